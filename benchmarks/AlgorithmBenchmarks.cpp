@@ -0,0 +1,637 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Macro benchmarks of the pose estimation algorithms
+ */
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <utMath/Pose.h>
+#include <utMath/Matrix.h>
+#include <utMath/PoseListOperations.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utMath/Geometry/PointProjection.h>
+#include <utMath/Geometry/PointTransformation.h>
+
+#include <utAlgorithm/PoseEstimation3D3D/AbsoluteOrientation.h>
+#include <utAlgorithm/PoseEstimation3D3D/Ransac.h>
+#include <utAlgorithm/PoseEstimation2D3D/NonPlanarPoseEstimation.h>
+#include <utAlgorithm/PoseEstimation2D3D/PlanarPoseEstimation.h>
+#include <utAlgorithm/PoseEstimation6D6D/DualQuaternion.h>
+#include <utAlgorithm/Homography.h>
+#include <utAlgorithm/Projection.h>
+#include <utAlgorithm/NewFunction/CameraIntrinsicsMultiplication.h>
+#include <utAlgorithm/Function/MultiplePointProjection.h>
+#include <utAlgorithm/Function/ProjectivePoseNormalize.h>
+#include <utTracking/PoseKalmanFilter.h>
+#include <utTracking/PoseFilterBank.h>
+
+#include <utMath/Optimization/Dogleg.h>
+
+#include <utMath/Optimization/NewFunction/Function.h>
+#include <utMath/Optimization/NewFunction/AutoDiffFunction.h>
+#include <utMath/Optimization/NewFunction/Dehomogenization.h>
+#include <utMath/Optimization/NewFunction/LieRotation.h>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+#ifdef HAVE_LAPACK
+
+namespace {
+
+/// two sets of corresponding 3D points related by a random pose
+template< std::size_t N_POINTS, std::size_t N_OUTLIERS >
+struct Correspondences3D3D
+{
+	std::vector< Vector< double, 3 > > pointsA, pointsB;
+
+	Correspondences3D3D()
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Quaternion< double >::Uniform randQuat;
+		Random::Vector< double, 3 >::Uniform randVector( -10, 10 );
+		Random::Vector< double, 3 >::Normal randNoise( 0, 1e-3 );
+
+		const Quaternion q( randQuat() );
+		const Vector< double, 3 > t( randVector() );
+		const Matrix< double, 3, 4 > trafo( q, t );
+
+		std::generate_n( std::back_inserter( pointsB ), N_POINTS, randVector );
+		Geometry::transform_points( trafo, pointsB.begin(), pointsB.end(), std::back_inserter( pointsA ) );
+		for ( std::size_t i = 0; i < N_POINTS; i++ )
+			pointsA[ i ] = pointsA[ i ] + ( i < N_OUTLIERS ? randVector() : randNoise() );
+	}
+};
+
+template< std::size_t N_POINTS >
+struct AbsoluteOrientation
+	: public Correspondences3D3D< N_POINTS, 0 >
+{
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Pose pose;
+			Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( this->pointsA, pose, this->pointsB );
+			Benchmark::consume( pose.translation()( 0 ) );
+		}
+	}
+};
+
+typedef AbsoluteOrientation< 10 > AbsoluteOrientation10;
+typedef AbsoluteOrientation< 1000 > AbsoluteOrientation1000;
+UBITRACK_BENCHMARK( "algorithm/pose6d_3d3d/10", AbsoluteOrientation10 );
+UBITRACK_BENCHMARK( "algorithm/pose6d_3d3d/1000", AbsoluteOrientation1000 );
+
+
+template< std::size_t N_POINTS, std::size_t N_OUTLIERS >
+struct RobustAbsoluteOrientation
+	: public Correspondences3D3D< N_POINTS, N_OUTLIERS >
+{
+	void operator()( const std::size_t n )
+	{
+		const Optimization::RansacParameter< double > params( 0.05, 3, N_POINTS / 2, std::size_t( 100 ) );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			// the sequential ransac draws its samples with rand()
+			std::srand( Benchmark::seed() );
+			Pose pose;
+			Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( this->pointsA, pose, this->pointsB, params );
+			Benchmark::consume( pose.translation()( 0 ) );
+		}
+	}
+};
+
+typedef RobustAbsoluteOrientation< 2000, 400 > RobustAbsoluteOrientation2000;
+UBITRACK_BENCHMARK( "algorithm/pose6d_3d3d_ransac/2000", RobustAbsoluteOrientation2000 );
+
+
+/// 2D-3D correspondences of a random pose in front of the camera, in float or double
+template< typename T, std::size_t N_POINTS >
+struct Correspondences2D3D
+{
+	std::vector< Vector< T, 3 > > p3D;
+	std::vector< Vector< T, 2 > > p2D;
+	Pose truth;
+	Pose initial;
+
+	Correspondences2D3D()
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Quaternion< double >::Uniform randQuat;
+		Random::Vector< double, 3 >::Uniform randVector( -0.5, 0.5 );
+
+		const Quaternion q( randQuat() );
+		Vector< double, 3 > t( Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( 2, 5 ) );
+		const Matrix< double, 3, 4 > proj( q, t );
+		truth = Pose( q, t );
+
+		std::vector< Vector< double, 3 > > points;
+		std::vector< Vector< double, 2 > > projected;
+		std::generate_n( std::back_inserter( points ), N_POINTS, randVector );
+		Geometry::project_points( proj, points.begin(), points.end(), std::back_inserter( projected ) );
+		for ( std::size_t i = 0; i < N_POINTS; i++ )
+		{
+			p3D.push_back( Vector< T, 3 >( T( points[ i ]( 0 ) ), T( points[ i ]( 1 ) ), T( points[ i ]( 2 ) ) ) );
+			p2D.push_back( Vector< T, 2 >( T( projected[ i ]( 0 ) ), T( projected[ i ]( 1 ) ) ) );
+		}
+
+		// start close to the solution as in tracking
+		initial = Pose( q, t + randVector() * 0.1 );
+	}
+
+	/// reports the distance of the estimated translation to the ground truth
+	void reportError( const Pose& pose ) const
+	{
+		Benchmark::reportError( ublas::norm_2( pose.translation() - truth.translation() ) );
+	}
+};
+
+template< typename T, std::size_t N_POINTS >
+struct PoseEstimation2D3D
+	: public Correspondences2D3D< T, N_POINTS >
+{
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Pose pose( this->initial );
+			T error( T( 1e-6 ) );
+			std::size_t iterations( 100 );
+			Algorithm::PoseEstimation2D3D::estimatePose6D_2D3D( this->p2D, pose, this->p3D, iterations, error );
+			Benchmark::consume( pose.translation()( 0 ) );
+			if ( i == 0 )
+				this->reportError( pose );
+		}
+	}
+};
+
+typedef PoseEstimation2D3D< double, 50 > PoseEstimation2D3D50;
+typedef PoseEstimation2D3D< float, 50 > PoseEstimation2D3D50f;
+UBITRACK_BENCHMARK( "algorithm/pose6d_2d3d/50", PoseEstimation2D3D50 );
+UBITRACK_BENCHMARK( "algorithm/pose6d_2d3d/50f", PoseEstimation2D3D50f );
+
+
+/// Levenberg-Marquardt refinement of a pose from 2D-3D correspondences
+template< typename T, std::size_t N_POINTS >
+struct OptimizePose
+	: public Correspondences2D3D< T, N_POINTS >
+{
+	/// the correspondences are in normalized image coordinates
+	Matrix< T, 3, 3 > cam;
+
+	OptimizePose()
+		: cam( Matrix< T, 3, 3 >::identity() )
+	{}
+
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Pose pose( this->initial );
+			Algorithm::PoseEstimation2D3D::optimizePose( pose, this->p2D, this->p3D, cam, 10 );
+			Benchmark::consume( pose.translation()( 0 ) );
+			if ( i == 0 )
+				this->reportError( pose );
+		}
+	}
+};
+
+typedef OptimizePose< double, 50 > OptimizePose50;
+typedef OptimizePose< float, 50 > OptimizePose50f;
+UBITRACK_BENCHMARK( "algorithm/optimize_pose/50", OptimizePose50 );
+UBITRACK_BENCHMARK( "algorithm/optimize_pose/50f", OptimizePose50f );
+
+
+/// the same refinement with the dogleg trust-region optimizer
+template< typename T, std::size_t N_POINTS >
+struct OptimizePoseDogleg
+	: public OptimizePose< T, N_POINTS >
+{
+	void operator()( const std::size_t n )
+	{
+		Vector< T > measurements( 2 * N_POINTS );
+		for ( std::size_t i = 0; i < N_POINTS; i++ )
+			ublas::subrange( measurements, 2 * i, 2 * i + 2 ) = this->p2D[ i ];
+		Algorithm::Function::MultiplePointProjection< T > projection( this->p3D, this->cam );
+
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Vector< T, 7 > params;
+			this->initial.toVector( params );
+			Optimization::dogleg( projection, params, measurements,
+				Optimization::OptTerminate( 10, 1e-6 ), Algorithm::Function::ProjectivePoseNormalize() );
+			const Pose pose( Pose::fromVector( params ) );
+			Benchmark::consume( pose.translation()( 0 ) );
+			if ( i == 0 )
+				this->reportError( pose );
+		}
+	}
+};
+
+typedef OptimizePoseDogleg< double, 50 > OptimizePoseDogleg50;
+UBITRACK_BENCHMARK( "algorithm/optimize_pose/50_dogleg", OptimizePoseDogleg50 );
+
+
+/// refinement of many small independent poses per frame, one at a time or as a batch
+template< std::size_t N_BODIES, std::size_t N_POINTS, bool BATCH, std::size_t N_THREADS >
+struct OptimizePoses
+{
+	Matrix< double, 3, 3 > cam;
+	std::vector< Pose > initial;
+	std::vector< std::vector< Vector< double, 2 > > > p2D;
+	std::vector< std::vector< Vector< double, 3 > > > p3D;
+	Math::ListExecutor executor;
+
+	OptimizePoses()
+		: cam( Matrix< double, 3, 3 >::identity() )
+		, p2D( N_BODIES )
+		, p3D( N_BODIES )
+	{
+		if ( N_THREADS > 0 )
+			executor = threadExecutor( N_THREADS, 8 );
+
+		Random::Quaternion< double >::Uniform randQuat;
+		Random::Vector< double, 3 >::Uniform randVector( -0.1, 0.1 );
+		for ( std::size_t i = 0; i < N_BODIES; i++ )
+		{
+			const Quaternion q( randQuat() );
+			const Vector< double, 3 > t( Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( 2, 5 ) );
+			std::generate_n( std::back_inserter( p3D[ i ] ), N_POINTS, randVector );
+			Geometry::project_points( Matrix< double, 3, 4 >( q, t ), p3D[ i ].begin(), p3D[ i ].end(), std::back_inserter( p2D[ i ] ) );
+			initial.push_back( Pose( q, t + randVector() * 0.1 ) );
+		}
+	}
+
+	void operator()( const std::size_t n )
+	{
+		std::vector< Pose > poses;
+		std::vector< Algorithm::PoseEstimation2D3D::PoseOptimizationResult > results;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			poses = initial;
+			if ( BATCH )
+				Algorithm::PoseEstimation2D3D::optimizePoses( poses, p2D, p3D, cam, results, 10, executor );
+			else
+				for ( std::size_t j = 0; j < N_BODIES; j++ )
+					Algorithm::PoseEstimation2D3D::optimizePose( poses[ j ], p2D[ j ], p3D[ j ], cam, 10 );
+			Benchmark::consume( poses.back().translation()( 0 ) );
+		}
+	}
+};
+
+typedef OptimizePoses< 100, 12, false, 0 > OptimizePosesLoop;
+typedef OptimizePoses< 100, 12, true, 0 > OptimizePosesBatch;
+typedef OptimizePoses< 100, 12, true, 4 > OptimizePosesThreads;
+UBITRACK_BENCHMARK( "algorithm/optimize_poses/100x12_loop", OptimizePosesLoop );
+UBITRACK_BENCHMARK( "algorithm/optimize_poses/100x12_batch", OptimizePosesBatch );
+UBITRACK_BENCHMARK( "algorithm/optimize_poses/100x12_threads4", OptimizePosesThreads );
+
+
+template< std::size_t N_POINTS >
+struct HomographyDLT
+{
+	std::vector< Vector< double, 2 > > from, to;
+
+	HomographyDLT()
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Vector< double, 2 >::Uniform randVector( -1, 1 );
+		Matrix< double, 3, 3 > H( Matrix< double, 3, 3 >::identity() );
+		H( 0, 1 ) = 0.1; H( 0, 2 ) = 0.5; H( 1, 2 ) = -0.3; H( 2, 0 ) = 0.05;
+
+		for ( std::size_t i = 0; i < N_POINTS; i++ )
+		{
+			const Vector< double, 2 > p( randVector() );
+			const Vector< double, 3 > q( boost::numeric::ublas::prod( H, Vector< double, 3 >( p( 0 ), p( 1 ), 1 ) ) );
+			from.push_back( p );
+			to.push_back( Vector< double, 2 >( q( 0 ) / q( 2 ), q( 1 ) / q( 2 ) ) );
+		}
+	}
+
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+			Benchmark::consume( Algorithm::homographyDLT( from, to )( 0, 0 ) );
+	}
+};
+
+typedef HomographyDLT< 50 > HomographyDLT50;
+UBITRACK_BENCHMARK( "algorithm/homography_dlt/50", HomographyDLT50 );
+
+
+template< std::size_t N_POINTS >
+struct ProjectionDLT
+{
+	std::vector< Vector< double, 3 > > from;
+	std::vector< Vector< double, 2 > > to;
+
+	ProjectionDLT()
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+		cam( 0, 0 ) = cam( 1, 1 ) = 500;
+		const Matrix< double, 3, 4 > P( boost::numeric::ublas::prod( cam,
+			Matrix< double, 3, 4 >( Quaternion( Vector< double, 3 >( 0, 1, 0 ), 0.3 ), Vector< double, 3 >( 0.2, -0.1, 5 ) ) ) );
+
+		std::generate_n( std::back_inserter( from ), N_POINTS, randVector );
+		Geometry::project_points( P, from.begin(), from.end(), std::back_inserter( to ) );
+	}
+
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+			Benchmark::consume( Algorithm::projectionDLT( from, to )( 0, 0 ) );
+	}
+};
+
+typedef ProjectionDLT< 50 > ProjectionDLT50;
+UBITRACK_BENCHMARK( "algorithm/projection_dlt/50", ProjectionDLT50 );
+
+
+template< std::size_t N_POSES >
+struct HandEye
+{
+	std::vector< Pose > eyes, hands;
+
+	HandEye()
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Quaternion< double >::Uniform randQuat;
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+
+		const Pose x( randQuat(), randVector() );
+		for ( std::size_t i = 0; i < N_POSES; i++ )
+		{
+			const Pose hand( randQuat(), randVector() );
+			hands.push_back( hand );
+			eyes.push_back( ~( x * hand ) );
+		}
+	}
+
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Pose pose;
+			Algorithm::PoseEstimation6D6D::estimatePose6D_6D6D( eyes, pose, hands );
+			Benchmark::consume( pose.translation()( 0 ) );
+		}
+	}
+};
+
+typedef HandEye< 20 > HandEye20;
+UBITRACK_BENCHMARK( "algorithm/pose6d_6d6d/20", HandEye20 );
+
+
+/// intrinsics and rotation of a camera observing random points, as in a calibration problem
+struct ProjectionJacobian
+{
+	std::vector< Vector< double, 3 > > points;
+	Vector< double, 8 > params;
+
+	ProjectionJacobian()
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		for ( std::size_t i = 0; i < 64; i++ )
+			points.push_back( randVector() + Vector< double, 3 >( 0, 0, 5 ) );
+		params( 0 ) = 500; params( 1 ) = 0.5; params( 2 ) = -320; params( 3 ) = 510; params( 4 ) = -240;
+		ublas::subrange( params, 5, 8 ) = randVector() * 0.5;
+	}
+};
+
+/// hand-written jacobians composed by the binder
+struct ProjectionJacobianComposed
+	: public ProjectionJacobian
+{
+	void operator()( const std::size_t n )
+	{
+		namespace NF = Optimization::Function;
+		Vector< double, 2 > value;
+		Matrix< double, 2, 8 > j;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			( Algorithm::Function::CameraIntrinsicsMultiplication() << NF::parameter< 5 >( 0 ) <<
+				( NF::Dehomogenization< 3 >() <<
+					( NF::LieRotation() << NF::parameter< 3 >( 5 ) << NF::fixedParameterRef< 3 >( points[ i % points.size() ] ) ) ) )
+				.evaluateWithJacobian( params, value, j );
+			Benchmark::consume( j( 1, 7 ) );
+		}
+	}
+};
+UBITRACK_BENCHMARK( "algorithm/new_function/projection_jacobian/composed", ProjectionJacobianComposed );
+
+/// the same projection as a single node with automatic differentiation
+struct AutoDiffProjection
+	: public Optimization::Function::AutoDiffFunction< AutoDiffProjection, 2, 5, 3, 0 >
+{
+	template< class DestinationVector, class Param1, class Param2, class Param3 >
+	void evaluate( DestinationVector& result, const Param1& intr, const Param2& r, const Param3& p ) const
+	{
+		// Rodrigues' formula, r is never close to zero here
+		typedef typename DestinationVector::value_type T;
+		const T c[ 3 ] = { r( 1 ) * p( 2 ) - r( 2 ) * p( 1 ), r( 2 ) * p( 0 ) - r( 0 ) * p( 2 ), r( 0 ) * p( 1 ) - r( 1 ) * p( 0 ) };
+		const T cc[ 3 ] = { r( 1 ) * c[ 2 ] - r( 2 ) * c[ 1 ], r( 2 ) * c[ 0 ] - r( 0 ) * c[ 2 ], r( 0 ) * c[ 1 ] - r( 1 ) * c[ 0 ] };
+		const T theta2 = r( 0 ) * r( 0 ) + r( 1 ) * r( 1 ) + r( 2 ) * r( 2 );
+		const T theta = sqrt( theta2 );
+		const T a = sin( theta ) / theta;
+		const T b = ( 1 - cos( theta ) ) / theta2;
+		const T iz = 1 / ( p( 2 ) + a * c[ 2 ] + b * cc[ 2 ] );
+		const T x = ( p( 0 ) + a * c[ 0 ] + b * cc[ 0 ] ) * iz;
+		const T y = ( p( 1 ) + a * c[ 1 ] + b * cc[ 1 ] ) * iz;
+		result( 0 ) = -( intr( 0 ) * x + intr( 1 ) * y + intr( 2 ) );
+		result( 1 ) = -( intr( 3 ) * y + intr( 4 ) );
+	}
+};
+
+struct ProjectionJacobianAutoDiff
+	: public ProjectionJacobian
+{
+	void operator()( const std::size_t n )
+	{
+		namespace NF = Optimization::Function;
+		Vector< double, 2 > value;
+		Matrix< double, 2, 8 > j;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			( AutoDiffProjection() << NF::parameter< 5 >( 0 ) << NF::parameter< 3 >( 5 ) << NF::fixedParameterRef< 3 >( points[ i % points.size() ] ) )
+				.evaluateWithJacobian( params, value, j );
+			Benchmark::consume( j( 1, 7 ) );
+		}
+	}
+};
+UBITRACK_BENCHMARK( "algorithm/new_function/projection_jacobian/autodiff", ProjectionJacobianAutoDiff );
+
+
+/** pose kalman filter with constant velocity and angular velocity, one pose and one rotation velocity per step */
+struct PoseKalmanFilter11
+{
+	std::vector< Measurement::ErrorPose > poses;
+	Math::Stochastic::KalmanCovarianceForm form;
+
+	PoseKalmanFilter11()
+		: form( Math::Stochastic::kalmanFullCovariance )
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		for ( std::size_t i = 0; i < 100; i++ )
+			poses.push_back( Measurement::ErrorPose( 1000000000ULL + i * 1000000ULL, ErrorPose( Random::Quaternion< double >::Uniform()(),
+				randVector(), Matrix< double, 6, 6 >::identity() * 1e-4 ) ) );
+	}
+
+	void operator()( const std::size_t n )
+	{
+		Tracking::LinearPoseMotionModel motionModel( 1, 1 );
+		motionModel.setPosPN( 0, 0.1 );
+		motionModel.setPosPN( 1, 0.1 );
+		motionModel.setOriPN( 0, 0.1 );
+		motionModel.setOriPN( 1, 0.1 );
+		Tracking::PoseKalmanFilter filter( motionModel );
+		filter.setCovarianceForm( form );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Measurement::ErrorPose m( poses[ i % poses.size() ] );
+			m.time( 1000000000ULL + i * 1000000ULL );
+			filter.addPoseMeasurement( m );
+			filter.addRotationVelocityMeasurement( Measurement::RotationVelocity( m.time() + 500000ULL, RotationVelocity( 0.1, 0.2, -0.1 ) ) );
+		}
+		Benchmark::consume( filter.getState()( 0 ) );
+	}
+};
+UBITRACK_BENCHMARK( "tracking/pose_kalman_filter/1_1", PoseKalmanFilter11 );
+
+struct PoseKalmanFilter11UD
+	: public PoseKalmanFilter11
+{
+	PoseKalmanFilter11UD()
+	{ form = Math::Stochastic::kalmanUDFactors; }
+};
+UBITRACK_BENCHMARK( "tracking/pose_kalman_filter/1_1_ud", PoseKalmanFilter11UD );
+
+
+/** pose predictions at display rate from a filter with constant velocity and angular velocity */
+struct PosePrediction11
+{
+	Tracking::PoseKalmanFilter filter;
+
+	PosePrediction11()
+		: filter( Tracking::LinearPoseMotionModel( 1, 1 ) )
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		filter.addPoseMeasurement( Measurement::ErrorPose( 1000000000ULL, ErrorPose( Random::Quaternion< double >::Uniform()(),
+			randVector(), Matrix< double, 6, 6 >::identity() * 1e-4 ) ) );
+		filter.addRotationVelocityMeasurement( Measurement::RotationVelocity( 1000500000ULL, RotationVelocity( 0.1, 0.2, -0.1 ) ) );
+	}
+};
+
+struct PosePrediction11Full
+	: public PosePrediction11
+{
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+			Benchmark::consume( filter.predictPose( 1001000000ULL + i * 11111ULL )->translation()( 0 ) );
+	}
+};
+UBITRACK_BENCHMARK( "tracking/pose_prediction/1_1/covariance", PosePrediction11Full );
+
+struct PosePrediction11Extrapolate
+	: public PosePrediction11
+{
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+			Benchmark::consume( filter.extrapolatePose( 1001000000ULL + i * 11111ULL )->translation()( 0 ) );
+	}
+};
+UBITRACK_BENCHMARK( "tracking/pose_prediction/1_1/extrapolate", PosePrediction11Extrapolate );
+
+
+/** time updates of 512 targets with constant velocity and angular velocity, each after a pose measurement */
+struct PoseFilters512
+{
+	Tracking::LinearPoseMotionModel motionModel;
+	std::vector< std::pair< std::size_t, Measurement::ErrorPose > > measurements;
+
+	PoseFilters512()
+		: motionModel( 1, 1 )
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		motionModel.setPosPN( 0, 0.1 );
+		motionModel.setPosPN( 1, 0.1 );
+		motionModel.setOriPN( 0, 0.1 );
+		motionModel.setOriPN( 1, 0.1 );
+		for ( std::size_t i = 0; i < 512; i++ )
+			measurements.push_back( std::make_pair( i, Measurement::ErrorPose( 1000000000ULL, ErrorPose( Random::Quaternion< double >::Uniform()(),
+				randVector(), Matrix< double, 6, 6 >::identity() * 1e-4 ) ) ) );
+	}
+};
+
+struct PoseFilters512Separate
+	: public PoseFilters512
+{
+	void operator()( const std::size_t n )
+	{
+		std::vector< Tracking::PoseKalmanFilterT< 1, 1 > > filters( measurements.size(), Tracking::PoseKalmanFilterT< 1, 1 >( motionModel ) );
+		for ( std::size_t i = 0; i < filters.size(); i++ )
+			filters[ i ].addPoseMeasurement( measurements[ i ].second );
+		for ( std::size_t i = 0; i < n; i++ )
+			for ( std::size_t j = 0; j < filters.size(); j++ )
+				filters[ j ].timeUpdate( 1000000000ULL + ( i + 1 ) * 1000000ULL );
+		Benchmark::consume( filters[ 0 ].state()( 0 ) );
+	}
+};
+
+struct PoseFilters512Bank
+	: public PoseFilters512
+{
+	void operator()( const std::size_t n )
+	{
+		Tracking::PoseFilterBank< 1, 1 > bank( motionModel );
+		for ( std::size_t i = 0; i < measurements.size(); i++ )
+			bank.addTarget();
+		bank.addPoseMeasurements( measurements );
+		for ( std::size_t i = 0; i < n; i++ )
+			bank.timeUpdate( 1000000000ULL + ( i + 1 ) * 1000000ULL );
+		Benchmark::consume( bank.predictPose( 0, 1000000000ULL + n * 1000000ULL )->translation()( 0 ) );
+	}
+};
+UBITRACK_BENCHMARK( "tracking/pose_filters/512_time_update/separate", PoseFilters512Separate );
+UBITRACK_BENCHMARK( "tracking/pose_filters/512_time_update/bank", PoseFilters512Bank );
+
+} // anonymous namespace
+
+#endif // HAVE_LAPACK
@@ -0,0 +1,150 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Runner and output of the utcore benchmarks
+ */
+
+#include "Benchmark.h"
+
+#include <map>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include <utUtil/OS.h>
+
+namespace Ubitrack { namespace Benchmark {
+
+namespace {
+
+/// all benchmarks, sorted by name
+std::map< std::string, FactoryFunction >& registry()
+{
+	static std::map< std::string, FactoryFunction > benchmarks;
+	return benchmarks;
+}
+
+volatile double g_sink = 0;
+
+/// largest error reported by the running benchmark, negative if none
+double g_error = -1;
+
+/// runs the benchmark n times and returns the elapsed time in seconds
+double timeRuns( RunFunction& f, const std::size_t n )
+{
+	const long long start = Util::getHighPerformanceCounter();
+	f( n );
+	return ( Util::getHighPerformanceCounter() - start ) / Util::getHighPerformanceFrequency();
+}
+
+} // anonymous namespace
+
+
+void registerBenchmark( const std::string& name, FactoryFunction factory )
+{
+	registry()[ name ] = factory;
+}
+
+
+void consume( double value )
+{
+	g_sink = g_sink + value;
+}
+
+
+void reportError( double error )
+{
+	g_error = std::max( g_error, std::fabs( error ) );
+}
+
+
+std::vector< Result > runBenchmarks( const Settings& settings )
+{
+	std::vector< Result > results;
+	for ( std::map< std::string, FactoryFunction >::const_iterator it = registry().begin(); it != registry().end(); ++it )
+	{
+		if ( it->first.find( settings.filter ) == std::string::npos )
+			continue;
+
+		RunFunction f = it->second();
+		g_error = -1;
+
+		// warm up and find the number of runs that fill one sample
+		std::size_t n = 1;
+		while ( timeRuns( f, n ) < settings.minSampleTime && n < ( std::size_t( 1 ) << 30 ) )
+			n *= 2;
+
+		std::vector< double > times;
+		for ( std::size_t s = 0; s < settings.samples; s++ )
+			times.push_back( timeRuns( f, n ) * 1e9 / n );
+		std::sort( times.begin(), times.end() );
+
+		Result r;
+		r.name = it->first;
+		r.runs = n;
+		r.samples = times.size();
+		r.minNs = times.front();
+		r.medianNs = times[ times.size() / 2 ];
+		r.meanNs = std::accumulate( times.begin(), times.end(), 0.0 ) / times.size();
+		r.hasError = g_error >= 0;
+		r.error = r.hasError ? g_error : 0;
+		results.push_back( r );
+	}
+	return results;
+}
+
+
+void writeCsv( std::ostream& os, const std::vector< Result >& results )
+{
+	os << "name,runs,samples,min_ns,median_ns,mean_ns,error\n";
+	for ( std::vector< Result >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		os << it->name << ',' << it->runs << ',' << it->samples << ',' << std::setprecision( 6 )
+			<< it->minNs << ',' << it->medianNs << ',' << it->meanNs << ',';
+		if ( it->hasError )
+			os << it->error;
+		os << '\n';
+	}
+}
+
+
+void writeJson( std::ostream& os, const std::vector< Result >& results )
+{
+	os << "{\n  \"benchmarks\": [";
+	for ( std::vector< Result >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		os << ( it == results.begin() ? "\n" : ",\n" ) << std::setprecision( 6 )
+			<< "    { \"name\": \"" << it->name << "\", \"runs\": " << it->runs << ", \"samples\": " << it->samples
+			<< ", \"min_ns\": " << it->minNs << ", \"median_ns\": " << it->medianNs << ", \"mean_ns\": " << it->meanNs;
+		if ( it->hasError )
+			os << ", \"error\": " << it->error;
+		os << " }";
+	}
+	os << "\n  ]\n}\n";
+}
+
+} } // namespace Ubitrack::Benchmark
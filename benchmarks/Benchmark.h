@@ -0,0 +1,151 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Minimal harness for the utcore micro and macro benchmarks
+ *
+ * A benchmark is a class with a default constructor, that generates the
+ * (synthetic) input data, and an <tt>operator()( std::size_t n )</tt>, that runs
+ * the measured code \c n times. The runner calibrates \c n such that one sample
+ * takes at least the minimum sample time and reports the time per run:
+ * @code
+ * struct QuaternionProduct
+ * {
+ *     QuaternionProduct() { ... generate data ... }
+ *     void operator()( const std::size_t n ) { ... }
+ * };
+ * UBITRACK_BENCHMARK( "math/quaternion/product", QuaternionProduct );
+ * @endcode
+ *
+ * The constructors should seed the random generators with \c Benchmark::seed() before
+ * generating data, so all runs and all machines measure the same input.
+ */
+
+#ifndef __UBITRACK_BENCHMARK_BENCHMARK_H_INCLUDED__
+#define __UBITRACK_BENCHMARK_BENCHMARK_H_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+#include <boost/function.hpp>
+
+namespace Ubitrack { namespace Benchmark {
+
+/** function running the measured code n times */
+typedef boost::function< void ( std::size_t ) > RunFunction;
+
+/** creates the benchmark including its input data */
+typedef RunFunction ( *FactoryFunction )();
+
+/** result of one benchmark */
+struct Result
+{
+	std::string name;
+	/// number of runs per sample
+	std::size_t runs;
+	/// number of samples
+	std::size_t samples;
+	/// time per run in nanoseconds
+	double minNs;
+	double medianNs;
+	double meanNs;
+	/// true, if the benchmark reported an error with \c reportError
+	bool hasError;
+	/// largest error reported by the benchmark
+	double error;
+};
+
+/** settings of the runner */
+struct Settings
+{
+	Settings()
+		: minSampleTime( 0.05 )
+		, samples( 7 )
+	{}
+
+	/// minimum duration of one sample in seconds
+	double minSampleTime;
+
+	/// number of samples per benchmark
+	std::size_t samples;
+
+	/// only benchmarks whose name contains this string are run
+	std::string filter;
+};
+
+/** adds a benchmark to the global list, used by \c UBITRACK_BENCHMARK */
+void registerBenchmark( const std::string& name, FactoryFunction factory );
+
+/** runs all registered benchmarks whose name matches the filter */
+std::vector< Result > runBenchmarks( const Settings& settings );
+
+/** writes the results as comma separated values, one benchmark per line */
+void writeCsv( std::ostream& os, const std::vector< Result >& results );
+
+/** writes the results as a json document */
+void writeJson( std::ostream& os, const std::vector< Result >& results );
+
+/** seed for the random data of the benchmarks */
+inline unsigned seed()
+{ return 5489u; }
+
+/**
+ * prevents the compiler from removing computations whose result is not used
+ * by adding a value to a global sink
+ */
+void consume( double value );
+
+/**
+ * reports the accuracy of the measured code, e.g. the deviation of an estimate from the
+ * ground truth of the synthetic data, to compare float and double variants. The largest
+ * value reported while the benchmark runs is written next to its timing.
+ */
+void reportError( double error );
+
+/// @internal creates a benchmark of type \c B
+template< class B >
+RunFunction createBenchmark()
+{ return RunFunction( B() ); }
+
+/// @internal registers a benchmark at static initialization time
+struct Registrar
+{
+	Registrar( const std::string& name, FactoryFunction factory )
+	{ registerBenchmark( name, factory ); }
+};
+
+} } // namespace Ubitrack::Benchmark
+
+#define UBITRACK_BENCHMARK_CONCAT2( a, b ) a##b
+#define UBITRACK_BENCHMARK_CONCAT( a, b ) UBITRACK_BENCHMARK_CONCAT2( a, b )
+
+/**
+ * registers the benchmark class \c type under the given name,
+ * names are hierarchical with '/' as separator, e.g. "math/blas1/inner_product"
+ */
+#define UBITRACK_BENCHMARK( name, type ) \
+	static Ubitrack::Benchmark::Registrar UBITRACK_BENCHMARK_CONCAT( _benchmarkRegistrar, __LINE__ )( name, &Ubitrack::Benchmark::createBenchmark< type > )
+
+#endif // __UBITRACK_BENCHMARK_BENCHMARK_H_INCLUDED__
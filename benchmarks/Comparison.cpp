@@ -0,0 +1,551 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Accuracy and runtime of alternative solvers and estimators, see Comparison.h
+ */
+
+#include "Comparison.h"
+#include "Benchmark.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <utUtil/OS.h>
+#include <utUtil/Exception.h>
+#include <utMath/Pose.h>
+#include <utMath/Matrix.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utMath/Optimization/Optimization.h>
+#include <utMath/Optimization/OptTelemetry.h>
+#include <utMath/Optimization/LevenbergMarquardt.h>
+
+#include <utAlgorithm/Function/MultiplePointProjection.h>
+#include <utAlgorithm/Function/ProjectivePoseNormalize.h>
+#include <utAlgorithm/PoseEstimation2D3D/PlanarPoseEstimation.h>
+#include <utAlgorithm/PoseEstimation3D3D/AbsoluteOrientation.h>
+#include <utAlgorithm/PoseEstimation3D3D/Ransac.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace Ubitrack { namespace Benchmark {
+
+namespace {
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+#ifdef HAVE_LAPACK
+
+/// a configuration of a problem
+struct Configuration
+{
+	Configuration( const std::string& p, std::size_t s, double n, double o = 0 )
+		: problem( p )
+		, size( s )
+		, noise( n )
+		, outliers( o )
+	{}
+
+	std::string problem;
+	std::size_t size;
+	double noise;
+	double outliers;
+};
+
+
+/// runtimes and errors of one variant on the trials of one configuration
+struct Trials
+{
+	Trials()
+		: failures( 0 )
+		, fallbacks( 0 )
+	{}
+
+	/// runtimes in microseconds, including the failed trials
+	std::vector< double > times;
+	/// errors of the successful trials
+	std::vector< double > errors;
+	std::size_t failures;
+	std::size_t fallbacks;
+};
+
+
+double percentile( std::vector< double > values, const double p )
+{
+	if ( values.empty() )
+		return std::numeric_limits< double >::quiet_NaN();
+	std::sort( values.begin(), values.end() );
+	return values[ std::min( values.size() - 1, static_cast< std::size_t >( p * values.size() ) ) ];
+}
+
+
+/**
+ * times one trial of a variant. \c f returns the error of the result, a negative or NaN
+ * error or a \c Util::Exception count as failure.
+ */
+template< class F >
+void runTrial( Trials& trials, const F& f )
+{
+	const long long start = Ubitrack::Util::getHighPerformanceCounter();
+	double error = -1;
+	try
+	{
+		error = f();
+	}
+	catch ( const Ubitrack::Util::Exception& )
+	{}
+	trials.times.push_back( ( Ubitrack::Util::getHighPerformanceCounter() - start ) * 1e6 / Ubitrack::Util::getHighPerformanceFrequency() );
+
+	if ( error >= 0 )
+		trials.errors.push_back( error );
+	else
+		trials.failures++;
+}
+
+
+/** appends the results of the variants of one configuration and marks the Pareto optimal ones */
+void appendResults( const Configuration& config, const std::vector< std::string >& variants,
+	const std::vector< Trials >& trials, const std::vector< bool >& fallbacks, std::vector< ComparisonResult >& results )
+{
+	const std::size_t first = results.size();
+	for ( std::size_t i = 0; i < variants.size(); i++ )
+	{
+		ComparisonResult r;
+		r.problem = config.problem;
+		r.variant = variants[ i ];
+		r.size = config.size;
+		r.noise = config.noise;
+		r.outliers = config.outliers;
+		r.trials = trials[ i ].times.size();
+		r.failures = trials[ i ].failures;
+		r.medianUs = percentile( trials[ i ].times, 0.5 );
+		r.medianError = percentile( trials[ i ].errors, 0.5 );
+		r.p90Error = percentile( trials[ i ].errors, 0.9 );
+		r.fallbackRate = fallbacks[ i ] && r.trials ? double( trials[ i ].fallbacks ) / r.trials : -1;
+		r.pareto = false;
+		results.push_back( r );
+	}
+
+	for ( std::size_t i = first; i < results.size(); i++ )
+	{
+		ComparisonResult& r = results[ i ];
+		if ( 2 * r.failures > r.trials )
+			continue;
+
+		r.pareto = true;
+		for ( std::size_t j = first; j < results.size() && r.pareto; j++ )
+		{
+			const ComparisonResult& other = results[ j ];
+			if ( j == i || 2 * other.failures > other.trials )
+				continue;
+			if ( other.medianUs <= r.medianUs && other.medianError <= r.medianError
+				&& ( other.medianUs < r.medianUs || other.medianError < r.medianError ) )
+				r.pareto = false;
+		}
+	}
+}
+
+
+/// 2D-3D correspondences of a random pose seen by a 640x480 camera in the ubitrack convention
+struct Scene2D3D
+{
+	Scene2D3D( const std::size_t n, const double noise, const bool bPlanar )
+		: cam( Matrix< double, 3, 3 >::identity() )
+	{
+		cam( 0, 0 ) = cam( 1, 1 ) = 500;
+		cam( 0, 2 ) = -320;
+		cam( 1, 2 ) = -240;
+		cam( 2, 2 ) = -1;
+
+		// planar targets are tilted by at most 60 degrees, so that they are not seen edge-on
+		Quaternion rotation;
+		if ( bPlanar )
+		{
+			const double a = Random::distribute_uniform< double >( -M_PI, M_PI );
+			rotation = Quaternion( Vector< double, 3 >( std::cos( a ), std::sin( a ), 0 ), Random::distribute_uniform< double >( -1, 1 ) )
+				* Quaternion( Vector< double, 3 >( 0, 0, 1 ), Random::distribute_uniform< double >( -M_PI, M_PI ) );
+		}
+		else
+			rotation = Random::Quaternion< double >::Uniform()();
+		truth = Pose( rotation, Vector< double, 3 >( Random::distribute_uniform< double >( -0.5, 0.5 ),
+			Random::distribute_uniform< double >( -0.5, 0.5 ), -Random::distribute_uniform< double >( 3, 6 ) ) );
+
+		Random::Vector< double, 3 >::Uniform randVector( -0.5, 0.5 );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Vector< double, 3 > p( randVector() );
+			if ( bPlanar )
+				p( 2 ) = 0;
+			p3D.push_back( p );
+
+			const Vector< double, 3 > x( ublas::prod( cam, truth * p ) );
+			Vector< double, 2 > p2( x( 0 ) / x( 2 ), x( 1 ) / x( 2 ) );
+			if ( noise > 0 )
+				for ( std::size_t j = 0; j < 2; j++ )
+					p2( j ) += Random::distribute_normal< double >( 0, noise );
+			p2D.push_back( p2 );
+		}
+	}
+
+	double error( const Pose& pose ) const
+	{ return ublas::norm_2( pose.translation() - truth.translation() ); }
+
+	Matrix< double, 3, 3 > cam;
+	Pose truth;
+	std::vector< Vector< double, 3 > > p3D;
+	std::vector< Vector< double, 2 > > p2D;
+};
+
+
+/// refines a perturbed pose with one of the solvers of levenbergMarquardt
+struct LmRefinement
+{
+	LmRefinement( const Scene2D3D& scene, const Pose& initial, const Optimization::LmSolverType solver )
+		: m_scene( scene )
+		, m_initial( initial )
+		, m_solver( solver )
+	{}
+
+	double operator()() const
+	{
+		Vector< double > measurements( 2 * m_scene.p2D.size() );
+		for ( std::size_t i = 0; i < m_scene.p2D.size(); i++ )
+			ublas::subrange( measurements, 2 * i, 2 * i + 2 ) = m_scene.p2D[ i ];
+		Algorithm::Function::MultiplePointProjection< double > projection( m_scene.p3D, m_scene.cam );
+
+		Vector< double, 7 > params;
+		m_initial.toVector( params );
+		Optimization::levenbergMarquardt( projection, params, measurements, Optimization::OptTerminate( 10, 1e-6 ),
+			Algorithm::Function::ProjectivePoseNormalize(), m_solver );
+		return m_scene.error( Pose::fromVector( params ) );
+	}
+
+	const Scene2D3D& m_scene;
+	const Pose& m_initial;
+	Optimization::LmSolverType m_solver;
+};
+
+
+/// computePose with one initialization, optionally refined
+struct PoseFromCorrespondences
+{
+	PoseFromCorrespondences( const Scene2D3D& scene, const Algorithm::PoseEstimation2D3D::InitializationMethod method, const bool bOptimize )
+		: m_scene( scene )
+		, m_method( method )
+		, m_bOptimize( bOptimize )
+	{}
+
+	double operator()() const
+	{
+		double residual;
+		const ErrorPose pose( Algorithm::PoseEstimation2D3D::computePose( m_scene.p2D, m_scene.p3D, m_scene.cam, residual, m_bOptimize, m_method ) );
+		return m_scene.error( pose );
+	}
+
+	const Scene2D3D& m_scene;
+	Algorithm::PoseEstimation2D3D::InitializationMethod m_method;
+	bool m_bOptimize;
+};
+
+
+/// 3D-3D correspondences related by a random pose, the outliers are mixed with the inliers
+struct Scene3D3D
+{
+	Scene3D3D( const std::size_t n, const double noise, const double outliers )
+		: truth( Random::Quaternion< double >::Uniform()(), Random::Vector< double, 3 >::Uniform( -1, 1 )() )
+	{
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			pointsB.push_back( randVector() );
+			if ( Random::distribute_uniform< double >( 0, 1 ) < outliers )
+				pointsA.push_back( truth * randVector() );
+			else
+			{
+				Vector< double, 3 > a( truth * pointsB.back() );
+				for ( std::size_t j = 0; j < 3; j++ )
+					a( j ) += Random::distribute_normal< double >( 0, noise );
+				pointsA.push_back( a );
+			}
+		}
+	}
+
+	double error( const Pose& pose ) const
+	{ return ublas::norm_2( pose.translation() - truth.translation() ); }
+
+	Pose truth;
+	std::vector< Vector< double, 3 > > pointsA;
+	std::vector< Vector< double, 3 > > pointsB;
+};
+
+
+/// absolute orientation in closed form, on all points
+struct ClosedFormOrientation
+{
+	explicit ClosedFormOrientation( const Scene3D3D& scene )
+		: m_scene( scene )
+	{}
+
+	double operator()() const
+	{
+		Pose pose;
+		if ( !Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( m_scene.pointsA, pose, m_scene.pointsB ) )
+			return -1;
+		return m_scene.error( pose );
+	}
+
+	const Scene3D3D& m_scene;
+};
+
+
+/// absolute orientation with RANSAC
+struct RansacOrientation
+{
+	RansacOrientation( const Scene3D3D& scene, const Optimization::RansacParameter< double >& params )
+		: m_scene( scene )
+		, m_params( params )
+	{}
+
+	double operator()() const
+	{
+		// the sequential RANSAC draws from rand(), all variants get the same sequence
+		std::srand( seed() );
+		Pose pose;
+		if ( !Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( m_scene.pointsA, pose, m_scene.pointsB, m_params ) )
+			return -1;
+		return m_scene.error( pose );
+	}
+
+	const Scene3D3D& m_scene;
+	Optimization::RansacParameter< double > m_params;
+};
+
+
+bool selected( const ComparisonSettings& settings, const std::string& problem )
+{ return settings.filter.empty() || problem.find( settings.filter ) != std::string::npos; }
+
+
+void compareLmSolvers( const ComparisonSettings& settings, std::vector< ComparisonResult >& results )
+{
+	static const char* names[] = { "cholesky", "qr", "svd", "cg" };
+	static const Optimization::LmSolverType solvers[] = { Optimization::lmUseCholesky, Optimization::lmUseQR,
+		Optimization::lmUseSVD, Optimization::lmUseCG };
+	static const std::size_t sizes[] = { 6, 50, 500 };
+	static const double noises[] = { 0, 1, 5 };
+
+	const std::vector< std::string > variants( names, names + 4 );
+	std::vector< bool > fallbacks( 4, false );
+	fallbacks[ 0 ] = true;
+
+	std::vector< Optimization::OptIterationRecord > records;
+	for ( std::size_t s = 0; s < 3; s++ )
+		for ( std::size_t e = 0; e < 3; e++ )
+		{
+			const Configuration config( "lm_solver", sizes[ s ], noises[ e ] );
+			std::vector< Trials > trials( 4 );
+			for ( std::size_t t = 0; t < settings.trials; t++ )
+			{
+				Random::seed( seed() + t );
+				const Scene2D3D scene( config.size, config.noise, false );
+				const Pose initial( Quaternion( Random::Vector< double, 3 >::Uniform( -1, 1 )(), 0.1 ) * scene.truth.rotation(),
+					scene.truth.translation() + Random::Vector< double, 3 >::Uniform( -0.1, 0.1 )() );
+
+				for ( std::size_t v = 0; v < 4; v++ )
+				{
+					// only the cholesky runs are recorded, a rank means it fell back to SVD
+					if ( fallbacks[ v ] )
+						Optimization::OptTelemetry::enable();
+					runTrial( trials[ v ], LmRefinement( scene, initial, solvers[ v ] ) );
+					if ( !fallbacks[ v ] )
+						continue;
+
+					Optimization::OptTelemetry::disable();
+					records.clear();
+					Optimization::OptTelemetry::drain( records );
+					for ( std::size_t r = 0; r < records.size(); r++ )
+						if ( records[ r ].rank >= 0 )
+						{
+							trials[ v ].fallbacks++;
+							break;
+						}
+				}
+			}
+			appendResults( config, variants, trials, fallbacks, results );
+		}
+}
+
+
+void compareInitializations( const ComparisonSettings& settings, const bool bPlanar, std::vector< ComparisonResult >& results )
+{
+	using namespace Algorithm::PoseEstimation2D3D;
+	static const char* names[] = { "planar_homography", "nonplanar_projection", "epnp", "p3p" };
+	static const InitializationMethod methods[] = { PLANAR_HOMOGRAPHY, NONPLANAR_PROJECTION, EPNP, P3P };
+	static const std::size_t sizes[] = { 6, 20, 100 };
+	static const double noises[] = { 0, 1, 3 };
+
+	std::vector< std::string > variants;
+	for ( std::size_t m = 0; m < 4; m++ )
+	{
+		variants.push_back( names[ m ] );
+		variants.push_back( std::string( names[ m ] ) + "+lm" );
+	}
+	const std::vector< bool > fallbacks( variants.size(), false );
+
+	for ( std::size_t s = 0; s < 3; s++ )
+		for ( std::size_t e = 0; e < 3; e++ )
+		{
+			const Configuration config( bPlanar ? "pose2d3d_init/planar" : "pose2d3d_init/nonplanar", sizes[ s ], noises[ e ] );
+			std::vector< Trials > trials( variants.size() );
+			for ( std::size_t t = 0; t < settings.trials; t++ )
+			{
+				Random::seed( seed() + t );
+				const Scene2D3D scene( config.size, config.noise, bPlanar );
+				for ( std::size_t v = 0; v < variants.size(); v++ )
+					runTrial( trials[ v ], PoseFromCorrespondences( scene, methods[ v / 2 ], v % 2 == 1 ) );
+			}
+			appendResults( config, variants, trials, fallbacks, results );
+		}
+}
+
+
+void compareAbsoluteOrientation( const ComparisonSettings& settings, std::vector< ComparisonResult >& results )
+{
+	static const std::size_t sizes[] = { 20, 200, 2000 };
+	static const double noises[] = { 0.001, 0.01 };
+	static const double outlierRatios[] = { 0, 0.2, 0.5 };
+
+	std::vector< std::string > variants;
+	variants.push_back( "closed_form" );
+	variants.push_back( "ransac" );
+	variants.push_back( "ransac_lo" );
+	variants.push_back( "ransac_sprt" );
+	const std::vector< bool > fallbacks( variants.size(), false );
+
+	for ( std::size_t s = 0; s < 3; s++ )
+		for ( std::size_t e = 0; e < 2; e++ )
+			for ( std::size_t o = 0; o < 3; o++ )
+			{
+				const Configuration config( "pose3d3d", sizes[ s ], noises[ e ], outlierRatios[ o ] );
+
+				// inlier are within 3 sigma of the noise. The outliers are drawn at random, so the
+				// iterations and the minimum number of inlier are planned for 10% more.
+				Optimization::RansacParameter< double > plain( 3 * std::sqrt( 3.0 ) * config.noise, 3, config.size,
+					config.outliers + 0.1 );
+				Optimization::RansacParameter< double > local( plain );
+				local.nLocalIterations = 5;
+				Optimization::RansacParameter< double > sprt( plain );
+				sprt.sprtDelta = 0.05;
+
+				std::vector< Trials > trials( variants.size() );
+				for ( std::size_t t = 0; t < settings.trials; t++ )
+				{
+					Random::seed( seed() + t );
+					const Scene3D3D scene( config.size, config.noise, config.outliers );
+					runTrial( trials[ 0 ], ClosedFormOrientation( scene ) );
+					runTrial( trials[ 1 ], RansacOrientation( scene, plain ) );
+					runTrial( trials[ 2 ], RansacOrientation( scene, local ) );
+					runTrial( trials[ 3 ], RansacOrientation( scene, sprt ) );
+				}
+				appendResults( config, variants, trials, fallbacks, results );
+			}
+}
+
+#endif // HAVE_LAPACK
+
+
+/// writes NaN, which json does not know, as null
+void writeJsonNumber( std::ostream& os, const double value )
+{
+	if ( value == value )
+		os << value;
+	else
+		os << "null";
+}
+
+} // anonymous namespace
+
+
+std::vector< ComparisonResult > runComparison( const ComparisonSettings& settings )
+{
+	std::vector< ComparisonResult > results;
+#ifdef HAVE_LAPACK
+	if ( selected( settings, "lm_solver" ) )
+		compareLmSolvers( settings, results );
+	if ( selected( settings, "pose2d3d_init/planar" ) )
+		compareInitializations( settings, true, results );
+	if ( selected( settings, "pose2d3d_init/nonplanar" ) )
+		compareInitializations( settings, false, results );
+	if ( selected( settings, "pose3d3d" ) )
+		compareAbsoluteOrientation( settings, results );
+#endif
+	return results;
+}
+
+
+void writeComparisonCsv( std::ostream& os, const std::vector< ComparisonResult >& results )
+{
+	os << "problem,variant,size,noise,outliers,trials,failures,median_us,median_error,p90_error,fallback_rate,pareto\n";
+	for ( std::vector< ComparisonResult >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		os << it->problem << ',' << it->variant << ',' << it->size << ',' << std::setprecision( 6 )
+			<< it->noise << ',' << it->outliers << ',' << it->trials << ',' << it->failures << ','
+			<< it->medianUs << ',' << it->medianError << ',' << it->p90Error << ',';
+		if ( it->fallbackRate >= 0 )
+			os << it->fallbackRate;
+		os << ',' << ( it->pareto ? 1 : 0 ) << '\n';
+	}
+}
+
+
+void writeComparisonJson( std::ostream& os, const std::vector< ComparisonResult >& results )
+{
+	os << "{\n  \"comparison\": [";
+	for ( std::vector< ComparisonResult >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		os << ( it == results.begin() ? "\n" : ",\n" ) << std::setprecision( 6 )
+			<< "    { \"problem\": \"" << it->problem << "\", \"variant\": \"" << it->variant
+			<< "\", \"size\": " << it->size << ", \"noise\": " << it->noise << ", \"outliers\": " << it->outliers
+			<< ", \"trials\": " << it->trials << ", \"failures\": " << it->failures << ", \"median_us\": ";
+		writeJsonNumber( os, it->medianUs );
+		os << ", \"median_error\": ";
+		writeJsonNumber( os, it->medianError );
+		os << ", \"p90_error\": ";
+		writeJsonNumber( os, it->p90Error );
+		if ( it->fallbackRate >= 0 )
+			os << ", \"fallback_rate\": " << it->fallbackRate;
+		os << ", \"pareto\": " << ( it->pareto ? "true" : "false" ) << " }";
+	}
+	os << "\n  ]\n}\n";
+}
+
+} } // namespace Ubitrack::Benchmark
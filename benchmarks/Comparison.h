@@ -0,0 +1,109 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Accuracy and runtime of alternative solvers and estimators
+ *
+ * The micro benchmarks time one configuration of an algorithm. The comparison instead runs all
+ * variants of an algorithm on the same synthetic problems, sweeping the problem size, the
+ * noise and the outlier ratio, and reports the median runtime and the error of the result
+ * for every variant:
+ * - \c lm_solver: pose refinement from 2D-3D correspondences by \c levenbergMarquardt with
+ *   \c lmUseCholesky, \c lmUseQR, \c lmUseSVD and \c lmUseCG. For Cholesky, the fraction of
+ *   runs that fell back to SVD is reported as well.
+ * - \c pose2d3d_init/planar and \c pose2d3d_init/nonplanar: \c computePose with each
+ *   initialization, with and without the refinement
+ * - \c pose3d3d: \c estimatePose6D_3D3D in closed form and with RANSAC, RANSAC with local
+ *   optimization and RANSAC with the sequential probability ratio test
+ *
+ * The error is the distance of the estimated translation to the ground truth, in units of the
+ * synthetic scene (about 1m). Variants that fail in more than half of the trials are never
+ * Pareto optimal. Of the others, a variant is Pareto optimal if no other variant of the same
+ * problem is both faster and more accurate.
+ */
+
+#ifndef __UBITRACK_BENCHMARK_COMPARISON_H_INCLUDED__
+#define __UBITRACK_BENCHMARK_COMPARISON_H_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+namespace Ubitrack { namespace Benchmark {
+
+/** settings of the comparison */
+struct ComparisonSettings
+{
+	ComparisonSettings()
+		: trials( 20 )
+	{}
+
+	/// number of random problems per configuration, all variants solve the same problems
+	std::size_t trials;
+
+	/// only problems whose name contains this string are compared
+	std::string filter;
+};
+
+/** result of one variant on one configuration of a problem */
+struct ComparisonResult
+{
+	std::string problem;
+	std::string variant;
+
+	/// number of points, noise (pixels for 2D, scene units for 3D) and fraction of outliers
+	std::size_t size;
+	double noise;
+	double outliers;
+
+	std::size_t trials;
+	/// trials that threw or returned an invalid result
+	std::size_t failures;
+
+	/// median runtime in microseconds
+	double medianUs;
+
+	/// median and 90th percentile of the error of the successful trials
+	double medianError;
+	double p90Error;
+
+	/// fraction of trials in which the Cholesky solver fell back to SVD, negative if not applicable
+	double fallbackRate;
+
+	/// no other variant of the same configuration is both faster and more accurate
+	bool pareto;
+};
+
+/** runs all variants of all problems matching the filter */
+std::vector< ComparisonResult > runComparison( const ComparisonSettings& settings );
+
+/** writes the results as comma separated values, one variant and configuration per line */
+void writeComparisonCsv( std::ostream& os, const std::vector< ComparisonResult >& results );
+
+/** writes the results as a json document */
+void writeComparisonJson( std::ostream& os, const std::vector< ComparisonResult >& results );
+
+} } // namespace Ubitrack::Benchmark
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Memory footprint of the measurement, math and error types, see Footprint.h
+ *
+ * The global \c operator \c new of the benchmark executable is replaced by one that adds the
+ * requested size to a counter while a footprint is measured. Outside of the measurement it
+ * only costs a relaxed atomic load, so the timings of the other benchmarks are not affected.
+ */
+
+#include "Footprint.h"
+#include "Benchmark.h"
+
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <ostream>
+#include <iomanip>
+
+#include <boost/atomic.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <utMath/Pose.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/ErrorPose.h>
+#include <utMeasurement/Measurement.h>
+#include <utMeasurement/InlineMeasurement.h>
+#include <utMeasurement/LocalMeasurement.h>
+#include <utUtil/MessageArchive.h>
+#include <utUtil/PortableBinaryArchive.h>
+#include <utSerialization/ROSBinarySerialization.h>
+#include <utSerialization/MsgpackSerializer.h>
+
+namespace {
+
+/// true while a footprint is measured
+boost::atomic< bool > g_counting( false );
+
+/// bytes requested from \c operator \c new while counting
+boost::atomic< std::size_t > g_heapBytes( 0 );
+
+} // anonymous namespace
+
+
+void* operator new( std::size_t n )
+{
+	if ( g_counting.load( boost::memory_order_relaxed ) )
+		g_heapBytes.fetch_add( n, boost::memory_order_relaxed );
+	void* p = std::malloc( n ? n : 1 );
+	if ( !p )
+		throw std::bad_alloc();
+	return p;
+}
+
+
+void operator delete( void* p ) throw()
+{
+	std::free( p );
+}
+
+
+namespace Ubitrack { namespace Benchmark {
+
+namespace {
+
+using namespace Ubitrack::Math;
+namespace Meas = Ubitrack::Measurement;
+namespace ROSBinary = Ubitrack::Serialization::ROSBinary;
+
+/// number of objects constructed to measure the heap per object
+const std::size_t g_nObjects = 1000;
+
+
+/// collects the results of the types and variants matching the filter
+struct Collector
+{
+	Collector( const std::string& f, std::vector< FootprintResult >& r )
+		: filter( f )
+		, results( r )
+	{}
+
+	bool selected( const std::string& category, const std::string& type ) const
+	{
+		return filter.empty() || category.find( filter ) != std::string::npos
+			|| type.find( filter ) != std::string::npos;
+	}
+
+	void add( const std::string& category, const std::string& type, const std::string& variant,
+		const std::size_t bytes, const double heapBytes )
+	{
+		FootprintResult r;
+		r.category = category;
+		r.type = type;
+		r.variant = variant;
+		r.bytes = bytes;
+		r.heapBytes = heapBytes;
+		results.push_back( r );
+	}
+
+	/**
+	 * adds \c sizeof( Object ) and the heap bytes of an object that \c make constructs
+	 * from \c prototype. Only the allocations of the new objects are counted, temporaries
+	 * that are freed again are avoided by constructing from the prototype.
+	 */
+	template< class Object, class Value, class Make >
+	void object( const std::string& category, const std::string& type, const std::string& variant,
+		const Value& prototype, const Make& make )
+	{
+		if ( !selected( category, type ) )
+			return;
+
+		std::vector< Object > objects;
+		objects.reserve( g_nObjects );
+		g_heapBytes = 0;
+		g_counting = true;
+		for ( std::size_t i = 0; i < g_nObjects; i++ )
+			make( objects, prototype );
+		g_counting = false;
+		add( category, type, variant, sizeof( Object ), double( g_heapBytes.load() ) / g_nObjects );
+	}
+
+	const std::string filter;
+	std::vector< FootprintResult >& results;
+};
+
+
+/// appends a copy of the prototype
+struct Copy
+{
+	template< class Object >
+	void operator()( std::vector< Object >& objects, const Object& prototype ) const
+	{ objects.push_back( prototype ); }
+};
+
+
+/// appends a new measurement of the prototype payload, copies of it share the payload
+struct MakeMeasurement
+{
+	template< class M >
+	void operator()( std::vector< M >& objects, const typename M::value_type& prototype ) const
+	{ objects.push_back( M( Meas::now(), prototype ) ); }
+};
+
+
+template< class M >
+void measurementVariants( Collector& collector, const std::string& type, const typename M::value_type& value )
+{
+	collector.object< Meas::Measurement< typename M::value_type > >( "measurement", type, "shared", value, MakeMeasurement() );
+	collector.object< Meas::LocalMeasurement< typename M::value_type > >( "measurement", type, "local", value, MakeMeasurement() );
+}
+
+
+void measurements( Collector& collector )
+{
+	const Pose pose( Quaternion(), Vector< double, 3 >( 1, 2, 3 ) );
+	const Vector< double, 3 > position( 1, 2, 3 );
+	const std::vector< Vector< double, 3 > > positions( 100, position );
+	const std::vector< Pose > poses( 100, pose );
+
+	measurementVariants< Meas::Pose >( collector, "pose", pose );
+	collector.object< Meas::InlinePose >( "measurement", "pose", "inline", pose, MakeMeasurement() );
+	measurementVariants< Meas::Position >( collector, "position", position );
+	collector.object< Meas::InlinePosition >( "measurement", "position", "inline", position, MakeMeasurement() );
+	measurementVariants< Meas::ErrorPose >( collector, "error_pose", ErrorPose() );
+	measurementVariants< Meas::PositionList >( collector, "position_list_100", positions );
+	measurementVariants< Meas::PoseList >( collector, "pose_list_100", poses );
+}
+
+
+void storage( Collector& collector )
+{
+	collector.object< Vector< double, 3 > >( "storage", "vector_3", "fixed", Vector< double, 3 >( 1, 2, 3 ), Copy() );
+	collector.object< Vector< double, 0 > >( "storage", "vector_3", "dynamic", Vector< double, 0 >( 3 ), Copy() );
+	collector.object< Vector< double, 0 > >( "storage", "vector_100", "dynamic", Vector< double, 0 >( 100 ), Copy() );
+	collector.object< Vector< float, 3 > >( "storage", "vector_3f", "fixed", Vector< float, 3 >( 1, 2, 3 ), Copy() );
+	collector.object< Matrix< double, 3, 3 > >( "storage", "matrix_3x3", "fixed", Matrix< double, 3, 3 >::identity(), Copy() );
+	collector.object< Matrix< double, 0, 0 > >( "storage", "matrix_3x3", "dynamic", Matrix< double, 0, 0 >( 3, 3 ), Copy() );
+	collector.object< Matrix< double, 6, 6 > >( "storage", "matrix_6x6", "fixed", Matrix< double, 6, 6 >::identity(), Copy() );
+	collector.object< Matrix< double, 0, 0 > >( "storage", "matrix_6x6", "dynamic", Matrix< double, 0, 0 >( 6, 6 ), Copy() );
+	collector.object< Matrix< double, 0, 0 > >( "storage", "matrix_20x20", "dynamic", Matrix< double, 0, 0 >( 20, 20 ), Copy() );
+}
+
+
+void errorPoses( Collector& collector )
+{
+	const ErrorPose full;
+	collector.object< ErrorPose >( "error_pose", "error_pose", "full", full, Copy() );
+	collector.object< PackedErrorPose< double > >( "error_pose", "error_pose", "packed_double", PackedErrorPose< double >( full ), Copy() );
+	collector.object< PackedErrorPose< float > >( "error_pose", "error_pose", "packed_float", PackedErrorPose< float >( full ), Copy() );
+}
+
+
+/// sizes of a value in the formats that serialize through boost::serialization
+template< class T >
+void boostFormats( Collector& collector, const std::string& type, const T& value )
+{
+	if ( !collector.selected( "serialized", type ) )
+		return;
+	{
+		std::ostringstream stream;
+		boost::archive::binary_oarchive archive( stream, boost::archive::no_header );
+		archive << value;
+		collector.add( "serialized", type, "boost_binary", stream.str().size(), -1 );
+	}
+	{
+		std::ostringstream stream;
+		boost::archive::text_oarchive archive( stream, boost::archive::no_header );
+		archive << value;
+		collector.add( "serialized", type, "boost_text", stream.str().size(), -1 );
+	}
+	{
+		std::ostringstream stream;
+		Ubitrack::Util::PortableBinaryOArchive archive( stream, false );
+		archive << value;
+		collector.add( "serialized", type, "portable_binary", stream.str().size(), -1 );
+	}
+	{
+		Ubitrack::Util::MessageOArchive archive;
+		archive << value;
+		collector.add( "serialized", type, "message_archive", archive.size(), -1 );
+	}
+#ifdef HAVE_MSGPACK
+	{
+		msgpack::sbuffer buffer;
+		msgpack::pack( buffer, value );
+		collector.add( "serialized", type, "msgpack", buffer.size(), -1 );
+	}
+#endif
+}
+
+
+/// size of a value in the ROS binary format of the measurement logs
+template< class T >
+void rosBinary( Collector& collector, const std::string& type, const T& value )
+{
+	if ( !collector.selected( "serialized", type ) )
+		return;
+	ROSBinary::LStream length;
+	length.next( value );
+	collector.add( "serialized", type, "ros_binary", length.getLength(), -1 );
+}
+
+
+void serialized( Collector& collector )
+{
+	const Pose pose( Quaternion(), Vector< double, 3 >( 1, 2, 3 ) );
+	const ErrorPose errorPose;
+	const PackedErrorPose< double > packedDouble( errorPose );
+	const PackedErrorPose< float > packedFloat( errorPose );
+	const std::vector< Vector< double, 3 > > positions( 100, Vector< double, 3 >( 1, 2, 3 ) );
+
+	boostFormats( collector, "pose", pose );
+	rosBinary( collector, "pose", pose );
+	boostFormats( collector, "error_pose", errorPose );
+	boostFormats( collector, "packed_error_pose_double", packedDouble );
+	rosBinary( collector, "packed_error_pose_double", packedDouble );
+	boostFormats( collector, "packed_error_pose_float", packedFloat );
+	rosBinary( collector, "packed_error_pose_float", packedFloat );
+	boostFormats( collector, "position_list_100", positions );
+	rosBinary( collector, "position_list_100", positions );
+}
+
+} // anonymous namespace
+
+
+std::vector< FootprintResult > runFootprint( const std::string& filter )
+{
+	std::vector< FootprintResult > results;
+	Collector collector( filter, results );
+	measurements( collector );
+	storage( collector );
+	errorPoses( collector );
+	serialized( collector );
+	return results;
+}
+
+
+void writeFootprintCsv( std::ostream& os, const std::vector< FootprintResult >& results )
+{
+	os << "category,type,variant,bytes,heap_bytes\n";
+	for ( std::vector< FootprintResult >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		os << it->category << ',' << it->type << ',' << it->variant << ',' << it->bytes << ',';
+		if ( it->heapBytes >= 0 )
+			os << std::setprecision( 6 ) << it->heapBytes;
+		os << '\n';
+	}
+}
+
+
+void writeFootprintJson( std::ostream& os, const std::vector< FootprintResult >& results )
+{
+	os << "{\n  \"footprint\": [";
+	for ( std::vector< FootprintResult >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		os << ( it == results.begin() ? "\n" : ",\n" ) << "    { \"category\": \"" << it->category
+			<< "\", \"type\": \"" << it->type << "\", \"variant\": \"" << it->variant << "\", \"bytes\": " << it->bytes;
+		if ( it->heapBytes >= 0 )
+			os << ", \"heap_bytes\": " << std::setprecision( 6 ) << it->heapBytes;
+		os << " }";
+	}
+	os << "\n  ]\n}\n";
+}
+
+} } // namespace Ubitrack::Benchmark
@@ -0,0 +1,84 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Memory footprint of the measurement, math and error types
+ *
+ * Reports the size of an object and the heap bytes it keeps allocated, per object, for
+ * capacity planning of queues, buffers and recordings:
+ * - \c measurement: \c Measurement, \c InlineMeasurement and \c LocalMeasurement of single
+ *   values and of lists of 100 positions. The heap of the shared variants includes the
+ *   payload and the reference count, copies of a measurement share both.
+ * - \c storage: fixed size \c Math::Vector and \c Math::Matrix against the dynamic ones, which
+ *   keep up to 32 (vectors) or 256 (matrices) elements inline and the larger ones on the heap
+ * - \c error_pose: \c ErrorPose with the full 6x6 covariance against \c PackedErrorPose,
+ *   which stores the 21 elements of the upper triangle in double or float
+ * - \c serialized: the size of the payload written by each serialization format, without the
+ *   headers of the archives and the framing of the logs. ROS binary only supports the packed
+ *   error types, msgpack is only reported if the library was built with it.
+ *
+ * The heap is measured by counting the bytes passed to the global \c operator \c new while
+ * 1000 objects are constructed from a prototype, see Footprint.cpp.
+ */
+
+#ifndef __UBITRACK_BENCHMARK_FOOTPRINT_H_INCLUDED__
+#define __UBITRACK_BENCHMARK_FOOTPRINT_H_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+namespace Ubitrack { namespace Benchmark {
+
+/** footprint of one type in one variant */
+struct FootprintResult
+{
+	/// \c measurement, \c storage, \c error_pose or \c serialized
+	std::string category;
+
+	/// the payload, e.g. \c pose or \c position_list_100
+	std::string type;
+
+	/// the measurement class, the storage, the covariance layout or the serialization format
+	std::string variant;
+
+	/// \c sizeof of the object, or the serialized size in the category \c serialized
+	std::size_t bytes;
+
+	/// heap bytes kept per object, negative in the category \c serialized
+	double heapBytes;
+};
+
+/** measures the footprints of all types whose category or type contains the filter */
+std::vector< FootprintResult > runFootprint( const std::string& filter );
+
+/** writes the results as comma separated values, one type and variant per line */
+void writeFootprintCsv( std::ostream& os, const std::vector< FootprintResult >& results );
+
+/** writes the results as a json document */
+void writeFootprintJson( std::ostream& os, const std::vector< FootprintResult >& results );
+
+} } // namespace Ubitrack::Benchmark
+
+#endif
@@ -0,0 +1,1224 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Micro benchmarks of the basic math types and the generic estimators
+ */
+
+#include "Benchmark.h"
+
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+
+#include <utMath/Blas1.h>
+#include <utMath/Blas2.h>
+#include <utMath/Blas3.h>
+#include <utMath/Pose.h>
+#include <utMath/PoseOperations.h>
+#include <utMath/PoseListOperations.h>
+#include <utMath/ErrorPose.h>
+#include <utMath/FixedDecomposition.h>
+#include <utMath/ProductChain.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utMath/Stochastic/k_means.h>
+#include <utMath/Stochastic/KMeansClustering.h>
+#include <utMath/Stochastic/expectation_maximization.h>
+#include <utMath/Stochastic/GaussianMixtureEM.h>
+#include <utMath/Stochastic/BackwardPropagation.h>
+#include <utMath/Stochastic/MahalanobisDistance.h>
+#include <utMath/Stochastic/Correlation.h>
+#include <utMath/Stochastic/CrossCorrelation.h>
+#include <utMath/Stochastic/Kalman.h>
+#include <utMath/Optimization/Function/LinearFunction.h>
+
+#ifdef HAVE_LAPACK
+#include <utMath/Optimization/LevenbergMarquardt.h>
+#include <utMath/Optimization/SparseLevenbergMarquardt.h>
+#include <boost/numeric/bindings/lapack/syev.hpp>
+#include <boost/numeric/bindings/lapack/gesvd.hpp>
+#endif
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+namespace {
+
+/// number of inputs the micro benchmarks cycle through, small enough to stay in the cache
+static const std::size_t nData = 1024;
+
+template< typename T, std::size_t N >
+void randomVectors( std::vector< Vector< T, N > >& v, const std::size_t n )
+{
+	typename Random::Vector< T, N >::Uniform randVector( -10, 10 );
+	v.clear();
+	std::generate_n( std::back_inserter( v ), n, randVector );
+}
+
+template< typename T, std::size_t N >
+struct InnerProduct
+{
+	std::vector< Vector< T, N > > a, b;
+
+	InnerProduct()
+	{
+		Random::seed( Benchmark::seed() );
+		randomVectors( a, nData );
+		randomVectors( b, nData );
+	}
+
+	void operator()( const std::size_t n )
+	{
+		T sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			sum += inner_product( a[ i % nData ], b[ i % nData ] );
+		Benchmark::consume( sum );
+	}
+};
+
+typedef InnerProduct< double, 3 > InnerProduct3d;
+typedef InnerProduct< float, 3 > InnerProduct3f;
+UBITRACK_BENCHMARK( "math/blas1/inner_product/3d", InnerProduct3d );
+UBITRACK_BENCHMARK( "math/blas1/inner_product/3f", InnerProduct3f );
+
+
+template< typename T, std::size_t N >
+struct Norm2
+{
+	std::vector< Vector< T, N > > a;
+
+	Norm2()
+	{
+		Random::seed( Benchmark::seed() );
+		randomVectors( a, nData );
+	}
+
+	void operator()( const std::size_t n )
+	{
+		T sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			sum += norm_2( a[ i % nData ] );
+		Benchmark::consume( sum );
+	}
+};
+
+typedef Norm2< double, 3 > Norm2_3d;
+UBITRACK_BENCHMARK( "math/blas1/norm_2/3d", Norm2_3d );
+
+
+/// matrix-vector product (blas level 2)
+template< typename T, std::size_t N >
+struct MatrixVectorProduct
+{
+	std::vector< Matrix< T, N, N > > m;
+	std::vector< Vector< T, N > > v;
+
+	MatrixVectorProduct()
+	{
+		Random::seed( Benchmark::seed() );
+		randomVectors( v, nData );
+		for ( std::size_t i = 0; i < nData; i++ )
+		{
+			Matrix< T, N, N > mat;
+			for ( std::size_t r = 0; r < N; r++ )
+				for ( std::size_t c = 0; c < N; c++ )
+					mat( r, c ) = Random::distribute_uniform< T >( -1, 1 );
+			m.push_back( mat );
+		}
+	}
+
+	void operator()( const std::size_t n )
+	{
+		Vector< T, N > result;
+		T sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			product( m[ i % nData ], v[ i % nData ], result );
+			sum += result( 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+
+typedef MatrixVectorProduct< double, 3 > MatrixVectorProduct3d;
+typedef MatrixVectorProduct< double, 4 > MatrixVectorProduct4d;
+UBITRACK_BENCHMARK( "math/blas2/product/3x3d", MatrixVectorProduct3d );
+UBITRACK_BENCHMARK( "math/blas2/product/4x4d", MatrixVectorProduct4d );
+
+
+/// matrix-matrix product (blas level 3)
+template< typename T, std::size_t N >
+struct MatrixMatrixProduct
+{
+	std::vector< Matrix< T, N, N > > m;
+
+	MatrixMatrixProduct()
+	{
+		Random::seed( Benchmark::seed() );
+		for ( std::size_t i = 0; i < nData; i++ )
+		{
+			Matrix< T, N, N > mat;
+			for ( std::size_t r = 0; r < N; r++ )
+				for ( std::size_t c = 0; c < N; c++ )
+					mat( r, c ) = Random::distribute_uniform< T >( -1, 1 );
+			m.push_back( mat );
+		}
+	}
+
+	void operator()( const std::size_t n )
+	{
+		Matrix< T, N, N > result;
+		T sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			product( m[ i % nData ], m[ ( i + 1 ) % nData ], result );
+			sum += result( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+
+typedef MatrixMatrixProduct< double, 3 > MatrixMatrixProduct3d;
+typedef MatrixMatrixProduct< double, 4 > MatrixMatrixProduct4d;
+UBITRACK_BENCHMARK( "math/blas3/product/3x3d", MatrixMatrixProduct3d );
+UBITRACK_BENCHMARK( "math/blas3/product/4x4d", MatrixMatrixProduct4d );
+
+
+/// projection of points through a chain K * [R|t] * offset
+struct ProjectionChain
+{
+	Matrix< double, 3, 3 > K;
+	Matrix< double, 3, 4 > Rt;
+	Matrix< double, 4, 4 > offset;
+	std::vector< Vector< double, 4 > > points;
+
+	ProjectionChain()
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Quaternion< double >::Uniform randQuat;
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		K = Matrix< double, 3, 3 >::identity();
+		K( 0, 0 ) = K( 1, 1 ) = 500; K( 0, 2 ) = 320; K( 1, 2 ) = 240;
+		Rt = Matrix< double, 3, 4 >( randQuat(), randVector() );
+		offset = Matrix< double, 4, 4 >( randQuat(), randVector() );
+		for ( std::size_t i = 0; i < nData; i++ )
+		{
+			const Vector< double, 3 > p( randVector() );
+			points.push_back( Vector< double, 4 >( p( 0 ), p( 1 ), p( 2 ), 1 ) );
+		}
+	}
+};
+
+struct ProjectionChainUblas
+	: public ProjectionChain
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Matrix< double, 3, 4 > KRt( boost::numeric::ublas::prod( K, Rt ) );
+			const Matrix< double, 3, 4 > P( boost::numeric::ublas::prod( KRt, offset ) );
+			const Vector< double, 3 > x( boost::numeric::ublas::prod( P, points[ i % nData ] ) );
+			sum += x( 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/product_chain/project_point_ublas", ProjectionChainUblas );
+
+struct ProjectionChainFused
+	: public ProjectionChain
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		Vector< double, 3 > x;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			productChainInto( K, Rt, offset, points[ i % nData ], x );
+			sum += x( 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/product_chain/project_point", ProjectionChainFused );
+
+
+/// data shared by the quaternion and pose benchmarks
+struct RandomPoses
+{
+	std::vector< Quaternion > q;
+	std::vector< Vector< double, 3 > > t;
+	std::vector< Pose > p;
+
+	RandomPoses()
+	{
+		Random::seed( Benchmark::seed() );
+		Random::Quaternion< double >::Uniform randQuat;
+		for ( std::size_t i = 0; i < nData; i++ )
+			q.push_back( randQuat() );
+		randomVectors( t, nData );
+		for ( std::size_t i = 0; i < nData; i++ )
+			p.push_back( Pose( q[ i ], t[ i ] ) );
+	}
+};
+
+struct QuaternionProduct
+	: public RandomPoses
+{
+	void operator()( const std::size_t n )
+	{
+		Quaternion r;
+		for ( std::size_t i = 0; i < n; i++ )
+			r = q[ i % nData ] * q[ ( i + 1 ) % nData ];
+		Benchmark::consume( r.w() );
+	}
+};
+UBITRACK_BENCHMARK( "math/quaternion/product", QuaternionProduct );
+
+struct QuaternionRotateVector
+	: public RandomPoses
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			sum += ( q[ i % nData ] * t[ i % nData ] )( 0 );
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/quaternion/rotate_vector", QuaternionRotateVector );
+
+struct PoseProduct
+	: public RandomPoses
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			sum += ( p[ i % nData ] * p[ ( i + 1 ) % nData ] ).translation()( 0 );
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/pose/product", PoseProduct );
+
+struct PoseTransformPoint
+	: public RandomPoses
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			sum += ( p[ i % nData ] * t[ ( i + 1 ) % nData ] )( 0 );
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/pose/transform_point", PoseTransformPoint );
+
+struct PoseTransformPoints
+	: public RandomPoses
+{
+	std::vector< Vector< double, 3 > > out;
+
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			transformPoints( p[ i % nData ], t, out );
+			sum += out[ i % nData ]( 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/pose/transform_points/1024", PoseTransformPoints );
+
+struct PoseListMultiply
+	: public RandomPoses
+{
+	std::vector< Pose > out;
+
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			multiplyPoseList( p[ i % nData ], p, out );
+			sum += out[ i % nData ].translation()( 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/pose/multiply_pose_list/1024", PoseListMultiply );
+
+/// interpolates each rotation with its successor
+struct QuaternionListSlerp
+	: public RandomPoses
+{
+	std::vector< Quaternion > next;
+	std::vector< Quaternion > out;
+
+	QuaternionListSlerp()
+		: next( q.begin() + 1, q.end() )
+	{
+		next.push_back( q.front() );
+	}
+};
+
+struct QuaternionSlerpLoop
+	: public QuaternionListSlerp
+{
+	void operator()( const std::size_t n )
+	{
+		out.resize( nData );
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			for ( std::size_t j = 0; j < nData; j++ )
+				out[ j ] = slerp( q[ j ], next[ j ], 0.3 );
+			sum += out[ i % nData ].w();
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/quaternion/slerp_loop/1024", QuaternionSlerpLoop );
+
+template< RotationInterpolation mode >
+struct QuaternionSlerpList
+	: public QuaternionListSlerp
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			interpolateQuaternionList( q, next, 0.3, out, ListExecutor(), mode );
+			sum += out[ i % nData ].w();
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/quaternion/slerp_list/1024", QuaternionSlerpList< slerpInterpolation > );
+UBITRACK_BENCHMARK( "math/quaternion/fast_slerp_list/1024", QuaternionSlerpList< fastInterpolation > );
+
+/// rotation vectors of the random rotations
+struct RandomRotationVectors
+	: public RandomPoses
+{
+	std::vector< Vector< double, 3 > > r;
+	std::vector< Quaternion > out;
+
+	RandomRotationVectors()
+	{
+		quaternionLogarithms( q, r );
+		out.resize( nData );
+	}
+};
+
+struct QuaternionExpLoop
+	: public RandomRotationVectors
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			for ( std::size_t j = 0; j < nData; j++ )
+				out[ j ] = Quaternion::fromLogarithm( r[ j ] );
+			sum += out[ i % nData ].w();
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/quaternion/exp_loop/1024", QuaternionExpLoop );
+
+struct QuaternionExpList
+	: public RandomRotationVectors
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			quaternionsFromLogarithms( r, out );
+			sum += out[ i % nData ].w();
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/quaternion/exp_list/1024", QuaternionExpList );
+
+/// rotation matrices of the random poses
+struct RandomRotationMatrices
+	: public RandomPoses
+{
+	std::vector< Matrix< double, 3, 3 > > m;
+
+	RandomRotationMatrices()
+	{
+		for ( std::size_t i = 0; i < nData; i++ )
+			m.push_back( Matrix< double, 3, 3 >( q[ i ] ) );
+	}
+};
+
+struct QuaternionsToMatrices
+	: public RandomRotationMatrices
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			quaternionsToMatrices( q, m );
+			sum += m[ i % nData ]( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/rotation/quaternions_to_matrices/1024", QuaternionsToMatrices );
+
+struct QuaternionsToMatricesSingle
+	: public RandomRotationMatrices
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			for ( std::size_t j = 0; j < nData; j++ )
+				q[ j ].toMatrix( m[ j ] );
+			sum += m[ i % nData ]( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/rotation/quaternions_to_matrices/1024_single", QuaternionsToMatricesSingle );
+
+struct MatricesToQuaternions
+	: public RandomRotationMatrices
+{
+	std::vector< Quaternion > out;
+
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			matricesToQuaternions( m, out );
+			sum += out[ i % nData ].w();
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/rotation/matrices_to_quaternions/1024", MatricesToQuaternions );
+
+struct MatricesToQuaternionsSingle
+	: public RandomRotationMatrices
+{
+	std::vector< Quaternion > out;
+
+	MatricesToQuaternionsSingle()
+		: out( nData )
+	{}
+
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			for ( std::size_t j = 0; j < nData; j++ )
+				out[ j ] = Quaternion( m[ j ] );
+			sum += out[ i % nData ].w();
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/rotation/matrices_to_quaternions/1024_single", MatricesToQuaternionsSingle );
+
+
+/// random symmetric positive definite and general square matrices
+template< std::size_t N >
+struct Decomposition
+{
+	std::vector< Matrix< double, N, N > > symmetric, general;
+
+	Decomposition()
+	{
+		Random::seed( Benchmark::seed() );
+		std::vector< Vector< double, N > > v;
+		randomVectors( v, N * nData );
+		for ( std::size_t i = 0; i < nData; i++ )
+		{
+			Matrix< double, N, N > m;
+			for ( std::size_t j = 0; j < N; j++ )
+				boost::numeric::ublas::column( m, j ) = v[ i * N + j ];
+			general.push_back( m );
+			symmetric.push_back( Matrix< double, N, N >( boost::numeric::ublas::prod( boost::numeric::ublas::trans( m ), m ) ) );
+		}
+	}
+};
+
+struct SymmetricEigen4x4
+	: public Decomposition< 4 >
+{
+	void operator()( const std::size_t n )
+	{
+		Vector< double, 4 > w;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Matrix< double, 4, 4 > a( symmetric[ i % nData ] );
+			symmetricEigen( a, w );
+			Benchmark::consume( w( 3 ) );
+		}
+	}
+};
+UBITRACK_BENCHMARK( "math/decomposition/symmetric_eigen/4x4", SymmetricEigen4x4 );
+
+struct Svd3x3
+	: public Decomposition< 3 >
+{
+	void operator()( const std::size_t n )
+	{
+		Vector< double, 3 > s;
+		Matrix< double, 3, 3 > u, vt;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			svd( general[ i % nData ], s, u, vt );
+			Benchmark::consume( s( 0 ) );
+		}
+	}
+};
+UBITRACK_BENCHMARK( "math/decomposition/svd/3x3", Svd3x3 );
+
+
+#ifdef HAVE_LAPACK
+
+/// the same decompositions through the LAPACK bindings, for comparison
+struct SymmetricEigen4x4Lapack
+	: public Decomposition< 4 >
+{
+	void operator()( const std::size_t n )
+	{
+		Vector< double, 4 > w;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Matrix< double, 4, 4 > a( symmetric[ i % nData ] );
+			boost::numeric::bindings::lapack::syev( 'V', 'U', a, w, boost::numeric::bindings::lapack::minimal_workspace() );
+			Benchmark::consume( w( 3 ) );
+		}
+	}
+};
+UBITRACK_BENCHMARK( "math/decomposition/symmetric_eigen/4x4_lapack", SymmetricEigen4x4Lapack );
+
+struct Svd3x3Lapack
+	: public Decomposition< 3 >
+{
+	void operator()( const std::size_t n )
+	{
+		Vector< double, 3 > s;
+		Matrix< double, 3, 3 > u, vt;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Matrix< double, 3, 3 > a( general[ i % nData ] );
+			boost::numeric::bindings::lapack::gesvd( 'A', 'A', a, s, u, vt );
+			Benchmark::consume( s( 0 ) );
+		}
+	}
+};
+UBITRACK_BENCHMARK( "math/decomposition/svd/3x3_lapack", Svd3x3Lapack );
+
+
+/** fits the curve y = a * exp( b * x ) + c, a typical small least-squares problem */
+struct ExponentialCurve
+{
+	std::vector< double > x;
+
+	std::size_t size() const
+	{ return x.size(); }
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		for ( std::size_t i = 0; i < x.size(); i++ )
+		{
+			const double e = std::exp( input( 1 ) * x[ i ] );
+			result( i ) = input( 0 ) * e + input( 2 );
+			J( i, 0 ) = e;
+			J( i, 1 ) = input( 0 ) * x[ i ] * e;
+			J( i, 2 ) = 1;
+		}
+	}
+};
+
+struct LevenbergMarquardt
+{
+	ExponentialCurve curve;
+	Vector< double > y;
+
+	LevenbergMarquardt()
+	{
+		Random::seed( Benchmark::seed() );
+		const std::size_t n = 100;
+		y.resize( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			curve.x.push_back( 2.0 * i / n );
+			y( i ) = 1.5 * std::exp( 0.8 * curve.x[ i ] ) - 0.3 + Random::distribute_normal< double >( 0, 1e-3 );
+		}
+	}
+
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Vector< double > params( 3 );
+			params( 0 ) = 1; params( 1 ) = 0; params( 2 ) = 0;
+			sum += Optimization::weightedLevenbergMarquardt( curve, params, y, Optimization::OptTerminate( 20, 1e-10 )
+				, Optimization::OptNoNormalize(), Optimization::OptNoWeightFunction() );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/optimization/levenberg_marquardt/100x3", LevenbergMarquardt );
+
+/// same problem, using the overload for a fixed number of parameters
+struct LevenbergMarquardtFixed
+	: public LevenbergMarquardt
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Vector< double, 3 > params( 1, 0, 0 );
+			sum += Optimization::weightedLevenbergMarquardt( curve, params, y, Optimization::OptTerminate( 20, 1e-10 )
+				, Optimization::OptNoNormalize(), Optimization::OptNoWeightFunction() );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/optimization/levenberg_marquardt/100x3_fixed", LevenbergMarquardtFixed );
+
+
+/** independent curves y = a_g * exp( b_g * x ) + c with a shared offset c, the jacobian is arrow-shaped */
+struct GroupedCurves
+{
+	std::vector< double > x;
+	std::size_t nGroups;
+
+	std::size_t size() const
+	{ return x.size() * nGroups; }
+
+	template< class VT >
+	double sample( const VT& input, const std::size_t g, const std::size_t i, double* d ) const
+	{
+		const double e = std::exp( input( 2 * g + 1 ) * x[ i ] );
+		d[ 0 ] = e;
+		d[ 1 ] = input( 2 * g ) * x[ i ] * e;
+		return input( 2 * g ) * e + input( 2 * nGroups );
+	}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		J.clear();
+		double d[ 2 ];
+		for ( std::size_t g = 0; g < nGroups; g++ )
+			for ( std::size_t i = 0; i < x.size(); i++ )
+			{
+				const std::size_t r = g * x.size() + i;
+				result( r ) = sample( input, g, i, d );
+				J( r, 2 * g ) = d[ 0 ];
+				J( r, 2 * g + 1 ) = d[ 1 ];
+				J( r, 2 * nGroups ) = 1;
+			}
+	}
+
+	template< class VT1, class VT2 >
+	void evaluateWithJacobian( VT1& result, const VT2& input, Optimization::SparseJacobian< double >& J ) const
+	{
+		J.clear( input.size() );
+		double d[ 2 ];
+		for ( std::size_t g = 0; g < nGroups; g++ )
+			for ( std::size_t i = 0; i < x.size(); i++ )
+			{
+				result( g * x.size() + i ) = sample( input, g, i, d );
+				J.push_back( 2 * g, d[ 0 ] );
+				J.push_back( 2 * g + 1, d[ 1 ] );
+				J.push_back( 2 * nGroups, 1 );
+				J.finishRow();
+			}
+	}
+};
+
+template< bool SPARSE >
+struct GroupedLevenbergMarquardt
+{
+	GroupedCurves curves;
+	Vector< double > y;
+
+	GroupedLevenbergMarquardt()
+	{
+		Random::seed( Benchmark::seed() );
+		curves.nGroups = 200;
+		for ( std::size_t i = 0; i < 10; i++ )
+			curves.x.push_back( 0.2 * i );
+		y.resize( curves.size() );
+		for ( std::size_t g = 0; g < curves.nGroups; g++ )
+		{
+			const double a = Random::distribute_uniform< double >( 1, 2 );
+			const double b = Random::distribute_uniform< double >( 0.5, 1.5 );
+			for ( std::size_t i = 0; i < curves.x.size(); i++ )
+				y( g * curves.x.size() + i ) = a * std::exp( b * curves.x[ i ] ) - 0.3 + Random::distribute_normal< double >( 0, 1e-3 );
+		}
+	}
+
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Vector< double > params( boost::numeric::ublas::scalar_vector< double >( 2 * curves.nGroups + 1, 0 ) );
+			for ( std::size_t g = 0; g < curves.nGroups; g++ )
+				params( 2 * g ) = 1;
+			if ( SPARSE )
+				sum += Optimization::sparseLevenbergMarquardt( curves, params, y, Optimization::OptTerminate( 10, 1e-10 ), Optimization::OptNoNormalize() );
+			else
+				sum += Optimization::levenbergMarquardt( curves, params, y, Optimization::OptTerminate( 10, 1e-10 ), Optimization::OptNoNormalize() );
+		}
+		Benchmark::consume( sum );
+	}
+};
+typedef GroupedLevenbergMarquardt< false > DenseLevenbergMarquardt2000x401;
+typedef GroupedLevenbergMarquardt< true > SparseLevenbergMarquardt2000x401;
+UBITRACK_BENCHMARK( "math/optimization/levenberg_marquardt/2000x401", DenseLevenbergMarquardt2000x401 );
+UBITRACK_BENCHMARK( "math/optimization/levenberg_marquardt/2000x401_sparse", SparseLevenbergMarquardt2000x401 );
+
+#endif // HAVE_LAPACK
+
+
+template< std::size_t N_POINTS, std::size_t N_CLUSTER >
+struct KMeans
+{
+	std::vector< Vector< double, 2 > > points;
+
+	KMeans()
+	{
+		Random::seed( Benchmark::seed() );
+		randomVectors( points, N_POINTS );
+	}
+
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			std::vector< std::size_t > indices;
+			std::vector< Vector< double, 2 > > centroids;
+			// k_means uses the global generator for its seeding, keep the runs identical
+			Random::seed( Benchmark::seed() );
+			Stochastic::k_means( points.begin(), points.end(), N_CLUSTER, std::back_inserter( centroids ), std::back_inserter( indices ) );
+			Benchmark::consume( centroids[ 0 ]( 0 ) );
+		}
+	}
+};
+
+typedef KMeans< 2000, 8 > KMeans2000x8;
+UBITRACK_BENCHMARK( "math/stochastic/k_means/2000x8", KMeans2000x8 );
+
+
+template< std::size_t N_POINTS, std::size_t N_CLUSTER, unsigned N_THREADS >
+struct KMeansClustering
+{
+	std::vector< Vector< double, 2 > > points;
+	ListExecutor executor;
+
+	KMeansClustering()
+	{
+		Random::seed( Benchmark::seed() );
+		randomVectors( points, N_POINTS );
+		if ( N_THREADS )
+			executor = threadExecutor( N_THREADS, 1 );
+	}
+
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Stochastic::KMeansClustering< double, 2 > kmeans( N_CLUSTER );
+			Random::seed( Benchmark::seed() );
+			kmeans.seed( points, executor );
+			Benchmark::consume( kmeans.cluster( points, executor ) );
+		}
+	}
+};
+
+typedef KMeansClustering< 2000, 8, 0 > KMeansClustering2000x8;
+typedef KMeansClustering< 100000, 16, 0 > KMeansClustering100000x16;
+typedef KMeansClustering< 100000, 16, 4 > KMeansClustering100000x16Threads4;
+UBITRACK_BENCHMARK( "math/stochastic/kmeans_clustering/2000x8", KMeansClustering2000x8 );
+UBITRACK_BENCHMARK( "math/stochastic/kmeans_clustering/100000x16", KMeansClustering100000x16 );
+UBITRACK_BENCHMARK( "math/stochastic/kmeans_clustering/100000x16_threads4", KMeansClustering100000x16Threads4 );
+
+
+/** EM of a mixture with N_COMPONENTS components on points around as many centers, run until convergence */
+template< std::size_t N_POINTS, std::size_t N_COMPONENTS, int MODE >
+struct ExpectationMaximization
+{
+	typedef Stochastic::Weighted< Stochastic::Gaussian< double, 2 >, double > Component;
+	std::vector< Vector< double, 2 > > points;
+	std::vector< Component > initial;
+	ListExecutor executor;
+
+	ExpectationMaximization()
+	{
+		Random::seed( Benchmark::seed() );
+		randomVectors( points, N_POINTS );
+		initial.resize( N_COMPONENTS );
+		for ( std::size_t k = 0; k < N_COMPONENTS; k++ )
+		{
+			for ( std::size_t i = k; i < N_POINTS; i += N_COMPONENTS )
+				points[ i ]( 0 ) += 4.0 * k;
+			initial[ k ].weight = 1.0 / N_COMPONENTS;
+			initial[ k ].mean[ 0 ] = 4.0 * k + 0.5;
+			initial[ k ].mean[ 1 ] = 0.5;
+			initial[ k ].covariance[ 0 ] = initial[ k ].covariance[ 3 ] = 1;
+			initial[ k ].covariance[ 1 ] = initial[ k ].covariance[ 2 ] = 0;
+		}
+		if ( MODE == 2 )
+			executor = threadExecutor( 4, 1 );
+	}
+
+	void operator()( const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			std::vector< Component > mixture( initial );
+			if ( MODE == 0 )
+				Benchmark::consume( Stochastic::expectation_maximization( points.begin(), points.end(), mixture.begin(), mixture.end() ) );
+			else
+			{
+				Stochastic::GaussianMixtureEM< double, 2 > em;
+				Benchmark::consume( em.estimate( points, mixture, executor ) );
+			}
+		}
+	}
+};
+
+typedef ExpectationMaximization< 20000, 4, 0 > ExpectationMaximization20000x4;
+typedef ExpectationMaximization< 20000, 4, 1 > GaussianMixtureEM20000x4;
+typedef ExpectationMaximization< 20000, 4, 2 > GaussianMixtureEM20000x4Threads4;
+UBITRACK_BENCHMARK( "math/stochastic/expectation_maximization/20000x4", ExpectationMaximization20000x4 );
+UBITRACK_BENCHMARK( "math/stochastic/gaussian_mixture_em/20000x4", GaussianMixtureEM20000x4 );
+UBITRACK_BENCHMARK( "math/stochastic/gaussian_mixture_em/20000x4_threads4", GaussianMixtureEM20000x4Threads4 );
+
+struct ErrorPositions
+	: public RandomPoses
+{
+	std::vector< ErrorVector< double, 3 > > points;
+	std::vector< ErrorVector< double, 3 > > out;
+	ErrorPose pose;
+
+	ErrorPositions()
+		: pose( p[ 0 ], Matrix< double, 6, 6 >::identity() * 1e-4 )
+	{
+		for ( std::size_t i = 0; i < nData; i++ )
+			points.push_back( ErrorVector< double, 3 >( t[ i ], Matrix< double, 3, 3 >::identity() * 1e-2 ) );
+		out.resize( nData );
+	}
+};
+
+struct ErrorPoseTransformSingle
+	: public ErrorPositions
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			for ( std::size_t j = 0; j < nData; j++ )
+				out[ j ] = pose * points[ j ];
+			sum += out[ i % nData ].covariance( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+
+struct ErrorPoseTransformList
+	: public ErrorPositions
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			transformErrorPositionList( pose, points, out );
+			sum += out[ i % nData ].covariance( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/stochastic/error_pose_transform/1024_single", ErrorPoseTransformSingle );
+UBITRACK_BENCHMARK( "math/stochastic/error_pose_transform/1024", ErrorPoseTransformList );
+
+#ifdef HAVE_LAPACK
+
+/** linear function with a 200x6 jacobian, like the projections of 100 points */
+struct BackwardPropagation200x6
+{
+	Matrix< double, 0, 0 > J;
+	Matrix< double, 0, 0 > work;
+	Vector< double, 6 > params;
+
+	BackwardPropagation200x6()
+		: J( 200, 6 )
+		, work( 200, 6 )
+		, params( Vector< double, 6 >::zeros() )
+	{
+		Random::seed( Benchmark::seed() );
+		for ( std::size_t r = 0; r < J.size1(); r++ )
+			for ( std::size_t c = 0; c < J.size2(); c++ )
+				J( r, c ) = Random::distribute_uniform< double >( -1, 1 ) * ( c < 3 ? 1 : 500 );
+	}
+
+	std::size_t size() const
+	{ return J.size1(); }
+
+	template< class VT, class MT >
+	void jacobian( const VT&, MT& j ) const
+	{ j = J; }
+
+	void operator()( const std::size_t n )
+	{
+		Matrix< double, 6, 6 > result;
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Stochastic::backwardPropagationIdentity( result, 0.5, *this, params );
+			sum += result( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+
+struct BackwardPropagation200x6Svd
+	: public BackwardPropagation200x6
+{
+	void operator()( const std::size_t n )
+	{
+		Matrix< double, 6, 6 > result;
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			jacobian( params, work );
+			Stochastic::backwardPropagationIdentity( result, 0.5, work );
+			sum += result( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/stochastic/backward_propagation/200x6", BackwardPropagation200x6 );
+UBITRACK_BENCHMARK( "math/stochastic/backward_propagation/200x6_svd", BackwardPropagation200x6Svd );
+
+#endif // HAVE_LAPACK
+
+struct MahalanobisGating
+{
+	std::vector< Vector< double, 3 > > points;
+	std::vector< double > squared;
+	Stochastic::Gaussian< double, 3 > gaussian;
+
+	MahalanobisGating()
+	{
+		randomVectors( points, nData );
+		const double covariance[ 9 ] = { 2, 0.5, 0.1, 0.5, 1, 0.2, 0.1, 0.2, 0.5 };
+		std::copy( covariance, covariance + 9, gaussian.covariance );
+		std::fill( gaussian.mean, gaussian.mean + 3, 0.1 );
+	}
+};
+
+struct MahalanobisGatingSingle
+	: public MahalanobisGating
+{
+	void operator()( const std::size_t n )
+	{
+		const Stochastic::MahalanobisDistance< Stochastic::Gaussian< double, 3 > > distance( gaussian );
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			sum += distance.squared( points[ i % nData ] );
+		Benchmark::consume( sum );
+	}
+};
+
+struct MahalanobisGatingBatch
+	: public MahalanobisGating
+{
+	void operator()( const std::size_t n )
+	{
+		const Stochastic::MahalanobisDistance< Stochastic::Gaussian< double, 3 > > distance( gaussian );
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i += nData )
+		{
+			distance.squaredDistances( points, squared );
+			sum += squared[ i % nData ];
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/stochastic/mahalanobis_squared/3d", MahalanobisGatingSingle );
+UBITRACK_BENCHMARK( "math/stochastic/mahalanobis_squared/3d_batch", MahalanobisGatingBatch );
+
+#ifdef HAVE_LAPACK
+
+struct KalmanUpdate7x3
+{
+	Matrix< double, 3, 7 > h;
+	ErrorVector< double, 7 > prior;
+	ErrorVector< double, 3 > measurement;
+
+	KalmanUpdate7x3()
+	{
+		Random::seed( Benchmark::seed() );
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t c = 0; c < 7; c++ )
+				h( r, c ) = Random::distribute_uniform< double >( -1, 1 );
+		prior.value = Vector< double, 7 >::zeros();
+		prior.covariance = Matrix< double, 7, 7 >::identity();
+		measurement.value = Vector< double, 3 >::zeros();
+		measurement.covariance = Matrix< double, 3, 3 >::identity() * 0.01;
+	}
+};
+
+struct KalmanUpdate7x3Fixed
+	: public KalmanUpdate7x3
+{
+	void operator()( const std::size_t n )
+	{
+		const Optimization::Function::LinearFunction< 3, 7, double > mf( h );
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			ErrorVector< double, 7 > state( prior );
+			Stochastic::kalmanMeasurementUpdate< 7, 3 >( state, mf, measurement );
+			sum += state.covariance( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+
+struct KalmanUpdate7x3Generic
+	: public KalmanUpdate7x3
+{
+	void operator()( const std::size_t n )
+	{
+		const Optimization::Function::LinearFunction< 3, 7, double > mf( h );
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			ErrorVector< double, 7 > state( prior );
+			Stochastic::kalmanMeasurementUpdate( state.value, state.covariance, mf, 
+				measurement.value, measurement.covariance, 0, 7 );
+			sum += state.covariance( 0, 0 );
+		}
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/stochastic/kalman_update/7x3", KalmanUpdate7x3Fixed );
+UBITRACK_BENCHMARK( "math/stochastic/kalman_update/7x3_generic", KalmanUpdate7x3Generic );
+
+#endif // HAVE_LAPACK
+
+/** two signals of 4096 samples, correlated for the lags -2048..2048 */
+struct CrossCorrelation4096
+{
+	enum { nSamples = 4096, maxLag = 2048 };
+	std::vector< double > a;
+	std::vector< double > b;
+	std::vector< double > c;
+
+	CrossCorrelation4096()
+		: c( 2 * maxLag + 1 )
+	{
+		Random::seed( Benchmark::seed() );
+		for ( std::size_t i = 0; i < nSamples; i++ )
+		{
+			a.push_back( Random::distribute_uniform< double >( -1, 1 ) );
+			b.push_back( Random::distribute_uniform< double >( -1, 1 ) );
+		}
+	}
+
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			Stochastic::crossCorrelation( a, b, maxLag, c );
+			sum += c[ i % c.size() ];
+		}
+		Benchmark::consume( sum );
+	}
+};
+
+struct CrossCorrelation4096Direct
+	: public CrossCorrelation4096
+{
+	void operator()( const std::size_t n )
+	{
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			for ( long lag = -long( maxLag ); lag <= long( maxLag ); lag++ )
+			{
+				const long begin = std::max( 0L, -lag );
+				const long end = std::min( long( a.size() ), long( b.size() ) - lag );
+				c[ lag + maxLag ] = Stochastic::correlation( a.begin() + begin, a.begin() + end, b.begin() + begin + lag, b.begin() + end + lag );
+			}
+			sum += c[ i % c.size() ];
+		}
+		Benchmark::consume( sum );
+	}
+};
+
+struct SlidingCrossCorrelation4096
+	: public CrossCorrelation4096
+{
+	void operator()( const std::size_t n )
+	{
+		Stochastic::SlidingCrossCorrelation< double > sliding( 1024, maxLag );
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			sliding.push( a[ i % nSamples ], b[ i % nSamples ] );
+		sliding.correlations( c );
+		sum += c[ maxLag ];
+		Benchmark::consume( sum );
+	}
+};
+UBITRACK_BENCHMARK( "math/stochastic/cross_correlation/4096x4097", CrossCorrelation4096 );
+UBITRACK_BENCHMARK( "math/stochastic/cross_correlation/4096x4097_direct", CrossCorrelation4096Direct );
+UBITRACK_BENCHMARK( "math/stochastic/cross_correlation/sliding_push_1024x4097", SlidingCrossCorrelation4096 );
+
+} // anonymous namespace
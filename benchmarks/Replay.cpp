@@ -0,0 +1,698 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Replay of recorded sessions through the utcore tracking pipelines
+ */
+
+#include "Replay.h"
+#include "Benchmark.h"
+
+#include <set>
+#include <map>
+#include <cmath>
+#include <sstream>
+#include <ostream>
+#include <iomanip>
+#include <iterator>
+#include <algorithm>
+#include <typeinfo>
+
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <utUtil/OS.h>
+#include <utUtil/Exception.h>
+#include <utUtil/HistogramBlockTimer.h>
+#include <utMath/Pose.h>
+#include <utMath/ErrorPose.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Geometry/PointProjection.h>
+#include <utMath/Graph/Munkres.h>
+#include <utMeasurement/Measurement.h>
+#include <utSerialization/MeasurementLog.h>
+#include <utSerialization/BoostArchiveSerializer.h>
+#include <utAlgorithm/PoseEstimation2D3D/PlanarPoseEstimation.h>
+#include <utAlgorithm/3DPointReconstruction.h>
+#include <utAlgorithm/FundamentalMatrix.h>
+#include <utTracking/PoseKalmanFilter.h>
+
+namespace Ubitrack { namespace Benchmark {
+
+namespace {
+
+namespace Log = Serialization::MeasurementLog;
+namespace ublas = boost::numeric::ublas;
+
+typedef std::vector< Math::Vector< double, 2 > > Detections;
+typedef std::vector< Math::Vector< double, 3 > > Model;
+
+/// maximum distance in pixels of an associated detection to its predicted model point
+const double g_maxAssociationDistance = 20;
+
+/// maximum distance in pixels of a stereo match to the epipolar line
+const double g_maxEpipolarDistance = 3;
+
+/// minimum number of associated detections for a pose
+const std::size_t g_minPosePoints = 6;
+
+/// timers of the pipeline stages, in the order of the report
+struct Stages
+	: private boost::noncopyable
+{
+	Stages()
+		: read( "read" )
+		, serialization( "serialization" )
+		, association( "association" )
+		, pose2d3d( "pose2d3d" )
+		, fusion( "fusion" )
+		, reconstruction( "reconstruction" )
+		, lostFrames( 0 )
+	{}
+
+	Util::HistogramBlockTimer read;
+	Util::HistogramBlockTimer serialization;
+	Util::HistogramBlockTimer association;
+	Util::HistogramBlockTimer pose2d3d;
+	Util::HistogramBlockTimer fusion;
+	Util::HistogramBlockTimer reconstruction;
+
+	std::size_t lostFrames;
+};
+
+
+/// a stream of the session, whose measurements are replayed in temporal order
+class Source
+	: private boost::noncopyable
+{
+public:
+	Source()
+		: m_timeOffset( 0 )
+	{}
+
+	virtual ~Source()
+	{}
+
+	virtual std::size_t size() const = 0;
+
+	virtual Measurement::Timestamp time( std::size_t i ) const = 0;
+
+	/// reads and processes measurement i
+	virtual void replay( std::size_t i ) = 0;
+
+	/// added to the recorded timestamps, so repeated passes continue in time
+	void setTimeOffset( Measurement::Timestamp offset )
+	{ m_timeOffset = offset; }
+
+protected:
+	Measurement::Timestamp m_timeOffset;
+};
+
+
+/// round-trip through a boost binary archive, as when sending the measurement to another process
+template< typename T >
+void serializationRoundTrip( const Measurement::Measurement< T >& m, Measurement::Measurement< T >& copy )
+{
+	std::ostringstream os;
+	{
+		boost::archive::binary_oarchive out( os );
+		Serialization::BoostArchive::serialize( out, m );
+	}
+	std::istringstream is( os.str() );
+	boost::archive::binary_iarchive in( is );
+	Serialization::BoostArchive::deserialize( in, copy );
+}
+
+
+/// reads the measurements of a stream with payload type \c T, derived classes process them
+template< typename T >
+class StreamSource
+	: public Source
+{
+public:
+	typedef Measurement::Measurement< T > MeasurementType;
+
+	StreamSource( const Log::Reader& reader, unsigned id, Stages& stages )
+		: m_stream( reader, id )
+		, m_stages( stages )
+		, m_copy( 0, boost::shared_ptr< T >( new T() ) )
+	{}
+
+	std::size_t size() const
+	{ return m_stream.size(); }
+
+	Measurement::Timestamp time( std::size_t i ) const
+	{ return m_stream.time( i ); }
+
+	void replay( std::size_t i )
+	{
+		{
+			Util::HistogramBlockTimer::Time timer( m_stages.read );
+			m_stream.read( i, m_measurement );
+			m_measurement.time( m_measurement.time() + m_timeOffset );
+		}
+		{
+			Util::HistogramBlockTimer::Time timer( m_stages.serialization );
+			serializationRoundTrip( m_measurement, m_copy );
+		}
+		process( m_measurement );
+	}
+
+protected:
+	virtual void process( const MeasurementType& )
+	{}
+
+	Log::StreamReader< T > m_stream;
+	Stages& m_stages;
+	MeasurementType m_measurement;
+	MeasurementType m_copy;
+};
+
+
+#ifdef HAVE_LAPACK
+
+/// the motion model of all filters, constant velocity and angular velocity
+Tracking::LinearPoseMotionModel motionModel()
+{
+	Tracking::LinearPoseMotionModel model( 1, 1 );
+	model.setPosPN( 0, 0.1 );
+	model.setPosPN( 1, 0.1 );
+	model.setOriPN( 0, 0.1 );
+	model.setOriPN( 1, 0.1 );
+	return model;
+}
+
+Math::ErrorPose toErrorPose( const Math::Pose& pose )
+{
+	// 1mm and about 0.1 degrees
+	Math::Matrix< double, 6, 6 > covariance( Math::Matrix< double, 6, 6 >::identity() * 1e-6 );
+	return Math::ErrorPose( pose, covariance );
+}
+
+Math::ErrorPose toErrorPose( const Math::PackedErrorPose< double >& pose )
+{ return pose.toErrorPose(); }
+
+
+/// fuses the poses of a stream with a Kalman filter
+template< typename T >
+class PoseSource
+	: public StreamSource< T >
+{
+public:
+	PoseSource( const Log::Reader& reader, unsigned id, Stages& stages )
+		: StreamSource< T >( reader, id, stages )
+		, m_filter( motionModel() )
+	{}
+
+protected:
+	void process( const typename StreamSource< T >::MeasurementType& m )
+	{
+		Util::HistogramBlockTimer::Time timer( this->m_stages.fusion );
+		m_filter.addPoseMeasurement( Measurement::ErrorPose( m.time(), toErrorPose( *m ) ) );
+		consume( m_filter.predictPose( m.time() )->translation()( 0 ) );
+	}
+
+	Tracking::PoseKalmanFilter m_filter;
+};
+
+
+/// a camera, tracking a model and/or reconstructing points with a second camera
+class CameraSource
+	: public StreamSource< Detections >
+{
+public:
+	CameraSource( const Log::Reader& reader, unsigned id, Stages& stages, const Math::Matrix< double, 3, 3 >& K )
+		: StreamSource< Detections >( reader, id, stages )
+		, m_K( K )
+		, m_filter( motionModel() )
+		, m_bTracking( false )
+		, m_bCalibrated( false )
+		, m_bFrame( false )
+		, m_pPartner( 0 )
+	{}
+
+	/// tracks the model in the detections
+	void setModel( const Model& model )
+	{ m_model = model; }
+
+	/// sets the pose of the camera in world coordinates, from world to camera
+	void setExtrinsics( const Math::Pose& pose )
+	{
+		m_bCalibrated = true;
+		m_extrinsics = pose;
+		m_projection = ublas::prod( m_K, Math::Matrix< double, 3, 4 >( pose ) );
+	}
+
+	bool calibrated() const
+	{ return m_bCalibrated; }
+
+	/// reconstructs the points of each frame with the last frame of \c partner
+	void setStereoPartner( CameraSource& partner )
+	{
+		m_pPartner = &partner;
+		m_fundamental = Algorithm::fundamentalMatrixFromPoses( m_extrinsics, partner.m_extrinsics, m_K, partner.m_K );
+	}
+
+protected:
+	void process( const MeasurementType& m )
+	{
+		if ( !m_model.empty() )
+			track( m );
+		if ( m_pPartner && m_pPartner->m_bFrame )
+			reconstruct( *m );
+		m_detections = *m;
+		m_bFrame = true;
+	}
+
+	void track( const MeasurementType& m )
+	{
+		m_p2D.clear();
+		m_p3D.clear();
+		{
+			Util::HistogramBlockTimer::Time timer( m_stages.association );
+			if ( !m_bTracking )
+			{
+				// the first frame is in the order of the model
+				for ( std::size_t i = 0; i < std::min( m_model.size(), m->size() ); i++ )
+				{
+					m_p2D.push_back( ( *m )[ i ] );
+					m_p3D.push_back( m_model[ i ] );
+				}
+			}
+			else
+				associate( m );
+		}
+		if ( m_p2D.size() < g_minPosePoints )
+		{
+			m_stages.lostFrames++;
+			return;
+		}
+
+		Math::ErrorPose pose;
+		{
+			Util::HistogramBlockTimer::Time timer( m_stages.pose2d3d );
+			try
+			{
+				double residual;
+				pose = Algorithm::PoseEstimation2D3D::computePose( m_p2D, m_p3D, m_K, residual, true,
+					Algorithm::PoseEstimation2D3D::EPNP );
+			}
+			catch ( const Util::Exception& )
+			{
+				m_stages.lostFrames++;
+				return;
+			}
+		}
+
+		Util::HistogramBlockTimer::Time timer( m_stages.fusion );
+		m_filter.addPoseMeasurement( Measurement::ErrorPose( m.time(), pose ) );
+		m_bTracking = true;
+	}
+
+	/// assigns the detections to the model points projected with the predicted pose
+	void associate( const MeasurementType& m )
+	{
+		const Math::Pose predicted( *m_filter.extrapolatePose( m.time() ) );
+		const Math::Matrix< double, 3, 4 > projection( ublas::prod( m_K, Math::Matrix< double, 3, 4 >( predicted ) ) );
+		m_projected.clear();
+		Math::Geometry::project_points( projection, m_model.begin(), m_model.end(), std::back_inserter( m_projected ) );
+
+		const Detections& detections( *m );
+		m_costs.resize( m_model.size(), detections.size(), false );
+		for ( std::size_t r = 0; r < m_model.size(); r++ )
+			for ( std::size_t c = 0; c < detections.size(); c++ )
+			{
+				const Math::Vector< double, 2 > d( m_projected[ r ] - detections[ c ] );
+				m_costs( r, c ) = ublas::inner_prod( d, d );
+			}
+
+		m_assignment.setMatrix( m_costs, g_maxAssociationDistance * g_maxAssociationDistance );
+		m_assignment.solve( m_matches );
+		m_matches = m_assignment.getRowMatchList();
+		for ( std::size_t r = 0; r < m_matches.size(); r++ )
+			if ( m_matches[ r ] != Math::Graph::Munkres< double >::unassigned )
+			{
+				m_p2D.push_back( detections[ m_matches[ r ] ] );
+				m_p3D.push_back( m_model[ r ] );
+			}
+	}
+
+	void reconstruct( const Detections& detections )
+	{
+		Util::HistogramBlockTimer::Time timer( m_stages.reconstruction );
+		const std::vector< Math::Vector< double, 3 > > points( Algorithm::reconstruct3DPoints( detections, m_pPartner->m_detections,
+			m_projection, m_pPartner->m_projection, m_fundamental, g_maxEpipolarDistance ) );
+		consume( static_cast< double >( points.size() ) );
+	}
+
+	Math::Matrix< double, 3, 3 > m_K;
+	Model m_model;
+	Tracking::PoseKalmanFilter m_filter;
+	bool m_bTracking;
+
+	bool m_bCalibrated;
+	Math::Pose m_extrinsics;
+	Math::Matrix< double, 3, 4 > m_projection;
+
+	/// last frame, for the stereo partner
+	bool m_bFrame;
+	Detections m_detections;
+	CameraSource* m_pPartner;
+	Math::Matrix< double, 3, 3 > m_fundamental;
+
+	// buffers reused in every frame
+	Math::Graph::Munkres< double > m_assignment;
+	Math::Matrix< double, 0, 0 > m_costs;
+	std::vector< std::size_t > m_matches;
+	Detections m_projected;
+	Detections m_p2D;
+	Model m_p3D;
+};
+
+#endif // HAVE_LAPACK
+
+
+/// a measurement to replay
+struct Event
+{
+	Measurement::Timestamp time;
+	Source* pSource;
+	std::size_t index;
+
+	bool operator<( const Event& other ) const
+	{ return time < other.time; }
+};
+
+
+/// id of the stream \c name, or -1 if there is none
+int findStream( const Log::Reader& reader, const std::string& name )
+{
+	for ( std::size_t i = 0; i < reader.streamCount(); i++ )
+		if ( reader.stream( i ).name == name )
+			return static_cast< int >( i );
+	return -1;
+}
+
+template< typename T >
+bool isStreamOf( const Log::Reader& reader, int id )
+{ return id >= 0 && reader.stream( id ).type == typeid( T ).name(); }
+
+/// first measurement of a stream with parameters
+template< typename T >
+T readStatic( const Log::Reader& reader, int id )
+{
+	if ( !isStreamOf< T >( reader, id ) )
+		UBITRACK_THROW( "Stream " + reader.stream( id ).name + " has an unexpected type" );
+	Log::StreamReader< T > stream( reader, id );
+	if ( stream.size() == 0 )
+		UBITRACK_THROW( "Stream " + reader.stream( id ).name + " is empty" );
+	return *stream[ 0 ];
+}
+
+StageResult stageResult( const Util::HistogramBlockTimer& timer )
+{
+	const Util::HistogramBlockTimer::Statistics statistics( timer.getStatistics() );
+	StageResult r;
+	r.name = timer.getName();
+	r.runs = statistics.runs;
+	r.avg = statistics.avg;
+	r.p50 = statistics.p50;
+	r.p99 = statistics.p99;
+	r.p999 = statistics.p999;
+	r.max = statistics.max;
+	return r;
+}
+
+} // anonymous namespace
+
+
+ReplayResult replaySession( const std::string& fileName, const ReplaySettings& settings )
+{
+	Log::Reader reader( fileName );
+	Stages stages;
+
+	// the parameters of the cameras are not replayed
+	std::set< int > parameters;
+	for ( unsigned id = 0; id < reader.streamCount(); id++ )
+		if ( isStreamOf< Detections >( reader, id ) && findStream( reader, reader.stream( id ).name + ".intrinsics" ) >= 0 )
+		{
+			const char* suffixes[] = { ".intrinsics", ".model", ".pose" };
+			for ( std::size_t i = 0; i < 3; i++ )
+				parameters.insert( findStream( reader, reader.stream( id ).name + suffixes[ i ] ) );
+		}
+
+	std::vector< boost::shared_ptr< Source > > sources;
+#ifdef HAVE_LAPACK
+	std::map< std::string, CameraSource* > calibrated;
+#endif
+	for ( unsigned id = 0; id < reader.streamCount(); id++ )
+	{
+		const std::string& name( reader.stream( id ).name );
+		if ( parameters.count( id ) )
+			continue;
+		else if ( isStreamOf< Math::Pose >( reader, id ) )
+		{
+#ifdef HAVE_LAPACK
+			sources.push_back( boost::shared_ptr< Source >( new PoseSource< Math::Pose >( reader, id, stages ) ) );
+#else
+			sources.push_back( boost::shared_ptr< Source >( new StreamSource< Math::Pose >( reader, id, stages ) ) );
+#endif
+		}
+		else if ( isStreamOf< Math::PackedErrorPose< double > >( reader, id ) )
+		{
+#ifdef HAVE_LAPACK
+			sources.push_back( boost::shared_ptr< Source >( new PoseSource< Math::PackedErrorPose< double > >( reader, id, stages ) ) );
+#else
+			sources.push_back( boost::shared_ptr< Source >( new StreamSource< Math::PackedErrorPose< double > >( reader, id, stages ) ) );
+#endif
+		}
+		else if ( isStreamOf< Detections >( reader, id ) )
+		{
+#ifdef HAVE_LAPACK
+			const int intrinsics = findStream( reader, name + ".intrinsics" );
+			if ( intrinsics >= 0 )
+			{
+				const Math::Vector< double, 9 > k( readStatic< Math::Vector< double, 9 > >( reader, intrinsics ) );
+				Math::Matrix< double, 3, 3 > K;
+				for ( std::size_t i = 0; i < 9; i++ )
+					K( i / 3, i % 3 ) = k( i );
+
+				CameraSource* pCamera = new CameraSource( reader, id, stages, K );
+				sources.push_back( boost::shared_ptr< Source >( pCamera ) );
+				const int model = findStream( reader, name + ".model" );
+				if ( model >= 0 )
+					pCamera->setModel( readStatic< Model >( reader, model ) );
+				const int extrinsics = findStream( reader, name + ".pose" );
+				if ( extrinsics >= 0 )
+				{
+					pCamera->setExtrinsics( readStatic< Math::Pose >( reader, extrinsics ) );
+					calibrated[ name ] = pCamera;
+				}
+				continue;
+			}
+#endif
+			sources.push_back( boost::shared_ptr< Source >( new StreamSource< Detections >( reader, id, stages ) ) );
+		}
+	}
+#ifdef HAVE_LAPACK
+	if ( calibrated.size() >= 2 )
+		calibrated.begin()->second->setStereoPartner( *( ++calibrated.begin() )->second );
+#endif
+
+	// all measurements in temporal order
+	std::vector< Event > events;
+	for ( std::size_t s = 0; s < sources.size(); s++ )
+		for ( std::size_t i = 0; i < sources[ s ]->size(); i++ )
+		{
+			const Event e = { sources[ s ]->time( i ), sources[ s ].get(), i };
+			events.push_back( e );
+		}
+	std::stable_sort( events.begin(), events.end() );
+
+	ReplayResult result;
+	result.session = fileName;
+	result.measurements = 0;
+	result.sessionSeconds = events.empty() ? 0 : ( events.back().time - events.front().time ) * 1e-9;
+	result.allocationsTracked = Util::AllocationTracker::enabled();
+	Util::AllocationTracker::reset();
+
+	const long long start = Util::getMonotonicTime();
+	long long busyTicks = 0;
+	for ( std::size_t pass = 0; pass < settings.repeat && !events.empty(); pass++ )
+	{
+		// each pass starts one second after the end of the previous one
+		const Measurement::Timestamp offset = pass * ( events.back().time - events.front().time + 1000000000ULL );
+		for ( std::size_t s = 0; s < sources.size(); s++ )
+			sources[ s ]->setTimeOffset( offset );
+
+		const long long passStart = Util::getMonotonicTime();
+		for ( std::vector< Event >::const_iterator it = events.begin(); it != events.end(); ++it )
+		{
+			if ( settings.speed > 0 )
+				Util::sleepUntil( passStart + static_cast< long long >( ( it->time - events.front().time ) / settings.speed ), 200000 );
+
+			const long long busyStart = Util::getHighPerformanceCounter();
+			it->pSource->replay( it->index );
+			busyTicks += Util::getHighPerformanceCounter() - busyStart;
+			result.measurements++;
+		}
+	}
+	result.wallSeconds = ( Util::getMonotonicTime() - start ) * 1e-9;
+	result.busySeconds = busyTicks / Util::getHighPerformanceFrequency();
+	result.lostFrames = stages.lostFrames;
+
+	const Util::HistogramBlockTimer* timers[] = { &stages.read, &stages.serialization, &stages.association,
+		&stages.pose2d3d, &stages.fusion, &stages.reconstruction };
+	for ( std::size_t i = 0; i < sizeof( timers ) / sizeof( timers[ 0 ] ); i++ )
+		if ( timers[ i ]->getStatistics().runs )
+			result.stages.push_back( stageResult( *timers[ i ] ) );
+	if ( result.allocationsTracked )
+		result.allocations = Util::AllocationTracker::snapshot();
+	return result;
+}
+
+
+void generateSession( const std::string& fileName, const double seconds )
+{
+	Math::Random::seed( seed() );
+	Math::Random::Vector< double, 3 >::Uniform randModel( -0.2, 0.2 );
+	Math::Random::Vector< double, 2 >::Normal randNoise( 0, 0.2 );
+
+	Log::Writer writer( fileName );
+	const Measurement::Timestamp t0 = 1500000000000000000ULL;
+
+	// intrinsics of all cameras, 640x480 pixels
+	Math::Vector< double, 9 > k( Math::Vector< double, 9 >::zeros() );
+	k( 0 ) = k( 4 ) = 600;
+	k( 2 ) = 320;
+	k( 5 ) = 240;
+	k( 8 ) = 1;
+	Math::Matrix< double, 3, 3 > K;
+	for ( std::size_t i = 0; i < 9; i++ )
+		K( i / 3, i % 3 ) = k( i );
+
+	// a model tracked by the camera at the origin and a stereo pair with a baseline of 20cm
+	Model model;
+	std::generate_n( std::back_inserter( model ), 20, randModel );
+	const Math::Pose stereo[ 2 ] = { Math::Pose( Math::Quaternion(), Math::Vector< double, 3 >( 0.1, 0, 0 ) ),
+		Math::Pose( Math::Quaternion(), Math::Vector< double, 3 >( -0.1, 0, 0 ) ) };
+	const char* cameraNames[ 3 ] = { "camera", "left", "right" };
+
+	unsigned cameraIds[ 3 ];
+	for ( std::size_t c = 0; c < 3; c++ )
+	{
+		const std::string name( cameraNames[ c ] );
+		cameraIds[ c ] = writer.addStream< Detections >( name );
+		writer.write( writer.addStream< Math::Vector< double, 9 > >( name + ".intrinsics" ), t0, k );
+		if ( c == 0 )
+			writer.write( writer.addStream< Model >( name + ".model" ), t0, model );
+		else
+			writer.write( writer.addStream< Math::Pose >( name + ".pose" ), t0, stereo[ c - 1 ] );
+	}
+	const unsigned trackerId = writer.addStream< Math::PackedErrorPose< double > >( "tracker" );
+
+	// the target moves on a circle 4m in front of the cameras and rotates back and forth
+	const Math::Vector< double, 3 > axis( Math::Vector< double, 3 >( 0, 1, 0.3 ) / std::sqrt( 1.09 ) );
+	const std::size_t nTracker = static_cast< std::size_t >( seconds * 100 );
+	for ( std::size_t i = 0; i < nTracker; i++ )
+	{
+		const double t = i * 0.01;
+		const Math::Pose target( Math::Quaternion( axis, 0.5 * std::sin( t ) ),
+			Math::Vector< double, 3 >( 0.3 * std::sin( t ), 0.2 * std::cos( t ), 4 + 0.3 * std::sin( 0.5 * t ) ) );
+		writer.write( trackerId, t0 + static_cast< Measurement::Timestamp >( i ) * 10000000ULL,
+			Math::PackedErrorPose< double >( target, Math::Matrix< double, 6, 6 >::identity() * 1e-6 ) );
+	}
+
+	const std::size_t nFrames = static_cast< std::size_t >( seconds * 60 );
+	for ( std::size_t i = 0; i < nFrames; i++ )
+	{
+		const double t = i / 60.0;
+		const Math::Pose target( Math::Quaternion( axis, 0.5 * std::sin( t ) ),
+			Math::Vector< double, 3 >( 0.3 * std::sin( t ), 0.2 * std::cos( t ), 4 + 0.3 * std::sin( 0.5 * t ) ) );
+		for ( std::size_t c = 0; c < 3; c++ )
+		{
+			const Math::Pose camera( c == 0 ? target : stereo[ c - 1 ] * target );
+			const Math::Matrix< double, 3, 4 > projection( ublas::prod( K, Math::Matrix< double, 3, 4 >( camera ) ) );
+			Detections detections;
+			Math::Geometry::project_points( projection, model.begin(), model.end(), std::back_inserter( detections ) );
+			for ( std::size_t j = 0; j < detections.size(); j++ )
+				detections[ j ] = detections[ j ] + randNoise();
+
+			// detectors do not report the points in a fixed order, except the first frame of the tracking camera
+			if ( i > 0 || c > 0 )
+				for ( std::size_t j = detections.size() - 1; j > 0; j-- )
+					std::swap( detections[ j ], detections[ Math::Random::distribute_uniform< std::size_t >( 0, j ) ] );
+			writer.write( cameraIds[ c ], t0 + static_cast< Measurement::Timestamp >( i * 1e9 / 60 ), detections );
+		}
+	}
+	writer.close();
+}
+
+
+void writeReplayCsv( std::ostream& os, const ReplayResult& result )
+{
+	os << std::setprecision( 6 )
+		<< "# session,measurements,session_s,wall_s,busy_s,throughput_hz,lost_frames\n"
+		<< "# " << result.session << ',' << result.measurements << ',' << result.sessionSeconds << ',' << result.wallSeconds
+		<< ',' << result.busySeconds << ',' << ( result.busySeconds > 0 ? result.measurements / result.busySeconds : 0 )
+		<< ',' << result.lostFrames << '\n';
+	for ( std::vector< Util::AllocationStatistics >::const_iterator it = result.allocations.begin(); it != result.allocations.end(); ++it )
+		os << "# allocations " << it->category << ": " << it->allocations << " allocations, " << it->bytes << " bytes, "
+			<< it->peakBytes << " peak bytes\n";
+
+	os << "stage,runs,avg_ms,p50_ms,p99_ms,p999_ms,max_ms\n";
+	for ( std::vector< StageResult >::const_iterator it = result.stages.begin(); it != result.stages.end(); ++it )
+		os << it->name << ',' << it->runs << ',' << it->avg << ',' << it->p50 << ',' << it->p99 << ',' << it->p999 << ',' << it->max << '\n';
+}
+
+
+void writeReplayJson( std::ostream& os, const ReplayResult& result )
+{
+	os << std::setprecision( 6 )
+		<< "{\n  \"session\": \"" << result.session << "\", \"measurements\": " << result.measurements
+		<< ", \"session_s\": " << result.sessionSeconds << ", \"wall_s\": " << result.wallSeconds
+		<< ", \"busy_s\": " << result.busySeconds
+		<< ", \"throughput_hz\": " << ( result.busySeconds > 0 ? result.measurements / result.busySeconds : 0 )
+		<< ", \"lost_frames\": " << result.lostFrames << ",\n  \"stages\": [";
+	for ( std::vector< StageResult >::const_iterator it = result.stages.begin(); it != result.stages.end(); ++it )
+		os << ( it == result.stages.begin() ? "\n" : ",\n" )
+			<< "    { \"name\": \"" << it->name << "\", \"runs\": " << it->runs << ", \"avg_ms\": " << it->avg
+			<< ", \"p50_ms\": " << it->p50 << ", \"p99_ms\": " << it->p99 << ", \"p999_ms\": " << it->p999
+			<< ", \"max_ms\": " << it->max << " }";
+	os << "\n  ]";
+	if ( result.allocationsTracked )
+	{
+		os << ",\n  \"allocations\": [";
+		for ( std::vector< Util::AllocationStatistics >::const_iterator it = result.allocations.begin(); it != result.allocations.end(); ++it )
+			os << ( it == result.allocations.begin() ? "\n" : ",\n" )
+				<< "    { \"category\": \"" << it->category << "\", \"allocations\": " << it->allocations
+				<< ", \"deallocations\": " << it->deallocations << ", \"bytes\": " << it->bytes
+				<< ", \"peak_bytes\": " << it->peakBytes << " }";
+		os << "\n  ]";
+	}
+	os << "\n}\n";
+}
+
+} } // namespace Ubitrack::Benchmark
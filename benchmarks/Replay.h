@@ -0,0 +1,143 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Replay of recorded sessions through the utcore tracking pipelines
+ *
+ * The micro benchmarks measure single functions on synthetic input. A replay instead drives
+ * the pipelines with the measurements of a recorded session, in the order and optionally at
+ * the speed in which they were recorded, so the results reflect the real workload mix.
+ *
+ * Sessions are \c MeasurementLog files. The streams are assigned to the pipelines by their
+ * payload type and name:
+ * - \c Math::Pose or \c Math::PackedErrorPose< double > streams: each stream is fused by a
+ *   \c PoseKalmanFilter, which predicts the pose at the time of every measurement
+ *   ("fusion" stage). Poses without covariance get a fixed one.
+ * - <tt>std::vector< Math::Vector< double, 2 > ></tt> streams are the detections of a camera
+ *   \c C, whose intrinsics are the first measurement of the stream <tt>C.intrinsics</tt>,
+ *   a <tt>Math::Vector< double, 9 ></tt> holding the matrix row by row. Cameras without
+ *   intrinsics are only read.
+ *   - if there is a stream <tt>C.model</tt> (<tt>std::vector< Math::Vector< double, 3 > ></tt>),
+ *     the camera tracks the model: the detections are associated to the model points
+ *     projected with the predicted pose by \c Munkres ("association"), the pose is computed
+ *     by \c computePose ("pose2d3d") and fused by a \c PoseKalmanFilter ("fusion"). The
+ *     detections of the first frame must be in the order of the model.
+ *   - if there is a stream <tt>C.pose</tt> (\c Math::Pose, from world to camera coordinates),
+ *     the camera is calibrated. The first two calibrated cameras by name form a stereo pair:
+ *     every frame of the first is reconstructed with the last frame of the second by
+ *     \c reconstruct3DPoints ("reconstruction").
+ * - streams of other types are not replayed.
+ *
+ * Every replayed measurement is read from the log ("read") and serialized to and
+ * deserialized from a boost binary archive ("serialization"). The stages are timed by
+ * \c HistogramBlockTimer, and the allocations counted by the \c AllocationTracker if the
+ * library is built with \c UBITRACK_TRACK_ALLOCATIONS.
+ *
+ * \c generateSession writes a synthetic session that uses all pipelines.
+ */
+
+#ifndef __UBITRACK_BENCHMARK_REPLAY_H_INCLUDED__
+#define __UBITRACK_BENCHMARK_REPLAY_H_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+#include <utUtil/AllocationTracker.h>
+
+namespace Ubitrack { namespace Benchmark {
+
+/** settings of a replay */
+struct ReplaySettings
+{
+	ReplaySettings()
+		: speed( 0 )
+		, repeat( 1 )
+	{}
+
+	/// playback speed relative to the recording, e.g. 1 for recorded speed, 0 replays as fast as possible
+	double speed;
+
+	/// number of passes over the session, the pipelines keep their state between passes
+	std::size_t repeat;
+};
+
+/** latency distribution of one pipeline stage, times in ms */
+struct StageResult
+{
+	std::string name;
+	std::size_t runs;
+	double avg;
+	double p50;
+	double p99;
+	double p999;
+	double max;
+};
+
+/** result of a replay */
+struct ReplayResult
+{
+	std::string session;
+
+	/// number of replayed measurements, over all passes
+	std::size_t measurements;
+
+	/// duration of the recording and of the replay in seconds
+	double sessionSeconds;
+	double wallSeconds;
+
+	/// time spent in the pipelines in seconds, the wall time without waiting for recorded time
+	double busySeconds;
+
+	/// frames of tracking cameras without a pose, e.g. when too few detections were associated
+	std::size_t lostFrames;
+
+	std::vector< StageResult > stages;
+
+	/// true if the library counts allocations, see \c Util::AllocationTracker
+	bool allocationsTracked;
+	std::vector< Util::AllocationStatistics > allocations;
+};
+
+/**
+ * replays a session through the pipelines. Throws a \c Util::Exception if the file
+ * cannot be read.
+ */
+ReplayResult replaySession( const std::string& fileName, const ReplaySettings& settings );
+
+/**
+ * writes a synthetic session of a moving target, observed by a tracker, a camera
+ * tracking a model and a stereo pair
+ */
+void generateSession( const std::string& fileName, double seconds );
+
+/** writes the result as comma separated values, one stage per line */
+void writeReplayCsv( std::ostream& os, const ReplayResult& result );
+
+/** writes the result as a json document */
+void writeReplayJson( std::ostream& os, const ReplayResult& result );
+
+} } // namespace Ubitrack::Benchmark
+
+#endif
@@ -0,0 +1,395 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Thread scaling of the parallel algorithms, see Scaling.h
+ */
+
+#include "Scaling.h"
+#include "Benchmark.h"
+
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <utUtil/OS.h>
+#include <utUtil/Executor.h>
+#include <utMath/Pose.h>
+#include <utMath/Matrix.h>
+#include <utMath/PoseListOperations.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utMath/Stochastic/KMeansClustering.h>
+#include <utMath/Stochastic/GaussianMixtureEM.h>
+#include <utAlgorithm/3DPointReconstruction.h>
+#include <utAlgorithm/BundleAdjustmentPartition.h>
+#include <utAlgorithm/PoseEstimation3D3D/Ransac.h>
+
+namespace Ubitrack { namespace Benchmark {
+
+namespace {
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+/// runs a workload once with the threads of the given executor
+typedef boost::function< void ( Ubitrack::Util::Executor& ) > Workload;
+
+
+bool selected( const ScalingSettings& settings, const std::string& workload )
+{ return settings.filter.empty() || workload.find( settings.filter ) != std::string::npos; }
+
+
+double median( std::vector< double > values )
+{
+	std::sort( values.begin(), values.end() );
+	return values[ values.size() / 2 ];
+}
+
+
+/** runs a workload with 1 to \c settings.threads threads and appends the results */
+void measure( const ScalingSettings& settings, const std::string& name, const Workload& workload, std::vector< ScalingResult >& results )
+{
+	double singleUs = 0;
+	for ( std::size_t t = 1; t <= settings.threads; t++ )
+	{
+		Ubitrack::Util::Executor executor( static_cast< unsigned >( t ) );
+
+		// the first run warms up the caches and the threads of the executor
+		workload( executor );
+
+		std::vector< double > times;
+		for ( std::size_t r = 0; r < settings.repetitions; r++ )
+		{
+			const long long start = Ubitrack::Util::getHighPerformanceCounter();
+			workload( executor );
+			times.push_back( ( Ubitrack::Util::getHighPerformanceCounter() - start ) * 1e6 / Ubitrack::Util::getHighPerformanceFrequency() );
+		}
+
+		ScalingResult result;
+		result.workload = name;
+		result.threads = t;
+		result.medianUs = median( times );
+		if ( t == 1 )
+			singleUs = result.medianUs;
+		result.speedup = result.medianUs > 0 ? singleUs / result.medianUs : std::numeric_limits< double >::quiet_NaN();
+		result.efficiency = result.speedup / t;
+		results.push_back( result );
+	}
+}
+
+
+/// points around a few centers, the data of k-means and EM
+std::vector< Vector< double, 3 > > clusteredPoints( const std::size_t n, const std::size_t nCenters )
+{
+	Random::seed( seed() );
+	Random::Vector< double, 3 >::Uniform randCenter( -10, 10 );
+	std::vector< Vector< double, 3 > > centers;
+	for ( std::size_t c = 0; c < nCenters; c++ )
+		centers.push_back( randCenter() );
+
+	std::vector< Vector< double, 3 > > points( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		points[ i ] = centers[ i % nCenters ];
+		for ( std::size_t j = 0; j < 3; j++ )
+			points[ i ]( j ) += Random::distribute_normal< double >( 0, 1 );
+	}
+	return points;
+}
+
+
+struct KMeansWorkload
+{
+	KMeansWorkload()
+		: points( clusteredPoints( 200000, 16 ) )
+	{}
+
+	void operator()( Ubitrack::Util::Executor& executor ) const
+	{
+		// the same seeding in every run
+		Random::seed( seed() );
+		Stochastic::KMeansClustering< double, 3 > kmeans( 16, 20 );
+		consume( kmeans.cluster( points, poolExecutor( executor, 1 ) ) );
+	}
+
+	std::vector< Vector< double, 3 > > points;
+};
+
+
+struct EMWorkload
+{
+	typedef Stochastic::GaussianMixtureEM< double, 3 >::component_type Component;
+
+	EMWorkload()
+		: points( clusteredPoints( 100000, 4 ) )
+	{
+		// broad components at the first points, EM has to find the centers
+		for ( std::size_t c = 0; c < 4; c++ )
+		{
+			Stochastic::Gaussian< double, 3 > gaussian;
+			Stochastic::reset( gaussian );
+			for ( std::size_t j = 0; j < 3; j++ )
+			{
+				gaussian.mean[ j ] = points[ c ]( j );
+				gaussian.covariance[ 4 * j ] = 25;
+			}
+			initial.push_back( Component( gaussian, 0.25 ) );
+		}
+	}
+
+	void operator()( Ubitrack::Util::Executor& executor ) const
+	{
+		// a threshold of zero runs all iterations
+		std::vector< Component > mixture( initial );
+		Stochastic::GaussianMixtureEM< double, 3 > em( 20, 0, 1e-6 );
+		consume( em.estimate( points, mixture, poolExecutor( executor, 1 ) ) );
+	}
+
+	std::vector< Vector< double, 3 > > points;
+	std::vector< Component > initial;
+};
+
+
+struct TriangulationWorkload
+{
+	TriangulationWorkload()
+		: imagePoints( 8 )
+	{
+		Random::seed( seed() );
+		Matrix< double, 3, 3 > K( Matrix< double, 3, 3 >::identity() );
+		K( 0, 0 ) = K( 1, 1 ) = 500;
+		K( 0, 2 ) = 320;
+		K( 1, 2 ) = 240;
+
+		// cameras on a circle looking at the origin
+		for ( std::size_t c = 0; c < 8; c++ )
+		{
+			const Quaternion rotation( Vector< double, 3 >( 0, 1, 0 ), 2 * 3.14159265358979323846 * c / 8 );
+			const Pose pose( rotation, Vector< double, 3 >( 0, 0, 5 ) );
+			matrices.push_back( ublas::prod( K, Matrix< double, 3, 4 >( pose ) ) );
+		}
+
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		for ( std::size_t i = 0; i < 100000; i++ )
+		{
+			const Vector< double, 3 > p( randVector() );
+			for ( std::size_t c = 0; c < 8; c++ )
+			{
+				const Vector< double, 3 > x( ublas::prod( matrices[ c ], Vector< double, 4 >( p( 0 ), p( 1 ), p( 2 ), 1 ) ) );
+				imagePoints[ c ].push_back( Vector< double, 2 >( x( 0 ) / x( 2 ) + Random::distribute_normal< double >( 0, 0.5 ),
+					x( 1 ) / x( 2 ) + Random::distribute_normal< double >( 0, 0.5 ) ) );
+			}
+		}
+	}
+
+	void operator()( Ubitrack::Util::Executor& executor ) const
+	{
+		const Algorithm::MultiViewTriangulation< double > triangulation( matrices );
+		std::vector< Vector< double, 3 > > points;
+		std::vector< Matrix< double, 3, 3 > > covariances;
+		triangulation.triangulate( imagePoints, points, &covariances, 0.5, poolExecutor( executor, 1024 ) );
+		consume( points.back()( 0 ) + covariances.back()( 0, 0 ) );
+	}
+
+	std::vector< Matrix< double, 3, 4 > > matrices;
+	std::vector< std::vector< Vector< double, 2 > > > imagePoints;
+};
+
+
+#ifdef HAVE_LAPACK
+
+struct RansacWorkload
+{
+	RansacWorkload()
+	{
+		Random::seed( seed() );
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		Random::Quaternion< double >::Uniform randQuat;
+		const Pose truth( randQuat(), randVector() );
+		for ( std::size_t i = 0; i < 2000; i++ )
+		{
+			pointsB.push_back( randVector() );
+			if ( i % 10 < 3 )
+				pointsA.push_back( truth * randVector() );
+			else
+			{
+				Vector< double, 3 > a( truth * pointsB.back() );
+				for ( std::size_t j = 0; j < 3; j++ )
+					a( j ) += Random::distribute_normal< double >( 0, 0.01 );
+				pointsA.push_back( a );
+			}
+		}
+	}
+
+	void operator()( Ubitrack::Util::Executor& executor ) const
+	{
+		Optimization::RansacParameter< double > params( 0.05, 3, 1000, std::size_t( 0 ), 0.0, executor.concurrency(), seed() );
+		params.executor = &executor;
+		params.nPreemptiveHypotheses = 1024;
+		params.preemptiveBlockSize = 200;
+		Pose pose;
+		Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( pointsA, pose, pointsB, params );
+		consume( pose.translation()( 0 ) );
+	}
+
+	std::vector< Vector< double, 3 > > pointsA;
+	std::vector< Vector< double, 3 > > pointsB;
+};
+
+
+/// solves the clusters [ begin, end ) like \c solveClustersLocally
+void solveClusters( std::vector< Algorithm::BundleAdjustmentCluster >* pClusters,
+	const Algorithm::BundleAdjustmentPartitionParameters* pParams, std::size_t begin, std::size_t end )
+{
+	for ( std::size_t k = begin; k < end; k++ )
+		if ( !( *pClusters )[ k ].network.observations.empty() )
+			Algorithm::bundleAdjustment( ( *pClusters )[ k ].network, pParams->solver, pParams->maxIterations );
+}
+
+
+struct BundleAdjustmentWorkload
+{
+	BundleAdjustmentWorkload()
+	{
+		// a row of cameras looking at a strip of points, disturbed
+		Random::seed( seed() );
+		const std::size_t nCameras = 64;
+		Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+		for ( std::size_t c = 0; c < nCameras; c++ )
+			network.cameras.push_back( Pose( Quaternion::fromLogarithm( Vector< double, 3 >( 0.05 * randVector() ) ),
+				Vector< double, 3 >( -0.5 * c, 0, 8 ) ) );
+		for ( std::size_t p = 0; p < 15 * nCameras; p++ )
+		{
+			const Vector< double, 3 > r( randVector() );
+			network.points.push_back( Vector< double, 3 >( 0.5 * ( nCameras - 1 ) * ( r( 0 ) + 1 ) / 2, r( 1 ), r( 2 ) ) );
+		}
+		for ( std::size_t c = 0; c < nCameras; c++ )
+			for ( std::size_t p = 0; p < network.points.size(); p++ )
+				if ( std::fabs( network.points[ p ]( 0 ) - 0.5 * c ) < 1.6 )
+				{
+					const Vector< double, 3 > x( network.cameras[ c ] * network.points[ p ] );
+					network.observations.push_back( Algorithm::BundleAdjustmentNetwork::Observation( c, p, Vector< double, 2 >( x( 0 ) / x( 2 ), x( 1 ) / x( 2 ) ) ) );
+				}
+		for ( std::size_t c = 0; c < nCameras; c++ )
+			network.cameras[ c ] = Pose( network.cameras[ c ].rotation() * Quaternion::fromLogarithm( Vector< double, 3 >( 0.01 * randVector() ) ),
+				network.cameras[ c ].translation() + 0.05 * randVector() );
+		for ( std::size_t p = 0; p < network.points.size(); p++ )
+			network.points[ p ] += 0.05 * randVector();
+
+		params.maxClusterCameras = 4;
+		params.overlapCameras = 2;
+		params.consensusRounds = 1;
+	}
+
+	void operator()( Ubitrack::Util::Executor& executor ) const
+	{
+		Algorithm::BundleAdjustmentNetwork result( network );
+		consume( Algorithm::distributedBundleAdjustment( result, params, boost::bind( &BundleAdjustmentWorkload::solve, this, &executor, _1 ) ) );
+	}
+
+	/// the cluster solver, one cluster per task
+	void solve( Ubitrack::Util::Executor* pExecutor, std::vector< Algorithm::BundleAdjustmentCluster >& clusters ) const
+	{ pExecutor->parallelFor( 0, clusters.size(), 1, boost::bind( &solveClusters, &clusters, &params, _1, _2 ) ); }
+
+	Algorithm::BundleAdjustmentNetwork network;
+	Algorithm::BundleAdjustmentPartitionParameters params;
+};
+
+#endif // HAVE_LAPACK
+
+
+/// writes NaN, which json does not know, as null
+void writeJsonNumber( std::ostream& os, const double value )
+{
+	if ( value == value )
+		os << value;
+	else
+		os << "null";
+}
+
+} // anonymous namespace
+
+
+ScalingSettings::ScalingSettings()
+	: threads( std::max( 1u, boost::thread::hardware_concurrency() ) )
+	, repetitions( 5 )
+{}
+
+
+std::vector< ScalingResult > runScaling( const ScalingSettings& settings )
+{
+	std::vector< ScalingResult > results;
+#ifdef HAVE_LAPACK
+	if ( selected( settings, "ransac" ) )
+		measure( settings, "ransac", RansacWorkload(), results );
+#endif
+	if ( selected( settings, "k_means" ) )
+		measure( settings, "k_means", KMeansWorkload(), results );
+	if ( selected( settings, "em" ) )
+		measure( settings, "em", EMWorkload(), results );
+	if ( selected( settings, "triangulation" ) )
+		measure( settings, "triangulation", TriangulationWorkload(), results );
+#ifdef HAVE_LAPACK
+	if ( selected( settings, "bundle_adjustment" ) )
+		measure( settings, "bundle_adjustment", BundleAdjustmentWorkload(), results );
+#endif
+	return results;
+}
+
+
+void writeScalingCsv( std::ostream& os, const std::vector< ScalingResult >& results )
+{
+	os << "workload,threads,median_us,speedup,efficiency\n";
+	for ( std::vector< ScalingResult >::const_iterator it = results.begin(); it != results.end(); ++it )
+		os << it->workload << ',' << it->threads << ',' << std::setprecision( 6 ) << it->medianUs << ','
+			<< it->speedup << ',' << it->efficiency << '\n';
+}
+
+
+void writeScalingJson( std::ostream& os, const std::vector< ScalingResult >& results )
+{
+	os << "{\n  \"scaling\": [";
+	for ( std::vector< ScalingResult >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		os << ( it == results.begin() ? "\n" : ",\n" ) << std::setprecision( 6 )
+			<< "    { \"workload\": \"" << it->workload << "\", \"threads\": " << it->threads << ", \"median_us\": ";
+		writeJsonNumber( os, it->medianUs );
+		os << ", \"speedup\": ";
+		writeJsonNumber( os, it->speedup );
+		os << ", \"efficiency\": ";
+		writeJsonNumber( os, it->efficiency );
+		os << " }";
+	}
+	os << "\n  ]\n}\n";
+}
+
+} } // namespace Ubitrack::Benchmark
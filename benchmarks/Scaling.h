@@ -0,0 +1,95 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Thread scaling of the parallel algorithms
+ *
+ * Runs the same workload of each parallel algorithm with 1 up to N threads and reports the
+ * median runtime, the speedup over one thread and the parallel efficiency, i.e. the speedup
+ * divided by the number of threads. The threads are those of a \c Util::Executor with the
+ * given concurrency, so the runs do not share threads with the process executor:
+ * - \c ransac: preemptive RANSAC of \c estimatePose6D_3D3D on 2000 correspondences with 30%
+ *   outliers. The number of hypotheses is fixed, so the work does not depend on the random sets.
+ * - \c k_means: 20 iterations of \c KMeansClustering with 16 clusters on 200000 points
+ * - \c em: 20 iterations of \c GaussianMixtureEM with 4 components on 100000 points
+ * - \c triangulation: \c MultiViewTriangulation of 100000 points seen by 8 cameras, with covariances
+ * - \c bundle_adjustment: one round of \c distributedBundleAdjustment of a strip of 64 cameras,
+ *   with the clusters solved in parallel. The bundle adjustment of a single network has no
+ *   parallel mode, the clusters are the unit of parallel work.
+ *
+ * On a machine with fewer cores than threads, the additional threads only add overhead.
+ */
+
+#ifndef __UBITRACK_BENCHMARK_SCALING_H_INCLUDED__
+#define __UBITRACK_BENCHMARK_SCALING_H_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+namespace Ubitrack { namespace Benchmark {
+
+/** settings of the scaling benchmark */
+struct ScalingSettings
+{
+	ScalingSettings();
+
+	/// the workloads run with 1 up to this number of threads, by default the number of cores
+	std::size_t threads;
+
+	/// number of timed runs per workload and number of threads, the median is reported
+	std::size_t repetitions;
+
+	/// only workloads whose name contains this string are run
+	std::string filter;
+};
+
+/** result of one workload with one number of threads */
+struct ScalingResult
+{
+	std::string workload;
+	std::size_t threads;
+
+	/// median runtime in microseconds
+	double medianUs;
+
+	/// median runtime with one thread divided by the median runtime with \c threads threads
+	double speedup;
+
+	/// speedup divided by the number of threads, 1 is perfect scaling
+	double efficiency;
+};
+
+/** runs all workloads matching the filter with all numbers of threads */
+std::vector< ScalingResult > runScaling( const ScalingSettings& settings );
+
+/** writes the results as comma separated values, one workload and number of threads per line */
+void writeScalingCsv( std::ostream& os, const std::vector< ScalingResult >& results );
+
+/** writes the results as a json document */
+void writeScalingJson( std::ostream& os, const std::vector< ScalingResult >& results );
+
+} } // namespace Ubitrack::Benchmark
+
+#endif
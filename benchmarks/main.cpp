@@ -0,0 +1,236 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Command line front end of the utcore benchmarks
+ *
+ * usage: utcore_benchmarks [--format=csv|json] [--output=file] [--filter=substring]
+ *                          [--samples=n] [--min-time=seconds]
+ *        utcore_benchmarks --replay=session [--speed=factor] [--repeat=n] [--format=csv|json] [--output=file]
+ *        utcore_benchmarks --generate=session [--duration=seconds]
+ *        utcore_benchmarks --compare [--trials=n] [--filter=substring] [--format=csv|json] [--output=file]
+ *        utcore_benchmarks --scaling [--threads=n] [--samples=n] [--filter=substring] [--format=csv|json] [--output=file]
+ *        utcore_benchmarks --footprint [--filter=substring] [--format=csv|json] [--output=file]
+ *
+ * \c --replay runs a recorded session through the tracking pipelines instead of the
+ * benchmarks (see Replay.h), \c --generate writes a synthetic session. \c --compare runs the
+ * accuracy and runtime comparison of the solvers and estimators (see Comparison.h).
+ * \c --scaling runs the parallel algorithms with 1 up to n threads (see Scaling.h),
+ * \c --footprint reports the memory used by the measurement and math types (see Footprint.h).
+ */
+
+#include "Benchmark.h"
+#include "Replay.h"
+#include "Comparison.h"
+#include "Scaling.h"
+#include "Footprint.h"
+
+#include <utUtil/Exception.h>
+
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+
+namespace {
+
+/// returns true and the value if the argument has the form --key=value
+bool option( const std::string& arg, const std::string& key, std::string& value )
+{
+	const std::string prefix = "--" + key + "=";
+	if ( arg.compare( 0, prefix.size(), prefix ) != 0 )
+		return false;
+	value = arg.substr( prefix.size() );
+	return true;
+}
+
+} // anonymous namespace
+
+
+int main( int argc, char** argv )
+{
+	using namespace Ubitrack;
+
+	Benchmark::Settings settings;
+	Benchmark::ReplaySettings replaySettings;
+	Benchmark::ComparisonSettings comparisonSettings;
+	Benchmark::ScalingSettings scalingSettings;
+	bool bCompare = false;
+	bool bScaling = false;
+	bool bFootprint = false;
+	std::string format = "csv";
+	std::string output;
+	std::string replay;
+	std::string generate;
+	double duration = 10;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const std::string arg( argv[ i ] );
+		std::string value;
+		if ( arg == "--compare" )
+			bCompare = true;
+		else if ( arg == "--scaling" )
+			bScaling = true;
+		else if ( arg == "--footprint" )
+			bFootprint = true;
+		else if ( option( arg, "format", value ) )
+			format = value;
+		else if ( option( arg, "output", value ) )
+			output = value;
+		else if ( option( arg, "filter", value ) )
+		{
+			settings.filter = value;
+			comparisonSettings.filter = value;
+			scalingSettings.filter = value;
+		}
+		else if ( option( arg, "samples", value ) )
+		{
+			settings.samples = std::max( 1, std::atoi( value.c_str() ) );
+			scalingSettings.repetitions = settings.samples;
+		}
+		else if ( option( arg, "threads", value ) )
+			scalingSettings.threads = std::max( 1, std::atoi( value.c_str() ) );
+		else if ( option( arg, "min-time", value ) )
+			settings.minSampleTime = std::atof( value.c_str() );
+		else if ( option( arg, "trials", value ) )
+			comparisonSettings.trials = std::max( 1, std::atoi( value.c_str() ) );
+		else if ( option( arg, "replay", value ) )
+			replay = value;
+		else if ( option( arg, "speed", value ) )
+			replaySettings.speed = std::max( 0.0, std::atof( value.c_str() ) );
+		else if ( option( arg, "repeat", value ) )
+			replaySettings.repeat = std::max( 1, std::atoi( value.c_str() ) );
+		else if ( option( arg, "generate", value ) )
+			generate = value;
+		else if ( option( arg, "duration", value ) )
+			duration = std::atof( value.c_str() );
+		else
+		{
+			std::cerr << "usage: " << argv[ 0 ] << " [--format=csv|json] [--output=file] [--filter=substring]"
+				<< " [--samples=n] [--min-time=seconds]\n"
+				<< "       " << argv[ 0 ] << " --replay=session [--speed=factor] [--repeat=n] [--format=csv|json] [--output=file]\n"
+				<< "       " << argv[ 0 ] << " --generate=session [--duration=seconds]\n"
+				<< "       " << argv[ 0 ] << " --compare [--trials=n] [--filter=substring] [--format=csv|json] [--output=file]\n"
+				<< "       " << argv[ 0 ] << " --scaling [--threads=n] [--samples=n] [--filter=substring] [--format=csv|json] [--output=file]\n"
+				<< "       " << argv[ 0 ] << " --footprint [--filter=substring] [--format=csv|json] [--output=file]" << std::endl;
+			return 1;
+		}
+	}
+
+	if ( !generate.empty() )
+	{
+		try
+		{
+			Benchmark::generateSession( generate, duration );
+		}
+		catch ( const Util::Exception& e )
+		{
+			std::cerr << "cannot write " << generate << ": " << e.what() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	if ( format != "csv" && format != "json" )
+	{
+		std::cerr << "unknown output format " << format << std::endl;
+		return 1;
+	}
+
+	std::vector< Benchmark::Result > results;
+	Benchmark::ReplayResult replayResult;
+	std::vector< Benchmark::ComparisonResult > comparison;
+	std::vector< Benchmark::ScalingResult > scaling;
+	std::vector< Benchmark::FootprintResult > footprint;
+	if ( bCompare )
+		comparison = Benchmark::runComparison( comparisonSettings );
+	else if ( bScaling )
+		scaling = Benchmark::runScaling( scalingSettings );
+	else if ( bFootprint )
+		footprint = Benchmark::runFootprint( settings.filter );
+	else if ( !replay.empty() )
+	{
+		try
+		{
+			replayResult = Benchmark::replaySession( replay, replaySettings );
+		}
+		catch ( const Util::Exception& e )
+		{
+			std::cerr << "cannot replay " << replay << ": " << e.what() << std::endl;
+			return 1;
+		}
+	}
+	else
+		results = Benchmark::runBenchmarks( settings );
+
+	std::ofstream file;
+	if ( !output.empty() )
+	{
+		file.open( output.c_str() );
+		if ( !file )
+		{
+			std::cerr << "cannot write " << output << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& os = output.empty() ? std::cout : file;
+
+	if ( bCompare )
+	{
+		if ( format == "json" )
+			Benchmark::writeComparisonJson( os, comparison );
+		else
+			Benchmark::writeComparisonCsv( os, comparison );
+	}
+	else if ( bScaling )
+	{
+		if ( format == "json" )
+			Benchmark::writeScalingJson( os, scaling );
+		else
+			Benchmark::writeScalingCsv( os, scaling );
+	}
+	else if ( bFootprint )
+	{
+		if ( format == "json" )
+			Benchmark::writeFootprintJson( os, footprint );
+		else
+			Benchmark::writeFootprintCsv( os, footprint );
+	}
+	else if ( !replay.empty() )
+	{
+		if ( format == "json" )
+			Benchmark::writeReplayJson( os, replayResult );
+		else
+			Benchmark::writeReplayCsv( os, replayResult );
+	}
+	else if ( format == "json" )
+		Benchmark::writeJson( os, results );
+	else
+		Benchmark::writeCsv( os, results );
+
+	return 0;
+}
@@ -34,8 +34,14 @@
 #include <utUtil/Logging.h>
 #include <utUtil/Exception.h>
 #include <utMath/Graph/Munkres.h>
+#include <utMath/MatrixArena.h>
 #include <utMath/Optimization/LevenbergMarquardt.h>
 #include <utAlgorithm/Function/SinglePointMultiProjection.h>
+#include <utAlgorithm/EpipolarMatching.h>
+#include <utMath/FixedDecomposition.h>
+
+#include <cmath>
+#include <boost/bind.hpp>
 
 namespace ublas = boost::numeric::ublas;
 
@@ -125,7 +131,9 @@ Math::Vector< typename std::iterator_traits< ForwardIterator2 >::value_type::val
 	if( n < 2 )
 		UBITRACK_THROW( "3d point estimation requires at least 2 matrices and 2 image points." );
 
-	Math::Matrix< Type, 0, 0 > A( n * 3, 4 );
+	// the temporaries are taken from the arena
+	Math::MatrixArena::Scope arena;
+	typename Math::ArenaMatrix< Type >::type A( n * 3, 4 );
 	
 	std::size_t i( 0 );
 	for ( ForwardIterator1 it ( iBegin ); it != iEnd; ++i, ++it, ++iPoints )
@@ -142,7 +150,7 @@ Math::Vector< typename std::iterator_traits< ForwardIterator2 >::value_type::val
 
 	Math::Vector< Type, 4 > s;
 	Math::Matrix< Type, 4, 4 > Vt;
-	Math::Matrix< Type, 0, 0 > U( 3*n, 3*n );
+	Math::Matrix< Type, 1, 1 > U; // not referenced for jobu = 'N'
 	if( lapack::gesvd( 'N', 'A', A, s, U, Vt ) != 0 )
 		UBITRACK_THROW ( "SVD for point reconstruction failed." );
 		
@@ -226,9 +234,9 @@ Math::Vector< double, 3 > get3DPositionWithResidual( const std::vector< Math::Ma
 }
 
 
-/** internal of reconstruct3DPoints function */
-template< typename T >
-std::vector< Math::Vector< T, 3 > > reconstruct3DPointsImpl( const std::vector< Math::Vector< T, 2 > > & p1, const std::vector< Math::Vector< T, 2 > > & p2,
+/** internal of reconstruct3DPoints function, works on \c std::vector and \c Math::PointCloud */
+template< typename T, typename Points >
+std::vector< Math::Vector< T, 3 > > reconstruct3DPointsImpl( const Points & p1, const Points & p2,
 																			const Math::Matrix< T, 3, 4 > & P1, const Math::Matrix< T, 3, 4 > & P2, const Math::Matrix< T, 3, 3 > & fM )
 {
 	
@@ -240,9 +248,10 @@ std::vector< Math::Vector< T, 3 > > reconstruct3DPointsImpl( const std::vector<
 
 	for( std::size_t row( 0 ); row < p1Size; ++row )
 	{
+		const Math::Vector< T, 2 > point( p1[ row ] );
 		for( std::size_t col( 0 ); col < p2Size; ++col )
 		{
-			matrix( row, col ) = pointToPointDist( p1.at( row ), p2.at( col ), fM );
+			matrix( row, col ) = pointToPointDist( point, Math::Vector< T, 2 >( p2[ col ] ), fM );
 		}
 	}
 
@@ -250,16 +259,63 @@ std::vector< Math::Vector< T, 3 > > reconstruct3DPointsImpl( const std::vector<
 	m.solve();
 	std::vector< std::size_t > matchList = m.getRowMatchList();
 
-	std::vector< Math::Vector< T, 3 > > list;
-
+	// triangulate all matches in one batch
+	std::vector< std::vector< Math::Vector< T, 2 > > > imagePoints( 2 );
 	for( std::size_t i( 0 ); i < p1Size; ++i )
 	{
 		if( matchList.at( i ) < p2Size )
 		{
-			list.push_back( get3DPosition( P1, P2, p1.at( i ), p2.at( matchList.at( i ) ) ) );
+			imagePoints[ 0 ].push_back( p1[ i ] );
+			imagePoints[ 1 ].push_back( p2[ matchList.at( i ) ] );
 		}
 	}
 
+	std::vector< Math::Matrix< T, 3, 4 > > P( 2 );
+	P[ 0 ] = P1;
+	P[ 1 ] = P2;
+
+	std::vector< Math::Vector< T, 3 > > list;
+	MultiViewTriangulation< T >( P ).triangulate( imagePoints, list );
+	return list;
+}
+
+/** internal of reconstruct3DPoints function with epipolar candidates */
+template< typename T >
+std::vector< Math::Vector< T, 3 > > reconstruct3DPointsImpl( const std::vector< Math::Vector< T, 2 > > & p1, const std::vector< Math::Vector< T, 2 > > & p2,
+	const Math::Matrix< T, 3, 4 > & P1, const Math::Matrix< T, 3, 4 > & P2, const Math::Matrix< T, 3, 3 > & fM, const T maxDistance )
+{
+	std::vector< EpipolarCandidate< T > > candidates;
+	EpipolarMatcher< T >( fM, p2, maxDistance ).match( p1, candidates );
+
+	std::vector< Math::Vector< T, 3 > > list;
+	if( candidates.empty() )
+		return list;
+
+	// only candidates can be assigned
+	std::vector< typename Math::Graph::Munkres< T >::Entry > entries;
+	entries.reserve( candidates.size() );
+	for( std::size_t i( 0 ); i < candidates.size(); ++i )
+		entries.push_back( typename Math::Graph::Munkres< T >::Entry( candidates[ i ].from, candidates[ i ].to, candidates[ i ].distance ) );
+
+	Math::Graph::Munkres< T > m;
+	m.setSparseMatrix( p1.size(), p2.size(), entries );
+	m.solve();
+	std::vector< std::size_t > matchList = m.getRowMatchList();
+
+	std::vector< std::vector< Math::Vector< T, 2 > > > imagePoints( 2 );
+	for( std::size_t i( 0 ); i < p1.size(); ++i )
+	{
+		if( matchList.at( i ) < p2.size() )
+		{
+			imagePoints[ 0 ].push_back( p1.at( i ) );
+			imagePoints[ 1 ].push_back( p2.at( matchList.at( i ) ) );
+		}
+	}
+
+	std::vector< Math::Matrix< T, 3, 4 > > P( 2 );
+	P[ 0 ] = P1;
+	P[ 1 ] = P2;
+	MultiViewTriangulation< T >( P ).triangulate( imagePoints, list );
 	return list;
 }
 
@@ -275,6 +331,273 @@ std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( const std::vector<
 	return reconstruct3DPointsImpl( p1, p2, P1, P2, fM );
 }
 
+std::vector< Math::Vector< float, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< float, 2 > > & p1, const std::vector< Math::Vector< float, 2 > > & p2,
+	const Math::Matrix< float, 3, 4 > & P1, const Math::Matrix< float, 3, 4 > & P2, const Math::Matrix< float, 3, 3 > & fM, float maxDistance )
+{
+	return reconstruct3DPointsImpl( p1, p2, P1, P2, fM, maxDistance );
+}
+
+std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< double, 2 > > & p1, const std::vector< Math::Vector< double, 2 > > & p2,
+	const Math::Matrix< double, 3, 4 > & P1, const Math::Matrix< double, 3, 4 > & P2, const Math::Matrix< double, 3, 3 > & fM, double maxDistance )
+{
+	return reconstruct3DPointsImpl( p1, p2, P1, P2, fM, maxDistance );
+}
+
+Math::PointCloud3f reconstruct3DPoints( const Math::PointCloud2f & p1, const Math::PointCloud2f & p2,
+	const Math::Matrix< float, 3, 4 > & P1, const Math::Matrix< float, 3, 4 > & P2, const Math::Matrix< float, 3, 3 > & fM )
+{
+	return Math::PointCloud3f( reconstruct3DPointsImpl( p1, p2, P1, P2, fM ) );
+}
+
+Math::PointCloud3d reconstruct3DPoints( const Math::PointCloud2d & p1, const Math::PointCloud2d & p2,
+	const Math::Matrix< double, 3, 4 > & P1, const Math::Matrix< double, 3, 4 > & P2, const Math::Matrix< double, 3, 3 > & fM )
+{
+	return Math::PointCloud3d( reconstruct3DPointsImpl( p1, p2, P1, P2, fM ) );
+}
+
 #endif // HAVE_LAPACK
 
+
+template< typename T >
+MultiViewTriangulation< T >::MultiViewTriangulation( const std::vector< Math::Matrix< T, 3, 4 > >& P )
+	: m_cameras( P.size() )
+	, m_center( 0, 0, 0 )
+	, m_scale( 1 )
+{
+	// camera centers C = -M^-1 p4 from the adjugate of the left 3x3 part M
+	std::vector< Math::Vector< double, 3 > > centers;
+	for ( std::size_t c = 0; c < P.size(); c++ )
+	{
+		Camera& cam( m_cameras[ c ] );
+		for ( std::size_t i = 0; i < 3; i++ )
+			for ( std::size_t j = 0; j < 4; j++ )
+				cam.P( i, j ) = P[ c ]( i, j );
+
+		const Math::Matrix< double, 3, 4 >& m( cam.P );
+		Math::Matrix< double, 3, 3 > adj;
+		for ( std::size_t i = 0; i < 3; i++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+			{
+				const std::size_t i1 = ( i + 1 ) % 3, i2 = ( i + 2 ) % 3;
+				const std::size_t j1 = ( j + 1 ) % 3, j2 = ( j + 2 ) % 3;
+				adj( j, i ) = m( i1, j1 ) * m( i2, j2 ) - m( i1, j2 ) * m( i2, j1 );
+			}
+		const double det = m( 0, 0 ) * adj( 0, 0 ) + m( 0, 1 ) * adj( 1, 0 ) + m( 0, 2 ) * adj( 2, 0 );
+		if ( det == 0 )
+			continue;
+
+		Math::Vector< double, 3 > center;
+		for ( std::size_t i = 0; i < 3; i++ )
+			center( i ) = -( adj( i, 0 ) * m( 0, 3 ) + adj( i, 1 ) * m( 1, 3 ) + adj( i, 2 ) * m( 2, 3 ) ) / det;
+		centers.push_back( center );
+	}
+
+	// world normalization X' = ( X - center ) / scale
+	if ( !centers.empty() )
+	{
+		for ( std::size_t c = 0; c < centers.size(); c++ )
+			m_center += centers[ c ];
+		m_center /= static_cast< double >( centers.size() );
+
+		double dist = 0;
+		for ( std::size_t c = 0; c < centers.size(); c++ )
+			dist += ublas::norm_2( centers[ c ] - m_center );
+		dist /= static_cast< double >( centers.size() );
+		if ( dist > 0 )
+			m_scale = dist;
+	}
+
+	for ( std::size_t c = 0; c < m_cameras.size(); c++ )
+	{
+		Camera& cam( m_cameras[ c ] );
+
+		// P' = P [ scale * I, center; 0, 1 ]
+		double a[ 3 ][ 4 ];
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			a[ i ][ 3 ] = cam.P( i, 3 );
+			for ( std::size_t j = 0; j < 3; j++ )
+			{
+				a[ i ][ j ] = m_scale * cam.P( i, j );
+				a[ i ][ 3 ] += cam.P( i, j ) * m_center( j );
+			}
+		}
+
+		// intrinsics from M M^T = K K^T, neglecting the skew
+		double mm[ 3 ][ 3 ];
+		for ( std::size_t i = 0; i < 3; i++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+				mm[ i ][ j ] = cam.P( i, 0 ) * cam.P( j, 0 ) + cam.P( i, 1 ) * cam.P( j, 1 ) + cam.P( i, 2 ) * cam.P( j, 2 );
+		cam.cx = cam.cy = 0;
+		cam.fx = cam.fy = 1;
+		if ( mm[ 2 ][ 2 ] > 0 )
+		{
+			const double cx = mm[ 0 ][ 2 ] / mm[ 2 ][ 2 ];
+			const double cy = mm[ 1 ][ 2 ] / mm[ 2 ][ 2 ];
+			const double fx2 = mm[ 0 ][ 0 ] / mm[ 2 ][ 2 ] - cx * cx;
+			const double fy2 = mm[ 1 ][ 1 ] / mm[ 2 ][ 2 ] - cy * cy;
+			if ( fx2 > 0 && fy2 > 0 )
+			{
+				cam.cx = cx;
+				cam.cy = cy;
+				cam.fx = std::sqrt( fx2 );
+				cam.fy = std::sqrt( fy2 );
+			}
+		}
+
+		// normalized rows, scaled such that the algebraic error is an angular error times the depth
+		const double rowScale = mm[ 2 ][ 2 ] > 0 ? 1 / std::sqrt( mm[ 2 ][ 2 ] ) : 1;
+		double r[ 3 ][ 4 ];
+		for ( std::size_t j = 0; j < 4; j++ )
+		{
+			r[ 0 ][ j ] = rowScale * ( a[ 0 ][ j ] - cam.cx * a[ 2 ][ j ] ) / cam.fx;
+			r[ 1 ][ j ] = rowScale * ( a[ 1 ][ j ] - cam.cy * a[ 2 ][ j ] ) / cam.fy;
+			r[ 2 ][ j ] = rowScale * a[ 2 ][ j ];
+		}
+
+		// rows x r3 - r1 and y r3 - r2 give
+		// ( x^2 + y^2 ) r3 r3^T + r1 r1^T + r2 r2^T - x ( r1 r3^T + r3 r1^T ) - y ( r2 r3^T + r3 r2^T )
+		std::size_t k = 0;
+		for ( std::size_t i = 0; i < 4; i++ )
+			for ( std::size_t j = i; j < 4; j++, k++ )
+			{
+				cam.coeff[ 0 ][ k ] = r[ 2 ][ i ] * r[ 2 ][ j ];
+				cam.coeff[ 1 ][ k ] = r[ 0 ][ i ] * r[ 0 ][ j ] + r[ 1 ][ i ] * r[ 1 ][ j ];
+				cam.coeff[ 2 ][ k ] = r[ 0 ][ i ] * r[ 2 ][ j ] + r[ 2 ][ i ] * r[ 0 ][ j ];
+				cam.coeff[ 3 ][ k ] = r[ 1 ][ i ] * r[ 2 ][ j ] + r[ 2 ][ i ] * r[ 1 ][ j ];
+			}
+	}
+}
+
+
+template< typename T >
+void MultiViewTriangulation< T >::triangulate( const std::vector< Observation >& observations, const std::vector< std::size_t >& offsets,
+	std::vector< Math::Vector< T, 3 > >& points, std::vector< Math::Matrix< T, 3, 3 > >* pCovariances,
+	T imageNoise, const Math::ListExecutor& executor ) const
+{
+	if ( offsets.empty() || offsets.back() != observations.size() )
+		UBITRACK_THROW( "Observation offsets do not match the number of observations" );
+	for ( std::size_t i = 0; i + 1 < offsets.size(); i++ )
+		if ( offsets[ i + 1 ] < offsets[ i ] + 2 )
+			UBITRACK_THROW( "3d point estimation requires at least 2 observations per point" );
+	for ( std::size_t i = 0; i < observations.size(); i++ )
+		if ( observations[ i ].camera >= m_cameras.size() )
+			UBITRACK_THROW( "Observation refers to an unknown camera" );
+
+	const std::size_t nPoints = offsets.size() - 1;
+	points.resize( nPoints );
+	if ( pCovariances )
+		pCovariances->resize( nPoints );
+	if ( nPoints == 0 )
+		return;
+
+	const boost::function< void ( std::size_t, std::size_t ) > task( boost::bind( &MultiViewTriangulation< T >::triangulateRange,
+		this, &observations[ 0 ], &offsets[ 0 ], &points[ 0 ], pCovariances ? &( *pCovariances )[ 0 ] : 0,
+		double( imageNoise ) * imageNoise, _1, _2 ) );
+	if ( executor.empty() )
+		task( 0, nPoints );
+	else
+		executor( nPoints, task );
+}
+
+
+template< typename T >
+void MultiViewTriangulation< T >::triangulate( const std::vector< std::vector< Math::Vector< T, 2 > > >& imagePoints,
+	std::vector< Math::Vector< T, 3 > >& points, std::vector< Math::Matrix< T, 3, 3 > >* pCovariances,
+	T imageNoise, const Math::ListExecutor& executor ) const
+{
+	if ( imagePoints.size() != m_cameras.size() )
+		UBITRACK_THROW( "no equal amount of cameras and point lists." );
+	const std::size_t nPoints = imagePoints.empty() ? 0 : imagePoints[ 0 ].size();
+	for ( std::size_t c = 1; c < imagePoints.size(); c++ )
+		if ( imagePoints[ c ].size() != nPoints )
+			UBITRACK_THROW( "point lists of the cameras differ in size." );
+
+	std::vector< Observation > observations;
+	observations.reserve( nPoints * imagePoints.size() );
+	std::vector< std::size_t > offsets;
+	offsets.reserve( nPoints + 1 );
+	for ( std::size_t i = 0; i < nPoints; i++ )
+	{
+		offsets.push_back( observations.size() );
+		for ( std::size_t c = 0; c < imagePoints.size(); c++ )
+			observations.push_back( Observation( c, imagePoints[ c ][ i ] ) );
+	}
+	offsets.push_back( observations.size() );
+
+	triangulate( observations, offsets, points, pCovariances, imageNoise, executor );
+}
+
+
+template< typename T >
+void MultiViewTriangulation< T >::triangulateRange( const Observation* observations, const std::size_t* offsets,
+	Math::Vector< T, 3 >* points, Math::Matrix< T, 3, 3 >* covariances, const double noiseVariance,
+	const std::size_t begin, const std::size_t end ) const
+{
+	for ( std::size_t p = begin; p < end; p++ )
+	{
+		const Observation* pObsBegin = observations + offsets[ p ];
+		const Observation* pObsEnd = observations + offsets[ p + 1 ];
+
+		// weighted sum of the camera coefficients
+		double ata[ 10 ] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+		for ( const Observation* pObs = pObsBegin; pObs != pObsEnd; ++pObs )
+		{
+			const Camera& cam( m_cameras[ pObs->camera ] );
+			const double x = ( pObs->point( 0 ) - cam.cx ) / cam.fx;
+			const double y = ( pObs->point( 1 ) - cam.cy ) / cam.fy;
+			const double xy2 = x * x + y * y;
+			for ( std::size_t k = 0; k < 10; k++ )
+				ata[ k ] += xy2 * cam.coeff[ 0 ][ k ] + cam.coeff[ 1 ][ k ] - x * cam.coeff[ 2 ][ k ] - y * cam.coeff[ 3 ][ k ];
+		}
+
+		Math::Matrix< double, 4, 4 > a;
+		std::size_t k = 0;
+		for ( std::size_t i = 0; i < 4; i++ )
+			for ( std::size_t j = i; j < 4; j++, k++ )
+				a( i, j ) = ata[ k ];
+		Math::Vector< double, 4 > w;
+		Math::symmetricEigen( a, w );
+
+		Math::Vector< double, 3 > x;
+		for ( std::size_t i = 0; i < 3; i++ )
+			x( i ) = m_scale * a( i, 0 ) / a( 3, 0 ) + m_center( i );
+		points[ p ] = x;
+
+		if ( !covariances )
+			continue;
+
+		// inverse of the gauss-newton approximation of the reprojection error hessian
+		Math::Matrix< double, 3, 3 > jtj( Math::Matrix< double, 3, 3 >::zeros() );
+		for ( const Observation* pObs = pObsBegin; pObs != pObsEnd; ++pObs )
+		{
+			const Math::Matrix< double, 3, 4 >& P( m_cameras[ pObs->camera ].P );
+			double h[ 3 ];
+			for ( std::size_t i = 0; i < 3; i++ )
+				h[ i ] = P( i, 0 ) * x( 0 ) + P( i, 1 ) * x( 1 ) + P( i, 2 ) * x( 2 ) + P( i, 3 );
+			double j[ 2 ][ 3 ];
+			for ( std::size_t r = 0; r < 2; r++ )
+				for ( std::size_t c = 0; c < 3; c++ )
+					j[ r ][ c ] = ( P( r, c ) - h[ r ] / h[ 2 ] * P( 2, c ) ) / h[ 2 ];
+			for ( std::size_t r = 0; r < 3; r++ )
+				for ( std::size_t c = 0; c <= r; c++ )
+					jtj( r, c ) += j[ 0 ][ r ] * j[ 0 ][ c ] + j[ 1 ][ r ] * j[ 1 ][ c ];
+		}
+
+		Math::Matrix< T, 3, 3 >& cov( covariances[ p ] );
+		if ( Math::choleskyInvert( jtj ) )
+		{
+			for ( std::size_t r = 0; r < 3; r++ )
+				for ( std::size_t c = 0; c < 3; c++ )
+					cov( r, c ) = static_cast< T >( noiseVariance * jtj( r, c ) );
+		}
+		else
+			cov = Math::Matrix< T, 3, 3 >::zeros();
+	}
+}
+
+// explicit instantiations
+template class MultiViewTriangulation< float >;
+template class MultiViewTriangulation< double >;
+
 } } // namespace Ubitrack::Algorithm
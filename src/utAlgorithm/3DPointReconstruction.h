@@ -34,9 +34,13 @@
 #define __UBITRACK_CALIBRATION_3DPOINTRECONSTRUCTION_H_INCLUDED__
 
 
+#include <vector>
+
 #include <utCore.h>
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
+#include <utMath/PointCloud.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
 
 namespace Ubitrack { namespace Algorithm {
 
@@ -102,6 +106,42 @@ UBITRACK_EXPORT std::vector< Math::Vector< float, 3 > > reconstruct3DPoints( con
 UBITRACK_EXPORT std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< double, 2 > > & p1, const std::vector< Math::Vector< double, 2 > > & p2,
 																			const Math::Matrix< double, 3, 4 > & P1, const Math::Matrix< double, 3, 4 > & P2, const Math::Matrix< double, 3, 3 > & fM );
 
+/**
+ * @ingroup tracking_algorithms
+ * Reconstructs 3D points from two sets of 2D points, matching only points within \c maxDistance
+ * pixels of each other's epipolar line
+ *
+ * Instead of computing \c pointToPointDist for every pair of points, the candidates are found by an
+ * \c EpipolarMatcher. Points without a candidate are not reconstructed.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param p1 a vector of 2D points from the first camera
+ * @param p2 a vector of 2D points from the second camera
+ * @param P1 the projection matrix of the first camera
+ * @param P2 the projection matrix of the second camera
+ * @param fM the fundamental matrix, mapping points of the first to lines in the second camera
+ * @param maxDistance maximum distance of a point in the second camera to the epipolar line of its match
+ * @return a vector of 3D points
+ */
+UBITRACK_EXPORT std::vector< Math::Vector< float, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< float, 2 > > & p1, const std::vector< Math::Vector< float, 2 > > & p2,
+	const Math::Matrix< float, 3, 4 > & P1, const Math::Matrix< float, 3, 4 > & P2, const Math::Matrix< float, 3, 3 > & fM, float maxDistance );
+
+UBITRACK_EXPORT std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( const std::vector< Math::Vector< double, 2 > > & p1, const std::vector< Math::Vector< double, 2 > > & p2,
+	const Math::Matrix< double, 3, 4 > & P1, const Math::Matrix< double, 3, 4 > & P2, const Math::Matrix< double, 3, 3 > & fM, double maxDistance );
+
+/**
+ * @ingroup tracking_algorithms
+ * Reconstructs 3D points from two clouds of 2D points, see the \c std::vector version above
+ *
+ * Note: also exists with \c double parameters.
+ */
+UBITRACK_EXPORT Math::PointCloud3f reconstruct3DPoints( const Math::PointCloud2f & p1, const Math::PointCloud2f & p2,
+	const Math::Matrix< float, 3, 4 > & P1, const Math::Matrix< float, 3, 4 > & P2, const Math::Matrix< float, 3, 3 > & fM );
+
+UBITRACK_EXPORT Math::PointCloud3d reconstruct3DPoints( const Math::PointCloud2d & p1, const Math::PointCloud2d & p2,
+	const Math::Matrix< double, 3, 4 > & P1, const Math::Matrix< double, 3, 4 > & P2, const Math::Matrix< double, 3, 3 > & fM );
+
 
 /**
  * @ingroup tracking_algorithms
@@ -116,6 +156,8 @@ UBITRACK_EXPORT std::vector< Math::Vector< double, 3 > > reconstruct3DPoints( co
  * @param falg to indicate minimization
  * flag == 0: algebraic(fast), flag == 1: non-linear (accurate)
  * @return a 3D points
+ *
+ * To reconstruct many points seen by the same cameras, use \c MultiViewTriangulation.
  */
 
 UBITRACK_EXPORT Math::Vector< float, 3 > get3DPosition( const std::vector< Math::Matrix< float, 3, 4 > > &P, const std::vector< Math::Vector< float, 2 > > &points, std::size_t flag );
@@ -125,6 +167,118 @@ UBITRACK_EXPORT Math::Vector< double, 3 > get3DPosition( const std::vector< Math
 UBITRACK_EXPORT Math::Vector< double, 3 > get3DPositionWithResidual( const std::vector< Math::Matrix< double, 3, 4 > > &P, const std::vector< Math::Vector< double, 2 > >& points, std::size_t flag = 0, double* residual = 0 );
 #endif
 
+
+/**
+ * @ingroup tracking_algorithms
+ * Triangulates many points seen by a fixed set of calibrated cameras, e.g. the blobs of an
+ * outside-in tracking system.
+ *
+ * The algebraic error of a point, which \c get3DPosition minimizes by a SVD of the stacked DLT
+ * equations, is a quadratic form whose 4x4 matrix depends on the image position \c (x,y) of
+ * each observation only through the factors \c x, \c y and <tt>x^2 + y^2</tt>. The constructor
+ * precomputes the coefficient matrices of every camera, so a point costs one weighted sum per
+ * observation and a 4x4 symmetric eigen decomposition of fixed size, without any allocation.
+ * World and image coordinates are normalized internally, using the camera centers and the
+ * intrinsics contained in the projection matrices, to keep the normal equations well conditioned.
+ *
+ * Points are independent of each other and can be distributed over threads by a
+ * \c Math::ListExecutor. Optionally, the covariance of each point is computed from the
+ * jacobian of its reprojections, assuming isotropic image noise.
+ *
+ * The computation is done in double precision, also for \c float.
+ */
+template< typename T >
+class UBITRACK_EXPORT MultiViewTriangulation
+{
+public:
+	/** one image observation of a point */
+	struct Observation
+	{
+		Observation()
+		{}
+
+		Observation( std::size_t c, const Math::Vector< T, 2 >& p )
+			: camera( c )
+			, point( p )
+		{}
+
+		/** index of the camera in the list given to the constructor */
+		std::size_t camera;
+
+		/** position in the image of the camera */
+		Math::Vector< T, 2 > point;
+	};
+
+	/**
+	 * Precomputes the contributions of the cameras.
+	 * @param P projection matrices of the cameras, mapping world to image coordinates
+	 */
+	explicit MultiViewTriangulation( const std::vector< Math::Matrix< T, 3, 4 > >& P );
+
+	/** returns the number of cameras */
+	std::size_t cameraCount() const
+	{ return m_cameras.size(); }
+
+	/**
+	 * Triangulates points with individual sets of observations.
+	 * Throws if a point has less than two observations or a camera index is out of range.
+	 *
+	 * @param observations observations of all points, ordered by point
+	 * @param offsets the observations of point \c i are <tt>observations[ offsets[ i ] ]</tt> up to
+	 *   <tt>observations[ offsets[ i + 1 ] - 1 ]</tt>, so there is one more offset than points
+	 * @param points the triangulated points
+	 * @param pCovariances if given, receives the 3x3 covariance of every point, zero if the point
+	 *   is not determined
+	 * @param imageNoise standard deviation of the image measurements in pixels, used for the covariances
+	 * @param executor distributes the points over threads, see \c Math::threadExecutor
+	 */
+	void triangulate( const std::vector< Observation >& observations, const std::vector< std::size_t >& offsets,
+		std::vector< Math::Vector< T, 3 > >& points, std::vector< Math::Matrix< T, 3, 3 > >* pCovariances = 0,
+		T imageNoise = 1, const Math::ListExecutor& executor = Math::ListExecutor() ) const;
+
+	/**
+	 * Triangulates points that are seen by all cameras.
+	 *
+	 * @param imagePoints one list per camera, <tt>imagePoints[ c ][ i ]</tt> is the observation
+	 *   of point \c i in camera \c c. All lists must have the same size.
+	 * @param points the triangulated points
+	 * @param pCovariances if given, receives the covariances of the points
+	 * @param imageNoise standard deviation of the image measurements in pixels
+	 * @param executor distributes the points over threads
+	 */
+	void triangulate( const std::vector< std::vector< Math::Vector< T, 2 > > >& imagePoints,
+		std::vector< Math::Vector< T, 3 > >& points, std::vector< Math::Matrix< T, 3, 3 > >* pCovariances = 0,
+		T imageNoise = 1, const Math::ListExecutor& executor = Math::ListExecutor() ) const;
+
+protected:
+	/** triangulates the points [ begin, end ) */
+	void triangulateRange( const Observation* observations, const std::size_t* offsets, Math::Vector< T, 3 >* points,
+		Math::Matrix< T, 3, 3 >* covariances, double noiseVariance, std::size_t begin, std::size_t end ) const;
+
+	/** precomputed data of a camera */
+	struct Camera
+	{
+		/** projection matrix in pixels, used for the covariance */
+		Math::Matrix< double, 3, 4 > P;
+
+		/** image normalization: principal point and focal lengths */
+		double cx, cy, fx, fy;
+
+		/**
+		 * upper triangles of the 4x4 coefficient matrices of the normalized rows a1, a2, a3:
+		 * a3 a3^T, a1 a1^T + a2 a2^T, a1 a3^T + a3 a1^T and a2 a3^T + a3 a2^T
+		 */
+		double coeff[ 4 ][ 10 ];
+	};
+
+	/** cameras */
+	std::vector< Camera > m_cameras;
+
+	/** world normalization: centroid of the camera centers and scale */
+	Math::Vector< double, 3 > m_center;
+	double m_scale;
+};
+
 } } // namespace Ubitrack::Algorithm
 
 #endif
@@ -0,0 +1,119 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Asynchronous versions of long-running calibrations
+ */
+
+#include "AsyncCalibration.h"
+
+#include <iterator>
+
+#include <boost/bind.hpp>
+
+#include <utMath/PoseListOperations.h>
+#include <utMath/Stochastic/k_means.h>
+#include "PoseEstimation6D6D/TsaiLenz.h"
+#include "ToolTip/TipCalibration.h"
+
+namespace Ubitrack { namespace Algorithm {
+
+namespace {
+
+#ifdef HAVE_LAPACK
+
+SimpleBundleAdjustmentResult runSimpleBundleAdjustment( const std::vector< std::vector< Math::Vector2d > >& pts2D,
+	SimpleBundleAdjustmentResult result, const BundleAdjustmentSolver solver )
+{
+	simpleBundleAdjustment( pts2D, result.cameras, result.points, solver );
+	return result;
+}
+
+Math::Pose runHandEyeCalibration( const std::vector< Math::Pose >& hand, const std::vector< Math::Pose >& eye,
+	const bool bUseAllPairs, Util::Executor* pExecutor )
+{
+	return PoseEstimation6D6D::performHandEyeCalibration( hand, eye, bUseAllPairs, Math::poolExecutor( *pExecutor, 16 ) );
+}
+
+#endif // HAVE_LAPACK
+
+TipCalibrationResult runTipCalibration( const std::vector< Math::Pose >& poses )
+{
+	TipCalibrationResult result;
+	result.valid = ToolTip::estimatePosition3D_6D( result.pw, poses, result.pm );
+	return result;
+}
+
+KMeansResult runKMeans( const std::vector< Math::Vector3d >& points, const std::size_t nClusters )
+{
+	if ( nClusters == 0 || nClusters >= points.size() )
+		UBITRACK_THROW( "k-means needs more points than clusters" );
+
+	KMeansResult result;
+	Math::Stochastic::k_means( points.begin(), points.end(), nClusters,
+		std::back_inserter( result.centroids ), std::back_inserter( result.indices ) );
+	return result;
+}
+
+} // anonymous namespace
+
+
+#ifdef HAVE_LAPACK
+
+Util::Future< SimpleBundleAdjustmentResult > simpleBundleAdjustmentAsync(
+	const std::vector< std::vector< Math::Vector2d > >& pts2D, const std::vector< Math::Pose >& camPoses,
+	const std::vector< Math::Vector3d >& pts3D, const BundleAdjustmentSolver solver,
+	const Util::CancellationToken& token, const Util::ProgressCallback& progress, Util::Executor& executor )
+{
+	SimpleBundleAdjustmentResult initial;
+	initial.cameras = camPoses;
+	initial.points = pts3D;
+	return Util::async< SimpleBundleAdjustmentResult >( boost::bind( &runSimpleBundleAdjustment, pts2D, initial, solver ),
+		token, progress, executor );
+}
+
+Util::Future< Math::Pose > performHandEyeCalibrationAsync(
+	const std::vector< Math::Pose >& hand, const std::vector< Math::Pose >& eye, const bool bUseAllPairs,
+	const Util::CancellationToken& token, const Util::ProgressCallback& progress, Util::Executor& executor )
+{
+	return Util::async< Math::Pose >( boost::bind( &runHandEyeCalibration, hand, eye, bUseAllPairs, &executor ),
+		token, progress, executor );
+}
+
+#endif // HAVE_LAPACK
+
+Util::Future< TipCalibrationResult > tipCalibrationAsync( const std::vector< Math::Pose >& poses,
+	const Util::CancellationToken& token, const Util::ProgressCallback& progress, Util::Executor& executor )
+{
+	return Util::async< TipCalibrationResult >( boost::bind( &runTipCalibration, poses ), token, progress, executor );
+}
+
+Util::Future< KMeansResult > kMeansAsync( const std::vector< Math::Vector3d >& points, const std::size_t nClusters,
+	const Util::CancellationToken& token, const Util::ProgressCallback& progress, Util::Executor& executor )
+{
+	return Util::async< KMeansResult >( boost::bind( &runKMeans, points, nClusters ), token, progress, executor );
+}
+
+} } // namespace Ubitrack::Algorithm
@@ -0,0 +1,134 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Asynchronous versions of long-running calibrations
+ *
+ * Each function copies its input, queues the calibration on an \c Util::Executor and returns a
+ * \c Util::Future for the result. The iterations of the optimizers, RANSAC and k-means loops
+ * are reported to the progress callback, and the calibration stops with
+ * \c Util::OperationCancelled at the next iteration after the token was cancelled:
+ * @code
+ * Util::CancellationToken token;
+ * Util::Future< Math::Pose > handEye( Algorithm::performHandEyeCalibrationAsync( hands, eyes, true, token ) );
+ * ...
+ * token.cancel(); // e.g. from the cancel button of the calibration dialog
+ * @endcode
+ */
+
+#ifndef __UBITRACK_ALGORITHM_ASYNCCALIBRATION_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_ASYNCCALIBRATION_H_INCLUDED__
+
+#include <vector>
+
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Pose.h>
+#include <utUtil/Async.h>
+
+#include "BundleAdjustment.h"
+
+namespace Ubitrack { namespace Algorithm {
+
+/** @ingroup tracking_algorithms result of \c simpleBundleAdjustmentAsync */
+struct SimpleBundleAdjustmentResult
+{
+	/** the optimized camera poses */
+	std::vector< Math::Pose > cameras;
+
+	/** the optimized 3D points */
+	std::vector< Math::Vector3d > points;
+};
+
+/** @ingroup tracking_algorithms result of \c tipCalibrationAsync */
+struct TipCalibrationResult
+{
+	TipCalibrationResult()
+		: valid( false )
+	{}
+
+	/** the tip in body coordinates */
+	Math::Vector3d pm;
+
+	/** the tip in world coordinates */
+	Math::Vector3d pw;
+
+	/** false if the poses did not determine the tip */
+	bool valid;
+};
+
+/** @ingroup tracking_algorithms result of \c kMeansAsync */
+struct KMeansResult
+{
+	/** the centroids of the clusters */
+	std::vector< Math::Vector3d > centroids;
+
+	/** index of the cluster of each point */
+	std::vector< std::size_t > indices;
+};
+
+#ifdef HAVE_LAPACK
+
+/**
+ * @ingroup tracking_algorithms
+ * \c simpleBundleAdjustment on an executor, starting from \c camPoses and \c pts3D
+ */
+UBITRACK_EXPORT Util::Future< SimpleBundleAdjustmentResult > simpleBundleAdjustmentAsync(
+	const std::vector< std::vector< Math::Vector2d > >& pts2D, const std::vector< Math::Pose >& camPoses,
+	const std::vector< Math::Vector3d >& pts3D, const BundleAdjustmentSolver solver = baSparseSchurSolver,
+	const Util::CancellationToken& token = Util::CancellationToken(), const Util::ProgressCallback& progress = Util::ProgressCallback(),
+	Util::Executor& executor = Util::Executor::instance() );
+
+/**
+ * @ingroup tracking_algorithms
+ * \c PoseEstimation6D6D::performHandEyeCalibration on an executor, the pairs are distributed over
+ * the same executor
+ */
+UBITRACK_EXPORT Util::Future< Math::Pose > performHandEyeCalibrationAsync(
+	const std::vector< Math::Pose >& hand, const std::vector< Math::Pose >& eye, const bool bUseAllPairs = true,
+	const Util::CancellationToken& token = Util::CancellationToken(), const Util::ProgressCallback& progress = Util::ProgressCallback(),
+	Util::Executor& executor = Util::Executor::instance() );
+
+#endif // HAVE_LAPACK
+
+/**
+ * @ingroup tracking_algorithms
+ * \c ToolTip::estimatePosition3D_6D on an executor
+ */
+UBITRACK_EXPORT Util::Future< TipCalibrationResult > tipCalibrationAsync( const std::vector< Math::Pose >& poses,
+	const Util::CancellationToken& token = Util::CancellationToken(), const Util::ProgressCallback& progress = Util::ProgressCallback(),
+	Util::Executor& executor = Util::Executor::instance() );
+
+/**
+ * @ingroup tracking_algorithms
+ * \c Math::Stochastic::k_means with \c nClusters clusters on an executor
+ */
+UBITRACK_EXPORT Util::Future< KMeansResult > kMeansAsync( const std::vector< Math::Vector3d >& points, const std::size_t nClusters,
+	const Util::CancellationToken& token = Util::CancellationToken(), const Util::ProgressCallback& progress = Util::ProgressCallback(),
+	Util::Executor& executor = Util::Executor::instance() );
+
+} } // namespace Ubitrack::Algorithm
+
+#endif
@@ -40,18 +40,22 @@
 #include <functional> // std::mem_fun_ref
 
 #include <utMath/Vector.h>
+#include <utMath/LapackBackend.h>
 #include <utUtil/Exception.h>
 
 #ifdef HAVE_LAPACK
 //#define OPTIMIZATION_LOGGING // use define before optimization functions
 #include <utMath/Optimization/LevenbergMarquardt.h>
+#include <utMath/Optimization/SchurLevenbergMarquardt.h>
+#include <utMath/Gpu/Backend.h>
+#include <boost/scoped_ptr.hpp>
 #endif
 
 
 // get a logger
-#include <log4cpp/Category.hh>
-static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Calibration.BundleAdjustment" ) );
-static log4cpp::Category& optLogger( log4cpp::Category::getInstance( "Ubitrack.Calibration.BundleAdjustment.LM" ) );
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Calibration.BundleAdjustment" );
+static Ubitrack::Util::LazyLogger optLogger( "Ubitrack.Calibration.BundleAdjustment.LM" );
 
 
 namespace Ubitrack { namespace Algorithm {
@@ -60,6 +64,111 @@ namespace Ubitrack { namespace Algorithm {
 #ifdef HAVE_LAPACK
 
 
+/**
+ * computes the projection of a single 3D point into the (normalized) image plane of a camera
+ * together with the jacobians wrt. the camera parameters and the point coordinates.
+ *
+ * @param camera the camera parameters (quaternion x, y, z, w followed by the translation)
+ * @param point the 3D point
+ * @param result 2-vector to store the projected point in
+ * @param jCamera 2x7 matrix to store the jacobian wrt. the camera parameters in
+ * @param jPoint 2x3 matrix to store the jacobian wrt. the point coordinates in
+ */
+template< class VType, class VT1, class VT2, class VT3, class MT1, class MT2 >
+void reprojectPointWithJacobian( const VT1& camera, const VT2& point, VT3& result, MT1& jCamera, MT2& jPoint )
+{
+	const VType qx = camera( 0 );
+	const VType qy = camera( 1 );
+	const VType qz = camera( 2 );
+	const VType qw = camera( 3 );
+	const VType tx = camera( 4 );
+	const VType ty = camera( 5 );
+	const VType tz = camera( 6 );
+	
+	const Math::Pose pose( Math::Quaternion( qx, qy, qz, qw ), Math::Vector< VType, 3 >( tx, ty, tz ) );
+	
+	const VType x = point( 0 );
+	const VType y = point( 1 );
+	const VType z = point( 2 );
+	
+	Math::Vector< VType, 3 > pts ( x, y, z );
+	pts = pose * pts;
+	result( 0 ) = pts( 0 ) / pts( 2 );
+	result( 1 ) = pts( 1 ) / pts( 2 );
+	
+	const VType t2 = qw*qw;
+	const VType t3 = qx*qx;
+	const VType t4 = qy*qy;
+	const VType t5 = qz*qz;
+	const VType t6 = qw*qy*2;
+	const VType t7 = t2-t3-t4+t5;
+	const VType t8 = t7*z;
+	const VType t9 = qx*qz*2;
+	const VType t10 = qw*qx*2;
+	const VType t11 = qy*qz*2;
+	const VType t12 = t10+t11;
+	const VType t13 = t12*y;
+	const VType t14 = t6-t9;
+	const VType t23 = t14*x;
+	const VType t15 = t8+t13-t23+tz;
+	const VType t16 = t2+t3-t4-t5;
+	const VType t17 = t16*x;
+	const VType t18 = qw*qz*2;
+	const VType t33 = qx*qy*2;
+	const VType t19 = t18-t33;
+	const VType t20 = t6+t9;
+	const VType t21 = t20*z;
+	const VType t34 = t19*y;
+	const VType t22 = t17+t21-t34+tx;
+	const VType t24 = 1/(t15*t15);
+	const VType t25 = qz*x*2;
+	const VType t26 = qw*y*2;
+	const VType t43 = qx*z*2;
+	const VType t27 = t25+t26-t43;
+	const VType t28 = 1/t15;
+	const VType t29 = qx*x*2;
+	const VType t30 = qy*y*2;
+	const VType t31 = qz*z*2;
+	const VType t32 = t29+t30+t31;
+	const VType t35 = qw*x*2;
+	const VType t36 = qy*z*2;
+	const VType t44 = qz*y*2;
+	const VType t37 = t35+t36-t44;
+	const VType t38 = qx*y*2;
+	const VType t39 = qw*z*2;
+	const VType t41 = qy*x*2;
+	const VType t40 = t38+t39-t41;
+	const VType t42 = t28*t40;
+	const VType t45 = t2-t3+t4-t5;
+	const VType t46 = t45*y;
+	const VType t47 = t18+t33;
+	const VType t48 = t47*x;
+	const VType t49 = t10-t11;
+	const VType t52 = t49*z;
+	const VType t50 = t46+t48-t52+ty;
+	const VType t51 = t28*t37;
+	jCamera( 0, 0 ) = t32/(t8+t13+tz-x*(t6-qx*qz*2))-t22*t24*t27;
+	jCamera( 0, 1 ) = t42+t22*t24*t37;
+	jCamera( 0, 2 ) = -t27*t28-t22*t24*t32;
+	jCamera( 0, 3 ) = t51-t22*t24*t40;
+	jCamera( 0, 4 ) = t28;
+	jCamera( 0, 5 ) = 0;
+	jCamera( 0, 6 ) = -t22*t24;
+	jPoint( 0, 0 ) = t16*t28+t14*t22*t24;
+	jPoint( 0, 1 ) = -t19*t28-t12*t22*t24;
+	jPoint( 0, 2 ) = t20*t28-t7*t22*t24;
+	jCamera( 1, 0 ) = -t42-t24*t27*t50;
+	jCamera( 1, 1 ) = t28*t32+t24*t37*t50;
+	jCamera( 1, 2 ) = t51-t24*t32*t50;
+	jCamera( 1, 3 ) = t27*t28-t24*t40*t50;
+	jCamera( 1, 4 ) = 0;
+	jCamera( 1, 5 ) = t28;
+	jCamera( 1, 6 ) = -t24*t50;
+	jPoint( 1, 0 ) = t28*t47+t14*t24*t50;
+	jPoint( 1, 1 ) = t28*t45-t12*t24*t50;
+	jPoint( 1, 2 ) = -t28*t49-t7*t24*t50;
+}
+
 template< class VType >
 class MinimizeReprojectionErrorAllPoints
 {
@@ -102,7 +211,7 @@ public:
 		
 		LOG4CPP_TRACE( optLogger, "Input vector: \n " << static_cast< Math::Vector< VType > >( input ) << "\n" );
 		
-		J = Math::Matrix< VType >::zeros( J.size1(), J.size2() );
+		J.clear();
 				
 		std::size_t row_index = 0;
 		std::size_t index_cam = 0;
@@ -110,101 +219,23 @@ public:
 		for( std::size_t iter_c( 0 ); iter_c < n_cams; ++iter_c )// für alle cameras
 		{
 			const std::size_t camIndex = iter_c*7;
-			const VType qx = input( camIndex + 0 );
-			const VType qy = input( camIndex + 1 );
-			const VType qz = input( camIndex + 2 );
-			const VType qw = input( camIndex + 3 );
-			const VType tx = input( camIndex + 4 );
-			const VType ty = input( camIndex + 5 );
-			const VType tz = input( camIndex + 6 );
-			
-			const Math::Pose pose( Math::Quaternion( qx, qy, qz, qw ), Math::Vector< VType, 3 >( tx, ty, tz ) );
+			const boost::numeric::ublas::vector_range< const VT2 > camera( input, boost::numeric::ublas::range( camIndex, camIndex + 7 ) );
 
 			for ( std::size_t iter_p( 0 ); iter_p < n_pts3D; ++iter_p, row_index += 2 )
 			{
 				// fetch x, y and z coordinate of 3D point from vector
 				const std::size_t pointIndex = start_index_3d_pts + (iter_p*3);
-				const VType x = input( pointIndex + 0 );
-				const VType y = input( pointIndex + 1 );
-				const VType z = input( pointIndex + 2 );
+				const boost::numeric::ublas::vector_range< const VT2 > point( input, boost::numeric::ublas::range( pointIndex, pointIndex + 3 ) );
 				
-				Math::Vector< VType, 3 > pts ( x, y, z );
-				pts = pose * pts;
-				result( row_index + 0 ) = pts( 0 ) / pts( 2 );
-				result( row_index + 1 ) = pts( 1 ) / pts( 2 );
+				Math::Vector< VType, 2 > projected;
+				Math::Matrix< VType, 2, 7 > jCamera;
+				Math::Matrix< VType, 2, 3 > jPoint;
+				reprojectPointWithJacobian< VType >( camera, point, projected, jCamera, jPoint );
 				
-				const std::size_t jrow0 = row_index;
-				const std::size_t jrow1 = jrow0 + 1;
-				
-				const VType t2 = qw*qw;
-				const VType t3 = qx*qx;
-				const VType t4 = qy*qy;
-				const VType t5 = qz*qz;
-				const VType t6 = qw*qy*2;
-				const VType t7 = t2-t3-t4+t5;
-				const VType t8 = t7*z;
-				const VType t9 = qx*qz*2;
-				const VType t10 = qw*qx*2;
-				const VType t11 = qy*qz*2;
-				const VType t12 = t10+t11;
-				const VType t13 = t12*y;
-				const VType t14 = t6-t9;
-				const VType t23 = t14*x;
-				const VType t15 = t8+t13-t23+tz;
-				const VType t16 = t2+t3-t4-t5;
-				const VType t17 = t16*x;
-				const VType t18 = qw*qz*2;
-				const VType t33 = qx*qy*2;
-				const VType t19 = t18-t33;
-				const VType t20 = t6+t9;
-				const VType t21 = t20*z;
-				const VType t34 = t19*y;
-				const VType t22 = t17+t21-t34+tx;
-				const VType t24 = 1/(t15*t15);
-				const VType t25 = qz*x*2;
-				const VType t26 = qw*y*2;
-				const VType t43 = qx*z*2;
-				const VType t27 = t25+t26-t43;
-				const VType t28 = 1/t15;
-				const VType t29 = qx*x*2;
-				const VType t30 = qy*y*2;
-				const VType t31 = qz*z*2;
-				const VType t32 = t29+t30+t31;
-				const VType t35 = qw*x*2;
-				const VType t36 = qy*z*2;
-				const VType t44 = qz*y*2;
-				const VType t37 = t35+t36-t44;
-				const VType t38 = qx*y*2;
-				const VType t39 = qw*z*2;
-				const VType t41 = qy*x*2;
-				const VType t40 = t38+t39-t41;
-				const VType t42 = t28*t40;
-				const VType t45 = t2-t3+t4-t5;
-				const VType t46 = t45*y;
-				const VType t47 = t18+t33;
-				const VType t48 = t47*x;
-				const VType t49 = t10-t11;
-				const VType t52 = t49*z;
-				const VType t50 = t46+t48-t52+ty;
-				const VType t51 = t28*t37;
-				J( jrow0, camIndex + 0 ) = t32/(t8+t13+tz-x*(t6-qx*qz*2))-t22*t24*t27;
-				J( jrow0, camIndex + 1 ) = t42+t22*t24*t37;
-				J( jrow0, camIndex + 2 ) = -t27*t28-t22*t24*t32;
-				J( jrow0, camIndex + 3 ) = t51-t22*t24*t40;
-				J( jrow0, camIndex + 4 ) = t28;
-				J( jrow0, camIndex + 6 ) = -t22*t24;
-				J( jrow0,  pointIndex + 0 ) = t16*t28+t14*t22*t24;
-				J( jrow0,  pointIndex + 1 ) = -t19*t28-t12*t22*t24;
-				J( jrow0,  pointIndex + 2 ) = t20*t28-t7*t22*t24;
-				J( jrow1, camIndex + 0 ) = -t42-t24*t27*t50;
-				J( jrow1, camIndex + 1 ) = t28*t32+t24*t37*t50;
-				J( jrow1, camIndex + 2 ) = t51-t24*t32*t50;
-				J( jrow1, camIndex + 3 ) = t27*t28-t24*t40*t50;
-				J( jrow1, camIndex + 5 ) = t28;
-				J( jrow1, camIndex + 6 ) = -t24*t50;
-				J( jrow1,  pointIndex + 0 ) = t28*t47+t14*t24*t50;
-				J( jrow1,  pointIndex + 1 ) = t28*t45-t12*t24*t50;
-				J( jrow1,  pointIndex + 2 ) = -t28*t49-t7*t24*t50;
+				result( row_index + 0 ) = projected( 0 );
+				result( row_index + 1 ) = projected( 1 );
+				ublas::subrange( J, row_index, row_index + 2, camIndex, camIndex + 7 ) = jCamera;
+				ublas::subrange( J, row_index, row_index + 2, pointIndex, pointIndex + 3 ) = jPoint;
 			}
 		}
 		
@@ -213,6 +244,182 @@ public:
 	}
 };
 
+/**
+ * Block-sparse formulation of \c MinimizeReprojectionErrorAllPoints for the
+ * \c schurLevenbergMarquardt optimizer, which only stores the 2x7 camera
+ * and 2x3 point blocks of the jacobian.
+ */
+template< class VType >
+class MinimizeReprojectionErrorBlocks
+{
+protected:
+	const std::size_t n_cams;
+	const std::size_t n_pts3D;
+	
+	/** camera index of each observation */
+	std::vector< std::size_t > m_observationCamera;
+	
+	/** point index of each observation */
+	std::vector< std::size_t > m_observationPoint;
+
+public:
+	enum { measurementBlockSize = 2, cameraBlockSize = 7, pointBlockSize = 3 };
+
+	/**
+	 * @param cams number of cameras
+	 * @param points number of 3D points
+	 * @param pointCount number of observations for each camera, the i-th observation of a camera belongs to the i-th point
+	 */
+	MinimizeReprojectionErrorBlocks(
+		  const std::size_t cams
+		, const std::size_t points
+		, const std::vector< std::size_t >& pointCount
+		)
+		: n_cams ( cams )
+		, n_pts3D ( points )
+	{
+		for ( std::size_t iter_c( 0 ); iter_c < n_cams; ++iter_c )
+			for ( std::size_t iter_p( 0 ); iter_p < pointCount[ iter_c ]; ++iter_p )
+			{
+				m_observationCamera.push_back( iter_c );
+				m_observationPoint.push_back( iter_p );
+			}
+	}
+
+	/**
+	 * @param cams number of cameras
+	 * @param points number of 3D points
+	 * @param observationCamera camera index of each observation
+	 * @param observationPoint point index of each observation
+	 */
+	MinimizeReprojectionErrorBlocks(
+		  const std::size_t cams
+		, const std::size_t points
+		, const std::vector< std::size_t >& observationCamera
+		, const std::vector< std::size_t >& observationPoint
+		)
+		: n_cams ( cams )
+		, n_pts3D ( points )
+		, m_observationCamera( observationCamera )
+		, m_observationPoint( observationPoint )
+	{}
+
+	std::size_t cameraCount() const
+	{ return n_cams; }
+
+	std::size_t pointCount() const
+	{ return n_pts3D; }
+
+	std::size_t observationCount() const
+	{ return m_observationCamera.size(); }
+
+	std::size_t observationCamera( const std::size_t i ) const
+	{ return m_observationCamera[ i ]; }
+
+	std::size_t observationPoint( const std::size_t i ) const
+	{ return m_observationPoint[ i ]; }
+
+	/**
+	 * @param i index of the observation
+	 * @param result vector to store the predicted 2D observation in
+	 * @param camera the camera parameters (quaternion and translation as 7-vector)
+	 * @param point the 3D point
+	 * @param jCamera 2x7 matrix to store the jacobian wrt. the camera parameters in
+	 * @param jPoint 2x3 matrix to store the jacobian wrt. the point in
+	 */
+	template< class VT1, class VT2, class VT3, class MT1, class MT2 >
+	void evaluateObservationWithJacobian( const std::size_t i, VT1& result, const VT2& camera, const VT3& point, MT1& jCamera, MT2& jPoint ) const
+	{
+		reprojectPointWithJacobian< VType >( camera, point, result, jCamera, jPoint );
+	}
+};
+
+/**
+ * \c MinimizeReprojectionErrorBlocks evaluating all observations at once with a
+ * \c Math::Gpu::ReprojectionEvaluator, on a CUDA device if available. The device
+ * keeps the observation indices and its buffers over all iterations of the optimization.
+ */
+template< class VType >
+class MinimizeReprojectionErrorGpu
+	: public MinimizeReprojectionErrorBlocks< VType >
+{
+public:
+	MinimizeReprojectionErrorGpu(
+		  const std::size_t cams
+		, const std::size_t points
+		, const std::vector< std::size_t >& pointCount
+		)
+		: MinimizeReprojectionErrorBlocks< VType >( cams, points, pointCount )
+		, m_pEvaluator( new Math::Gpu::ReprojectionEvaluator( cams, points, this->m_observationCamera, this->m_observationPoint ) )
+	{}
+
+	MinimizeReprojectionErrorGpu(
+		  const std::size_t cams
+		, const std::size_t points
+		, const std::vector< std::size_t >& observationCamera
+		, const std::vector< std::size_t >& observationPoint
+		)
+		: MinimizeReprojectionErrorBlocks< VType >( cams, points, observationCamera, observationPoint )
+		, m_pEvaluator( new Math::Gpu::ReprojectionEvaluator( cams, points, this->m_observationCamera, this->m_observationPoint ) )
+	{}
+
+	/** true if the observations are evaluated on the device */
+	bool onDevice() const
+	{ return m_pEvaluator->onDevice(); }
+
+	/**
+	 * @param params the parameters of all cameras and points
+	 * @param predicted vector to store the predicted 2D observations in
+	 * @param cameraJacobians 2x7 jacobian wrt. the camera of each observation
+	 * @param pointJacobians 2x3 jacobian wrt. the point of each observation
+	 */
+	template< class VT1, class VT2, class MT1, class MT2 >
+	void evaluateObservationsWithJacobian( const VT1& params, VT2& predicted, std::vector< MT1 >& cameraJacobians, std::vector< MT2 >& pointJacobians ) const
+	{
+		const std::size_t n = this->observationCount();
+		if ( n == 0 )
+			return;
+
+		m_params.assign( params.begin(), params.end() );
+		m_predicted.resize( 2 * n );
+		m_cameraJacobians.resize( 14 * n );
+		m_pointJacobians.resize( 6 * n );
+		m_pEvaluator->evaluate( &m_params[ 0 ], &m_predicted[ 0 ], &m_cameraJacobians[ 0 ], &m_pointJacobians[ 0 ] );
+
+		for ( std::size_t i = 0; i < n; i++ )
+			for ( std::size_t r = 0; r < 2; r++ )
+			{
+				predicted( 2 * i + r ) = static_cast< VType >( m_predicted[ 2 * i + r ] );
+				for ( std::size_t c = 0; c < 7; c++ )
+					cameraJacobians[ i ]( r, c ) = static_cast< VType >( m_cameraJacobians[ 14 * i + 7 * r + c ] );
+				for ( std::size_t c = 0; c < 3; c++ )
+					pointJacobians[ i ]( r, c ) = static_cast< VType >( m_pointJacobians[ 6 * i + 3 * r + c ] );
+			}
+	}
+
+protected:
+	boost::scoped_ptr< Math::Gpu::ReprojectionEvaluator > m_pEvaluator;
+
+	/** double precision copies of the parameters and results */
+	mutable std::vector< double > m_params;
+	mutable std::vector< double > m_predicted;
+	mutable std::vector< double > m_cameraJacobians;
+	mutable std::vector< double > m_pointJacobians;
+};
+
+} // namespace Algorithm
+
+namespace Math { namespace Optimization {
+
+template< class VType >
+struct SchurBatchEvaluation< Algorithm::MinimizeReprojectionErrorGpu< VType > >
+	: public boost::true_type
+{};
+
+} } // namespace Math::Optimization
+
+namespace Algorithm {
+
 /** 
  * @tparam ForwardIterator1 iterator to container including containers of 2D observations
  * @tparam ForwardIterator2 iterator to container including extrinsic camera pose
@@ -225,6 +432,7 @@ void simpleBundleAdjustmentImpl (
 	, ForwardIterator2 iExtrinsicsPose // e.g. std::vector < Math::Pose >::iterator -> begin()
 	, ForwardIterator3 i3DPtsBegin //  e.g. std::vector < Math::Vector< T, 3 > >::iterator -> begin()
 	, ForwardIterator3 i3DPtsEnd //  e.g. std::vector < Math::Vector< T, 3 > >::iterator -> end()
+	, const BundleAdjustmentSolver solver
 	//, visibility <- next to come :)
 	)
 {
@@ -301,8 +509,27 @@ void simpleBundleAdjustmentImpl (
 	
 	
 	OPT_LOG_DEBUG( "Optimizing pose over " << numberCameras << " cameras using " << observationCountTotal << " observations" );
-	MinimizeReprojectionErrorAllPoints< value_type > minimizeFunc( n_cams, n_pts3D );
-	value_type res = Math::Optimization::levenbergMarquardt( minimizeFunc, paramVector, observationVector, Math::Optimization::OptTerminate( 10, 1e-6 ), Math::Optimization::OptNoNormalize() );
+	value_type res;
+	// offline optimization, may use all threads of the lapack implementation
+	Math::LapackScope lapackScope( 0, "Ubitrack.Algorithm.BundleAdjustment" );
+	if ( solver == baGpuSchurSolver )
+	{
+		MinimizeReprojectionErrorGpu< value_type > minimizeFunc( n_cams, n_pts3D, point_count );
+		LOG4CPP_DEBUG( logger, "Evaluating the reprojections on " << ( minimizeFunc.onDevice() ? Math::Gpu::deviceName() : std::string( "the host" ) ) );
+		res = Math::Optimization::schurLevenbergMarquardt( minimizeFunc, paramVector, observationVector, Math::Optimization::OptTerminate( 10, 1e-6 ), Math::Optimization::OptNoNormalize() );
+	}
+	else if ( solver == baSparseSchurSolver )
+	{
+		MinimizeReprojectionErrorBlocks< value_type > minimizeFunc( n_cams, n_pts3D, point_count );
+		res = Math::Optimization::schurLevenbergMarquardt( minimizeFunc, paramVector, observationVector, Math::Optimization::OptTerminate( 10, 1e-6 ), Math::Optimization::OptNoNormalize() );
+	}
+	else
+	{
+		// the dense jacobian is filled with two rows per observation
+		MinimizeReprojectionErrorAllPoints< value_type > minimizeFunc( n_cams, n_pts3D );
+		Math::Optimization::LevenbergMarquardtWorkspace< value_type, boost::numeric::ublas::row_major > workspace( observationVector.size(), paramVector.size() );
+		res = Math::Optimization::levenbergMarquardt( workspace, minimizeFunc, paramVector, observationVector, Math::Optimization::OptTerminate( 10, 1e-6 ), Math::Optimization::OptNoNormalize() );
+	}
 	
 	// LOG4CPP_TRACE( logger, "optimized parameter vector:\n" << paramVector );
 	
@@ -326,14 +553,84 @@ void simpleBundleAdjustmentImpl (
 	}
 };
 
-void simpleBundleAdjustment( const std::vector< std::vector< Math::Vector2d > >& pts2D, std::vector< Math::Pose >& poses, std::vector< Math::Vector3d > & pts3D )
+void simpleBundleAdjustment( const std::vector< std::vector< Math::Vector2d > >& pts2D, std::vector< Math::Pose >& poses, std::vector< Math::Vector3d > & pts3D, const BundleAdjustmentSolver solver )
 {
-	simpleBundleAdjustmentImpl( pts2D.begin(), pts2D.end(), poses.begin(), pts3D.begin(), pts3D.end() );
+	simpleBundleAdjustmentImpl( pts2D.begin(), pts2D.end(), poses.begin(), pts3D.begin(), pts3D.end(), solver );
 }
 
-void simpleBundleAdjustment( const std::vector< std::vector< Math::Vector2f > >& pts2D,  std::vector< Math::Pose >& poses, std::vector< Math::Vector3f > & pts3D )
+void simpleBundleAdjustment( const std::vector< std::vector< Math::Vector2f > >& pts2D,  std::vector< Math::Pose >& poses, std::vector< Math::Vector3f > & pts3D, const BundleAdjustmentSolver solver )
 {
-	simpleBundleAdjustmentImpl( pts2D.begin(), pts2D.end(), poses.begin(), pts3D.begin(), pts3D.end() );
+	simpleBundleAdjustmentImpl( pts2D.begin(), pts2D.end(), poses.begin(), pts3D.begin(), pts3D.end(), solver );
+}
+
+double bundleAdjustment( BundleAdjustmentNetwork& network, const BundleAdjustmentSolver solver, const std::size_t maxIterations )
+{
+	const std::size_t n_cams = network.cameras.size();
+	const std::size_t n_pts3D = network.points.size();
+	const std::size_t n_obs = network.observations.size();
+
+	std::vector< std::size_t > observationCamera( n_obs );
+	std::vector< std::size_t > observationPoint( n_obs );
+	Math::Vector< double > observationVector( 2 * n_obs );
+	for ( std::size_t i = 0; i < n_obs; i++ )
+	{
+		const BundleAdjustmentNetwork::Observation& o( network.observations[ i ] );
+		if ( o.camera >= n_cams || o.point >= n_pts3D )
+			UBITRACK_THROW( "bundle adjustment: observation of a camera or point that does not exist" );
+		observationCamera[ i ] = o.camera;
+		observationPoint[ i ] = o.point;
+		observationVector( 2 * i ) = o.measurement( 0 );
+		observationVector( 2 * i + 1 ) = o.measurement( 1 );
+	}
+
+	Math::Vector< double > paramVector( 7 * n_cams + 3 * n_pts3D );
+	for ( std::size_t c = 0; c < n_cams; c++ )
+	{
+		Math::Vector< double, 4 > quatVec;
+		network.cameras[ c ].rotation().toVector( quatVec );
+		boost::numeric::ublas::subrange( paramVector, 7 * c, 7 * c + 4 ) = quatVec;
+		boost::numeric::ublas::subrange( paramVector, 7 * c + 4, 7 * c + 7 ) = network.cameras[ c ].translation();
+	}
+	for ( std::size_t p = 0; p < n_pts3D; p++ )
+		boost::numeric::ublas::subrange( paramVector, 7 * n_cams + 3 * p, 7 * n_cams + 3 * p + 3 ) = network.points[ p ];
+
+	LOG4CPP_DEBUG( logger, "Bundle adjustment of a network with " << n_cams << " cameras, " << n_pts3D << " points and " << n_obs << " observations" );
+	Math::LapackScope lapackScope( 0, "Ubitrack.Algorithm.BundleAdjustment" );
+	double res;
+	if ( solver == baGpuSchurSolver )
+	{
+		MinimizeReprojectionErrorGpu< double > minimizeFunc( n_cams, n_pts3D, observationCamera, observationPoint );
+		res = Math::Optimization::schurLevenbergMarquardt( minimizeFunc, paramVector, observationVector, Math::Optimization::OptTerminate( maxIterations, 1e-6 ), Math::Optimization::OptNoNormalize() );
+	}
+	else
+	{
+		MinimizeReprojectionErrorBlocks< double > minimizeFunc( n_cams, n_pts3D, observationCamera, observationPoint );
+		res = Math::Optimization::schurLevenbergMarquardt( minimizeFunc, paramVector, observationVector, Math::Optimization::OptTerminate( maxIterations, 1e-6 ), Math::Optimization::OptNoNormalize() );
+	}
+
+	for ( std::size_t c = 0; c < n_cams; c++ )
+	{
+		const Math::Quaternion quat = Math::Quaternion::fromVector( boost::numeric::ublas::subrange( paramVector, 7 * c, 7 * c + 4 ) ).normalize();
+		network.cameras[ c ] = Math::Pose( quat, Math::Vector3d( boost::numeric::ublas::subrange( paramVector, 7 * c + 4, 7 * c + 7 ) ) );
+	}
+	for ( std::size_t p = 0; p < n_pts3D; p++ )
+		network.points[ p ] = boost::numeric::ublas::subrange( paramVector, 7 * n_cams + 3 * p, 7 * n_cams + 3 * p + 3 );
+
+	return res;
+}
+
+double reprojectionError( const BundleAdjustmentNetwork& network )
+{
+	double sum = 0;
+	for ( std::size_t i = 0; i < network.observations.size(); i++ )
+	{
+		const BundleAdjustmentNetwork::Observation& o( network.observations[ i ] );
+		const Math::Vector3d x( network.cameras[ o.camera ] * network.points[ o.point ] );
+		const double dx = x( 0 ) / x( 2 ) - o.measurement( 0 );
+		const double dy = x( 1 ) / x( 2 ) - o.measurement( 1 );
+		sum += dx * dx + dy * dy;
+	}
+	return sum;
 }
 
 #endif // HAVE_LAPACK
@@ -21,6 +21,9 @@
  * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
  */
 
+#ifndef __UBITRACK_ALGORITHM_BUNDLEADJUSTMENT_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_BUNDLEADJUSTMENT_H_INCLUDED__
+
 // #include <utMeasurement/Measurement.h>
 
 #include "../utCore.h"
@@ -29,10 +32,29 @@
 #include <utMath/Matrix.h>
 #include <utMath/Pose.h>
 
+#include <vector>
+
 namespace Ubitrack { namespace Algorithm {
 
 #ifdef HAVE_LAPACK
 
+/**
+ * @ingroup tracking_algorithms
+ * solvers available for the bundle adjustment
+ */
+enum BundleAdjustmentSolver
+{
+	/** dense levenberg-marquardt on the full jacobian */
+	baDenseSolver,
+	/** block-sparse levenberg-marquardt, marginalizing the points via the schur complement */
+	baSparseSchurSolver,
+	/**
+	 * like \c baSparseSchurSolver, evaluating the reprojections and jacobians on a CUDA device
+	 * if the library was built with ENABLE_CUDA (see \c Math::Gpu::ReprojectionEvaluator)
+	 */
+	baGpuSchurSolver
+};
+
 /**
  * @ingroup tracking_algorithms
  * @brief Performs a (classic) bundle adjustment
@@ -48,12 +70,77 @@ namespace Ubitrack { namespace Algorithm {
  * @param pts2D \c std::vector of observations, for each camera a new \c std::vector
  * @return camPoses \c std::vector of poses, defining the initial extrinsic camera orientations
  * @return pts3D \c std::vector of initial 3D points , basis of the 2D observations in 1st parameter
+ * @param solver the solver to use, the sparse solver only stores the non-zero blocks of the jacobian
+ *   and solves the reduced camera system, which is much faster for large networks
  */
 
-UBITRACK_EXPORT void simpleBundleAdjustment( const std::vector< std::vector< Math::Vector2d > >& pts2D, std::vector< Math::Pose >& camPoses, std::vector< Math::Vector3d >& pts3D );
+UBITRACK_EXPORT void simpleBundleAdjustment( const std::vector< std::vector< Math::Vector2d > >& pts2D, std::vector< Math::Pose >& camPoses, std::vector< Math::Vector3d >& pts3D, const BundleAdjustmentSolver solver = baSparseSchurSolver );
+
+UBITRACK_EXPORT void simpleBundleAdjustment( const std::vector< std::vector< Math::Vector2f > >& pts2D, std::vector< Math::Pose >& camPoses, std::vector< Math::Vector3f >& pts3D, const BundleAdjustmentSolver solver = baSparseSchurSolver );
+
+/**
+ * @ingroup tracking_algorithms
+ * A bundle adjustment problem in which each camera observes an arbitrary subset of the points.
+ * The observations are in normalized image coordinates, as for \c simpleBundleAdjustment.
+ */
+struct BundleAdjustmentNetwork
+{
+	/** an observation of a point by a camera */
+	struct Observation
+	{
+		Observation()
+			: camera( 0 )
+			, point( 0 )
+		{}
+
+		Observation( const std::size_t c, const std::size_t p, const Math::Vector2d& m )
+			: camera( c )
+			, point( p )
+			, measurement( m )
+		{}
+
+		std::size_t camera;
+		std::size_t point;
+		Math::Vector2d measurement;
 
-UBITRACK_EXPORT void simpleBundleAdjustment( const std::vector< std::vector< Math::Vector2f > >& pts2D, std::vector< Math::Pose >& camPoses, std::vector< Math::Vector3f >& pts3D);
+		template< class Archive >
+		void serialize( Archive& ar, const unsigned int )
+		{ ar & camera & point & measurement; }
+	};
+
+	/** extrinsic poses of the cameras, mapping points into the camera frame */
+	std::vector< Math::Pose > cameras;
+
+	/** the 3D points */
+	std::vector< Math::Vector3d > points;
+
+	/** all observations */
+	std::vector< Observation > observations;
+
+	template< class Archive >
+	void serialize( Archive& ar, const unsigned int )
+	{ ar & cameras & points & observations; }
+};
+
+/**
+ * @ingroup tracking_algorithms
+ * Optimizes the cameras and points of a \c BundleAdjustmentNetwork, like \c simpleBundleAdjustment.
+ * @param network the network, the cameras and points are replaced by the optimized ones
+ * @param solver the solver to use, \c baDenseSolver is treated as \c baSparseSchurSolver
+ * @param maxIterations maximum number of levenberg-marquardt iterations
+ * @return the sum of the squared reprojection errors
+ */
+UBITRACK_EXPORT double bundleAdjustment( BundleAdjustmentNetwork& network, const BundleAdjustmentSolver solver = baSparseSchurSolver,
+	const std::size_t maxIterations = 10 );
+
+/**
+ * @ingroup tracking_algorithms
+ * @return the sum of the squared reprojection errors of a \c BundleAdjustmentNetwork
+ */
+UBITRACK_EXPORT double reprojectionError( const BundleAdjustmentNetwork& network );
 	
 #endif // HAVE_LAPACK
 
 }} // namespace Ubitrack::Algorithm
+
+#endif // __UBITRACK_ALGORITHM_BUNDLEADJUSTMENT_H_INCLUDED__
@@ -0,0 +1,335 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Partition of bundle adjustment networks into overlapping clusters
+ */
+
+#include "BundleAdjustmentPartition.h"
+
+#ifdef HAVE_LAPACK
+
+#include <map>
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <utUtil/Exception.h>
+#include <utUtil/PortableBinaryArchive.h>
+#include "PoseEstimation3D3D/AbsoluteOrientation.h"
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Algorithm.BundleAdjustmentPartition" );
+
+namespace Ubitrack { namespace Algorithm {
+
+namespace {
+
+/** number of points each camera has in common with its neighbours */
+typedef std::vector< std::map< std::size_t, std::size_t > > CovisibilityGraph;
+
+CovisibilityGraph covisibility( const BundleAdjustmentNetwork& network )
+{
+	std::vector< std::vector< std::size_t > > pointCameras( network.points.size() );
+	for ( std::size_t i = 0; i < network.observations.size(); i++ )
+		pointCameras[ network.observations[ i ].point ].push_back( network.observations[ i ].camera );
+
+	CovisibilityGraph graph( network.cameras.size() );
+	for ( std::size_t p = 0; p < pointCameras.size(); p++ )
+	{
+		std::vector< std::size_t >& cams( pointCameras[ p ] );
+		std::sort( cams.begin(), cams.end() );
+		cams.erase( std::unique( cams.begin(), cams.end() ), cams.end() );
+		for ( std::size_t a = 0; a < cams.size(); a++ )
+			for ( std::size_t b = a + 1; b < cams.size(); b++ )
+			{
+				graph[ cams[ a ] ][ cams[ b ] ]++;
+				graph[ cams[ b ] ][ cams[ a ] ]++;
+			}
+	}
+	return graph;
+}
+
+/** orders candidate cameras by the number of points shared with the cluster, most first */
+bool moreShared( const std::pair< std::size_t, std::size_t >& a, const std::pair< std::size_t, std::size_t >& b )
+{ return a.second > b.second || ( a.second == b.second && a.first < b.first ); }
+
+/**
+ * similarity transformation from the frame of the cluster to the global frame, estimated
+ * from the points, <tt>x_g = scale * R x_c + t</tt>
+ * @return false if the cluster has too few points
+ */
+bool alignCluster( const BundleAdjustmentNetwork& network, const BundleAdjustmentCluster& cluster, double& scale, Math::Pose& transform )
+{
+	const std::size_t n = cluster.pointIds.size();
+	if ( n < 3 )
+		return false;
+
+	Math::Vector3d centroidLocal( Math::Vector3d::zeros() );
+	Math::Vector3d centroidGlobal( Math::Vector3d::zeros() );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		centroidLocal += cluster.network.points[ i ];
+		centroidGlobal += network.points[ cluster.pointIds[ i ] ];
+	}
+	centroidLocal /= static_cast< double >( n );
+	centroidGlobal /= static_cast< double >( n );
+
+	double spreadLocal = 0;
+	double spreadGlobal = 0;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		spreadLocal += boost::numeric::ublas::inner_prod( cluster.network.points[ i ] - centroidLocal, cluster.network.points[ i ] - centroidLocal );
+		spreadGlobal += boost::numeric::ublas::inner_prod( network.points[ cluster.pointIds[ i ] ] - centroidGlobal, network.points[ cluster.pointIds[ i ] ] - centroidGlobal );
+	}
+	if ( spreadLocal <= 0 || spreadGlobal <= 0 )
+		return false;
+	scale = std::sqrt( spreadGlobal / spreadLocal );
+
+	std::vector< Math::Vector3d > left( n );
+	std::vector< Math::Vector3d > right( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		left[ i ] = scale * cluster.network.points[ i ];
+		right[ i ] = network.points[ cluster.pointIds[ i ] ];
+	}
+	transform = PoseEstimation3D3D::calculateAbsoluteOrientation( left, right );
+	return true;
+}
+
+} // anonymous namespace
+
+
+std::vector< BundleAdjustmentCluster > partitionNetwork( const BundleAdjustmentNetwork& network, const BundleAdjustmentPartitionParameters& params )
+{
+	if ( params.maxClusterCameras == 0 || params.minSharedPoints == 0 )
+		UBITRACK_THROW( "partition of a bundle adjustment network: clusters need at least one camera and one shared point" );
+
+	const std::size_t nCams = network.cameras.size();
+	for ( std::size_t i = 0; i < network.observations.size(); i++ )
+		if ( network.observations[ i ].camera >= nCams || network.observations[ i ].point >= network.points.size() )
+			UBITRACK_THROW( "partition of a bundle adjustment network: observation of a camera or point that does not exist" );
+
+	const CovisibilityGraph graph( covisibility( network ) );
+
+	// grow regions of neighbouring cameras
+	static const std::size_t unassigned = static_cast< std::size_t >( -1 );
+	std::vector< std::size_t > clusterOf( nCams, unassigned );
+	std::vector< std::vector< std::size_t > > cores;
+	for ( std::size_t seed = 0; seed < nCams; seed++ )
+	{
+		if ( clusterOf[ seed ] != unassigned )
+			continue;
+
+		std::vector< std::size_t > core( 1, seed );
+		clusterOf[ seed ] = cores.size();
+		for ( std::size_t next = 0; next < core.size() && core.size() < params.maxClusterCameras; next++ )
+			for ( std::map< std::size_t, std::size_t >::const_iterator it = graph[ core[ next ] ].begin();
+				it != graph[ core[ next ] ].end() && core.size() < params.maxClusterCameras; ++it )
+				if ( it->second >= params.minSharedPoints && clusterOf[ it->first ] == unassigned )
+				{
+					clusterOf[ it->first ] = cores.size();
+					core.push_back( it->first );
+				}
+		cores.push_back( core );
+	}
+
+	std::vector< std::vector< std::size_t > > cameraObservations( nCams );
+	for ( std::size_t i = 0; i < network.observations.size(); i++ )
+		cameraObservations[ network.observations[ i ].camera ].push_back( i );
+
+	std::vector< BundleAdjustmentCluster > clusters( cores.size() );
+	for ( std::size_t k = 0; k < cores.size(); k++ )
+	{
+		BundleAdjustmentCluster& cluster( clusters[ k ] );
+		cluster.cameraIds = cores[ k ];
+		cluster.coreCameras = cores[ k ].size();
+
+		// add the neighbours sharing the most points with the cluster
+		std::map< std::size_t, std::size_t > shared;
+		for ( std::size_t i = 0; i < cores[ k ].size(); i++ )
+			for ( std::map< std::size_t, std::size_t >::const_iterator it = graph[ cores[ k ][ i ] ].begin(); it != graph[ cores[ k ][ i ] ].end(); ++it )
+				if ( clusterOf[ it->first ] != k )
+					shared[ it->first ] += it->second;
+		std::vector< std::pair< std::size_t, std::size_t > > candidates( shared.begin(), shared.end() );
+		std::sort( candidates.begin(), candidates.end(), moreShared );
+		for ( std::size_t i = 0; i < candidates.size() && i < params.overlapCameras && candidates[ i ].second >= params.minSharedPoints; i++ )
+			cluster.cameraIds.push_back( candidates[ i ].first );
+
+		// points observed by at least two cameras of the cluster
+		std::map< std::size_t, std::size_t > pointViews;
+		for ( std::size_t i = 0; i < cluster.cameraIds.size(); i++ )
+		{
+			const std::vector< std::size_t >& obs( cameraObservations[ cluster.cameraIds[ i ] ] );
+			for ( std::size_t j = 0; j < obs.size(); j++ )
+				pointViews[ network.observations[ obs[ j ] ].point ]++;
+		}
+		std::map< std::size_t, std::size_t > localPoint;
+		for ( std::map< std::size_t, std::size_t >::const_iterator it = pointViews.begin(); it != pointViews.end(); ++it )
+			if ( it->second >= 2 )
+			{
+				localPoint[ it->first ] = cluster.pointIds.size();
+				cluster.pointIds.push_back( it->first );
+				cluster.network.points.push_back( network.points[ it->first ] );
+			}
+
+		for ( std::size_t i = 0; i < cluster.cameraIds.size(); i++ )
+		{
+			cluster.network.cameras.push_back( network.cameras[ cluster.cameraIds[ i ] ] );
+			const std::vector< std::size_t >& obs( cameraObservations[ cluster.cameraIds[ i ] ] );
+			for ( std::size_t j = 0; j < obs.size(); j++ )
+			{
+				const BundleAdjustmentNetwork::Observation& o( network.observations[ obs[ j ] ] );
+				std::map< std::size_t, std::size_t >::const_iterator p = localPoint.find( o.point );
+				if ( p != localPoint.end() )
+					cluster.network.observations.push_back( BundleAdjustmentNetwork::Observation( i, p->second, o.measurement ) );
+			}
+		}
+	}
+
+	LOG4CPP_DEBUG( logger, "Partitioned " << nCams << " cameras into " << clusters.size() << " clusters" );
+	return clusters;
+}
+
+
+void mergeClusters( BundleAdjustmentNetwork& network, const std::vector< BundleAdjustmentCluster >& clusters )
+{
+	const std::size_t nCams = network.cameras.size();
+	const std::size_t nPoints = network.points.size();
+	std::vector< Math::Vector4d > rotationSum( nCams, Math::Vector4d::zeros() );
+	std::vector< Math::Vector3d > translationSum( nCams, Math::Vector3d::zeros() );
+	std::vector< std::size_t > cameraCount( nCams, 0 );
+	std::vector< Math::Vector3d > pointSum( nPoints, Math::Vector3d::zeros() );
+	std::vector< std::size_t > pointCount( nPoints, 0 );
+
+	for ( std::size_t k = 0; k < clusters.size(); k++ )
+	{
+		const BundleAdjustmentCluster& cluster( clusters[ k ] );
+		double scale;
+		Math::Pose transform;
+		if ( !alignCluster( network, cluster, scale, transform ) )
+		{
+			LOG4CPP_DEBUG( logger, "Cluster " << k << " has too few points to be merged" );
+			continue;
+		}
+
+		// the camera frame is scaled as well, which does not change the projections
+		const Math::Quaternion inverseRotation( ~transform.rotation() );
+		for ( std::size_t i = 0; i < cluster.cameraIds.size(); i++ )
+		{
+			const std::size_t c = cluster.cameraIds[ i ];
+			const Math::Pose& local( cluster.network.cameras[ i ] );
+			const Math::Quaternion rotation( Math::Quaternion( local.rotation() * inverseRotation ).negateIfCloser( network.cameras[ c ].rotation() ) );
+			Math::Vector4d q;
+			rotation.toVector( q );
+			rotationSum[ c ] += q;
+			translationSum[ c ] += scale * local.translation() - rotation * transform.translation();
+			cameraCount[ c ]++;
+		}
+
+		for ( std::size_t i = 0; i < cluster.pointIds.size(); i++ )
+		{
+			pointSum[ cluster.pointIds[ i ] ] += transform * Math::Vector3d( scale * cluster.network.points[ i ] );
+			pointCount[ cluster.pointIds[ i ] ]++;
+		}
+	}
+
+	for ( std::size_t c = 0; c < nCams; c++ )
+		if ( cameraCount[ c ] )
+			network.cameras[ c ] = Math::Pose( Math::Quaternion::fromVector( rotationSum[ c ] ).normalize(),
+				Math::Vector3d( translationSum[ c ] / static_cast< double >( cameraCount[ c ] ) ) );
+	for ( std::size_t p = 0; p < nPoints; p++ )
+		if ( pointCount[ p ] )
+			network.points[ p ] = pointSum[ p ] / static_cast< double >( pointCount[ p ] );
+}
+
+
+void solveClustersLocally( std::vector< BundleAdjustmentCluster >& clusters, const BundleAdjustmentSolver solver, const std::size_t maxIterations )
+{
+	for ( std::size_t k = 0; k < clusters.size(); k++ )
+		if ( !clusters[ k ].network.observations.empty() )
+			bundleAdjustment( clusters[ k ].network, solver, maxIterations );
+}
+
+
+double distributedBundleAdjustment( BundleAdjustmentNetwork& network, const BundleAdjustmentPartitionParameters& params,
+	const BundleAdjustmentClusterSolver& clusterSolver )
+{
+	const BundleAdjustmentClusterSolver solve( clusterSolver ? clusterSolver :
+		BundleAdjustmentClusterSolver( boost::bind( &solveClustersLocally, _1, params.solver, params.maxIterations ) ) );
+
+	for ( std::size_t round = 0; round < params.consensusRounds; round++ )
+	{
+		std::vector< BundleAdjustmentCluster > clusters( partitionNetwork( network, params ) );
+		solve( clusters );
+		mergeClusters( network, clusters );
+		LOG4CPP_DEBUG( logger, "Reprojection error after round " << round << ": " << reprojectionError( network ) );
+	}
+
+	if ( params.refineGlobally )
+		return bundleAdjustment( network, params.solver, params.maxIterations );
+	return reprojectionError( network );
+}
+
+
+std::string serializeCluster( const BundleAdjustmentCluster& cluster )
+{
+	std::ostringstream stream;
+	Util::PortableBinaryOArchive archive( stream );
+	archive << cluster;
+	return stream.str();
+}
+
+
+BundleAdjustmentCluster deserializeCluster( const std::string& data )
+{
+	std::istringstream stream( data );
+	BundleAdjustmentCluster cluster;
+	try
+	{
+		Util::PortableBinaryIArchive archive( stream );
+		archive >> cluster;
+	}
+	catch ( const std::exception& e )
+	{
+		UBITRACK_THROW( std::string( "invalid bundle adjustment cluster: " ) + e.what() );
+	}
+	if ( !stream )
+		UBITRACK_THROW( "invalid bundle adjustment cluster: truncated data" );
+
+	const BundleAdjustmentNetwork& n( cluster.network );
+	if ( cluster.cameraIds.size() != n.cameras.size() || cluster.pointIds.size() != n.points.size() || cluster.coreCameras > n.cameras.size() )
+		UBITRACK_THROW( "invalid bundle adjustment cluster: inconsistent sizes" );
+	for ( std::size_t i = 0; i < n.observations.size(); i++ )
+		if ( n.observations[ i ].camera >= n.cameras.size() || n.observations[ i ].point >= n.points.size() )
+			UBITRACK_THROW( "invalid bundle adjustment cluster: observation of a camera or point that does not exist" );
+	return cluster;
+}
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // HAVE_LAPACK
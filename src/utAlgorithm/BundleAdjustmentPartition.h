@@ -0,0 +1,172 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Bundle adjustment of large networks, split into overlapping clusters of cameras.
+ *
+ * The clusters are small \c BundleAdjustmentNetwork objects that can be serialized and solved
+ * independently, e.g. on other nodes. Their solutions are merged into the global network by a
+ * consensus step: each cluster is aligned to the current global estimate by a similarity
+ * transformation, and cameras and points contained in several clusters are averaged.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_BUNDLEADJUSTMENTPARTITION_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_BUNDLEADJUSTMENTPARTITION_H_INCLUDED__
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include "../utCore.h"
+#include "BundleAdjustment.h"
+
+namespace Ubitrack { namespace Algorithm {
+
+#ifdef HAVE_LAPACK
+
+/**
+ * @ingroup tracking_algorithms
+ * A part of a \c BundleAdjustmentNetwork, with its own numbering of cameras and points.
+ */
+struct BundleAdjustmentCluster
+{
+	BundleAdjustmentCluster()
+		: coreCameras( 0 )
+	{}
+
+	/** the sub-problem, solved in place */
+	BundleAdjustmentNetwork network;
+
+	/** index of each camera of the cluster in the global network */
+	std::vector< std::size_t > cameraIds;
+
+	/** index of each point of the cluster in the global network */
+	std::vector< std::size_t > pointIds;
+
+	/** the first \c coreCameras cameras belong to this cluster only, the others overlap with other clusters */
+	std::size_t coreCameras;
+
+	template< class Archive >
+	void serialize( Archive& ar, const unsigned int )
+	{ ar & network & cameraIds & pointIds & coreCameras; }
+};
+
+/** @ingroup tracking_algorithms parameters of \c partitionNetwork and \c distributedBundleAdjustment */
+struct BundleAdjustmentPartitionParameters
+{
+	BundleAdjustmentPartitionParameters()
+		: maxClusterCameras( 20 )
+		, overlapCameras( 4 )
+		, minSharedPoints( 5 )
+		, consensusRounds( 2 )
+		, maxIterations( 10 )
+		, solver( baSparseSchurSolver )
+		, refineGlobally( false )
+	{}
+
+	/** maximum number of cameras that belong to one cluster only */
+	std::size_t maxClusterCameras;
+
+	/** number of cameras of neighbouring clusters added to each cluster */
+	std::size_t overlapCameras;
+
+	/** two cameras are neighbours if they observe at least this many common points */
+	std::size_t minSharedPoints;
+
+	/** number of rounds of solving the clusters and merging them */
+	std::size_t consensusRounds;
+
+	/** maximum number of levenberg-marquardt iterations per cluster */
+	std::size_t maxIterations;
+
+	/** the solver used for the clusters */
+	BundleAdjustmentSolver solver;
+
+	/** if true, the merged network is refined by a bundle adjustment of all cameras */
+	bool refineGlobally;
+};
+
+/**
+ * @ingroup tracking_algorithms
+ * Solves a list of clusters in place. Replace the default to distribute the clusters to other
+ * nodes, e.g. using \c serializeCluster and \c deserializeCluster.
+ */
+typedef boost::function< void ( std::vector< BundleAdjustmentCluster >& ) > BundleAdjustmentClusterSolver;
+
+/**
+ * @ingroup tracking_algorithms
+ * Splits a network into overlapping clusters of cameras. The cameras are grouped by growing
+ * regions in the graph of cameras observing common points, then the neighbours with the most
+ * common points are added to each cluster. A cluster contains the points observed by at least
+ * two of its cameras.
+ * @throws Util::Exception if the parameters are invalid
+ */
+UBITRACK_EXPORT std::vector< BundleAdjustmentCluster > partitionNetwork( const BundleAdjustmentNetwork& network,
+	const BundleAdjustmentPartitionParameters& params = BundleAdjustmentPartitionParameters() );
+
+/**
+ * @ingroup tracking_algorithms
+ * Merges solved clusters into the global network. Each cluster is aligned to the cameras and
+ * points of \c network by a similarity transformation, then cameras and points are replaced by
+ * the average over all clusters containing them.
+ */
+UBITRACK_EXPORT void mergeClusters( BundleAdjustmentNetwork& network, const std::vector< BundleAdjustmentCluster >& clusters );
+
+/**
+ * @ingroup tracking_algorithms
+ * Solves the clusters one after the other with \c bundleAdjustment, the default cluster solver.
+ */
+UBITRACK_EXPORT void solveClustersLocally( std::vector< BundleAdjustmentCluster >& clusters,
+	const BundleAdjustmentSolver solver = baSparseSchurSolver, const std::size_t maxIterations = 10 );
+
+/**
+ * @ingroup tracking_algorithms
+ * Bundle adjustment of a large network by partitioning it into clusters, solving the clusters
+ * and merging them, repeated for \c params.consensusRounds rounds.
+ * @param network the network, the cameras and points are replaced by the optimized ones
+ * @param params parameters of the partition
+ * @param clusterSolver solves the clusters of a round, by default \c solveClustersLocally
+ * @return the sum of the squared reprojection errors of the merged network
+ */
+UBITRACK_EXPORT double distributedBundleAdjustment( BundleAdjustmentNetwork& network,
+	const BundleAdjustmentPartitionParameters& params = BundleAdjustmentPartitionParameters(),
+	const BundleAdjustmentClusterSolver& clusterSolver = BundleAdjustmentClusterSolver() );
+
+/** @ingroup tracking_algorithms serializes a cluster to send it to another node */
+UBITRACK_EXPORT std::string serializeCluster( const BundleAdjustmentCluster& cluster );
+
+/**
+ * @ingroup tracking_algorithms
+ * reads a cluster written by \c serializeCluster
+ * @throws Util::Exception if the data is not a valid cluster
+ */
+UBITRACK_EXPORT BundleAdjustmentCluster deserializeCluster( const std::string& data );
+
+#endif // HAVE_LAPACK
+
+} } // namespace Ubitrack::Algorithm
+
+#endif
@@ -0,0 +1,264 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Camera model with precomputed lens coefficients for repeated projection.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_CAMERALENS_CAMERAMODEL_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_CAMERALENS_CAMERAMODEL_H_INCLUDED__
+
+#include <vector>
+
+#include <utUtil/Exception.h>
+#include <utMath/Vector.h>
+#include <utMath/CameraIntrinsics.h>
+
+#include "Distortion.h"
+#include "Undistortion.h"
+
+namespace Ubitrack { namespace Algorithm { namespace CameraLens {
+
+/**
+ * @ingroup tracking_algorithms
+ * @brief Projection, distortion and undistortion of many points with fixed intrinsics.
+ *
+ * The model is built once from the camera intrinsics and keeps the coefficients of the
+ * intrinsic matrix and the lens that the batch kernels need. The radial model is selected
+ * by the calibration type: \c OPENCV_2_2 and \c OPENCV_3_2 use kernels instantiated for the
+ * polynomial with 2 or 3 terms, which save the unused powers of the radius and the division
+ * by the denominator, other types use the rational model with all 6 coefficients. The choice
+ * is made once per batch, so the loops over the points contain no branches on the model.
+ * Fish-eye parameters are not supported.
+ *
+ * Distortion and undistortion give the same results as \c distort and \c undistort of
+ * \c Correction.h, up to rounding. \c project maps points in camera coordinates to distorted
+ * image coordinates, i.e. the distortion of the ideal projection with the intrinsic matrix.
+ *
+ * @verbatim
+ CameraModel< double > model( intrinsics );
+ model.project( points3D, imagePoints );
+ model.undistort( measuredPoints, idealPoints );
+ @endverbatim
+ */
+template< typename T >
+class CameraModel
+{
+public:
+	/**
+	 * Constructor.
+	 * @param intrinsics camera intrinsics parameters including 3x3 intrinsic matrix and distortion parameters
+	 */
+	explicit CameraModel( const Math::CameraIntrinsics< T >& intrinsics )
+		: m_intrinsics( intrinsics )
+		, m_coefficients( intrinsics )
+		, m_radialTerms( radialTerms( intrinsics ) )
+	{}
+
+	/** @return the intrinsics the model was built for */
+	const Math::CameraIntrinsics< T >& intrinsics() const
+	{ return m_intrinsics; }
+
+	/**
+	 * projects \c n 3d points given as separate coordinate arrays to distorted image coordinates
+	 *
+	 * @param n number of points
+	 * @param x,y,z arrays of the coordinates in the camera frame
+	 * @param uOut,vOut arrays receiving the distorted image coordinates
+	 */
+	void project( const std::size_t n, const T* x, const T* y, const T* z, T* uOut, T* vOut ) const
+	{
+		switch ( m_radialTerms )
+		{
+			case 2: projectImpl< 2 >( n, x, y, z, uOut, vOut ); break;
+			case 3: projectImpl< 3 >( n, x, y, z, uOut, vOut ); break;
+			default: projectImpl< 6 >( n, x, y, z, uOut, vOut ); break;
+		}
+	}
+
+	/** projects a vector of 3d points in camera coordinates to distorted image coordinates */
+	void project( const std::vector< Math::Vector< T, 3 > >& points, std::vector< Math::Vector< T, 2 > >& result ) const
+	{
+		const std::size_t n = points.size();
+		if ( n == 0 )
+		{
+			result.clear();
+			return;
+		}
+
+		std::vector< T > x( n ), y( n ), z( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			x[ i ] = points[ i ]( 0 );
+			y[ i ] = points[ i ]( 1 );
+			z[ i ] = points[ i ]( 2 );
+		}
+		project( n, &x[ 0 ], &y[ 0 ], &z[ 0 ], &x[ 0 ], &y[ 0 ] );
+		internal::merge_points( x, y, result );
+	}
+
+	/** projects a single 3d point in camera coordinates to distorted image coordinates */
+	Math::Vector< T, 2 > project( const Math::Vector< T, 3 >& point ) const
+	{
+		Math::Vector< T, 2 > result;
+		project( 1, &point( 0 ), &point( 1 ), &point( 2 ), &result( 0 ), &result( 1 ) );
+		return result;
+	}
+
+	/**
+	 * applies the lens distortion to \c n points given as separate coordinate arrays
+	 *
+	 * @param n number of points
+	 * @param u,v arrays of the undistorted image coordinates
+	 * @param uOut,vOut arrays receiving the distorted image coordinates, may be identical to the input
+	 */
+	void distort( const std::size_t n, const T* u, const T* v, T* uOut, T* vOut ) const
+	{
+		switch ( m_radialTerms )
+		{
+			case 2: distortImpl< 2 >( n, u, v, uOut, vOut ); break;
+			case 3: distortImpl< 3 >( n, u, v, uOut, vOut ); break;
+			default: distortImpl< 6 >( n, u, v, uOut, vOut ); break;
+		}
+	}
+
+	/** applies the lens distortion to a vector of points, the result may be identical to the input */
+	void distort( const std::vector< Math::Vector< T, 2 > >& undistorted, std::vector< Math::Vector< T, 2 > >& distorted ) const
+	{
+		if ( undistorted.empty() )
+		{
+			distorted.clear();
+			return;
+		}
+
+		std::vector< T > u, v;
+		internal::split_points( undistorted, u, v );
+		distort( u.size(), &u[ 0 ], &v[ 0 ], &u[ 0 ], &v[ 0 ] );
+		internal::merge_points( u, v, distorted );
+	}
+
+	/** applies the lens distortion to a single point */
+	Math::Vector< T, 2 > distort( const Math::Vector< T, 2 >& undistorted ) const
+	{
+		Math::Vector< T, 2 > result;
+		distort( 1, &undistorted( 0 ), &undistorted( 1 ), &result( 0 ), &result( 1 ) );
+		return result;
+	}
+
+	/**
+	 * removes the lens distortion from \c n points given as separate coordinate arrays
+	 *
+	 * Uses the same newton iterations as \c undistort of \c Correction.h.
+	 *
+	 * @param n number of points
+	 * @param u,v arrays of the distorted image coordinates
+	 * @param uOut,vOut arrays receiving the undistorted image coordinates, may be identical to the input
+	 */
+	void undistort( const std::size_t n, const T* u, const T* v, T* uOut, T* vOut ) const
+	{
+		switch ( m_radialTerms )
+		{
+			case 2: undistortImpl< 2 >( n, u, v, uOut, vOut ); break;
+			case 3: undistortImpl< 3 >( n, u, v, uOut, vOut ); break;
+			default: undistortImpl< 6 >( n, u, v, uOut, vOut ); break;
+		}
+	}
+
+	/** removes the lens distortion from a vector of points, the result may be identical to the input */
+	void undistort( const std::vector< Math::Vector< T, 2 > >& distorted, std::vector< Math::Vector< T, 2 > >& undistorted ) const
+	{
+		if ( distorted.empty() )
+		{
+			undistorted.clear();
+			return;
+		}
+
+		std::vector< T > u, v;
+		internal::split_points( distorted, u, v );
+		undistort( u.size(), &u[ 0 ], &v[ 0 ], &u[ 0 ], &v[ 0 ] );
+		internal::merge_points( u, v, undistorted );
+	}
+
+	/** removes the lens distortion from a single point */
+	Math::Vector< T, 2 > undistort( const Math::Vector< T, 2 >& distorted ) const
+	{
+		Math::Vector< T, 2 > result;
+		undistort( 1, &distorted( 0 ), &distorted( 1 ), &result( 0 ), &result( 1 ) );
+		return result;
+	}
+
+protected:
+	/// the number of radial terms of the kernels for the calibration type
+	static std::size_t radialTerms( const Math::CameraIntrinsics< T >& intrinsics )
+	{
+		switch ( intrinsics.calib_type )
+		{
+			case Math::CameraIntrinsics< T >::OPENCV_2_2:
+				return 2;
+			case Math::CameraIntrinsics< T >::OPENCV_3_2:
+				return 3;
+			case Math::CameraIntrinsics< T >::OPENCV_4_0_FISHEYE:
+				UBITRACK_THROW( "Camera model does not support fish-eye distortion" );
+			default:
+				return 6;
+		}
+	}
+
+	// the packs are built on the stack, as SIMD types may require more alignment than the heap provides
+
+	template< std::size_t RadialTerms >
+	void projectImpl( const std::size_t n, const T* x, const T* y, const T* z, T* uOut, T* vOut ) const
+	{
+		const std::size_t i = internal::project_batch( internal::LensPack< Math::Util::simd_pack< T >, RadialTerms >( m_coefficients ), 0, n, x, y, z, uOut, vOut );
+		internal::project_batch( internal::LensPack< Math::Util::simd_scalar< T >, RadialTerms >( m_coefficients ), i, n, x, y, z, uOut, vOut );
+	}
+
+	template< std::size_t RadialTerms >
+	void distortImpl( const std::size_t n, const T* u, const T* v, T* uOut, T* vOut ) const
+	{
+		const std::size_t i = internal::distort_batch( internal::LensPack< Math::Util::simd_pack< T >, RadialTerms >( m_coefficients ), 0, n, u, v, uOut, vOut );
+		internal::distort_batch( internal::LensPack< Math::Util::simd_scalar< T >, RadialTerms >( m_coefficients ), i, n, u, v, uOut, vOut );
+	}
+
+	template< std::size_t RadialTerms >
+	void undistortImpl( const std::size_t n, const T* u, const T* v, T* uOut, T* vOut ) const
+	{
+		const std::size_t i = internal::undistort_batch( internal::LensPack< Math::Util::simd_pack< T >, RadialTerms >( m_coefficients ), 0, n, u, v, uOut, vOut, internal::undistortIterations, false );
+		internal::undistort_batch( internal::LensPack< Math::Util::simd_scalar< T >, RadialTerms >( m_coefficients ), i, n, u, v, uOut, vOut, internal::undistortIterations, false );
+	}
+
+	/// intrinsics the model was built for
+	Math::CameraIntrinsics< T > m_intrinsics;
+
+	/// coefficients of the lens and the intrinsic matrix
+	internal::LensCoefficients< T > m_coefficients;
+
+	/// number of radial terms of the kernels
+	std::size_t m_radialTerms;
+};
+
+}}} // namespace Ubitrack::Algorithm::CameraLens
+
+#endif	//__UBITRACK_ALGORITHM_CAMERALENS_CAMERAMODEL_H_INCLUDED__
@@ -33,10 +33,7 @@
 
 #include "Correction.h"
 #include "Distortion.h"
-
-#ifdef HAVE_LAPACK
 #include "Undistortion.h"
-#endif
 
 namespace Ubitrack { namespace Algorithm { namespace CameraLens {
 
@@ -60,10 +57,27 @@ void distort( const Ubitrack::Math::CameraIntrinsics< double >& mat, const std::
 {
 	distort_impl( mat, undistorted, distorted );	
 }
- 
 
-#ifdef HAVE_LAPACK
+void distort( const Ubitrack::Math::CameraIntrinsics< float >& mat, const std::size_t n, const float* u, const float* v, float* uOut, float* vOut )
+{
+	distort_impl( mat, n, u, v, uOut, vOut );
+}
+
+void distort( const Ubitrack::Math::CameraIntrinsics< double >& mat, const std::size_t n, const double* u, const double* v, double* uOut, double* vOut )
+{
+	distort_impl( mat, n, u, v, uOut, vOut );
+}
+
+void undistort( const Ubitrack::Math::CameraIntrinsics< float >& mat, const std::size_t n, const float* u, const float* v, float* uOut, float* vOut )
+{
+	undistort_impl( mat, n, u, v, uOut, vOut );
+}
 
+void undistort( const Ubitrack::Math::CameraIntrinsics< double >& mat, const std::size_t n, const double* u, const double* v, double* uOut, double* vOut )
+{
+	undistort_impl( mat, n, u, v, uOut, vOut );
+}
+ 
 
 void undistort( const Ubitrack::Math::CameraIntrinsics< float >& mat, const Math::Vector2f& distorted, Math::Vector2f& undistorted )
 {
@@ -85,6 +99,4 @@ void undistort( const Ubitrack::Math::CameraIntrinsics< double >& mat, const std
 	undistort_impl( mat, distorted, undistorted );
 }
 	
-#endif
-	
 }}} // namespace Ubitrack::Algorithm::CameraLens
\ No newline at end of file
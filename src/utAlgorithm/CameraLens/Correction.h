@@ -95,8 +95,65 @@ UBITRACK_EXPORT void distort( const Math::CameraIntrinsics< float >& intrinsics,
  */
 UBITRACK_EXPORT void distort( const Math::CameraIntrinsics< double >& intrinsics, const std::vector< Math::Vector2d >& undistorted, std::vector< Math::Vector2d >& distorted );
 
+/** 
+ * @brief overloaded function \c distort for \c n 2d points given as separate coordinate arrays with single precision parameters.
+ *
+ * Processes several points at once using the SIMD instructions of the target platform. The output arrays
+ * may be identical to the input arrays.
+ * For further information on this algorithm see void distort( const Math::CameraIntrinsics< float >& intrinsics, const Math::Vector2f& distorted, Math::Vector2f& undistorted );
+ *
+ * @param intrinsics camera intrinsics parameters including 3x3 intrinsic matrix and distortion parameters
+ * @param n number of points
+ * @param u,v arrays of the undistorted image coordinates
+ * @param uOut,vOut arrays receiving the distorted image coordinates
+ */
+UBITRACK_EXPORT void distort( const Math::CameraIntrinsics< float >& intrinsics, const std::size_t n, const float* u, const float* v, float* uOut, float* vOut );
+
+/** 
+ * @brief overloaded function \c distort for \c n 2d points given as separate coordinate arrays with double precision parameters.
+ *
+ * For further information on this algorithm see void distort( const Math::CameraIntrinsics< float >& intrinsics, const std::size_t n, const float* u, const float* v, float* uOut, float* vOut );
+ */
+UBITRACK_EXPORT void distort( const Math::CameraIntrinsics< double >& intrinsics, const std::size_t n, const double* u, const double* v, double* uOut, double* vOut );
+
+
+/**
+ * remove lens distortion from \c n 2d points given as separate coordinate arrays
+ *
+ * The inverse of the distortion function is computed by newton iterations, which process several points
+ * at once using the SIMD instructions of the target platform and stop when all of them have converged.
+ * The output arrays may be identical to the input arrays.
+ *
+ * For the distortion model see void distort( const Math::CameraIntrinsics< float >& intrinsics, const Math::Vector2f& undistorted, Math::Vector2f& distorted );
+ *
+ * @param intrinsics camera intrinsics parameters including 3x3 intrinsic matrix and distortion parameters
+ * @param n number of points
+ * @param u,v arrays of the distorted image coordinates
+ * @param uOut,vOut arrays receiving the undistorted image coordinates
+ */
+UBITRACK_EXPORT void undistort( const Math::CameraIntrinsics< float >& intrinsics, const std::size_t n, const float* u, const float* v, float* uOut, float* vOut );
+
+/** 
+ * @brief overloaded function \c undistort for separate coordinate arrays with double precision parameters.
+ *
+ * For further information on this algorithm see void undistort( const Math::CameraIntrinsics< float >& intrinsics, const std::size_t n, const float* u, const float* v, float* uOut, float* vOut );
+ */
+UBITRACK_EXPORT void undistort( const Math::CameraIntrinsics< double >& intrinsics, const std::size_t n, const double* u, const double* v, double* uOut, double* vOut );
+
+/** 
+ * @brief overloaded function \c undistort with \c for vectors of 2d points with single precision parameters.
+ *
+ * Uses the batch version void undistort( const Math::CameraIntrinsics< float >& intrinsics, const std::size_t n, const float* u, const float* v, float* uOut, float* vOut );
+ */
+UBITRACK_EXPORT void undistort( const Math::CameraIntrinsics< float >& intrinsics, const std::vector< Math::Vector2f >& distorted, std::vector< Math::Vector2f >& undistorted );
+
+/** 
+ * @brief overloaded function \c undistort with \c for vectors of 2d points with double precision parameters.
+ *
+ * Uses the batch version void undistort( const Math::CameraIntrinsics< float >& intrinsics, const std::size_t n, const float* u, const float* v, float* uOut, float* vOut );
+ */
+UBITRACK_EXPORT void undistort( const Math::CameraIntrinsics< double >& intrinsics, const std::vector< Math::Vector2d >& distorted, std::vector< Math::Vector2d >& undistorted );
 
-#ifdef HAVE_LAPACK
 
 /**
  * remove lens distortion to a point 
@@ -110,8 +167,10 @@ UBITRACK_EXPORT void distort( const Math::CameraIntrinsics< double >& intrinsics
  * a 6-vector containing the coefficients for the radial distortion ( k1, k2[, k3[, k4, k5, k6]]
  * a 2-vector containing the coefficients for the tangential distortion ( p1, p2 )
  * 
- * applies a non-linear optimization to the image points to approximate the undistorted image points. The optimization is based on the
- * distortion function explained in void distort( const Math::CameraIntrinsics< float >& intrinsics, const Math::Vector2f& undistorted, Math::Vector2f& distorted );
+ * inverts the distortion function explained in void distort( const Math::CameraIntrinsics< float >& intrinsics, const Math::Vector2f& undistorted, Math::Vector2f& distorted );
+ * by newton iterations with its analytic jacobian, starting at the inverse of the radial distortion up to r^4.
+ * The iteration stops as soon as the step is at the rounding level, which takes 2-3 iterations for
+ * most points of common lenses.
  *
  * @attention : There are overloaded versions of this function for \c double precision types and vectors of 2d-images points
  *
@@ -128,22 +187,6 @@ UBITRACK_EXPORT void undistort( const Math::CameraIntrinsics< float >& intrinsic
  * For further information on this algorithm see void undistort( const Math::CameraIntrinsics< float >& intrinsics, const Math::Vector2f& distorted, Math::Vector2f& undistorted );
  */
 UBITRACK_EXPORT void undistort( const Math::CameraIntrinsics< double >& intrinsics, const Math::Vector2d& distorted, Math::Vector2d& undistorted );
-
-/** 
- * @brief overloaded function \c undistort with \c for vectors of 2d points with single precision parameters.
- *
- * For further information on this algorithm see void undistort( const Math::CameraIntrinsics< float >& intrinsics, const Math::Vector2f& distorted, Math::Vector2f& undistorted );
- */
-UBITRACK_EXPORT void undistort( const Math::CameraIntrinsics< float >& intrinsics, const std::vector< Math::Vector2f >& distorted, std::vector< Math::Vector2f >& undistorted );
-
-/** 
- * @brief overloaded function \c undistort with \c for vectors of 2d points with double precision parameters.
- *
- * For further information on this algorithm see void undistort( const Math::CameraIntrinsics< float >& intrinsics, const Math::Vector2f& distorted, Math::Vector2f& undistorted );
- */
-UBITRACK_EXPORT void undistort( const Math::CameraIntrinsics< double >& intrinsics, const std::vector< Math::Vector2d >& distorted, std::vector< Math::Vector2d >& undistorted );
-	
-#endif
 	
 }}} // namespace Ubitrack::Algorithm::CameraLens
 
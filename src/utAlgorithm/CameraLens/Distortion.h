@@ -33,6 +33,9 @@
 #ifndef __UBITRACK_CALIBRATION_FUNCTION_CAMERALENS_DISTORTION_H_INCLUDED__
 #define __UBITRACK_CALIBRATION_FUNCTION_CAMERALENS_DISTORTION_H_INCLUDED__
 
+#include <vector>
+#include <utMath/CameraIntrinsics.h>
+#include <utMath/Util/simd_traits.h>
 
 namespace Ubitrack { namespace Algorithm { namespace CameraLens {
 	
@@ -96,6 +99,315 @@ namespace internal {
 		project_impl( camIntrin, distorted, distorted );
 	}
 
+	/**
+	 * @internal coefficients of the series inversion of the radial distortion up to r^4
+	 *
+	 * The ratio of the rational model is expanded to 1 + a r^2 + b r^4, the inverse of
+	 * r_d = r ( 1 + a r^2 + b r^4 ) is r = r_d ( 1 + c1 r_d^2 + c2 r_d^4 ) with c1 = -a and
+	 * c2 = 3 a^2 - b. The coefficients after \c radialTerms are treated as zero.
+	 */
+	template< class VT >
+	inline void inverse_radial_coefficients( const VT& radVec, const std::size_t radialTerms, typename VT::value_type& c1, typename VT::value_type& c2 )
+	{
+		typedef typename VT::value_type VType;
+		const VType k4 = radialTerms == 6 ? radVec( 3 ) : VType( 0 );
+		const VType k5 = radialTerms == 6 ? radVec( 4 ) : VType( 0 );
+		const VType a = radVec( 0 ) - k4;
+		const VType b = radVec( 1 ) - k5 - k4 * a;
+		c1 = -a;
+		c2 = 3 * a * a - b;
+	}
+
+	/**
+	 * @internal scalar coefficients of the lens model, computed once from the camera intrinsics
+	 *
+	 * Plain values, so they can be stored in objects without the alignment requirements of SIMD packs.
+	 */
+	template< typename T >
+	struct LensCoefficients
+	{
+		T k[ 6 ];
+		T p[ 2 ];
+		T fx, skew, cx, fy, cy;
+
+		/// the sign of K( 2, 2 ), which relates camera and sensor coordinates
+		T m22;
+
+		/// coefficients of the derivatives wrt. r^2 and the jacobian
+		T dk[ 6 ];
+		T twoP[ 2 ];
+		T sixP[ 2 ];
+
+		explicit LensCoefficients( const Math::CameraIntrinsics< T >& camIntrin )
+		{
+			const Math::Matrix< T, 3, 3 >& camMat = camIntrin.matrix;
+			for ( std::size_t i = 0; i < 6; i++ )
+			{
+				k[ i ] = camIntrin.radial_params( i );
+				dk[ i ] = T( i % 3 + 1 ) * camIntrin.radial_params( i );
+			}
+			for ( std::size_t i = 0; i < 2; i++ )
+			{
+				p[ i ] = camIntrin.tangential_params( i );
+				twoP[ i ] = 2 * camIntrin.tangential_params( i );
+				sixP[ i ] = 6 * camIntrin.tangential_params( i );
+			}
+			fx = camMat( 0, 0 );
+			skew = camMat( 0, 1 );
+			cx = camMat( 0, 2 ) * camMat( 2, 2 );
+			fy = camMat( 1, 1 );
+			cy = camMat( 1, 2 ) * camMat( 2, 2 );
+			m22 = camMat( 2, 2 );
+		}
+	};
+
+	/**
+	 * @internal camera intrinsics broadcast into SIMD packs
+	 *
+	 * Provides the same computations as \c unproject_impl, \c project_impl and \c distort_impl
+	 * for a whole pack of points at once, \c Pack is one of the \c Math::Util::simd_pack types.
+	 *
+	 * \c RadialTerms selects the radial model at compile time: 2 or 3 terms of the polynomial
+	 * in the numerator and no denominator, or all 6 coefficients of the rational model. The
+	 * terms that are left out are treated as zero.
+	 */
+	template< class Pack, std::size_t RadialTerms = 6 >
+	struct LensPack
+	{
+		typedef typename Pack::type pack_type;
+
+		pack_type k[ 6 ];
+		pack_type p[ 2 ];
+		pack_type fx, skew, cx, fy, cy, m22;
+		pack_type one, two;
+
+		/// coefficients of the derivatives wrt. r^2 and the jacobian
+		pack_type dk[ 6 ];
+		pack_type twoP[ 2 ];
+		pack_type sixP[ 2 ];
+
+		/// coefficients of the inverse radial series, see \c inverse_radial_coefficients
+		pack_type ik[ 2 ];
+
+		template< typename T >
+		explicit LensPack( const Math::CameraIntrinsics< T >& camIntrin )
+		{
+			set( LensCoefficients< T >( camIntrin ) );
+		}
+
+		template< typename T >
+		explicit LensPack( const LensCoefficients< T >& coeffs )
+		{
+			set( coeffs );
+		}
+
+		/// from image(pixel) to sensor coordinates
+		void unproject( const pack_type u, const pack_type v, pack_type& x, pack_type& y ) const
+		{
+			y = Pack::div( Pack::sub( v, cy ), fy );
+			x = Pack::div( Pack::sub( Pack::sub( u, Pack::mul( skew, y ) ), cx ), fx );
+		}
+
+		/// from sensor to image(pixel) coordinates
+		void project( const pack_type x, const pack_type y, pack_type& u, pack_type& v ) const
+		{
+			u = Pack::add( Pack::add( Pack::mul( x, fx ), Pack::mul( y, skew ) ), cx );
+			v = Pack::add( Pack::mul( y, fy ), cy );
+		}
+
+		/// from camera to sensor coordinates, i.e. the (undistorted) image point is the projection of the result
+		void dehomogenize( const pack_type x, const pack_type y, const pack_type z, pack_type& xOut, pack_type& yOut ) const
+		{
+			const pack_type w = Pack::mul( z, m22 );
+			xOut = Pack::div( x, w );
+			yOut = Pack::div( y, w );
+		}
+
+		/// radial and tangential distortion of sensor coordinates
+		void distort( const pack_type x, const pack_type y, pack_type& xOut, pack_type& yOut ) const
+		{
+			pack_type ratio, xx, yy, xy2, r2;
+			radial( x, y, ratio, xx, yy, xy2, r2 );
+			xOut = tangentialX( x, ratio, xx, xy2, r2 );
+			yOut = tangentialY( y, ratio, yy, xy2, r2 );
+		}
+
+		/// distortion of sensor coordinates including the jacobian wrt. the undistorted point
+		void distortWithJacobian( const pack_type x, const pack_type y, pack_type& xOut, pack_type& yOut
+			, pack_type& j00, pack_type& j01, pack_type& j10, pack_type& j11 ) const
+		{
+			pack_type ratio, xx, yy, xy2, r2;
+			const pack_type lower = radial( x, y, ratio, xx, yy, xy2, r2 );
+			xOut = tangentialX( x, ratio, xx, xy2, r2 );
+			yOut = tangentialY( y, ratio, yy, xy2, r2 );
+
+			// derivative of the radial ratio wrt. r^2
+			pack_type dUpper = Pack::add( dk[ 0 ], Pack::mul( dk[ 1 ], r2 ) );
+			if ( RadialTerms > 2 )
+				dUpper = Pack::add( dUpper, Pack::mul( dk[ 2 ], Pack::mul( r2, r2 ) ) );
+			// 2 * d(ratio)/d(r^2), as d(r^2)/dx = 2x
+			pack_type dRatio2;
+			if ( RadialTerms == 6 )
+			{
+				const pack_type r4 = Pack::mul( r2, r2 );
+				const pack_type dLower = Pack::add( Pack::add( dk[ 3 ], Pack::mul( dk[ 4 ], r2 ) ), Pack::mul( dk[ 5 ], r4 ) );
+				dRatio2 = Pack::mul( two, Pack::div( Pack::sub( dUpper, Pack::mul( ratio, dLower ) ), lower ) );
+			}
+			else
+				dRatio2 = Pack::mul( two, dUpper );
+
+			j00 = Pack::add( Pack::add( ratio, Pack::mul( dRatio2, xx ) ), Pack::add( Pack::mul( twoP[ 0 ], y ), Pack::mul( sixP[ 1 ], x ) ) );
+			j01 = Pack::add( Pack::mul( dRatio2, Pack::mul( x, y ) ), Pack::add( Pack::mul( twoP[ 0 ], x ), Pack::mul( twoP[ 1 ], y ) ) );
+			j10 = j01;
+			j11 = Pack::add( Pack::add( ratio, Pack::mul( dRatio2, yy ) ), Pack::add( Pack::mul( twoP[ 1 ], x ), Pack::mul( sixP[ 0 ], y ) ) );
+		}
+
+		/// approximate inverse of the radial distortion, the starting point of the newton iterations
+		void undistortGuess( const pack_type xd, const pack_type yd, pack_type& x, pack_type& y ) const
+		{
+			const pack_type r2 = Pack::add( Pack::mul( xd, xd ), Pack::mul( yd, yd ) );
+			const pack_type scale = Pack::add( one, Pack::mul( r2, Pack::add( ik[ 0 ], Pack::mul( ik[ 1 ], r2 ) ) ) );
+			x = Pack::mul( xd, scale );
+			y = Pack::mul( yd, scale );
+		}
+
+	protected:
+		/// broadcasts the coefficients
+		template< typename T >
+		void set( const LensCoefficients< T >& coeffs )
+		{
+			for ( std::size_t i = 0; i < 6; i++ )
+			{
+				k[ i ] = Pack::set1( coeffs.k[ i ] );
+				dk[ i ] = Pack::set1( coeffs.dk[ i ] );
+			}
+			for ( std::size_t i = 0; i < 2; i++ )
+			{
+				p[ i ] = Pack::set1( coeffs.p[ i ] );
+				twoP[ i ] = Pack::set1( coeffs.twoP[ i ] );
+				sixP[ i ] = Pack::set1( coeffs.sixP[ i ] );
+			}
+			fx = Pack::set1( coeffs.fx );
+			skew = Pack::set1( coeffs.skew );
+			cx = Pack::set1( coeffs.cx );
+			fy = Pack::set1( coeffs.fy );
+			cy = Pack::set1( coeffs.cy );
+			m22 = Pack::set1( coeffs.m22 );
+			T c1, c2;
+			inverse_radial_coefficients( Math::Vector< T, 6 >( coeffs.k ), RadialTerms, c1, c2 );
+			ik[ 0 ] = Pack::set1( c1 );
+			ik[ 1 ] = Pack::set1( c2 );
+			one = Pack::set1( T( 1 ) );
+			two = Pack::set1( T( 2 ) );
+		}
+
+		/// computes the radial distortion ratio and the common terms, returns the denominator of the ratio
+		pack_type radial( const pack_type x, const pack_type y, pack_type& ratio, pack_type& xx, pack_type& yy, pack_type& xy2, pack_type& r2 ) const
+		{
+			xx = Pack::mul( x, x );
+			xy2 = Pack::mul( Pack::mul( x, y ), two );
+			yy = Pack::mul( y, y );
+			r2 = Pack::add( xx, yy );
+			const pack_type r4 = Pack::mul( r2, r2 );
+			pack_type upper = Pack::add( Pack::add( one, Pack::mul( k[ 0 ], r2 ) ), Pack::mul( k[ 1 ], r4 ) );
+			if ( RadialTerms == 2 )
+			{
+				ratio = upper;
+				return one;
+			}
+
+			const pack_type r6 = Pack::mul( r4, r2 );
+			upper = Pack::add( upper, Pack::mul( k[ 2 ], r6 ) );
+			if ( RadialTerms == 3 )
+			{
+				ratio = upper;
+				return one;
+			}
+
+			const pack_type lower = Pack::add( Pack::add( Pack::add( one, Pack::mul( k[ 3 ], r2 ) ), Pack::mul( k[ 4 ], r4 ) ), Pack::mul( k[ 5 ], r6 ) );
+			ratio = Pack::div( upper, lower );
+			return lower;
+		}
+
+		pack_type tangentialX( const pack_type x, const pack_type ratio, const pack_type xx, const pack_type xy2, const pack_type r2 ) const
+		{
+			return Pack::add( Pack::add( Pack::mul( x, ratio ), Pack::mul( p[ 0 ], xy2 ) ), Pack::mul( p[ 1 ], Pack::add( r2, Pack::mul( xx, two ) ) ) );
+		}
+
+		pack_type tangentialY( const pack_type y, const pack_type ratio, const pack_type yy, const pack_type xy2, const pack_type r2 ) const
+		{
+			return Pack::add( Pack::add( Pack::mul( y, ratio ), Pack::mul( p[ 1 ], xy2 ) ), Pack::mul( p[ 0 ], Pack::add( r2, Pack::mul( yy, two ) ) ) );
+		}
+	};
+
+	/**
+	 * @internal distorts the points from index \c i on, stops before the last incomplete pack
+	 * @return index of the first point that was not processed
+	 */
+	template< class Pack, std::size_t RadialTerms, typename T >
+	std::size_t distort_batch( const LensPack< Pack, RadialTerms >& lens, std::size_t i, const std::size_t n, const T* u, const T* v, T* uOut, T* vOut )
+	{
+		typedef typename Pack::type pack_type;
+		for ( ; i + Pack::size <= n; i += Pack::size )
+		{
+			pack_type x, y, xd, yd;
+			lens.unproject( Pack::load( u + i ), Pack::load( v + i ), x, y );
+			lens.distort( x, y, xd, yd );
+			lens.project( xd, yd, x, y );
+			Pack::store( uOut + i, x );
+			Pack::store( vOut + i, y );
+		}
+		return i;
+	}
+
+	/**
+	 * @internal projects the 3d points in camera coordinates from index \c i on to distorted image
+	 * coordinates, stops before the last incomplete pack
+	 * @return index of the first point that was not processed
+	 */
+	template< class Pack, std::size_t RadialTerms, typename T >
+	std::size_t project_batch( const LensPack< Pack, RadialTerms >& lens, std::size_t i, const std::size_t n, const T* x, const T* y, const T* z, T* uOut, T* vOut )
+	{
+		typedef typename Pack::type pack_type;
+		for ( ; i + Pack::size <= n; i += Pack::size )
+		{
+			pack_type xs, ys, xd, yd;
+			lens.dehomogenize( Pack::load( x + i ), Pack::load( y + i ), Pack::load( z + i ), xs, ys );
+			lens.distort( xs, ys, xd, yd );
+			lens.project( xd, yd, xs, ys );
+			Pack::store( uOut + i, xs );
+			Pack::store( vOut + i, ys );
+		}
+		return i;
+	}
+
+	/// @internal copies 2d points into separate coordinate arrays
+	template< typename T, std::size_t N >
+	void split_points( const std::vector< Math::Vector< T, N > >& points, std::vector< T >& x, std::vector< T >& y )
+	{
+		const std::size_t n = points.size();
+		x.resize( n );
+		y.resize( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			x[ i ] = points[ i ]( 0 );
+			y[ i ] = points[ i ]( 1 );
+		}
+	}
+
+	/// @internal copies separate coordinate arrays back into 2d points
+	template< typename T, std::size_t N >
+	void merge_points( const std::vector< T >& x, const std::vector< T >& y, std::vector< Math::Vector< T, N > >& points )
+	{
+		const std::size_t n = x.size();
+		points.resize( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			points[ i ]( 0 ) = x[ i ];
+			points[ i ]( 1 ) = y[ i ];
+		}
+	}
+
 }	// namespsce ::internal 
 
 template< typename T, std::size_t N >
@@ -128,15 +440,29 @@ inline void distort_impl( const Math::CameraIntrinsics< T >& camIntrin,  const M
 }
 
 
+/// distorts \c n points given as separate coordinate arrays, the output may be identical to the input
+template< typename T >
+inline void distort_impl( const Math::CameraIntrinsics< T >& camIntrin, const std::size_t n, const T* u, const T* v, T* uOut, T* vOut )
+{
+	const std::size_t i = internal::distort_batch( internal::LensPack< Math::Util::simd_pack< T > >( camIntrin ), 0, n, u, v, uOut, vOut );
+	internal::distort_batch( internal::LensPack< Math::Util::simd_scalar< T > >( camIntrin ), i, n, u, v, uOut, vOut );
+}
+
+
 template< typename T, std::size_t N >
 inline void distort_impl( const Math::CameraIntrinsics< T > camIntrin, const std::vector< Math::Vector< T, N > >& pointsIn, std::vector< Math::Vector< T, N > >& result )
 {
-	typename std::vector< Math::Vector< T, N > >::const_iterator itBegin = pointsIn.begin();
-	const typename std::vector< Math::Vector< T, N > >::const_iterator itEnd = pointsIn.end();
-	/// @todo check here if same vector is used as output or another -> could be std::back_inserter than
-	typename std::vector< Math::Vector< T, N > >::iterator itOut = result.begin();
-	for( ; itBegin != itEnd; ++itBegin, ++itOut )
-		internal::distort_impl( camIntrin, *itBegin, *itOut );
+	if ( pointsIn.empty() )
+	{
+		result.clear();
+		return;
+	}
+
+	// the batch kernel works on separate coordinate arrays
+	std::vector< T > u, v;
+	internal::split_points( pointsIn, u, v );
+	distort_impl( camIntrin, u.size(), &u[ 0 ], &v[ 0 ], &u[ 0 ], &v[ 0 ] );
+	internal::merge_points( u, v, result );
 }
 
 
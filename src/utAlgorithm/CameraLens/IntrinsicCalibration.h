@@ -0,0 +1,571 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Calibration of the camera intrinsics and lens distortion from views of a calibration target.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_CAMERALENS_INTRINSICCALIBRATION_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_CAMERALENS_INTRINSICCALIBRATION_H_INCLUDED__
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include <utUtil/Exception.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+#include <utMath/CameraIntrinsics.h>
+#include <utMath/FixedDecomposition.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
+
+namespace Ubitrack { namespace Algorithm { namespace CameraLens {
+
+/**
+ * @ingroup tracking_algorithms
+ * Parameters of an \c IntrinsicCalibration.
+ */
+struct IntrinsicCalibrationParameter
+{
+	/**
+	 * @param maxIterations maximum number of levenberg-marquardt iterations
+	 * @param minImprovement relative decrease of the cost below which the optimization stops
+	 * @param bFixSkew keep the skew of the intrinsic matrix
+	 * @param bFixTangential keep the tangential distortion parameters
+	 */
+	IntrinsicCalibrationParameter( const std::size_t maxIterations = 50, const double minImprovement = 1e-10
+		, const bool bFixSkew = true, const bool bFixTangential = false )
+		: maxIterations( maxIterations )
+		, minImprovement( minImprovement )
+		, bFixSkew( bFixSkew )
+		, bFixTangential( bFixTangential )
+	{}
+
+	std::size_t maxIterations;
+	double minImprovement;
+	bool bFixSkew;
+	bool bFixTangential;
+};
+
+
+namespace internal {
+
+/// @internal plain least squares, the loss of an \c IntrinsicCalibration without robust loss
+struct SquaredLoss
+{
+	template< typename T >
+	T loss( const T s ) const
+	{ return s; }
+
+	template< typename T >
+	T weight( const T ) const
+	{ return T( 1 ); }
+};
+
+} // namespace internal
+
+
+/**
+ * @ingroup tracking_algorithms
+ * @brief Refines camera intrinsics, lens distortion and the poses of the views of a calibration target.
+ *
+ * Minimizes the reprojection error of the detected corners of all views over the intrinsic
+ * matrix, the radial and tangential distortion and one pose per view, using the distortion
+ * model of \c CameraModel. The radial parameters that are optimized follow the calibration
+ * type of the initial intrinsics, 2 or 3 for \c OPENCV_2_2 and \c OPENCV_3_2 and 6 otherwise.
+ *
+ * Every corner depends on the shared intrinsics and on the pose of its view only. The normal
+ * equations are therefore accumulated per view, and each levenberg-marquardt step eliminates
+ * the 6x6 pose blocks by the Schur complement, so only a 13x13 system for the intrinsics is
+ * solved and the effort grows linearly with the number of views. The views are evaluated in
+ * parallel by an optional \c Math::ListExecutor, and summed in a fixed order, so the result
+ * does not depend on the number of threads.
+ *
+ * Outlier corners are handled by iteratively reweighted least squares with one of the robust
+ * losses of \c Math::Optimization, e.g. \c HuberLoss or \c CauchyLoss, applied to the squared
+ * reprojection error of each corner in pixels.
+ *
+ * The poses map target coordinates to camera coordinates, with the target in front of the
+ * camera at negative z as in the rest of Ubitrack. Initial values are required, e.g. from a
+ * homography based initialization.
+ *
+ * @code
+ * IntrinsicCalibration< double > calibration( targetPoints, imagePoints );
+ * calibration.optimize( intrinsics, poses, Math::Optimization::HuberLoss( 2.0 ), IntrinsicCalibrationParameter(), Math::threadExecutor() );
+ * @endcode
+ */
+template< typename T >
+class IntrinsicCalibration
+{
+public:
+	/** number of intrinsic parameters: fx, skew, cx, fy, cy, 6 radial and 2 tangential */
+	static const std::size_t cameraSize = 13;
+
+	/**
+	 * Constructor.
+	 * @param objectPoints for every view the corners in target coordinates
+	 * @param imagePoints for every view the detected corners in image coordinates
+	 */
+	IntrinsicCalibration( const std::vector< std::vector< Math::Vector< T, 3 > > >& objectPoints
+		, const std::vector< std::vector< Math::Vector< T, 2 > > >& imagePoints )
+		: m_iterations( 0 )
+		, m_rmsError( 0 )
+	{
+		if ( objectPoints.size() != imagePoints.size() )
+			UBITRACK_THROW( "Intrinsic calibration requires the same number of views for target and image points" );
+
+		m_viewOffsets.push_back( 0 );
+		for ( std::size_t v = 0; v < objectPoints.size(); v++ )
+		{
+			if ( objectPoints[ v ].size() != imagePoints[ v ].size() )
+				UBITRACK_THROW( "Intrinsic calibration requires the same number of target and image points per view" );
+			for ( std::size_t i = 0; i < objectPoints[ v ].size(); i++ )
+			{
+				m_objectPoints.push_back( Math::Vector< double, 3 >( objectPoints[ v ][ i ]( 0 ), objectPoints[ v ][ i ]( 1 ), objectPoints[ v ][ i ]( 2 ) ) );
+				m_imagePoints.push_back( Math::Vector< double, 2 >( imagePoints[ v ][ i ]( 0 ), imagePoints[ v ][ i ]( 1 ) ) );
+			}
+			m_viewOffsets.push_back( m_objectPoints.size() );
+		}
+	}
+
+	/** @return the number of views */
+	std::size_t viewCount() const
+	{ return m_viewOffsets.size() - 1; }
+
+	/** @return the number of corners of all views */
+	std::size_t cornerCount() const
+	{ return m_objectPoints.size(); }
+
+	/** @return the number of iterations of the last optimization */
+	std::size_t iterations() const
+	{ return m_iterations; }
+
+	/** @return the root mean square reprojection error of all corners after the last optimization, in pixels */
+	double rmsError() const
+	{ return m_rmsError; }
+
+	/**
+	 * refines the intrinsics and the poses with a robust loss
+	 *
+	 * @param intrinsics initial intrinsics on entry, optimized intrinsics on exit
+	 * @param poses initial poses of the views on entry, optimized poses on exit
+	 * @param loss robust loss of the squared reprojection error of a corner
+	 * @param params parameters of the optimization
+	 * @param executor distributes the views over threads, see \c Math::threadExecutor
+	 * @return the final sum of the losses
+	 */
+	template< class Loss >
+	double optimize( Math::CameraIntrinsics< T >& intrinsics, std::vector< Math::Pose >& poses, const Loss& loss
+		, const IntrinsicCalibrationParameter& params = IntrinsicCalibrationParameter()
+		, const Math::ListExecutor& executor = Math::ListExecutor() );
+
+	/** refines the intrinsics and the poses by least squares, see the robust version */
+	double optimize( Math::CameraIntrinsics< T >& intrinsics, std::vector< Math::Pose >& poses
+		, const IntrinsicCalibrationParameter& params = IntrinsicCalibrationParameter()
+		, const Math::ListExecutor& executor = Math::ListExecutor() )
+	{ return optimize( intrinsics, poses, internal::SquaredLoss(), params, executor ); }
+
+protected:
+	typedef Math::Vector< double, cameraSize > CameraVector;
+
+	/** normal equations of the corners of one view */
+	struct ViewBlocks
+	{
+		Math::Matrix< double, cameraSize, cameraSize > cameraHessian;
+		Math::Matrix< double, cameraSize, 6 > crossHessian;
+		Math::Matrix< double, 6, 6 > poseHessian;
+		Math::Vector< double, cameraSize > cameraGradient;
+		Math::Vector< double, 6 > poseGradient;
+	};
+
+	/** evaluates the views [ begin, end ), with the normal equations if \c pBlocks is set */
+	template< class Loss >
+	struct ViewTask
+	{
+		const IntrinsicCalibration* pSelf;
+		const Loss* pLoss;
+		const CameraVector* pCamera;
+		double m22;
+		const std::vector< Math::Pose >* pPoses;
+		const CameraVector* pMask;
+		std::vector< ViewBlocks >* pBlocks;
+		std::vector< double >* pCost;
+		std::vector< double >* pSquaredError;
+
+		void operator()( const std::size_t begin, const std::size_t end ) const
+		{
+			for ( std::size_t v = begin; v < end; v++ )
+				pSelf->evaluateView( v, *pLoss, *pCamera, m22, ( *pPoses )[ v ], *pMask
+					, pBlocks ? &( *pBlocks )[ v ] : 0, ( *pCost )[ v ], ( *pSquaredError )[ v ] );
+		}
+	};
+
+	/** runs a \c ViewTask over all views and sums the losses and the squared errors in the order of the views */
+	template< class Task >
+	static void runViews( const Task& task, const Math::ListExecutor& executor, const std::vector< double >& viewCost
+		, const std::vector< double >& viewError, double& cost, double& squaredError )
+	{
+		if ( executor.empty() )
+			task( 0, viewCost.size() );
+		else
+			executor( viewCost.size(), task );
+
+		cost = squaredError = 0;
+		for ( std::size_t v = 0; v < viewCost.size(); v++ )
+		{
+			cost += viewCost[ v ];
+			squaredError += viewError[ v ];
+		}
+	}
+
+	template< class Loss >
+	void evaluateView( std::size_t v, const Loss& loss, const CameraVector& camera, double m22, const Math::Pose& pose
+		, const CameraVector& mask, ViewBlocks* pBlocks, double& cost, double& squaredError ) const;
+
+	/// corners of all views, view v has [ offsets[ v ], offsets[ v + 1 ] )
+	std::vector< Math::Vector< double, 3 > > m_objectPoints;
+	std::vector< Math::Vector< double, 2 > > m_imagePoints;
+	std::vector< std::size_t > m_viewOffsets;
+
+	/// statistics of the last optimization
+	std::size_t m_iterations;
+	double m_rmsError;
+};
+
+
+template< typename T >
+template< class Loss >
+void IntrinsicCalibration< T >::evaluateView( const std::size_t v, const Loss& loss, const CameraVector& camera, const double m22
+	, const Math::Pose& pose, const CameraVector& mask, ViewBlocks* pBlocks, double& cost, double& squaredError ) const
+{
+	const double fx = camera( 0 ), skew = camera( 1 ), cx = camera( 2 ), fy = camera( 3 ), cy = camera( 4 );
+	const double* k = &camera( 5 );
+	const double p0 = camera( 11 ), p1 = camera( 12 );
+
+	Math::Matrix< double, 3, 3 > rot;
+	pose.rotation().toMatrix( rot );
+	const Math::Vector< double, 3 >& t( pose.translation() );
+
+	if ( pBlocks )
+	{
+		pBlocks->cameraHessian = Math::Matrix< double, cameraSize, cameraSize >::zeros();
+		pBlocks->crossHessian = Math::Matrix< double, cameraSize, 6 >::zeros();
+		pBlocks->poseHessian = Math::Matrix< double, 6, 6 >::zeros();
+		pBlocks->cameraGradient = Math::Vector< double, cameraSize >::zeros();
+		pBlocks->poseGradient = Math::Vector< double, 6 >::zeros();
+	}
+	cost = 0;
+	squaredError = 0;
+
+	for ( std::size_t i = m_viewOffsets[ v ]; i < m_viewOffsets[ v + 1 ]; i++ )
+	{
+		// target point in camera and sensor coordinates
+		const Math::Vector< double, 3 >& X( m_objectPoints[ i ] );
+		double a[ 3 ], p[ 3 ];
+		for ( std::size_t r = 0; r < 3; r++ )
+		{
+			a[ r ] = rot( r, 0 ) * X( 0 ) + rot( r, 1 ) * X( 1 ) + rot( r, 2 ) * X( 2 );
+			p[ r ] = a[ r ] + t( r );
+		}
+		const double w = p[ 2 ] * m22;
+		const double xs = p[ 0 ] / w;
+		const double ys = p[ 1 ] / w;
+
+		// distortion as in CameraModel
+		const double xx = xs * xs, yy = ys * ys, xy2 = 2 * xs * ys;
+		const double r2 = xx + yy, r4 = r2 * r2, r6 = r4 * r2;
+		const double upper = 1 + k[ 0 ] * r2 + k[ 1 ] * r4 + k[ 2 ] * r6;
+		const double lower = 1 + k[ 3 ] * r2 + k[ 4 ] * r4 + k[ 5 ] * r6;
+		const double ratio = upper / lower;
+		const double xd = xs * ratio + p0 * xy2 + p1 * ( r2 + 2 * xx );
+		const double yd = ys * ratio + p1 * xy2 + p0 * ( r2 + 2 * yy );
+
+		const double eu = m_imagePoints[ i ]( 0 ) - ( fx * xd + skew * yd + cx );
+		const double ev = m_imagePoints[ i ]( 1 ) - ( fy * yd + cy );
+		const double s = eu * eu + ev * ev;
+		cost += loss.loss( s );
+		squaredError += s;
+		if ( !pBlocks )
+			continue;
+
+		const double weight = loss.weight( s );
+		if ( weight == 0 )
+			continue;
+
+		// jacobian wrt. the intrinsics
+		double jc[ 2 ][ cameraSize ] = { { xd, yd, 1, 0, 0 }, { 0, 0, 0, yd, 1 } };
+		double rPow = r2;
+		for ( std::size_t j = 0; j < 3; j++, rPow *= r2 )
+		{
+			const double dUpper = rPow / lower;
+			const double dLower = -ratio * rPow / lower;
+			jc[ 0 ][ 5 + j ] = fx * xs * dUpper + skew * ys * dUpper;
+			jc[ 1 ][ 5 + j ] = fy * ys * dUpper;
+			jc[ 0 ][ 8 + j ] = fx * xs * dLower + skew * ys * dLower;
+			jc[ 1 ][ 8 + j ] = fy * ys * dLower;
+		}
+		jc[ 0 ][ 11 ] = fx * xy2 + skew * ( r2 + 2 * yy );
+		jc[ 1 ][ 11 ] = fy * ( r2 + 2 * yy );
+		jc[ 0 ][ 12 ] = fx * ( r2 + 2 * xx ) + skew * xy2;
+		jc[ 1 ][ 12 ] = fy * xy2;
+		for ( std::size_t j = 0; j < cameraSize; j++ )
+		{
+			jc[ 0 ][ j ] *= mask( j );
+			jc[ 1 ][ j ] *= mask( j );
+		}
+
+		// jacobian of the distortion wrt. the sensor coordinates
+		const double dUpper = k[ 0 ] + 2 * k[ 1 ] * r2 + 3 * k[ 2 ] * r4;
+		const double dLower = k[ 3 ] + 2 * k[ 4 ] * r2 + 3 * k[ 5 ] * r4;
+		const double dRatio2 = 2 * ( dUpper - ratio * dLower ) / lower;
+		const double j00 = ratio + dRatio2 * xx + 2 * p0 * ys + 6 * p1 * xs;
+		const double j01 = dRatio2 * xs * ys + 2 * p0 * xs + 2 * p1 * ys;
+		const double j11 = ratio + dRatio2 * yy + 2 * p1 * xs + 6 * p0 * ys;
+
+		// image wrt. sensor coordinates
+		const double d00 = fx * j00 + skew * j01;
+		const double d01 = fx * j01 + skew * j11;
+		const double d10 = fy * j01;
+		const double d11 = fy * j11;
+
+		// image wrt. camera coordinates
+		const double e[ 2 ][ 3 ] = {
+			{ d00 / w, d01 / w, -( d00 * xs + d01 * ys ) / p[ 2 ] },
+			{ d10 / w, d11 / w, -( d10 * xs + d11 * ys ) / p[ 2 ] } };
+
+		// jacobian wrt. the pose update, a rotation vector applied from the left and a translation
+		double jp[ 2 ][ 6 ];
+		for ( std::size_t r = 0; r < 2; r++ )
+		{
+			// e * -[ a ]_x
+			jp[ r ][ 0 ] = e[ r ][ 2 ] * a[ 1 ] - e[ r ][ 1 ] * a[ 2 ];
+			jp[ r ][ 1 ] = e[ r ][ 0 ] * a[ 2 ] - e[ r ][ 2 ] * a[ 0 ];
+			jp[ r ][ 2 ] = e[ r ][ 1 ] * a[ 0 ] - e[ r ][ 0 ] * a[ 1 ];
+			jp[ r ][ 3 ] = e[ r ][ 0 ];
+			jp[ r ][ 4 ] = e[ r ][ 1 ];
+			jp[ r ][ 5 ] = e[ r ][ 2 ];
+		}
+
+		// weighted normal equations, upper triangles of the diagonal blocks
+		const double res[ 2 ] = { weight * eu, weight * ev };
+		for ( std::size_t r = 0; r < cameraSize; r++ )
+		{
+			const double wc0 = weight * jc[ 0 ][ r ], wc1 = weight * jc[ 1 ][ r ];
+			for ( std::size_t c = r; c < cameraSize; c++ )
+				pBlocks->cameraHessian( r, c ) += wc0 * jc[ 0 ][ c ] + wc1 * jc[ 1 ][ c ];
+			for ( std::size_t c = 0; c < 6; c++ )
+				pBlocks->crossHessian( r, c ) += wc0 * jp[ 0 ][ c ] + wc1 * jp[ 1 ][ c ];
+			pBlocks->cameraGradient( r ) += jc[ 0 ][ r ] * res[ 0 ] + jc[ 1 ][ r ] * res[ 1 ];
+		}
+		for ( std::size_t r = 0; r < 6; r++ )
+		{
+			for ( std::size_t c = r; c < 6; c++ )
+				pBlocks->poseHessian( r, c ) += weight * ( jp[ 0 ][ r ] * jp[ 0 ][ c ] + jp[ 1 ][ r ] * jp[ 1 ][ c ] );
+			pBlocks->poseGradient( r ) += jp[ 0 ][ r ] * res[ 0 ] + jp[ 1 ][ r ] * res[ 1 ];
+		}
+	}
+}
+
+
+template< typename T >
+template< class Loss >
+double IntrinsicCalibration< T >::optimize( Math::CameraIntrinsics< T >& intrinsics, std::vector< Math::Pose >& poses, const Loss& loss
+	, const IntrinsicCalibrationParameter& params, const Math::ListExecutor& executor )
+{
+	const std::size_t nViews = viewCount();
+	if ( poses.size() != nViews )
+		UBITRACK_THROW( "Intrinsic calibration requires one initial pose per view" );
+
+	// free radial parameters from the calibration type
+	std::size_t radialTerms = 6;
+	switch ( intrinsics.calib_type )
+	{
+		case Math::CameraIntrinsics< T >::OPENCV_2_2: radialTerms = 2; break;
+		case Math::CameraIntrinsics< T >::OPENCV_3_2: radialTerms = 3; break;
+		case Math::CameraIntrinsics< T >::OPENCV_4_0_FISHEYE: UBITRACK_THROW( "Intrinsic calibration does not support fish-eye distortion" );
+		default: break;
+	}
+
+	CameraVector mask;
+	for ( std::size_t j = 0; j < cameraSize; j++ )
+		mask( j ) = 1;
+	for ( std::size_t j = radialTerms; j < 6; j++ )
+		mask( 5 + j ) = 0;
+	if ( params.bFixSkew )
+		mask( 1 ) = 0;
+	if ( params.bFixTangential )
+		mask( 11 ) = mask( 12 ) = 0;
+
+	// parameters in the form of CameraModel: principal point multiplied with K( 2, 2 )
+	const Math::Matrix< T, 3, 3 >& K( intrinsics.matrix );
+	const double m22 = K( 2, 2 );
+	CameraVector camera;
+	camera( 0 ) = K( 0, 0 );
+	camera( 1 ) = K( 0, 1 );
+	camera( 2 ) = K( 0, 2 ) * m22;
+	camera( 3 ) = K( 1, 1 );
+	camera( 4 ) = K( 1, 2 ) * m22;
+	for ( std::size_t j = 0; j < 6; j++ )
+		camera( 5 + j ) = mask( 5 + j ) ? double( intrinsics.radial_params( j ) ) : 0.0;
+	camera( 11 ) = intrinsics.tangential_params( 0 );
+	camera( 12 ) = intrinsics.tangential_params( 1 );
+
+	std::vector< ViewBlocks > blocks( nViews );
+	std::vector< double > viewCost( nViews );
+	std::vector< double > viewError( nViews );
+	std::vector< Math::Pose > newPoses( poses );
+	std::vector< Math::Matrix< double, 6, 6 > > poseInverse( nViews );
+	std::vector< Math::Vector< double, 6 > > poseStep( nViews );
+
+	ViewTask< Loss > task = { this, &loss, &camera, m22, &poses, &mask, &blocks, &viewCost, &viewError };
+	CameraVector newCamera;
+	ViewTask< Loss > costTask = { this, &loss, &newCamera, m22, &newPoses, &mask, 0, &viewCost, &viewError };
+
+	double cost, squaredError;
+	runViews( task, executor, viewCost, viewError, cost, squaredError );
+
+	double lambda = 1e-3;
+	m_iterations = 0;
+	bool bDone = nViews == 0;
+	while ( !bDone && m_iterations < params.maxIterations )
+	{
+		m_iterations++;
+
+		// reduced system of the intrinsics, lower triangle
+		Math::Matrix< double, cameraSize, cameraSize > reduced( Math::Matrix< double, cameraSize, cameraSize >::zeros() );
+		CameraVector rhs( CameraVector::zeros() );
+		for ( std::size_t v = 0; v < nViews; v++ )
+		{
+			for ( std::size_t r = 0; r < cameraSize; r++ )
+				for ( std::size_t c = r; c < cameraSize; c++ )
+					reduced( c, r ) += blocks[ v ].cameraHessian( r, c );
+			rhs += blocks[ v ].cameraGradient;
+		}
+		for ( std::size_t j = 0; j < cameraSize; j++ )
+			reduced( j, j ) += lambda * reduced( j, j );
+
+		// eliminate the poses
+		bool bSingular = false;
+		for ( std::size_t v = 0; v < nViews && !bSingular; v++ )
+		{
+			Math::Matrix< double, 6, 6 >& inv( poseInverse[ v ] );
+			for ( std::size_t r = 0; r < 6; r++ )
+				for ( std::size_t c = r; c < 6; c++ )
+					inv( c, r ) = blocks[ v ].poseHessian( r, c );
+			for ( std::size_t j = 0; j < 6; j++ )
+				inv( j, j ) += lambda * inv( j, j );
+			if ( !Math::choleskyInvert( inv ) )
+			{
+				bSingular = true;
+				break;
+			}
+
+			const Math::Matrix< double, cameraSize, 6 > factor( boost::numeric::ublas::prod( blocks[ v ].crossHessian, inv ) );
+			for ( std::size_t r = 0; r < cameraSize; r++ )
+			{
+				for ( std::size_t c = 0; c <= r; c++ )
+				{
+					double sum = 0;
+					for ( std::size_t j = 0; j < 6; j++ )
+						sum += factor( r, j ) * blocks[ v ].crossHessian( c, j );
+					reduced( r, c ) -= sum;
+				}
+				for ( std::size_t j = 0; j < 6; j++ )
+					rhs( r ) -= factor( r, j ) * blocks[ v ].poseGradient( j );
+			}
+		}
+
+		// fixed parameters keep their values
+		for ( std::size_t j = 0; j < cameraSize; j++ )
+			if ( !mask( j ) )
+			{
+				for ( std::size_t c = 0; c < cameraSize; c++ )
+					reduced( j, c ) = reduced( c, j ) = 0;
+				reduced( j, j ) = 1;
+				rhs( j ) = 0;
+			}
+
+		if ( bSingular || !Math::choleskySolve( reduced, rhs ) )
+		{
+			lambda *= 10;
+			bDone = lambda > 1e10;
+			continue;
+		}
+
+		// back-substitute the pose steps and apply the update
+		newCamera = camera + rhs;
+		for ( std::size_t v = 0; v < nViews; v++ )
+		{
+			Math::Vector< double, 6 > g( blocks[ v ].poseGradient );
+			for ( std::size_t r = 0; r < 6; r++ )
+				for ( std::size_t c = 0; c < cameraSize; c++ )
+					g( r ) -= blocks[ v ].crossHessian( c, r ) * rhs( c );
+			poseStep[ v ] = boost::numeric::ublas::prod( poseInverse[ v ], g );
+
+			const Math::Vector< double, 3 > omega( poseStep[ v ]( 0 ), poseStep[ v ]( 1 ), poseStep[ v ]( 2 ) );
+			const Math::Vector< double, 3 > dt( poseStep[ v ]( 3 ), poseStep[ v ]( 4 ), poseStep[ v ]( 5 ) );
+			Math::Quaternion rotation( Math::Quaternion::fromLogarithm( omega ) * poses[ v ].rotation() );
+			newPoses[ v ] = Math::Pose( rotation.normalize(), poses[ v ].translation() + dt );
+		}
+
+		double newCost, newError;
+		runViews( costTask, executor, viewCost, viewError, newCost, newError );
+		if ( !( newCost < cost ) )
+		{
+			lambda *= 10;
+			bDone = lambda > 1e10;
+			continue;
+		}
+
+		const double improvement = ( cost - newCost ) / std::max( cost, std::numeric_limits< double >::min() );
+		camera = newCamera;
+		poses.swap( newPoses );
+		lambda = std::max( lambda / 10, 1e-12 );
+		bDone = improvement < params.minImprovement;
+
+		// linearize at the new parameters
+		runViews( task, executor, viewCost, viewError, cost, squaredError );
+		newPoses = poses;
+	}
+
+	// back to the intrinsics
+	intrinsics.matrix( 0, 0 ) = T( camera( 0 ) );
+	intrinsics.matrix( 0, 1 ) = T( camera( 1 ) );
+	intrinsics.matrix( 0, 2 ) = T( camera( 2 ) * m22 );
+	intrinsics.matrix( 1, 1 ) = T( camera( 3 ) );
+	intrinsics.matrix( 1, 2 ) = T( camera( 4 ) * m22 );
+	for ( std::size_t j = 0; j < 6; j++ )
+		intrinsics.radial_params( j ) = T( camera( 5 + j ) );
+	intrinsics.tangential_params( 0 ) = T( camera( 11 ) );
+	intrinsics.tangential_params( 1 ) = T( camera( 12 ) );
+
+	m_rmsError = cornerCount() ? std::sqrt( squaredError / cornerCount() ) : 0;
+	return cost;
+}
+
+}}} // namespace Ubitrack::Algorithm::CameraLens
+
+#endif	//__UBITRACK_ALGORITHM_CAMERALENS_INTRINSICCALIBRATION_H_INCLUDED__
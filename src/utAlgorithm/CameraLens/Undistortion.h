@@ -36,9 +36,7 @@
 #include "Distortion.h"
 #include <utMath/CameraIntrinsics.h>
 
-#ifdef HAVE_LAPACK
-#include <utMath/Optimization/LevenbergMarquardt.h>
-#endif
+#include <limits>
 
 namespace Ubitrack { namespace Algorithm { namespace CameraLens {
 
@@ -195,18 +193,140 @@ public:
 		// J( 1, 1 ) = (k2*pow(x*x+y*y,2)+k3*pow(x*x+y*y,3)+k1*(x*x+y*y)+1)/(k5*pow(x*x+y*y,2)+k6*pow(x*x+y*y,3)+k4*(x*x+y*y)+1)+p2*x*2+p1*y*6+(y*(k1*y*2+k2*y*(x*x+y*y)*4+k3*y*pow(x*x+y*y,2)*6))/(k5*pow(x*x+y*y,2)+k6*pow(x*x+y*y,3)+k4*(x*x+y*y)+1)-y*(k4*y*2+k5*y*(x*x+y*y)*4+k6*y*pow(x*x+y*y,2)*6)*(k2*pow(x*x+y*y,2)+k3*pow(x*x+y*y,3)+k1*(x*x+y*y)+1)*1/pow(k5*pow(x*x+y*y,2)+k6*pow(x*x+y*y,3)+k4*(x*x+y*y)+1,2);
 	}
 };
+
+/// @internal maximum number of newton iterations used by the undistortion
+static const std::size_t undistortIterations = 20;
+
+/**
+ * @internal squared length of a newton step in sensor coordinates below which the undistortion
+ * of a point has converged, a few units in the last place of \c T
+ */
+template< typename T >
+inline T undistortTolerance()
+{
+	const T eps = 16 * std::numeric_limits< T >::epsilon();
+	return eps * eps;
+}
+
+/**
+ * @internal removes the distortion from the points starting at index \c i by newton iterations
+ *
+ * Solves distort( x ) = x_d for each point with the analytic jacobian of the distortion. A pack stops
+ * iterating when the steps of all its points are below \c undistortTolerance, after at most
+ * \c iterations steps. If \c useGuess is set, the iteration starts at the (undistorted) image
+ * points given in \c uOut and \c vOut, which then must not alias the input, otherwise at the
+ * inverse of the radial distortion up to r^4, which is already close except for strong distortion.
+ *
+ * @return index of the first point that was not processed
+ */
+template< class Pack, std::size_t RadialTerms, typename T >
+std::size_t undistort_batch( const LensPack< Pack, RadialTerms >& lens, std::size_t i, const std::size_t n, const T* u, const T* v, T* uOut, T* vOut
+	, const std::size_t iterations, const bool useGuess )
+{
+	typedef typename Pack::type pack_type;
+	const T tolerance = undistortTolerance< T >();
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		pack_type xd, yd, x, y;
+		lens.unproject( Pack::load( u + i ), Pack::load( v + i ), xd, yd );
+		if ( useGuess )
+			lens.unproject( Pack::load( uOut + i ), Pack::load( vOut + i ), x, y );
+		else
+			lens.undistortGuess( xd, yd, x, y );
+
+		for ( std::size_t it = 0; it < iterations; it++ )
+		{
+			pack_type fx, fy, j00, j01, j10, j11;
+			lens.distortWithJacobian( x, y, fx, fy, j00, j01, j10, j11 );
+			const pack_type rx = Pack::sub( xd, fx );
+			const pack_type ry = Pack::sub( yd, fy );
+
+			// solve the 2x2 system J * delta = r
+			const pack_type det = Pack::sub( Pack::mul( j00, j11 ), Pack::mul( j01, j10 ) );
+			const pack_type dx = Pack::div( Pack::sub( Pack::mul( j11, rx ), Pack::mul( j01, ry ) ), det );
+			const pack_type dy = Pack::div( Pack::sub( Pack::mul( j00, ry ), Pack::mul( j10, rx ) ), det );
+			x = Pack::add( x, dx );
+			y = Pack::add( y, dy );
+
+			// converged if the longest step of the pack is small
+			T steps[ Pack::size ];
+			Pack::store( steps, Pack::add( Pack::mul( dx, dx ), Pack::mul( dy, dy ) ) );
+			bool bConverged = true;
+			for ( std::size_t k = 0; k < Pack::size; k++ )
+				bConverged = bConverged && steps[ k ] <= tolerance;
+			if ( bConverged )
+				break;
+		}
+
+		lens.project( x, y, xd, yd );
+		Pack::store( uOut + i, xd );
+		Pack::store( vOut + i, yd );
+	}
+	return i;
+}
+
 }	// namespace ::internal
 
-#ifdef HAVE_LAPACK
+/// undistorts \c n points given as separate coordinate arrays, the output may be identical to the input
+template< typename T >
+inline void undistort_impl( const Math::CameraIntrinsics< T >& camIntrin, const std::size_t n, const T* u, const T* v, T* uOut, T* vOut )
+{
+	const std::size_t i = internal::undistort_batch( internal::LensPack< Math::Util::simd_pack< T > >( camIntrin ), 0, n, u, v, uOut, vOut, internal::undistortIterations, false );
+	internal::undistort_batch( internal::LensPack< Math::Util::simd_scalar< T > >( camIntrin ), i, n, u, v, uOut, vOut, internal::undistortIterations, false );
+}
 
+template< typename T, std::size_t N >
+inline void undistort_impl( const Math::CameraIntrinsics< T > camIntrin, const std::vector< Math::Vector< T, N > >& pointsIn, std::vector< Math::Vector< T, N > >& result )
+{
+	if ( pointsIn.empty() )
+	{
+		result.clear();
+		return;
+	}
+
+	// the batch kernel works on separate coordinate arrays
+	std::vector< T > u, v;
+	internal::split_points( pointsIn, u, v );
+	undistort_impl( camIntrin, u.size(), &u[ 0 ], &v[ 0 ], &u[ 0 ], &v[ 0 ] );
+	internal::merge_points( u, v, result );
+}
+
+/**
+ * removes the distortion from a point in sensor coordinates by newton iterations with the analytic
+ * jacobian of \c internal::PointUndistortion, starting at the inverse of the radial distortion up
+ * to r^4 and stopping as soon as the step is below \c internal::undistortTolerance.
+ */
 template< typename T, std::size_t N >
 void undistort_impl( const Math::Vector< T, 6 >& radVector, const Math::Vector< T, 2 >& tanVector, const Math::Vector< T, N >& distorted, Math::Vector< T, N >& undistorted )
 {
-	// non-linear minimization
-	Math::Vector< T, N > tmp = ( distorted );
-	internal::PointUndistortion< T > distFunc( radVector, tanVector );
-	Math::Optimization::levenbergMarquardt( distFunc, tmp, distorted, Math::Optimization::OptTerminate( 5, 1e-5 ), Math::Optimization::OptNoNormalize() );
-	undistorted = tmp;
+	const internal::PointUndistortion< T > distFunc( radVector, tanVector );
+	const T xd = distorted( 0 );
+	const T yd = distorted( 1 );
+
+	T c1, c2;
+	internal::inverse_radial_coefficients( radVector, 6, c1, c2 );
+	const T r2 = xd * xd + yd * yd;
+	const T scale = 1 + r2 * ( c1 + c2 * r2 );
+	Math::Vector< T, 2 > x( xd * scale, yd * scale );
+
+	const T tolerance = internal::undistortTolerance< T >();
+	Math::Vector< T, 2 > f;
+	Math::Matrix< T, 2, 2 > J;
+	for ( std::size_t it = 0; it < internal::undistortIterations; it++ )
+	{
+		distFunc.evaluateWithJacobian( f, x, J );
+		const T rx = xd - f( 0 );
+		const T ry = yd - f( 1 );
+		const T det = J( 0, 0 ) * J( 1, 1 ) - J( 0, 1 ) * J( 1, 0 );
+		const T dx = ( J( 1, 1 ) * rx - J( 0, 1 ) * ry ) / det;
+		const T dy = ( J( 0, 0 ) * ry - J( 1, 0 ) * rx ) / det;
+		x( 0 ) += dx;
+		x( 1 ) += dy;
+		if ( dx * dx + dy * dy <= tolerance )
+			break;
+	}
+	undistorted( 0 ) = x( 0 );
+	undistorted( 1 ) = x( 1 );
 }
 
 template< typename T >
@@ -223,19 +343,6 @@ void undistort_impl( const Math::CameraIntrinsics< T >& mat, const Math::Vector<
 	internal::project_impl( mat, undistorted, undistorted );
 }
 
-template< typename T, std::size_t N >
-inline void undistort_impl( const Math::CameraIntrinsics< T > camIntrin, const std::vector< Math::Vector< T, N > >& pointsIn, std::vector< Math::Vector< T, N > >& result )
-{
-	typename std::vector< Math::Vector< T, N > >::const_iterator itBegin = pointsIn.begin();
-	const typename std::vector< Math::Vector< T, N > >::const_iterator itEnd = pointsIn.end();
-	/// @todo check here if same vector is used as output or another -> could be std::back_inserter than
-	typename std::vector< Math::Vector< T, N > >::iterator itOut = result.begin();
-	for( ; itBegin != itEnd; ++itBegin, ++itOut )
-		undistort_impl( camIntrin, *itBegin, *itOut );
-}
-
-#endif
-
 }}} // namespace Ubitrack::Algorithm::CameraLens
 
 #endif //__UBITRACK_CALIBRATION_FUNCTION_CAMERALENS_UNDISTORTION_H_INCLUDED__
@@ -0,0 +1,229 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Precomputed lookup grid for lens undistortion.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_CAMERALENS_UNDISTORTIONGRID_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_CAMERALENS_UNDISTORTIONGRID_H_INCLUDED__
+
+#include <vector>
+#include <cmath>
+
+#include <utUtil/Exception.h>
+#include <utMath/Vector.h>
+#include <utMath/CameraIntrinsics.h>
+
+#include "Distortion.h"
+#include "Undistortion.h"
+
+namespace Ubitrack { namespace Algorithm { namespace CameraLens {
+
+/**
+ * @ingroup tracking_algorithms
+ * @brief Lookup grid to undistort many points of the same camera.
+ *
+ * The undistorted positions of the nodes of a regular grid over the (distorted) image are computed once.
+ * A point is undistorted by bilinear interpolation between the four surrounding nodes, followed by
+ * a small number of newton iterations that refine the interpolated position. Points outside of the
+ * image are undistorted by the full iterative method.
+ *
+ * The grid has to be built by \c update, which only recomputes it if the intrinsics have changed:
+ * @verbatim
+ UndistortionGrid< double > grid;
+ ...
+ grid.update( intrinsics ); // cheap if the intrinsics are the same as before
+ grid.undistort( distortedPoints, undistortedPoints );
+ @endverbatim
+ */
+template< typename T >
+class UndistortionGrid
+{
+public:
+	/**
+	 * Constructor.
+	 * @param cellSize distance of the grid nodes in pixels
+	 * @param refinements number of newton iterations after the interpolation
+	 */
+	explicit UndistortionGrid( const std::size_t cellSize = 16, const std::size_t refinements = 1 )
+		: m_cellSize( cellSize )
+		, m_refinements( refinements )
+		, m_cols( 0 )
+		, m_rows( 0 )
+		, m_version( 0 )
+	{}
+
+	/**
+	 * builds the grid for the given intrinsics, unless it was built for the same intrinsics already
+	 *
+	 * The grid covers the image given by \c intrinsics.dimension.
+	 * @return true if the grid was (re)built
+	 */
+	bool update( const Math::CameraIntrinsics< T >& intrinsics )
+	{
+		if ( valid() && sameIntrinsics( intrinsics ) )
+			return false;
+
+		if ( intrinsics.dimension( 0 ) == 0 || intrinsics.dimension( 1 ) == 0 )
+			UBITRACK_THROW( "Undistortion grid requires the image dimension of the camera intrinsics" );
+
+		m_intrinsics = intrinsics;
+		m_version = m_intrinsics.version();
+		m_cols = ( intrinsics.dimension( 0 ) + m_cellSize - 1 ) / m_cellSize + 1;
+		m_rows = ( intrinsics.dimension( 1 ) + m_cellSize - 1 ) / m_cellSize + 1;
+
+		std::vector< T > u( m_cols * m_rows );
+		std::vector< T > v( m_cols * m_rows );
+		for ( std::size_t r = 0; r < m_rows; r++ )
+			for ( std::size_t c = 0; c < m_cols; c++ )
+			{
+				u[ r * m_cols + c ] = T( c * m_cellSize );
+				v[ r * m_cols + c ] = T( r * m_cellSize );
+			}
+
+		m_gridU.resize( u.size() );
+		m_gridV.resize( v.size() );
+		undistort_impl( m_intrinsics, u.size(), &u[ 0 ], &v[ 0 ], &m_gridU[ 0 ], &m_gridV[ 0 ] );
+		return true;
+	}
+
+	/** @return true if the grid has been built */
+	bool valid() const
+	{ return m_cols != 0; }
+
+	/** @return the intrinsics the grid was built for */
+	const Math::CameraIntrinsics< T >& intrinsics() const
+	{ return m_intrinsics; }
+
+	/**
+	 * removes the lens distortion from \c n points given as separate coordinate arrays
+	 *
+	 * @param n number of points
+	 * @param u,v arrays of the distorted image coordinates
+	 * @param uOut,vOut arrays receiving the undistorted image coordinates, must not be identical to the input
+	 */
+	void undistort( const std::size_t n, const T* u, const T* v, T* uOut, T* vOut ) const
+	{
+		if ( !valid() )
+			UBITRACK_THROW( "Undistortion grid has not been built" );
+
+		// interpolated starting points
+		std::vector< std::size_t > outside;
+		for ( std::size_t i = 0; i < n; i++ )
+			if ( !interpolate( u[ i ], v[ i ], uOut[ i ], vOut[ i ] ) )
+				outside.push_back( i );
+
+		// refinement
+		typedef Math::Util::simd_pack< T > Pack;
+		typedef Math::Util::simd_scalar< T > Scalar;
+		const internal::LensPack< Scalar > scalarLens( m_intrinsics );
+		const std::size_t i = internal::undistort_batch( internal::LensPack< Pack >( m_intrinsics ), 0, n, u, v, uOut, vOut, m_refinements, true );
+		internal::undistort_batch( scalarLens, i, n, u, v, uOut, vOut, m_refinements, true );
+
+		// points outside of the grid
+		for ( std::vector< std::size_t >::const_iterator it = outside.begin(); it != outside.end(); ++it )
+			internal::undistort_batch( scalarLens, *it, *it + 1, u, v, uOut, vOut, internal::undistortIterations, false );
+	}
+
+	/**
+	 * removes the lens distortion from a vector of points
+	 *
+	 * @param distorted distorted 2d image points
+	 * @param undistorted receives the undistorted image points, may be identical to \c distorted
+	 */
+	void undistort( const std::vector< Math::Vector< T, 2 > >& distorted, std::vector< Math::Vector< T, 2 > >& undistorted ) const
+	{
+		if ( distorted.empty() )
+		{
+			undistorted.clear();
+			return;
+		}
+
+		std::vector< T > u, v;
+		internal::split_points( distorted, u, v );
+		std::vector< T > uOut( u.size() );
+		std::vector< T > vOut( v.size() );
+		undistort( u.size(), &u[ 0 ], &v[ 0 ], &uOut[ 0 ], &vOut[ 0 ] );
+		internal::merge_points( uOut, vOut, undistorted );
+	}
+
+protected:
+	/// bilinear interpolation of the undistorted position, returns false if the point is outside of the grid
+	bool interpolate( const T u, const T v, T& uOut, T& vOut ) const
+	{
+		const T gu = u / m_cellSize;
+		const T gv = v / m_cellSize;
+		if ( !( gu >= 0 && gv >= 0 && gu < T( m_cols - 1 ) && gv < T( m_rows - 1 ) ) )
+		{
+			uOut = u;
+			vOut = v;
+			return false;
+		}
+
+		const std::size_t c = static_cast< std::size_t >( gu );
+		const std::size_t r = static_cast< std::size_t >( gv );
+		const T a = gu - c;
+		const T b = gv - r;
+		const std::size_t i00 = r * m_cols + c;
+		const std::size_t i10 = i00 + m_cols;
+
+		uOut = ( 1 - b ) * ( ( 1 - a ) * m_gridU[ i00 ] + a * m_gridU[ i00 + 1 ] ) + b * ( ( 1 - a ) * m_gridU[ i10 ] + a * m_gridU[ i10 + 1 ] );
+		vOut = ( 1 - b ) * ( ( 1 - a ) * m_gridV[ i00 ] + a * m_gridV[ i00 + 1 ] ) + b * ( ( 1 - a ) * m_gridV[ i10 ] + a * m_gridV[ i10 + 1 ] );
+		return true;
+	}
+
+	/// compares the given intrinsics to those of the grid, by version first and by value for separately built intrinsics
+	bool sameIntrinsics( const Math::CameraIntrinsics< T >& intrinsics ) const
+	{
+		if ( intrinsics.version() == m_version )
+			return true;
+		return m_intrinsics.derived()->matches( intrinsics );
+	}
+
+	/// distance of the grid nodes in pixels
+	std::size_t m_cellSize;
+
+	/// number of newton iterations after the interpolation
+	std::size_t m_refinements;
+
+	/// number of grid nodes in each direction
+	std::size_t m_cols;
+	std::size_t m_rows;
+
+	/// undistorted image coordinates of the grid nodes, row by row
+	std::vector< T > m_gridU;
+	std::vector< T > m_gridV;
+
+	/// intrinsics the grid was built for
+	Math::CameraIntrinsics< T > m_intrinsics;
+
+	/// version of the intrinsics the grid was built for
+	std::size_t m_version;
+};
+
+}}} // namespace Ubitrack::Algorithm::CameraLens
+
+#endif	//__UBITRACK_ALGORITHM_CAMERALENS_UNDISTORTIONGRID_H_INCLUDED__
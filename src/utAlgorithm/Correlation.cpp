@@ -9,6 +9,7 @@
 
 #include "Correlation.h"
 #include <utMath/Stochastic/Correlation.h>
+#include <utMath/Stochastic/CrossCorrelation.h>
 
 namespace Ubitrack { namespace Algorithm {
 
@@ -22,5 +23,17 @@ double computeCorrelation ( const std::vector< double >& left,
 	return Math::Stochastic::correlation( left.begin(), left.end(), right.begin(), right.end() );
 }
 
+double estimateTimeOffset ( const std::vector< double >& left,
+							const std::vector< double >& right,
+							std::size_t maxLag, double* correlation )
+{
+	// require half of the shorter signal to overlap, so short overlaps at the borders do not win
+	const std::size_t minOverlap = std::max< std::size_t >( 2, std::min( left.size(), right.size() ) / 2 );
+
+	std::vector< double > correlations;
+	Math::Stochastic::crossCorrelation( left, right, maxLag, correlations, minOverlap );
+	return Math::Stochastic::correlationPeak( correlations, correlation ) - double( maxLag );
+}
+
 } } // namespace Ubitrack::Algorithm
 
@@ -21,6 +21,21 @@ namespace Ubitrack { namespace Algorithm {
 UBITRACK_EXPORT double computeCorrelation ( const std::vector< double >& left,
 											const std::vector< double >& right);
 
+/**
+ * Estimates the temporal offset between two equally sampled signals, e.g. the speeds measured by an IMU and
+ * an optical tracker, as the lag of the maximal normalized cross-correlation. All lags are computed at once by
+ * an FFT, and the maximum is interpolated to sub-sample accuracy.
+ *
+ * @param left first signal
+ * @param right second signal, a positive offset means that it lags behind \c left
+ * @param maxLag largest absolute offset in samples that is considered
+ * @param correlation if not 0, receives the correlation at the estimated offset
+ * @return the offset in samples
+ */
+UBITRACK_EXPORT double estimateTimeOffset ( const std::vector< double >& left,
+											const std::vector< double >& right,
+											std::size_t maxLag, double* correlation = 0 );
+
 }}; // namespace Ubitrack::Algorithm
 
 #endif // __UBITRACK_ALGORITHM_CORRELATION_H_INCLUDED__
@@ -0,0 +1,174 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Solver for the homogeneous linear systems of the DLT estimators.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_DIRECT_LINEAR_TRANSFORM_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_DIRECT_LINEAR_TRANSFORM_H_INCLUDED__
+
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/FixedDecomposition.h>
+
+namespace Ubitrack { namespace Algorithm {
+
+/**
+ * @internal Least squares solution of a homogeneous system <tt>A x = 0</tt> with \c N unknowns
+ * and <tt>|x| = 1</tt>, as it appears in the DLT estimation of homographies, projection and
+ * fundamental matrices.
+ *
+ * Instead of storing the 2n x N design matrix and decomposing it by a SVD, the rows are
+ * accumulated into the fixed-size normal matrix <tt>A^T A</tt>, whose eigenvector of the smallest
+ * eigenvalue is the smallest right singular vector of \c A. Only this eigenvector is computed, by
+ * inverse iteration, with a complete Jacobi eigen decomposition as fallback. Accumulation and
+ * solution need no memory that depends on the number of points, and the rows are only touched once.
+ *
+ * Forming the normal matrix squares the condition number, so the rows should be built from
+ * normalized points (see \c Math::Geometry::estimateNormalizationParameters). The accumulation
+ * is always done in double precision, also for \c float points.
+ */
+template< std::size_t N >
+class HomogeneousLinearSystem
+{
+public:
+	HomogeneousLinearSystem()
+		: m_ata( Math::Matrix< double, N, N >::zeros() )
+	{}
+
+	/** adds the equation <tt>row^T x = 0</tt>, zero entries of \c row are skipped */
+	void addRow( const double* row )
+	{
+		// only the upper triangle is used by the eigen solver
+		for ( std::size_t i = 0; i < N; i++ )
+		{
+			const double ri = row[ i ];
+			if ( ri == 0 )
+				continue;
+			for ( std::size_t j = i; j < N; j++ )
+				m_ata( i, j ) += ri * row[ j ];
+		}
+	}
+
+	/**
+	 * computes the unit vector \c x that minimizes <tt>|A x|</tt>, the sign is arbitrary
+	 * @return false if the eigen decomposition did not converge
+	 */
+	template< typename T >
+	bool solve( Math::Vector< T, N >& x ) const
+	{
+		Math::Vector< double, N > v;
+		const bool bConverged = inverseIteration( v ) || smallestEigenvector( v );
+		for ( std::size_t i = 0; i < N; i++ )
+			x( i ) = static_cast< T >( v( i ) );
+		return bConverged;
+	}
+
+protected:
+	/**
+	 * inverse iteration with the cholesky factor of the normal matrix, which converges within a
+	 * few steps as the smallest eigenvalue is well separated for normalized points. The shift keeps
+	 * the factorization defined for exact data, where the smallest eigenvalue is zero.
+	 * @return false if the iteration did not converge, e.g. for degenerate configurations
+	 */
+	bool inverseIteration( Math::Vector< double, N >& v ) const
+	{
+		double trace = 0;
+		for ( std::size_t i = 0; i < N; i++ )
+			trace += m_ata( i, i );
+		if ( !( trace > 0 ) )
+			return false;
+
+		Math::Matrix< double, N, N > l;
+		for ( std::size_t i = 0; i < N; i++ )
+			for ( std::size_t j = i; j < N; j++ )
+				l( j, i ) = m_ata( i, j );
+		for ( std::size_t i = 0; i < N; i++ )
+			l( i, i ) += 1e-12 * trace;
+		if ( !Math::cholesky( l, l ) )
+			return false;
+
+		for ( std::size_t i = 0; i < N; i++ )
+			v( i ) = 1 / std::sqrt( double( N ) );
+
+		for ( std::size_t iter = 0; iter < 20; iter++ )
+		{
+			// y = ( L L^T )^-1 v
+			Math::Vector< double, N > y;
+			for ( std::size_t i = 0; i < N; i++ )
+			{
+				double s = v( i );
+				for ( std::size_t k = 0; k < i; k++ )
+					s -= l( i, k ) * y( k );
+				y( i ) = s / l( i, i );
+			}
+			for ( std::size_t i = N; i-- > 0; )
+			{
+				double s = y( i );
+				for ( std::size_t k = i + 1; k < N; k++ )
+					s -= l( k, i ) * y( k );
+				y( i ) = s / l( i, i );
+			}
+
+			double norm = 0;
+			double dot = 0;
+			for ( std::size_t i = 0; i < N; i++ )
+			{
+				norm += y( i ) * y( i );
+				dot += y( i ) * v( i );
+			}
+			const double scale = ( dot < 0 ? -1 : 1 ) / std::sqrt( norm );
+			double change = 0;
+			for ( std::size_t i = 0; i < N; i++ )
+			{
+				const double yi = y( i ) * scale;
+				change = std::max( change, std::fabs( yi - v( i ) ) );
+				v( i ) = yi;
+			}
+			if ( change <= 1e-10 )
+				return true;
+		}
+		return false;
+	}
+
+	/** eigenvector of the smallest eigenvalue by a complete eigen decomposition */
+	bool smallestEigenvector( Math::Vector< double, N >& v ) const
+	{
+		Math::Matrix< double, N, N > a( m_ata );
+		Math::Vector< double, N > w;
+		const bool bConverged = Math::symmetricEigen( a, w );
+		for ( std::size_t i = 0; i < N; i++ )
+			v( i ) = a( i, 0 );
+		return bConverged;
+	}
+
+	/** upper triangle of the normal matrix */
+	Math::Matrix< double, N, N > m_ata;
+};
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // __UBITRACK_ALGORITHM_DIRECT_LINEAR_TRANSFORM_H_INCLUDED__
@@ -0,0 +1,129 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Off-axis projections of static screens for tracked viewers
+ */
+
+#include "DisplayProjection.h"
+
+#include <cmath>
+
+namespace Ubitrack { namespace Algorithm {
+
+DisplayProjection::DisplayProjection()
+{
+	Math::Vector< double, 3 > zero( Math::Vector< double, 3 >::zeros() );
+	Math::Vector< double, 3 > x( zero ), y( zero );
+	x( 0 ) = y( 1 ) = 1;
+	init( zero, y, x, 0.1, 100, 1, 1 );
+}
+
+
+DisplayProjection::DisplayProjection( const Math::Vector< double, 3 >& ll, const Math::Vector< double, 3 >& ul,
+	const Math::Vector< double, 3 >& lr, double n, double f, double sw, double sh )
+{
+	init( ll, ul, lr, n, f, sw, sh );
+}
+
+
+DisplayProjection::DisplayProjection( const Math::Vector< double, 3 >& ll, const Math::Vector< double, 3 >& ul,
+	const Math::Vector< double, 3 >& lr, double n, double f )
+{
+	init( ll, ul, lr, n, f, boost::numeric::ublas::norm_2( lr - ll ), boost::numeric::ublas::norm_2( ul - ll ) );
+}
+
+
+void DisplayProjection::init( const Math::Vector< double, 3 >& ll, const Math::Vector< double, 3 >& ul,
+	const Math::Vector< double, 3 >& lr, double n, double f, double sw, double sh )
+{
+	m_width = sw;
+	m_height = sh;
+	m_invWidth = 1 / sw;
+	m_invHeight = 1 / sh;
+
+	// the screen frame of offAxisProjectionMatrix
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		m_axes[ 0 ][ i ] = ( lr( i ) - ll( i ) ) * m_invWidth;
+		m_axes[ 1 ][ i ] = ( ul( i ) - ll( i ) ) * m_invHeight;
+	}
+	const double ( &x )[ 3 ] = m_axes[ 0 ];
+	const double ( &y )[ 3 ] = m_axes[ 1 ];
+	m_axes[ 2 ][ 0 ] = x[ 1 ] * y[ 2 ] - x[ 2 ] * y[ 1 ];
+	m_axes[ 2 ][ 1 ] = x[ 2 ] * y[ 0 ] - x[ 0 ] * y[ 2 ];
+	m_axes[ 2 ][ 2 ] = x[ 0 ] * y[ 1 ] - x[ 1 ] * y[ 0 ];
+
+	for ( std::size_t a = 0; a < 3; a++ )
+		m_origin[ a ] = m_axes[ a ][ 0 ] * ll( 0 ) + m_axes[ a ][ 1 ] * ll( 1 ) + m_axes[ a ][ 2 ] * ll( 2 );
+
+	m_depthScale = -( f + n ) / ( f - n );
+	m_depthOffset = -( 2 * f * n ) / ( f - n );
+}
+
+
+void DisplayProjection::matrix( const Math::Vector< double, 3 >& eye, Math::Matrix< double, 4, 4 >& result ) const
+{
+	// eye in the screen frame, the view matrix has the rows ( axis, -p )
+	double p[ 3 ];
+	for ( std::size_t a = 0; a < 3; a++ )
+		p[ a ] = m_axes[ a ][ 0 ] * eye( 0 ) + m_axes[ a ][ 1 ] * eye( 1 ) + m_axes[ a ][ 2 ] * eye( 2 );
+	const double distance = p[ 2 ] - m_origin[ 2 ];
+
+	// the frustum of offAxisProjectionMatrix, with the near plane cancelled out
+	const double sx = 2 * distance * m_invWidth;
+	const double sy = 2 * distance * m_invHeight;
+	const double ox = 1 - 2 * ( p[ 0 ] - m_origin[ 0 ] ) * m_invWidth;
+	const double oy = 1 - 2 * ( p[ 1 ] - m_origin[ 1 ] ) * m_invHeight;
+
+	const double ( &x )[ 3 ] = m_axes[ 0 ];
+	const double ( &y )[ 3 ] = m_axes[ 1 ];
+	const double ( &z )[ 3 ] = m_axes[ 2 ];
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		result( 0, i ) = sx * x[ i ] + ox * z[ i ];
+		result( 1, i ) = sy * y[ i ] + oy * z[ i ];
+		result( 2, i ) = m_depthScale * z[ i ];
+		result( 3, i ) = -z[ i ];
+	}
+	result( 0, 3 ) = -sx * p[ 0 ] - ox * p[ 2 ];
+	result( 1, 3 ) = -sy * p[ 1 ] - oy * p[ 2 ];
+	result( 2, 3 ) = -m_depthScale * p[ 2 ] + m_depthOffset;
+	result( 3, 3 ) = p[ 2 ];
+}
+
+
+void DisplayProjection::matrices( const std::vector< DisplayProjection >& screens, const Math::Vector< double, 3 >& leftEye,
+	const Math::Vector< double, 3 >& rightEye, std::vector< Math::Matrix< double, 4, 4 > >& result )
+{
+	result.resize( 2 * screens.size() );
+	for ( std::size_t i = 0; i < screens.size(); i++ )
+	{
+		screens[ i ].matrix( leftEye, result[ 2 * i ] );
+		screens[ i ].matrix( rightEye, result[ 2 * i + 1 ] );
+	}
+}
+
+} } // namespace Ubitrack::Algorithm
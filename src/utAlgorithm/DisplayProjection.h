@@ -0,0 +1,116 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Off-axis projections of static screens for tracked viewers
+ */
+
+#ifndef __UBITRACK_ALGORITHM_DISPLAYPROJECTION_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_DISPLAYPROJECTION_H_INCLUDED__
+
+#include <vector>
+
+#include <utCore.h>
+#include <utMath/Matrix.h>
+#include <utMath/Vector.h>
+
+namespace Ubitrack { namespace Algorithm {
+
+/**
+ * @ingroup tracking_algorithms
+ * Off-axis projection of a static screen, e.g. a CAVE wall or a projector screen, for a
+ * moving eye. Computes the same matrices as \c offAxisProjectionMatrix, but the screen frame
+ * is computed once in the constructor, so each eye only costs three dot products and a few
+ * multiplications to fill in the matrix.
+ *
+ * The object is not modified after construction, so several threads, e.g. the render thread
+ * and the tracking thread, can use it at the same time without locks.
+ */
+class UBITRACK_EXPORT DisplayProjection
+{
+public:
+	/** default constructor, needed for containers. The matrices are undefined. */
+	DisplayProjection();
+
+	/**
+	 * constructor
+	 * @param ll lower left corner of the screen
+	 * @param ul upper left corner of the screen
+	 * @param lr lower right corner of the screen
+	 * @param n near clipping plane
+	 * @param f far clipping plane
+	 * @param sw screen width
+	 * @param sh screen height
+	 */
+	DisplayProjection( const Math::Vector< double, 3 >& ll, const Math::Vector< double, 3 >& ul,
+		const Math::Vector< double, 3 >& lr, double n, double f, double sw, double sh );
+
+	/** constructor, the screen size is the distance between the corners */
+	DisplayProjection( const Math::Vector< double, 3 >& ll, const Math::Vector< double, 3 >& ul,
+		const Math::Vector< double, 3 >& lr, double n, double f );
+
+	/** computes the projection matrix for an eye, including the view transformation */
+	void matrix( const Math::Vector< double, 3 >& eye, Math::Matrix< double, 4, 4 >& result ) const;
+
+	/** \c matrix returning the result */
+	Math::Matrix< double, 4, 4 > matrix( const Math::Vector< double, 3 >& eye ) const
+	{
+		Math::Matrix< double, 4, 4 > result;
+		matrix( eye, result );
+		return result;
+	}
+
+	/**
+	 * computes the matrices of several screens for a stereo viewer. The result is resized to
+	 * twice the number of screens and holds the left and right eye matrix of screen i at
+	 * 2 i and 2 i + 1, so it does not allocate if it is reused for the next frame.
+	 */
+	static void matrices( const std::vector< DisplayProjection >& screens, const Math::Vector< double, 3 >& leftEye,
+		const Math::Vector< double, 3 >& rightEye, std::vector< Math::Matrix< double, 4, 4 > >& result );
+
+protected:
+	void init( const Math::Vector< double, 3 >& ll, const Math::Vector< double, 3 >& ul,
+		const Math::Vector< double, 3 >& lr, double n, double f, double sw, double sh );
+
+	/// screen axes, scaled by the inverse screen size, and their normal
+	double m_axes[ 3 ][ 3 ];
+
+	/// products of the axes with the lower left corner
+	double m_origin[ 3 ];
+
+	/// screen size and its inverse
+	double m_width;
+	double m_height;
+	double m_invWidth;
+	double m_invHeight;
+
+	/// depth part of the projection
+	double m_depthScale;
+	double m_depthOffset;
+};
+
+} } // namespace Ubitrack::Algorithm
+
+#endif
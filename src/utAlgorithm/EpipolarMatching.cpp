@@ -0,0 +1,232 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implementation of the epipolar correspondence search.
+ */
+
+#include "EpipolarMatching.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <boost/math/constants/constants.hpp>
+
+namespace Ubitrack { namespace Algorithm {
+
+namespace {
+
+/// @internal the ratio of the distance from the epipole to maxDistance below which points are always tested
+static const double nearEpipoleRatio = 10;
+
+/// @internal angle of a direction, folded to [ 0, pi ) as lines have no orientation
+inline double lineAngle( const double dx, const double dy )
+{
+	double angle = std::atan2( dy, dx );
+	if ( angle < 0 )
+		angle += boost::math::constants::pi< double >();
+	if ( angle >= boost::math::constants::pi< double >() )
+		angle = 0;
+	return angle;
+}
+
+} // anonymous namespace
+
+
+template< typename T >
+EpipolarMatcher< T >::EpipolarMatcher( const Math::Matrix< T, 3, 3 >& F, const std::vector< Math::Vector< T, 2 > >& toPoints, const T maxDistance )
+	: m_toPoints( toPoints )
+	, m_maxDistance( maxDistance )
+	, m_bEpipoleAtInfinity( false )
+	, m_window( 0 )
+{
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			m_F( i, j ) = F( i, j );
+
+	// the epipole e' with F^T e' = 0 is orthogonal to all columns of F
+	double bestNorm = -1;
+	for ( std::size_t k = 0; k < 3; k++ )
+	{
+		const std::size_t a = ( k + 1 ) % 3, b = ( k + 2 ) % 3;
+		Math::Vector< double, 3 > e;
+		e( 0 ) = m_F( 1, a ) * m_F( 2, b ) - m_F( 2, a ) * m_F( 1, b );
+		e( 1 ) = m_F( 2, a ) * m_F( 0, b ) - m_F( 0, a ) * m_F( 2, b );
+		e( 2 ) = m_F( 0, a ) * m_F( 1, b ) - m_F( 1, a ) * m_F( 0, b );
+		const double norm = e( 0 ) * e( 0 ) + e( 1 ) * e( 1 ) + e( 2 ) * e( 2 );
+		if ( norm > bestNorm )
+		{
+			bestNorm = norm;
+			m_epipole = e;
+		}
+	}
+
+	const double dirNorm = std::sqrt( m_epipole( 0 ) * m_epipole( 0 ) + m_epipole( 1 ) * m_epipole( 1 ) );
+	m_bEpipoleAtInfinity = std::fabs( m_epipole( 2 ) ) <= 1e-12 * dirNorm;
+
+	m_keys.reserve( m_toPoints.size() );
+	if ( m_bEpipoleAtInfinity )
+	{
+		// parallel lines, the key is the offset along their normal
+		m_epipole( 0 ) /= dirNorm;
+		m_epipole( 1 ) /= dirNorm;
+		m_epipole( 2 ) = 0;
+		for ( std::size_t i = 0; i < m_toPoints.size(); i++ )
+			m_keys.push_back( std::make_pair( -m_epipole( 1 ) * m_toPoints[ i ]( 0 ) + m_epipole( 0 ) * m_toPoints[ i ]( 1 ), i ) );
+	}
+	else
+	{
+		m_epipole /= m_epipole( 2 );
+		const double nearRadius = nearEpipoleRatio * m_maxDistance;
+		m_window = std::asin( 1 / nearEpipoleRatio );
+		for ( std::size_t i = 0; i < m_toPoints.size(); i++ )
+		{
+			const double dx = m_toPoints[ i ]( 0 ) - m_epipole( 0 );
+			const double dy = m_toPoints[ i ]( 1 ) - m_epipole( 1 );
+			if ( dx * dx + dy * dy < nearRadius * nearRadius )
+				m_nearEpipole.push_back( i );
+			else
+				m_keys.push_back( std::make_pair( lineAngle( dx, dy ), i ) );
+		}
+	}
+	std::sort( m_keys.begin(), m_keys.end() );
+}
+
+
+template< typename T >
+void EpipolarMatcher< T >::searchKeys( const double lower, const double upper, std::vector< std::size_t >& indices ) const
+{
+	typedef std::vector< std::pair< double, std::size_t > >::const_iterator Iterator;
+	const Iterator itEnd = m_keys.end();
+	for ( Iterator it = std::lower_bound( m_keys.begin(), itEnd, std::make_pair( lower, std::size_t( 0 ) ) );
+		it != itEnd && it->first <= upper; ++it )
+		indices.push_back( it->second );
+}
+
+
+template< typename T >
+void EpipolarMatcher< T >::findCandidates( const Math::Vector< T, 2 >& from, std::vector< std::size_t >& indices ) const
+{
+	// epipolar line l' = F x
+	double l[ 3 ];
+	for ( std::size_t i = 0; i < 3; i++ )
+		l[ i ] = m_F( i, 0 ) * from( 0 ) + m_F( i, 1 ) * from( 1 ) + m_F( i, 2 );
+	const double normalSq = l[ 0 ] * l[ 0 ] + l[ 1 ] * l[ 1 ];
+	if ( !( normalSq > 0 ) )
+		return;
+
+	const std::size_t nIndices = indices.size();
+	if ( m_bEpipoleAtInfinity )
+	{
+		// offset of the line along the normal ( -e_y, e_x ) of the line direction
+		const double offset = -l[ 2 ] * ( -m_epipole( 1 ) * l[ 0 ] + m_epipole( 0 ) * l[ 1 ] ) / normalSq;
+		searchKeys( offset - m_maxDistance, offset + m_maxDistance, indices );
+	}
+	else
+	{
+		const double pi = boost::math::constants::pi< double >();
+		const double angle = lineAngle( l[ 1 ], -l[ 0 ] );
+		searchKeys( std::max( angle - m_window, 0.0 ), std::min( angle + m_window, pi ), indices );
+		if ( angle - m_window < 0 )
+			searchKeys( angle - m_window + pi, pi, indices );
+		if ( angle + m_window > pi )
+			searchKeys( 0, angle + m_window - pi, indices );
+		indices.insert( indices.end(), m_nearEpipole.begin(), m_nearEpipole.end() );
+	}
+
+	// exact test of the points in the window
+	const double maxDistanceSq = m_maxDistance * m_maxDistance * normalSq;
+	std::size_t nKept = nIndices;
+	for ( std::size_t i = nIndices; i < indices.size(); i++ )
+	{
+		const Math::Vector< T, 2 >& p( m_toPoints[ indices[ i ] ] );
+		const double term = l[ 0 ] * p( 0 ) + l[ 1 ] * p( 1 ) + l[ 2 ];
+		if ( term * term <= maxDistanceSq )
+			indices[ nKept++ ] = indices[ i ];
+	}
+	indices.resize( nKept );
+}
+
+
+template< typename T >
+void EpipolarMatcher< T >::match( const std::vector< Math::Vector< T, 2 > >& fromPoints, std::vector< EpipolarCandidate< T > >& candidates ) const
+{
+	candidates.clear();
+	std::vector< std::size_t > indices;
+	for ( std::size_t i = 0; i < fromPoints.size(); i++ )
+	{
+		indices.clear();
+		findCandidates( fromPoints[ i ], indices );
+
+		double l[ 3 ];
+		for ( std::size_t k = 0; k < 3; k++ )
+			l[ k ] = m_F( k, 0 ) * fromPoints[ i ]( 0 ) + m_F( k, 1 ) * fromPoints[ i ]( 1 ) + m_F( k, 2 );
+		const double normalSq = l[ 0 ] * l[ 0 ] + l[ 1 ] * l[ 1 ];
+
+		for ( std::size_t j = 0; j < indices.size(); j++ )
+		{
+			const Math::Vector< T, 2 >& p( m_toPoints[ indices[ j ] ] );
+			const double term = l[ 0 ] * p( 0 ) + l[ 1 ] * p( 1 ) + l[ 2 ];
+
+			EpipolarCandidate< T > candidate;
+			candidate.from = i;
+			candidate.to = indices[ j ];
+			candidate.distance = static_cast< T >( term * term / normalSq );
+			candidates.push_back( candidate );
+		}
+	}
+}
+
+
+/** internal of epipolarCostMatrix function */
+template< typename T >
+void epipolarCostMatrixImpl( const std::vector< EpipolarCandidate< T > >& candidates, const std::size_t nFrom, const std::size_t nTo,
+	const T noMatchCost, Math::Matrix< T, 0, 0 >& costs )
+{
+	costs.resize( nFrom, nTo, false );
+	for ( std::size_t i = 0; i < nFrom; i++ )
+		for ( std::size_t j = 0; j < nTo; j++ )
+			costs( i, j ) = noMatchCost;
+	for ( std::size_t i = 0; i < candidates.size(); i++ )
+		costs( candidates[ i ].from, candidates[ i ].to ) = candidates[ i ].distance;
+}
+
+void epipolarCostMatrix( const std::vector< EpipolarCandidate< float > >& candidates, std::size_t nFrom, std::size_t nTo,
+	float noMatchCost, Math::Matrix< float, 0, 0 >& costs )
+{
+	epipolarCostMatrixImpl( candidates, nFrom, nTo, noMatchCost, costs );
+}
+
+void epipolarCostMatrix( const std::vector< EpipolarCandidate< double > >& candidates, std::size_t nFrom, std::size_t nTo,
+	double noMatchCost, Math::Matrix< double, 0, 0 >& costs )
+{
+	epipolarCostMatrixImpl( candidates, nFrom, nTo, noMatchCost, costs );
+}
+
+// explicit instantiations
+template class EpipolarMatcher< float >;
+template class EpipolarMatcher< double >;
+
+} } // namespace Ubitrack::Algorithm
@@ -0,0 +1,156 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Search of point correspondences between two views along epipolar lines.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_EPIPOLAR_MATCHING_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_EPIPOLAR_MATCHING_H_INCLUDED__
+
+#include <vector>
+#include <utility>
+
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+
+namespace Ubitrack { namespace Algorithm {
+
+/**
+ * @ingroup tracking_algorithms
+ * A possible correspondence found by \c EpipolarMatcher.
+ */
+template< typename T >
+struct EpipolarCandidate
+{
+	/** index of the point in the first view */
+	std::size_t from;
+
+	/** index of the point in the second view */
+	std::size_t to;
+
+	/** squared distance of the second point to the epipolar line of the first, like \c pointToPointDist */
+	T distance;
+};
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Finds the points of a second view that lie close to the epipolar lines of points of a first view.
+ *
+ * All epipolar lines of the second view pass through its epipole \c e'. The points of the second
+ * view are therefore indexed by the angle of the line from \c e' to the point, and the points near
+ * an epipolar line are found by a binary search for the angle of the line. A point at distance \c r
+ * from the epipole lies within \c maxDistance of a line if their angles differ by less than
+ * <tt>asin( maxDistance / r )</tt>. Points closer to the epipole than <tt>10 maxDistance</tt> would
+ * widen the search window and are always tested. If the epipole lies at infinity, the epipolar lines
+ * are parallel and the points are indexed by their offset perpendicular to the lines.
+ *
+ * Building the index takes O(M log M) for M points, a query O(log M) plus the number of points in
+ * the window, instead of testing every pair with \c pointToPointDist. The candidates are the sparse
+ * input of a \c Math::Graph::Munkres assignment, or can be turned into a dense cost matrix by
+ * \c epipolarCostMatrix.
+ *
+ * The fundamental matrix must have rank 2, as computed by \c getFundamentalMatrix.
+ */
+template< typename T >
+class UBITRACK_EXPORT EpipolarMatcher
+{
+public:
+	/**
+	 * Builds the index of the second view.
+	 * @param F fundamental matrix with <tt>x'^T F x = 0</tt>
+	 * @param toPoints points \c x' of the second view
+	 * @param maxDistance maximum distance of a candidate to the epipolar line in pixels
+	 */
+	EpipolarMatcher( const Math::Matrix< T, 3, 3 >& F, const std::vector< Math::Vector< T, 2 > >& toPoints, T maxDistance );
+
+	/**
+	 * Appends the points of the second view close to the epipolar line of \c from.
+	 * @param from a point \c x of the first view
+	 * @param indices receives the indices of the points in the second view, in no particular order
+	 */
+	void findCandidates( const Math::Vector< T, 2 >& from, std::vector< std::size_t >& indices ) const;
+
+	/**
+	 * Computes all pairs of points within \c maxDistance of each other's epipolar line.
+	 * @param fromPoints points \c x of the first view
+	 * @param candidates receives the candidate pairs, ordered by the index of the first point
+	 */
+	void match( const std::vector< Math::Vector< T, 2 > >& fromPoints, std::vector< EpipolarCandidate< T > >& candidates ) const;
+
+protected:
+	/** appends the indices of the points with a key in [ lower, upper ] */
+	void searchKeys( double lower, double upper, std::vector< std::size_t >& indices ) const;
+
+	/** fundamental matrix */
+	Math::Matrix< double, 3, 3 > m_F;
+
+	/** points of the second view */
+	std::vector< Math::Vector< T, 2 > > m_toPoints;
+
+	/** maximum distance to the epipolar line */
+	double m_maxDistance;
+
+	/** epipole of the second view and whether it lies at infinity */
+	Math::Vector< double, 3 > m_epipole;
+	bool m_bEpipoleAtInfinity;
+
+	/** half width of the angular search window */
+	double m_window;
+
+	/** points sorted by the angle or offset of their epipolar line */
+	std::vector< std::pair< double, std::size_t > > m_keys;
+
+	/** points near the epipole */
+	std::vector< std::size_t > m_nearEpipole;
+};
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Fills the cost matrix of an assignment of the first to the second view from epipolar candidates.
+ *
+ * Pairs that are no candidates get \c noMatchCost, which should be larger than the squared maximum
+ * distance. A maximum cost below \c noMatchCost in \c Math::Graph::Munkres::setMatrix excludes these pairs.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param candidates candidates from \c EpipolarMatcher::match
+ * @param nFrom number of points in the first view, the rows
+ * @param nTo number of points in the second view, the columns
+ * @param noMatchCost cost of the pairs that are no candidates
+ * @param costs the cost matrix, resized to nFrom x nTo
+ */
+UBITRACK_EXPORT void epipolarCostMatrix( const std::vector< EpipolarCandidate< float > >& candidates, std::size_t nFrom, std::size_t nTo,
+	float noMatchCost, Math::Matrix< float, 0, 0 >& costs );
+
+UBITRACK_EXPORT void epipolarCostMatrix( const std::vector< EpipolarCandidate< double > >& candidates, std::size_t nFrom, std::size_t nTo,
+	double noMatchCost, Math::Matrix< double, 0, 0 >& costs );
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // __UBITRACK_ALGORITHM_EPIPOLAR_MATCHING_H_INCLUDED__
@@ -35,6 +35,7 @@
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 
 #include <utMath/Util/cast_assign.h>
+#include <utMath/RotationMatrixCache.h>
 #include "Dehomogenization.h"
 #include "RadialDistortion.h"
 #include "CameraIntrinsicsMultiplication.h"
@@ -59,12 +60,42 @@ public:
 
 	// methods part of the UnaryFunctionPrototype interface
 
+	/** computes only the predicted measurements, used by the optimizer for trial steps */
 	template< class VT1, class VT2 > 
 	void evaluate( VT1& result, const VT2& input ) const
 	{
 		namespace ublas = boost::numeric::ublas;
-		ublas::matrix< T, ublas::column_major > J( result.size(), input.size() );
-		evaluateWithJacobian( result, input, J );
+		updateRotations( input );
+
+		std::size_t iM = 0; // offset into measurement vector
+
+		// free point measurements
+		for ( typename std::vector< typename BundleAdjustmentNetwork< T >::FreePointMeasurement >::const_iterator it = m_net.freePointMeasurements.begin();
+			it != m_net.freePointMeasurements.end(); it++, iM += 2 )
+		{
+			std::size_t iP = m_pointOffset + 3 * it->iPoint; // offset into parameter vector
+			ublas::vector_range< VT1 > resultRange( result, ublas::range( iM, iM + 2 ) );
+			Math::Vector< T, 3 > p3d( ublas::subrange( input, iP, iP + 3 ) );
+			evaluateSingleWorldPoint( resultRange, input, it->iCamera, it->iImage, p3d );
+		}
+
+		// body point measurements
+		for ( typename std::vector< typename BundleAdjustmentNetwork< T >::BodyPointMeasurement >::const_iterator it = m_net.bodyPointMeasurements.begin();
+			it != m_net.bodyPointMeasurements.end(); it++, iM += 2 )
+		{
+			std::size_t iP = m_bodyPoseOffset + 6 * ( it->iBodyPose - 1 ); // offset into parameter vector
+
+			// transform point from body to world
+			Math::Vector< T, 3 > worldPoint( m_net.bodies[ it->iBody ][ it->iPoint ] );
+			if ( it->iBodyPose != 0 )
+			{
+				noalias( worldPoint ) = ublas::prod( m_bodyRotations[ it->iBodyPose ].matrix(), m_net.bodies[ it->iBody ][ it->iPoint ] );
+				noalias( worldPoint ) += ublas::subrange( input, iP, iP + 3 );
+			}
+
+			ublas::vector_range< VT1 > resultRange( result, ublas::range( iM, iM + 2 ) );
+			evaluateSingleWorldPoint( resultRange, input, it->iCamera, it->iImage, worldPoint );
+		}
 	}
 
 	template< class VT2, class MT > 
@@ -86,17 +117,9 @@ public:
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
 	{
 		namespace ublas = boost::numeric::ublas;
-		// precompute image rotation matrices
-		std::vector< Math::Matrix< T, 3, 3 > > camRotations( m_net.images.size() );
-		std::size_t iV = m_imageOffset;
-		for ( std::size_t i = 0; i != m_net.images.size(); i++, iV += 6 )
-			Math::Quaternion::fromLogarithm( ublas::subrange( input, iV + 3, iV + 6 ) ).toMatrix( camRotations[ i ] );
-
-		// precompute body rotation matrices
-		std::vector< Math::Matrix< T, 3, 3 > > bodyRotations( m_net.bodyPoses.size() );
-		iV = m_bodyPoseOffset;
-		for ( std::size_t i = 1; i < m_net.bodyPoses.size(); i++, iV += 6 )
-			Math::Quaternion::fromLogarithm( ublas::subrange( input, iV + 3, iV + 6 ) ).toMatrix( bodyRotations[ i ] );
+		updateRotations( input );
+		const std::vector< Math::RotationMatrixCache< T > >& camRotations( m_camRotations );
+		const std::vector< Math::RotationMatrixCache< T > >& bodyRotations( m_bodyRotations );
 
 		// clear jacobian
 		noalias( J ) = ublas::zero_matrix< T >( J.size1(), J.size2() );
@@ -133,7 +156,7 @@ public:
 			else
 			{
 				// take pose from parameter
-				noalias( worldPoint ) = ublas::prod( bodyRotations[ it->iBodyPose ], m_net.bodies[ it->iBody ][ it->iPoint ] );
+				noalias( worldPoint ) = ublas::prod( bodyRotations[ it->iBodyPose ].matrix(), m_net.bodies[ it->iBody ][ it->iPoint ] );
 				noalias( worldPoint ) += ublas::subrange( input, iP, iP + 3 );
 			}
 
@@ -298,14 +321,71 @@ public:
 	}
 
 protected:
+	/** updates the cached rotation matrices, the matrices are kept for unchanged parameters */
+	template< class VT >
+	void updateRotations( const VT& input ) const
+	{
+		namespace ublas = boost::numeric::ublas;
+
+		// update image rotations
+		m_camRotations.resize( m_net.images.size() );
+		std::size_t iV = m_imageOffset;
+		for ( std::size_t i = 0; i != m_net.images.size(); i++, iV += 6 )
+			m_camRotations[ i ].setRotation( Math::Quaternion::fromLogarithm( ublas::subrange( input, iV + 3, iV + 6 ) ) );
+
+		// update body rotations
+		m_bodyRotations.resize( m_net.bodyPoses.size() );
+		iV = m_bodyPoseOffset;
+		for ( std::size_t i = 1; i < m_net.bodyPoses.size(); i++, iV += 6 )
+			m_bodyRotations[ i ].setRotation( Math::Quaternion::fromLogarithm( ublas::subrange( input, iV + 3, iV + 6 ) ) );
+	}
+
+	/**
+	 * projects a single 3D point in world coordinates without computing jacobians,
+	 * uses the rotations cached by \c updateRotations
+	 */
+	template< class VT1, class VT2 > 
+	void evaluateSingleWorldPoint( VT1& result, const VT2& input, std::size_t iCamera, std::size_t iImage,
+		const Math::Vector< T, 3 >& p3d ) const
+	{
+		namespace ublas = boost::numeric::ublas;
+
+		// transform point into camera coordinate frame
+		std::size_t iP = m_imageOffset + 6 * iImage;
+		Math::Vector< T, 3 > transformed( ublas::prod( m_camRotations[ iImage ].matrix(), p3d ) );
+		noalias( transformed ) += ublas::subrange( input, iP, iP + 3 );
+
+		// dehomogenize
+		Math::Vector< T, 2 > dehomogenized;
+		Function::Dehomogenization< 3 >().evaluate( dehomogenized, transformed );
+
+		// distort and apply intrinsics camera parameters
+		Math::Vector< T, 2 > distorted;
+		if ( m_net.bEstimateIntrinsics )
+		{
+			iP = m_intrinsicsOffset + 9 * iCamera;
+			Function::RadialDistortionWrtD< T >( dehomogenized )
+				.evaluate( distorted, ublas::subrange( input, iP + 5, iP + 9 ) );
+			Function::CameraIntrinsicsMultiplication< T >( distorted )
+				.evaluate( result, ublas::subrange( input, iP, iP + 5 ) );
+		}
+		else
+		{
+			Function::RadialDistortionWrtD< T >( dehomogenized ).evaluate( distorted, m_net.distortions[ iCamera ] );
+			const Math::Matrix< T, 3, 3 >& K( m_net.intrinsics[ iCamera ] );
+			result( 0 ) = -( K( 0, 0 ) * distorted( 0 ) + K( 0, 1 ) * distorted( 1 ) + K( 0, 2 ) );
+			result( 1 ) = -(                              K( 1, 1 ) * distorted( 1 ) + K( 1, 2 ) );
+		}
+	}
+
 	/**
 	 * same as evaluateWithJacobian, but for a single 3D point in world coordinates
 	 * @param result where to put the predicted 2d-measurement
 	 * @param input the whole BA parameter vector
 	 * @param J 2x<inputsize> jacobian of 2d-measurement wrt. all BA parameters
 	 * @param pointJacobian 2x3 jacobian of 2D point wrt 3D input point
-	 * @param camRotations precomputed camera rotation matrices (from input quaternions)
-	 * @param bodyRotations precomputed body rotation matrices (from input quaternions)
+	 * @param camRotations cached camera rotation matrices (from input quaternions)
+	 * @param bodyRotations cached body rotation matrices (from input quaternions)
 	 * @param pIntrinsics precomputed or constant camera projection matrices
 	 * @param iCamera index of camera intrinsics
 	 * @param iImage index of camera pose
@@ -313,8 +393,8 @@ protected:
 	 */
 	template< class VT1, class VT2, class MT, class VT3 > 
 	void evaluateSingleWorldPointWithJacobian( VT1& result, const VT2& input, MT& J, VT3& pointJacobian, 
-		const std::vector< Math::Matrix< T, 3, 3 > >& camRotations,
-		const std::vector< Math::Matrix< T, 3, 3 > >& bodyRotations,
+		const std::vector< Math::RotationMatrixCache< T > >& camRotations,
+		const std::vector< Math::RotationMatrixCache< T > >& bodyRotations,
 		std::size_t iCamera, std::size_t iImage,
 		const Math::Vector< T, 3 >& p3d ) const
 	{
@@ -324,7 +404,7 @@ protected:
 
 		// transform point into camera coordinate frame
 		iP = m_imageOffset + 6 * iImage;
-		Math::Vector< T, 3 > transformed( ublas::prod( camRotations[ iImage ], p3d ) );
+		Math::Vector< T, 3 > transformed( ublas::prod( camRotations[ iImage ].matrix(), p3d ) );
 		noalias( transformed ) += ublas::subrange( input, iP, iP + 3 );
 
 		// dehomogenize
@@ -408,7 +488,7 @@ protected:
 		noalias( ublas::subrange( J, 0, 2, iP + 3, iP + 6 ) ) = ublas::prod( jDehom, jCamOri );
 
 		// jacobian
-		noalias( pointJacobian ) = ublas::prod( jDehom, camRotations[ iImage ] );
+		noalias( pointJacobian ) = ublas::prod( jDehom, camRotations[ iImage ].matrix() );
 	}
 
 	// some offsets into the parameter vector
@@ -428,6 +508,12 @@ protected:
 
 	/** reference to the network */
 	BundleAdjustmentNetwork< T >& m_net;
+
+	/** rotation matrices of the camera poses of the last evaluation */
+	mutable std::vector< Math::RotationMatrixCache< T > > m_camRotations;
+
+	/** rotation matrices of the body poses of the last evaluation, the first body pose is the identity */
+	mutable std::vector< Math::RotationMatrixCache< T > > m_bodyRotations;
 };
 
 } } // namespace Ubitrack::Algorithm
@@ -83,42 +83,7 @@ public:
 	 */
 	template< class VT1, class VT2 > 
 	void evaluate( VT1& result, const VT2& input ) const
-	{
-		using namespace Ubitrack::Math;
-		namespace ublas = boost::numeric::ublas;
-
-		// convert quaternion to matrix (for speedup)
-		Math::Quaternion rotQ( Quaternion::fromVector( ublas::subrange( input, 3, 7 ) ) );
-		Math::Matrix< VType, 3, 3 > rot( rotQ );
-		
-		// create vectors
-		Math::Vector< VType, 3 > rotated;
-		Math::Vector< VType, 3 > camCoord;
-		Math::Vector< VType, 2 > camCoordDehom;
-		Math::Vector< VType, 2 > distorted;
-		Math::Vector< VType, 2 > projected;
-		
-		for ( std::size_t i( 0 ); i < m_vis.size(); i++ )
-		{
-			// shortcuts
-			const Math::Vector< VType, 3 >& p3D( m_p3D[ m_vis[ i ].first ] );
-			const Math::Pose& camP( m_camP[ m_vis[ i ].second ] );
-			const Math::Matrix< VType, 3, 3 >& camI( m_camI[ m_vis[ i ].second ] );
-			const Math::Vector< VType, 4 >& camD( m_camD[ m_vis[ i ].second ] );
-			
-			// rotate & project points
-			noalias( rotated ) = ublas::prod( rot, p3D ) + ublas::subrange( input, 0, 3 );
-			noalias( camCoord ) = camP * rotated;
-			noalias( camCoordDehom ) = ublas::subrange( camCoord, 0, 2 ) / camCoord( 2 );
-			Function::radialDistortion( distorted, camCoordDehom, camD );
-			noalias( projected ) = ublas::prod( ublas::subrange( camI, 0, 2, 0, 2 ), distorted );
-			projected( 0 ) += camI( 0, 2 );
-			projected( 1 ) += camI( 1, 2 );
-			projected *= camI( 2, 2 ); // should be -1 or 1
-			
-			ublas::subrange( result, 2 * i, 2 * i + 2 ) = projected;
-		}
-	}
+	{ compute( &result, input, static_cast< Math::Matrix< VType, 0, 0 >* >( 0 ) ); }
 
 	/**
 	 * @param result vector to store the result in
@@ -127,11 +92,7 @@ public:
 	 */
 	template< class VT1, class VT2, class MT > 
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
-	{
-		// TODO: implement as one function (more efficient)
-		evaluate( result, input );
-		jacobian( input, J );
-	}
+	{ compute( &result, input, &J ); }
 	
 	/**
 	 * @param input containing the parameters (target pose as 7-vector)
@@ -139,71 +100,102 @@ public:
 	 */
 	template< class VT2, class MT > 
 	void jacobian( const VT2& input, MT& J ) const
+	{ compute( static_cast< Math::Vector< VType, 0 >* >( 0 ), input, &J ); }
+	
+protected:
+	/**
+	 * computes the projections and/or the jacobian in one pass over the observations, writing the
+	 * elements of \c result and \c J directly. Null pointers are skipped.
+	 */
+	template< class VT1, class VT2, class MT >
+	void compute( VT1* pResult, const VT2& input, MT* pJ ) const
 	{
-		using namespace Ubitrack::Math;
-		namespace ublas = boost::numeric::ublas;
-
-		// convert quaternion to matrix (for speedup)
-		Math::Quaternion rotQ( Quaternion::fromVector( ublas::subrange( input, 3, 7 ) ) );
-		Math::Matrix< VType, 3, 3 > rot( rotQ );
+		// convert quaternion to matrix once for all points
+		const Math::Vector< VType, 4 > q( input( 3 ), input( 4 ), input( 5 ), input( 6 ) );
+		Math::Matrix< VType, 3, 3 > rot;
+		Math::Quaternion::vectorToMatrix( q, rot );
 		
-		// create vectors
-		Math::Vector< VType, 3 > rotated;
-		Math::Vector< VType, 3 > camCoord;
-		Math::Vector< VType, 2 > camCoordDehom;
-		Math::Vector< VType, 2 > distorted;
-		Math::Vector< VType, 2 > projected;
+		// combine the target pose with each camera pose, camCoord = R_c R p + ( R_c t + t_c )
+		std::vector< Math::Matrix< VType, 3, 3 > > camRot( m_camP.size() );
+		std::vector< Math::Matrix< VType, 3, 4 > > camPose( m_camP.size() );
+		for ( std::size_t c( 0 ); c < m_camP.size(); c++ )
+		{
+			camRot[ c ] = Math::Matrix< VType, 3, 3 >( m_camP[ c ].rotation() );
+			for ( std::size_t k( 0 ); k < 3; ++k )
+			{
+				for ( std::size_t l( 0 ); l < 3; ++l )
+					camPose[ c ]( k, l ) = camRot[ c ]( k, 0 ) * rot( 0, l ) + camRot[ c ]( k, 1 ) * rot( 1, l ) + camRot[ c ]( k, 2 ) * rot( 2, l );
+				camPose[ c ]( k, 3 ) = camRot[ c ]( k, 0 ) * input( 0 ) + camRot[ c ]( k, 1 ) * input( 1 ) + camRot[ c ]( k, 2 ) * input( 2 )
+					+ VType( m_camP[ c ].translation()( k ) );
+			}
+		}
 		
-		// create matrices
-		Math::Matrix< VType, 3, 4 > rotJ;
-		Math::Matrix< VType, 2, 3 > dehomJ;
+		Math::Vector< VType, 2 > camCoordDehom;
 		Math::Matrix< VType, 2, 2 > distJ;
-		Math::Matrix< VType, 2, 3 > projJ;
-
-		Math::Matrix< VType, 2, 2 > jA;
-		Math::Matrix< VType, 2, 3 > jB;
-		Math::Matrix< VType, 2, 3 > jC;
-
-		for ( unsigned i = 0; i < m_vis.size(); i++ )
+		Math::Matrix< VType, 3, 4 > rotJ;
+		for ( std::size_t i( 0 ); i < m_vis.size(); i++ )
 		{
 			// shortcuts
 			const Math::Vector< VType, 3 >& p3D( m_p3D[ m_vis[ i ].first ] );
-			const Math::Pose& camP( m_camP[ m_vis[ i ].second ] );
 			const Math::Matrix< VType, 3, 3 >& camI( m_camI[ m_vis[ i ].second ] );
 			const Math::Vector< VType, 4 >& camD( m_camD[ m_vis[ i ].second ] );
+			const Math::Matrix< VType, 3, 4 >& camT( camPose[ m_vis[ i ].second ] );
 			
-			// rotate & project points
-			noalias( rotated ) = ublas::prod( rot, p3D ) + ublas::subrange( input, 0, 3 );
-			noalias( camCoord ) = camP * rotated;
-			noalias( camCoordDehom ) = ublas::subrange( camCoord, 0, 2 ) / camCoord( 2 );
-			Function::radialDistortion( distorted, camCoordDehom, camD );
-			noalias( projected ) = ublas::prod(
-				ublas::subrange( camI, 0, 2, 0, 2 ), distorted );
-			projected( 0 ) += camI( 0, 2 );
-			projected( 1 ) += camI( 1, 2 );
-			projected *= camI( 2, 2 );
+			// rotate & project point
+			VType camCoord[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				camCoord[ k ] = camT( k, 0 ) * p3D( 0 ) + camT( k, 1 ) * p3D( 1 ) + camT( k, 2 ) * p3D( 2 ) + camT( k, 3 );
+			const VType iz = 1 / camCoord[ 2 ];
+			const VType x = camCoord[ 0 ] * iz;
+			const VType y = camCoord[ 1 ] * iz;
 			
-			// create jacobian for this measurement
-			QuaternionRotation< VType > qrf( p3D );
-			qrf.jacobian( ublas::subrange( input, 3, 7 ), rotJ );
-			Math::Matrix< VType, 3, 3 > rotCamJ( camP.rotation() );
-			Dehomogenization< 3 >().jacobian( camCoord, dehomJ );
-			Function::RadialDistortionWrtP< VType >( camD ).jacobian(
-				camCoordDehom, distJ );
-
-			noalias( jA ) = ublas::prod( ublas::subrange( camI, 0, 2, 0, 2 ), distJ )
-				* camI( 2, 2 ); // camI( 2, 2 ) should be -1 or 1
-			noalias( jB ) = ublas::prod( jA, dehomJ );
-			noalias( jC ) = ublas::prod( jB, rotCamJ );
+			// radial and tangential distortion, see radialDistortion
+			const VType r2 = x * x + y * y;
+			const VType radial = 1 + camD( 0 ) * r2 + camD( 1 ) * r2 * r2;
+			const VType xd = x * radial + 2 * camD( 2 ) * x * y + camD( 3 ) * ( r2 + 2 * x * x );
+			const VType yd = y * radial + 2 * camD( 3 ) * x * y + camD( 2 ) * ( r2 + 2 * y * y );
 			
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ) ) 
-				= jC;
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 3, 7 ) ) 
-				= ublas::prod( jC, rotJ );
+			// camI( 2, 2 ) should be -1 or 1
+			if ( pResult )
+			{
+				( *pResult )( 2 * i ) = ( camI( 0, 0 ) * xd + camI( 0, 1 ) * yd + camI( 0, 2 ) ) * camI( 2, 2 );
+				( *pResult )( 2 * i + 1 ) = ( camI( 1, 0 ) * xd + camI( 1, 1 ) * yd + camI( 1, 2 ) ) * camI( 2, 2 );
+			}
+			if ( !pJ )
+				continue;
+			
+			// jacobian of intrinsics and distortion wrt. the dehomogenized point
+			camCoordDehom( 0 ) = x;
+			camCoordDehom( 1 ) = y;
+			Function::RadialDistortionWrtP< VType >( camD ).jacobian( camCoordDehom, distJ );
+			VType jA[ 2 ][ 2 ];
+			for ( std::size_t row( 0 ); row < 2; ++row )
+				for ( std::size_t k( 0 ); k < 2; ++k )
+					jA[ row ][ k ] = ( camI( row, 0 ) * distJ( 0, k ) + camI( row, 1 ) * distJ( 1, k ) ) * camI( 2, 2 );
+			
+			// dehomogenization and camera rotation give the jacobian wrt. t
+			const Math::Matrix< VType, 3, 3 >& rotCamJ( camRot[ m_vis[ i ].second ] );
+			VType jC[ 2 ][ 3 ];
+			for ( std::size_t row( 0 ); row < 2; ++row )
+			{
+				const VType jB[ 3 ] = { jA[ row ][ 0 ] * iz, jA[ row ][ 1 ] * iz, -( jA[ row ][ 0 ] * x + jA[ row ][ 1 ] * y ) * iz };
+				for ( std::size_t k( 0 ); k < 3; ++k )
+					jC[ row ][ k ] = jB[ 0 ] * rotCamJ( 0, k ) + jB[ 1 ] * rotCamJ( 1, k ) + jB[ 2 ] * rotCamJ( 2, k );
+			}
+			
+			// chain rule with the jacobian of the rotation wrt. the quaternion
+			QuaternionRotation< VType >( p3D ).jacobian( q, rotJ );
+			MT& J( *pJ );
+			for ( std::size_t row( 0 ); row < 2; ++row )
+			{
+				for ( std::size_t k( 0 ); k < 3; ++k )
+					J( 2 * i + row, k ) = jC[ row ][ k ];
+				for ( std::size_t k( 0 ); k < 4; ++k )
+					J( 2 * i + row, 3 + k ) = jC[ row ][ 0 ] * rotJ( 0, k ) + jC[ row ][ 1 ] * rotJ( 1, k ) + jC[ row ][ 2 ] * rotJ( 2, k );
+			}
 		}
 	}
 	
-protected:
 	const std::vector< Math::Vector< VType, 3 > >& m_p3D;
 	const std::vector< Math::Pose >& m_camP;
 	const std::vector< Math::Matrix< VType, 3, 3 > >& m_camI;
@@ -83,42 +83,102 @@ public:
 	template< class VT2, class MT > 
 	void jacobian( const VT2& input, MT& J ) const
 	{
-		using namespace Ubitrack::Math;
-		namespace ublas = boost::numeric::ublas;
-
-		// convert quaternion to matrix (for speedup)
-		Quaternion rotQ( Quaternion::fromVector( ublas::subrange( input, 3, 7 ) ) );
-		Matrix< VType, 3, 3 > rot( rotQ );
+		// convert quaternion to matrix once for all points
+		const Math::Vector< VType, 4 > q( input( 3 ), input( 4 ), input( 5 ), input( 6 ) );
+		Math::Matrix< VType, 3, 3 > rot;
+		Math::Quaternion::vectorToMatrix( q, rot );
 		
-		// create matrices
-		Matrix< VType, 2, 3 > projJ;
-		Matrix< VType, 3, 3 > rotJ;
-		Vector< VType, 3 > rotated;
-		Vector< VType, 3 > projected;
+		// combine the pose with each camera, x = M R p + ( M t + m )
+		std::vector< Math::Matrix< VType, 3, 4 > > camPose( m_cam.size() );
+		for ( std::size_t c( 0 ); c < m_cam.size(); c++ )
+			for ( std::size_t k( 0 ); k < 3; ++k )
+			{
+				for ( std::size_t l( 0 ); l < 3; ++l )
+					camPose[ c ]( k, l ) = m_cam[ c ]( k, 0 ) * rot( 0, l ) + m_cam[ c ]( k, 1 ) * rot( 1, l ) + m_cam[ c ]( k, 2 ) * rot( 2, l );
+				camPose[ c ]( k, 3 ) = m_cam[ c ]( k, 0 ) * input( 0 ) + m_cam[ c ]( k, 1 ) * input( 1 ) + m_cam[ c ]( k, 2 ) * input( 2 ) + m_cam[ c ]( k, 3 );
+			}
 		
+		VType j[ 2 ][ 6 ];
 		for ( std::size_t i( 0 ); i < m_vis.size(); i++ )
 		{
 			// shortcuts
-			const Math::Vector< VType, 3 >& p3D( m_p3D[ m_vis[ i ].first ] );
-			const Math::Matrix< VType, 3, 4 >& cam( m_cam[ m_vis[ i ].second ] );
+			const Math::Vector< VType, 3 >& p( m_p3D[ m_vis[ i ].first ] );
+			const Math::Matrix< VType, 3, 4 >& mr( camPose[ m_vis[ i ].second ] );
+			
+			// rotate & project point
+			VType x[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				x[ k ] = mr( k, 0 ) * p( 0 ) + mr( k, 1 ) * p( 1 ) + mr( k, 2 ) * p( 2 ) + mr( k, 3 );
 			
-			// rotate & project points
-			noalias( rotated ) = ublas::prod( rot, p3D ) + ublas::subrange( input, 0, 3 );
-			noalias( projected ) = ublas::prod( ublas::subrange( cam, 0, 3, 0, 3 ), rotated ) + ublas::column( cam, 3 );
+			observationJacobian( p, m_cam[ m_vis[ i ].second ], q, x, j );
+			for ( std::size_t row( 0 ); row < 2; ++row )
+				for ( std::size_t k( 0 ); k < 6; ++k )
+					J( 2 * i + row, k ) = j[ row ][ k ];
+		}
+	}
+	
+	/**
+	 * Accumulates the 6x6 normal matrix J^T * J of the jacobian observation by observation, 
+	 * without storing the jacobian.
+	 * @param input containing the parameters (pose as 7-vector)
+	 * @param n matrix to which the normal matrix is added, only the lower triangle is written
+	 */
+	template< class VT2 > 
+	void addNormalMatrix( const VT2& input, Math::Matrix< double, 6, 6 >& n ) const
+	{
+		const Math::Vector< VType, 4 > q( input( 3 ), input( 4 ), input( 5 ), input( 6 ) );
+		Math::Matrix< VType, 3, 3 > rot;
+		Math::Quaternion::vectorToMatrix( q, rot );
+		
+		VType j[ 2 ][ 6 ];
+		for ( std::size_t i( 0 ); i < m_vis.size(); i++ )
+		{
+			const Math::Vector< VType, 3 >& p( m_p3D[ m_vis[ i ].first ] );
+			const Math::Matrix< VType, 3, 4 >& cam( m_cam[ m_vis[ i ].second ] );
 			
-			// create jacobian for this measurement
-			QuaternionRotationError< VType > qrf( p3D );
-			qrf.jacobian( ublas::subrange( input, 3, 7 ), rotJ );
-			Dehomogenization< 3 >().jacobian( projected, projJ );
+			// x = M ( R p + t ) + m
+			VType r[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				r[ k ] = rot( k, 0 ) * p( 0 ) + rot( k, 1 ) * p( 1 ) + rot( k, 2 ) * p( 2 ) + VType( input( k ) );
+			VType x[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				x[ k ] = cam( k, 0 ) * r[ 0 ] + cam( k, 1 ) * r[ 1 ] + cam( k, 2 ) * r[ 2 ] + cam( k, 3 );
 			
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ) ) 
-				= ublas::prod( projJ, ublas::subrange( cam, 0, 3, 0, 3 ) );
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 3, 6 ) ) 
-				= ublas::prod( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ), rotJ );
+			observationJacobian( p, cam, q, x, j );
+			for ( std::size_t r( 0 ); r < 6; ++r )
+				for ( std::size_t c( 0 ); c <= r; ++c )
+					n( r, c ) += double( j[ 0 ][ r ] ) * j[ 0 ][ c ] + double( j[ 1 ][ r ] ) * j[ 1 ][ c ];
 		}
 	}
 	
 protected:
+	/** computes the two rows of the jacobian of a single observation, given the projected point x */
+	static void observationJacobian( const Math::Vector< VType, 3 >& p, const Math::Matrix< VType, 3, 4 >& cam, 
+		const Math::Vector< VType, 4 >& q, const VType x[ 3 ], VType j[ 2 ][ 6 ] )
+	{
+		const VType iz = 1 / x[ 2 ];
+		const VType u = x[ 0 ] * iz;
+		const VType v = x[ 1 ] * iz;
+		
+		// dehomogenization jacobian times camera matrix is the jacobian wrt. e_t
+		VType a[ 2 ][ 3 ];
+		for ( std::size_t k( 0 ); k < 3; ++k )
+		{
+			a[ 0 ][ k ] = ( cam( 0, k ) - u * cam( 2, k ) ) * iz;
+			a[ 1 ][ k ] = ( cam( 1, k ) - v * cam( 2, k ) ) * iz;
+		}
+		
+		// chain rule with the jacobian of the rotation wrt. e_r
+		Math::Matrix< VType, 3, 3 > rotJ;
+		QuaternionRotationError< VType >( p ).jacobian( q, rotJ );
+		for ( std::size_t row( 0 ); row < 2; ++row )
+			for ( std::size_t k( 0 ); k < 3; ++k )
+			{
+				j[ row ][ k ] = a[ row ][ k ];
+				j[ row ][ 3 + k ] = a[ row ][ 0 ] * rotJ( 0, k ) + a[ row ][ 1 ] * rotJ( 1, k ) + a[ row ][ 2 ] * rotJ( 2, k );
+			}
+	}
+	
 	const std::vector< Math::Vector< VType, 3 > >& m_p3D;
 	const std::vector< Math::Matrix< VType, 3, 4 > >& m_cam;
 	const std::vector< std::pair< std::size_t, std::size_t > > m_vis;
@@ -88,50 +88,60 @@ public:
 	template< class VT2, class MT > 
 	void jacobian( const VT2& input, MT& J ) const
 	{
-		using namespace Ubitrack::Math;
-		namespace ublas = boost::numeric::ublas;
-
-		// convert quaternion to matrix (for speedup)
-		Quaternion rotQ( Quaternion::fromLogarithm( ublas::subrange( input, 3, 6 ) ) );
-		Matrix< VType, 3, 3 > rot( rotQ );
+		// convert exponential map to matrix once for all points
+		const Math::Matrix< VType, 3, 3 > rot( Math::Quaternion::fromLogarithm( Math::Vector< double, 3 >( input( 3 ), input( 4 ), input( 5 ) ) ) );
+		
+		// rotated center of gravity, the points are rotated around it
+		VType rc[ 3 ];
+		for ( std::size_t k( 0 ); k < 3; ++k )
+			rc[ k ] = rot( k, 0 ) * m_centerOfGravity( 0 ) + rot( k, 1 ) * m_centerOfGravity( 1 ) + rot( k, 2 ) * m_centerOfGravity( 2 );
 		
-		// create matrices
-		Matrix< VType, 2, 3 > projJ;
-		Matrix< VType, 3, 3 > rotJ;
-		Vector< VType, 3 > rotated;
-		Vector< VType, 3 > translated;
-		Vector< VType, 3 > projected;
+		// combine the pose with each camera, P * ( R * p + t )
+		std::vector< Math::Matrix< VType, 3, 4 > > camPose( m_cam.size() );
+		for ( std::size_t c( 0 ); c < m_cam.size(); c++ )
+			for ( std::size_t k( 0 ); k < 3; ++k )
+			{
+				for ( std::size_t l( 0 ); l < 3; ++l )
+					camPose[ c ]( k, l ) = m_cam[ c ]( k, 0 ) * rot( 0, l ) + m_cam[ c ]( k, 1 ) * rot( 1, l ) + m_cam[ c ]( k, 2 ) * rot( 2, l );
+				camPose[ c ]( k, 3 ) = m_cam[ c ]( k, 0 ) * input( 0 ) + m_cam[ c ]( k, 1 ) * input( 1 ) + m_cam[ c ]( k, 2 ) * input( 2 ) + m_cam[ c ]( k, 3 );
+			}
 		
 		for ( unsigned i = 0; i < m_vis.size(); i++ )
 		{
 			// shortcuts
-			const Math::Vector< VType, 3 >& p3D( m_p3D[ m_vis[ i ].first ] );
+			const Math::Vector< VType, 3 >& p( m_p3D[ m_vis[ i ].first ] );
 			const Math::Matrix< VType, 3, 4 >& cam( m_cam[ m_vis[ i ].second ] );
+			const Math::Matrix< VType, 3, 4 >& mr( camPose[ m_vis[ i ].second ] );
 			
-			// rotate & project points
-			noalias( rotated ) = ublas::prod( rot, p3D - m_centerOfGravity );
-			noalias( translated ) = rotated + ublas::subrange( input, 0, 3 ) + ublas::prod( rot, m_centerOfGravity );
-			noalias( projected ) = ublas::prod( ublas::subrange( cam, 0, 3, 0, 3 ), translated ) + ublas::column( cam, 3 );
-			
-			// create rotation jacobian for this measurement
-			rotJ( 0, 0 ) = 0;
-			rotJ( 0, 1 ) = rotated( 2 );
-			rotJ( 0, 2 ) = -rotated( 1 );
-			rotJ( 1, 0 ) = -rotated( 2 );
-			rotJ( 1, 1 ) = 0;
-			rotJ( 1, 2 ) = rotated( 0 );
-			rotJ( 2, 0 ) = rotated( 1 );
-			rotJ( 2, 1 ) = -rotated( 0 );
-			rotJ( 2, 2 ) = 0;
+			// rotate & project point
+			VType rotated[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				rotated[ k ] = rot( k, 0 ) * p( 0 ) + rot( k, 1 ) * p( 1 ) + rot( k, 2 ) * p( 2 ) - rc[ k ];
+			VType x[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				x[ k ] = mr( k, 0 ) * p( 0 ) + mr( k, 1 ) * p( 1 ) + mr( k, 2 ) * p( 2 ) + mr( k, 3 );
+			const VType iz = 1 / x[ 2 ];
+			const VType u = x[ 0 ] * iz;
+			const VType v = x[ 1 ] * iz;
 			
-			// create projection jacobian for this measurement
-			Dehomogenization< 3 >().jacobian( projected, projJ );
+			// dehomogenization jacobian times camera matrix is the jacobian wrt. e_t
+			VType a[ 2 ][ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+			{
+				a[ 0 ][ k ] = ( cam( 0, k ) - u * cam( 2, k ) ) * iz;
+				a[ 1 ][ k ] = ( cam( 1, k ) - v * cam( 2, k ) ) * iz;
+			}
 			
-			// apply chain rule
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ) ) 
-				= ublas::prod( projJ, ublas::subrange( cam, 0, 3, 0, 3 ) );
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 3, 6 ) ) 
-				= ublas::prod( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ), rotJ );
+			// chain rule with the rotation jacobian, which is the cross product matrix of the rotated point
+			for ( std::size_t row( 0 ); row < 2; ++row )
+			{
+				J( 2 * i + row, 0 ) = a[ row ][ 0 ];
+				J( 2 * i + row, 1 ) = a[ row ][ 1 ];
+				J( 2 * i + row, 2 ) = a[ row ][ 2 ];
+				J( 2 * i + row, 3 ) = a[ row ][ 2 ] * rotated[ 1 ] - a[ row ][ 1 ] * rotated[ 2 ];
+				J( 2 * i + row, 4 ) = a[ row ][ 0 ] * rotated[ 2 ] - a[ row ][ 2 ] * rotated[ 0 ];
+				J( 2 * i + row, 5 ) = a[ row ][ 1 ] * rotated[ 0 ] - a[ row ][ 0 ] * rotated[ 1 ];
+			}
 		}
 	}
 	
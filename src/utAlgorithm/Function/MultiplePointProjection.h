@@ -81,22 +81,7 @@ public:
 	 */
 	template< class VT1, class VT2 > 
 	void evaluate( VT1& result, const VT2& input ) const
-	{
-		using namespace Ubitrack::Math;
-		namespace ublas = boost::numeric::ublas;
-
-		// convert quaternion to matrix (for speedup)
-		Quaternion rotQ( Quaternion::fromVector( ublas::subrange( input, 3, 7 ) ) );
-		Matrix< VType, 3, 3 > rot( rotQ );
-		
-		for ( std::size_t i ( 0 ); i < m_p3D.size(); ++i )
-		{
-			// rotate & project points
-			Vector< VType, 3 > rotated( ublas::prod( rot, m_p3D[ i ] ) + ublas::subrange( input, 0, 3 ) );
-			Vector< VType, 3 > projected( ublas::prod( m_cam, rotated ) );
-			ublas::noalias( ublas::subrange( result, i * 2, (i+1) * 2 ) ) = ublas::subrange( projected, 0, 2 ) / projected( 2 );
-		}
-	}
+	{ compute( &result, input, static_cast< Math::Matrix< VType, 0, 0 >* >( 0 ) ); }
 	
 	/**
 	 * @param result vector to store the result in
@@ -105,11 +90,7 @@ public:
 	 */
 	template< class VT1, class VT2, class MT > 
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
-	{
-		// TODO: implement as one function (more efficient)
-		evaluate( result, input );
-		jacobian( input, J );
-	}
+	{ compute( &result, input, &J ); }
 
 	/**
 	 * @param input containing the parameters (to be optimized)
@@ -117,39 +98,67 @@ public:
 	 */
 	template< class VT2, class MT > 
 	void jacobian( const VT2& input, MT& J ) const
+	{ compute( static_cast< Math::Vector< VType, 0 >* >( 0 ), input, &J ); }
+	
+protected:
+	/**
+	 * computes the projections and/or the jacobian in one pass over the points, writing the
+	 * elements of \c result and \c J directly. Null pointers are skipped.
+	 */
+	template< class VT1, class VT2, class MT >
+	void compute( VT1* pResult, const VT2& input, MT* pJ ) const
 	{
-		using namespace Ubitrack::Math;
-		namespace ublas = boost::numeric::ublas;
-
-		// convert quaternion to matrix (for speedup)
-		Quaternion rotQ( Quaternion::fromVector( ublas::subrange( input, 3, 7 ) ) );
-		Matrix< VType, 3, 3 > rot( rotQ );
-		
-		// create matrices
-		Matrix< VType, 2, 3 > projJ;
-		Matrix< VType, 3, 4 > rotJ;
-		Vector< VType, 3 > rotated;
-		Vector< VType, 3 > projected;
+		// convert quaternion to matrix once for all points
+		const Math::Vector< VType, 4 > q( input( 3 ), input( 4 ), input( 5 ), input( 6 ) );
+		Math::Matrix< VType, 3, 3 > rot;
+		Math::Quaternion::vectorToMatrix( q, rot );
+		const VType t[ 3 ] = { VType( input( 0 ) ), VType( input( 1 ) ), VType( input( 2 ) ) };
+		const Math::Matrix< VType, 3, 3 >& cam( m_cam );
+		Math::Matrix< VType, 3, 4 > rotJ;
 		
-		for ( unsigned i = 0; i < m_p3D.size(); i++ )
+		for ( std::size_t i( 0 ); i < m_p3D.size(); ++i )
 		{
-			// rotate & project points
-			noalias( rotated ) = ublas::prod( rot, m_p3D[ i ] ) + ublas::subrange( input, 0, 3 );
-			noalias( projected ) = ublas::prod( m_cam, rotated );
+			// rotate & project point
+			const Math::Vector< VType, 3 >& p( m_p3D[ i ] );
+			VType r[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				r[ k ] = rot( k, 0 ) * p( 0 ) + rot( k, 1 ) * p( 1 ) + rot( k, 2 ) * p( 2 ) + t[ k ];
+			VType x[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				x[ k ] = cam( k, 0 ) * r[ 0 ] + cam( k, 1 ) * r[ 1 ] + cam( k, 2 ) * r[ 2 ];
+			const VType iz = 1 / x[ 2 ];
+			const VType u = x[ 0 ] * iz;
+			const VType v = x[ 1 ] * iz;
 			
-			// create jacobian for this measurement
-			QuaternionRotation< VType > qrf( m_p3D[ i ] );
-			qrf.jacobian( ublas::subrange( input, 3, 7 ), rotJ );
-			Dehomogenization< 3 >().jacobian( projected, projJ );
+			if ( pResult )
+			{
+				( *pResult )( 2 * i ) = u;
+				( *pResult )( 2 * i + 1 ) = v;
+			}
+			if ( !pJ )
+				continue;
 			
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ) ) 
-				= ublas::prod( projJ, m_cam );
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 3, 7 ) ) 
-				= ublas::prod( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ), rotJ );
+			// dehomogenization jacobian times camera matrix is the jacobian wrt. t
+			VType a[ 2 ][ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+			{
+				a[ 0 ][ k ] = ( cam( 0, k ) - u * cam( 2, k ) ) * iz;
+				a[ 1 ][ k ] = ( cam( 1, k ) - v * cam( 2, k ) ) * iz;
+			}
+			
+			// chain rule with the jacobian of the rotation wrt. the quaternion
+			QuaternionRotation< VType >( p ).jacobian( q, rotJ );
+			MT& J( *pJ );
+			for ( std::size_t row( 0 ); row < 2; ++row )
+			{
+				for ( std::size_t k( 0 ); k < 3; ++k )
+					J( 2 * i + row, k ) = a[ row ][ k ];
+				for ( std::size_t k( 0 ); k < 4; ++k )
+					J( 2 * i + row, 3 + k ) = a[ row ][ 0 ] * rotJ( 0, k ) + a[ row ][ 1 ] * rotJ( 1, k ) + a[ row ][ 2 ] * rotJ( 2, k );
+			}
 		}
 	}
 	
-protected:
 	const std::vector< Math::Vector< VType, 3 > >& m_p3D;
 	const Math::Matrix< VType, 3, 3 >& m_cam;
 };
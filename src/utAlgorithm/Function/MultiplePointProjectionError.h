@@ -77,38 +77,91 @@ public:
 	template< class VT2, class MT > 
 	void jacobian( const VT2& input, MT& J ) const
 	{
-		using namespace Ubitrack::Math;
-		namespace ublas = boost::numeric::ublas;
-
-		// convert quaternion to matrix (for speedup)
-		Quaternion rotQ( Quaternion::fromVector( ublas::subrange( input, 3, 7 ) ) );
-		Matrix< VType, 3, 3 > rot( rotQ );
+		Math::Vector< VType, 4 > q;
+		Math::Matrix< VType, 3, 3 > rot;
+		VType t[ 3 ];
+		prepare( input, q, rot, t );
 		
-		// create matrices
-		Matrix< VType, 2, 3 > projJ;
-		Matrix< VType, 3, 3 > rotJ;
-		Vector< VType, 3 > rotated;
-		Vector< VType, 3 > projected;
+		VType j[ 2 ][ 6 ];
+		for ( std::size_t i( 0 ); i < m_p3D.size(); i++ )
+		{
+			pointJacobian( m_p3D[ i ], q, rot, t, j );
+			for ( std::size_t row( 0 ); row < 2; ++row )
+				for ( std::size_t k( 0 ); k < 6; ++k )
+					J( 2 * i + row, k ) = j[ row ][ k ];
+		}
+	}
+	
+	/**
+	 * Accumulates the 6x6 normal matrix J^T * J of the jacobian point by point, without storing the jacobian.
+	 * @param input containing the parameters (pose as 7-vector)
+	 * @param n matrix to which the normal matrix is added, only the lower triangle is written
+	 */
+	template< class VT2 > 
+	void addNormalMatrix( const VT2& input, Math::Matrix< double, 6, 6 >& n ) const
+	{
+		Math::Vector< VType, 4 > q;
+		Math::Matrix< VType, 3, 3 > rot;
+		VType t[ 3 ];
+		prepare( input, q, rot, t );
 		
+		VType j[ 2 ][ 6 ];
 		for ( std::size_t i( 0 ); i < m_p3D.size(); i++ )
 		{
-			// rotate & project points
-			noalias( rotated ) = ublas::prod( rot, m_p3D[ i ] ) + ublas::subrange( input, 0, 3 );
-			noalias( projected ) = ublas::prod( m_cam, rotated );
-			
-			// create jacobian for this measurement
-			QuaternionRotationError< VType > qrf( m_p3D[ i ] );
-			qrf.jacobian( ublas::subrange( input, 3, 7 ), rotJ );
-			Dehomogenization< 3 >().jacobian( projected, projJ );
-			
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ) ) 
-				= ublas::prod( projJ, m_cam );
-			noalias( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 3, 6 ) ) 
-				= ublas::prod( ublas::subrange( J, i * 2, ( i + 1 ) * 2, 0, 3 ), rotJ );
+			pointJacobian( m_p3D[ i ], q, rot, t, j );
+			for ( std::size_t r( 0 ); r < 6; ++r )
+				for ( std::size_t c( 0 ); c <= r; ++c )
+					n( r, c ) += double( j[ 0 ][ r ] ) * j[ 0 ][ c ] + double( j[ 1 ][ r ] ) * j[ 1 ][ c ];
 		}
 	}
 	
 protected:
+	/** converts the quaternion to a matrix once for all points */
+	template< class VT2 >
+	static void prepare( const VT2& input, Math::Vector< VType, 4 >& q, Math::Matrix< VType, 3, 3 >& rot, VType t[ 3 ] )
+	{
+		q = Math::Vector< VType, 4 >( input( 3 ), input( 4 ), input( 5 ), input( 6 ) );
+		Math::Quaternion::vectorToMatrix( q, rot );
+		for ( std::size_t k( 0 ); k < 3; ++k )
+			t[ k ] = VType( input( k ) );
+	}
+	
+	/** computes the two rows of the jacobian of a single point */
+	void pointJacobian( const Math::Vector< VType, 3 >& p, const Math::Vector< VType, 4 >& q, 
+		const Math::Matrix< VType, 3, 3 >& rot, const VType t[ 3 ], VType j[ 2 ][ 6 ] ) const
+	{
+		const Math::Matrix< VType, 3, 3 >& cam( m_cam );
+		
+		// rotate & project point
+		VType r[ 3 ];
+		for ( std::size_t k( 0 ); k < 3; ++k )
+			r[ k ] = rot( k, 0 ) * p( 0 ) + rot( k, 1 ) * p( 1 ) + rot( k, 2 ) * p( 2 ) + t[ k ];
+		VType x[ 3 ];
+		for ( std::size_t k( 0 ); k < 3; ++k )
+			x[ k ] = cam( k, 0 ) * r[ 0 ] + cam( k, 1 ) * r[ 1 ] + cam( k, 2 ) * r[ 2 ];
+		const VType iz = 1 / x[ 2 ];
+		const VType u = x[ 0 ] * iz;
+		const VType v = x[ 1 ] * iz;
+		
+		// dehomogenization jacobian times camera matrix is the jacobian wrt. e_t
+		VType a[ 2 ][ 3 ];
+		for ( std::size_t k( 0 ); k < 3; ++k )
+		{
+			a[ 0 ][ k ] = ( cam( 0, k ) - u * cam( 2, k ) ) * iz;
+			a[ 1 ][ k ] = ( cam( 1, k ) - v * cam( 2, k ) ) * iz;
+		}
+		
+		// chain rule with the jacobian of the rotation wrt. e_r
+		Math::Matrix< VType, 3, 3 > rotJ;
+		QuaternionRotationError< VType >( p ).jacobian( q, rotJ );
+		for ( std::size_t row( 0 ); row < 2; ++row )
+			for ( std::size_t k( 0 ); k < 3; ++k )
+			{
+				j[ row ][ k ] = a[ row ][ k ];
+				j[ row ][ 3 + k ] = a[ row ][ 0 ] * rotJ( 0, k ) + a[ row ][ 1 ] * rotJ( 1, k ) + a[ row ][ 2 ] * rotJ( 2, k );
+			}
+	}
+	
 	const std::vector< Math::Vector< VType, 3 > >& m_p3D;
 	const Math::Matrix< VType, 3, 3 >& m_cam;
 };
@@ -84,13 +84,7 @@ public:
 	 */
 	template< class VT1, class VT2 > 
 	void evaluate( VT1& result, const VT2& input ) const
-	{
-		namespace ublas = boost::numeric::ublas;
-
-		std::size_t i ( 0 );
-		for ( ForwardIterator1 it ( m_iBegin ); it != m_iEnd; ++i, ++it )
-			ublas::subrange ( result, i*2+0, i*2+2 ) = Math::Geometry::ProjectPoint()( *it, static_cast< Math::Vector< VType, 3 > > ( ublas::subrange( input, 0, 3 )  ) );
-	}
+	{ compute( &result, input, static_cast< Math::Matrix< VType, 0, 0 >* >( 0 ) ); }
 	
 	/**
 	 * @param result vector to store the result in
@@ -99,11 +93,7 @@ public:
 	 */
 	template< class VT1, class VT2, class MT > 
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
-	{
-		// TODO: implement as one function (more efficient)
-		evaluate( result, input );
-		jacobian( input, J );
-	}
+	{ compute( &result, input, &J ); }
 
 	/**
 	 * @param input containing the parameters (to be optimized)
@@ -111,18 +101,40 @@ public:
 	 */
 	template< class VT2, class MT > 
 	void jacobian( const VT2& input, MT& J ) const
+	{ compute( static_cast< Math::Vector< VType, 0 >* >( 0 ), input, &J ); }
+
+protected:
+	/**
+	 * computes the projections and/or the jacobian in one pass over the projections, writing the
+	 * elements of \c result and \c J directly. Null pointers are skipped.
+	 */
+	template< class VT1, class VT2, class MT >
+	void compute( VT1* pResult, const VT2& input, MT* pJ ) const
 	{
-		const Math::Vector< VType, 3 > vec( input( 0 ), input( 1 ), input( 2 ) );		
+		const VType px( input( 0 ) );
+		const VType py( input( 1 ) );
+		const VType pz( input( 2 ) );
 		std::size_t i( 0 );
 		for ( ForwardIterator1 it ( m_iBegin ); it != m_iEnd; ++i, ++it )
 		{
+			VType point[ 3 ];
+			for ( std::size_t k( 0 ); k < 3; ++k )
+				point[ k ] = (*it)( k, 0 ) * px + (*it)( k, 1 ) * py + (*it)( k, 2 ) * pz + (*it)( k, 3 );
+			const VType P3_14p = point[ 2 ];
+			
+			if ( pResult )
+			{
+				( *pResult )( i*2+0 ) = point[ 0 ] / P3_14p;
+				( *pResult )( i*2+1 ) = point[ 1 ] / P3_14p;
+			}
+			if ( !pJ )
+				continue;
 			
-			const Math::Vector< VType, 3 > point ( Math::Geometry::TransformPoint()( *it, vec ) );
-			const VType P3_14p = point( 2 );
+			MT& J( *pJ );
 			//= 1/(P3_14p^2)
 			const VType P3_14p2 = 1 / (P3_14p * P3_14p); 
-			const VType P1_14p = P3_14p2 * point( 0 );
-			const VType P2_14p = P3_14p2 * point( 1 );
+			const VType P1_14p = P3_14p2 * point[ 0 ];
+			const VType P2_14p = P3_14p2 * point[ 1 ];
 			
 			const VType P3_1 = (*it)( 2, 0 );
 			const VType P3_2 = (*it)( 2, 1 );
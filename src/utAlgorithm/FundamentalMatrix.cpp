@@ -30,12 +30,16 @@
  */ 
 
 #include "FundamentalMatrix.h"
+#include "FundamentalMatrixRansac.h"
+#include "DirectLinearTransform.h"
+#include "Polynomial.h"
 #include <utMath/MatrixOperations.h>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 
 #include <log4cpp/Category.hh>
 #include <utUtil/Exception.h>
 #include <utUtil/Logging.h>
+#include <utUtil/TraceSpan.h>
 #include <boost/numeric/ublas/io.hpp>
 
 #ifdef HAVE_LAPACK
@@ -84,6 +88,7 @@ Math::Matrix< T, 3, 3 > getFundamentalMatrixImpl( const std::vector< Math::Vecto
 	const std::vector< Math::Vector< T, 2 > > & toPoints, std::size_t stepSize )
 {
 	static log4cpp::Category& logger(log4cpp::Category::getInstance( "Ubitrack.Calibration.FundamentalMatrix" ));
+	UBITRACK_TRACE_SPAN( "fundamental_matrix", fromPoints.size() );
 	
 	if( stepSize < 1 )
 	{
@@ -116,50 +121,36 @@ Math::Matrix< T, 3, 3 > getFundamentalMatrixImpl( const std::vector< Math::Vecto
 	normalize( toShift, toScale, toModMatrix, toPoints );
 
 	//Linear Solution
-	Math::Matrix< T, 0, 0 > A( fromPoints.size() / stepSize, 9 );
-
+	HomogeneousLinearSystem< 9 > system;
 	for( std::size_t i=0; i < ( fromPoints.size() / stepSize ); i++ )
 	{
-		T x = ( fromPoints.at( i * stepSize )( 0 ) - fromShift( 0 ) ) * fromScale;
-		T x_ = ( toPoints.at( i * stepSize )( 0 ) - toShift( 0 ) ) * toScale;
-		T y = ( fromPoints.at( i * stepSize )( 1 ) - fromShift( 1 ) ) * fromScale;
-		T y_ = ( toPoints.at( i * stepSize )( 1 ) - toShift( 1 ) ) * toScale;
-
-		A( i, 0 ) = x_ * x;
-		A( i, 1 ) = x_ * y;
-		A( i, 2 ) = x_;
-		A( i, 3 ) = y_* x;
-		A( i, 4 ) = y_ * y;
-		A( i, 5 ) = y_;
-		A( i, 6 ) = x;
-		A( i, 7 ) = y;
-		A( i, 8 ) = static_cast< T >( 1.0 );
-	}
+		const double x = ( fromPoints[ i * stepSize ]( 0 ) - fromShift( 0 ) ) * fromScale;
+		const double x_ = ( toPoints[ i * stepSize ]( 0 ) - toShift( 0 ) ) * toScale;
+		const double y = ( fromPoints[ i * stepSize ]( 1 ) - fromShift( 1 ) ) * fromScale;
+		const double y_ = ( toPoints[ i * stepSize ]( 1 ) - toShift( 1 ) ) * toScale;
 
-	// solve using SVD
-	std::size_t nSingularValues = std::min( A.size1(), A.size2() );
-	Math::Vector< T > s1( nSingularValues );
-	Math::Matrix< T, 9, 9 > Vt;
-	Math::Matrix< T, 0, 0 > U( fromPoints.size() / stepSize, fromPoints.size() / stepSize );
-	int info = lapack::gesvd( 'N', 'A', A, s1, U, Vt );
+		const double row[ 9 ] = { x_ * x, x_ * y, x_, y_ * x, y_ * y, y_, x, y, 1 };
+		system.addRow( row );
+	}
 
-	if ( info != 0 )
+	Math::Vector< T, 9 > f;
+	if ( !system.solve( f ) )
 	{
-		LOG4CPP_ERROR ( logger, "first SVD failed");
-		UBITRACK_THROW ( "first SVD failed" );	
+		LOG4CPP_ERROR ( logger, "eigen decomposition of the linear solution failed");
+		UBITRACK_THROW ( "eigen decomposition of the linear solution failed" );	
 	}
 
 	// copy result to 3x3 matrix
 	Math::Matrix< T, 3, 3 > F;
-	F( 0, 0 ) = Vt( 8, 0 ); F( 0, 1 ) = Vt( 8, 1 ); F( 0, 2 ) = Vt( 8, 2 );
-	F( 1, 0 ) = Vt( 8, 3 ); F( 1, 1 ) = Vt( 8, 4 ); F( 1, 2 ) = Vt( 8, 5 );
-	F( 2, 0 ) = Vt( 8, 6 ); F( 2, 1 ) = Vt( 8, 7 ); F( 2, 2 ) = Vt( 8, 8 );
+	F( 0, 0 ) = f( 0 ); F( 0, 1 ) = f( 1 ); F( 0, 2 ) = f( 2 );
+	F( 1, 0 ) = f( 3 ); F( 1, 1 ) = f( 4 ); F( 1, 2 ) = f( 5 );
+	F( 2, 0 ) = f( 6 ); F( 2, 1 ) = f( 7 ); F( 2, 2 ) = f( 8 );
 
 	// constraint enforcement
 	Math::Vector< T, 3 > s2;
 	Math::Matrix< T, 3, 3 > U2;
 	Math::Matrix< T, 3, 3 > Vt2;
-	info = lapack::gesvd( 'A', 'A', F, s2, U2, Vt2 );
+	const int info = lapack::gesvd( 'A', 'A', F, s2, U2, Vt2 );
 
 	if ( info != 0 )
 	{
@@ -188,6 +179,721 @@ Math::Matrix< double, 3, 3 > getFundamentalMatrix( const std::vector< Math::Vect
 	return getFundamentalMatrixImpl( fromPoints, toPoints, stepSize );
 }
 
+/** determinant of a row-major 3x3 matrix */
+inline double determinant3x3( const double* m )
+{
+	return m[ 0 ] * ( m[ 4 ] * m[ 8 ] - m[ 5 ] * m[ 7 ] )
+		- m[ 1 ] * ( m[ 3 ] * m[ 8 ] - m[ 5 ] * m[ 6 ] )
+		+ m[ 2 ] * ( m[ 3 ] * m[ 7 ] - m[ 4 ] * m[ 6 ] );
+}
+
+template< typename T >
+std::size_t fundamentalMatrix7PointImpl( const std::vector< Math::Vector< T, 2 > > & fromPoints,
+	const std::vector< Math::Vector< T, 2 > > & toPoints, std::vector< Math::Matrix< T, 3, 3 > >& solutions )
+{
+	if( fromPoints.size() < 7 || toPoints.size() < 7 )
+		UBITRACK_THROW ( "Input sizes to small. Use at least 7 values" );
+
+	//Normalization of the first seven points
+	const std::vector< Math::Vector< T, 2 > > from7( fromPoints.begin(), fromPoints.begin() + 7 );
+	const std::vector< Math::Vector< T, 2 > > to7( toPoints.begin(), toPoints.begin() + 7 );
+	Math::Vector< T, 2 > fromShift;
+	T fromScale;
+	Math::Vector< T, 2 > toShift;
+	T toScale;
+	Math::Matrix< T, 3, 3 > fromModMatrix;
+	Math::Matrix< T, 3, 3 > toModMatrix;
+	normalize( fromShift, fromScale, fromModMatrix, from7 );
+	normalize( toShift, toScale, toModMatrix, to7 );
+
+	double a[ 7 ][ 9 ];
+	double maxEntry = 0;
+	for( std::size_t i = 0; i < 7; i++ )
+	{
+		const double x = ( from7[ i ]( 0 ) - fromShift( 0 ) ) * fromScale;
+		const double x_ = ( to7[ i ]( 0 ) - toShift( 0 ) ) * toScale;
+		const double y = ( from7[ i ]( 1 ) - fromShift( 1 ) ) * fromScale;
+		const double y_ = ( to7[ i ]( 1 ) - toShift( 1 ) ) * toScale;
+
+		const double row[ 9 ] = { x_ * x, x_ * y, x_, y_ * x, y_ * y, y_, x, y, 1 };
+		for ( std::size_t j = 0; j < 9; j++ )
+		{
+			a[ i ][ j ] = row[ j ];
+			maxEntry = std::max( maxEntry, std::fabs( row[ j ] ) );
+		}
+	}
+
+	// gauss-jordan elimination with full pivoting, the two remaining columns span the null space
+	std::size_t cols[ 9 ] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+	for ( std::size_t r = 0; r < 7; r++ )
+	{
+		std::size_t pivotRow = r;
+		std::size_t pivotCol = r;
+		double pivot = 0;
+		for ( std::size_t i = r; i < 7; i++ )
+			for ( std::size_t j = r; j < 9; j++ )
+				if ( std::fabs( a[ i ][ cols[ j ] ] ) > pivot )
+				{
+					pivot = std::fabs( a[ i ][ cols[ j ] ] );
+					pivotRow = i;
+					pivotCol = j;
+				}
+
+		// rank deficient, e.g. for points on a plane or a line
+		if ( !( pivot > 1e-10 * maxEntry ) )
+			return 0;
+
+		std::swap( cols[ r ], cols[ pivotCol ] );
+		for ( std::size_t j = 0; j < 9; j++ )
+			std::swap( a[ r ][ j ], a[ pivotRow ][ j ] );
+
+		const double scale = 1 / a[ r ][ cols[ r ] ];
+		for ( std::size_t j = 0; j < 9; j++ )
+			a[ r ][ j ] *= scale;
+		for ( std::size_t i = 0; i < 7; i++ )
+		{
+			const double factor = a[ i ][ cols[ r ] ];
+			if ( i == r || factor == 0 )
+				continue;
+			for ( std::size_t j = 0; j < 9; j++ )
+				a[ i ][ j ] -= factor * a[ r ][ j ];
+		}
+	}
+
+	double f1[ 9 ];
+	double f2[ 9 ];
+	for ( std::size_t k = 0; k < 2; k++ )
+	{
+		double* f = k ? f2 : f1;
+		for ( std::size_t j = 0; j < 9; j++ )
+			f[ j ] = 0;
+		f[ cols[ 7 + k ] ] = 1;
+		for ( std::size_t r = 0; r < 7; r++ )
+			f[ cols[ r ] ] = -a[ r ][ cols[ 7 + k ] ];
+	}
+
+	// det( a F1 + ( 1 - a ) F2 ) is a cubic polynomial, interpolated at a = 0, 1, -1, 2
+	double samples[ 4 ];
+	const double alphas[ 4 ] = { 0, 1, -1, 2 };
+	for ( std::size_t k = 0; k < 4; k++ )
+	{
+		double f[ 9 ];
+		for ( std::size_t j = 0; j < 9; j++ )
+			f[ j ] = alphas[ k ] * f1[ j ] + ( 1 - alphas[ k ] ) * f2[ j ];
+		samples[ k ] = determinant3x3( f );
+	}
+	double cubic[ 4 ];
+	cubic[ 0 ] = samples[ 0 ];
+	cubic[ 2 ] = 0.5 * ( samples[ 1 ] + samples[ 2 ] ) - samples[ 0 ];
+	const double odd = 0.5 * ( samples[ 1 ] - samples[ 2 ] );
+	cubic[ 3 ] = ( samples[ 3 ] - samples[ 0 ] - 4 * cubic[ 2 ] - 2 * odd ) / 6;
+	cubic[ 1 ] = odd - cubic[ 3 ];
+
+	double roots[ 3 ];
+	const std::size_t nRoots = realRoots( cubic, 3, roots );
+
+	for ( std::size_t k = 0; k < nRoots; k++ )
+	{
+		Math::Matrix< T, 3, 3 > F;
+		for ( std::size_t j = 0; j < 9; j++ )
+			F( j / 3, j % 3 ) = static_cast< T >( roots[ k ] * f1[ j ] + ( 1 - roots[ k ] ) * f2[ j ] );
+
+		// reverse normalization
+		F = ublas::prod( ublas::trans( toModMatrix ), F );
+		F = ublas::prod( F, fromModMatrix );
+		const T norm = ublas::norm_frobenius( F );
+		solutions.push_back( F / norm );
+	}
+	return nRoots;
+}
+
+std::size_t fundamentalMatrix7Point( const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< Math::Matrix< float, 3, 3 > >& solutions )
+{
+	return fundamentalMatrix7PointImpl( fromPoints, toPoints, solutions );
+}
+
+std::size_t fundamentalMatrix7Point( const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< Math::Matrix< double, 3, 3 > >& solutions )
+{
+	return fundamentalMatrix7PointImpl( fromPoints, toPoints, solutions );
+}
+
+/** @internal polynomial in x, y and z of total degree up to three, c[ i ][ j ][ k ] is the coefficient of x^i y^j z^k */
+struct TrivariatePolynomial
+{
+	double c[ 4 ][ 4 ][ 4 ];
+
+	TrivariatePolynomial()
+	{ std::fill( &c[ 0 ][ 0 ][ 0 ], &c[ 0 ][ 0 ][ 0 ] + 64, 0. ); }
+
+	TrivariatePolynomial& operator+=( const TrivariatePolynomial& p )
+	{
+		for ( std::size_t i = 0; i < 64; i++ )
+			( &c[ 0 ][ 0 ][ 0 ] )[ i ] += ( &p.c[ 0 ][ 0 ][ 0 ] )[ i ];
+		return *this;
+	}
+
+	TrivariatePolynomial& operator-=( const TrivariatePolynomial& p )
+	{
+		for ( std::size_t i = 0; i < 64; i++ )
+			( &c[ 0 ][ 0 ][ 0 ] )[ i ] -= ( &p.c[ 0 ][ 0 ][ 0 ] )[ i ];
+		return *this;
+	}
+
+	TrivariatePolynomial& operator*=( const double s )
+	{
+		for ( std::size_t i = 0; i < 64; i++ )
+			( &c[ 0 ][ 0 ][ 0 ] )[ i ] *= s;
+		return *this;
+	}
+};
+
+/** @internal product of two trivariate polynomials, terms beyond degree three must not occur */
+inline TrivariatePolynomial operator*( const TrivariatePolynomial& a, const TrivariatePolynomial& b )
+{
+	TrivariatePolynomial p;
+	for ( std::size_t i1 = 0; i1 < 4; i1++ )
+		for ( std::size_t j1 = 0; i1 + j1 < 4; j1++ )
+			for ( std::size_t k1 = 0; i1 + j1 + k1 < 4; k1++ )
+			{
+				const double a1 = a.c[ i1 ][ j1 ][ k1 ];
+				if ( a1 == 0 )
+					continue;
+				for ( std::size_t i2 = 0; i1 + j1 + k1 + i2 < 4; i2++ )
+					for ( std::size_t j2 = 0; i1 + j1 + k1 + i2 + j2 < 4; j2++ )
+						for ( std::size_t k2 = 0; i1 + j1 + k1 + i2 + j2 + k2 < 4; k2++ )
+							p.c[ i1 + i2 ][ j1 + j2 ][ k1 + k2 ] += a1 * b.c[ i2 ][ j2 ][ k2 ];
+			}
+	return p;
+}
+
+template< typename T >
+std::size_t essentialMatrix5PointImpl( const std::vector< Math::Vector< T, 2 > > & fromPoints,
+	const std::vector< Math::Vector< T, 2 > > & toPoints, std::vector< Math::Matrix< T, 3, 3 > >& solutions )
+{
+	if( fromPoints.size() < 5 || toPoints.size() < 5 )
+		UBITRACK_THROW ( "Input sizes to small. Use at least 5 values" );
+
+	// the points are not normalized, as only rotations and a common scale preserve essential matrices
+	double a[ 5 ][ 9 ];
+	double maxEntry = 0;
+	for( std::size_t i = 0; i < 5; i++ )
+	{
+		const double x = fromPoints[ i ]( 0 );
+		const double x_ = toPoints[ i ]( 0 );
+		const double y = fromPoints[ i ]( 1 );
+		const double y_ = toPoints[ i ]( 1 );
+
+		const double row[ 9 ] = { x_ * x, x_ * y, x_, y_ * x, y_ * y, y_, x, y, 1 };
+		for ( std::size_t j = 0; j < 9; j++ )
+		{
+			a[ i ][ j ] = row[ j ];
+			maxEntry = std::max( maxEntry, std::fabs( row[ j ] ) );
+		}
+	}
+
+	// gauss-jordan elimination with full pivoting, the four remaining columns span the null space
+	std::size_t cols[ 9 ] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+	for ( std::size_t r = 0; r < 5; r++ )
+	{
+		std::size_t pivotRow = r;
+		std::size_t pivotCol = r;
+		double pivot = 0;
+		for ( std::size_t i = r; i < 5; i++ )
+			for ( std::size_t j = r; j < 9; j++ )
+				if ( std::fabs( a[ i ][ cols[ j ] ] ) > pivot )
+				{
+					pivot = std::fabs( a[ i ][ cols[ j ] ] );
+					pivotRow = i;
+					pivotCol = j;
+				}
+
+		if ( !( pivot > 1e-10 * maxEntry ) )
+			return 0;
+
+		std::swap( cols[ r ], cols[ pivotCol ] );
+		for ( std::size_t j = 0; j < 9; j++ )
+			std::swap( a[ r ][ j ], a[ pivotRow ][ j ] );
+
+		const double scale = 1 / a[ r ][ cols[ r ] ];
+		for ( std::size_t j = 0; j < 9; j++ )
+			a[ r ][ j ] *= scale;
+		for ( std::size_t i = 0; i < 5; i++ )
+		{
+			const double factor = a[ i ][ cols[ r ] ];
+			if ( i == r || factor == 0 )
+				continue;
+			for ( std::size_t j = 0; j < 9; j++ )
+				a[ i ][ j ] -= factor * a[ r ][ j ];
+		}
+	}
+
+	// E = x X + y Y + z Z + W with the null space basis X, Y, Z, W
+	double basis[ 4 ][ 9 ];
+	for ( std::size_t k = 0; k < 4; k++ )
+	{
+		for ( std::size_t j = 0; j < 9; j++ )
+			basis[ k ][ j ] = 0;
+		basis[ k ][ cols[ 5 + k ] ] = 1;
+		for ( std::size_t r = 0; r < 5; r++ )
+			basis[ k ][ cols[ r ] ] = -a[ r ][ cols[ 5 + k ] ];
+	}
+
+	TrivariatePolynomial E[ 3 ][ 3 ];
+	for ( std::size_t j = 0; j < 9; j++ )
+	{
+		TrivariatePolynomial& e = E[ j / 3 ][ j % 3 ];
+		e.c[ 1 ][ 0 ][ 0 ] = basis[ 0 ][ j ];
+		e.c[ 0 ][ 1 ][ 0 ] = basis[ 1 ][ j ];
+		e.c[ 0 ][ 0 ][ 1 ] = basis[ 2 ][ j ];
+		e.c[ 0 ][ 0 ][ 0 ] = basis[ 3 ][ j ];
+	}
+
+	// ten cubic constraints: det( E ) = 0 and 2 E E^T E - tr( E E^T ) E = 0
+	TrivariatePolynomial equations[ 10 ];
+	TrivariatePolynomial minor = E[ 1 ][ 1 ] * E[ 2 ][ 2 ];
+	minor -= E[ 1 ][ 2 ] * E[ 2 ][ 1 ];
+	equations[ 0 ] = E[ 0 ][ 0 ] * minor;
+	minor = E[ 1 ][ 0 ] * E[ 2 ][ 2 ];
+	minor -= E[ 1 ][ 2 ] * E[ 2 ][ 0 ];
+	equations[ 0 ] -= E[ 0 ][ 1 ] * minor;
+	minor = E[ 1 ][ 0 ] * E[ 2 ][ 1 ];
+	minor -= E[ 1 ][ 1 ] * E[ 2 ][ 0 ];
+	equations[ 0 ] += E[ 0 ][ 2 ] * minor;
+
+	TrivariatePolynomial EEt[ 3 ][ 3 ];
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = i; j < 3; j++ )
+		{
+			for ( std::size_t k = 0; k < 3; k++ )
+				EEt[ i ][ j ] += E[ i ][ k ] * E[ j ][ k ];
+			EEt[ j ][ i ] = EEt[ i ][ j ];
+		}
+	TrivariatePolynomial trace = EEt[ 0 ][ 0 ];
+	trace += EEt[ 1 ][ 1 ];
+	trace += EEt[ 2 ][ 2 ];
+	trace *= -0.5;
+
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+		{
+			TrivariatePolynomial& e = equations[ 1 + 3 * i + j ];
+			e = trace * E[ i ][ j ];
+			for ( std::size_t k = 0; k < 3; k++ )
+				e += EEt[ i ][ k ] * E[ k ][ j ];
+		}
+
+	// coefficient matrix, the monomials that are eliminated come first:
+	// x^3, y^3, x^2 y, x y^2, x^2 z, x^2, y^2 z, y^2, x y z, x y | x z^2, x z, x, y z^2, y z, y, z^3, z^2, z, 1
+	static const std::size_t monomials[ 20 ][ 3 ] = {
+		{ 3, 0, 0 }, { 0, 3, 0 }, { 2, 1, 0 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 0, 0 }, { 0, 2, 1 }, { 0, 2, 0 }, { 1, 1, 1 }, { 1, 1, 0 },
+		{ 1, 0, 2 }, { 1, 0, 1 }, { 1, 0, 0 }, { 0, 1, 2 }, { 0, 1, 1 }, { 0, 1, 0 }, { 0, 0, 3 }, { 0, 0, 2 }, { 0, 0, 1 }, { 0, 0, 0 } };
+	double m[ 10 ][ 20 ];
+	for ( std::size_t i = 0; i < 10; i++ )
+		for ( std::size_t j = 0; j < 20; j++ )
+			m[ i ][ j ] = equations[ i ].c[ monomials[ j ][ 0 ] ][ monomials[ j ][ 1 ] ][ monomials[ j ][ 2 ] ];
+
+	// gauss-jordan elimination with partial pivoting of the first ten columns
+	for ( std::size_t r = 0; r < 10; r++ )
+	{
+		std::size_t pivotRow = r;
+		for ( std::size_t i = r + 1; i < 10; i++ )
+			if ( std::fabs( m[ i ][ r ] ) > std::fabs( m[ pivotRow ][ r ] ) )
+				pivotRow = i;
+		if ( !( std::fabs( m[ pivotRow ][ r ] ) > 1e-14 ) )
+			return 0;
+
+		for ( std::size_t j = 0; j < 20; j++ )
+			std::swap( m[ r ][ j ], m[ pivotRow ][ j ] );
+		const double scale = 1 / m[ r ][ r ];
+		for ( std::size_t j = r; j < 20; j++ )
+			m[ r ][ j ] *= scale;
+		for ( std::size_t i = 0; i < 10; i++ )
+		{
+			const double factor = m[ i ][ r ];
+			if ( i == r || factor == 0 )
+				continue;
+			for ( std::size_t j = r; j < 20; j++ )
+				m[ i ][ j ] -= factor * m[ r ][ j ];
+		}
+	}
+
+	// the rows of x^2 z and x^2, y^2 z and y^2, x y z and x y give ( row_p - z row_q ) with only
+	// the monomials x, y and 1 times polynomials in z: C( z ) ( x, y, 1 )^T = 0
+	double C[ 3 ][ 3 ][ 5 ];
+	for ( std::size_t k = 0; k < 3; k++ )
+	{
+		const double* bp = m[ 4 + 2 * k ] + 10;
+		const double* bq = m[ 5 + 2 * k ] + 10;
+		const double cx[ 5 ] = { bp[ 2 ], bp[ 1 ] - bq[ 2 ], bp[ 0 ] - bq[ 1 ], -bq[ 0 ], 0 };
+		const double cy[ 5 ] = { bp[ 5 ], bp[ 4 ] - bq[ 5 ], bp[ 3 ] - bq[ 4 ], -bq[ 3 ], 0 };
+		const double c1[ 5 ] = { bp[ 9 ], bp[ 8 ] - bq[ 9 ], bp[ 7 ] - bq[ 8 ], bp[ 6 ] - bq[ 7 ], -bq[ 6 ] };
+		std::copy( cx, cx + 5, C[ k ][ 0 ] );
+		std::copy( cy, cy + 5, C[ k ][ 1 ] );
+		std::copy( c1, c1 + 5, C[ k ][ 2 ] );
+	}
+
+	// det( C( z ) ) is of degree ten, expanded along the first row
+	double minor1[ 8 ], minor2[ 8 ], minor3[ 7 ], product[ 8 ];
+	multiplyPolynomials( C[ 1 ][ 1 ], 3, C[ 2 ][ 2 ], 4, minor1 );
+	multiplyPolynomials( C[ 1 ][ 2 ], 4, C[ 2 ][ 1 ], 3, product );
+	for ( std::size_t i = 0; i < 8; i++ )
+		minor1[ i ] -= product[ i ];
+	multiplyPolynomials( C[ 1 ][ 0 ], 3, C[ 2 ][ 2 ], 4, minor2 );
+	multiplyPolynomials( C[ 1 ][ 2 ], 4, C[ 2 ][ 0 ], 3, product );
+	for ( std::size_t i = 0; i < 8; i++ )
+		minor2[ i ] -= product[ i ];
+	multiplyPolynomials( C[ 1 ][ 0 ], 3, C[ 2 ][ 1 ], 3, minor3 );
+	multiplyPolynomials( C[ 1 ][ 1 ], 3, C[ 2 ][ 0 ], 3, product );
+	for ( std::size_t i = 0; i < 7; i++ )
+		minor3[ i ] -= product[ i ];
+
+	double det[ 11 ];
+	double term[ 11 ];
+	multiplyPolynomials( C[ 0 ][ 0 ], 3, minor1, 7, det );
+	multiplyPolynomials( C[ 0 ][ 1 ], 3, minor2, 7, term );
+	for ( std::size_t i = 0; i < 11; i++ )
+		det[ i ] -= term[ i ];
+	multiplyPolynomials( C[ 0 ][ 2 ], 4, minor3, 6, term );
+	for ( std::size_t i = 0; i < 11; i++ )
+		det[ i ] += term[ i ];
+
+	double roots[ 10 ];
+	const std::size_t nRoots = realRoots( det, 10, roots );
+
+	std::size_t nSolutions = 0;
+	for ( std::size_t r = 0; r < nRoots; r++ )
+	{
+		const double z = roots[ r ];
+		double c[ 3 ][ 3 ];
+		for ( std::size_t i = 0; i < 3; i++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+				c[ i ][ j ] = evaluatePolynomial( C[ i ][ j ], 4, z );
+
+		// ( x, y, 1 ) is the null vector of C( z ), the most stable cross product of two rows
+		double v[ 3 ] = { 0, 0, 0 };
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			const double* r1 = c[ k == 0 ? 1 : 0 ];
+			const double* r2 = c[ k == 2 ? 1 : 2 ];
+			const double w[ 3 ] = { r1[ 1 ] * r2[ 2 ] - r1[ 2 ] * r2[ 1 ],
+				r1[ 2 ] * r2[ 0 ] - r1[ 0 ] * r2[ 2 ], r1[ 0 ] * r2[ 1 ] - r1[ 1 ] * r2[ 0 ] };
+			if ( std::fabs( w[ 2 ] ) > std::fabs( v[ 2 ] ) )
+				std::copy( w, w + 3, v );
+		}
+		if ( v[ 2 ] == 0 )
+			continue;
+		const double x = v[ 0 ] / v[ 2 ];
+		const double y = v[ 1 ] / v[ 2 ];
+
+		Math::Matrix< T, 3, 3 > Em;
+		for ( std::size_t j = 0; j < 9; j++ )
+			Em( j / 3, j % 3 ) = static_cast< T >( x * basis[ 0 ][ j ] + y * basis[ 1 ][ j ] + z * basis[ 2 ][ j ] + basis[ 3 ][ j ] );
+		const T norm = ublas::norm_frobenius( Em );
+		solutions.push_back( Em / norm );
+		nSolutions++;
+	}
+	return nSolutions;
+}
+
+std::size_t essentialMatrix5Point( const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< Math::Matrix< float, 3, 3 > >& solutions )
+{
+	return essentialMatrix5PointImpl( fromPoints, toPoints, solutions );
+}
+
+std::size_t essentialMatrix5Point( const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< Math::Matrix< double, 3, 3 > >& solutions )
+{
+	return essentialMatrix5PointImpl( fromPoints, toPoints, solutions );
+}
+
+/** @internal rotation matrix of a rotation vector by the rodrigues formula */
+inline Math::Matrix< double, 3, 3 > rotationFromVector( const double* w )
+{
+	const double angle = std::sqrt( w[ 0 ] * w[ 0 ] + w[ 1 ] * w[ 1 ] + w[ 2 ] * w[ 2 ] );
+	Math::Matrix< double, 3, 3 > R = Math::Matrix< double, 3, 3 >::identity();
+	if ( angle == 0 )
+		return R;
+
+	const double k[ 3 ] = { w[ 0 ] / angle, w[ 1 ] / angle, w[ 2 ] / angle };
+	const double s = std::sin( angle );
+	const double c = 1 - std::cos( angle );
+	const double K[ 3 ][ 3 ] = { { 0, -k[ 2 ], k[ 1 ] }, { k[ 2 ], 0, -k[ 0 ] }, { -k[ 1 ], k[ 0 ], 0 } };
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+		{
+			double kk = 0;
+			for ( std::size_t l = 0; l < 3; l++ )
+				kk += K[ i ][ l ] * K[ l ][ j ];
+			R( i, j ) += s * K[ i ][ j ] + c * kk;
+		}
+	return R;
+}
+
+/** @internal signed Sampson distances of the correspondences to U R( a ) diag( 1, 1, 0 ) R( b )^T V^T, returns the squared sum */
+template< typename T >
+double essentialResiduals( const Math::Matrix< double, 3, 3 >& U, const Math::Matrix< double, 3, 3 >& Vt, const double* p,
+	const std::vector< Math::Vector< T, 2 > >& fromPoints, const std::vector< Math::Vector< T, 2 > >& toPoints, double* residuals )
+{
+	Math::Matrix< double, 3, 3 > A = ublas::prod( U, rotationFromVector( p ) );
+	const Math::Matrix< double, 3, 3 > B = ublas::prod( ublas::trans( rotationFromVector( p + 3 ) ), Vt );
+	ublas::column( A, 2 ) *= 0.0;
+	const Math::Matrix< double, 3, 3 > E = ublas::prod( A, B );
+	const double f[ 9 ] = { E( 0, 0 ), E( 0, 1 ), E( 0, 2 ), E( 1, 0 ), E( 1, 1 ), E( 1, 2 ), E( 2, 0 ), E( 2, 1 ), E( 2, 2 ) };
+
+	double sum = 0;
+	for ( std::size_t i = 0; i < fromPoints.size(); i++ )
+	{
+		const double x = fromPoints[ i ]( 0 );
+		const double y = fromPoints[ i ]( 1 );
+		const double u = toPoints[ i ]( 0 );
+		const double v = toPoints[ i ]( 1 );
+		const double l0 = f[ 0 ] * x + f[ 1 ] * y + f[ 2 ];
+		const double l1 = f[ 3 ] * x + f[ 4 ] * y + f[ 5 ];
+		const double l2 = f[ 6 ] * x + f[ 7 ] * y + f[ 8 ];
+		const double m0 = f[ 0 ] * u + f[ 3 ] * v + f[ 6 ];
+		const double m1 = f[ 1 ] * u + f[ 4 ] * v + f[ 7 ];
+		residuals[ i ] = ( u * l0 + v * l1 + l2 ) / std::sqrt( l0 * l0 + l1 * l1 + m0 * m0 + m1 * m1 );
+		sum += residuals[ i ] * residuals[ i ];
+	}
+	return sum;
+}
+
+/**
+ * @internal minimizes the Sampson distances by levenberg-marquardt on the essential matrices
+ * U R( a ) diag( 1, 1, 0 ) R( b )^T V^T, which keeps the essential structure that the projection
+ * of the linear solution only enforces afterwards.
+ */
+template< typename T >
+void refineEssentialMatrix( Math::Matrix< double, 3, 3 >& U, Math::Matrix< double, 3, 3 >& Vt,
+	const std::vector< Math::Vector< T, 2 > >& fromPoints, const std::vector< Math::Vector< T, 2 > >& toPoints )
+{
+	const std::size_t n = fromPoints.size();
+	std::vector< double > residuals( n );
+	std::vector< double > shifted( n );
+	std::vector< double > jacobian( 6 * n );
+	const double zero[ 6 ] = { 0, 0, 0, 0, 0, 0 };
+	double cost = essentialResiduals( U, Vt, zero, fromPoints, toPoints, &residuals[ 0 ] );
+	double lambda = 1e-3;
+
+	for ( std::size_t iter = 0; iter < 20 && cost > 0; iter++ )
+	{
+		// forward differences
+		for ( std::size_t k = 0; k < 6; k++ )
+		{
+			double p[ 6 ] = { 0, 0, 0, 0, 0, 0 };
+			p[ k ] = 1e-7;
+			essentialResiduals( U, Vt, p, fromPoints, toPoints, &shifted[ 0 ] );
+			for ( std::size_t i = 0; i < n; i++ )
+				jacobian[ 6 * i + k ] = ( shifted[ i ] - residuals[ i ] ) * 1e7;
+		}
+
+		Math::Matrix< double, 6, 6 > JtJ = Math::Matrix< double, 6, 6 >::zeros();
+		Math::Vector< double, 6 > Jtr = Math::Vector< double, 6 >::zeros();
+		for ( std::size_t i = 0; i < n; i++ )
+			for ( std::size_t k = 0; k < 6; k++ )
+			{
+				Jtr( k ) += jacobian[ 6 * i + k ] * residuals[ i ];
+				for ( std::size_t l = 0; l < 6; l++ )
+					JtJ( k, l ) += jacobian[ 6 * i + k ] * jacobian[ 6 * i + l ];
+			}
+
+		// a rotation about the third axis in both factors leaves E unchanged, the damping keeps the system regular
+		bool bImproved = false;
+		while ( !bImproved && lambda < 1e6 )
+		{
+			Math::Matrix< double, 6, 6 > A = JtJ;
+			for ( std::size_t k = 0; k < 6; k++ )
+				A( k, k ) += lambda * JtJ( k, k ) + 1e-12;
+			const Math::Vector< double, 6 > step = ublas::prod( Math::invert_matrix( A ), Jtr );
+			const double p[ 6 ] = { -step( 0 ), -step( 1 ), -step( 2 ), -step( 3 ), -step( 4 ), -step( 5 ) };
+
+			const double newCost = essentialResiduals( U, Vt, p, fromPoints, toPoints, &shifted[ 0 ] );
+			if ( newCost < cost )
+			{
+				bImproved = true;
+				U = ublas::prod( U, rotationFromVector( p ) );
+				Vt = ublas::prod( ublas::trans( rotationFromVector( p + 3 ) ), Vt );
+				residuals.swap( shifted );
+				const bool bConverged = cost - newCost <= 1e-10 * cost;
+				cost = newCost;
+				lambda = std::max( lambda * 0.1, 1e-9 );
+				if ( bConverged )
+					return;
+			}
+			else
+				lambda *= 10;
+		}
+		if ( !bImproved )
+			return;
+	}
+}
+
+template< typename T >
+Math::Matrix< T, 3, 3 > getEssentialMatrixImpl( const std::vector< Math::Vector< T, 2 > > & fromPoints,
+	const std::vector< Math::Vector< T, 2 > > & toPoints )
+{
+	Math::Matrix< double, 3, 3 > E;
+	{
+		const Math::Matrix< T, 3, 3 > F = getFundamentalMatrixImpl( fromPoints, toPoints, 1 );
+		for ( std::size_t i = 0; i < 3; i++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+				E( i, j ) = F( i, j );
+	}
+
+	Math::Vector< double, 3 > s;
+	Math::Matrix< double, 3, 3 > U;
+	Math::Matrix< double, 3, 3 > Vt;
+	if ( lapack::gesvd( 'A', 'A', E, s, U, Vt ) != 0 )
+		UBITRACK_THROW ( "SVD of the essential matrix failed" );
+
+	// the projection onto equal singular values is sensitive to noise in small fields of view
+	refineEssentialMatrix( U, Vt, fromPoints, toPoints );
+
+	// equal singular values of unit frobenius norm
+	ublas::column( U, 0 ) *= std::sqrt( 0.5 );
+	ublas::column( U, 1 ) *= std::sqrt( 0.5 );
+	ublas::column( U, 2 ) *= 0.0;
+	E = ublas::prod( U, Vt );
+
+	Math::Matrix< T, 3, 3 > result;
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			result( i, j ) = static_cast< T >( E( i, j ) );
+	return result;
+}
+
+Math::Matrix< float, 3, 3 > getEssentialMatrix( const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints )
+{
+	return getEssentialMatrixImpl( fromPoints, toPoints );
+}
+
+Math::Matrix< double, 3, 3 > getEssentialMatrix( const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints )
+{
+	return getEssentialMatrixImpl( fromPoints, toPoints );
+}
+
+template< typename T >
+void fundamentalSampsonDistancesImpl( const Math::Matrix< T, 3, 3 >& F, const std::vector< Math::Vector< T, 2 > >& fromPoints,
+	const std::vector< Math::Vector< T, 2 > >& toPoints, std::vector< T >& distances )
+{
+	assert( fromPoints.size() == toPoints.size() );
+	distances.resize( fromPoints.size() );
+
+	const T f[ 9 ] = { F( 0, 0 ), F( 0, 1 ), F( 0, 2 ), F( 1, 0 ), F( 1, 1 ), F( 1, 2 ), F( 2, 0 ), F( 2, 1 ), F( 2, 2 ) };
+	for ( std::size_t i = 0; i < fromPoints.size(); i++ )
+		distances[ i ] = fundamentalSampsonDistance( f, fromPoints[ i ]( 0 ), fromPoints[ i ]( 1 ), toPoints[ i ]( 0 ), toPoints[ i ]( 1 ) );
+}
+
+void fundamentalSampsonDistances( const Math::Matrix< float, 3, 3 >& F, const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< float >& distances )
+{
+	fundamentalSampsonDistancesImpl( F, fromPoints, toPoints, distances );
+}
+
+void fundamentalSampsonDistances( const Math::Matrix< double, 3, 3 >& F, const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< double >& distances )
+{
+	fundamentalSampsonDistancesImpl( F, fromPoints, toPoints, distances );
+}
+
+template< typename T >
+std::size_t estimateFundamentalRansacImpl( const std::vector< Math::Vector< T, 2 > >& fromPoints, Math::Matrix< T, 3, 3 >& F,
+	const std::vector< Math::Vector< T, 2 > >& toPoints, const Math::Optimization::RansacParameter< T >& params, std::vector< bool >* pInliers )
+{
+	if( fromPoints.size() != toPoints.size() )
+		UBITRACK_THROW ( "Input sizes do not match" );
+
+	const std::size_t nInlier = estimateFundamentalRansac( fromPoints.begin(), fromPoints.end(), F, toPoints.begin(), toPoints.end(), params );
+	if ( pInliers )
+	{
+		pInliers->assign( fromPoints.size(), false );
+		if ( nInlier )
+		{
+			std::vector< T > distances;
+			fundamentalSampsonDistancesImpl( F, fromPoints, toPoints, distances );
+			for ( std::size_t i = 0; i < distances.size(); i++ )
+				( *pInliers )[ i ] = distances[ i ] < params.threshold;
+		}
+	}
+	return nInlier;
+}
+
+std::size_t estimateFundamentalRansac( const std::vector< Math::Vector< float, 2 > >& fromPoints, Math::Matrix< float, 3, 3 >& F,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, const Math::Optimization::RansacParameter< float >& params, std::vector< bool >* pInliers )
+{
+	return estimateFundamentalRansacImpl( fromPoints, F, toPoints, params, pInliers );
+}
+
+std::size_t estimateFundamentalRansac( const std::vector< Math::Vector< double, 2 > >& fromPoints, Math::Matrix< double, 3, 3 >& F,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, const Math::Optimization::RansacParameter< double >& params, std::vector< bool >* pInliers )
+{
+	return estimateFundamentalRansacImpl( fromPoints, F, toPoints, params, pInliers );
+}
+
+template< typename T >
+std::size_t estimateEssentialRansacImpl( const std::vector< Math::Vector< T, 2 > >& fromPixels, Math::Matrix< T, 3, 3 >& E,
+	const std::vector< Math::Vector< T, 2 > >& toPixels, const Math::Matrix< T, 3, 3 >& K1, const Math::Matrix< T, 3, 3 >& K2,
+	const Math::Optimization::RansacParameter< T >& params, std::vector< bool >* pInliers )
+{
+	if( fromPixels.size() != toPixels.size() )
+		UBITRACK_THROW ( "Input sizes do not match" );
+
+	std::vector< Math::Vector< T, 2 > > fromPoints( fromPixels.size() );
+	std::vector< Math::Vector< T, 2 > > toPoints( toPixels.size() );
+	for ( std::size_t i = 0; i < fromPixels.size(); i++ )
+	{
+		fromPoints[ i ] = normalizedImagePoint( K1, fromPixels[ i ] );
+		toPoints[ i ] = normalizedImagePoint( K2, toPixels[ i ] );
+	}
+
+	// the threshold in normalized image coordinates
+	const T focal = ( std::fabs( K1( 0, 0 ) ) + std::fabs( K1( 1, 1 ) ) + std::fabs( K2( 0, 0 ) ) + std::fabs( K2( 1, 1 ) ) ) / 4;
+	Math::Optimization::RansacParameter< T > normalizedParams( params.threshold / focal, params.setSize, params.nMinInlier,
+		params.nMaxIterations, params.successProbability, params.nThreads, params.seed );
+	normalizedParams.executor = params.executor;
+	normalizedParams.nLocalIterations = params.nLocalIterations;
+	normalizedParams.sprtDelta = params.sprtDelta;
+	normalizedParams.sprtModelCost = params.sprtModelCost;
+	normalizedParams.nPreemptiveHypotheses = params.nPreemptiveHypotheses;
+	normalizedParams.preemptiveBlockSize = params.preemptiveBlockSize;
+	normalizedParams.deadline = params.deadline;
+
+	const std::size_t nInlier = estimateEssentialRansac( fromPoints.begin(), fromPoints.end(), E, toPoints.begin(), toPoints.end(), normalizedParams );
+	if ( normalizedParams.deadline.expired() )
+		params.deadline.check();
+	if ( pInliers )
+	{
+		pInliers->assign( fromPoints.size(), false );
+		if ( nInlier )
+		{
+			std::vector< T > distances;
+			fundamentalSampsonDistancesImpl( E, fromPoints, toPoints, distances );
+			for ( std::size_t i = 0; i < distances.size(); i++ )
+				( *pInliers )[ i ] = distances[ i ] < normalizedParams.threshold;
+		}
+	}
+	return nInlier;
+}
+
+std::size_t estimateEssentialRansac( const std::vector< Math::Vector< float, 2 > >& fromPixels, Math::Matrix< float, 3, 3 >& E,
+	const std::vector< Math::Vector< float, 2 > >& toPixels, const Math::Matrix< float, 3, 3 >& K1, const Math::Matrix< float, 3, 3 >& K2,
+	const Math::Optimization::RansacParameter< float >& params, std::vector< bool >* pInliers )
+{
+	return estimateEssentialRansacImpl( fromPixels, E, toPixels, K1, K2, params, pInliers );
+}
+
+std::size_t estimateEssentialRansac( const std::vector< Math::Vector< double, 2 > >& fromPixels, Math::Matrix< double, 3, 3 >& E,
+	const std::vector< Math::Vector< double, 2 > >& toPixels, const Math::Matrix< double, 3, 3 >& K1, const Math::Matrix< double, 3, 3 >& K2,
+	const Math::Optimization::RansacParameter< double >& params, std::vector< bool >* pInliers )
+{
+	return estimateEssentialRansacImpl( fromPixels, E, toPixels, K1, K2, params, pInliers );
+}
+
 Math::Matrix< double, 3, 3 > fundamentalMatrixFromPoses( const Math::Pose & cam1, const Math::Pose & cam2, const Math::Matrix< double, 3, 3 > & K1, const Math::Matrix< double, 3, 3 > & K2 )
 {
 	Math::Matrix< double, 3, 4 > E1( cam1 );
@@ -299,6 +1005,78 @@ Math::Pose poseFromFundamentalMatrix( const Math::Matrix< double, 3, 3 > & fM, c
 	return Math::Pose( Math::Quaternion( Wt ), u3 );
 }
 
+
+Math::Pose poseFromEssentialMatrix( const Math::Matrix< double, 3, 3 >& E,
+	const std::vector< Math::Vector< double, 2 > >& fromPoints, const std::vector< Math::Vector< double, 2 > >& toPoints,
+	const Math::Matrix< double, 3, 3 >& K1, const Math::Matrix< double, 3, 3 >& K2, std::size_t* pInFront )
+{
+	if( fromPoints.size() != toPoints.size() )
+		UBITRACK_THROW ( "Input sizes do not match" );
+
+	Math::Matrix< double, 3, 3 > A = E;
+	Math::Vector< double, 3 > s;
+	Math::Matrix< double, 3, 3 > U;
+	Math::Matrix< double, 3, 3 > Vt;
+	if ( lapack::gesvd( 'A', 'A', A, s, U, Vt ) != 0 )
+		UBITRACK_THROW ( "SVD of the essential matrix failed" );
+
+	// E is defined up to sign, so both factors can be made proper rotations
+	if ( Math::determinant( U ) < 0 )
+		U *= -1.0;
+	if ( Math::determinant( Vt ) < 0 )
+		Vt *= -1.0;
+
+	Math::Matrix< double, 3, 3 > W = Math::Matrix< double, 3, 3 >::zeros();
+	W( 0, 1 ) = -1.0;
+	W( 1, 0 ) = 1.0;
+	W( 2, 2 ) = 1.0;
+
+	Math::Matrix< double, 3, 3 > rotations[ 2 ];
+	rotations[ 0 ] = ublas::prod( U, Math::Matrix< double, 3, 3 >( ublas::prod( W, Vt ) ) );
+	rotations[ 1 ] = ublas::prod( U, Math::Matrix< double, 3, 3 >( ublas::prod( ublas::trans( W ), Vt ) ) );
+	const Math::Vector< double, 3 > u3 = ublas::column( U, 2 );
+
+	Math::Matrix< double, 3, 4 > p1;
+	ublas::subrange( p1, 0, 3, 0, 3 ) = Math::Matrix< double, 3, 3 >::identity();
+	ublas::column( p1, 3 ) = Math::Vector< double, 3 >( 0.0, 0.0, 0.0 );
+	const Math::Matrix< double, 3, 4 > P1 = ublas::prod( K1, p1 );
+	const double sign1 = K1( 2, 2 ) < 0 ? -1.0 : 1.0;
+	const double sign2 = K2( 2, 2 ) < 0 ? -1.0 : 1.0;
+
+	// the candidate that puts the most points in front of both cameras
+	std::size_t bestInFront = 0;
+	Math::Pose best( Math::Quaternion( rotations[ 0 ] ), u3 );
+	for ( std::size_t k = 0; k < 4; k++ )
+	{
+		const Math::Matrix< double, 3, 3 >& R = rotations[ k / 2 ];
+		const Math::Vector< double, 3 > t = k % 2 ? Math::Vector< double, 3 >( -u3 ) : u3;
+
+		Math::Matrix< double, 3, 4 > p2;
+		ublas::subrange( p2, 0, 3, 0, 3 ) = R;
+		ublas::column( p2, 3 ) = t;
+		const Math::Matrix< double, 3, 4 > P2 = ublas::prod( K2, p2 );
+
+		std::size_t inFront = 0;
+		for ( std::size_t i = 0; i < fromPoints.size(); i++ )
+		{
+			const Math::Vector< double, 3 > X = get3DPosition( P1, P2, fromPoints[ i ], toPoints[ i ] );
+			const Math::Vector< double, 3 > X2 = ublas::prod( R, X ) + t;
+			if ( X( 2 ) * sign1 > 0 && X2( 2 ) * sign2 > 0 )
+				inFront++;
+		}
+
+		if ( inFront > bestInFront )
+		{
+			bestInFront = inFront;
+			best = Math::Pose( Math::Quaternion( R ), t );
+		}
+	}
+
+	if ( pInFront )
+		*pInFront = bestInFront;
+	return best;
+}
+
 } } // namespace Ubitrack::Algorithm
 
 #endif // HAVE_LAPACK
@@ -36,6 +36,10 @@
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
 
+#include <vector>
+#include <cmath>
+#include <limits>
+
 #ifdef HAVE_LAPACK
 
 namespace Ubitrack { namespace Algorithm {
@@ -60,6 +64,114 @@ UBITRACK_EXPORT Math::Matrix< float, 3, 3 > getFundamentalMatrix( const std::vec
 UBITRACK_EXPORT Math::Matrix< double, 3, 3 > getFundamentalMatrix( const std::vector< Math::Vector< double, 2 > >& fromPoints, 
 	const std::vector< Math::Vector< double, 2 > >& toPoints, std::size_t stepSize = 1 );
 
+/**
+ * @ingroup tracking_algorithms
+ * Computes all fundamental matrices that are consistent with seven correspondences, the minimal
+ * sample of a robust estimation.
+ *
+ * The seven epipolar constraints of the normalized points leave a two-dimensional null space
+ * a F1 + ( 1 - a ) F2, which is found by gaussian elimination. The rank constraint
+ * det( a F1 + ( 1 - a ) F2 ) = 0 is a cubic polynomial in a with one or three real roots, each
+ * gives a solution. The results are normalized to a unit frobenius norm.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param fromPoints points x as inhomogeneous 2-vectors, only the first seven are used
+ * @param toPoints points x' as inhomogeneous 2-vectors
+ * @param solutions the solutions F with x'^T F x = 0 are appended
+ * @return the number of appended solutions, 0 for degenerate configurations
+ */
+UBITRACK_EXPORT std::size_t fundamentalMatrix7Point( const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< Math::Matrix< float, 3, 3 > >& solutions );
+
+UBITRACK_EXPORT std::size_t fundamentalMatrix7Point( const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< Math::Matrix< double, 3, 3 > >& solutions );
+
+/**
+ * @ingroup tracking_algorithms
+ * Converts a pixel to normalized image coordinates, the coordinates of the essential matrix
+ * functions: the ray <tt>K^-1 ( u, v, 1 )</tt> divided by its third component. The result does not
+ * depend on whether the camera looks along the positive or, as usual in Ubitrack, the negative z axis.
+ *
+ * @param K upper triangular intrinsic matrix
+ * @param p the pixel
+ */
+template< typename T >
+inline Math::Vector< T, 2 > normalizedImagePoint( const Math::Matrix< T, 3, 3 >& K, const Math::Vector< T, 2 >& p )
+{
+	const T r2 = 1 / K( 2, 2 );
+	const T r1 = ( p( 1 ) - K( 1, 2 ) * r2 ) / K( 1, 1 );
+	const T r0 = ( p( 0 ) - K( 0, 1 ) * r1 - K( 0, 2 ) * r2 ) / K( 0, 0 );
+	return Math::Vector< T, 2 >( r0 / r2, r1 / r2 );
+}
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes all essential matrices that are consistent with five correspondences of calibrated
+ * cameras, the minimal sample of a robust relative pose estimation (Nister's five-point algorithm
+ * in the formulation of Stewenius et al.).
+ *
+ * The five epipolar constraints leave a four-dimensional null space E = x X + y Y + z Z + W. The
+ * rank constraint det( E ) = 0 and the trace constraint 2 E E^T E - tr( E E^T ) E = 0 are ten cubic
+ * equations in x, y and z. Gauss-Jordan elimination of their 10x20 coefficient matrix and the hidden
+ * variable z give a polynomial of degree ten, each of its up to ten real roots gives a solution.
+ * The results are normalized to a unit frobenius norm.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param fromPoints points x of the first camera in normalized image coordinates, see
+ *   \c normalizedImagePoint, only the first five are used
+ * @param toPoints points x' of the second camera in normalized image coordinates
+ * @param solutions the solutions E with x'^T E x = 0 are appended
+ * @return the number of appended solutions, 0 for degenerate configurations
+ */
+UBITRACK_EXPORT std::size_t essentialMatrix5Point( const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< Math::Matrix< float, 3, 3 > >& solutions );
+
+UBITRACK_EXPORT std::size_t essentialMatrix5Point( const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< Math::Matrix< double, 3, 3 > >& solutions );
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes an essential matrix from eight or more correspondences of calibrated cameras: the
+ * fundamental matrix of \c getFundamentalMatrix with equal non-zero singular values, refined by
+ * levenberg-marquardt on the Sampson distances.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param fromPoints points x in normalized image coordinates, see \c normalizedImagePoint
+ * @param toPoints points x' in normalized image coordinates
+ * @return the essential matrix with x'^T E x = 0 and unit frobenius norm
+ */
+UBITRACK_EXPORT Math::Matrix< float, 3, 3 > getEssentialMatrix( const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints );
+
+UBITRACK_EXPORT Math::Matrix< double, 3, 3 > getEssentialMatrix( const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints );
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the pose of a second camera relative to the first camera from an essential matrix.
+ *
+ * Of the four rotations and translations that give the essential matrix, the one is chosen that
+ * puts the most correspondences in front of both cameras, with the points triangulated by
+ * \c get3DPosition. Unlike \c poseFromFundamentalMatrix, which decides by one correspondence,
+ * this tolerates outliers and points close to the baseline.
+ *
+ * @param E the essential matrix with x'^T E x = 0 in normalized image coordinates
+ * @param fromPoints pixels of the first camera
+ * @param toPoints pixels of the second camera
+ * @param K1 intrinsic matrix of the first camera, points are in front if their z coordinate has
+ *   the sign of <tt>K1( 2, 2 )</tt>
+ * @param K2 intrinsic matrix of the second camera
+ * @param pInFront if given, receives the number of correspondences in front of both cameras
+ * @return the pose that maps points from the first into the second camera, with a translation of
+ *   unit length
+ */
+UBITRACK_EXPORT Math::Pose poseFromEssentialMatrix( const Math::Matrix< double, 3, 3 >& E,
+	const std::vector< Math::Vector< double, 2 > >& fromPoints, const std::vector< Math::Vector< double, 2 > >& toPoints,
+	const Math::Matrix< double, 3, 3 >& K1, const Math::Matrix< double, 3, 3 >& K2, std::size_t* pInFront = 0 );
+
 /**
  * @ingroup tracking_algorithms
  * Computes a fundamental matrix from two camera poses
@@ -123,6 +235,63 @@ public:
 	}
 };
 	
+/**
+ * @internal Sampson distance of the correspondence ( x, y ) -> ( u, v ) for the fundamental
+ * matrix with the row-major entries \c f, see \c fundamentalSampsonDistance.
+ */
+template< typename T >
+inline T fundamentalSampsonDistance( const T* f, const T x, const T y, const T u, const T v )
+{
+	// epipolar lines F x and F^T x'
+	const T l0 = f[ 0 ] * x + f[ 1 ] * y + f[ 2 ];
+	const T l1 = f[ 3 ] * x + f[ 4 ] * y + f[ 5 ];
+	const T l2 = f[ 6 ] * x + f[ 7 ] * y + f[ 8 ];
+	const T m0 = f[ 0 ] * u + f[ 3 ] * v + f[ 6 ];
+	const T m1 = f[ 1 ] * u + f[ 4 ] * v + f[ 7 ];
+
+	const T term = u * l0 + v * l1 + l2;
+	const T norm = l0 * l0 + l1 * l1 + m0 * m0 + m1 * m1;
+	if ( !( norm > 0 ) )
+		return std::numeric_limits< T >::max();
+	return std::fabs( term ) / std::sqrt( norm );
+}
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the Sampson distance of a correspondence for a fundamental matrix, the first order
+ * approximation of the geometric distance of ( x, x' ) to the closest pair of points that
+ * satisfies the epipolar constraint, in pixels. Unlike \c EvaluateFundamentalMatrix it accounts
+ * for the errors in both images.
+ *
+ * @param F fundamental matrix with x'^T F x = 0
+ * @param from point x
+ * @param to point x'
+ */
+template< typename T >
+inline T fundamentalSampsonDistance( const Math::Matrix< T, 3, 3 >& F, const Math::Vector< T, 2 >& from, const Math::Vector< T, 2 >& to )
+{
+	const T f[ 9 ] = { F( 0, 0 ), F( 0, 1 ), F( 0, 2 ), F( 1, 0 ), F( 1, 1 ), F( 1, 2 ), F( 2, 0 ), F( 2, 1 ), F( 2, 2 ) };
+	return fundamentalSampsonDistance( f, from( 0 ), from( 1 ), to( 0 ), to( 1 ) );
+}
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the Sampson distances of all correspondences for a fundamental matrix in one pass,
+ * e.g. to score a hypothesis or to select the inlier of a robust estimate.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param F fundamental matrix with x'^T F x = 0
+ * @param fromPoints points x
+ * @param toPoints points x'
+ * @param distances resized to the number of points, receives the distances
+ */
+UBITRACK_EXPORT void fundamentalSampsonDistances( const Math::Matrix< float, 3, 3 >& F, const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< float >& distances );
+
+UBITRACK_EXPORT void fundamentalSampsonDistances( const Math::Matrix< double, 3, 3 >& F, const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< double >& distances );
+	
 } } // namespace Ubitrack::Algorithm
 
 #endif // HAVE_LAPACK
@@ -0,0 +1,288 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Functions for ransac fundamental matrix estimation.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_FUNDAMENTAL_MATRIX_RANSAC_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_FUNDAMENTAL_MATRIX_RANSAC_H_INCLUDED__
+
+#include "FundamentalMatrix.h"
+#include <utCore.h>
+#include <utMath/Optimization/Ransac.h>
+
+#ifdef HAVE_LAPACK
+
+namespace Ubitrack { namespace Algorithm {
+
+/**
+ * @internal function object that provides estimation and evaluation
+ * functions for a ransac fundamental matrix estimation.
+ */
+template< typename T >
+struct FundamentalMatrixRansac
+{
+public:
+
+	typedef T value_type;
+
+	/**
+	 * @internal computes a fundamental matrix: sets of up to eight points by
+	 * \c fundamentalMatrix7Point, where the points after the seventh select the solution,
+	 * larger sets, e.g. all inlier of the final solution, by \c getFundamentalMatrix.
+	 */
+	struct Estimator
+	{
+		public:
+
+		template< typename InputIterator1, typename InputIterator2, typename ResultType >
+		bool operator()( ResultType& F, const InputIterator1 iBegin1, const InputIterator1 iEnd1, const InputIterator2 iBegin2, const InputIterator2 iEnd2 ) const
+		{
+			const std::vector< Math::Vector< T, 2 > > fromPoints( iBegin1, iEnd1 );
+			const std::vector< Math::Vector< T, 2 > > toPoints( iBegin2, iEnd2 );
+			if ( fromPoints.size() > 8 )
+			{
+				F = getFundamentalMatrix( fromPoints, toPoints );
+				return true;
+			}
+			if ( fromPoints.size() < 7 )
+				return false;
+
+			std::vector< Math::Matrix< T, 3, 3 > > solutions;
+			const std::size_t nSolutions = fundamentalMatrix7Point( fromPoints, toPoints, solutions );
+
+			// without further points only a unique solution is accepted
+			if ( fromPoints.size() == 7 )
+			{
+				if ( nSolutions != 1 )
+					return false;
+				F = solutions[ 0 ];
+				return true;
+			}
+
+			T bestDistance = std::numeric_limits< T >::max();
+			for ( std::size_t i = 0; i < nSolutions; i++ )
+			{
+				const T d = fundamentalSampsonDistance( solutions[ i ], fromPoints[ 7 ], toPoints[ 7 ] );
+				if ( d < bestDistance )
+				{
+					bestDistance = d;
+					F = solutions[ i ];
+				}
+			}
+			return bestDistance < std::numeric_limits< T >::max();
+		}
+	};
+
+	/**
+	 * @internal computes the Sampson distance of a correspondence
+	 */
+	struct Evaluator
+	{
+		public:
+
+		template< typename MatrixType, typename VectorType1, typename VectorType2 >
+		T operator()( const MatrixType& F, const VectorType1& from, const VectorType2& to ) const
+		{
+			return fundamentalSampsonDistance< T >( F, from, to );
+		}
+	};
+};
+
+/**
+ * @ingroup tracking_algorithms
+ * Robust fundamental matrix estimation, hypotheses are computed by \c fundamentalMatrix7Point
+ * from seven correspondences, where an eighth one selects among the up to three solutions, and
+ * the inlier of the best one are refined by \c getFundamentalMatrix. Use a \c setSize of 8
+ * and a threshold on the Sampson distance in pixels.
+ * Note: Also exists with \c float parameters.
+ *
+ * @param fromPoints points x
+ * @param F the estimated fundamental matrix with x'^T F x = 0
+ * @param toPoints points x'
+ * @param params ransac parameters
+ * @return the number of inlier, 0 if not enough inlier were found
+ */
+template< typename T, typename InputIterator1, typename InputIterator2, typename ResultType >
+std::size_t estimateFundamentalRansac( const InputIterator1 itBegin1, const InputIterator1 itEnd1
+		, ResultType& F
+		, const InputIterator2 itBegin2, const InputIterator2 itEnd2
+		, const Math::Optimization::RansacParameter< T >& params )
+{
+	return Math::Optimization::ransac( itBegin1, itEnd1, itBegin2, itEnd2, F, FundamentalMatrixRansac< T >(), params );
+}
+
+/**
+ * @ingroup tracking_algorithms
+ * Robust fundamental matrix estimation of two point lists, see above.
+ * Note: Also exists with \c float parameters.
+ *
+ * @param pInliers if given, receives for every correspondence if its Sampson distance to the
+ *   result is below the threshold
+ */
+UBITRACK_EXPORT std::size_t estimateFundamentalRansac( const std::vector< Math::Vector< float, 2 > >& fromPoints
+	, Math::Matrix< float, 3, 3 >& F
+	, const std::vector< Math::Vector< float, 2 > >& toPoints
+	, const Math::Optimization::RansacParameter< float >& params
+	, std::vector< bool >* pInliers = 0 );
+
+UBITRACK_EXPORT std::size_t estimateFundamentalRansac( const std::vector< Math::Vector< double, 2 > >& fromPoints
+	, Math::Matrix< double, 3, 3 >& F
+	, const std::vector< Math::Vector< double, 2 > >& toPoints
+	, const Math::Optimization::RansacParameter< double >& params
+	, std::vector< bool >* pInliers = 0 );
+
+/**
+ * @internal function object that provides estimation and evaluation
+ * functions for a ransac essential matrix estimation in normalized image coordinates.
+ */
+template< typename T >
+struct EssentialMatrixRansac
+{
+public:
+
+	typedef T value_type;
+
+	/**
+	 * @internal computes an essential matrix: sets of up to eight points by
+	 * \c essentialMatrix5Point, where the points after the fifth select the solution,
+	 * larger sets, e.g. all inlier of the final solution, by \c getEssentialMatrix.
+	 */
+	struct Estimator
+	{
+		public:
+
+		template< typename InputIterator1, typename InputIterator2, typename ResultType >
+		bool operator()( ResultType& E, const InputIterator1 iBegin1, const InputIterator1 iEnd1, const InputIterator2 iBegin2, const InputIterator2 iEnd2 ) const
+		{
+			const std::vector< Math::Vector< T, 2 > > fromPoints( iBegin1, iEnd1 );
+			const std::vector< Math::Vector< T, 2 > > toPoints( iBegin2, iEnd2 );
+			if ( fromPoints.size() > 8 )
+			{
+				E = getEssentialMatrix( fromPoints, toPoints );
+				return true;
+			}
+			if ( fromPoints.size() < 5 )
+				return false;
+
+			std::vector< Math::Matrix< T, 3, 3 > > solutions;
+			const std::size_t nSolutions = essentialMatrix5Point( fromPoints, toPoints, solutions );
+
+			// without further points only a unique solution is accepted
+			if ( fromPoints.size() == 5 )
+			{
+				if ( nSolutions != 1 )
+					return false;
+				E = solutions[ 0 ];
+				return true;
+			}
+
+			T bestDistance = std::numeric_limits< T >::max();
+			for ( std::size_t i = 0; i < nSolutions; i++ )
+			{
+				T d = 0;
+				for ( std::size_t j = 5; j < fromPoints.size(); j++ )
+					d += fundamentalSampsonDistance( solutions[ i ], fromPoints[ j ], toPoints[ j ] );
+				if ( d < bestDistance )
+				{
+					bestDistance = d;
+					E = solutions[ i ];
+				}
+			}
+			return bestDistance < std::numeric_limits< T >::max();
+		}
+	};
+
+	/**
+	 * @internal computes the Sampson distance of a correspondence
+	 */
+	typedef typename FundamentalMatrixRansac< T >::Evaluator Evaluator;
+};
+
+/**
+ * @ingroup tracking_algorithms
+ * Robust essential matrix estimation of calibrated cameras, hypotheses are computed by
+ * \c essentialMatrix5Point from five correspondences, where the following ones select among the
+ * up to ten solutions, and the inlier of the best one are refined by \c getEssentialMatrix.
+ * The points are in normalized image coordinates, see \c normalizedImagePoint, and so is the
+ * threshold on the Sampson distance.
+ * Note: Also exists with \c float parameters.
+ *
+ * @param fromPoints points x
+ * @param E the estimated essential matrix with x'^T E x = 0
+ * @param toPoints points x'
+ * @param params ransac parameters
+ * @return the number of inlier, 0 if not enough inlier were found
+ */
+template< typename T, typename InputIterator1, typename InputIterator2, typename ResultType >
+std::size_t estimateEssentialRansac( const InputIterator1 itBegin1, const InputIterator1 itEnd1
+		, ResultType& E
+		, const InputIterator2 itBegin2, const InputIterator2 itEnd2
+		, const Math::Optimization::RansacParameter< T >& params )
+{
+	return Math::Optimization::ransac( itBegin1, itEnd1, itBegin2, itEnd2, E, EssentialMatrixRansac< T >(), params );
+}
+
+/**
+ * @ingroup tracking_algorithms
+ * Robust essential matrix estimation of the pixels of two calibrated cameras, e.g. to bootstrap
+ * the extrinsic calibration of a stereo rig together with \c poseFromEssentialMatrix. The pixels
+ * are converted to normalized image coordinates and the threshold on the Sampson distance in pixels
+ * is divided by the mean focal length. A \c setSize of 6, a minimal set and one point to select
+ * the solution, needs the fewest iterations.
+ * Note: Also exists with \c float parameters.
+ *
+ * @param fromPixels pixels of the first camera
+ * @param E the estimated essential matrix in normalized image coordinates
+ * @param toPixels pixels of the second camera
+ * @param K1 intrinsic matrix of the first camera
+ * @param K2 intrinsic matrix of the second camera
+ * @param params ransac parameters
+ * @param pInliers if given, receives for every correspondence if its Sampson distance to the
+ *   result is below the threshold
+ * @return the number of inlier, 0 if not enough inlier were found
+ */
+UBITRACK_EXPORT std::size_t estimateEssentialRansac( const std::vector< Math::Vector< float, 2 > >& fromPixels
+	, Math::Matrix< float, 3, 3 >& E
+	, const std::vector< Math::Vector< float, 2 > >& toPixels
+	, const Math::Matrix< float, 3, 3 >& K1
+	, const Math::Matrix< float, 3, 3 >& K2
+	, const Math::Optimization::RansacParameter< float >& params
+	, std::vector< bool >* pInliers = 0 );
+
+UBITRACK_EXPORT std::size_t estimateEssentialRansac( const std::vector< Math::Vector< double, 2 > >& fromPixels
+	, Math::Matrix< double, 3, 3 >& E
+	, const std::vector< Math::Vector< double, 2 > >& toPixels
+	, const Math::Matrix< double, 3, 3 >& K1
+	, const Math::Matrix< double, 3, 3 >& K2
+	, const Math::Optimization::RansacParameter< double >& params
+	, std::vector< bool >* pInliers = 0 );
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // HAVE_LAPACK
+
+#endif // __UBITRACK_ALGORITHM_FUNDAMENTAL_MATRIX_RANSAC_H_INCLUDED__
@@ -30,10 +30,14 @@
  */ 
 
 #include "Homography.h"
+#include "HomographyRansac.h"
+#include "DirectLinearTransform.h"
 #include <utMath/Geometry/PointNormalization.h>
 
 #ifdef HAVE_LAPACK
 #include <boost/numeric/bindings/lapack/gesvd.hpp>
+#include <utUtil/Exception.h>
+#include <utUtil/TraceSpan.h>
 
 // shortcuts to namespaces
 namespace ublas = boost::numeric::ublas;
@@ -43,57 +47,72 @@ namespace Ubitrack { namespace Algorithm {
 
 /** \internal */
 template< typename T >
-Math::Matrix< T, 3, 3 > homographyDLTImpl( const std::vector< Math::Vector< T, 2 > >& fromPoints, 
-	const std::vector< Math::Vector< T, 2 > >& toPoints )
+void estimateNormalization( const std::vector< Math::Vector< T, 2 > >& points, Math::Vector< T, 2 >& shift, Math::Vector< T, 2 >& scale )
 {
+	Math::Geometry::estimateNormalizationParameters( points.begin(), points.end(), shift, scale );
+}
+
+/** \internal */
+template< typename T >
+void estimateNormalization( const Math::PointView< T, 2 >& points, Math::Vector< T, 2 >& shift, Math::Vector< T, 2 >& scale )
+{
+	Math::Geometry::estimateNormalizationParameters( points.begin(), points.end(), shift, scale );
+}
+
+/**
+ * \internal point clouds accumulate in the same order and precision as the vector version,
+ * so both give the same homography
+ */
+template< typename T >
+void estimateNormalization( const Math::PointCloud< T, 2 >& points, Math::Vector< T, 2 >& shift, Math::Vector< T, 2 >& scale )
+{
+	Math::Geometry::estimateNormalizationParameters( points.begin(), points.end(), shift, scale );
+}
+
+/** \internal works on \c std::vector and \c Math::PointCloud */
+template< typename Points >
+Math::Matrix< typename Points::value_type::value_type, 3, 3 > homographyDLTImpl( const Points& fromPoints, const Points& toPoints )
+{
+	typedef typename Points::value_type::value_type T;
 	const std::size_t n_points ( fromPoints.size() );
 	assert( n_points == toPoints.size() );
 	assert( n_points >= 4 );
+	UBITRACK_TRACE_SPAN( "homography_dlt", n_points );
 
 	// normalize input points
 	Math::Vector< T, 2 > fromShift;
 	Math::Vector< T, 2 > fromScale;
-	Math::Geometry::estimateNormalizationParameters( fromPoints.begin(), fromPoints.end(), fromShift, fromScale );
+	estimateNormalization( fromPoints, fromShift, fromScale );
 
 	Math::Vector< T, 2 > toShift;
 	Math::Vector< T, 2 > toScale;
-	Math::Geometry::estimateNormalizationParameters( toPoints.begin(), toPoints.end(), toShift, toScale );
+	estimateNormalization( toPoints, toShift, toScale );
 
-	// construct equation system
-	Math::Matrix< T, 0, 0 > A( 2 * n_points, 9 );
+	// accumulate the normal equations of the system
+	HomogeneousLinearSystem< 9 > system;
 	for ( std::size_t i ( 0 ); i < n_points; ++i )
 	{
-		const Math::Vector< T, 2 > to = ublas::element_div( toPoints[ i ] - toShift, toScale );
-		const Math::Vector< T, 2 > from = ublas::element_div( fromPoints[ i ] - fromShift, fromScale );
-
-		A( i * 2, 0 ) = A( i * 2, 1 ) = A( i * 2, 2 ) = 0.0f;
-		A( i * 2, 3 ) = -from( 0 ); 
-		A( i * 2, 4 ) = -from( 1 ); 
-		A( i * 2, 5 ) = -1.0f;
-		A( i * 2, 6 ) = to( 1 ) * from( 0 ); 
-		A( i * 2, 7 ) = to( 1 ) * from( 1 );
-		A( i * 2, 8 ) = to( 1 );
-		A( i * 2 + 1, 0 ) = from( 0 ); 
-		A( i * 2 + 1, 1 ) = from( 1 ); 
-		A( i * 2 + 1, 2 ) = 1.0f;
-		A( i * 2 + 1, 3 ) = A( i * 2 + 1, 4 ) = A( i * 2 + 1, 5 ) = 0.0f;
-		A( i * 2 + 1, 6 ) = -to( 0 ) * from( 0 ); 
-		A( i * 2 + 1, 7 ) = -to( 0 ) * from( 1 );
-		A( i * 2 + 1, 8 ) = -to( 0 );
+		const Math::Vector< T, 2 > from( fromPoints[ i ] );
+		const Math::Vector< T, 2 > to( toPoints[ i ] );
+		const double fx = ( from( 0 ) - fromShift( 0 ) ) / fromScale( 0 );
+		const double fy = ( from( 1 ) - fromShift( 1 ) ) / fromScale( 1 );
+		const double tx = ( to( 0 ) - toShift( 0 ) ) / toScale( 0 );
+		const double ty = ( to( 1 ) - toShift( 1 ) ) / toScale( 1 );
+
+		const double row1[ 9 ] = { 0, 0, 0, -fx, -fy, -1, ty * fx, ty * fy, ty };
+		const double row2[ 9 ] = { fx, fy, 1, 0, 0, 0, -tx * fx, -tx * fy, -tx };
+		system.addRow( row1 );
+		system.addRow( row2 );
 	}
 
-	// solve using SVD
-	const std::size_t nSingularValues ( std::min( A.size1(), A.size2() ) );
-	Math::Vector< T > s( nSingularValues );
-	Math::Matrix< T, 9, 9 > Vt;
-	Math::Matrix< T, 0, 0 > U( 2 * n_points, 2 * n_points );
-	lapack::gesvd( 'N', 'A', A, s, U, Vt );
+	Math::Vector< T, 9 > h;
+	system.solve( h );
 
 	// copy result to 3x3 matrix
 	Math::Matrix< T, 3, 3 > H;
-	H( 0, 0 ) = Vt( 8, 0 ); H( 0, 1 ) = Vt( 8, 1 ); H( 0, 2 ) = Vt( 8, 2 );
-	H( 1, 0 ) = Vt( 8, 3 ); H( 1, 1 ) = Vt( 8, 4 ); H( 1, 2 ) = Vt( 8, 5 );
-	H( 2, 0 ) = Vt( 8, 6 ); H( 2, 1 ) = Vt( 8, 7 ); H( 2, 2 ) = Vt( 8, 8 );
+	H( 0, 0 ) = h( 0 ); H( 0, 1 ) = h( 1 ); H( 0, 2 ) = h( 2 );
+	H( 1, 0 ) = h( 3 ); H( 1, 1 ) = h( 4 ); H( 1, 2 ) = h( 5 );
+	H( 2, 0 ) = h( 6 ); H( 2, 1 ) = h( 7 ); H( 2, 2 ) = h( 8 );
 	
 	// reverse normalization
 	const Math::Matrix< T, 3, 3 > toCorrect( Math::Geometry::generateNormalizationMatrix( toShift, toScale, true ) );
@@ -117,6 +136,194 @@ Math::Matrix< double, 3, 3 > homographyDLT( const std::vector< Math::Vector< dou
 	return homographyDLTImpl( fromPoints, toPoints );
 }
 
+Math::Matrix< float, 3, 3 > homographyDLT( const Math::PointCloud2f& fromPoints, const Math::PointCloud2f& toPoints )
+{
+	return homographyDLTImpl( fromPoints, toPoints );
+}
+
+Math::Matrix< double, 3, 3 > homographyDLT( const Math::PointCloud2d& fromPoints, const Math::PointCloud2d& toPoints )
+{
+	return homographyDLTImpl( fromPoints, toPoints );
+}
+
+Math::Matrix< float, 3, 3 > homographyDLT( const Math::PointView2f& fromPoints, const Math::PointView2f& toPoints )
+{
+	return homographyDLTImpl( fromPoints, toPoints );
+}
+
+Math::Matrix< double, 3, 3 > homographyDLT( const Math::PointView2d& fromPoints, const Math::PointView2d& toPoints )
+{
+	return homographyDLTImpl( fromPoints, toPoints );
+}
+
+
+/** \internal doubled signed area of the triangle with the points i, j, k */
+inline double triangleArea( const double* x, const double* y, const std::size_t i, const std::size_t j, const std::size_t k )
+{
+	return ( x[ j ] - x[ i ] ) * ( y[ k ] - y[ i ] ) - ( y[ j ] - y[ i ] ) * ( x[ k ] - x[ i ] );
+}
+
+/**
+ * \internal computes the matrix that maps the projective basis e1, e2, e3, ( 1, 1, 1 ) onto the
+ * four points, its columns are the first three points scaled by the solution of
+ * [ p1 p2 p3 ] l = p4. The determinants of the cramer solution are the doubled areas of the
+ * triangles of the points.
+ * @return false if three of the points are (nearly) collinear
+ */
+template< typename T >
+bool projectiveBasis( const std::vector< Math::Vector< T, 2 > >& points, double b[ 3 ][ 3 ] )
+{
+	double x[ 4 ];
+	double y[ 4 ];
+	double meanX = 0;
+	double meanY = 0;
+	for ( std::size_t i ( 0 ); i < 4; ++i )
+	{
+		x[ i ] = points[ i ]( 0 );
+		y[ i ] = points[ i ]( 1 );
+		meanX += x[ i ] / 4;
+		meanY += y[ i ] / 4;
+	}
+
+	double spread = 0;
+	for ( std::size_t i ( 0 ); i < 4; ++i )
+		spread += ( x[ i ] - meanX ) * ( x[ i ] - meanX ) + ( y[ i ] - meanY ) * ( y[ i ] - meanY );
+
+	const double area[ 4 ] = { triangleArea( x, y, 0, 1, 2 ), triangleArea( x, y, 3, 1, 2 ),
+		triangleArea( x, y, 0, 3, 2 ), triangleArea( x, y, 0, 1, 3 ) };
+
+	for ( std::size_t i ( 0 ); i < 4; ++i )
+		if ( !( std::fabs( area[ i ] ) > 1e-8 * spread ) )
+			return false;
+
+	for ( std::size_t j ( 0 ); j < 3; ++j )
+	{
+		const double l = area[ j + 1 ] / area[ 0 ];
+		b[ 0 ][ j ] = l * x[ j ];
+		b[ 1 ][ j ] = l * y[ j ];
+		b[ 2 ][ j ] = l;
+	}
+	return true;
+}
+
+/** \internal */
+template< typename T >
+bool homography4PointImpl( const std::vector< Math::Vector< T, 2 > >& fromPoints,
+	const std::vector< Math::Vector< T, 2 > >& toPoints, Math::Matrix< T, 3, 3 >& H )
+{
+	assert( fromPoints.size() >= 4 && toPoints.size() >= 4 );
+
+	double from[ 3 ][ 3 ];
+	double to[ 3 ][ 3 ];
+	if ( !projectiveBasis( fromPoints, from ) || !projectiveBasis( toPoints, to ) )
+		return false;
+
+	// the adjugate is the inverse up to scale
+	double adj[ 3 ][ 3 ];
+	for ( std::size_t i ( 0 ); i < 3; ++i )
+	{
+		const std::size_t i1 = ( i + 1 ) % 3;
+		const std::size_t i2 = ( i + 2 ) % 3;
+		for ( std::size_t j ( 0 ); j < 3; ++j )
+		{
+			const std::size_t j1 = ( j + 1 ) % 3;
+			const std::size_t j2 = ( j + 2 ) % 3;
+			adj[ j ][ i ] = from[ i1 ][ j1 ] * from[ i2 ][ j2 ] - from[ i1 ][ j2 ] * from[ i2 ][ j1 ];
+		}
+	}
+
+	double h[ 3 ][ 3 ];
+	double norm = 0;
+	for ( std::size_t i ( 0 ); i < 3; ++i )
+		for ( std::size_t j ( 0 ); j < 3; ++j )
+		{
+			h[ i ][ j ] = to[ i ][ 0 ] * adj[ 0 ][ j ] + to[ i ][ 1 ] * adj[ 1 ][ j ] + to[ i ][ 2 ] * adj[ 2 ][ j ];
+			norm += h[ i ][ j ] * h[ i ][ j ];
+		}
+
+	norm = 1 / std::sqrt( norm );
+	for ( std::size_t i ( 0 ); i < 3; ++i )
+		for ( std::size_t j ( 0 ); j < 3; ++j )
+			H( i, j ) = static_cast< T >( h[ i ][ j ] * norm );
+	return true;
+}
+
+
+bool homography4Point( const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, Math::Matrix< float, 3, 3 >& H )
+{
+	return homography4PointImpl( fromPoints, toPoints, H );
+}
+
+bool homography4Point( const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, Math::Matrix< double, 3, 3 >& H )
+{
+	return homography4PointImpl( fromPoints, toPoints, H );
+}
+
+
+/** \internal */
+template< typename T >
+void homographySampsonDistancesImpl( const Math::Matrix< T, 3, 3 >& H, const std::vector< Math::Vector< T, 2 > >& fromPoints,
+	const std::vector< Math::Vector< T, 2 > >& toPoints, std::vector< T >& distances )
+{
+	assert( fromPoints.size() == toPoints.size() );
+	const std::size_t n_points ( fromPoints.size() );
+	distances.resize( n_points );
+
+	const T h[ 9 ] = { H( 0, 0 ), H( 0, 1 ), H( 0, 2 ), H( 1, 0 ), H( 1, 1 ), H( 1, 2 ), H( 2, 0 ), H( 2, 1 ), H( 2, 2 ) };
+	for ( std::size_t i ( 0 ); i < n_points; ++i )
+		distances[ i ] = homographySampsonDistance( h, fromPoints[ i ]( 0 ), fromPoints[ i ]( 1 ), toPoints[ i ]( 0 ), toPoints[ i ]( 1 ) );
+}
+
+void homographySampsonDistances( const Math::Matrix< float, 3, 3 >& H, const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< float >& distances )
+{
+	homographySampsonDistancesImpl( H, fromPoints, toPoints, distances );
+}
+
+void homographySampsonDistances( const Math::Matrix< double, 3, 3 >& H, const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< double >& distances )
+{
+	homographySampsonDistancesImpl( H, fromPoints, toPoints, distances );
+}
+
+
+/** \internal */
+template< typename T >
+std::size_t estimateHomographyRansacImpl( const std::vector< Math::Vector< T, 2 > >& fromPoints, Math::Matrix< T, 3, 3 >& H,
+	const std::vector< Math::Vector< T, 2 > >& toPoints, const Math::Optimization::RansacParameter< T >& params, std::vector< bool >* pInliers )
+{
+	if ( fromPoints.size() != toPoints.size() )
+		UBITRACK_THROW( "Robust homography estimation requires the same number of points in both lists" );
+
+	const std::size_t nInlier = estimateHomographyRansac( fromPoints.begin(), fromPoints.end(), H, toPoints.begin(), toPoints.end(), params );
+	if ( pInliers )
+	{
+		pInliers->assign( fromPoints.size(), false );
+		if ( nInlier )
+		{
+			std::vector< T > distances;
+			homographySampsonDistancesImpl( H, fromPoints, toPoints, distances );
+			for ( std::size_t i ( 0 ); i < distances.size(); ++i )
+				( *pInliers )[ i ] = distances[ i ] < params.threshold;
+		}
+	}
+	return nInlier;
+}
+
+std::size_t estimateHomographyRansac( const std::vector< Math::Vector< float, 2 > >& fromPoints, Math::Matrix< float, 3, 3 >& H,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, const Math::Optimization::RansacParameter< float >& params, std::vector< bool >* pInliers )
+{
+	return estimateHomographyRansacImpl( fromPoints, H, toPoints, params, pInliers );
+}
+
+std::size_t estimateHomographyRansac( const std::vector< Math::Vector< double, 2 > >& fromPoints, Math::Matrix< double, 3, 3 >& H,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, const Math::Optimization::RansacParameter< double >& params, std::vector< bool >* pInliers )
+{
+	return estimateHomographyRansacImpl( fromPoints, H, toPoints, params, pInliers );
+}
+
 
 /** \internal */
 template< typename T >
@@ -39,7 +39,11 @@
 #include <utCore.h>
 #include <utMath/Matrix.h>
 #include <utMath/Vector.h>
+#include <utMath/PointCloud.h>
+#include <utMath/PointView.h>
 #include <vector>
+#include <cmath>
+#include <limits>
 
 namespace Ubitrack { namespace Algorithm {
 
@@ -62,6 +66,24 @@ UBITRACK_EXPORT Math::Matrix< float, 3, 3 > homographyDLT( const std::vector< Ma
 
 UBITRACK_EXPORT Math::Matrix< double, 3, 3 > homographyDLT( const std::vector< Math::Vector< double, 2 > >& fromPoints, 
 	const std::vector< Math::Vector< double, 2 > >& toPoints );
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes a general homography using a linear DLT method, for points stored in a \c Math::PointCloud.
+ * The normalization of the points runs on the coordinate arrays with SIMD instructions.
+ */
+UBITRACK_EXPORT Math::Matrix< float, 3, 3 > homographyDLT( const Math::PointCloud2f& fromPoints, const Math::PointCloud2f& toPoints );
+
+UBITRACK_EXPORT Math::Matrix< double, 3, 3 > homographyDLT( const Math::PointCloud2d& fromPoints, const Math::PointCloud2d& toPoints );
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes a general homography using a linear DLT method, for points in strided buffers
+ * (e.g. \c cv::Point2f arrays), which are read in place. See \c Math::PointView.
+ */
+UBITRACK_EXPORT Math::Matrix< float, 3, 3 > homographyDLT( const Math::PointView2f& fromPoints, const Math::PointView2f& toPoints );
+
+UBITRACK_EXPORT Math::Matrix< double, 3, 3 > homographyDLT( const Math::PointView2d& fromPoints, const Math::PointView2d& toPoints );
 	
 
 /**
@@ -81,6 +103,92 @@ UBITRACK_EXPORT Math::Matrix< float, 3, 3 > squareHomography( const std::vector<
 
 UBITRACK_EXPORT Math::Matrix< double, 3, 3 > squareHomography( const std::vector< Math::Vector< double, 2 > >& corners );
 
+/**
+ * @ingroup tracking_algorithms
+ * Computes the homography that maps four points exactly onto four other points, the minimal
+ * sample of a robust estimation.
+ *
+ * Both point sets are mapped onto the projective basis by a closed-form 3x3 solution, so no
+ * decomposition is needed. The result is normalized to a unit frobenius norm.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param fromPoints four points x as inhomogeneous 2-vectors, only the first four are used
+ * @param toPoints four points x' as inhomogeneous 2-vectors
+ * @param H the homography with x' = H x
+ * @return false if three of the points in one of the sets are (nearly) collinear
+ */
+UBITRACK_EXPORT bool homography4Point( const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, Math::Matrix< float, 3, 3 >& H );
+
+UBITRACK_EXPORT bool homography4Point( const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, Math::Matrix< double, 3, 3 >& H );
+
+/**
+ * @internal Sampson distance of the correspondence ( x, y ) -> ( u, v ) for the homography with
+ * the row-major entries \c h, see \c homographySampsonDistance.
+ */
+template< typename T >
+inline T homographySampsonDistance( const T* h, const T x, const T y, const T u, const T v )
+{
+	const T a = h[ 0 ] * x + h[ 1 ] * y + h[ 2 ];
+	const T b = h[ 3 ] * x + h[ 4 ] * y + h[ 5 ];
+	const T c = h[ 6 ] * x + h[ 7 ] * y + h[ 8 ];
+
+	// the two DLT equations and their derivatives by x, y, u, v
+	const T e1 = v * c - b;
+	const T e2 = a - u * c;
+	const T j1x = v * h[ 6 ] - h[ 3 ];
+	const T j1y = v * h[ 7 ] - h[ 4 ];
+	const T j2x = h[ 0 ] - u * h[ 6 ];
+	const T j2y = h[ 1 ] - u * h[ 7 ];
+
+	const T s11 = j1x * j1x + j1y * j1y + c * c;
+	const T s22 = j2x * j2x + j2y * j2y + c * c;
+	const T s12 = j1x * j2x + j1y * j2y;
+	const T det = s11 * s22 - s12 * s12;
+	if ( !( det > 0 ) )
+		return std::numeric_limits< T >::max();
+	return std::sqrt( ( s22 * e1 * e1 - 2 * s12 * e1 * e2 + s11 * e2 * e2 ) / det );
+}
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the Sampson distance of a correspondence for a homography, the first order
+ * approximation of the geometric distance of ( x, x' ) to the closest pair of points that is
+ * mapped exactly, in pixels.
+ *
+ * @param H homography with x' = H x
+ * @param from point x
+ * @param to point x'
+ * @return the distance, or the largest value of \c T if x is mapped to infinity
+ */
+template< typename T >
+inline T homographySampsonDistance( const Math::Matrix< T, 3, 3 >& H, const Math::Vector< T, 2 >& from, const Math::Vector< T, 2 >& to )
+{
+	const T h[ 9 ] = { H( 0, 0 ), H( 0, 1 ), H( 0, 2 ), H( 1, 0 ), H( 1, 1 ), H( 1, 2 ), H( 2, 0 ), H( 2, 1 ), H( 2, 2 ) };
+	return homographySampsonDistance( h, from( 0 ), from( 1 ), to( 0 ), to( 1 ) );
+}
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the Sampson distances of all correspondences for a homography in one pass, e.g. to
+ * score a hypothesis or to select the inlier of a robust estimate. The entries of the homography
+ * are read only once.
+ *
+ * Note: also exists with \c double parameters.
+ *
+ * @param H homography with x' = H x
+ * @param fromPoints points x
+ * @param toPoints points x'
+ * @param distances resized to the number of points, receives the distances
+ */
+UBITRACK_EXPORT void homographySampsonDistances( const Math::Matrix< float, 3, 3 >& H, const std::vector< Math::Vector< float, 2 > >& fromPoints,
+	const std::vector< Math::Vector< float, 2 > >& toPoints, std::vector< float >& distances );
+
+UBITRACK_EXPORT void homographySampsonDistances( const Math::Matrix< double, 3, 3 >& H, const std::vector< Math::Vector< double, 2 > >& fromPoints,
+	const std::vector< Math::Vector< double, 2 > >& toPoints, std::vector< double >& distances );
+
 } } // namespace Ubitrack::Algorithm
 
 #endif // HAVE_LAPACK
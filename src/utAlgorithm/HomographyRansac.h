@@ -0,0 +1,135 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Functions for ransac homography estimation.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_HOMOGRAPHY_RANSAC_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_HOMOGRAPHY_RANSAC_H_INCLUDED__
+
+#include "Homography.h"
+#include <utCore.h>
+#include <utMath/Optimization/Ransac.h>
+
+#ifdef HAVE_LAPACK
+
+namespace Ubitrack { namespace Algorithm {
+
+/**
+ * @internal function object that provides estimation and evaluation
+ * functions for a ransac homography estimation.
+ */
+template< typename T >
+struct HomographyRansac
+{
+public:
+
+	typedef T value_type;
+
+	/**
+	 * @internal computes a homography: minimal sets of four points by \c homography4Point,
+	 * larger sets, e.g. all inlier of the final solution, by \c homographyDLT.
+	 */
+	struct Estimator
+	{
+		public:
+
+		template< typename InputIterator1, typename InputIterator2, typename ResultType >
+		bool operator()( ResultType& H, const InputIterator1 iBegin1, const InputIterator1 iEnd1, const InputIterator2 iBegin2, const InputIterator2 iEnd2 ) const
+		{
+			const std::vector< Math::Vector< T, 2 > > fromPoints( iBegin1, iEnd1 );
+			const std::vector< Math::Vector< T, 2 > > toPoints( iBegin2, iEnd2 );
+			if ( fromPoints.size() < 4 )
+				return false;
+			if ( fromPoints.size() == 4 )
+				return homography4Point( fromPoints, toPoints, H );
+			H = homographyDLT( fromPoints, toPoints );
+			return true;
+		}
+	};
+
+	/**
+	 * @internal computes the Sampson distance of a correspondence
+	 */
+	struct Evaluator
+	{
+		public:
+
+		template< typename MatrixType, typename VectorType1, typename VectorType2 >
+		T operator()( const MatrixType& H, const VectorType1& from, const VectorType2& to ) const
+		{
+			return homographySampsonDistance< T >( H, from, to );
+		}
+	};
+};
+
+/**
+ * @ingroup tracking_algorithms
+ * Robust homography estimation, hypotheses of four correspondences are computed by
+ * \c homography4Point and the inlier of the best one are refined by \c homographyDLT.
+ * Use a \c setSize of 4 and a threshold on the Sampson distance in pixels.
+ * Note: Also exists with \c float parameters.
+ *
+ * @param fromPoints points x
+ * @param H the estimated homography with x' = H x
+ * @param toPoints points x'
+ * @param params ransac parameters
+ * @return the number of inlier, 0 if not enough inlier were found
+ */
+template< typename T, typename InputIterator1, typename InputIterator2, typename ResultType >
+std::size_t estimateHomographyRansac( const InputIterator1 itBegin1, const InputIterator1 itEnd1
+		, ResultType& H
+		, const InputIterator2 itBegin2, const InputIterator2 itEnd2
+		, const Math::Optimization::RansacParameter< T >& params )
+{
+	return Math::Optimization::ransac( itBegin1, itEnd1, itBegin2, itEnd2, H, HomographyRansac< T >(), params );
+}
+
+/**
+ * @ingroup tracking_algorithms
+ * Robust homography estimation of two point lists, see above.
+ * Note: Also exists with \c float parameters.
+ *
+ * @param pInliers if given, receives for every correspondence if its Sampson distance to the
+ *   result is below the threshold
+ */
+UBITRACK_EXPORT std::size_t estimateHomographyRansac( const std::vector< Math::Vector< float, 2 > >& fromPoints
+	, Math::Matrix< float, 3, 3 >& H
+	, const std::vector< Math::Vector< float, 2 > >& toPoints
+	, const Math::Optimization::RansacParameter< float >& params
+	, std::vector< bool >* pInliers = 0 );
+
+UBITRACK_EXPORT std::size_t estimateHomographyRansac( const std::vector< Math::Vector< double, 2 > >& fromPoints
+	, Math::Matrix< double, 3, 3 >& H
+	, const std::vector< Math::Vector< double, 2 > >& toPoints
+	, const Math::Optimization::RansacParameter< double >& params
+	, std::vector< bool >* pInliers = 0 );
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // HAVE_LAPACK
+
+#endif // __UBITRACK_ALGORITHM_HOMOGRAPHY_RANSAC_H_INCLUDED__
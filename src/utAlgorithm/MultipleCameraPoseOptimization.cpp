@@ -39,8 +39,8 @@
 //#define OPTIMIZATION_LOGGING
 
 // get a logger
-#include <log4cpp/Category.hh>
-static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Calibration.2D6DPoseEstimation" ) );
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Calibration.2D6DPoseEstimation" );
 //static log4cpp::Category& optLogger( log4cpp::Category::getInstance( "Ubitrack.Calibration.2D6DPoseEstimation.LM" ) );
 
 
@@ -55,62 +55,103 @@ namespace Ubitrack { namespace Algorithm {
 // In future, this file should not be compiled at all if lapack is not available
 #ifdef HAVE_LAPACK
 
-std::pair < Math::ErrorPose , double > 
-	multipleCameraEstimatePose (
+namespace {
+
+/** @internal camera frames as used by the objective function, computed once for all local bundles */
+struct CameraFrames
+{
+	CameraFrames( const std::vector < Math::Pose >& camPoses )
+		: rotations( camPoses.size() )
+		, translations( camPoses.size() )
+	{
+		for ( std::size_t cameraIndex = 0; cameraIndex < camPoses.size(); cameraIndex++ )
+		{
+			OPT_LOG_DEBUG( "Camera "<<cameraIndex<<" pose:"  << camPoses[ cameraIndex ] );
+			rotations[ cameraIndex ] = Math::Matrix< double, 3, 3 >( camPoses[ cameraIndex ].rotation() );
+			translations[ cameraIndex ] = camPoses[ cameraIndex ].translation();
+		}
+	}
+
+	std::vector< Math::Matrix< double, 3, 3 > > rotations;
+	std::vector< Math::Vector< double, 3 > > translations;
+};
+
+
+/** @internal buffers of one pose estimation, reused for the local bundles handled by one thread */
+struct LocalBundleWorkspace
+{
+	LocalBundleWorkspace( const std::size_t numberCameras )
+		: p3dLocalFiltered( numberCameras )
+		, p2dLocal( numberCameras )
+		, observationCount( numberCameras )
+	{}
+
+	/** observation vector list which is used by the objective function */
+	std::vector< std::pair< std::size_t, std::size_t > > observations;
+
+	/** local 3dpoints for all cameras */
+	std::vector< Math::Vector< double, 3 > > p3dLocal;
+
+	/** local 3dpoints for each cameras (filtered - only available if observation exists) */
+	std::vector< std::vector < Math::Vector< double, 3 > > > p3dLocalFiltered;
+
+	/** local 2d points for each camera */
+	std::vector< std::vector < Math::Vector< double, 2 > > > p2dLocal;
+
+	/** number of observations (=corners with weight != 0) in each camera */
+	std::vector < std::size_t > observationCount;
+
+	/** measurement vector for the LM optimization */
+	Math::Vector< double > measurements;
+};
+
+
+/** @internal estimates the pose from the points [ startIndex, endIndex ) */
+std::pair < Math::ErrorPose , double > estimateLocalBundlePose (
 	const std::vector < Math::Vector< double, 3 > >&  points3d,
 	const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
 	const std::vector < std::vector < Math::Scalar< double > > >& points2dWeights,
 	const std::vector < Math::Pose >& camPoses,
 	const std::vector < Math::Matrix< double, 3, 3 > >& camMatrices,
+	const CameraFrames& cameras,
 	const int minCorrespondences,
 	bool hasInitialPoseProvided,
 	Math::Pose initialPose,
-	int startIndex,
-	int endIndex)
+	const std::size_t startIndex,
+	const std::size_t endIndex,
+	LocalBundleWorkspace& ws )
 {
-	if (endIndex == -1)
-		endIndex = static_cast<int>( points3d.size() ) - 1 ;
-
 	namespace ublas = boost::numeric::ublas;
 	const std::size_t numberCameras ( points2dWeights.size() );
 
-
-	// observation vector list which is used by the objective function
-	std::vector< std::pair< std::size_t, std::size_t > > observations;
-
-	// local 3dpoints for all cameras
-	std::vector< Math::Vector< double, 3 > > p3dLocal;
-
-	// local 3dpoints for each cameras (filtered - only available if observation exists)
-	std::vector< std::vector < Math::Vector< double, 3 > > > p3dLocalFiltered ( numberCameras );
-
-	// local 2d points for each camera
-	std::vector< std::vector < Math::Vector< double, 2 > > > p2dLocal ( numberCameras );
+	ws.observations.clear();
+	ws.p3dLocal.clear();
+	for ( std::size_t cameraIndex = 0; cameraIndex < numberCameras; cameraIndex++ ) {
+		ws.p3dLocalFiltered[ cameraIndex ].clear();
+		ws.p2dLocal[ cameraIndex ].clear();
+	}
 
 	// observationCountTotal will count the number of total observations (=corners with weight != 0) in all cameras
 	std::size_t observationCountTotal( 0 );
-	// observations will count the number of observations (=corners with weight != 0) in each cameras
-	std::vector < std::size_t > observationCount ( numberCameras );
-	std::fill (observationCount.begin(), observationCount.end(), 0);
-
+	std::fill ( ws.observationCount.begin(), ws.observationCount.end(), 0 );
 
 	for ( std::size_t cameraIndex = 0; cameraIndex < numberCameras; cameraIndex++ ) {
-		for ( std::size_t pointIndex = startIndex; pointIndex <= endIndex; pointIndex++ ) {
+		for ( std::size_t pointIndex = startIndex; pointIndex < endIndex; pointIndex++ ) {
 
 			if ( points2dWeights[ cameraIndex ][ pointIndex ] != 0.0 )
 			{
 				OPT_LOG_TRACE( "Observation: marker corner " << pointIndex << " -> camera " << cameraIndex << ", weight=" << points2dWeights[ cameraIndex ][ pointIndex ] << ", m=" << points2d[ cameraIndex ][ pointIndex ] );
 				OPT_LOG_TRACE( "According 3D Point: "<< points3d.at ( pointIndex ) );
-				observations.push_back( std::make_pair( pointIndex - startIndex, cameraIndex ) );			
-				p2dLocal.at(cameraIndex).push_back ( points2d.at(cameraIndex).at(pointIndex) );
-				p3dLocalFiltered.at(cameraIndex).push_back ( points3d.at(pointIndex) );
+				ws.observations.push_back( std::make_pair( pointIndex - startIndex, cameraIndex ) );
+				ws.p2dLocal.at(cameraIndex).push_back ( points2d.at(cameraIndex).at(pointIndex) );
+				ws.p3dLocalFiltered.at(cameraIndex).push_back ( points3d.at(pointIndex) );
 				observationCountTotal++;
-				observationCount.at(cameraIndex)++;
+				ws.observationCount.at(cameraIndex)++;
 			}
 
 			// Add 3d model points only once
 			if (cameraIndex == 0) {
-				p3dLocal.push_back( points3d.at( pointIndex ) ); 
+				ws.p3dLocal.push_back( points3d.at( pointIndex ) );
 			}
 
 		}
@@ -118,55 +159,43 @@ std::pair < Math::ErrorPose , double >
 
 	OPT_LOG_DEBUG( observationCountTotal<<" observations found.");
 
-	std::vector < std::size_t >::iterator minElement = std::min_element ( observationCount.begin(), observationCount.end());
+	std::vector < std::size_t >::iterator minElement = std::min_element ( ws.observationCount.begin(), ws.observationCount.end());
 	std::size_t minObs = *minElement;
-	std::size_t maxObsIndex = (std::max_element (observationCount.begin(), observationCount.end())) - observationCount.begin();
-	std::size_t maxObs = observationCount.at ( maxObsIndex );
+	std::size_t maxObsIndex = (std::max_element (ws.observationCount.begin(), ws.observationCount.end())) - ws.observationCount.begin();
+	std::size_t maxObs = ws.observationCount.at ( maxObsIndex );
 
 	if (minObs >= minCorrespondences && (hasInitialPoseProvided || maxObs >= 4)) {
 		// For the initial pose use camera with most observations
-		
+
 
 		// Compute initial pose
 		if (!hasInitialPoseProvided) {
-			OPT_LOG_DEBUG(  "Compute initial pose with "<<p2dLocal.at(maxObsIndex).size() << " observations for camera " << maxObsIndex );
-			initialPose = camPoses.at( maxObsIndex ) * Algorithm::PoseEstimation2D3D::computePose( p2dLocal.at( maxObsIndex) , p3dLocalFiltered.at( maxObsIndex) ,
+			OPT_LOG_DEBUG(  "Compute initial pose with "<<ws.p2dLocal.at(maxObsIndex).size() << " observations for camera " << maxObsIndex );
+			initialPose = camPoses.at( maxObsIndex ) * Algorithm::PoseEstimation2D3D::computePose( ws.p2dLocal.at( maxObsIndex) , ws.p3dLocalFiltered.at( maxObsIndex) ,
 				camMatrices.at( maxObsIndex ), PoseEstimation2D3D::PLANAR_HOMOGRAPHY ); // there are no scoped enums in C++98 (only in C++0x onwards)
 			OPT_LOG_DEBUG(  "Initial pose "<<initialPose );
 		}
 
 		// Now create the measurement vector from the local 2d points for LM optimization
-		Math::Vector< double > measurements( 2 * observationCountTotal );
+		ws.measurements.resize( 2 * observationCountTotal, false );
 		std::size_t iIndex = 0;
 		for ( std::size_t cameraIndex = 0; cameraIndex < numberCameras; cameraIndex++ ) {
-			for ( std::size_t pointIndex = 0; pointIndex < p2dLocal.at(cameraIndex).size(); pointIndex++ ) {
-				ublas::subrange( measurements, 2 * iIndex, 2 * (iIndex+1) ) = p2dLocal.at( cameraIndex ).at( pointIndex );
+			for ( std::size_t pointIndex = 0; pointIndex < ws.p2dLocal.at(cameraIndex).size(); pointIndex++ ) {
+				ublas::subrange( ws.measurements, 2 * iIndex, 2 * (iIndex+1) ) = ws.p2dLocal.at( cameraIndex ).at( pointIndex );
 				OPT_LOG_TRACE( "Index: "<<iIndex << " pointIndex: "<<pointIndex);
 				iIndex++;
 			}
 		}
 
-		// create camera matrices and rotations for LM optimization
-		std::vector< Math::Matrix< double, 3, 3 > > camRotations( camPoses.size() );
-		std::vector< Math::Vector< double, 3 > > camTranslations( camPoses.size() );
-		for ( std::size_t cameraIndex = 0; cameraIndex < numberCameras; cameraIndex++ )
-		{
-			OPT_LOG_DEBUG( "Camera "<<cameraIndex<<" pose:"  << camPoses[ cameraIndex ] );
-			OPT_LOG_DEBUG( "Camera "<<cameraIndex<<" matrix:"  << camMatrices[ cameraIndex ] );
-
-			camRotations[ cameraIndex ] = Math::Matrix< double, 3, 3 >( camPoses[ cameraIndex ].rotation() );
-			camTranslations[ cameraIndex ] = camPoses[ cameraIndex ].translation();
-		}
-
 		// starting optimization
 		OPT_LOG_DEBUG( "Optimizing pose over " << numberCameras << " cameras using " << observationCountTotal << " observations" );
 
-		ObjectiveFunction< double > f( p3dLocal, camRotations, camTranslations, camMatrices, observations );
+		ObjectiveFunction< double > f( ws.p3dLocal, cameras.rotations, cameras.translations, camMatrices, ws.observations );
 		Math::Vector< double, 6 > param;
 		ublas::subrange( param, 0, 3 ) = initialPose.translation();
 		ublas::subrange( param, 3, 6 ) = initialPose.rotation().toLogarithm();
 
-		const double res = Math::Optimization::levenbergMarquardt( f, param, measurements, Math::Optimization::OptTerminate( 10, 1e-6 ), Math::Optimization::OptNoNormalize() );
+		const double res = Math::Optimization::levenbergMarquardt( f, param, ws.measurements, Math::Optimization::OptTerminate( 10, 1e-6 ), Math::Optimization::OptNoNormalize() );
 
         // Create an error pose with covariance matrix that has the residual on its diagonal entries
 		const Math::ErrorPose finalPose( Math::Quaternion::fromLogarithm( ublas::subrange( param, 3, 6 ) ), ublas::subrange( param, 0, 3 ), Math::Matrix< double, 6, 6 >::identity( ) * res );
@@ -182,6 +211,85 @@ std::pair < Math::ErrorPose , double >
 	}
 }
 
+
+/** @internal estimates the poses of a range of local bundles, with one workspace per range */
+struct LocalBundleTask
+{
+	LocalBundleTask( const std::vector < Math::Vector< double, 3 > >& points3d,
+		const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
+		const std::vector < std::vector < Math::Scalar< double > > >& points2dWeights,
+		const std::vector < Math::Pose >& camPoses,
+		const std::vector < Math::Matrix< double, 3, 3 > >& camMatrices,
+		const CameraFrames& cameras,
+		const int minCorrespondences,
+		const std::vector< std::size_t >& offsets,
+		Math::ErrorPose* poses,
+		Math::Scalar < double >* poseWeights )
+		: m_points3d( points3d )
+		, m_points2d( points2d )
+		, m_points2dWeights( points2dWeights )
+		, m_camPoses( camPoses )
+		, m_camMatrices( camMatrices )
+		, m_cameras( cameras )
+		, m_minCorrespondences( minCorrespondences )
+		, m_offsets( offsets )
+		, m_poses( poses )
+		, m_poseWeights( poseWeights )
+	{}
+
+	void operator()( const std::size_t begin, const std::size_t end ) const
+	{
+		LocalBundleWorkspace ws( m_points2dWeights.size() );
+		for ( std::size_t localBundleIndex = begin; localBundleIndex < end; ++localBundleIndex )
+		{
+			LOG4CPP_DEBUG( logger, "Local bundle " << localBundleIndex <<" has "<< m_offsets[ localBundleIndex + 1 ] - m_offsets[ localBundleIndex ]
+				<< " 2d points. Offset in global bundle list: "<< m_offsets[ localBundleIndex ] );
+
+			const std::pair < Math::ErrorPose , double > estimate =
+				estimateLocalBundlePose( m_points3d, m_points2d, m_points2dWeights, m_camPoses, m_camMatrices, m_cameras, m_minCorrespondences,
+					false, Math::Pose(), m_offsets[ localBundleIndex ], m_offsets[ localBundleIndex + 1 ], ws );
+			m_poses[ localBundleIndex ] = estimate.first;
+			m_poseWeights[ localBundleIndex ] = estimate.second;
+		}
+	}
+
+	const std::vector < Math::Vector< double, 3 > >& m_points3d;
+	const std::vector < std::vector < Math::Vector< double, 2 > > >& m_points2d;
+	const std::vector < std::vector < Math::Scalar< double > > >& m_points2dWeights;
+	const std::vector < Math::Pose >& m_camPoses;
+	const std::vector < Math::Matrix< double, 3, 3 > >& m_camMatrices;
+	const CameraFrames& m_cameras;
+	const int m_minCorrespondences;
+	const std::vector< std::size_t >& m_offsets;
+	Math::ErrorPose* m_poses;
+	Math::Scalar < double >* m_poseWeights;
+};
+
+} // anonymous namespace
+
+
+std::pair < Math::ErrorPose , double > 
+	multipleCameraEstimatePose (
+	const std::vector < Math::Vector< double, 3 > >&  points3d,
+	const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
+	const std::vector < std::vector < Math::Scalar< double > > >& points2dWeights,
+	const std::vector < Math::Pose >& camPoses,
+	const std::vector < Math::Matrix< double, 3, 3 > >& camMatrices,
+	const int minCorrespondences,
+	bool hasInitialPoseProvided,
+	Math::Pose initialPose,
+	int startIndex,
+	int endIndex)
+{
+	if (endIndex == -1)
+		endIndex = static_cast<int>( points3d.size() ) - 1 ;
+
+	const CameraFrames cameras( camPoses );
+	LocalBundleWorkspace ws( points2dWeights.size() );
+	return estimateLocalBundlePose( points3d, points2d, points2dWeights, camPoses, camMatrices, cameras, minCorrespondences,
+		hasInitialPoseProvided, initialPose, startIndex, endIndex + 1, ws );
+}
+
 void checkConsistency (
 	const std::vector < Math::Vector< double, 3 > >&  points3d,
 	const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
@@ -220,35 +328,36 @@ void multipleCameraPoseEstimationWithLocalBundles (
 	const int minCorrespondences,
 	std::vector < Math::ErrorPose >& poses,
 	std::vector < Math::Scalar < double > >& poseWeights,
-	std::vector < Math::Scalar < int > >& localBundleSizes
+	std::vector < Math::Scalar < int > >& localBundleSizes,
+	const Math::ListExecutor& executor
 	)
 {
-	namespace ublas = boost::numeric::ublas;
-	size_t numberCameras = points2dWeights.size();
-
 	checkConsistency ( points3d, points2d, points2dWeights, camPoses, camMatrices );
 
-	// Offset for the current local bundle	
-	int localBundleOffset = 0;
-
-	LOG4CPP_DEBUG( logger, "Processing " << localBundleSizes.size() << " local bundles..." );
-
-	for (int localBundleIndex = 0; localBundleIndex < localBundleSizes.size(); ++localBundleIndex) {
-
-		// Get the number of marker corners for the current cube
-		int localBundleSize = localBundleSizes.at( localBundleIndex );
-
-		LOG4CPP_DEBUG( logger, "Local bundle " << localBundleIndex <<" has "<<localBundleSize<< " 2d points. Offset in global bundle list: "<<localBundleOffset);
-
-		std::pair < Math::ErrorPose , double > estimate = 
-			multipleCameraEstimatePose (points3d, points2d, points2dWeights, camPoses, camMatrices, minCorrespondences, false,
-			Math::Pose(), localBundleOffset, localBundleOffset + localBundleSizes.at( localBundleIndex ) - 1);
-
-		poses.push_back (estimate.first);
-		poseWeights.push_back (estimate.second);
-
-		localBundleOffset += localBundleSize;
-	}
+	// Offsets of the local bundles in the global bundle list
+	const std::size_t numberBundles( localBundleSizes.size() );
+	std::vector< std::size_t > offsets( numberBundles + 1, 0 );
+	for ( std::size_t localBundleIndex = 0; localBundleIndex < numberBundles; ++localBundleIndex )
+		offsets[ localBundleIndex + 1 ] = offsets[ localBundleIndex ] + static_cast< int >( localBundleSizes[ localBundleIndex ] );
+	if ( offsets.back() > points3d.size() )
+		UBITRACK_THROW( "Local bundles contain more points than given" );
+
+	LOG4CPP_DEBUG( logger, "Processing " << numberBundles << " local bundles..." );
+	if ( numberBundles == 0 )
+		return;
+
+	// the results are appended to the given lists
+	const std::size_t firstPose( poses.size() );
+	poses.resize( firstPose + numberBundles );
+	poseWeights.resize( firstPose + numberBundles );
+
+	const CameraFrames cameras( camPoses );
+	const LocalBundleTask task( points3d, points2d, points2dWeights, camPoses, camMatrices, cameras, minCorrespondences, offsets,
+		&poses[ firstPose ], &poseWeights[ firstPose ] );
+	if ( executor.empty() )
+		task( 0, numberBundles );
+	else
+		executor( numberBundles, task );
 }
 
 
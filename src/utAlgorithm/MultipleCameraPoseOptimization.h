@@ -28,6 +28,7 @@
 #include <utMath/Optimization/NewFunction/LieRotation.h>
 #include <utMath/Optimization/NewFunction/LinearTransformation.h>
 #include <utMeasurement/Measurement.h>
+#include <utMath/PoseListOperations.h>
 
 namespace Ubitrack { namespace Algorithm {
 
@@ -59,6 +60,28 @@ public:
 	{ return 2 * m_vis.size(); }
 
 
+	/**
+	 * @param result vector to store the result in
+	 * @param input containing the parameters (target pose as 7-vector)
+	 */
+	template< class VT1, class VT2 > 
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		EvaluateOp< VT1, VT2 > op( result, input );
+		forEachObservation( op );
+	}
+
+	/**
+	 * @param input containing the parameters (target pose as 7-vector)
+	 * @param J matrix to store the jacobian (evaluated for input) in
+	 */
+	template< class VT2, class MT > 
+	void jacobian( const VT2& input, MT& J ) const
+	{
+		JacobianOp< VT2, MT > op( input, J );
+		forEachObservation( op );
+	}
+
 	/**
 	 * @param result vector to store the result in
 	 * @param input containing the parameters (target pose as 7-vector)
@@ -66,16 +89,21 @@ public:
 	 */
 	template< class VT1, class VT2, class MT > 
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		EvaluateWithJacobianOp< VT1, VT2, MT > op( result, input, J );
+		forEachObservation( op );
+	}
+	
+protected:
+	/** calls <tt>op( i, f )</tt> with the projection function f of each observation i */
+	template< class Op >
+	void forEachObservation( Op& op ) const
 	{
 		namespace NF = Math::Optimization::Function;
-		namespace ublas = boost::numeric::ublas;
 		const std::size_t n_vis( m_vis.size() );
 		for ( std::size_t i( 0 ); i < n_vis; ++i )
 		{
-				ublas::vector_range< VT1 > subResult( result, ublas::range( i * 2, ( i + 1 ) * 2 ) );
-				ublas::matrix_range< MT > subJ( J, ublas::range( i * 2, ( i + 1 ) * 2 ), ublas::range( 0, 6 ) );
-		
-				( NF::Dehomogenization< 3 >() <<
+			op( i, ( NF::Dehomogenization< 3 >() <<
 				( NF::LinearTransformation< 3, 3 >( m_camI[ m_vis[ i ].second ] ) <<
 					( NF::Addition< 3 >() <<
 						( NF::fixedParameterRef< 3 >( m_camT[ m_vis[ i ].second ] ) ) <<
@@ -90,11 +118,74 @@ public:
 						)
 					)
 				)
-			).evaluateWithJacobian( input, subResult, subJ );
+			) );
 		}
 	}
-	
-protected:
+
+	/** @internal stores the projection of observation i in rows 2i, 2i+1 of the result */
+	template< class VT1, class VT2 >
+	struct EvaluateOp
+	{
+		EvaluateOp( VT1& result, const VT2& input )
+			: m_result( result )
+			, m_input( input )
+		{}
+
+		template< class F >
+		void operator()( const std::size_t i, const F& f )
+		{
+			boost::numeric::ublas::vector_range< VT1 > subResult( m_result, boost::numeric::ublas::range( i * 2, ( i + 1 ) * 2 ) );
+			f.evaluate( m_input, subResult );
+		}
+
+		VT1& m_result;
+		const VT2& m_input;
+	};
+
+	/** @internal stores the jacobian of observation i in rows 2i, 2i+1 of J */
+	template< class VT2, class MT >
+	struct JacobianOp
+	{
+		JacobianOp( const VT2& input, MT& J )
+			: m_input( input )
+			, m_J( J )
+		{}
+
+		template< class F >
+		void operator()( const std::size_t i, const F& f )
+		{
+			boost::numeric::ublas::matrix_range< MT > subJ( m_J, boost::numeric::ublas::range( i * 2, ( i + 1 ) * 2 ), boost::numeric::ublas::range( 0, 6 ) );
+			f.jacobian( m_input, subJ );
+		}
+
+		const VT2& m_input;
+		MT& m_J;
+	};
+
+	/** @internal both of the above */
+	template< class VT1, class VT2, class MT >
+	struct EvaluateWithJacobianOp
+	{
+		EvaluateWithJacobianOp( VT1& result, const VT2& input, MT& J )
+			: m_result( result )
+			, m_input( input )
+			, m_J( J )
+		{}
+
+		template< class F >
+		void operator()( const std::size_t i, const F& f )
+		{
+			namespace ublas = boost::numeric::ublas;
+			ublas::vector_range< VT1 > subResult( m_result, ublas::range( i * 2, ( i + 1 ) * 2 ) );
+			ublas::matrix_range< MT > subJ( m_J, ublas::range( i * 2, ( i + 1 ) * 2 ), ublas::range( 0, 6 ) );
+			f.evaluateWithJacobian( m_input, subResult, subJ );
+		}
+
+		VT1& m_result;
+		const VT2& m_input;
+		MT& m_J;
+	};
+
 	const std::vector< Math::Vector< VType, 3 > >& m_p3D;
 	const std::vector< Math::Matrix< double, 3, 3 > >& m_camR;
 	const std::vector< Math::Vector< double, 3 > >& m_camT;
@@ -124,6 +215,13 @@ std::pair < Math::ErrorPose , double >
 	int startIndex = 0,
 	int endIndex = -1);
 
+/**
+ * Estimates one pose for each local bundle of consecutive points, e.g. one per marker of a rig.
+ *
+ * The poses and weights of the bundles are appended to \c poses and \c poseWeights, a weight of -1
+ * marks a bundle with too few observations. The bundles are independent and can be distributed over
+ * threads by \c executor, see \c Math::threadExecutor; each thread reuses its buffers for its bundles.
+ */
 UBITRACK_EXPORT void multipleCameraPoseEstimationWithLocalBundles (
 	const std::vector < Math::Vector< double, 3 > >&  points3d,
 	const std::vector < std::vector < Math::Vector< double, 2 > > >& points2d,
@@ -133,7 +231,8 @@ UBITRACK_EXPORT void multipleCameraPoseEstimationWithLocalBundles (
 	const int minCorrespondences,
 	std::vector < Math::ErrorPose >& poses,
 	std::vector < Math::Scalar < double > >& poseWeights,
-	std::vector < Math::Scalar < int > >& localBundleSizes
+	std::vector < Math::Scalar < int > >& localBundleSizes,
+	const Math::ListExecutor& executor = Math::ListExecutor()
 	);
 
 UBITRACK_EXPORT void multipleCameraPoseEstimation (
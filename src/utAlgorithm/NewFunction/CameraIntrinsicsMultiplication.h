@@ -29,8 +29,8 @@
  * @author Daniel Pustka <daniel.pustka@in.tum.de>
  */
 
-#ifndef __UBITRACK_CALIBRATION_FUNCTION_CAMERAINTRINSICSMULTIPLICATION_H_INCLUDED__
-#define __UBITRACK_CALIBRATION_FUNCTION_CAMERAINTRINSICSMULTIPLICATION_H_INCLUDED__
+#ifndef __UBITRACK_ALGORITHM_NEWFUNCTION_CAMERAINTRINSICSMULTIPLICATION_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_NEWFUNCTION_CAMERAINTRINSICSMULTIPLICATION_H_INCLUDED__
 
 #include <utMath/Optimization/NewFunction/MultiVariateFunction.h>
  
@@ -0,0 +1,106 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+
+/**
+ * @ingroup calibration
+ * @file
+ * Implements online hand-eye-calibration of rotation and translation
+ */
+
+#include "OnlineHec.h"
+#ifdef HAVE_LAPACK
+
+#include <cmath>
+#include <algorithm>
+#include <utMath/FixedDecomposition.h>
+#include "PoseEstimation6D6D/DataSelection.h"
+
+namespace Ubitrack { namespace Algorithm {
+
+namespace ublas = boost::numeric::ublas;
+
+OnlineHec::OnlineHec( double minAngle, double minDistance, std::size_t nCompare )
+	: m_minAngle( minAngle )
+	, m_minDistance( minDistance )
+	, m_accepted( nCompare )
+	, m_nAccepted( 0 )
+	, m_bHaveAnchor( false )
+{
+}
+
+
+bool OnlineHec::addPoses( const Math::Pose& hand, const Math::Pose& eye )
+{
+	if ( !m_bHaveAnchor )
+	{
+		m_anchorHand = hand;
+		m_anchorEye = eye;
+		m_bHaveAnchor = true;
+		return false;
+	}
+
+	// relative motions to the anchor, as in fillTransformationVectors of TsaiLenz.cpp
+	if ( !addMeasurement( ~hand * m_anchorHand, eye * ~m_anchorEye ) )
+		return false;
+
+	m_anchorHand = hand;
+	m_anchorEye = eye;
+	return true;
+}
+
+
+bool OnlineHec::addMeasurement( const Math::Pose& a, const Math::Pose& b )
+{
+	// selection criteria
+	const PoseEstimation6D6D::DataSelection< double > align;
+	const Math::RotationDistance< Math::Vector< double, 6 > > distance;
+	const Math::Vector< double, 6 > aAligned( align( a ) );
+	const Math::Vector< double, 6 > bAligned( align( b ) );
+	if ( distance( aAligned, Math::Vector< double, 6 >::zeros() ) < m_minAngle || 
+		distance( bAligned, Math::Vector< double, 6 >::zeros() ) < m_minAngle )
+		return false;
+
+	const std::size_t nCompare = std::min( m_nAccepted, m_accepted.size() );
+	for ( std::size_t i = 0; i < nCompare; i++ )
+		if ( distance( aAligned, m_accepted[ i ] ) < m_minDistance )
+			return false;
+
+	if ( !m_accepted.empty() )
+		m_accepted[ m_nAccepted % m_accepted.size() ] = aAligned;
+	m_nAccepted++;
+
+	m_equations.add( a, b );
+	return true;
+}
+
+
+Math::Pose OnlineHec::computeResult() const
+{
+	return m_equations.computeResult();
+}
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // HAVE_LAPACK
@@ -0,0 +1,126 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+
+/**
+ * @ingroup calibration
+ * @file
+ * Online hand-eye-calibration of rotation and translation
+ */
+ 
+#ifndef __UBITRACK_CALIBRATION_ONLINEHEC_H_INCLUDED__
+#define __UBITRACK_CALIBRATION_ONLINEHEC_H_INCLUDED__
+
+
+#ifdef HAVE_LAPACK
+
+#include <vector>
+
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+#include <utCore.h>
+#include "PoseEstimation6D6D/TsaiLenz.h"
+
+namespace Ubitrack { namespace Algorithm {
+
+/**
+ * Computes a full hand-eye calibration online, with constant effort per pose pair.
+ *
+ * Uses the formulation of Tsai and Lenz, see \c PoseEstimation6D6D::performHandEyeCalibration. Given
+ * pairs of poses a and b, describing relative motions between frames, the class computes a pose x,
+ * s.t. ax = xb:
+ * - the rotation solves the equations of \c OnlineRotHec, <tt>skew( p_a + p_b ) p_x = p_b - p_a</tt>
+ *   with the imaginary parts \c p_a, \c p_b of the quaternions and \c p_x that of x divided by its real part,
+ * - the translation solves <tt>( R_a - I ) t_x = R_x t_b - t_a</tt>.
+ *
+ * Both are recursive least squares problems in information form: each pair adds its rows to the
+ * normal equations of a \c PoseEstimation6D6D::TsaiLenzAccumulator, which \c computeResult solves.
+ * Unlike \c OnlineRotHec, which starts from a prior, the result is the same as
+ * the batch solution of \c PoseEstimation6D6D::performHandEyeCalibration on the accepted pairs.
+ *
+ * Pairs that contribute little are rejected when they are added, following the criteria of
+ * \c PoseEstimation6D6D::DataSelection: the relative rotation of hand and eye must have an angle of at
+ * least \c minAngle, and its axis-angle vector must differ by at least \c minDistance from those of
+ * the last \c nCompare accepted pairs.
+ */
+class UBITRACK_EXPORT OnlineHec
+{
+public:
+	/**
+	 * constructor
+	 * @param minAngle minimum rotation angle of a relative motion, in radians
+	 * @param minDistance minimum distance of the axis-angle rotation of a relative motion to those of
+	 *   previously accepted motions
+	 * @param nCompare number of previously accepted motions that are compared
+	 */
+	OnlineHec( double minAngle = 0.0, double minDistance = 0.0, std::size_t nCompare = 8 );
+	
+	/**
+	 * Adds the absolute poses of hand and eye at one point in time. Together with the poses of the
+	 * last accepted call, they form a pair of relative motions, as in
+	 * \c PoseEstimation6D6D::performHandEyeCalibration, which is passed to \c addMeasurement.
+	 * @return true if the relative motions were accepted
+	 */
+	bool addPoses( const Math::Pose& hand, const Math::Pose& eye );
+
+	/**
+	 * a and b are the relative motion between two frames
+	 * @return true if the pair was accepted
+	 */
+	bool addMeasurement( const Math::Pose& a, const Math::Pose& b );
+
+	/**
+	 * returns the currently estimated transformation x, the identity until the rotation axes of the
+	 * accepted pairs span at least two directions
+	 */
+	Math::Pose computeResult() const;
+
+	/** returns the number of accepted pairs */
+	std::size_t size() const
+	{ return m_nAccepted; }
+
+protected:
+	/** selection thresholds */
+	double m_minAngle;
+	double m_minDistance;
+
+	/** normal equations of the accepted pairs */
+	PoseEstimation6D6D::TsaiLenzAccumulator m_equations;
+
+	/** axis-angle rotations of the last accepted pairs, as by \c PoseEstimation6D6D::DataSelection */
+	std::vector< Math::Vector< double, 6 > > m_accepted;
+
+	/** number of accepted pairs */
+	std::size_t m_nAccepted;
+
+	/** poses of the last accepted call of \c addPoses */
+	bool m_bHaveAnchor;
+	Math::Pose m_anchorHand;
+	Math::Pose m_anchorEye;
+};
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // HAVE_LAPACK
+#endif
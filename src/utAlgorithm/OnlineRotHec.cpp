@@ -30,8 +30,8 @@
  * @author Daniel Pustka <daniel.pustka@in.tum.de>
  */
 
-#include <log4cpp/Category.hh>
-static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Calibration.OnlineRotHec" ) );
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Calibration.OnlineRotHec" );
 #define KALMAN_LOGGING
  
 #include "OnlineRotHec.h"
@@ -0,0 +1,179 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Real roots of small polynomials, as they appear in the minimal solvers.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_POLYNOMIAL_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_POLYNOMIAL_H_INCLUDED__
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace Ubitrack { namespace Algorithm {
+
+/** @internal evaluates the polynomial c[0] + c[1] x + ... + c[deg] x^deg */
+inline double evaluatePolynomial( const double* c, const std::size_t deg, const double x )
+{
+	double y = c[ deg ];
+	for ( std::size_t i = deg; i-- > 0; )
+		y = y * x + c[ i ];
+	return y;
+}
+
+/** @internal magnitude of the terms of the polynomial at x, the scale of its rounding error */
+inline double polynomialScale( const double* c, const std::size_t deg, const double x )
+{
+	double y = std::fabs( c[ deg ] );
+	for ( std::size_t i = deg; i-- > 0; )
+		y = y * std::fabs( x ) + std::fabs( c[ i ] );
+	return y;
+}
+
+/** @internal multiplies two polynomials */
+inline void multiplyPolynomials( const double* a, const std::size_t degA, const double* b, const std::size_t degB, double* c )
+{
+	std::fill( c, c + degA + degB + 1, 0. );
+	for ( std::size_t i = 0; i <= degA; i++ )
+		for ( std::size_t j = 0; j <= degB; j++ )
+			c[ i + j ] += a[ i ] * b[ j ];
+}
+
+/**
+ * @internal computes the real roots of a polynomial of degree up to ten. The extrema are found
+ * recursively from the derivative, each monotonic interval with a sign change holds one root,
+ * which is found by a safeguarded newton iteration.
+ * @return the number of roots written to \c roots, in ascending order
+ */
+inline std::size_t realRoots( const double* c, std::size_t deg, double* roots )
+{
+	double maxCoeff = 0;
+	for ( std::size_t i = 0; i <= deg; i++ )
+		maxCoeff = std::max( maxCoeff, std::fabs( c[ i ] ) );
+	while ( deg > 0 && std::fabs( c[ deg ] ) <= 1e-14 * maxCoeff )
+		deg--;
+
+	if ( deg == 0 )
+		return 0;
+
+	if ( deg == 1 )
+	{
+		roots[ 0 ] = -c[ 0 ] / c[ 1 ];
+		return 1;
+	}
+
+	if ( deg == 2 )
+	{
+		const double disc = c[ 1 ] * c[ 1 ] - 4 * c[ 2 ] * c[ 0 ];
+		if ( disc < 0 )
+			return 0;
+		// avoids the cancellation of the textbook formula
+		const double q = -0.5 * ( c[ 1 ] + ( c[ 1 ] < 0 ? -1 : 1 ) * std::sqrt( disc ) );
+		if ( q == 0 )
+		{
+			roots[ 0 ] = 0;
+			return 1;
+		}
+		roots[ 0 ] = q / c[ 2 ];
+		roots[ 1 ] = c[ 0 ] / q;
+		if ( roots[ 0 ] > roots[ 1 ] )
+			std::swap( roots[ 0 ], roots[ 1 ] );
+		return 2;
+	}
+
+	// the extrema separate the roots
+	double derivative[ 10 ];
+	for ( std::size_t i = 0; i < deg; i++ )
+		derivative[ i ] = ( i + 1 ) * c[ i + 1 ];
+	double bounds[ 11 ];
+	const std::size_t nExtrema = realRoots( derivative, deg - 1, bounds + 1 );
+
+	// all roots are within the cauchy bound
+	double bound = 0;
+	for ( std::size_t i = 0; i < deg; i++ )
+		bound = std::max( bound, std::fabs( c[ i ] / c[ deg ] ) );
+	bound += 1;
+	bounds[ 0 ] = -bound;
+	for ( std::size_t i = 1; i <= nExtrema; i++ )
+		bounds[ i ] = std::max( -bound, std::min( bound, bounds[ i ] ) );
+	bounds[ nExtrema + 1 ] = bound;
+
+	std::size_t nRoots = 0;
+	for ( std::size_t i = 0; i <= nExtrema; i++ )
+	{
+		double lo = bounds[ i ];
+		double hi = bounds[ i + 1 ];
+		const double fLo = evaluatePolynomial( c, deg, lo );
+		const double fHi = evaluatePolynomial( c, deg, hi );
+		if ( fLo == 0 )
+		{
+			if ( nRoots == 0 || roots[ nRoots - 1 ] != lo )
+				roots[ nRoots++ ] = lo;
+			continue;
+		}
+		if ( ( fLo < 0 ) == ( fHi < 0 ) )
+		{
+			// an extremum that touches zero up to rounding is a double root
+			if ( i < nExtrema && std::fabs( fHi ) <= 1e-10 * polynomialScale( c, deg, hi ) )
+				roots[ nRoots++ ] = hi;
+			continue;
+		}
+
+		double x = 0.5 * ( lo + hi );
+		double lastStep = hi - lo;
+		double step = lastStep;
+		for ( std::size_t iter = 0; iter < 200; iter++ )
+		{
+			const double fx = evaluatePolynomial( c, deg, x );
+			if ( fx == 0 )
+				break;
+			if ( ( fx < 0 ) == ( fLo < 0 ) )
+				lo = x;
+			else
+				hi = x;
+
+			const double dfx = evaluatePolynomial( derivative, deg - 1, x );
+			double next = dfx != 0 ? x - fx / dfx : 0.5 * ( lo + hi );
+
+			// bisection if newton leaves the interval or converges slowly, e.g. far from the root
+			if ( !( next > lo && next < hi ) || std::fabs( next - x ) > 0.5 * std::fabs( lastStep ) )
+				next = 0.5 * ( lo + hi );
+			lastStep = step;
+			step = next - x;
+			const bool bDone = std::fabs( next - x ) <= 4 * std::numeric_limits< double >::epsilon() * ( 1 + std::fabs( x ) );
+			x = next;
+			if ( bDone )
+				break;
+		}
+		roots[ nRoots++ ] = x;
+	}
+	return nRoots;
+}
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // __UBITRACK_ALGORITHM_POLYNOMIAL_H_INCLUDED__
@@ -0,0 +1,578 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implementation of the closed-form P3P and EPnP pose estimation.
+ */
+
+#include "ClosedFormPoseEstimation.h"
+#include "Ransac.h"
+
+// std
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// Boost
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+
+#include <utMath/Blas1.h> // inner_product, norm_2
+#include <utMath/VectorFunctions.h> // cross_product
+#include <utMath/FixedDecomposition.h>
+#include <utUtil/TraceSpan.h>
+#include "../Polynomial.h"
+
+#ifdef HAVE_LAPACK
+#include "../PoseEstimation3D3D/AbsoluteOrientation.h" // -> pose from camera coordinates
+#endif
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger optLogger( "Ubitrack.Calibration.2D3DPoseEstimation" );
+
+
+// shortcuts to namespaces
+namespace ublas = boost::numeric::ublas;
+
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
+
+namespace { // anonymous
+
+typedef Math::Vector< double, 2 > Vec2;
+typedef Math::Vector< double, 3 > Vec3;
+
+/** @internal squared reprojection error of the points [ iBegin, n ) in normalized image coordinates */
+double reprojectionError( const Math::Pose& pose, const Vec2* p2D, const Vec3* p3D, const std::size_t iBegin, const std::size_t n )
+{
+	double error = 0;
+	for ( std::size_t i = iBegin; i < n; i++ )
+	{
+		const Vec3 p( pose * p3D[ i ] );
+		if ( p( 2 ) <= 0 )
+			return std::numeric_limits< double >::max();
+		const double dx = p( 0 ) / p( 2 ) - p2D[ i ]( 0 );
+		const double dy = p( 1 ) / p( 2 ) - p2D[ i ]( 1 );
+		error += dx * dx + dy * dy;
+	}
+	return error;
+}
+
+/** @internal orthonormal frame spanned by three points, as columns */
+bool triad( const Vec3& p1, const Vec3& p2, const Vec3& p3, Math::Matrix< double, 3, 3 >& frame )
+{
+	Vec3 e1( p2 - p1 );
+	Vec3 e3( Math::cross_product( e1, Vec3( p3 - p1 ) ) );
+	const double n1 = Math::norm_2( e1 );
+	const double n3 = Math::norm_2( e3 );
+	if ( !( n3 > 1e-12 * n1 * n1 ) )
+		return false;
+	e1 /= n1;
+	e3 /= n3;
+	const Vec3 e2( Math::cross_product( e3, e1 ) );
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		frame( i, 0 ) = e1( i );
+		frame( i, 1 ) = e2( i );
+		frame( i, 2 ) = e3( i );
+	}
+	return true;
+}
+
+/** @internal P3P of the first three points, appends the solutions */
+std::size_t p3p( const Vec2* p2D, const Vec3* p3D, std::vector< Math::Pose >& poses )
+{
+	// bearing vectors
+	Vec3 f[ 3 ];
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		f[ i ] = Vec3( p2D[ i ]( 0 ), p2D[ i ]( 1 ), 1 );
+		f[ i ] /= Math::norm_2( f[ i ] );
+	}
+
+	Math::Matrix< double, 3, 3 > objectFrame;
+	if ( !triad( p3D[ 0 ], p3D[ 1 ], p3D[ 2 ], objectFrame ) )
+		return 0;
+
+	// squared sides opposite to the points and cosines of the angles between the bearings
+	const double a2 = Math::inner_product( Vec3( p3D[ 1 ] - p3D[ 2 ] ), Vec3( p3D[ 1 ] - p3D[ 2 ] ) );
+	const double b2 = Math::inner_product( Vec3( p3D[ 0 ] - p3D[ 2 ] ), Vec3( p3D[ 0 ] - p3D[ 2 ] ) );
+	const double c2 = Math::inner_product( Vec3( p3D[ 0 ] - p3D[ 1 ] ), Vec3( p3D[ 0 ] - p3D[ 1 ] ) );
+	const double cosA = Math::inner_product( f[ 1 ], f[ 2 ] );
+	const double cosB = Math::inner_product( f[ 0 ], f[ 2 ] );
+	const double cosC = Math::inner_product( f[ 0 ], f[ 1 ] );
+
+	// 1 - cos from the chords, the angles between the bearings are small
+	const double omA = 0.5 * Math::inner_product( Vec3( f[ 1 ] - f[ 2 ] ), Vec3( f[ 1 ] - f[ 2 ] ) );
+	const double omB = 0.5 * Math::inner_product( Vec3( f[ 0 ] - f[ 2 ] ), Vec3( f[ 0 ] - f[ 2 ] ) );
+	const double omC = 0.5 * Math::inner_product( Vec3( f[ 0 ] - f[ 1 ] ), Vec3( f[ 0 ] - f[ 1 ] ) );
+
+	// with the distances s2 = u s1 and s3 = v s1, the law of cosines gives
+	//   b2 ( u^2 + v^2 - 2 u v cosA ) = a2 ( 1 + v^2 - 2 v cosB )
+	//   b2 ( 1 + u^2 - 2 u cosC )     = c2 ( 1 + v^2 - 2 v cosB )
+	// their difference is linear in u, u = N( v ) / D( v ), substituting it into the second
+	// equation leaves a quartic in v. For targets far from the camera all roots cluster
+	// around v = 1, where the coefficients in v cancel, so the polynomials are expanded in w = v - 1
+	const double l[ 3 ] = { 2 * omB, 2 * omB, 1 };
+	const double n[ 3 ] = { 2 * ( a2 - c2 ) * omB, 2 * ( a2 - c2 ) * omB - 2 * b2, a2 - c2 - b2 };
+	const double d[ 2 ] = { 2 * b2 * ( omA - omC ), -2 * b2 * cosA };
+
+	// b2 ( N^2 + D^2 - 2 cosC N D ) = c2 L D^2, with the left side as b2 ( ( N - D )^2 + 2 ( 1 - cosC ) N D )
+	const double nMinusD[ 3 ] = { n[ 0 ] - d[ 0 ], n[ 1 ] - d[ 1 ], n[ 2 ] };
+	double dd[ 3 ], nmd2[ 5 ], nd[ 4 ], ldd[ 5 ];
+	multiplyPolynomials( d, 1, d, 1, dd );
+	multiplyPolynomials( nMinusD, 2, nMinusD, 2, nmd2 );
+	multiplyPolynomials( n, 2, d, 1, nd );
+	multiplyPolynomials( l, 2, dd, 2, ldd );
+
+	double quartic[ 5 ];
+	for ( std::size_t i = 0; i < 5; i++ )
+		quartic[ i ] = b2 * ( nmd2[ i ] + 2 * omC * ( i < 4 ? nd[ i ] : 0 ) ) - c2 * ldd[ i ];
+
+	double roots[ 4 ];
+	const std::size_t nRoots = realRoots( quartic, 4, roots );
+
+	std::size_t nSolutions = 0;
+	for ( std::size_t i = 0; i < nRoots; i++ )
+	{
+		const double w = roots[ i ];
+		const double v = 1 + w;
+		const double dv = evaluatePolynomial( d, 1, w );
+		const double lv = evaluatePolynomial( l, 2, w );
+		if ( v <= 0 || std::fabs( dv ) <= 1e-12 * b2 || lv <= 0 )
+			continue;
+		const double u = evaluatePolynomial( n, 2, w ) / dv;
+		if ( u <= 0 )
+			continue;
+
+		// distances of the points, polished by newton steps on the law of cosines,
+		// as the elimination loses accuracy near double roots, where newton converges slowly
+		const double s1 = std::sqrt( b2 / lv );
+		Vec3 s( s1, u * s1, v * s1 );
+		for ( std::size_t iter = 0; iter < 10; iter++ )
+		{
+			const Vec3 g( s( 1 ) * s( 1 ) + s( 2 ) * s( 2 ) - 2 * s( 1 ) * s( 2 ) * cosA - a2,
+				s( 0 ) * s( 0 ) + s( 2 ) * s( 2 ) - 2 * s( 0 ) * s( 2 ) * cosB - b2,
+				s( 0 ) * s( 0 ) + s( 1 ) * s( 1 ) - 2 * s( 0 ) * s( 1 ) * cosC - c2 );
+			Math::Matrix< double, 3, 3 > jacobian;
+			jacobian( 0, 0 ) = 0;
+			jacobian( 0, 1 ) = 2 * ( s( 1 ) - s( 2 ) * cosA );
+			jacobian( 0, 2 ) = 2 * ( s( 2 ) - s( 1 ) * cosA );
+			jacobian( 1, 0 ) = 2 * ( s( 0 ) - s( 2 ) * cosB );
+			jacobian( 1, 1 ) = 0;
+			jacobian( 1, 2 ) = 2 * ( s( 2 ) - s( 0 ) * cosB );
+			jacobian( 2, 0 ) = 2 * ( s( 0 ) - s( 1 ) * cosC );
+			jacobian( 2, 1 ) = 2 * ( s( 1 ) - s( 0 ) * cosC );
+			jacobian( 2, 2 ) = 0;
+			Vec3 step;
+			if ( !Math::qrSolve( jacobian, g, step ) )
+				break;
+			s -= step;
+			if ( ublas::norm_inf( step ) <= 1e-12 * ublas::norm_inf( s ) )
+				break;
+		}
+
+		// camera coordinates of the points
+		Math::Matrix< double, 3, 3 > cameraFrame;
+		if ( !triad( Vec3( f[ 0 ] * s( 0 ) ), Vec3( f[ 1 ] * s( 1 ) ), Vec3( f[ 2 ] * s( 2 ) ), cameraFrame ) )
+			continue;
+
+		const Math::Matrix< double, 3, 3 > rotation( ublas::prod( cameraFrame, ublas::trans( objectFrame ) ) );
+		const Vec3 translation( f[ 0 ] * s( 0 ) - ublas::prod( rotation, p3D[ 0 ] ) );
+		poses.push_back( Math::Pose( Math::Quaternion( rotation ).normalize(), translation ) );
+		nSolutions++;
+	}
+
+	LOG4CPP_TRACE( optLogger, "P3P found " << nSolutions << " solutions from " << nRoots << " real roots" );
+	return nSolutions;
+}
+
+/** @internal converts the points to double precision */
+template< typename T >
+void toDouble( const std::vector< Math::Vector< T, 2 > >& p2D, const std::vector< Math::Vector< T, 3 > >& p3D,
+	std::vector< Vec2 >& p2Dd, std::vector< Vec3 >& p3Dd )
+{
+	p2Dd.reserve( p2D.size() );
+	p3Dd.reserve( p3D.size() );
+	for ( std::size_t i = 0; i < p2D.size(); i++ )
+	{
+		p2Dd.push_back( Vec2( p2D[ i ]( 0 ), p2D[ i ]( 1 ) ) );
+		p3Dd.push_back( Vec3( p3D[ i ]( 0 ), p3D[ i ]( 1 ), p3D[ i ]( 2 ) ) );
+	}
+}
+
+/** @internal */
+template< typename T >
+std::size_t estimatePosesP3P_impl( const std::vector< Math::Vector< T, 2 > >& p2D, std::vector< Math::Pose >& poses,
+	const std::vector< Math::Vector< T, 3 > >& p3D )
+{
+	if ( p2D.size() < 3 || p3D.size() != p2D.size() )
+		return 0;
+	std::vector< Vec2 > p2Dd;
+	std::vector< Vec3 > p3Dd;
+	toDouble( std::vector< Math::Vector< T, 2 > >( p2D.begin(), p2D.begin() + 3 ),
+		std::vector< Math::Vector< T, 3 > >( p3D.begin(), p3D.begin() + 3 ), p2Dd, p3Dd );
+	return p3p( &p2Dd[ 0 ], &p3Dd[ 0 ], poses );
+}
+
+/** @internal */
+template< typename T >
+bool estimatePoseP3P_impl( const std::vector< Math::Vector< T, 2 > >& p2D, Math::Pose& pose,
+	const std::vector< Math::Vector< T, 3 > >& p3D )
+{
+	const std::size_t n = p2D.size();
+	if ( n < 4 || p3D.size() != n )
+		return false;
+	std::vector< Vec2 > p2Dd;
+	std::vector< Vec3 > p3Dd;
+	toDouble( p2D, p3D, p2Dd, p3Dd );
+
+	std::vector< Math::Pose > poses;
+	poses.reserve( 4 );
+	p3p( &p2Dd[ 0 ], &p3Dd[ 0 ], poses );
+
+	double bestError = std::numeric_limits< double >::max();
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+	{
+		const double error = reprojectionError( poses[ i ], &p2Dd[ 0 ], &p3Dd[ 0 ], 3, n );
+		if ( error < bestError )
+		{
+			bestError = error;
+			pose = poses[ i ];
+		}
+	}
+	return bestError < std::numeric_limits< double >::max();
+}
+
+
+#ifdef HAVE_LAPACK
+
+/**
+ * @internal initial weights of three eigenvectors for four control points from the linearized
+ * distance constraints in b11, b12, b13, b22, b23, b33
+ * @param diffs differences of the control points in the eigenvectors, six per eigenvector
+ * @param rho squared distances of the control points in object coordinates
+ * @param beta the first three weights
+ */
+bool threeVectorWeights( const Vec3* diffs, const double* rho, double* beta )
+{
+	Math::Matrix< double, 6, 6 > l;
+	Math::Vector< double, 6 > r;
+	for ( std::size_t p = 0; p < 6; p++ )
+	{
+		for ( std::size_t j = 0, c = 0; j < 3; j++ )
+			for ( std::size_t k = j; k < 3; k++, c++ )
+				l( p, c ) = ( j == k ? 1 : 2 ) * Math::inner_product( diffs[ 6 * j + p ], diffs[ 6 * k + p ] );
+		r( p ) = rho[ p ];
+	}
+	Math::Vector< double, 6 > b;
+	if ( !Math::qrSolve( l, r, b ) || b( 0 ) == 0 )
+		return false;
+	beta[ 0 ] = std::sqrt( std::fabs( b( 0 ) ) );
+	beta[ 1 ] = b( 1 ) / beta[ 0 ];
+	beta[ 2 ] = b( 2 ) / beta[ 0 ];
+	return true;
+}
+
+/**
+ * @internal EPnP with \c NC control points, the centroid \c c0 and \c NC - 1 points c0 + axes[ k ].
+ * @return the squared reprojection error of the pose
+ */
+template< std::size_t NC >
+double epnp( const std::vector< Vec2 >& p2D, const std::vector< Vec3 >& p3D, const Vec3& c0, const Vec3* axes, Math::Pose& pose )
+{
+	static const std::size_t nUnknowns = 3 * NC;
+	static const std::size_t nPairs = NC * ( NC - 1 ) / 2;
+	static const std::size_t nBetas = NC == 4 ? 4 : 3;
+	const std::size_t n = p2D.size();
+
+	// barycentric coordinates w.r.t. the control points, the axes are orthogonal
+	std::vector< double > alphas( n * NC );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const Vec3 p( p3D[ i ] - c0 );
+		double* alpha = &alphas[ i * NC ];
+		alpha[ 0 ] = 1;
+		for ( std::size_t k = 1; k < NC; k++ )
+		{
+			alpha[ k ] = Math::inner_product( axes[ k - 1 ], p ) / Math::inner_product( axes[ k - 1 ], axes[ k - 1 ] );
+			alpha[ 0 ] -= alpha[ k ];
+		}
+	}
+
+	// M^T M of the two equations per point
+	//   sum_j alpha_j ( x_j - u z_j ) = 0, sum_j alpha_j ( y_j - v z_j ) = 0
+	// for the camera coordinates ( x_j, y_j, z_j ) of the control points
+	Math::Matrix< double, nUnknowns, nUnknowns > mtm( Math::Matrix< double, nUnknowns, nUnknowns >::zeros() );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const double* alpha = &alphas[ i * NC ];
+		const double u = p2D[ i ]( 0 );
+		const double v = p2D[ i ]( 1 );
+		const double b[ 3 ][ 3 ] = { { 1, 0, -u }, { 0, 1, -v }, { -u, -v, u * u + v * v } };
+		for ( std::size_t j = 0; j < NC; j++ )
+			for ( std::size_t k = j; k < NC; k++ )
+			{
+				const double a = alpha[ j ] * alpha[ k ];
+				for ( std::size_t r = 0; r < 3; r++ )
+					for ( std::size_t c = 0; c < 3; c++ )
+						mtm( 3 * j + r, 3 * k + c ) += a * b[ r ][ c ];
+			}
+	}
+
+	Math::Vector< double, nUnknowns > eigenValues;
+	if ( !Math::symmetricEigen( mtm, eigenValues ) )
+		return std::numeric_limits< double >::max();
+
+	// distances between the control points in object coordinates and differences of
+	// the control points in the eigenvectors with the smallest eigenvalues
+	Vec3 controls[ NC ];
+	controls[ 0 ] = c0;
+	for ( std::size_t k = 1; k < NC; k++ )
+		controls[ k ] = c0 + axes[ k - 1 ];
+	double rho[ nPairs ];
+	Vec3 diffs[ nBetas ][ nPairs ];
+	for ( std::size_t i = 0, p = 0; i < NC; i++ )
+		for ( std::size_t j = i + 1; j < NC; j++, p++ )
+		{
+			rho[ p ] = Math::inner_product( Vec3( controls[ i ] - controls[ j ] ), Vec3( controls[ i ] - controls[ j ] ) );
+			for ( std::size_t k = 0; k < nBetas; k++ )
+				for ( std::size_t c = 0; c < 3; c++ )
+					diffs[ k ][ p ]( c ) = mtm( 3 * i + c, k ) - mtm( 3 * j + c, k );
+		}
+
+	// initial weights of one to three eigenvectors from the linearized distance constraints
+	std::vector< Math::Vector< double, nBetas > > candidates;
+	{
+		// one eigenvector: scale only
+		double num = 0, den = 0;
+		for ( std::size_t p = 0; p < nPairs; p++ )
+		{
+			const double d = Math::norm_2( diffs[ 0 ][ p ] );
+			num += d * std::sqrt( rho[ p ] );
+			den += d * d;
+		}
+		Math::Vector< double, nBetas > beta( Math::Vector< double, nBetas >::zeros() );
+		beta( 0 ) = num / den;
+		candidates.push_back( beta );
+	}
+	{
+		// two eigenvectors: b11, b12, b22
+		Math::Matrix< double, nPairs, 3 > l;
+		Math::Vector< double, nPairs > r;
+		for ( std::size_t p = 0; p < nPairs; p++ )
+		{
+			l( p, 0 ) = Math::inner_product( diffs[ 0 ][ p ], diffs[ 0 ][ p ] );
+			l( p, 1 ) = 2 * Math::inner_product( diffs[ 0 ][ p ], diffs[ 1 ][ p ] );
+			l( p, 2 ) = Math::inner_product( diffs[ 1 ][ p ], diffs[ 1 ][ p ] );
+			r( p ) = rho[ p ];
+		}
+		Math::Vector< double, 3 > b;
+		if ( Math::qrSolve( l, r, b ) && b( 0 ) != 0 )
+		{
+			Math::Vector< double, nBetas > beta( Math::Vector< double, nBetas >::zeros() );
+			beta( 0 ) = std::sqrt( std::fabs( b( 0 ) ) );
+			beta( 1 ) = b( 1 ) / beta( 0 );
+			candidates.push_back( beta );
+		}
+	}
+	if ( NC == 4 )
+	{
+		Math::Vector< double, nBetas > beta( Math::Vector< double, nBetas >::zeros() );
+		if ( threeVectorWeights( &diffs[ 0 ][ 0 ], rho, &beta( 0 ) ) )
+			candidates.push_back( beta );
+	}
+
+	double bestError = std::numeric_limits< double >::max();
+	std::vector< Vec3 > pCam( n );
+	for ( std::size_t iCandidate = 0; iCandidate < candidates.size(); iCandidate++ )
+	{
+		Math::Vector< double, nBetas > beta( candidates[ iCandidate ] );
+
+		// gauss-newton on the distance constraints
+		for ( std::size_t iter = 0; iter < 5; iter++ )
+		{
+			Math::Matrix< double, nBetas, nBetas > jtj( Math::Matrix< double, nBetas, nBetas >::zeros() );
+			Math::Vector< double, nBetas > jtr( Math::Vector< double, nBetas >::zeros() );
+			for ( std::size_t p = 0; p < nPairs; p++ )
+			{
+				Vec3 diff( Vec3::zeros() );
+				for ( std::size_t k = 0; k < nBetas; k++ )
+					diff += beta( k ) * diffs[ k ][ p ];
+				const double residual = Math::inner_product( diff, diff ) - rho[ p ];
+				double jacobian[ nBetas ];
+				for ( std::size_t k = 0; k < nBetas; k++ )
+					jacobian[ k ] = 2 * Math::inner_product( diff, diffs[ k ][ p ] );
+				for ( std::size_t j = 0; j < nBetas; j++ )
+				{
+					jtr( j ) -= jacobian[ j ] * residual;
+					for ( std::size_t k = 0; k < nBetas; k++ )
+						jtj( j, k ) += jacobian[ j ] * jacobian[ k ];
+				}
+			}
+			if ( !Math::choleskySolve( jtj, jtr ) )
+				break;
+			beta += jtr;
+		}
+
+		// camera coordinates of the control points and of the points, in front of the camera
+		Vec3 cameraControls[ NC ];
+		for ( std::size_t j = 0; j < NC; j++ )
+			for ( std::size_t c = 0; c < 3; c++ )
+			{
+				cameraControls[ j ]( c ) = 0;
+				for ( std::size_t k = 0; k < nBetas; k++ )
+					cameraControls[ j ]( c ) += beta( k ) * mtm( 3 * j + c, k );
+			}
+		double depth = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			pCam[ i ] = Vec3::zeros();
+			for ( std::size_t j = 0; j < NC; j++ )
+				pCam[ i ] += alphas[ i * NC + j ] * cameraControls[ j ];
+			depth += pCam[ i ]( 2 );
+		}
+		if ( depth < 0 )
+			for ( std::size_t i = 0; i < n; i++ )
+				pCam[ i ] *= -1;
+
+		Math::Pose candidate;
+		if ( !PoseEstimation3D3D::estimatePose6D_3D3D( pCam, candidate, p3D ) )
+			continue;
+		const double error = reprojectionError( candidate, &p2D[ 0 ], &p3D[ 0 ], 0, n );
+		LOG4CPP_TRACE( optLogger, "EPnP candidate " << iCandidate << " has reprojection error " << error );
+		if ( error < bestError )
+		{
+			bestError = error;
+			pose = candidate;
+		}
+	}
+	return bestError;
+}
+
+/** @internal */
+template< typename T >
+bool estimatePoseEPnP_impl( const std::vector< Math::Vector< T, 2 > >& p2D, Math::Pose& pose,
+	const std::vector< Math::Vector< T, 3 > >& p3D )
+{
+	const std::size_t n = p2D.size();
+	if ( n < 4 || p3D.size() != n )
+		return false;
+	UBITRACK_TRACE_SPAN( "pose_estimation_epnp", n );
+	std::vector< Vec2 > p2Dd;
+	std::vector< Vec3 > p3Dd;
+	toDouble( p2D, p3D, p2Dd, p3Dd );
+
+	// principal axes of the object points, scaled to their standard deviation
+	Vec3 c0( Vec3::zeros() );
+	for ( std::size_t i = 0; i < n; i++ )
+		c0 += p3Dd[ i ];
+	c0 /= static_cast< double >( n );
+	Math::Matrix< double, 3, 3 > cov( Math::Matrix< double, 3, 3 >::zeros() );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const Vec3 p( p3Dd[ i ] - c0 );
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t c = 0; c < 3; c++ )
+				cov( r, c ) += p( r ) * p( c );
+	}
+	Math::Vector< double, 3 > variances;
+	if ( !Math::symmetricEigen( cov, variances ) || !( variances( 1 ) > 1e-8 * variances( 2 ) ) )
+	{
+		LOG4CPP_DEBUG( optLogger, "EPnP failed, the object points are collinear" );
+		return false;
+	}
+	Vec3 axes[ 3 ];
+	for ( std::size_t k = 0; k < 3; k++ )
+		axes[ k ] = ublas::column( cov, 2 - k ) * std::sqrt( std::max( variances( 2 - k ), 0. ) / n );
+
+	// three control points in the plane of planar objects
+	if ( variances( 0 ) <= 1e-8 * variances( 2 ) )
+		return epnp< 3 >( p2Dd, p3Dd, c0, axes, pose ) < std::numeric_limits< double >::max();
+
+	// four points in general position leave four eigenvectors, whose weights are not determined
+	// by the linearized constraints, the minimal solver is exact then
+	if ( n == 4 )
+		return estimatePoseP3P_impl( p2D, pose, p3D );
+
+	return epnp< 4 >( p2Dd, p3Dd, c0, axes, pose ) < std::numeric_limits< double >::max();
+}
+
+#endif // HAVE_LAPACK
+
+} // anonymous-namespace
+
+std::size_t estimatePosesP3P( const std::vector< Math::Vector2d >& p2D, std::vector< Math::Pose >& poses,
+	const std::vector< Math::Vector3d >& p3D )
+{
+	return estimatePosesP3P_impl( p2D, poses, p3D );
+}
+
+std::size_t estimatePosesP3P( const std::vector< Math::Vector2f >& p2D, std::vector< Math::Pose >& poses,
+	const std::vector< Math::Vector3f >& p3D )
+{
+	return estimatePosesP3P_impl( p2D, poses, p3D );
+}
+
+bool estimatePoseP3P( const std::vector< Math::Vector2d >& p2D, Math::Pose& pose, const std::vector< Math::Vector3d >& p3D )
+{
+	return estimatePoseP3P_impl( p2D, pose, p3D );
+}
+
+bool estimatePoseP3P( const std::vector< Math::Vector2f >& p2D, Math::Pose& pose, const std::vector< Math::Vector3f >& p3D )
+{
+	return estimatePoseP3P_impl( p2D, pose, p3D );
+}
+
+#ifdef HAVE_LAPACK
+
+bool estimatePoseEPnP( const std::vector< Math::Vector2d >& p2D, Math::Pose& pose, const std::vector< Math::Vector3d >& p3D )
+{
+	return estimatePoseEPnP_impl( p2D, pose, p3D );
+}
+
+bool estimatePoseEPnP( const std::vector< Math::Vector2f >& p2D, Math::Pose& pose, const std::vector< Math::Vector3f >& p3D )
+{
+	return estimatePoseEPnP_impl( p2D, pose, p3D );
+}
+
+bool estimatePose6D_2D3D( const std::vector< Math::Vector2f >& p2D
+	, Math::Pose& pose
+	, const std::vector< Math::Vector3f >& p3D
+	, const Math::Optimization::RansacParameter< float >& params )
+{
+	return estimatePose6D_2D3D( p2D.begin(), p2D.end(), pose, p3D.begin(), p3D.end(), params );
+}
+
+bool estimatePose6D_2D3D( const std::vector< Math::Vector2d >& p2D
+	, Math::Pose& pose
+	, const std::vector< Math::Vector3d >& p3D
+	, const Math::Optimization::RansacParameter< double >& params )
+{
+	return estimatePose6D_2D3D( p2D.begin(), p2D.end(), pose, p3D.begin(), p3D.end(), params );
+}
+
+#endif // HAVE_LAPACK
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation2D3D
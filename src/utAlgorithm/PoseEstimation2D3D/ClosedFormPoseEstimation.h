@@ -0,0 +1,136 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Closed-form solutions of the 2D-3D pose estimation problem.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_CLOSED_FORM_2D3D_POSE_ESTIMATION_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_CLOSED_FORM_2D3D_POSE_ESTIMATION_H_INCLUDED__
+
+// std
+#include <vector>
+
+// Ubitrack
+#include <utCore.h>		// EXPORT_UBITRACK
+#include <utMath/Pose.h>
+
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
+
+/**
+ * @ingroup tracking_algorithms
+ * @brief Computes all poses that map the first three \b 3D points onto their \b 2D observations,
+ * the minimal \b P3P problem.
+ *
+ * The distances of the points to the camera center follow from the law of cosines in the three
+ * triangles spanned by the camera center and two of the points. Eliminating the distances leaves
+ * a polynomial of degree four (Grunert, see "Review and analysis of solutions of the three point
+ * perspective pose estimation problem" from Haralick et al. in 1994), which has up to four real
+ * solutions. The distances of each are polished by newton steps and turned into a pose by
+ * aligning two orthonormal triads, no decompositions are needed.
+ *
+ * @attention : There is a version of this function overloaded with \c float instead of \c double parameters.
+ *
+ * @param p2D points in normalized image coordinates, only the first three are used
+ * @param poses the solutions are appended, the poses map object to camera coordinates
+ * @param p3D points in object coordinates, only the first three are used
+ * @return the number of appended solutions
+ */
+UBITRACK_EXPORT std::size_t estimatePosesP3P( const std::vector< Math::Vector2d >& p2D, std::vector< Math::Pose >& poses,
+	const std::vector< Math::Vector3d >& p3D );
+
+/// @internal overloaded function with float values
+UBITRACK_EXPORT std::size_t estimatePosesP3P( const std::vector< Math::Vector2f >& p2D, std::vector< Math::Pose >& poses,
+	const std::vector< Math::Vector3f >& p3D );
+
+/**
+ * @ingroup tracking_algorithms
+ * @brief Computes a pose from the first three correspondences with \c estimatePosesP3P and
+ * selects the solution with the smallest reprojection error of the remaining points.
+ *
+ * @attention : There is a version of this function overloaded with \c float instead of \c double parameters.
+ *
+ * @param p2D at least four points in normalized image coordinates
+ * @param pose the estimated pose
+ * @param p3D points in object coordinates
+ * @return false if there are less than four points or no solution was found
+ */
+UBITRACK_EXPORT bool estimatePoseP3P( const std::vector< Math::Vector2d >& p2D, Math::Pose& pose,
+	const std::vector< Math::Vector3d >& p3D );
+
+/// @internal overloaded function with float values
+UBITRACK_EXPORT bool estimatePoseP3P( const std::vector< Math::Vector2f >& p2D, Math::Pose& pose,
+	const std::vector< Math::Vector3f >& p3D );
+
+#ifdef HAVE_LAPACK
+
+/**
+ * @ingroup tracking_algorithms
+ * @brief Computes a pose from \b 2D-3D correspondences in time linear in the number of points,
+ * based on "EPnP: An Accurate O(n) Solution to the PnP Problem" from Lepetit et al. in 2009
+ * ( @cite lepetit2009epnp ):
+ *
+ * @verbatim
+@article{lepetit2009epnp,
+ title={EPnP: An Accurate O(n) Solution to the PnP Problem},
+ author={Lepetit, Vincent and Moreno-Noguer, Francesc and Fua, Pascal},
+ journal={International Journal of Computer Vision},
+ volume={81},
+ number={2},
+ pages={155--166},
+ year={2009},
+ publisher={Springer}
+} @endverbatim
+ *
+ * The points are expressed as weighted sums of four control points on the principal axes of the
+ * object, three for planar objects. Every observation gives two linear equations in the camera
+ * coordinates of the control points, which are accumulated into a 12x12 (9x9) normal matrix. The
+ * solution is a combination of its eigenvectors with the smallest eigenvalues, whose weights are
+ * chosen to preserve the distances between the control points and refined by a few Gauss-Newton
+ * steps. Only the accumulation depends on the number of points, all decompositions have a fixed size.
+ * Four points that are not coplanar do not determine the weights, they are solved by \c estimatePoseP3P.
+ *
+ * The result can initialize \c optimizePose directly, unlike \c estimatePose6D_2D3D it does not iterate.
+ *
+ * @attention : There is a version of this function overloaded with \c float instead of \c double parameters.
+ *
+ * @param p2D at least four points in normalized image coordinates
+ * @param pose the estimated pose, maps object to camera coordinates
+ * @param p3D points in object coordinates, not all on a line
+ * @return false if there are less than four points or the points are degenerate
+ */
+UBITRACK_EXPORT bool estimatePoseEPnP( const std::vector< Math::Vector2d >& p2D, Math::Pose& pose,
+	const std::vector< Math::Vector3d >& p3D );
+
+/// @internal overloaded function with float values
+UBITRACK_EXPORT bool estimatePoseEPnP( const std::vector< Math::Vector2f >& p2D, Math::Pose& pose,
+	const std::vector< Math::Vector3f >& p3D );
+
+#endif // HAVE_LAPACK
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation2D3D
+
+#endif //__UBITRACK_ALGORITHM_CLOSED_FORM_2D3D_POSE_ESTIMATION_H_INCLUDED__
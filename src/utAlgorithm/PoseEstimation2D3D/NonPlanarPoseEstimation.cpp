@@ -55,8 +55,8 @@
 
 
 
-#include <log4cpp/Category.hh>
-static log4cpp::Category& optLogger( log4cpp::Category::getInstance( "Ubitrack.Calibration.2D3DPoseEstimation" ) );
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger optLogger( "Ubitrack.Calibration.2D3DPoseEstimation" );
 
 
 // shortcuts to namespaces
@@ -176,9 +176,10 @@ public:
     }
 };
 
-/** @internal */
-template< typename T > 
-bool estimatePose2D3D_impl( const std::vector< Math::Vector< T, 2 > >& p2D_in, Math::Pose& p, const std::vector< Math::Vector< T, 3 > >& p3D_in,  std::size_t &max_iter, T &max_error  )
+/** @internal works on \c std::vector and \c Math::PointCloud */
+template< typename T, typename Points2D, typename Points3D >
+bool estimatePose2D3D_impl( const Points2D& p2D_in, Math::Pose& p, const Points3D& p3D_in,  std::size_t &max_iter, T &max_error
+	, const Math::Optimization::Deadline& deadline )
 {
 	assert( max_iter > 0 );
 	
@@ -187,15 +188,18 @@ bool estimatePose2D3D_impl( const std::vector< Math::Vector< T, 2 > >& p2D_in, M
 	std::vector< Math::Vector< T, 3 > > p2Dh;
 	p2Dh.reserve( p2D_in.size() );
 	// p2Dh.assign( p2D.begin(), p2D.end() ); // better: -> add the final coordinate
-	typename std::vector< Math::Vector< T, 2 > >::const_iterator it = p2D_in.begin();
-	typename std::vector< Math::Vector< T, 2 > >::const_iterator itEnd = p2D_in.end();
+	typename Points2D::const_iterator it = p2D_in.begin();
+	const typename Points2D::const_iterator itEnd = p2D_in.end();
 	for( ; it != itEnd; ++it )
-		p2Dh.push_back( Math::Vector< T, 3 >( (*it)[ 0 ], (*it)[ 1 ], 1 ) );
+	{
+		const Math::Vector< T, 2 > p2D = *it;
+		p2Dh.push_back( Math::Vector< T, 3 >( p2D[ 0 ], p2D[ 1 ], 1 ) );
+	}
 	
 	// translate the 3D object points to coordinate center
 	// this could also be done outside. In repeated usage of this algorithm here is a minimal optimization possibility
 	std::vector< Math::Vector< T, 3 > > p3D;
-	p3D.reserve( p3D.size() );
+	p3D.reserve( p3D_in.size() );
 	p3D.assign( p3D_in.begin(), p3D_in.end() );
 	Math::Vector< T, 3 > center = shiftToCenter( p3D );
 	
@@ -241,6 +245,18 @@ bool estimatePose2D3D_impl( const std::vector< Math::Vector< T, 2 > >& p2D_in, M
 		//check termination criteria 
 		// converged = ( iterations >= max_iter ) || (error_new <  max_error ) ;
 		converged = ( iterations >= max_iter ) || ( std::fabs( error_old - error_new ) <= max_error  );
+		
+		// out of time: the current estimate is the best so far
+		if( !converged && deadline.check() )
+		{
+			LOG4CPP_DEBUG( optLogger, "deadline passed after " << iterations + 1 << " iterations." );
+			center = ublas::prod( R , center );
+			Tr -= center;
+			p = Math::Pose( Math::Quaternion( R ).normalize(), Tr  );
+			error_old = error_new;
+			break;
+		}
+		
 		if( converged )
 		{
 			center = ublas::prod( R , center );
@@ -266,17 +282,51 @@ bool estimatePose2D3D_impl( const std::vector< Math::Vector< T, 2 > >& p2D_in, M
 } // anonymous-namespace
 
 bool estimatePose6D_2D3D( const std::vector< Math::Vector2d >& p2D, Math::Pose& p, 
-	const std::vector< Math::Vector3d >& p3D, std::size_t &max_iter, double &error )
+	const std::vector< Math::Vector3d >& p3D, std::size_t &max_iter, double &error,
+	const Math::Optimization::Deadline& deadline )
 {
 	LOG4CPP_DEBUG( optLogger, "starting 2D-3D pose estimate with double values." );
-	return estimatePose2D3D_impl( p2D, p, p3D, max_iter, error );
+	return estimatePose2D3D_impl( p2D, p, p3D, max_iter, error, deadline );
 }
 
 bool estimatePose6D_2D3D( const std::vector< Math::Vector2f >& p2D, Math::Pose& p, 
-	const std::vector< Math::Vector3f >& p3D, std::size_t &max_iter, float &error )
+	const std::vector< Math::Vector3f >& p3D, std::size_t &max_iter, float &error,
+	const Math::Optimization::Deadline& deadline )
 {
 	LOG4CPP_DEBUG( optLogger, "starting 2D-3D pose estimate with float values." );
-	return estimatePose2D3D_impl( p2D, p, p3D, max_iter, error );
+	return estimatePose2D3D_impl( p2D, p, p3D, max_iter, error, deadline );
+}
+
+bool estimatePose6D_2D3D( const Math::PointCloud2d& p2D, Math::Pose& p, 
+	const Math::PointCloud3d& p3D, std::size_t &max_iter, double &error,
+	const Math::Optimization::Deadline& deadline )
+{
+	LOG4CPP_DEBUG( optLogger, "starting 2D-3D pose estimate with double point clouds." );
+	return estimatePose2D3D_impl( p2D, p, p3D, max_iter, error, deadline );
+}
+
+bool estimatePose6D_2D3D( const Math::PointCloud2f& p2D, Math::Pose& p, 
+	const Math::PointCloud3f& p3D, std::size_t &max_iter, float &error,
+	const Math::Optimization::Deadline& deadline )
+{
+	LOG4CPP_DEBUG( optLogger, "starting 2D-3D pose estimate with float point clouds." );
+	return estimatePose2D3D_impl( p2D, p, p3D, max_iter, error, deadline );
+}
+
+bool estimatePose6D_2D3D( const Math::PointView2d& p2D, Math::Pose& p, 
+	const Math::PointView3d& p3D, std::size_t &max_iter, double &error,
+	const Math::Optimization::Deadline& deadline )
+{
+	LOG4CPP_DEBUG( optLogger, "starting 2D-3D pose estimate with double point views." );
+	return estimatePose2D3D_impl( p2D, p, p3D, max_iter, error, deadline );
+}
+
+bool estimatePose6D_2D3D( const Math::PointView2f& p2D, Math::Pose& p, 
+	const Math::PointView3f& p3D, std::size_t &max_iter, float &error,
+	const Math::Optimization::Deadline& deadline )
+{
+	LOG4CPP_DEBUG( optLogger, "starting 2D-3D pose estimate with float point views." );
+	return estimatePose2D3D_impl( p2D, p, p3D, max_iter, error, deadline );
 }
 
 #endif // HAVE_LAPACK
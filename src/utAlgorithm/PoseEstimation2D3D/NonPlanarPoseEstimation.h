@@ -38,6 +38,9 @@
 // Ubitrack
 #include <utCore.h>		// EXPORT_UBITRACK
 #include <utMath/Pose.h>
+#include <utMath/PointCloud.h>
+#include <utMath/PointView.h>
+#include <utMath/Optimization/Deadline.h>
 
 
 namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
@@ -83,16 +86,40 @@ namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
  * @param p3D points in object coordinates
  * @param max_iter maximum number of allowed iterations
  * @param min_error the minimum change in error allowed to converge
+ * @param deadline stops after the first iteration that ends behind the deadline, \c pose is
+ *    then set to the estimate of that iteration and \c false is returned
  * @return flag that signs if the algorithm converged due to minimal error
  */ 
 #ifdef HAVE_LAPACK
 
 UBITRACK_EXPORT bool estimatePose6D_2D3D(  const std::vector< Math::Vector2d >& p2D, Math::Pose& pose,
-	const std::vector< Math::Vector3d >& p3D, std::size_t &max_iter, double &min_error );
+	const std::vector< Math::Vector3d >& p3D, std::size_t &max_iter, double &min_error,
+	const Math::Optimization::Deadline& deadline = Math::Optimization::Deadline() );
 
 /// @internal overloaded function with float values
 UBITRACK_EXPORT bool estimatePose6D_2D3D( const std::vector< Math::Vector2f >& p2D, Math::Pose& pose,
-	const std::vector< Math::Vector3f >& p3D, std::size_t &nIterations, float &error );
+	const std::vector< Math::Vector3f >& p3D, std::size_t &nIterations, float &error,
+	const Math::Optimization::Deadline& deadline = Math::Optimization::Deadline() );
+
+/// overloaded function for points stored in \c Math::PointCloud
+UBITRACK_EXPORT bool estimatePose6D_2D3D( const Math::PointCloud2d& p2D, Math::Pose& pose,
+	const Math::PointCloud3d& p3D, std::size_t &max_iter, double &min_error,
+	const Math::Optimization::Deadline& deadline = Math::Optimization::Deadline() );
+
+/// @internal overloaded function with float point clouds
+UBITRACK_EXPORT bool estimatePose6D_2D3D( const Math::PointCloud2f& p2D, Math::Pose& pose,
+	const Math::PointCloud3f& p3D, std::size_t &nIterations, float &error,
+	const Math::Optimization::Deadline& deadline = Math::Optimization::Deadline() );
+
+/// overloaded function for points in strided buffers, e.g. of Eigen or OpenCV, which are read in place
+UBITRACK_EXPORT bool estimatePose6D_2D3D( const Math::PointView2d& p2D, Math::Pose& pose,
+	const Math::PointView3d& p3D, std::size_t &max_iter, double &min_error,
+	const Math::Optimization::Deadline& deadline = Math::Optimization::Deadline() );
+
+/// @internal overloaded function with float point views
+UBITRACK_EXPORT bool estimatePose6D_2D3D( const Math::PointView2f& p2D, Math::Pose& pose,
+	const Math::PointView3f& p3D, std::size_t &nIterations, float &error,
+	const Math::Optimization::Deadline& deadline = Math::Optimization::Deadline() );
 
 #endif // HAVE_LAPACK
 	
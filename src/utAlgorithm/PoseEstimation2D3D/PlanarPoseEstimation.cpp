@@ -39,23 +39,23 @@
 // boost
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/vector_proxy.hpp>
+#include <boost/bind.hpp>
 
 
-#ifdef HAVE_LAPACK
-#include <boost/numeric/bindings/lapack/gesvd.hpp>
-#endif
-
 // Ubitrack
 #include "../Function/MultiplePointProjection.h"
 #include "../Function/MultiplePointProjectionError.h"
 #include "../Function/MultipleCameraProjectionError.h"
 #include "../Function/ProjectivePoseNormalize.h"
+#include "ClosedFormPoseEstimation.h"
 
 #include "../Homography.h"
 #include "../Projection.h"
 
 #include <utMath/VectorFunctions.h>
 #include <utMath/MatrixOperations.h>
+#include <utMath/FixedDecomposition.h>
+#include <utMath/LapackBackend.h>
 #include <utMath/Stochastic/BackwardPropagation.h>
 
 //#define OPTIMIZATION_LOGGING
@@ -102,10 +102,11 @@ Math::Pose poseFromHomographyImpl( const Matrix< T, 3, 3 >& H, const Matrix< T,
 	//CW@2013-12-06:
 	// last change was wrong, s needs to be set to 2
 	// actually the svd looks like: R_3x2 * S_2 * Vt_2x2, although matrices are 3x3
-	ublas::matrix_range< Math::Matrix< T, 3, 3 > > Rleft( R, ublas::range( 0, 3 ), ublas::range( 0, 2 ) );
-	ublas::matrix_range< Math::Matrix< T, 3, 3 > > vt( right, ublas::range( 0, 2 ), ublas::range( 0, 2 ) );
-	boost::numeric::bindings::lapack::gesvd( 'A', 'A', Rleft, s, u, vt );
+	const Math::Matrix< T, 3, 2 > Rleft( ublas::subrange( R, 0, 3, 0, 2 ) );
+	Math::Matrix< T, 2, 2 > vt;
+	Math::svd( Rleft, s, u, vt );
 	
+	ublas::subrange( right, 0, 2, 0, 2 ) = vt;
 	right( 0, 2 ) = right( 1, 2 ) = 0;
 	right( 2, 0 ) = right( 2, 1 ) = 0;
 	right( 2, 2 ) = Math::determinant( vt ) * Math::determinant( u ); // should be -1 or +1
@@ -146,23 +147,24 @@ Math::Pose poseFromHomography( const Math::Matrix< double, 3, 3 >& H, const Math
 #ifdef HAVE_LAPACK
 
 /** \internal */	
-template< typename T > 
-T optimizePoseImpl( Pose& p, const std::vector< Vector< T, 2 > >& p2D, const std::vector< Vector< T, 3 > >& p3D, 
-	const Matrix< T, 3, 3 >& cam, const std::size_t nIterations  )
+template< typename T, class TC > 
+T optimizePoseImpl( Pose& p, Math::Vector< T >& measurements, const std::vector< Vector< T, 2 > >& p2D, 
+	const std::vector< Vector< T, 3 > >& p3D, const Matrix< T, 3, 3 >& cam, const TC& terminate )
 {
 	// copy rot & trans to parameter vector
 	Vector< T, 7 > params;
 	p.toVector( params );
 
 	// copy 2D points to measurement vector
-	Math::Vector< T >  measurements( 2 * p2D.size() );
+	measurements.resize( 2 * p2D.size(), false );
 	for ( std::size_t i( 0 ); i < p2D.size(); i++ )
 		ublas::subrange( measurements, 2*i, (i+1)*2 ) = p2D[ i ];
 
-	// perform optimization
+	// perform optimization, the problem is too small for lapack threads
 	Function::MultiplePointProjection< T > projection( p3D, cam );
+	Math::LapackScope lapackScope( 1, "Ubitrack.Algorithm.optimizePose" );
 	T fRes = Optimization::levenbergMarquardt( projection, params, measurements, 
-		Optimization::OptTerminate( nIterations, 1e-6 ), Function::ProjectivePoseNormalize() );
+		terminate, Function::ProjectivePoseNormalize() );
 
 	// copy back rot & trans from vector
 	p = Pose::fromVector( params );
@@ -170,6 +172,15 @@ T optimizePoseImpl( Pose& p, const std::vector< Vector< T, 2 > >& p2D, const std
 	return fRes;
 }
 
+/** \internal */	
+template< typename T > 
+T optimizePoseImpl( Pose& p, const std::vector< Vector< T, 2 > >& p2D, const std::vector< Vector< T, 3 > >& p3D, 
+	const Matrix< T, 3, 3 >& cam, const std::size_t nIterations  )
+{
+	Math::Vector< T > measurements;
+	return optimizePoseImpl( p, measurements, p2D, p3D, cam, Optimization::OptTerminate( nIterations, 1e-6 ) );
+}
+
 float optimizePose( Math::Pose& p, const std::vector< Math::Vector< float, 2 > >& p2D, 
 	const std::vector< Math::Vector< float, 3 > >& p3D, const Math::Matrix< float, 3, 3 >& cam,
 	const std::size_t nIterations )
@@ -185,6 +196,117 @@ double optimizePose( Math::Pose& p, const std::vector< Math::Vector< double, 2 >
 }
 
 
+/** \internal optimizes the problems [ begin, end ) of a batch, reusing the measurement vector */
+template< typename T >
+void optimizePoseRange( Pose* poses, const std::vector< Vector< T, 2 > >* p2D, const std::vector< Vector< T, 3 > >* p3D, 
+	const Matrix< T, 3, 3 >* cam, const std::size_t nIterations, PoseOptimizationResult* results, 
+	const std::size_t begin, const std::size_t end )
+{
+	Math::Vector< T > measurements;
+	for ( std::size_t i = begin; i < end; i++ )
+	{
+		PoseOptimizationResult& result( results[ i ] );
+		result.residual = 0;
+		result.iterations = 0;
+		result.converged = false;
+		if ( p2D[ i ].empty() )
+			continue;
+
+		Optimization::OptTerminateRecord terminate( nIterations, 1e-6 );
+		result.residual = optimizePoseImpl( poses[ i ], measurements, p2D[ i ], p3D[ i ], *cam, terminate );
+		result.iterations = terminate.iterations();
+		result.converged = terminate.converged();
+	}
+}
+
+/** \internal */
+template< typename T >
+void optimizePosesImpl( std::vector< Pose >& poses, const std::vector< std::vector< Vector< T, 2 > > >& p2D, 
+	const std::vector< std::vector< Vector< T, 3 > > >& p3D, const Matrix< T, 3, 3 >& cam, 
+	std::vector< PoseOptimizationResult >& results, const std::size_t nIterations, const Math::ListExecutor& executor )
+{
+	if ( p2D.size() != poses.size() || p3D.size() != poses.size() )
+		UBITRACK_THROW( "Batch pose optimization requires point lists for each pose" );
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+		if ( p2D[ i ].size() != p3D[ i ].size() )
+			UBITRACK_THROW( "Batch pose optimization requires the same number of 2D and 3D points per pose" );
+
+	results.resize( poses.size() );
+	if ( poses.empty() )
+		return;
+
+	const boost::function< void ( std::size_t, std::size_t ) > task( boost::bind( &optimizePoseRange< T >, 
+		&poses[ 0 ], &p2D[ 0 ], &p3D[ 0 ], &cam, nIterations, &results[ 0 ], _1, _2 ) );
+	if ( executor.empty() )
+		task( 0, poses.size() );
+	else
+		executor( poses.size(), task );
+}
+
+void optimizePoses( std::vector< Math::Pose >& poses, const std::vector< std::vector< Math::Vector< float, 2 > > >& p2D,
+	const std::vector< std::vector< Math::Vector< float, 3 > > >& p3D, const Math::Matrix< float, 3, 3 >& cam,
+	std::vector< PoseOptimizationResult >& results, const std::size_t nIterations, const Math::ListExecutor& executor )
+{
+	optimizePosesImpl( poses, p2D, p3D, cam, results, nIterations, executor );
+}
+
+void optimizePoses( std::vector< Math::Pose >& poses, const std::vector< std::vector< Math::Vector< double, 2 > > >& p2D,
+	const std::vector< std::vector< Math::Vector< double, 3 > > >& p3D, const Math::Matrix< double, 3, 3 >& cam,
+	std::vector< PoseOptimizationResult >& results, const std::size_t nIterations, const Math::ListExecutor& executor )
+{
+	optimizePosesImpl( poses, p2D, p3D, cam, results, nIterations, executor );
+}
+
+
+/**
+ * \internal
+ * Computes the pose covariance <tt>s * ( J^T * J )^-1</tt> from the normal matrix, which the projection
+ * function accumulates point by point, so the 2N x 6 jacobian is never stored. Like the backward
+ * propagation, the columns are equilibrated before the Cholesky decomposition, and the SVD based 
+ * pseudo-inverse of the full jacobian is used if the normal matrix is close to singular.
+ */
+template< typename T, class F >
+Matrix< T, 6, 6 > poseCovarianceFromNormalMatrix( const F& projection, const Vector< T, 7 >& params, T imageError )
+{
+	// smallest pivot of the equilibrated Cholesky factor, as in Stochastic::backwardPropagation
+	const double minPivot = 1e-4;
+
+	Matrix< double, 6, 6 > normal( Matrix< double, 6, 6 >::zeros() );
+	projection.addNormalMatrix( params, normal );
+
+	Vector< double, 6 > scale;
+	bool bFactorized = true;
+	for ( std::size_t i = 0; i < 6 && bFactorized; i++ )
+		if ( normal( i, i ) > 0 )
+			scale( i ) = 1.0 / std::sqrt( normal( i, i ) );
+		else
+			bFactorized = false;
+
+	Matrix< double, 6, 6 > factor;
+	if ( bFactorized )
+	{
+		for ( std::size_t r = 0; r < 6; r++ )
+			for ( std::size_t c = 0; c <= r; c++ )
+				normal( r, c ) *= scale( r ) * scale( c );
+		bFactorized = Math::cholesky( normal, factor );
+		for ( std::size_t i = 0; i < 6 && bFactorized; i++ )
+			bFactorized = factor( i, i ) >= minPivot;
+	}
+
+	Matrix< T, 6, 6 > result;
+	if ( !bFactorized || !Math::choleskyInvert( normal ) )
+	{
+		Stochastic::backwardPropagationIdentity( result, imageError, projection, params );
+		return result;
+	}
+
+	for ( std::size_t r = 0; r < 6; r++ )
+		for ( std::size_t c = 0; c < 6; c++ )
+			result( r, c ) = T( normal( r, c ) * scale( r ) * scale( c ) * imageError );
+	return result;
+}
+
+
 /** \internal */
 template< typename T >
 Matrix< T, 6, 6 > singleCameraPoseErrorImpl( const Pose& p, const std::vector< Vector< T, 3 > >& p3D, 
@@ -194,13 +316,8 @@ Matrix< T, 6, 6 > singleCameraPoseErrorImpl( const Pose& p, const std::vector< V
 	Vector< T, 7 > params;
 	p.toVector( params );
 
-	// calculate error
-	Matrix< T, 6, 6 > result;
 	Function::MultiplePointProjectionError< T > projection( p3D, cam );
-
-	Stochastic::backwardPropagationIdentity( result, imageError, projection, params );
-	
-	return result;
+	return poseCovarianceFromNormalMatrix< T >( projection, params, imageError );
 }
 
 Matrix< float, 6, 6 > singleCameraPoseError( const Math::Pose& p, const std::vector< Math::Vector< float, 3 > >& p3D, 
@@ -228,13 +345,8 @@ Math::Matrix< T, 6, 6 > multipleCameraPoseErrorImpl( const Math::Pose& p,
 	Vector< T, 7 > params;
 	p.toVector( params );
 
-	// calculate error
-	Matrix< T, 6, 6 > result;
 	Function::MultipleCameraProjectionError< T > projection( p3D, cameras, observations );
-
-	Stochastic::backwardPropagationIdentity( result, imageError, projection, params );
-	
-	return result;
+	return poseCovarianceFromNormalMatrix< T >( projection, params, imageError );
 }
 	
 Math::Matrix< float, 6, 6 > multipleCameraPoseError( const Math::Pose& p, 
@@ -316,12 +428,10 @@ Math::ErrorPose computePose(
 	return computePose( p2d, p3d, cam, dummy, optimize, initMethod );
 }
 
-Math::ErrorPose computePose( 
+Math::Pose initializePose( 
 		const std::vector< Math::Vector< double, 2 > >& p2d,
 		const std::vector< Math::Vector< double, 3 > >& p3d,
 		const Math::Matrix< double, 3, 3 >& cam,
-		double& residual,
-		bool optimize,
 		enum InitializationMethod initMethod
 	)
 {
@@ -341,6 +451,41 @@ Math::ErrorPose computePose(
 
 	bool bInitialized = false;
 	
+	if ( initMethod == EPNP || initMethod == P3P )
+	{
+		// closed-form solutions work in normalized image coordinates of a camera looking along +z.
+		// In the ubitrack convention ( cam( 2, 2 ) < 0 ) the camera looks along -z, so the
+		// solutions are computed for the camera rotated by 180 degrees about its x-axis.
+		const bool bNegativeZ = cam( 2, 2 ) < 0;
+		std::vector< Math::Vector< double, 2 > > p2dNormalized;
+		p2dNormalized.reserve( n_points );
+		for ( std::size_t i( 0 ); i < n_points; ++i )
+		{
+			const Math::Vector< double, 3 > x( ublas::prod( invK, Math::Vector< double, 3 >( p2d[ i ]( 0 ), p2d[ i ]( 1 ), 1.0 ) ) );
+			p2dNormalized.push_back( Math::Vector< double, 2 >( ( bNegativeZ ? -x( 0 ) : x( 0 ) ) / x( 2 ), x( 1 ) / x( 2 ) ) );
+		}
+
+		if ( initMethod == EPNP )
+			bInitialized = Algorithm::PoseEstimation2D3D::estimatePoseEPnP( p2dNormalized, pose, p3d );
+		else
+			bInitialized = Algorithm::PoseEstimation2D3D::estimatePoseP3P( p2dNormalized, pose, p3d );
+
+		if ( bInitialized && bNegativeZ )
+		{
+			const Math::Vector< double, 3 > t( pose.translation() );
+			pose = Math::Pose( Math::Quaternion( 1, 0, 0, 0 ) * pose.rotation(), Math::Vector< double, 3 >( t( 0 ), -t( 1 ), -t( 2 ) ) );
+		}
+
+		if ( bInitialized )
+		{
+			OPT_LOG_TRACE( "Pose from closed-form solution: " << pose );
+		}
+		else
+		{
+			OPT_LOG_DEBUG( "Closed-form pose estimation failed, falling back to homography" );
+		}
+	}
+	
 	if ( initMethod == NONPLANAR_PROJECTION && n_points >= 6 )
 	{
 		// initialize from 3x4 projection matrix
@@ -368,7 +513,7 @@ Math::ErrorPose computePose(
 		if ( Math::determinant( R ) < 0 )
 			Rt *= -1;
 
-		boost::numeric::bindings::lapack::gesvd( 'A', 'A', R, s, u, vt );
+		Math::svd( Math::Matrix< double, 3, 3 >( R ), s, u, vt );
 		OPT_LOG_TRACE( "s: " << s );
 		OPT_LOG_TRACE( "U: " << std::endl << u );
 		OPT_LOG_TRACE( "V^T: " << std::endl << vt );
@@ -492,6 +637,21 @@ Math::ErrorPose computePose(
 		}
 	}
 	
+	return pose;
+}
+
+Math::ErrorPose computePose( 
+		const std::vector< Math::Vector< double, 2 > >& p2d,
+		const std::vector< Math::Vector< double, 3 > >& p3d,
+		const Math::Matrix< double, 3, 3 >& cam,
+		double& residual,
+		bool optimize,
+		enum InitializationMethod initMethod
+	)
+{
+	const std::size_t n_points( p2d.size() );
+	Math::Pose pose( initializePose( p2d, p3d, cam, initMethod ) );
+
 	// non-linear minimization
 	Math::Matrix< double, 6, 6 > covMatrix;
 	if ( optimize )
@@ -511,6 +671,20 @@ Math::ErrorPose computePose(
 	return Math::ErrorPose( pose, covMatrix );
 }
 
+Math::ErrorPose computePose( 
+		const Math::PointView2d& p2d,
+		const Math::PointView3d& p3d,
+		const Math::Matrix< double, 3, 3 >& cam,
+		double& residual,
+		bool optimize,
+		enum InitializationMethod initMethod
+	)
+{
+	const std::vector< Math::Vector< double, 2 > > points2d( p2d.begin(), p2d.end() );
+	const std::vector< Math::Vector< double, 3 > > points3d( p3d.begin(), p3d.end() );
+	return computePose( points2d, points3d, cam, residual, optimize, initMethod );
+}
+
 #endif // HAVE_LAPACK
 
 } } } // namespace Ubitrack::Algorithm::PoseEstimation2D3D
@@ -39,6 +39,8 @@
 #include <utMath/Matrix.h>
 #include <utMath/Pose.h>
 #include <utMath/ErrorPose.h>
+#include <utMath/PointView.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
 
 
 namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
@@ -78,11 +80,60 @@ UBITRACK_EXPORT double optimizePose( Math::Pose& p, const std::vector< Math::Vec
 	const std::vector< Math::Vector< double, 3 > >& p3D, const Math::Matrix< double, 3, 3 >& cam,
 	const std::size_t nIterations = 6 );
 
+
+/** result of a single problem of \c optimizePoses */
+struct PoseOptimizationResult
+{
+	/** residual of the optimization */
+	double residual;
+
+	/** number of levenberg-marquardt iterations performed */
+	std::size_t iterations;
+
+	/** true if the residual converged before the iteration limit was reached */
+	bool converged;
+};
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Optimizes a batch of independent poses, e.g. of all rigid bodies seen by a camera in one frame,
+ * as \c optimizePose does for each of them. The problems can be distributed over several threads
+ * by passing a \c Math::ListExecutor, as the problems are small, use a small chunk size:
+ * @code
+ * const Math::ListExecutor executor( Math::threadExecutor( 0, 8 ) );
+ * optimizePoses( poses, p2D, p3D, cam, results, 6, executor );
+ * @endcode
+ * Problems without points are left unchanged.
+ * Note: Also exists with \c double parameters.
+ *
+ * @param poses the initial poses on entry, the optimized poses on exit
+ * @param p2D for each pose the points in image coordinates
+ * @param p3D for each pose the points in object coordinates
+ * @param cam camera intrinsics matrix
+ * @param results resized to the number of poses and filled with the residual and convergence of each problem
+ * @param nIterations maximum number of levenberg-marquardt iterations per problem
+ * @param executor runs the problems, the default runs all of them in the calling thread
+ */
+UBITRACK_EXPORT void optimizePoses( std::vector< Math::Pose >& poses,
+	const std::vector< std::vector< Math::Vector< float, 2 > > >& p2D,
+	const std::vector< std::vector< Math::Vector< float, 3 > > >& p3D, const Math::Matrix< float, 3, 3 >& cam,
+	std::vector< PoseOptimizationResult >& results, const std::size_t nIterations = 6,
+	const Math::ListExecutor& executor = Math::ListExecutor() );
+
+UBITRACK_EXPORT void optimizePoses( std::vector< Math::Pose >& poses,
+	const std::vector< std::vector< Math::Vector< double, 2 > > >& p2D,
+	const std::vector< std::vector< Math::Vector< double, 3 > > >& p3D, const Math::Matrix< double, 3, 3 >& cam,
+	std::vector< PoseOptimizationResult >& results, const std::size_t nIterations = 6,
+	const Math::ListExecutor& executor = Math::ListExecutor() );
+
 	
 /**
  * @ingroup tracking_algorithms
  * Computes the covariance of a pose created from observations of known 3D points by a single camera.
  * For an explanation of the covariance matrix, see \c ErrorPose.
+ * The 6x6 information matrix is accumulated point by point and inverted by a fixed-size Cholesky
+ * decomposition, so the full jacobian is never stored.
  * Note: Also exists with \c double parameters.
  *
  * @param p the already computed pose whose error is to be estimated (extrinsic camera parameters)
@@ -101,6 +152,7 @@ UBITRACK_EXPORT Math::Matrix< double, 6, 6 > singleCameraPoseError( const Math::
  * Computes the covariance of a pose created from observations of known 3D points by a multiple cameras, 
  * e.g. the ART DTrack tracking system.
  * For an explanation of the covariance matrix, see \c ErrorPose.
+ * Like \c singleCameraPoseError, the information matrix is accumulated per observation.
  * Note: Also exists with \c double parameters.
  *
  * @param p the already computed pose whose error is to be estimated
@@ -127,13 +179,34 @@ UBITRACK_EXPORT Math::Matrix< double, 6, 6 > multipleCameraPoseError( const Math
 /**
  * Initialization type needed for computePose() method.
  * Use \c NONPLANAR_PROJECTION only in case you are sure that points are not coplanar.
+ * \c EPNP (see \c estimatePoseEPnP) works for planar and non-planar points without a DLT,
+ * \c P3P (see \c estimatePoseP3P) uses only the first four points and is the fastest.
+ * Both fall back to \c PLANAR_HOMOGRAPHY if they fail.
  */
 UBITRACK_EXPORT typedef enum InitializationMethod {
 	PLANAR_HOMOGRAPHY,
-	NONPLANAR_PROJECTION
+	NONPLANAR_PROJECTION,
+	EPNP,
+	P3P
 } InitializationMethod_t;
 
 
+/**
+ * @ingroup tracking_algorithms
+ * Computes the initial pose of \c computePose, which is refined by the non-linear optimization.
+ * Throws if less than 4 points are given or the first three points of a planar target are collinear.
+ * @param p2D points in image coordinates
+ * @param p3D points in object coordinates
+ * @param cam camera intrinsics matrix
+ * @param initMethod Method used for initialization
+ */
+UBITRACK_EXPORT Math::Pose initializePose( 
+		const std::vector< Math::Vector< double, 2 > >& p2d,
+		const std::vector< Math::Vector< double, 3 > >& p3d,
+		const Math::Matrix< double, 3, 3 >& cam,
+		enum InitializationMethod initMethod = (enum InitializationMethod)PLANAR_HOMOGRAPHY
+	);
+
 /**
  * @ingroup tracking_algorithms
  * Computes a pose given 2D-3D point correspondences
@@ -167,6 +240,26 @@ UBITRACK_EXPORT Math::ErrorPose computePose(
 		bool optimize = true,
 		enum InitializationMethod initMethod = (enum InitializationMethod)PLANAR_HOMOGRAPHY		
 	);
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes a pose given 2D-3D point correspondences in strided buffers, e.g. of Eigen or OpenCV.
+ * See \c Math::PointView. The initializations and the optimization work on lists of vectors,
+ * so the points are gathered into them once, without intermediate copies by the caller.
+ * @param p2D points in image coordinates
+ * @param p3D points in object coordinates
+ * @param cam camera intrinsics matrix
+ * @param residual reprojection error im image coordinates
+ * @param initMethod Method used for initialization of the non-linear optimization
+ */
+UBITRACK_EXPORT Math::ErrorPose computePose( 
+		const Math::PointView2d& p2d,
+		const Math::PointView3d& p3d,
+		const Math::Matrix< double, 3, 3 >& cam,
+		double& residual,
+		bool optimize = true,
+		enum InitializationMethod initMethod = (enum InitializationMethod)PLANAR_HOMOGRAPHY		
+	);
 	
 #endif // HAVE_LAPACK
 	
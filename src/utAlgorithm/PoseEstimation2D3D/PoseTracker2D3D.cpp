@@ -0,0 +1,124 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implementation of the frame-to-frame 2D-3D pose tracker.
+ */
+
+#include "PoseTracker2D3D.h"
+
+#ifdef HAVE_LAPACK
+
+#include <cmath>
+
+// boost
+#include <boost/numeric/ublas/vector_proxy.hpp>
+
+#include <utUtil/Exception.h>
+#include "../Function/MultiplePointProjection.h"
+#include "../Function/ProjectivePoseNormalize.h"
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Algorithm.PoseTracker2D3D" );
+
+namespace ublas = boost::numeric::ublas;
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
+
+PoseTracker2D3D::PoseTracker2D3D( const Math::Matrix< double, 3, 3 >& cam, double maxError, std::size_t nIterations,
+	enum InitializationMethod initMethod )
+	: m_cam( cam )
+	, m_maxError( maxError )
+	, m_nIterations( nIterations )
+	, m_initMethod( initMethod )
+	, m_bTracking( false )
+	, m_bInitialized( false )
+	, m_sqError( 0 )
+	, m_rmsError( 0 )
+	, m_bCovarianceValid( false )
+{
+}
+
+
+bool PoseTracker2D3D::track( const std::vector< Math::Vector< double, 2 > >& p2D, const std::vector< Math::Vector< double, 3 > >& p3D )
+{
+	if ( p2D.size() != p3D.size() )
+		UBITRACK_THROW( "2D3D pose tracking requires the same number of 2D and 3D points" );
+
+	const double nMeasurements = static_cast< double >( 2 * p2D.size() );
+	m_bCovarianceValid = false;
+	m_bInitialized = false;
+	m_p3D.assign( p3D.begin(), p3D.end() );
+
+	// warm start at the previous pose, needs at least as many measurements as parameters
+	if ( m_bTracking && p2D.size() >= 4 )
+	{
+		m_sqError = refine( p2D, p3D );
+		m_rmsError = std::sqrt( m_sqError / nMeasurements );
+		if ( m_rmsError <= m_maxError )
+			return true;
+		LOG4CPP_DEBUG( logger, "Lost track with a reprojection error of " << m_rmsError << ", reinitializing" );
+	}
+
+	m_bInitialized = true;
+	m_pose = initializePose( p2D, p3D, m_cam, m_initMethod );
+	m_sqError = refine( p2D, p3D );
+	m_rmsError = std::sqrt( m_sqError / nMeasurements );
+	m_bTracking = m_rmsError <= m_maxError;
+	return m_bTracking;
+}
+
+
+double PoseTracker2D3D::refine( const std::vector< Math::Vector< double, 2 > >& p2D, const std::vector< Math::Vector< double, 3 > >& p3D )
+{
+	Math::Vector< double, 7 > params;
+	m_pose.toVector( params );
+
+	m_measurements.resize( 2 * p2D.size(), false );
+	for ( std::size_t i( 0 ); i < p2D.size(); i++ )
+		ublas::subrange( m_measurements, 2 * i, 2 * i + 2 ) = p2D[ i ];
+
+	Function::MultiplePointProjection< double > projection( p3D, m_cam );
+	const double fRes = Math::Optimization::levenbergMarquardt( m_workspace, projection, params, m_measurements,
+		Math::Optimization::OptTerminate( m_nIterations, 1e-6 ), Function::ProjectivePoseNormalize() );
+
+	m_pose = Math::Pose::fromVector( params );
+	return fRes;
+}
+
+
+Math::ErrorPose PoseTracker2D3D::errorPose() const
+{
+	if ( !m_bCovarianceValid )
+	{
+		m_covariance = singleCameraPoseError( m_pose, m_p3D, m_cam, m_sqError );
+		m_bCovarianceValid = true;
+	}
+	return Math::ErrorPose( m_pose, m_covariance );
+}
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation2D3D
+
+#endif // HAVE_LAPACK
@@ -0,0 +1,159 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Frame-to-frame 2D-3D pose tracking.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_2D3D_POSE_TRACKER_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_2D3D_POSE_TRACKER_H_INCLUDED__
+
+#ifdef HAVE_LAPACK
+
+// std
+#include <vector>
+
+#include <utCore.h>		// EXPORT_UBITRACK
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+#include <utMath/ErrorPose.h>
+#include <utMath/Optimization/LevenbergMarquardt.h>
+#include "PlanarPoseEstimation.h"
+
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
+
+/**
+ * @ingroup tracking_algorithms
+ * Tracks the pose of a target over a sequence of frames from 2D-3D point correspondences.
+ *
+ * \c computePose initializes every frame from scratch. The tracker instead starts the
+ * levenberg-marquardt refinement at the pose of the previous frame and keeps the buffers of the
+ * optimizer between frames, so a frame with the same number of points does not allocate memory.
+ * Only if there is no previous pose or the refined pose has a larger reprojection error than
+ * \c maxError, the frame is initialized like in \c computePose. The covariance is computed when
+ * \c errorPose is called for the first time after a frame.
+ *
+ * @code
+ * PoseTracker2D3D tracker( cam );
+ * for each frame:
+ *   if ( tracker.track( p2D, p3D ) )
+ *     send( tracker.pose() );
+ * @endcode
+ */
+class UBITRACK_EXPORT PoseTracker2D3D
+{
+public:
+	/**
+	 * Constructor.
+	 * @param cam camera intrinsics matrix
+	 * @param maxError maximum root mean square reprojection error in pixels of a tracked pose
+	 * @param nIterations maximum number of levenberg-marquardt iterations per frame
+	 * @param initMethod initialization of frames without a valid previous pose, see \c computePose
+	 */
+	PoseTracker2D3D( const Math::Matrix< double, 3, 3 >& cam, double maxError = 2.0, std::size_t nIterations = 6,
+		enum InitializationMethod initMethod = (enum InitializationMethod)PLANAR_HOMOGRAPHY );
+
+	/**
+	 * Computes the pose of a new frame.
+	 * Throws if a frame has to be initialized from less than 4 points.
+	 * @param p2D points in image coordinates
+	 * @param p3D points in object coordinates
+	 * @return true if the reprojection error of the pose is below \c maxError. Otherwise the next
+	 *   frame is initialized again.
+	 */
+	bool track( const std::vector< Math::Vector< double, 2 > >& p2D, const std::vector< Math::Vector< double, 3 > >& p3D );
+
+	/** forgets the previous pose, the next frame is initialized */
+	void reset()
+	{ m_bTracking = false; }
+
+	/** returns true if the next frame starts at the previous pose */
+	bool isTracking() const
+	{ return m_bTracking; }
+
+	/** returns true if the last frame was initialized instead of tracked */
+	bool wasInitialized() const
+	{ return m_bInitialized; }
+
+	/** returns the pose of the last frame */
+	const Math::Pose& pose() const
+	{ return m_pose; }
+
+	/** returns the root mean square reprojection error of the last frame in pixels */
+	double residual() const
+	{ return m_rmsError; }
+
+	/** returns the pose of the last frame with its covariance, see \c singleCameraPoseError */
+	Math::ErrorPose errorPose() const;
+
+	/** changes the camera intrinsics, e.g. when the zoom changes */
+	void setCamera( const Math::Matrix< double, 3, 3 >& cam )
+	{ m_cam = cam; m_bCovarianceValid = false; }
+
+protected:
+	/** refines \c m_pose, returns the sum of squared reprojection errors */
+	double refine( const std::vector< Math::Vector< double, 2 > >& p2D, const std::vector< Math::Vector< double, 3 > >& p3D );
+
+	/** camera intrinsics */
+	Math::Matrix< double, 3, 3 > m_cam;
+
+	/** maximum rms reprojection error of a tracked pose */
+	double m_maxError;
+
+	/** maximum number of iterations per frame */
+	std::size_t m_nIterations;
+
+	/** initialization method */
+	enum InitializationMethod m_initMethod;
+
+	/** pose of the last frame */
+	Math::Pose m_pose;
+
+	/** is \c m_pose a valid starting point for the next frame? */
+	bool m_bTracking;
+
+	/** was the last frame initialized? */
+	bool m_bInitialized;
+
+	/** sum of squared and rms reprojection error of the last frame */
+	double m_sqError;
+	double m_rmsError;
+
+	/** buffers of the optimizer, kept between frames, the jacobian is filled row by row */
+	Math::Optimization::LevenbergMarquardtWorkspace< double, boost::numeric::ublas::row_major > m_workspace;
+	Math::Vector< double > m_measurements;
+
+	/** object points of the last frame and the covariance computed from them on demand */
+	std::vector< Math::Vector< double, 3 > > m_p3D;
+	mutable Math::Matrix< double, 6, 6 > m_covariance;
+	mutable bool m_bCovarianceValid;
+};
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation2D3D
+
+#endif // HAVE_LAPACK
+
+#endif // __UBITRACK_ALGORITHM_2D3D_POSE_TRACKER_H_INCLUDED__
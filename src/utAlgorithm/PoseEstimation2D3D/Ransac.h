@@ -0,0 +1,131 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Functions for ransac 2D-3D pose estimation.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_2D3D_POSE_ESTIMATION_RANSAC_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_2D3D_POSE_ESTIMATION_RANSAC_H_INCLUDED__
+
+#include "ClosedFormPoseEstimation.h"
+#include <utCore.h>
+#include <utMath/Optimization/Ransac.h>
+
+#include <limits>
+
+#ifdef HAVE_LAPACK
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
+
+/**
+ * @internal function object that provides estimation and evaluation
+ * functions for a ransac 2D-3D pose estimation.
+ */
+template< typename T >
+struct Ransac
+{
+public:
+
+	typedef T value_type;
+
+	/**
+	 * @internal computes a pose from 2D points in normalized image coordinates and their 3D points:
+	 * minimal sets of four points by P3P, where the fourth point selects the solution, larger
+	 * sets, e.g. all inlier of the final solution, by EPnP.
+	 */
+	struct Estimator
+	{
+		public:
+
+		template< typename InputIterator1, typename InputIterator2, typename ResultType >
+		bool operator()( ResultType& resultPose, const InputIterator1 iBegin1, const InputIterator1 iEnd1, const InputIterator2 iBegin2, const InputIterator2 iEnd2 ) const
+		{
+			const std::vector< Math::Vector< T, 2 > > p2D( iBegin1, iEnd1 );
+			const std::vector< Math::Vector< T, 3 > > p3D( iBegin2, iEnd2 );
+			if ( p2D.size() < 6 )
+				return estimatePoseP3P( p2D, resultPose, p3D );
+			return estimatePoseEPnP( p2D, resultPose, p3D );
+		}
+	};
+
+	/**
+	 * @internal computes the reprojection error of a 3D point in normalized image coordinates
+	 */
+	struct Evaluator
+	{
+		public:
+
+		template< typename PoseType, typename Vector2Type, typename Vector3Type >
+		T operator()( const PoseType &pose, const Vector2Type &vec2, const Vector3Type &vec3 ) const
+		{
+			const Math::Vector< double, 3 > p( pose * Math::Vector< double, 3 >( vec3( 0 ), vec3( 1 ), vec3( 2 ) ) );
+			if ( p( 2 ) <= 0 )
+				return std::numeric_limits< T >::max();
+			const T dx = static_cast< T >( p( 0 ) / p( 2 ) ) - vec2( 0 );
+			const T dy = static_cast< T >( p( 1 ) / p( 2 ) ) - vec2( 1 );
+			return std::sqrt( dx * dx + dy * dy );
+		}
+	};
+};
+
+/**
+ * @ingroup tracking_algorithms
+ * Robust 2D-3D pose estimation, hypotheses of four correspondences are computed by P3P and the
+ * inlier of the best one are refined by EPnP. Use a \c setSize of 4 and a threshold in normalized
+ * image coordinates, i.e. the pixel threshold divided by the focal length.
+ * Note: Also exists with \c float parameters.
+ *
+ * @param p2D points in normalized image coordinates
+ * @param pose the estimated pose, maps object to camera coordinates
+ * @param p3D points in object coordinates
+ * @param params ransac parameters
+ * @return true if enough inlier were found
+ */
+template< typename T, typename InputIterator1, typename InputIterator2, typename ResultType >
+bool estimatePose6D_2D3D ( const InputIterator1 itBegin1, const InputIterator1 itEnd1
+		, ResultType& pose
+		, const InputIterator2 itBegin2, const InputIterator2 itEnd2
+		, const Math::Optimization::RansacParameter< T >& params )
+{
+	const std::size_t inlier = Math::Optimization::ransac( itBegin1, itEnd1, itBegin2, itEnd2, pose, PoseEstimation2D3D::Ransac< T >(), params  );
+	return ( inlier > 0 );
+}
+
+UBITRACK_EXPORT bool estimatePose6D_2D3D( const std::vector< Math::Vector2f >& p2D
+	, Math::Pose& pose
+	, const std::vector< Math::Vector3f >& p3D
+	, const Math::Optimization::RansacParameter< float >& params );
+
+UBITRACK_EXPORT bool estimatePose6D_2D3D( const std::vector< Math::Vector2d >& p2D
+	, Math::Pose& pose
+	, const std::vector< Math::Vector3d >& p3D
+	, const Math::Optimization::RansacParameter< double >& params );
+
+}}} // namespace Ubitrack::Algorithm::PoseEstimation2D3D
+
+#endif // HAVE_LAPACK
+
+#endif //__UBITRACK_ALGORITHM_2D3D_POSE_ESTIMATION_RANSAC_H_INCLUDED__
@@ -0,0 +1,354 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Pose estimation of square markers from their four corners.
+ */
+
+#include "SquareMarkerPose.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <utMath/FixedDecomposition.h>
+#include <utUtil/Exception.h>
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
+
+namespace {
+
+/** the corners of the unit square in the order of \c squareHomography */
+const double g_square[ 4 ][ 2 ] = { { -0.5, 0.5 }, { -0.5, -0.5 }, { 0.5, -0.5 }, { 0.5, 0.5 } };
+
+/**
+ * homography that maps the unit square onto the four corners, in closed form, see
+ * P. Heckbert, "Fundamentals of Texture Mapping and Image Warping", 1989.
+ * Returns false if three corners are collinear.
+ */
+bool squareToQuad( const Math::Vector< double, 2 >* c, double h[ 3 ][ 3 ] )
+{
+	// mapping of ( 0, 0 ), ( 1, 0 ), ( 1, 1 ), ( 0, 1 ) onto the corners
+	const double sx = c[ 0 ]( 0 ) - c[ 1 ]( 0 ) + c[ 2 ]( 0 ) - c[ 3 ]( 0 );
+	const double sy = c[ 0 ]( 1 ) - c[ 1 ]( 1 ) + c[ 2 ]( 1 ) - c[ 3 ]( 1 );
+	const double dx1 = c[ 1 ]( 0 ) - c[ 2 ]( 0 );
+	const double dx2 = c[ 3 ]( 0 ) - c[ 2 ]( 0 );
+	const double dy1 = c[ 1 ]( 1 ) - c[ 2 ]( 1 );
+	const double dy2 = c[ 3 ]( 1 ) - c[ 2 ]( 1 );
+	const double den = dx1 * dy2 - dx2 * dy1;
+	if ( den == 0 )
+		return false;
+
+	const double g = ( sx * dy2 - dx2 * sy ) / den;
+	const double k = ( dx1 * sy - sx * dy1 ) / den;
+	const double m[ 3 ][ 3 ] = {
+		{ c[ 1 ]( 0 ) - c[ 0 ]( 0 ) + g * c[ 1 ]( 0 ), c[ 3 ]( 0 ) - c[ 0 ]( 0 ) + k * c[ 3 ]( 0 ), c[ 0 ]( 0 ) },
+		{ c[ 1 ]( 1 ) - c[ 0 ]( 1 ) + g * c[ 1 ]( 1 ), c[ 3 ]( 1 ) - c[ 0 ]( 1 ) + k * c[ 3 ]( 1 ), c[ 0 ]( 1 ) },
+		{ g, k, 1 } };
+
+	// the square ( x, y ) has u = 0.5 - y and v = x + 0.5
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		h[ i ][ 0 ] = m[ i ][ 1 ];
+		h[ i ][ 1 ] = -m[ i ][ 0 ];
+		h[ i ][ 2 ] = 0.5 * ( m[ i ][ 0 ] + m[ i ][ 1 ] ) + m[ i ][ 2 ];
+	}
+
+	// a square with three collinear corners
+	const double det = h[ 0 ][ 0 ] * ( h[ 1 ][ 1 ] * h[ 2 ][ 2 ] - h[ 1 ][ 2 ] * h[ 2 ][ 1 ] )
+		- h[ 0 ][ 1 ] * ( h[ 1 ][ 0 ] * h[ 2 ][ 2 ] - h[ 1 ][ 2 ] * h[ 2 ][ 0 ] )
+		+ h[ 0 ][ 2 ] * ( h[ 1 ][ 0 ] * h[ 2 ][ 1 ] - h[ 1 ][ 1 ] * h[ 2 ][ 0 ] );
+	return det != 0;
+}
+
+/** rotation matrix of a rotation vector */
+void rodrigues( const double w[ 3 ], double r[ 3 ][ 3 ] )
+{
+	const double theta2 = w[ 0 ] * w[ 0 ] + w[ 1 ] * w[ 1 ] + w[ 2 ] * w[ 2 ];
+	const double theta = std::sqrt( theta2 );
+	const double a = theta < 1e-8 ? 1 - theta2 / 6 : std::sin( theta ) / theta;
+	const double b = theta < 1e-8 ? 0.5 - theta2 / 24 : ( 1 - std::cos( theta ) ) / theta2;
+	r[ 0 ][ 0 ] = 1 - b * ( w[ 1 ] * w[ 1 ] + w[ 2 ] * w[ 2 ] );
+	r[ 1 ][ 1 ] = 1 - b * ( w[ 0 ] * w[ 0 ] + w[ 2 ] * w[ 2 ] );
+	r[ 2 ][ 2 ] = 1 - b * ( w[ 0 ] * w[ 0 ] + w[ 1 ] * w[ 1 ] );
+	r[ 0 ][ 1 ] = -a * w[ 2 ] + b * w[ 0 ] * w[ 1 ];
+	r[ 1 ][ 0 ] = a * w[ 2 ] + b * w[ 0 ] * w[ 1 ];
+	r[ 0 ][ 2 ] = a * w[ 1 ] + b * w[ 0 ] * w[ 2 ];
+	r[ 2 ][ 0 ] = -a * w[ 1 ] + b * w[ 0 ] * w[ 2 ];
+	r[ 1 ][ 2 ] = -a * w[ 0 ] + b * w[ 1 ] * w[ 2 ];
+	r[ 2 ][ 1 ] = a * w[ 0 ] + b * w[ 1 ] * w[ 2 ];
+}
+
+/**
+ * squared reprojection error of the corners and the normal equations of a gauss-newton step,
+ * with the pose update exp( w ) [ R | t ] + v
+ */
+double evaluatePose( const Math::Matrix< double, 3, 3 >& k, const double markerSize, const Math::Vector< double, 2 >* corners,
+	const double r[ 3 ][ 3 ], const double t[ 3 ], Math::Matrix< double, 6, 6 >& jtj, Math::Vector< double, 6 >& jtr, bool& bInFront )
+{
+	jtj = Math::Matrix< double, 6, 6 >::zeros();
+	jtr = Math::Vector< double, 6 >::zeros();
+	bInFront = true;
+	double squaredError = 0;
+	for ( std::size_t c = 0; c < 4; c++ )
+	{
+		const double x = markerSize * g_square[ c ][ 0 ];
+		const double y = markerSize * g_square[ c ][ 1 ];
+		double p[ 3 ], q[ 3 ];
+		for ( std::size_t i = 0; i < 3; i++ )
+			p[ i ] = r[ i ][ 0 ] * x + r[ i ][ 1 ] * y + t[ i ];
+		for ( std::size_t i = 0; i < 3; i++ )
+			q[ i ] = k( i, 0 ) * p[ 0 ] + k( i, 1 ) * p[ 1 ] + k( i, 2 ) * p[ 2 ];
+		bInFront = bInFront && q[ 2 ] > 0;
+
+		for ( std::size_t d = 0; d < 2; d++ )
+		{
+			const double projected = q[ d ] / q[ 2 ];
+			const double residual = projected - corners[ c ]( d );
+			squaredError += residual * residual;
+
+			// derivative of the projection by p, then by ( w, v )
+			double dp[ 3 ];
+			for ( std::size_t i = 0; i < 3; i++ )
+				dp[ i ] = ( k( d, i ) - projected * k( 2, i ) ) / q[ 2 ];
+			const double row[ 6 ] = {
+				dp[ 2 ] * p[ 1 ] - dp[ 1 ] * p[ 2 ],
+				dp[ 0 ] * p[ 2 ] - dp[ 2 ] * p[ 0 ],
+				dp[ 1 ] * p[ 0 ] - dp[ 0 ] * p[ 1 ],
+				dp[ 0 ], dp[ 1 ], dp[ 2 ] };
+			for ( std::size_t i = 0; i < 6; i++ )
+			{
+				jtr( i ) -= row[ i ] * residual;
+				for ( std::size_t j = 0; j <= i; j++ )
+					jtj( i, j ) += row[ i ] * row[ j ];
+			}
+		}
+	}
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = i + 1; j < 6; j++ )
+			jtj( i, j ) = jtj( j, i );
+	return squaredError;
+}
+
+/** applies the update ( w, v ) to the pose [ R | t ] */
+void updatePose( const double r[ 3 ][ 3 ], const double t[ 3 ], const double step[ 6 ], double r2[ 3 ][ 3 ], double t2[ 3 ] )
+{
+	double dr[ 3 ][ 3 ];
+	rodrigues( step, dr );
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		for ( std::size_t j = 0; j < 3; j++ )
+			r2[ i ][ j ] = dr[ i ][ 0 ] * r[ 0 ][ j ] + dr[ i ][ 1 ] * r[ 1 ][ j ] + dr[ i ][ 2 ] * r[ 2 ][ j ];
+		t2[ i ] = dr[ i ][ 0 ] * t[ 0 ] + dr[ i ][ 1 ] * t[ 1 ] + dr[ i ][ 2 ] * t[ 2 ] + step[ 3 + i ];
+	}
+}
+
+} // anonymous namespace
+
+
+SquareMarkerPose::SquareMarkerPose( const Math::Matrix< double, 3, 3 >& cam, double markerSize, std::size_t nIterations )
+	: m_cam( cam )
+	, m_markerSize( markerSize )
+	, m_nIterations( nIterations )
+{
+	init();
+}
+
+
+SquareMarkerPose::SquareMarkerPose( const Math::CameraIntrinsics< double >& intrinsics, double markerSize, std::size_t nIterations )
+	: m_cam( intrinsics.matrix )
+	, m_markerSize( markerSize )
+	, m_nIterations( nIterations )
+{
+	init();
+}
+
+
+void SquareMarkerPose::init()
+{
+	// inverse by the adjugate, intrinsics are well conditioned
+	const Math::Matrix< double, 3, 3 >& k( m_cam );
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+		{
+			const std::size_t i1 = ( j + 1 ) % 3, i2 = ( j + 2 ) % 3;
+			const std::size_t j1 = ( i + 1 ) % 3, j2 = ( i + 2 ) % 3;
+			m_invCam( i, j ) = k( i1, j1 ) * k( i2, j2 ) - k( i1, j2 ) * k( i2, j1 );
+		}
+	const double det = k( 0, 0 ) * m_invCam( 0, 0 ) + k( 0, 1 ) * m_invCam( 1, 0 ) + k( 0, 2 ) * m_invCam( 2, 0 );
+	if ( det == 0 )
+		UBITRACK_THROW( "Square marker pose: singular camera matrix" );
+	m_invCam *= 1 / det;
+}
+
+
+bool SquareMarkerPose::compute( const Math::Vector< double, 2 >* corners, Math::Pose& pose, SquareMarkerResult* pResult ) const
+{
+	SquareMarkerResult result;
+	result.residual = 0;
+	result.iterations = 0;
+	result.valid = false;
+
+	double h[ 3 ][ 3 ];
+	if ( !squareToQuad( corners, h ) )
+	{
+		if ( pResult )
+			*pResult = result;
+		return false;
+	}
+
+	// M = K^-1 H, with the sign that puts the marker in front of the camera
+	double m[ 3 ][ 3 ];
+	const double sign = h[ 2 ][ 2 ] < 0 ? -1.0 : 1.0;
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			m[ i ][ j ] = sign * ( m_invCam( i, 0 ) * h[ 0 ][ j ] + m_invCam( i, 1 ) * h[ 1 ][ j ] + m_invCam( i, 2 ) * h[ 2 ][ j ] );
+
+	// orthonormalize the first two columns symmetrically around their bisector
+	double xLen = 0, yLen = 0;
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		xLen += m[ i ][ 0 ] * m[ i ][ 0 ];
+		yLen += m[ i ][ 1 ] * m[ i ][ 1 ];
+	}
+	xLen = std::sqrt( xLen );
+	yLen = std::sqrt( yLen );
+	double sum[ 3 ], diff[ 3 ], sumLen = 0, diffLen = 0;
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		sum[ i ] = m[ i ][ 0 ] / xLen + m[ i ][ 1 ] / yLen;
+		diff[ i ] = m[ i ][ 0 ] / xLen - m[ i ][ 1 ] / yLen;
+		sumLen += sum[ i ] * sum[ i ];
+		diffLen += diff[ i ] * diff[ i ];
+	}
+	sumLen = std::sqrt( 2 * sumLen );
+	diffLen = std::sqrt( 2 * diffLen );
+
+	double r[ 3 ][ 3 ], t[ 3 ];
+	const double transScale = 2 * m_markerSize / ( xLen + yLen );
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		r[ i ][ 0 ] = sum[ i ] / sumLen + diff[ i ] / diffLen;
+		r[ i ][ 1 ] = sum[ i ] / sumLen - diff[ i ] / diffLen;
+		t[ i ] = m[ i ][ 2 ] * transScale;
+	}
+	r[ 0 ][ 2 ] = r[ 1 ][ 0 ] * r[ 2 ][ 1 ] - r[ 2 ][ 0 ] * r[ 1 ][ 1 ];
+	r[ 1 ][ 2 ] = r[ 2 ][ 0 ] * r[ 0 ][ 1 ] - r[ 0 ][ 0 ] * r[ 2 ][ 1 ];
+	r[ 2 ][ 2 ] = r[ 0 ][ 0 ] * r[ 1 ][ 1 ] - r[ 1 ][ 0 ] * r[ 0 ][ 1 ];
+
+	// gauss-newton on the reprojection errors, halving steps that increase the error
+	Math::Matrix< double, 6, 6 > jtj;
+	Math::Vector< double, 6 > jtr;
+	bool bInFront;
+	double squaredError = evaluatePose( m_cam, m_markerSize, corners, r, t, jtj, jtr, bInFront );
+	for ( std::size_t iteration = 0; iteration < m_nIterations; iteration++ )
+	{
+		if ( !Math::choleskySolve( jtj, jtr ) )
+			break;
+
+		double step[ 6 ];
+		std::copy( jtr.begin(), jtr.end(), step );
+		double r2[ 3 ][ 3 ], t2[ 3 ];
+		Math::Matrix< double, 6, 6 > jtj2;
+		Math::Vector< double, 6 > jtr2;
+		bool bInFront2;
+		double squaredError2 = 0;
+		for ( std::size_t halving = 0; halving < 10; halving++ )
+		{
+			updatePose( r, t, step, r2, t2 );
+			squaredError2 = evaluatePose( m_cam, m_markerSize, corners, r2, t2, jtj2, jtr2, bInFront2 );
+			if ( squaredError2 <= squaredError )
+				break;
+			for ( std::size_t i = 0; i < 6; i++ )
+				step[ i ] *= 0.5;
+		}
+		if ( squaredError2 > squaredError )
+			break;
+
+		std::copy( &r2[ 0 ][ 0 ], &r2[ 0 ][ 0 ] + 9, &r[ 0 ][ 0 ] );
+		std::copy( t2, t2 + 3, t );
+		jtj = jtj2;
+		jtr = jtr2;
+		bInFront = bInFront2;
+		result.iterations = iteration + 1;
+
+		const double change = squaredError - squaredError2;
+		squaredError = squaredError2;
+		if ( change <= 1e-12 * squaredError )
+			break;
+	}
+
+	Math::Matrix< double, 3, 3 > rotation;
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			rotation( i, j ) = r[ i ][ j ];
+	pose = Math::Pose( Math::Quaternion( rotation ), Math::Vector< double, 3 >( t[ 0 ], t[ 1 ], t[ 2 ] ) );
+
+	result.residual = std::sqrt( squaredError / 4 );
+	result.valid = bInFront;
+	if ( pResult )
+		*pResult = result;
+	return result.valid;
+}
+
+
+bool SquareMarkerPose::compute( const std::vector< Math::Vector< double, 2 > >& corners, Math::Pose& pose, SquareMarkerResult* result ) const
+{
+	if ( corners.size() != 4 )
+		UBITRACK_THROW( "Square marker pose requires four corners" );
+	return compute( &corners[ 0 ], pose, result );
+}
+
+
+void SquareMarkerPose::computeRange( const Math::Vector< double, 2 >* corners, Math::Pose* poses, SquareMarkerResult* results,
+	std::size_t begin, std::size_t end ) const
+{
+	for ( std::size_t i = begin; i < end; i++ )
+		compute( corners + 4 * i, poses[ i ], results + i );
+}
+
+
+void SquareMarkerPose::compute( const std::vector< Math::Vector< double, 2 > >& corners, std::vector< Math::Pose >& poses,
+	std::vector< SquareMarkerResult >& results, const Math::ListExecutor& executor ) const
+{
+	if ( corners.size() % 4 != 0 )
+		UBITRACK_THROW( "Square marker pose requires four corners per marker" );
+
+	const std::size_t n = corners.size() / 4;
+	poses.resize( n );
+	results.resize( n );
+	if ( n == 0 )
+		return;
+
+	const boost::function< void ( std::size_t, std::size_t ) > task( boost::bind( &SquareMarkerPose::computeRange, this,
+		&corners[ 0 ], &poses[ 0 ], &results[ 0 ], _1, _2 ) );
+	if ( executor.empty() )
+		task( 0, n );
+	else
+		executor( n, task );
+}
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation2D3D
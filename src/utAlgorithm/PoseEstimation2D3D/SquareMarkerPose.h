@@ -0,0 +1,146 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Pose estimation of square markers from their four corners.
+ */
+
+#ifndef __UBITRACK_ALGORITHM_2D3D_SQUARE_MARKER_POSE_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_2D3D_SQUARE_MARKER_POSE_H_INCLUDED__
+
+// std
+#include <vector>
+
+#include <utCore.h>		// EXPORT_UBITRACK
+#include <utMath/Matrix.h>
+#include <utMath/Vector.h>
+#include <utMath/Pose.h>
+#include <utMath/CameraIntrinsics.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
+
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation2D3D {
+
+/** result of \c SquareMarkerPose for a single marker */
+struct SquareMarkerResult
+{
+	/** root mean square reprojection error of the corners in pixels */
+	double residual;
+
+	/** number of gauss-newton iterations performed */
+	std::size_t iterations;
+
+	/** false if the corners are degenerate or the marker is behind the camera */
+	bool valid;
+};
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the pose of square markers from the image coordinates of their four corners.
+ *
+ * Does the same as <tt>poseFromHomography( squareHomography( corners ), invK )</tt> followed by
+ * \c optimizePose, but everything works on fixed-size types and nothing is allocated:
+ * - the homography that maps the unit square onto the four corners is computed in closed form,
+ * - the pose is decomposed directly from it,
+ * - gauss-newton iterations on the 6x6 normal equations minimize the reprojection error
+ *   of the corners. Steps that increase the error are halved, and the iterations stop when the
+ *   error no longer decreases.
+ *
+ * The corners are ordered like in \c squareHomography, i.e. they are the projections of
+ * <tt>(-s/2, s/2, 0), (-s/2, -s/2, 0), (s/2, -s/2, 0), (s/2, s/2, 0)</tt> for a marker of size s.
+ * The inverse of the intrinsics is computed once in the constructor. The object is not modified
+ * by the computations, so several threads can use it at the same time.
+ *
+ * @code
+ * const SquareMarkerPose estimator( intrinsics, markerSize );
+ * estimator.compute( corners, poses, results, Math::threadExecutor( 0, 32 ) );
+ * @endcode
+ */
+class UBITRACK_EXPORT SquareMarkerPose
+{
+public:
+	/**
+	 * Constructor.
+	 * @param cam camera intrinsics matrix
+	 * @param markerSize edge length of the markers
+	 * @param nIterations maximum number of gauss-newton iterations, 0 returns the pose of the homography
+	 */
+	SquareMarkerPose( const Math::Matrix< double, 3, 3 >& cam, double markerSize = 1.0, std::size_t nIterations = 10 );
+
+	/** Constructor, taking the matrix of \c CameraIntrinsics. */
+	SquareMarkerPose( const Math::CameraIntrinsics< double >& intrinsics, double markerSize = 1.0, std::size_t nIterations = 10 );
+
+	/**
+	 * Computes the pose of a single marker.
+	 * @param corners the four corners in image coordinates
+	 * @param pose the pose of the marker in camera coordinates
+	 * @param result residual and validity, may be 0
+	 * @return false if the corners are degenerate or the marker is behind the camera
+	 */
+	bool compute( const Math::Vector< double, 2 >* corners, Math::Pose& pose, SquareMarkerResult* result = 0 ) const;
+
+	/** \c compute for a vector of four corners, throws if it has a different size */
+	bool compute( const std::vector< Math::Vector< double, 2 > >& corners, Math::Pose& pose, SquareMarkerResult* result = 0 ) const;
+
+	/**
+	 * Computes the poses of many markers, e.g. all markers detected in a frame.
+	 * Throws if the number of corners is not a multiple of four.
+	 * @param corners four corners per marker, one marker after the other
+	 * @param poses resized to the number of markers and filled with their poses
+	 * @param results resized to the number of markers and filled with the results
+	 * @param executor distributes the markers over threads, the default computes them in the calling thread
+	 */
+	void compute( const std::vector< Math::Vector< double, 2 > >& corners, std::vector< Math::Pose >& poses,
+		std::vector< SquareMarkerResult >& results, const Math::ListExecutor& executor = Math::ListExecutor() ) const;
+
+	/** camera intrinsics matrix */
+	const Math::Matrix< double, 3, 3 >& camera() const
+	{ return m_cam; }
+
+	/** the inverse of the camera intrinsics matrix */
+	const Math::Matrix< double, 3, 3 >& inverseCamera() const
+	{ return m_invCam; }
+
+	/** edge length of the markers */
+	double markerSize() const
+	{ return m_markerSize; }
+
+protected:
+	void init();
+
+	/** computes the markers [ begin, end ) of a batch */
+	void computeRange( const Math::Vector< double, 2 >* corners, Math::Pose* poses, SquareMarkerResult* results,
+		std::size_t begin, std::size_t end ) const;
+
+	Math::Matrix< double, 3, 3 > m_cam;
+	Math::Matrix< double, 3, 3 > m_invCam;
+	double m_markerSize;
+	std::size_t m_nIterations;
+};
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation2D3D
+
+#endif
@@ -36,6 +36,7 @@
 #include "Pose6D.h"
 #include "Ransac.h"
 #include "Optimization.h"
+#include "CovarianceEstimation.h"
 
 namespace Ubitrack { namespace Algorithm { namespace PoseEstimation3D3D {
 
@@ -49,6 +50,13 @@ Math::Pose calculateAbsoluteOrientation ( const std::vector< Math::Vector3d >& l
 	return Math::Pose( pose );
 }
 
+Math::Pose calculateAbsoluteOrientation ( const Math::PointView3d& left, const Math::PointView3d& right )
+{
+	Math::Pose pose;
+	estimatePose6D_3D3D ( right.begin(), right.end(), pose, left.begin(), left.end() );
+	return pose;
+}
+
 double estimateScale_3D3D( const std::vector< Math::Vector3d >& m_left
 	, const std::vector< Math::Vector3d >& m_right )
 {
@@ -74,6 +82,44 @@ bool estimatePose6D_3D3D( const std::vector< Math::Vector3f >& points3dA
 	return estimatePose6D_3D3D( points3dA.begin(), points3dA.end(), pose, points3dB.begin(), points3dB.end() );
 }
 
+bool estimatePose6D_3D3D( const std::vector< Math::Vector3d >& points3dA
+	, Math::Pose& pose, const std::vector< Math::Vector3d >& points3dB
+	, double& residual, Math::Matrix< double, 6, 6 >& covariance )
+{
+	return estimatePose6D_3D3D( points3dA.begin(), points3dA.end(), pose, points3dB.begin(), points3dB.end(), residual, covariance );
+}
+
+bool estimatePose6D_3D3D( const std::vector< Math::Vector3f >& points3dA
+	, Math::Pose& pose, const std::vector< Math::Vector3f >& points3dB
+	, float& residual, Math::Matrix< float, 6, 6 >& covariance )
+{
+	return estimatePose6D_3D3D( points3dA.begin(), points3dA.end(), pose, points3dB.begin(), points3dB.end(), residual, covariance );
+}
+
+bool estimatePose6D_3D3D( const Math::PointCloud3d& points3dA
+	, Math::Pose& pose, const Math::PointCloud3d& points3dB )
+{
+	return estimatePose6D_3D3D( points3dA.begin(), points3dA.end(), pose, points3dB.begin(), points3dB.end() );
+}
+
+bool estimatePose6D_3D3D( const Math::PointCloud3f& points3dA
+	, Math::Pose& pose, const Math::PointCloud3f& points3dB )
+{
+	return estimatePose6D_3D3D( points3dA.begin(), points3dA.end(), pose, points3dB.begin(), points3dB.end() );
+}
+
+bool estimatePose6D_3D3D( const Math::PointView3d& points3dA
+	, Math::Pose& pose, const Math::PointView3d& points3dB )
+{
+	return estimatePose6D_3D3D( points3dA.begin(), points3dA.end(), pose, points3dB.begin(), points3dB.end() );
+}
+
+bool estimatePose6D_3D3D( const Math::PointView3f& points3dA
+	, Math::Pose& pose, const Math::PointView3f& points3dB )
+{
+	return estimatePose6D_3D3D( points3dA.begin(), points3dA.end(), pose, points3dB.begin(), points3dB.end() );
+}
+
 bool estimatePose6D_3D3D( const std::vector< Math::Vector3f >& pointsA
 	, Math::Pose& pose
 	, const std::vector< Math::Vector3f >& pointsB
@@ -40,6 +40,8 @@
 #include <utMath/Pose.h>
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
+#include <utMath/PointCloud.h>
+#include <utMath/PointView.h>
 
 #include <vector>
 
@@ -66,6 +68,13 @@ namespace Ubitrack { namespace Algorithm { namespace PoseEstimation3D3D {
 UBITRACK_EXPORT Math::Pose calculateAbsoluteOrientation ( const std::vector< Math::Vector< double, 3 > >& left,
 														  const std::vector< Math::Vector< double, 3 > >& right);
 
+/**
+ * @ingroup tracking_algorithms
+ * @internal
+ * overloaded function for points in buffers of other libraries, which are read in place.
+ */
+UBITRACK_EXPORT Math::Pose calculateAbsoluteOrientation ( const Math::PointView3d& left, const Math::PointView3d& right );
+
 /**
  * @ingroup tracking_algorithms
  * @brief Calculates a solution to the 3D-3D pose estiataion problem, also
@@ -118,6 +127,57 @@ UBITRACK_EXPORT bool estimatePose6D_3D3D( const std::vector< Math::Vector3d >& p
 UBITRACK_EXPORT bool estimatePose6D_3D3D( const std::vector< Math::Vector3f >& points3dA, Math::Pose& pose
 										, const std::vector< Math::Vector3f >& points3dB );
 
+/** 
+ * @brief overloaded function \c estimatePose6D_3D3D that also computes the residual and the covariance of the pose.
+ *
+ * The residual and the covariance are the same as computed by \c estimatePose6DResidual and
+ * \c estimatePose6DCovariance of CovarianceEstimation.h, but both come from a single pass over
+ * the points after the pose is solved.
+ *
+ * @param points3dA vector of \b 3D \b points in the left coordinate frame.
+ * @return pose the \b pose describes the transformation of the right coordinate frame into the left coordinate frame.
+ * @param points3dB vector of \b 3D \b points in the right coordinate frame.
+ * @param residual returns the mean distance error divided by three
+ * @param covariance returns the 6-by-6 covariance of translation and rotation error
+ * @return a flag that signs if the algorithm has succesfully determined a solution.
+ */
+UBITRACK_EXPORT bool estimatePose6D_3D3D( const std::vector< Math::Vector3d >& points3dA, Math::Pose& pose
+										, const std::vector< Math::Vector3d >& points3dB
+										, double& residual, Math::Matrix< double, 6, 6 >& covariance );
+
+/// @internal overloaded function with residual and covariance for \c float parameters
+UBITRACK_EXPORT bool estimatePose6D_3D3D( const std::vector< Math::Vector3f >& points3dA, Math::Pose& pose
+										, const std::vector< Math::Vector3f >& points3dB
+										, float& residual, Math::Matrix< float, 6, 6 >& covariance );
+
+/** 
+ * @brief overloaded function \c estimatePose6D_3D3D for points stored in a \c Math::PointCloud.
+ *
+ * The points are read directly from the coordinate arrays of the clouds.
+ * For further information on this algorithm see estimatePose6D_3D3D( const std::vector< Math::Vector3d >& points3dA, Math::Pose& pose, const std::vector< Math::Vector3d >& points3dB );
+ */
+UBITRACK_EXPORT bool estimatePose6D_3D3D( const Math::PointCloud3d& points3dA, Math::Pose& pose
+										, const Math::PointCloud3d& points3dB );
+
+/** 
+ * @internal
+ * @brief overloaded function \c estimatePose6D_3D3D with \c float point clouds.
+ */
+UBITRACK_EXPORT bool estimatePose6D_3D3D( const Math::PointCloud3f& points3dA, Math::Pose& pose
+										, const Math::PointCloud3f& points3dB );
+
+/** 
+ * @brief overloaded function \c estimatePose6D_3D3D for points in strided buffers, e.g. of Eigen or OpenCV.
+ *
+ * The points are read in place, see \c Math::PointView.
+ */
+UBITRACK_EXPORT bool estimatePose6D_3D3D( const Math::PointView3d& points3dA, Math::Pose& pose
+										, const Math::PointView3d& points3dB );
+
+/// @internal overloaded function with \c float point views
+UBITRACK_EXPORT bool estimatePose6D_3D3D( const Math::PointView3f& points3dA, Math::Pose& pose
+										, const Math::PointView3f& points3dB );
+
 /** 
  * @brief This algorithm estimates the rotation between two coordinate frames.
  *
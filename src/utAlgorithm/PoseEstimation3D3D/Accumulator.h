@@ -0,0 +1,298 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Streaming accumulation of corresponding 3D points for Absolute Orientation
+ */
+
+#ifndef __UBITRACK_ALGORITHM_ABSOLUTE_ORIENTATION_ACCUMULATOR_INCLUDED__
+#define __UBITRACK_ALGORITHM_ABSOLUTE_ORIENTATION_ACCUMULATOR_INCLUDED__
+
+#include <cmath>	// std::sqrt
+#include <cstddef>	// std::size_t
+
+#include <utMath/Pose.h>
+#include <utMath/Quaternion.h>
+#include <utMath/FixedDecomposition.h> // eigenvalue (quaternion) solution
+#include <utMath/Util/RotationCast.h>
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation3D3D {
+
+/**
+ * @internal
+ * Solves Horn's eigenvalue problem for the rotation from the matrix
+ * M = sum( ( b - centroidB ) * ( a - centroidA )^T ) of centered outer products.
+ * The rotation maps the points b onto the points a.
+ */
+template< typename T, typename ResultType >
+bool estimateRotation_3D3D( const Math::Matrix< T, 3, 3 >& M, ResultType& rotation )
+{
+	// calculate the matrix N as linear combinations of elements of M
+	// upper right suffices, since N is symmetric
+	Math::Matrix< T, 4, 4 > N;
+	N( 0, 0 ) =  M ( 0, 0 )+M ( 1, 1 )+M ( 2, 2 );
+	N( 1, 1 ) =  M ( 0, 0 )-M ( 1, 1 )-M ( 2, 2 );
+	N( 2, 2 ) = -M ( 0, 0 )+M ( 1, 1 )-M ( 2, 2 );
+	N( 3, 3 ) = -M ( 0, 0 )-M ( 1, 1 )+M ( 2, 2 );
+
+	N( 0, 1 ) = M ( 1, 2 )-M ( 2, 1 );
+	N( 0, 2 ) = M ( 2, 0 )-M ( 0, 2 );
+	N( 0, 3 ) = M ( 0, 1 )-M ( 1, 0 );
+	N( 1, 2 ) = M ( 0, 1 )+M ( 1, 0 );
+	N( 1, 3 ) = M ( 2, 0 )+M ( 0, 2 );
+	N( 2, 3 ) = M ( 1, 2 )+M ( 2, 1 );
+
+	// calculate eigenvalues and eigenvectors of N
+	Math::Vector< T, 4 > W;
+	if( !Math::symmetricEigen( N, W ) )
+		return false;
+
+	// largest eigenvalue is always the last one
+	if ( W[ 3 ] <= 0.0 )
+		return false;
+
+	rotation = Math::Util::RotationCast< ResultType >( )( Math::Quaternion ( N ( 1, 3 ), N ( 2, 3 ), N ( 3, 3 ), N ( 0, 3 ) ) );
+	return true;
+}
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Accumulates corresponding 3D points a and b for the closed-form solution
+ * of the Absolute Orientation problem, a = scale * R * b + t.
+ *
+ * Points are added one at a time or as ranges and are not stored. The
+ * accumulator keeps the weighted centroids, the centered cross-covariance
+ * and the centered sums of squares, updated in a single pass by West's
+ * weighted variant of Welford's algorithm, which does not lose precision
+ * for points far from the origin like raw sums do. Accumulators of disjoint
+ * sets of points, e.g. filled by different threads, are combined by
+ * \c merge. The rotation is then found from the 4x4 symmetric eigenvalue
+ * problem of Horn's method, independent of the number of points.
+ *
+ * @code
+ * AbsoluteOrientationAccumulator< double > acc;
+ * for ( ... )
+ *     acc.add( pointA, pointB, weight );
+ * Math::Pose pose;
+ * if ( acc.estimatePose( pose ) )
+ *     ...
+ * @endcode
+ */
+template< typename T >
+class AbsoluteOrientationAccumulator
+{
+public:
+	typedef T value_type;
+
+	AbsoluteOrientationAccumulator()
+	{ reset(); }
+
+	/** removes all points */
+	void reset()
+	{
+		m_count = 0;
+		m_weight = 0;
+		m_sumSquaresA = 0;
+		m_sumSquaresB = 0;
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			m_centroidA( i ) = 0;
+			m_centroidB( i ) = 0;
+			for ( std::size_t j = 0; j < 3; j++ )
+				m_crossCovariance( i, j ) = 0;
+		}
+	}
+
+	/**
+	 * adds a pair of corresponding points
+	 * @param a point in the left coordinate frame
+	 * @param b corresponding point in the right coordinate frame
+	 * @param weight positive weight of the pair, pairs without weight are ignored
+	 */
+	template< typename VA, typename VB >
+	void add( const VA& a, const VB& b, const T weight = 1 )
+	{
+		if ( !( weight > 0 ) )
+			return;
+
+		m_count++;
+		m_weight += weight;
+		const T f = weight / m_weight;
+		const T g = weight * ( 1 - f );
+
+		T da[ 3 ], db[ 3 ];
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			da[ i ] = static_cast< T >( a[ i ] ) - m_centroidA( i );
+			db[ i ] = static_cast< T >( b[ i ] ) - m_centroidB( i );
+			m_centroidA( i ) += f * da[ i ];
+			m_centroidB( i ) += f * db[ i ];
+		}
+
+		// the deviation from the new centroid is ( 1 - f ) times the deviation from the old one
+		for ( std::size_t i = 0; i < 3; i++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+				m_crossCovariance( i, j ) += g * db[ i ] * da[ j ];
+		m_sumSquaresA += g * ( da[ 0 ] * da[ 0 ] + da[ 1 ] * da[ 1 ] + da[ 2 ] * da[ 2 ] );
+		m_sumSquaresB += g * ( db[ 0 ] * db[ 0 ] + db[ 1 ] * db[ 1 ] + db[ 2 ] * db[ 2 ] );
+	}
+
+	/** adds the pairs of the ranges [ iBeginA, iEndA ) and [ iBeginB, ... ) with unit weights */
+	template< typename InputIteratorA, typename InputIteratorB >
+	void addRange( InputIteratorA iBeginA, const InputIteratorA iEndA, InputIteratorB iBeginB )
+	{
+		for ( ; iBeginA != iEndA; ++iBeginA, ++iBeginB )
+			add( *iBeginA, *iBeginB );
+	}
+
+	/** adds the pairs of the ranges [ iBeginA, iEndA ) and [ iBeginB, ... ) with the weights [ iBeginWeight, ... ) */
+	template< typename InputIteratorA, typename InputIteratorB, typename WeightIterator >
+	void addRange( InputIteratorA iBeginA, const InputIteratorA iEndA, InputIteratorB iBeginB, WeightIterator iBeginWeight )
+	{
+		for ( ; iBeginA != iEndA; ++iBeginA, ++iBeginB, ++iBeginWeight )
+			add( *iBeginA, *iBeginB, static_cast< T >( *iBeginWeight ) );
+	}
+
+	/** adds the points of another accumulator, e.g. one filled by another thread */
+	void merge( const AbsoluteOrientationAccumulator& other )
+	{
+		if ( other.m_count == 0 )
+			return;
+		if ( m_count == 0 )
+		{
+			*this = other;
+			return;
+		}
+
+		const T weight = m_weight + other.m_weight;
+		const T f = other.m_weight / weight;
+		const T g = m_weight * f;
+
+		T da[ 3 ], db[ 3 ];
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			da[ i ] = other.m_centroidA( i ) - m_centroidA( i );
+			db[ i ] = other.m_centroidB( i ) - m_centroidB( i );
+			m_centroidA( i ) += f * da[ i ];
+			m_centroidB( i ) += f * db[ i ];
+		}
+
+		for ( std::size_t i = 0; i < 3; i++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+				m_crossCovariance( i, j ) += other.m_crossCovariance( i, j ) + g * db[ i ] * da[ j ];
+		m_sumSquaresA += other.m_sumSquaresA + g * ( da[ 0 ] * da[ 0 ] + da[ 1 ] * da[ 1 ] + da[ 2 ] * da[ 2 ] );
+		m_sumSquaresB += other.m_sumSquaresB + g * ( db[ 0 ] * db[ 0 ] + db[ 1 ] * db[ 1 ] + db[ 2 ] * db[ 2 ] );
+
+		m_count += other.m_count;
+		m_weight = weight;
+	}
+
+	/** same as \c merge */
+	AbsoluteOrientationAccumulator& operator+=( const AbsoluteOrientationAccumulator& other )
+	{
+		merge( other );
+		return *this;
+	}
+
+	/** number of pairs with positive weight */
+	std::size_t size() const
+	{ return m_count; }
+
+	/** sum of the weights */
+	T weight() const
+	{ return m_weight; }
+
+	/** weighted centroid of the points a */
+	const Math::Vector< T, 3 >& centroidA() const
+	{ return m_centroidA; }
+
+	/** weighted centroid of the points b */
+	const Math::Vector< T, 3 >& centroidB() const
+	{ return m_centroidB; }
+
+	/** the matrix sum( w * ( b - centroidB ) * ( a - centroidA )^T ) */
+	const Math::Matrix< T, 3, 3 >& crossCovariance() const
+	{ return m_crossCovariance; }
+
+	/**
+	 * estimates the rotation R of a = R * b + t
+	 * @param rotation a \c Math::Quaternion or 3x3 matrix receiving the rotation
+	 * @return false if there are less than three pairs or the problem is degenerate
+	 */
+	template< typename ResultType >
+	bool estimateRotation( ResultType& rotation ) const
+	{
+		if ( m_count < 3 )
+			return false;
+		return estimateRotation_3D3D( m_crossCovariance, rotation );
+	}
+
+	/**
+	 * estimates the pose ( R, t ) of a = R * b + t
+	 * @return false if there are less than three pairs or the problem is degenerate
+	 */
+	bool estimatePose( Math::Pose& pose ) const
+	{
+		Math::Quaternion quat;
+		if ( !estimateRotation( quat ) )
+			return false;
+
+		Math::Vector< double, 3 > centroidA, centroidB;
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			centroidA( i ) = m_centroidA( i );
+			centroidB( i ) = m_centroidB( i );
+		}
+		pose = Math::Pose( quat, centroidA - quat * centroidB );
+		return true;
+	}
+
+	/** estimates the scale of a = scale * R * b + t as the ratio of the spreads of both point sets */
+	T estimateScale() const
+	{ return std::sqrt( m_sumSquaresA / m_sumSquaresB ); }
+
+protected:
+	/** number of pairs */
+	std::size_t m_count;
+
+	/** sum of the weights */
+	T m_weight;
+
+	/** weighted centroids */
+	Math::Vector< T, 3 > m_centroidA;
+	Math::Vector< T, 3 > m_centroidB;
+
+	/** weighted sum of the centered outer products ( b - centroidB ) * ( a - centroidA )^T */
+	Math::Matrix< T, 3, 3 > m_crossCovariance;
+
+	/** weighted sums of the squared distances to the centroids */
+	T m_sumSquaresA;
+	T m_sumSquaresB;
+};
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation3D3D
+
+#endif // __UBITRACK_ALGORITHM_ABSOLUTE_ORIENTATION_ACCUMULATOR_INCLUDED__
@@ -38,7 +38,9 @@
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
 #include <utMath/Blas1.h>
+#include <utMath/FixedDecomposition.h>
 #include "ErrorEstimation.h"
+#include "Pose6D.h"
 
 #include <utMath/Geometry/PointTransformation.h>
 #include "../Function/QuaternionRotationError.h"
@@ -127,34 +129,108 @@ public:
 
 
 
-/// @internal function to calculate the covariance to an estimated pose from 3D point correspondences
+/**
+ * @internal
+ * Computes the residual of \c estimatePose6DResidual and the covariance of \c estimatePose6DCovariance
+ * in a single pass over the points.
+ *
+ * Instead of stacking the 3n-by-6 jacobian of \c Function::MultiplePointTransformationError and
+ * decomposing it, only its 6-by-6 normal matrix is accumulated. The pseudo-inverse of the normal
+ * matrix is computed from its eigen decomposition, with the same rank threshold as the SVD of
+ * \c Math::Stochastic::backwardPropagationIdentity.
+ *
+ * @return false if there are no points
+ */
 template< typename InputIterator >
-bool estimatePose6DCovariance( const InputIterator iBeginA, const InputIterator iEndA
+bool estimatePose6DResidualCovariance( const InputIterator iBeginA, const InputIterator iEndA
 	, const Math::Pose& pose
 	, const InputIterator iBeginB, const InputIterator iEndB
-	// , Math::Matrix< Math::Pose::value_type, 6, 6 > &covariance )
+	, typename std::iterator_traits< InputIterator >::value_type::value_type& residual
 	, Math::Matrix< typename std::iterator_traits< InputIterator >::value_type::value_type, 6, 6 > &covariance )
 {
+	namespace ublas = boost::numeric::ublas;
 	typedef typename std::iterator_traits< InputIterator >::value_type vector_type;
 	typedef typename vector_type::value_type T;
 
-	// const std::size_t n = std::distance( iBeginA, iEndA );
-	
-	// const Math::Matrix< T, 3, 4 > mat( pose );
-
-	// estimate residual error
-	const T err = estimatePose6DResidual< T >( iBeginA, iEndA, pose, iBeginB, iEndB );
-	
-	// copy rot & trans to parameter vector
 	Math::Vector< T, 7 > params;
 	pose.toVector( params );
+	const Math::Vector< T, 4 > quaternion( ublas::subrange( params, 3, 7 ) );
+
+	// sum of the distance errors and upper triangle of sum( J_i^T * J_i ) with J_i = [ I rotJ_i ]
+	const ErrorFunction< T > errorFunction( pose );
+	Math::Matrix< double, 6, 6 > normal( Math::Matrix< double, 6, 6 >::zeros() );
+	Math::Matrix< T, 3, 3 > rotJ;
+	T err( 0 );
+	std::size_t n( 0 );
+	InputIterator itB( iBeginB );
+	for( InputIterator itA( iBeginA ); itA != iEndA; ++itA, ++itB, ++n )
+	{
+		err += errorFunction( *itA, *itB );
+
+		Algorithm::Function::QuaternionRotationError< T >( *itB ).jacobian( quaternion, rotJ );
+		for( std::size_t r( 0 ); r < 3; ++r )
+			for( std::size_t c( 0 ); c < 3; ++c )
+			{
+				normal( r, 3 + c ) += rotJ( r, c );
+				if( c >= r )
+					normal( 3 + r, 3 + c ) += rotJ( 0, r ) * rotJ( 0, c ) + rotJ( 1, r ) * rotJ( 1, c ) + rotJ( 2, r ) * rotJ( 2, c );
+			}
+	}
+	if( n == 0 )
+		return false;
+
+	residual = err / ( 3 * n );
+	for( std::size_t r( 0 ); r < 3; ++r )
+		normal( r, r ) = static_cast< double >( n );
+	for( std::size_t r( 0 ); r < 6; ++r )
+		for( std::size_t c( r + 1 ); c < 6; ++c )
+			normal( c, r ) = normal( r, c );
+
+	// pseudo-inverse, singular values of J below 1e-8 of the largest one are treated as zero
+	Math::Vector< double, 6 > w;
+	if( !Math::symmetricEigen( normal, w ) )
+		return false;
+	const double precision( w( 5 ) * 1e-16 );
+	for( std::size_t r( 0 ); r < 6; ++r )
+		for( std::size_t c( r ); c < 6; ++c )
+		{
+			double sum( 0 );
+			for( std::size_t k( 0 ); k < 6; ++k )
+				if( w( k ) > precision )
+					sum += normal( r, k ) * normal( c, k ) / w( k );
+			covariance( r, c ) = covariance( c, r ) = static_cast< T >( residual * sum );
+		}
+	return true;
+}
 
-	// calculate error
-	Function::MultiplePointTransformationError< InputIterator > trafoFunc( iBeginB, iEndB );
-
-	Math::Stochastic::backwardPropagationIdentity( covariance, err, trafoFunc, params );
+/// @internal function to calculate the covariance to an estimated pose from 3D point correspondences
+template< typename InputIterator >
+bool estimatePose6DCovariance( const InputIterator iBeginA, const InputIterator iEndA
+	, const Math::Pose& pose
+	, const InputIterator iBeginB, const InputIterator iEndB
+	, Math::Matrix< typename std::iterator_traits< InputIterator >::value_type::value_type, 6, 6 > &covariance )
+{
+	typename std::iterator_traits< InputIterator >::value_type::value_type residual;
+	return estimatePose6DResidualCovariance( iBeginA, iEndA, pose, iBeginB, iEndB, residual, covariance );
+}
 
-	return true;
+/**
+ * @internal
+ * Estimates the pose of the absolute orientation problem together with its residual and covariance.
+ *
+ * The pose is computed from the single pass of \c AbsoluteOrientationAccumulator, the residual and
+ * the covariance in one further pass by \c estimatePose6DResidualCovariance, instead of one pass
+ * for each of them.
+ */
+template< typename InputIterator >
+bool estimatePose6D_3D3D( const InputIterator itBegin1, const InputIterator itEnd1
+	, Math::Pose& pose, const InputIterator itBegin2, const InputIterator itEnd2
+	, typename std::iterator_traits< InputIterator >::value_type::value_type& residual
+	, Math::Matrix< typename std::iterator_traits< InputIterator >::value_type::value_type, 6, 6 > &covariance )
+{
+	if( !estimatePose6D_3D3D( itBegin1, itEnd1, pose, itBegin2, itEnd2 ) )
+		return false;
+	return estimatePose6DResidualCovariance( itBegin1, itEnd1, pose, itBegin2, itEnd2, residual, covariance );
 }
 	
 }}} // namespace Ubitrack::Algorithm::PoseEstimation3D3D
@@ -71,15 +71,15 @@ template< typename T, typename InputIterator >
 T estimatePose6DResidual( const InputIterator itBegin1, const InputIterator itEnd1
 		, const Math::Pose& pose, const InputIterator itBegin2, const InputIterator itEnd2 )
 {
-	// calculate distance errors in advance and reuse them later
-	const std::size_t n ( std::distance(  itBegin1, itEnd1 ) );
-	std::vector< T > distance_error;
-	distance_error.reserve( n );
-	std::transform( itBegin1, itEnd1, itBegin2, std::back_inserter( distance_error ), ErrorFunction< T >( pose ) );
-	
+	// sum up the distance errors in a single pass
+	const ErrorFunction< T > errorFunction( pose );
+	std::size_t n( 0 );
 	T err( 0 );
+	InputIterator it2( itBegin2 );
+	for( InputIterator it1( itBegin1 ); it1 != itEnd1; ++it1, ++it2, ++n )
+		err += errorFunction( *it1, *it2 );
+
 	{	// mean error, also residual, HartleyZissermann, p.136
-		err = std::accumulate( distance_error.begin(), distance_error.end(), err );
 		err /= (3*n);
 		/// @todo check if a square root is necessary here:
 		// err = std::sqrt( err );
@@ -0,0 +1,263 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implementation of the iterative closest point registration.
+ */
+
+#include "IterativeClosestPoint.h"
+#include "Accumulator.h"
+
+#include <cmath>
+
+#include <boost/bind.hpp>
+
+#include <utUtil/Exception.h>
+#include <utUtil/TraceSpan.h>
+#include <utMath/FixedDecomposition.h>
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation3D3D {
+
+template< typename T >
+IterativeClosestPoint< T >::IterativeClosestPoint( const std::vector< Math::Vector< T, 3 > >& model )
+	: m_model( model )
+	, m_tree( model )
+	, m_pScene( 0 )
+	, m_subsample( 1 )
+	, m_maxDistanceSq( 0 )
+	, m_iterations( 0 )
+	, m_bConverged( false )
+	, m_correspondences( 0 )
+	, m_rmsError( 0 )
+{
+}
+
+
+template< typename T >
+IterativeClosestPoint< T >::IterativeClosestPoint( const std::vector< Math::Vector< T, 3 > >& model, const std::vector< Math::Vector< T, 3 > >& normals )
+	: m_model( model )
+	, m_normals( normals )
+	, m_tree( model )
+	, m_pScene( 0 )
+	, m_subsample( 1 )
+	, m_maxDistanceSq( 0 )
+	, m_iterations( 0 )
+	, m_bConverged( false )
+	, m_correspondences( 0 )
+	, m_rmsError( 0 )
+{
+	if ( normals.size() != model.size() )
+		UBITRACK_THROW( "ICP needs one normal per model point" );
+}
+
+
+template< typename T >
+void IterativeClosestPoint< T >::estimateNormals( const std::size_t k, const Math::ListExecutor& executor )
+{
+	m_normals.resize( m_model.size() );
+	if ( executor.empty() )
+		estimateNormalsRange( 0, m_model.size(), k );
+	else
+		executor( m_model.size(), boost::bind( &IterativeClosestPoint< T >::estimateNormalsRange, this, _1, _2, k ) );
+}
+
+
+template< typename T >
+void IterativeClosestPoint< T >::estimateNormalsRange( const std::size_t begin, const std::size_t end, const std::size_t k )
+{
+	std::vector< std::pair< T, std::size_t > > neighbours;
+	for ( std::size_t i = begin; i < end; i++ )
+	{
+		m_normals[ i ] = Math::Vector< T, 3 >::zeros();
+		m_tree.kNearest( m_model[ i ], k, neighbours );
+		if ( neighbours.size() < 3 )
+			continue;
+
+		// the normal is the eigenvector of the smallest eigenvalue of the neighbourhood covariance
+		double centroid[ 3 ] = { 0, 0, 0 };
+		for ( std::size_t j = 0; j < neighbours.size(); j++ )
+			for ( std::size_t r = 0; r < 3; r++ )
+				centroid[ r ] += m_model[ neighbours[ j ].second ]( r ) / static_cast< double >( neighbours.size() );
+
+		Math::Matrix< double, 3, 3 > covariance( Math::Matrix< double, 3, 3 >::zeros() );
+		for ( std::size_t j = 0; j < neighbours.size(); j++ )
+		{
+			double d[ 3 ];
+			for ( std::size_t r = 0; r < 3; r++ )
+				d[ r ] = m_model[ neighbours[ j ].second ]( r ) - centroid[ r ];
+			for ( std::size_t r = 0; r < 3; r++ )
+				for ( std::size_t c = 0; c < 3; c++ )
+					covariance( r, c ) += d[ r ] * d[ c ];
+		}
+
+		Math::Vector< double, 3 > eigenvalues;
+		if ( !Math::symmetricEigen( covariance, eigenvalues ) )
+			continue;
+		for ( std::size_t r = 0; r < 3; r++ )
+			m_normals[ i ]( r ) = static_cast< T >( covariance( r, 0 ) );
+	}
+}
+
+
+template< typename T >
+void IterativeClosestPoint< T >::findCorrespondences( const std::size_t begin, const std::size_t end )
+{
+	const std::vector< Math::Vector< T, 3 > >& scene( *m_pScene );
+	for ( std::size_t j = begin; j < end; j++ )
+	{
+		const Math::Vector< T, 3 >& b( scene[ j * m_subsample ] );
+		const Math::Vector< double, 3 > p( m_pose * Math::Vector< double, 3 >( b( 0 ), b( 1 ), b( 2 ) ) );
+		for ( std::size_t r = 0; r < 3; r++ )
+			m_transformed[ j ]( r ) = static_cast< T >( p( r ) );
+		m_matches[ j ] = m_tree.nearest( m_transformed[ j ], m_maxDistanceSq, &m_distancesSq[ j ] );
+	}
+}
+
+
+template< typename T >
+bool IterativeClosestPoint< T >::align( const std::vector< Math::Vector< T, 3 > >& scene, Math::Pose& pose,
+	const IcpParameter< T >& params, const Math::ListExecutor& executor )
+{
+	if ( params.metric == IcpPointToPlane && m_normals.size() != m_model.size() )
+		UBITRACK_THROW( "Point to plane ICP needs model normals" );
+
+	m_pScene = &scene;
+	m_pose = pose;
+	m_subsample = std::max< std::size_t >( params.subsample, 1 );
+	m_maxDistanceSq = params.maxDistance < std::sqrt( std::numeric_limits< T >::max() ) ?
+		params.maxDistance * params.maxDistance : std::numeric_limits< T >::max();
+
+	const std::size_t n = ( scene.size() + m_subsample - 1 ) / m_subsample;
+	// attributes: sampled scene points, iterations, correspondences
+	UBITRACK_TRACE_SPAN( "icp", n );
+	m_transformed.resize( n );
+	m_matches.resize( n );
+	m_distancesSq.resize( n );
+
+	m_iterations = 0;
+	m_bConverged = false;
+	m_correspondences = 0;
+	m_rmsError = 0;
+
+	while ( m_iterations < params.maxIterations )
+	{
+		if ( executor.empty() )
+			findCorrespondences( 0, n );
+		else
+			executor( n, boost::bind( &IterativeClosestPoint< T >::findCorrespondences, this, _1, _2 ) );
+		m_iterations++;
+
+		std::size_t count = 0;
+		double sumSq = 0;
+		Math::Pose newPose;
+		bool bSolved;
+		if ( params.metric == IcpPointToPoint )
+		{
+			// closed-form pose of the original scan points and their closest model points
+			AbsoluteOrientationAccumulator< double > accumulator;
+			for ( std::size_t j = 0; j < n; j++ )
+				if ( m_matches[ j ] != m_tree.invalid )
+				{
+					accumulator.add( m_model[ m_matches[ j ] ], scene[ j * m_subsample ] );
+					sumSq += m_distancesSq[ j ];
+					count++;
+				}
+			bSolved = accumulator.estimatePose( newPose );
+		}
+		else
+		{
+			// residual ( p - a ) n after an incremental rotation w and translation t of p:
+			// r + w ( p x n ) + t n
+			Math::Matrix< double, 6, 6 > JtJ( Math::Matrix< double, 6, 6 >::zeros() );
+			Math::Vector< double, 6 > Jtr( Math::Vector< double, 6 >::zeros() );
+			for ( std::size_t j = 0; j < n; j++ )
+			{
+				if ( m_matches[ j ] == m_tree.invalid )
+					continue;
+				const Math::Vector< T, 3 >& p( m_transformed[ j ] );
+				const Math::Vector< T, 3 >& a( m_model[ m_matches[ j ] ] );
+				const Math::Vector< T, 3 >& nrm( m_normals[ m_matches[ j ] ] );
+
+				double row[ 6 ];
+				row[ 0 ] = double( p( 1 ) ) * nrm( 2 ) - double( p( 2 ) ) * nrm( 1 );
+				row[ 1 ] = double( p( 2 ) ) * nrm( 0 ) - double( p( 0 ) ) * nrm( 2 );
+				row[ 2 ] = double( p( 0 ) ) * nrm( 1 ) - double( p( 1 ) ) * nrm( 0 );
+				row[ 3 ] = nrm( 0 );
+				row[ 4 ] = nrm( 1 );
+				row[ 5 ] = nrm( 2 );
+				const double r = ( double( p( 0 ) ) - a( 0 ) ) * nrm( 0 ) + ( double( p( 1 ) ) - a( 1 ) ) * nrm( 1 )
+					+ ( double( p( 2 ) ) - a( 2 ) ) * nrm( 2 );
+
+				// lower triangle suffices for the cholesky solver
+				for ( std::size_t u = 0; u < 6; u++ )
+				{
+					for ( std::size_t v = 0; v <= u; v++ )
+						JtJ( u, v ) += row[ u ] * row[ v ];
+					Jtr( u ) -= row[ u ] * r;
+				}
+				sumSq += m_distancesSq[ j ];
+				count++;
+			}
+
+			bSolved = count >= 6 && Math::choleskySolve( JtJ, Jtr );
+			if ( bSolved )
+			{
+				Math::Quaternion rotation( Math::Quaternion::fromLogarithm( Math::Vector< double, 3 >( Jtr( 0 ), Jtr( 1 ), Jtr( 2 ) ) ) );
+				newPose = Math::Pose( rotation, Math::Vector< double, 3 >( Jtr( 3 ), Jtr( 4 ), Jtr( 5 ) ) ) * m_pose;
+				newPose = Math::Pose( Math::Quaternion( newPose.rotation() ).normalize(), newPose.translation() );
+			}
+		}
+
+		m_correspondences = count;
+		UBITRACK_TRACE_SPAN_SET( 1, m_iterations );
+		UBITRACK_TRACE_SPAN_SET( 2, count );
+		m_rmsError = count ? static_cast< T >( std::sqrt( sumSq / count ) ) : T( 0 );
+		if ( !bSolved )
+		{
+			pose = m_pose;
+			return false;
+		}
+
+		// stop when the pose does not change anymore, the angle by atan2 is exact near zero unlike acos
+		const Math::Pose delta( newPose * ~m_pose );
+		m_pose = newPose;
+		const Math::Quaternion& dq( delta.rotation() );
+		const double angle = 2 * std::atan2( std::sqrt( dq.x() * dq.x() + dq.y() * dq.y() + dq.z() * dq.z() ), std::fabs( dq.w() ) );
+		if ( boost::numeric::ublas::norm_2( delta.translation() ) < params.minTranslation && angle < params.minRotation )
+		{
+			m_bConverged = true;
+			break;
+		}
+	}
+
+	pose = m_pose;
+	return true;
+}
+
+// explicit instantiations
+template class IterativeClosestPoint< float >;
+template class IterativeClosestPoint< double >;
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation3D3D
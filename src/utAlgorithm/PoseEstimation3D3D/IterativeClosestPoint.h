@@ -0,0 +1,204 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Iterative closest point registration of 3D point sets
+ */
+
+#ifndef __UBITRACK_ALGORITHM_ABSOLUTE_ORIENTATION_ITERATIVE_CLOSEST_POINT_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_ABSOLUTE_ORIENTATION_ITERATIVE_CLOSEST_POINT_H_INCLUDED__
+
+#include <vector>
+#include <limits>
+
+#include <utCore.h>
+#include <utMath/Pose.h>
+#include <utMath/Vector.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
+#include <utMath/Geometry/KdTree.h>
+
+namespace Ubitrack { namespace Algorithm { namespace PoseEstimation3D3D {
+
+/**
+ * @ingroup tracking_algorithms
+ * Error metric minimized by \c IterativeClosestPoint.
+ */
+enum IcpErrorMetric
+{
+	/** squared distance of a point to its closest model point, solved in closed form by Horn's method */
+	IcpPointToPoint,
+
+	/** squared distance of a point to the tangent plane of its closest model point, needs model normals */
+	IcpPointToPlane
+};
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Parameters of \c IterativeClosestPoint::align.
+ */
+template< typename T >
+struct IcpParameter
+{
+	/** maximum number of iterations */
+	std::size_t maxIterations;
+
+	/** correspondences farther apart than this are not used */
+	T maxDistance;
+
+	/** iterations stop when the pose changes by less than this translation... */
+	T minTranslation;
+
+	/** ...and this rotation angle in radians */
+	T minRotation;
+
+	/** only every \c subsample th point of the scene is used */
+	std::size_t subsample;
+
+	/** the minimized error */
+	IcpErrorMetric metric;
+
+	IcpParameter( const std::size_t maxIterations_ = 50, const T maxDistance_ = std::numeric_limits< T >::max()
+		, const T minTranslation_ = T( 1e-6 ), const T minRotation_ = T( 1e-6 ), const std::size_t subsample_ = 1
+		, const IcpErrorMetric metric_ = IcpPointToPoint )
+		: maxIterations( maxIterations_ )
+		, maxDistance( maxDistance_ )
+		, minTranslation( minTranslation_ )
+		, minRotation( minRotation_ )
+		, subsample( subsample_ )
+		, metric( metric_ )
+	{}
+};
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Registers scans of 3D points to a model point set by the iterative closest point algorithm
+ * of Besl and McKay (point to point) or Chen and Medioni (point to plane).
+ *
+ * The model is indexed once by a \c Math::Geometry::KdTree and can be used for any number of
+ * scans. Every iteration transforms the scan by the current pose, finds the closest model point of
+ * every scan point, distributed over threads by a \c Math::ListExecutor, and updates the pose:
+ * - point to point: the pose of the corresponding pairs in closed form, see \c AbsoluteOrientationAccumulator,
+ * - point to plane: a Gauss-Newton step of the linearized distances to the tangent planes.
+ *
+ * The pose passed to \c align is the initial estimate, e.g. the result of the previous frame,
+ * and must be close enough for the closest points to be meaningful.
+ *
+ * @code
+ * IterativeClosestPoint< double > icp( modelPoints );
+ * Math::Pose pose( lastPose );
+ * if ( icp.align( scanPoints, pose, IcpParameter< double >( 30, 0.05 ) ) )
+ *     ... // modelPoint = pose * scanPoint
+ * @endcode
+ */
+template< typename T >
+class UBITRACK_EXPORT IterativeClosestPoint
+{
+public:
+	/**
+	 * Builds the index of the model points, for point to point registration.
+	 * Point to plane registration is possible after \c estimateNormals.
+	 */
+	explicit IterativeClosestPoint( const std::vector< Math::Vector< T, 3 > >& model );
+
+	/**
+	 * Builds the index of the model points with given normals.
+	 * @param model the model points
+	 * @param normals unit normals of the model points
+	 */
+	IterativeClosestPoint( const std::vector< Math::Vector< T, 3 > >& model, const std::vector< Math::Vector< T, 3 > >& normals );
+
+	/**
+	 * Estimates the model normals as the direction of least spread of the \c k nearest model points.
+	 * @param k number of neighbours, at least 3
+	 * @param executor distributes the points over threads, see \c Math::threadExecutor
+	 */
+	void estimateNormals( std::size_t k = 8, const Math::ListExecutor& executor = Math::ListExecutor() );
+
+	/**
+	 * Aligns a scan to the model.
+	 * @param scene the scan points
+	 * @param pose the initial pose, receives the pose that maps the scan points onto the model
+	 * @param params termination, subsampling and error metric
+	 * @param executor distributes the closest point queries over threads, see \c Math::threadExecutor
+	 * @return false if an iteration had too few correspondences, \c pose is the last estimate then
+	 */
+	bool align( const std::vector< Math::Vector< T, 3 > >& scene, Math::Pose& pose,
+		const IcpParameter< T >& params = IcpParameter< T >(), const Math::ListExecutor& executor = Math::ListExecutor() );
+
+	/** number of iterations of the last \c align */
+	std::size_t iterations() const
+	{ return m_iterations; }
+
+	/** whether the last \c align stopped because the pose converged */
+	bool converged() const
+	{ return m_bConverged; }
+
+	/** number of correspondences in the last iteration */
+	std::size_t correspondences() const
+	{ return m_correspondences; }
+
+	/** root mean square distance of the correspondences in the last iteration, before its update */
+	T rmsError() const
+	{ return m_rmsError; }
+
+	/** the index of the model points */
+	const Math::Geometry::KdTree< T, 3 >& index() const
+	{ return m_tree; }
+
+protected:
+	/** finds the closest model points of the scan points [ begin, end ) of the current iteration */
+	void findCorrespondences( std::size_t begin, std::size_t end );
+
+	/** estimates the normals of the model points [ begin, end ) */
+	void estimateNormalsRange( std::size_t begin, std::size_t end, std::size_t k );
+
+	/** the model */
+	std::vector< Math::Vector< T, 3 > > m_model;
+	std::vector< Math::Vector< T, 3 > > m_normals;
+	Math::Geometry::KdTree< T, 3 > m_tree;
+
+	/** state of the current iteration, read by the correspondence search */
+	const std::vector< Math::Vector< T, 3 > >* m_pScene;
+	Math::Pose m_pose;
+	std::size_t m_subsample;
+	T m_maxDistanceSq;
+
+	/** transformed scan points, their closest model points and squared distances */
+	std::vector< Math::Vector< T, 3 > > m_transformed;
+	std::vector< std::size_t > m_matches;
+	std::vector< T > m_distancesSq;
+
+	/** statistics of the last alignment */
+	std::size_t m_iterations;
+	bool m_bConverged;
+	std::size_t m_correspondences;
+	T m_rmsError;
+};
+
+} } } // namespace Ubitrack::Algorithm::PoseEstimation3D3D
+
+#endif // __UBITRACK_ALGORITHM_ABSOLUTE_ORIENTATION_ITERATIVE_CLOSEST_POINT_H_INCLUDED__
@@ -83,15 +83,15 @@ template< typename InputIterator >
 bool estimatePose6D_3D3D ( const InputIterator itBegin1, const InputIterator itEnd1
 		, Math::Pose& pose, const InputIterator itBegin2, const InputIterator itEnd2 )
 {
-	/// @todo <-check that vector_type is a 3-vector
-	typedef typename std::iterator_traits< InputIterator >::value_type vector_type; 
-
-	const std::size_t n = std::distance( itBegin1, itEnd1 );
+	typedef typename std::iterator_traits< InputIterator >::value_type::value_type value_type;
 
-	const vector_type leftCentroid = std::accumulate( itBegin1, itEnd1, vector_type::zeros() ) / n;
-	const vector_type rightCentroid = std::accumulate( itBegin2, itEnd2, vector_type::zeros() ) / n;
+	assert( std::distance( itBegin1, itEnd1 ) == std::distance( itBegin2, itEnd2 ) );
 
-	return estimatePose6D_3D3D( itBegin1, itEnd1, pose, itBegin2, itEnd2, leftCentroid, rightCentroid );
+	// centroids and outer products in a single pass
+	AbsoluteOrientationAccumulator< value_type > accumulator;
+	accumulator.addRange( itBegin1, itEnd1, itBegin2 );
+	assert( accumulator.size() > 2u );
+	return accumulator.estimatePose( pose );
 }
 
 } } } // namespace Ubitrack::Algorithm::PoseEstimation3D3D
@@ -33,18 +33,10 @@
 #ifndef __UBITRACK_ALGORITHM_ABSOLUTE_ORIENTATION_ROTATION_3D_INCLUDED__
 #define __UBITRACK_ALGORITHM_ABSOLUTE_ORIENTATION_ROTATION_3D_INCLUDED__
 
-#include <numeric> // std::accumulate
 #include <iterator> // std::iterator_traits
 
-#ifdef HAVE_LAPACK
-// eigenvalue (quaternion) solution
-#include <boost/numeric/bindings/lapack/syev.hpp>
-// svd solution
-#include <boost/numeric/bindings/lapack/gesvd.hpp>
-#endif
-
 #include <utMath/Quaternion.h>
-#include <utMath/Util/RotationCast.h>
+#include "Accumulator.h" // eigenvalue (quaternion) solution
 #include <utMath/Blas2.h> // outer_product
 #include <utMath/MatrixOperations.h> // determinant
 
@@ -61,9 +53,6 @@ bool estimateRotation_3D3D ( const InputIterator iBeginLeft, const InputIterator
 		, const typename std::iterator_traits< InputIterator >::value_type& leftCentroid
 		, const typename std::iterator_traits< InputIterator >::value_type& rightCentroid )
 {
-#ifndef HAVE_LAPACK
-	return false;
-#else
 	typedef typename std::iterator_traits< InputIterator >::value_type vector_type;
 	typedef typename vector_type::value_type value_type;
 
@@ -108,41 +97,7 @@ bool estimateRotation_3D3D ( const InputIterator iBeginLeft, const InputIterator
 		// return true;
 	// }
 	
-	// calculate the matrix N as linear combinations of elements of M
-	// upper right suffices, since N is symmetric
-	Math::Matrix< value_type, 4, 4 > N;
-	N( 0, 0 ) =  M ( 0, 0 )+M ( 1, 1 )+M ( 2, 2 );
-	N( 1, 1 ) =  M ( 0, 0 )-M ( 1, 1 )-M ( 2, 2 );
-	N( 2, 2 ) = -M ( 0, 0 )+M ( 1, 1 )-M ( 2, 2 );
-	N( 3, 3 ) = -M ( 0, 0 )-M ( 1, 1 )+M ( 2, 2 );
- 
-	N( 0, 1 ) = M ( 1, 2 )-M ( 2, 1 );
-	N( 0, 2 ) = M ( 2, 0 )-M ( 0, 2 );
-	N( 0, 3 ) = M ( 0, 1 )-M ( 1, 0 );
-	N( 1, 2 ) = M ( 0, 1 )+M ( 1, 0 );
-	N( 1, 3 ) = M ( 2, 0 )+M ( 0, 2 );
-	N( 2, 3 ) = M ( 1, 2 )+M ( 2, 1 );
-
-	// calculate eigenvalues and eigenvectors of N
-	Math::Vector< value_type, 4 > W;
-	int i = boost::numeric::bindings::lapack::syev ( 'V', 'U', N, W, boost::numeric::bindings::lapack::minimal_workspace() );
-	if( i != 0 )
-	{
-		// < 0:  if INFO = -i, the i-th argument had an illegal value
-		// std::cout << "Lapack problem, eigenvalue decomposition problem " << i << ".\n";
-		return false;
-	}
-	// largest eigenvalue is always the last one when returned by lapack
-	if ( W[ 3 ] <= 0.0 )
-	{
-		return false;
-		// UBITRACK_THROW ( "Largest Eigenvalue of Matrix N is not positive" );
-	}
-	
-	rotation = Math::Util::RotationCast< ResultType >( )( Math::Quaternion ( N ( 1, 3 ), N ( 2, 3 ), N ( 3, 3 ), N ( 0, 3 ) ) );
-	return true; // <- return everything is ok
-	
-#endif // HAVE_LAPACK
+	return estimateRotation_3D3D( M, rotation );
 }
 
 /// @internal function that also calculates the centroids
@@ -151,15 +106,15 @@ bool estimateRotation_3D3D( const InputIterator iBeginA, const InputIterator iEn
 	, ResultType& result
 	, const InputIterator iBeginB, const InputIterator iEndB )
 {
-	// some initial typedefs for easier coding
-	typedef typename std::iterator_traits< InputIterator >::value_type vector_type;
-	
-	const std::size_t n = std::distance( iBeginA, iEndA );
-	
-	const vector_type leftCentroid = std::accumulate( iBeginA, iEndA, vector_type::zeros() ) / n;
-	const vector_type rightCentroid = std::accumulate( iBeginB, iEndB, vector_type::zeros() ) / n;
+	typedef typename std::iterator_traits< InputIterator >::value_type::value_type value_type;
+
+	assert( std::distance( iBeginA, iEndA ) == std::distance( iBeginB, iEndB ) );
 
-	return estimateRotation_3D3D ( iBeginA, iEndA, result, iBeginB, iEndB, leftCentroid, rightCentroid );
+	// centroids and outer products in a single pass
+	AbsoluteOrientationAccumulator< value_type > accumulator;
+	accumulator.addRange( iBeginA, iEndA, iBeginB );
+	assert( accumulator.size() > 2u );
+	return accumulator.estimateRotation( result );
 }
 
 } } } // namespace Ubitrack::Algorithm::PoseEstimation3D3D
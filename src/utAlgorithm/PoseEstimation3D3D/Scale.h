@@ -36,9 +36,10 @@
 
 #include <cmath>	// std::sqrt
 #include <cassert>	// assert-macro
-#include <numeric>	// std::accumulate
 #include <iterator>	// std::iterator_traits
 
+#include "Accumulator.h"
+
 namespace Ubitrack { namespace Algorithm { namespace PoseEstimation3D3D {
 
 
@@ -93,18 +94,15 @@ typename std::iterator_traits< InputIterator >::value_type::value_type estimateS
 	, const InputIterator iBeginRight, const InputIterator iEndRight )
 {
 
-	/// @todo <-check that vector_type is a 3-vector
-	typedef typename std::iterator_traits< InputIterator >::value_type vector_type; 
-	typedef typename vector_type::value_type value_type;
-	
-	const std::size_t n = std::distance( iBeginLeft, iEndLeft );
-	
-	//Compute the centroids of both coordinate systems
-	const vector_type leftCentroid = std::accumulate( iBeginLeft, iEndLeft, vector_type::zeros() ) / n;
-	const vector_type rightCentroid = std::accumulate( iBeginRight, iEndRight, vector_type::zeros() ) / n;
-	
-	// call other functions that expects the centroids, see code above
-	return estimateScale_3D3D( iBeginLeft, iEndLeft, iBeginRight, iEndRight, leftCentroid, rightCentroid );
+	typedef typename std::iterator_traits< InputIterator >::value_type::value_type value_type;
+
+	assert( std::distance( iBeginLeft, iEndLeft ) == std::distance( iBeginRight, iEndRight ) );
+
+	// centroids and sums of squares in a single pass
+	AbsoluteOrientationAccumulator< value_type > accumulator;
+	accumulator.addRange( iBeginLeft, iEndLeft, iBeginRight );
+	assert( accumulator.size() > 2u );
+	return accumulator.estimateScale();
 }
 
 } } } // namespace Ubitrack::Algorithm::PoseEstimation3D3D
@@ -43,10 +43,29 @@ namespace Ubitrack { namespace Algorithm { namespace PoseEstimation6D6D {
 
 namespace {
 
+/// @internal writes the relative poses of eye and hand for the same pair
+template< typename EyeWriter, typename HandWriter >
+struct pair_pose_writer
+{
+	EyeWriter& eyeWriter;
+	HandWriter& handWriter;
+
+	pair_pose_writer( EyeWriter& eye, HandWriter& hand )
+		: eyeWriter( eye )
+		, handWriter( hand )
+	{}
+
+	void operator()( const std::size_t i, const std::size_t j )
+	{
+		eyeWriter( i, j );
+		handWriter( i, j );
+	}
+};
+
 template< bool use_all_pairs, typename T, typename InputIterator, typename OutputIterator >
 void pose6D_selection_impl( const InputIterator itBeginEye, const InputIterator itEndEye,
 	const InputIterator itBeginHand, const InputIterator itEndHand,
-	const std::size_t n_select, OutputIterator itEye, OutputIterator itHand )
+	const std::size_t n_select, const T minAngle, OutputIterator itEye, OutputIterator itHand )
 {
 	typedef Ubitrack::Math::Vector< T, 6 > pose_type;
 	typedef typename Ubitrack::Util::container_traits< OutputIterator >::value_type output_type;
@@ -60,13 +79,25 @@ void pose6D_selection_impl( const InputIterator itBeginEye, const InputIterator
 	const std::size_t m = use_all_pairs ? (n*n_in)/2 : n;
 	
 	std::vector< pose_type > dualA; // <- paper from Daniilidis uses a and b to specify dual quaternions
-	{ // set the first dual quaternion from input differences
-		dualA.reserve( m );
-		generate_relative_pose6D_impl< use_all_pairs, true >( itBeginEye, itEndEye, std::back_inserter( dualA ) );
-	}
-	
 	std::vector< pose_type > dualB;  // <- paper from Daniilidis uses a and b to specify dual quaternions
+	if( use_all_pairs && minAngle > 0 )
+	{ // only pairs with enough rotation between the eye poses, found without generating all pairs
+		typedef std::back_insert_iterator< std::vector< pose_type > > insert_iterator;
+		typedef relative_pose_writer< true, InputIterator, insert_iterator > eye_writer;
+		typedef relative_pose_writer< false, InputIterator, insert_iterator > hand_writer;
+		eye_writer eyeWriter( itBeginEye, std::back_inserter( dualA ) );
+		hand_writer handWriter( itBeginHand, std::back_inserter( dualB ) );
+		pair_pose_writer< eye_writer, hand_writer > writer( eyeWriter, handWriter );
+		RotationPairIndex< T >( itBeginEye, itEndEye ).forEachDistantPair( minAngle, writer );
+		if( dualA.empty() )
+			return;
+	}
+	else
 	{
+		// set the first dual quaternion from input differences
+		dualA.reserve( m );
+		generate_relative_pose6D_impl< use_all_pairs, true >( itBeginEye, itEndEye, std::back_inserter( dualA ) );
+
 		dualB.reserve( m );
 		generate_relative_pose6D_impl< use_all_pairs, false >( itBeginHand, itEndHand, std::back_inserter( dualB ) );
 	}
@@ -77,7 +108,7 @@ void pose6D_selection_impl( const InputIterator itBeginEye, const InputIterator
 	}
 	
 
-	const std::size_t n_cluster( std::min( n, n_select ) );
+	const std::size_t n_cluster( std::min( std::min( n, n_select ), dualA.size() ) );
 	
 	std::vector< pose_type > means;
 	means.reserve( n_cluster );
@@ -135,12 +166,13 @@ UBITRACK_EXPORT void select_6DPoses( const std::vector< Math::Pose >& eyes
 	, const std::vector< Math::Pose >& hands
 	, const std::size_t select
 	, std::vector< Math::Pose >& eyesOut
-	, std::vector< Math::Pose >& handsOut  )
+	, std::vector< Math::Pose >& handsOut
+	, const double minAngle )
 {
 	eyesOut.reserve( select );
 	handsOut.reserve( select );
 	
-	pose6D_selection_impl< true, double >( eyes.begin(), eyes.end(), hands.begin(), hands.end(), select, std::back_inserter( eyesOut ), std::back_inserter( handsOut ) );
+	pose6D_selection_impl< true, double >( eyes.begin(), eyes.end(), hands.begin(), hands.end(), select, minAngle, std::back_inserter( eyesOut ), std::back_inserter( handsOut ) );
 	
 }
 
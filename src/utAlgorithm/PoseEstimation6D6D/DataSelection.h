@@ -42,6 +42,9 @@
 #include <utMath/Stochastic/k_means.h> // copy_probability, k_means
 
 #include <vector>
+#include <utility> // std::pair
+#include <algorithm> // std::sort
+#include <cmath>
 
 namespace Ubitrack{ namespace Math {
 
@@ -282,7 +285,7 @@ struct hemisphere_alignment
 	typedef pose_type result_type;
 
 	template< typename pose_in >
-	void operator()( const pose_in & pose )const
+	result_type operator()( const pose_in & pose )const
 	{
 		UBITRACK_STATIC_ASSERT( (false), NO_MATCHING_SPECIALIZATION_AVALIABLE );
 		return result_type();
@@ -295,7 +298,7 @@ struct hemisphere_alignment< Math::Vector< T, 6 >, true >
 	typedef Math::Vector< T, 6 > result_type;
 
 	template< typename pose_in >
-	void operator()( const pose_in & pose )const
+	result_type operator()( const pose_in & pose )const
 	{
 		UBITRACK_STATIC_ASSERT( (false), NO_MATCHING_POSE_AVAILABLE );
 		return result_type();
@@ -550,6 +553,209 @@ void generate_relative_pose6D_impl( const InputIterator itBegin, const InputIter
 	}
 }
 
+/**
+ * @brief A spatial index over the rotations of a sequence of poses that enumerates the pairs of poses
+ * whose relative rotation has at least a given angle, without testing all pairs.
+ *
+ * The rotations are stored as unit quaternions with non-negative real part in the buckets of a regular
+ * grid. The relative rotation angle \c a of two poses follows from their quaternions as
+ * <tt>cos( a / 2 ) = | q_i . q_j |</tt>, i.e. from the smaller chord <tt>min( | q_i - q_j |, | q_i + q_j | )</tt>.
+ * For each pair of buckets, the chords between their bounding boxes decide whether all pairs are distant,
+ * which are emitted without further tests, or none, which are skipped. Only pairs of buckets on the
+ * boundary are tested pair by pair. Building the index costs O(N log N), enumerating the pairs is
+ * proportional to the number of emitted pairs plus the pairs near the boundary.
+ *
+ * @tparam T precision of the stored quaternions
+ */
+template< typename T >
+class RotationPairIndex
+{
+public:
+	/// type of an emitted pair of pose indices, the smaller index first
+	typedef std::pair< std::size_t, std::size_t > pair_type;
+
+	/// builds the index over a sequence of \c Math::Pose
+	template< typename InputIterator >
+	RotationPairIndex( const InputIterator itBegin, const InputIterator itEnd )
+	{
+		const std::size_t n = std::distance( itBegin, itEnd );
+		m_rotations.reserve( n );
+		for( InputIterator it = itBegin; it != itEnd; ++it )
+		{
+			const Math::Quaternion& q = it->rotation();
+			const T s = q.w() < 0 ? T( -1 ) : T( 1 );
+			m_rotations.push_back( Math::Vector< T, 4 >( s * q.x(), s * q.y(), s * q.z(), s * q.w() ) );
+		}
+
+		// about 16 rotations per bucket, the unit sphere fills ~1.2 g^3 of the g^4 cells
+		const std::size_t g = std::max< std::size_t >( 1, static_cast< std::size_t >( std::ceil( std::pow( n / 20.0, 1.0 / 3.0 ) ) ) );
+		std::vector< std::pair< std::size_t, std::size_t > > keys( n );
+		for( std::size_t i = 0; i < n; ++i )
+		{
+			std::size_t key = 0;
+			for( std::size_t k = 0; k < 4; ++k )
+			{
+				const std::size_t c = static_cast< std::size_t >( ( m_rotations[ i ][ k ] + 1 ) * 0.5 * g );
+				key = key * g + std::min( c, g - 1 );
+			}
+			keys[ i ] = std::make_pair( key, i );
+		}
+		std::sort( keys.begin(), keys.end() );
+
+		// reorder the rotations by bucket and compute the bounding boxes
+		std::vector< Math::Vector< T, 4 > > sorted;
+		sorted.reserve( n );
+		m_indices.reserve( n );
+		for( std::size_t i = 0; i < n; ++i )
+		{
+			if( i == 0 || keys[ i ].first != keys[ i - 1 ].first )
+			{
+				Bucket bucket;
+				bucket.begin = i;
+				bucket.lower = bucket.upper = m_rotations[ keys[ i ].second ];
+				m_buckets.push_back( bucket );
+			}
+			Bucket& bucket = m_buckets.back();
+			const Math::Vector< T, 4 >& q = m_rotations[ keys[ i ].second ];
+			for( std::size_t k = 0; k < 4; ++k )
+			{
+				bucket.lower[ k ] = std::min( bucket.lower[ k ], q[ k ] );
+				bucket.upper[ k ] = std::max( bucket.upper[ k ], q[ k ] );
+			}
+			bucket.end = i + 1;
+			sorted.push_back( q );
+			m_indices.push_back( keys[ i ].second );
+		}
+		m_rotations.swap( sorted );
+	}
+
+	/**
+	 * calls \c f( i, j ) with i < j for all pairs of poses whose relative rotation angle is at least \c minAngle.
+	 * The pairs are grouped by bucket, not sorted.
+	 */
+	template< typename Function >
+	void forEachDistantPair( const T minAngle, Function& f ) const
+	{
+		// angle >= minAngle <=> | q_i . q_j | <= cos( minAngle / 2 ) <=> both chords >= chord
+		const T maxDot = std::cos( minAngle / 2 );
+		const T chord = std::sqrt( std::max< T >( 0, 2 - 2 * maxDot ) );
+
+		for( std::size_t a = 0; a < m_buckets.size(); ++a )
+			for( std::size_t b = a; b < m_buckets.size(); ++b )
+			{
+				const Bucket& ba = m_buckets[ a ];
+				const Bucket& bb = m_buckets[ b ];
+
+				T minSame = 0, minOpposite = 0, maxSame = 0, maxOpposite = 0;
+				for( std::size_t k = 0; k < 4; ++k )
+				{
+					const T dSame = std::max< T >( 0, std::max( ba.lower[ k ] - bb.upper[ k ], bb.lower[ k ] - ba.upper[ k ] ) );
+					const T dOpposite = std::max< T >( 0, std::max( ba.lower[ k ] + bb.lower[ k ], -ba.upper[ k ] - bb.upper[ k ] ) );
+					const T eSame = std::max( ba.upper[ k ] - bb.lower[ k ], bb.upper[ k ] - ba.lower[ k ] );
+					const T eOpposite = std::max( std::fabs( ba.upper[ k ] + bb.upper[ k ] ), std::fabs( ba.lower[ k ] + bb.lower[ k ] ) );
+					minSame += dSame * dSame;
+					minOpposite += dOpposite * dOpposite;
+					maxSame += eSame * eSame;
+					maxOpposite += eOpposite * eOpposite;
+				}
+
+				// all pairs closer than the threshold
+				if( maxSame < chord * chord || maxOpposite < chord * chord )
+					continue;
+
+				const bool bAllDistant = minSame >= chord * chord && minOpposite >= chord * chord;
+				for( std::size_t i = ba.begin; i < ba.end; ++i )
+					for( std::size_t j = ( a == b ? i + 1 : bb.begin ); j < bb.end; ++j )
+					{
+						if( !bAllDistant )
+						{
+							const Math::Vector< T, 4 >& qi = m_rotations[ i ];
+							const Math::Vector< T, 4 >& qj = m_rotations[ j ];
+							const T dot = qi[ 0 ] * qj[ 0 ] + qi[ 1 ] * qj[ 1 ] + qi[ 2 ] * qj[ 2 ] + qi[ 3 ] * qj[ 3 ];
+							if( std::fabs( dot ) > maxDot )
+								continue;
+						}
+						f( std::min( m_indices[ i ], m_indices[ j ] ), std::max( m_indices[ i ], m_indices[ j ] ) );
+					}
+			}
+	}
+
+	/// writes all pairs of poses whose relative rotation angle is at least \c minAngle as \c pair_type to \c itOut
+	template< typename OutputIterator >
+	OutputIterator distantPairs( const T minAngle, OutputIterator itOut ) const
+	{
+		PairWriter< OutputIterator > writer( itOut );
+		forEachDistantPair( minAngle, writer );
+		return writer.itOut;
+	}
+
+protected:
+	/// @internal a bucket of the grid, the rotations [ begin, end ) with their bounding box
+	struct Bucket
+	{
+		std::size_t begin;
+		std::size_t end;
+		Math::Vector< T, 4 > lower;
+		Math::Vector< T, 4 > upper;
+	};
+
+	/// @internal writes the pairs to an output iterator
+	template< typename OutputIterator >
+	struct PairWriter
+	{
+		OutputIterator itOut;
+
+		PairWriter( OutputIterator it )
+			: itOut( it )
+		{}
+
+		void operator()( const std::size_t i, const std::size_t j )
+		{ *itOut++ = pair_type( i, j ); }
+	};
+
+	/// quaternions as ( x, y, z, w ), sorted by bucket
+	std::vector< Math::Vector< T, 4 > > m_rotations;
+
+	/// index of the pose of each rotation
+	std::vector< std::size_t > m_indices;
+
+	/// the non-empty buckets
+	std::vector< Bucket > m_buckets;
+};
+
+/// @internal writes the relative poses of the pairs of a \c RotationPairIndex to an output iterator
+template< bool direction, typename RandomAccessIterator, typename OutputIterator >
+struct relative_pose_writer
+{
+	typedef typename Ubitrack::Util::container_traits< OutputIterator >::value_type desired_pose_type;
+
+	RandomAccessIterator itBegin;
+	OutputIterator itOut;
+
+	relative_pose_writer( const RandomAccessIterator itPoses, const OutputIterator it )
+		: itBegin( itPoses )
+		, itOut( it )
+	{}
+
+	void operator()( const std::size_t i, const std::size_t j )
+	{ *itOut++ = Ubitrack::Math::relative_pose< desired_pose_type, direction >()( itBegin[ j ], itBegin[ i ] ); }
+};
+
+/**
+ * @internal Streams the relative poses of all pairs ( i < j ) whose relative rotation angle is at least \c minAngle,
+ * found with a \c RotationPairIndex, in the same form as \c generate_relative_pose6D_impl< true, direction >.
+ * The pairs are written grouped by bucket, not in the order of \c generate_relative_pose6D_impl.
+ */
+template< bool direction, typename RandomAccessIterator, typename OutputIterator >
+OutputIterator generate_distant_relative_pose6D_impl( const RandomAccessIterator itBegin, const RandomAccessIterator itEnd,
+	const double minAngle, OutputIterator itOut )
+{
+	const RotationPairIndex< double > index( itBegin, itEnd );
+	relative_pose_writer< direction, RandomAccessIterator, OutputIterator > writer( itBegin, itOut );
+	index.forEachDistantPair( minAngle, writer );
+	return writer.itOut;
+}
+
 /**
  * @ingroup calibration tracking_algorithms
  * @brief An algorithm to determine adequate relative poses as an input 
@@ -596,10 +802,13 @@ void generate_relative_pose6D_impl( const InputIterator itBegin, const InputIter
  * @param select amount of relative poses to select
  * @param eyesOut contains n ( n=select) \b relative \b 6D \b poses from the from the input data
  * @param handsOut contains n ( n=select) corresponding \b relative \b 6D \b poses from the input data
+ * @param minAngle if positive, only pairs of poses whose relative rotation has at least this angle ( in radians )
+ * are candidates. They are found with a \c RotationPairIndex instead of generating all pairs.
  */
 UBITRACK_EXPORT void select_6DPoses( const std::vector< Math::Pose >& eyes, const std::vector< Math::Pose >& hands
 	, const std::size_t select
-	, std::vector< Math::Pose >& eyesOut, std::vector< Math::Pose >& handsOut );
+	, std::vector< Math::Pose >& eyesOut, std::vector< Math::Pose >& handsOut
+	, const double minAngle = 0 );
 	
 
 UBITRACK_EXPORT void generate_relative_6DPoses( const std::vector< Math::Pose >& poses
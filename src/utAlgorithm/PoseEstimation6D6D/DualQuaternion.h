@@ -37,6 +37,8 @@
 
 #include <utCore.h>
 #include <utMath/Pose.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
 
 #include <vector>
 
@@ -102,6 +104,83 @@ UBITRACK_EXPORT bool estimatePose6D_6D6D(  const std::vector< Math::Pose >& eyes
 /// @internal overloaded function performing a hand-eye calibration that takes dual quaternions (as 8-vector) assuming them to be relative poses.
 UBITRACK_EXPORT bool estimatePose6D_6D6D( const std::vector< Math::Vector< double, 8 > >& eyes, Math::Pose& pose,
 	const std::vector< Math::Vector< double, 8 > >& hands );
+
+
+/**
+ * @ingroup calibration tracking_algorithms
+ * @brief Accumulates the dual quaternion hand-eye equations of relative motions.
+ *
+ * Each pair of relative motions contributes six rows to the 6n-by-8 matrix \c T of
+ * Daniilidis. Instead of stacking \c T, the accumulator keeps the 8x8 matrix
+ * <tt>T^T T</tt>, whose eigenvectors to the two smallest eigenvalues are the right singular
+ * vectors that \c estimatePose6D_6D6D needs. A pair is added or removed in constant time
+ * and the solution takes a fixed-size 8x8 eigen decomposition, independent of the number of
+ * pairs, e.g. to re-solve subsets of the motions for a cross-validation.
+ *
+ * Removing pairs subtracts their contribution, so the rounding errors of large pairs remain.
+ * As the normal matrix squares the singular values, the solution loses some precision against
+ * the SVD of \c T for nearly degenerate motions.
+ *
+ * @code
+ * DualQuaternionAccumulator equations;
+ * for( std::size_t i = 0; i < dualEyes.size(); ++i )
+ *     equations.add( dualEyes[ i ], dualHands[ i ] );
+ * Math::Pose pose;
+ * bool ok = equations.estimatePose( pose );
+ * @endcode
+ */
+class UBITRACK_EXPORT DualQuaternionAccumulator
+{
+public:
+	DualQuaternionAccumulator();
+
+	/** removes all pairs */
+	void reset();
+
+	/**
+	 * adds a pair of relative motions
+	 * @param a relative motion of the eye as dual quaternion (q | q')
+	 * @param b corresponding relative motion of the hand as dual quaternion (q | q')
+	 */
+	void add( const Math::Vector< double, 8 >& a, const Math::Vector< double, 8 >& b );
+
+	/** adds a pair of relative motions given as poses */
+	void add( const Math::Pose& a, const Math::Pose& b );
+
+	/** removes a pair that was added before */
+	void remove( const Math::Vector< double, 8 >& a, const Math::Vector< double, 8 >& b );
+
+	/** adds the pairs of another accumulator */
+	DualQuaternionAccumulator& operator+=( const DualQuaternionAccumulator& other );
+
+	/** removes the pairs of another accumulator, which must be a subset */
+	DualQuaternionAccumulator& operator-=( const DualQuaternionAccumulator& other );
+
+	/** returns the number of pairs */
+	std::size_t size() const
+	{ return m_size; }
+
+	/** returns the upper triangle of T^T T */
+	const Math::Matrix< double, 8, 8 >& normalMatrix() const
+	{ return m_normalMatrix; }
+
+	/**
+	 * solves for the pose, with the same criteria as \c estimatePose6D_6D6D
+	 * @param pose the pose, if a solution can be found
+	 * @return a flag that signs if a solution was found
+	 */
+	bool estimatePose( Math::Pose& pose ) const;
+
+protected:
+	/** adds the pair with the given sign */
+	void accumulate( const Math::Vector< double, 8 >& a, const Math::Vector< double, 8 >& b, double sign );
+
+	/** upper triangle of T^T T */
+	Math::Matrix< double, 8, 8 > m_normalMatrix;
+
+	/** number of pairs */
+	std::size_t m_size;
+};
 	
 }}} // namespace Ubitrack::Algorithm::PoseEstimation6D6D
 
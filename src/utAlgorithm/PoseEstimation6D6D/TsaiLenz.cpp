@@ -41,7 +41,9 @@
 #include <log4cpp/Category.hh>
 #include <utUtil/Exception.h>
 #include <utUtil/Logging.h>
+#include <utUtil/Progress.h>
 #include <utMath/MatrixOperations.h>
+#include <utMath/FixedDecomposition.h>
 
 //shortcuts to namespaces
 namespace ublas = boost::numeric::ublas;
@@ -458,36 +460,138 @@ Math::Pose performHandEyeCalibration ( const std::vector< Math::Matrix< double,
 }
 
 
-void fillTransformationVectors( TransformCont<double>& tc, const std::vector<Math::Pose>& hand, const std::vector<Math::Pose>& eye, bool bUseAllPairs )
+TsaiLenzAccumulator::TsaiLenzAccumulator()
+	: m_rotationMatrix( Math::Matrix< double, 3, 3 >::zeros() )
+	, m_rotationOffset( Math::Vector< double, 3 >::zeros() )
+	, m_normalMatrix( Math::Matrix< double, 3, 3 >::zeros() )
+	, m_normalOffset( Math::Vector< double, 3 >::zeros() )
+	, m_normalRotation( Math::Matrix< double, 3, 9 >::zeros() )
 {
-	Math::Matrix< double, 4, 4 > hij;
-	Math::Matrix< double, 4, 4 > hi;
-	Math::Matrix< double, 4, 4 > hj;
-	const std::size_t n_hands( hand.size() );
-	for( std::size_t i( 0 ) ; i<(n_hands-1); ++i )
+}
+
+
+void TsaiLenzAccumulator::add( const Math::Pose& a, const Math::Pose& b )
+{
+	// rotation: accumulate the normal equations of skew( p_a + p_b ) p_x = p_b - p_a, signs as in OnlineRotHec
+	const Math::Quaternion& qa( a.rotation() );
+	const Math::Quaternion& qb( b.rotation() );
+	const double na = qa.w() < 0 ? -1 : 1;
+	const double nb = qb.w() < 0 ? -1 : 1;
+	const Math::Vector< double, 3 > sum( qa.x() * na + qb.x() * nb, qa.y() * na + qb.y() * nb, qa.z() * na + qb.z() * nb );
+	const Math::Vector< double, 3 > diff( qb.x() * nb - qa.x() * na, qb.y() * nb - qa.y() * na, qb.z() * nb - qa.z() * na );
+	const double s2 = ublas::inner_prod( sum, sum );
+	for ( std::size_t r = 0; r < 3; r++ )
+		for ( std::size_t c = 0; c < 3; c++ )
+			m_rotationMatrix( r, c ) += ( r == c ? s2 : 0 ) - sum( r ) * sum( c );
+
+	// skew( s )^T d = d x s
+	m_rotationOffset( 0 ) += diff( 1 ) * sum( 2 ) - diff( 2 ) * sum( 1 );
+	m_rotationOffset( 1 ) += diff( 2 ) * sum( 0 ) - diff( 0 ) * sum( 2 );
+	m_rotationOffset( 2 ) += diff( 0 ) * sum( 1 ) - diff( 1 ) * sum( 0 );
+
+	// translation: accumulate the normal equations of ( R_a - I ) t_x = R_x t_b - t_a
+	Math::Matrix< double, 3, 3 > m;
+	a.rotation().toMatrix( m );
+	for ( std::size_t i = 0; i < 3; i++ )
+		m( i, i ) -= 1;
+
+	const Math::Vector< double, 3 >& ta( a.translation() );
+	const Math::Vector< double, 3 >& tb( b.translation() );
+	for ( std::size_t r = 0; r < 3; r++ )
 	{
-		const std::size_t to = bUseAllPairs ? n_hands : i + 2;
-		for( std::size_t k( i+1 ); k<to; ++k )
-		{
-			//first we compute the hg
-			hi = Math::Matrix< double, 4, 4 >(hand.at(i));
-			hj = Math::Matrix< double, 4, 4 >(hand.at(k));
+		for ( std::size_t c = 0; c < 3; c++ )
+			m_normalMatrix( r, c ) += m( 0, r ) * m( 0, c ) + m( 1, r ) * m( 1, c ) + m( 2, r ) * m( 2, c );
+		m_normalOffset( r ) += m( 0, r ) * ta( 0 ) + m( 1, r ) * ta( 1 ) + m( 2, r ) * ta( 2 );
+		for ( std::size_t k = 0; k < 3; k++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+				m_normalRotation( r, 3 * k + j ) += m( k, r ) * tb( j );
+	}
+}
 
-			hij = computeTransformation(hi, hj, 0);
-			tc.push_back_hg(hij);
 
-			//second we compute the hc
-			hi =  Math::Matrix< double, 4, 4 >(eye.at(i));
-			hj =  Math::Matrix< double, 4, 4 >(eye.at(k));
+TsaiLenzAccumulator& TsaiLenzAccumulator::operator+=( const TsaiLenzAccumulator& other )
+{
+	m_rotationMatrix += other.m_rotationMatrix;
+	m_rotationOffset += other.m_rotationOffset;
+	m_normalMatrix += other.m_normalMatrix;
+	m_normalOffset += other.m_normalOffset;
+	m_normalRotation += other.m_normalRotation;
+	return *this;
+}
 
-			hij = computeTransformation( hi, hj, 1 );
-			tc.push_back_hc(hij);
-		}
+
+Math::Pose TsaiLenzAccumulator::computeResult() const
+{
+	Math::Vector< double, 3 > p( m_rotationOffset );
+	if ( !Math::choleskySolve( m_rotationMatrix, p ) )
+		return Math::Pose( Math::Quaternion(), Math::Vector< double, 3 >::zeros() );
+
+	// same conversion as in OnlineRotHec::computeResult
+	const double n = ublas::norm_2( p );
+	const double s = 1.0 / std::sqrt( 1.0 + n * n );
+	const Math::Quaternion rotation( p( 0 ) * s, p( 1 ) * s, p( 2 ) * s, s );
+	Math::Matrix< double, 3, 3 > rx;
+	rotation.toMatrix( rx );
+
+	// right hand side sum ( R_a - I )^T ( R_x t_b - t_a ) with the current rotation
+	Math::Vector< double, 3 > translation;
+	for ( std::size_t r = 0; r < 3; r++ )
+	{
+		double sum = -m_normalOffset( r );
+		for ( std::size_t k = 0; k < 3; k++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+				sum += m_normalRotation( r, 3 * k + j ) * rx( k, j );
+		translation( r ) = sum;
 	}
+
+	if ( !Math::choleskySolve( m_normalMatrix, translation ) )
+		translation = Math::Vector< double, 3 >::zeros();
+
+	return Math::Pose( rotation, translation );
 }
 
 
-Math::Pose performHandEyeCalibration ( const std::vector< Math::Pose >& hand,  const std::vector< Math::Pose >& eye, bool bUseAllPairs )
+/** \internal adds the pairs of relative motions whose first pose lies in [ begin, end ) */
+struct HandEyePairTask
+{
+	HandEyePairTask( const std::vector< Math::Pose >& hand, const std::vector< Math::Pose >& invHand
+		, const std::vector< Math::Pose >& eye, const std::vector< Math::Pose >& invEye
+		, const bool bUseAllPairs, std::vector< TsaiLenzAccumulator >& accumulators )
+		: m_hand( hand )
+		, m_invHand( invHand )
+		, m_eye( eye )
+		, m_invEye( invEye )
+		, m_bUseAllPairs( bUseAllPairs )
+		, m_accumulators( accumulators )
+		, m_progress( Util::ProgressContext::current() )
+	{}
+
+	void operator()( const std::size_t begin, const std::size_t end ) const
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+		{
+			m_progress.check();
+			// same relative motions as fillTransformationVectors: inv( H_k ) H_i and E_k inv( E_i )
+			const std::size_t to = m_bUseAllPairs ? m_hand.size() : i + 2;
+			for ( std::size_t k = i + 1; k < to; k++ )
+				m_accumulators[ i ].add( m_invHand[ k ] * m_hand[ i ], m_eye[ k ] * m_invEye[ i ] );
+		}
+	}
+
+	const std::vector< Math::Pose >& m_hand;
+	const std::vector< Math::Pose >& m_invHand;
+	const std::vector< Math::Pose >& m_eye;
+	const std::vector< Math::Pose >& m_invEye;
+	const bool m_bUseAllPairs;
+	std::vector< TsaiLenzAccumulator >& m_accumulators;
+
+	/** the context of the calling thread, checked by the threads of the executor */
+	const Util::ProgressContext m_progress;
+};
+
+
+Math::Pose performHandEyeCalibration ( const std::vector< Math::Pose >& hand,  const std::vector< Math::Pose >& eye, bool bUseAllPairs,
+	const Math::ListExecutor& executor )
 {
 	static log4cpp::Category& logger(log4cpp::Category::getInstance( "Ubitrack.Calibration.HandEyeCalibration" )); 
 	const std::size_t n_eyes( eye.size() );
@@ -498,21 +602,29 @@ Math::Pose performHandEyeCalibration ( const std::vector< Math::Pose >& hand,  c
 	}
 
 	if( n_eyes <= 2 )
+		return Math::Pose( Math::Quaternion(), Math::Vector< double, 3 >( 0, 0, 0 ) );
+
+	// inverses once per pose instead of once per pair
+	std::vector< Math::Pose > invHand( n_eyes );
+	std::vector< Math::Pose > invEye( n_eyes );
+	for( std::size_t i( 0 ); i < n_eyes; ++i )
 	{
-		Math::Vector< double, 3 >* v = new Math::Vector< double, 3 >( 0, 0, 0 );
-		Math::Quaternion* q = new Math::Quaternion();
-		return Math::Pose( *q, *v);
+		invHand[ i ] = ~hand[ i ];
+		invEye[ i ] = ~eye[ i ];
 	}
 
-	TransformCont< double > tc;
-
-	tc.setNumber( n_eyes, bUseAllPairs );
-
-	fillTransformationVectors( tc, hand, eye, bUseAllPairs );			//readies values //ai = eye, bi = hand
-	Math::Matrix< double, 3, 3 > rcg = computePcg< double >( tc );									//returns also Rcg
-	Math::Vector< double, 3 > tcg = computeTcg( tc, rcg );
-
-	return Math::Pose(Math::Quaternion( rcg ), tcg);
+	// one accumulator per first pose, summed in a fixed order for reproducible results
+	std::vector< TsaiLenzAccumulator > accumulators( n_eyes - 1 );
+	const HandEyePairTask task( hand, invHand, eye, invEye, bUseAllPairs, accumulators );
+	if ( executor.empty() )
+		task( 0, n_eyes - 1 );
+	else
+		executor( n_eyes - 1, task );
+
+	TsaiLenzAccumulator result;
+	for( std::size_t i( 0 ); i < n_eyes - 1; ++i )
+		result += accumulators[ i ];
+	return result.computeResult();
 }
 
 }}} // namespace Ubitrack::Algorithm::PoseEstimation6D6D
@@ -37,7 +37,9 @@
 
 #include <utCore.h>
 #include <utMath/Matrix.h>
+#include <utMath/Vector.h>
 #include <utMath/Pose.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
 #include <vector>
 
 namespace Ubitrack { namespace Algorithm { namespace PoseEstimation6D6D {
@@ -58,7 +60,65 @@ UBITRACK_EXPORT Math::Pose performHandEyeCalibration ( const std::vector< Math::
 
 UBITRACK_EXPORT Math::Pose performHandEyeCalibration ( const std::vector< Math::Matrix< double, 4, 4 > >& hand,  const std::vector< Math::Matrix< double, 4, 4 > >& eye, bool bUseAllPairs = true );
 
-UBITRACK_EXPORT Math::Pose performHandEyeCalibration ( const std::vector< Math::Pose >& hand,  const std::vector< Math::Pose >& eye, bool bUseAllPairs = true );
+/**
+ * @ingroup tracking_algorithms
+ * Overload for poses, which works on the quaternions and translations directly.
+ *
+ * The relative motions are computed on the fly and added to a \c TsaiLenzAccumulator, so the memory
+ * does not depend on the number of pairs. With \c bUseAllPairs, the pairs of each first pose can be
+ * distributed over threads by a \c Math::ListExecutor. Returns the identity if the rotation axes of
+ * the relative motions do not span at least two directions.
+ */
+UBITRACK_EXPORT Math::Pose performHandEyeCalibration ( const std::vector< Math::Pose >& hand,  const std::vector< Math::Pose >& eye, bool bUseAllPairs = true,
+	const Math::ListExecutor& executor = Math::ListExecutor() );
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Normal equations of the Tsai-Lenz hand-eye calibration, accumulated pair by pair.
+ *
+ * Given pairs of relative motions a and b, the pose x with ax = xb is computed:
+ * - the rotation solves <tt>skew( p_a + p_b ) p_x = p_b - p_a</tt> with the imaginary parts \c p_a,
+ *   \c p_b of the quaternions and \c p_x that of x divided by its real part,
+ * - the translation solves <tt>( R_a - I ) t_x = R_x t_b - t_a</tt>.
+ *
+ * Each pair adds its rows to the 3x3 normal equations of both problems. For the translation, the
+ * unknown \c R_x is factored out of the accumulated sums, so all pairs are added in a single pass
+ * before the rotation is known. Accumulators of disjoint sets of pairs are combined by \c operator+=.
+ */
+class UBITRACK_EXPORT TsaiLenzAccumulator
+{
+public:
+	TsaiLenzAccumulator();
+
+	/** adds a pair of relative motions */
+	void add( const Math::Pose& a, const Math::Pose& b );
+
+	/** adds the pairs of another accumulator */
+	TsaiLenzAccumulator& operator+=( const TsaiLenzAccumulator& other );
+
+	/**
+	 * returns the transformation x, the identity until the rotation axes of the pairs span at
+	 * least two directions
+	 */
+	Math::Pose computeResult() const;
+
+protected:
+	/** sum of skew( p_a + p_b )^T skew( p_a + p_b ) */
+	Math::Matrix< double, 3, 3 > m_rotationMatrix;
+
+	/** sum of skew( p_a + p_b )^T ( p_b - p_a ) */
+	Math::Vector< double, 3 > m_rotationOffset;
+
+	/** sum of ( R_a - I )^T ( R_a - I ) */
+	Math::Matrix< double, 3, 3 > m_normalMatrix;
+
+	/** sum of ( R_a - I )^T t_a */
+	Math::Vector< double, 3 > m_normalOffset;
+
+	/** sum of ( R_a - I )( k, r ) t_b( j ), at [ r ][ 3 * k + j ] */
+	Math::Matrix< double, 3, 9 > m_normalRotation;
+};
 
 
 }}} // namespace Ubitrack::Algorithm::PoseEstimation6D6D
@@ -0,0 +1,619 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Implementation of the sparse pose graph optimization
+ *
+ * The normal equations and the cholesky factor are stored as 6x6 blocks: one diagonal block per
+ * variable node and one block per non-zero below the diagonal, stored column by column in the
+ * elimination order.
+ */
+
+#include "PoseGraph.h"
+
+#include <set>
+#include <cmath>
+#include <algorithm>
+
+#include <utMath/LieGroups.h>
+#include <utMath/Optimization/RobustLoss.h>
+#include <utUtil/Exception.h>
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Algorithm.PoseGraph" );
+
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+typedef Ubitrack::Math::Matrix< double, 3, 3 > Matrix3;
+typedef Ubitrack::Math::Vector< double, 3 > Vector3;
+
+const std::size_t npos = std::size_t( -1 );
+
+/** lower cholesky factor of a row-major 6x6 matrix in place, false if not positive definite */
+bool cholesky6( double* a )
+{
+	for ( std::size_t j = 0; j < 6; j++ )
+	{
+		double d = a[ j * 6 + j ];
+		for ( std::size_t k = 0; k < j; k++ )
+			d -= a[ j * 6 + k ] * a[ j * 6 + k ];
+		if ( !( d > 0 ) )
+			return false;
+		d = std::sqrt( d );
+		a[ j * 6 + j ] = d;
+		for ( std::size_t i = j + 1; i < 6; i++ )
+		{
+			double s = a[ i * 6 + j ];
+			for ( std::size_t k = 0; k < j; k++ )
+				s -= a[ i * 6 + k ] * a[ j * 6 + k ];
+			a[ i * 6 + j ] = s / d;
+		}
+		for ( std::size_t k = j + 1; k < 6; k++ )
+			a[ j * 6 + k ] = 0;
+	}
+	return true;
+}
+
+/** x = L^-1 x for a lower triangular L */
+void forwardSubstitute( const double* l, double* x )
+{
+	for ( std::size_t i = 0; i < 6; i++ )
+	{
+		double s = x[ i ];
+		for ( std::size_t k = 0; k < i; k++ )
+			s -= l[ i * 6 + k ] * x[ k ];
+		x[ i ] = s / l[ i * 6 + i ];
+	}
+}
+
+/** x = L^-T x for a lower triangular L */
+void backSubstitute( const double* l, double* x )
+{
+	for ( std::size_t i = 6; i-- > 0; )
+	{
+		double s = x[ i ];
+		for ( std::size_t k = i + 1; k < 6; k++ )
+			s -= l[ k * 6 + i ] * x[ k ];
+		x[ i ] = s / l[ i * 6 + i ];
+	}
+}
+
+/** c -= a * b^T for row-major 6x6 blocks */
+void subtractProductTransposed( const double* a, const double* b, double* c )
+{
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < 6; j++ )
+		{
+			double s = 0;
+			for ( std::size_t k = 0; k < 6; k++ )
+				s += a[ i * 6 + k ] * b[ j * 6 + k ];
+			c[ i * 6 + j ] -= s;
+		}
+}
+
+/** c += w a^T b for row-major 6x6 blocks */
+void addTransposedProduct( const double w, const double* a, const double* b, double* c )
+{
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < 6; j++ )
+		{
+			double s = 0;
+			for ( std::size_t k = 0; k < 6; k++ )
+				s += a[ k * 6 + i ] * b[ k * 6 + j ];
+			c[ i * 6 + j ] += w * s;
+		}
+}
+
+void setSkew( const Vector3& v, double* j, const std::size_t row, const std::size_t col )
+{
+	j[ ( row + 0 ) * 6 + col + 0 ] = 0;       j[ ( row + 0 ) * 6 + col + 1 ] = -v( 2 ); j[ ( row + 0 ) * 6 + col + 2 ] = v( 1 );
+	j[ ( row + 1 ) * 6 + col + 0 ] = v( 2 );  j[ ( row + 1 ) * 6 + col + 1 ] = 0;       j[ ( row + 1 ) * 6 + col + 2 ] = -v( 0 );
+	j[ ( row + 2 ) * 6 + col + 0 ] = -v( 1 ); j[ ( row + 2 ) * 6 + col + 1 ] = v( 0 );  j[ ( row + 2 ) * 6 + col + 2 ] = 0;
+}
+
+void setBlock( const Matrix3& m, const double f, double* j, const std::size_t row, const std::size_t col )
+{
+	for ( std::size_t r = 0; r < 3; r++ )
+		for ( std::size_t c = 0; c < 3; c++ )
+			j[ ( row + r ) * 6 + col + c ] = f * m( r, c );
+}
+
+/**
+ * unweighted residual of an edge and, if \c ji is given, its jacobians wrt. the increments
+ * ( dt, dr ) of both nodes, as row-major 6x6 blocks
+ */
+void edgeResidual( const Ubitrack::Math::Pose& measurement, const Ubitrack::Math::Pose& pi, const Ubitrack::Math::Pose& pj,
+	double* r, double* ji, double* jj )
+{
+	using Ubitrack::Math::Quaternion;
+	const Quaternion qiInv( ~pi.rotation() );
+	const Vector3 local( qiInv * Vector3( pj.translation() - pi.translation() ) );
+	const Vector3 phi( Ubitrack::Math::Lie::logSO3( Quaternion( ~measurement.rotation() * qiInv * pj.rotation() ) ) );
+	for ( std::size_t k = 0; k < 3; k++ )
+	{
+		r[ k ] = local( k ) - measurement.translation()( k );
+		r[ k + 3 ] = 0.5 * phi( k );
+	}
+	if ( !ji )
+		return;
+
+	Matrix3 riT;
+	qiInv.toMatrix( riT );
+	Matrix3 rjTri;
+	Quaternion( ~pj.rotation() * pi.rotation() ).toMatrix( rjTri );
+	Matrix3 jrInv;
+	Ubitrack::Math::Lie::SO3Terms< double >( phi ).inverseRightJacobian( jrInv );
+
+	std::fill( ji, ji + 36, 0.0 );
+	std::fill( jj, jj + 36, 0.0 );
+	setBlock( riT, -1, ji, 0, 0 );
+	setSkew( local, ji, 0, 3 );
+	setBlock( Matrix3( ublas::prod( jrInv, rjTri ) ), -0.5, ji, 3, 3 );
+	setBlock( riT, 1, jj, 0, 0 );
+	setBlock( jrInv, 0.5, jj, 3, 3 );
+}
+
+/** robust loss of a squared whitened residual \c s, and its weight */
+template< class Loss >
+double robustLoss( const Loss& loss, const double s, double& weight )
+{
+	weight = loss.weight( s );
+	return loss.loss( s );
+}
+
+double kernelLoss( const Ubitrack::Algorithm::PoseGraph::Parameters& params, const double s, double& weight )
+{
+	namespace Opt = Ubitrack::Math::Optimization;
+	switch ( params.kernel )
+	{
+	case Ubitrack::Algorithm::pgHuberKernel:
+		return robustLoss( Opt::HuberLoss( params.kernelWidth ), s, weight );
+	case Ubitrack::Algorithm::pgCauchyKernel:
+		return robustLoss( Opt::CauchyLoss( params.kernelWidth ), s, weight );
+	case Ubitrack::Algorithm::pgGemanMcClureKernel:
+		return robustLoss( Opt::GemanMcClureLoss( params.kernelWidth ), s, weight );
+	case Ubitrack::Algorithm::pgTukeyKernel:
+		return robustLoss( Opt::TukeyLoss( params.kernelWidth ), s, weight );
+	default:
+		weight = 1;
+		return s;
+	}
+}
+
+/** applies the increments of the variables to the poses */
+void applyIncrement( const std::vector< Ubitrack::Math::Pose >& poses, const std::vector< std::size_t >& variable,
+	const std::vector< double >& x, std::vector< Ubitrack::Math::Pose >& result )
+{
+	using Ubitrack::Math::Quaternion;
+	result = poses;
+	for ( std::size_t n = 0; n < poses.size(); n++ )
+		if ( variable[ n ] != npos )
+		{
+			const double* d = &x[ 6 * variable[ n ] ];
+			Quaternion q( poses[ n ].rotation() * Quaternion::fromLogarithm( Vector3( d[ 3 ], d[ 4 ], d[ 5 ] ) ) );
+			q.normalize();
+			result[ n ] = Ubitrack::Math::Pose( q, Vector3( poses[ n ].translation() + Vector3( d[ 0 ], d[ 1 ], d[ 2 ] ) ) );
+		}
+}
+
+} // anonymous namespace
+
+
+namespace Ubitrack { namespace Algorithm {
+
+PoseGraph::PoseGraph()
+	: m_bDirty( true )
+	, m_iterations( 0 )
+	, m_analyses( 0 )
+{}
+
+
+std::size_t PoseGraph::addNode( const Math::Pose& pose, bool fixed )
+{
+	m_poses.push_back( pose );
+	m_fixed.push_back( fixed );
+	m_bDirty = true;
+	return m_poses.size() - 1;
+}
+
+
+std::size_t PoseGraph::addEdge( std::size_t from, std::size_t to, const Math::ErrorPose& relative )
+{
+	if ( from >= m_poses.size() || to >= m_poses.size() || from == to )
+		UBITRACK_THROW( "Pose graph edge between invalid nodes" );
+
+	Edge edge;
+	edge.from = from;
+	edge.to = to;
+	edge.measurement = relative;
+
+	// whitening with the inverse of the cholesky factor of the covariance
+	Block l;
+	for ( std::size_t r = 0; r < 6; r++ )
+		for ( std::size_t c = 0; c < 6; c++ )
+			l.m[ r * 6 + c ] = relative.covariance()( r, c );
+	if ( !cholesky6( l.m ) )
+		UBITRACK_THROW( "Pose graph edge covariance is not positive definite" );
+	for ( std::size_t c = 0; c < 6; c++ )
+	{
+		double e[ 6 ] = { 0, 0, 0, 0, 0, 0 };
+		e[ c ] = 1;
+		forwardSubstitute( l.m, e );
+		for ( std::size_t r = 0; r < 6; r++ )
+			edge.whitening( r, c ) = e[ r ];
+	}
+	m_edges.push_back( edge );
+
+	// the factor structure can be kept if it already contains the block of the new edge
+	if ( !m_bDirty )
+	{
+		const std::size_t a = m_variable[ from ];
+		const std::size_t b = m_variable[ to ];
+		const std::size_t slot = ( a == npos || b == npos ) ? npos : blockSlot( a, b );
+		if ( a != npos && b != npos && slot == npos )
+			m_bDirty = true;
+		else
+			m_edgeSlot.push_back( slot );
+	}
+
+	return m_edges.size() - 1;
+}
+
+
+void PoseGraph::setFixed( std::size_t node, bool fixed )
+{
+	if ( m_fixed[ node ] != fixed )
+	{
+		m_fixed[ node ] = fixed;
+		m_bDirty = true;
+	}
+}
+
+
+void PoseGraph::analyze()
+{
+	const std::size_t nNodes = m_poses.size();
+	const bool bAnyFixed = std::find( m_fixed.begin(), m_fixed.end(), true ) != m_fixed.end();
+
+	// adjacency of the variable nodes
+	std::vector< std::set< std::size_t > > adjacency( nNodes );
+	std::vector< bool > isVariable( nNodes );
+	for ( std::size_t n = 0; n < nNodes; n++ )
+		isVariable[ n ] = !m_fixed[ n ] && ( bAnyFixed || n != 0 );
+	for ( std::size_t e = 0; e < m_edges.size(); e++ )
+		if ( isVariable[ m_edges[ e ].from ] && isVariable[ m_edges[ e ].to ] )
+		{
+			adjacency[ m_edges[ e ].from ].insert( m_edges[ e ].to );
+			adjacency[ m_edges[ e ].to ].insert( m_edges[ e ].from );
+		}
+
+	// minimum degree ordering, eliminating a node connects all its neighbours
+	std::set< std::pair< std::size_t, std::size_t > > queue;
+	for ( std::size_t n = 0; n < nNodes; n++ )
+		if ( isVariable[ n ] )
+			queue.insert( std::make_pair( adjacency[ n ].size(), n ) );
+
+	m_variable.assign( nNodes, npos );
+	std::vector< std::size_t > order;
+	std::vector< std::vector< std::size_t > > columnNodes;
+	while ( !queue.empty() )
+	{
+		const std::size_t best = queue.begin()->second;
+		queue.erase( queue.begin() );
+		m_variable[ best ] = order.size();
+		order.push_back( best );
+
+		const std::set< std::size_t >& adj( adjacency[ best ] );
+		columnNodes.push_back( std::vector< std::size_t >( adj.begin(), adj.end() ) );
+		for ( std::set< std::size_t >::const_iterator it = adj.begin(); it != adj.end(); ++it )
+		{
+			std::set< std::size_t >& other( adjacency[ *it ] );
+			queue.erase( std::make_pair( other.size(), *it ) );
+			other.erase( best );
+			other.insert( adj.begin(), adj.end() );
+			other.erase( *it );
+			queue.insert( std::make_pair( other.size(), *it ) );
+		}
+		adjacency[ best ].clear();
+	}
+
+	// the structure of column k of the factor are the neighbours of its node at elimination
+	const std::size_t nVariables = order.size();
+	m_colStart.assign( 1, 0 );
+	m_rowBlocks.clear();
+	for ( std::size_t k = 0; k < nVariables; k++ )
+	{
+		const std::size_t first = m_rowBlocks.size();
+		for ( std::size_t i = 0; i < columnNodes[ k ].size(); i++ )
+			m_rowBlocks.push_back( m_variable[ columnNodes[ k ][ i ] ] );
+		std::sort( m_rowBlocks.begin() + first, m_rowBlocks.end() );
+		m_colStart.push_back( m_rowBlocks.size() );
+	}
+
+	m_edgeSlot.resize( m_edges.size() );
+	for ( std::size_t e = 0; e < m_edges.size(); e++ )
+	{
+		const std::size_t a = m_variable[ m_edges[ e ].from ];
+		const std::size_t b = m_variable[ m_edges[ e ].to ];
+		m_edgeSlot[ e ] = ( a == npos || b == npos ) ? npos : blockSlot( a, b );
+	}
+
+	m_hessianDiag.resize( nVariables );
+	m_hessianOff.resize( m_rowBlocks.size() );
+	m_factorDiag.resize( nVariables );
+	m_factorOff.resize( m_rowBlocks.size() );
+	m_gradient.resize( 6 * nVariables );
+
+	m_bDirty = false;
+	m_analyses++;
+	LOG4CPP_DEBUG( logger, "Pose graph with " << nVariables << " variable nodes, factor has " << factorBlocks() << " blocks" );
+}
+
+
+std::size_t PoseGraph::blockSlot( std::size_t a, std::size_t b ) const
+{
+	const std::size_t col = std::min( a, b );
+	const std::size_t row = std::max( a, b );
+	const std::vector< std::size_t >::const_iterator begin = m_rowBlocks.begin() + m_colStart[ col ];
+	const std::vector< std::size_t >::const_iterator end = m_rowBlocks.begin() + m_colStart[ col + 1 ];
+	const std::vector< std::size_t >::const_iterator it = std::lower_bound( begin, end, row );
+	return ( it != end && *it == row ) ? std::size_t( it - m_rowBlocks.begin() ) : npos;
+}
+
+
+double PoseGraph::linearize( const Parameters& params )
+{
+	for ( std::size_t k = 0; k < m_hessianDiag.size(); k++ )
+		std::fill( m_hessianDiag[ k ].m, m_hessianDiag[ k ].m + 36, 0.0 );
+	for ( std::size_t k = 0; k < m_hessianOff.size(); k++ )
+		std::fill( m_hessianOff[ k ].m, m_hessianOff[ k ].m + 36, 0.0 );
+	std::fill( m_gradient.begin(), m_gradient.end(), 0.0 );
+
+	double fCost = 0;
+	double r[ 6 ], wr[ 6 ];
+	Block ji, jj, wji, wjj;
+	for ( std::size_t e = 0; e < m_edges.size(); e++ )
+	{
+		const Edge& edge( m_edges[ e ] );
+		const std::size_t a = m_variable[ edge.from ];
+		const std::size_t b = m_variable[ edge.to ];
+		edgeResidual( edge.measurement, m_poses[ edge.from ], m_poses[ edge.to ], r, ji.m, jj.m );
+
+		// whitening
+		double s = 0;
+		for ( std::size_t i = 0; i < 6; i++ )
+		{
+			wr[ i ] = 0;
+			for ( std::size_t k = 0; k <= i; k++ )
+				wr[ i ] += edge.whitening( i, k ) * r[ k ];
+			s += wr[ i ] * wr[ i ];
+			for ( std::size_t c = 0; c < 6; c++ )
+			{
+				double si = 0, sj = 0;
+				for ( std::size_t k = 0; k <= i; k++ )
+				{
+					si += edge.whitening( i, k ) * ji.m[ k * 6 + c ];
+					sj += edge.whitening( i, k ) * jj.m[ k * 6 + c ];
+				}
+				wji.m[ i * 6 + c ] = si;
+				wjj.m[ i * 6 + c ] = sj;
+			}
+		}
+		double w;
+		fCost += kernelLoss( params, s, w );
+		if ( w <= 0 )
+			continue;
+
+		// accumulate the blocks of the normal equations and the gradient J^T r
+		if ( a != npos )
+		{
+			addTransposedProduct( w, wji.m, wji.m, m_hessianDiag[ a ].m );
+			for ( std::size_t c = 0; c < 6; c++ )
+				for ( std::size_t i = 0; i < 6; i++ )
+					m_gradient[ 6 * a + c ] += w * wji.m[ i * 6 + c ] * wr[ i ];
+		}
+		if ( b != npos )
+		{
+			addTransposedProduct( w, wjj.m, wjj.m, m_hessianDiag[ b ].m );
+			for ( std::size_t c = 0; c < 6; c++ )
+				for ( std::size_t i = 0; i < 6; i++ )
+					m_gradient[ 6 * b + c ] += w * wjj.m[ i * 6 + c ] * wr[ i ];
+		}
+		if ( a != npos && b != npos )
+		{
+			// the block in row max( a, b ), column min( a, b )
+			if ( a > b )
+				addTransposedProduct( w, wji.m, wjj.m, m_hessianOff[ m_edgeSlot[ e ] ].m );
+			else
+				addTransposedProduct( w, wjj.m, wji.m, m_hessianOff[ m_edgeSlot[ e ] ].m );
+		}
+	}
+	return fCost;
+}
+
+
+bool PoseGraph::factorize( double lambda )
+{
+	m_factorDiag = m_hessianDiag;
+	m_factorOff = m_hessianOff;
+	for ( std::size_t k = 0; k < m_factorDiag.size(); k++ )
+		for ( std::size_t i = 0; i < 6; i++ )
+			m_factorDiag[ k ].m[ i * 7 ] += lambda;
+
+	// right-looking block cholesky
+	for ( std::size_t k = 0; k < m_factorDiag.size(); k++ )
+	{
+		if ( !cholesky6( m_factorDiag[ k ].m ) )
+			return false;
+		const double* d = m_factorDiag[ k ].m;
+
+		// L_rk = A_rk D^-T, row by row
+		for ( std::size_t s = m_colStart[ k ]; s < m_colStart[ k + 1 ]; s++ )
+			for ( std::size_t i = 0; i < 6; i++ )
+				forwardSubstitute( d, m_factorOff[ s ].m + 6 * i );
+
+		// update the trailing blocks A_ab -= L_ak L_bk^T
+		for ( std::size_t sa = m_colStart[ k ]; sa < m_colStart[ k + 1 ]; sa++ )
+		{
+			const std::size_t ra = m_rowBlocks[ sa ];
+			subtractProductTransposed( m_factorOff[ sa ].m, m_factorOff[ sa ].m, m_factorDiag[ ra ].m );
+			for ( std::size_t sb = m_colStart[ k ]; sb < sa; sb++ )
+			{
+				const std::size_t target = blockSlot( m_rowBlocks[ sb ], ra );
+				subtractProductTransposed( m_factorOff[ sa ].m, m_factorOff[ sb ].m, m_factorOff[ target ].m );
+			}
+		}
+	}
+	return true;
+}
+
+
+void PoseGraph::solve( std::vector< double >& x ) const
+{
+	const std::size_t n = m_factorDiag.size();
+
+	// L y = b
+	for ( std::size_t k = 0; k < n; k++ )
+	{
+		double* xk = &x[ 6 * k ];
+		forwardSubstitute( m_factorDiag[ k ].m, xk );
+		for ( std::size_t s = m_colStart[ k ]; s < m_colStart[ k + 1 ]; s++ )
+		{
+			double* xr = &x[ 6 * m_rowBlocks[ s ] ];
+			const double* l = m_factorOff[ s ].m;
+			for ( std::size_t i = 0; i < 6; i++ )
+				for ( std::size_t j = 0; j < 6; j++ )
+					xr[ i ] -= l[ i * 6 + j ] * xk[ j ];
+		}
+	}
+
+	// L^T x = y
+	for ( std::size_t k = n; k-- > 0; )
+	{
+		double* xk = &x[ 6 * k ];
+		for ( std::size_t s = m_colStart[ k ]; s < m_colStart[ k + 1 ]; s++ )
+		{
+			const double* xr = &x[ 6 * m_rowBlocks[ s ] ];
+			const double* l = m_factorOff[ s ].m;
+			for ( std::size_t i = 0; i < 6; i++ )
+				for ( std::size_t j = 0; j < 6; j++ )
+					xk[ j ] -= l[ i * 6 + j ] * xr[ i ];
+		}
+		backSubstitute( m_factorDiag[ k ].m, xk );
+	}
+}
+
+
+double PoseGraph::cost( const Parameters& params, const std::vector< Math::Pose >& poses ) const
+{
+	double fCost = 0;
+	double r[ 6 ];
+	for ( std::size_t e = 0; e < m_edges.size(); e++ )
+	{
+		const Edge& edge( m_edges[ e ] );
+		edgeResidual( edge.measurement, poses[ edge.from ], poses[ edge.to ], r, 0, 0 );
+		double s = 0;
+		for ( std::size_t i = 0; i < 6; i++ )
+		{
+			double wr = 0;
+			for ( std::size_t k = 0; k <= i; k++ )
+				wr += edge.whitening( i, k ) * r[ k ];
+			s += wr * wr;
+		}
+		double w;
+		fCost += kernelLoss( params, s, w );
+	}
+	return fCost;
+}
+
+
+double PoseGraph::cost( const Parameters& params ) const
+{
+	return cost( params, m_poses );
+}
+
+
+double PoseGraph::optimize( const Parameters& params )
+{
+	m_iterations = 0;
+	if ( m_bDirty )
+		analyze();
+	if ( m_factorDiag.empty() )
+		return cost( params );
+
+	double fCost = linearize( params );
+	double fMaxDiag = 0;
+	for ( std::size_t k = 0; k < m_hessianDiag.size(); k++ )
+		for ( std::size_t i = 0; i < 6; i++ )
+			fMaxDiag = std::max( fMaxDiag, m_hessianDiag[ k ].m[ i * 7 ] );
+	double fLambda = 1e-5 * std::max( fMaxDiag, 1e-12 );
+
+	std::vector< double > step( m_gradient.size() );
+	std::vector< Math::Pose > newPoses;
+	while ( m_iterations < params.maxIterations )
+	{
+		m_iterations++;
+		if ( !factorize( fLambda ) )
+		{
+			fLambda *= 10;
+			continue;
+		}
+
+		for ( std::size_t i = 0; i < step.size(); i++ )
+			step[ i ] = -m_gradient[ i ];
+		solve( step );
+		double fStepNorm = 0;
+		for ( std::size_t i = 0; i < step.size(); i++ )
+			fStepNorm = std::max( fStepNorm, std::fabs( step[ i ] ) );
+		if ( fStepNorm < 1e-12 )
+			break;
+
+		applyIncrement( m_poses, m_variable, step, newPoses );
+		const double fNewCost = cost( params, newPoses );
+		LOG4CPP_DEBUG( logger, "Pose graph iteration " << m_iterations << ": cost " << fNewCost << ", lambda " << fLambda );
+
+		if ( fNewCost < fCost )
+		{
+			m_poses.swap( newPoses );
+			const bool bConverged = fCost - fNewCost <= params.tolerance * fCost;
+			fLambda = std::max( fLambda / 10, 1e-12 * std::max( fMaxDiag, 1e-12 ) );
+			fCost = linearize( params );
+			if ( bConverged )
+				break;
+		}
+		else
+		{
+			fLambda *= 10;
+			if ( fLambda > 1e12 * std::max( fMaxDiag, 1e-12 ) )
+				break;
+		}
+	}
+	return fCost;
+}
+
+} } // namespace Ubitrack::Algorithm
@@ -0,0 +1,235 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Sparse pose graph optimization
+ */
+
+#ifndef __UBITRACK_ALGORITHM_POSEGRAPH_H_INCLUDED__
+#define __UBITRACK_ALGORITHM_POSEGRAPH_H_INCLUDED__
+
+#include <vector>
+
+#include "../utCore.h"
+
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+#include <utMath/ErrorPose.h>
+
+namespace Ubitrack { namespace Algorithm {
+
+/**
+ * @ingroup tracking_algorithms
+ * robust kernels of the pose graph optimization, see \c Math::Optimization::HuberLoss etc.
+ */
+enum PoseGraphKernel { pgNoKernel, pgHuberKernel, pgCauchyKernel, pgGemanMcClureKernel, pgTukeyKernel };
+
+/**
+ * @ingroup tracking_algorithms
+ * Optimizes the poses of trackers, markers etc. (the nodes) from measured relative poses between
+ * them (the edges), e.g. to register many trackers into a common frame.
+ *
+ * An edge from node \c i to node \c j measures the pose of \c j in the frame of \c i,
+ * <tt>T_i^-1 T_j</tt>, with the error model of \c Math::ErrorPose. Its residual is
+ * <pre>
+ * e_t = R_i^T ( t_j - t_i ) - t_ij
+ * e_r = 1/2 Log( R_ij^T R_i^T R_j )
+ * </pre>
+ * weighted by the inverse covariance of the edge. The nodes are updated as
+ * <tt>t <- t + dt, R <- R Exp( dr )</tt> with the rotation logarithm as Lie algebra parameterization,
+ * and the jacobians wrt. these increments are computed in closed form.
+ *
+ * Each levenberg-marquardt step assembles the normal equations from 6x6 blocks, one per node and
+ * one per pair of connected nodes, and solves them with a block-sparse cholesky decomposition.
+ * The elimination order is chosen by minimum degree on the nodes, so the fill-in stays small for
+ * chains of trackers with loop closures and graphs of 10000 and more nodes can be optimized.
+ *
+ * The graph can be optimized incrementally: the poses are kept between calls of \c optimize and
+ * serve as initial values of the next call, and the ordering and structure of the decomposition
+ * are only recomputed when an edge connects nodes whose block is not part of the factor yet, a
+ * node is added or nodes are fixed or released.
+ *
+ * Fixed nodes define the common frame. If no node is fixed, the first node is.
+ */
+class UBITRACK_EXPORT PoseGraph
+{
+public:
+	/** parameters of the optimization */
+	struct Parameters
+	{
+		Parameters()
+			: maxIterations( 20 )
+			, tolerance( 1e-9 )
+			, kernel( pgNoKernel )
+			, kernelWidth( 1.0 )
+		{}
+
+		/** maximum number of levenberg-marquardt iterations */
+		std::size_t maxIterations;
+
+		/** stops when the cost decreases by less than this fraction */
+		double tolerance;
+
+		/** robust kernel applied to the whitened residual of each edge */
+		PoseGraphKernel kernel;
+
+		/** scale of the robust kernel, in standard deviations */
+		double kernelWidth;
+	};
+
+	/** constructs an empty graph */
+	PoseGraph();
+
+	/**
+	 * adds a node.
+	 * @param pose initial pose of the node
+	 * @param fixed if true, the pose is not optimized
+	 * @return the index of the node
+	 */
+	std::size_t addNode( const Math::Pose& pose, bool fixed = false );
+
+	/**
+	 * adds a relative pose measurement.
+	 * @param from index of the node \c i
+	 * @param to index of the node \c j
+	 * @param relative the pose of \c j in the frame of \c i with its (positive definite) covariance
+	 * @return the index of the edge
+	 * @throws Util::Exception if a node does not exist, both are the same or the covariance is not positive definite
+	 */
+	std::size_t addEdge( std::size_t from, std::size_t to, const Math::ErrorPose& relative );
+
+	/** fixes or releases a node */
+	void setFixed( std::size_t node, bool fixed );
+
+	/** true if the node is fixed */
+	bool isFixed( std::size_t node ) const
+	{ return m_fixed[ node ]; }
+
+	/** sets the pose of a node, e.g. to initialize it */
+	void setPose( std::size_t node, const Math::Pose& pose )
+	{ m_poses[ node ] = pose; }
+
+	/** the current pose of a node */
+	const Math::Pose& pose( std::size_t node ) const
+	{ return m_poses[ node ]; }
+
+	/** number of nodes */
+	std::size_t nodeCount() const
+	{ return m_poses.size(); }
+
+	/** number of edges */
+	std::size_t edgeCount() const
+	{ return m_edges.size(); }
+
+	/**
+	 * optimizes the poses of all nodes that are not fixed
+	 * @return the final cost, the sum of the (robust) squared whitened residuals
+	 */
+	double optimize( const Parameters& params = Parameters() );
+
+	/** the cost of the current poses */
+	double cost( const Parameters& params = Parameters() ) const;
+
+	/** number of iterations of the last optimization */
+	std::size_t iterations() const
+	{ return m_iterations; }
+
+	/** number of times the ordering and structure of the decomposition were computed */
+	std::size_t analyses() const
+	{ return m_analyses; }
+
+	/** number of non-zero 6x6 blocks of the cholesky factor */
+	std::size_t factorBlocks() const
+	{ return m_rowBlocks.size() + m_colStart.size() - ( m_colStart.empty() ? 0 : 1 ); }
+
+protected:
+	/// @internal a relative pose measurement
+	struct Edge
+	{
+		std::size_t from;
+		std::size_t to;
+		Math::Pose measurement;
+		/// inverse of the cholesky factor of the covariance
+		Math::Matrix< double, 6, 6 > whitening;
+	};
+
+	/// @internal a 6x6 block, row-major
+	struct Block
+	{
+		double m[ 36 ];
+	};
+
+	/// @internal computes elimination order and structure of the factor
+	void analyze();
+
+	/// @internal slot of the off-diagonal block between two variables in the factor, or npos
+	std::size_t blockSlot( std::size_t a, std::size_t b ) const;
+
+	/// @internal factorizes the damped normal equations in m_factor
+	bool factorize( double lambda );
+
+	/// @internal solves with the factor, overwriting \c x
+	void solve( std::vector< double >& x ) const;
+
+	/// @internal assembles the normal equations at the current poses, returns the cost
+	double linearize( const Parameters& params );
+
+	/// @internal cost of the poses in \c poses
+	double cost( const Parameters& params, const std::vector< Math::Pose >& poses ) const;
+
+	std::vector< Math::Pose > m_poses;
+	std::vector< bool > m_fixed;
+	std::vector< Edge > m_edges;
+
+	/// true if the factor structure must be recomputed
+	bool m_bDirty;
+	std::size_t m_iterations;
+	std::size_t m_analyses;
+
+	/// variable (position in elimination order) of each node, or npos if fixed
+	std::vector< std::size_t > m_variable;
+
+	/// rows of the off-diagonal blocks of column k in [ m_colStart[ k ], m_colStart[ k + 1 ] ), sorted
+	std::vector< std::size_t > m_colStart;
+	std::vector< std::size_t > m_rowBlocks;
+
+	/// block of each edge between two variables, or npos
+	std::vector< std::size_t > m_edgeSlot;
+
+	/// normal equations: diagonal and off-diagonal blocks in the factor structure, and the gradient
+	std::vector< Block > m_hessianDiag;
+	std::vector< Block > m_hessianOff;
+	std::vector< double > m_gradient;
+
+	/// the factor
+	std::vector< Block > m_factorDiag;
+	std::vector< Block > m_factorOff;
+};
+
+} } // namespace Ubitrack::Algorithm
+
+#endif // __UBITRACK_ALGORITHM_POSEGRAPH_H_INCLUDED__
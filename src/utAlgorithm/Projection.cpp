@@ -30,8 +30,12 @@
  */
 
 #include "Projection.h"
+#include "DirectLinearTransform.h"
 #include <utMath/VectorFunctions.h>
 #include <utMath/Geometry/PointNormalization.h>
+#include <utMath/ProductChain.h>
+
+#include <cmath>
 
 
 #include <boost/numeric/ublas/matrix_proxy.hpp>
@@ -39,20 +43,9 @@
 
 namespace ublas = boost::numeric::ublas;
 
-#ifndef HAVE_LAPACK
 namespace Ubitrack { namespace Algorithm {
-#else
-#include <utMath/MatrixOperations.h>
-#include <boost/numeric/bindings/lapack/gesvd.hpp>
-#include <boost/numeric/bindings/lapack/gerqf.hpp>
-#include <boost/numeric/bindings/lapack/orgrq.hpp>
-#include <boost/numeric/bindings/blas/blas3.hpp>
-
-// shortcuts to namespaces
-namespace lapack = boost::numeric::bindings::lapack;
-namespace blas = boost::numeric::bindings::blas;
 
-namespace Ubitrack { namespace Algorithm {
+#ifdef HAVE_LAPACK
 
 /** \internal */
 template< typename T >
@@ -71,50 +64,35 @@ Math::Matrix< T, 3, 4 >projectionDLTImpl( const std::vector< Math::Vector< T, 3
 	Math::Vector< T, 2 > toScale;
 	Math::Geometry::estimateNormalizationParameters( toPoints.begin(), toPoints.end(), toShift, toScale );
 
-	// construct equation system
-	Math::Matrix< T, 0, 0 > A( 2 * fromPoints.size(), 12 );
-	for ( unsigned i = 0; i < fromPoints.size(); i++ )
+	// accumulate the normal equations of the system
+	HomogeneousLinearSystem< 12 > system;
+	for ( std::size_t i = 0; i < fromPoints.size(); i++ )
 	{
-		Math::Vector< T, 2 > to = ublas::element_div( toPoints[ i ] - toShift, toScale );
-		Math::Vector< T, 3 > from = ublas::element_div( fromPoints[ i ] - fromShift, fromScale );
-
-		A( i * 2,  0 ) = A( i * 2, 1 ) = A( i * 2, 2 ) = A( i * 2, 3 ) = 0;
-		A( i * 2,  4 ) = -from( 0 );
-		A( i * 2,  5 ) = -from( 1 );
-		A( i * 2,  6 ) = -from( 2 );
-		A( i * 2,  7 ) = -1;
-		A( i * 2,  8 ) = to( 1 ) * from( 0 );
-		A( i * 2,  9 ) = to( 1 ) * from( 1 );
-		A( i * 2, 10 ) = to( 1 ) * from( 2 );
-		A( i * 2, 11 ) = to( 1 );
-		A( i * 2 + 1,  0 ) = from( 0 );
-		A( i * 2 + 1,  1 ) = from( 1 );
-		A( i * 2 + 1,  2 ) = from( 2 );
-		A( i * 2 + 1,  3 ) = 1;
-		A( i * 2 + 1,  4 ) = A( i * 2 + 1, 5 ) = A( i * 2 + 1, 6 ) = A( i * 2 + 1, 7 ) = 0;
-		A( i * 2 + 1,  8 ) = -to( 0 ) * from( 0 );
-		A( i * 2 + 1,  9 ) = -to( 0 ) * from( 1 );
-		A( i * 2 + 1, 10 ) = -to( 0 ) * from( 2 );
-		A( i * 2 + 1, 11 ) = -to( 0 );
+		const double fx = ( fromPoints[ i ]( 0 ) - fromShift( 0 ) ) / fromScale( 0 );
+		const double fy = ( fromPoints[ i ]( 1 ) - fromShift( 1 ) ) / fromScale( 1 );
+		const double fz = ( fromPoints[ i ]( 2 ) - fromShift( 2 ) ) / fromScale( 2 );
+		const double tx = ( toPoints[ i ]( 0 ) - toShift( 0 ) ) / toScale( 0 );
+		const double ty = ( toPoints[ i ]( 1 ) - toShift( 1 ) ) / toScale( 1 );
+
+		const double row1[ 12 ] = { 0, 0, 0, 0, -fx, -fy, -fz, -1, ty * fx, ty * fy, ty * fz, ty };
+		const double row2[ 12 ] = { fx, fy, fz, 1, 0, 0, 0, 0, -tx * fx, -tx * fy, -tx * fz, -tx };
+		system.addRow( row1 );
+		system.addRow( row2 );
 	}
 
-	// solve using SVD
-	Math::Vector< T > s( 12 );
-	Math::Matrix< T, 12, 12 > Vt;
-	Math::Matrix< T, 0, 0 > U( 2 * fromPoints.size(), 2 * fromPoints.size() );
-	lapack::gesvd( 'N', 'A', A, s, U, Vt );
+	Math::Vector< T, 12 > p;
+	system.solve( p );
 
 	// copy result to 3x4 matrix
-	Math::Matrix< T, 3, 4 > P;
-	P( 0, 0 ) = Vt( 11, 0 ); P( 0, 1 ) = Vt( 11, 1 ); P( 0, 2 ) = Vt( 11,  2 ); P( 0, 3 ) = Vt( 11,  3 );
-	P( 1, 0 ) = Vt( 11, 4 ); P( 1, 1 ) = Vt( 11, 5 ); P( 1, 2 ) = Vt( 11,  6 ); P( 1, 3 ) = Vt( 11,  7 );
-	P( 2, 0 ) = Vt( 11, 8 ); P( 2, 1 ) = Vt( 11, 9 ); P( 2, 2 ) = Vt( 11, 10 ); P( 2, 3 ) = Vt( 11, 11 );
+	Math::Matrix< T, 3, 4 > Pn;
+	Pn( 0, 0 ) = p( 0 ); Pn( 0, 1 ) = p( 1 ); Pn( 0, 2 ) = p(  2 ); Pn( 0, 3 ) = p(  3 );
+	Pn( 1, 0 ) = p( 4 ); Pn( 1, 1 ) = p( 5 ); Pn( 1, 2 ) = p(  6 ); Pn( 1, 3 ) = p(  7 );
+	Pn( 2, 0 ) = p( 8 ); Pn( 2, 1 ) = p( 9 ); Pn( 2, 2 ) = p( 10 ); Pn( 2, 3 ) = p( 11 );
 
 	// reverse normalization
 	const Math::Matrix< T, 3, 3 > toCorrect( Math::Geometry::generateNormalizationMatrix( toShift, toScale, true ) );
-	Math::Matrix< T, 3, 4 > Ptemp( ublas::prod( toCorrect, P ) );
 	const Math::Matrix< T, 4, 4 > fromCorrect( Math::Geometry::generateNormalizationMatrix( fromShift, fromScale, false ) );
-	ublas::noalias( P ) = ublas::prod( Ptemp, fromCorrect );
+	Math::Matrix< T, 3, 4 > P( Math::productChain( toCorrect, Pn, fromCorrect ) );
 
 	// normalize result to have a viewing direction of length 1 (optional)
 	T fViewDirLen = sqrt( P( 2, 0 ) * P( 2, 0 ) + P( 2, 1 ) * P( 2, 1 ) + P( 2, 2 ) * P( 2, 2 ) );
@@ -142,67 +120,84 @@ Math::Matrix< double, 3, 4 > projectionDLT( const std::vector< Math::Vector< dou
 }
 
 
+#endif // HAVE_LAPACK
+
+/**
+ * \internal
+ * Givens rotation of the columns \c i and \c j of \c a that zeroes a( row, i ), accumulated in \c q
+ */
+template< typename T >
+void givensColumns( Math::Matrix< T, 3, 3 >& a, Math::Matrix< T, 3, 3 >& q, std::size_t row, std::size_t i, std::size_t j )
+{
+	const T h = std::sqrt( a( row, i ) * a( row, i ) + a( row, j ) * a( row, j ) );
+	if ( h == 0 )
+		return;
+	const T c = a( row, j ) / h;
+	const T s = -a( row, i ) / h;
+	for ( std::size_t m = 0; m < 3; m++ )
+	{
+		const T ai = a( m, i );
+		a( m, i ) = c * ai + s * a( m, j );
+		a( m, j ) = c * a( m, j ) - s * ai;
+		const T qi = q( m, i );
+		q( m, i ) = c * qi + s * q( m, j );
+		q( m, j ) = c * q( m, j ) - s * qi;
+	}
+	a( row, i ) = 0;
+}
+
+
 /** \internal */
 template< typename T > void decomposeProjectionImpl( Math::Matrix< T, 3, 3 >& k,
-	Math::Matrix< T, 3, 3 >& r, Math::Vector< T, 3 >& t, const Math::Matrix< T, 3, 4 >& p_ )
+	Math::Matrix< T, 3, 3 >& r, Math::Vector< T, 3 >& t, const Math::Matrix< T, 3, 4 >& p )
 {
-	// copy matrix
-	Math::Matrix< T, 3, 4 > P( p_ );
-	ublas::matrix_range< Math::Matrix< T, 3, 4 > > A( P, ublas::range( 0, 3 ), ublas::range( 0, 3 ) );
-
 	// origin must lie in front of camera
-	if ( P( 2, 3 ) < 0 )
-		P *= -1;
-
-	// perform RQ decomposition
-	Math::Vector< T, 3 > tau;
-	lapack::gerqf( A, tau );
-
-	// generate matrix k
-	k = A;
-	k( 1, 0 ) = k( 2, 0 ) = k( 2, 1 ) = 0.0f;
-
-	// generate matrix r
-	lapack::orgrq( A, tau );
-	r = A;
-
-	// do some normalization
+	const T sign = p( 2, 3 ) < 0 ? T( -1 ) : T( 1 );
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			k( i, j ) = sign * p( i, j );
+
+	// RQ decomposition with three Givens rotations, A Q = K with Q = Gx Gy Gz, see Hartley & Zisserman, A4.1.1
+	Math::Matrix< T, 3, 3 > q( Math::Matrix< T, 3, 3 >::identity() );
+	givensColumns( k, q, 2, 1, 2 );
+	givensColumns( k, q, 2, 0, 2 );
+	givensColumns( k, q, 1, 0, 1 );
+	k( 1, 0 ) = k( 2, 0 ) = k( 2, 1 ) = 0;
+
+	// Q is a rotation, so det( R ) = det( Q^T ) is positive already
 	// normalization is done by changing the product K R to (K S) (S^-1 R),
-	// where S(i,i) == +/- 1 and S(i,j) == 0 for i!=j. Thus, S == S^-1
-	Math::Vector< T, 3 > scale( 1, 1, 1 );
-
-	// det( R ) must be positive
-	if ( Math::determinant( r ) < 0 )
-		scale *= -1;
+	// where S(i,i) == +/- 1 and S(i,j) == 0 for i!=j and det( S ) = 1. Thus, S == S^-1
+	T scale[ 3 ] = { 1, 1, 1 };
 
 	// K_11 must be positive
-	if ( k( 0, 0 ) * scale( 0 ) < 0 )
+	if ( k( 0, 0 ) < 0 )
 	{
-		scale( 0 ) *= -1;
-		scale( 1 ) *= -1;
+		scale[ 0 ] = -1;
+		scale[ 1 ] = -1;
 	}
 
 	// K_33 must be negative
-	if ( k( 2, 2 ) * scale( 2 ) > 0 )
+	if ( k( 2, 2 ) > 0 )
 	{
-		scale( 2 ) *= -1;
-		scale( 1 ) *= -1;
+		scale[ 2 ] = -1;
+		scale[ 1 ] *= -1;
 	}
 
-	for ( unsigned i = 0; i < 3; i++ )
-	{
-		ublas::column( k, i ) *= scale( i );
-		ublas::row( r, i ) *= scale( i );
-	}
-
-	// normalize k
-	T f = -1 / k( 2, 2 );
-	k *= f;
-
-	// compute translation vector: t = K^-1 p^4
-	Math::Matrix< T, 3, 1 > ttmp = ublas::subrange( P, 0, 3, 3, 4 );
-	blas::trsm( 'L', 'U', 'N', 'N', 1.0f, k, ttmp );
-	t = ublas::column( ttmp, 0 );
+	// normalize k to K_33 = -1
+	const T f = -scale[ 2 ] / k( 2, 2 );
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+		{
+			k( i, j ) *= scale[ j ] * f;
+			r( i, j ) = scale[ i ] * q( j, i );
+		}
+	k( 2, 2 ) = -1;
+
+	// compute translation vector: t = K^-1 p^4 by back substitution, with K before the normalization
+	const T p4[ 3 ] = { f * sign * p( 0, 3 ), f * sign * p( 1, 3 ), f * sign * p( 2, 3 ) };
+	t( 2 ) = p4[ 2 ] / k( 2, 2 );
+	t( 1 ) = ( p4[ 1 ] - k( 1, 2 ) * t( 2 ) ) / k( 1, 1 );
+	t( 0 ) = ( p4[ 0 ] - k( 0, 1 ) * t( 1 ) - k( 0, 2 ) * t( 2 ) ) / k( 0, 0 );
 }
 
 
@@ -218,7 +213,31 @@ void decomposeProjection( Math::Matrix< double, 3, 3 >& k,
 	decomposeProjectionImpl( k, r, t, p );
 }
 
-#endif // HAVE_LAPACK
+
+/** \internal */
+template< typename T >
+void decomposeProjectionsImpl( std::vector< Math::Matrix< T, 3, 3 > >& k, std::vector< Math::Matrix< T, 3, 3 > >& r,
+	std::vector< Math::Vector< T, 3 > >& t, const std::vector< Math::Matrix< T, 3, 4 > >& p )
+{
+	k.resize( p.size() );
+	r.resize( p.size() );
+	t.resize( p.size() );
+	for ( std::size_t i = 0; i < p.size(); i++ )
+		decomposeProjectionImpl( k[ i ], r[ i ], t[ i ], p[ i ] );
+}
+
+void decomposeProjections( std::vector< Math::Matrix< float, 3, 3 > >& k, std::vector< Math::Matrix< float, 3, 3 > >& r,
+	std::vector< Math::Vector< float, 3 > >& t, const std::vector< Math::Matrix< float, 3, 4 > >& p )
+{
+	decomposeProjectionsImpl( k, r, t, p );
+}
+
+void decomposeProjections( std::vector< Math::Matrix< double, 3, 3 > >& k, std::vector< Math::Matrix< double, 3, 3 > >& r,
+	std::vector< Math::Vector< double, 3 > >& t, const std::vector< Math::Matrix< double, 3, 4 > >& p )
+{
+	decomposeProjectionsImpl( k, r, t, p );
+}
+
 
 /** \internal */
 template < typename T >
@@ -343,9 +362,8 @@ Math::Matrix< double, 4, 4 > offAxisProjectionMatrix( Math::Vector< double, 3 >&
 								m(3, 3) = 1.0;
 	
 	// The rotation matrix is orthogonal so we can transpose it instead of inverting.
-	Math::Matrix< double, 4, 4 > view = boost::numeric::ublas::prod(boost::numeric::ublas::trans(m), translation );
-	Math::Matrix< double, 4, 4 > view2 = boost::numeric::ublas::prod(proj, view);
-	return view2;
+	const Math::Matrix< double, 4, 4 > mt( boost::numeric::ublas::trans( m ) );
+	return Math::productChain( proj, mt, translation );
 }
 
 
@@ -37,6 +37,7 @@
 #include <utCore.h>
 #include <utMath/Matrix.h>
 #include <utMath/Vector.h>
+#include <utMath/CameraIntrinsics.h>
 #include <vector>
 
 namespace Ubitrack { namespace Algorithm {
@@ -62,6 +63,7 @@ UBITRACK_EXPORT Math::Matrix< float, 3, 4 > projectionDLT( const std::vector< Ma
 UBITRACK_EXPORT Math::Matrix< double, 3, 4 > projectionDLT( const std::vector< Math::Vector< double, 3 > >& fromPoints, 
 	const std::vector< Math::Vector< double, 2 > >& toPoints );
 
+#endif // HAVE_LAPACK
 
 /**
  * @ingroup tracking_algorithms
@@ -70,6 +72,9 @@ UBITRACK_EXPORT Math::Matrix< double, 3, 4 > projectionDLT( const std::vector< M
  * If you create a matrix/pose from r|t, the expression x' = [r|t] x will transform world 
  * coordinates x to camera coordinates x'. To get the camera position, invert this pose/matrix.
  *
+ * The RQ decomposition uses three Givens rotations on the fixed-size matrices, so it neither
+ * allocates nor calls LAPACK and can be used in RANSAC loops.
+ *
  * Note: also exists with \c double parameters
  *
  * @param k resulting camera intrinsics matrix (upper triangular)
@@ -81,9 +86,20 @@ UBITRACK_EXPORT void decomposeProjection( Math::Matrix< float, 3, 3 >& k,
 	Math::Matrix< float, 3, 3 >& r, Math::Vector< float, 3 >& t, const Math::Matrix< float, 3, 4 >& p ); 
 
 UBITRACK_EXPORT void decomposeProjection( Math::Matrix< double, 3, 3 >& k, 
-	Math::Matrix< double, 3, 3 >& r, Math::Vector< double, 3 >& t, const Math::Matrix< double, 3, 4 >& p );    
+	Math::Matrix< double, 3, 3 >& r, Math::Vector< double, 3 >& t, const Math::Matrix< double, 3, 4 >& p );
+
+
+/**
+ * @ingroup tracking_algorithms
+ * Decomposes many 3x4 projection matrices, see \c decomposeProjection.
+ * The results are resized to the number of projections.
+ */
+UBITRACK_EXPORT void decomposeProjections( std::vector< Math::Matrix< float, 3, 3 > >& k, std::vector< Math::Matrix< float, 3, 3 > >& r,
+	std::vector< Math::Vector< float, 3 > >& t, const std::vector< Math::Matrix< float, 3, 4 > >& p );
+
+UBITRACK_EXPORT void decomposeProjections( std::vector< Math::Matrix< double, 3, 3 > >& k, std::vector< Math::Matrix< double, 3, 3 > >& r,
+	std::vector< Math::Vector< double, 3 > >& t, const std::vector< Math::Matrix< double, 3, 4 > >& p );
 
-#endif // HAVE_LAPACK
 
 /**
  * @ingroup tracking_algorithms
@@ -107,9 +123,54 @@ UBITRACK_EXPORT Math::Matrix< double, 4, 4 > projectionMatrixToOpenGL( double l,
 
 UBITRACK_EXPORT Math::Matrix< float, 4, 4 > projectionMatrixToOpenGL( float l, float r, float b, float t, float n, float f, Math::Matrix< float, 3, 3 > m );
 
+/**
+ * @ingroup tracking_algorithms
+ * Caches the 4x4 OpenGL projection matrix of camera intrinsics.
+ *
+ * The matrix is computed by \c projectionMatrixToOpenGL for the image borders 0..width-1 and 0..height-1
+ * and only recomputed if the version of the intrinsics or the clipping planes change.
+ */
+template< typename T >
+class OpenGLProjectionCache
+{
+public:
+	OpenGLProjectionCache()
+		: m_version( 0 )
+		, m_near( 0 )
+		, m_far( 0 )
+	{}
+
+	/**
+	 * @param intrinsics camera intrinsics with known image dimension
+	 * @param n near clipping plane
+	 * @param f far clipping plane
+	 * @return the OpenGL projection matrix
+	 */
+	const Math::Matrix< T, 4, 4 >& operator()( const Math::CameraIntrinsics< T >& intrinsics, T n, T f )
+	{
+		const std::size_t version = intrinsics.version();
+		if ( version != m_version || n != m_near || f != m_far )
+		{
+			m_projection = projectionMatrixToOpenGL( T( 0 ), T( intrinsics.dimension( 0 ) ) - 1, 
+				T( 0 ), T( intrinsics.dimension( 1 ) ) - 1, n, f, intrinsics.matrix );
+			m_version = version;
+			m_near = n;
+			m_far = f;
+		}
+		return m_projection;
+	}
+
+protected:
+	std::size_t m_version;
+	T m_near;
+	T m_far;
+	Math::Matrix< T, 4, 4 > m_projection;
+};
+
 /**
  * @ingroup tracking_algorithms
  * Computes a 4x4 off-axis projection matrix for OpenGL.
+ * For static screens and a moving eye, \c DisplayProjection computes the same matrix faster.
  *
  * @param eye viewpoint position
  * @param ll lower left egde of screen
@@ -43,10 +43,13 @@ namespace Ubitrack { namespace Algorithm {
 
 namespace ublas = boost::numeric::ublas;
 
-RotationHecKalmanFilter::RotationHecKalmanFilter()
+RotationHecKalmanFilter::RotationHecKalmanFilter( Math::Stochastic::KalmanCovarianceForm form )
+	: m_covarianceForm( form )
 {
 	m_state.value = Math::Vector< double, 4 >( 0, 0, 0, 1 );
 	m_state.covariance = Math::Matrix< double, 4, 4 >::identity() * 1e2;
+	if ( m_covarianceForm == Math::Stochastic::kalmanUDFactors )
+		Math::Stochastic::udFactorize( m_state.covariance, m_factors );
 }
 
 void RotationHecKalmanFilter::addMeasurement( const Math::Quaternion& a, const Math::Quaternion& b )
@@ -58,6 +61,20 @@ void RotationHecKalmanFilter::addMeasurement( const Math::Quaternion& a, const M
 
 	// do the filter update
 	Function::RotHecMeasurement mf( a, b.negateIfCloser( a ) );
+	if ( m_covarianceForm == Math::Stochastic::kalmanUDFactors )
+	{
+		Math::Stochastic::kalmanMeasurementUpdateUD( m_state.value, m_factors, mf, kalmanMeasurement.value, kalmanMeasurement.covariance );
+
+		// normalize and add the regularization in one transformation of the factors
+		Math::Vector< double, 4 > q;
+		Math::Matrix< double, 4, 4 > jacobian;
+		Math::Optimization::Function::VectorNormalize( 4 ).evaluateWithJacobian( q, m_state.value, jacobian );
+		m_state.value = q;
+		Math::Stochastic::udTransform( m_factors, jacobian, Math::Vector< double, 4 >( 1e-12, 1e-12, 1e-12, 1e-12 ) );
+		Math::Stochastic::udCompose( m_factors, m_state.covariance );
+		return;
+	}
+
 	Math::Stochastic::kalmanMeasurementUpdate< 4, 4 >( m_state, mf, kalmanMeasurement, 0, m_state.value.size() );
 
 	// normalize the result to ensure quaternion properties
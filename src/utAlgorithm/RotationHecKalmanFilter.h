@@ -38,6 +38,7 @@
 
 #include <utMath/ErrorVector.h>
 #include <utMath/RotationVelocity.h>
+#include <utMath/Stochastic/KalmanUD.h>
 #include <utCore.h>
 
 namespace Ubitrack { namespace Algorithm {
@@ -53,8 +54,12 @@ namespace Ubitrack { namespace Algorithm {
 class UBITRACK_EXPORT RotationHecKalmanFilter
 {
 public:
-	/** constructor */
-	RotationHecKalmanFilter();
+	/**
+	 * constructor
+	 * @param form with \c Math::Stochastic::kalmanUDFactors, the covariance is updated in UD-factorized
+	 *   form, see utMath/Stochastic/KalmanUD.h, which keeps it positive semi-definite in long runs
+	 */
+	RotationHecKalmanFilter( Math::Stochastic::KalmanCovarianceForm form = Math::Stochastic::kalmanFullCovariance );
 	
 	/**
 	 * a and b are the relative motion between two frames
@@ -71,6 +76,12 @@ public:
 	
 protected:
 	Math::ErrorVector< double, 4 > m_state;
+
+	/** how the covariance is updated */
+	Math::Stochastic::KalmanCovarianceForm m_covarianceForm;
+
+	/** packed UD factors of the covariance, if used */
+	Math::Matrix< double, 4, 4 > m_factors;
 };
 
 } } // namespace Ubitrack::Algorithm
@@ -37,6 +37,8 @@
 #include <utMath/Pose.h>
 #include <utMath/Vector.h>
 #include <utMath/Blas1.h>
+#include <utMath/Matrix.h>
+#include <utMath/FixedDecomposition.h>
 
 // std
 #include <utility> // std::pair
@@ -79,34 +81,80 @@ std::pair< T, T > estimatePosition3DError_6D( const Math::Vector< T, 3 >& pw
 	, const InputIterator iEnd
 	, const Math::Vector< T, 3 >& pm )
 {
-	{	// old version
-		// T err( 0 );
-		// //err = std::accumulate( poses.begin(), poses.end(), err, ErrorFunction< T >( pw, pm ) );
-		// err /= n;
+	// mean error and standard deviation in a single pass (Welford)
+	ErrorFunction< T > errorFunction( pw, pm );
+	std::size_t n( 0 );
+	T err( 0 );
+	T sumSquares( 0 );
+	for( InputIterator it( iBegin ); it != iEnd; ++it )
+	{
+		const T e( errorFunction( *it ) );
+		const T d( e - err );
+		err += d / ++n;
+		sumSquares += d * ( e - err );
 	}
 
-	// calculate distance errors in advance and reuse them later
-	const std::size_t n ( std::distance(  iBegin, iEnd ) );
-	std::vector< T > distance_error;
-	distance_error.reserve( n );
-	std::transform( iBegin, iEnd, std::back_inserter( distance_error ), ErrorFunction< T >( pw, pm ) );
-	
+	const T stdDev( std::sqrt( sumSquares / ( n - 1 ) ) );
+	return std::make_pair( err, stdDev ) ;
+}
 
+/**
+ * @internal
+ * Computes the error statistics of \c estimatePosition3DError_6D and the covariance of the
+ * least-square solution ( pm, pw ) of \c estimatePosition3D_6D in the same pass over the poses.
+ *
+ * The normal matrix of the equations @f$ (R_i -I) (p_m p_w) = -t_i @f$ only depends on the sum of
+ * the rotations, so the covariance @f$ \sigma^2 (A^T A)^{-1} @f$ with the variance
+ * @f$ \sigma^2 @f$ of the residuals costs one 6-by-6 inversion.
+ *
+ * @param covariance returns the 6-by-6 covariance of pm (first three) and pw (last three)
+ * @return a pair of values including the mean value and the standard deviation of the error
+ */
+template< typename T, typename InputIterator >
+std::pair< T, T > estimatePosition3DErrorCovariance_6D( const Math::Vector< T, 3 >& pw
+	, const InputIterator iBegin
+	, const InputIterator iEnd
+	, const Math::Vector< T, 3 >& pm
+	, Math::Matrix< T, 6, 6 >& covariance )
+{
+	ErrorFunction< T > errorFunction( pw, pm );
+	std::size_t n( 0 );
 	T err( 0 );
-	{	// mean error
-		err = std::accumulate( distance_error.begin(), distance_error.end(), err );
-		err /= n;
+	T sumSquares( 0 );
+	double residualSquares( 0 );
+	Math::Matrix< double, 3, 3 > sumR( Math::Matrix< double, 3, 3 >::zeros() );
+	Math::Matrix< double, 3, 3 > r;
+	for( InputIterator it( iBegin ); it != iEnd; ++it )
+	{
+		const T e( errorFunction( *it ) );
+		const T d( e - err );
+		err += d / ++n;
+		sumSquares += d * ( e - err );
+		residualSquares += e * e;
+
+		it->rotation().toMatrix( r );
+		sumR += r;
 	}
 
-	
-	T stdDev( 0 );
-	{	// standard deviation
-		for( typename std::vector< T >::const_iterator it ( distance_error.begin() ); it != distance_error.end(); ++it )
-			stdDev += pow( *it - err, 2 );
-		
-		stdDev /= (n-1);
-		stdDev = std::sqrt( stdDev );
+	// A^T A = [ n I, -sum R^T; -sum R, n I ], only the lower triangle is read
+	Math::Matrix< double, 6, 6 > normal( Math::Matrix< double, 6, 6 >::zeros() );
+	for( std::size_t i( 0 ); i < 3; ++i )
+	{
+		normal( i, i ) = normal( i + 3, i + 3 ) = static_cast< double >( n );
+		for( std::size_t j( 0 ); j < 3; ++j )
+			normal( i + 3, j ) = -sumR( i, j );
 	}
+	if( n > 2 && Math::choleskyInvert( normal ) )
+	{
+		const double variance( residualSquares / ( 3 * n - 6 ) );
+		for( std::size_t i( 0 ); i < 6; ++i )
+			for( std::size_t j( 0 ); j < 6; ++j )
+				covariance( i, j ) = static_cast< T >( variance * normal( i, j ) );
+	}
+	else
+		covariance = Math::Matrix< T, 6, 6 >::zeros();
+
+	const T stdDev( std::sqrt( sumSquares / ( n - 1 ) ) );
 	return std::make_pair( err, stdDev ) ;
 }
 	
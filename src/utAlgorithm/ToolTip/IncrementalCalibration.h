@@ -0,0 +1,266 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking_algorithms
+ * @file
+ * Incremental tooltip/hotspot calibration for live feedback.
+ */ 
+
+#ifndef __UBITRACK_ALGROITHM_TOOLTIP_INCREMENTAL_CALIBRATION_H_INCLUDED__
+#define __UBITRACK_ALGROITHM_TOOLTIP_INCREMENTAL_CALIBRATION_H_INCLUDED__
+
+// std
+#include <cmath>
+#include <deque>
+#include <utility> // std::pair
+
+// Ubitrack
+#include <utMath/Pose.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/FixedDecomposition.h> // choleskySolve
+#include "ErrorEstimation.h"
+
+namespace Ubitrack { namespace Algorithm { namespace ToolTip {
+
+/**
+ * @ingroup tracking_algorithms
+ * Computes the tooltip/hotspot calibration incrementally, while the tool is pivoted.
+ *
+ * The least-square solution of @f$ (R_i -I) (p_m p_w) = -t_i @f$, see \c estimatePosition3D_6D,
+ * only depends on the sums of the rotations @f$ R_i @f$, of @f$ R_i^T t_i @f$ and of @f$ t_i @f$
+ * over all poses. These sums are updated in O(1) when a pose is added, so the current tip and the
+ * root mean square distance of all poses to it are available at any moment without storing the
+ * poses. The translations are taken relative to the first pose to keep the sums well conditioned.
+ *
+ * The last \c windowSize poses are kept additionally. They give the mean and standard deviation
+ * of the error like \c estimatePosition3DError_6D, and allow a robust estimation that reweights
+ * the poses of the window by one of the losses of \c utMath/Optimization/RobustLoss.h.
+ *
+ * @code
+ * IncrementalTipCalibration< double > calibration( 200 );
+ * // for every incoming pose
+ * calibration.add( pose );
+ * Math::Vector3d pw, pm;
+ * if ( calibration.estimate( pw, pm ) )
+ *     showFeedback( pw, calibration.rmsError( pw, pm ) );
+ * @endcode
+ */
+template< typename T >
+class IncrementalTipCalibration
+{
+public:
+	/**
+	 * @param windowSize number of most recent poses kept for the error statistics and the
+	 * robust estimation, 0 keeps none
+	 */
+	explicit IncrementalTipCalibration( const std::size_t windowSize = 0 )
+		: m_windowSize( windowSize )
+	{ reset(); }
+
+	/** removes all poses */
+	void reset()
+	{
+		m_count = 0;
+		m_weight = 0;
+		m_sumSquares = 0;
+		m_sumR = Math::Matrix< double, 3, 3 >::zeros();
+		m_sumRtT = Math::Vector< double, 3 >::zeros();
+		m_sumT = Math::Vector< double, 3 >::zeros();
+		m_origin = Math::Vector< double, 3 >::zeros();
+		m_window.clear();
+	}
+
+	/**
+	 * adds a pose of the pivoted body
+	 * @param pose the pose of the body
+	 * @param weight positive weight of the pose in the least-square solution, poses without weight are ignored
+	 */
+	void add( const Math::Pose& pose, const double weight = 1 )
+	{
+		if ( !( weight > 0 ) )
+			return;
+
+		if ( m_count == 0 )
+			m_origin = pose.translation();
+		m_count++;
+		m_weight += weight;
+
+		Math::Matrix< double, 3, 3 > r;
+		pose.rotation().toMatrix( r );
+		const Math::Vector< double, 3 > t( pose.translation() - m_origin );
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			for ( std::size_t j = 0; j < 3; j++ )
+				m_sumR( i, j ) += weight * r( i, j );
+			m_sumRtT( i ) += weight * ( r( 0, i ) * t( 0 ) + r( 1, i ) * t( 1 ) + r( 2, i ) * t( 2 ) );
+			m_sumT( i ) += weight * t( i );
+			m_sumSquares += weight * t( i ) * t( i );
+		}
+
+		if ( m_windowSize > 0 )
+		{
+			if ( m_window.size() == m_windowSize )
+				m_window.pop_front();
+			m_window.push_back( pose );
+		}
+	}
+
+	/** number of poses added */
+	std::size_t size() const
+	{ return m_count; }
+
+	/** the most recent poses, at most \c windowSize */
+	const std::deque< Math::Pose >& window() const
+	{ return m_window; }
+
+	/**
+	 * computes the least-square solution of all poses added so far
+	 * @param pw returns the constant point in world coordinates
+	 * @param pm returns the constant point in body coordinates
+	 * @return false if there are less than three poses or the rotations do not determine the tip
+	 */
+	bool estimate( Math::Vector< T, 3 >& pw, Math::Vector< T, 3 >& pm ) const
+	{
+		if ( m_count < 3 )
+			return false;
+
+		// normal equations [ W I, -S^T; -S, W I ] ( pm pw' ) = ( -sum R^T t, sum t )
+		Math::Matrix< double, 6, 6 > n( Math::Matrix< double, 6, 6 >::zeros() );
+		Math::Vector< double, 6 > x;
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			n( i, i ) = m_weight;
+			n( i + 3, i + 3 ) = m_weight;
+			for ( std::size_t j = 0; j < 3; j++ )
+				n( i + 3, j ) = -m_sumR( i, j );
+			x( i ) = -m_sumRtT( i );
+			x( i + 3 ) = m_sumT( i );
+		}
+		if ( !Math::choleskySolve( n, x ) )
+			return false;
+
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			pm( i ) = static_cast< T >( x( i ) );
+			pw( i ) = static_cast< T >( x( i + 3 ) + m_origin( i ) );
+		}
+		return true;
+	}
+
+	/**
+	 * computes the root mean square distance @f$ | R_i p_m + t_i - p_w | @f$ over all poses added
+	 * so far in O(1), weighted like the least-square solution
+	 */
+	T rmsError( const Math::Vector< T, 3 >& pw, const Math::Vector< T, 3 >& pm ) const
+	{
+		if ( m_count == 0 )
+			return 0;
+
+		// sum | R pm + t - pw |^2 expanded into the accumulated sums
+		double p[ 3 ], w[ 3 ];
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			p[ i ] = pm( i );
+			w[ i ] = pw( i ) - m_origin( i );
+		}
+		double sum = m_sumSquares;
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			double sp = 0;
+			for ( std::size_t j = 0; j < 3; j++ )
+				sp += m_sumR( i, j ) * p[ j ];
+			sum += m_weight * ( p[ i ] * p[ i ] + w[ i ] * w[ i ] ) + 2 * ( p[ i ] * m_sumRtT( i ) - w[ i ] * m_sumT( i ) - w[ i ] * sp );
+		}
+		return static_cast< T >( std::sqrt( std::max( sum, 0.0 ) / m_weight ) );
+	}
+
+	/**
+	 * computes the mean and standard deviation of the error of the poses in the window,
+	 * see \c estimatePosition3DError_6D
+	 */
+	std::pair< T, T > windowError( const Math::Vector< T, 3 >& pw, const Math::Vector< T, 3 >& pm ) const
+	{ return estimatePosition3DError_6D( pw, m_window.begin(), m_window.end(), pm ); }
+
+	/**
+	 * computes a robust solution from the poses in the window by iteratively reweighted least
+	 * squares, starting with equal weights
+	 *
+	 * @param pw returns the constant point in world coordinates
+	 * @param pm returns the constant point in body coordinates
+	 * @param loss a loss of \c utMath/Optimization/RobustLoss.h, e.g. \c HuberLoss, its scale is a distance
+	 * @param iterations number of reweighting iterations
+	 * @return false if the window does not determine the tip
+	 */
+	template< class Loss >
+	bool estimateRobust( Math::Vector< T, 3 >& pw, Math::Vector< T, 3 >& pm, const Loss& loss,
+		const std::size_t iterations = 10 ) const
+	{
+		IncrementalTipCalibration< T > weighted;
+		for ( std::size_t i = 0; i < m_window.size(); i++ )
+			weighted.add( m_window[ i ] );
+		if ( !weighted.estimate( pw, pm ) )
+			return false;
+
+		for ( std::size_t k = 0; k < iterations; k++ )
+		{
+			weighted.reset();
+			for ( std::size_t i = 0; i < m_window.size(); i++ )
+			{
+				const Math::Vector< double, 3 > pmd( pm( 0 ), pm( 1 ), pm( 2 ) );
+				const Math::Vector< double, 3 > d( m_window[ i ] * pmd );
+				const double s = ( d( 0 ) - pw( 0 ) ) * ( d( 0 ) - pw( 0 ) ) + ( d( 1 ) - pw( 1 ) ) * ( d( 1 ) - pw( 1 ) )
+					+ ( d( 2 ) - pw( 2 ) ) * ( d( 2 ) - pw( 2 ) );
+				weighted.add( m_window[ i ], loss.weight( s ) );
+			}
+			if ( !weighted.estimate( pw, pm ) )
+				return false;
+		}
+		return true;
+	}
+
+protected:
+	/** maximum number of poses in the window */
+	std::size_t m_windowSize;
+
+	/** number of poses and sum of their weights */
+	std::size_t m_count;
+	double m_weight;
+
+	/** translation of the first pose, the sums use translations relative to it */
+	Math::Vector< double, 3 > m_origin;
+
+	/** weighted sums of R, R^T t, t and | t |^2 */
+	Math::Matrix< double, 3, 3 > m_sumR;
+	Math::Vector< double, 3 > m_sumRtT;
+	Math::Vector< double, 3 > m_sumT;
+	double m_sumSquares;
+
+	/** the most recent poses */
+	std::deque< Math::Pose > m_window;
+};
+
+}}} // namespace Ubitrack::Algorithm::ToolTip
+
+#endif //__UBITRACK_ALGROITHM_TOOLTIP_INCREMENTAL_CALIBRATION_H_INCLUDED__
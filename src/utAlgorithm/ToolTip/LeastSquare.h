@@ -38,6 +38,7 @@
 #include <utMath/Pose.h>
 #include <utMath/Matrix.h>
 #include <utMath/Blas1.h>
+#include "ErrorEstimation.h"
 
 #ifdef HAVE_LAPACK
 
@@ -127,6 +128,31 @@ bool estimatePosition3D_6D( Math::Vector< T, 3 >& pw
 
 }
 
+/**
+ * @ingroup tracking_algorithms
+ * Computes the tooltip/hotspot calibration in a least-square fashion, together with the
+ * error statistics of \c estimatePosition3DError_6D and the covariance of the solution.
+ *
+ * Both are computed by \c estimatePosition3DErrorCovariance_6D in a single pass over the poses
+ * after the solution, instead of one pass for the errors and another one for their deviation.
+ *
+ * @param error returns the mean value and the standard deviation of the error
+ * @param covariance returns the 6-by-6 covariance of pm (first three) and pw (last three)
+ */
+template< typename T, typename InputIterator >
+bool estimatePosition3D_6D( Math::Vector< T, 3 >& pw
+	, const InputIterator iBegin
+	, const InputIterator iEnd
+	, Math::Vector< T, 3 >& pm
+	, std::pair< T, T >& error
+	, Math::Matrix< T, 6, 6 >& covariance )
+{
+	if( !estimatePosition3D_6D( pw, iBegin, iEnd, pm ) )
+		return false;
+	error = estimatePosition3DErrorCovariance_6D( pw, iBegin, iEnd, pm, covariance );
+	return true;
+}
+
 }}} // namespace Ubitrack::Algorithm::ToolTip
 
 #endif //__UBITRACK_ALGROITHM_TOOLTIP_LEASTSQUARES_H_INCLUDED__
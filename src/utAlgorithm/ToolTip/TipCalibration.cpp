@@ -80,6 +80,26 @@ std::pair< double, double > estimatePosition3DError_6D( const Math::Vector3d& pw
 	return estimatePosition3DError_6D( pw, poses.begin(), poses.end(), pm );
 }
 
+/// @internal specialization of tooltip calibration with error and covariance for type \c float
+bool estimatePosition3D_6D( Math::Vector3f& pw
+	, const std::vector< Math::Pose >& poses 
+	, Math::Vector3f& pm
+	, std::pair< float, float >& error
+	, Math::Matrix< float, 6, 6 >& covariance )
+{
+	return estimatePosition3D_6D( pw, poses.begin(), poses.end(), pm, error, covariance );
+}
+
+/// @internal specialization of tooltip calibration with error and covariance for type \c double
+bool estimatePosition3D_6D( Math::Vector3d& pw
+	, const std::vector< Math::Pose >& poses 
+	, Math::Vector3d& pm
+	, std::pair< double, double >& error
+	, Math::Matrix< double, 6, 6 >& covariance )
+{
+	return estimatePosition3D_6D( pw, poses.begin(), poses.end(), pm, error, covariance );
+}
+
 /// @internal specialization of non-linearly optimized tooltip calibration for type \c float
 bool estimatePosition3D_6D( Math::Vector3f& pw
 	, const std::vector< Math::Pose >& poses 
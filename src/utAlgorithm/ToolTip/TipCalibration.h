@@ -40,6 +40,7 @@
 #include <utCore.h>
 #include <utMath/Pose.h>
 #include <utMath/Vector.h> //includes std::vector
+#include <utMath/Matrix.h>
 
 namespace Ubitrack { namespace Algorithm { namespace ToolTip {
 
@@ -101,6 +102,32 @@ UBITRACK_EXPORT std::pair< double, double > estimatePosition3DError_6D( const Ma
 	, const Math::Vector3d& pm );
 
 
+/**
+ * @ingroup tracking_algorithms
+ * Computes the tooltip/hotspot calibration together with its error and covariance.
+ *
+ * Gives the same results as \c estimatePosition3D_6D followed by \c estimatePosition3DError_6D,
+ * but the error statistics and the covariance are computed in a single pass over the poses.
+ *
+ * @param pw returns the constant point in world coordinates
+ * @param poses the list of poses that
+ * @param pm returns the constant point in body coordinates
+ * @param error returns the mean value and the standard deviation of the error
+ * @param covariance returns the 6-by-6 covariance of pm (first three) and pw (last three)
+ */
+UBITRACK_EXPORT bool estimatePosition3D_6D( Math::Vector3f& pw
+	, const std::vector< Math::Pose >& poses 
+	, Math::Vector3f& pm
+	, std::pair< float, float >& error
+	, Math::Matrix< float, 6, 6 >& covariance );
+
+UBITRACK_EXPORT bool estimatePosition3D_6D( Math::Vector3d& pw
+	, const std::vector< Math::Pose >& poses 
+	, Math::Vector3d& pm
+	, std::pair< double, double >& error
+	, Math::Matrix< double, 6, 6 >& covariance );
+
+
 /// old version of function call, please use instead: \c bool estimatePosition3D_6D( Math::Vector3f& pw, const std::vector< Math::Pose >& poses , Math::Vector3f& pm );
 UBITRACK_EXPORT void tipCalibration( const std::vector< Math::Pose >& poses, 
 	Math::Vector3d& pm, Math::Vector3d& pw );
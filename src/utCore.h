@@ -45,5 +45,25 @@
 #	define UBITRACK_EXPORT
 #endif
 
+/*
+ * UBITRACK_COLD marks functions that are rarely called, e.g. on error paths, so that the
+ * compiler keeps them and the code leading to them out of the hot code layout.
+ * UBITRACK_NORETURN marks functions that never return, e.g. because they always throw.
+ * UBITRACK_UNLIKELY( x ) marks conditions that are rarely true.
+ */
+#if defined( __GNUC__ )
+#	define UBITRACK_COLD __attribute__(( cold, noinline ))
+#	define UBITRACK_NORETURN __attribute__(( noreturn ))
+#	define UBITRACK_UNLIKELY( x ) __builtin_expect( !!( x ), 0 )
+#elif defined( _MSC_VER )
+#	define UBITRACK_COLD __declspec( noinline )
+#	define UBITRACK_NORETURN __declspec( noreturn )
+#	define UBITRACK_UNLIKELY( x ) ( x )
+#else
+#	define UBITRACK_COLD
+#	define UBITRACK_NORETURN
+#	define UBITRACK_UNLIKELY( x ) ( x )
+#endif
+
 #endif
 
@@ -43,6 +43,7 @@
 #define __UBITRACK_MATH_BLAS_LEVEL_1_H__
 
 #include "Util/vector_traits.h"
+#include "Util/simd_kernels.h"
 #include <utUtil/StaticAssert.h>
 
 
@@ -101,6 +102,25 @@ protected:
 	{
 		UBITRACK_STATIC_ASSERT( ( Math::Util::has_fixed_storage< VecType >::value ), VECTOR_TYPE_OF_FIXED_STORAGE_CATEGORY_EXPECTED );
 		typedef typename Math::Util::vector_traits< VecType >::value_type value_type;
+		static const std::size_t size = Math::Util::vector_traits< VecType >::size;
+		
+		return this->operator()( vec1, vec2, typename Math::Util::has_simd_kernel< value_type, size >::type() );
+	}
+	
+	/// @internal function for small fixed storage vectors, uses the SIMD kernel
+	template< typename VecType >
+	typename Math::Util::vector_traits< VecType >::value_type operator() ( const VecType& vec1, const VecType& vec2, const Ubitrack::Util::true_type ) const
+	{
+		typedef typename Math::Util::vector_traits< VecType >::value_type value_type;
+		
+		return Math::Util::simd_dot< value_type, Math::Util::vector_traits< VecType >::size >( &vec1[ 0 ], &vec2[ 0 ] );
+	}
+	
+	/// @internal function for other fixed storage vectors, uses the internal functor
+	template< typename VecType >
+	typename Math::Util::vector_traits< VecType >::value_type operator() ( const VecType& vec1, const VecType& vec2, const Ubitrack::Util::false_type ) const
+	{
+		typedef typename Math::Util::vector_traits< VecType >::value_type value_type;
 		
 		return inner_product_impl< value_type, Math::Util::vector_traits< VecType >::size >()( vec1, vec2, 0 );
 	}
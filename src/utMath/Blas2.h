@@ -45,6 +45,7 @@
 
 #include "Util/vector_traits.h"
 #include "Util/matrix_traits.h"
+#include "Util/simd_kernels.h"
 #include "Geometry/container_traits.h"
 #include "Stochastic/identity_iterator.h"
 
@@ -90,7 +91,10 @@ public:
 		VT *ptr = Math::Util::matrix_traits< RetType >::ptr( result );
 		
 		// call for column-major representation:
-		outer_product_impl< size1, size1, size2 >() ( vec1, vec2, ptr );
+		typedef typename Math::Util::has_simd_kernel< VT, size1, size2
+			, typename Math::Util::vector_traits< VectorType1 >::value_type
+			, typename Math::Util::vector_traits< VectorType2 >::value_type >::type simd_category;
+		this->compute< size1, size2 >( vec1, vec2, ptr, simd_category() );
 	}
 	
 		/**
@@ -120,6 +124,20 @@ public:
 	}
 	
 protected:
+	/// @internal small vectors of the same type, uses the SIMD kernel
+	template< std::size_t size1, std::size_t size2, typename VectorType1, typename VectorType2 >
+	void compute( const VectorType1& vec1, const VectorType2& vec2, VT* ptr, const Ubitrack::Util::true_type ) const
+	{
+		Math::Util::simd_outer< VT, size1, size2 >( &vec1[ 0 ], &vec2[ 0 ], ptr );
+	}
+	
+	/// @internal all other vectors, uses the internal functor
+	template< std::size_t size1, std::size_t size2, typename VectorType1, typename VectorType2 >
+	void compute( const VectorType1& vec1, const VectorType2& vec2, VT* ptr, const Ubitrack::Util::false_type ) const
+	{
+		outer_product_impl< size1, size1, size2 >() ( vec1, vec2, ptr );
+	}
+	
 	/**
 	 * @ingroup math functor
 	 * Internal functor that implements the calculation of the
@@ -206,8 +224,10 @@ public:
 		static const typename Math::Util::matrix_traits< MatrixType >::size_type size2 = Math::Util::matrix_traits< MatrixType >::size2;
 
 		// call for column-major representation (there is no row_major call yet)
-		// mat_vec_product_impl_forward< size1, size2, 0, 0 >() ( lhs, rhs, result );
-		mat_vec_product_impl_backward< size1, size2, size1, size2 >() ( lhs, rhs, result );
+		typedef typename Math::Util::has_simd_kernel< value_type, size1, size2
+			, typename Math::Util::vector_traits< VectorType >::value_type
+			, typename Math::Util::vector_traits< RetType >::value_type >::type simd_category;
+		this->compute< size1, size2 >( lhs, rhs, result, simd_category() );
 	}
 	
 	template< typename MatrixType, typename VectorType >
@@ -219,6 +239,22 @@ public:
 	}
 	
 protected:
+	/// @internal small matrices and vectors of the same type, uses the SIMD kernel
+	template< std::size_t size1, std::size_t size2, typename MatrixType, typename VectorType, typename RetType >
+	void compute( const MatrixType& lhs, const VectorType& rhs, RetType& result, const Ubitrack::Util::true_type ) const
+	{
+		typedef typename Math::Util::matrix_traits< MatrixType >::value_type value_type;
+		Math::Util::simd_gemv< value_type, size1, size2 >( Math::Util::matrix_traits< MatrixType >::ptr( lhs ), &rhs[ 0 ], &result[ 0 ] );
+	}
+	
+	/// @internal all other matrices and vectors, uses the internal functor
+	template< std::size_t size1, std::size_t size2, typename MatrixType, typename VectorType, typename RetType >
+	void compute( const MatrixType& lhs, const VectorType& rhs, RetType& result, const Ubitrack::Util::false_type ) const
+	{
+		// mat_vec_product_impl_forward< size1, size2, 0, 0 >() ( lhs, rhs, result );
+		mat_vec_product_impl_backward< size1, size2, size1, size2 >() ( lhs, rhs, result );
+	}
+	
 	/**
 	 * @internal
 	 * Internal functor that implements a matrix-vector product.
@@ -44,6 +44,7 @@
 #define __UBITRACK_MATH_BLAS_LEVEL_3_H__
 
 #include "Util/matrix_traits.h"
+#include "Util/simd_kernels.h"
 #include "Geometry/container_traits.h"
 
 #include "Matrix.h"
@@ -83,8 +84,11 @@ public:
 		static const typename Math::Util::matrix_traits< MatrixTypeRight >::size_type size3 = Math::Util::matrix_traits< MatrixTypeRight >::size2;
 
 		// call for column-major representation (there is no row_major call yet)
-		mat_mat_product_impl_forward< size1, size2, size3, 0, 0, 0 >() ( lhs, rhs, result );
-		//mat_mat_product_impl_backward< size1, size2, size1, size2 >() ( lhs, rhs, result );
+		typedef typename Math::Util::has_simd_kernel< value_type, size1, size2
+			, typename Math::Util::matrix_traits< MatrixTypeRight >::value_type
+			, typename Math::Util::matrix_traits< RetMatrixType >::value_type >::type simd_category;
+		this->compute< size1, size2, size3 >( lhs, rhs, result, typename Ubitrack::Util::constant_value< bool
+			, simd_category::value && ( size3 >= 3 ) && ( size3 <= 4 ) >::type() );
 	}
 	
 	template< typename MatrixTypeLeft, typename MatrixTypeRight >
@@ -96,6 +100,23 @@ public:
 	}
 	
 protected:
+	/// @internal small matrices of the same type, uses the SIMD kernel
+	template< std::size_t size1, std::size_t size2, std::size_t size3, typename MatrixTypeLeft, typename MatrixTypeRight, typename RetMatrixType >
+	void compute( const MatrixTypeLeft& lhs, const MatrixTypeRight& rhs, RetMatrixType& result, const Ubitrack::Util::true_type ) const
+	{
+		typedef typename Math::Util::matrix_traits< MatrixTypeLeft >::value_type value_type;
+		Math::Util::simd_gemm< value_type, size1, size2, size3 >( Math::Util::matrix_traits< MatrixTypeLeft >::ptr( lhs )
+			, Math::Util::matrix_traits< MatrixTypeRight >::ptr( rhs ), Math::Util::matrix_traits< RetMatrixType >::ptr( result ) );
+	}
+	
+	/// @internal all other matrices, uses the internal functor
+	template< std::size_t size1, std::size_t size2, std::size_t size3, typename MatrixTypeLeft, typename MatrixTypeRight, typename RetMatrixType >
+	void compute( const MatrixTypeLeft& lhs, const MatrixTypeRight& rhs, RetMatrixType& result, const Ubitrack::Util::false_type ) const
+	{
+		mat_mat_product_impl_forward< size1, size2, size3, 0, 0, 0 >() ( lhs, rhs, result );
+		//mat_mat_product_impl_backward< size1, size2, size1, size2 >() ( lhs, rhs, result );
+	}
+	
 	/**
 	 * @internal
 	 * Internal functor that implements a matrix-matrix product.
@@ -39,6 +39,9 @@
 
 //Boost
 #include <boost/serialization/access.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/atomic.hpp>
 
 //Ubitrack
 #include <utMath/Vector.h>
@@ -46,6 +49,17 @@
 
 namespace Ubitrack { namespace Math {
 
+namespace internal {
+
+/// @internal returns a new process-wide unique version number of camera intrinsics, never 0
+inline std::size_t nextIntrinsicsVersion()
+{
+	static boost::atomic< std::size_t > s_counter( 0 );
+	return ++s_counter;
+}
+
+} // namespace internal
+
 /**
  * @ingroup math
  * Stores all intrinsics camera parameters to have one compact 
@@ -201,6 +215,17 @@ public:
 		{
 			reset();
 		}
+
+	/** Copy constructor, the copy shares the derived quantities of \c rhs */
+	CameraIntrinsics( const CameraIntrinsics< T >& rhs )
+		: calib_type( rhs.calib_type )
+		, dimension( rhs.dimension )
+		, matrix( rhs.matrix )
+		, radial_size( rhs.radial_size )
+		, radial_params( rhs.radial_params )
+		, tangential_params( rhs.tangential_params )
+		, m_derived( boost::atomic_load( &rhs.m_derived ) )
+		{}
 		
 	CameraIntrinsics& operator= ( const CameraIntrinsics< T >& rhs )
 	{
@@ -211,8 +236,97 @@ public:
 		this->radial_size		= rhs.radial_size;
 		this->radial_params		= rhs.radial_params;
 		this->tangential_params	= rhs.tangential_params;
+		boost::atomic_store( &m_derived, boost::atomic_load( &rhs.m_derived ) );
 		return *this;
 	}
+
+	/**
+	 * Quantities derived from the intrinsics, computed once per set of parameters.
+	 *
+	 * The bundle is immutable and shared by all copies of the intrinsics, its \c version 
+	 * identifies the parameters and can be used as a key by caches of more expensive 
+	 * derived data, e.g. undistortion maps or OpenGL projections.
+	 */
+	struct Derived
+	{
+		/** process-wide unique number of this set of parameters */
+		std::size_t version;
+
+		/** inverse of the intrinsic matrix */
+		matrix_type inverse;
+
+		explicit Derived( const CameraIntrinsics< T >& intrinsics )
+			: version( internal::nextIntrinsicsVersion() )
+			, m_calibType( intrinsics.calib_type )
+			, m_dimension( intrinsics.dimension )
+			, m_matrix( intrinsics.matrix )
+			, m_radialSize( intrinsics.radial_size )
+			, m_radial( intrinsics.radial_params )
+			, m_tangential( intrinsics.tangential_params )
+		{
+			// the intrinsic matrix is upper triangular
+			const matrix_type& k = intrinsics.matrix;
+			inverse = matrix_type::zeros();
+			inverse( 0, 0 ) = 1 / k( 0, 0 );
+			inverse( 1, 1 ) = 1 / k( 1, 1 );
+			inverse( 2, 2 ) = 1 / k( 2, 2 );
+			inverse( 0, 1 ) = -k( 0, 1 ) * inverse( 0, 0 ) * inverse( 1, 1 );
+			inverse( 1, 2 ) = -k( 1, 2 ) * inverse( 1, 1 ) * inverse( 2, 2 );
+			inverse( 0, 2 ) = -( k( 0, 1 ) * inverse( 1, 2 ) + k( 0, 2 ) * inverse( 2, 2 ) ) * inverse( 0, 0 );
+		}
+
+		/** @return true if the bundle was derived from the current parameters of \c intrinsics */
+		bool matches( const CameraIntrinsics< T >& intrinsics ) const
+		{
+			if ( m_calibType != intrinsics.calib_type || m_radialSize != intrinsics.radial_size
+				|| m_dimension( 0 ) != intrinsics.dimension( 0 ) || m_dimension( 1 ) != intrinsics.dimension( 1 ) )
+				return false;
+			for ( std::size_t i = 0; i < 3; i++ )
+				for ( std::size_t j = 0; j < 3; j++ )
+					if ( m_matrix( i, j ) != intrinsics.matrix( i, j ) )
+						return false;
+			for ( std::size_t i = 0; i < 6; i++ )
+				if ( m_radial( i ) != intrinsics.radial_params( i ) )
+					return false;
+			return m_tangential( 0 ) == intrinsics.tangential_params( 0 ) 
+				&& m_tangential( 1 ) == intrinsics.tangential_params( 1 );
+		}
+
+	private:
+		// the parameters the bundle was derived from
+		CalibType m_calibType;
+		Math::Vector< std::size_t, 2 > m_dimension;
+		matrix_type m_matrix;
+		std::size_t m_radialSize;
+		radial_type m_radial;
+		tangential_type m_tangential;
+	};
+
+	/**
+	 * returns the quantities derived from the current parameters.
+	 *
+	 * The bundle is computed lazily and only recomputed if a parameter has changed since, 
+	 * which is detected by comparing the parameters, so the members can still be modified directly.
+	 * Safe to call concurrently on the same object as long as no thread modifies the parameters.
+	 */
+	boost::shared_ptr< const Derived > derived() const
+	{
+		boost::shared_ptr< const Derived > pDerived( boost::atomic_load( &m_derived ) );
+		if ( !pDerived || !pDerived->matches( *this ) )
+		{
+			pDerived = boost::make_shared< const Derived >( *this );
+			boost::atomic_store( &m_derived, pDerived );
+		}
+		return pDerived;
+	}
+
+	/** returns a process-wide unique number that changes whenever a parameter changes */
+	std::size_t version() const
+	{ return derived()->version; }
+
+	/** returns the inverse of the intrinsic matrix, cached until a parameter changes */
+	matrix_type inverse() const
+	{ return derived()->inverse; }
 	
 	void reset()
 	{
@@ -298,6 +412,9 @@ protected:
 		
 		reset();
 	}
+
+	/** lazily computed derived quantities, shared between copies */
+	mutable boost::shared_ptr< const Derived > m_derived;
 };
 
 
@@ -24,8 +24,10 @@
 
 #include "ErrorPose.h"
 #include "ErrorVector.h"
+#include "Blas3.h"
 #include "Stochastic/CovarianceTransform.h"
 
+#include <boost/bind.hpp>
 #include <boost/math/constants/constants.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/vector_proxy.hpp>
@@ -484,6 +486,161 @@ struct ErrorConversion
 
 };
 
+/// @internal 3x3 block of a pose covariance or jacobian
+typedef Matrix< double, 3, 3 > Block3;
+
+/// @internal copies the 3x3 block of m starting at ( row, col ), optionally transposed
+template< class MT >
+void getBlock( Block3& b, const MT& m, const std::size_t row, const std::size_t col, const bool transposed = false )
+{
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			if ( transposed )
+				b( j, i ) = m( row + i, col + j );
+			else
+				b( i, j ) = m( row + i, col + j );
+}
+
+
+/**
+ * @internal
+ * A pose covariance [ P Q ; Q^T S ] split into the translation block P, the translation-rotation
+ * block Q and the rotation block S.
+ *
+ * The jacobians of the pose product have the block structure
+ *   J1 = [ I A ; 0 B ] (first pose), J2 = [ R 0 ; 0 I ] (second pose),
+ * so the sandwiches J * C * J^T reduce to a few 3x3 products, which the Blas3 \c product
+ * computes with the SIMD kernels. Of the symmetric diagonal blocks only the upper triangle
+ * is written back.
+ */
+struct CovarianceBlocks
+{
+	Block3 p;
+	Block3 q;
+	Block3 s;
+
+	CovarianceBlocks()
+	{}
+
+	explicit CovarianceBlocks( const Matrix< double, 6, 6 >& c )
+	{
+		getBlock( p, c, 0, 0 );
+		getBlock( q, c, 0, 3 );
+		getBlock( s, c, 3, 3 );
+	}
+
+	void add( const CovarianceBlocks& c )
+	{
+		noalias( p ) += c.p;
+		noalias( q ) += c.q;
+		noalias( s ) += c.s;
+	}
+
+	/** assembles the 6x6 covariance, mirroring the upper triangles of the diagonal blocks */
+	void toMatrix( Matrix< double, 6, 6 >& c ) const
+	{
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			for ( std::size_t j = i; j < 3; j++ )
+			{
+				c( i, j ) = c( j, i ) = p( i, j );
+				c( i + 3, j + 3 ) = c( j + 3, i + 3 ) = s( i, j );
+			}
+			for ( std::size_t j = 0; j < 3; j++ )
+				c( i, j + 3 ) = c( j + 3, i ) = q( i, j );
+		}
+	}
+};
+
+
+/**
+ * @internal
+ * translation block P + A Q^T + Q A^T + A S A^T of the sandwich with [ I A ], computed as
+ * P + A Q^T + ( Q + A S ) A^T. \c qas receives Q + A S.
+ */
+void translationSandwich( Block3& result, Block3& qas, const Block3& a, const CovarianceBlocks& c )
+{
+	Block3 at;
+	Block3 qt;
+	Block3 tmp;
+	getBlock( at, a, 0, 0, true );
+	getBlock( qt, c.q, 0, 0, true );
+
+	product( a, c.s, qas );
+	noalias( qas ) += c.q;
+	product( a, qt, result );
+	product( qas, at, tmp );
+	noalias( result ) += c.p;
+	noalias( result ) += tmp;
+}
+
+
+/** @internal J1 * C * J1^T with the jacobian J1 = [ I A ; 0 B ] of the product wrt. the first pose */
+void propagateFirst( CovarianceBlocks& result, const Matrix< double, 6, 6 >& j1, const CovarianceBlocks& c )
+{
+	Block3 a;
+	Block3 b;
+	Block3 bt;
+	Block3 qas;
+	Block3 tmp;
+	getBlock( a, j1, 0, 3 );
+	getBlock( b, j1, 3, 3 );
+	getBlock( bt, j1, 3, 3, true );
+
+	translationSandwich( result.p, qas, a, c );
+	product( qas, bt, result.q );
+	product( b, c.s, tmp );
+	product( tmp, bt, result.s );
+}
+
+
+/** @internal J2 * C * J2^T with the jacobian J2 = [ R 0 ; 0 I ] of the product wrt. the second pose */
+void propagateSecond( CovarianceBlocks& result, const Matrix< double, 6, 6 >& j2, const CovarianceBlocks& c )
+{
+	Block3 r;
+	Block3 rt;
+	Block3 tmp;
+	getBlock( r, j2, 0, 0 );
+	getBlock( rt, j2, 0, 0, true );
+
+	product( r, c.p, tmp );
+	product( tmp, rt, result.p );
+	product( r, c.q, result.q );
+	result.s = c.s;
+}
+
+
+/** @internal covariance of the product of two uncertain poses */
+void productCovariance( Matrix< double, 6, 6 >& result, const Pose& a, const Matrix< double, 6, 6 >& covA,
+	const Pose& b, const Matrix< double, 6, 6 >& covB )
+{
+	Matrix< double, 6, 6 > jacobian1;
+	Matrix< double, 6, 6 > jacobian2;
+	multiplicationJacobians( jacobian1, jacobian2, a, b );
+
+	CovarianceBlocks first;
+	CovarianceBlocks second;
+	propagateFirst( first, jacobian1, CovarianceBlocks( covA ) );
+	propagateSecond( second, jacobian2, CovarianceBlocks( covB ) );
+	first.add( second );
+	first.toMatrix( result );
+}
+
+
+/** @internal covariance of p * x due to the pose error, with the jacobian [ I M ] of errorPoseTimesVectorJacobian */
+void poseTimesVectorCovariance( Matrix< double, 3, 3 >& result, const Matrix< double, 3, 6 >& jacobian, const CovarianceBlocks& c )
+{
+	Block3 m;
+	Block3 qms;
+	Block3 tmp;
+	getBlock( m, jacobian, 0, 3 );
+	translationSandwich( tmp, qms, m, c );
+
+	for ( std::size_t i = 0; i < 3; i++ )
+		for ( std::size_t j = i; j < 3; j++ )
+			result( i, j ) = result( j, i ) = tmp( i, j );
+}
+
 } // anonymous namespace
 
 
@@ -504,17 +661,8 @@ ErrorPose ErrorPose::operator~() const
 ErrorPose operator*( const ErrorPose& a, const ErrorPose& b )
 {
 	// covariance transform
-	Matrix< double, 6, 6 > jacobian1;
-	Matrix< double, 6, 6 > jacobian2;
-	Matrix< double, 6, 6 > tmp;
 	Matrix< double, 6, 6 > newCovariance;
-	multiplicationJacobians( jacobian1, jacobian2, a, b );
-	
-	// here we could save some time by regarding the zero and identity blocks of the jacobians...
-	noalias( tmp ) = ublas::prod( jacobian1, a.covariance() );
-	noalias( newCovariance ) = ublas::prod( tmp, ublas::trans( jacobian1 ) );
-	noalias( tmp ) = ublas::prod( jacobian2, b.covariance() );
-	noalias( newCovariance ) += ublas::prod( tmp, ublas::trans( jacobian2 ) );
+	productCovariance( newCovariance, a, a.covariance(), b, b.covariance() );
 
 	return ErrorPose( static_cast< const Pose& >( a ) * static_cast< const Pose& >( b ), newCovariance );
 }
@@ -525,13 +673,12 @@ ErrorPose operator*( const Pose& a, const ErrorPose& b )
 	// covariance transform
 	Matrix< double, 6, 6 > jacobian1;
 	Matrix< double, 6, 6 > jacobian2;
-	Matrix< double, 6, 6 > tmp;
 	Matrix< double, 6, 6 > newCovariance;
 	multiplicationJacobians( jacobian1, jacobian2, a, b );
-	
-	// here we could save some time by regarding the zero and identity blocks of the jacobians...
-	noalias( tmp ) = ublas::prod( jacobian2, b.covariance() );
-	noalias( newCovariance ) = ublas::prod( tmp, ublas::trans( jacobian2 ) );
+
+	CovarianceBlocks propagated;
+	propagateSecond( propagated, jacobian2, CovarianceBlocks( b.covariance() ) );
+	propagated.toMatrix( newCovariance );
 
 	return ErrorPose( static_cast< const Pose& >( a ) * static_cast< const Pose& >( b ), newCovariance );
 }
@@ -542,13 +689,12 @@ ErrorPose operator*( const ErrorPose& a, const Pose& b )
 	// covariance transform
 	Matrix< double, 6, 6 > jacobian1;
 	Matrix< double, 6, 6 > jacobian2;
-	Matrix< double, 6, 6 > tmp;
 	Matrix< double, 6, 6 > newCovariance;
 	multiplicationJacobians( jacobian1, jacobian2, a, b );
 
-	// here we could save some time by regarding the zero and identity blocks of the jacobians...
-	noalias( tmp ) = ublas::prod( jacobian1, a.covariance() );
-	noalias( newCovariance ) = ublas::prod( tmp, ublas::trans( jacobian1 ) );
+	CovarianceBlocks propagated;
+	propagateFirst( propagated, jacobian1, CovarianceBlocks( a.covariance() ) );
+	propagated.toMatrix( newCovariance );
 
 	return ErrorPose( static_cast< const Pose& >( a ) * static_cast< const Pose& >( b ), newCovariance );
 }
@@ -560,11 +706,8 @@ ErrorVector< double, 3 > operator*( const ErrorPose& a, const Math::Vector< doub
 	Matrix< double, 3, 6 > jacobian;
 	errorPoseTimesVectorJacobian( jacobian, a, b );
 
-	Matrix< double, 3, 6 > tmp;
 	Matrix< double, 3, 3 > newCovariance;
-
-	noalias( tmp ) = ublas::prod( jacobian, a.covariance() );
-	noalias( newCovariance ) = ublas::prod( tmp, ublas::trans( jacobian ) );
+	poseTimesVectorCovariance( newCovariance, jacobian, CovarianceBlocks( a.covariance() ) );
 
 	return ErrorVector< double, 3 >( static_cast< const Pose& >( a ) * b, newCovariance );
 }
@@ -573,41 +716,135 @@ ErrorVector< double, 3 > operator*( const ErrorPose& a, const Math::Vector< doub
 
 ErrorVector< double, 3 > operator*( const ErrorPose& a, const Math::ErrorVector< double, 3 >& b )
 {
-	
-	// covariance transform
+	// covariance transform of the pose and the point
 	Matrix< double, 3, 6 > jacobian;
 	errorPoseTimesVectorJacobian( jacobian, a, b.value );
+	Matrix< double, 3, 3 > rotation;
+	a.rotation().toMatrix( rotation );
+
+	ErrorVector< double, 3 > result;
+	poseTimesVectorCovariance( result.covariance, jacobian, CovarianceBlocks( a.covariance() ) );
+	Stochastic::addSymmetricTransform( result.covariance, rotation, b.covariance );
+	result.value = static_cast< const Pose& >( a ) * b.value;
+	return result;
+}
 
-	Matrix< double, 3, 6 > tmp;
-	Matrix< double, 3, 3 > newCovariance;
 
-	noalias( tmp ) = ublas::prod( jacobian, a.covariance() );
-	noalias( newCovariance ) = ublas::prod( tmp, ublas::trans( jacobian ) );
+void transformErrorPositionList( const Pose& p, const std::vector< ErrorVector< double, 3 > >& points,
+	std::vector< ErrorVector< double, 3 > >& result, const ListExecutor& executor )
+{
+	Matrix< double, 3, 3 > rotation;
+	p.rotation().toMatrix( rotation );
+	Stochastic::transformListWithCovariance( rotation, p.translation(), points, result, executor );
+}
+
+
+namespace {
 
-	return ErrorVector< double, 3 >( static_cast< const Pose& >( a ) * b.value, newCovariance );
+/// @internal y = p * x as function of x, whose jacobian is the rotation, and of the pose error
+struct ErrorPoseTimesPoint
+{
+	const ErrorPose& m_pose;
+	Matrix< double, 3, 3 > m_rotation;
+	CovarianceBlocks m_covariance;
+
+	ErrorPoseTimesPoint( const ErrorPose& p )
+		: m_pose( p )
+		, m_covariance( p.covariance() )
+	{ p.rotation().toMatrix( m_rotation ); }
+
+	void transformRange( const std::vector< ErrorVector< double, 3 > >& points, std::vector< ErrorVector< double, 3 > >& result,
+		const std::size_t begin, const std::size_t end ) const
+	{
+		Matrix< double, 3, 6 > jacobian;
+		Matrix< double, 3, 3 > covariance;
+		for ( std::size_t i = begin; i < end; i++ )
+		{
+			const Vector< double, 3 > x( points[ i ].value );
+			errorPoseTimesVectorJacobian( jacobian, m_pose, x );
+			poseTimesVectorCovariance( covariance, jacobian, m_covariance );
+			Stochastic::addSymmetricTransform( covariance, m_rotation, points[ i ].covariance );
+			result[ i ].covariance = covariance;
+			result[ i ].value = static_cast< const Pose& >( m_pose ) * x;
+		}
+	}
+};
+
+} // anonymous namespace
+
+
+void transformErrorPositionList( const ErrorPose& p, const std::vector< ErrorVector< double, 3 > >& points,
+	std::vector< ErrorVector< double, 3 > >& result, const ListExecutor& executor )
+{
+	const ErrorPoseTimesPoint f( p );
+	result.resize( points.size() );
+	if ( executor.empty() )
+		f.transformRange( points, result, 0, points.size() );
+	else
+		executor( points.size(), boost::bind( &ErrorPoseTimesPoint::transformRange, &f, boost::cref( points ), boost::ref( result ), _1, _2 ) );
 }
 
 
 ErrorPose invertMultiply( const ErrorPose& a, const ErrorPose& b )
 {
 	// covariance transform
-	Matrix< double, 6, 6 > jacobian1;
-	Matrix< double, 6, 6 > jacobian2;
-	Matrix< double, 6, 6 > tmp;
 	Matrix< double, 6, 6 > newCovariance;
-	multiplicationJacobians( jacobian1, jacobian2, a, b );
-	
-	// here we could save some time by regarding the zero and identity blocks of the jacobians...
-	noalias( tmp ) = ublas::prod( jacobian1, a.covariance() );
-	noalias( newCovariance ) = ublas::prod( tmp, ublas::trans( jacobian1 ) );
-	noalias( tmp ) = ublas::prod( jacobian2, b.covariance() );
-	noalias( newCovariance ) += ublas::prod( tmp, ublas::trans( jacobian2 ) );
+	productCovariance( newCovariance, a, a.covariance(), b, b.covariance() );
 
 	return ErrorPose( ~static_cast< const Pose& >( a ) * static_cast< const Pose& >( b ), newCovariance );
 }
 
 
-void ErrorPose::toAdditiveErrorVector( ErrorVector< double, 7 >& v )
+namespace {
+
+/// @internal propagates the packed covariances of both poses with the jacobians of the product
+template< typename C >
+PackedCovariance< C, 6 > packedProductCovariance( const Pose& a, const PackedCovariance< C, 6 >& covA,
+	const Pose& b, const PackedCovariance< C, 6 >& covB )
+{
+	Matrix< double, 6, 6 > fullA;
+	Matrix< double, 6, 6 > fullB;
+	covA.toMatrix( fullA );
+	covB.toMatrix( fullB );
+
+	Matrix< double, 6, 6 > newCovariance;
+	productCovariance( newCovariance, a, fullA, b, fullB );
+	return PackedCovariance< C, 6 >( newCovariance );
+}
+
+} // anonymous namespace
+
+
+PackedErrorPose< float > operator*( const PackedErrorPose< float >& a, const PackedErrorPose< float >& b )
+{
+	return PackedErrorPose< float >( static_cast< const Pose& >( a ) * static_cast< const Pose& >( b ),
+		packedProductCovariance( a, a.packedCovariance(), b, b.packedCovariance() ) );
+}
+
+
+PackedErrorPose< double > operator*( const PackedErrorPose< double >& a, const PackedErrorPose< double >& b )
+{
+	return PackedErrorPose< double >( static_cast< const Pose& >( a ) * static_cast< const Pose& >( b ),
+		packedProductCovariance( a, a.packedCovariance(), b, b.packedCovariance() ) );
+}
+
+
+// same propagation as invertMultiply( const ErrorPose&, const ErrorPose& )
+PackedErrorPose< float > invertMultiply( const PackedErrorPose< float >& a, const PackedErrorPose< float >& b )
+{
+	return PackedErrorPose< float >( ~static_cast< const Pose& >( a ) * static_cast< const Pose& >( b ),
+		packedProductCovariance( a, a.packedCovariance(), b, b.packedCovariance() ) );
+}
+
+
+PackedErrorPose< double > invertMultiply( const PackedErrorPose< double >& a, const PackedErrorPose< double >& b )
+{
+	return PackedErrorPose< double >( ~static_cast< const Pose& >( a ) * static_cast< const Pose& >( b ),
+		packedProductCovariance( a, a.packedCovariance(), b, b.packedCovariance() ) );
+}
+
+
+void ErrorPose::toAdditiveErrorVector( ErrorVector< double, 7 >& v ) const
 {
 	Pose::toVector( v.value );
 
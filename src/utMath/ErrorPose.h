@@ -37,6 +37,9 @@
 // #include "Pose.h"
 // #include "Matrix.h"
 #include "ErrorVector.h"
+#include "PoseListOperations.h"	// ListExecutor
+
+#include <vector>
 
 namespace Ubitrack { namespace Math {
 
@@ -116,7 +119,7 @@ class UBITRACK_EXPORT ErrorPose
 		 * converts the pose to a ublas vector and the multiplicative 6x6 covariance to an 
 		 * additive 7x7 covariance matrix.
 		 */
-		void toAdditiveErrorVector( ErrorVector< double, 7 >& v );
+		void toAdditiveErrorVector( ErrorVector< double, 7 >& v ) const;
 
 		/**
 		 * creates an ErrorPose from a ublas vector with an additive 7x7 covariance.
@@ -137,6 +140,93 @@ class UBITRACK_EXPORT ErrorPose
 };
 
 
+/**
+ * @ingroup math
+ * A 6D pose with errors like \c ErrorPose, whose covariance is stored as packed upper
+ * triangle of 21 instead of 36 elements, optionally as \c float. This pays off in large
+ * lists of poses and on the wire. The propagation
+ * of \c operator* and \c invertMultiply computes in \c double and only the upper triangle.
+ *
+ * @tparam C type of the covariance elements, \c float or \c double
+ */
+template< typename C >
+class PackedErrorPose
+	: public Pose
+{
+	protected:
+
+	/** the upper triangle of the 6-by-6 covariance */
+	PackedCovariance< C, 6 > m_covariance;
+
+	public:
+
+		typedef double value_type;
+
+		PackedErrorPose()
+		{}
+
+		/**
+		 * construct from quaternion, translation and error
+		 * @param q a rotation
+		 * @param t a translation
+		 * @param c a full or packed 6x6 covariance matrix
+		 */
+		template< class MT >
+		PackedErrorPose( const Quaternion& q, const Vector< double, 3 >& t, const MT& c )
+			: Pose( q, t )
+			, m_covariance( c )
+		{}
+
+		/**
+		 * construct from pose and error
+		 * @param p a pose
+		 * @param c a full or packed 6x6 covariance matrix
+		 */
+		template< class MT >
+		PackedErrorPose( const Pose& p, const MT& c )
+			: Pose( p )
+			, m_covariance( c )
+		{}
+
+		/** packs an \c ErrorPose */
+		explicit PackedErrorPose( const ErrorPose& p )
+			: Pose( p )
+			, m_covariance( p.covariance() )
+		{}
+
+		/**
+		 * get the full covariance
+		 * @return covariance of the pose
+		 */
+		Matrix< double, 6, 6 > covariance() const
+		{
+			Matrix< double, 6, 6 > c;
+			m_covariance.toMatrix( c );
+			return c;
+		}
+
+		/** get the packed covariance */
+		const PackedCovariance< C, 6 >& packedCovariance() const
+		{ return m_covariance; }
+
+		/** unpacks into an \c ErrorPose */
+		ErrorPose toErrorPose() const
+		{ return ErrorPose( *this, covariance() ); }
+
+	protected:
+
+		friend class ::boost::serialization::access;
+
+		/// serialize Pose object
+		template< class Archive >
+		void serialize( Archive& ar, const unsigned int version )
+		{
+			Pose::serialize( ar, version );
+			ar & m_covariance;
+		}
+};
+
+
 /**
  * @internal multiplies two poses and propagates the error of both poses
  */
@@ -168,8 +258,41 @@ UBITRACK_EXPORT ErrorVector< double, 3 > operator*( const ErrorPose& a, const Ma
  */
 UBITRACK_EXPORT ErrorPose invertMultiply( const ErrorPose& a, const ErrorPose& b );
 
+/**
+ * @internal
+ * Propagates the errors of the pose and of the point to the transformed point.
+ */
 UBITRACK_EXPORT ErrorVector< double, 3 > operator*( const ErrorPose& a, const Math::ErrorVector< double, 3 >& b );
 
+/**
+ * Transforms a list of points with covariance by a pose, <tt>result[ i ] = p * points[ i ]</tt>.
+ * The rotation is the jacobian of all points, so it is computed once. The result list is resized
+ * to the size of the input and may be the input list.
+ */
+UBITRACK_EXPORT void transformErrorPositionList( const Pose& p, const std::vector< ErrorVector< double, 3 > >& points,
+	std::vector< ErrorVector< double, 3 > >& result, const ListExecutor& executor = ListExecutor() );
+
+/**
+ * Transforms a list of points with covariance by a pose with error, <tt>result[ i ] = p * points[ i ]</tt>,
+ * propagating the errors of the pose and of the points. See the overload for poses without error.
+ */
+UBITRACK_EXPORT void transformErrorPositionList( const ErrorPose& p, const std::vector< ErrorVector< double, 3 > >& points,
+	std::vector< ErrorVector< double, 3 > >& result, const ListExecutor& executor = ListExecutor() );
+
+/**
+ * multiplies two poses with packed covariance and propagates the error of both poses,
+ * like the \c ErrorPose version
+ */
+UBITRACK_EXPORT PackedErrorPose< float > operator*( const PackedErrorPose< float >& a, const PackedErrorPose< float >& b );
+UBITRACK_EXPORT PackedErrorPose< double > operator*( const PackedErrorPose< double >& a, const PackedErrorPose< double >& b );
+
+/**
+ * Multiplies two poses with packed covariance and inverts one ( A^-1 * B ), like the
+ * \c ErrorPose version.
+ */
+UBITRACK_EXPORT PackedErrorPose< float > invertMultiply( const PackedErrorPose< float >& a, const PackedErrorPose< float >& b );
+UBITRACK_EXPORT PackedErrorPose< double > invertMultiply( const PackedErrorPose< double >& a, const PackedErrorPose< double >& b );
+
 /**
  * performs a linear interpolation between two poses
  * using SLERP and vector interpolation
@@ -183,6 +306,14 @@ UBITRACK_EXPORT ErrorPose linearInterpolate ( const ErrorPose& x, const ErrorPos
 /// @internal stream output operator
 UBITRACK_EXPORT std::ostream& operator<<( std::ostream& s, const ErrorPose& p );
 
+/// @internal stream output operator
+template< typename C >
+std::ostream& operator<<( std::ostream& s, const PackedErrorPose< C >& p )
+{
+	s << p.translation() << " " << p.rotation() << "\n" << p.packedCovariance();
+	return s;
+}
+
 } } // namespace Ubitrack::Math
 
 #endif // __UBITRACK_MATH_ERRORPOSE_H_INCLUDED__
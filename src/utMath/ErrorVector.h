@@ -34,6 +34,7 @@
 
 #include "Vector.h"
 #include "Matrix.h"
+#include "PackedCovariance.h"
 
 #include <boost/numeric/ublas/vector_proxy.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
@@ -97,6 +98,73 @@ struct ErrorVector
 };
 
 
+/**
+ * N-vector with a covariance stored as packed upper triangle, which needs about half the
+ * memory of an \c ErrorVector, e.g. for large lists of points.
+ *
+ * @tparam T type of vector elements
+ * @tparam N size of the vector
+ * @tparam C type of the covariance elements, e.g. \c float
+ */
+template< typename T, std::size_t N, typename C = T >
+struct PackedErrorVector
+{
+	typedef T value_type;
+
+	/** vector contents */
+	Math::Vector< T, N > value;
+
+	/** covariance matrix of \c value, with element access like a \c Matrix */
+	PackedCovariance< C, N > covariance;
+
+	/** default constructor */
+	PackedErrorVector()
+	{}
+
+	/** construct from value and a full or packed covariance */
+	template< class VT, class MT >
+	PackedErrorVector( const VT& _value, const MT& _covariance )
+		: value( _value )
+		, covariance( _covariance )
+	{}
+
+	/** packs an \c ErrorVector */
+	template< typename U >
+	explicit PackedErrorVector( const ErrorVector< U, N >& v )
+		: value( v.value )
+		, covariance( v.covariance )
+	{}
+
+	/** unpacks into an \c ErrorVector */
+	ErrorVector< T, N > toErrorVector() const
+	{
+		ErrorVector< T, N > result;
+		result.value = value;
+		covariance.toMatrix( result.covariance );
+		return result;
+	}
+
+	/** compute RMS value (in this case: square-root of trace of covariance matrix) */
+	T getRMS() const
+	{
+		T trace = 0;
+		for ( std::size_t i = 0; i < N; i++ )
+			trace += covariance( i, i );
+		return sqrt( trace );
+	}
+
+	/**
+	 * (un-)serialization helper function
+	 */
+	template< class Archive >
+	void serialize( Archive& ar, const unsigned int version )
+	{
+		ar & value;
+		ar & covariance;
+	}
+};
+
+
 /// @internal stream output operator
 template< typename T, std::size_t N >
 std::ostream& operator<<( std::ostream& s, const ErrorVector< T, N >& v )
@@ -106,6 +174,15 @@ std::ostream& operator<<( std::ostream& s, const ErrorVector< T, N >& v )
 }
 
 
+/// @internal stream output operator
+template< typename T, std::size_t N, typename C >
+std::ostream& operator<<( std::ostream& s, const PackedErrorVector< T, N, C >& v )
+{
+	s << v.value << std::endl << v.covariance;
+	return s;
+}
+
+
 } } // namespace Ubitrack::Math
 
 #endif //__UBITRACK_MATH_ERRORVECTOR_H_INCLUDED__
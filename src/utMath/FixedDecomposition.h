@@ -0,0 +1,461 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * LAPACK-free decompositions of small fixed-size matrices.
+ *
+ * For the 2x2 to 9x9 problems that most estimators solve (e.g. the 4x4 eigenproblem
+ * of Horn's absolute orientation or the 3x3 orthogonalizations in pose estimation)
+ * the overhead of a LAPACK call, i.e. workspace queries, copies to column-major
+ * storage and the call through the bindings, dominates the actual computation. The
+ * functions here work directly on \c Math::Matrix and \c Math::Vector with sizes
+ * known at compile time, so the loops can be unrolled by the compiler and nothing is
+ * allocated on the heap.
+ *
+ * The results follow the conventions of the corresponding LAPACK routines:
+ * - \c svd as \c gesvd: \c A = U * diag( s ) * Vt with descending singular values,
+ * - \c symmetricEigen as \c syev: ascending eigenvalues, eigenvectors as columns,
+ * - \c cholesky, \c choleskySolve and \c choleskyInvert as \c potrf, \c posv and \c potri,
+ * - \c qrSolve as \c gels for overdetermined systems of full rank.
+ *
+ * The SVD and eigen decompositions use cyclic Jacobi rotations, which are accurate
+ * to machine precision but scale cubically per sweep, so use LAPACK for larger matrices.
+ */
+
+#ifndef __UBITRACK_MATH_FIXEDDECOMPOSITION_H_INCLUDED__
+#define __UBITRACK_MATH_FIXEDDECOMPOSITION_H_INCLUDED__
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <boost/static_assert.hpp>
+
+#include "Vector.h"
+#include "Matrix.h"
+
+namespace Ubitrack { namespace Math {
+
+namespace Detail {
+
+/// @internal maximum number of Jacobi sweeps before giving up
+static const std::size_t maxJacobiSweeps = 60;
+
+/// @internal rotates columns p and q of m by the angle given by c and s
+template< class M >
+inline void rotateColumns( M& m, const std::size_t rows, const std::size_t p, const std::size_t q,
+	const typename M::value_type c, const typename M::value_type s )
+{
+	for ( std::size_t k = 0; k < rows; k++ )
+	{
+		const typename M::value_type mp = m( k, p );
+		const typename M::value_type mq = m( k, q );
+		m( k, p ) = c * mp - s * mq;
+		m( k, q ) = s * mp + c * mq;
+	}
+}
+
+} // namespace Detail
+
+
+/**
+ * Computes all eigenvalues and eigenvectors of a symmetric matrix.
+ *
+ * @param a symmetric matrix, only the upper triangle is read. Overwritten with the
+ *   orthonormal eigenvectors as columns.
+ * @param w the eigenvalues in ascending order
+ * @return false if the iteration did not converge
+ */
+template< typename T, std::size_t N >
+bool symmetricEigen( Math::Matrix< T, N, N >& a, Math::Vector< T, N >& w )
+{
+	BOOST_STATIC_ASSERT( N > 0 );
+
+	Math::Matrix< T, N, N > d;
+	for ( std::size_t i = 0; i < N; i++ )
+		for ( std::size_t j = i; j < N; j++ )
+			d( i, j ) = d( j, i ) = a( i, j );
+	Math::Matrix< T, N, N > v( Math::Matrix< T, N, N >::identity() );
+
+	bool converged = false;
+	for ( std::size_t sweep = 0; sweep < Detail::maxJacobiSweeps && !converged; sweep++ )
+	{
+		converged = true;
+		for ( std::size_t p = 0; p + 1 < N; p++ )
+			for ( std::size_t q = p + 1; q < N; q++ )
+			{
+				const T apq = d( p, q );
+				const T scale = std::fabs( d( p, p ) ) + std::fabs( d( q, q ) );
+				if ( std::fabs( apq ) <= std::numeric_limits< T >::epsilon() * scale
+					|| std::fabs( apq ) < std::numeric_limits< T >::min() )
+				{
+					d( p, q ) = d( q, p ) = 0;
+					continue;
+				}
+				converged = false;
+
+				// rotation angle that annihilates d( p, q )
+				const T theta = ( d( q, q ) - d( p, p ) ) / ( 2 * apq );
+				const T t = ( theta >= 0 ? T( 1 ) : T( -1 ) ) / ( std::fabs( theta ) + std::sqrt( theta * theta + 1 ) );
+				const T c = 1 / std::sqrt( t * t + 1 );
+				const T s = t * c;
+
+				// d = J^T * d * J, keeping d symmetric
+				for ( std::size_t k = 0; k < N; k++ )
+				{
+					if ( k == p || k == q )
+						continue;
+					const T dp = d( k, p );
+					const T dq = d( k, q );
+					d( k, p ) = d( p, k ) = c * dp - s * dq;
+					d( k, q ) = d( q, k ) = s * dp + c * dq;
+				}
+				d( p, p ) -= t * apq;
+				d( q, q ) += t * apq;
+				d( p, q ) = d( q, p ) = 0;
+
+				Detail::rotateColumns( v, N, p, q, c, s );
+			}
+	}
+
+	// sort ascending
+	for ( std::size_t i = 0; i < N; i++ )
+		w( i ) = d( i, i );
+	for ( std::size_t i = 0; i < N; i++ )
+	{
+		std::size_t iMin = i;
+		for ( std::size_t j = i + 1; j < N; j++ )
+			if ( w( j ) < w( iMin ) )
+				iMin = j;
+		std::swap( w( i ), w( iMin ) );
+		for ( std::size_t k = 0; k < N; k++ )
+		{
+			a( k, i ) = v( k, iMin );
+			v( k, iMin ) = v( k, i );
+		}
+	}
+	return converged;
+}
+
+
+/**
+ * Computes the singular value decomposition <tt>a = u * diag( s ) * vt</tt> of a matrix
+ * with at least as many rows as columns, using one-sided Jacobi rotations.
+ *
+ * \c u is completed to an orthonormal basis, also for rank-deficient matrices.
+ *
+ * @param a the matrix to decompose
+ * @param s the singular values in descending order
+ * @param u the left singular vectors as columns
+ * @param vt the transposed right singular vectors
+ * @return false if the iteration did not converge
+ */
+template< typename T, std::size_t M, std::size_t N >
+bool svd( const Math::Matrix< T, M, N >& a, Math::Vector< T, N >& s,
+	Math::Matrix< T, M, M >& u, Math::Matrix< T, N, N >& vt )
+{
+	BOOST_STATIC_ASSERT( M >= N && N > 0 );
+
+	Math::Matrix< T, M, N > w( a );
+	Math::Matrix< T, N, N > v( Math::Matrix< T, N, N >::identity() );
+
+	// orthogonalize the columns of w
+	bool converged = false;
+	for ( std::size_t sweep = 0; sweep < Detail::maxJacobiSweeps && !converged; sweep++ )
+	{
+		converged = true;
+		for ( std::size_t p = 0; p + 1 < N; p++ )
+			for ( std::size_t q = p + 1; q < N; q++ )
+			{
+				T alpha = 0;
+				T beta = 0;
+				T gamma = 0;
+				for ( std::size_t k = 0; k < M; k++ )
+				{
+					alpha += w( k, p ) * w( k, p );
+					beta += w( k, q ) * w( k, q );
+					gamma += w( k, p ) * w( k, q );
+				}
+				if ( std::fabs( gamma ) <= std::numeric_limits< T >::epsilon() * std::sqrt( alpha * beta )
+					|| std::fabs( gamma ) < std::numeric_limits< T >::min() )
+					continue;
+				converged = false;
+
+				const T zeta = ( beta - alpha ) / ( 2 * gamma );
+				const T t = ( zeta >= 0 ? T( 1 ) : T( -1 ) ) / ( std::fabs( zeta ) + std::sqrt( zeta * zeta + 1 ) );
+				const T c = 1 / std::sqrt( t * t + 1 );
+				Detail::rotateColumns( w, M, p, q, c, t * c );
+				Detail::rotateColumns( v, N, p, q, c, t * c );
+			}
+	}
+
+	// singular values are the column norms, sort descending
+	std::size_t order[ N ];
+	for ( std::size_t j = 0; j < N; j++ )
+	{
+		T n2 = 0;
+		for ( std::size_t k = 0; k < M; k++ )
+			n2 += w( k, j ) * w( k, j );
+		s( j ) = std::sqrt( n2 );
+		order[ j ] = j;
+	}
+	for ( std::size_t i = 0; i < N; i++ )
+		for ( std::size_t j = i + 1; j < N; j++ )
+			if ( s( order[ j ] ) > s( order[ i ] ) )
+				std::swap( order[ i ], order[ j ] );
+
+	Math::Vector< T, N > sorted;
+	const T tiny = std::numeric_limits< T >::epsilon() * M * ( s( order[ 0 ] ) > 0 ? s( order[ 0 ] ) : T( 1 ) );
+	std::size_t rank = 0;
+	for ( std::size_t i = 0; i < N; i++ )
+	{
+		const std::size_t j = order[ i ];
+		sorted( i ) = s( j );
+		for ( std::size_t k = 0; k < N; k++ )
+			vt( i, k ) = v( k, j );
+		if ( s( j ) > tiny )
+		{
+			for ( std::size_t k = 0; k < M; k++ )
+				u( k, i ) = w( k, j ) / s( j );
+			rank = i + 1;
+		}
+	}
+	s = sorted;
+
+	// complete u with the unit vectors that are farthest from the span of the existing columns
+	for ( std::size_t i = rank; i < M; i++ )
+	{
+		Math::Vector< T, M > best;
+		T bestNorm2 = -1;
+		for ( std::size_t e = 0; e < M; e++ )
+		{
+			Math::Vector< T, M > c;
+			for ( std::size_t k = 0; k < M; k++ )
+				c( k ) = k == e ? T( 1 ) : T( 0 );
+			for ( int pass = 0; pass < 2; pass++ )
+				for ( std::size_t j = 0; j < i; j++ )
+				{
+					T dot = 0;
+					for ( std::size_t k = 0; k < M; k++ )
+						dot += u( k, j ) * c( k );
+					for ( std::size_t k = 0; k < M; k++ )
+						c( k ) -= dot * u( k, j );
+				}
+			T n2 = 0;
+			for ( std::size_t k = 0; k < M; k++ )
+				n2 += c( k ) * c( k );
+			if ( n2 > bestNorm2 )
+			{
+				best = c;
+				bestNorm2 = n2;
+			}
+		}
+		const T n = std::sqrt( bestNorm2 );
+		for ( std::size_t k = 0; k < M; k++ )
+			u( k, i ) = best( k ) / n;
+	}
+	return converged;
+}
+
+
+/**
+ * Computes the cholesky decomposition <tt>a = l * l^T</tt> of a symmetric positive
+ * definite matrix.
+ *
+ * @param a the matrix, only the lower triangle is read
+ * @param l the lower triangular factor, the strict upper triangle is set to zero. May be \c a.
+ * @return false if \c a is not positive definite
+ */
+template< typename T, std::size_t N >
+bool cholesky( const Math::Matrix< T, N, N >& a, Math::Matrix< T, N, N >& l )
+{
+	for ( std::size_t j = 0; j < N; j++ )
+	{
+		T d = a( j, j );
+		for ( std::size_t k = 0; k < j; k++ )
+			d -= l( j, k ) * l( j, k );
+		if ( !( d > T( 0 ) ) )
+			return false;
+		l( j, j ) = std::sqrt( d );
+
+		for ( std::size_t i = j + 1; i < N; i++ )
+		{
+			T s = a( i, j );
+			for ( std::size_t k = 0; k < j; k++ )
+				s -= l( i, k ) * l( j, k );
+			l( i, j ) = s / l( j, j );
+		}
+	}
+	for ( std::size_t j = 1; j < N; j++ )
+		for ( std::size_t i = 0; i < j; i++ )
+			l( i, j ) = 0;
+	return true;
+}
+
+
+/**
+ * Solves <tt>a * x = b</tt> for a symmetric positive definite matrix \c a.
+ *
+ * @param a the matrix, only the lower triangle is read
+ * @param b the right hand side, overwritten with the solution
+ * @return false if \c a is not positive definite, \c b is unchanged then
+ */
+template< typename T, std::size_t N >
+bool choleskySolve( const Math::Matrix< T, N, N >& a, Math::Vector< T, N >& b )
+{
+	Math::Matrix< T, N, N > l;
+	if ( !cholesky( a, l ) )
+		return false;
+
+	// forward substitution l * y = b
+	for ( std::size_t i = 0; i < N; i++ )
+	{
+		T s = b( i );
+		for ( std::size_t k = 0; k < i; k++ )
+			s -= l( i, k ) * b( k );
+		b( i ) = s / l( i, i );
+	}
+
+	// back substitution l^T * x = y
+	for ( std::size_t i = N; i-- > 0; )
+	{
+		T s = b( i );
+		for ( std::size_t k = i + 1; k < N; k++ )
+			s -= l( k, i ) * b( k );
+		b( i ) = s / l( i, i );
+	}
+	return true;
+}
+
+
+/**
+ * Inverts a symmetric positive definite matrix in place.
+ *
+ * @param a the matrix, only the lower triangle is read. Overwritten with the full inverse.
+ * @return false if \c a is not positive definite, \c a is unchanged then
+ */
+template< typename T, std::size_t N >
+bool choleskyInvert( Math::Matrix< T, N, N >& a )
+{
+	Math::Matrix< T, N, N > l;
+	if ( !cholesky( a, l ) )
+		return false;
+
+	// invert l (lower triangular)
+	Math::Matrix< T, N, N > li( Math::Matrix< T, N, N >::zeros() );
+	for ( std::size_t j = 0; j < N; j++ )
+	{
+		li( j, j ) = T( 1 ) / l( j, j );
+		for ( std::size_t i = j + 1; i < N; i++ )
+		{
+			T s = 0;
+			for ( std::size_t k = j; k < i; k++ )
+				s -= l( i, k ) * li( k, j );
+			li( i, j ) = s / l( i, i );
+		}
+	}
+
+	// a^-1 = l^-T * l^-1
+	for ( std::size_t i = 0; i < N; i++ )
+		for ( std::size_t j = 0; j <= i; j++ )
+		{
+			T s = 0;
+			for ( std::size_t k = i; k < N; k++ )
+				s += li( k, i ) * li( k, j );
+			a( i, j ) = s;
+			a( j, i ) = s;
+		}
+	return true;
+}
+
+
+/**
+ * Solves the linear least squares problem <tt>min | a * x - b |</tt> for a matrix with
+ * at least as many rows as columns using a Householder QR decomposition.
+ *
+ * @param a the matrix
+ * @param b the right hand side
+ * @param x the solution
+ * @return false if \c a does not have full column rank, \c x is undefined then
+ */
+template< typename T, std::size_t M, std::size_t N >
+bool qrSolve( const Math::Matrix< T, M, N >& a, const Math::Vector< T, M >& b, Math::Vector< T, N >& x )
+{
+	BOOST_STATIC_ASSERT( M >= N && N > 0 );
+
+	Math::Matrix< T, M, N > r( a );
+	Math::Vector< T, M > y( b );
+
+	T maxDiag = 0;
+	for ( std::size_t j = 0; j < N; j++ )
+	{
+		// householder vector of column j below the diagonal, stored in place
+		T n2 = 0;
+		for ( std::size_t k = j; k < M; k++ )
+			n2 += r( k, j ) * r( k, j );
+		const T norm = std::sqrt( n2 );
+		if ( !( norm > T( 0 ) ) )
+			return false;
+		const T alpha = r( j, j ) > 0 ? -norm : norm;
+		const T vn2 = 2 * ( n2 - r( j, j ) * alpha );
+		r( j, j ) -= alpha;
+
+		// apply ( I - 2 v v^T / v^T v ) to the remaining columns and to y
+		for ( std::size_t c = j + 1; c < N; c++ )
+		{
+			T dot = 0;
+			for ( std::size_t k = j; k < M; k++ )
+				dot += r( k, j ) * r( k, c );
+			const T f = 2 * dot / vn2;
+			for ( std::size_t k = j; k < M; k++ )
+				r( k, c ) -= f * r( k, j );
+		}
+		T dot = 0;
+		for ( std::size_t k = j; k < M; k++ )
+			dot += r( k, j ) * y( k );
+		const T f = 2 * dot / vn2;
+		for ( std::size_t k = j; k < M; k++ )
+			y( k ) -= f * r( k, j );
+
+		r( j, j ) = alpha;
+		maxDiag = std::max( maxDiag, std::fabs( alpha ) );
+	}
+
+	// back substitution r * x = q^T * b
+	for ( std::size_t i = N; i-- > 0; )
+	{
+		if ( std::fabs( r( i, i ) ) <= std::numeric_limits< T >::epsilon() * M * maxDiag )
+			return false;
+		T s = y( i );
+		for ( std::size_t k = i + 1; k < N; k++ )
+			s -= r( i, k ) * x( k );
+		x( i ) = s / r( i, i );
+	}
+	return true;
+}
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_FIXEDDECOMPOSITION_H_INCLUDED__
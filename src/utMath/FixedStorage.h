@@ -0,0 +1,496 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Fixed-size vectors and matrices on plain array storage.
+ *
+ * \c Math::Vector< T, N > and \c Math::Matrix< T, M, N > keep their elements in a
+ * \c ublas::bounded_array, which stores the current size next to the elements and
+ * checks every access in debug builds. \c FixedVector and \c FixedMatrix use
+ * \c FixedArray instead, which is nothing but a \c T[ N ]:
+ * @code
+ * std::vector< Math::FixedVector< double, 3 > > points; // 24 bytes per point instead of 32
+ * @endcode
+ *
+ * Both types are ublas containers, so all ublas expressions and the functors of
+ * \c Blas1.h, \c Blas2.h and \c Blas3.h work with them, and they convert implicitly
+ * from and to the corresponding \c Math::Vector and \c Math::Matrix.
+ *
+ * @note Copying is a plain element-wise copy of the array. \c FixedMatrix still contains
+ * the two size fields of \c ublas::matrix.
+ * @note Lapack bindings are only provided for \c Math::Vector and \c Math::Matrix.
+ */
+
+#ifndef __UBITRACK_MATH_FIXEDSTORAGE_H_INCLUDED__
+#define __UBITRACK_MATH_FIXEDSTORAGE_H_INCLUDED__
+
+#include <utUtil/StaticAssert.h>
+
+#include "Vector.h"
+#include "Matrix.h"
+#include "Util/vector_traits.h"
+#include "Util/matrix_traits.h"
+
+#include <assert.h>
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <algorithm> // std::fill, std::swap_ranges
+#include <iterator> // std::reverse_iterator
+
+#include <boost/static_assert.hpp>
+#include <boost/serialization/access.hpp>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * @brief ublas storage of exactly \c N elements without size information.
+ *
+ * Implements the ublas storage concept as far as \c ublas::vector and
+ * \c ublas::matrix require it. The size is fixed, \c resize only checks the
+ * requested size in debug builds. Copy construction and assignment are the
+ * implicit ones, so \c FixedArray is trivially copyable if \c T is.
+ *
+ * @tparam T builtin type of elements (e.g \c double or \c float )
+ * @tparam N number of elements
+ */
+template< typename T, std::size_t N >
+class FixedArray
+{
+	public:
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T value_type;
+		typedef const T& const_reference;
+		typedef T& reference;
+		typedef const T* const_pointer;
+		typedef T* pointer;
+		typedef const_pointer const_iterator;
+		typedef pointer iterator;
+		typedef std::reverse_iterator< const_iterator > const_reverse_iterator;
+		typedef std::reverse_iterator< iterator > reverse_iterator;
+
+		/** default constructor, leaves the elements uninitialized as bounded_array does */
+		FixedArray()
+		{}
+
+		/** pro-forma constructor */
+		explicit FixedArray( size_type size )
+		{ assert( size == N ); }
+
+		/** pro-forma constructor, sets all elements to \c init */
+		FixedArray( size_type size, const value_type& init )
+		{
+			assert( size == N );
+			std::fill( begin(), end(), init );
+		}
+
+		/** pro-forma resize */
+		void resize( size_type size )
+		{ assert( size == N ); }
+
+		/** pro-forma resize */
+		void resize( size_type size, value_type )
+		{ assert( size == N ); }
+
+		size_type max_size() const
+		{ return N; }
+
+		bool empty() const
+		{ return N == 0; }
+
+		size_type size() const
+		{ return N; }
+
+		const_reference operator[]( size_type i ) const
+		{ return m_data[ i ]; }
+
+		reference operator[]( size_type i )
+		{ return m_data[ i ]; }
+
+		FixedArray& assign_temporary( FixedArray& a )
+		{ return *this = a; }
+
+		void swap( FixedArray& a )
+		{
+			if ( this != &a )
+				std::swap_ranges( begin(), end(), a.begin() );
+		}
+
+		friend void swap( FixedArray& a1, FixedArray& a2 )
+		{ a1.swap( a2 ); }
+
+		const_iterator begin() const
+		{ return m_data; }
+
+		const_iterator end() const
+		{ return m_data + N; }
+
+		iterator begin()
+		{ return m_data; }
+
+		iterator end()
+		{ return m_data + N; }
+
+		const_reverse_iterator rbegin() const
+		{ return const_reverse_iterator( end() ); }
+
+		const_reverse_iterator rend() const
+		{ return const_reverse_iterator( begin() ); }
+
+		reverse_iterator rbegin()
+		{ return reverse_iterator( end() ); }
+
+		reverse_iterator rend()
+		{ return reverse_iterator( begin() ); }
+
+	protected:
+		/// the elements, aligned as T
+		T m_data[ N ];
+};
+
+
+/**
+ * @ingroup math
+ * @brief A fixed-size \b Vector of exactly \c N elements of type \c T.
+ *
+ * Same interface as \c Math::Vector< T, N > for the commonly used parts, but
+ * <tt>sizeof( FixedVector< T, N > ) == N * sizeof( T )</tt>.
+ *
+ * @tparam T builtin type of Vector elements (e.g \c double or \c float )
+ * @tparam N size of vector
+ */
+template< typename T, std::size_t N >
+class FixedVector
+	: public boost::numeric::ublas::vector< T, FixedArray< T, N > >
+{
+	BOOST_STATIC_ASSERT( N > 0 );
+
+	public:
+		typedef boost::numeric::ublas::vector< T, FixedArray< T, N > > base_type;
+		typedef Math::FixedVector< T, N >	self_type;
+		typedef T							value_type;
+		typedef std::size_t					size_type;
+
+		/** Default constructor, elements are uninitialized */
+		FixedVector()
+			: base_type( N )
+		{}
+
+		/** construct from fixed number of parameters (2) */
+		FixedVector( T p0, T p1 )
+			: base_type( N )
+		{
+			UBITRACK_STATIC_ASSERT( N == 2, VECTOR_2_REQUIRED );
+			(*this)[0] = p0;
+			(*this)[1] = p1;
+		}
+
+		/** construct from fixed number of parameters (3) */
+		FixedVector( T p0, T p1, T p2 )
+			: base_type( N )
+		{
+			UBITRACK_STATIC_ASSERT( N == 3, VECTOR_3_REQUIRED );
+			(*this)[0] = p0;
+			(*this)[1] = p1;
+			(*this)[2] = p2;
+		}
+
+		/** construct from fixed number of parameters (4) */
+		FixedVector( T p0, T p1, T p2, T p3 )
+			: base_type( N )
+		{
+			UBITRACK_STATIC_ASSERT( N == 4, VECTOR_4_REQUIRED );
+			(*this)[0] = p0;
+			(*this)[1] = p1;
+			(*this)[2] = p2;
+			(*this)[3] = p3;
+		}
+
+		/**
+		 * Construct from vector_expression, e.g. a \c Math::Vector
+		 * @param e a vector_expression
+		 */
+		template< class AE >
+		FixedVector( const boost::numeric::ublas::vector_expression< AE >& e )
+			: base_type( e )
+		{ assert( e().size() == N ); }
+
+		/**
+		 * Construct from array.
+		 * Note: This will copy the contents.
+		 * @param pFirst pointer to first element
+		 */
+		FixedVector( const T* pFirst )
+			: base_type( N )
+		{ std::copy( pFirst, pFirst + N, content() ); }
+
+		/** converts to the bounded_array based \c Math::Vector */
+		operator Vector< T, N >() const
+		{ return Vector< T, N >( content() ); }
+
+		/** might facilitate compiler optimizations */
+		size_type size() const
+		{ return N; }
+
+		/** return a pointer to the raw data */
+		T* content()
+		{ return (*this).data().begin(); }
+
+		/** return a pointer to the raw data */
+		const T* content() const
+		{ return (*this).data().begin(); }
+
+		/**
+		 * assign from vector_expression
+		 * @param e a vector_expression
+		 */
+		template< class AE >
+		FixedVector< T, N >& operator=( const boost::numeric::ublas::vector_expression< AE >& e )
+		{
+			assert( e().size() == N );
+			base_type::operator=( e );
+			return *this;
+		}
+
+		/**
+		 * Returns vector of zeros
+		 */
+		static FixedVector< T, N > zeros()
+		{
+			return boost::numeric::ublas::zero_vector< T >( N );
+		}
+
+	protected:
+
+		friend class ::boost::serialization::access;
+
+		/** serialize Vector object, same format as \c Math::Vector */
+		template< class Archive >
+		void serialize( Archive& ar, const unsigned int version )
+		{
+			for( size_type i = 0; i < N; i++ )
+				ar & (*this)[i];
+		}
+};
+
+
+/**
+ * @ingroup math
+ * @brief A fixed-size \b Matrix of \c M x \c N elements on plain array storage.
+ *
+ * Same interface as \c Math::Matrix< T, M, N > for the commonly used parts. The
+ * elements are stored column-major as in \c Math::Matrix.
+ *
+ * @tparam T builtin type of matrix elements (e.g \c double or \c float )
+ * @tparam M number of matrix rows
+ * @tparam N number of matrix columns (defaults to M for a symmetric \b Matrix)
+ */
+template< typename T, std::size_t M, std::size_t N = M >
+class FixedMatrix
+	: public boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, FixedArray< T, M*N > >
+{
+	BOOST_STATIC_ASSERT( M > 0 && N > 0 );
+
+	public:
+		typedef boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, FixedArray< T, M*N > > base_type;
+		typedef Math::FixedMatrix< T, M, N >	self_type;
+		typedef T								value_type;
+		typedef typename base_type::size_type	size_type;
+
+		/** default constructor, elements are uninitialized */
+		FixedMatrix()
+			: base_type( M, N )
+		{ }
+
+		/**
+		 * construct from ublas matrix expression, e.g. a \c Math::Matrix
+		 * @param e a matrix_expression
+		 */
+		template< class ME >
+		FixedMatrix( const boost::numeric::ublas::matrix_expression< ME >& e )
+			: base_type( e )
+		{ assert( e().size1() == M && e().size2() == N ); }
+
+		/**
+		 * construct from array
+		 * @param pFirst an array with M*N elements (row-major)
+		 */
+		FixedMatrix( const T* pFirst )
+			: base_type( M, N )
+		{
+			for( size_type i = 0; i < M; i++ )
+				for( size_type j = 0; j < N; j++ )
+					(*this)(i,j) = pFirst[i*N+j];
+		}
+
+		/** converts to the bounded_array based \c Math::Matrix */
+		operator Matrix< T, M, N >() const
+		{ return Matrix< T, M, N >( static_cast< const base_type& >( *this ) ); }
+
+		/** might facilitate compiler optimizations */
+		size_type size1() const
+		{ return M; }
+
+		/** might facilitate compiler optimizations */
+		size_type size2() const
+		{ return N; }
+
+		/** return a pointer to the raw data */
+		T* content()
+		{ return (*this).data().begin(); }
+
+		/** return a pointer to the raw data */
+		const T* content() const
+		{ return (*this).data().begin(); }
+
+		/**
+		 * assign from ublas matrix_expression
+		 * @param e a matrix_expression
+		 */
+		template< class AE >
+		FixedMatrix< T, M, N >& operator=( const boost::numeric::ublas::matrix_expression< AE >& e )
+		{
+			assert( e().size1() == M && e().size2() == N );
+			base_type::operator=( e );
+			return *this;
+		}
+
+		/**
+		 * @return N*N square identity matrix
+		 */
+		static FixedMatrix< T, M, N > identity()
+		{
+			return boost::numeric::ublas::identity_matrix< T, boost::numeric::ublas::column_major >( M );
+		}
+
+		/**
+		 * @return M*N zero matrix
+		 */
+		static FixedMatrix< T, M, N > zeros()
+		{
+			return boost::numeric::ublas::zero_matrix< T, boost::numeric::ublas::column_major >( M, N );
+		}
+
+	protected:
+
+		friend class ::boost::serialization::access;
+
+		/// serialize this Matrix, same format as \c Math::Matrix
+		template< class Archive >
+		void serialize( Archive& ar, const unsigned int version )
+		{
+			for( size_type i = 0; i < M; i++ )
+				for( size_type j = 0; j < N; j++ )
+					ar & (*this)(i,j);
+		}
+};
+
+
+/** @internal stream output operator for a FixedVector */
+template< typename T, std::size_t N >
+std::ostream& operator<<( std::ostream& s, const FixedVector< T, N >& v )
+{
+	s << "[ ";
+	for( std::size_t i = 0; i < N; ++i )
+		s << v[ i ] << " ";
+	s << "]";
+	return s;
+}
+
+
+/// typedef for 2 dimensional FixedVector of type \c double
+typedef Math::FixedVector< double, 2 > FixedVector2d;
+/// typedef for 3 dimensional FixedVector of type \c double
+typedef Math::FixedVector< double, 3 > FixedVector3d;
+/// typedef for 4 dimensional FixedVector of type \c double
+typedef Math::FixedVector< double, 4 > FixedVector4d;
+/// typedef for 3x3 FixedMatrix of type \c double
+typedef Math::FixedMatrix< double, 3, 3 > FixedMatrix3x3d;
+/// typedef for 4x4 FixedMatrix of type \c double
+typedef Math::FixedMatrix< double, 4, 4 > FixedMatrix4x4d;
+
+
+namespace Util {
+
+/** @internal FixedVectors have fixed storage */
+template< typename T, std::size_t N >
+struct has_fixed_storage< Math::FixedVector< T, N > >
+	: public Ubitrack::Util::true_type{};
+
+/** @internal FixedVectors have no dynamic storage */
+template< typename T, std::size_t N >
+struct has_dynamic_storage< Math::FixedVector< T, N > >
+	: public Ubitrack::Util::false_type{};
+
+/** @internal specialization for FixedVectors */
+template< typename T, std::size_t N >
+struct vector_traits< Math::FixedVector< T, N > >
+{
+	typedef typename Math::FixedVector< T, N > self_type;
+	typedef fixed_storage_tag storage_category;
+	typedef fixed_vector_storage_tag storage_type;
+	typedef typename std::size_t size_type;
+	typedef T value_type;
+
+	static const size_type size = N;
+};
+
+/** @internal FixedMatrices have fixed storage */
+template< typename T, std::size_t M, std::size_t N >
+struct has_fixed_storage< Math::FixedMatrix< T, M, N > >
+	: public Ubitrack::Util::true_type{};
+
+/** @internal FixedMatrices have no dynamic storage */
+template< typename T, std::size_t M, std::size_t N >
+struct has_dynamic_storage< Math::FixedMatrix< T, M, N > >
+	: public Ubitrack::Util::false_type{};
+
+/** @internal specialization for FixedMatrices */
+template< typename T, std::size_t M, std::size_t N >
+struct matrix_traits< Math::FixedMatrix< T, M, N > >
+{
+	typedef typename Math::FixedMatrix< T, M, N > self_type;
+	typedef fixed_storage_tag storage_category;
+	typedef fixed_matrix_storage_tag storage_type;
+	typedef typename std::size_t size_type;
+	typedef T value_type;
+
+	static const size_type size1 = M;
+	static const size_type size2 = N;
+
+	static T* ptr( const self_type& rhs )
+	{
+		return const_cast< T* > ( rhs.data().begin() );
+	}
+};
+
+} // namespace Util
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_FIXEDSTORAGE_H_INCLUDED__
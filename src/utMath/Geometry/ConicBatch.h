@@ -0,0 +1,468 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math geometry
+ * @file
+ * Batch kernels for conics and for the projection of quadrics
+ *
+ * Like the kernels in PointBatch.h, the conics and quadrics are passed as
+ * structure of arrays, which allows to process several of them at once with
+ * the SIMD instructions of \c Util::simd_pack. All buffers use a planar
+ * layout: coefficient \c k of element \c i of a batch of \c n elements is
+ * stored at index <tt>k * n + i</tt>. The coefficients are ordered as in
+ * the functors of Conic.h and QuadricFunctors.h, and \c vectors_to_planar
+ * and \c planar_to_vectors convert from and to containers of \c Math::Vector.
+ */
+
+#ifndef __H__CONIC_BATCH_FUNCTIONS__
+#define __H__CONIC_BATCH_FUNCTIONS__
+
+#include <cmath>
+#include <vector>
+
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include "../Util/simd_traits.h"
+
+#ifndef M_PI
+#define _USE_MATH_DEFINES //for having PI
+#include <math.h>
+#endif
+
+namespace Ubitrack { namespace Math { namespace Geometry {
+
+namespace Detail {
+
+/// @internal inverts a conic [a b c d e f] held in packs, same formula as \c ConicInverse
+template< class Pack >
+inline void packConicInverse( const typename Pack::type (&in)[ 6 ], typename Pack::type (&out)[ 6 ] )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type two = Pack::set1( 2 );
+	const pack_type four = Pack::set1( 4 );
+	const pack_type a = in[ 0 ], b = in[ 1 ], c = in[ 2 ], d = in[ 3 ], e = in[ 4 ], f = in[ 5 ];
+
+	// a*e*e + c*d*d + b*b*f - a*c*f*4 - b*d*e
+	const pack_type det = Pack::sub( Pack::sub( Pack::add( Pack::add( Pack::mul( a, Pack::mul( e, e ) ), Pack::mul( c, Pack::mul( d, d ) ) )
+		, Pack::mul( Pack::mul( b, b ), f ) ), Pack::mul( Pack::mul( Pack::mul( a, c ), f ), four ) ), Pack::mul( Pack::mul( b, d ), e ) );
+	const pack_type divisor = Pack::div( Pack::set1( 1 ), det );
+
+	out[ 0 ] = Pack::mul( Pack::sub( Pack::mul( e, e ), Pack::mul( Pack::mul( c, f ), four ) ), divisor );
+	out[ 1 ] = Pack::mul( Pack::mul( two, Pack::sub( Pack::mul( Pack::mul( b, f ), two ), Pack::mul( d, e ) ) ), divisor );
+	out[ 2 ] = Pack::mul( Pack::sub( Pack::mul( d, d ), Pack::mul( Pack::mul( a, f ), four ) ), divisor );
+	out[ 3 ] = Pack::mul( Pack::mul( two, Pack::sub( Pack::mul( Pack::mul( c, d ), two ), Pack::mul( b, e ) ) ), divisor );
+	out[ 4 ] = Pack::mul( Pack::mul( two, Pack::sub( Pack::mul( Pack::mul( a, e ), two ), Pack::mul( b, d ) ) ), divisor );
+	out[ 5 ] = Pack::mul( Pack::sub( Pack::mul( b, b ), Pack::mul( Pack::mul( a, c ), four ) ), divisor );
+}
+
+/// @internal loads the element at index \c i of each coefficient array into packs
+template< class Pack, typename T, std::size_t N >
+inline void packLoad( const T* const (&in)[ N ], const std::size_t i, typename Pack::type (&out)[ N ] )
+{
+	for ( std::size_t k = 0; k < N; k++ )
+		out[ k ] = Pack::load( in[ k ] + i );
+}
+
+/// @internal stores packs to the element at index \c i of each coefficient array
+template< class Pack, typename T, std::size_t N >
+inline void packStore( const typename Pack::type (&in)[ N ], const std::size_t i, T* const (&out)[ N ] )
+{
+	for ( std::size_t k = 0; k < N; k++ )
+		Pack::store( out[ k ] + i, in[ k ] );
+}
+
+/**
+ * @internal conic inversion kernel, starts at index \c i and stops before the last incomplete pack
+ * @return index of the first conic that was not processed
+ */
+template< class Pack, typename T >
+std::size_t batchConicInverse( std::size_t i, const std::size_t n, const T* const (&in)[ 6 ], T* const (&out)[ 6 ] )
+{
+	typedef typename Pack::type pack_type;
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		pack_type conic[ 6 ], inverse[ 6 ];
+		packLoad< Pack >( in, i, conic );
+		packConicInverse< Pack >( conic, inverse );
+		packStore< Pack >( inverse, i, out );
+	}
+	return i;
+}
+
+/// @internal determinant kernel, same formula as \c ConicDeterminant, see above
+template< class Pack, typename T >
+std::size_t batchConicDeterminant( std::size_t i, const std::size_t n, const T* const (&in)[ 6 ], T* determinants )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type quarter = Pack::set1( T( 0.25 ) );
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		pack_type conic[ 6 ];
+		packLoad< Pack >( in, i, conic );
+		const pack_type a = conic[ 0 ], b = conic[ 1 ], c = conic[ 2 ], d = conic[ 3 ], e = conic[ 4 ], f = conic[ 5 ];
+
+		// a*c*f + (-b*b*f + b*e*d - c*d*d - a*e*e) * 0.25
+		const pack_type sum = Pack::sub( Pack::sub( Pack::sub( Pack::mul( Pack::mul( b, e ), d ), Pack::mul( Pack::mul( b, b ), f ) )
+			, Pack::mul( Pack::mul( c, d ), d ) ), Pack::mul( Pack::mul( a, e ), e ) );
+		Pack::store( determinants + i, Pack::add( Pack::mul( Pack::mul( a, c ), f ), Pack::mul( sum, quarter ) ) );
+	}
+	return i;
+}
+
+/**
+ * @internal semi-axes kernel, see above
+ *
+ * Instead of rotating the conic by the angle of \c ConicAngle, the coefficients of the rotated
+ * conic are the eigenvalues of the quadratic part, the smaller one belonging to the major axis,
+ * which needs no trigonometric functions.
+ */
+template< class Pack, typename T >
+std::size_t batchConicSemiAxes( std::size_t i, const std::size_t n, const T* const (&in)[ 6 ], T* const (&out)[ 2 ] )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type half = Pack::set1( T( 0.5 ) );
+	const pack_type four = Pack::set1( 4 );
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		pack_type conic[ 6 ];
+		packLoad< Pack >( in, i, conic );
+		const pack_type a = conic[ 0 ], b = conic[ 1 ], c = conic[ 2 ], d = conic[ 3 ], e = conic[ 4 ], f = conic[ 5 ];
+
+		// eigenvalues of [ a b/2; b/2 c ]
+		const pack_type h = Pack::mul( b, half );
+		const pack_type m = Pack::mul( Pack::add( a, c ), half );
+		const pack_type s = Pack::mul( Pack::sub( a, c ), half );
+		const pack_type r = Pack::sqrt( Pack::add( Pack::mul( s, s ), Pack::mul( h, h ) ) );
+		const pack_type a1 = Pack::sub( m, r );
+		const pack_type c1 = Pack::add( m, r );
+
+		// ( c1*d1*d1 + a1*e1*e1 - 4*a1*c1*f ) / ( 4*a1*c1 ) with the rotated d1, e1
+		const pack_type det4 = Pack::mul( four, Pack::sub( Pack::mul( a, c ), Pack::mul( h, h ) ) );
+		const pack_type upper = Pack::sub( Pack::sub( Pack::add( Pack::mul( Pack::mul( a, e ), e ), Pack::mul( Pack::mul( c, d ), d ) )
+			, Pack::mul( Pack::mul( b, d ), e ) ), Pack::mul( det4, f ) );
+		const pack_type num = Pack::div( upper, det4 );
+
+		Pack::store( out[ 0 ] + i, Pack::sqrt( Pack::div( num, a1 ) ) );
+		Pack::store( out[ 1 ] + i, Pack::sqrt( Pack::div( num, c1 ) ) );
+	}
+	return i;
+}
+
+/// @internal row \c j of the 3x4 projection applied to the symmetric 4x4 matrix of a quadric
+template< class Pack >
+inline void packQuadricRow( const typename Pack::type (&q)[ 10 ], const typename Pack::type (&p)[ 4 ], typename Pack::type (&out)[ 4 ] )
+{
+	// the matrix is [ a f g p; f b h q; g h c r; p q r d ] as in ProjectQuadric
+	const typename Pack::type row[ 4 ][ 4 ] = { { q[ 0 ], q[ 3 ], q[ 4 ], q[ 6 ] }, { q[ 3 ], q[ 1 ], q[ 5 ], q[ 7 ] }
+		, { q[ 4 ], q[ 5 ], q[ 2 ], q[ 8 ] }, { q[ 6 ], q[ 7 ], q[ 8 ], q[ 9 ] } };
+	for ( std::size_t k = 0; k < 4; k++ )
+		out[ k ] = Pack::add( Pack::add( Pack::add( Pack::mul( p[ 0 ], row[ k ][ 0 ] ), Pack::mul( p[ 1 ], row[ k ][ 1 ] ) )
+			, Pack::mul( p[ 2 ], row[ k ][ 2 ] ) ), Pack::mul( p[ 3 ], row[ k ][ 3 ] ) );
+}
+
+/// @internal dot product of two 4-vectors held in packs
+template< class Pack >
+inline typename Pack::type packDot4( const typename Pack::type (&x)[ 4 ], const typename Pack::type (&y)[ 4 ] )
+{
+	return Pack::add( Pack::add( Pack::add( Pack::mul( x[ 0 ], y[ 0 ] ), Pack::mul( x[ 1 ], y[ 1 ] ) )
+		, Pack::mul( x[ 2 ], y[ 2 ] ) ), Pack::mul( x[ 3 ], y[ 3 ] ) );
+}
+
+/// @internal quadric projection kernel, see above
+template< class Pack, typename T >
+std::size_t batchProjectQuadric( const Math::Matrix< T, 3, 4 >& projection, std::size_t i, const std::size_t n
+	, const T* const (&in)[ 10 ], T* const (&out)[ 6 ] )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type two = Pack::set1( 2 );
+	pack_type p[ 3 ][ 4 ];
+	for ( std::size_t r = 0; r < 3; r++ )
+		for ( std::size_t k = 0; k < 4; k++ )
+			p[ r ][ k ] = Pack::set1( projection( r, k ) );
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		pack_type quadric[ 10 ];
+		packLoad< Pack >( in, i, quadric );
+
+		// line conic P * Q * P^T
+		pack_type qp[ 3 ][ 4 ];
+		for ( std::size_t r = 0; r < 3; r++ )
+			packQuadricRow< Pack >( quadric, p[ r ], qp[ r ] );
+		const pack_type lineConic[ 6 ] = { packDot4< Pack >( p[ 0 ], qp[ 0 ] ), Pack::mul( two, packDot4< Pack >( p[ 0 ], qp[ 1 ] ) )
+			, packDot4< Pack >( p[ 1 ], qp[ 1 ] ), Pack::mul( two, packDot4< Pack >( p[ 0 ], qp[ 2 ] ) )
+			, Pack::mul( two, packDot4< Pack >( p[ 1 ], qp[ 2 ] ) ), packDot4< Pack >( p[ 2 ], qp[ 2 ] ) };
+
+		pack_type pointConic[ 6 ];
+		packConicInverse< Pack >( lineConic, pointConic );
+		packStore< Pack >( pointConic, i, out );
+	}
+	return i;
+}
+
+/// @internal ellipsoid projection kernel, see above
+template< class Pack, typename T >
+std::size_t batchProjectEllipsoid( const Math::Matrix< T, 3, 4 >& projection, std::size_t i, const std::size_t n
+	, const T* const (&in)[ 6 ], T* const (&out)[ 6 ] )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type two = Pack::set1( 2 );
+	pack_type p[ 3 ][ 4 ];
+	for ( std::size_t r = 0; r < 3; r++ )
+		for ( std::size_t k = 0; k < 4; k++ )
+			p[ r ][ k ] = Pack::set1( projection( r, k ) );
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		pack_type ellipsoid[ 6 ];
+		packLoad< Pack >( in, i, ellipsoid );
+		const pack_type axes[ 3 ] = { Pack::mul( ellipsoid[ 0 ], ellipsoid[ 0 ] ), Pack::mul( ellipsoid[ 1 ], ellipsoid[ 1 ] )
+			, Pack::mul( ellipsoid[ 2 ], ellipsoid[ 2 ] ) };
+
+		// projected center of each row and the rows scaled by the squared semi-axes
+		pack_type center[ 3 ], scaled[ 3 ][ 3 ];
+		for ( std::size_t r = 0; r < 3; r++ )
+		{
+			center[ r ] = Pack::add( Pack::add( Pack::add( Pack::mul( p[ r ][ 0 ], ellipsoid[ 3 ] ), Pack::mul( p[ r ][ 1 ], ellipsoid[ 4 ] ) )
+				, Pack::mul( p[ r ][ 2 ], ellipsoid[ 5 ] ) ), p[ r ][ 3 ] );
+			for ( std::size_t k = 0; k < 3; k++ )
+				scaled[ r ][ k ] = Pack::mul( p[ r ][ k ], axes[ k ] );
+		}
+
+		// line conic entry ( r, s ) = P_r diag( a^2, b^2, c^2 ) P_s^T - center_r * center_s
+		pack_type entry[ 3 ][ 3 ];
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t s = r; s < 3; s++ )
+				entry[ r ][ s ] = Pack::sub( Pack::add( Pack::add( Pack::mul( scaled[ r ][ 0 ], p[ s ][ 0 ] ), Pack::mul( scaled[ r ][ 1 ], p[ s ][ 1 ] ) )
+					, Pack::mul( scaled[ r ][ 2 ], p[ s ][ 2 ] ) ), Pack::mul( center[ r ], center[ s ] ) );
+		const pack_type lineConic[ 6 ] = { entry[ 0 ][ 0 ], Pack::mul( two, entry[ 0 ][ 1 ] ), entry[ 1 ][ 1 ]
+			, Pack::mul( two, entry[ 0 ][ 2 ] ), Pack::mul( two, entry[ 1 ][ 2 ] ), entry[ 2 ][ 2 ] };
+
+		pack_type pointConic[ 6 ];
+		packConicInverse< Pack >( lineConic, pointConic );
+		packStore< Pack >( pointConic, i, out );
+	}
+	return i;
+}
+
+/// @internal pointers to the \c N coefficient arrays of a planar buffer of \c n elements
+template< typename T, std::size_t N >
+inline void planarPointers( T* data, const std::size_t n, T* (&pointers)[ N ] )
+{
+	for ( std::size_t k = 0; k < N; k++ )
+		pointers[ k ] = data + k * n;
+}
+
+} // namespace Detail
+
+
+/**
+ * @ingroup math geometry
+ * @brief Copies \c N-vectors (e.g. conics or quadrics) into a planar buffer.
+ *
+ * @param vectors the vectors
+ * @param planar receives the coefficients, coefficient \c k of vector \c i at index <tt>k * n + i</tt>
+ */
+template< typename T, std::size_t N >
+void vectors_to_planar( const std::vector< Math::Vector< T, N > >& vectors, std::vector< T >& planar )
+{
+	const std::size_t n = vectors.size();
+	planar.resize( N * n );
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t k = 0; k < N; k++ )
+			planar[ k * n + i ] = vectors[ i ]( k );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Copies a planar buffer of \c N-vectors back into vectors, the inverse of \c vectors_to_planar.
+ */
+template< typename T, std::size_t N >
+void planar_to_vectors( const std::vector< T >& planar, std::vector< Math::Vector< T, N > >& vectors )
+{
+	const std::size_t n = planar.size() / N;
+	vectors.resize( n );
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t k = 0; k < N; k++ )
+			vectors[ i ]( k ) = planar[ k * n + i ];
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Inverts \c n conics, like \c ConicInverse.
+ *
+ * @param n number of conics
+ * @param conics planar buffer of \c 6n coefficients
+ * @param inverse planar buffer receiving the \c 6n coefficients of the dual conics, may be identical to \c conics
+ */
+template< typename T >
+void invert_conics_batch( const std::size_t n, const T* conics, T* inverse )
+{
+	const T* in[ 6 ];
+	T* out[ 6 ];
+	Detail::planarPointers( conics, n, in );
+	Detail::planarPointers( inverse, n, out );
+
+	const std::size_t i = Detail::batchConicInverse< Util::simd_pack< T > >( 0, n, in, out );
+	Detail::batchConicInverse< Util::simd_scalar< T > >( i, n, in, out );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Computes the determinants of \c n conics, like \c ConicDeterminant.
+ *
+ * @param n number of conics
+ * @param conics planar buffer of \c 6n coefficients
+ * @param determinants array receiving the \c n determinants
+ */
+template< typename T >
+void conic_determinants_batch( const std::size_t n, const T* conics, T* determinants )
+{
+	const T* in[ 6 ];
+	Detail::planarPointers( conics, n, in );
+
+	const std::size_t i = Detail::batchConicDeterminant< Util::simd_pack< T > >( 0, n, in, determinants );
+	Detail::batchConicDeterminant< Util::simd_scalar< T > >( i, n, in, determinants );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Computes the lengths of the semi-axes of \c n ellipses, like \c ConicSemiAxes.
+ *
+ * The first length belongs to the axis in the direction of \c ConicAngle.
+ *
+ * @param n number of conics
+ * @param conics planar buffer of \c 6n coefficients
+ * @param semiAxes planar buffer receiving the \c 2n lengths
+ */
+template< typename T >
+void conic_semi_axes_batch( const std::size_t n, const T* conics, T* semiAxes )
+{
+	const T* in[ 6 ];
+	T* out[ 2 ];
+	Detail::planarPointers( conics, n, in );
+	Detail::planarPointers( semiAxes, n, out );
+
+	const std::size_t i = Detail::batchConicSemiAxes< Util::simd_pack< T > >( 0, n, in, out );
+	Detail::batchConicSemiAxes< Util::simd_scalar< T > >( i, n, in, out );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Computes the angles of the major semi-axes of \c n conics, like \c ConicAngle.
+ *
+ * There is no arc tangent among the SIMD operations, so this is a plain loop over the planar buffer.
+ *
+ * @param n number of conics
+ * @param conics planar buffer of \c 6n coefficients
+ * @param angles array receiving the \c n angles
+ */
+template< typename T >
+void conic_angles_batch( const std::size_t n, const T* conics, T* angles )
+{
+	const T* a = conics;
+	const T* b = conics + n;
+	const T* c = conics + 2 * n;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const T angle = std::atan( b[ i ] / ( a[ i ] - c[ i ] ) ) * static_cast< T >( 0.5 );
+		angles[ i ] = a[ i ] <= c[ i ] ? angle : static_cast< T >( M_PI * 0.5 ) + angle;
+	}
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Projects \c n quadrics with a \b 3-by-4 \b projection \b matrix to point conics, like \c ProjectQuadric.
+ *
+ * @param projection the projection matrix
+ * @param n number of quadrics
+ * @param quadrics planar buffer of \c 10n coefficients
+ * @param conics planar buffer receiving the \c 6n coefficients of the conics
+ */
+template< typename T >
+void project_quadrics_batch( const Math::Matrix< T, 3, 4 >& projection, const std::size_t n, const T* quadrics, T* conics )
+{
+	const T* in[ 10 ];
+	T* out[ 6 ];
+	Detail::planarPointers( quadrics, n, in );
+	Detail::planarPointers( conics, n, out );
+
+	const std::size_t i = Detail::batchProjectQuadric< Util::simd_pack< T > >( projection, 0, n, in, out );
+	Detail::batchProjectQuadric< Util::simd_scalar< T > >( projection, i, n, in, out );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Projects \c n axis-aligned ellipsoids with a \b 3-by-4 \b projection \b matrix, like \c ProjectEllipsoid.
+ *
+ * @param projection the projection matrix
+ * @param n number of ellipsoids
+ * @param ellipsoids planar buffer of \c 6n parameters, the three semi-axes followed by the position
+ * @param conics planar buffer receiving the \c 6n coefficients of the conics, may be identical to \c ellipsoids
+ */
+template< typename T >
+void project_ellipsoids_batch( const Math::Matrix< T, 3, 4 >& projection, const std::size_t n, const T* ellipsoids, T* conics )
+{
+	const T* in[ 6 ];
+	T* out[ 6 ];
+	Detail::planarPointers( ellipsoids, n, in );
+	Detail::planarPointers( conics, n, out );
+
+	const std::size_t i = Detail::batchProjectEllipsoid< Util::simd_pack< T > >( projection, 0, n, in, out );
+	Detail::batchProjectEllipsoid< Util::simd_scalar< T > >( projection, i, n, in, out );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Projects \c n spheroids with a \b 3-by-4 \b projection \b matrix, like \c ProjectSpheroid.
+ *
+ * @param projection the projection matrix
+ * @param n number of spheroids
+ * @param spheroids planar buffer of \c 4n parameters as in \c ProjectSpheroid
+ * @param conics planar buffer receiving the \c 6n coefficients of the conics
+ */
+template< typename T >
+void project_spheroids_batch( const Math::Matrix< T, 3, 4 >& projection, const std::size_t n, const T* spheroids, T* conics )
+{
+	// the ellipsoid with the semi-axes ( s0, s0, s1 ) at ( s2, s3, s1 )
+	const T* const in[ 6 ] = { spheroids, spheroids, spheroids + n, spheroids + 2 * n, spheroids + 3 * n, spheroids + n };
+	T* out[ 6 ];
+	Detail::planarPointers( conics, n, out );
+
+	const std::size_t i = Detail::batchProjectEllipsoid< Util::simd_pack< T > >( projection, 0, n, in, out );
+	Detail::batchProjectEllipsoid< Util::simd_scalar< T > >( projection, i, n, in, out );
+}
+
+
+} } } // namespace Ubitrack::Math::Geometry
+
+#endif //__H__CONIC_BATCH_FUNCTIONS__
@@ -0,0 +1,214 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math geometry
+ * @file
+ * Direct least-squares fit of an ellipse to 2D points.
+ */
+
+#ifndef __UBITRACK_MATH_GEOMETRY_ELLIPSE_FIT_H_INCLUDED__
+#define __UBITRACK_MATH_GEOMETRY_ELLIPSE_FIT_H_INCLUDED__
+
+#include <cmath>
+#include <iterator>
+
+// Ubitrack
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/FixedDecomposition.h>
+#include "ConicCovariance.h"
+
+
+namespace Ubitrack { namespace Math { namespace Geometry {
+
+
+/**
+ * Fits an ellipse to 2D points by direct least squares.
+ *
+ * Minimizes the algebraic distance of the points to the conic under the constraint
+ * @f$4ac - b^2 = 1@f$, which always yields an ellipse, as proposed by Fitzgibbon et al.
+ * ( @cite fitzgibbon1999direct ). The scatter matrix is split into its quadratic and
+ * linear parts as by Halir and Flusser ( @cite halir1998numerically ), which leaves a
+ * 3x3 generalized eigenproblem that is solved with the fixed-size decompositions, so no
+ * LAPACK call and no heap allocation is involved. The points are centered and scaled
+ * before the fit for numerical stability, and the points are traversed twice.
+ *
+ * @verbatim
+@article{fitzgibbon1999direct,
+  title={Direct least square fitting of ellipses},
+  author={Fitzgibbon, Andrew and Pilu, Maurizio and Fisher, Robert B.},
+  journal={IEEE Transactions on Pattern Analysis and Machine Intelligence},
+  volume={21},
+  number={5},
+  pages={476--480},
+  year={1999}
+}
+@inproceedings{halir1998numerically,
+  title={Numerically stable direct least squares fitting of ellipses},
+  author={Halir, Radim and Flusser, Jan},
+  booktitle={Proc. 6th International Conference in Central Europe on Computer Graphics and Visualization},
+  pages={125--132},
+  year={1998}
+} @endverbatim
+ *
+ * @tparam InputIterator type of iterator to container of 2d points
+ * @tparam T numeric type of the conic ( e.g. \c double or \c float )
+ * @param iBegin iterator to the first point on the outline of the ellipse
+ * @param iEnd iterator behind the last point
+ * @param conic receives the ellipse as a 6-vector as in Conic.h, normalized to unit length
+ * @return false if there are less than five points or the points do not determine an ellipse
+ */
+template< typename InputIterator, typename T >
+bool fitEllipse( const InputIterator iBegin, const InputIterator iEnd, Math::Vector< T, 6 >& conic )
+{
+	const std::size_t n = std::distance( iBegin, iEnd );
+	if ( n < 5 )
+		return false;
+
+	// centroid and scale to a mean distance of sqrt( 2 )
+	double mx = 0;
+	double my = 0;
+	for ( InputIterator it( iBegin ); it != iEnd; ++it )
+	{
+		mx += (*it)[ 0 ];
+		my += (*it)[ 1 ];
+	}
+	mx /= n;
+	my /= n;
+	double meanDistance = 0;
+	for ( InputIterator it( iBegin ); it != iEnd; ++it )
+	{
+		const double dx = (*it)[ 0 ] - mx;
+		const double dy = (*it)[ 1 ] - my;
+		meanDistance += std::sqrt( dx * dx + dy * dy );
+	}
+	if ( !( meanDistance > 0 ) )
+		return false;
+	const double s = std::sqrt( 2.0 ) * n / meanDistance;
+
+	// scatter matrices of the quadratic part [ x^2 xy y^2 ] and the linear part [ x y 1 ]
+	Math::Matrix< double, 3, 3 > s1( Math::Matrix< double, 3, 3 >::zeros() );
+	Math::Matrix< double, 3, 3 > s2( Math::Matrix< double, 3, 3 >::zeros() );
+	Math::Matrix< double, 3, 3 > s3( Math::Matrix< double, 3, 3 >::zeros() );
+	for ( InputIterator it( iBegin ); it != iEnd; ++it )
+	{
+		const double x = s * ( (*it)[ 0 ] - mx );
+		const double y = s * ( (*it)[ 1 ] - my );
+		const double d1[ 3 ] = { x * x, x * y, y * y };
+		const double d2[ 3 ] = { x, y, 1 };
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t c = 0; c < 3; c++ )
+			{
+				s1( r, c ) += d1[ r ] * d1[ c ];
+				s2( r, c ) += d1[ r ] * d2[ c ];
+				s3( r, c ) += d2[ r ] * d2[ c ];
+			}
+	}
+
+	// the linear part follows from the quadratic one: a2 = t * a1 with t = -s3^-1 * s2^T
+	if ( !Math::choleskyInvert( s3 ) )
+		return false;
+	const Math::Matrix< double, 3, 3 > t( -boost::numeric::ublas::prod( s3, boost::numeric::ublas::trans( s2 ) ) );
+
+	// reduced scatter matrix, slightly regularized as it is singular for exact points
+	Math::Matrix< double, 3, 3 > m( s1 + boost::numeric::ublas::prod( s2, t ) );
+	const double regularization = 1e-12 * ( m( 0, 0 ) + m( 1, 1 ) + m( 2, 2 ) );
+	for ( std::size_t k = 0; k < 3; k++ )
+		m( k, k ) += regularization;
+	Math::Matrix< double, 3, 3 > l;
+	if ( !Math::cholesky( m, l ) )
+		return false;
+
+	// m * a1 = lambda * c1 * a1 with the constraint matrix c1, transformed to the symmetric
+	// eigenproblem of inv( l ) * c1 * inv( l )^T, the ellipse has its only positive eigenvalue
+	Math::Matrix< double, 3, 3 > li( Math::Matrix< double, 3, 3 >::zeros() );
+	for ( std::size_t c = 0; c < 3; c++ )
+	{
+		li( c, c ) = 1 / l( c, c );
+		for ( std::size_t r = c + 1; r < 3; r++ )
+		{
+			double sum = 0;
+			for ( std::size_t k = c; k < r; k++ )
+				sum += l( r, k ) * li( k, c );
+			li( r, c ) = -sum / l( r, r );
+		}
+	}
+	Math::Matrix< double, 3, 3 > c1( Math::Matrix< double, 3, 3 >::zeros() );
+	c1( 0, 2 ) = c1( 2, 0 ) = 2;
+	c1( 1, 1 ) = -1;
+	Math::Matrix< double, 3, 3 > e( boost::numeric::ublas::prod( li, Math::Matrix< double, 3, 3 >( boost::numeric::ublas::prod( c1, boost::numeric::ublas::trans( li ) ) ) ) );
+	Math::Vector< double, 3 > w;
+	if ( !Math::symmetricEigen( e, w ) || !( w( 2 ) > 0 ) )
+		return false;
+
+	const Math::Vector< double, 3 > a1( boost::numeric::ublas::prod( boost::numeric::ublas::trans( li ), boost::numeric::ublas::column( e, 2 ) ) );
+	const Math::Vector< double, 3 > a2( boost::numeric::ublas::prod( t, a1 ) );
+
+	// back to the original coordinates, x' = s * ( x - mx )
+	const double a = a1( 0 ) * s * s;
+	const double b = a1( 1 ) * s * s;
+	const double c = a1( 2 ) * s * s;
+	const double d = a2( 0 ) * s;
+	const double f = a2( 1 ) * s;
+	Math::Vector< double, 6 > result;
+	result( 0 ) = a;
+	result( 1 ) = b;
+	result( 2 ) = c;
+	result( 3 ) = d - 2 * a * mx - b * my;
+	result( 4 ) = f - 2 * c * my - b * mx;
+	result( 5 ) = a * mx * mx + b * mx * my + c * my * my - d * mx - f * my + a2( 2 );
+
+	double norm = boost::numeric::ublas::norm_2( result );
+	if ( result( 0 ) + result( 2 ) < 0 )
+		norm = -norm;
+	for ( std::size_t k = 0; k < 6; k++ )
+		conic( k ) = static_cast< T >( result( k ) / norm );
+	return true;
+}
+
+
+/**
+ * Fits an ellipse to 2D points by direct least squares and estimates the covariance
+ * of its parameters with \c estimateCovariance.
+ *
+ * @param iBegin iterator to the first point on the outline of the ellipse
+ * @param iEnd iterator behind the last point
+ * @param conic receives the ellipse as a 6-vector as in Conic.h, normalized to unit length
+ * @param covariance receives the covariance of the conic parameters
+ * @return false if no ellipse could be fitted
+ */
+template< typename InputIterator, typename T >
+bool fitEllipse( const InputIterator iBegin, const InputIterator iEnd, Math::Vector< T, 6 >& conic
+	, Math::Matrix< typename std::iterator_traits< InputIterator >::value_type::value_type, 6, 6 >& covariance )
+{
+	if ( !fitEllipse( iBegin, iEnd, conic ) )
+		return false;
+	return estimateCovariance( iBegin, iEnd, conic, covariance );
+}
+
+
+}}} // namespace Ubitrack::Math::Geometry
+
+
+#endif //__UBITRACK_MATH_GEOMETRY_ELLIPSE_FIT_H_INCLUDED__
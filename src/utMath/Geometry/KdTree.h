@@ -0,0 +1,432 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math geometry
+ * @file
+ * k-d tree for nearest neighbour queries on points
+ */
+
+#ifndef __H__KD_TREE__
+#define __H__KD_TREE__
+
+#include <vector>
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <utMath/Vector.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
+
+namespace Ubitrack { namespace Math { namespace Geometry {
+
+/**
+ * @ingroup math geometry
+ * A k-d tree over a fixed set of points, e.g. the model points of an ICP registration.
+ *
+ * The tree splits the points at the median of the coordinate with the largest extent until at
+ * most \c leafSize points remain, so it is balanced and built in O(n log n). The points are
+ * copied in tree order, such that the points of a leaf lie next to each other in memory.
+ * Queries only read the tree and may run in several threads at once, the batched queries over
+ * lists of points can be distributed over threads by a \c Math::ListExecutor.
+ *
+ * @code
+ * Geometry::KdTree< double, 3 > tree( modelPoints );
+ * double distanceSq;
+ * const std::size_t i = tree.nearest( query, 0.01, &distanceSq );
+ * if ( i != tree.invalid )
+ *     ...
+ * @endcode
+ */
+template< typename T, std::size_t N >
+class KdTree
+{
+public:
+	typedef Math::Vector< T, N > point_type;
+
+	/** index returned if no point lies within the search radius */
+	static const std::size_t invalid = std::size_t( -1 );
+
+	/** an empty tree */
+	KdTree()
+	{}
+
+	/** builds the tree over the given points */
+	explicit KdTree( const std::vector< point_type >& points, const std::size_t leafSize = 8 )
+	{ build( points, leafSize ); }
+
+	/** replaces the points of the tree */
+	void build( const std::vector< point_type >& points, std::size_t leafSize = 8 );
+
+	/** number of points */
+	std::size_t size() const
+	{ return m_points.size(); }
+
+	/**
+	 * finds the nearest point
+	 * @param query the query point
+	 * @param maxDistanceSq only points with a squared distance below this are returned
+	 * @param pDistanceSq receives the squared distance of the nearest point if not null
+	 * @return index of the nearest point in the vector given to \c build, or \c invalid
+	 */
+	std::size_t nearest( const point_type& query, T maxDistanceSq = std::numeric_limits< T >::max(), T* pDistanceSq = 0 ) const;
+
+	/**
+	 * finds the \c k nearest points
+	 * @param query the query point
+	 * @param k maximum number of points
+	 * @param result receives the squared distances and indices of the points, sorted by distance
+	 * @param maxDistanceSq only points with a squared distance below this are returned
+	 */
+	void kNearest( const point_type& query, std::size_t k, std::vector< std::pair< T, std::size_t > >& result,
+		T maxDistanceSq = std::numeric_limits< T >::max() ) const;
+
+	/**
+	 * finds all points within a radius
+	 * @param query the query point
+	 * @param radiusSq points with a squared distance below this are returned
+	 * @param result receives the squared distances and indices of the points, in no particular order
+	 */
+	void radiusSearch( const point_type& query, T radiusSq, std::vector< std::pair< T, std::size_t > >& result ) const;
+
+	/**
+	 * finds the nearest point of every query, like \c nearest
+	 * @param queries the query points
+	 * @param indices receives the index of the nearest point of every query, or \c invalid
+	 * @param distancesSq receives the squared distances of the nearest points, or \c maxDistanceSq
+	 * @param maxDistanceSq only points with a squared distance below this are returned
+	 * @param executor distributes the queries over threads, see \c Math::threadExecutor
+	 */
+	void nearest( const std::vector< point_type >& queries, std::vector< std::size_t >& indices, std::vector< T >& distancesSq,
+		T maxDistanceSq = std::numeric_limits< T >::max(), const ListExecutor& executor = ListExecutor() ) const;
+
+	/** finds the \c k nearest points of every query, like \c kNearest */
+	void kNearest( const std::vector< point_type >& queries, std::size_t k, std::vector< std::vector< std::pair< T, std::size_t > > >& results,
+		T maxDistanceSq = std::numeric_limits< T >::max(), const ListExecutor& executor = ListExecutor() ) const;
+
+	/** finds the points within a radius of every query, like \c radiusSearch */
+	void radiusSearch( const std::vector< point_type >& queries, T radiusSq, std::vector< std::vector< std::pair< T, std::size_t > > >& results,
+		const ListExecutor& executor = ListExecutor() ) const;
+
+protected:
+	/** a node covers the points [ begin, end ), inner nodes split them at \c split in dimension \c dim */
+	struct Node
+	{
+		std::size_t begin;
+		std::size_t end;
+		std::size_t dim;
+		T split;
+		std::size_t left;
+		std::size_t right;
+	};
+
+	/** builds the subtree of the points [ begin, end ) and returns its node */
+	std::size_t buildNode( const std::vector< point_type >& points, std::size_t begin, std::size_t end, std::size_t leafSize );
+
+	/** squared distance of a query to the point at tree position \c i */
+	T distanceSq( const point_type& query, const std::size_t i ) const
+	{
+		T d( 0 );
+		for ( std::size_t k = 0; k < N; k++ )
+		{
+			const T diff = query( k ) - m_points[ i ]( k );
+			d += diff * diff;
+		}
+		return d;
+	}
+
+	void searchNearest( std::size_t node, const point_type& query, T& bestSq, std::size_t& best ) const;
+
+	void searchKNearest( std::size_t node, const point_type& query, std::size_t k,
+		std::vector< std::pair< T, std::size_t > >& result, T& boundSq ) const;
+
+	void searchRadius( std::size_t node, const point_type& query, T radiusSq, std::vector< std::pair< T, std::size_t > >& result ) const;
+
+	/** the batched queries of [ begin, end ) */
+	void nearestRange( std::size_t begin, std::size_t end, const std::vector< point_type >& queries, T maxDistanceSq,
+		std::vector< std::size_t >& indices, std::vector< T >& distancesSq ) const
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+		{
+			distancesSq[ i ] = maxDistanceSq;
+			indices[ i ] = nearest( queries[ i ], maxDistanceSq, &distancesSq[ i ] );
+		}
+	}
+
+	void kNearestRange( std::size_t begin, std::size_t end, const std::vector< point_type >& queries, std::size_t k, T maxDistanceSq,
+		std::vector< std::vector< std::pair< T, std::size_t > > >& results ) const
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+			kNearest( queries[ i ], k, results[ i ], maxDistanceSq );
+	}
+
+	void radiusRange( std::size_t begin, std::size_t end, const std::vector< point_type >& queries, T radiusSq,
+		std::vector< std::vector< std::pair< T, std::size_t > > >& results ) const
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+			radiusSearch( queries[ i ], radiusSq, results[ i ] );
+	}
+
+	/** the nodes, the root is the first */
+	std::vector< Node > m_nodes;
+
+	/** the points in tree order and their indices in the original vector */
+	std::vector< point_type > m_points;
+	std::vector< std::size_t > m_indices;
+};
+
+template< typename T, std::size_t N >
+const std::size_t KdTree< T, N >::invalid;
+
+/// @internal orders point indices by one coordinate
+template< typename T, std::size_t N >
+struct KdTreeCoordinateLess
+{
+	KdTreeCoordinateLess( const std::vector< Math::Vector< T, N > >& points, const std::size_t dim )
+		: m_points( points )
+		, m_dim( dim )
+	{}
+
+	bool operator()( const std::size_t a, const std::size_t b ) const
+	{ return m_points[ a ]( m_dim ) < m_points[ b ]( m_dim ); }
+
+	const std::vector< Math::Vector< T, N > >& m_points;
+	std::size_t m_dim;
+};
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::build( const std::vector< point_type >& points, const std::size_t leafSize )
+{
+	m_nodes.clear();
+	m_indices.resize( points.size() );
+	for ( std::size_t i = 0; i < points.size(); i++ )
+		m_indices[ i ] = i;
+
+	if ( !points.empty() )
+		buildNode( points, 0, points.size(), std::max< std::size_t >( leafSize, 1 ) );
+
+	m_points.resize( points.size() );
+	for ( std::size_t i = 0; i < points.size(); i++ )
+		m_points[ i ] = points[ m_indices[ i ] ];
+}
+
+template< typename T, std::size_t N >
+std::size_t KdTree< T, N >::buildNode( const std::vector< point_type >& points, const std::size_t begin, const std::size_t end,
+	const std::size_t leafSize )
+{
+	const std::size_t node = m_nodes.size();
+	m_nodes.push_back( Node() );
+	m_nodes[ node ].begin = begin;
+	m_nodes[ node ].end = end;
+	m_nodes[ node ].left = invalid;
+	m_nodes[ node ].right = invalid;
+	if ( end - begin <= leafSize )
+		return node;
+
+	// split the dimension of largest extent at the median
+	T lower[ N ], upper[ N ];
+	for ( std::size_t k = 0; k < N; k++ )
+		lower[ k ] = upper[ k ] = points[ m_indices[ begin ] ]( k );
+	for ( std::size_t i = begin + 1; i < end; i++ )
+		for ( std::size_t k = 0; k < N; k++ )
+		{
+			lower[ k ] = std::min( lower[ k ], points[ m_indices[ i ] ]( k ) );
+			upper[ k ] = std::max( upper[ k ], points[ m_indices[ i ] ]( k ) );
+		}
+	std::size_t dim = 0;
+	for ( std::size_t k = 1; k < N; k++ )
+		if ( upper[ k ] - lower[ k ] > upper[ dim ] - lower[ dim ] )
+			dim = k;
+
+	const std::size_t mid = begin + ( end - begin ) / 2;
+	std::nth_element( m_indices.begin() + begin, m_indices.begin() + mid, m_indices.begin() + end,
+		KdTreeCoordinateLess< T, N >( points, dim ) );
+
+	// points left of mid are not larger, points right of mid not smaller than the split
+	m_nodes[ node ].dim = dim;
+	m_nodes[ node ].split = points[ m_indices[ mid ] ]( dim );
+	const std::size_t left = buildNode( points, begin, mid, leafSize );
+	const std::size_t right = buildNode( points, mid, end, leafSize );
+	m_nodes[ node ].left = left;
+	m_nodes[ node ].right = right;
+	return node;
+}
+
+template< typename T, std::size_t N >
+std::size_t KdTree< T, N >::nearest( const point_type& query, const T maxDistanceSq, T* pDistanceSq ) const
+{
+	T bestSq = maxDistanceSq;
+	std::size_t best = invalid;
+	if ( !m_nodes.empty() )
+		searchNearest( 0, query, bestSq, best );
+
+	if ( best == invalid )
+		return invalid;
+	if ( pDistanceSq )
+		*pDistanceSq = bestSq;
+	return m_indices[ best ];
+}
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::searchNearest( const std::size_t node, const point_type& query, T& bestSq, std::size_t& best ) const
+{
+	const Node& n( m_nodes[ node ] );
+	if ( n.left == invalid )
+	{
+		for ( std::size_t i = n.begin; i < n.end; i++ )
+		{
+			const T d = distanceSq( query, i );
+			if ( d < bestSq )
+			{
+				bestSq = d;
+				best = i;
+			}
+		}
+		return;
+	}
+
+	const T diff = query( n.dim ) - n.split;
+	searchNearest( diff < 0 ? n.left : n.right, query, bestSq, best );
+	if ( diff * diff < bestSq )
+		searchNearest( diff < 0 ? n.right : n.left, query, bestSq, best );
+}
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::kNearest( const point_type& query, const std::size_t k, std::vector< std::pair< T, std::size_t > >& result,
+	const T maxDistanceSq ) const
+{
+	result.clear();
+	if ( m_nodes.empty() || k == 0 )
+		return;
+
+	T boundSq = maxDistanceSq;
+	searchKNearest( 0, query, k, result, boundSq );
+	for ( std::size_t i = 0; i < result.size(); i++ )
+		result[ i ].second = m_indices[ result[ i ].second ];
+}
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::searchKNearest( const std::size_t node, const point_type& query, const std::size_t k,
+	std::vector< std::pair< T, std::size_t > >& result, T& boundSq ) const
+{
+	const Node& n( m_nodes[ node ] );
+	if ( n.left == invalid )
+	{
+		for ( std::size_t i = n.begin; i < n.end; i++ )
+		{
+			const T d = distanceSq( query, i );
+			if ( !( d < boundSq ) )
+				continue;
+
+			// insertion into the sorted result, which is short
+			if ( result.size() == k )
+				result.pop_back();
+			result.insert( std::upper_bound( result.begin(), result.end(), std::make_pair( d, i ) ), std::make_pair( d, i ) );
+			if ( result.size() == k )
+				boundSq = result.back().first;
+		}
+		return;
+	}
+
+	const T diff = query( n.dim ) - n.split;
+	searchKNearest( diff < 0 ? n.left : n.right, query, k, result, boundSq );
+	if ( diff * diff < boundSq )
+		searchKNearest( diff < 0 ? n.right : n.left, query, k, result, boundSq );
+}
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::radiusSearch( const point_type& query, const T radiusSq, std::vector< std::pair< T, std::size_t > >& result ) const
+{
+	result.clear();
+	if ( m_nodes.empty() )
+		return;
+
+	searchRadius( 0, query, radiusSq, result );
+	for ( std::size_t i = 0; i < result.size(); i++ )
+		result[ i ].second = m_indices[ result[ i ].second ];
+}
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::searchRadius( const std::size_t node, const point_type& query, const T radiusSq,
+	std::vector< std::pair< T, std::size_t > >& result ) const
+{
+	const Node& n( m_nodes[ node ] );
+	if ( n.left == invalid )
+	{
+		for ( std::size_t i = n.begin; i < n.end; i++ )
+		{
+			const T d = distanceSq( query, i );
+			if ( d < radiusSq )
+				result.push_back( std::make_pair( d, i ) );
+		}
+		return;
+	}
+
+	const T diff = query( n.dim ) - n.split;
+	searchRadius( diff < 0 ? n.left : n.right, query, radiusSq, result );
+	if ( diff * diff < radiusSq )
+		searchRadius( diff < 0 ? n.right : n.left, query, radiusSq, result );
+}
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::nearest( const std::vector< point_type >& queries, std::vector< std::size_t >& indices, std::vector< T >& distancesSq,
+	const T maxDistanceSq, const ListExecutor& executor ) const
+{
+	indices.resize( queries.size() );
+	distancesSq.resize( queries.size() );
+	if ( executor.empty() )
+		nearestRange( 0, queries.size(), queries, maxDistanceSq, indices, distancesSq );
+	else
+		executor( queries.size(), boost::bind( &KdTree< T, N >::nearestRange, this, _1, _2,
+			boost::cref( queries ), maxDistanceSq, boost::ref( indices ), boost::ref( distancesSq ) ) );
+}
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::kNearest( const std::vector< point_type >& queries, const std::size_t k,
+	std::vector< std::vector< std::pair< T, std::size_t > > >& results, const T maxDistanceSq, const ListExecutor& executor ) const
+{
+	results.resize( queries.size() );
+	if ( executor.empty() )
+		kNearestRange( 0, queries.size(), queries, k, maxDistanceSq, results );
+	else
+		executor( queries.size(), boost::bind( &KdTree< T, N >::kNearestRange, this, _1, _2,
+			boost::cref( queries ), k, maxDistanceSq, boost::ref( results ) ) );
+}
+
+template< typename T, std::size_t N >
+void KdTree< T, N >::radiusSearch( const std::vector< point_type >& queries, const T radiusSq,
+	std::vector< std::vector< std::pair< T, std::size_t > > >& results, const ListExecutor& executor ) const
+{
+	results.resize( queries.size() );
+	if ( executor.empty() )
+		radiusRange( 0, queries.size(), queries, radiusSq, results );
+	else
+		executor( queries.size(), boost::bind( &KdTree< T, N >::radiusRange, this, _1, _2,
+			boost::cref( queries ), radiusSq, boost::ref( results ) ) );
+}
+
+} } } // namespace Ubitrack::Math::Geometry
+
+#endif // __H__KD_TREE__
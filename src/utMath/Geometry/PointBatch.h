@@ -0,0 +1,281 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math geometry
+ * @file
+ * Batch kernels for projection and transformation of many points
+ *
+ * The points are passed as structure of arrays (one array per coordinate),
+ * which allows to process several points at once with the SIMD instructions
+ * of \c Util::simd_pack. Points stored as \c Math::Vector should use the
+ * iterator based \c project_points and \c transform_points instead, converting
+ * them to arrays first costs more than the kernels save. Points kept in a
+ * \c Math::PointCloud already have this layout and can be passed directly.
+ */
+
+#ifndef __H__POINT_BATCH_FUNCTIONS__
+#define __H__POINT_BATCH_FUNCTIONS__
+
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/PointCloud.h>
+#include "../Util/simd_traits.h"
+
+namespace Ubitrack { namespace Math { namespace Geometry {
+
+namespace Detail {
+
+/// @internal one row of a matrix applied to the homogeneous point [x y z 1]
+template< class Pack >
+inline typename Pack::type batchRow( const typename Pack::type (&c)[ 4 ]
+	, const typename Pack::type x, const typename Pack::type y, const typename Pack::type z )
+{
+	// same order of operations as in the single point functors
+	return Pack::add( Pack::add( Pack::add( Pack::mul( c[ 0 ], x ), Pack::mul( c[ 1 ], y ) ), Pack::mul( c[ 2 ], z ) ), c[ 3 ] );
+}
+
+/// @internal one row of a matrix applied to the homogeneous point [x y 1]
+template< class Pack >
+inline typename Pack::type batchRow( const typename Pack::type (&c)[ 3 ]
+	, const typename Pack::type x, const typename Pack::type y )
+{
+	return Pack::add( Pack::add( Pack::mul( c[ 0 ], x ), Pack::mul( c[ 1 ], y ) ), c[ 2 ] );
+}
+
+/// @internal broadcasts the first \c R rows of a matrix into packs
+template< class Pack, typename T, std::size_t M, std::size_t N, std::size_t R >
+void batchCoefficients( const Math::Matrix< T, M, N >& mat, typename Pack::type (&c)[ R ][ N ] )
+{
+	for ( std::size_t r = 0; r < R; r++ )
+		for ( std::size_t k = 0; k < N; k++ )
+			c[ r ][ k ] = Pack::set1( mat( r, k ) );
+}
+
+/**
+ * @internal projection kernel for 3D points, starts at index \c i and stops before the last incomplete pack
+ * @return index of the first point that was not processed
+ */
+template< class Pack, typename T >
+std::size_t batchProject( const Math::Matrix< T, 3, 4 >& mat, std::size_t i, const std::size_t n
+	, const T* x, const T* y, const T* z, T* u, T* v )
+{
+	typedef typename Pack::type pack_type;
+	pack_type c[ 3 ][ 4 ];
+	batchCoefficients< Pack >( mat, c );
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type px = Pack::load( x + i );
+		const pack_type py = Pack::load( y + i );
+		const pack_type pz = Pack::load( z + i );
+		const pack_type e1 = batchRow< Pack >( c[ 0 ], px, py, pz );
+		const pack_type e2 = batchRow< Pack >( c[ 1 ], px, py, pz );
+		const pack_type e3 = batchRow< Pack >( c[ 2 ], px, py, pz );
+		Pack::store( u + i, Pack::div( e1, e3 ) );
+		Pack::store( v + i, Pack::div( e2, e3 ) );
+	}
+	return i;
+}
+
+/// @internal projection kernel for 2D points, see above
+template< class Pack, typename T >
+std::size_t batchProject( const Math::Matrix< T, 3, 3 >& mat, std::size_t i, const std::size_t n
+	, const T* x, const T* y, T* u, T* v )
+{
+	typedef typename Pack::type pack_type;
+	pack_type c[ 3 ][ 3 ];
+	batchCoefficients< Pack >( mat, c );
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type px = Pack::load( x + i );
+		const pack_type py = Pack::load( y + i );
+		const pack_type e1 = batchRow< Pack >( c[ 0 ], px, py );
+		const pack_type e2 = batchRow< Pack >( c[ 1 ], px, py );
+		const pack_type e3 = batchRow< Pack >( c[ 2 ], px, py );
+		Pack::store( u + i, Pack::div( e1, e3 ) );
+		Pack::store( v + i, Pack::div( e2, e3 ) );
+	}
+	return i;
+}
+
+/// @internal 3-by-4 transformation kernel for 3D points, see above
+template< class Pack, typename T >
+std::size_t batchTransform( const Math::Matrix< T, 3, 4 >& mat, std::size_t i, const std::size_t n
+	, const T* x, const T* y, const T* z, T* xOut, T* yOut, T* zOut )
+{
+	typedef typename Pack::type pack_type;
+	pack_type c[ 3 ][ 4 ];
+	batchCoefficients< Pack >( mat, c );
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type px = Pack::load( x + i );
+		const pack_type py = Pack::load( y + i );
+		const pack_type pz = Pack::load( z + i );
+		Pack::store( xOut + i, batchRow< Pack >( c[ 0 ], px, py, pz ) );
+		Pack::store( yOut + i, batchRow< Pack >( c[ 1 ], px, py, pz ) );
+		Pack::store( zOut + i, batchRow< Pack >( c[ 2 ], px, py, pz ) );
+	}
+	return i;
+}
+
+/// @internal 4-by-4 transformation kernel for 3D points, see above
+template< class Pack, typename T >
+std::size_t batchTransform( const Math::Matrix< T, 4, 4 >& mat, std::size_t i, const std::size_t n
+	, const T* x, const T* y, const T* z, T* xOut, T* yOut, T* zOut, T* wOut )
+{
+	typedef typename Pack::type pack_type;
+	pack_type c[ 4 ][ 4 ];
+	batchCoefficients< Pack >( mat, c );
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type px = Pack::load( x + i );
+		const pack_type py = Pack::load( y + i );
+		const pack_type pz = Pack::load( z + i );
+		Pack::store( xOut + i, batchRow< Pack >( c[ 0 ], px, py, pz ) );
+		Pack::store( yOut + i, batchRow< Pack >( c[ 1 ], px, py, pz ) );
+		Pack::store( zOut + i, batchRow< Pack >( c[ 2 ], px, py, pz ) );
+		Pack::store( wOut + i, batchRow< Pack >( c[ 3 ], px, py, pz ) );
+	}
+	return i;
+}
+
+} // namespace Detail
+
+
+/**
+ * @ingroup math geometry
+ * @brief Projects \c n 3D points given as separate coordinate arrays with a \b 3-by-4 \b projection \b matrix.
+ *
+ * Computes @f$ [u_i v_i]^T = [\hat{p}_{1} \hat{p}_{2}]^T / \hat{p}_{3} @f$ with
+ * @f$ \hat{p} = P_{3x4} \cdot [x_i y_i z_i 1]^T @f$. The output arrays may be identical to input arrays.
+ *
+ * @param projection the projection matrix
+ * @param n number of points
+ * @param x,y,z arrays of the point coordinates
+ * @param u,v arrays receiving the projected coordinates
+ */
+template< typename T >
+void project_points_batch( const Math::Matrix< T, 3, 4 >& projection, const std::size_t n
+	, const T* x, const T* y, const T* z, T* u, T* v )
+{
+	const std::size_t i = Detail::batchProject< Util::simd_pack< T > >( projection, 0, n, x, y, z, u, v );
+	Detail::batchProject< Util::simd_scalar< T > >( projection, i, n, x, y, z, u, v );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Projects \c n 2D points given as separate coordinate arrays with a \b 3-by-3 matrix (e.g. a homography).
+ *
+ * Computes @f$ [u_i v_i]^T = [\hat{p}_{1} \hat{p}_{2}]^T / \hat{p}_{3} @f$ with
+ * @f$ \hat{p} = H_{3x3} \cdot [x_i y_i 1]^T @f$. The output arrays may be identical to input arrays.
+ */
+template< typename T >
+void project_points_batch( const Math::Matrix< T, 3, 3 >& projection, const std::size_t n
+	, const T* x, const T* y, T* u, T* v )
+{
+	const std::size_t i = Detail::batchProject< Util::simd_pack< T > >( projection, 0, n, x, y, u, v );
+	Detail::batchProject< Util::simd_scalar< T > >( projection, i, n, x, y, u, v );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Transforms \c n 3D points given as separate coordinate arrays with a \b 3-by-4 matrix.
+ *
+ * Computes @f$ [x'_i y'_i z'_i]^T = M_{3x4} \cdot [x_i y_i z_i 1]^T @f$. The output arrays may be identical to input arrays.
+ */
+template< typename T >
+void transform_points_batch( const Math::Matrix< T, 3, 4 >& transformation, const std::size_t n
+	, const T* x, const T* y, const T* z, T* xOut, T* yOut, T* zOut )
+{
+	const std::size_t i = Detail::batchTransform< Util::simd_pack< T > >( transformation, 0, n, x, y, z, xOut, yOut, zOut );
+	Detail::batchTransform< Util::simd_scalar< T > >( transformation, i, n, x, y, z, xOut, yOut, zOut );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Transforms \c n 3D points given as separate coordinate arrays with a \b 4-by-4 matrix.
+ *
+ * Computes @f$ [x'_i y'_i z'_i w'_i]^T = M_{4x4} \cdot [x_i y_i z_i 1]^T @f$. The output arrays may be identical to input arrays.
+ */
+template< typename T >
+void transform_points_batch( const Math::Matrix< T, 4, 4 >& transformation, const std::size_t n
+	, const T* x, const T* y, const T* z, T* xOut, T* yOut, T* zOut, T* wOut )
+{
+	const std::size_t i = Detail::batchTransform< Util::simd_pack< T > >( transformation, 0, n, x, y, z, xOut, yOut, zOut, wOut );
+	Detail::batchTransform< Util::simd_scalar< T > >( transformation, i, n, x, y, z, xOut, yOut, zOut, wOut );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Projects a cloud of 3D points with a \b 3-by-4 \b projection \b matrix.
+ *
+ * Same as the iterator based \c project_points, but uses the batch kernel on the coordinate arrays.
+ * @c out is resized to the size of @c in.
+ */
+template< typename T >
+void project_points( const Math::Matrix< T, 3, 4 >& projection, const Math::PointCloud< T, 3 >& in, Math::PointCloud< T, 2 >& out )
+{
+	out.resize( in.size() );
+	project_points_batch( projection, in.size(), in.data( 0 ), in.data( 1 ), in.data( 2 ), out.data( 0 ), out.data( 1 ) );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Projects a cloud of 2D points with a \b 3-by-3 matrix (e.g. a homography).
+ *
+ * @c out is resized to the size of @c in and may be the same cloud.
+ */
+template< typename T >
+void project_points( const Math::Matrix< T, 3, 3 >& projection, const Math::PointCloud< T, 2 >& in, Math::PointCloud< T, 2 >& out )
+{
+	out.resize( in.size() );
+	project_points_batch( projection, in.size(), in.data( 0 ), in.data( 1 ), out.data( 0 ), out.data( 1 ) );
+}
+
+
+/**
+ * @ingroup math geometry
+ * @brief Transforms a cloud of 3D points with a \b 3-by-4 matrix.
+ *
+ * @c out is resized to the size of @c in and may be the same cloud.
+ */
+template< typename T >
+void transform_points( const Math::Matrix< T, 3, 4 >& transformation, const Math::PointCloud< T, 3 >& in, Math::PointCloud< T, 3 >& out )
+{
+	out.resize( in.size() );
+	transform_points_batch( transformation, in.size(), in.data( 0 ), in.data( 1 ), in.data( 2 ), out.data( 0 ), out.data( 1 ), out.data( 2 ) );
+}
+
+
+} } } // namespace Ubitrack::Math::Geometry
+
+#endif //__H__POINT_BATCH_FUNCTIONS__
@@ -40,9 +40,14 @@
 #ifndef __POINT_NORMALIZATION_H__
 #define __POINT_NORMALIZATION_H__
 
+// std
+#include <cmath>
+#include <algorithm>
+
 // Ubitrack
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
+#include "../Util/simd_traits.h"
 
 namespace Ubitrack { namespace Math { namespace Geometry {
 
@@ -65,22 +70,38 @@ template< std::size_t N, typename T, typename ForwardIterator >
 void estimateNormalizationParameters( const ForwardIterator iBegin, const ForwardIterator iEnd
 	, Math::Vector< T, N >& shift, Math::Vector< T, N >& scale )
 {
-	const std::size_t n_pts = std::distance( iBegin, iEnd );
-	// compute mean and mean of square
 	shift = Math::Vector< T, N >::zeros();
 	scale = Math::Vector< T, N >::zeros();
-	
-	for ( ForwardIterator it( iBegin ); it < iEnd; ++it )
+	if ( iBegin == iEnd )
+		return;
+
+	// single pass over the points, the sums are taken relative to the first point, which
+	// avoids the cancellation of the mean of squares for points far from the origin
+	double origin[ N ];
+	double sum[ N ];
+	double sumSq[ N ];
+	for ( std::size_t i = 0; i < N; i++ )
 	{
-		shift = shift + *it;
-		scale = scale + boost::numeric::ublas::element_prod( *it, *it );
+		origin[ i ] = (*iBegin)( i );
+		sum[ i ] = sumSq[ i ] = 0;
 	}
-	shift *= static_cast< T >( 1 ) / n_pts;
-	scale *= static_cast< T >( 1 ) / n_pts;
-	
-	// compute standard deviation
+
+	std::size_t n_pts = 0;
+	for ( ForwardIterator it( iBegin ); it != iEnd; ++it, ++n_pts )
+		for ( std::size_t i = 0; i < N; i++ )
+		{
+			const double d = (*it)( i ) - origin[ i ];
+			sum[ i ] += d;
+			sumSq[ i ] += d * d;
+		}
+
+	// compute mean and standard deviation
 	for ( std::size_t i = 0; i < N; i++ )
-		scale( i ) = std::sqrt( scale( i ) - ( shift( i ) * shift( i ) ) );
+	{
+		const double mean = sum[ i ] / n_pts;
+		shift( i ) = static_cast< T >( origin[ i ] + mean );
+		scale( i ) = static_cast< T >( std::sqrt( std::max( sumSq[ i ] / n_pts - mean * mean, 0.0 ) ) );
+	}
 }
 
 /**
@@ -122,6 +143,181 @@ inline Math::Matrix< T, N+1, N+1 > generateNormalizationMatrix( const Math::Vect
 	return modMatrix;
 };
 
+
+namespace Detail {
+
+/// @internal number of points whose sums are accumulated in packs before they are added to the double totals
+static const std::size_t normalizationBlockSize = 1024;
+
+/**
+ * @internal accumulates the sums and the sums of squares of the coordinates relative to \c origin,
+ * starts at index \c i and stops before the last incomplete pack
+ * @return index of the first point that was not processed
+ */
+template< class Pack, typename T, std::size_t N >
+std::size_t batchMoments( std::size_t i, const std::size_t n, const T* const (&coords)[ N ], const T (&origin)[ N ]
+	, double (&sum)[ N ], double (&sumSq)[ N ] )
+{
+	typedef typename Pack::type pack_type;
+	pack_type o[ N ];
+	for ( std::size_t k = 0; k < N; k++ )
+		o[ k ] = Pack::set1( origin[ k ] );
+
+	while ( i + Pack::size <= n )
+	{
+		// partial sums in packs bound the rounding error of float sums
+		pack_type s[ N ], q[ N ];
+		for ( std::size_t k = 0; k < N; k++ )
+			s[ k ] = q[ k ] = Pack::set1( 0 );
+
+		const std::size_t blockEnd = std::min( n, i + normalizationBlockSize );
+		for ( ; i + Pack::size <= blockEnd; i += Pack::size )
+			for ( std::size_t k = 0; k < N; k++ )
+			{
+				const pack_type d = Pack::sub( Pack::load( coords[ k ] + i ), o[ k ] );
+				s[ k ] = Pack::add( s[ k ], d );
+				q[ k ] = Pack::add( q[ k ], Pack::mul( d, d ) );
+			}
+
+		T lanes[ 2 ][ Pack::size ];
+		for ( std::size_t k = 0; k < N; k++ )
+		{
+			Pack::store( lanes[ 0 ], s[ k ] );
+			Pack::store( lanes[ 1 ], q[ k ] );
+			for ( std::size_t l = 0; l < Pack::size; l++ )
+			{
+				sum[ k ] += lanes[ 0 ][ l ];
+				sumSq[ k ] += lanes[ 1 ][ l ];
+			}
+		}
+	}
+	return i;
+}
+
+/// @internal normalization kernel, see above
+template< class Pack, typename T, std::size_t N >
+std::size_t batchNormalize( std::size_t i, const std::size_t n, const Math::Vector< T, N >& shift, const Math::Vector< T, N >& scale
+	, const T* const (&coords)[ N ], T* const (&out)[ N ] )
+{
+	typedef typename Pack::type pack_type;
+	pack_type s[ N ], f[ N ];
+	for ( std::size_t k = 0; k < N; k++ )
+	{
+		s[ k ] = Pack::set1( shift( k ) );
+		f[ k ] = Pack::set1( static_cast< T >( 1 ) / scale( k ) );
+	}
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+		for ( std::size_t k = 0; k < N; k++ )
+			Pack::store( out[ k ] + i, Pack::mul( Pack::sub( Pack::load( coords[ k ] + i ), s[ k ] ), f[ k ] ) );
+	return i;
+}
+
+/// @internal normalization parameters of points given as \c N coordinate arrays
+template< typename T, std::size_t N >
+void estimateNormalizationBatch( const std::size_t n, const T* const (&coords)[ N ], Math::Vector< T, N >& shift, Math::Vector< T, N >& scale )
+{
+	shift = Math::Vector< T, N >::zeros();
+	scale = Math::Vector< T, N >::zeros();
+	if ( n == 0 )
+		return;
+
+	T origin[ N ];
+	double sum[ N ];
+	double sumSq[ N ];
+	for ( std::size_t k = 0; k < N; k++ )
+	{
+		origin[ k ] = coords[ k ][ 0 ];
+		sum[ k ] = sumSq[ k ] = 0;
+	}
+
+	const std::size_t i = batchMoments< Util::simd_pack< T > >( 0, n, coords, origin, sum, sumSq );
+	batchMoments< Util::simd_scalar< T > >( i, n, coords, origin, sum, sumSq );
+
+	for ( std::size_t k = 0; k < N; k++ )
+	{
+		const double mean = sum[ k ] / n;
+		shift( k ) = static_cast< T >( origin[ k ] + mean );
+		scale( k ) = static_cast< T >( std::sqrt( std::max( sumSq[ k ] / n - mean * mean, 0.0 ) ) );
+	}
+}
+
+/// @internal normalizes points given as \c N coordinate arrays
+template< typename T, std::size_t N >
+void normalizeBatch( const std::size_t n, const Math::Vector< T, N >& shift, const Math::Vector< T, N >& scale
+	, const T* const (&coords)[ N ], T* const (&out)[ N ] )
+{
+	const std::size_t i = batchNormalize< Util::simd_pack< T > >( 0, n, shift, scale, coords, out );
+	batchNormalize< Util::simd_scalar< T > >( i, n, shift, scale, coords, out );
+}
+
+} // namespace Detail
+
+
+/**
+ * Computes the normalization parameters of \c n 2D points given as separate coordinate arrays.
+ *
+ * Same result as \c estimateNormalizationParameters in a single pass, which processes several
+ * points at once with the SIMD instructions of \c Util::simd_pack.
+ *
+ * @tparam T type of point ( e.g. \c double or \c float )
+ * @param n number of points
+ * @param x,y arrays of the point coordinates
+ * @param shift returns the mean value of the points
+ * @param scale returns the non-isotropic extension of the points around the mean
+ */
+template< typename T >
+void estimate_normalization_batch( const std::size_t n, const T* x, const T* y, Math::Vector< T, 2 >& shift, Math::Vector< T, 2 >& scale )
+{
+	const T* const coords[ 2 ] = { x, y };
+	Detail::estimateNormalizationBatch( n, coords, shift, scale );
+}
+
+/**
+ * Computes the normalization parameters of \c n 3D points given as separate coordinate arrays,
+ * see the 2D version.
+ */
+template< typename T >
+void estimate_normalization_batch( const std::size_t n, const T* x, const T* y, const T* z, Math::Vector< T, 3 >& shift, Math::Vector< T, 3 >& scale )
+{
+	const T* const coords[ 3 ] = { x, y, z };
+	Detail::estimateNormalizationBatch( n, coords, shift, scale );
+}
+
+/**
+ * Applies p'=(p-shift)/scale to \c n 2D points given as separate coordinate arrays.
+ *
+ * The output arrays may be identical to the input arrays to normalize in place, or e.g. columns
+ * of a column-major design matrix, which avoids a separate copy of the normalized points.
+ *
+ * @tparam T type of point ( e.g. \c double or \c float )
+ * @param n number of points
+ * @param shift the shift from \c estimate_normalization_batch
+ * @param scale the scale from \c estimate_normalization_batch
+ * @param x,y arrays of the point coordinates
+ * @param xOut,yOut arrays receiving the normalized coordinates
+ */
+template< typename T >
+void normalize_points_batch( const std::size_t n, const Math::Vector< T, 2 >& shift, const Math::Vector< T, 2 >& scale
+	, const T* x, const T* y, T* xOut, T* yOut )
+{
+	const T* const coords[ 2 ] = { x, y };
+	T* const out[ 2 ] = { xOut, yOut };
+	Detail::normalizeBatch( n, shift, scale, coords, out );
+}
+
+/**
+ * Applies p'=(p-shift)/scale to \c n 3D points given as separate coordinate arrays, see the 2D version.
+ */
+template< typename T >
+void normalize_points_batch( const std::size_t n, const Math::Vector< T, 3 >& shift, const Math::Vector< T, 3 >& scale
+	, const T* x, const T* y, const T* z, T* xOut, T* yOut, T* zOut )
+{
+	const T* const coords[ 3 ] = { x, y, z };
+	T* const out[ 3 ] = { xOut, yOut, zOut };
+	Detail::normalizeBatch( n, shift, scale, coords, out );
+}
+
 }}} // namespace Ubitrack::Math::Geometry
 
 #endif // __POINT_NORMALIZATION_H__
\ No newline at end of file
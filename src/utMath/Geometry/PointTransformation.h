@@ -37,6 +37,7 @@
 
 #include <utMath/Vector.h> //includes static assert
 #include <utMath/Matrix.h>
+#include <utMath/RotationMatrixCache.h>
 
 
 #include "container_traits.h"
@@ -181,6 +182,13 @@ public:
 		const T e4 = transMat( 3, 0 ) * vec( 0 ) + transMat( 3, 1 ) * vec( 1 ) + transMat( 3, 3 ) * vec( 2 ) + transMat( 3, 3 ) * vec( 3 );
 		return Math::Vector< T, 4 > ( e1, e2, e3, e4 );
 	}
+
+	/// @internal Specialization of bracket operator (\c operator() ) for a \b pose with cached rotation matrix and \b 3D \b points
+	template< typename T >
+	Math::Vector< T, 3 > operator() ( const Math::CachedPose< T > &pose, const Math::Vector< T, 3 > &vec ) const
+	{
+		return pose * vec;
+	}
 };
 
 
@@ -254,6 +262,27 @@ inline void transform_points( const Math::Matrix< T, M, N > &transformation, con
 }
 
 
+/**
+ * @ingroup math geometry
+ * @brief transforms several \b 3D \b points with a pose, converting its rotation to a matrix at most once.
+ *
+ * @param pose the pose applied to the \b points
+ * @param iBegin \c iterator pointing to first element in the input container/storage class of the \b points
+ * @param iEnd \c iterator pointing behind the last element in the input container/storage class of the \b points
+ * @param iOut output \c iterator pointing to first element in container/storage class for storing the transformed points
+ */
+template< typename T, typename ForwardIterator1, typename ForwardIterator2 >
+inline void transform_points( const Math::CachedPose< T > &pose, const ForwardIterator1 iBegin, const ForwardIterator1 iEnd, ForwardIterator2 iOut )
+{
+	typedef typename Ubitrack::Util::container_traits< ForwardIterator1 >::value_type vector_type_in;
+	UBITRACK_STATIC_ASSERT( (Ubitrack::Util::is_same< vector_type_in, Math::Vector< T, 3 > >::value ), POSES_TRANSFORM_ONLY_3D_POINTS_OF_SAME_BUILTIN_TYPE );
+
+	const std::size_t n = std::distance( iBegin, iEnd );
+	Ubitrack::Util::identity< const Math::CachedPose< T > > id_container( pose, n );
+	std::transform( id_container.begin(), id_container.end(), iBegin, iOut, TransformPoint() );
+}
+
+
 } } } // namespace Ubitrack::Math::Geometry
 
 #endif //__H__POINT_TRANSFORMATION_FUNCTIONS__
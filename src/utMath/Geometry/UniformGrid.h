@@ -0,0 +1,613 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math geometry
+ * @file
+ * uniform hash grid for neighbour queries on changing points
+ */
+
+#ifndef __H__UNIFORM_GRID__
+#define __H__UNIFORM_GRID__
+
+#include <cmath>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/static_assert.hpp>
+
+#include <utUtil/Exception.h>
+#include <utMath/Vector.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
+
+namespace Ubitrack { namespace Math { namespace Geometry {
+
+/**
+ * @ingroup math geometry
+ * A uniform grid over a changing set of points, e.g. the blobs of the current camera frame.
+ *
+ * Space is divided into cubic cells of a fixed size, and every cell is mapped to one of a fixed number
+ * of buckets by a spatial hash, so the grid needs no bounds. A bucket stores copies of its points,
+ * such that the points of a cell lie next to each other in memory. Points are inserted, moved and
+ * removed in constant time and keep the id returned by \c insert, ids of removed points are reused.
+ *
+ * Queries visit the cells around the query point, so they are fastest if the cell size is close to
+ * the typical query radius. Unlike \c KdTree, the grid degrades if the points are spread over many
+ * more cells than there are buckets. Queries only read the grid and may run in several threads at
+ * once, as long as no points change, the batched queries can be distributed over threads by a
+ * \c Math::ListExecutor.
+ *
+ * @code
+ * Geometry::UniformGrid< double, 2 > grid( 8.0 );
+ * const std::size_t id = grid.insert( blob );
+ * grid.move( id, newPosition );
+ * grid.radiusSearch( projected, 4.0 * 4.0, neighbours );
+ * @endcode
+ */
+template< typename T, std::size_t N >
+class UniformGrid
+{
+	BOOST_STATIC_ASSERT( N > 0 && N <= 3 );
+
+public:
+	typedef Math::Vector< T, N > point_type;
+
+	/** id returned if no point lies within the search radius */
+	static const std::size_t invalid = std::size_t( -1 );
+
+	/**
+	 * an empty grid
+	 * @param cellSize edge length of the cells
+	 * @param nBuckets number of hash buckets, should be about the number of occupied cells
+	 */
+	explicit UniformGrid( const T cellSize, const std::size_t nBuckets = 4096 )
+		: m_cellSize( cellSize )
+		, m_buckets( std::max< std::size_t >( nBuckets, 1 ) )
+		, m_size( 0 )
+		, m_bBounds( false )
+	{
+		if ( !( cellSize > 0 ) )
+			UBITRACK_THROW( "Cell size of the grid must be positive" );
+	}
+
+	/** inserts a point and returns its id */
+	std::size_t insert( const point_type& p );
+
+	/** removes the point with the given id */
+	void remove( std::size_t id );
+
+	/** moves the point with the given id */
+	void move( std::size_t id, const point_type& p );
+
+	/** removes all points */
+	void clear();
+
+	/** number of points */
+	std::size_t size() const
+	{ return m_size; }
+
+	/** returns if a point with the given id exists */
+	bool contains( const std::size_t id ) const
+	{ return id < m_locations.size() && m_locations[ id ].bucket != invalid; }
+
+	/** returns the point with the given id */
+	const point_type& point( const std::size_t id ) const
+	{
+		assert( contains( id ) );
+		return m_buckets[ m_locations[ id ].bucket ][ m_locations[ id ].slot ].point;
+	}
+
+	/**
+	 * finds the nearest point
+	 * @param query the query point
+	 * @param maxDistanceSq only points with a squared distance below this are returned
+	 * @param pDistanceSq receives the squared distance of the nearest point if not null
+	 * @return id of the nearest point, or \c invalid
+	 */
+	std::size_t nearest( const point_type& query, T maxDistanceSq = std::numeric_limits< T >::max(), T* pDistanceSq = 0 ) const;
+
+	/**
+	 * finds the \c k nearest points
+	 * @param query the query point
+	 * @param k maximum number of points
+	 * @param result receives the squared distances and ids of the points, sorted by distance
+	 * @param maxDistanceSq only points with a squared distance below this are returned
+	 */
+	void kNearest( const point_type& query, std::size_t k, std::vector< std::pair< T, std::size_t > >& result,
+		T maxDistanceSq = std::numeric_limits< T >::max() ) const;
+
+	/**
+	 * finds all points within a radius
+	 * @param query the query point
+	 * @param radiusSq points with a squared distance below this are returned
+	 * @param result receives the squared distances and ids of the points, in no particular order
+	 */
+	void radiusSearch( const point_type& query, T radiusSq, std::vector< std::pair< T, std::size_t > >& result ) const;
+
+	/** finds the nearest point of every query, like \c KdTree::nearest */
+	void nearest( const std::vector< point_type >& queries, std::vector< std::size_t >& ids, std::vector< T >& distancesSq,
+		T maxDistanceSq = std::numeric_limits< T >::max(), const ListExecutor& executor = ListExecutor() ) const;
+
+	/** finds the \c k nearest points of every query, like \c KdTree::kNearest */
+	void kNearest( const std::vector< point_type >& queries, std::size_t k, std::vector< std::vector< std::pair< T, std::size_t > > >& results,
+		T maxDistanceSq = std::numeric_limits< T >::max(), const ListExecutor& executor = ListExecutor() ) const;
+
+	/** finds the points within a radius of every query, like \c KdTree::radiusSearch */
+	void radiusSearch( const std::vector< point_type >& queries, T radiusSq, std::vector< std::vector< std::pair< T, std::size_t > > >& results,
+		const ListExecutor& executor = ListExecutor() ) const;
+
+protected:
+	/** integer coordinates of a cell */
+	struct Cell
+	{
+		long c[ N ];
+
+		bool operator==( const Cell& other ) const
+		{ return std::equal( c, c + N, other.c ); }
+	};
+
+	/** a point stored in a bucket */
+	struct Item
+	{
+		point_type point;
+		Cell cell;
+		std::size_t id;
+	};
+
+	/** position of a point in the buckets, \c bucket is \c invalid for unused ids */
+	struct Location
+	{
+		std::size_t bucket;
+		std::size_t slot;
+	};
+
+	/** keeps the nearest point */
+	struct NearestVisitor
+	{
+		NearestVisitor( const T maxDistanceSq )
+			: boundSq( maxDistanceSq )
+			, best( invalid )
+		{}
+
+		void operator()( const T d, const std::size_t id )
+		{
+			if ( d < boundSq )
+			{
+				boundSq = d;
+				best = id;
+			}
+		}
+
+		T boundSq;
+		std::size_t best;
+	};
+
+	/** keeps the k nearest points, sorted by distance */
+	struct KNearestVisitor
+	{
+		KNearestVisitor( const std::size_t k_, std::vector< std::pair< T, std::size_t > >& result_, const T maxDistanceSq )
+			: k( k_ )
+			, result( result_ )
+			, boundSq( maxDistanceSq )
+		{}
+
+		void operator()( const T d, const std::size_t id )
+		{
+			if ( !( d < boundSq ) )
+				return;
+			if ( result.size() == k )
+				result.pop_back();
+			result.insert( std::upper_bound( result.begin(), result.end(), std::make_pair( d, id ) ), std::make_pair( d, id ) );
+			if ( result.size() == k )
+				boundSq = result.back().first;
+		}
+
+		std::size_t k;
+		std::vector< std::pair< T, std::size_t > >& result;
+		T boundSq;
+	};
+
+	/** keeps all points within the radius */
+	struct RadiusVisitor
+	{
+		RadiusVisitor( std::vector< std::pair< T, std::size_t > >& result_, const T radiusSq )
+			: result( result_ )
+			, boundSq( radiusSq )
+		{}
+
+		void operator()( const T d, const std::size_t id )
+		{
+			if ( d < boundSq )
+				result.push_back( std::make_pair( d, id ) );
+		}
+
+		std::vector< std::pair< T, std::size_t > >& result;
+		T boundSq;
+	};
+
+	/** cell of a point */
+	Cell cellOf( const point_type& p ) const
+	{
+		Cell cell;
+		for ( std::size_t k = 0; k < N; k++ )
+			cell.c[ k ] = static_cast< long >( std::floor( p( k ) / m_cellSize ) );
+		return cell;
+	}
+
+	/** bucket of a cell, by the spatial hash of Teschner et al. */
+	std::size_t bucketOf( const Cell& cell ) const
+	{
+		static const std::size_t primes[ 3 ] = { 73856093u, 19349663u, 83492791u };
+		std::size_t h = 0;
+		for ( std::size_t k = 0; k < N; k++ )
+			h ^= static_cast< std::size_t >( cell.c[ k ] ) * primes[ k ];
+		return h % m_buckets.size();
+	}
+
+	/** stores a point under the given id */
+	void store( std::size_t id, const point_type& p );
+
+	/** removes a point from its bucket, the id stays allocated */
+	void unstore( std::size_t id );
+
+	/** passes the points of a cell with their squared distances to the visitor */
+	template< typename Visitor >
+	void visitCell( const Cell& cell, const point_type& query, Visitor& visitor ) const
+	{
+		const std::vector< Item >& bucket( m_buckets[ bucketOf( cell ) ] );
+		for ( std::size_t i = 0; i < bucket.size(); i++ )
+		{
+			// other cells may share the bucket
+			if ( !( bucket[ i ].cell == cell ) )
+				continue;
+			T d( 0 );
+			for ( std::size_t k = 0; k < N; k++ )
+			{
+				const T diff = query( k ) - bucket[ i ].point( k );
+				d += diff * diff;
+			}
+			visitor( d, bucket[ i ].id );
+		}
+	}
+
+	/**
+	 * visits the cells of the box [ from, to ] clipped to the occupied cells,
+	 * skipping the cells closer than \c ring to \c center in all coordinates
+	 */
+	template< typename Visitor >
+	void visitBox( const Cell& center, long ring, const Cell& from, const Cell& to, const point_type& query, Visitor& visitor ) const;
+
+	/** visits the cells in rings of growing size around the query until the visitor's bound is reached */
+	template< typename Visitor >
+	void visitRings( const point_type& query, Visitor& visitor ) const;
+
+	/** the batched queries of [ begin, end ) */
+	void nearestRange( std::size_t begin, std::size_t end, const std::vector< point_type >& queries, T maxDistanceSq,
+		std::vector< std::size_t >& ids, std::vector< T >& distancesSq ) const
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+		{
+			distancesSq[ i ] = maxDistanceSq;
+			ids[ i ] = nearest( queries[ i ], maxDistanceSq, &distancesSq[ i ] );
+		}
+	}
+
+	void kNearestRange( std::size_t begin, std::size_t end, const std::vector< point_type >& queries, std::size_t k, T maxDistanceSq,
+		std::vector< std::vector< std::pair< T, std::size_t > > >& results ) const
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+			kNearest( queries[ i ], k, results[ i ], maxDistanceSq );
+	}
+
+	void radiusRange( std::size_t begin, std::size_t end, const std::vector< point_type >& queries, T radiusSq,
+		std::vector< std::vector< std::pair< T, std::size_t > > >& results ) const
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+			radiusSearch( queries[ i ], radiusSq, results[ i ] );
+	}
+
+	/** edge length of the cells */
+	T m_cellSize;
+
+	/** the points, hashed by their cells */
+	std::vector< std::vector< Item > > m_buckets;
+
+	/** position of every id and the ids of removed points */
+	std::vector< Location > m_locations;
+	std::vector< std::size_t > m_freeIds;
+
+	/** number of points */
+	std::size_t m_size;
+
+	/** bounds of the cells that contained points since the last \c clear, limits the searched cells */
+	bool m_bBounds;
+	Cell m_lower;
+	Cell m_upper;
+};
+
+template< typename T, std::size_t N >
+const std::size_t UniformGrid< T, N >::invalid;
+
+template< typename T, std::size_t N >
+std::size_t UniformGrid< T, N >::insert( const point_type& p )
+{
+	std::size_t id;
+	if ( m_freeIds.empty() )
+	{
+		id = m_locations.size();
+		m_locations.push_back( Location() );
+	}
+	else
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	store( id, p );
+	m_size++;
+	return id;
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::remove( const std::size_t id )
+{
+	if ( !contains( id ) )
+		UBITRACK_THROW( "Point to remove is not in the grid" );
+	unstore( id );
+	m_freeIds.push_back( id );
+	m_size--;
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::move( const std::size_t id, const point_type& p )
+{
+	if ( !contains( id ) )
+		UBITRACK_THROW( "Point to move is not in the grid" );
+
+	// points that stay in their cell are updated in place
+	Item& item( m_buckets[ m_locations[ id ].bucket ][ m_locations[ id ].slot ] );
+	if ( item.cell == cellOf( p ) )
+		item.point = p;
+	else
+	{
+		unstore( id );
+		store( id, p );
+	}
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::clear()
+{
+	for ( std::size_t b = 0; b < m_buckets.size(); b++ )
+		m_buckets[ b ].clear();
+	m_locations.clear();
+	m_freeIds.clear();
+	m_size = 0;
+	m_bBounds = false;
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::store( const std::size_t id, const point_type& p )
+{
+	Item item;
+	item.point = p;
+	item.cell = cellOf( p );
+	item.id = id;
+
+	if ( !m_bBounds )
+	{
+		m_lower = m_upper = item.cell;
+		m_bBounds = true;
+	}
+	for ( std::size_t k = 0; k < N; k++ )
+	{
+		m_lower.c[ k ] = std::min( m_lower.c[ k ], item.cell.c[ k ] );
+		m_upper.c[ k ] = std::max( m_upper.c[ k ], item.cell.c[ k ] );
+	}
+
+	const std::size_t b = bucketOf( item.cell );
+	m_locations[ id ].bucket = b;
+	m_locations[ id ].slot = m_buckets[ b ].size();
+	m_buckets[ b ].push_back( item );
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::unstore( const std::size_t id )
+{
+	// the last point of the bucket takes the place of the removed one
+	std::vector< Item >& bucket( m_buckets[ m_locations[ id ].bucket ] );
+	const std::size_t slot = m_locations[ id ].slot;
+	if ( slot + 1 != bucket.size() )
+	{
+		bucket[ slot ] = bucket.back();
+		m_locations[ bucket[ slot ].id ].slot = slot;
+	}
+	bucket.pop_back();
+	m_locations[ id ].bucket = invalid;
+}
+
+template< typename T, std::size_t N >
+template< typename Visitor >
+void UniformGrid< T, N >::visitBox( const Cell& center, const long ring, const Cell& from, const Cell& to,
+	const point_type& query, Visitor& visitor ) const
+{
+	Cell lower, upper;
+	for ( std::size_t k = 0; k < N; k++ )
+	{
+		lower.c[ k ] = std::max( from.c[ k ], m_lower.c[ k ] );
+		upper.c[ k ] = std::min( to.c[ k ], m_upper.c[ k ] );
+		if ( lower.c[ k ] > upper.c[ k ] )
+			return;
+	}
+
+	// rows along the first coordinate, of which only the ends lie on the ring if the other coordinates do not
+	Cell cell( lower );
+	while ( true )
+	{
+		bool bOnRing = ring == 0;
+		for ( std::size_t k = 1; k < N && !bOnRing; k++ )
+			bOnRing = std::abs( cell.c[ k ] - center.c[ k ] ) >= ring;
+		if ( bOnRing )
+			for ( cell.c[ 0 ] = lower.c[ 0 ]; cell.c[ 0 ] <= upper.c[ 0 ]; cell.c[ 0 ]++ )
+				visitCell( cell, query, visitor );
+		else
+		{
+			cell.c[ 0 ] = center.c[ 0 ] - ring;
+			if ( cell.c[ 0 ] >= lower.c[ 0 ] )
+				visitCell( cell, query, visitor );
+			cell.c[ 0 ] = center.c[ 0 ] + ring;
+			if ( cell.c[ 0 ] <= upper.c[ 0 ] )
+				visitCell( cell, query, visitor );
+		}
+		cell.c[ 0 ] = lower.c[ 0 ];
+
+		std::size_t k = 1;
+		for ( ; k < N; k++ )
+		{
+			if ( ++cell.c[ k ] <= upper.c[ k ] )
+				break;
+			cell.c[ k ] = lower.c[ k ];
+		}
+		if ( k == N )
+			return;
+	}
+}
+
+template< typename T, std::size_t N >
+template< typename Visitor >
+void UniformGrid< T, N >::visitRings( const point_type& query, Visitor& visitor ) const
+{
+	if ( m_size == 0 )
+		return;
+
+	// rings closer than the occupied cells are empty
+	const Cell center( cellOf( query ) );
+	long firstRing = 0;
+	for ( std::size_t k = 0; k < N; k++ )
+		firstRing = std::max( firstRing, std::max( m_lower.c[ k ] - center.c[ k ], center.c[ k ] - m_upper.c[ k ] ) );
+
+	for ( long ring = firstRing; ; ring++ )
+	{
+		Cell from, to;
+		bool bCovered = true;
+		for ( std::size_t k = 0; k < N; k++ )
+		{
+			from.c[ k ] = center.c[ k ] - ring;
+			to.c[ k ] = center.c[ k ] + ring;
+			bCovered = bCovered && from.c[ k ] <= m_lower.c[ k ] && to.c[ k ] >= m_upper.c[ k ];
+		}
+		visitBox( center, ring, from, to, query, visitor );
+
+		// points outside the visited cells are at least ring cells away
+		const T reach = ring * m_cellSize;
+		if ( bCovered || !( reach * reach < visitor.boundSq ) )
+			return;
+	}
+}
+
+template< typename T, std::size_t N >
+std::size_t UniformGrid< T, N >::nearest( const point_type& query, const T maxDistanceSq, T* pDistanceSq ) const
+{
+	NearestVisitor visitor( maxDistanceSq );
+	visitRings( query, visitor );
+	if ( visitor.best != invalid && pDistanceSq )
+		*pDistanceSq = visitor.boundSq;
+	return visitor.best;
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::kNearest( const point_type& query, const std::size_t k, std::vector< std::pair< T, std::size_t > >& result,
+	const T maxDistanceSq ) const
+{
+	result.clear();
+	if ( k == 0 )
+		return;
+
+	KNearestVisitor visitor( k, result, maxDistanceSq );
+	visitRings( query, visitor );
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::radiusSearch( const point_type& query, const T radiusSq, std::vector< std::pair< T, std::size_t > >& result ) const
+{
+	result.clear();
+	if ( m_size == 0 || !( radiusSq > 0 ) )
+		return;
+
+	// the box of cells around the sphere
+	const T radius = std::sqrt( radiusSq );
+	Cell from, to;
+	for ( std::size_t k = 0; k < N; k++ )
+	{
+		from.c[ k ] = static_cast< long >( std::floor( ( query( k ) - radius ) / m_cellSize ) );
+		to.c[ k ] = static_cast< long >( std::floor( ( query( k ) + radius ) / m_cellSize ) );
+	}
+
+	RadiusVisitor visitor( result, radiusSq );
+	visitBox( from, 0, from, to, query, visitor );
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::nearest( const std::vector< point_type >& queries, std::vector< std::size_t >& ids, std::vector< T >& distancesSq,
+	const T maxDistanceSq, const ListExecutor& executor ) const
+{
+	ids.resize( queries.size() );
+	distancesSq.resize( queries.size() );
+	if ( executor.empty() )
+		nearestRange( 0, queries.size(), queries, maxDistanceSq, ids, distancesSq );
+	else
+		executor( queries.size(), boost::bind( &UniformGrid< T, N >::nearestRange, this, _1, _2,
+			boost::cref( queries ), maxDistanceSq, boost::ref( ids ), boost::ref( distancesSq ) ) );
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::kNearest( const std::vector< point_type >& queries, const std::size_t k,
+	std::vector< std::vector< std::pair< T, std::size_t > > >& results, const T maxDistanceSq, const ListExecutor& executor ) const
+{
+	results.resize( queries.size() );
+	if ( executor.empty() )
+		kNearestRange( 0, queries.size(), queries, k, maxDistanceSq, results );
+	else
+		executor( queries.size(), boost::bind( &UniformGrid< T, N >::kNearestRange, this, _1, _2,
+			boost::cref( queries ), k, maxDistanceSq, boost::ref( results ) ) );
+}
+
+template< typename T, std::size_t N >
+void UniformGrid< T, N >::radiusSearch( const std::vector< point_type >& queries, const T radiusSq,
+	std::vector< std::vector< std::pair< T, std::size_t > > >& results, const ListExecutor& executor ) const
+{
+	results.resize( queries.size() );
+	if ( executor.empty() )
+		radiusRange( 0, queries.size(), queries, radiusSq, results );
+	else
+		executor( queries.size(), boost::bind( &UniformGrid< T, N >::radiusRange, this, _1, _2,
+			boost::cref( queries ), radiusSq, boost::ref( results ) ) );
+}
+
+} } } // namespace Ubitrack::Math::Geometry
+
+#endif // __H__UNIFORM_GRID__
@@ -0,0 +1,683 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Host implementation and device memory management of the GPU backend
+ */
+
+#include "Backend.h"
+#include "Reprojection.h"
+
+#include <limits>
+#include <algorithm>
+
+#include <utUtil/Exception.h>
+
+#ifdef HAVE_CUDA
+	#include <cuda_runtime.h>
+	#include "Kernels.h"
+#endif
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Math.Gpu" );
+
+namespace Ubitrack { namespace Math { namespace Gpu {
+
+namespace {
+
+#ifdef HAVE_CUDA
+
+/** throws if a CUDA call failed */
+void check( const cudaError_t error, const char* what )
+{
+	if ( error != cudaSuccess )
+		UBITRACK_THROW( std::string( "CUDA error " ) + what + ": " + cudaGetErrorString( error ) );
+}
+
+/** checks the launch of a kernel */
+void checkLaunch( const char* what )
+{
+	check( cudaGetLastError(), what );
+}
+
+/** device memory that only grows, so it is allocated once for repeated calls of the same size */
+template< typename T >
+class DeviceBuffer
+	: private boost::noncopyable
+{
+public:
+	DeviceBuffer()
+		: m_pData( 0 )
+		, m_capacity( 0 )
+	{}
+
+	~DeviceBuffer()
+	{
+		if ( m_pData )
+			cudaFree( m_pData );
+	}
+
+	/** makes room for n elements, the contents are lost if the buffer grows */
+	void reserve( const std::size_t n )
+	{
+		if ( n <= m_capacity )
+			return;
+		if ( m_pData )
+			cudaFree( m_pData );
+		m_pData = 0;
+		m_capacity = 0;
+		check( cudaMalloc( reinterpret_cast< void** >( &m_pData ), n * sizeof( T ) ), "allocating device memory" );
+		m_capacity = n;
+	}
+
+	void upload( const T* p, const std::size_t n )
+	{
+		reserve( n );
+		if ( n )
+			check( cudaMemcpy( m_pData, p, n * sizeof( T ), cudaMemcpyHostToDevice ), "copying to the device" );
+	}
+
+	void download( T* p, const std::size_t n ) const
+	{
+		if ( n )
+			check( cudaMemcpy( p, m_pData, n * sizeof( T ), cudaMemcpyDeviceToHost ), "copying from the device" );
+	}
+
+	T* get() const
+	{ return m_pData; }
+
+protected:
+	T* m_pData;
+	std::size_t m_capacity;
+};
+
+/** indices on the device are 32 bit */
+unsigned deviceIndex( const std::size_t i )
+{
+	if ( i > std::numeric_limits< unsigned >::max() )
+		UBITRACK_THROW( "GPU backend: problem too large for 32 bit indices" );
+	return static_cast< unsigned >( i );
+}
+
+/** copies indices to the device */
+void uploadIndices( DeviceBuffer< unsigned >& buffer, const std::vector< std::size_t >& indices )
+{
+	std::vector< unsigned > converted( indices.size() );
+	for ( std::size_t i = 0; i < indices.size(); i++ )
+		converted[ i ] = deviceIndex( indices[ i ] );
+	buffer.upload( converted.empty() ? 0 : &converted[ 0 ], converted.size() );
+}
+
+#endif // HAVE_CUDA
+
+} // anonymous namespace
+
+
+bool available()
+{
+#ifdef HAVE_CUDA
+	static const bool bAvailable = deviceName() != "host";
+	return bAvailable;
+#else
+	return false;
+#endif
+}
+
+
+std::string deviceName()
+{
+#ifdef HAVE_CUDA
+	int nDevices = 0;
+	cudaDeviceProp properties;
+	if ( cudaGetDeviceCount( &nDevices ) == cudaSuccess && nDevices > 0 && cudaGetDeviceProperties( &properties, 0 ) == cudaSuccess )
+		return properties.name;
+#endif
+	return "host";
+}
+
+
+struct ReprojectionEvaluator::Impl
+{
+	std::size_t nCameras;
+	std::size_t nPoints;
+	std::vector< std::size_t > cameras;
+	std::vector< std::size_t > points;
+	bool bDevice;
+
+#ifdef HAVE_CUDA
+	DeviceBuffer< unsigned > dCameras;
+	DeviceBuffer< unsigned > dPoints;
+	DeviceBuffer< double > dParams;
+	DeviceBuffer< double > dPredicted;
+	DeviceBuffer< double > dCameraJacobians;
+	DeviceBuffer< double > dPointJacobians;
+#endif
+};
+
+
+ReprojectionEvaluator::ReprojectionEvaluator( std::size_t nCameras, std::size_t nPoints,
+	const std::vector< std::size_t >& observationCamera, const std::vector< std::size_t >& observationPoint )
+	: m_pImpl( new Impl )
+{
+	if ( observationCamera.size() != observationPoint.size() )
+		UBITRACK_THROW( "GPU backend: different number of camera and point indices" );
+
+	Impl& d( *m_pImpl );
+	d.nCameras = nCameras;
+	d.nPoints = nPoints;
+	d.cameras = observationCamera;
+	d.points = observationPoint;
+	d.bDevice = available();
+
+#ifdef HAVE_CUDA
+	if ( d.bDevice )
+	{
+		const std::size_t n = d.cameras.size();
+		deviceIndex( 7 * nCameras + 3 * nPoints );
+		uploadIndices( d.dCameras, d.cameras );
+		uploadIndices( d.dPoints, d.points );
+		d.dParams.reserve( 7 * nCameras + 3 * nPoints );
+		d.dPredicted.reserve( 2 * n );
+		d.dCameraJacobians.reserve( 14 * n );
+		d.dPointJacobians.reserve( 6 * n );
+		LOG4CPP_DEBUG( logger, "Reprojecting " << n << " observations on " << deviceName() );
+	}
+#endif
+}
+
+
+ReprojectionEvaluator::~ReprojectionEvaluator()
+{}
+
+
+std::size_t ReprojectionEvaluator::observationCount() const
+{ return m_pImpl->cameras.size(); }
+
+
+bool ReprojectionEvaluator::onDevice() const
+{ return m_pImpl->bDevice; }
+
+
+void ReprojectionEvaluator::evaluate( const double* params, double* predicted, double* cameraJacobians, double* pointJacobians )
+{
+	Impl& d( *m_pImpl );
+	const std::size_t n = d.cameras.size();
+	const std::size_t pointOffset = 7 * d.nCameras;
+
+#ifdef HAVE_CUDA
+	if ( d.bDevice )
+	{
+		d.dParams.upload( params, pointOffset + 3 * d.nPoints );
+		Detail::reprojectObservations( deviceIndex( n ), d.dParams.get(), deviceIndex( pointOffset ),
+			d.dCameras.get(), d.dPoints.get(), d.dPredicted.get(), d.dCameraJacobians.get(), d.dPointJacobians.get() );
+		checkLaunch( "reprojecting the observations" );
+		d.dPredicted.download( predicted, 2 * n );
+		d.dCameraJacobians.download( cameraJacobians, 14 * n );
+		d.dPointJacobians.download( pointJacobians, 6 * n );
+		return;
+	}
+#endif
+
+	for ( std::size_t i = 0; i < n; i++ )
+		Detail::reprojectPoint( params + 7 * d.cameras[ i ], params + pointOffset + 3 * d.points[ i ],
+			predicted + 2 * i, cameraJacobians + 14 * i, pointJacobians + 6 * i );
+}
+
+
+struct PointProjector::Impl
+{
+	bool bDevice;
+	std::vector< double > points;
+	std::vector< double > result;
+
+#ifdef HAVE_CUDA
+	DeviceBuffer< double > dPoints;
+	DeviceBuffer< double > dResult;
+#endif
+};
+
+
+PointProjector::PointProjector()
+	: m_pImpl( new Impl )
+{
+	m_pImpl->bDevice = available();
+}
+
+
+PointProjector::~PointProjector()
+{}
+
+
+bool PointProjector::onDevice() const
+{ return m_pImpl->bDevice; }
+
+
+void PointProjector::project( const double* projection, const double* points, std::size_t n, double* result )
+{
+#ifdef HAVE_CUDA
+	Impl& d( *m_pImpl );
+	if ( d.bDevice )
+	{
+		Detail::ProjectionMatrix matrix;
+		std::copy( projection, projection + 12, matrix.p );
+		d.dPoints.upload( points, 3 * n );
+		d.dResult.reserve( 2 * n );
+		Detail::projectPoints( matrix, d.dPoints.get(), deviceIndex( n ), d.dResult.get() );
+		checkLaunch( "projecting the points" );
+		d.dResult.download( result, 2 * n );
+		return;
+	}
+#endif
+
+	for ( std::size_t i = 0; i < n; i++ )
+		Detail::projectPoint( projection, points + 3 * i, result + 2 * i );
+}
+
+
+void PointProjector::project( const Math::Matrix< double, 3, 4 >& projection, const std::vector< Math::Vector< double, 3 > >& points,
+	std::vector< Math::Vector< double, 2 > >& result )
+{
+	Impl& d( *m_pImpl );
+	const std::size_t n = points.size();
+	double matrix[ 12 ];
+	for ( std::size_t r = 0; r < 3; r++ )
+		for ( std::size_t c = 0; c < 4; c++ )
+			matrix[ 4 * r + c ] = projection( r, c );
+
+	d.points.resize( 3 * n );
+	d.result.resize( 2 * n );
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			d.points[ 3 * i + j ] = points[ i ]( j );
+
+	result.resize( n );
+	if ( n == 0 )
+		return;
+	project( matrix, &d.points[ 0 ], n, &d.result[ 0 ] );
+	for ( std::size_t i = 0; i < n; i++ )
+		result[ i ] = Math::Vector< double, 2 >( d.result[ 2 * i ], d.result[ 2 * i + 1 ] );
+}
+
+
+struct ConjugateGradientSolver::Impl
+{
+	/** the vectors of the iteration */
+	enum { vR, vZ, vP, vX, vAp, vInvDiag, vJp, nVectors };
+
+	bool bDevice;
+	std::size_t nRows;
+	std::size_t nCols;
+
+	/** J^T in compressed row storage, and the index of each of its elements in the values of J */
+	std::vector< std::size_t > tRowStart;
+	std::vector< std::size_t > tColumns;
+	std::vector< std::size_t > permutation;
+	std::vector< double > tValues;
+
+	std::vector< double > host[ nVectors ];
+
+#ifdef HAVE_CUDA
+	DeviceBuffer< unsigned > dRowStart;
+	DeviceBuffer< unsigned > dColumns;
+	DeviceBuffer< double > dValues;
+	DeviceBuffer< unsigned > dTRowStart;
+	DeviceBuffer< unsigned > dTColumns;
+	DeviceBuffer< unsigned > dPermutation;
+	DeviceBuffer< double > dTValues;
+	DeviceBuffer< double > device[ nVectors ];
+	DeviceBuffer< double > dPartials;
+	double partials[ Detail::maxDotPartials ];
+#endif
+
+	/** size of vector v */
+	std::size_t size( const int v ) const
+	{ return v == vJp ? nRows : nCols; }
+
+	/** storage of vector v */
+	double* data( const int v )
+	{
+#ifdef HAVE_CUDA
+		if ( bDevice )
+			return device[ v ].get();
+#endif
+		return host[ v ].empty() ? 0 : &host[ v ][ 0 ];
+	}
+
+	void allocate()
+	{
+		for ( int v = 0; v < nVectors; v++ )
+		{
+#ifdef HAVE_CUDA
+			if ( bDevice )
+			{
+				device[ v ].reserve( size( v ) );
+				continue;
+			}
+#endif
+			host[ v ].resize( size( v ) );
+		}
+#ifdef HAVE_CUDA
+		if ( bDevice )
+			dPartials.reserve( Detail::maxDotPartials );
+#endif
+	}
+
+	double dot( const int a, const int b )
+	{
+		const std::size_t n = size( a );
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			const unsigned nPartials = Detail::dotPartials( deviceIndex( n ), data( a ), data( b ), dPartials.get() );
+			checkLaunch( "computing an inner product" );
+			dPartials.download( partials, nPartials );
+			double sum = 0;
+			for ( unsigned i = 0; i < nPartials; i++ )
+				sum += partials[ i ];
+			return sum;
+		}
+#endif
+		const double* x = data( a );
+		const double* y = data( b );
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			sum += x[ i ] * y[ i ];
+		return sum;
+	}
+
+	/** y += a x */
+	void axpy( const double a, const int x, const int y )
+	{
+		const std::size_t n = size( x );
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			Detail::axpy( deviceIndex( n ), a, data( x ), data( y ) );
+			checkLaunch( "updating a vector" );
+			return;
+		}
+#endif
+		const double* px = data( x );
+		double* py = data( y );
+		for ( std::size_t i = 0; i < n; i++ )
+			py[ i ] += a * px[ i ];
+	}
+
+	/** y = x + b y */
+	void xpby( const int x, const double b, const int y )
+	{
+		const std::size_t n = size( x );
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			Detail::xpby( deviceIndex( n ), data( x ), b, data( y ) );
+			checkLaunch( "updating a vector" );
+			return;
+		}
+#endif
+		const double* px = data( x );
+		double* py = data( y );
+		for ( std::size_t i = 0; i < n; i++ )
+			py[ i ] = px[ i ] + b * py[ i ];
+	}
+
+	/** z = invDiag .* r */
+	void precondition()
+	{
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			Detail::multiplyElements( deviceIndex( nCols ), data( vInvDiag ), data( vR ), data( vZ ) );
+			checkLaunch( "preconditioning" );
+			return;
+		}
+#endif
+		const double* d = data( vInvDiag );
+		const double* r = data( vR );
+		double* z = data( vZ );
+		for ( std::size_t j = 0; j < nCols; j++ )
+			z[ j ] = d[ j ] * r[ j ];
+	}
+
+	/** invDiag = 1 / diag( J^T J + lambda I ), from the rows of J^T */
+	void inverseDiagonal( const double lambda )
+	{
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			Detail::inverseRowNorms( deviceIndex( nCols ), dTRowStart.get(), dTValues.get(), lambda, data( vInvDiag ) );
+			checkLaunch( "computing the preconditioner" );
+			return;
+		}
+#endif
+		double* d = data( vInvDiag );
+		for ( std::size_t j = 0; j < nCols; j++ )
+		{
+			double sum = lambda;
+			for ( std::size_t k = tRowStart[ j ]; k < tRowStart[ j + 1 ]; k++ )
+				sum += tValues[ k ] * tValues[ k ];
+			d[ j ] = 1 / sum;
+		}
+	}
+
+	/** Ap = J^T J p + lambda p */
+	void multiplyNormal( const double lambda, const std::vector< std::size_t >& rowStart,
+		const std::vector< std::size_t >& columns, const std::vector< double >& values )
+	{
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			Detail::csrMultiply( deviceIndex( nRows ), dRowStart.get(), dColumns.get(), dValues.get(), data( vP ), data( vJp ) );
+			Detail::csrMultiply( deviceIndex( nCols ), dTRowStart.get(), dTColumns.get(), dTValues.get(), data( vJp ), data( vAp ) );
+			Detail::axpy( deviceIndex( nCols ), lambda, data( vP ), data( vAp ) );
+			checkLaunch( "multiplying with the normal matrix" );
+			return;
+		}
+#endif
+		const double* p = data( vP );
+		double* jp = data( vJp );
+		double* ap = data( vAp );
+		for ( std::size_t i = 0; i < nRows; i++ )
+		{
+			double sum = 0;
+			for ( std::size_t k = rowStart[ i ]; k < rowStart[ i + 1 ]; k++ )
+				sum += values[ k ] * p[ columns[ k ] ];
+			jp[ i ] = sum;
+		}
+		for ( std::size_t j = 0; j < nCols; j++ )
+		{
+			double sum = lambda * p[ j ];
+			for ( std::size_t k = tRowStart[ j ]; k < tRowStart[ j + 1 ]; k++ )
+				sum += tValues[ k ] * jp[ tColumns[ k ] ];
+			ap[ j ] = sum;
+		}
+	}
+
+	/** y = x */
+	void copy( const int x, const int y )
+	{
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			if ( size( x ) )
+				check( cudaMemcpy( data( y ), data( x ), size( x ) * sizeof( double ), cudaMemcpyDeviceToDevice ), "copying a vector" );
+			return;
+		}
+#endif
+		host[ y ] = host[ x ];
+	}
+
+	/** v = 0 */
+	void zero( const int v )
+	{
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			if ( size( v ) )
+				check( cudaMemset( data( v ), 0, size( v ) * sizeof( double ) ), "clearing a vector" );
+			return;
+		}
+#endif
+		std::fill( host[ v ].begin(), host[ v ].end(), 0.0 );
+	}
+
+	/** copies a host vector into vector v */
+	void set( const int v, const double* p )
+	{
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			device[ v ].upload( p, size( v ) );
+			return;
+		}
+#endif
+		std::copy( p, p + size( v ), host[ v ].begin() );
+	}
+
+	/** copies vector v to the host */
+	void get( const int v, double* p )
+	{
+#ifdef HAVE_CUDA
+		if ( bDevice )
+		{
+			device[ v ].download( p, size( v ) );
+			return;
+		}
+#endif
+		std::copy( host[ v ].begin(), host[ v ].end(), p );
+	}
+};
+
+
+ConjugateGradientSolver::ConjugateGradientSolver()
+	: m_nCols( 0 )
+	, m_pImpl( new Impl )
+{
+	m_pImpl->bDevice = available();
+	m_pImpl->nRows = 0;
+	m_pImpl->nCols = 0;
+}
+
+
+ConjugateGradientSolver::~ConjugateGradientSolver()
+{}
+
+
+bool ConjugateGradientSolver::onDevice() const
+{ return m_pImpl->bDevice; }
+
+
+void ConjugateGradientSolver::upload( bool bPattern )
+{
+	Impl& d( *m_pImpl );
+	const std::size_t nnz = m_values.size();
+
+	if ( bPattern )
+	{
+		// transpose the pattern by counting the elements of each column
+		d.nRows = m_rowStart.size() - 1;
+		d.nCols = m_nCols;
+		d.tRowStart.assign( m_nCols + 1, 0 );
+		for ( std::size_t k = 0; k < nnz; k++ )
+			d.tRowStart[ m_columns[ k ] + 1 ]++;
+		for ( std::size_t j = 0; j < m_nCols; j++ )
+			d.tRowStart[ j + 1 ] += d.tRowStart[ j ];
+
+		std::vector< std::size_t > next( d.tRowStart.begin(), d.tRowStart.end() - 1 );
+		d.tColumns.resize( nnz );
+		d.permutation.resize( nnz );
+		for ( std::size_t i = 0; i < d.nRows; i++ )
+			for ( std::size_t k = m_rowStart[ i ]; k < m_rowStart[ i + 1 ]; k++ )
+			{
+				const std::size_t t = next[ m_columns[ k ] ]++;
+				d.tColumns[ t ] = i;
+				d.permutation[ t ] = k;
+			}
+		d.allocate();
+
+#ifdef HAVE_CUDA
+		if ( d.bDevice )
+		{
+			uploadIndices( d.dRowStart, m_rowStart );
+			uploadIndices( d.dColumns, m_columns );
+			uploadIndices( d.dTRowStart, d.tRowStart );
+			uploadIndices( d.dTColumns, d.tColumns );
+			uploadIndices( d.dPermutation, d.permutation );
+			d.dTValues.reserve( nnz );
+		}
+#endif
+	}
+
+#ifdef HAVE_CUDA
+	if ( d.bDevice )
+	{
+		d.dValues.upload( nnz ? &m_values[ 0 ] : 0, nnz );
+		Detail::gather( deviceIndex( nnz ), d.dPermutation.get(), d.dValues.get(), d.dTValues.get() );
+		checkLaunch( "transposing the jacobian" );
+		return;
+	}
+#endif
+
+	d.tValues.resize( nnz );
+	for ( std::size_t t = 0; t < nnz; t++ )
+		d.tValues[ t ] = m_values[ d.permutation[ t ] ];
+}
+
+
+std::size_t ConjugateGradientSolver::solve( double lambda, const double* b, double* x, std::size_t maxIterations, double tolerance )
+{
+	if ( m_rowStart.empty() )
+		UBITRACK_THROW( "GPU conjugate gradients: no jacobian set" );
+
+	Impl& d( *m_pImpl );
+	d.set( Impl::vR, b );
+	d.inverseDiagonal( lambda );
+	d.precondition();
+	d.copy( Impl::vZ, Impl::vP );
+	d.zero( Impl::vX );
+
+	double rz = d.dot( Impl::vR, Impl::vZ );
+	const double stop = tolerance * tolerance * d.dot( Impl::vR, Impl::vR );
+	std::size_t iteration = 0;
+	while ( iteration < maxIterations && d.dot( Impl::vR, Impl::vR ) > stop )
+	{
+		d.multiplyNormal( lambda, m_rowStart, m_columns, m_values );
+
+		const double alpha = rz / d.dot( Impl::vP, Impl::vAp );
+		d.axpy( alpha, Impl::vP, Impl::vX );
+		d.axpy( -alpha, Impl::vAp, Impl::vR );
+		d.precondition();
+
+		const double rzNew = d.dot( Impl::vR, Impl::vZ );
+		d.xpby( Impl::vZ, rzNew / rz, Impl::vP );
+		rz = rzNew;
+		++iteration;
+	}
+
+	d.get( Impl::vX, x );
+	return iteration;
+}
+
+}}} // namespace Ubitrack::Math::Gpu
@@ -0,0 +1,229 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Optional CUDA backend for large bundle adjustment type problems
+ *
+ * Calibrations over several days produce millions of observations. Evaluating their
+ * reprojections and jacobians, projecting large point sets and solving the normal equations
+ * by conjugate gradients are independent per observation or per matrix row and run well on
+ * a GPU. The classes below do this on the first CUDA device if the library was built with
+ * the CMake option \c ENABLE_CUDA, and on the host otherwise or if there is no device, so
+ * callers do not need to distinguish the cases.
+ *
+ * Each object keeps its device buffers until it is destroyed and only grows them, so an
+ * optimizer that keeps the object over its iterations allocates device memory once. Only
+ * the changing values are copied: the parameters to the device and the residuals and
+ * jacobian blocks back. All computations are in double precision.
+ */
+
+#ifndef __UBITRACK_MATH_GPU_BACKEND_H_INCLUDED__
+#define __UBITRACK_MATH_GPU_BACKEND_H_INCLUDED__
+
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Optimization/SparseJacobian.h>
+
+namespace Ubitrack { namespace Math { namespace Gpu {
+
+/** true if the library was built with CUDA and a device is present */
+UBITRACK_EXPORT bool available();
+
+/** name of the device that is used, "host" without one */
+UBITRACK_EXPORT std::string deviceName();
+
+
+/**
+ * @ingroup math
+ * Evaluates the reprojections of all observations of a bundle adjustment.
+ *
+ * The parameter vector holds 7 parameters for each camera (quaternion x, y, z, w and
+ * translation) followed by 3 for each point. Observation i is the projection of point
+ * \c observationPoint[ i ] into the normalized image plane of camera \c observationCamera[ i ].
+ * The indices are copied to the device once in the constructor.
+ */
+class UBITRACK_EXPORT ReprojectionEvaluator
+	: private boost::noncopyable
+{
+public:
+	/**
+	 * @param nCameras number of cameras
+	 * @param nPoints number of points
+	 * @param observationCamera camera index of each observation
+	 * @param observationPoint point index of each observation
+	 */
+	ReprojectionEvaluator( std::size_t nCameras, std::size_t nPoints,
+		const std::vector< std::size_t >& observationCamera, const std::vector< std::size_t >& observationPoint );
+
+	~ReprojectionEvaluator();
+
+	/** number of observations */
+	std::size_t observationCount() const;
+
+	/** true if the evaluation runs on the device */
+	bool onDevice() const;
+
+	/**
+	 * evaluates all observations.
+	 * @param params the 7 * nCameras + 3 * nPoints parameters
+	 * @param predicted 2 values per observation
+	 * @param cameraJacobians row-major 2x7 block per observation
+	 * @param pointJacobians row-major 2x3 block per observation
+	 */
+	void evaluate( const double* params, double* predicted, double* cameraJacobians, double* pointJacobians );
+
+protected:
+	struct Impl;
+	boost::scoped_ptr< Impl > m_pImpl;
+};
+
+
+/**
+ * @ingroup math
+ * Projects large batches of 3D points with a 3x4 projection matrix,
+ * like \c Geometry::project_points.
+ */
+class UBITRACK_EXPORT PointProjector
+	: private boost::noncopyable
+{
+public:
+	PointProjector();
+
+	~PointProjector();
+
+	/** true if the projection runs on the device */
+	bool onDevice() const;
+
+	/**
+	 * @param projection row-major 3x4 projection matrix
+	 * @param points x, y, z of each point
+	 * @param n number of points
+	 * @param result x, y of each projected point
+	 */
+	void project( const double* projection, const double* points, std::size_t n, double* result );
+
+	/** projects a vector of points */
+	void project( const Math::Matrix< double, 3, 4 >& projection, const std::vector< Math::Vector< double, 3 > >& points,
+		std::vector< Math::Vector< double, 2 > >& result );
+
+protected:
+	struct Impl;
+	boost::scoped_ptr< Impl > m_pImpl;
+};
+
+
+/**
+ * @ingroup math
+ * Solves ( J^T J + lambda I ) x = b by jacobi-preconditioned conjugate gradients, like the
+ * host solver of \c sparseLevenbergMarquardt.
+ *
+ * The sparsity pattern of J and its transpose are copied to the device when they change,
+ * the values with every call of \c setJacobian.
+ */
+class UBITRACK_EXPORT ConjugateGradientSolver
+	: private boost::noncopyable
+{
+public:
+	ConjugateGradientSolver();
+
+	~ConjugateGradientSolver();
+
+	/** true if the solver runs on the device */
+	bool onDevice() const;
+
+	/** sets the jacobian */
+	template< typename T >
+	void setJacobian( const Optimization::SparseJacobian< T >& J )
+	{
+		const std::size_t nnz = J.nonZeros();
+		m_values.resize( nnz );
+		for ( std::size_t k = 0; k < nnz; k++ )
+			m_values[ k ] = J.value( k );
+
+		bool bSame = m_nCols == J.size2() && m_rowStart.size() == J.size1() + 1 && m_columns.size() == nnz;
+		for ( std::size_t i = 0; bSame && i < J.size1(); i++ )
+			bSame = m_rowStart[ i ] == J.rowBegin( i );
+		for ( std::size_t k = 0; bSame && k < nnz; k++ )
+			bSame = m_columns[ k ] == J.column( k );
+		if ( !bSame )
+		{
+			m_nCols = J.size2();
+			m_rowStart.resize( J.size1() + 1 );
+			for ( std::size_t i = 0; i < J.size1(); i++ )
+				m_rowStart[ i ] = J.rowBegin( i );
+			m_rowStart[ J.size1() ] = nnz;
+			m_columns.resize( nnz );
+			for ( std::size_t k = 0; k < nnz; k++ )
+				m_columns[ k ] = J.column( k );
+		}
+		upload( !bSame );
+	}
+
+	/**
+	 * solves the system for the last jacobian.
+	 * @return the number of iterations
+	 */
+	template< typename T, class VT >
+	std::size_t solve( const T lambda, const VT& b, VT& x, const std::size_t maxIterations, const T tolerance )
+	{
+		m_b.resize( m_nCols );
+		m_x.resize( m_nCols );
+		for ( std::size_t j = 0; j < m_nCols; j++ )
+			m_b[ j ] = b( j );
+		const std::size_t iterations = solve( double( lambda ), m_b.empty() ? 0 : &m_b[ 0 ], m_x.empty() ? 0 : &m_x[ 0 ],
+			maxIterations, double( tolerance ) );
+		for ( std::size_t j = 0; j < m_nCols; j++ )
+			x( j ) = T( m_x[ j ] );
+		return iterations;
+	}
+
+	/** solves the system for the last jacobian, \c b and \c x have one element per column of J */
+	std::size_t solve( double lambda, const double* b, double* x, std::size_t maxIterations, double tolerance );
+
+protected:
+	/** copies the values and, if changed, the pattern to the device */
+	void upload( bool bPattern );
+
+	std::size_t m_nCols;
+	std::vector< std::size_t > m_rowStart;
+	std::vector< std::size_t > m_columns;
+	std::vector< double > m_values;
+	std::vector< double > m_b;
+	std::vector< double > m_x;
+
+	struct Impl;
+	boost::scoped_ptr< Impl > m_pImpl;
+};
+
+}}} // namespace Ubitrack::Math::Gpu
+
+#endif // __UBITRACK_MATH_GPU_BACKEND_H_INCLUDED__
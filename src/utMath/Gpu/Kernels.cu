@@ -0,0 +1,198 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * @internal
+ * CUDA kernels of the GPU backend, compiled with the CMake option \c ENABLE_CUDA
+ */
+
+#include <cuda_runtime.h>
+
+#include "Kernels.h"
+#include "Reprojection.h"
+
+namespace Ubitrack { namespace Math { namespace Gpu { namespace Detail {
+
+namespace {
+
+const unsigned blockSize = 256;
+
+inline unsigned gridSize( const unsigned n )
+{ return ( n + blockSize - 1 ) / blockSize; }
+
+__global__ void reprojectObservationsKernel( const unsigned n, const double* params, const unsigned pointOffset,
+	const unsigned* cameras, const unsigned* points, double* predicted, double* cameraJacobians, double* pointJacobians )
+{
+	const unsigned i = blockIdx.x * blockDim.x + threadIdx.x;
+	if ( i >= n )
+		return;
+
+	reprojectPoint( params + 7 * cameras[ i ], params + pointOffset + 3 * points[ i ],
+		predicted + 2 * i, cameraJacobians + 14 * i, pointJacobians + 6 * i );
+}
+
+__global__ void projectPointsKernel( const ProjectionMatrix projection, const double* points, const unsigned n, double* result )
+{
+	const unsigned i = blockIdx.x * blockDim.x + threadIdx.x;
+	if ( i < n )
+		projectPoint( projection.p, points + 3 * i, result + 2 * i );
+}
+
+__global__ void csrMultiplyKernel( const unsigned rows, const unsigned* rowStart, const unsigned* columns, const double* values,
+	const double* x, double* y )
+{
+	const unsigned i = blockIdx.x * blockDim.x + threadIdx.x;
+	if ( i >= rows )
+		return;
+
+	double sum = 0;
+	for ( unsigned k = rowStart[ i ]; k < rowStart[ i + 1 ]; k++ )
+		sum += values[ k ] * x[ columns[ k ] ];
+	y[ i ] = sum;
+}
+
+__global__ void gatherKernel( const unsigned n, const unsigned* index, const double* source, double* destination )
+{
+	const unsigned i = blockIdx.x * blockDim.x + threadIdx.x;
+	if ( i < n )
+		destination[ i ] = source[ index[ i ] ];
+}
+
+__global__ void inverseRowNormsKernel( const unsigned rows, const unsigned* rowStart, const double* values, const double lambda, double* result )
+{
+	const unsigned i = blockIdx.x * blockDim.x + threadIdx.x;
+	if ( i >= rows )
+		return;
+
+	double sum = lambda;
+	for ( unsigned k = rowStart[ i ]; k < rowStart[ i + 1 ]; k++ )
+		sum += values[ k ] * values[ k ];
+	result[ i ] = 1 / sum;
+}
+
+__global__ void axpyKernel( const unsigned n, const double a, const double* x, double* y )
+{
+	const unsigned i = blockIdx.x * blockDim.x + threadIdx.x;
+	if ( i < n )
+		y[ i ] += a * x[ i ];
+}
+
+__global__ void xpbyKernel( const unsigned n, const double* x, const double b, double* y )
+{
+	const unsigned i = blockIdx.x * blockDim.x + threadIdx.x;
+	if ( i < n )
+		y[ i ] = x[ i ] + b * y[ i ];
+}
+
+__global__ void multiplyElementsKernel( const unsigned n, const double* a, const double* b, double* c )
+{
+	const unsigned i = blockIdx.x * blockDim.x + threadIdx.x;
+	if ( i < n )
+		c[ i ] = a[ i ] * b[ i ];
+}
+
+/** each block sums a grid-strided part of the products and writes one partial sum */
+__global__ void dotPartialsKernel( const unsigned n, const double* x, const double* y, double* partials )
+{
+	__shared__ double cache[ blockSize ];
+
+	double sum = 0;
+	for ( unsigned i = blockIdx.x * blockDim.x + threadIdx.x; i < n; i += blockDim.x * gridDim.x )
+		sum += x[ i ] * y[ i ];
+	cache[ threadIdx.x ] = sum;
+	__syncthreads();
+
+	for ( unsigned s = blockDim.x / 2; s > 0; s /= 2 )
+	{
+		if ( threadIdx.x < s )
+			cache[ threadIdx.x ] += cache[ threadIdx.x + s ];
+		__syncthreads();
+	}
+
+	if ( threadIdx.x == 0 )
+		partials[ blockIdx.x ] = cache[ 0 ];
+}
+
+} // anonymous namespace
+
+
+void reprojectObservations( unsigned n, const double* params, unsigned pointOffset,
+	const unsigned* cameras, const unsigned* points, double* predicted, double* cameraJacobians, double* pointJacobians )
+{
+	if ( n )
+		reprojectObservationsKernel<<< gridSize( n ), blockSize >>>( n, params, pointOffset, cameras, points, predicted, cameraJacobians, pointJacobians );
+}
+
+void projectPoints( const ProjectionMatrix& projection, const double* points, unsigned n, double* result )
+{
+	if ( n )
+		projectPointsKernel<<< gridSize( n ), blockSize >>>( projection, points, n, result );
+}
+
+void csrMultiply( unsigned rows, const unsigned* rowStart, const unsigned* columns, const double* values,
+	const double* x, double* y )
+{
+	if ( rows )
+		csrMultiplyKernel<<< gridSize( rows ), blockSize >>>( rows, rowStart, columns, values, x, y );
+}
+
+void gather( unsigned n, const unsigned* index, const double* source, double* destination )
+{
+	if ( n )
+		gatherKernel<<< gridSize( n ), blockSize >>>( n, index, source, destination );
+}
+
+void inverseRowNorms( unsigned rows, const unsigned* rowStart, const double* values, double lambda, double* result )
+{
+	if ( rows )
+		inverseRowNormsKernel<<< gridSize( rows ), blockSize >>>( rows, rowStart, values, lambda, result );
+}
+
+void axpy( unsigned n, double a, const double* x, double* y )
+{
+	if ( n )
+		axpyKernel<<< gridSize( n ), blockSize >>>( n, a, x, y );
+}
+
+void xpby( unsigned n, const double* x, double b, double* y )
+{
+	if ( n )
+		xpbyKernel<<< gridSize( n ), blockSize >>>( n, x, b, y );
+}
+
+void multiplyElements( unsigned n, const double* a, const double* b, double* c )
+{
+	if ( n )
+		multiplyElementsKernel<<< gridSize( n ), blockSize >>>( n, a, b, c );
+}
+
+unsigned dotPartials( unsigned n, const double* x, const double* y, double* partials )
+{
+	const unsigned blocks = n == 0 ? 1 : ( gridSize( n ) < maxDotPartials ? gridSize( n ) : maxDotPartials );
+	dotPartialsKernel<<< blocks, blockSize >>>( n, x, y, partials );
+	return blocks;
+}
+
+}}}} // namespace Ubitrack::Math::Gpu::Detail
@@ -0,0 +1,84 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * @internal
+ * Launchers of the CUDA kernels of \c Backend.h, only available with \c HAVE_CUDA.
+ * All pointers are device pointers, the kernels run on the default stream.
+ */
+
+#ifndef __UBITRACK_MATH_GPU_KERNELS_H_INCLUDED__
+#define __UBITRACK_MATH_GPU_KERNELS_H_INCLUDED__
+
+#ifdef HAVE_CUDA
+
+namespace Ubitrack { namespace Math { namespace Gpu { namespace Detail {
+
+/** @internal row-major 3x4 matrix, passed to the kernel by value */
+struct ProjectionMatrix
+{
+	double p[ 12 ];
+};
+
+/** @internal maximum number of partial sums written by \c dotPartials */
+const unsigned maxDotPartials = 256;
+
+/** @internal evaluates \c Detail::reprojectPoint for n observations */
+void reprojectObservations( unsigned n, const double* params, unsigned pointOffset,
+	const unsigned* cameras, const unsigned* points, double* predicted, double* cameraJacobians, double* pointJacobians );
+
+/** @internal evaluates \c Detail::projectPoint for n points */
+void projectPoints( const ProjectionMatrix& projection, const double* points, unsigned n, double* result );
+
+/** @internal y = A x for a matrix in compressed row storage */
+void csrMultiply( unsigned rows, const unsigned* rowStart, const unsigned* columns, const double* values,
+	const double* x, double* y );
+
+/** @internal destination[ i ] = source[ index[ i ] ] */
+void gather( unsigned n, const unsigned* index, const double* source, double* destination );
+
+/** @internal inverse of the diagonal of A A^T + lambda I for a matrix A in compressed row storage */
+void inverseRowNorms( unsigned rows, const unsigned* rowStart, const double* values, double lambda, double* result );
+
+/** @internal y += a x */
+void axpy( unsigned n, double a, const double* x, double* y );
+
+/** @internal y = x + b y */
+void xpby( unsigned n, const double* x, double b, double* y );
+
+/** @internal c = a .* b */
+void multiplyElements( unsigned n, const double* a, const double* b, double* c );
+
+/**
+ * @internal partial sums of the inner product of x and y
+ * @return the number of partial sums, at most \c maxDotPartials
+ */
+unsigned dotPartials( unsigned n, const double* x, const double* y, double* partials );
+
+}}}} // namespace Ubitrack::Math::Gpu::Detail
+
+#endif // HAVE_CUDA
+
+#endif // __UBITRACK_MATH_GPU_KERNELS_H_INCLUDED__
@@ -0,0 +1,172 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Reprojection of bundle adjustment observations, shared by the host and the CUDA kernels
+ *
+ * The camera parameters are a quaternion ( x, y, z, w ) followed by the translation, as in
+ * the bundle adjustment of utAlgorithm. The predicted point is rotated like
+ * \c Pose::operator*, which assumes a unit quaternion, and the jacobians are those of
+ * the scaled rotation of the unnormalized quaternion, so the results are the same as on the
+ * host. The functions only use built-in types, so they compile with nvcc.
+ */
+
+#ifndef __UBITRACK_MATH_GPU_REPROJECTION_H_INCLUDED__
+#define __UBITRACK_MATH_GPU_REPROJECTION_H_INCLUDED__
+
+#ifdef __CUDACC__
+	#define UBITRACK_HOST_DEVICE __host__ __device__
+#else
+	#define UBITRACK_HOST_DEVICE
+#endif
+
+namespace Ubitrack { namespace Math { namespace Gpu { namespace Detail {
+
+/**
+ * @internal
+ * projects a 3D point into the normalized image plane of a camera and computes the jacobians
+ * wrt. the camera parameters and the point coordinates.
+ *
+ * @param camera the 7 camera parameters
+ * @param point the 3 point coordinates
+ * @param result 2 elements to store the projected point in
+ * @param jCamera row-major 2x7 matrix to store the jacobian wrt. the camera parameters in
+ * @param jPoint row-major 2x3 matrix to store the jacobian wrt. the point in
+ */
+template< typename T >
+UBITRACK_HOST_DEVICE inline void reprojectPoint( const T* camera, const T* point, T* result, T* jCamera, T* jPoint )
+{
+	const T qx = camera[ 0 ];
+	const T qy = camera[ 1 ];
+	const T qz = camera[ 2 ];
+	const T qw = camera[ 3 ];
+	const T tx = camera[ 4 ];
+	const T ty = camera[ 5 ];
+	const T tz = camera[ 6 ];
+
+	const T x = point[ 0 ];
+	const T y = point[ 1 ];
+	const T z = point[ 2 ];
+
+	const T t2 = qw*qw;
+	const T t3 = qx*qx;
+	const T t4 = qy*qy;
+	const T t5 = qz*qz;
+	const T t6 = qw*qy*2;
+	const T t7 = t2-t3-t4+t5;
+	const T t8 = t7*z;
+	const T t9 = qx*qz*2;
+	const T t10 = qw*qx*2;
+	const T t11 = qy*qz*2;
+	const T t12 = t10+t11;
+	const T t13 = t12*y;
+	const T t14 = t6-t9;
+	const T t23 = t14*x;
+	const T t15 = t8+t13-t23+tz;
+	const T t16 = t2+t3-t4-t5;
+	const T t17 = t16*x;
+	const T t18 = qw*qz*2;
+	const T t33 = qx*qy*2;
+	const T t19 = t18-t33;
+	const T t20 = t6+t9;
+	const T t21 = t20*z;
+	const T t34 = t19*y;
+	const T t22 = t17+t21-t34+tx;
+	const T t24 = 1/(t15*t15);
+	const T t25 = qz*x*2;
+	const T t26 = qw*y*2;
+	const T t43 = qx*z*2;
+	const T t27 = t25+t26-t43;
+	const T t28 = 1/t15;
+	const T t29 = qx*x*2;
+	const T t30 = qy*y*2;
+	const T t31 = qz*z*2;
+	const T t32 = t29+t30+t31;
+	const T t35 = qw*x*2;
+	const T t36 = qy*z*2;
+	const T t44 = qz*y*2;
+	const T t37 = t35+t36-t44;
+	const T t38 = qx*y*2;
+	const T t39 = qw*z*2;
+	const T t41 = qy*x*2;
+	const T t40 = t38+t39-t41;
+	const T t42 = t28*t40;
+	const T t45 = t2-t3+t4-t5;
+	const T t46 = t45*y;
+	const T t47 = t18+t33;
+	const T t48 = t47*x;
+	const T t49 = t10-t11;
+	const T t52 = t49*z;
+	const T t50 = t46+t48-t52+ty;
+	const T t51 = t28*t37;
+
+	const T cx = 2*(qy*z-qz*y);
+	const T cy = 2*(qz*x-qx*z);
+	const T cz = 2*(qx*y-qy*x);
+	const T rx = x + qw*cx + (qy*cz-qz*cy) + tx;
+	const T ry = y + qw*cy + (qz*cx-qx*cz) + ty;
+	const T rz = z + qw*cz + (qx*cy-qy*cx) + tz;
+	result[ 0 ] = rx / rz;
+	result[ 1 ] = ry / rz;
+
+	jCamera[ 0 ] = t28*t32-t22*t24*t27;
+	jCamera[ 1 ] = t42+t22*t24*t37;
+	jCamera[ 2 ] = -t27*t28-t22*t24*t32;
+	jCamera[ 3 ] = t51-t22*t24*t40;
+	jCamera[ 4 ] = t28;
+	jCamera[ 5 ] = 0;
+	jCamera[ 6 ] = -t22*t24;
+	jCamera[ 7 ] = -t42-t24*t27*t50;
+	jCamera[ 8 ] = t28*t32+t24*t37*t50;
+	jCamera[ 9 ] = t51-t24*t32*t50;
+	jCamera[ 10 ] = t27*t28-t24*t40*t50;
+	jCamera[ 11 ] = 0;
+	jCamera[ 12 ] = t28;
+	jCamera[ 13 ] = -t24*t50;
+
+	jPoint[ 0 ] = t16*t28+t14*t22*t24;
+	jPoint[ 1 ] = -t19*t28-t12*t22*t24;
+	jPoint[ 2 ] = t20*t28-t7*t22*t24;
+	jPoint[ 3 ] = t28*t47+t14*t24*t50;
+	jPoint[ 4 ] = t28*t45-t12*t24*t50;
+	jPoint[ 5 ] = -t28*t49-t7*t24*t50;
+}
+
+/**
+ * @internal
+ * projects a 3D point with a row-major 3x4 projection matrix
+ */
+template< typename T >
+UBITRACK_HOST_DEVICE inline void projectPoint( const T* projection, const T* point, T* result )
+{
+	const T* p = projection;
+	const T w = p[ 8 ] * point[ 0 ] + p[ 9 ] * point[ 1 ] + p[ 10 ] * point[ 2 ] + p[ 11 ];
+	result[ 0 ] = ( p[ 0 ] * point[ 0 ] + p[ 1 ] * point[ 1 ] + p[ 2 ] * point[ 2 ] + p[ 3 ] ) / w;
+	result[ 1 ] = ( p[ 4 ] * point[ 0 ] + p[ 5 ] * point[ 1 ] + p[ 6 ] * point[ 2 ] + p[ 7 ] ) / w;
+}
+
+}}}} // namespace Ubitrack::Math::Gpu::Detail
+
+#endif // __UBITRACK_MATH_GPU_REPROJECTION_H_INCLUDED__
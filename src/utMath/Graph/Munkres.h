@@ -26,8 +26,8 @@
  * @ingroup math graph
  * @file
  * Munkres class
- * This file contains the Munkres class for using the
- * Munkres' Assignment Algorithm (sometimes referred to as the Hungarian Algorithm)
+ * This file contains the Munkres class for solving the linear assignment problem,
+ * also known as Munkres' Assignment Algorithm or Hungarian Algorithm.
  *
  * You use a matrix which should be solved
  *
@@ -42,468 +42,467 @@
 #include <utCore.h>
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
-#include <list>
 #include <vector>
-
-#include <boost/numeric/ublas/matrix_proxy.hpp>
-
-#define Z_NORMAL 0
-#define Z_STAR 1
-#define Z_PRIME 2
+#include <limits>
+#include <algorithm>
 
 namespace Ubitrack { namespace Math { namespace Graph {
 
 /**
- * @ingroup math
- * The actual Munkres class
- * to solve various problems using the Hungarian Algorithm
- * @param T type of vector/matrix elements 
- * @param N dimension of the vectors (2 or 3)
+ * Computes the assignment of rows to columns with minimal total cost.
+ *
+ * The solver uses shortest augmenting paths with row and column potentials, as in the
+ * algorithm of Jonker and Volgenant, in O(n^2 m) for n <= m. Rectangular matrices are solved
+ * directly (transposed internally if there are more rows than columns), so every element of the
+ * smaller dimension is assigned. Pairs can be excluded by a maximum cost or by giving only the
+ * allowed pairs as a sparse matrix. The result then assigns as many rows as possible with allowed
+ * pairs, with minimal cost among these assignments, and the other rows stay unassigned.
+ *
+ * All buffers are members and keep their capacity, so an instance that is reused every frame
+ * does not allocate once the largest problem has been seen. \c solve( initialRowMatch ) starts from
+ * a given assignment, e.g. the one of the previous frame. Pairs of the initial assignment that are
+ * tight under the initial potentials are kept, which resolves rows competing for the same cheapest
+ * column without a search, and only the remaining rows are augmented. The result is optimal in any case.
+ *
+ * @code
+ * Munkres< double > munkres;
+ * for each frame:
+ *   munkres.setMatrix( costs, maxCost );
+ *   munkres.solve( matches );
+ *   matches = munkres.getRowMatchList();
+ * @endcode
  */
 template< typename T >
 class Munkres {
 
 public:
+	/** value of unassigned rows and columns in the match lists */
+	static const std::size_t unassigned = static_cast< std::size_t >( -1 );
+
+	/** an allowed pair of a sparse cost matrix */
+	struct Entry
+	{
+		Entry()
+		{}
+
+		Entry( std::size_t r, std::size_t c, T v )
+			: row( r )
+			, col( c )
+			, cost( v )
+		{}
+
+		std::size_t row;
+		std::size_t col;
+		T cost;
+	};
 
 	/** Default constructor */
 	Munkres();
 
 	/** Constructor directly using a matrix which should be solved */
-	Munkres( Math::Matrix< T, 0, 0 > & matrix);
+	Munkres( const Math::Matrix< T, 0, 0 > & matrix );
 
 	/** this function must be called AFTER the input data was set*/
 	void solve();
 
+	/**
+	 * solves starting from an initial assignment, see the class description
+	 * @param initialRowMatch column of every row, or \c unassigned. May have a different size than the matrix.
+	 */
+	void solve( const std::vector< std::size_t >& initialRowMatch );
+
 	/**
 	 * sets the input data
+	 * @param matrix the matrix to be solved, rows are assigned to columns
+	 */
+	void setMatrix( const Math::Matrix< T, 0, 0 > & matrix );
+
+	/**
+	 * sets the input data, pairs with a cost larger than \c maxCost are never assigned
 	 * @param matrix the matrix to be solved
+	 * @param maxCost maximum cost of an assigned pair
+	 */
+	void setMatrix( const Math::Matrix< T, 0, 0 > & matrix, T maxCost );
+
+	/**
+	 * sets the input data as the list of allowed pairs, all other pairs are never assigned
+	 * @param nRows number of rows
+	 * @param nCols number of columns
+	 * @param entries the allowed pairs with their costs, each pair at most once
 	 */
-	void setMatrix( Math::Matrix< T, 0, 0 > & matrix );
+	void setSparseMatrix( std::size_t nRows, std::size_t nCols, const std::vector< Entry >& entries );
 
 	/**
 	 * returns the result as a masked Matrix
 	 * @return every 1 in the matrix represents a match
 	 */
-	Math::Matrix< T, 0, 0 >  getMaskMatrix();
+	Math::Matrix< T, 0, 0 >  getMaskMatrix() const;
 
 	/**
 	 * returns the result as a ordered list of matches
 	 * the order is corresponding to the old points ( rows )
 	 *
-	 * @return match list of columns to rows
+	 * @return for every row the matched column, or \c unassigned
 	 */
-	std::vector< std::size_t > getRowMatchList();
+	std::vector< std::size_t > getRowMatchList() const;
 
 	/**
 	 * returns the result as a ordered list of matches
 	 * the order is corresponding to the current points ( columns )
 	 *
-	 * @return match list of columns to rows
+	 * @return for every column the matched row, or \c unassigned
 	 */
-	std::vector< std::size_t > getColMatchList();
+	std::vector< std::size_t > getColMatchList() const;
+
+	/** returns the total cost of the assignment */
+	T getCost() const;
 
 private:
-	inline bool find_uncovered_in_matrix( T item , std::size_t & row, std::size_t & col );
-	inline bool pair_in_list( const std::pair<int,int> & needle, const std::list< std::pair< int, int > > & haystack );
-	int step1();
-	int step2();
-	int step3();
-	int step4();
-	int step5();
-	int step6();
-	boost::numeric::ublas::matrix< int > mask_matrix;
-	Math::Matrix< T, 0, 0 > m_matrix;
-	bool *row_mask;
-	bool *col_mask;
-	std::size_t saverow, savecol;
-	std::size_t m_max;
+	/** allocates the buffers for a problem of the given size */
+	void resize( std::size_t nRows, std::size_t nCols );
+
+	/** cost and allowed flag of a pair in internal orientation */
+	T& cost( std::size_t i, std::size_t j )
+	{ return m_costs[ i * m_nCols + j ]; }
+
+	const T& cost( std::size_t i, std::size_t j ) const
+	{ return m_costs[ i * m_nCols + j ]; }
+
+	bool allowed( std::size_t i, std::size_t j ) const
+	{ return m_allowed[ i * m_nCols + j ] != 0; }
+
+	/** initializes potentials and a partial assignment of tight pairs */
+	void initialize( const std::vector< std::size_t >* pInitialRowMatch );
+
+	/** assigns the free row \c i0 by a shortest augmenting path */
+	void augment( std::size_t i0 );
+
+	/** solves with an optional initial assignment */
+	void solve( const std::vector< std::size_t >* pInitialRowMatch );
+
+	/** size of the matrix as given by the user */
+	std::size_t m_nUserRows;
+	std::size_t m_nUserCols;
+
+	/** internally rows are the smaller dimension, is the user matrix transposed? */
+	bool m_bTransposed;
+	std::size_t m_nRows;
+	std::size_t m_nCols;
+
+	/** costs and allowed pairs in internal orientation, row-major */
+	std::vector< T > m_costs;
+	std::vector< char > m_allowed;
+
+	/** are there pairs that must not be assigned? */
+	bool m_bGated;
+
+	/** potentials of internal rows and columns */
+	std::vector< T > m_u;
+	std::vector< T > m_v;
+
+	/** assignment in internal orientation */
+	std::vector< std::size_t > m_rowMatch;
+	std::vector< std::size_t > m_colMatch;
+
+	/** buffers of the shortest path search */
+	std::vector< T > m_minv;
+	std::vector< std::size_t > m_way;
+	std::vector< char > m_used;
+	std::vector< std::size_t > m_usedList;
 };
 
-/** internal */
+template< typename T >
+const std::size_t Munkres< T >::unassigned;
+
 template< typename T >
 Munkres< T >::Munkres()
-	: saverow( 0 )
-	, savecol( 0 )
+	: m_nUserRows( 0 )
+	, m_nUserCols( 0 )
+	, m_bTransposed( false )
+	, m_nRows( 0 )
+	, m_nCols( 0 )
+	, m_bGated( false )
 {
-	
 }
 
 template< typename T >
-Munkres< T >::Munkres( Math::Matrix< T, 0, 0 > & matrix)
-{	
-	saverow = 0; 
-	savecol = 0;
+Munkres< T >::Munkres( const Math::Matrix< T, 0, 0 > & matrix )
+	: m_nUserRows( 0 )
+	, m_nUserCols( 0 )
+	, m_bTransposed( false )
+	, m_nRows( 0 )
+	, m_nCols( 0 )
+	, m_bGated( false )
+{
 	setMatrix( matrix );
 }
 
 template< typename T >
-bool Munkres< T >::find_uncovered_in_matrix(T item, std::size_t & row, std::size_t & col) {
-	for ( std::size_t row( 0 ) ; row < m_max ; ++row )
-		if ( !row_mask[row] )
-			for ( std::size_t col( 0 ) ; col < m_max ; ++col )
-				if ( !col_mask[col] )
-					if ( m_matrix( row, col ) == item )
-						return true;
-
-	return false;
-}
-
-template< typename T >
-bool Munkres< T >::pair_in_list(const std::pair<int,int> &needle, const std::list<std::pair<int,int> > &haystack) {
-	for ( std::list<std::pair<int,int> >::const_iterator i = haystack.begin() ; i != haystack.end() ; i++ ) {
-		if ( needle == *i )
-			return true;
-	}
-	
-	return false;
-}
-
-template< typename T >
-int Munkres< T >::step1() 
+void Munkres< T >::resize( const std::size_t nRows, const std::size_t nCols )
 {
-	for ( std::size_t row( 0 ) ; row < m_max ; ++row )
-		for ( std::size_t col( 0 ) ; col < m_max ; ++col )
-			if ( m_matrix( row, col ) == 0 ) 
-			{
-				bool isstarred = false;
-				for ( std::size_t nrow( 0 ) ; nrow < m_max ; ++nrow )
-					if ( mask_matrix( nrow, col ) == Z_STAR )
-						isstarred = true;
-
-				if ( !isstarred ) 
-				{
-					for ( std::size_t ncol( 0 ) ; ncol < m_max ; ++ncol )
-						if ( mask_matrix( row, ncol ) == Z_STAR )
-							isstarred = true;
-				}
-							
-				if ( !isstarred ) 
-				{
-					mask_matrix( row, col ) = Z_STAR;
-				}
-			}
-
-	return 2;
+	m_nUserRows = nRows;
+	m_nUserCols = nCols;
+	m_bTransposed = nRows > nCols;
+	m_nRows = m_bTransposed ? nCols : nRows;
+	m_nCols = m_bTransposed ? nRows : nCols;
+
+	m_costs.resize( m_nRows * m_nCols );
+	m_allowed.assign( m_nRows * m_nCols, 0 );
+	m_bGated = false;
+	m_rowMatch.assign( m_nRows, unassigned );
+	m_colMatch.assign( m_nCols, unassigned );
 }
 
 template< typename T >
-int Munkres< T >::step2() 
+void Munkres< T >::setMatrix( const Math::Matrix< T, 0, 0 > & matrix )
 {
-	std::size_t covercount = 0;
-	for ( std::size_t row( 0 ) ; row < m_max ; ++row )
-		for ( std::size_t col( 0 ) ; col < m_max ; ++col )
-			if ( mask_matrix( row, col ) == Z_STAR ) 
-			{
-				col_mask[col] = true;
-				covercount++;
-			}
-			
-	if ( covercount >= m_max )
-		return 0;
-	else return 3;
+	setMatrix( matrix, std::numeric_limits< T >::max() );
 }
 
 template< typename T >
-int Munkres< T >::step3() 
+void Munkres< T >::setMatrix( const Math::Matrix< T, 0, 0 > & matrix, const T maxCost )
 {
-	/*
-	Main Zero Search
-
-   1. Find an uncovered Z in the distance matrix and prime it. If no such zero exists, go to Step 5
-   2. If No Z* exists in the row of the Z', go to Step 4.
-   3. If a Z* exists, cover this row and uncover the column of the Z*. Return to Step 3.1 to find a new Z
-	*/
-	if ( find_uncovered_in_matrix( 0, saverow, savecol ) ) 
-		mask_matrix( saverow, savecol ) = Z_PRIME; // prime it.
-	else return 5;
-
-	for ( std::size_t ncol( 0 ) ; ncol < m_max ; ++ncol )
-		if ( mask_matrix( saverow, ncol ) == Z_STAR )
+	resize( matrix.size1(), matrix.size2() );
+	for ( std::size_t row( 0 ); row < matrix.size1(); ++row )
+		for ( std::size_t col( 0 ); col < matrix.size2(); ++col )
 		{
-			row_mask[saverow] = true; //cover this row and
-			col_mask[ncol] = false; // uncover the column containing the starred zero
-			return 3; // repeat
+			const std::size_t i = m_bTransposed ? col : row;
+			const std::size_t j = m_bTransposed ? row : col;
+			cost( i, j ) = matrix( row, col );
+			m_allowed[ i * m_nCols + j ] = matrix( row, col ) <= maxCost;
+			m_bGated = m_bGated || !( matrix( row, col ) <= maxCost );
 		}
-
-	return 4; // no starred zero in the row containing this primed zero
 }
 
 template< typename T >
-int Munkres< T >::step4() 
+void Munkres< T >::setSparseMatrix( const std::size_t nRows, const std::size_t nCols, const std::vector< Entry >& entries )
 {
-	std::list<std::pair<int,int> > seq;
-	// use saverow, savecol from step 3.
-	std::pair<int,int> z0( static_cast< int >( saverow ), static_cast< int >( savecol ) );
-	std::pair<int,int> z1(-1,-1);
-	std::pair<int,int> z2n(-1,-1);
-	seq.insert(seq.end(), z0);
-	std::size_t row, col = savecol;
-	/*
-	Increment Set of Starred Zeros
-
-   1. Construct the ``alternating sequence'' of primed and starred zeros:
-
-         Z0 : Unpaired Z' from Step 4.2 
-         Z1 : The Z* in the column of Z0
-         Z[2N] : The Z' in the row of Z[2N-1], if such a zero exists 
-         Z[2N+1] : The Z* in the column of Z[2N]
-
-      The sequence eventually terminates with an unpaired Z' = Z[2N] for some N.
-	*/
-	bool madepair;
-	do {
-		madepair = false;
-		for ( row = 0; row < m_max ; ++row )
-			if ( mask_matrix(row,col) == Z_STAR ) {
-				z1.first = static_cast< int >( row );
-				z1.second = static_cast< int >( col );
-				if ( pair_in_list(z1, seq) )
-					continue;
-				
-				madepair = true;
-				seq.insert(seq.end(), z1);
-				break;
-			}
-
-		if ( !madepair )
-			break;
-
-		madepair = false;
-
-		for ( col = 0; col < m_max ; ++col )
-			if ( mask_matrix(row,col) == Z_PRIME ) {
-				z2n.first = static_cast< int >( row );
-				z2n.second = static_cast< int >( col );
-				if ( pair_in_list(z2n, seq) )
-					continue;
-				madepair = true;
-				seq.insert(seq.end(), z2n);
-				break;
-			}
-	} while ( madepair );
-
-	for ( std::list<std::pair<int,int> >::iterator i = seq.begin() ;
-		  i != seq.end() ;
-		  i++ ) {
-		// 2. Unstar each starred zero of the sequence.
-		if ( mask_matrix(i->first,i->second) == Z_STAR )
-			mask_matrix(i->first,i->second) = Z_NORMAL;
-
-		// 3. Star each primed zero of the sequence,
-		// thus increasing the number of starred zeros by one.
-		if ( mask_matrix(i->first,i->second) == Z_PRIME )
-			mask_matrix(i->first,i->second) = Z_STAR;
-	}
-
-	// 4. Erase all primes, uncover all columns and rows, 
-	for ( std::size_t row( 0 ); row < m_max ; ++row )
-		for ( std::size_t col( 0 ); col < m_max ; ++col )
-			if ( mask_matrix(row,col) == Z_PRIME )
-				mask_matrix(row,col) = Z_NORMAL;
-	
-	for ( std::size_t i( 0 ) ; i < m_max ; ++i ) {
-		row_mask[i] = false;
-	}
-
-	for ( std::size_t i( 0 ); i < m_max ; ++i ) {
-		col_mask[i] = false;
+	resize( nRows, nCols );
+	for ( std::size_t k( 0 ); k < entries.size(); ++k )
+	{
+		const std::size_t i = m_bTransposed ? entries[ k ].col : entries[ k ].row;
+		const std::size_t j = m_bTransposed ? entries[ k ].row : entries[ k ].col;
+		cost( i, j ) = entries[ k ].cost;
+		m_allowed[ i * m_nCols + j ] = 1;
 	}
-
-	// and return to Step 2. 
-	return 2;
+	m_bGated = entries.size() < m_nRows * m_nCols;
 }
 
 template< typename T >
-int Munkres< T >::step5() 
+void Munkres< T >::initialize( const std::vector< std::size_t >* pInitialRowMatch )
 {
-	/*
-	New Zero Manufactures
-
-   1. Let h be the smallest uncovered entry in the (modified) distance matrix.
-   2. Add h to all covered rows.
-   3. Subtract h from all uncovered columns
-   4. Return to Step 3, without altering stars, primes, or covers. 
-	*/
-	T h = 0;
-	for ( std::size_t row( 0 ); row < m_max ; ++row )
+	m_u.assign( m_nRows, T( 0 ) );
+	m_v.assign( m_nCols, T( 0 ) );
+	m_rowMatch.assign( m_nRows, unassigned );
+	m_colMatch.assign( m_nCols, unassigned );
+	if ( m_nRows == 0 )
+		return;
+
+	// Excluded pairs get a cost that is larger than the difference of any two assignments of
+	// allowed pairs. Then an optimal assignment has as few excluded pairs as possible and is
+	// optimal for the allowed pairs, the excluded ones are removed after the solve.
+	if ( m_bGated )
 	{
-		if ( !row_mask[row] ) 
-		{
-			for ( std::size_t col( 0 ) ; col < m_max ; ++col )
+		bool bFirst = true;
+		T minCost( 0 );
+		T maxCost( 0 );
+		for ( std::size_t k( 0 ); k < m_costs.size(); ++k )
+			if ( m_allowed[ k ] )
 			{
-				if ( !col_mask[col] ) 
-				{
-					if ( (h > m_matrix( row, col ) && m_matrix( row, col ) != 0) || h == 0 )
-						h = m_matrix( row, col );
-				}
+				minCost = bFirst ? m_costs[ k ] : std::min( minCost, m_costs[ k ] );
+				maxCost = bFirst ? m_costs[ k ] : std::max( maxCost, m_costs[ k ] );
+				bFirst = false;
 			}
-		}
+		const T excludedCost = maxCost + static_cast< T >( m_nRows ) * ( maxCost - minCost ) + T( 1 );
+		for ( std::size_t k( 0 ); k < m_costs.size(); ++k )
+			if ( !m_allowed[ k ] )
+				m_costs[ k ] = excludedCost;
 	}
 
-	for ( std::size_t row( 0 ) ; row < m_max ; ++row )
-		for ( std::size_t col( 0 ) ; col < m_max ; ++col ) 
+	// The potentials must be feasible, c( i, j ) - u( i ) - v( j ) >= 0. Columns that stay
+	// unassigned need the largest column potential for the result to be optimal, so the
+	// columns are only reduced if all of them will be assigned.
+	if ( m_nRows == m_nCols )
+		for ( std::size_t j( 0 ); j < m_nCols; ++j )
 		{
-			if ( row_mask[row] )
-				m_matrix( row, col ) += h;
+			T minCost = cost( 0, j );
+			for ( std::size_t i( 1 ); i < m_nRows; ++i )
+				minCost = std::min( minCost, cost( i, j ) );
+			m_v[ j ] = minCost;
+		}
+	for ( std::size_t i( 0 ); i < m_nRows; ++i )
+	{
+		T minCost = cost( i, 0 ) - m_v[ 0 ];
+		for ( std::size_t j( 1 ); j < m_nCols; ++j )
+			minCost = std::min( minCost, cost( i, j ) - m_v[ j ] );
+		m_u[ i ] = minCost;
+	}
 
-			if ( !col_mask[col] )
-				m_matrix( row, col ) -= h;
+	// keep the pairs of the initial assignment that are tight
+	if ( pInitialRowMatch )
+		for ( std::size_t row( 0 ); row < std::min( pInitialRowMatch->size(), m_nUserRows ); ++row )
+		{
+			const std::size_t col = ( *pInitialRowMatch )[ row ];
+			if ( col >= m_nUserCols )
+				continue;
+			const std::size_t i = m_bTransposed ? col : row;
+			const std::size_t j = m_bTransposed ? row : col;
+			if ( m_rowMatch[ i ] == unassigned && m_colMatch[ j ] == unassigned && cost( i, j ) - m_v[ j ] <= m_u[ i ] )
+			{
+				m_rowMatch[ i ] = j;
+				m_colMatch[ j ] = i;
+			}
 		}
 
-	return 3;
+	// greedy assignment of the remaining tight pairs
+	for ( std::size_t i( 0 ); i < m_nRows; ++i )
+	{
+		if ( m_rowMatch[ i ] != unassigned )
+			continue;
+		for ( std::size_t j( 0 ); j < m_nCols; ++j )
+			if ( m_colMatch[ j ] == unassigned && cost( i, j ) - m_v[ j ] <= m_u[ i ] )
+			{
+				m_rowMatch[ i ] = j;
+				m_colMatch[ j ] = i;
+				break;
+			}
+	}
 }
 
 template< typename T >
-void Munkres< T >::setMatrix( Math::Matrix< T, 0, 0 > & matrix )
+void Munkres< T >::augment( const std::size_t i0 )
 {
-	//find maximum matrix value vMax
-	T vMax = static_cast< T >( 0 );
-	for( std::size_t row( 0 ); row < matrix.size1(); ++row )
+	const T inf = std::numeric_limits< T >::max();
+	m_minv.assign( m_nCols, inf );
+	m_way.assign( m_nCols, unassigned );
+	m_used.assign( m_nCols, 0 );
+	m_usedList.clear();
+
+	// dijkstra on the reduced costs, the potentials are updated on the way
+	std::size_t i = i0;
+	std::size_t jPrev = unassigned;
+	while ( true )
 	{
-		for( std::size_t col( 0 ); col < matrix.size2(); ++col )
+		for ( std::size_t j( 0 ); j < m_nCols; ++j )
 		{
-			if( matrix( row, col ) > vMax )
-				vMax = matrix( row, col );
+			if ( m_used[ j ] )
+				continue;
+			const T reduced = cost( i, j ) - m_u[ i ] - m_v[ j ];
+			if ( reduced < m_minv[ j ] )
+			{
+				m_minv[ j ] = reduced;
+				m_way[ j ] = jPrev;
+			}
 		}
-	}
-
-	//create a M x M matrix
-	if ( matrix.size1() == matrix.size2() )
-	{
-		m_matrix = matrix;
-	}
-	else if ( matrix.size1() > matrix.size2() )
-	{
-		m_matrix.resize( matrix.size1(), matrix.size1() );
-		boost::numeric::ublas::subrange( m_matrix, 0, matrix.size1(), 0, matrix.size2() ) = matrix;
-		boost::numeric::ublas::subrange( m_matrix, 0, matrix.size1(), matrix.size2(), matrix.size1() - matrix.size2() ) = 
-			boost::numeric::ublas::scalar_matrix< T >( matrix.size1(), matrix.size1() - matrix.size2(), vMax );
-	}
-	else
-	{
-		m_matrix.resize( matrix.size2(), matrix.size2(), false );
-		boost::numeric::ublas::subrange( m_matrix, 0, matrix.size1(), 0, matrix.size2() ) = matrix;
-		boost::numeric::ublas::subrange( m_matrix, matrix.size1(), matrix.size2() - matrix.size1(), 0, matrix.size2() ) = 
-			boost::numeric::ublas::scalar_matrix< T >( matrix.size2() - matrix.size1(), matrix.size2(), vMax );
-	}
 
-	m_max = m_matrix.size1();
+		std::size_t jNext = unassigned;
+		T delta = inf;
+		for ( std::size_t j( 0 ); j < m_nCols; ++j )
+			if ( !m_used[ j ] && m_minv[ j ] < delta )
+			{
+				delta = m_minv[ j ];
+				jNext = j;
+			}
+		if ( jNext == unassigned )
+			return;	// only with NaN costs
 
-	//create a zero in every row
-	T min = vMax;	
-	for( std::size_t row( 0 ); row<m_max; ++row )
-	{
-		for( std::size_t col( 0 ); col<m_max; ++col )
+		m_u[ i0 ] += delta;
+		for ( std::size_t k( 0 ); k < m_usedList.size(); ++k )
 		{
-			if( m_matrix( row, col ) < min )
-				min = m_matrix( row, col );
+			m_u[ m_colMatch[ m_usedList[ k ] ] ] += delta;
+			m_v[ m_usedList[ k ] ] -= delta;
 		}
-		for( std::size_t col( 0 ); col<m_max; ++col )
+		for ( std::size_t j( 0 ); j < m_nCols; ++j )
+			if ( !m_used[ j ] )
+				m_minv[ j ] -= delta;
+
+		m_used[ jNext ] = 1;
+		m_usedList.push_back( jNext );
+		if ( m_colMatch[ jNext ] == unassigned )
 		{
-			m_matrix( row, col ) = m_matrix( row, col ) - min;
+			// flip the path
+			for ( std::size_t j = jNext; j != unassigned; )
+			{
+				const std::size_t jBack = m_way[ j ];
+				const std::size_t iNew = jBack == unassigned ? i0 : m_colMatch[ jBack ];
+				m_colMatch[ j ] = iNew;
+				m_rowMatch[ iNew ] = j;
+				j = jBack;
+			}
+			return;
 		}
-		min = vMax;
-	}	
-
-	//initialize mask matrix
-	mask_matrix = boost::numeric::ublas::scalar_matrix< int >( m_matrix.size1(), m_matrix.size1(), Z_NORMAL );
+		i = m_colMatch[ jNext ];
+		jPrev = jNext;
+	}
 }
 
 template< typename T >
-void Munkres< T >::solve()
+void Munkres< T >::solve( const std::vector< std::size_t >* pInitialRowMatch )
 {
-	bool notdone( true );
-	int step ( 1 );
-
-	// Z_STAR == 1 == starred, Z_PRIME == 2 == primed
-	row_mask = new bool[m_max];
-	col_mask = new bool[m_max];
-	for ( std::size_t i( 0 ) ; i < m_max ; ++i ) 
-	{
-		row_mask[i] = false;
-		col_mask[i] = false;
-	}
-
-	while ( notdone ) 
-	{
-		switch ( step ) 
+	initialize( pInitialRowMatch );
+	for ( std::size_t i( 0 ); i < m_nRows; ++i )
+		if ( m_rowMatch[ i ] == unassigned )
+			augment( i );
+
+	// remove the excluded pairs
+	for ( std::size_t i( 0 ); i < m_nRows; ++i )
+		if ( m_rowMatch[ i ] != unassigned && !allowed( i, m_rowMatch[ i ] ) )
 		{
-			case 0:
-				notdone = false;
-				break;
-			case 1:
-				step = step1();
-				break;
-			case 2:
-				step = step2();
-				break;
-			case 3:
-				step = step3();
-				break;
-			case 4:
-				step = step4();
-				break;
-			case 5:
-				step = step5();
-				break;
+			m_colMatch[ m_rowMatch[ i ] ] = unassigned;
+			m_rowMatch[ i ] = unassigned;
 		}
-	}
 }
 
 template< typename T >
-Math::Matrix< T, 0, 0 >  Munkres< T >::getMaskMatrix()
+void Munkres< T >::solve()
 {
-	return mask_matrix;
+	solve( 0 );
 }
 
 template< typename T >
-std::vector< std::size_t > Munkres< T >::getRowMatchList()
+void Munkres< T >::solve( const std::vector< std::size_t >& initialRowMatch )
 {
-	std::vector< std::size_t > list;
-	bool found( false );
-	std::size_t col( 0 );
+	solve( &initialRowMatch );
+}
 
-	for( std::size_t row( 0 ); row<m_max; ++row )
-	{
-		while( !found && col < m_max)
+template< typename T >
+Math::Matrix< T, 0, 0 >  Munkres< T >::getMaskMatrix() const
+{
+	Math::Matrix< T, 0, 0 > mask( m_nUserRows, m_nUserCols );
+	for ( std::size_t row( 0 ); row < m_nUserRows; ++row )
+		for ( std::size_t col( 0 ); col < m_nUserCols; ++col )
+			mask( row, col ) = 0;
+	for ( std::size_t i( 0 ); i < m_nRows; ++i )
+		if ( m_rowMatch[ i ] != unassigned )
 		{
-			if( mask_matrix( row, col ) == Z_STAR )
-			{
-				list.push_back( col );
-				found = true;
-			}
-			++col;
+			if ( m_bTransposed )
+				mask( m_rowMatch[ i ], i ) = 1;
+			else
+				mask( i, m_rowMatch[ i ] ) = 1;
 		}
-		found = false;
-		col = 0;
-	}
-
-	return list;
+	return mask;
 }
 
 template< typename T >
-std::vector< std::size_t > Munkres< T >::getColMatchList()
+std::vector< std::size_t > Munkres< T >::getRowMatchList() const
 {
-	std::vector< std::size_t > list;
-	bool found ( false );
-	std::size_t row ( 0 );
+	return m_bTransposed ? m_colMatch : m_rowMatch;
+}
 
-	for( std::size_t col( 0 ); col<m_max; ++col )
-	{
-		while( !found && row < m_max)
-		{
-			if( mask_matrix( row, col ) == Z_STAR )
-			{
-				list.push_back( row );
-				found = true;
-			}
-			++row;
-		}
-		found = false;
-		row = 0;
-	}
+template< typename T >
+std::vector< std::size_t > Munkres< T >::getColMatchList() const
+{
+	return m_bTransposed ? m_rowMatch : m_colMatch;
+}
 
-	return list;
+template< typename T >
+T Munkres< T >::getCost() const
+{
+	T sum( 0 );
+	for ( std::size_t i( 0 ); i < m_nRows; ++i )
+		if ( m_rowMatch[ i ] != unassigned )
+			sum += cost( i, m_rowMatch[ i ] );
+	return sum;
 }
 
 }}} // namespace Ubitrack::math::Graph
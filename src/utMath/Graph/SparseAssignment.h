@@ -0,0 +1,286 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math graph
+ * @file
+ * Assignment problems given by a sparse list of allowed pairs.
+ */
+#ifndef __UBITRACK_MATH_GRAPH_SPARSE_ASSIGNMENT_H_INCLUDED__
+#define __UBITRACK_MATH_GRAPH_SPARSE_ASSIGNMENT_H_INCLUDED__
+
+#include <vector>
+
+#include <boost/bind.hpp>
+
+#include <utMath/PoseListOperations.h>	// ListExecutor
+#include "Munkres.h"
+
+namespace Ubitrack { namespace Math { namespace Graph {
+
+/**
+ * Solves an assignment problem that is given as the list of allowed (row, column, cost) pairs,
+ * e.g. the target-detection pairs that pass a gating test.
+ *
+ * Rows and columns that are connected by allowed pairs form connected components, which are
+ * found by a union-find over the pairs in nearly linear time. An optimal assignment consists of
+ * optimal assignments of the components, so each component is solved on its own by \c Munkres with
+ * the size of the component instead of the full problem, and components with a single pair are
+ * assigned directly. The components can be distributed over threads by a \c Math::ListExecutor.
+ *
+ * Like \c Munkres with gating, the result assigns as many rows as possible, with minimal cost
+ * among these assignments. The buffers are kept between calls.
+ *
+ * @code
+ * SparseAssignment< double > assignment;
+ * assignment.solve( nTargets, nDetections, gatedPairs );
+ * const std::vector< std::size_t >& matches( assignment.getRowMatchList() );
+ * @endcode
+ */
+template< typename T >
+class SparseAssignment
+{
+public:
+	/** an allowed pair */
+	typedef typename Munkres< T >::Entry Entry;
+
+	/** value of unassigned rows and columns in the match lists */
+	static const std::size_t unassigned = Munkres< T >::unassigned;
+
+	SparseAssignment()
+		: m_cost( 0 )
+	{}
+
+	/**
+	 * computes the assignment
+	 * @param nRows number of rows
+	 * @param nCols number of columns
+	 * @param entries the allowed pairs, each at most once
+	 * @param executor distributes the components over threads, see \c Math::threadExecutor
+	 */
+	void solve( std::size_t nRows, std::size_t nCols, const std::vector< Entry >& entries,
+		const ListExecutor& executor = ListExecutor() );
+
+	/** returns for every row the matched column, or \c unassigned */
+	const std::vector< std::size_t >& getRowMatchList() const
+	{ return m_rowMatch; }
+
+	/** returns for every column the matched row, or \c unassigned */
+	const std::vector< std::size_t >& getColMatchList() const
+	{ return m_colMatch; }
+
+	/** returns the total cost of the assignment */
+	T getCost() const
+	{ return m_cost; }
+
+	/** returns the number of connected components of the last problem */
+	std::size_t componentCount() const
+	{ return m_componentOffsets.empty() ? 0 : m_componentOffsets.size() - 1; }
+
+protected:
+	/** root of a node of the union-find forest, rows are nodes [ 0, nRows ), columns follow */
+	std::size_t findRoot( std::size_t node )
+	{
+		while ( m_parent[ node ] != node )
+		{
+			m_parent[ node ] = m_parent[ m_parent[ node ] ];
+			node = m_parent[ node ];
+		}
+		return node;
+	}
+
+	/** solves the components [ begin, end ) with the given solver and buffer */
+	void solveComponents( std::size_t begin, std::size_t end, Munkres< T >& solver, std::vector< Entry >& localEntries );
+
+	/** solves the components [ begin, end ) with own buffers, for other threads */
+	void solveComponentsLocal( std::size_t begin, std::size_t end )
+	{
+		Munkres< T > solver;
+		std::vector< Entry > localEntries;
+		solveComponents( begin, end, solver, localEntries );
+	}
+
+	/** input of the current problem */
+	std::size_t m_nRows;
+	const std::vector< Entry >* m_pEntries;
+
+	/** union-find forest and size of the trees */
+	std::vector< std::size_t > m_parent;
+	std::vector< std::size_t > m_size;
+
+	/** component of every root node */
+	std::vector< std::size_t > m_component;
+
+	/** entries ordered by component, component c has [ offsets[ c ], offsets[ c + 1 ] ) */
+	std::vector< std::size_t > m_componentOffsets;
+	std::vector< std::size_t > m_componentEntries;
+
+	/** index of every node within its component, and the numbers of rows and columns per component */
+	std::vector< std::size_t > m_localIndex;
+	std::vector< std::size_t > m_componentRows;
+	std::vector< std::size_t > m_componentCols;
+
+	/** cost of every component */
+	std::vector< T > m_componentCost;
+
+	/** solver and buffer of the calling thread */
+	Munkres< T > m_solver;
+	std::vector< Entry > m_localEntries;
+
+	/** the result */
+	std::vector< std::size_t > m_rowMatch;
+	std::vector< std::size_t > m_colMatch;
+	T m_cost;
+};
+
+template< typename T >
+const std::size_t SparseAssignment< T >::unassigned;
+
+template< typename T >
+void SparseAssignment< T >::solve( const std::size_t nRows, const std::size_t nCols, const std::vector< Entry >& entries,
+	const ListExecutor& executor )
+{
+	m_nRows = nRows;
+	m_pEntries = &entries;
+	m_rowMatch.assign( nRows, unassigned );
+	m_colMatch.assign( nCols, unassigned );
+	m_cost = T( 0 );
+
+	// connected components of rows and columns
+	const std::size_t nNodes = nRows + nCols;
+	m_parent.resize( nNodes );
+	m_size.assign( nNodes, 1 );
+	for ( std::size_t node( 0 ); node < nNodes; ++node )
+		m_parent[ node ] = node;
+	for ( std::size_t k( 0 ); k < entries.size(); ++k )
+	{
+		std::size_t a = findRoot( entries[ k ].row );
+		std::size_t b = findRoot( nRows + entries[ k ].col );
+		if ( a == b )
+			continue;
+		if ( m_size[ a ] < m_size[ b ] )
+			std::swap( a, b );
+		m_parent[ b ] = a;
+		m_size[ a ] += m_size[ b ];
+	}
+
+	// number the components with entries and sort the entries by component
+	m_component.assign( nNodes, unassigned );
+	m_componentOffsets.assign( 1, 0 );
+	for ( std::size_t k( 0 ); k < entries.size(); ++k )
+	{
+		const std::size_t root = findRoot( entries[ k ].row );
+		if ( m_component[ root ] == unassigned )
+		{
+			m_component[ root ] = m_componentOffsets.size() - 1;
+			m_componentOffsets.push_back( 0 );
+		}
+		m_componentOffsets[ m_component[ root ] + 1 ]++;
+	}
+	const std::size_t nComponents = m_componentOffsets.size() - 1;
+	for ( std::size_t c( 0 ); c < nComponents; ++c )
+		m_componentOffsets[ c + 1 ] += m_componentOffsets[ c ];
+
+	m_componentEntries.resize( entries.size() );
+	m_componentRows.assign( nComponents, 0 );
+	m_componentCols.assign( nComponents, 0 );
+	m_localIndex.assign( nNodes, unassigned );
+	for ( std::size_t k( 0 ); k < entries.size(); ++k )
+	{
+		// the row counters serve as fill positions until all entries are placed
+		const std::size_t c = m_component[ findRoot( entries[ k ].row ) ];
+		m_componentEntries[ m_componentOffsets[ c ] + m_componentRows[ c ]++ ] = k;
+	}
+
+	// local indices of the rows and columns within their components
+	m_componentRows.assign( nComponents, 0 );
+	for ( std::size_t c( 0 ); c < nComponents; ++c )
+		for ( std::size_t e( m_componentOffsets[ c ] ); e < m_componentOffsets[ c + 1 ]; ++e )
+		{
+			const Entry& entry( entries[ m_componentEntries[ e ] ] );
+			if ( m_localIndex[ entry.row ] == unassigned )
+				m_localIndex[ entry.row ] = m_componentRows[ c ]++;
+			if ( m_localIndex[ nRows + entry.col ] == unassigned )
+				m_localIndex[ nRows + entry.col ] = m_componentCols[ c ]++;
+		}
+
+	m_componentCost.assign( nComponents, T( 0 ) );
+	if ( nComponents == 0 )
+		return;
+	if ( executor.empty() )
+		solveComponents( 0, nComponents, m_solver, m_localEntries );
+	else
+		executor( nComponents, boost::bind( &SparseAssignment< T >::solveComponentsLocal, this, _1, _2 ) );
+
+	for ( std::size_t c( 0 ); c < nComponents; ++c )
+		m_cost += m_componentCost[ c ];
+}
+
+template< typename T >
+void SparseAssignment< T >::solveComponents( const std::size_t begin, const std::size_t end, Munkres< T >& solver,
+	std::vector< Entry >& localEntries )
+{
+	const std::vector< Entry >& entries( *m_pEntries );
+	for ( std::size_t c( begin ); c < end; ++c )
+	{
+		const std::size_t eBegin = m_componentOffsets[ c ];
+		const std::size_t eEnd = m_componentOffsets[ c + 1 ];
+
+		// a single pair is assigned directly
+		if ( eEnd - eBegin == 1 )
+		{
+			const Entry& entry( entries[ m_componentEntries[ eBegin ] ] );
+			m_rowMatch[ entry.row ] = entry.col;
+			m_colMatch[ entry.col ] = entry.row;
+			m_componentCost[ c ] = entry.cost;
+			continue;
+		}
+
+		localEntries.clear();
+		for ( std::size_t e( eBegin ); e < eEnd; ++e )
+		{
+			const Entry& entry( entries[ m_componentEntries[ e ] ] );
+			localEntries.push_back( Entry( m_localIndex[ entry.row ], m_localIndex[ m_nRows + entry.col ], entry.cost ) );
+		}
+		solver.setSparseMatrix( m_componentRows[ c ], m_componentCols[ c ], localEntries );
+		solver.solve();
+		m_componentCost[ c ] = solver.getCost();
+
+		// map the local matches back, every local row and column appears in an entry
+		const std::vector< std::size_t >& localRowMatch( solver.getRowMatchList() );
+		for ( std::size_t e( eBegin ); e < eEnd; ++e )
+		{
+			const Entry& entry( entries[ m_componentEntries[ e ] ] );
+			if ( localRowMatch[ m_localIndex[ entry.row ] ] == m_localIndex[ m_nRows + entry.col ] )
+			{
+				m_rowMatch[ entry.row ] = entry.col;
+				m_colMatch[ entry.col ] = entry.row;
+			}
+		}
+	}
+}
+
+}}} // namespace Ubitrack::Math::Graph
+
+#endif // __UBITRACK_MATH_GRAPH_SPARSE_ASSIGNMENT_H_INCLUDED__
@@ -0,0 +1,224 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Detection and thread control of the BLAS / LAPACK implementation
+ */
+
+#include "LapackBackend.h"
+
+#include <utUtil/OS.h>
+#include <utUtil/TimerRegistry.h>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <utUtil/CleanWindows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include <utUtil/LazyLogger.h>
+
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Math.LapackBackend" );
+
+namespace Ubitrack { namespace Math {
+
+namespace {
+
+#ifdef _WIN32
+	/** looks up an exported function in the libraries the implementations are shipped as */
+	void* findSymbol( const char* name )
+	{
+		static const char* modules[] = { "mkl_rt.2.dll", "mkl_rt.dll", "libopenblas.dll", "openblas.dll", "libblis.dll", "blis.dll", 0 };
+		for ( const char** m = modules; *m; m++ )
+			if ( HMODULE module = GetModuleHandleA( *m ) )
+				if ( FARPROC p = GetProcAddress( module, name ) )
+					return reinterpret_cast< void* >( p );
+		return 0;
+	}
+#else
+	/** looks up an exported function in the libraries loaded by the process */
+	void* findSymbol( const char* name )
+	{ return dlsym( RTLD_DEFAULT, name ); }
+#endif
+
+	template< class F >
+	void lookup( F& f, const char* name )
+	{ f = reinterpret_cast< F >( findSymbol( name ) ); }
+}
+
+
+LapackBackend& LapackBackend::instance()
+{
+	static LapackBackend backend;
+	return backend;
+}
+
+
+LapackBackend::LapackBackend()
+	: m_vendor( Default )
+	, m_name( "default" )
+	, m_defaultThreads( 1 )
+{
+	// the registry must outlive the timers of the call sites
+	Ubitrack::Util::TimerRegistry::instance();
+
+	lookup( m_mklSetLocal, "mkl_set_num_threads_local" );
+	lookup( m_mklGetMax, "mkl_get_max_threads" );
+	lookup( m_openblasSet, "openblas_set_num_threads" );
+	lookup( m_openblasSetLocal, "openblas_set_num_threads_local" );
+	lookup( m_openblasGet, "openblas_get_num_threads" );
+	lookup( m_blisSet, "bli_thread_set_num_threads" );
+	lookup( m_blisGet, "bli_thread_get_num_threads" );
+
+	// MKL also exports the OpenBLAS names in some configurations, so test it first
+	if ( m_mklSetLocal && m_mklGetMax )
+	{
+		m_vendor = MKL;
+		m_name = "mkl";
+		m_defaultThreads = m_mklGetMax();
+	}
+	else if ( m_openblasSet && m_openblasGet )
+	{
+		m_vendor = OpenBLAS;
+		m_name = "openblas";
+		m_defaultThreads = m_openblasGet();
+	}
+	else if ( m_blisSet && m_blisGet )
+	{
+		m_vendor = BLIS;
+		m_name = "blis";
+		m_defaultThreads = static_cast< int >( m_blisGet() );
+	}
+	m_defaultThreads = std::max( m_defaultThreads, 1 );
+
+	LOG4CPP_INFO( logger, "BLAS/LAPACK implementation: " << m_name << ", " << m_defaultThreads << " threads" );
+}
+
+
+bool LapackBackend::perThreadControl() const
+{
+	return m_vendor == MKL || ( m_vendor == OpenBLAS && m_openblasSetLocal );
+}
+
+
+int LapackBackend::threads() const
+{
+	switch ( m_vendor )
+	{
+	case MKL:
+		return m_mklGetMax();
+	case OpenBLAS:
+		return m_openblasGet();
+	case BLIS:
+		return static_cast< int >( m_blisGet() );
+	default:
+		return 1;
+	}
+}
+
+
+Ubitrack::Util::HistogramBlockTimer& LapackBackend::timer( const std::string& site )
+{
+	boost::mutex::scoped_lock lock( m_mutex );
+	boost::shared_ptr< Ubitrack::Util::HistogramBlockTimer >& t( m_timers[ site ] );
+	if ( !t )
+		t.reset( new Ubitrack::Util::HistogramBlockTimer( site + "." + m_name ) );
+	return *t;
+}
+
+
+int LapackBackend::setThreads( const int nThreads, const bool bLocal )
+{
+	switch ( m_vendor )
+	{
+	case MKL:
+		// always thread-local, 0 returns to the global setting
+		return m_mklSetLocal( nThreads );
+	case OpenBLAS:
+		if ( bLocal )
+			return m_openblasSetLocal( nThreads );
+		m_openblasSet( nThreads );
+		return 0;
+	case BLIS:
+		m_blisSet( nThreads );
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+
+int LapackBackend::enterScope( const int nThreads )
+{
+	if ( !threadControl() )
+		return 0;
+	if ( perThreadControl() )
+		return setThreads( nThreads, true );
+
+	// process-wide: the smallest number of all active scopes
+	boost::mutex::scoped_lock lock( m_mutex );
+	m_activeScopes[ nThreads ]++;
+	setThreads( m_activeScopes.begin()->first, false );
+	return 0;
+}
+
+
+void LapackBackend::leaveScope( const int nThreads, const int previous )
+{
+	if ( !threadControl() )
+		return;
+	if ( perThreadControl() )
+	{
+		setThreads( previous, true );
+		return;
+	}
+
+	boost::mutex::scoped_lock lock( m_mutex );
+	std::map< int, std::size_t >::iterator it( m_activeScopes.find( nThreads ) );
+	if ( --it->second == 0 )
+		m_activeScopes.erase( it );
+	setThreads( m_activeScopes.empty() ? m_defaultThreads : m_activeScopes.begin()->first, false );
+}
+
+
+LapackScope::LapackScope( const int nThreads, const char* site )
+	: m_nThreads( nThreads > 0 ? nThreads : LapackBackend::instance().defaultThreads() )
+	, m_previous( LapackBackend::instance().enterScope( m_nThreads ) )
+	, m_pTimer( site ? &LapackBackend::instance().timer( site ) : 0 )
+	, m_startTime( Ubitrack::Util::getHighPerformanceCounter() )
+{
+}
+
+
+LapackScope::~LapackScope()
+{
+	if ( m_pTimer )
+		m_pTimer->addMeasurement( Ubitrack::Util::getHighPerformanceCounter() - m_startTime );
+	LapackBackend::instance().leaveScope( m_nThreads, m_previous );
+}
+
+} } // namespace Ubitrack::Math
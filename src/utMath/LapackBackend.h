@@ -0,0 +1,177 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Detection and thread control of the BLAS / LAPACK implementation
+ *
+ * The library calls BLAS and LAPACK through the boost bindings and links whatever
+ * \c LAPACK_LIBRARIES were found. Which implementation actually runs is only known at run
+ * time, e.g. when it is chosen with FlexiBLAS, update-alternatives or \c LD_PRELOAD.
+ * \c LapackBackend detects it from the exported symbols and controls its internal threads,
+ * and \c LapackScope sets the threads for a block of calls and times it.
+ */
+
+#ifndef __UBITRACK_MATH_LAPACKBACKEND_H_INCLUDED__
+#define __UBITRACK_MATH_LAPACKBACKEND_H_INCLUDED__
+
+#include <map>
+#include <string>
+
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <utCore.h>
+#include <utUtil/HistogramBlockTimer.h>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * The BLAS / LAPACK implementation of the process.
+ *
+ * Recognizes Intel MKL, OpenBLAS and BLIS. Everything else, e.g. the reference implementation,
+ * has no thread control and is reported as \c Default.
+ *
+ * MKL and OpenBLAS (since 0.3.27) can set the number of threads for the calling thread only.
+ * For the others the number is process-wide: while scopes with different numbers are active,
+ * the smallest one is used, so a per-frame solve that asks for one thread is never
+ * oversubscribed by an offline computation in another thread.
+ */
+class UBITRACK_EXPORT LapackBackend
+	: private boost::noncopyable
+{
+public:
+	/** the recognized implementations */
+	enum Vendor
+	{
+		Default,
+		MKL,
+		OpenBLAS,
+		BLIS
+	};
+
+	/** the backend of the process */
+	static LapackBackend& instance();
+
+	/** the detected implementation */
+	Vendor vendor() const
+	{ return m_vendor; }
+
+	/** name of the implementation, e.g. "openblas" */
+	const std::string& name() const
+	{ return m_name; }
+
+	/** true if the number of threads can be changed */
+	bool threadControl() const
+	{ return m_vendor != Default; }
+
+	/** true if the number of threads is set per calling thread */
+	bool perThreadControl() const;
+
+	/** number of threads of the implementation for calls from this thread, 1 without thread control */
+	int threads() const;
+
+	/** number of threads of the implementation when the process started */
+	int defaultThreads() const
+	{ return m_defaultThreads; }
+
+	/**
+	 * timer of a call site, named "<site>.<backend name>", created on first use.
+	 * The timer is part of the \c Util::TimerRegistry.
+	 */
+	Ubitrack::Util::HistogramBlockTimer& timer( const std::string& site );
+
+protected:
+	friend class LapackScope;
+
+	LapackBackend();
+
+	/// @internal sets the threads for a new scope, returns the previous value to restore for thread-local control
+	int enterScope( int nThreads );
+
+	/// @internal restores the threads of a finished scope
+	void leaveScope( int nThreads, int previous );
+
+	/// @internal sets the threads of the implementation, returns the previous thread-local value if supported
+	int setThreads( int nThreads, bool bLocal );
+
+	Vendor m_vendor;
+	std::string m_name;
+	int m_defaultThreads;
+
+	/// implementation specific functions, 0 if not exported
+	int ( *m_mklSetLocal )( int );
+	int ( *m_mklGetMax )();
+	void ( *m_openblasSet )( int );
+	int ( *m_openblasSetLocal )( int );
+	int ( *m_openblasGet )();
+	void ( *m_blisSet )( long long );
+	long long ( *m_blisGet )();
+
+	/// number of active process-wide scopes per requested number of threads
+	boost::mutex m_mutex;
+	std::map< int, std::size_t > m_activeScopes;
+
+	std::map< std::string, boost::shared_ptr< Ubitrack::Util::HistogramBlockTimer > > m_timers;
+};
+
+
+/**
+ * @ingroup math
+ * Sets the number of threads of the BLAS / LAPACK implementation for a block of calls and
+ * optionally times the block with the timer of a call site, see \c LapackBackend::timer.
+ * Scopes can be nested and used from several threads.
+ * @code
+ * {
+ *     // small per-frame solve, must not spawn threads
+ *     Math::LapackScope scope( 1, "Ubitrack.Algorithm.optimizePose" );
+ *     ...
+ * }
+ * @endcode
+ */
+class UBITRACK_EXPORT LapackScope
+	: private boost::noncopyable
+{
+public:
+	/**
+	 * @param nThreads number of threads in the scope, 0 for the default of the implementation
+	 * @param site name of the call site for the timer, 0 to not time the scope
+	 */
+	explicit LapackScope( int nThreads, const char* site = 0 );
+
+	/** restores the previous number of threads */
+	~LapackScope();
+
+protected:
+	const int m_nThreads;
+	int m_previous;
+	Ubitrack::Util::HistogramBlockTimer* m_pTimer;
+	unsigned long long m_startTime;
+};
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_LAPACKBACKEND_H_INCLUDED__
@@ -0,0 +1,265 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Exponential and logarithm maps of the rotations SO(3) and rigid transformations SE(3),
+ * and the jacobians of the rotation exponential.
+ *
+ * Rotations are given as rotation vectors r = theta * axis, the logarithm of \c Quaternion.
+ * All functions of a rotation vector share the trigonometric terms in \c SO3Terms, which need
+ * one \c sin and one \c cos of the half angle. Small angles use Taylor series instead of the
+ * closed forms, which lose precision or divide by zero there:
+ * @code
+ * const Math::Lie::SO3Terms< double > terms( r );
+ * Math::Matrix< double, 3, 3 > R, Jl;
+ * terms.matrix( R );
+ * terms.leftJacobian( Jl );
+ * @endcode
+ *
+ * The left jacobian Jl maps a small change d of the rotation vector to a rotation applied on
+ * the left, exp( r + d ) ~ exp( Jl d ) exp( r ), the right jacobian Jr = Jl^T to a rotation
+ * applied on the right, exp( r + d ) ~ exp( r ) exp( Jr d ).
+ *
+ * Lists of rotation vectors are converted on \c Util::simd_pack registers by
+ * \c quaternionsFromLogarithms in PoseListOperations.h.
+ */
+
+#ifndef __UBITRACK_MATH_LIEGROUPS_H_INCLUDED__
+#define __UBITRACK_MATH_LIEGROUPS_H_INCLUDED__
+
+#include "Quaternion.h"
+#include "Pose.h"
+#include "Vector.h"
+#include "Matrix.h"
+
+#include <cmath>
+#include <limits>
+
+namespace Ubitrack { namespace Math { namespace Lie {
+
+/**
+ * Trigonometric terms of a rotation vector r with angle theta, shared by the exponential
+ * and the jacobians.
+ *
+ * @param T element type
+ */
+template< typename T >
+struct SO3Terms
+{
+	/** the rotation vector */
+	Vector< T, 3 > r;
+
+	/** theta^2 */
+	T theta2;
+
+	/** sin( theta / 2 ) / theta, the factor of the imaginary part of the quaternion */
+	T halfSinc;
+
+	/** cos( theta / 2 ), the real part of the quaternion */
+	T halfCos;
+
+	/** sin( theta ) / theta */
+	T sinc;
+
+	/** ( 1 - cos( theta ) ) / theta^2 */
+	T cosc;
+
+	/** ( theta - sin( theta ) ) / theta^3 */
+	T sinc3;
+
+	/** ( 1 - theta / 2 * cot( theta / 2 ) ) / theta^2, of the inverse jacobians */
+	T inverseFactor;
+
+	/** computes the terms of the rotation vector \c v */
+	template< class VT >
+	explicit SO3Terms( const VT& v )
+		: r( v( 0 ), v( 1 ), v( 2 ) )
+		, theta2( r( 0 ) * r( 0 ) + r( 1 ) * r( 1 ) + r( 2 ) * r( 2 ) )
+	{
+		// below the cube root of epsilon the omitted terms of the series are below rounding
+		if ( theta2 < smallAngle2() )
+		{
+			const T t4 = theta2 * theta2;
+			halfSinc = T( 0.5 ) - theta2 / 48 + t4 / 3840;
+			halfCos = T( 1 ) - theta2 / 8 + t4 / 384;
+			sinc = T( 1 ) - theta2 / 6 + t4 / 120;
+			cosc = T( 0.5 ) - theta2 / 24 + t4 / 720;
+			sinc3 = T( 1 ) / 6 - theta2 / 120 + t4 / 5040;
+			inverseFactor = T( 1 ) / 12 + theta2 / 720 + t4 / 30240;
+		}
+		else
+		{
+			const T theta = std::sqrt( theta2 );
+			const T s = std::sin( theta / 2 );
+			halfCos = std::cos( theta / 2 );
+			halfSinc = s / theta;
+			sinc = 2 * halfSinc * halfCos;
+			cosc = 2 * halfSinc * halfSinc;
+			sinc3 = ( 1 - sinc ) / theta2;
+			inverseFactor = ( 1 - halfCos / ( 2 * halfSinc ) ) / theta2;
+		}
+	}
+
+	/** squared angle below which the series are used, about the cube root of epsilon */
+	static T smallAngle2()
+	{ return std::numeric_limits< T >::digits > 24 ? T( 6e-6 ) : T( 5e-3 ); }
+
+	/** the unit quaternion exp( r ) */
+	Quaternion quaternion() const
+	{ return Quaternion( halfSinc * r( 0 ), halfSinc * r( 1 ), halfSinc * r( 2 ), halfCos ); }
+
+	/** the rotation matrix R = I + sinc [ r ]x + cosc [ r ]x^2 */
+	template< class M >
+	void matrix( M& m ) const
+	{ set( m, sinc, cosc ); }
+
+	/** the left jacobian Jl = I + cosc [ r ]x + sinc3 [ r ]x^2 */
+	template< class M >
+	void leftJacobian( M& m ) const
+	{ set( m, cosc, sinc3 ); }
+
+	/** the right jacobian Jr = I - cosc [ r ]x + sinc3 [ r ]x^2 */
+	template< class M >
+	void rightJacobian( M& m ) const
+	{ set( m, -cosc, sinc3 ); }
+
+	/** the inverse of the left jacobian, I - 1/2 [ r ]x + inverseFactor [ r ]x^2 */
+	template< class M >
+	void inverseLeftJacobian( M& m ) const
+	{ set( m, T( -0.5 ), inverseFactor ); }
+
+	/** the inverse of the right jacobian, I + 1/2 [ r ]x + inverseFactor [ r ]x^2 */
+	template< class M >
+	void inverseRightJacobian( M& m ) const
+	{ set( m, T( 0.5 ), inverseFactor ); }
+
+	/**
+	 * rotates a vector and computes the jacobian of the result wrt. r,
+	 * d( R v ) / dr = -[ R v ]x Jl
+	 * @param v the vector to rotate
+	 * @param result R v
+	 * @param j 3x3 jacobian
+	 */
+	template< class V, class VR, class M >
+	void rotate( const V& v, VR& result, M& j ) const
+	{
+		Matrix< T, 3, 3 > m;
+		matrix( m );
+		const T rv[ 3 ] = {
+			m( 0, 0 ) * v( 0 ) + m( 0, 1 ) * v( 1 ) + m( 0, 2 ) * v( 2 ),
+			m( 1, 0 ) * v( 0 ) + m( 1, 1 ) * v( 1 ) + m( 1, 2 ) * v( 2 ),
+			m( 2, 0 ) * v( 0 ) + m( 2, 1 ) * v( 1 ) + m( 2, 2 ) * v( 2 ) };
+		leftJacobian( m );
+		for ( std::size_t c = 0; c < 3; c++ )
+		{
+			j( 0, c ) = rv[ 2 ] * m( 1, c ) - rv[ 1 ] * m( 2, c );
+			j( 1, c ) = rv[ 0 ] * m( 2, c ) - rv[ 2 ] * m( 0, c );
+			j( 2, c ) = rv[ 1 ] * m( 0, c ) - rv[ 0 ] * m( 1, c );
+		}
+		result( 0 ) = rv[ 0 ];
+		result( 1 ) = rv[ 1 ];
+		result( 2 ) = rv[ 2 ];
+	}
+
+protected:
+	/** m = I + a [ r ]x + b [ r ]x^2, using [ r ]x^2 = r r^T - theta^2 I */
+	template< class M >
+	void set( M& m, const T a, const T b ) const
+	{
+		const T d = 1 - b * theta2;
+		m( 0, 0 ) = d + b * r( 0 ) * r( 0 );
+		m( 1, 1 ) = d + b * r( 1 ) * r( 1 );
+		m( 2, 2 ) = d + b * r( 2 ) * r( 2 );
+		m( 0, 1 ) = b * r( 0 ) * r( 1 ) - a * r( 2 );
+		m( 1, 0 ) = b * r( 0 ) * r( 1 ) + a * r( 2 );
+		m( 0, 2 ) = b * r( 0 ) * r( 2 ) + a * r( 1 );
+		m( 2, 0 ) = b * r( 0 ) * r( 2 ) - a * r( 1 );
+		m( 1, 2 ) = b * r( 1 ) * r( 2 ) - a * r( 0 );
+		m( 2, 1 ) = b * r( 1 ) * r( 2 ) + a * r( 0 );
+	}
+};
+
+
+/** the rotation exp( r ) of a rotation vector, the same as \c Quaternion::fromLogarithm */
+inline Quaternion expSO3( const Vector< double, 3 >& r )
+{ return SO3Terms< double >( r ).quaternion(); }
+
+/**
+ * the rotation vector of a quaternion with an angle of at most pi, the same as
+ * \c Quaternion::toLogarithm. The angle is computed with atan2, which stays accurate
+ * for small angles, where acos of the real part loses half of the digits.
+ */
+inline Vector< double, 3 > logSO3( const Quaternion& q )
+{
+	// always take the quaternion with w >= 0
+	const double w = q.w() >= 0 ? q.w() : -q.w();
+	const double s2 = q.x() * q.x() + q.y() * q.y() + q.z() * q.z();
+	double f;
+	if ( s2 < SO3Terms< double >::smallAngle2() * w * w )
+	{
+		// 2 atan( u ) / ( u w ) with u = s / w, to the third term of the series
+		const double u2 = s2 / ( w * w );
+		f = 2 / w * ( 1 - u2 / 3 + u2 * u2 / 5 );
+	}
+	else
+	{
+		// only zero for a zero quaternion, which has no rotation
+		const double s = std::sqrt( s2 );
+		f = s > 0 ? 2 * std::atan2( s, w ) / s : 0;
+	}
+	if ( q.w() < 0 )
+		f = -f;
+	return Vector< double, 3 >( f * q.x(), f * q.y(), f * q.z() );
+}
+
+/**
+ * the rigid transformation exp( xi ) of a twist xi = ( rho, phi ), with the rotation
+ * exp( phi ) and the translation Jl( phi ) rho
+ */
+inline Pose expSE3( const Vector< double, 6 >& xi )
+{
+	const SO3Terms< double > terms( Vector< double, 3 >( xi( 3 ), xi( 4 ), xi( 5 ) ) );
+	Matrix< double, 3, 3 > jl;
+	terms.leftJacobian( jl );
+	const Vector< double, 3 > rho( xi( 0 ), xi( 1 ), xi( 2 ) );
+	return Pose( terms.quaternion(), Vector< double, 3 >( boost::numeric::ublas::prod( jl, rho ) ) );
+}
+
+/** the twist ( rho, phi ) of a rigid transformation, the inverse of \c expSE3 */
+inline Vector< double, 6 > logSE3( const Pose& p )
+{
+	const Vector< double, 3 > phi( logSO3( p.rotation() ) );
+	Matrix< double, 3, 3 > jlInv;
+	SO3Terms< double >( phi ).inverseLeftJacobian( jlInv );
+	const Vector< double, 3 > rho( boost::numeric::ublas::prod( jlInv, p.translation() ) );
+	Vector< double, 6 > xi;
+	xi( 0 ) = rho( 0 ); xi( 1 ) = rho( 1 ); xi( 2 ) = rho( 2 );
+	xi( 3 ) = phi( 0 ); xi( 4 ) = phi( 1 ); xi( 5 ) = phi( 2 );
+	return xi;
+}
+
+} } } // namespace Ubitrack::Math::Lie
+
+#endif // __UBITRACK_MATH_LIEGROUPS_H_INCLUDED__
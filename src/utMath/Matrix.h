@@ -34,6 +34,8 @@
 #define __UBITRACK_MATH_MATRIX_H_INCLUDED__
 
 #include <utUtil/StaticAssert.h>
+#include <utUtil/AllocationTracker.h>
+#include <utMath/SmallArray.h>
 
 #include "Quaternion.h"
 #include "Vector.h"
@@ -264,8 +266,10 @@ template< typename T, std::size_t M = 0, std::size_t N = M > class Matrix
  * @ingroup math
  * @brief Specialization of \b Matrix for memory allocation during runtime.
  *
- * The size of the \b Matrix is determined at runtime, the heap is used
- * for memory allocation in this case.
+ * The size of the \b Matrix is determined at runtime. Matrices of up to
+ * 16x16 elements are stored within the object, the heap is used for larger
+ * ones. The heap storage is counted by the \c Util::AllocationTracker if
+ * tracking is enabled.
  * Many functions are dropped since they are not necessary yet ( e.g. \c serialize ).
  *
  * @note Please see Matrix for more details on the stack allocated version.
@@ -274,11 +278,13 @@ template< typename T, std::size_t M = 0, std::size_t N = M > class Matrix
  */
 template< typename T >
 class Matrix< T, 0, 0 >
- 	: public boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, boost::numeric::ublas::unbounded_array< T > >
+ 	: public boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, Math::SmallArray< T, 256,
+		typename Ubitrack::Util::TrackedAllocator< T, Ubitrack::Util::AllocationTracker::MathStorage >::type > >
 {
 	public:
 		
-		typedef boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, boost::numeric::ublas::unbounded_array< T > > base_type;
+		typedef boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, Math::SmallArray< T, 256,
+			typename Ubitrack::Util::TrackedAllocator< T, Ubitrack::Util::AllocationTracker::MathStorage >::type > > base_type;
 		typedef Math::Matrix< T, 0, 0 >			self_type;
 		typedef T								value_type;
 		typedef typename base_type::size_type	size_type;
@@ -0,0 +1,201 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Implementation of the thread-local matrix arena.
+ */
+
+#include "MatrixArena.h"
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+#include <boost/thread/tss.hpp>
+
+namespace Ubitrack { namespace Math {
+
+namespace {
+
+/// @internal alignment of all allocations, enough for SSE loads
+const std::size_t alignment = 16;
+
+/// @internal the arena of one thread
+struct Arena
+{
+	struct Block
+	{
+		char* memory;
+		char* begin;
+		char* end;
+	};
+
+	/// all blocks, the ones after \c current are unused
+	std::vector< Block > blocks;
+
+	/// index of the block in use
+	std::size_t current;
+
+	/// next free byte in the current block
+	char* pos;
+
+	/// number of allocations that have not been released yet
+	std::size_t live;
+
+	/// number of active scopes
+	unsigned depth;
+
+	Arena()
+		: current( 0 )
+		, pos( 0 )
+		, live( 0 )
+		, depth( 0 )
+	{}
+
+	~Arena()
+	{
+		for ( std::vector< Block >::iterator it = blocks.begin(); it != blocks.end(); ++it )
+			delete[] it->memory;
+	}
+
+	void addBlock( const std::size_t size )
+	{
+		Block b;
+		b.memory = new char[ size + alignment ];
+		b.begin = alignUp( b.memory );
+		b.end = b.begin + size;
+		blocks.push_back( b );
+	}
+
+	static char* alignUp( char* p )
+	{
+		const std::size_t misalignment = reinterpret_cast< std::size_t >( p ) % alignment;
+		return misalignment ? p + ( alignment - misalignment ) : p;
+	}
+
+	void* allocate( std::size_t n )
+	{
+		n = ( n + alignment - 1 ) / alignment * alignment;
+		if ( n > std::size_t( blocks[ current ].end - pos ) )
+		{
+			// use the next free block that is large enough or append a new one
+			std::size_t i = current + 1;
+			while ( i < blocks.size() && std::size_t( blocks[ i ].end - blocks[ i ].begin ) < n )
+				i++;
+			if ( i == blocks.size() )
+			{
+				const std::size_t last = blocks.back().end - blocks.back().begin;
+				addBlock( std::max( n, 2 * last ) );
+			}
+			current = i;
+			pos = blocks[ i ].begin;
+		}
+		void* p = pos;
+		pos += n;
+		live++;
+		return p;
+	}
+
+	bool owns( const void* p ) const
+	{
+		const char* c = static_cast< const char* >( p );
+		for ( std::vector< Block >::const_iterator it = blocks.begin(); it != blocks.end(); ++it )
+			if ( c >= it->begin && c < it->end )
+				return true;
+		return false;
+	}
+};
+
+boost::thread_specific_ptr< Arena > g_arena;
+
+} // anonymous namespace
+
+
+MatrixArena::Scope::Scope( std::size_t initialSize )
+{
+	Arena* a = g_arena.get();
+	if ( !a )
+	{
+		a = new Arena;
+		g_arena.reset( a );
+	}
+	if ( a->blocks.empty() )
+	{
+		a->addBlock( std::max( initialSize, alignment ) );
+		a->pos = a->blocks[ 0 ].begin;
+	}
+
+	m_block = a->current;
+	m_pos = a->pos;
+	m_live = a->live;
+	a->depth++;
+}
+
+
+MatrixArena::Scope::~Scope()
+{
+	Arena* a = g_arena.get();
+
+	// matrices allocated within the scope must not outlive it
+	assert( a->live == m_live );
+
+	a->current = m_block;
+	a->pos = m_pos;
+	a->live = m_live;
+	a->depth--;
+}
+
+
+void* MatrixArena::allocate( std::size_t n )
+{
+	Arena* a = g_arena.get();
+	if ( !a || !a->depth )
+		return 0;
+	return a->allocate( n );
+}
+
+
+bool MatrixArena::deallocate( void* p )
+{
+	Arena* a = g_arena.get();
+	if ( !a || !a->owns( p ) )
+		return false;
+
+	assert( a->depth > 0 );
+	a->live--;
+	return true;
+}
+
+
+std::size_t MatrixArena::capacity()
+{
+	Arena* a = g_arena.get();
+	std::size_t n = 0;
+	if ( a )
+		for ( std::vector< Arena::Block >::const_iterator it = a->blocks.begin(); it != a->blocks.end(); ++it )
+			n += it->end - it->begin;
+	return n;
+}
+
+} } // namespace Ubitrack::Math
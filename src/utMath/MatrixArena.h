@@ -0,0 +1,202 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Scoped arena allocation of temporary dynamic-size matrices and vectors.
+ *
+ * Estimators like the DLTs build large design matrices and SVD workspaces on every call,
+ * each of them allocated on the heap by \c ublas::unbounded_array. When an estimator runs
+ * per frame for many cameras, these allocations add up. The matrix types defined here use
+ * the \c ArenaAllocator, which takes memory from a thread-local arena while a
+ * \c MatrixArena::Scope is alive on the calling thread:
+ * @code
+ * Math::MatrixArena::Scope arena;
+ * Math::ArenaMatrix< T >::type A( 2 * n, 9 );
+ * Math::ArenaMatrix< T >::type U( 2 * n, 2 * n );
+ * ...
+ * @endcode
+ * Allocations are bump allocations from blocks that the thread keeps for later calls, and
+ * everything allocated within a scope is released at once when the scope ends. Outside of
+ * a scope the allocator falls back to the heap, so the types can be used anywhere.
+ *
+ * Rules:
+ * - Declare the scope before the matrices, so they are destroyed before the scope ends.
+ * - Destroy the matrices on the thread that created them.
+ * - The contents must not outlive the scope, e.g. copy results into a \c Math::Matrix.
+ *
+ * The arena types are plain \c ublas types, so they work with the LAPACK bindings.
+ */
+
+#ifndef __UBITRACK_MATH_MATRIXARENA_H_INCLUDED__
+#define __UBITRACK_MATH_MATRIXARENA_H_INCLUDED__
+
+#include <utCore.h>
+
+#include <new>
+#include <limits>
+#include <cstddef>
+
+#include <boost/utility.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/vector.hpp>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * Thread-local bump allocator for temporary matrix storage.
+ */
+class UBITRACK_EXPORT MatrixArena
+{
+public:
+	/**
+	 * Activates the arena of the calling thread.
+	 *
+	 * Scopes can be nested. An inner scope releases only the memory allocated while it
+	 * was alive.
+	 */
+	class UBITRACK_EXPORT Scope
+		: private boost::noncopyable
+	{
+	public:
+		/**
+		 * @param initialSize size of the first block in bytes, if the thread does not
+		 *   own an arena yet
+		 */
+		explicit Scope( std::size_t initialSize = 64 * 1024 );
+
+		/** releases everything allocated since the construction of the scope */
+		~Scope();
+
+	protected:
+		std::size_t m_block;
+		char* m_pos;
+		std::size_t m_live;
+	};
+
+	/**
+	 * Allocates \c n bytes from the arena of the calling thread.
+	 * @return 0 if no scope is active on this thread
+	 */
+	static void* allocate( std::size_t n );
+
+	/**
+	 * Releases memory allocated by \c allocate. The memory is only reused after the
+	 * scope ends.
+	 * @return false if \c p does not belong to the arena of the calling thread
+	 */
+	static bool deallocate( void* p );
+
+	/** number of bytes the arena of the calling thread has reserved */
+	static std::size_t capacity();
+};
+
+
+/**
+ * Standard allocator that takes memory from the \c MatrixArena while a scope is active
+ * and from the heap otherwise.
+ */
+template< typename T >
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template< typename U >
+	struct rebind
+	{ typedef ArenaAllocator< U > other; };
+
+	ArenaAllocator()
+	{}
+
+	template< typename U >
+	ArenaAllocator( const ArenaAllocator< U >& )
+	{}
+
+	pointer address( reference x ) const
+	{ return &x; }
+
+	const_pointer address( const_reference x ) const
+	{ return &x; }
+
+	pointer allocate( size_type n, const void* = 0 )
+	{
+		void* p = MatrixArena::allocate( n * sizeof( T ) );
+		if ( !p )
+			p = ::operator new( n * sizeof( T ) );
+		return static_cast< pointer >( p );
+	}
+
+	void deallocate( pointer p, size_type )
+	{
+		if ( !MatrixArena::deallocate( p ) )
+			::operator delete( p );
+	}
+
+	size_type max_size() const
+	{ return std::numeric_limits< size_type >::max() / sizeof( T ); }
+
+	void construct( pointer p, const T& v )
+	{ new( p ) T( v ); }
+
+	void destroy( pointer p )
+	{ p->~T(); }
+
+	bool operator==( const ArenaAllocator& ) const
+	{ return true; }
+
+	bool operator!=( const ArenaAllocator& ) const
+	{ return false; }
+};
+
+
+/** dynamic-size column-major matrix with arena storage, see \c MatrixArena */
+template< typename T >
+struct ArenaMatrix
+{
+	typedef boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major,
+		boost::numeric::ublas::unbounded_array< T, ArenaAllocator< T > > > type;
+};
+
+/** dynamic-size vector with arena storage, see \c MatrixArena */
+template< typename T >
+struct ArenaVector
+{
+	typedef boost::numeric::ublas::vector< T, boost::numeric::ublas::unbounded_array< T, ArenaAllocator< T > > > type;
+};
+
+typedef ArenaMatrix< float >::type ArenaMatrixf;
+typedef ArenaMatrix< double >::type ArenaMatrixd;
+typedef ArenaVector< float >::type ArenaVectorf;
+typedef ArenaVector< double >::type ArenaVectord;
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_MATRIXARENA_H_INCLUDED__
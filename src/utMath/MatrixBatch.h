@@ -0,0 +1,389 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Batches of small matrices of the same size and operations on all of them
+ *
+ * Filter banks, batched optimizations and subset searches (e.g. in the hand-eye calibration or
+ * the triangulation of many points) solve thousands of independent problems of a few rows.
+ * The functors of \c Blas1.h to \c Blas3.h and the LAPACK bindings work on a single matrix at a
+ * time, and a \c std::vector< Math::Matrix > cannot be vectorized across its matrices.
+ *
+ * A \c MatrixBatch< T, M, N > stores its matrices interleaved, like a \c PointCloud stores its
+ * points: each of the \c M * \c N elements has a contiguous array over all matrices, so
+ * <tt>data( r, c )[ k ]</tt> is the element ( r, c ) of matrix k. The functions below compute
+ * \c Util::simd_pack< T >::size matrices at once with the same instructions, as the point
+ * kernels of \c PointBatch.h, and the remaining matrices with the scalar version.
+ * @code
+ * Math::MatrixBatch< double, 6, 6 > normal( normalMatrices );   // from std::vector< Math::Matrix< double, 6, 6 > >
+ * Math::MatrixBatch< double, 6, 1 > rhs( gradients );
+ * std::vector< std::size_t > info;
+ * Math::batchCholeskySolve( normal, rhs, &info );
+ * @endcode
+ *
+ * The matrices of the arguments of one call must not overlap, unless stated otherwise.
+ */
+
+#ifndef __UBITRACK_MATH_MATRIXBATCH_H_INCLUDED__
+#define __UBITRACK_MATH_MATRIXBATCH_H_INCLUDED__
+
+#include "Matrix.h"
+#include "Util/simd_traits.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * List of \c M x \c N matrices stored as \c M * \c N arrays of elements.
+ * Vectors are batches of \c N x 1 matrices.
+ *
+ * @tparam T builtin type of the elements (e.g \c double or \c float )
+ * @tparam M number of rows
+ * @tparam N number of columns
+ */
+template< typename T, std::size_t M, std::size_t N >
+class MatrixBatch
+{
+public:
+	typedef Math::Matrix< T, M, N > value_type;
+	typedef T element_type;
+	typedef std::size_t size_type;
+	static const std::size_t rows = M;
+	static const std::size_t columns = N;
+
+	/** empty batch */
+	MatrixBatch()
+	{}
+
+	/** batch of \c n zero matrices */
+	explicit MatrixBatch( const size_type n )
+	{ resize( n ); }
+
+	/** copies a list of matrices */
+	explicit MatrixBatch( const std::vector< value_type >& matrices )
+	{ assign( matrices ); }
+
+	/** replaces the matrices with a copy of the list */
+	void assign( const std::vector< value_type >& matrices )
+	{
+		resize( matrices.size() );
+		for ( std::size_t k = 0; k < matrices.size(); k++ )
+			set( k, matrices[ k ] );
+	}
+
+	/** copies the matrices into a list */
+	void toMatrices( std::vector< value_type >& matrices ) const
+	{
+		matrices.resize( size() );
+		for ( std::size_t k = 0; k < matrices.size(); k++ )
+			for ( std::size_t c = 0; c < N; c++ )
+				for ( std::size_t r = 0; r < M; r++ )
+					matrices[ k ]( r, c ) = m_elements[ c * M + r ][ k ];
+	}
+
+	/** number of matrices */
+	size_type size() const
+	{ return m_elements[ 0 ].size(); }
+
+	bool empty() const
+	{ return m_elements[ 0 ].empty(); }
+
+	/** changes the number of matrices, new matrices are zero */
+	void resize( const size_type n )
+	{
+		for ( std::size_t e = 0; e < M * N; e++ )
+			m_elements[ e ].resize( n, T( 0 ) );
+	}
+
+	void clear()
+	{
+		for ( std::size_t e = 0; e < M * N; e++ )
+			m_elements[ e ].clear();
+	}
+
+	/** returns matrix \c k */
+	value_type operator[]( const size_type k ) const
+	{
+		value_type m;
+		for ( std::size_t c = 0; c < N; c++ )
+			for ( std::size_t r = 0; r < M; r++ )
+				m( r, c ) = m_elements[ c * M + r ][ k ];
+		return m;
+	}
+
+	/** replaces matrix \c k */
+	void set( const size_type k, const value_type& m )
+	{
+		for ( std::size_t c = 0; c < N; c++ )
+			for ( std::size_t r = 0; r < M; r++ )
+				m_elements[ c * M + r ][ k ] = m( r, c );
+	}
+
+	/** element ( r, c ) of matrix \c k */
+	T& operator()( const size_type k, const std::size_t r, const std::size_t c )
+	{ return m_elements[ c * M + r ][ k ]; }
+
+	const T& operator()( const size_type k, const std::size_t r, const std::size_t c ) const
+	{ return m_elements[ c * M + r ][ k ]; }
+
+	/** the contiguous array of element ( r, c ) of all matrices, 0 if the batch is empty */
+	T* data( const std::size_t r, const std::size_t c )
+	{ return m_elements[ c * M + r ].empty() ? 0 : &m_elements[ c * M + r ][ 0 ]; }
+
+	const T* data( const std::size_t r, const std::size_t c ) const
+	{ return m_elements[ c * M + r ].empty() ? 0 : &m_elements[ c * M + r ][ 0 ]; }
+
+protected:
+	std::vector< T > m_elements[ M * N ];
+};
+
+
+namespace Detail {
+
+/**
+ * @internal gemm kernel, starts at matrix \c i and stops before the last incomplete pack
+ * @return index of the first matrix that was not processed
+ */
+template< class Pack, typename T, std::size_t M, std::size_t K, std::size_t N >
+std::size_t batchGemm( const MatrixBatch< T, M, K >& a, const MatrixBatch< T, K, N >& b, MatrixBatch< T, M, N >& result
+	, const T alpha, const T beta, std::size_t i, const std::size_t n )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type packAlpha = Pack::set1( alpha );
+	const pack_type packBeta = Pack::set1( beta );
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+		for ( std::size_t c = 0; c < N; c++ )
+			for ( std::size_t r = 0; r < M; r++ )
+			{
+				pack_type acc = Pack::mul( Pack::load( a.data( r, 0 ) + i ), Pack::load( b.data( 0, c ) + i ) );
+				for ( std::size_t k = 1; k < K; k++ )
+					acc = Pack::add( acc, Pack::mul( Pack::load( a.data( r, k ) + i ), Pack::load( b.data( k, c ) + i ) ) );
+				acc = Pack::mul( packAlpha, acc );
+				if ( beta != T( 0 ) )
+					acc = Pack::add( acc, Pack::mul( packBeta, Pack::load( result.data( r, c ) + i ) ) );
+				Pack::store( result.data( r, c ) + i, acc );
+			}
+	return i;
+}
+
+/**
+ * @internal cholesky kernel, see above. Matrices with a pivot that is not positive get \c j + 1
+ * of the first such column \c j in \c info (if given) and continue with a pivot of one.
+ */
+template< class Pack, typename T, std::size_t N >
+std::size_t batchCholesky( MatrixBatch< T, N, N >& a, std::size_t* info, std::size_t& nFailed
+	, std::size_t i, const std::size_t n )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type one = Pack::set1( T( 1 ) );
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		std::size_t failedColumn[ Pack::size ] = {};
+		for ( std::size_t j = 0; j < N; j++ )
+		{
+			pack_type d = Pack::load( a.data( j, j ) + i );
+			for ( std::size_t k = 0; k < j; k++ )
+			{
+				const pack_type l = Pack::load( a.data( j, k ) + i );
+				d = Pack::sub( d, Pack::mul( l, l ) );
+			}
+
+			// test the pivots of all lanes
+			T pivots[ Pack::size ];
+			Pack::store( pivots, d );
+			for ( std::size_t lane = 0; lane < Pack::size; lane++ )
+				if ( !( pivots[ lane ] > T( 0 ) ) )
+				{
+					if ( failedColumn[ lane ] == 0 )
+						failedColumn[ lane ] = j + 1;
+					pivots[ lane ] = T( 1 );
+				}
+			d = Pack::sqrt( Pack::load( pivots ) );
+			Pack::store( a.data( j, j ) + i, d );
+			const pack_type inverse = Pack::div( one, d );
+
+			for ( std::size_t r = j + 1; r < N; r++ )
+			{
+				pack_type s = Pack::load( a.data( r, j ) + i );
+				for ( std::size_t k = 0; k < j; k++ )
+					s = Pack::sub( s, Pack::mul( Pack::load( a.data( r, k ) + i ), Pack::load( a.data( j, k ) + i ) ) );
+				Pack::store( a.data( r, j ) + i, Pack::mul( s, inverse ) );
+				Pack::store( a.data( j, r ) + i, Pack::set1( T( 0 ) ) );
+			}
+		}
+
+		for ( std::size_t lane = 0; lane < Pack::size; lane++ )
+		{
+			if ( failedColumn[ lane ] )
+				nFailed++;
+			if ( info )
+				info[ i + lane ] = failedColumn[ lane ];
+		}
+	}
+	return i;
+}
+
+/// @internal triangular solve kernel, see above
+template< class Pack, typename T, std::size_t N, std::size_t R >
+std::size_t batchTriangularSolve( const MatrixBatch< T, N, N >& l, MatrixBatch< T, N, R >& b, const bool bTranspose
+	, std::size_t i, const std::size_t n )
+{
+	typedef typename Pack::type pack_type;
+
+	for ( ; i + Pack::size <= n; i += Pack::size )
+		for ( std::size_t c = 0; c < R; c++ )
+			if ( !bTranspose )
+			{
+				// forward substitution l * x = b
+				for ( std::size_t r = 0; r < N; r++ )
+				{
+					pack_type s = Pack::load( b.data( r, c ) + i );
+					for ( std::size_t k = 0; k < r; k++ )
+						s = Pack::sub( s, Pack::mul( Pack::load( l.data( r, k ) + i ), Pack::load( b.data( k, c ) + i ) ) );
+					Pack::store( b.data( r, c ) + i, Pack::div( s, Pack::load( l.data( r, r ) + i ) ) );
+				}
+			}
+			else
+			{
+				// back substitution l^T * x = b
+				for ( std::size_t r = N; r-- > 0; )
+				{
+					pack_type s = Pack::load( b.data( r, c ) + i );
+					for ( std::size_t k = r + 1; k < N; k++ )
+						s = Pack::sub( s, Pack::mul( Pack::load( l.data( k, r ) + i ), Pack::load( b.data( k, c ) + i ) ) );
+					Pack::store( b.data( r, c ) + i, Pack::div( s, Pack::load( l.data( r, r ) + i ) ) );
+				}
+			}
+	return i;
+}
+
+} // namespace Detail
+
+
+/**
+ * @ingroup math
+ * Computes <tt>result = alpha * a * b + beta * result</tt> for all matrices of the batches,
+ * as \c gemm. The batches must have the same size, \c result is resized to it.
+ * \c result must not be \c a or \c b.
+ */
+template< typename T, std::size_t M, std::size_t K, std::size_t N >
+void batchGemm( const MatrixBatch< T, M, K >& a, const MatrixBatch< T, K, N >& b, MatrixBatch< T, M, N >& result
+	, const T alpha = T( 1 ), const T beta = T( 0 ) )
+{
+	const std::size_t n = a.size();
+	result.resize( n );
+	const std::size_t i = Detail::batchGemm< Util::simd_pack< T > >( a, b, result, alpha, beta, 0, n );
+	Detail::batchGemm< Util::simd_scalar< T > >( a, b, result, alpha, beta, i, n );
+}
+
+
+/**
+ * @ingroup math
+ * Computes <tt>y = alpha * a * x + beta * y</tt> for all matrices and vectors of the batches,
+ * as \c gemv.
+ */
+template< typename T, std::size_t M, std::size_t N >
+void batchGemv( const MatrixBatch< T, M, N >& a, const MatrixBatch< T, N, 1 >& x, MatrixBatch< T, M, 1 >& y
+	, const T alpha = T( 1 ), const T beta = T( 0 ) )
+{
+	batchGemm( a, x, y, alpha, beta );
+}
+
+
+/**
+ * @ingroup math
+ * Computes the cholesky decompositions <tt>a = l * l^T</tt> of symmetric positive definite
+ * matrices in place, as \c potrf. Only the lower triangles are read, they are overwritten with
+ * the factors and the strict upper triangles are set to zero.
+ *
+ * @param a the matrices
+ * @param info if given, resized to the batch and set to zero for each successful decomposition
+ *   and to j + 1 if column j had the first pivot that is not positive. The factor of such a
+ *   matrix is not usable.
+ * @return number of matrices that are not positive definite
+ */
+template< typename T, std::size_t N >
+std::size_t batchCholesky( MatrixBatch< T, N, N >& a, std::vector< std::size_t >* info = 0 )
+{
+	const std::size_t n = a.size();
+	std::size_t* pInfo = 0;
+	if ( info )
+	{
+		info->resize( n );
+		pInfo = n ? &( *info )[ 0 ] : 0;
+	}
+
+	std::size_t nFailed = 0;
+	const std::size_t i = Detail::batchCholesky< Util::simd_pack< T > >( a, pInfo, nFailed, 0, n );
+	Detail::batchCholesky< Util::simd_scalar< T > >( a, pInfo, nFailed, i, n );
+	return nFailed;
+}
+
+
+/**
+ * @ingroup math
+ * Solves <tt>l * x = b</tt> or, if \c bTranspose is set, <tt>l^T * x = b</tt> for lower
+ * triangular matrices \c l, as \c trsm. Only the lower triangles of \c l are read.
+ *
+ * @param l the triangular matrices, e.g. the factors of \c batchCholesky
+ * @param b the right hand sides, overwritten with the solutions
+ * @param bTranspose solve with the transposed matrices
+ */
+template< typename T, std::size_t N, std::size_t R >
+void batchTriangularSolve( const MatrixBatch< T, N, N >& l, MatrixBatch< T, N, R >& b, const bool bTranspose = false )
+{
+	const std::size_t n = l.size();
+	const std::size_t i = Detail::batchTriangularSolve< Util::simd_pack< T > >( l, b, bTranspose, 0, n );
+	Detail::batchTriangularSolve< Util::simd_scalar< T > >( l, b, bTranspose, i, n );
+}
+
+
+/**
+ * @ingroup math
+ * Solves <tt>a * x = b</tt> for symmetric positive definite matrices, as \c posv.
+ *
+ * @param a the matrices, only the lower triangles are read, overwritten with the cholesky factors
+ * @param b the right hand sides, overwritten with the solutions. The solutions of matrices that
+ *   are not positive definite are not usable.
+ * @param info see \c batchCholesky
+ * @return number of matrices that are not positive definite
+ */
+template< typename T, std::size_t N, std::size_t R >
+std::size_t batchCholeskySolve( MatrixBatch< T, N, N >& a, MatrixBatch< T, N, R >& b, std::vector< std::size_t >* info = 0 )
+{
+	const std::size_t nFailed = batchCholesky( a, info );
+	batchTriangularSolve( a, b, false );
+	batchTriangularSolve( a, b, true );
+	return nFailed;
+}
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_MATRIXBATCH_H_INCLUDED__
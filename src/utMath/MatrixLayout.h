@@ -0,0 +1,150 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Row-major storage for large temporaries that are filled row by row.
+ *
+ * \c Math::Matrix is column-major, as expected by BLAS and LAPACK. Jacobians and design
+ * matrices are usually filled with one or two rows per measurement, which writes across all
+ * columns with a stride of the number of rows. \c RowMajorMatrix< T >::type stores the rows
+ * contiguously instead, so these fills become sequential writes.
+ *
+ * The memory of a row-major M-by-N matrix is the column-major N-by-M transpose, and
+ * \c columnMajorTranspose returns this transpose as a view that can be passed to the
+ * BLAS / LAPACK bindings without copying, e.g. J^T J of a row-major jacobian is
+ * @code
+ * blas::syrk( 'L', 'N', T( 1 ), Math::columnMajorTranspose( jacobian ), T( 0 ), jtj );
+ * @endcode
+ */
+
+#ifndef __UBITRACK_MATH_MATRIXLAYOUT_H_INCLUDED__
+#define __UBITRACK_MATH_MATRIXLAYOUT_H_INCLUDED__
+
+#include <cstddef>
+#include <algorithm>
+
+#include <boost/type_traits/remove_const.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/bindings/traits/matrix_traits.hpp>
+
+#include "Matrix.h"
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * Dynamic-size matrix with the storage of \c Math::Matrix< T >, but row-major.
+ * @tparam T builtin type of matrix elements (e.g \c double or \c float )
+ */
+template< typename T >
+struct RowMajorMatrix
+{
+	typedef boost::numeric::ublas::matrix< T, boost::numeric::ublas::row_major, typename Math::Matrix< T >::base_type::array_type > type;
+};
+
+/**
+ * Column-major matrix view of external storage, for the BLAS / LAPACK bindings.
+ * @tparam T element type, \c const T for read-only views
+ */
+template< typename T >
+class ColumnMajorView
+{
+public:
+	typedef typename boost::remove_const< T >::type value_type;
+	typedef std::size_t size_type;
+
+	/**
+	 * @param data first element
+	 * @param size1 number of rows
+	 * @param size2 number of columns
+	 */
+	ColumnMajorView( T* data, const size_type size1, const size_type size2 )
+		: m_data( data )
+		, m_size1( size1 )
+		, m_size2( size2 )
+	{}
+
+	T* data() const
+	{ return m_data; }
+
+	size_type size1() const
+	{ return m_size1; }
+
+	size_type size2() const
+	{ return m_size2; }
+
+	T& operator()( const size_type i, const size_type j ) const
+	{ return m_data[ j * m_size1 + i ]; }
+
+protected:
+	T* m_data;
+	size_type m_size1;
+	size_type m_size2;
+};
+
+/** @return the transpose of a row-major matrix as a column-major view of the same storage */
+template< typename T, class A >
+ColumnMajorView< T > columnMajorTranspose( boost::numeric::ublas::matrix< T, boost::numeric::ublas::row_major, A >& m )
+{ return ColumnMajorView< T >( m.size1() && m.size2() ? &m.data()[ 0 ] : 0, m.size2(), m.size1() ); }
+
+/** @return the transpose of a row-major matrix as a read-only column-major view of the same storage */
+template< typename T, class A >
+ColumnMajorView< const T > columnMajorTranspose( const boost::numeric::ublas::matrix< T, boost::numeric::ublas::row_major, A >& m )
+{ return ColumnMajorView< const T >( m.size1() && m.size2() ? &m.data()[ 0 ] : 0, m.size2(), m.size1() ); }
+
+} } // namespace Ubitrack::Math
+
+
+namespace boost { namespace numeric { namespace bindings { namespace traits {
+
+/** @internal makes \c Math::ColumnMajorView usable with the BLAS / LAPACK bindings */
+template< typename T, typename M >
+struct matrix_detail_traits< Ubitrack::Math::ColumnMajorView< T >, M >
+{
+	typedef Ubitrack::Math::ColumnMajorView< T > identifier_type;
+	typedef M matrix_type;
+	typedef general_t matrix_structure;
+	typedef column_major_t ordering_type;
+	typedef typename boost::remove_const< T >::type value_type;
+	typedef T* pointer;
+
+	static pointer storage( matrix_type& m )
+	{ return m.data(); }
+
+	static int size1( matrix_type& m )
+	{ return static_cast< int >( m.size1() ); }
+
+	static int size2( matrix_type& m )
+	{ return static_cast< int >( m.size2() ); }
+
+	static int storage_size( matrix_type& m )
+	{ return size1( m ) * size2( m ); }
+
+	static int leading_dimension( matrix_type& m )
+	{ return std::max( size1( m ), 1 ); }
+};
+
+} } } } // namespace boost::numeric::bindings::traits
+
+#endif // __UBITRACK_MATH_MATRIXLAYOUT_H_INCLUDED__
@@ -0,0 +1,108 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Deadlines of anytime estimators
+ */
+
+#ifndef __UBITRACK_MATH_OPTIMIZATION_DEADLINE_H_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_DEADLINE_H_INCLUDED__
+
+#include <utMeasurement/Timestamp.h>
+
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+/**
+ * Point in time by which an iterative estimator has to return its best result so far.
+ *
+ * The estimators check the deadline once per iteration and stop as soon as it has passed, so
+ * they overrun it by at most one iteration. A default constructed deadline never passes.
+ * @code
+ * // 5 ms for the whole frame
+ * const Optimization::Deadline deadline( Optimization::Deadline::in( 5000000 ) );
+ *
+ * Optimization::RansacParameter< double > params( 0.01, 3, 20, std::size_t( 500 ) );
+ * params.deadline = deadline;
+ * Optimization::ransac( ..., params );
+ *
+ * Optimization::OptTerminateRecord criteria( 20, 1e-6, deadline );
+ * Optimization::levenbergMarquardt( problem, x, y, criteria, Optimization::OptNoNormalize() );
+ * if ( !criteria.converged() ) ...
+ * @endcode
+ *
+ * A deadline records whether a check found it passed, which \c expired() reports afterwards,
+ * i.e. whether an estimator returned early. Estimators that take parameters by value record
+ * in their copy. The record is not synchronized, so estimators running concurrently need
+ * their own copies.
+ */
+class Deadline
+{
+public:
+	/** a deadline that never passes */
+	Deadline()
+		: m_time( 0 )
+		, m_expired( false )
+	{}
+
+	/** a deadline at the given time, as returned by \c Measurement::now() */
+	explicit Deadline( const Measurement::Timestamp time )
+		: m_time( time )
+		, m_expired( false )
+	{}
+
+	/** a deadline \c duration nanoseconds from now */
+	static Deadline in( const Measurement::Timestamp duration )
+	{ return Deadline( Measurement::now() + duration ); }
+
+	/** true unless the deadline never passes */
+	bool isSet() const
+	{ return m_time != 0; }
+
+	/** the time of the deadline, 0 if it never passes */
+	Measurement::Timestamp time() const
+	{ return m_time; }
+
+	/** returns true and records it if the deadline has passed, called by the estimators in every iteration */
+	bool check() const
+	{
+		if ( !m_expired && m_time && Measurement::now() >= m_time )
+			m_expired = true;
+		return m_expired;
+	}
+
+	/** true if a check found the deadline passed, i.e. an estimator stopped early */
+	bool expired() const
+	{ return m_expired; }
+
+protected:
+	Measurement::Timestamp m_time;
+	mutable bool m_expired;
+};
+
+} } } // namespace Ubitrack::Math::Optimization
+
+#endif // __UBITRACK_MATH_OPTIMIZATION_DEADLINE_H_INCLUDED__
@@ -0,0 +1,213 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Powell's dogleg trust-region optimizer
+ *
+ * An alternative to the levenberg-marquardt optimizer with the same problem interface. The
+ * gauss-newton and steepest descent steps are computed once per jacobian and reused while the
+ * trust region radius is adapted, and rejected steps only evaluate the residuals. This saves
+ * jacobian evaluations on problems where levenberg-marquardt rejects many steps.
+ */ 
+
+#ifndef __UBITRACK_MATH_OPTIMIZATION_DOGLEG_H_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_DOGLEG_H_INCLUDED__
+
+#ifdef HAVE_LAPACK
+
+#include <algorithm> // std::swap, std::max
+#include <math.h> // sqrt
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include <boost/numeric/ublas/vector_proxy.hpp>
+
+#include <boost/numeric/bindings/blas/blas.hpp>
+#include <boost/numeric/bindings/lapack/posv.hpp>
+#include <boost/numeric/bindings/lapack/gelss.hpp>
+#include <boost/numeric/bindings/traits/ublas_vector2.hpp>
+
+#include "../Vector.h"
+#include "../Matrix.h"
+#include "Optimization.h"
+#include "OptTelemetry.h"
+#include <utUtil/Exception.h>
+
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+/**
+ * @ingroup math
+ * Optimize a given problem using Powell's dogleg method.
+ *
+ * In each iteration, the step is a combination of the gauss-newton step and the steepest descent
+ * step that lies within a trust region around the current parameters. The trust region grows
+ * when the residual decreases as predicted by the linearization and shrinks otherwise.
+ *
+ * @par The problem class
+ * The problem class P must be modeled after the UnaryFunctionPrototype and implement the functions
+ * \c evaluate, which computes the predicted measurement and is used for trial steps, and
+ * \c evaluateWithJacobian, which is only called for the initial and for accepted parameters.
+ *
+ * @param problem the problem to optimize -- provides measurement estimates and jacobians
+ * @param params initial parameters on entry, optimized parameters on exit
+ * @param measurement the measurement vector
+ * @param terminationCriteria functor that returns true if the optimization should terminate. Is called with
+ *   bool operator()( unsigned iteration, double currentError, double previousError ) after each
+ *   trial step
+ * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
+ * @param fRadius initial radius of the trust region, in units of the parameters
+ * @return the residual of the optimization process
+ */
+template< class P, class X, class Y, class TC, class NT > 
+typename X::value_type dogleg( P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
+	const typename X::value_type fRadius = 1.0 )
+{
+	namespace lapack = boost::numeric::bindings::lapack;
+	namespace blas = boost::numeric::bindings::blas;
+	namespace ublas = boost::numeric::ublas;
+	typedef typename X::value_type T;
+	typedef typename Math::Matrix< T >::base_type MatType;
+	typedef typename Math::Vector< T >::base_type VecType;
+
+	const std::size_t n_meas = measurement.size();
+	const std::size_t n_params = params.size();
+
+	MatType jacobian( n_meas, n_params );
+	MatType jacobiSquare( n_params, n_params );
+	VecType measurementDiff( n_meas );
+	VecType measurementDiff2( n_meas );
+	VecType estimatedMeasurement( n_meas );
+	VecType jacobianProduct( n_meas );
+	VecType gradient( n_params );
+	VecType stepGaussNewton( n_params );
+	VecType stepSteepest( n_params );
+	VecType step( n_params );
+	VecType newParams( n_params );
+	VecType singularValues( n_params );
+
+	// compute initial error
+	problem.evaluateWithJacobian( estimatedMeasurement, params, jacobian );
+	ublas::noalias( measurementDiff ) = measurement - estimatedMeasurement;
+	T fErrPrev = ublas::inner_prod( measurementDiff, measurementDiff );
+	OPT_LOG_DEBUG( "Dogleg residual 0: " << fErrPrev );
+	const OptTelemetryRun telemetry( "Dogleg" );
+	telemetry.iteration( 0, fErrPrev );
+
+	T fDelta = fRadius;
+	std::size_t iteration = 0;
+	bool bTerminate = false;
+	while ( !bTerminate )
+	{
+		// steps for the current jacobian: gradient g = J^T r, steepest descent alpha * g
+		blas::gemv( 'T', T( 1 ), jacobian, measurementDiff, T( 0 ), gradient );
+		const T gradNorm2 = ublas::inner_prod( gradient, gradient );
+		if ( gradNorm2 == T( 0 ) )
+			break;
+		blas::gemv( 'N', T( 1 ), jacobian, gradient, T( 0 ), jacobianProduct );
+		const T alpha = gradNorm2 / ublas::inner_prod( jacobianProduct, jacobianProduct );
+		ublas::noalias( stepSteepest ) = alpha * gradient;
+		const T steepestNorm = alpha * sqrt( gradNorm2 );
+
+		// gauss-newton step ( J^T J ) h = g
+		blas::syrk( 'L', 'T', T( 1 ), jacobian, T( 0 ), jacobiSquare );
+		ublas::noalias( stepGaussNewton ) = gradient;
+		if ( lapack::posv( 'L', jacobiSquare, stepGaussNewton ) != 0 )
+		{
+			OPT_LOG_DEBUG( "Error in cholesky decomposition, using SVD" );
+			blas::gemm( 'T', 'N', T( 1 ), jacobian, jacobian, T( 0 ), jacobiSquare );
+			ublas::noalias( stepGaussNewton ) = gradient;
+			int rank;
+			if ( lapack::gelss( jacobiSquare, stepGaussNewton, singularValues, T( -1 ), rank ) != 0 )
+				UBITRACK_THROW( "lapack::gelss returned an error" );
+		}
+		const T gaussNewtonNorm = ublas::norm_2( stepGaussNewton );
+
+		// try steps with decreasing radius until one reduces the error
+		bool bAccepted = false;
+		while ( !bAccepted && !bTerminate )
+		{
+			++iteration;
+
+			if ( gaussNewtonNorm <= fDelta )
+				ublas::noalias( step ) = stepGaussNewton;
+			else if ( steepestNorm >= fDelta )
+				ublas::noalias( step ) = ( fDelta / sqrt( gradNorm2 ) ) * gradient;
+			else
+			{
+				// intersection of the line from the steepest descent to the gauss-newton step with the trust region
+				ublas::noalias( newParams ) = stepGaussNewton - stepSteepest;
+				const T a = ublas::inner_prod( newParams, newParams );
+				const T b = ublas::inner_prod( stepSteepest, newParams );
+				const T c = steepestNorm * steepestNorm - fDelta * fDelta;
+				const T beta = b <= T( 0 ) ? ( -b + sqrt( b * b - a * c ) ) / a : -c / ( b + sqrt( b * b - a * c ) );
+				ublas::noalias( step ) = stepSteepest + beta * newParams;
+			}
+			const T stepNorm = ublas::norm_2( step );
+
+			// decrease of the error predicted by the linearization, ||r||^2 - ||r - J h||^2
+			blas::gemv( 'N', T( 1 ), jacobian, step, T( 0 ), jacobianProduct );
+			const T fPredicted = 2 * ublas::inner_prod( step, gradient ) - ublas::inner_prod( jacobianProduct, jacobianProduct );
+
+			ublas::noalias( newParams ) = params + step;
+			normalize.evaluate( newParams, newParams );
+
+			// trial steps only need the residual
+			problem.evaluate( estimatedMeasurement, newParams );
+			ublas::noalias( measurementDiff2 ) = measurement - estimatedMeasurement;
+			const T fErr = ublas::inner_prod( measurementDiff2, measurementDiff2 );
+			OPT_LOG_DEBUG( "Dogleg residual " << iteration << ": " << fErr << ", radius " << fDelta );
+			telemetry.iteration( iteration, fErr, fDelta );
+
+			bTerminate = terminationCriteria( iteration, fErr, fErrPrev ) || !( fPredicted > T( 0 ) );
+
+			// adapt the trust region
+			const T rho = ( fErrPrev - fErr ) / fPredicted;
+			if ( rho > T( 0.75 ) )
+				fDelta = std::max( fDelta, 3 * stepNorm );
+			else if ( rho < T( 0.25 ) )
+				fDelta = stepNorm / 2;
+
+			if ( fErr < fErrPrev )
+			{
+				bAccepted = true;
+				ublas::noalias( params ) = newParams;
+				fErrPrev = fErr;
+				if ( !bTerminate )
+				{
+					problem.evaluateWithJacobian( estimatedMeasurement, params, jacobian );
+					ublas::noalias( measurementDiff ) = measurement - estimatedMeasurement;
+				}
+			}
+		}
+	}
+
+	return fErrPrev;
+}
+
+}}} // namespace Ubitrack::Math::Optimization
+
+#endif	// HAVE_LAPACK
+
+#endif
@@ -26,18 +26,61 @@
  * @file
  * Downhill Simplex Optimizer
  *
+ * Besides the sequential \c downhillSimplex, \c parallelDownhillSimplex evaluates the candidate
+ * points of each iteration and the vertices of a shrink step concurrently, and
+ * \c multiStartDownhillSimplex runs several independent simplices at the same time. Both distribute
+ * the evaluations with a \c Math::ListExecutor. As only a few points are evaluated at a time, create
+ * the executor with a chunk size of one, e.g. <tt>Math::threadExecutor( 4, 1 )</tt>. The \c evaluate
+ * function of the problem and the termination criterion are then called from several threads.
+ *
  * @author Daniel Pustka <daniel.pustka@in.tum.de>
  */ 
  
 #ifndef __UBITRACK_MATH_DOWNHILLSIMPLEX_INCLUDED__
 #define __UBITRACK_MATH_DOWNHILLSIMPLEX_INCLUDED__
 
+#include <vector>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 
 #include "Optimization.h"
+#include "../PoseListOperations.h"	// ListExecutor
 
 namespace Ubitrack { namespace Math { namespace Optimization {
 
+/**
+ * function internally used by the simplex optimizer
+ * \internal
+ */
+template<  class T, class P, class VT2, class NT > 
+T downhillSimplexTry( Math::Matrix< T, 0, 0 >& p, Math::Vector< T >& y, 
+	Math::Vector< T >& psum, P& problem, unsigned ihi, T fac, Math::Vector< T >& eval, 
+	const VT2& measurement, const NT& normalize )
+{
+	namespace ublas = boost::numeric::ublas;
+	unsigned ndim = psum.size();
+	T fac1 = ( T( 1 ) - fac ) / ndim;
+	T fac2 = fac1 - fac;
+
+	// compute the trial point
+	Math::Vector< T > ptry( psum * fac1 - ublas::row( p, ihi ) * fac2 );
+	normalize.evaluate( ptry, ptry );
+
+	// evaluate
+	problem.evaluate( eval, ptry );
+	T ytry = ublas::norm_2( eval - measurement );
+
+	// replace the highest if the trial is better
+	if ( ytry < y( ihi ) )
+	{
+		y( ihi ) = ytry;
+		noalias( psum ) += ptry - ublas::row( p, ihi );
+		noalias( ublas::row( p, ihi ) ) = ptry;
+	}
+
+	return ytry;
+}
+
+
 /**
  * Downhill simplex minimizer  la Nelder and Mead (1965).
  * Adapted to boost::ublas from numerical recipes.
@@ -59,7 +102,7 @@ typename VT1::value_type downhillSimplex( const P& problem, VT1& params, const V
 
 	// initialize the starting points of the simplex
 	unsigned ndim = params.size();
-	Math::Matrix< VType, 0, 0 > p( ndim + 1, ndim );
+	Math::Matrix< T, 0, 0 > p( ndim + 1, ndim );
 	ublas::row( p, 0 ) = params;
 	for ( unsigned i = 1; i <= ndim; i++ )
 	{
@@ -155,39 +198,298 @@ typename VT1::value_type downhillSimplex( const P& problem, VT1& params, const V
 }
 
 
+namespace Detail {
+
+/** @internal evaluates the residuals of the given rows of a point matrix */
+template< class P, class VT2, typename T >
+struct SimplexEvaluation
+{
+	SimplexEvaluation( const P& problem, const VT2& measurement, const Math::Matrix< T, 0, 0 >& points, 
+		const std::vector< unsigned >& rows, Math::Vector< T >& y )
+		: m_problem( problem )
+		, m_measurement( measurement )
+		, m_points( points )
+		, m_rows( rows )
+		, m_y( y )
+	{}
+
+	void operator()( const std::size_t begin, const std::size_t end ) const
+	{
+		namespace ublas = boost::numeric::ublas;
+		Math::Vector< T > eval( m_problem.size() );
+		for ( std::size_t i = begin; i < end; i++ )
+		{
+			m_problem.evaluate( eval, ublas::row( m_points, m_rows[ i ] ) );
+			m_y( m_rows[ i ] ) = ublas::norm_2( eval - m_measurement );
+		}
+	}
+
+	const P& m_problem;
+	const VT2& m_measurement;
+	const Math::Matrix< T, 0, 0 >& m_points;
+	const std::vector< unsigned >& m_rows;
+	Math::Vector< T >& m_y;
+};
+
+/** @internal evaluates the given rows of a point matrix with the executor */
+template< class P, class VT2, typename T >
+void evaluateSimplexPoints( const P& problem, const VT2& measurement, const Math::Matrix< T, 0, 0 >& points, 
+	const std::vector< unsigned >& rows, Math::Vector< T >& y, const Math::ListExecutor& executor )
+{
+	const SimplexEvaluation< P, VT2, T > task( problem, measurement, points, rows, y );
+	if ( executor.empty() )
+		task( 0, rows.size() );
+	else
+		executor( rows.size(), boost::cref( task ) );
+}
+
+/** @internal computes the point of \c downhillSimplexTry for the factor fac */
+template< typename T, class VT, class NT >
+void simplexTrialPoint( const Math::Vector< T >& psum, const VT& pHigh, const T fac, 
+	Math::Matrix< T, 0, 0 >& trials, const unsigned row, const NT& normalize )
+{
+	namespace ublas = boost::numeric::ublas;
+	const unsigned ndim = psum.size();
+	const T fac1 = ( T( 1 ) - fac ) / ndim;
+	const T fac2 = fac1 - fac;
+
+	ublas::matrix_row< Math::Matrix< T, 0, 0 > > trial( trials, row );
+	noalias( trial ) = psum * fac1 - pHigh * fac2;
+	normalize.evaluate( trial, trial );
+}
+
+/** @internal replaces the highest point by a trial point, if the trial is better */
+template< typename T >
+void simplexReplace( Math::Matrix< T, 0, 0 >& p, Math::Vector< T >& y, Math::Vector< T >& psum, 
+	const unsigned ihi, const Math::Matrix< T, 0, 0 >& trials, const unsigned row, const T ytry )
+{
+	namespace ublas = boost::numeric::ublas;
+	if ( ytry < y( ihi ) )
+	{
+		y( ihi ) = ytry;
+		noalias( psum ) += ublas::row( trials, row ) - ublas::row( p, ihi );
+		noalias( ublas::row( p, ihi ) ) = ublas::row( trials, row );
+	}
+}
+
+/** @internal runs the sequential simplex for the starting points [ begin, end ) */
+template< class P, class VT1, class VT2, class TC, class NT >
+struct MultiStartSimplex
+{
+	MultiStartSimplex( const P& problem, std::vector< VT1 >& params, const VT2& measurement, 
+		const TC& terminationCriteria, const NT& normalize, std::vector< typename VT1::value_type >& residuals )
+		: m_problem( problem )
+		, m_params( params )
+		, m_measurement( measurement )
+		, m_terminationCriteria( terminationCriteria )
+		, m_normalize( normalize )
+		, m_residuals( residuals )
+	{}
+
+	void operator()( const std::size_t begin, const std::size_t end ) const
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+			m_residuals[ i ] = downhillSimplex( m_problem, m_params[ i ], m_measurement, m_terminationCriteria, m_normalize );
+	}
+
+	const P& m_problem;
+	std::vector< VT1 >& m_params;
+	const VT2& m_measurement;
+	const TC& m_terminationCriteria;
+	const NT& m_normalize;
+	std::vector< typename VT1::value_type >& m_residuals;
+};
+
+} // namespace Detail
+
+
 /**
- * function internally used by the simplex optimizer
- * \internal
+ * Downhill simplex minimizer as \c downhillSimplex, which evaluates the problem concurrently.
+ *
+ * Each iteration computes the reflection, expansion and both contractions of the highest point in
+ * advance and evaluates them at the same time, the shrink step evaluates all moved vertices at the
+ * same time. The decisions are the same as in \c downhillSimplex, so the result is the same, but an
+ * iteration takes a single round of evaluations instead of up to three, at the price of up to two
+ * unused evaluations.
+ *
+ * @param problem problem class, must have an evaluate(...) method that can be called concurrently.
+ * @param params initial parameters, replaced by result at the end
+ * @param measurement goal of the function
+ * @param terminationCriteria when to terminate
+ * @param executor distributes the evaluations, the default evaluates in the calling thread
+ * @param normalize normalization function
  */
-template<  class T, class P, class VT2, class NT > 
-T downhillSimplexTry( Math::Matrix< T, 0, 0 >& p, Math::Vector< T >& y, 
-	Math::Vector< T >& psum, P& problem, unsigned ihi, T fac, Math::Vector< T >& eval, 
-	const VT2& measurement, const NT& normalize )
+template< class P, class VT1, class VT2, class TC, class NT > 
+typename VT1::value_type parallelDownhillSimplex( const P& problem, VT1& params, const VT2& measurement, 
+	const TC& terminationCriteria, const Math::ListExecutor& executor, const NT& normalize )
 {
 	namespace ublas = boost::numeric::ublas;
-	unsigned ndim = psum.size();
-	T fac1 = ( T( 1 ) - fac ) / ndim;
-	T fac2 = fac1 - fac;
+	typedef typename VT1::value_type T;
 
-	// compute the trial point
-	Math::Vector< T > ptry( psum * fac1 - ublas::row( p, ihi ) * fac2 );
-	normalize.evaluate( ptry, ptry );
+	// initialize the starting points of the simplex
+	unsigned ndim = params.size();
+	Math::Matrix< T, 0, 0 > p( ndim + 1, ndim );
+	ublas::row( p, 0 ) = params;
+	for ( unsigned i = 1; i <= ndim; i++ )
+	{
+		ublas::matrix_row< Math::Matrix< T, 0, 0 > > subrow( p, i );
+		subrow = params;
+		p( i, i-1 ) *= T( 1.48529 );
+		normalize.evaluate( subrow, subrow );
+	}
 
-	// evaluate
-	problem.evaluate( eval, ptry );
-	T ytry = ublas::norm_2( eval - measurement );
+	// evaluate the function for these points
+	Math::Vector< T > y( ndim + 1 );
+	std::vector< unsigned > rows;
+	for ( unsigned i = 0; i <= ndim; i++ )
+		rows.push_back( i );
+	Detail::evaluateSimplexPoints( problem, measurement, p, rows, y, executor );
 
-	// replace the highest if the trial is better
-	if ( ytry < y( ihi ) )
+	// reflection, expansion, outside and inside contraction
+	enum { reflection, expansion, outside, inside, nTrials };
+	Math::Matrix< T, 0, 0 > trials( nTrials, ndim );
+	Math::Vector< T > ytrials( nTrials );
+	std::vector< unsigned > trialRows;
+	for ( unsigned i = 0; i < nTrials; i++ )
+		trialRows.push_back( i );
+
+	// number of iterations
+	unsigned nfunk = 0;
+
+	// the sum of all simplex points
+	Math::Vector< T > psum( ublas::row( p, 0 ) );
+	for ( unsigned i = 1; i <= ndim; i++ )
+		noalias( psum ) += ublas::row( p, i );
+	Math::Vector< T > psumReflected( ndim );
+
+	while ( true )
 	{
-		y( ihi ) = ytry;
-		noalias( psum ) += ptry - ublas::row( p, ihi );
-		noalias( ublas::row( p, ihi ) ) = ptry;
+		// find lowest, highest and next-highest points
+		unsigned ilo = 0;
+		unsigned ihi, inhi;
+		if ( y( 0 ) > y( 1 ) )
+			ihi = 0, inhi = 1;
+		else
+			ihi = 1, inhi = 0;
+		for ( unsigned i = 0; i <= ndim; i++ )
+		{
+			if ( y( i ) <= y( ilo ) )
+				ilo = i;
+			if ( y( i ) > y( ihi ) )
+			{
+				inhi = ihi;
+				ihi = i;
+			}
+			else if ( y( i ) > y( inhi ) && i != ihi )
+				inhi = i;
+		}
+
+		// check for termination
+		if ( terminationCriteria( nfunk, y( ilo ), y( ihi ) ) )
+		{
+			noalias( params ) = ublas::row( p, ilo );
+			return y( ilo );
+		}
+
+		nfunk += 2;
+
+		// all candidates, expansion and outside contraction start from the simplex with the reflected point
+		Detail::simplexTrialPoint( psum, ublas::row( p, ihi ), T( -1 ), trials, reflection, normalize );
+		noalias( psumReflected ) = psum + ( ublas::row( trials, reflection ) - ublas::row( p, ihi ) );
+		Detail::simplexTrialPoint( psumReflected, ublas::row( trials, reflection ), T( 2 ), trials, expansion, normalize );
+		Detail::simplexTrialPoint( psumReflected, ublas::row( trials, reflection ), T( 0.5 ), trials, outside, normalize );
+		Detail::simplexTrialPoint( psum, ublas::row( p, ihi ), T( 0.5 ), trials, inside, normalize );
+		Detail::evaluateSimplexPoints( problem, measurement, trials, trialRows, ytrials, executor );
+
+		// same decisions as the sequential version
+		const bool bReflected = ytrials( reflection ) < y( ihi );
+		Detail::simplexReplace( p, y, psum, ihi, trials, reflection, ytrials( reflection ) );
+		if ( ytrials( reflection ) <= y( ilo ) )
+			// better => take extrapolation by 2
+			Detail::simplexReplace( p, y, psum, ihi, trials, expansion, ytrials( expansion ) );
+		else if ( ytrials( reflection ) >= y( inhi ) )
+		{
+			// worse => take intermediate lower point
+			const T ysave = y( ihi );
+			const unsigned contraction = bReflected ? outside : inside;
+			Detail::simplexReplace( p, y, psum, ihi, trials, contraction, ytrials( contraction ) );
+			if ( ytrials( contraction ) >= ysave )
+			{
+				// contract around lowest point
+				rows.clear();
+				for ( unsigned i = 0; i <= ndim; i++ )
+					if ( i != ilo )
+					{
+						ublas::matrix_row< Math::Matrix< T, 0, 0 > > subrow( p, i );
+						noalias( subrow ) += ublas::row( p, ilo );
+						subrow *= T( 0.5 );
+						normalize.evaluate( subrow, subrow );
+						rows.push_back( i );
+					}
+				Detail::evaluateSimplexPoints( problem, measurement, p, rows, y, executor );
+
+				nfunk += ndim;
+
+				// recompute psum
+				noalias( psum ) = ublas::row( p, 0 );
+				for ( unsigned i = 1; i <= ndim; i++ )
+					noalias( psum ) += ublas::row( p, i );
+			}
+		}
+		else
+			nfunk--;
 	}
+}
 
-	return ytry;
+/** same as above without normalization */
+template< class P, class VT1, class VT2, class TC > 
+typename VT1::value_type parallelDownhillSimplex( const P& problem, VT1& params, const VT2& measurement, 
+	const TC& terminationCriteria, const Math::ListExecutor& executor )
+{ return parallelDownhillSimplex( problem, params, measurement, terminationCriteria, executor, OptNoNormalize() ); }
+
+
+/**
+ * Runs \c downhillSimplex for several starting points at the same time, e.g. to find the global
+ * minimum of a problem with several local minima.
+ *
+ * @param problem problem class, must have an evaluate(...) method that can be called concurrently.
+ * @param params initial parameters of each simplex, replaced by the results at the end
+ * @param measurement goal of the function
+ * @param terminationCriteria when to terminate each simplex
+ * @param residuals resized to the number of starting points and filled with the residuals of the results
+ * @param executor distributes the simplices, the default runs them one after another
+ * @param normalize normalization function
+ * @return the index of the result with the smallest residual
+ */
+template< class P, class VT1, class VT2, class TC, class NT > 
+std::size_t multiStartDownhillSimplex( const P& problem, std::vector< VT1 >& params, const VT2& measurement, 
+	const TC& terminationCriteria, std::vector< typename VT1::value_type >& residuals, 
+	const Math::ListExecutor& executor, const NT& normalize )
+{
+	residuals.resize( params.size() );
+	if ( params.empty() )
+		return 0;
+
+	const Detail::MultiStartSimplex< P, VT1, VT2, TC, NT > task( problem, params, measurement, terminationCriteria, normalize, residuals );
+	if ( executor.empty() )
+		task( 0, params.size() );
+	else
+		executor( params.size(), boost::cref( task ) );
+
+	std::size_t best = 0;
+	for ( std::size_t i = 1; i < residuals.size(); i++ )
+		if ( residuals[ i ] < residuals[ best ] )
+			best = i;
+	return best;
 }
 
+/** same as above without normalization */
+template< class P, class VT1, class VT2, class TC > 
+std::size_t multiStartDownhillSimplex( const P& problem, std::vector< VT1 >& params, const VT2& measurement, 
+	const TC& terminationCriteria, std::vector< typename VT1::value_type >& residuals, 
+	const Math::ListExecutor& executor = Math::ListExecutor() )
+{ return multiStartDownhillSimplex( problem, params, measurement, terminationCriteria, residuals, executor, OptNoNormalize() ); }
+
 
 }}} // namespace Ubitrack::Math::Optimization
 
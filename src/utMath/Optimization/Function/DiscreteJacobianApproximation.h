@@ -29,23 +29,69 @@
  * This class will automatically add the evaluateWithJacobian() and jacobian() methods
  * to any function class that only implements evaluate().
  *
+ * For functions with many parameters the columns can be computed in parallel by setting
+ * a \c ListExecutor, and parameters that influence disjoint sets of results can be
+ * perturbed together by setting the sparsity pattern of the jacobian:
+ * @code
+ * Function::DiscreteJacobianApproximation< Model > f( model );
+ * f.setScheme( Function::DiscreteJacobianApproximation< Model >::centralDifference );
+ * f.setExecutor( Math::threadExecutor( 4, 8 ) );
+ * f.setSparsity( pattern );
+ * @endcode
+ *
  * @author Daniel Pustka <daniel.pustka@in.tum.de>
  */
 
+#ifndef __UBITRACK_MATH_OPTIMIZATION_FUNCTION_DISCRETEJACOBIANAPPROXIMATION_H_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_FUNCTION_DISCRETEJACOBIANAPPROXIMATION_H_INCLUDED__
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <boost/ref.hpp>
+
+#include <utUtil/Exception.h>
 #include <utMath/Vector.h>
+#include <utMath/PoseListOperations.h> // ListExecutor
 #include <boost/numeric/ublas/matrix_proxy.hpp> // column
  
 namespace Ubitrack { namespace Math { namespace Optimization { namespace Function {
  
 /**
  * Function class that numerically approximates the jacobian of a function.
- * This requires n function evaluations for each jacobian computation, where n is the size of the
- * input vector.
+ * This requires n function evaluations for each jacobian computation (2n for central
+ * differences), where n is the size of the input vector, or the number of groups of
+ * structurally independent parameters if a sparsity pattern is set.
+ *
+ * If an executor is set, \c FC::evaluate is called from several threads at the same time
+ * and must not modify shared state.
  */
 template< class FC >
 class DiscreteJacobianApproximation
 {
 public:
+	/** finite difference formula */
+	enum DifferenceScheme
+	{
+		/** ( f( x + h ) - f( x ) ) / h, one evaluation per column */
+		forwardDifference,
+		/** ( f( x + h ) - f( x - h ) ) / 2h, two evaluations per column but more accurate */
+		centralDifference
+	};
+
+	/** choice of the step size h for a parameter x */
+	enum StepPolicy
+	{
+		/** h = width * x, or width if x is zero */
+		relativeStep,
+		/** h = width * max( 1, |x| ), also for parameters close to zero */
+		scaledStep
+	};
+
+	/** for each parameter the indices of the results that depend on it */
+	typedef std::vector< std::vector< std::size_t > > SparsityPattern;
+
 	/**
 	 * construct a new approximation.
 	 * @param f the function object whose jacobian is to be estimated
@@ -55,6 +101,8 @@ public:
 	DiscreteJacobianApproximation( const FC& f, double fApproxWidth = 0.001 )
 		: m_f( f )
 		, m_fApproxWidth( fApproxWidth )
+		, m_scheme( forwardDifference )
+		, m_stepPolicy( relativeStep )
 	{}
 	
 	/**
@@ -62,7 +110,61 @@ public:
 	 */
 	unsigned size() const
 	{ return m_f.size(); }
-	
+
+	/** sets the finite difference formula, the default is \c forwardDifference */
+	void setScheme( const DifferenceScheme scheme )
+	{ m_scheme = scheme; }
+
+	/** sets the step size policy, the default is \c relativeStep */
+	void setStepPolicy( const StepPolicy policy )
+	{ m_stepPolicy = policy; }
+
+	/** distributes the columns of the jacobian over an executor, an empty one computes them sequentially */
+	void setExecutor( const ListExecutor& executor )
+	{ m_executor = executor; }
+
+	/**
+	 * sets the sparsity pattern of the jacobian. Parameters are grouped such that no two
+	 * parameters of a group influence the same result, and all parameters of a group are
+	 * perturbed in the same evaluation. Entries outside the pattern are set to zero.
+	 * An empty pattern perturbs each parameter on its own.
+	 */
+	void setSparsity( const SparsityPattern& pattern )
+	{
+		m_pattern = pattern;
+		m_groups.clear();
+
+		// greedy coloring, a parameter joins the first group that shares no result with it
+		std::vector< std::vector< bool > > usedRows;
+		for ( std::size_t j = 0; j < pattern.size(); j++ )
+		{
+			std::size_t g = 0;
+			for ( ; g < m_groups.size(); g++ )
+			{
+				bool bFree = true;
+				for ( std::size_t k = 0; k < pattern[ j ].size() && bFree; k++ )
+					bFree = pattern[ j ][ k ] >= usedRows[ g ].size() || !usedRows[ g ][ pattern[ j ][ k ] ];
+				if ( bFree )
+					break;
+			}
+			if ( g == m_groups.size() )
+			{
+				m_groups.push_back( std::vector< std::size_t >() );
+				usedRows.push_back( std::vector< bool >() );
+			}
+			m_groups[ g ].push_back( j );
+			for ( std::size_t k = 0; k < pattern[ j ].size(); k++ )
+			{
+				if ( pattern[ j ][ k ] >= usedRows[ g ].size() )
+					usedRows[ g ].resize( pattern[ j ][ k ] + 1, false );
+				usedRows[ g ][ pattern[ j ][ k ] ] = true;
+			}
+		}
+	}
+
+	/** number of evaluations of the function per jacobian, without the one at the input */
+	std::size_t evaluationsPerJacobian( const std::size_t inputSize ) const
+	{ return ( m_groups.empty() ? inputSize : m_groups.size() ) * ( m_scheme == centralDifference ? 2 : 1 ); }
 
 	/**
 	 * Evaluate the function on the input \c input and store the result in
@@ -88,33 +190,19 @@ public:
 	template< class VT1, class VT2, class MT > 
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
 	{
-		
+		if ( !m_groups.empty() && m_pattern.size() != input.size() )
+			UBITRACK_THROW( "Sparsity pattern does not match the number of parameters" );
+
 		// evaluate at initial position
 		m_f.evaluate( result, input );
-		
+
 		// evaluate for each discretization point
-		unsigned inputSize = input.size();
-		Math::Vector< typename VT1::value_type > testResult( m_f.size() );
-		Math::Vector< typename VT2::value_type > testInput( input );
-		for ( unsigned i = 0; i < inputSize; i++ )
-		{
-			// slightly modify the input
-			double eps;
-			if ( testInput( i ) != 0 )
-				eps = testInput( i ) * m_fApproxWidth;
-			else
-				eps = m_fApproxWidth;
-
-			testInput( i ) = input( i ) + eps;
-				
-			m_f.evaluate( testResult, testInput );
-			
-			// compute jacobian column
-			boost::numeric::ublas::column( J, i ) = ( testResult - result ) / eps;
-			
-			// reset testInput
-			testInput( i ) = input( i );
-		}
+		const ColumnTask< VT1, VT2, MT > task( *this, result, input, J );
+		const std::size_t nTasks = m_groups.empty() ? input.size() : m_groups.size();
+		if ( m_executor.empty() )
+			task( 0, nTasks );
+		else if ( nTasks )
+			m_executor( nTasks, boost::cref( task ) );
 	}
 
 	/**
@@ -133,8 +221,106 @@ public:
 	}
 	
 protected:
+	/// @internal computes the jacobian columns of a range of parameters or parameter groups
+	template< class VT1, class VT2, class MT >
+	struct ColumnTask
+	{
+		const DiscreteJacobianApproximation& self;
+		const VT1& result;
+		const VT2& input;
+		MT& J;
+
+		ColumnTask( const DiscreteJacobianApproximation& s, const VT1& r, const VT2& i, MT& j )
+			: self( s ), result( r ), input( i ), J( j )
+		{}
+
+		void operator()( const std::size_t begin, const std::size_t end ) const
+		{
+			typedef typename VT2::value_type T;
+
+			// buffers are shared by all columns of the range
+			Math::Vector< typename VT1::value_type > plus( self.m_f.size() );
+			Math::Vector< typename VT1::value_type > minus( self.m_f.size() );
+			Math::Vector< T > testInput( input );
+			Math::Vector< T > steps( input.size() );
+			const bool bCentral = self.m_scheme == centralDifference;
+
+			for ( std::size_t t = begin; t < end; t++ )
+			{
+				const std::size_t nColumns = self.m_groups.empty() ? 1 : self.m_groups[ t ].size();
+
+				// slightly modify the input
+				for ( std::size_t c = 0; c < nColumns; c++ )
+				{
+					const std::size_t i = column( t, c );
+					steps( i ) = self.step( input( i ) );
+					testInput( i ) = input( i ) + steps( i );
+				}
+				self.m_f.evaluate( plus, testInput );
+
+				if ( bCentral )
+				{
+					for ( std::size_t c = 0; c < nColumns; c++ )
+					{
+						const std::size_t i = column( t, c );
+						testInput( i ) = input( i ) - steps( i );
+					}
+					self.m_f.evaluate( minus, testInput );
+				}
+
+				// compute jacobian columns and reset testInput
+				for ( std::size_t c = 0; c < nColumns; c++ )
+				{
+					const std::size_t i = column( t, c );
+					const T width = bCentral ? 2 * steps( i ) : steps( i );
+					if ( self.m_groups.empty() )
+					{
+						if ( bCentral )
+							boost::numeric::ublas::column( J, i ) = ( plus - minus ) / width;
+						else
+							boost::numeric::ublas::column( J, i ) = ( plus - result ) / width;
+					}
+					else
+					{
+						boost::numeric::ublas::column( J, i ) = boost::numeric::ublas::zero_vector< T >( J.size1() );
+						const std::vector< std::size_t >& rows( self.m_pattern[ i ] );
+						for ( std::size_t k = 0; k < rows.size(); k++ )
+							J( rows[ k ], i ) = ( plus( rows[ k ] ) - ( bCentral ? minus( rows[ k ] ) : result( rows[ k ] ) ) ) / width;
+					}
+					testInput( i ) = input( i );
+				}
+			}
+		}
+
+		/// index of the c-th parameter of task t
+		std::size_t column( const std::size_t t, const std::size_t c ) const
+		{ return self.m_groups.empty() ? t : self.m_groups[ t ][ c ]; }
+	};
+
+	/// step size for a parameter, rounded such that x + h is exactly representable
+	template< typename T >
+	T step( const T x ) const
+	{
+		T h;
+		if ( m_stepPolicy == scaledStep )
+			h = T( m_fApproxWidth * std::max( T( 1 ), T( std::fabs( x ) ) ) );
+		else if ( x != 0 )
+			h = T( x * m_fApproxWidth );
+		else
+			h = T( m_fApproxWidth );
+		volatile T xh = x + h;
+		return xh - x;
+	}
+
 	FC m_f;
 	double m_fApproxWidth;
+	DifferenceScheme m_scheme;
+	StepPolicy m_stepPolicy;
+	ListExecutor m_executor;
+	SparsityPattern m_pattern;
+	std::vector< std::vector< std::size_t > > m_groups;
 };
 
 }}}} // namespace Ubitrack::Math::Optimization::Function
+
+#endif // __UBITRACK_MATH_OPTIMIZATION_FUNCTION_DISCRETEJACOBIANAPPROXIMATION_H_INCLUDED__
@@ -40,6 +40,9 @@ namespace Ubitrack { namespace Math { namespace Optimization { namespace Functio
  * You do not need to explicitly derive from this class!
  *
  * In most cases, implementing only the \c evaluateWithJacobian is sufficient.
+ * If \c evaluate and \c jacobian are implemented as well, the optimizers only
+ * compute the residuals for trial steps and the jacobian only for accepted steps.
+ * This pays off if \c evaluate is considerably cheaper than \c evaluateWithJacobian.
  */
 struct UnaryFunctionPrototype
 {
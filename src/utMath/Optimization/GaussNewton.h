@@ -33,16 +33,18 @@
 #define __UBITRACK_MATH_GAUSSNEWTON_INCLUDED__
 
 #include "Optimization.h"
+#include "OptTelemetry.h"
 
 #include <utMath/Matrix.h>
 #include <utMath/Vector.h>
 #include <utUtil/Exception.h>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/vector_proxy.hpp>
+#include <limits>
 
 #include <boost/numeric/bindings/blas/blas.hpp>
 #include <boost/numeric/bindings/lapack/posv.hpp>
-#include <boost/numeric/bindings/lapack/gels.hpp>
+#include <boost/numeric/bindings/lapack/gelss.hpp>
 #include <boost/numeric/bindings/traits/ublas_vector2.hpp>
 
 
@@ -50,6 +52,204 @@
 
 namespace Ubitrack { namespace Math { namespace Optimization {
 
+/**
+ * @ingroup math
+ * Stateful Gauss-Newton optimizer for streaming refinement, e.g. of a tracked pose from frame to frame.
+ *
+ * The object keeps its buffers between calls to \c optimize, so they are only reallocated when the
+ * size of the problem changes. The caller passes the solution of the previous frame as initial
+ * parameters, and the iterations stop as soon as the norm of the update falls below a threshold,
+ * which for slowly changing parameters usually happens after one or two iterations:
+ * @code
+ * Optimization::IncrementalGaussNewton< double > optimizer( 10, 1e-8 );
+ * while ( nextFrame( measurement ) )
+ *     optimizer.optimize( problem, params, measurement, normalize );
+ * @endcode
+ *
+ * If the problem implements \c evaluate and \c jacobian of the \c UnaryFunctionPrototype in addition to
+ * \c evaluateWithJacobian, the jacobian and the cholesky factorization of the normal equations are
+ * kept and reused for the following iterations and calls, which then only evaluate the residual.
+ * They are recomputed as soon as an update does not shrink to at least half of the previous one.
+ * Otherwise each iteration computes a new jacobian as \c gaussNewton does.
+ */
+template< typename T >
+class IncrementalGaussNewton
+{
+public:
+	typedef typename Math::Matrix< T >::base_type matrix_type;
+	typedef typename Math::Vector< T >::base_type vector_type;
+
+	/**
+	 * Constructor.
+	 * @param maxIterations maximum number of iterations per call to \c optimize
+	 * @param updateThreshold stops if the norm of the parameter update is below this value
+	 * @param reuseFactorization keep the jacobian and factorization of previous iterations, if the problem allows it
+	 */
+	IncrementalGaussNewton( const std::size_t maxIterations = 10, const T updateThreshold = T( 1e-8 ), const bool reuseFactorization = true )
+		: m_maxIterations( maxIterations )
+		, m_updateThreshold( updateThreshold )
+		, m_bReuseFactorization( reuseFactorization )
+		, m_bFactorized( false )
+		, m_iterations( 0 )
+		, m_jacobians( 0 )
+		, m_bConverged( false )
+	{}
+
+	/**
+	 * Runs Gauss-Newton iterations until the update is below the threshold or the maximum number of iterations is reached.
+	 *
+	 * @param problem the problem to optimize -- provides measurement estimates and jacobians
+	 * @param params initial parameters on entry, e.g. the result of the previous frame, optimized parameters on exit
+	 * @param measurement the measurement vector
+	 * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
+	 * @return the residual before the last update
+	 */
+	template< class P, class VT1, class VT2, class NT >
+	T optimize( P& problem, VT1& params, const VT2& measurement, const NT& normalize )
+	{
+		namespace blas = boost::numeric::bindings::blas;
+		namespace ublas = boost::numeric::ublas;
+
+		resize( measurement.size(), params.size() );
+		Detail::HasResidualEvaluation< P, vector_type, VT1, matrix_type > residualOnly;
+
+		m_iterations = 0;
+		m_jacobians = 0;
+		m_bConverged = false;
+		T fRes( 0 );
+		T fPrevNorm( std::numeric_limits< T >::max() );
+		const OptTelemetryRun telemetry( "Gauss-Newton" );
+		while ( !m_bConverged && m_iterations < m_maxIterations )
+		{
+			++m_iterations;
+
+			// the stored jacobian is only kept, if the problem can evaluate the residual alone
+			bool bJacobian = true;
+			if ( m_bReuseFactorization && m_bFactorized )
+				bJacobian = Detail::evaluateTrial( problem, m_estimatedMeasurement, params, m_jacobian, residualOnly );
+			else
+				problem.evaluateWithJacobian( m_estimatedMeasurement, params, m_jacobian );
+
+			ublas::noalias( m_measurementDiff ) = measurement - m_estimatedMeasurement;
+			fRes = ublas::inner_prod( m_measurementDiff, m_measurementDiff );
+			OPT_LOG_DEBUG( "Gauss-Newton residual " << m_iterations << ": " << fRes );
+			telemetry.iteration( m_iterations, fRes );
+
+			if ( bJacobian )
+			{
+				++m_jacobians;
+				factorize();
+			}
+
+			// solve ( J^T J ) step = J^T diff
+			blas::gemv( 'T', T( 1 ), m_jacobian, m_measurementDiff, T( 0 ), m_paramDiff );
+			solve();
+
+			noalias( params ) += m_paramDiff;
+			normalize.evaluate( params, params );
+
+			const T fNorm = ublas::norm_2( m_paramDiff );
+			OPT_LOG_TRACE( "ParamDiff: " << m_paramDiff );
+			m_bConverged = fNorm < m_updateThreshold;
+
+			// an outdated jacobian that converges too slowly is recomputed in the next iteration
+			if ( !bJacobian && fNorm > T( 0.5 ) * fPrevNorm )
+				m_bFactorized = false;
+			fPrevNorm = fNorm;
+		}
+
+		if ( !m_bReuseFactorization )
+			m_bFactorized = false;
+		return fRes;
+	}
+
+	/** same as above without normalization */
+	template< class P, class VT1, class VT2 >
+	T optimize( P& problem, VT1& params, const VT2& measurement )
+	{ return optimize( problem, params, measurement, OptNoNormalize() ); }
+
+	/** discards the stored jacobian and factorization, e.g. when tracking was lost or the problem changed */
+	void reset()
+	{ m_bFactorized = false; }
+
+	/** number of iterations of the last call to \c optimize */
+	std::size_t iterations() const
+	{ return m_iterations; }
+
+	/** number of jacobians computed in the last call to \c optimize */
+	std::size_t jacobianEvaluations() const
+	{ return m_jacobians; }
+
+	/** true if the last call to \c optimize stopped because the update was below the threshold */
+	bool converged() const
+	{ return m_bConverged; }
+
+protected:
+	/// @internal adapts the buffers to the problem size, which invalidates the factorization
+	void resize( const std::size_t n_meas, const std::size_t n_params )
+	{
+		if ( m_jacobian.size1() == n_meas && m_jacobian.size2() == n_params )
+			return;
+
+		m_jacobian.resize( n_meas, n_params, false );
+		m_normalMatrix.resize( n_params, n_params, false );
+		m_measurementDiff.resize( n_meas, false );
+		m_estimatedMeasurement.resize( n_meas, false );
+		m_paramDiff.resize( n_params, false );
+		m_bFactorized = false;
+	}
+
+	/// @internal cholesky factorization of J^T J, stays unfactorized if J does not have full rank
+	void factorize()
+	{
+		namespace lapack = boost::numeric::bindings::lapack;
+		namespace blas = boost::numeric::bindings::blas;
+
+		blas::syrk( 'L', 'T', T( 1 ), m_jacobian, T( 0 ), m_normalMatrix );
+		m_bFactorized = lapack::potrf( 'L', m_normalMatrix ) == 0;
+		if ( !m_bFactorized )
+			OPT_LOG_DEBUG( "Error in cholesky decomposition, using SVD" );
+	}
+
+	/// @internal replaces the right hand side in m_paramDiff with the solution
+	void solve()
+	{
+		namespace lapack = boost::numeric::bindings::lapack;
+		namespace blas = boost::numeric::bindings::blas;
+
+		if ( m_bFactorized )
+		{
+			if ( lapack::potrs( 'L', m_normalMatrix, m_paramDiff ) != 0 )
+				UBITRACK_THROW( "lapack::potrs returned an error" );
+			return;
+		}
+
+		blas::gemm( 'T', 'N', T( 1 ), m_jacobian, m_jacobian, T( 0 ), m_normalMatrix );
+		vector_type singularValues( m_paramDiff.size() );
+		int rank;
+		if ( lapack::gelss( m_normalMatrix, m_paramDiff, singularValues, T( -1 ), rank ) != 0 )
+			UBITRACK_THROW( "lapack::gelss returned an error" );
+	}
+
+	std::size_t m_maxIterations;
+	T m_updateThreshold;
+	bool m_bReuseFactorization;
+
+	/// true if m_normalMatrix holds the cholesky factor belonging to m_jacobian
+	bool m_bFactorized;
+
+	std::size_t m_iterations;
+	std::size_t m_jacobians;
+	bool m_bConverged;
+
+	matrix_type m_jacobian;
+	matrix_type m_normalMatrix;
+	vector_type m_measurementDiff;
+	vector_type m_estimatedMeasurement;
+	vector_type m_paramDiff;
+};
+
+
 /**
  * @ingroup math
  * Run a number of Gauss-Newton optimizer iterations.
@@ -63,55 +263,15 @@ namespace Ubitrack { namespace Math { namespace Optimization {
  * @param measurement the measurement vector
  * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
  * @param nIterations number of iterations
- * @return the residual of the optimization process
  */
 template< class P, class VT1, class VT2, class NT >
 void gaussNewton( P& problem, VT1& params, const VT2& measurement, unsigned nIterations, const NT& normalize = OptNoNormalize() )
 {
-	namespace lapack = boost::numeric::bindings::lapack;
-	namespace blas = boost::numeric::bindings::blas;
-	namespace ublas = boost::numeric::ublas;
-	typedef typename VT1::value_type T;
-	typedef typename Math::Matrix< T, 0, 0 > MatType;
-
-	// create some matrices and vectors
-	MatType matJacobian( measurement.size(), params.size() );
-	MatType matJacobiSquare( params.size(), params.size() );
-	Math::Vector< T > measurementDiff( measurement.size() );
-	Math::Vector< T > paramDiff( params.size() );
-	Math::Vector< T > estimatedMeasurement( measurement.size() );
-
 	OPT_LOG_DEBUG( "Gauss-Newton entry params: " << params );
 
-	for ( unsigned i = 0; i < nIterations; i++ )
-	{
-		// compute initial error
-		problem.evaluateWithJacobian( estimatedMeasurement, params, matJacobian );
-
-		ublas::noalias( measurementDiff ) = measurement - estimatedMeasurement;
-		T fRes = ublas::inner_prod( measurementDiff, measurementDiff );
-		OPT_LOG_TRACE( "measurementDiff: " << measurementDiff );
-		OPT_LOG_DEBUG( "Gauss-Newton residual " << i << ": " << fRes );
-
-		// start optimization loop
-		blas::gemm( 'T', 'N', T( 1 ), matJacobian, matJacobian, T( 0 ), matJacobiSquare );
-		blas::gemm( 'T', 'N', T( 1 ), matJacobian, measurementDiff, T( 0 ), paramDiff );
-
-		OPT_LOG_TRACE( "Jacobian[0:16]: " << ublas::subrange( matJacobian, 0, std::min( std::size_t( 16 ), measurement.size() ), 0, params.size() ) );
-		
-		// do least squares
-		int info = lapack::gels( 'N', matJacobiSquare, paramDiff ); // result in matParamDiff
-		if ( info != 0 )
-			UBITRACK_THROW( "lapack::gels returned an error" );
-
-		noalias( params ) += paramDiff; //ublas::subrange( measurementDiff, 0, params.size() );
-
-		OPT_LOG_TRACE( "ParamDiff (after): " << paramDiff );
-		OPT_LOG_TRACE( "new params: " << params );
-
-		// normalize
-		normalize.evaluate( params, params );
-	}
+	// a zero threshold never stops early
+	IncrementalGaussNewton< typename VT1::value_type > optimizer( nIterations, 0, false );
+	optimizer.optimize( problem, params, measurement, normalize );
 }
 
 }}} // namespace Ubitrack::Math::Optimization
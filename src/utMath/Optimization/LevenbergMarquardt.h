@@ -36,9 +36,12 @@
 
 #ifdef HAVE_LAPACK
 
-// Boost
-#include <boost/scoped_ptr.hpp>
+// std
+#include <algorithm> // std::swap, std::min
+#include <math.h> // sqrt
 
+// Boost
+#include <boost/utility/enable_if.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/vector_proxy.hpp>
 
@@ -51,78 +54,489 @@
 // Ubitrack
 #include "../Vector.h"
 #include "../Matrix.h"
+#include "../MatrixLayout.h"
+#include "../FixedDecomposition.h"
 #include "Optimization.h"
+#include "OptTelemetry.h"
+#include "RobustLoss.h"
 #include <utUtil/Exception.h>
+#include <utUtil/TracingProvider.h>
+#include <utUtil/TraceSpan.h>
 
 
 namespace Ubitrack { namespace Math { namespace Optimization {
 
-/** possible solvers to use in levenberg-marquardt optimization */
-enum LmSolverType { lmUseCholesky, lmUseQR, lmUseSVD };
+/** 
+ * possible solvers to use in levenberg-marquardt optimization.
+ * \c lmUseCG solves the normal equations by preconditioned conjugate gradients using only
+ * products with the jacobian and never forms J^T J, see \c LevenbergMarquardtWorkspace
+ * for its parameters.
+ */
+enum LmSolverType { lmUseCholesky, lmUseQR, lmUseSVD, lmUseCG };
 
 /**
  * @ingroup math
- * Optimize a given problem using the levenberg marquardt optimizer.
+ * Caller-owned buffers for the levenberg-marquardt optimizer.
  *
- * @par The problem class
- * The problem class P must be modeled after the UnaryFunctionPrototype and implement the function
- * \c evaluateWithJacobian which computes the predicted measurement and the jacobian wrt. the parameters to optimize.
+ * Passing the same workspace to subsequent calls of \c levenbergMarquardt or
+ * \c weightedLevenbergMarquardt avoids all heap allocations inside the optimizer
+ * as long as the problem dimensions do not change (when the cholesky solver is used).
+ * A workspace must not be used by several threads at the same time.
+ *
+ * The jacobian is column-major by default. Problems that fill it row by row, e.g. two rows
+ * per projected point, can use a \c boost::numeric::ublas::row_major workspace instead, whose
+ * rows are written sequentially; the optimizer then hands its transpose to BLAS.
+ *
+ * @tparam T builtin type of the parameters (e.g \c double or \c float )
+ * @tparam Layout storage layout of the jacobian
+ */
+template< typename T, class Layout = boost::numeric::ublas::column_major >
+class LevenbergMarquardtWorkspace
+{
+public:
+	typedef typename Math::Matrix< T >::base_type matrix_type;
+	typedef typename Math::Vector< T >::base_type vector_type;
+	typedef boost::numeric::ublas::matrix< T, Layout, typename matrix_type::array_type > jacobian_type;
+
+	/** creates an empty workspace, which is sized on first use */
+	LevenbergMarquardtWorkspace()
+		: cgTolerance( T( 1e-6 ) )
+		, cgMaxIterations( 0 )
+		, cgBlockSize( 1 )
+	{}
+
+	/**
+	 * creates a workspace for a given problem size
+	 * @param n_meas size of the measurement vector
+	 * @param n_params size of the parameter vector
+	 * @param solver solver the workspace is used with
+	 */
+	LevenbergMarquardtWorkspace( const std::size_t n_meas, const std::size_t n_params, const LmSolverType solver = lmUseCholesky )
+		: cgTolerance( T( 1e-6 ) )
+		, cgMaxIterations( 0 )
+		, cgBlockSize( 1 )
+	{ resize( n_meas, n_params, solver ); }
+
+	/**
+	 * adapts the buffers to a given problem size. Only reallocates if the size changes.
+	 * The n_params x n_params normal equations are not allocated for \c lmUseCG.
+	 * @param n_meas size of the measurement vector
+	 * @param n_params size of the parameter vector
+	 * @param solver solver the workspace is used with
+	 */
+	void resize( const std::size_t n_meas, const std::size_t n_params, const LmSolverType solver = lmUseCholesky )
+	{
+		if ( jacobian.size1() != n_meas || jacobian.size2() != n_params )
+		{
+			jacobian.resize( n_meas, n_params, false );
+			jacobian2.resize( n_meas, n_params, false );
+		}
+		if ( solver != lmUseCG && jacobiSquare.size1() != n_params )
+			jacobiSquare.resize( n_params, n_params, false );
+		if ( solver == lmUseCG )
+		{
+			resizeVector( cgResidual, n_params );
+			resizeVector( cgDirection, n_params );
+			resizeVector( cgPreconditioned, n_params );
+			resizeVector( cgProduct, n_params );
+			resizeVector( cgMeasurementProduct, n_meas );
+			const std::size_t blockSize = std::max< std::size_t >( cgBlockSize, 1 );
+			if ( cgBlocks.size1() != blockSize || cgBlocks.size2() != n_params )
+				cgBlocks.resize( blockSize, n_params, false );
+		}
+
+		resizeVector( measurementDiff, n_meas );
+		resizeVector( measurementDiff2, n_meas );
+		resizeVector( estimatedMeasurement, n_meas );
+		resizeVector( weightVector, n_meas );
+		resizeVector( paramDiff, n_params );
+		resizeVector( newParams, n_params );
+		resizeVector( singularValues, n_params );
+	}
+
+	/** size of the measurement vector the workspace is prepared for */
+	std::size_t measurementSize() const
+	{ return jacobian.size1(); }
+
+	/** size of the parameter vector the workspace is prepared for */
+	std::size_t parameterSize() const
+	{ return jacobian.size2(); }
+
+	/** 
+	 * \c lmUseCG stops when the residual of the normal equations is reduced by this factor.
+	 * Loose tolerances give inexact, but cheaper steps.
+	 */
+	T cgTolerance;
+
+	/** maximum number of conjugate gradient iterations per step, 0 for the number of parameters */
+	std::size_t cgMaxIterations;
+
+	/**
+	 * size of the diagonal blocks of J^T J that are inverted for preconditioning, 1 for a jacobi
+	 * preconditioner. Use the size of the parameter blocks of the problem, e.g. 6 for poses.
+	 */
+	std::size_t cgBlockSize;
+
+	/** @internal buffers used by the optimizer */
+	jacobian_type jacobian;
+	jacobian_type jacobian2;
+	matrix_type jacobiSquare;
+	vector_type measurementDiff;
+	vector_type measurementDiff2;
+	vector_type estimatedMeasurement;
+	vector_type weightVector;
+	vector_type paramDiff;
+	vector_type newParams;
+	vector_type singularValues;
+	vector_type cgResidual;
+	vector_type cgDirection;
+	vector_type cgPreconditioned;
+	vector_type cgProduct;
+	vector_type cgMeasurementProduct;
+	matrix_type cgBlocks;
+
+protected:
+	static void resizeVector( vector_type& v, const std::size_t n )
+	{
+		if ( v.size() != n )
+			v.resize( n, false );
+	}
+};
+
+
+namespace Detail {
+
+/**
+ * @internal
+ * multiply jacobian and difference with the square root of the weight matrix
+ * @return the weighted squared error
+ */
+template< class WFT, class VT, class MT, class WT >
+typename VT::value_type applyLmWeights( const WFT& weightFunction, VT& measurementDiff, MT& jacobian, WT& weightVector )
+{
+	namespace ublas = boost::numeric::ublas;
+	typedef typename VT::value_type T;
+
+	weightFunction.computeWeights( measurementDiff, weightVector );
+	for ( std::size_t i = 0; i < measurementDiff.size(); i++ )
+	{
+		const T w = sqrt( weightVector( i ) );
+		measurementDiff( i ) *= w;
+		ublas::row( jacobian, i ) *= w;
+	}
+	OPT_LOG_TRACE( "weights = " << weightVector );
+	return ublas::inner_prod( measurementDiff, measurementDiff );
+}
+
+
+/** @internal scales rows of a dense jacobian */
+template< class MT >
+struct LmRowScaler
+{
+	LmRowScaler( MT& jacobian )
+		: m_jacobian( jacobian )
+	{}
+
+	template< typename T >
+	void operator()( const std::size_t i, const T w )
+	{ boost::numeric::ublas::row( m_jacobian, i ) *= w; }
+
+	MT& m_jacobian;
+};
+
+
+/**
+ * @internal
+ * robust losses compute the weights and scale the residuals and jacobian in one pass
+ * @return the sum of the losses, as the weighted error of redescending losses can decrease
+ *   by moving measurements towards the outliers
+ */
+template< class Loss, class VT, class MT, class WT >
+typename VT::value_type applyLmWeights( const RobustWeightFunction< Loss >& weightFunction, VT& measurementDiff, MT& jacobian, WT& weightVector )
+{
+	LmRowScaler< MT > scaler( jacobian );
+	const typename VT::value_type loss = weightFunction.weightRows( measurementDiff, weightVector, scaler );
+	OPT_LOG_TRACE( "weights = " << weightVector );
+	return loss;
+}
+
+
+/**
+ * @internal
+ * multiply the difference with the square root of the weight matrix, for trial steps without jacobian
+ * @return the weighted squared error
+ */
+template< class WFT, class VT, class WT >
+typename VT::value_type applyLmResidualWeights( const WFT& weightFunction, VT& measurementDiff, WT& weightVector )
+{
+	weightFunction.computeWeights( measurementDiff, weightVector );
+	for ( std::size_t i = 0; i < measurementDiff.size(); i++ )
+		measurementDiff( i ) *= sqrt( weightVector( i ) );
+	return boost::numeric::ublas::inner_prod( measurementDiff, measurementDiff );
+}
+
+
+/** @internal row scaler that does nothing */
+struct LmNoRowScaler
+{
+	template< typename T >
+	void operator()( const std::size_t, const T )
+	{}
+};
+
+
+/**
+ * @internal
+ * robust losses for trial steps without jacobian
+ * @return the sum of the losses
+ */
+template< class Loss, class VT, class WT >
+typename VT::value_type applyLmResidualWeights( const RobustWeightFunction< Loss >& weightFunction, VT& measurementDiff, WT& weightVector )
+{
+	LmNoRowScaler scaler;
+	return weightFunction.weightRows( measurementDiff, weightVector, scaler );
+}
+
+
+/**
+ * @internal
+ * weights the residuals of a trial step and, if it has been computed, the jacobian
+ * @return the error of the trial step
+ */
+template< class WFT, class VT, class MT, class WT >
+typename VT::value_type weightLmTrial( const WFT& weightFunction, VT& measurementDiff, MT& jacobian, const bool bJacobian, WT& weightVector )
+{
+	if ( weightFunction.noWeights() )
+		return boost::numeric::ublas::inner_prod( measurementDiff, measurementDiff );
+	if ( bJacobian )
+		return applyLmWeights( weightFunction, measurementDiff, jacobian, weightVector );
+	return applyLmResidualWeights( weightFunction, measurementDiff, weightVector );
+}
+
+
+/**
+ * @internal
+ * computes the jacobian of an accepted trial step that was evaluated without jacobian
+ * and multiplies it with the square root of the weights of the step
+ */
+template< class P, class VT, class MT, class WFT, class WT, class ResidualOnly >
+void lmAcceptedJacobian( P& problem, const VT& params, MT& jacobian, const WFT& weightFunction, const WT& weightVector, ResidualOnly residualOnly )
+{
+	evaluateAcceptedJacobian( problem, params, jacobian, residualOnly );
+	if ( !weightFunction.noWeights() )
+		for ( std::size_t i = 0; i < jacobian.size1(); i++ )
+			boost::numeric::ublas::row( jacobian, i ) *= sqrt( weightVector( i ) );
+}
+
+
+/** @internal computes J^T J of a column-major jacobian, only the lower triangle if \c bLower */
+template< typename T, class A, class MT >
+void lmNormalMatrix( const boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, A >& jacobian, MT& jtj, const bool bLower )
+{
+	namespace blas = boost::numeric::bindings::blas;
+	if ( bLower )
+		blas::syrk( 'L', 'T', T( 1 ), jacobian, T( 0 ), jtj );
+	else
+		blas::gemm( 'T', 'N', T( 1 ), jacobian, jacobian, T( 0 ), jtj );
+}
+
+/** @internal computes J^T J of a row-major jacobian, whose storage is J^T in column-major order */
+template< typename T, class A, class MT >
+void lmNormalMatrix( const boost::numeric::ublas::matrix< T, boost::numeric::ublas::row_major, A >& jacobian, MT& jtj, const bool bLower )
+{
+	namespace blas = boost::numeric::bindings::blas;
+	const Math::ColumnMajorView< const T > jt( Math::columnMajorTranspose( jacobian ) );
+	if ( bLower )
+		blas::syrk( 'L', 'N', T( 1 ), jt, T( 0 ), jtj );
+	else
+		blas::gemm( 'N', 'T', T( 1 ), jt, jt, T( 0 ), jtj );
+}
+
+/** @internal y = J x + beta y for a column-major jacobian */
+template< typename T, class A, class VX, class VY >
+void lmJacobianProduct( const boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, A >& jacobian, const VX& x, const T beta, VY& y )
+{ boost::numeric::bindings::blas::gemv( 'N', T( 1 ), jacobian, x, beta, y ); }
+
+/** @internal y = J x + beta y for a row-major jacobian */
+template< typename T, class A, class VX, class VY >
+void lmJacobianProduct( const boost::numeric::ublas::matrix< T, boost::numeric::ublas::row_major, A >& jacobian, const VX& x, const T beta, VY& y )
+{ boost::numeric::bindings::blas::gemv( 'T', T( 1 ), Math::columnMajorTranspose( jacobian ), x, beta, y ); }
+
+/** @internal y = J^T x + beta y for a column-major jacobian */
+template< typename T, class A, class VX, class VY >
+void lmTransposedJacobianProduct( const boost::numeric::ublas::matrix< T, boost::numeric::ublas::column_major, A >& jacobian, const VX& x, const T beta, VY& y )
+{ boost::numeric::bindings::blas::gemv( 'T', T( 1 ), jacobian, x, beta, y ); }
+
+/** @internal y = J^T x + beta y for a row-major jacobian */
+template< typename T, class A, class VX, class VY >
+void lmTransposedJacobianProduct( const boost::numeric::ublas::matrix< T, boost::numeric::ublas::row_major, A >& jacobian, const VX& x, const T beta, VY& y )
+{ boost::numeric::bindings::blas::gemv( 'N', T( 1 ), Math::columnMajorTranspose( jacobian ), x, beta, y ); }
+
+/**
+ * @internal
+ * applies the block jacobi preconditioner, whose cholesky factors are stored side by side in \c blocks
+ */
+template< class MT, class VT >
+void applyLmPreconditioner( const MT& blocks, const VT& r, VT& z )
+{
+	typedef typename VT::value_type T;
+	const std::size_t n = r.size();
+	const std::size_t bs = blocks.size1();
+	for ( std::size_t c0 = 0; c0 < n; c0 += bs )
+	{
+		const std::size_t m = std::min( bs, n - c0 );
+
+		// L L^T z = r
+		for ( std::size_t i = 0; i < m; i++ )
+		{
+			T s = r( c0 + i );
+			for ( std::size_t k = 0; k < i; k++ )
+				s -= blocks( i, c0 + k ) * z( c0 + k );
+			z( c0 + i ) = s / blocks( i, c0 + i );
+		}
+		for ( std::size_t i = m; i-- > 0; )
+		{
+			T s = z( c0 + i );
+			for ( std::size_t k = i + 1; k < m; k++ )
+				s -= blocks( k, c0 + i ) * z( c0 + k );
+			z( c0 + i ) = s / blocks( i, c0 + i );
+		}
+	}
+}
+
+/**
+ * @internal
+ * Solves ( J^T J + lambda I ) x = b with block jacobi preconditioned conjugate gradients,
+ * using only products with J and J^T. b is passed in paramDiff and replaced by x.
+ * @return the number of iterations
+ */
+template< typename T, class Layout, class MT, class VT >
+std::size_t lmConjugateGradient( const MT& jacobian, const T lambda, LevenbergMarquardtWorkspace< T, Layout >& workspace, VT& paramDiff )
+{
+	namespace ublas = boost::numeric::ublas;
+	const std::size_t n = jacobian.size2();
+	VT& r( workspace.cgResidual );
+	VT& p( workspace.cgDirection );
+	VT& z( workspace.cgPreconditioned );
+	VT& Ap( workspace.cgProduct );
+	VT& Jp( workspace.cgMeasurementProduct );
+	typename LevenbergMarquardtWorkspace< T, Layout >::matrix_type& blocks( workspace.cgBlocks );
+
+	// cholesky factors of the diagonal blocks of J^T J + lambda I
+	const std::size_t bs = blocks.size1();
+	for ( std::size_t c0 = 0; c0 < n; c0 += bs )
+	{
+		const std::size_t m = std::min( bs, n - c0 );
+		for ( std::size_t j = 0; j < m; j++ )
+		{
+			for ( std::size_t i = j; i < m; i++ )
+			{
+				T s = ublas::inner_prod( ublas::column( jacobian, c0 + i ), ublas::column( jacobian, c0 + j ) );
+				if ( i == j )
+					s += lambda;
+				for ( std::size_t k = 0; k < j; k++ )
+					s -= blocks( i, c0 + k ) * blocks( j, c0 + k );
+				if ( i == j )
+					blocks( j, c0 + j ) = s > T( 0 ) ? sqrt( s ) : T( 1 );
+				else
+					blocks( i, c0 + j ) = s / blocks( j, c0 + j );
+			}
+		}
+	}
+
+	ublas::noalias( r ) = paramDiff;
+	paramDiff.clear();
+	applyLmPreconditioner( blocks, r, z );
+	ublas::noalias( p ) = z;
+
+	T rz = ublas::inner_prod( r, z );
+	const T stop = workspace.cgTolerance * workspace.cgTolerance * ublas::inner_prod( r, r );
+	const std::size_t maxIterations = workspace.cgMaxIterations ? workspace.cgMaxIterations : n;
+	std::size_t iteration = 0;
+	while ( iteration < maxIterations && ublas::inner_prod( r, r ) > stop )
+	{
+		// Ap = J^T J p + lambda p
+		lmJacobianProduct( jacobian, p, T( 0 ), Jp );
+		ublas::noalias( Ap ) = lambda * p;
+		lmTransposedJacobianProduct( jacobian, Jp, T( 1 ), Ap );
+
+		const T alpha = rz / ublas::inner_prod( p, Ap );
+		ublas::noalias( paramDiff ) += alpha * p;
+		ublas::noalias( r ) -= alpha * Ap;
+		applyLmPreconditioner( blocks, r, z );
+
+		const T rzNew = ublas::inner_prod( r, z );
+		const T beta = rzNew / rz;
+		for ( std::size_t i = 0; i < n; i++ )
+			p( i ) = z( i ) + beta * p( i );
+		rz = rzNew;
+		++iteration;
+	}
+	return iteration;
+}
+
+} // namespace Detail
+
+
+/**
+ * @ingroup math
+ * Optimize a given problem using the levenberg marquardt optimizer.
+ * Same as \c weightedLevenbergMarquardt below, but uses the buffers of a caller-owned
+ * workspace, which is resized to the problem dimensions if necessary.
  *
+ * @param workspace buffers to use for the optimization
  * @param problem the problem to optimize -- provides measurement estimates and jacobians
  * @param params initial parameters on entry, optimized parameters on exit
  * @param measurement the measurement vector
  * @param terminationCriteria functor that returns true if the optimization should terminate. Is called with
  *   bool operator()( unsigned iteration, double currentError, double previousError )
  * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
+ * @param weightFunction computes the weights of the measurements from the residuals
  * @param solver least-squares solver to use
  * @return the residual of the optimization process
  */
-template< class P, class X, class Y, class TC, class NT, class WFT > 
-typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const Y& measurement, 
+template< class P, class X, class Y, class TC, class NT, class WFT, class Layout > 
+typename X::value_type weightedLevenbergMarquardt( LevenbergMarquardtWorkspace< typename X::value_type, Layout >& workspace,
+	P& problem, X& params, const Y& measurement, 
 	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
 	 const WFT& weightFunction = OptNoWeightFunction(), LmSolverType solver = lmUseCholesky,
 	 const typename X::value_type fStepSize = 1.0, const typename X::value_type fStepFactor = 10.0 )
 {
 	namespace lapack = boost::numeric::bindings::lapack;
-	namespace blas = boost::numeric::bindings::blas;
 	namespace ublas = boost::numeric::ublas;
 	typedef typename X::value_type T;
-	typedef typename Math::Matrix< T >::base_type MatType;
-	typedef typename Math::Vector< T >::base_type VecType;
+	typedef typename LevenbergMarquardtWorkspace< T, Layout >::matrix_type MatType;
+	typedef typename LevenbergMarquardtWorkspace< T, Layout >::jacobian_type JacType;
+	typedef typename LevenbergMarquardtWorkspace< T, Layout >::vector_type VecType;
 	
 	const std::size_t n_meas = measurement.size();
 	const std::size_t n_params = params.size();
-	// create some matrices and vectors
-	boost::scoped_ptr< MatType > pJacobian( new MatType( n_meas, n_params ) );
-	boost::scoped_ptr< MatType > pJacobian2( new MatType( n_meas, n_params ) );
-	MatType matJacobiSquare( n_params, n_params );
-	boost::scoped_ptr< VecType > pMeasurementDiff( new VecType( n_meas ) );
-	boost::scoped_ptr< VecType > pMeasurementDiff2( new VecType( n_meas ) );
-	VecType paramDiff( n_params );
-	VecType estimatedMeasurement( n_meas );
-	VecType newParams( n_params );
+	// attributes: measurements, parameters, iterations
+	UBITRACK_TRACE_SPAN( "levenberg_marquardt", n_meas, n_params );
+	workspace.resize( n_meas, n_params, solver );
+
+	// references into the workspace
+	JacType* pJacobian = &workspace.jacobian;
+	JacType* pJacobian2 = &workspace.jacobian2;
+	MatType& matJacobiSquare = workspace.jacobiSquare;
+	VecType* pMeasurementDiff = &workspace.measurementDiff;
+	VecType* pMeasurementDiff2 = &workspace.measurementDiff2;
+	VecType& paramDiff = workspace.paramDiff;
+	VecType& estimatedMeasurement = workspace.estimatedMeasurement;
+	VecType& newParams = workspace.newParams;
+	Detail::HasResidualEvaluation< P, VecType, VecType, JacType > residualOnly;
 
 	// compute initial error
 	problem.evaluateWithJacobian( estimatedMeasurement, params, *pJacobian );
 	ublas::noalias( *pMeasurementDiff ) = measurement - estimatedMeasurement;
 	OPT_LOG_TRACE( "Measurement Diff = " << *pMeasurementDiff );
 
-	// multiply jacobian and difference with sqare root of weight matrix
-	if ( !weightFunction.noWeights() )
-	{
-		VecType weightVector( n_meas );
-		weightFunction.computeWeights( *pMeasurementDiff, weightVector );
-		for ( std::size_t i = 0; i < n_meas; i++ )
-		{
-			const T w = sqrt( weightVector( i ) );
-			(*pMeasurementDiff)( i ) *= w;
-			ublas::row( *pJacobian, i ) *= w;
-		}
-		OPT_LOG_TRACE( "weights = " << weightVector );
-	}
-
-	T fErrPrev = ublas::inner_prod( *pMeasurementDiff, *pMeasurementDiff );
+	// multiply jacobian and difference with sqare root of weight matrix and compute the error
+	T fErrPrev = weightFunction.noWeights() ? ublas::inner_prod( *pMeasurementDiff, *pMeasurementDiff ) :
+		Detail::applyLmWeights( weightFunction, *pMeasurementDiff, *pJacobian, workspace.weightVector );
 	OPT_LOG_DEBUG( "Levenberg-Marquardt residual 0: " << fErrPrev );
+	const OptTelemetryRun telemetry( "Levenberg-Marquardt" );
+	telemetry.iteration( 0, fErrPrev );
 
 	// start optimization loop
 	T fLambda = T( fStepSize );
@@ -131,22 +545,29 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 	while ( !bTerminate )
 	{
 		++iteration;
+		int rank = -1;
 
 		// do one optimization step
-		if ( solver == lmUseCholesky )
-			blas::syrk( 'L', 'T', T( 1 ), *pJacobian, T( 0 ), matJacobiSquare );
-		else
-			blas::gemm( 'T', 'N', T( 1 ), *pJacobian, *pJacobian, T( 0 ), matJacobiSquare );
+		if ( solver != lmUseCG )
+			Detail::lmNormalMatrix( *pJacobian, matJacobiSquare, solver == lmUseCholesky );
 
-		blas::gemm( 'T', 'N', T( 1 ), *pJacobian, *pMeasurementDiff, T( 0 ), paramDiff );
+		Detail::lmTransposedJacobianProduct( *pJacobian, *pMeasurementDiff, T( 0 ), paramDiff );
 		
 		// add lambda to diagonal
-		for ( std::size_t i = 0; i < n_params; i++ )
-			matJacobiSquare( i, i ) += fLambda;		
+		if ( solver != lmUseCG )
+			for ( std::size_t i = 0; i < n_params; i++ )
+				matJacobiSquare( i, i ) += fLambda;		
 		
 		// do least squares
 		switch ( solver )
 		{
+		case lmUseCG:
+			{
+				const std::size_t nCG = Detail::lmConjugateGradient( *pJacobian, fLambda, workspace, paramDiff ); // result in paramDiff
+				OPT_LOG_DEBUG( "Conjugate gradient iterations: " << nCG );
+			}
+			break;
+
 		case lmUseCholesky:
 			if ( lapack::posv( 'L', matJacobiSquare, paramDiff ) != 0 ) // result in paramDiff
 			{
@@ -163,8 +584,7 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 
 		case lmUseSVD:
 			{
-				Math::Vector< T > sv( n_params );
-				int rank;
+				VecType& sv = workspace.singularValues;
 				if ( lapack::gelss( matJacobiSquare, paramDiff, sv, T( -1 ), rank ) != 0 ) // result in paramDiff
 					UBITRACK_THROW( "lapack::gelss returned an error" );
 				OPT_LOG_DEBUG( "Effective rank: " << rank );
@@ -181,28 +601,213 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 		// normalize
 		normalize.evaluate( newParams, newParams );
 
-		// compute new error
-		problem.evaluateWithJacobian( estimatedMeasurement, newParams, *pJacobian2 );
+		// compute new error, problems with residual evaluation compute the jacobian only for accepted steps
+		const bool bJacobian = Detail::evaluateTrial( problem, estimatedMeasurement, newParams, *pJacobian2, residualOnly );
 		ublas::noalias( *pMeasurementDiff2 ) = measurement - estimatedMeasurement;
 
-		// multiply jacobian and difference with square root of weight matrix
-		if ( !weightFunction.noWeights() )
+		// multiply jacobian and difference with square root of weight matrix and compute the error
+		const T fErr = Detail::weightLmTrial( weightFunction, *pMeasurementDiff2, *pJacobian2, bJacobian, workspace.weightVector );
+
+		OPT_LOG_TRACE( "measurementDiff: " << *pMeasurementDiff2 );
+		OPT_LOG_DEBUG( "Levenberg-Marquardt residual " << iteration << ": " << fErr );
+		telemetry.iteration( iteration, fErr, fLambda, rank );
+		TRACEPOINT_OPTIMIZATION_LM_ITERATION( iteration, fErr, fLambda, solver );
+		UBITRACK_TRACE_SPAN_SET( 2, iteration );
+
+		// check if we should terminate
+		bTerminate = terminationCriteria( iteration, fErr, fErrPrev );
+
+		// update parameters
+		if ( fErr >= fErrPrev )
+			fLambda *= T( fStepFactor );
+		else
 		{
-			VecType weightVector( n_meas );
-			weightFunction.computeWeights( *pMeasurementDiff2, weightVector );
-			for ( std::size_t  i = 0; i < n_meas; i++ )
+			if ( !bJacobian && !bTerminate )
+				Detail::lmAcceptedJacobian( problem, newParams, *pJacobian2, weightFunction, workspace.weightVector, residualOnly );
+
+			fLambda /= T( fStepFactor );
+			ublas::noalias( params ) = newParams;
+
+			// swap measurementDiff
+			std::swap( pMeasurementDiff, pMeasurementDiff2 );
+
+			// swap jacobian
+			std::swap( pJacobian, pJacobian2 );
+			
+			fErrPrev = fErr;
+		}
+	}
+
+	return fErrPrev;
+}
+
+/**
+ * @ingroup math
+ * Optimize a given problem using the levenberg marquardt optimizer.
+ *
+ * @par The problem class
+ * The problem class P must be modeled after the UnaryFunctionPrototype and implement the function
+ * \c evaluateWithJacobian which computes the predicted measurement and the jacobian wrt. the parameters to optimize.
+ *
+ * @param problem the problem to optimize -- provides measurement estimates and jacobians
+ * @param params initial parameters on entry, optimized parameters on exit
+ * @param measurement the measurement vector
+ * @param terminationCriteria functor that returns true if the optimization should terminate. Is called with
+ *   bool operator()( unsigned iteration, double currentError, double previousError )
+ * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
+ * @param solver least-squares solver to use
+ * @return the residual of the optimization process
+ */
+template< class P, class X, class Y, class TC, class NT, class WFT > 
+typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
+	 const WFT& weightFunction = OptNoWeightFunction(), LmSolverType solver = lmUseCholesky,
+	 const typename X::value_type fStepSize = 1.0, const typename X::value_type fStepFactor = 10.0 )
+{
+	LevenbergMarquardtWorkspace< typename X::value_type > workspace( measurement.size(), params.size(), solver );
+	return weightedLevenbergMarquardt( workspace, problem, params, measurement, terminationCriteria, normalize, weightFunction, solver, fStepSize, fStepFactor );
+}
+
+/**
+ * @ingroup math
+ * Optimize a given problem using the levenberg marquardt optimizer.
+ *
+ * Overload for parameter vectors of a size known at compile time. The normal equations
+ * are kept on the stack and solved by the inlined \c Math::choleskySolve instead of LAPACK,
+ * which is much faster for small problems (e.g. 6 or 7 pose parameters). If the decomposition
+ * fails, the solver switches to SVD as in the general version. The QR and SVD solvers are
+ * handled by the general version.
+ *
+ * @see weightedLevenbergMarquardt above for a description of the parameters
+ */
+template< class P, typename T, std::size_t N, class Y, class TC, class NT, class WFT > 
+typename boost::enable_if_c< ( N > 0 ), T >::type weightedLevenbergMarquardt( P& problem, Math::Vector< T, N >& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
+	 const WFT& weightFunction = OptNoWeightFunction(), LmSolverType solver = lmUseCholesky,
+	 const typename Math::Vector< T, N >::value_type fStepSize = 1.0, const typename Math::Vector< T, N >::value_type fStepFactor = 10.0 )
+{
+	namespace lapack = boost::numeric::bindings::lapack;
+	namespace ublas = boost::numeric::ublas;
+	typedef typename Math::Matrix< T >::base_type MatType;
+	typedef typename Math::Vector< T >::base_type VecType;
+
+	if ( solver != lmUseCholesky )
+	{
+		LevenbergMarquardtWorkspace< T > workspace( measurement.size(), N, solver );
+		return weightedLevenbergMarquardt( workspace, problem, params, measurement, terminationCriteria, normalize, weightFunction, solver, fStepSize, fStepFactor );
+	}
+
+	const std::size_t n_meas = measurement.size();
+	// attributes: measurements, parameters, iterations
+	UBITRACK_TRACE_SPAN( "levenberg_marquardt", n_meas, N );
+
+	// only the jacobians and residuals depend on the number of measurements
+	MatType jacobian( n_meas, N );
+	MatType jacobian2( n_meas, N );
+	VecType measurementDiff( n_meas );
+	VecType measurementDiff2( n_meas );
+	VecType estimatedMeasurement( n_meas );
+	VecType weightVector( weightFunction.noWeights() ? 0 : n_meas );
+	MatType* pJacobian = &jacobian;
+	MatType* pJacobian2 = &jacobian2;
+	VecType* pMeasurementDiff = &measurementDiff;
+	VecType* pMeasurementDiff2 = &measurementDiff2;
+
+	Math::Matrix< T, N, N > matJacobiSquare;
+	Math::Vector< T, N > paramDiff;
+	Math::Vector< T, N > newParams;
+	Detail::HasResidualEvaluation< P, VecType, Math::Vector< T, N >, MatType > residualOnly;
+
+	// compute initial error
+	problem.evaluateWithJacobian( estimatedMeasurement, params, *pJacobian );
+	ublas::noalias( *pMeasurementDiff ) = measurement - estimatedMeasurement;
+	OPT_LOG_TRACE( "Measurement Diff = " << *pMeasurementDiff );
+
+	// multiply jacobian and difference with sqare root of weight matrix and compute the error
+	T fErrPrev = weightFunction.noWeights() ? ublas::inner_prod( *pMeasurementDiff, *pMeasurementDiff ) :
+		Detail::applyLmWeights( weightFunction, *pMeasurementDiff, *pJacobian, weightVector );
+	OPT_LOG_DEBUG( "Levenberg-Marquardt residual 0: " << fErrPrev );
+	const OptTelemetryRun telemetry( "Levenberg-Marquardt" );
+	telemetry.iteration( 0, fErrPrev );
+
+	// start optimization loop
+	T fLambda = T( fStepSize );
+	std::size_t iteration = 0;
+	bool bTerminate = false;
+	while ( !bTerminate )
+	{
+		++iteration;
+		int rank = -1;
+
+		// compute J^T * J (lower triangle) and J^T * diff, jacobian is stored column-major
+		const T* pJ = &( pJacobian->data()[ 0 ] );
+		const T* pDiff = &( pMeasurementDiff->data()[ 0 ] );
+		for ( std::size_t i = 0; i < N; i++ )
+		{
+			const T* pColI = pJ + i * n_meas;
+			for ( std::size_t j = 0; j <= i; j++ )
+			{
+				const T* pColJ = pJ + j * n_meas;
+				T sum = 0;
+				for ( std::size_t k = 0; k < n_meas; k++ )
+					sum += pColI[ k ] * pColJ[ k ];
+				matJacobiSquare( i, j ) = sum;
+			}
+
+			T sum = 0;
+			for ( std::size_t k = 0; k < n_meas; k++ )
+				sum += pColI[ k ] * pDiff[ k ];
+			paramDiff( i ) = sum;
+		}
+
+		// add lambda to diagonal
+		for ( std::size_t i = 0; i < N; i++ )
+			matJacobiSquare( i, i ) += fLambda;
+
+		// do least squares
+		if ( solver == lmUseCholesky )
+		{
+			if ( !Math::choleskySolve( matJacobiSquare, paramDiff ) ) // result in paramDiff
 			{
-				const T w = sqrt( weightVector( i ) );
-				(*pMeasurementDiff2)( i ) *= w;
-				ublas::row( *pJacobian2, i ) *= w;
+				OPT_LOG_DEBUG( "Error in cholesky decomposition, switching to SVD" );
+				solver = lmUseSVD;
+				continue;
 			}
-			OPT_LOG_TRACE( "weights = " << weightVector );
 		}
+		else
+		{
+			// symmetric matrix is needed for the svd
+			for ( std::size_t i = 0; i < N; i++ )
+				for ( std::size_t j = 0; j < i; j++ )
+					matJacobiSquare( j, i ) = matJacobiSquare( i, j );
+
+			MatType matSquare( matJacobiSquare );
+			VecType diff( paramDiff );
+			VecType sv( N );
+			if ( lapack::gelss( matSquare, diff, sv, T( -1 ), rank ) != 0 ) // result in diff
+				UBITRACK_THROW( "lapack::gelss returned an error" );
+			OPT_LOG_DEBUG( "Effective rank: " << rank );
+			ublas::noalias( paramDiff ) = diff;
+		}
+
+		OPT_LOG_TRACE( "paramDiff: " << paramDiff );
+		ublas::noalias( newParams ) = params + paramDiff;
+
+		// normalize
+		normalize.evaluate( newParams, newParams );
 
-		const T fErr = ublas::inner_prod( *pMeasurementDiff2, *pMeasurementDiff2 );
+		// compute new error, problems with residual evaluation compute the jacobian only for accepted steps
+		const bool bJacobian = Detail::evaluateTrial( problem, estimatedMeasurement, newParams, *pJacobian2, residualOnly );
+		ublas::noalias( *pMeasurementDiff2 ) = measurement - estimatedMeasurement;
+
+		// multiply jacobian and difference with square root of weight matrix and compute the error
+		const T fErr = Detail::weightLmTrial( weightFunction, *pMeasurementDiff2, *pJacobian2, bJacobian, weightVector );
 
 		OPT_LOG_TRACE( "measurementDiff: " << *pMeasurementDiff2 );
 		OPT_LOG_DEBUG( "Levenberg-Marquardt residual " << iteration << ": " << fErr );
+		telemetry.iteration( iteration, fErr, fLambda, rank );
+		TRACEPOINT_OPTIMIZATION_LM_ITERATION( iteration, fErr, fLambda, solver );
+		UBITRACK_TRACE_SPAN_SET( 2, iteration );
 
 		// check if we should terminate
 		bTerminate = terminationCriteria( iteration, fErr, fErrPrev );
@@ -212,15 +817,16 @@ typename X::value_type weightedLevenbergMarquardt( P& problem, X& params, const
 			fLambda *= T( fStepFactor );
 		else
 		{
+			if ( !bJacobian && !bTerminate )
+				Detail::lmAcceptedJacobian( problem, newParams, *pJacobian2, weightFunction, weightVector, residualOnly );
+
 			fLambda /= T( fStepFactor );
 			params = newParams;
 
-			// swap measurementDiff
-			pMeasurementDiff.swap( pMeasurementDiff2 );
+			// swap measurementDiff and jacobian
+			std::swap( pMeasurementDiff, pMeasurementDiff2 );
+			std::swap( pJacobian, pJacobian2 );
 
-			// swap jacobian
-			pJacobian.swap( pJacobian2 );
-			
 			fErrPrev = fErr;
 		}
 	}
@@ -251,6 +857,18 @@ typename X::value_type levenbergMarquardt( P& problem, X& params, const Y& measu
 	LmSolverType solver = lmUseCholesky, const typename X::value_type stepSize = 1.0, const typename X::value_type stepFactor = 10.0  )
 { return weightedLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, OptNoWeightFunction(), solver, stepSize, stepFactor ); }
 
+/**
+ * @ingroup math
+ * Same as \c levenbergMarquardt above, but uses the buffers of a caller-owned workspace.
+ * @see LevenbergMarquardtWorkspace
+ */
+template< class P, class X, class Y, class TC, class NT, class Layout > 
+typename X::value_type levenbergMarquardt( LevenbergMarquardtWorkspace< typename X::value_type, Layout >& workspace,
+	P& problem, X& params, const Y& measurement, 
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(), 
+	LmSolverType solver = lmUseCholesky, const typename X::value_type stepSize = 1.0, const typename X::value_type stepFactor = 10.0  )
+{ return weightedLevenbergMarquardt( workspace, problem, params, measurement, terminationCriteria, normalize, OptNoWeightFunction(), solver, stepSize, stepFactor ); }
+
 }}} // namespace Ubitrack::Math::Optimization
 
 #endif	// HAVE_LAPACK
@@ -0,0 +1,157 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup Math
+ * @file
+ * Base class for multivariate functions with automatically computed jacobians
+ */
+
+#ifndef __UBITRACK_MATH_FUNCTION_AUTODIFFFUNCTION_H_INCLUDED__
+#define __UBITRACK_MATH_FUNCTION_AUTODIFFFUNCTION_H_INCLUDED__
+
+#include <boost/static_assert.hpp>
+
+#include <utMath/Vector.h>
+#include "MultiVariateFunction.h"
+#include "Dual.h"
+
+namespace Ubitrack { namespace Math { namespace Optimization { namespace Function {
+
+/**
+ * Derive your own multivariate functions from this class if you do not want to write the
+ * jacobians by hand.
+ *
+ * The derived class only implements \c evaluate as a template, and the
+ * \c multiplyJacobian functions required by the \c Binder are generated by evaluating it
+ * once on \c Dual numbers (forward-mode automatic differentiation). The product with the
+ * left-hand jacobian is accumulated directly into the destination matrix.
+ *
+ * In \c evaluate, intermediate values must be declared as
+ * <tt>typename DestinationVector::value_type</tt> and elementary functions must be called
+ * unqualified (e.g. \c sqrt instead of \c std::sqrt), as the destination holds dual
+ * numbers when the jacobian is computed. Parameters may be of different types, e.g.
+ * \c Dual for the parameter that is differentiated and \c double for the others.
+ *
+ * Several functions composed with \c operator<< can usually be merged into a single
+ * \c AutoDiffFunction, which avoids the intermediate jacobians of the composition.
+ *
+ * @param Derived the class of the derived function
+ * @param Size size of the result vector, must be known at compile-time
+ * @param N1 size of the first parameter
+ * @param N2 size of the second parameter, if any
+ * @param N3 size of the third parameter, if any. 0 for parameters that are never optimized.
+ */
+template< class Derived, unsigned Size, std::size_t N1, std::size_t N2 = 0, std::size_t N3 = 0 >
+class AutoDiffFunction
+	: public MultiVariateFunction< Derived, Size >
+{
+	BOOST_STATIC_ASSERT( Size > 0 );
+
+public:
+	// one-parameter function
+
+	template< class LeftHand, class DestinationMatrix, class Param1 >
+	void multiplyJacobian1( const LeftHand& l, DestinationMatrix& j, const Param1& p1 ) const
+	{
+		Math::Vector< Dual< N1 >, Size > r;
+		derived().evaluate( r, seed< N1 >( p1 ) );
+		multiplyLeft< N1 >( l, j, r );
+	}
+
+	// two-parameter functions
+
+	template< class LeftHand, class DestinationMatrix, class Param1, class Param2 >
+	void multiplyJacobian1( const LeftHand& l, DestinationMatrix& j, const Param1& p1, const Param2& p2 ) const
+	{
+		Math::Vector< Dual< N1 >, Size > r;
+		derived().evaluate( r, seed< N1 >( p1 ), p2 );
+		multiplyLeft< N1 >( l, j, r );
+	}
+
+	template< class LeftHand, class DestinationMatrix, class Param1, class Param2 >
+	void multiplyJacobian2( const LeftHand& l, DestinationMatrix& j, const Param1& p1, const Param2& p2 ) const
+	{
+		Math::Vector< Dual< N2 >, Size > r;
+		derived().evaluate( r, p1, seed< N2 >( p2 ) );
+		multiplyLeft< N2 >( l, j, r );
+	}
+
+	// three-parameter functions
+
+	template< class LeftHand, class DestinationMatrix, class Param1, class Param2, class Param3 >
+	void multiplyJacobian1( const LeftHand& l, DestinationMatrix& j, const Param1& p1, const Param2& p2, const Param3& p3 ) const
+	{
+		Math::Vector< Dual< N1 >, Size > r;
+		derived().evaluate( r, seed< N1 >( p1 ), p2, p3 );
+		multiplyLeft< N1 >( l, j, r );
+	}
+
+	template< class LeftHand, class DestinationMatrix, class Param1, class Param2, class Param3 >
+	void multiplyJacobian2( const LeftHand& l, DestinationMatrix& j, const Param1& p1, const Param2& p2, const Param3& p3 ) const
+	{
+		Math::Vector< Dual< N2 >, Size > r;
+		derived().evaluate( r, p1, seed< N2 >( p2 ), p3 );
+		multiplyLeft< N2 >( l, j, r );
+	}
+
+	template< class LeftHand, class DestinationMatrix, class Param1, class Param2, class Param3 >
+	void multiplyJacobian3( const LeftHand& l, DestinationMatrix& j, const Param1& p1, const Param2& p2, const Param3& p3 ) const
+	{
+		Math::Vector< Dual< N3 >, Size > r;
+		derived().evaluate( r, p1, p2, seed< N3 >( p3 ) );
+		multiplyLeft< N3 >( l, j, r );
+	}
+
+protected:
+	const Derived& derived() const
+	{ return *static_cast< const Derived* >( this ); }
+
+	/// @internal converts a parameter to dual numbers with unit gradients
+	template< std::size_t N, class Param >
+	static Math::Vector< Dual< N >, N > seed( const Param& p )
+	{
+		Math::Vector< Dual< N >, N > d;
+		for ( std::size_t i = 0; i < N; i++ )
+			d( i ) = Dual< N >( p( i ), i );
+		return d;
+	}
+
+	/// @internal j = l * J, where J is stored in the gradients of r
+	template< std::size_t N, class LeftHand, class DestinationMatrix >
+	static void multiplyLeft( const LeftHand& l, DestinationMatrix& j, const Math::Vector< Dual< N >, Size >& r )
+	{
+		for ( std::size_t row = 0; row < l.size1(); row++ )
+			for ( std::size_t c = 0; c < N; c++ )
+			{
+				double sum = 0;
+				for ( std::size_t i = 0; i < Size; i++ )
+					sum += l( row, i ) * r( i ).derivative( c );
+				j( row, c ) = sum;
+			}
+	}
+};
+
+}}}} // namespace Ubitrack::Math::Optimization::Function
+
+#endif
@@ -29,8 +29,8 @@
  * @author Daniel Pustka <daniel.pustka@in.tum.de>
  */
 
-#ifndef __UBITRACK_CALIBRATION_FUNCTION_DEHOMOGENIZATION_H_INCLUDED__
-#define __UBITRACK_CALIBRATION_FUNCTION_DEHOMOGENIZATION_H_INCLUDED__
+#ifndef __UBITRACK_MATH_FUNCTION_DEHOMOGENIZATION_H_INCLUDED__
+#define __UBITRACK_MATH_FUNCTION_DEHOMOGENIZATION_H_INCLUDED__
 
 #include "MultiVariateFunction.h"
  
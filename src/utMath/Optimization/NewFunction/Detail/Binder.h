@@ -37,6 +37,21 @@
  
 namespace Ubitrack { namespace Math { namespace Optimization { namespace Function { namespace Detail {
 
+template< class CFunc, class CParam > class Binder;
+
+/**
+ * \internal
+ * Marks the shared results in an expression as outdated at the start of an evaluation.
+ * Only binders and shared expressions (see SharedExpression.h) have something to do, the
+ * calls for all other nodes are resolved at compile time and vanish.
+ */
+template< class T >
+inline void invalidateShared( const T& )
+{}
+
+template< class CFunc, class CParam >
+void invalidateShared( const Binder< CFunc, CParam >& b );
+
 /**
  * \internal
  * Binds a function to a parameter.
@@ -58,6 +73,8 @@ public:
 
 private:
 	template< class, class > friend class Binder;
+	template< std::size_t, class > friend class Shared;
+	template< class F, class P > friend void invalidateShared( const Binder< F, P >& );
 	static const std::size_t staticSize = CFunc::staticSize;
 	static const bool wantsJacobian = CFunc::wantsJacobian || CParam::wantsJacobian;
 	
@@ -101,6 +118,13 @@ private:
 	}
 
 	
+	// reset shared results in the function and the parameter
+	void i_invalidate() const
+	{
+		invalidateShared( m_func );
+		invalidateShared( m_param );
+	}
+
 	// internal evaluation with internal storage
 	
 	// evaluate and store in internal result vector
@@ -190,6 +214,7 @@ public:
 	template< class ParameterVector, class DestinationVector >
 	void evaluate( const ParameterVector& p, DestinationVector& d ) const
 	{
+		i_invalidate();
 		i_evaluate( p, d );
 	}
 
@@ -198,6 +223,7 @@ public:
 	void jacobian( const ParameterVector& p, DestinationMatrix& j ) const
 	{
 		assert( staticSize == 0 || j.size1() == staticSize );
+		i_invalidate();
 		i_evaluateParameters( p ); 
 		i_multiplyJacobian< staticSize >( p, Math::Matrix< double >::identity( size() ), j );
 	}
@@ -207,6 +233,7 @@ public:
 	void evaluateWithJacobian( const ParameterVector& p, ResultVector& r, DestinationMatrix& j ) const
 	{
 		assert( staticSize == 0 || j.size1() == staticSize );
+		i_invalidate();
 		i_evaluate( p, r ); 
 		i_multiplyJacobian< staticSize >( p, Math::Matrix< double >::identity( size() ), j );
 	}
@@ -218,6 +245,12 @@ private:
 	mutable ResultVector< CFunc::staticSize > m_result;
 };
 
+template< class CFunc, class CParam >
+void invalidateShared( const Binder< CFunc, CParam >& b )
+{
+	b.i_invalidate();
+}
+
 
 }}}}} // namespace Ubitrack::Math::Optimization::Function::Detail
 
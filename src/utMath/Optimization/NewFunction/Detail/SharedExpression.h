@@ -0,0 +1,219 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup Math
+ * @file
+ * Subexpressions that are evaluated once and used by several functions.
+ *
+ * A function object built with \c operator<< holds all its parameters by value, so a
+ * subexpression used in several branches, e.g. the rotation of a point that feeds several
+ * linear transformations, is computed once per branch. Wrapping the subexpression with
+ * \c shared and a \c SharedResult makes all copies use the same result:
+ * @code
+ * Function::SharedResult< 3 > rotated;
+ * ( Function::Addition< 3 >()
+ *     << ( Function::LinearTransformation< 3, 3 >( A ) << Function::shared( rotated, rotation ) )
+ *     << ( Function::LinearTransformation< 3, 3 >( B ) << Function::shared( rotated, rotation ) ) )
+ *   .evaluateWithJacobian( params, value, jacobian );
+ * @endcode
+ * The value is computed by the first branch that needs it in an evaluation, and the jacobian
+ * of the subexpression with respect to the parameter vector by the first branch of a jacobian
+ * computation. The other branches only multiply their left-hand side with it. The jacobians
+ * of the branches are summed, unlike parameters used directly in several branches.
+ *
+ * The results are invalidated at the start of each top-level \c evaluate, \c jacobian or
+ * \c evaluateWithJacobian. This is dispatched at compile time, expressions without shared
+ * subexpressions do not pay for it.
+ */
+
+#ifndef __UBITRACK_MATH_FUNCTION_DETAIL_SHAREDEXPRESSION_H_INCLUDED__
+#define __UBITRACK_MATH_FUNCTION_DETAIL_SHAREDEXPRESSION_H_INCLUDED__
+
+#include "Binder.h"
+
+#include <vector>
+
+#include <boost/utility.hpp>
+
+namespace Ubitrack { namespace Math { namespace Optimization { namespace Function {
+
+namespace Detail {
+	template< std::size_t Size, class CExpr > class Shared;
+
+	template< std::size_t Size, class CExpr >
+	void invalidateShared( const Shared< Size, CExpr >& s );
+}
+
+/**
+ * Storage for the result of a shared subexpression of size \c Size. The value has a fixed
+ * size and lives where the \c SharedResult is declared, usually on the stack next to the
+ * function object. The jacobian block is allocated on first use and reused.
+ * The \c SharedResult must outlive all function objects using it.
+ */
+template< std::size_t Size >
+class SharedResult
+	: private boost::noncopyable
+{
+public:
+	SharedResult()
+		: m_bValue( false )
+		, m_bJacobian( false )
+		, m_bJacobianUsed( false )
+		, m_evaluations( 0 )
+	{}
+
+	/** value of the subexpression in the last evaluation */
+	const Math::Vector< double, Size >& value() const
+	{ return m_value; }
+
+	/** number of times the subexpression was evaluated, for testing */
+	std::size_t evaluations() const
+	{ return m_evaluations; }
+
+private:
+	template< std::size_t, class > friend class Detail::Shared;
+
+	void invalidate()
+	{
+		m_bValue = false;
+		m_bJacobian = false;
+		m_bJacobianUsed = false;
+	}
+
+	bool m_bValue;
+	bool m_bJacobian;
+	/** true after the first branch has written its jacobian in the current pass */
+	bool m_bJacobianUsed;
+	std::size_t m_evaluations;
+
+	Math::Vector< double, Size > m_value;
+	/** jacobian of the subexpression, only the columns in m_columns */
+	Math::Matrix< double > m_jacobian;
+	std::vector< std::size_t > m_columns;
+};
+
+
+namespace Detail {
+
+/**
+ * \internal
+ * Parameter computed by a subexpression whose result is stored in a \c SharedResult.
+ */
+template< std::size_t Size, class CExpr >
+class Shared
+{
+public:
+	Shared( SharedResult< Size >& result, const CExpr& expr )
+		: m_result( result )
+		, m_expr( expr )
+	{}
+
+	std::size_t size() const
+	{ return m_expr.size(); }
+
+private:
+	template< class, class > friend class Binder;
+	template< std::size_t S, class E > friend void invalidateShared( const Shared< S, E >& );
+
+	static const std::size_t staticSize = Size;
+	static const bool wantsJacobian = CExpr::wantsJacobian;
+
+	void i_invalidate() const
+	{
+		m_result.invalidate();
+		invalidateShared( m_expr );
+	}
+
+	template< class ParameterVector >
+	const Math::Vector< double, Size >& value( const ParameterVector& ) const
+	{ return m_result.m_value; }
+
+	template< class ParameterVector >
+	void i_evaluateInternal( const ParameterVector& p ) const
+	{
+		if ( m_result.m_bValue )
+			return;
+
+		m_expr.i_evaluateInternal( p );
+		m_result.m_value = m_expr.value( p );
+		m_result.m_bValue = true;
+		m_result.m_evaluations++;
+	}
+
+	/** adds l * J to the columns of j that depend on the subexpression, J is computed by the first call */
+	template< std::size_t LHSize, class ParameterVector, class LeftHand, class DestinationMatrix >
+	void i_multiplyJacobian( const ParameterVector& p, const LeftHand& l, DestinationMatrix& j ) const
+	{
+		if ( !m_result.m_bJacobian )
+		{
+			Math::Matrix< double > full( Size, j.size2() );
+			full.clear();
+			m_expr.template i_multiplyJacobian< Size >( p, Math::Matrix< double >::identity( Size ), full );
+
+			m_result.m_columns.clear();
+			for ( std::size_t c = 0; c < full.size2(); c++ )
+				for ( std::size_t r = 0; r < Size; r++ )
+					if ( full( r, c ) != 0 )
+					{
+						m_result.m_columns.push_back( c );
+						break;
+					}
+
+			m_result.m_jacobian.resize( Size, m_result.m_columns.size(), false );
+			for ( std::size_t k = 0; k < m_result.m_columns.size(); k++ )
+				for ( std::size_t r = 0; r < Size; r++ )
+					m_result.m_jacobian( r, k ) = full( r, m_result.m_columns[ k ] );
+			m_result.m_bJacobian = true;
+		}
+
+		const bool bAdd = m_result.m_bJacobianUsed;
+		for ( std::size_t k = 0; k < m_result.m_columns.size(); k++ )
+		{
+			const std::size_t c = m_result.m_columns[ k ];
+			for ( std::size_t r = 0; r < j.size1(); r++ )
+			{
+				double s = bAdd ? double( j( r, c ) ) : 0.0;
+				for ( std::size_t i = 0; i < Size; i++ )
+					s += l( r, i ) * m_result.m_jacobian( i, k );
+				j( r, c ) = s;
+			}
+		}
+		m_result.m_bJacobianUsed = true;
+	}
+
+	SharedResult< Size >& m_result;
+	CExpr m_expr;
+};
+
+template< std::size_t Size, class CExpr >
+void invalidateShared( const Shared< Size, CExpr >& s )
+{
+	s.i_invalidate();
+}
+
+} // namespace Detail
+
+}}}} // namespace Ubitrack::Math::Optimization::Function
+
+#endif
@@ -0,0 +1,301 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup Math
+ * @file
+ * Dual numbers for forward-mode automatic differentiation
+ *
+ * A \c Dual< N > carries a value together with its gradient with respect to N variables.
+ * Evaluating a function template on dual numbers yields the exact jacobian in the same
+ * pass as the function value. Elementary functions are found by argument dependent
+ * lookup, so function templates must call them unqualified:
+ * @code
+ * using std::sqrt;
+ * T r = sqrt( x * x + y * y );
+ * @endcode
+ */
+
+#ifndef __UBITRACK_MATH_FUNCTION_DUAL_H_INCLUDED__
+#define __UBITRACK_MATH_FUNCTION_DUAL_H_INCLUDED__
+
+#include <cmath>
+#include <cstddef>
+
+namespace Ubitrack { namespace Math { namespace Optimization { namespace Function {
+
+/**
+ * Dual numbers and their operators live in an own namespace, so the elementary functions
+ * do not hide those of the standard library for other code in this namespace
+ */
+namespace AutoDiff {
+
+/**
+ * Scalar with a gradient of fixed size N.
+ */
+template< std::size_t N >
+class Dual
+{
+public:
+	/// the underlying scalar type
+	typedef double value_type;
+
+	/** creates a constant with value zero */
+	Dual()
+		: m_value( 0 )
+	{ clearGradient(); }
+
+	/** creates a constant */
+	Dual( const double v )
+		: m_value( v )
+	{ clearGradient(); }
+
+	/** creates the \c i-th variable with value \c v */
+	Dual( const double v, const std::size_t i )
+		: m_value( v )
+	{
+		clearGradient();
+		m_gradient[ i ] = 1;
+	}
+
+	/** the value */
+	double value() const
+	{ return m_value; }
+
+	/** partial derivative with respect to the \c i-th variable */
+	double derivative( const std::size_t i ) const
+	{ return m_gradient[ i ]; }
+
+	/** partial derivative with respect to the \c i-th variable */
+	double& derivative( const std::size_t i )
+	{ return m_gradient[ i ]; }
+
+	Dual& operator+=( const Dual& b )
+	{
+		m_value += b.m_value;
+		for ( std::size_t i = 0; i < N; i++ )
+			m_gradient[ i ] += b.m_gradient[ i ];
+		return *this;
+	}
+
+	Dual& operator-=( const Dual& b )
+	{
+		m_value -= b.m_value;
+		for ( std::size_t i = 0; i < N; i++ )
+			m_gradient[ i ] -= b.m_gradient[ i ];
+		return *this;
+	}
+
+	Dual& operator*=( const Dual& b )
+	{
+		for ( std::size_t i = 0; i < N; i++ )
+			m_gradient[ i ] = m_gradient[ i ] * b.m_value + m_value * b.m_gradient[ i ];
+		m_value *= b.m_value;
+		return *this;
+	}
+
+	Dual& operator/=( const Dual& b )
+	{
+		const double inv = 1 / b.m_value;
+		m_value *= inv;
+		for ( std::size_t i = 0; i < N; i++ )
+			m_gradient[ i ] = ( m_gradient[ i ] - m_value * b.m_gradient[ i ] ) * inv;
+		return *this;
+	}
+
+	Dual& operator+=( const double b )
+	{ m_value += b; return *this; }
+
+	Dual& operator-=( const double b )
+	{ m_value -= b; return *this; }
+
+	Dual& operator*=( const double b )
+	{
+		m_value *= b;
+		for ( std::size_t i = 0; i < N; i++ )
+			m_gradient[ i ] *= b;
+		return *this;
+	}
+
+	Dual& operator/=( const double b )
+	{ return *this *= 1 / b; }
+
+	/**
+	 * applies an elementary function with value \c f and derivative \c df at the current value,
+	 * using the chain rule
+	 */
+	Dual chain( const double f, const double df ) const
+	{
+		Dual r;
+		r.m_value = f;
+		for ( std::size_t i = 0; i < N; i++ )
+			r.m_gradient[ i ] = df * m_gradient[ i ];
+		return r;
+	}
+
+protected:
+	void clearGradient()
+	{
+		for ( std::size_t i = 0; i < N; i++ )
+			m_gradient[ i ] = 0;
+	}
+
+	double m_value;
+	// parameters that are never differentiated use Dual< 0 >
+	double m_gradient[ N ? N : 1 ];
+};
+
+
+template< std::size_t N > inline Dual< N > operator-( const Dual< N >& a )
+{ return a.chain( -a.value(), -1 ); }
+
+template< std::size_t N > inline const Dual< N >& operator+( const Dual< N >& a )
+{ return a; }
+
+template< std::size_t N > inline Dual< N > operator+( Dual< N > a, const Dual< N >& b )
+{ return a += b; }
+
+template< std::size_t N > inline Dual< N > operator-( Dual< N > a, const Dual< N >& b )
+{ return a -= b; }
+
+template< std::size_t N > inline Dual< N > operator*( Dual< N > a, const Dual< N >& b )
+{ return a *= b; }
+
+template< std::size_t N > inline Dual< N > operator/( Dual< N > a, const Dual< N >& b )
+{ return a /= b; }
+
+template< std::size_t N > inline Dual< N > operator+( Dual< N > a, const double b )
+{ return a += b; }
+
+template< std::size_t N > inline Dual< N > operator-( Dual< N > a, const double b )
+{ return a -= b; }
+
+template< std::size_t N > inline Dual< N > operator*( Dual< N > a, const double b )
+{ return a *= b; }
+
+template< std::size_t N > inline Dual< N > operator/( Dual< N > a, const double b )
+{ return a /= b; }
+
+template< std::size_t N > inline Dual< N > operator+( const double a, Dual< N > b )
+{ return b += a; }
+
+template< std::size_t N > inline Dual< N > operator-( const double a, const Dual< N >& b )
+{ return -b += a; }
+
+template< std::size_t N > inline Dual< N > operator*( const double a, Dual< N > b )
+{ return b *= a; }
+
+template< std::size_t N > inline Dual< N > operator/( const double a, const Dual< N >& b )
+{ return b.chain( a / b.value(), -a / ( b.value() * b.value() ) ); }
+
+
+// comparisons only look at the value, so branches are taken as for double
+
+template< std::size_t N > inline bool operator<( const Dual< N >& a, const Dual< N >& b ) { return a.value() < b.value(); }
+template< std::size_t N > inline bool operator>( const Dual< N >& a, const Dual< N >& b ) { return a.value() > b.value(); }
+template< std::size_t N > inline bool operator<=( const Dual< N >& a, const Dual< N >& b ) { return a.value() <= b.value(); }
+template< std::size_t N > inline bool operator>=( const Dual< N >& a, const Dual< N >& b ) { return a.value() >= b.value(); }
+template< std::size_t N > inline bool operator==( const Dual< N >& a, const Dual< N >& b ) { return a.value() == b.value(); }
+template< std::size_t N > inline bool operator!=( const Dual< N >& a, const Dual< N >& b ) { return a.value() != b.value(); }
+
+template< std::size_t N > inline bool operator<( const Dual< N >& a, const double b ) { return a.value() < b; }
+template< std::size_t N > inline bool operator>( const Dual< N >& a, const double b ) { return a.value() > b; }
+template< std::size_t N > inline bool operator<=( const Dual< N >& a, const double b ) { return a.value() <= b; }
+template< std::size_t N > inline bool operator>=( const Dual< N >& a, const double b ) { return a.value() >= b; }
+template< std::size_t N > inline bool operator==( const Dual< N >& a, const double b ) { return a.value() == b; }
+template< std::size_t N > inline bool operator!=( const Dual< N >& a, const double b ) { return a.value() != b; }
+
+template< std::size_t N > inline bool operator<( const double a, const Dual< N >& b ) { return a < b.value(); }
+template< std::size_t N > inline bool operator>( const double a, const Dual< N >& b ) { return a > b.value(); }
+template< std::size_t N > inline bool operator<=( const double a, const Dual< N >& b ) { return a <= b.value(); }
+template< std::size_t N > inline bool operator>=( const double a, const Dual< N >& b ) { return a >= b.value(); }
+template< std::size_t N > inline bool operator==( const double a, const Dual< N >& b ) { return a == b.value(); }
+template< std::size_t N > inline bool operator!=( const double a, const Dual< N >& b ) { return a != b.value(); }
+
+
+// elementary functions
+
+template< std::size_t N > inline Dual< N > sqrt( const Dual< N >& a )
+{
+	const double s = std::sqrt( a.value() );
+	return a.chain( s, 0.5 / s );
+}
+
+template< std::size_t N > inline Dual< N > sin( const Dual< N >& a )
+{ return a.chain( std::sin( a.value() ), std::cos( a.value() ) ); }
+
+template< std::size_t N > inline Dual< N > cos( const Dual< N >& a )
+{ return a.chain( std::cos( a.value() ), -std::sin( a.value() ) ); }
+
+template< std::size_t N > inline Dual< N > tan( const Dual< N >& a )
+{
+	const double t = std::tan( a.value() );
+	return a.chain( t, 1 + t * t );
+}
+
+template< std::size_t N > inline Dual< N > exp( const Dual< N >& a )
+{
+	const double e = std::exp( a.value() );
+	return a.chain( e, e );
+}
+
+template< std::size_t N > inline Dual< N > log( const Dual< N >& a )
+{ return a.chain( std::log( a.value() ), 1 / a.value() ); }
+
+template< std::size_t N > inline Dual< N > pow( const Dual< N >& a, const double b )
+{
+	const double p = std::pow( a.value(), b - 1 );
+	return a.chain( p * a.value(), b * p );
+}
+
+template< std::size_t N > inline Dual< N > fabs( const Dual< N >& a )
+{ return a.value() < 0 ? -a : a; }
+
+template< std::size_t N > inline Dual< N > abs( const Dual< N >& a )
+{ return fabs( a ); }
+
+template< std::size_t N > inline Dual< N > atan( const Dual< N >& a )
+{ return a.chain( std::atan( a.value() ), 1 / ( 1 + a.value() * a.value() ) ); }
+
+template< std::size_t N > inline Dual< N > asin( const Dual< N >& a )
+{ return a.chain( std::asin( a.value() ), 1 / std::sqrt( 1 - a.value() * a.value() ) ); }
+
+template< std::size_t N > inline Dual< N > acos( const Dual< N >& a )
+{ return a.chain( std::acos( a.value() ), -1 / std::sqrt( 1 - a.value() * a.value() ) ); }
+
+template< std::size_t N > inline Dual< N > atan2( const Dual< N >& y, const Dual< N >& x )
+{
+	// d atan2( y, x ) = ( x dy - y dx ) / ( x^2 + y^2 )
+	const double inv = 1 / ( x.value() * x.value() + y.value() * y.value() );
+	Dual< N > r( y.chain( std::atan2( y.value(), x.value() ), x.value() * inv ) );
+	r -= x.chain( 0, y.value() * inv );
+	return r;
+}
+
+} // namespace AutoDiff
+
+using AutoDiff::Dual;
+
+}}}} // namespace Ubitrack::Math::Optimization::Function
+
+#endif
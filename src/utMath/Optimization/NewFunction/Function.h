@@ -36,6 +36,7 @@
 #include "Detail/FixedParameterRef.h"
 #include "Detail/FixedParameterCopy.h"
 #include "Detail/Binder.h"
+#include "Detail/SharedExpression.h"
  
 namespace Ubitrack { namespace Math { namespace Optimization { namespace Function {
 
@@ -79,6 +80,15 @@ template< std::size_t Size, class CVector >
 Detail::ParameterWrapper< Detail::FixedParameterCopy< Size > > fixedParameterCopy( const CVector& v )
 { return Detail::ParameterWrapper< Detail::FixedParameterCopy< Size > >( Detail::FixedParameterCopy< Size >( v ) ); }
 
+/**
+ * creates a parameter computed by a subexpression that is shared with other branches of
+ * the function, see SharedExpression.h. All uses of the subexpression must refer to
+ * the same \c SharedResult.
+ */
+template< std::size_t Size, class CFunc, class CParam >
+Detail::ParameterWrapper< Detail::Shared< Size, Detail::Binder< CFunc, CParam > > > shared( SharedResult< Size >& result, const Detail::Binder< CFunc, CParam >& expr )
+{ return Detail::ParameterWrapper< Detail::Shared< Size, Detail::Binder< CFunc, CParam > > >( Detail::Shared< Size, Detail::Binder< CFunc, CParam > >( result, expr ) ); }
+
 
 /**
  * Bind a function object to a (final) parameter
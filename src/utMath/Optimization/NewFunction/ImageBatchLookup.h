@@ -0,0 +1,437 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup calibration
+ * @file
+ * function to read many interpolated pixels from an image at once
+ *
+ * \c ImageBatchLookup is the batched counterpart of \c ImageLookup for direct (photometric)
+ * alignment: it samples all points of a template in one evaluation and computes the image
+ * gradients at the same positions in the same pass, so the jacobian needs no second lookup.
+ * The points are processed in blocks: the pixel neighbourhoods are gathered into one array
+ * per neighbour, and the interpolation weights, values and gradients are computed on
+ * \c Util::simd_pack registers.
+ *
+ * Images are passed as \c ImagePlane, a view that can be created from any image class with
+ * the members \c imageData, \c width, \c height and \c widthStep, e.g. \c Vision::Image.
+ * Gradients can also be looked up from an \c ImageGradients computed once per image
+ * (or per level of an image pyramid) with the sobel operator of \c ImageLookup.
+ */
+
+#ifndef __UBITRACK_CALIBRATION_FUNCTION_IMAGEBATCHLOOKUP_H_INCLUDED__
+#define __UBITRACK_CALIBRATION_FUNCTION_IMAGEBATCHLOOKUP_H_INCLUDED__
+
+#include "MultiVariateFunction.h"
+#include "../../Util/simd_traits.h"
+
+#include <vector>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+namespace Ubitrack { namespace Math { namespace Optimization { namespace Function {
+
+/** interpolation between the pixels of an image */
+enum ImageInterpolation
+{
+	/** bilinear interpolation of the 2x2 neighbourhood */
+	bilinearInterpolation,
+	/** bicubic (Catmull-Rom) interpolation of the 4x4 neighbourhood, continuous gradients */
+	bicubicInterpolation
+};
+
+
+/**
+ * Read-only view of a single channel image with pixels of type \c PixelT.
+ */
+template< class PixelT >
+struct ImagePlane
+{
+	/** view of the image data, rows are \c widthStep bytes apart */
+	ImagePlane( const PixelT* _data, int _width, int _height, int _widthStep )
+		: data( reinterpret_cast< const char* >( _data ) )
+		, width( _width )
+		, height( _height )
+		, widthStep( _widthStep )
+	{}
+
+	/** view of an image class like \c Vision::Image */
+	template< class ImageType >
+	explicit ImagePlane( const ImageType& image )
+		: data( image.imageData )
+		, width( image.width )
+		, height( image.height )
+		, widthStep( image.widthStep )
+	{}
+
+	/** pointer to the first pixel of row \c y */
+	const PixelT* row( int y ) const
+	{ return reinterpret_cast< const PixelT* >( data + y * widthStep ); }
+
+	const char* data;
+	int width;
+	int height;
+	int widthStep;
+};
+
+
+/**
+ * Horizontal and vertical gradients of an image, computed with the sobel operator
+ * divided by 8 as in \c ImageLookup. Pixels at the border have zero gradients.
+ */
+class ImageGradients
+{
+public:
+	template< class PixelT >
+	explicit ImageGradients( const ImagePlane< PixelT >& image )
+		: m_width( image.width )
+		, m_height( image.height )
+		, m_gx( std::size_t( image.width ) * image.height, 0.0f )
+		, m_gy( m_gx.size(), 0.0f )
+	{
+		for ( int y = 1; y < m_height - 1; y++ )
+		{
+			const PixelT* r0 = image.row( y - 1 );
+			const PixelT* r1 = image.row( y );
+			const PixelT* r2 = image.row( y + 1 );
+			float* gx = &m_gx[ std::size_t( y ) * m_width ];
+			float* gy = &m_gy[ std::size_t( y ) * m_width ];
+			for ( int x = 1; x < m_width - 1; x++ )
+			{
+				gx[ x ] = ( float( r0[ x + 1 ] ) - float( r0[ x - 1 ] ) + 2 * ( float( r1[ x + 1 ] ) - float( r1[ x - 1 ] ) )
+					+ float( r2[ x + 1 ] ) - float( r2[ x - 1 ] ) ) / 8;
+				gy[ x ] = ( float( r2[ x - 1 ] ) + 2 * float( r2[ x ] ) + float( r2[ x + 1 ] )
+					- float( r0[ x - 1 ] ) - 2 * float( r0[ x ] ) - float( r0[ x + 1 ] ) ) / 8;
+			}
+		}
+	}
+
+	/** horizontal gradient */
+	ImagePlane< float > gx() const
+	{ return ImagePlane< float >( &m_gx[ 0 ], m_width, m_height, m_width * sizeof( float ) ); }
+
+	/** vertical gradient */
+	ImagePlane< float > gy() const
+	{ return ImagePlane< float >( &m_gy[ 0 ], m_width, m_height, m_width * sizeof( float ) ); }
+
+protected:
+	int m_width;
+	int m_height;
+	std::vector< float > m_gx;
+	std::vector< float > m_gy;
+};
+
+
+namespace Detail {
+
+/// @internal number of points interpolated together
+static const std::size_t imageBlockSize = 64;
+
+/// @internal a block of points with their gathered neighbourhoods, as structure of arrays
+template< typename T >
+struct ImageSampleBlock
+{
+	/** sub-pixel offsets of the points */
+	T fx[ imageBlockSize ];
+	T fy[ imageBlockSize ];
+	/** neighbourhood, row by row: 2x2 for bilinear, 4x4 for bicubic interpolation */
+	T p[ 16 ][ imageBlockSize ];
+
+	/**
+	 * gathers the neighbourhoods of points ( x[ i ], y[ i ] ). Points outside
+	 * [ 0, width - 1 ) x [ 0, height - 1 ) get zero pixels, so their value and gradients are zero.
+	 * Bicubic neighbourhoods are clamped at the image border.
+	 */
+	template< class PixelT, typename CT >
+	void gather( const ImagePlane< PixelT >& image, const ImageInterpolation interpolation,
+		const CT* x, const CT* y, const std::size_t n )
+	{
+		const int r = interpolation == bicubicInterpolation ? 4 : 2;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const int ix = static_cast< int >( std::floor( x[ i ] ) );
+			const int iy = static_cast< int >( std::floor( y[ i ] ) );
+			if ( ix < 0 || ix >= image.width - 1 || iy < 0 || iy >= image.height - 1 )
+			{
+				fx[ i ] = fy[ i ] = 0;
+				for ( int k = 0; k < r * r; k++ )
+					p[ k ][ i ] = 0;
+				continue;
+			}
+
+			fx[ i ] = T( x[ i ] - ix );
+			fy[ i ] = T( y[ i ] - iy );
+			if ( r == 2 )
+			{
+				const PixelT* row = image.row( iy ) + ix;
+				p[ 0 ][ i ] = T( row[ 0 ] );
+				p[ 1 ][ i ] = T( row[ 1 ] );
+				row = image.row( iy + 1 ) + ix;
+				p[ 2 ][ i ] = T( row[ 0 ] );
+				p[ 3 ][ i ] = T( row[ 1 ] );
+			}
+			else
+			{
+				int cols[ 4 ];
+				for ( int c = 0; c < 4; c++ )
+					cols[ c ] = std::min( std::max( ix + c - 1, 0 ), image.width - 1 );
+				for ( int k = 0; k < 4; k++ )
+				{
+					const PixelT* row = image.row( std::min( std::max( iy + k - 1, 0 ), image.height - 1 ) );
+					for ( int c = 0; c < 4; c++ )
+						p[ 4 * k + c ][ i ] = T( row[ cols[ c ] ] );
+				}
+			}
+		}
+	}
+};
+
+/**
+ * @internal bilinear interpolation of the points [ i, n ) with pack \c P, as far as full
+ * packs are available. Returns the index of the first point not processed.
+ * @param gx horizontal gradients, may be 0
+ * @param gy vertical gradients, may be 0
+ */
+template< class P, typename T >
+std::size_t bilinear( std::size_t i, const std::size_t n, const ImageSampleBlock< T >& b, T* value, T* gx, T* gy )
+{
+	typedef typename P::type V;
+	for ( ; i + P::size <= n; i += P::size )
+	{
+		const V fx( P::load( b.fx + i ) );
+		const V fy( P::load( b.fy + i ) );
+		const V p00( P::load( b.p[ 0 ] + i ) );
+		const V p10( P::load( b.p[ 2 ] + i ) );
+		const V top( P::sub( P::load( b.p[ 1 ] + i ), p00 ) );
+		const V bottom( P::sub( P::load( b.p[ 3 ] + i ), p10 ) );
+		const V upper( P::add( p00, P::mul( fx, top ) ) );
+		const V dy( P::sub( P::add( p10, P::mul( fx, bottom ) ), upper ) );
+		P::store( value + i, P::add( upper, P::mul( fy, dy ) ) );
+		if ( gx )
+		{
+			P::store( gx + i, P::add( top, P::mul( fy, P::sub( bottom, top ) ) ) );
+			P::store( gy + i, dy );
+		}
+	}
+	return i;
+}
+
+/// @internal Catmull-Rom weights w and their derivatives d for the offsets t
+template< class P >
+void cubicWeights( const typename P::type t, typename P::type* w, typename P::type* d )
+{
+	typedef typename P::type V;
+	const V t2( P::mul( t, t ) );
+	const V t3( P::mul( t2, t ) );
+	const V half( P::set1( 0.5 ) );
+	const V oneHalf( P::set1( 1.5 ) );
+	// w0 = -0.5 t^3 + t^2 - 0.5 t, w3 = 0.5 t^3 - 0.5 t^2
+	w[ 0 ] = P::sub( t2, P::mul( half, P::add( t3, t ) ) );
+	w[ 3 ] = P::mul( half, P::sub( t3, t2 ) );
+	// w1 = 1.5 t^3 - 2.5 t^2 + 1, w2 = -1.5 t^3 + 2 t^2 + 0.5 t
+	w[ 1 ] = P::add( P::sub( P::mul( oneHalf, t3 ), P::mul( P::set1( 2.5 ), t2 ) ), P::set1( 1 ) );
+	w[ 2 ] = P::add( P::sub( P::add( t2, t2 ), P::mul( oneHalf, t3 ) ), P::mul( half, t ) );
+	// derivatives
+	d[ 0 ] = P::sub( P::add( t, t ), P::add( P::mul( oneHalf, t2 ), half ) );
+	d[ 1 ] = P::sub( P::mul( P::set1( 4.5 ), t2 ), P::mul( P::set1( 5 ), t ) );
+	d[ 2 ] = P::add( P::sub( P::mul( P::set1( 4 ), t ), P::mul( P::set1( 4.5 ), t2 ) ), half );
+	d[ 3 ] = P::sub( P::mul( oneHalf, t2 ), t );
+}
+
+/**
+ * @internal bicubic interpolation of the points [ i, n ) with pack \c P, see \c bilinear
+ */
+template< class P, typename T >
+std::size_t bicubic( std::size_t i, const std::size_t n, const ImageSampleBlock< T >& b, T* value, T* gx, T* gy )
+{
+	typedef typename P::type V;
+	for ( ; i + P::size <= n; i += P::size )
+	{
+		V wx[ 4 ], dx[ 4 ], wy[ 4 ], dy[ 4 ];
+		cubicWeights< P >( P::load( b.fx + i ), wx, dx );
+		cubicWeights< P >( P::load( b.fy + i ), wy, dy );
+
+		V v( P::set1( 0 ) );
+		V vx( P::set1( 0 ) );
+		V vy( P::set1( 0 ) );
+		for ( std::size_t r = 0; r < 4; r++ )
+		{
+			V h( P::set1( 0 ) );
+			V hd( P::set1( 0 ) );
+			for ( std::size_t c = 0; c < 4; c++ )
+			{
+				const V p( P::load( b.p[ 4 * r + c ] + i ) );
+				h = P::add( h, P::mul( wx[ c ], p ) );
+				hd = P::add( hd, P::mul( dx[ c ], p ) );
+			}
+			v = P::add( v, P::mul( wy[ r ], h ) );
+			vx = P::add( vx, P::mul( wy[ r ], hd ) );
+			vy = P::add( vy, P::mul( dy[ r ], h ) );
+		}
+		P::store( value + i, v );
+		if ( gx )
+		{
+			P::store( gx + i, vx );
+			P::store( gy + i, vy );
+		}
+	}
+	return i;
+}
+
+} // namespace Detail
+
+
+/**
+ * Interpolates an image at many sub-pixel positions.
+ * @param image the image
+ * @param interpolation bilinear or bicubic
+ * @param x horizontal coordinates of the \c n points
+ * @param y vertical coordinates of the \c n points
+ * @param value receives the \c n interpolated values, 0 for points outside the image
+ * @param gx if not 0, receives the horizontal derivatives of the interpolated image
+ * @param gy if not 0, receives the vertical derivatives of the interpolated image
+ */
+template< class PixelT, typename CT, typename T >
+void sampleImage( const ImagePlane< PixelT >& image, const ImageInterpolation interpolation,
+	const CT* x, const CT* y, const std::size_t n, T* value, T* gx = 0, T* gy = 0 )
+{
+	typedef Util::simd_pack< T > Pack;
+	typedef Util::simd_scalar< T > Scalar;
+	Detail::ImageSampleBlock< T > block;
+	for ( std::size_t s = 0; s < n; s += Detail::imageBlockSize )
+	{
+		const std::size_t m = std::min( Detail::imageBlockSize, n - s );
+		block.gather( image, interpolation, x + s, y + s, m );
+		T* bx = gx ? gx + s : 0;
+		T* by = gy ? gy + s : 0;
+		if ( interpolation == bicubicInterpolation )
+			Detail::bicubic< Scalar >( Detail::bicubic< Pack >( 0, m, block, value + s, bx, by ), m, block, value + s, bx, by );
+		else
+			Detail::bilinear< Scalar >( Detail::bilinear< Pack >( 0, m, block, value + s, bx, by ), m, block, value + s, bx, by );
+	}
+}
+
+
+/**
+ * Function that reads many pixels from an image. The parameter is the vector of pixel
+ * coordinates ( x0, y0, x1, y1, ... ), the result the vector of interpolated values.
+ *
+ * The gradients are those of the interpolated image, computed together with the values,
+ * or bilinearly interpolated from precomputed \c ImageGradients. They are kept from the
+ * evaluation for the jacobian, which the function framework always requests after
+ * evaluating the same parameters.
+ *
+ * @param ImageT the pixel type
+ * @param N the number of points, 0 if only known at run time
+ */
+template< class ImageT, unsigned N = 0 >
+class ImageBatchLookup
+	: public MultiVariateFunction< ImageBatchLookup< ImageT, N >, N >
+{
+public:
+	/**
+	 * @param image the image, must outlive the function
+	 * @param nPoints the number of points, must equal \c N if that is not 0
+	 * @param interpolation bilinear or bicubic
+	 * @param gradients precomputed gradients of the image, must outlive the function. If 0,
+	 *   the gradients of the interpolation are used.
+	 */
+	ImageBatchLookup( const ImagePlane< ImageT >& image, std::size_t nPoints = N,
+		ImageInterpolation interpolation = bilinearInterpolation, const ImageGradients* gradients = 0 )
+		: m_image( image )
+		, m_size( nPoints )
+		, m_interpolation( interpolation )
+		, m_gradients( gradients )
+		, m_x( nPoints )
+		, m_y( nPoints )
+		, m_values( nPoints )
+		, m_gx( nPoints )
+		, m_gy( nPoints )
+	{
+		assert( !N || nPoints == N );
+	}
+
+	/** number of points */
+	unsigned size() const
+	{ return static_cast< unsigned >( m_size ); }
+
+	/*
+	 * @param result the pixel values
+	 * @param p the pixel coordinates
+	 */
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& p ) const
+	{
+		if ( !m_size )
+			return;
+
+		for ( std::size_t i = 0; i < m_size; i++ )
+		{
+			m_x[ i ] = p( 2 * i );
+			m_y[ i ] = p( 2 * i + 1 );
+		}
+
+		if ( m_gradients )
+		{
+			sampleImage( m_image, m_interpolation, &m_x[ 0 ], &m_y[ 0 ], m_size, &m_values[ 0 ] );
+			sampleImage( m_gradients->gx(), bilinearInterpolation, &m_x[ 0 ], &m_y[ 0 ], m_size, &m_gx[ 0 ] );
+			sampleImage( m_gradients->gy(), bilinearInterpolation, &m_x[ 0 ], &m_y[ 0 ], m_size, &m_gy[ 0 ] );
+		}
+		else
+			sampleImage( m_image, m_interpolation, &m_x[ 0 ], &m_y[ 0 ], m_size, &m_values[ 0 ], &m_gx[ 0 ], &m_gy[ 0 ] );
+
+		for ( std::size_t i = 0; i < m_size; i++ )
+			result( i ) = m_values[ i ];
+	}
+
+	template< class LeftHand, class DestinationMatrix, class Param1 >
+	void multiplyJacobian1( const LeftHand& l, DestinationMatrix& j, const Param1& ) const
+	{
+		// the jacobian is block diagonal with the gradients as 1x2 blocks
+		for ( std::size_t r = 0; r < j.size1(); r++ )
+			for ( std::size_t i = 0; i < m_size; i++ )
+			{
+				const double li = l( r, i );
+				j( r, 2 * i ) = li * m_gx[ i ];
+				j( r, 2 * i + 1 ) = li * m_gy[ i ];
+			}
+	}
+
+protected:
+	ImagePlane< ImageT > m_image;
+	std::size_t m_size;
+	ImageInterpolation m_interpolation;
+	const ImageGradients* m_gradients;
+
+	/// coordinates, values and gradients of the last evaluation
+	mutable std::vector< double > m_x;
+	mutable std::vector< double > m_y;
+	mutable std::vector< double > m_values;
+	mutable std::vector< double > m_gx;
+	mutable std::vector< double > m_gy;
+};
+
+} } } } // namespace Ubitrack::Math::Optimization::Function
+
+#endif
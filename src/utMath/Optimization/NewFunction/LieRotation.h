@@ -29,11 +29,12 @@
  * @author Daniel Pustka <daniel.pustka@in.tum.de>
  */
 
-#ifndef __UBITRACK_CALIBRATION_FUNCTION_LIEROTATION_H_INCLUDED__
-#define __UBITRACK_CALIBRATION_FUNCTION_LIEROTATION_H_INCLUDED__
+#ifndef __UBITRACK_MATH_FUNCTION_LIEROTATION_H_INCLUDED__
+#define __UBITRACK_MATH_FUNCTION_LIEROTATION_H_INCLUDED__
  
 #include "MultiVariateFunction.h"
 #include "../../Quaternion.h"
+#include "../../LieGroups.h"
 
 namespace Ubitrack { namespace Math { namespace Optimization { namespace Function {
 
@@ -57,126 +58,10 @@ public:
 	{
 		typedef typename LeftHand::value_type VType;
 		Math::Matrix< VType, 3, 3 > J;
-	
-		VType t51944 = rotation( 0 );
-		VType t51945 = t51944 * t51944;
-		VType t51946 = rotation( 1 );
-		VType t51947 = t51946 * t51946;
-		VType t51948 = rotation( 2 );
-		VType t51949 = t51948 * t51948;
-		VType t51950 = t51945 + t51947 + t51949;
-		VType t51952 = sqrt( t51950 );
-		
-		if ( t51952 < VType( 1e-6 ) )
-		{
-			// avoid division by zero and compute limit of J with r->0
-			J( 0, 0 ) = 0;
-			J( 0, 1 ) = point( 2 );
-			J( 0, 2 ) = -point( 1 );
-			J( 1, 0 ) = -point( 2 );
-			J( 1, 1 ) = 0;
-			J( 1, 2 ) = point( 0 );
-			J( 2, 0 ) = point( 1 );
-			J( 2, 1 ) = -point( 0 );
-			J( 2, 2 ) = 0;
-		}
-		else
-		{
-			VType t51953 = cos( t51952 );
-			VType t51955 = point( 1 );
-			VType t51957 = point( 2 );
-			VType t51963 = t51946 * t51955;
-			VType t51964 = t51948 * t51957;
-			VType t51965 = t51963 + t51964;
-			VType t51962 = t51947 + t51949;
-			VType t51967 = sin( t51952 );
-			VType t51971 = point( 0 );
-			VType t51956 =  - ( t51948 * t51955 );
-			VType t51958 = t51946 * t51957;
-			VType t51951 = 1 / ( t51950 * t51950 );
-			VType t51954 = t51944 * t51944 * t51944;
-			VType t51959 = t51956 + t51958;
-			VType t52004 =  - t51949;
-			VType t52001 = 2 * t51971;
-			VType t52002 = t51956 + t51958 + t52001;
-			VType t51961 =  -1 + t51953;
-			VType t52058 =  - ( t51946 * t51971 );
-			VType t52015 = t51948 * t51948 * t51948;
-			VType t51984 = t51946 * t51946 * t51946;
-			VType t52022 = t51944 * t51971;
-			VType t52023 = t51963 + t52022;
-			VType t52024 =  - 2 * t51948 * t52023;
-			VType t52025 = t51945 + t51947 + t52004;
-			VType t52026 = t51957 * t52025;
-			VType t52027 = t52024 + t52026;
-			VType t52045 = ( t51944 * t51944 ) * ( t51944 * t51944 );
-			VType t52042 =  - ( t51952 * t51955 * t51967 );
-			VType t52083 =  - ( t51948 * t51971 );
-			VType t52090 = t51948 * t51971;
-			VType t52048 = t51952 * t51957 * t51967;
-			VType t52059 = t51946 * t51952 * t51967 * t51971;
-			VType t51988 = t51946 * t51948 * t51952 * t51955 * t51967;
-			VType t52110 = t51944 * t51946 * t51948 * t51952 * t51967 * t51971;
-			VType t51974 =  - ( t51949 * t51952 * t51967 * t51971 );
-			VType t51992 =  -2 * t51944 * t51946 * t51971;
-			VType t51993 = t51945 * t51955;
-			VType t51994 =  - ( t51947 * t51955 );
-			VType t51995 = t51949 * t51955;
-			VType t51996 =  -2 * t51946 * t51948 * t51957;
-			VType t51997 = t51992 + t51993 + t51994 + t51995 + t51996;
-			VType t52139 = t51955 * t51962;
-			VType t52067 = t51954 * t51971;
-			VType t52191 = t51956 + t51971;
-			VType t52167 = t51948 * t51955;
-			VType t52198 = t51955 + t52090;
-			VType t52007 = 2 * t51946 * t51948 * t51957;
-			J( 0, 0 ) = t51951 * ( t51953 * t51954 * t51959 - t51961 * t51962 * t51965 + t51945 * t51965 * (  - 1 + t51953 + t51952 * t51967 ) + 
-				t51944 * ( t51948 * t51952 * t51955 * t51967 - t51946 * t51952 * t51957 * t51967 + 
-				t51953 * t51962 * ( t51956 + t51958 - 2 * t51971 ) + 2 * t51962 * t51971 - t51947 * t51952 * t51967 * t51971 + t51974 ) );
-			J( 0, 1 ) = t51951 * ( t51944 * t51947 * t51952 * t51955 * t51967 + t51945 * t51952 * t51957 * t51967 + 
-				t51944 * t51946 * t51948 * t51952 * t51957 * t51967 + t51949 * t51952 * t51957 * t51967 - 
-				t51946 * t51949 * t51952 * t51967 * t51971 - t51952 * t51967 * t51971 * t51984 + t51988 + t51944 * t51997 + 
-				t51953 * (  - ( t51954 * t51955 ) + t51946 * t51959 * t51962 + t51945 * t51946 * t52002 + 
-				t51944 * ( t51955 * ( t51947 + t52004 ) + t52007 ) ) );
-			J( 0, 2 ) = t51951 * (  - ( t51945 * t51952 * t51955 * t51967 ) - t51947 * t51952 * t51955 * t51967 + 
-				t51944 * t51946 * t51948 * t51952 * t51955 * t51967 - t51946 * t51948 * t51952 * t51957 * t51967 + 
-				t51944 * t51949 * t51952 * t51957 * t51967 - t51947 * t51948 * t51952 * t51967 * t51971 + 
-				t51953 * (  - ( t51954 * t51957 ) + t51944 * ( 2 * t51946 * t51948 * t51955 - t51947 * t51957 + t51949 * t51957 ) + 
-				t51948 * t51959 * t51962 + t51945 * t51948 * t52002 ) - t51952 * t51967 * t51971 * t52015 + t51944 * t52027 );
-			J( 1, 0 ) = t51951 * ( t51944 * ( 2 * t51946 * t51961 * t51965 - t51949 * t51952 * t51955 * t51967 + 
-				t51946 * t51948 * t51952 * t51957 * t51967 + t51948 * t51953 * t51962 * t51971 - t51948 * t51952 * t51967 * t51971 ) + 
-				t51954 * ( t51948 * t51953 * t51971 + t52042 ) - t51953 * t51957 * t52045 - t51962 * ( t51946 * t51961 * t51971 + t52048 ) + 
-				t51945 * ( t52058 - t51953 * ( t51957 * t51962 + t52058 ) + t52059 ) );
-			J( 1, 1 ) = t51951 * ( 2 * t51945 * t51946 * t51955 + 2 * t51946 * t51949 * t51955 + t51945 * t51948 * t51957 - 
-				t51947 * t51948 * t51957 - t51945 * t51946 * t51952 * t51955 * t51967 - t51946 * t51949 * t51952 * t51955 * t51967 + 
-				t51944 * t51946 * t51952 * t51957 * t51967 + t51947 * t51948 * t51952 * t51957 * t51967 - t51944 * t51947 * t51971 + 
-				t51944 * t51949 * t51971 + t51944 * t51947 * t51952 * t51967 * t51971 - t51946 * t51948 * t51952 * t51967 * t51971 + 
-				t51957 * t52015 + t52067 - t51953 * ( t51954 * ( t51958 + t51971 ) + 
-				t51944 * ( t51946 * t51957 * t51962 + (  - t51947 + t51949 ) * t51971 ) + 
-				t51945 * ( t51964 + t51946 * ( 2 * t51955 + t52083 ) ) - 
-				t51948 * ( t51947 * t51957 - t51949 * t51957 + t51971 * t51984 + t51946 * t51948 * (  - 2 * t51955 + t52090 ) ) ) );
-			J( 1, 2 ) = t51951 * (  - ( t51945 * t51948 * t51952 * t51955 * t51967 ) + t51944 * t51948 * t51952 * t51957 * t51967 + 
-				t51946 * t51949 * t51952 * t51957 * t51967 + t51945 * t51952 * t51967 * t51971 + t51947 * t51952 * t51967 * t51971 - 
-				t51952 * t51955 * t51967 * t52015 + 
-				t51953 * (  - ( t51957 * ( t51945 * t51946 - t51946 * t51949 + t51948 * t51954 + t51944 * t51948 * t51962 + t51984 ) ) + 
-				t51948 * ( 2 * t51947 * t51955 + t51971 * ( 2 * t51944 * t51946 + ( t51945 + t51947 ) * t51948 + t52015 ) ) ) + 
-				t51946 * t52027 + t52110 );
-			J( 2, 0 ) = t51951 * (  - ( t51962 * ( t51948 * t51961 * t51971 + t52042 ) ) + t51953 * t51955 * t52045 - 
-				t51954 * ( t51946 * t51953 * t51971 + t52048 ) + 
-				t51944 * ( 2 * t51948 * t51961 * t51965 - t51947 * t51952 * t51957 * t51967 - t51946 * t51953 * t51962 * t51971 + t51988 + t52059 ) + 
-				t51945 * ( t51948 * t51952 * t51967 * t51971 + t52083 + t51953 * ( t52090 + t52139 ) ) );
-			J( 2, 1 ) = t51951 * (  - ( t51944 * t51946 * t51952 * t51955 * t51967 ) + t51947 * t51948 * t51952 * t51955 * t51967 - 
-				t51945 * t51946 * t51952 * t51957 * t51967 - t51945 * t51952 * t51967 * t51971 + t51974 - t51952 * t51957 * t51967 * t51984 + 
-				t51948 * t51997 + t52110 + t51953 * ( t51946 * t51954 * t51955 + 2 * t51946 * t51949 * t51957 - t51955 * t52015 + 
-				t51947 * t51948 * ( t51955 + t52083 ) + t51944 * t51946 * ( 2 * t51948 * t51971 + t52139 ) - 
-				t51945 * ( t51947 * t51971 + t52167 ) - t51971 * ( t51946 * t51946 ) * ( t51946 * t51946 ) ) );
-			J( 2, 2 ) = t51951 * ( t51945 * t51946 * t51955 - t51946 * t51949 * t51955 + 2 * t51945 * t51948 * t51957 + 
-				2 * t51947 * t51948 * t51957 - t51944 * t51948 * t51952 * t51955 * t51967 + t51946 * t51949 * t51952 * t51955 * t51967 - 
-				t51945 * t51948 * t51952 * t51957 * t51967 - t51947 * t51948 * t51952 * t51957 * t51967 + t51944 * t51947 * t51971 - 
-				t51944 * t51949 * t51971 + t51946 * t51948 * t51952 * t51967 * t51971 + t51944 * t51949 * t51952 * t51967 * t51971 + 
-				t51955 * t51984 + t52067 - t51953 * ( t51954 * t52191 + t51944 * (  - ( t51949 * ( t51971 + t52167 ) ) + t51947 * t52191 ) + 
-				t51945 * ( 2 * t51948 * t51957 + t51946 * t52198 ) + t51946 * ( t52007 + t51949 * (  - t51955 + t52090 ) + t51947 * t52198 ) ) );
-		}
+		Math::Vector< VType, 3 > rotated;
+
+		// the closed form -[ R p ]x Jl( r ), see LieGroups.h
+		Math::Lie::SO3Terms< VType >( rotation ).rotate( point, rotated, J );
 		
 		noalias( j ) = boost::numeric::ublas::prod( l, J );
 	}
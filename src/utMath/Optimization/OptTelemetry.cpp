@@ -0,0 +1,162 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Compact records of optimizer iterations
+ */
+
+#include "OptTelemetry.h"
+
+#include <ostream>
+#include <sstream>
+
+#include <boost/thread/mutex.hpp>
+
+#include <log4cpp/Category.hh>
+
+#include <utMeasurement/Timestamp.h>
+#include <utUtil/MpscQueue.h>
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+boost::atomic< bool > OptTelemetry::s_enabled( false );
+
+namespace {
+
+typedef Util::MpscQueue< OptIterationRecord > RecordQueue;
+
+/// created on the first enable and never deleted, so optimizers may run during the shutdown
+boost::atomic< RecordQueue* > g_queue( 0 );
+boost::atomic< boost::uint64_t > g_dropped( 0 );
+boost::atomic< boost::uint32_t > g_run( 0 );
+
+/// serializes enable and the consumers of the queue
+boost::mutex& consumerMutex()
+{
+	static boost::mutex mutex;
+	return mutex;
+}
+
+} // anonymous namespace
+
+
+std::ostream& operator<<( std::ostream& s, const OptIterationRecord& record )
+{
+	s << record.optimizer << " run " << record.run << " iteration " << record.iteration
+		<< ": residual " << record.residual;
+	if ( record.lambda != 0.0 )
+		s << ", lambda " << record.lambda;
+	if ( record.rank >= 0 )
+		s << ", rank " << record.rank;
+	return s;
+}
+
+
+void OptTelemetry::enable( std::size_t capacity )
+{
+	boost::mutex::scoped_lock lock( consumerMutex() );
+	if ( !g_queue.load() )
+		g_queue.store( new RecordQueue( capacity ) );
+	s_enabled.store( true );
+}
+
+
+void OptTelemetry::disable()
+{
+	s_enabled.store( false );
+}
+
+
+void OptTelemetry::record( const OptIterationRecord& record )
+{
+	if ( !enabled() )
+		return;
+
+	if ( !g_queue.load( boost::memory_order_acquire )->push( record ) )
+		g_dropped.fetch_add( 1, boost::memory_order_relaxed );
+}
+
+
+std::size_t OptTelemetry::drain( std::vector< OptIterationRecord >& records )
+{
+	boost::mutex::scoped_lock lock( consumerMutex() );
+	RecordQueue* queue = g_queue.load();
+	if ( !queue )
+		return 0;
+
+	std::size_t n = 0;
+	OptIterationRecord record;
+	while ( queue->pop( record ) )
+	{
+		records.push_back( record );
+		n++;
+	}
+	return n;
+}
+
+
+std::size_t OptTelemetry::logRecords( log4cpp::Category& category )
+{
+	std::vector< OptIterationRecord > records;
+	drain( records );
+	if ( !category.isDebugEnabled() )
+		return 0;
+
+	for ( std::size_t i = 0; i < records.size(); i++ )
+	{
+		std::ostringstream s;
+		s << records[ i ];
+		category.debug( s.str() );
+	}
+	return records.size();
+}
+
+
+boost::uint64_t OptTelemetry::droppedCount()
+{
+	return g_dropped.load( boost::memory_order_relaxed );
+}
+
+
+boost::uint32_t OptTelemetry::newRun()
+{
+	return g_run.fetch_add( 1, boost::memory_order_relaxed ) + 1;
+}
+
+
+void OptTelemetryRun::record( std::size_t iteration, double residual, double lambda, int rank ) const
+{
+	OptIterationRecord record;
+	record.time = Measurement::nowCoarse();
+	record.optimizer = m_optimizer;
+	record.run = m_run;
+	record.iteration = static_cast< boost::uint32_t >( iteration );
+	record.residual = residual;
+	record.lambda = lambda;
+	record.rank = rank;
+	OptTelemetry::record( record );
+}
+
+}}} // namespace Ubitrack::Math::Optimization
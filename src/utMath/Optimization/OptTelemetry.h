@@ -0,0 +1,175 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Compact records of optimizer iterations that can stay enabled in production builds
+ *
+ * The \c OPT_LOG_* macros stream vectors and matrices into strings and are therefore only
+ * compiled in with \c OPTIMIZATION_LOGGING. The telemetry is always compiled in instead: every
+ * iteration of the least-squares optimizers reports the residual, the damping and the rank
+ * through an \c OptTelemetryRun. While the telemetry is disabled this is a single flag test.
+ * While it is enabled, the scalars are copied into a fixed-size \c OptIterationRecord and
+ * appended to a lock-free queue. The records are rendered later, offline or by a logging
+ * thread:
+ * @code
+ * Math::Optimization::OptTelemetry::enable();
+ * ...
+ * // e.g. from a timer on a background thread
+ * Math::Optimization::OptTelemetry::logRecords( log4cpp::Category::getInstance( "Ubitrack.Optimization" ) );
+ * @endcode
+ */
+
+#ifndef __UBITRACK_MATH_OPTIMIZATION_OPTTELEMETRY_H_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_OPTTELEMETRY_H_INCLUDED__
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+#include <utCore.h>
+#include <utUtil/Progress.h>
+
+namespace log4cpp {
+	class Category;
+}
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+/** one iteration of an optimizer */
+struct OptIterationRecord
+{
+	/** time of the record, in nanoseconds as \c Measurement::Timestamp */
+	boost::uint64_t time;
+
+	/** name of the optimizer, a string literal */
+	const char* optimizer;
+
+	/** number of the optimization, to tell the iterations of concurrent optimizations apart */
+	boost::uint32_t run;
+
+	/** iteration within the optimization, 0 for the initial residual */
+	boost::uint32_t iteration;
+
+	/** residual after the iteration */
+	double residual;
+
+	/** damping of Levenberg-Marquardt or trust region radius of Dogleg, 0 if not applicable */
+	double lambda;
+
+	/** effective rank of the normal equations, -1 if not computed */
+	boost::int32_t rank;
+};
+
+/** renders a record as one line of text */
+UBITRACK_EXPORT std::ostream& operator<<( std::ostream& s, const OptIterationRecord& record );
+
+
+/**
+ * Global collection of the iteration records of all optimizers.
+ *
+ * Any number of threads record iterations without locking, the records are queued until they
+ * are taken with \c drain. When the queue is full, further records are dropped and counted.
+ */
+class UBITRACK_EXPORT OptTelemetry
+{
+public:
+	/**
+	 * starts recording iterations
+	 * @param capacity number of records that are kept until they are drained. Only used
+	 *   when the telemetry is enabled for the first time.
+	 */
+	static void enable( std::size_t capacity = 16384 );
+
+	/** stops recording, the records collected so far can still be drained */
+	static void disable();
+
+	/** true while iterations are recorded */
+	static bool enabled()
+	{ return s_enabled.load( boost::memory_order_relaxed ); }
+
+	/** appends a record, does nothing if the telemetry is disabled */
+	static void record( const OptIterationRecord& record );
+
+	/**
+	 * moves the queued records to the end of \c records
+	 * @return the number of records moved
+	 */
+	static std::size_t drain( std::vector< OptIterationRecord >& records );
+
+	/**
+	 * renders the queued records into a log4cpp category at DEBUG priority
+	 * @return the number of records logged
+	 */
+	static std::size_t logRecords( log4cpp::Category& category );
+
+	/** number of records dropped because the queue was full */
+	static boost::uint64_t droppedCount();
+
+	/** returns a new optimization number */
+	static boost::uint32_t newRun();
+
+protected:
+	static boost::atomic< bool > s_enabled;
+};
+
+
+/**
+ * Reports the iterations of one optimization. Optimizers create one at the start, which is
+ * cheap when the telemetry is disabled.
+ */
+class UBITRACK_EXPORT OptTelemetryRun
+{
+public:
+	/** @param optimizer name of the optimizer, must be a string literal */
+	explicit OptTelemetryRun( const char* optimizer )
+		: m_optimizer( optimizer )
+		, m_run( OptTelemetry::enabled() ? OptTelemetry::newRun() : 0 )
+	{}
+
+	/**
+	 * records an iteration if the telemetry is enabled and reports it to the \c Util::ProgressContext
+	 * of the calling thread
+	 * @throws Util::OperationCancelled if the optimization was cancelled
+	 */
+	void iteration( const std::size_t iteration, const double residual, const double lambda = 0.0, const int rank = -1 ) const
+	{
+		if ( OptTelemetry::enabled() )
+			record( iteration, residual, lambda, rank );
+		Ubitrack::Util::reportProgress( m_optimizer, iteration, residual, lambda );
+	}
+
+protected:
+	void record( std::size_t iteration, double residual, double lambda, int rank ) const;
+
+	const char* m_optimizer;
+	const boost::uint32_t m_run;
+};
+
+}}} // namespace Ubitrack::Math::Optimization
+
+#endif
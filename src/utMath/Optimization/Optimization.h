@@ -33,9 +33,14 @@
 #define __UBITRACK_MATH_OPTIMIZATION_H_INCLUDED__
 
 #include <math.h> // fabs
+#include <cstddef>
+#include <boost/type_traits/integral_constant.hpp>
+
+#include "Deadline.h"
 
 // to turn on logging of internal processing, create a log4cpp::Category object called "optLogger"
 // and #define OPTIMIZATION_LOGGING before including this header 
+// (residuals of the iterations are also available at runtime without it, see OptTelemetry.h)
 #ifdef OPTIMIZATION_LOGGING
 	#include <boost/numeric/ublas/io.hpp>
 	#define OPT_LOG_TRACE( message ) LOG4CPP_TRACE( optLogger, message )
@@ -62,22 +67,69 @@ public:
 	 * @param maxIterations maximum number of iterations, <= 0 for unlimited iterations
 	 * @param precision stops if the residual r changes from one iteration to the next by less 
 	 *    than r*precision.
+	 * @param deadline stops after the first iteration that ends behind the deadline, the
+	 *    optimizer then returns the best parameters so far
 	 */
-	OptTerminate( const std::size_t maxIterations, double precision = 0.0 )
+	OptTerminate( const std::size_t maxIterations, double precision = 0.0, const Deadline& deadline = Deadline() )
 		: m_maxIterations( maxIterations )
 		, m_precision( precision )
+		, m_deadline( deadline )
 	{}
 
 	/** this function is evaluated by the optimizer */
 	bool operator()( const std::size_t iterations, const double resPrev, const double resNow ) const
 	{ 
 		return ( m_maxIterations > 0 && iterations >= m_maxIterations ) ||
-			( m_precision != 0.0 && fabs( resPrev - resNow ) < m_precision * resNow );
+			( m_precision != 0.0 && fabs( resPrev - resNow ) < m_precision * resNow ) ||
+			m_deadline.check();
 	}
 
+	/** the deadline, which tells whether the optimization was stopped by it */
+	const Deadline& deadline() const
+	{ return m_deadline; }
+
 protected:
 	const std::size_t m_maxIterations;
 	const double m_precision;
+	const Deadline m_deadline;
+};
+
+
+/**
+ * Termination criterion as \c OptTerminate, that additionally records the number of
+ * iterations and whether the optimization stopped because the residual converged.
+ * The record refers to the last call, so use one object per optimization.
+ */
+class OptTerminateRecord
+	: public OptTerminate
+{
+public:
+	/** Constructor, see \c OptTerminate */
+	OptTerminateRecord( const std::size_t maxIterations, double precision = 0.0, const Deadline& deadline = Deadline() )
+		: OptTerminate( maxIterations, precision, deadline )
+		, m_iterations( 0 )
+		, m_converged( false )
+	{}
+
+	/** this function is evaluated by the optimizer */
+	bool operator()( const std::size_t iterations, const double resPrev, const double resNow ) const
+	{
+		m_iterations = iterations;
+		m_converged = m_precision != 0.0 && fabs( resPrev - resNow ) < m_precision * resNow;
+		return m_converged || ( m_maxIterations > 0 && iterations >= m_maxIterations ) || m_deadline.check();
+	}
+
+	/** number of iterations performed */
+	std::size_t iterations() const
+	{ return m_iterations; }
+
+	/** true if the residual changed by less than the precision in the last iteration */
+	bool converged() const
+	{ return m_converged; }
+
+protected:
+	mutable std::size_t m_iterations;
+	mutable bool m_converged;
 };
 
 
@@ -101,6 +153,70 @@ public:
 	{}
 };
 
+
+namespace Detail {
+
+/** @internal checks if \c evaluate and \c jacobian of a problem can be called with the given types */
+template< class P, class VT1, class VT2, class MT >
+struct ResidualEvaluationProbe
+{
+	typedef char Yes;
+	typedef char ( &No )[ 2 ];
+	template< std::size_t > struct Probe {};
+
+	template< class U >
+	static Yes test( Probe< sizeof( ( static_cast< U* >( 0 )->evaluate( *static_cast< VT1* >( 0 ), *static_cast< const VT2* >( 0 ) ),
+		static_cast< U* >( 0 )->jacobian( *static_cast< const VT2* >( 0 ), *static_cast< MT* >( 0 ) ), 0 ) ) >* );
+
+	template< class U >
+	static No test( ... );
+
+	enum { value = sizeof( test< P >( 0 ) ) == sizeof( Yes ) };
+};
+
+/**
+ * @internal
+ * \c boost::true_type if the problem class \c P implements \c evaluate and \c jacobian of the
+ * \c UnaryFunctionPrototype in addition to \c evaluateWithJacobian. Optimizers then evaluate trial
+ * steps without jacobian and compute the jacobian only for accepted steps.
+ */
+template< class P, class VT1, class VT2, class MT >
+struct HasResidualEvaluation
+	: public boost::integral_constant< bool, ResidualEvaluationProbe< P, VT1, VT2, MT >::value >
+{};
+
+/**
+ * @internal
+ * evaluates a problem at a trial point
+ * @return true if the jacobian has been computed as well
+ */
+template< class P, class VT1, class VT2, class MT >
+bool evaluateTrial( P& problem, VT1& result, const VT2& input, MT& J, boost::false_type )
+{
+	problem.evaluateWithJacobian( result, input, J );
+	return true;
+}
+
+/** @internal residual only evaluation of a trial point */
+template< class P, class VT1, class VT2, class MT >
+bool evaluateTrial( P& problem, VT1& result, const VT2& input, MT&, boost::true_type )
+{
+	problem.evaluate( result, input );
+	return false;
+}
+
+/** @internal computes the jacobian of an accepted trial point, if \c evaluateTrial did not */
+template< class P, class VT2, class MT >
+void evaluateAcceptedJacobian( P& problem, const VT2& input, MT& J, boost::true_type )
+{ problem.jacobian( input, J ); }
+
+/** @internal */
+template< class P, class VT2, class MT >
+void evaluateAcceptedJacobian( P&, const VT2&, MT&, boost::false_type )
+{}
+
+} // namespace Detail
+
 }}} // namespace Ubitrack::Math::Optimization
 
 #endif
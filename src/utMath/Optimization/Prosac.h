@@ -0,0 +1,349 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * PROSAC (progressive sample consensus) algorithm
+ *
+ * Variant of RANSAC for values with a quality score, see
+ * O. Chum and J. Matas, "Matching with PROSAC - Progressive Sample Consensus", CVPR 2005.
+ * The hypotheses are drawn from a growing set of the best scored values,
+ * after \c nMaxIterations iterations sampling is uniform as in RANSAC.
+ */
+
+
+#ifndef __UBITRACK_MATH_OPTIMIZATION_PROSAC_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_PROSAC_INCLUDED__
+
+#include "Ransac.h"
+
+#include <vector>
+#include <utility> // std::pair
+#include <functional> // std::greater
+#include <algorithm> // std::stable_sort
+#include <cmath>
+
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+/**
+ * @internal draws the random sets of the PROSAC algorithm
+ *
+ * In iteration \c t the set consists of the \c n-th best value and \c setSize-1 values
+ * drawn from the \c n-1 best ones, where \c n grows according to the schedule of
+ * the original paper. Once all values are part of the sampling set, the sets are drawn uniformly.
+ */
+class ProsacSampler
+{
+public:
+	typedef std::vector< std::size_t >::const_iterator const_iterator;
+
+	/**
+	 * @param order indices of the values sorted by decreasing quality
+	 * @param setSize amount of values in each set
+	 * @param nGrowth number of iterations after which all values are sampled uniformly
+	 */
+	ProsacSampler( const std::vector< std::size_t >& order, const std::size_t setSize, const std::size_t nGrowth )
+		: m_order( order )
+		, m_setSize( setSize )
+		, m_n( setSize )
+		, m_t( 0 )
+		, m_tn( nGrowth )
+		, m_tnPrime( 1 )
+	{
+		assert( setSize > 0 && setSize <= order.size() );
+		m_positions.reserve( order.size() );
+		std::generate_n( std::back_inserter( m_positions ), order.size(), IndexGenerator() );
+		m_swaps.resize( setSize );
+		m_sample.resize( setSize );
+
+		// expected number of samples drawn only from the setSize best values
+		for ( std::size_t i = 0; i < setSize; i++ )
+			m_tn *= static_cast< double >( setSize - i ) / ( order.size() - i );
+	}
+
+	/** draws the next set, accessible via \c begin() and \c end() */
+	void draw()
+	{
+		const std::size_t nValues = m_order.size();
+		m_t++;
+
+		// enlarge the sampling set if its samples are used up
+		while ( m_t > m_tnPrime && m_n < nValues )
+		{
+			const double tnNext = m_tn * ( m_n + 1 ) / ( m_n + 1 - m_setSize );
+			m_tnPrime += static_cast< std::size_t >( std::ceil( tnNext - m_tn ) );
+			m_tn = tnNext;
+			m_n++;
+		}
+
+		if ( m_t > m_tnPrime )
+			drawPositions( m_setSize, m_n );
+		else
+		{
+			// the newest value of the sampling set is always part of the set
+			drawPositions( m_setSize - 1, m_n - 1 );
+			m_sample[ m_setSize - 1 ] = m_order[ m_n - 1 ];
+		}
+	}
+
+	/** amount of best values sampling is currently restricted to */
+	std::size_t subsetSize() const
+	{ return m_n; }
+
+	const_iterator begin() const
+	{ return m_sample.begin(); }
+
+	const_iterator end() const
+	{ return m_sample.end(); }
+
+protected:
+	/**
+	 * draws nDraw of the first nRange values by a partial Fisher-Yates shuffle,
+	 * the swaps are undone afterwards so the positions stay sorted
+	 */
+	void drawPositions( const std::size_t nDraw, const std::size_t nRange )
+	{
+		for ( std::size_t i = 0; i < nDraw; i++ )
+		{
+			m_swaps[ i ] = i + Random::threadEngine().below( nRange - i );
+			std::swap( m_positions[ i ], m_positions[ m_swaps[ i ] ] );
+			m_sample[ i ] = m_order[ m_positions[ i ] ];
+		}
+		for ( std::size_t i = nDraw; i > 0; i-- )
+			std::swap( m_positions[ i - 1 ], m_positions[ m_swaps[ i - 1 ] ] );
+	}
+
+	const std::vector< std::size_t >& m_order;
+	const std::size_t m_setSize;
+
+	std::vector< std::size_t > m_positions;
+	std::vector< std::size_t > m_swaps;
+	std::vector< std::size_t > m_sample;
+
+	/** size of the current sampling set */
+	std::size_t m_n;
+
+	/** iteration counter */
+	std::size_t m_t;
+
+	/** expected number of samples from the current sampling set (T_n in the paper) */
+	double m_tn;
+
+	/** iteration until which the current sampling set is used (T'_n in the paper) */
+	std::size_t m_tnPrime;
+};
+
+
+namespace Detail {
+
+/// @internal indices of the values ordered by decreasing score
+template< class ScoreIterator >
+void prosacOrder( const ScoreIterator sBegin, const ScoreIterator sEnd, std::vector< std::size_t >& order )
+{
+	typedef typename std::iterator_traits< ScoreIterator >::value_type score_type;
+	typedef std::pair< score_type, std::size_t > score_index;
+
+	std::vector< score_index > scores;
+	scores.reserve( std::distance( sBegin, sEnd ) );
+	std::size_t i = 0;
+	for ( ScoreIterator it = sBegin; it != sEnd; ++it, i++ )
+		scores.push_back( score_index( *it, i ) );
+
+	// stable with respect to the index for equal scores
+	std::stable_sort( scores.begin(), scores.end(), std::greater< score_index >() );
+
+	order.clear();
+	order.reserve( scores.size() );
+	for ( typename std::vector< score_index >::const_iterator it = scores.begin(); it < scores.end(); ++it )
+		order.push_back( it->second );
+}
+
+
+/// @internal sequential PROSAC loop, shared by the one- and two-parameter versions
+template< class Values, class ResultType, typename T >
+std::size_t prosac( const Values& values, const std::vector< std::size_t >& order, ResultType& result, const RansacParameter< T >& params )
+{
+	const std::size_t nValues = values.size();
+	assert( params.nMinInlier <= nValues );
+	assert( order.size() == nValues );
+	// attributes: values, iterations, inliers
+	UBITRACK_TRACE_SPAN( "prosac", nValues );
+
+	OPT_LOG_DEBUG( "PROSAC with " << nValues << " values , " << params.nMinInlier << " inlier required" );
+
+	ProsacSampler sampler( order, params.setSize, params.nMaxIterations );
+	typename Values::Buffer buffer;
+
+	InlierMask inliers( nValues );
+
+	std::size_t nBestInliers = 0;
+	InlierMask bestInliers( nValues );
+
+	LocalOptimization< Values, ResultType, T > localOptimization( values, params, params.seed );
+	Sprt< T > sprt( params.sprtDelta, static_cast< T >( params.nMinInlier ) / nValues, params.sprtModelCost );
+	Sprt< T >* pSprt = params.sprtDelta > 0 ? &sprt : 0;
+
+	const bool bAdaptive = params.successProbability > 0;
+	std::size_t nIterations = params.nMaxIterations;
+
+	std::size_t iRun;
+	for( iRun = 0; iRun < nIterations; iRun++ )
+	{
+		if ( params.deadline.check() )
+		{
+			OPT_LOG_DEBUG( "PROSAC: deadline passed after " << iRun << " iterations" );
+			break;
+		}
+		sampler.draw();
+
+		ResultType hypothesis;
+		if( !values.estimate( hypothesis, sampler, buffer ) )
+		{
+			OPT_LOG_TRACE( "fast forward, no estimation possible" );
+			continue;
+		}
+
+		std::size_t nInlier = values.countInliers( hypothesis, params.threshold, std::max( params.nMinInlier, nBestInliers + 1 ), inliers, pSprt );
+		OPT_LOG_TRACE( nInlier << " inlier, sampled from the " << sampler.subsetSize() << " best values" );
+
+		if ( nInlier >= params.nMinInlier && nInlier > nBestInliers )
+		{
+			if ( params.nLocalIterations )
+				nInlier = localOptimization.run( hypothesis, inliers, nInlier, buffer );
+			nBestInliers = nInlier;
+			bestInliers.swap( inliers );
+			if ( pSprt )
+				pSprt->accepted( static_cast< T >( nBestInliers ) / nValues );
+
+			if ( bAdaptive )
+				nIterations = std::min( nIterations, ransacIterations( static_cast< T >( nBestInliers ) / nValues
+					, params.setSize, params.successProbability, params.nMaxIterations, pSprt ? pSprt->acceptance() : T( 1 ) ) );
+		}
+
+		if ( !bAdaptive && nBestInliers >= params.nMinInlier )
+			break;
+	}
+
+	if ( !nBestInliers )
+	{
+		OPT_LOG_DEBUG( "PROSAC: Not enough inlier found" );
+		TRACEPOINT_OPTIMIZATION_RANSAC( iRun, 0, nValues );
+		UBITRACK_TRACE_SPAN_SET( 1, iRun );
+		return 0;
+	}
+
+	values.estimateFinal( result, bestInliers, buffer );
+	OPT_LOG_DEBUG( "Estimated " << nBestInliers << " inlier after " << iRun + 1 << " iterations."  );
+	TRACEPOINT_OPTIMIZATION_RANSAC( iRun + 1, nBestInliers, nValues );
+	UBITRACK_TRACE_SPAN_SET( 1, iRun + 1 );
+	UBITRACK_TRACE_SPAN_SET( 2, nBestInliers );
+	return nBestInliers;
+}
+
+} // namespace Detail
+
+
+/**
+ * PROSAC algorithm (for one-parameter problems)
+ *
+ * Same as \c ransac, but values with a higher score are sampled first.
+ * The multithreaded mode of \c RansacParameter is not supported.
+ *
+ * @tparam InputIterator describes the type of container iterator that points to the values
+ * @tparam ScoreIterator describes the type of container iterator that points to the scores
+ * @tparam ResultType the result type of the solution formulation
+ * @tparam T describes the numeric type used for error calculation (usually \c float or \c double )
+ * @tparam RansacFunctor the type of the struct/class that should include \c Estimator and \c Evaluator functor object to estimate the solution and validate it
+ * @param iBegin an \c iterator point to the first element of a container including the values
+ * @param iEnd an \c iterator point to the final element of a container including the values
+ * @param sBegin an \c iterator point to the first element of a container including the scores of the values (higher is better)
+ * @param sEnd an \c iterator point to the final element of a container including the scores of the values
+ * @param result returns the best estimated result for the given problem and parameter set
+ * @param model an instance of the struct/class that includes the Estimator and Evaluator FunctorObjects that describe the solution of a problem and it's validation
+ * @param params an instance of the object containing the algorithms parametrization
+ * @return 0 (failure) or number of inlier on success
+*/
+template< class InputIterator, class ScoreIterator, class ResultType, typename T, class RansacFunctor >
+std::size_t prosac( const InputIterator iBegin, const InputIterator iEnd
+	, const ScoreIterator sBegin, const ScoreIterator sEnd
+	, ResultType& result
+	, const RansacFunctor& model
+	, const RansacParameter< T >& params )
+{
+	assert( std::distance( iBegin, iEnd ) == std::distance( sBegin, sEnd ) );
+
+	std::vector< std::size_t > order;
+	Detail::prosacOrder( sBegin, sEnd, order );
+
+	const Detail::RansacValues1< InputIterator, RansacFunctor > values( iBegin, iEnd );
+	return Detail::prosac( values, order, result, params );
+}
+
+
+/**
+ * PROSAC algorithm (for two-parameter problems)
+ *
+ * Same as \c ransac, but values with a higher score are sampled first.
+ * The multithreaded mode of \c RansacParameter is not supported.
+ *
+ * @tparam InputIterator1 describes the type of container iterator that points to the first type of values
+ * @tparam InputIterator2 describes the type of container iterator that points to the second type of values
+ * @tparam ScoreIterator describes the type of container iterator that points to the scores
+ * @tparam ResultType the result type of the solution formulation
+ * @tparam T describes the numeric type used for error calculation (usually \c float or \c double )
+ * @tparam RansacFunctor the type of the struct/class that should include \c Estimator and \c Evaluator functor object to estimate the solution and validate it
+ * @param iBegin1 an \c iterator that points to the first element of a container including the first problem values
+ * @param iEnd1 an \c iterator that points to the final element of a container including the first problem values
+ * @param iBegin2 an \c iterator that points to the first element of a container including the second problem values
+ * @param iEnd2 an \c iterator that points to the final element of a container including the second problem values
+ * @param sBegin an \c iterator point to the first element of a container including the scores of the values (higher is better)
+ * @param sEnd an \c iterator point to the final element of a container including the scores of the values
+ * @param result returns the best estimated result for the given problem and parameter set
+ * @param model an instance of the struct/class that includes the Estimator and Evaluator FunctorObjects that describe the solution of a problem and it's validation
+ * @param params an instance of the object containing the algorithms parametrization
+ * @return 0 (failure) or number of inlier on success
+*/
+template< typename InputIterator1, typename InputIterator2, class ScoreIterator, class ResultType, typename T, class RansacFunctor >
+std::size_t prosac( const InputIterator1 iBegin1, const InputIterator1 iEnd1
+	, const InputIterator2 iBegin2, const InputIterator2 iEnd2
+	, const ScoreIterator sBegin, const ScoreIterator sEnd
+	, ResultType& result
+	, const RansacFunctor& model
+	, const RansacParameter< T >& params )
+{
+	assert( std::distance( iBegin1, iEnd1 ) == std::distance( iBegin2, iEnd2 ) );
+	assert( std::distance( iBegin1, iEnd1 ) == std::distance( sBegin, sEnd ) );
+
+	std::vector< std::size_t > order;
+	Detail::prosacOrder( sBegin, sEnd, order );
+
+	const Detail::RansacValues2< InputIterator1, InputIterator2, RansacFunctor > values( iBegin1, iEnd1, iBegin2 );
+	return Detail::prosac( values, order, result, params );
+}
+
+}}} // namespace Ubitrack::Math::Optimization
+
+#endif // __UBITRACK_MATH_OPTIMIZATION_PROSAC_INCLUDED__
@@ -35,211 +35,1376 @@
 #define __UBITRACK_MATH_OPTIMIZATION_RANSAC_INCLUDED__
 
 #include <utCore.h>
+#include <utUtil/TracingProvider.h>
+#include <utUtil/TraceSpan.h>
+#include <utUtil/Status.h>
+#include <utUtil/Executor.h>
+#include <utUtil/Progress.h>
+#include <utMath/Random/Engine.h>
 #include "Optimization.h"
 
 #include <vector>
+#include <deque>
+#include <cmath>
 #include <stdlib.h>
 #include <iterator> // std::iterator_traits
 #include <algorithm> // std::generate_n
+#include <limits>
 #include <stdexcept>
 
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
 
 namespace Ubitrack { namespace Math { namespace Optimization {
 
 /**
- * Parameter structure for the RANSAC algorithm framework
+ * Parameter structure for the RANSAC algorithm framework
+ *
+ * This struct holds all parameters to set the appropriate parameters
+ * of the ransac algorithm framework.
+ */
+template< typename T >
+struct RansacParameter
+{
+public:
+	/** type of all the unsigned integer values within this class */
+	typedef std::size_t size_type;
+	
+	/** the floating point type used for numerical error expressions */
+	typedef T value_type;
+
+	const value_type threshold;
+	const size_type setSize;
+	const size_type nMinInlier;
+	const size_type nMaxIterations;
+	
+	/**
+	 * probability to draw at least one outlier-free set, enables adaptive termination if larger than 0.
+	 * In this case the algorithm does not stop at the first set of \c nMinInlier inlier but keeps on
+	 * searching until the number of iterations, derived from the best inlier ratio so far, is reached.
+	 */
+	const value_type successProbability;
+	
+	/**
+	 * number of threads generating and evaluating hypotheses, 1 runs sequentially and 0 uses all cores.
+	 * Every thread draws its random sets from an own random number stream, the result is
+	 * deterministic for a given \c seed and number of threads.
+	 */
+	const size_type nThreads;
+	
+	/** seed of the random number streams in the multithreaded mode */
+	const unsigned int seed;
+
+	/**
+	 * executor that runs the threads of the multithreaded mode as tasks instead of own
+	 * threads, 0 starts threads. With an executor, 0 threads uses its concurrency.
+	 */
+	Ubitrack::Util::Executor* executor;
+
+	/**
+	 * number of iterations of the local optimization (LO-RANSAC), 0 disables it.
+	 * Every hypothesis with more inlier than all previous ones is refined by least squares on
+	 * its inlier and by an inner RANSAC on sets of up to <tt>4 * setSize</tt> values drawn from
+	 * its inlier. The estimator has to accept more than \c setSize values, as it does for the
+	 * final estimation.
+	 */
+	size_type nLocalIterations;
+
+	/**
+	 * initial probability that a value is consistent with a wrong hypothesis, enables the
+	 * sequential probability ratio test if larger than 0. The test stops scoring a hypothesis
+	 * as soon as it is unlikely to beat the best one, the probability is adapted while running.
+	 * It assumes that inlier and outlier are mixed in the order of the values, values sorted
+	 * with the outlier first get good hypotheses rejected.
+	 */
+	value_type sprtDelta;
+
+	/** time to estimate a hypothesis relative to the time to score one value, used by the test */
+	value_type sprtModelCost;
+
+	/**
+	 * number of hypotheses of preemptive RANSAC, 0 disables it. Preemptive RANSAC generates all
+	 * hypotheses up front and scores them breadth-first on blocks of \c preemptiveBlockSize values
+	 * in random order, keeping the better half after every block until one is left. The runtime
+	 * only depends on the number of hypotheses and values, \c nMaxIterations, \c successProbability
+	 * and \c sprtDelta are not used. If \c nThreads is not 1, the hypotheses are scored in
+	 * parallel on \c executor or the process executor. See D. Nister, "Preemptive RANSAC for
+	 * live structure and motion estimation", ICCV 2003.
+	 */
+	size_type nPreemptiveHypotheses;
+
+	/** number of values each remaining hypothesis is scored on before the set is halved */
+	size_type preemptiveBlockSize;
+
+	/**
+	 * no new hypotheses are drawn after the deadline, the result is estimated from the best
+	 * inlier set so far. \c deadline.expired() tells afterwards whether it stopped the search.
+	 */
+	Deadline deadline;
+	
+	/**
+	 * Constructor accepting the parameters directly
+	 *
+	 *  @param fThreshold threhold to decide wether an value is accepeted to support the hypothesis or not
+	 *  @param n amount of values needed to estimate a solution by the given problem
+	 *  @param minInlier minimum amount of inlier that are required to accept a solution
+	 *  @param maxRuns maximum number of iterations
+	 *  @param percentSucess probability for adaptive termination, 0 stops at the first accepted solution
+	 *  @param threads number of threads, 1 runs sequentially and 0 uses all cores
+	 *  @param rngSeed seed of the random number streams if more than one thread is used
+	 */
+	RansacParameter( const T fThreshold, const std::size_t n, const std::size_t minInlier, const std::size_t maxRuns, const T percentSucess = 0
+		, const std::size_t threads = 1, const unsigned int rngSeed = 0 )
+		: threshold ( fThreshold )
+		, setSize ( n )
+		, nMinInlier ( minInlier )
+		, nMaxIterations ( maxRuns )
+		, successProbability ( percentSucess )
+		, nThreads ( threads )
+		, seed ( rngSeed )
+		, executor ( 0 )
+		, nLocalIterations ( 0 )
+		, sprtDelta ( 0 )
+		, sprtModelCost ( 200 )
+		, nPreemptiveHypotheses ( 0 )
+		, preemptiveBlockSize ( 100 )
+		{};
+	
+	/**
+	 * Constructor accepting intuitive parameters
+	 *
+	 *  @param fThreshold threhold to decide wether an value is accepeted tu support the hypothesis or not
+	 *  @param nMinSet amount of values needed to estimate a solution by the given problem
+	 *  @param n amount of values provided to estimate a solution for the given problem
+	 *  @param percentOutlier signs the percentage of expected outlier ( ranges from 0 to 1 )
+	 *  @param percentSucess probability that signs how intensive should be found a solution (affects number of iterations)
+	 *  @param threads number of threads, 1 runs sequentially and 0 uses all cores
+	 *  @param rngSeed seed of the random number streams if more than one thread is used
+	 */
+	RansacParameter( const T fThreshold, const std::size_t nMinSet, const std::size_t n, const T percentOutlier, const T percentSucess = 0.99
+		, const std::size_t threads = 1, const unsigned int rngSeed = 0 )
+		: threshold ( fThreshold )
+		, setSize ( nMinSet )
+		, nMinInlier ( static_cast< size_type >( (1.-percentOutlier) * n ) )
+		, nMaxIterations ( static_cast< size_type >( 1+std::log( 1-percentSucess) / ( std::log( 1-std::pow( 1-percentOutlier, static_cast< int >( nMinSet ) ) ) ) ) )
+		, successProbability ( percentSucess )
+		, nThreads ( threads )
+		, seed ( rngSeed )
+		, executor ( 0 )
+		, nLocalIterations ( 0 )
+		, sprtDelta ( 0 )
+		, sprtModelCost ( 200 )
+		, nPreemptiveHypotheses ( 0 )
+		, preemptiveBlockSize ( 100 )
+		{};
+};
+
+
+/// @internal index generator helper struct
+struct IndexGenerator
+{
+protected:
+	std::size_t index;
+	
+public:
+	IndexGenerator()
+		: index( 0 )
+	{}
+	
+	std::size_t operator()()
+	{
+		return index++;
+	}
+};
+
+
+/**
+ * @internal draws random sets of distinct indices
+ *
+ * Keeps a permutation of all indices that is updated by a partial
+ * Fisher-Yates shuffle, so only \c setSize random numbers are needed per
+ * drawn set and no memory is allocated after construction.
+ */
+class RansacSampler
+{
+public:
+	typedef std::vector< std::size_t >::const_iterator const_iterator;
+
+	RansacSampler( const std::size_t nValues, const std::size_t setSize )
+		: m_setSize( setSize )
+	{
+		assert( setSize <= nValues );
+		m_indices.reserve( nValues );
+		std::generate_n( std::back_inserter( m_indices ), nValues, IndexGenerator() );
+	}
+
+	/** draws a new set, accessible via \c begin() and \c end() */
+	void draw()
+	{
+		const std::size_t nValues = m_indices.size();
+		for ( std::size_t i = 0; i < m_setSize; i++ )
+			std::swap( m_indices[ i ], m_indices[ i + Random::threadEngine().below( nValues - i ) ] );
+	}
+
+	/** draws a new set using the given random number generator */
+	template< class Generator >
+	void draw( Generator& generator )
+	{
+		const std::size_t nValues = m_indices.size();
+		for ( std::size_t i = 0; i < m_setSize; i++ )
+		{
+			boost::uniform_int< std::size_t > distribution( i, nValues - 1 );
+			std::swap( m_indices[ i ], m_indices[ distribution( generator ) ] );
+		}
+	}
+
+	const_iterator begin() const
+	{ return m_indices.begin(); }
+
+	const_iterator end() const
+	{ return m_indices.begin() + m_setSize; }
+
+protected:
+	const std::size_t m_setSize;
+	std::vector< std::size_t > m_indices;
+};
+
+
+/**
+ * @internal computes the number of iterations necessary to draw at least one
+ * outlier-free set with the given probability, limited to \c nMaxIterations.
+ * \c pAccept is the probability that an outlier-free set passes the scoring.
+ */
+template< typename T >
+std::size_t ransacIterations( const T inlierRatio, const std::size_t setSize, const T successProbability, const std::size_t nMaxIterations
+	, const T pAccept = 1 )
+{
+	const T pGoodSet = pAccept * std::pow( inlierRatio, static_cast< int >( setSize ) );
+	if ( pGoodSet >= 1 )
+		return 1;
+	if ( pGoodSet <= 0 || successProbability >= 1 )
+		return nMaxIterations;
+
+	const T n = std::ceil( std::log( 1 - successProbability ) / std::log( 1 - pGoodSet ) );
+	if ( !( n < static_cast< T >( nMaxIterations ) ) )
+		return nMaxIterations;
+	return std::max< std::size_t >( 1, static_cast< std::size_t >( n ) );
+}
+
+
+namespace Detail {
+
+/**
+ * @internal set of inlier indices stored as packed bits
+ *
+ * Counting uses popcount on whole words, and the best set of a RANSAC run is kept by
+ * swapping two masks instead of copying index lists.
+ */
+class InlierMask
+{
+public:
+	typedef boost::uint64_t word_type;
+
+	explicit InlierMask( const std::size_t n = 0 )
+	{ resize( n ); }
+
+	/** resizes the mask to \c n indices, all cleared */
+	void resize( const std::size_t n )
+	{
+		m_size = n;
+		m_words.assign( ( n + 63 ) / 64, 0 );
+	}
+
+	/** removes all indices */
+	void clear()
+	{ std::fill( m_words.begin(), m_words.end(), word_type( 0 ) ); }
+
+	std::size_t size() const
+	{ return m_size; }
+
+	void set( const std::size_t i )
+	{ m_words[ i >> 6 ] |= word_type( 1 ) << ( i & 63 ); }
+
+	bool test( const std::size_t i ) const
+	{ return ( m_words[ i >> 6 ] >> ( i & 63 ) ) & 1; }
+
+	/** number of indices in the set */
+	std::size_t count() const
+	{
+		std::size_t n = 0;
+		for ( std::size_t w = 0; w < m_words.size(); w++ )
+			n += popcount( m_words[ w ] );
+		return n;
+	}
+
+	/** the first index in the set that is not smaller than \c i, \c size() if there is none */
+	std::size_t next( const std::size_t i ) const
+	{
+		std::size_t w = i >> 6;
+		if ( w >= m_words.size() )
+			return m_size;
+		word_type bits = m_words[ w ] & ( ~word_type( 0 ) << ( i & 63 ) );
+		while ( !bits )
+		{
+			if ( ++w == m_words.size() )
+				return m_size;
+			bits = m_words[ w ];
+		}
+		return ( w << 6 ) + lowestBit( bits );
+	}
+
+	void swap( InlierMask& other )
+	{
+		std::swap( m_size, other.m_size );
+		m_words.swap( other.m_words );
+	}
+
+	void toVector( std::vector< bool >& inliers ) const
+	{
+		inliers.assign( m_size, false );
+		for ( std::size_t i = next( 0 ); i < m_size; i = next( i + 1 ) )
+			inliers[ i ] = true;
+	}
+
+protected:
+	static std::size_t popcount( word_type x )
+	{
+	#if defined( __GNUC__ )
+		return __builtin_popcountll( x );
+	#elif defined( _MSC_VER ) && defined( _M_X64 )
+		return static_cast< std::size_t >( __popcnt64( x ) );
+	#else
+		x = x - ( ( x >> 1 ) & 0x5555555555555555ULL );
+		x = ( x & 0x3333333333333333ULL ) + ( ( x >> 2 ) & 0x3333333333333333ULL );
+		x = ( x + ( x >> 4 ) ) & 0x0f0f0f0f0f0f0f0fULL;
+		return static_cast< std::size_t >( ( x * 0x0101010101010101ULL ) >> 56 );
+	#endif
+	}
+
+	/** index of the lowest set bit of \c x, which must not be 0 */
+	static std::size_t lowestBit( const word_type x )
+	{
+	#if defined( __GNUC__ )
+		return __builtin_ctzll( x );
+	#elif defined( _MSC_VER ) && defined( _M_X64 )
+		unsigned long index;
+		_BitScanForward64( &index, x );
+		return index;
+	#else
+		return popcount( ( x & ( ~x + 1 ) ) - 1 );
+	#endif
+	}
+
+	std::size_t m_size;
+	std::vector< word_type > m_words;
+};
+
+
+/**
+ * @internal list of the values of a random set
+ *
+ * Sets of up to \c Capacity values are stored inline, larger ones on the heap.
+ * The values are passed to the estimators as pointer range.
+ */
+template< typename T, std::size_t Capacity = 8 >
+class SampleBuffer
+	: private boost::noncopyable
+{
+public:
+	typedef T value_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	SampleBuffer()
+		: m_data( m_inline )
+		, m_size( 0 )
+		, m_capacity( Capacity )
+	{}
+
+	/** makes room for \c n values, which moves the values to the heap if there are more than \c Capacity */
+	void reserve( const std::size_t n )
+	{
+		if ( n <= m_capacity )
+			return;
+		std::vector< T > heap( n );
+		std::copy( begin(), end(), heap.begin() );
+		m_heap.swap( heap );
+		m_data = &m_heap[ 0 ];
+		m_capacity = n;
+	}
+
+	void clear()
+	{ m_size = 0; }
+
+	void push_back( const T& value )
+	{
+		assert( m_size < m_capacity );
+		m_data[ m_size++ ] = value;
+	}
+
+	std::size_t size() const
+	{ return m_size; }
+
+	iterator begin()
+	{ return m_data; }
+
+	iterator end()
+	{ return m_data + m_size; }
+
+	const_iterator begin() const
+	{ return m_data; }
+
+	const_iterator end() const
+	{ return m_data + m_size; }
+
+protected:
+	T m_inline[ Capacity ];
+	std::vector< T > m_heap;
+	T* m_data;
+	std::size_t m_size;
+	std::size_t m_capacity;
+};
+
+
+/**
+ * @internal sequential probability ratio test of hypotheses, see
+ * J. Matas and O. Chum, "Randomized RANSAC with Sequential Probability Ratio Test", ICCV 2005.
+ *
+ * Accumulates the likelihood ratio of a hypothesis being wrong (a value is consistent with
+ * probability delta) to being good (probability epsilon) while the values are scored, and
+ * rejects it as soon as the ratio exceeds the decision threshold A. Epsilon follows the inlier
+ * ratio of the best hypothesis, delta the ratio of consistent values of rejected hypotheses.
+ */
+template< typename T >
+class Sprt
+{
+public:
+	/**
+	 * @param delta initial probability that a value is consistent with a wrong hypothesis
+	 * @param epsilon initial probability that a value is consistent with a good hypothesis
+	 * @param modelCost time to estimate a hypothesis relative to the time to score one value
+	 */
+	Sprt( const T delta, const T epsilon, const T modelCost )
+		: m_delta( delta )
+		, m_epsilon( epsilon )
+		, m_modelCost( modelCost )
+		, m_nRejectedValues( 0 )
+		, m_nRejectedConsistent( 0 )
+		, m_logLambda( 0 )
+	{ design(); }
+
+	/** starts the test of a new hypothesis */
+	void begin()
+	{ m_logLambda = 0; }
+
+	/** adds the next scored value, returns \c false if the hypothesis is rejected */
+	bool add( const bool consistent )
+	{
+		m_logLambda += consistent ? m_logConsistent : m_logInconsistent;
+		return m_logLambda <= m_logA;
+	}
+
+	/** a hypothesis was rejected after \c nValues values, \c nConsistent of them consistent */
+	void rejected( const std::size_t nValues, const std::size_t nConsistent )
+	{
+		m_nRejectedValues += nValues;
+		m_nRejectedConsistent += nConsistent;
+		const T delta = std::max( static_cast< T >( m_nRejectedConsistent ) / m_nRejectedValues, T( 1e-4 ) );
+
+		// a new test is only designed on a significant change
+		if ( std::fabs( delta - m_delta ) > T( 0.05 ) * m_delta )
+		{
+			m_delta = delta;
+			design();
+		}
+	}
+
+	/** a hypothesis with a new best inlier ratio was found */
+	void accepted( const T inlierRatio )
+	{
+		m_epsilon = std::min( inlierRatio, T( 0.999 ) );
+		design();
+	}
+
+	/** probability that a good hypothesis passes the test, 1 - 1/A */
+	T acceptance() const
+	{ return m_logA < std::numeric_limits< T >::max() ? 1 - std::exp( -m_logA ) : T( 1 ); }
+
+protected:
+	/** computes the threshold A, the test never rejects if epsilon is not larger than delta */
+	void design()
+	{
+		if ( !( m_epsilon > m_delta ) || !( m_delta > 0 ) )
+		{
+			m_logConsistent = m_logInconsistent = 0;
+			m_logA = std::numeric_limits< T >::max();
+			return;
+		}
+
+		m_logConsistent = std::log( m_delta / m_epsilon );
+		m_logInconsistent = std::log( ( 1 - m_delta ) / ( 1 - m_epsilon ) );
+
+		// A = A0 + log( A ) with A0 = modelCost * C + 1, converges in a few steps
+		const T c = ( 1 - m_delta ) * m_logInconsistent + m_delta * m_logConsistent;
+		const T a0 = m_modelCost * c + 1;
+		T a = a0;
+		for ( std::size_t i = 0; i < 10; i++ )
+			a = a0 + std::log( a );
+		m_logA = std::log( a );
+	}
+
+	T m_delta;
+	T m_epsilon;
+	const T m_modelCost;
+
+	std::size_t m_nRejectedValues;
+	std::size_t m_nRejectedConsistent;
+
+	/** increments of the log-likelihood ratio for consistent and inconsistent values */
+	T m_logConsistent;
+	T m_logInconsistent;
+	T m_logA;
+	T m_logLambda;
+};
+
+
+/// @internal set of indices given by a pointer range, for Values::estimate
+struct IndexRange
+{
+	typedef const std::size_t* const_iterator;
+
+	IndexRange( const std::size_t* b, const std::size_t n )
+		: m_begin( b )
+		, m_end( b + n )
+	{}
+
+	const_iterator begin() const
+	{ return m_begin; }
+
+	const_iterator end() const
+	{ return m_end; }
+
+	const std::size_t* m_begin;
+	const std::size_t* m_end;
+};
+
+
+/// @internal access to the values of one-parameter ransac problems
+template< class InputIterator, class RansacFunctor >
+class RansacValues1
+{
+public:
+	typedef typename std::iterator_traits< InputIterator >::value_type value_type;
+
+	/// @internal per-thread storage of the random set
+	struct Buffer
+	{
+		SampleBuffer< value_type > sample;
+		std::vector< value_type > list;
+	};
+
+	RansacValues1( const InputIterator iBegin, const InputIterator iEnd )
+		: m_iBegin( iBegin )
+		, m_nValues( std::distance( iBegin, iEnd ) )
+	{}
+
+	std::size_t size() const
+	{ return m_nValues; }
+
+	template< class ResultType, class Sampler >
+	bool estimate( ResultType& hypothesis, const Sampler& sampler, Buffer& buffer ) const
+	{
+		buffer.sample.clear();
+		buffer.sample.reserve( std::distance( sampler.begin(), sampler.end() ) );
+		for ( typename Sampler::const_iterator itSelected = sampler.begin(); itSelected < sampler.end(); ++itSelected )
+		{
+			InputIterator it ( m_iBegin );
+			std::advance( it, (*itSelected) );
+			buffer.sample.push_back( *it );
+		}
+		return typename RansacFunctor::Estimator()( hypothesis, buffer.sample.begin(), buffer.sample.end() );
+	}
+
+	/**
+	 * marks the inlier in \c inliers, stops as soon as less than \c nRequired inlier are possible
+	 * or the hypothesis is rejected by \c sprt, which returns 0
+	 */
+	template< class ResultType, typename T >
+	std::size_t countInliers( const ResultType& hypothesis, const T threshold, const std::size_t nRequired, InlierMask& inliers
+		, Sprt< T >* sprt = 0 ) const
+	{
+		inliers.clear();
+		if ( sprt )
+			sprt->begin();
+		std::size_t nInlier = 0;
+		InputIterator it ( m_iBegin );
+		for ( std::size_t i = 0; i < m_nValues && nInlier + ( m_nValues - i ) >= nRequired; i++, ++it )
+		{
+			const bool consistent = typename RansacFunctor::Evaluator()( hypothesis, *it ) < threshold;
+			if ( consistent )
+			{
+				inliers.set( i );
+				nInlier++;
+			}
+			if ( sprt && !sprt->add( consistent ) )
+			{
+				sprt->rejected( i + 1, nInlier );
+				return 0;
+			}
+		}
+		return nInlier;
+	}
+
+	/** number of inlier among the values with the given indices */
+	template< class ResultType, typename T >
+	std::size_t scoreIndices( const ResultType& hypothesis, const T threshold, const IndexRange& indices ) const
+	{
+		std::size_t nInlier = 0;
+		for ( IndexRange::const_iterator itIndex = indices.begin(); itIndex != indices.end(); ++itIndex )
+		{
+			InputIterator it ( m_iBegin );
+			std::advance( it, *itIndex );
+			if ( typename RansacFunctor::Evaluator()( hypothesis, *it ) < threshold )
+				nInlier++;
+		}
+		return nInlier;
+	}
+
+	template< class ResultType >
+	bool estimateFinal( ResultType& result, const InlierMask& inliers, Buffer& buffer ) const
+	{
+		buffer.list.clear();
+		buffer.list.reserve( inliers.count() );
+		InputIterator it ( m_iBegin );
+		std::size_t index = 0;
+		for ( std::size_t i = inliers.next( 0 ); i < m_nValues; i = inliers.next( i + 1 ) )
+		{
+			std::advance( it, i - index );
+			index = i;
+			buffer.list.push_back( *it );
+		}
+		return typename RansacFunctor::Estimator()( result, buffer.list.begin(), buffer.list.end() );
+	}
+
+protected:
+	const InputIterator m_iBegin;
+	const std::size_t m_nValues;
+};
+
+
+/// @internal access to the values of two-parameter ransac problems
+template< class InputIterator1, class InputIterator2, class RansacFunctor >
+class RansacValues2
+{
+public:
+	typedef typename std::iterator_traits< InputIterator1 >::value_type value_type1;
+	typedef typename std::iterator_traits< InputIterator2 >::value_type value_type2;
+
+	/// @internal per-thread storage of the random sets
+	struct Buffer
+	{
+		SampleBuffer< value_type1 > sample1;
+		SampleBuffer< value_type2 > sample2;
+		std::vector< value_type1 > list1;
+		std::vector< value_type2 > list2;
+	};
+
+	RansacValues2( const InputIterator1 iBegin1, const InputIterator1 iEnd1, const InputIterator2 iBegin2 )
+		: m_iBegin1( iBegin1 )
+		, m_iBegin2( iBegin2 )
+		, m_nValues( std::distance( iBegin1, iEnd1 ) )
+	{}
+
+	std::size_t size() const
+	{ return m_nValues; }
+
+	template< class ResultType, class Sampler >
+	bool estimate( ResultType& hypothesis, const Sampler& sampler, Buffer& buffer ) const
+	{
+		buffer.sample1.clear();
+		buffer.sample2.clear();
+		buffer.sample1.reserve( std::distance( sampler.begin(), sampler.end() ) );
+		buffer.sample2.reserve( std::distance( sampler.begin(), sampler.end() ) );
+		for ( typename Sampler::const_iterator itSelected = sampler.begin(); itSelected < sampler.end(); ++itSelected )
+		{
+			InputIterator1 it1 ( m_iBegin1 );
+			InputIterator2 it2 ( m_iBegin2 );
+			std::advance( it1, (*itSelected) );
+			std::advance( it2, (*itSelected) );
+			buffer.sample1.push_back( *it1 );
+			buffer.sample2.push_back( *it2 );
+		}
+		return typename RansacFunctor::Estimator()( hypothesis, buffer.sample1.begin(), buffer.sample1.end(), buffer.sample2.begin(), buffer.sample2.end() );
+	}
+
+	/**
+	 * marks the inlier in \c inliers, stops as soon as less than \c nRequired inlier are possible
+	 * or the hypothesis is rejected by \c sprt, which returns 0
+	 */
+	template< class ResultType, typename T >
+	std::size_t countInliers( const ResultType& hypothesis, const T threshold, const std::size_t nRequired, InlierMask& inliers
+		, Sprt< T >* sprt = 0 ) const
+	{
+		inliers.clear();
+		if ( sprt )
+			sprt->begin();
+		std::size_t nInlier = 0;
+		InputIterator1 it1 ( m_iBegin1 );
+		InputIterator2 it2 ( m_iBegin2 );
+		for ( std::size_t i = 0; i < m_nValues && nInlier + ( m_nValues - i ) >= nRequired; i++, ++it1, ++it2 )
+		{
+			const bool consistent = typename RansacFunctor::Evaluator()( hypothesis, *it1, *it2 ) < threshold;
+			if ( consistent )
+			{
+				inliers.set( i );
+				nInlier++;
+			}
+			if ( sprt && !sprt->add( consistent ) )
+			{
+				sprt->rejected( i + 1, nInlier );
+				return 0;
+			}
+		}
+		return nInlier;
+	}
+
+	/** number of inlier among the values with the given indices */
+	template< class ResultType, typename T >
+	std::size_t scoreIndices( const ResultType& hypothesis, const T threshold, const IndexRange& indices ) const
+	{
+		std::size_t nInlier = 0;
+		for ( IndexRange::const_iterator itIndex = indices.begin(); itIndex != indices.end(); ++itIndex )
+		{
+			InputIterator1 it1 ( m_iBegin1 );
+			InputIterator2 it2 ( m_iBegin2 );
+			std::advance( it1, *itIndex );
+			std::advance( it2, *itIndex );
+			if ( typename RansacFunctor::Evaluator()( hypothesis, *it1, *it2 ) < threshold )
+				nInlier++;
+		}
+		return nInlier;
+	}
+
+	template< class ResultType >
+	bool estimateFinal( ResultType& result, const InlierMask& inliers, Buffer& buffer ) const
+	{
+		const std::size_t nInlier = inliers.count();
+		buffer.list1.clear();
+		buffer.list2.clear();
+		buffer.list1.reserve( nInlier );
+		buffer.list2.reserve( nInlier );
+		InputIterator1 it1 ( m_iBegin1 );
+		InputIterator2 it2 ( m_iBegin2 );
+		std::size_t index = 0;
+		for ( std::size_t i = inliers.next( 0 ); i < m_nValues; i = inliers.next( i + 1 ) )
+		{
+			std::advance( it1, i - index );
+			std::advance( it2, i - index );
+			index = i;
+			buffer.list1.push_back( *it1 );
+			buffer.list2.push_back( *it2 );
+		}
+		return typename RansacFunctor::Estimator()( result, buffer.list1.begin(), buffer.list1.end(), buffer.list2.begin(), buffer.list2.end() );
+	}
+
+protected:
+	const InputIterator1 m_iBegin1;
+	const InputIterator2 m_iBegin2;
+	const std::size_t m_nValues;
+};
+
+
+/**
+ * @internal local optimization of LO-RANSAC, see
+ * O. Chum, J. Matas and J. Kittler, "Locally Optimized RANSAC", DAGM 2003.
+ *
+ * A new best hypothesis is refined by least squares on its inlier, followed by an inner
+ * RANSAC whose sets are drawn from the inlier only and are larger than the minimal set.
+ * Every estimate of the inner RANSAC is refined by least squares on its own inlier as well.
+ */
+template< class Values, class ResultType, typename T >
+class LocalOptimization
+{
+public:
+	LocalOptimization( const Values& values, const RansacParameter< T >& params, const boost::uint64_t seed )
+		: m_values( values )
+		, m_params( params )
+		, m_generator( seed )
+	{
+		if ( params.nLocalIterations )
+		{
+			m_candidateInliers.resize( values.size() );
+			m_refinedInliers.resize( values.size() );
+			m_indices.reserve( values.size() );
+		}
+	}
+
+	/**
+	 * optimizes a hypothesis with \c nInlier inlier, replaces the hypothesis and its inlier if a
+	 * better one is found and returns the new number of inlier
+	 */
+	std::size_t run( ResultType& hypothesis, InlierMask& inliers, std::size_t nInlier, typename Values::Buffer& buffer )
+	{
+		nInlier = refine( hypothesis, inliers, nInlier, buffer );
+
+		bool bChanged = true;
+		for ( std::size_t iRun = 0; iRun < m_params.nLocalIterations; iRun++ )
+		{
+			// larger than the minimal set, but at most half of the inlier
+			const std::size_t setSize = std::min( nInlier / 2, 4 * m_params.setSize );
+			if ( setSize <= m_params.setSize )
+				break;
+
+			if ( bChanged )
+			{
+				m_indices.clear();
+				for ( std::size_t i = inliers.next( 0 ); i < inliers.size(); i = inliers.next( i + 1 ) )
+					m_indices.push_back( i );
+				bChanged = false;
+			}
+			for ( std::size_t i = 0; i < setSize; i++ )
+			{
+				std::swap( m_indices[ i ], m_indices[ i + m_generator.below( m_indices.size() - i ) ] );
+			}
+
+			ResultType candidate;
+			if ( !m_values.estimate( candidate, IndexRange( &m_indices[ 0 ], setSize ), buffer ) )
+				continue;
+			std::size_t nCandidate = m_values.countInliers( candidate, m_params.threshold, 0, m_candidateInliers );
+			nCandidate = refine( candidate, m_candidateInliers, nCandidate, buffer );
+			if ( nCandidate > nInlier )
+			{
+				OPT_LOG_TRACE( "local optimization: " << nCandidate << " inlier instead of " << nInlier );
+				hypothesis = candidate;
+				inliers.swap( m_candidateInliers );
+				nInlier = nCandidate;
+				bChanged = true;
+			}
+		}
+		return nInlier;
+	}
+
+protected:
+	/** least squares estimate from the inlier, replaces the hypothesis if it has more inlier */
+	std::size_t refine( ResultType& hypothesis, InlierMask& inliers, const std::size_t nInlier, typename Values::Buffer& buffer )
+	{
+		ResultType refined;
+		if ( nInlier <= m_params.setSize || !m_values.estimateFinal( refined, inliers, buffer ) )
+			return nInlier;
+		const std::size_t nRefined = m_values.countInliers( refined, m_params.threshold, nInlier + 1, m_refinedInliers );
+		if ( nRefined <= nInlier )
+			return nInlier;
+		hypothesis = refined;
+		inliers.swap( m_refinedInliers );
+		return nRefined;
+	}
+
+	const Values& m_values;
+	const RansacParameter< T >& m_params;
+	Random::Engine m_generator;
+
+	/** inlier of the best hypothesis, the first ones form the drawn set */
+	std::vector< std::size_t > m_indices;
+	InlierMask m_candidateInliers;
+	InlierMask m_refinedInliers;
+};
+
+
+/**
+ * @internal multithreaded RANSAC
+ *
+ * Thread \c w computes the iterations \c w, \c w+nThreads, \c w+2*nThreads, ... with its own
+ * random number stream. The inlier counts are committed in the order of the iterations and
+ * the termination criteria are applied exactly as in the sequential algorithm, so the result
+ * does not depend on the scheduling of the threads. Iterations behind the termination point
+ * that were computed speculatively are discarded.
+ */
+template< class Values, class ResultType, typename T >
+class ParallelRansac
+{
+public:
+	ParallelRansac( const Values& values, const RansacParameter< T >& params )
+		: m_values( values )
+		, m_params( params )
+		, m_nThreads( params.nThreads ? params.nThreads : params.executor ? params.executor->concurrency()
+			: std::max< std::size_t >( 1, boost::thread::hardware_concurrency() ) )
+		, m_pending( m_nThreads )
+		, m_records( m_nThreads )
+		, m_nCommitted( 0 )
+		, m_nLimit( params.nMaxIterations )
+		, m_nBestInliers( 0 )
+		, m_iBest( 0 )
+		, m_progress( Ubitrack::Util::ProgressContext::current() )
+	{}
+
+	std::size_t run( ResultType& result )
+	{
+		OPT_LOG_DEBUG( "RANSAC with " << m_values.size() << " values , " << m_params.nMinInlier << " inlier required, " << m_nThreads << " threads" );
+		// attributes: values, iterations, inliers
+		UBITRACK_TRACE_SPAN( "ransac", m_values.size() );
+
+		if ( m_params.executor )
+		{
+			Ubitrack::Util::TaskGroup group( *m_params.executor );
+			for ( std::size_t w = 0; w < m_nThreads; w++ )
+				group.run( boost::bind( &ParallelRansac::work, this, w ) );
+			group.wait();
+		}
+		else
+		{
+			boost::thread_group threads;
+			for ( std::size_t w = 0; w < m_nThreads; w++ )
+				threads.create_thread( boost::bind( &ParallelRansac::work, this, w ) );
+			threads.join_all();
+		}
+
+		if ( m_error )
+			boost::rethrow_exception( m_error );
+
+		TRACEPOINT_OPTIMIZATION_RANSAC( m_nCommitted, m_nBestInliers, m_values.size() );
+		UBITRACK_TRACE_SPAN_SET( 1, m_nCommitted );
+		UBITRACK_TRACE_SPAN_SET( 2, m_nBestInliers );
+		if ( !m_nBestInliers )
+		{
+			OPT_LOG_DEBUG( "RANSAC: Not enough inlier found" );
+			return 0;
+		}
+
+		// the best iteration is always a record of its thread
+		const std::vector< Record >& records = m_records[ m_iBest % m_nThreads ];
+		typename std::vector< Record >::const_iterator it = records.begin();
+		while ( it->iteration != m_iBest )
+			++it;
+
+		typename Values::Buffer buffer;
+		m_values.estimateFinal( result, it->inliers, buffer );
+		OPT_LOG_DEBUG( "Estimated " << m_nBestInliers << " inlier after " << m_nCommitted << " iterations."  );
+		return m_nBestInliers;
+	}
+
+protected:
+	/// @internal hypothesis of a thread with more inlier than all previous ones of the same thread
+	struct Record
+	{
+		std::size_t iteration;
+		ResultType hypothesis;
+		InlierMask inliers;
+	};
+
+	void work( const std::size_t w )
+	{
+		try
+		{
+			Random::Engine generator( m_params.seed, w + 1 );
+			RansacSampler sampler( m_values.size(), m_params.setSize );
+			typename Values::Buffer buffer;
+			InlierMask inliers( m_values.size() );
+			LocalOptimization< Values, ResultType, T > localOptimization( m_values, m_params, generator() );
+			Sprt< T > sprt( m_params.sprtDelta, static_cast< T >( m_params.nMinInlier ) / m_values.size(), m_params.sprtModelCost );
+			Sprt< T >* pSprt = m_params.sprtDelta > 0 ? &sprt : 0;
+
+			// hypotheses that do not beat a previous one of the same thread never win, the count can stop early
+			std::size_t nOwnBest = 0;
+
+			for ( std::size_t iRun = w; ; iRun += m_nThreads )
+			{
+				{
+					boost::mutex::scoped_lock lock( m_mutex );
+					if ( iRun < m_nLimit && m_params.deadline.check() )
+					{
+						// the iterations in progress are discarded
+						OPT_LOG_DEBUG( "RANSAC: deadline passed after " << m_nCommitted << " iterations" );
+						m_nLimit = m_nCommitted;
+					}
+					if ( iRun >= m_nLimit )
+						break;
+					m_progress.check();
+				}
+
+				sampler.draw( generator );
+				ResultType hypothesis;
+				std::size_t nInlier = 0;
+				if ( m_values.estimate( hypothesis, sampler, buffer ) )
+				{
+					nInlier = m_values.countInliers( hypothesis, m_params.threshold, std::max( m_params.nMinInlier, nOwnBest + 1 ), inliers, pSprt );
+					if ( nInlier >= m_params.nMinInlier && nInlier > nOwnBest )
+					{
+						if ( m_params.nLocalIterations )
+							nInlier = localOptimization.run( hypothesis, inliers, nInlier, buffer );
+						if ( pSprt )
+							pSprt->accepted( static_cast< T >( nInlier ) / m_values.size() );
+						nOwnBest = nInlier;
+						m_records[ w ].push_back( Record() );
+						m_records[ w ].back().iteration = iRun;
+						m_records[ w ].back().hypothesis = hypothesis;
+						m_records[ w ].back().inliers.swap( inliers );
+						inliers.resize( m_values.size() );
+					}
+					else
+						nInlier = 0;
+				}
+
+				boost::mutex::scoped_lock lock( m_mutex );
+				m_pending[ w ].push_back( nInlier );
+				commit();
+			}
+		}
+		catch ( ... )
+		{
+			boost::mutex::scoped_lock lock( m_mutex );
+			if ( !m_error )
+				m_error = boost::current_exception();
+			m_nLimit = 0;
+		}
+	}
+
+	/** applies the sequential termination criteria to all finished iterations in order, requires the lock */
+	void commit()
+	{
+		while ( m_nCommitted < m_nLimit )
+		{
+			std::deque< std::size_t >& pending = m_pending[ m_nCommitted % m_nThreads ];
+			if ( pending.empty() )
+				return;
+
+			const std::size_t nInlier = pending.front();
+			pending.pop_front();
+			if ( nInlier >= m_params.nMinInlier && nInlier > m_nBestInliers )
+			{
+				m_nBestInliers = nInlier;
+				m_iBest = m_nCommitted;
+				m_progress.report( "ransac", m_nCommitted + 1, static_cast< double >( m_values.size() - nInlier ) / m_values.size() );
+
+				if ( m_params.successProbability > 0 )
+					m_nLimit = std::min( m_nLimit, ransacIterations( static_cast< T >( m_nBestInliers ) / m_values.size()
+						, m_params.setSize, m_params.successProbability, m_params.nMaxIterations ) );
+				else
+					m_nLimit = m_nCommitted + 1;
+			}
+			m_nCommitted++;
+		}
+	}
+
+	const Values& m_values;
+	const RansacParameter< T >& m_params;
+	const std::size_t m_nThreads;
+
+	boost::mutex m_mutex;
+
+	/** inlier counts of finished but not yet committed iterations per thread */
+	std::vector< std::deque< std::size_t > > m_pending;
+
+	/** written by the owning thread only */
+	std::vector< std::vector< Record > > m_records;
+
+	std::size_t m_nCommitted;
+	std::size_t m_nLimit;
+	std::size_t m_nBestInliers;
+	std::size_t m_iBest;
+	boost::exception_ptr m_error;
+
+	/** the progress context of the calling thread, the workers report to it and check its token */
+	const Ubitrack::Util::ProgressContext m_progress;
+};
+
+/**
+ * @internal preemptive RANSAC, see \c RansacParameter::nPreemptiveHypotheses
  *
- * This struct holds all parameters to set the appropriate parameters
- * of the ransac algorithm framework.
+ * The hypotheses are generated from one random number stream and every hypothesis is scored
+ * on its own, so the result does not depend on the number of threads. Hypotheses with the
+ * same score are ranked in the order of their generation.
  */
-template< typename T >
-struct RansacParameter
+template< class Values, class ResultType, typename T >
+class PreemptiveRansac
 {
 public:
-	/** type of all the unsigned integer values within this class */
-	typedef std::size_t size_type;
-	
-	/** the floating point type used for numerical error expressions */
-	typedef T value_type;
+	PreemptiveRansac( const Values& values, const RansacParameter< T >& params )
+		: m_values( values )
+		, m_params( params )
+		, m_pBlock( 0 )
+		, m_nBlock( 0 )
+	{}
 
-	const value_type threshold;
-	const size_type setSize;
-	const size_type nMinInlier;
-	const size_type nMaxIterations;
-	
-	RansacParameter( const T fThreshold, const std::size_t n, const std::size_t minInlier, const std::size_t maxRuns )
-		: threshold ( fThreshold )
-		, setSize ( n )
-		, nMinInlier ( minInlier )
-		, nMaxIterations ( maxRuns )
-		{};
-	
-	/**
-	 * Constructor accepting intuitive parameters
-	 *
-	 *  @param fThreshold threhold to decide wether an value is accepeted tu support the hypothesis or not
-	 *  @param nMinSet amount of values needed to estimate a solution by the given problem
-	 *  @param n amount of values provided to estimate a solution for the given problem
-	 *  @param percentOutlier signs the percentage of expected outlier ( ranges from 0 to 1 )
-	 *  @param percentSucess probability that signs how intensive should be found a solution (affects number of iterations)
-	 */
-	RansacParameter( const T fThreshold, const std::size_t nMinSet, const std::size_t n, const T percentOutlier, const T percentSucess = 0.99 )
-		: threshold ( fThreshold )
-		, setSize ( nMinSet )
-		, nMinInlier ( static_cast< size_type >( (1.-percentOutlier) * n ) )
-		, nMaxIterations ( static_cast< size_type >( 1+std::log( 1-percentSucess) / ( std::log( 1-std::pow( 1-percentOutlier, static_cast< int >( nMinSet ) ) ) ) ) )
-		{};
-};
+	std::size_t run( ResultType& result )
+	{
+		const std::size_t nValues = m_values.size();
+		OPT_LOG_DEBUG( "Preemptive RANSAC with " << nValues << " values, " << m_params.nPreemptiveHypotheses << " hypotheses" );
+		// attributes: values, iterations, inliers
+		UBITRACK_TRACE_SPAN( "ransac", nValues );
 
+		Random::Engine generator( m_params.seed );
+		RansacSampler sampler( nValues, m_params.setSize );
+		typename Values::Buffer buffer;
+
+		// all hypotheses up front, degenerate sets are dropped
+		m_hypotheses.clear();
+		m_hypotheses.reserve( m_params.nPreemptiveHypotheses );
+		for ( std::size_t i = 0; i < m_params.nPreemptiveHypotheses; i++ )
+		{
+			sampler.draw( generator );
+			m_hypotheses.push_back( ResultType() );
+			if ( !m_values.estimate( m_hypotheses.back(), sampler, buffer ) )
+				m_hypotheses.pop_back();
+		}
+		m_scores.assign( m_hypotheses.size(), 0 );
+		m_alive.resize( m_hypotheses.size() );
+		for ( std::size_t i = 0; i < m_alive.size(); i++ )
+			m_alive[ i ] = i;
+
+		// the blocks are taken from a random order of the values
+		m_order.resize( nValues );
+		for ( std::size_t i = 0; i < nValues; i++ )
+		{
+			m_order[ i ] = i;
+			std::swap( m_order[ i ], m_order[ generator.below( i + 1 ) ] );
+		}
+
+		const std::size_t blockSize = std::max< std::size_t >( 1, m_params.preemptiveBlockSize );
+		for ( std::size_t nScored = 0; m_alive.size() > 1 && nScored < nValues; nScored += m_nBlock )
+		{
+			if ( m_params.deadline.check() )
+			{
+				OPT_LOG_DEBUG( "Preemptive RANSAC: deadline passed after " << nScored << " values" );
+				break;
+			}
+			Ubitrack::Util::checkCancellation();
+
+			m_pBlock = &m_order[ nScored ];
+			m_nBlock = std::min( blockSize, nValues - nScored );
+			if ( m_params.nThreads != 1 )
+			{
+				Ubitrack::Util::Executor& executor( m_params.executor ? *m_params.executor : Ubitrack::Util::Executor::instance() );
+				const std::size_t grain = std::max< std::size_t >( 1, m_alive.size() / ( 4 * executor.concurrency() ) );
+				executor.parallelFor( 0, m_alive.size(), grain, boost::bind( &PreemptiveRansac::score, this, _1, _2 ) );
+			}
+			else
+				score( 0, m_alive.size() );
+
+			// keep the better half
+			const std::size_t nKeep = m_alive.size() / 2;
+			std::nth_element( m_alive.begin(), m_alive.begin() + nKeep - 1, m_alive.end(), BetterScore( m_scores ) );
+			m_alive.resize( nKeep );
+		}
+
+		if ( m_alive.empty() )
+		{
+			OPT_LOG_DEBUG( "Preemptive RANSAC: no hypothesis could be estimated" );
+			return 0;
+		}
+
+		// the best remaining hypothesis is scored on all values
+		ResultType hypothesis( m_hypotheses[ *std::min_element( m_alive.begin(), m_alive.end(), BetterScore( m_scores ) ) ] );
+		InlierMask inliers( nValues );
+		std::size_t nInlier = m_values.countInliers( hypothesis, m_params.threshold, m_params.nMinInlier, inliers );
+		TRACEPOINT_OPTIMIZATION_RANSAC( m_hypotheses.size(), nInlier, nValues );
+		UBITRACK_TRACE_SPAN_SET( 1, m_hypotheses.size() );
+		if ( nInlier < m_params.nMinInlier )
+		{
+			OPT_LOG_DEBUG( "Preemptive RANSAC: Not enough inlier found" );
+			return 0;
+		}
+
+		if ( m_params.nLocalIterations )
+			nInlier = LocalOptimization< Values, ResultType, T >( m_values, m_params, generator() ).run( hypothesis, inliers, nInlier, buffer );
+		UBITRACK_TRACE_SPAN_SET( 2, nInlier );
+
+		m_values.estimateFinal( result, inliers, buffer );
+		OPT_LOG_DEBUG( "Estimated " << nInlier << " inlier from " << m_hypotheses.size() << " hypotheses." );
+		return nInlier;
+	}
 
-/// @internal index generator helper struct
-struct IndexGenerator
-{
 protected:
-	std::size_t index;
-	
-public:
-	IndexGenerator()
-		: index( 0 )
-	{}
-	
-	std::size_t operator()()
+	/// @internal orders hypotheses by descending score, then by generation
+	struct BetterScore
 	{
-		return index++;
+		explicit BetterScore( const std::vector< std::size_t >& scores )
+			: m_scores( scores )
+		{}
+
+		bool operator()( const std::size_t a, const std::size_t b ) const
+		{ return m_scores[ a ] > m_scores[ b ] || ( m_scores[ a ] == m_scores[ b ] && a < b ); }
+
+		const std::vector< std::size_t >& m_scores;
+	};
+
+	/** adds the inlier in the current block to the scores of the remaining hypotheses [ begin, end ) */
+	void score( const std::size_t begin, const std::size_t end )
+	{
+		const IndexRange block( m_pBlock, m_nBlock );
+		for ( std::size_t i = begin; i < end; i++ )
+			m_scores[ m_alive[ i ] ] += m_values.scoreIndices( m_hypotheses[ m_alive[ i ] ], m_params.threshold, block );
 	}
+
+	const Values& m_values;
+	const RansacParameter< T >& m_params;
+
+	std::vector< ResultType > m_hypotheses;
+	std::vector< std::size_t > m_scores;
+
+	/** indices of the remaining hypotheses */
+	std::vector< std::size_t > m_alive;
+
+	/** random order of the values and the current block of it */
+	std::vector< std::size_t > m_order;
+	const std::size_t* m_pBlock;
+	std::size_t m_nBlock;
 };
 
 /**
- * RANSAC algorithm (for one-parameter problems)
- *
- * @tparam InputIterator describes the type of container iterator that points to the values
- * @tparam ResultType the result type of the solution formulation
- * @tparam T describes the numeric type used for error calculation (usually \c float or \c double )
- * @tparam RansacFunctor the type of the struct/class that should include \c Estimator and \c Evaluator functor object to estimate the solution and validate it
- * @param iBegin an \c iterator point to the first element of a container including the values
- * @param iEnd an \c iterator point to the final element of a container including the values
- * @param result returns the best estimated result for the given problem and parameter set
- * @param model an instance of the struct/class that includes the Estimator and Evaluator FunctorObjects that describe the solution of a problem and it's validation
- * @param params an instance of the object containing the algorithms parametrization
- * @return 0 (failure) or number of inlier on success
-*/
-template< class InputIterator, class ResultType, typename T, class RansacFunctor >
-std::size_t ransac( const InputIterator iBegin, const InputIterator iEnd
-	, ResultType& result
-	, const RansacFunctor& model
-	, const RansacParameter< T >& params )
+ * @internal
+ * result of an estimator call \c ( estimator( ... ), EstimatorNoStatus() ). Estimators without
+ * result yield this type by the built-in comma operator and report degenerate samples by
+ * exceptions, estimators returning \c bool or \c Util::Status select the overloads below.
+ */
+struct EstimatorNoStatus
+{};
+
+/** @internal */
+inline bool operator,( bool ok, EstimatorNoStatus )
+{ return ok; }
+
+/** @internal */
+inline bool operator,( const Ubitrack::Util::Status& status, EstimatorNoStatus )
+{ return status.ok(); }
+
+/** @internal */
+inline bool estimatorSucceeded( EstimatorNoStatus )
+{ return true; }
+
+/** @internal */
+inline bool estimatorSucceeded( bool ok )
+{ return ok; }
+
+/// @internal sequential RANSAC loop, shared by the one- and two-parameter versions
+template< class Values, class ResultType, typename T >
+std::size_t ransac( const Values& values, ResultType& result, const RansacParameter< T >& params )
 {
-	typedef typename std::iterator_traits< InputIterator >::value_type value_type;
-	typedef typename value_type::value_type numeric_type;
-	
-	typedef std::vector< value_type > list_type;
-	
-	// estimate number of parameter list
-	const std::size_t nValues = std::distance( iBegin, iEnd );
+	const std::size_t nValues = values.size();
 	assert( params.nMinInlier <= nValues );
-	
+	// attributes: values, iterations, inliers
+	UBITRACK_TRACE_SPAN( "ransac", nValues );
+
 	OPT_LOG_DEBUG( "RANSAC with " << nValues << " values , " << params.nMinInlier << " inlier required" );
-	
-	// includes every indices once, needed to shuffle for random order
-	std::vector< std::size_t > iShuffle;
-	iShuffle.reserve( nValues );
-	std::generate_n( std::back_inserter( iShuffle ), nValues, IndexGenerator() );
-	
-	// set of pointer to inlier
-	std::vector< InputIterator > iInliers;
-	iInliers.reserve( nValues );
 
-	// amount of best inlier so far
+	// draws the random sets
+	RansacSampler sampler( nValues, params.setSize );
+	typename Values::Buffer buffer;
+
+	InlierMask inliers( nValues );
 	std::size_t nBestInliers = 0;
-	
-	std::vector< InputIterator > iBestInliers;
-	iBestInliers.reserve( nValues );
-	
-	std::size_t iRun ;
-	for( iRun = 0; iRun < params.nMaxIterations; iRun++ )
+	InlierMask bestInliers( nValues );
+
+	LocalOptimization< Values, ResultType, T > localOptimization( values, params, params.seed );
+	Sprt< T > sprt( params.sprtDelta, static_cast< T >( params.nMinInlier ) / nValues, params.sprtModelCost );
+	Sprt< T >* pSprt = params.sprtDelta > 0 ? &sprt : 0;
+
+	// reduced by adaptive termination
+	const bool bAdaptive = params.successProbability > 0;
+	std::size_t nIterations = params.nMaxIterations;
+
+	std::size_t iRun;
+	for( iRun = 0; iRun < nIterations; iRun++ )
 	{
-		OPT_LOG_TRACE( "RANSAC iteration " << iRun + 1 );
-		
-		
-		// generate random set
-		list_type list;
-		list.reserve( params.setSize );
-		
-		// shuffle the indices little bit
-		std::random_shuffle( iShuffle.begin(), iShuffle.end() );
-		std::vector< std::size_t >::iterator itSelected = iShuffle.begin();
-		std::vector< std::size_t >::iterator itEnd = iShuffle.begin();
-		std::advance( itEnd, params.setSize );
-		
-		for ( ; itSelected < itEnd; ++itSelected )
+		if ( params.deadline.check() )
 		{
-			InputIterator it ( iBegin );
-			std::advance( it, (*itSelected) );
-			list.push_back( *it );
+			OPT_LOG_DEBUG( "RANSAC: deadline passed after " << iRun << " iterations" );
+			break;
 		}
-		
-		// compute hypothesis
+		Ubitrack::Util::checkCancellation();
+		OPT_LOG_TRACE( "RANSAC iteration " << iRun + 1 );
+
+		sampler.draw();
 		ResultType hypothesis;
-		if( ! typename RansacFunctor::Estimator()( hypothesis, list.begin(), list.end() ) )
+		if( !values.estimate( hypothesis, sampler, buffer ) )
 		{
 			OPT_LOG_TRACE( "fast forward, no estimation possible" );
 			continue;
 		}
-		// count inlier
-		std::size_t nInlier = 0;
-		T fInlierDist = 0;
-		iInliers.clear();
-		
-		InputIterator it ( iBegin );
-		for ( std::size_t i = 0; i < nValues && int( nValues - i ) >= int( params.nMinInlier - nInlier ); i++, ++it )
-		{
-			const T d = typename RansacFunctor::Evaluator()( hypothesis, *it );
-			if( d < params.threshold )
-			{
-				iInliers.push_back( it );
-				nInlier++;
-				fInlierDist += d;
-			}
-		}
-		if( !nInlier )
-		{
-			OPT_LOG_TRACE( "fast forward, no inlier found" );
-			continue;
-		}	
-		OPT_LOG_TRACE( nInlier << " inlier, avg dist=" << fInlierDist / nInlier );
+
+		// stop counting as soon as the hypothesis cannot be accepted anymore
+		std::size_t nInlier = values.countInliers( hypothesis, params.threshold, std::max( params.nMinInlier, nBestInliers + 1 ), inliers, pSprt );
+		OPT_LOG_TRACE( nInlier << " inlier" );
 
 		// save inlier set if we reached the required number or are better than a previous run
 		if ( nInlier >= params.nMinInlier && nInlier > nBestInliers )
 		{
+			if ( params.nLocalIterations )
+				nInlier = localOptimization.run( hypothesis, inliers, nInlier, buffer );
 			nBestInliers = nInlier;
-			iBestInliers.swap( iInliers );
+			bestInliers.swap( inliers );
+			if ( pSprt )
+				pSprt->accepted( static_cast< T >( nBestInliers ) / nValues );
+			Ubitrack::Util::reportProgress( "ransac", iRun + 1, static_cast< double >( nValues - nBestInliers ) / nValues );
+
+			if ( bAdaptive )
+				nIterations = std::min( nIterations, ransacIterations( static_cast< T >( nBestInliers ) / nValues
+					, params.setSize, params.successProbability, params.nMaxIterations, pSprt ? pSprt->acceptance() : T( 1 ) ) );
 		}
 
-		// stop after nMinRun iterations if the required number of inlier was found
-		if ( nBestInliers >= params.nMinInlier )
+		// without adaptive termination stop as soon as the required number of inlier was found
+		if ( !bAdaptive && nBestInliers >= params.nMinInlier )
 			break;
 	}
 
 	if ( nBestInliers >= params.nMinInlier )
 	{
 		// compute final result
-		list_type list;
-		list.reserve( nBestInliers );
-		
-		typename std::vector< InputIterator >::const_iterator it = iBestInliers.begin();
-		typename std::vector< InputIterator >::const_iterator itEnd = iBestInliers.end();
-		for ( ; it < itEnd; ++it )
-			list.push_back( *(*it) );
-
-		typename RansacFunctor::Estimator()( result, list.begin(), list.end() );
+		values.estimateFinal( result, bestInliers, buffer );
 		OPT_LOG_DEBUG( "Estimated " << nBestInliers << " inlier after " << iRun + 1 << " iterations."  );
+		TRACEPOINT_OPTIMIZATION_RANSAC( iRun + 1, nBestInliers, nValues );
+		UBITRACK_TRACE_SPAN_SET( 1, iRun + 1 );
+		UBITRACK_TRACE_SPAN_SET( 2, nBestInliers );
 		return nBestInliers;
 	}
-	
+
 	OPT_LOG_DEBUG( "RANSAC: Not enough inlier found" );
+	TRACEPOINT_OPTIMIZATION_RANSAC( iRun, 0, nValues );
+	UBITRACK_TRACE_SPAN_SET( 1, iRun );
 	return 0;
 }
 
+} // namespace Detail
+
+
+/**
+ * RANSAC algorithm (for one-parameter problems)
+ *
+ * @tparam InputIterator describes the type of container iterator that points to the values
+ * @tparam ResultType the result type of the solution formulation
+ * @tparam T describes the numeric type used for error calculation (usually \c float or \c double )
+ * @tparam RansacFunctor the type of the struct/class that should include \c Estimator and \c Evaluator functor object to estimate the solution and validate it
+ * @param iBegin an \c iterator point to the first element of a container including the values
+ * @param iEnd an \c iterator point to the final element of a container including the values
+ * @param result returns the best estimated result for the given problem and parameter set
+ * @param model an instance of the struct/class that includes the Estimator and Evaluator FunctorObjects that describe the solution of a problem and it's validation
+ * @param params an instance of the object containing the algorithms parametrization
+ * @return 0 (failure) or number of inlier on success
+*/
+template< class InputIterator, class ResultType, typename T, class RansacFunctor >
+std::size_t ransac( const InputIterator iBegin, const InputIterator iEnd
+	, ResultType& result
+	, const RansacFunctor& model
+	, const RansacParameter< T >& params )
+{
+	typedef Detail::RansacValues1< InputIterator, RansacFunctor > values_type;
+	const values_type values( iBegin, iEnd );
+	if ( params.nPreemptiveHypotheses )
+		return Detail::PreemptiveRansac< values_type, ResultType, T >( values, params ).run( result );
+	if ( params.nThreads != 1 )
+		return Detail::ParallelRansac< values_type, ResultType, T >( values, params ).run( result );
+	return Detail::ransac( values, result, params );
+}
+
 
 /**
  * RANSAC algorithm (for two-parameter problems)
@@ -265,137 +1430,22 @@ std::size_t ransac( const InputIterator1 iBegin1, const InputIterator1 iEnd1
 		, const RansacFunctor& model
 		, const RansacParameter< T >& params )
 {
-	typedef typename std::iterator_traits< InputIterator1 >::value_type value_type;
-	typedef typename value_type::value_type numeric_type;
-	
-	typedef std::vector< value_type > list_type;
-	
-	// estimate number of parameter list
-	const std::size_t nValues = std::distance( iBegin1, iEnd1 );
-	assert( params.nMinInlier <= nValues );
-	
-	OPT_LOG_DEBUG( "RANSAC with " << nValues << " values , " << params.nMinInlier << " inlier required" );
-	
-	// includes every indices once, needed to shuffle for random order
-	std::vector< std::size_t > iShuffle;
-	iShuffle.reserve( nValues );
-	std::generate_n( std::back_inserter( iShuffle ), nValues, IndexGenerator() );
-	
-	// indices to inlier
-	std::vector< std::size_t > iInliers;
-	iInliers.reserve( nValues );
-
-	// amount of best inlier so far
-	std::size_t nBestInliers = 0;
-	
-	// indices to best set of inlier
-	std::vector< std::size_t > iBestInliers;
-	iBestInliers.reserve( nValues );
-	
-	std::size_t iRun ;
-	for( iRun = 0; iRun < params.nMaxIterations; iRun++ )
-	{
-		OPT_LOG_TRACE( "RANSAC iteration " << iRun + 1 );
-		
-		
-		// generate random set
-		list_type list1;
-		list_type list2;
-		list1.reserve( params.setSize );
-		list2.reserve( params.setSize );
-		
-		std::random_shuffle( iShuffle.begin(), iShuffle.end() );
-		std::vector< std::size_t >::iterator itSelected = iShuffle.begin();
-		std::vector< std::size_t >::iterator itEnd = iShuffle.begin();
-		std::advance( itEnd, params.setSize );
-		
-		for ( ; itSelected < itEnd; ++itSelected )
-		{
-			InputIterator1 it1 ( iBegin1 );
-			InputIterator2 it2 ( iBegin2 );
-			std::advance( it1, (*itSelected) );
-			std::advance( it2, (*itSelected) );
-			list1.push_back( *it1 );
-			list2.push_back( *it2 );
-		}
-		
-		// compute hypothesis
-		ResultType hypothesis;
-		if( ! typename RansacFunctor::Estimator()( hypothesis, list1.begin(), list1.end(), list2.begin(), list2.end() ) )
-		{
-			OPT_LOG_TRACE( "fast forward, no estimation possible" );
-			continue;
-		}
-		// count inlier
-		std::size_t nInlier = 0;
-		T fInlierDist = 0;
-		iInliers.clear();
-		
-		InputIterator1 it1 ( iBegin1 );
-		InputIterator2 it2 ( iBegin2 );
-		for ( std::size_t i = 0; i < nValues && int( nValues - i ) >= int( params.nMinInlier - nInlier ); i++, ++it1, ++it2 )
-		{
-			const T d = typename RansacFunctor::Evaluator()( hypothesis, *it1, *it2 );
-			if( d < params.threshold )
-			{
-				const std::size_t index = std::distance( iBegin1, it1 );
-				iInliers.push_back( index );
-				nInlier++;
-				fInlierDist += d;
-			}
-		}
-		if( !nInlier )
-		{
-			OPT_LOG_TRACE( "fast forward, no inlier found" );
-			continue;
-		}	
-		OPT_LOG_TRACE( nInlier << " inlier, avg dist=" << fInlierDist / nInlier );
-
-		// save inlier set if we reached the required number or are better than a previous run
-		if ( nInlier >= params.nMinInlier && nInlier > nBestInliers )
-		{
-			nBestInliers = nInlier;
-			iBestInliers.swap( iInliers );
-		}
-
-		// stop after nMinRun iterations if the required number of inlier was found
-		if ( nBestInliers >= params.nMinInlier )
-			break;
-	}
-
-	if ( nBestInliers >= params.nMinInlier )
-	{
-		// compute final result
-		list_type list1;
-		list_type list2;
-		list1.reserve( nBestInliers );
-		list2.reserve( nBestInliers );
-		
-		// iterator to the indices...
-		typename std::vector< std::size_t >::const_iterator iti = iBestInliers.begin();
-		const typename std::vector< std::size_t >::const_iterator itiEnd = iBestInliers.end();
-		for ( ; iti < itiEnd; ++iti )
-		{
-			InputIterator1 it1 ( iBegin1 );
-			InputIterator2 it2 ( iBegin2 );
-			std::advance( it1, (*iti) );
-			std::advance( it2, (*iti) );
-			list1.push_back( *it1 );
-			list2.push_back( *it2 );
-		}
-			
-
-		typename RansacFunctor::Estimator()( result, list1.begin(), list1.end(), list2.begin(), list2.end() );
-		OPT_LOG_DEBUG( "Estimated " << nBestInliers << " inlier after " << iRun + 1 << " iterations."  );
-		return nBestInliers;
-	}
-	
-	OPT_LOG_DEBUG( "RANSAC: Not enough inlier found" );
-	return 0;
+	typedef Detail::RansacValues2< InputIterator1, InputIterator2, RansacFunctor > values_type;
+	const values_type values( iBegin1, iEnd1, iBegin2 );
+	if ( params.nPreemptiveHypotheses )
+		return Detail::PreemptiveRansac< values_type, ResultType, T >( values, params ).run( result );
+	if ( params.nThreads != 1 )
+		return Detail::ParallelRansac< values_type, ResultType, T >( values, params ).run( result );
+	return Detail::ransac( values, result, params );
 }
 
 /**
  * RANSAC algorithm (for two-parameter problems)
+ *
+ * The estimator is called as \c estimator( hypothesis, list1, list2 ). It reports degenerate
+ * samples either by returning \c false or a failed \c Util::Status, which is cheap, or by
+ * throwing a \c std::runtime_error, which costs a throw and catch per sample.
+ *
  * @param result
  * @return 0 (failure) or number of inlier on success
  */
@@ -405,13 +1455,22 @@ std::size_t ransac( Result& result, const std::vector< Param1 >& paramList1, con
 	const Estimator& estimator, const Evaluator& evaluator, std::vector< bool >* pInliers = 0 )
 {
 	OPT_LOG_DEBUG( "RANSAC with " << paramList1.size() << " parameters, " << nMinInlier << " inlier required" );
+	// attributes: values, iterations, inliers
+	UBITRACK_TRACE_SPAN( "ransac", paramList1.size() );
 	
 	// set of inlier
-	std::vector< bool > bInliers( paramList1.size() );
+	Detail::InlierMask inliers( paramList1.size() );
 
 	// best so far
 	std::size_t nBestInliers = 0;
-	std::vector< bool > bBestInliers( paramList1.size() );
+	Detail::InlierMask bestInliers( paramList1.size() );
+	
+	// draws the random sets
+	RansacSampler sampler( paramList1.size(), nSetSize );
+	std::vector< Param1 > list1;
+	std::vector< Param2 > list2;
+	list1.reserve( nSetSize );
+	list2.reserve( nSetSize );
 	
 	std::size_t iRun ;
 	for ( iRun = 0; iRun < nMaxRuns; iRun++ )
@@ -422,31 +1481,33 @@ std::size_t ransac( Result& result, const std::vector< Param1 >& paramList1, con
 		try
 		{
 			// generate random set
-			std::vector< Param1 > list1;
-			std::vector< Param2 > list2;
-			list1.reserve( nSetSize );
-			list2.reserve( nSetSize );
-			
-			for ( std::size_t i = nSetSize; i; i-- )
+			sampler.draw();
+			list1.clear();
+			list2.clear();
+			for ( RansacSampler::const_iterator itSelected = sampler.begin(); itSelected < sampler.end(); ++itSelected )
 			{
-				std::size_t iSelected = rand() % paramList1.size();
-				list1.push_back( paramList1[ iSelected ] );
-				list2.push_back( paramList2[ iSelected ] );
-				// TODO: check for double selections...
+				list1.push_back( paramList1[ *itSelected ] );
+				list2.push_back( paramList2[ *itSelected ] );
 			}
 			
 			// compute hypothesis
 			Result hypothesis;
-			estimator( hypothesis, list1, list2 );
+			if ( !Detail::estimatorSucceeded( ( estimator( hypothesis, list1, list2 ), Detail::EstimatorNoStatus() ) ) )
+			{
+				OPT_LOG_TRACE( "RANSAC: degenerate sample" );
+				continue;
+			}
 			
 			// count inlier
 			std::size_t nInlier = 0;
 			double fInlierDist = 0;
+			inliers.clear();
 			for ( std::size_t i = 0; i < paramList1.size() && int( paramList1.size() - i ) >= int( nMinInlier - nInlier ); i++ )
 			{
 				double d = evaluator( hypothesis, paramList1[ i ], paramList2[ i ] );
-				if ( ( bInliers[ i ] = ( d < fThreshold ) ) == true )
+				if ( d < fThreshold )
 				{
+					inliers.set( i );
 					nInlier++;
 					fInlierDist += d;
 				}
@@ -458,7 +1519,7 @@ std::size_t ransac( Result& result, const std::vector< Param1 >& paramList1, con
 			if ( nInlier >= nMinInlier && nInlier > nBestInliers )
 			{
 				nBestInliers = nInlier;
-				bBestInliers = bInliers;
+				bestInliers.swap( inliers );
 			}
 
 			// stop after nMinRun iterations if the required number of inlier was found
@@ -477,21 +1538,26 @@ std::size_t ransac( Result& result, const std::vector< Param1 >& paramList1, con
 	if ( nBestInliers >= nMinInlier )
 	{
 		// compute final result
-		std::vector< Param1 > list1;
-		std::vector< Param2 > list2;
+		list1.clear();
+		list2.clear();
 		list1.reserve( nBestInliers );
 		list2.reserve( nBestInliers );
-		for ( std::size_t i = 0; i < paramList1.size(); i++ )
-			if ( bBestInliers[ i ] )
-			{
-				list1.push_back( paramList1[ i ] );
-				list2.push_back( paramList2[ i ] );
-			}
+		for ( std::size_t i = bestInliers.next( 0 ); i < paramList1.size(); i = bestInliers.next( i + 1 ) )
+		{
+			list1.push_back( paramList1[ i ] );
+			list2.push_back( paramList2[ i ] );
+		}
 			
-		estimator( result, list1, list2 );
+		if ( !Detail::estimatorSucceeded( ( estimator( result, list1, list2 ), Detail::EstimatorNoStatus() ) ) )
+		{
+			OPT_LOG_DEBUG( "RANSAC: estimation from the inlier failed" );
+			return 0;
+		}
 		if ( pInliers )
-			*pInliers = bBestInliers;
+			bestInliers.toVector( *pInliers );
 		OPT_LOG_DEBUG( iRun + 1 << " iterations, " << nBestInliers << " inlier" );
+		UBITRACK_TRACE_SPAN_SET( 1, iRun + 1 );
+		UBITRACK_TRACE_SPAN_SET( 2, nBestInliers );
 
 		return nBestInliers;
 	}
@@ -0,0 +1,239 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Robust loss functions for iteratively reweighted least squares
+ *
+ * Each loss is a function rho( s ) of the squared norm s of the residual of one measurement,
+ * which may consist of several rows (e.g. 2 for an image point). The optimizers minimize
+ * sum rho( s ) by weighting the rows of each measurement with w = rho'( s ) in every iteration.
+ *
+ * Pass a loss wrapped in a \c RobustWeightFunction as weight function to
+ * \c weightedLevenbergMarquardt:
+ * @code
+ * Optimization::weightedLevenbergMarquardt( problem, params, measurements, Optimization::OptTerminate( 10, 1e-6 ),
+ *     Optimization::OptNoNormalize(), Optimization::RobustWeightFunction< Optimization::HuberLoss >( 2, 3.0 ) );
+ * @endcode
+ * The levenberg-marquardt drivers then compute the weights and scale residuals and jacobian
+ * rows in a single pass. Steps are accepted and the residual is reported based on the sum
+ * of the losses.
+ */ 
+
+#ifndef __UBITRACK_MATH_OPTIMIZATION_ROBUSTLOSS_H_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_ROBUSTLOSS_H_INCLUDED__
+
+#include <math.h> // sqrt
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+/** Huber loss: quadratic for residuals up to c, linear beyond */
+struct HuberLoss
+{
+	/** @param c residual norm up to which the loss is quadratic */
+	explicit HuberLoss( double c )
+		: m_c( c )
+	{}
+
+	template< typename T >
+	T loss( const T s ) const
+	{ return s <= T( m_c * m_c ) ? s : T( 2 * m_c ) * sqrt( s ) - T( m_c * m_c ); }
+
+	template< typename T >
+	T weight( const T s ) const
+	{ return s <= T( m_c * m_c ) ? T( 1 ) : T( m_c ) / sqrt( s ); }
+
+	double m_c;
+};
+
+
+/** Cauchy (lorentzian) loss, c^2 log( 1 + s / c^2 ) */
+struct CauchyLoss
+{
+	/** @param c scale of the residuals */
+	explicit CauchyLoss( double c )
+		: m_c( c )
+	{}
+
+	template< typename T >
+	T loss( const T s ) const
+	{ return T( m_c * m_c ) * log( T( 1 ) + s / T( m_c * m_c ) ); }
+
+	template< typename T >
+	T weight( const T s ) const
+	{ return T( 1 ) / ( T( 1 ) + s / T( m_c * m_c ) ); }
+
+	double m_c;
+};
+
+
+/** Geman-McClure loss, c^2 s / ( c^2 + s ), which saturates for large residuals */
+struct GemanMcClureLoss
+{
+	/** @param c scale of the residuals */
+	explicit GemanMcClureLoss( double c )
+		: m_c( c )
+	{}
+
+	template< typename T >
+	T loss( const T s ) const
+	{ return T( m_c * m_c ) * s / ( T( m_c * m_c ) + s ); }
+
+	template< typename T >
+	T weight( const T s ) const
+	{
+		const T d = T( m_c * m_c ) / ( T( m_c * m_c ) + s );
+		return d * d;
+	}
+
+	double m_c;
+};
+
+
+/** Tukey biweight loss, which ignores measurements with residuals beyond c */
+struct TukeyLoss
+{
+	/** @param c residual norm beyond which measurements get zero weight */
+	explicit TukeyLoss( double c )
+		: m_c( c )
+	{}
+
+	template< typename T >
+	T loss( const T s ) const
+	{
+		if ( s >= T( m_c * m_c ) )
+			return T( m_c * m_c / 3 );
+		const T d = T( 1 ) - s / T( m_c * m_c );
+		return T( m_c * m_c / 3 ) * ( T( 1 ) - d * d * d );
+	}
+
+	template< typename T >
+	T weight( const T s ) const
+	{
+		if ( s >= T( m_c * m_c ) )
+			return T( 0 );
+		const T d = T( 1 ) - s / T( m_c * m_c );
+		return d * d;
+	}
+
+	double m_c;
+};
+
+
+/**
+ * Weight function for the optimizers that applies a robust loss to groups of
+ * \c rowsPerMeasurement consecutive residuals.
+ *
+ * Besides the generic \c computeWeights interface, the levenberg-marquardt drivers use
+ * \c weightRows, which computes the weights and scales residuals and jacobian rows in one pass.
+ */
+template< class Loss >
+class RobustWeightFunction
+{
+public:
+	/**
+	 * @param rowsPerMeasurement number of residual rows per measurement
+	 * @param loss the robust loss
+	 */
+	RobustWeightFunction( unsigned rowsPerMeasurement, const Loss& loss )
+		: m_rowsPerMeasurement( rowsPerMeasurement )
+		, m_loss( loss )
+	{}
+
+	/** constructs the loss from its scale parameter */
+	RobustWeightFunction( unsigned rowsPerMeasurement, double c )
+		: m_rowsPerMeasurement( rowsPerMeasurement )
+		, m_loss( c )
+	{}
+
+	bool noWeights() const
+	{ return false; }
+
+	const Loss& loss() const
+	{ return m_loss; }
+
+	/** sum of the losses of all measurements */
+	template< class VT >
+	typename VT::value_type totalLoss( const VT& errorVector ) const
+	{
+		typename VT::value_type sum( 0 );
+		for ( std::size_t i = 0; i < errorVector.size(); i += m_rowsPerMeasurement )
+			sum += m_loss.loss( squaredNorm( errorVector, i ) );
+		return sum;
+	}
+
+	template< class VT1, class VT2 > 
+	void computeWeights( const VT1& errorVector, VT2& weightVector ) const
+	{
+		for ( std::size_t i = 0; i < errorVector.size(); i += m_rowsPerMeasurement )
+		{
+			const typename VT1::value_type w = m_loss.weight( squaredNorm( errorVector, i ) );
+			for ( unsigned j = 0; j < m_rowsPerMeasurement; j++ )
+				weightVector( i + j ) = w;
+		}
+	}
+
+	/**
+	 * computes the weights of the residuals in \c errorVector, stores them in \c weightVector
+	 * and calls <tt>scaleRow( row, sqrt( w ) )</tt> for each residual row.
+	 * @return the sum of the losses of all measurements
+	 */
+	template< class VT1, class VT2, class RowScaler > 
+	typename VT1::value_type weightRows( VT1& errorVector, VT2& weightVector, RowScaler& scaleRow ) const
+	{
+		typedef typename VT1::value_type T;
+		T sum( 0 );
+		for ( std::size_t i = 0; i < errorVector.size(); i += m_rowsPerMeasurement )
+		{
+			const T s = squaredNorm( errorVector, i );
+			const T w = m_loss.weight( s );
+			const T sw = sqrt( w );
+			sum += m_loss.loss( s );
+			for ( unsigned j = 0; j < m_rowsPerMeasurement; j++ )
+			{
+				weightVector( i + j ) = w;
+				errorVector( i + j ) *= sw;
+				scaleRow( i + j, sw );
+			}
+		}
+		return sum;
+	}
+
+protected:
+	template< class VT >
+	typename VT::value_type squaredNorm( const VT& errorVector, const std::size_t i ) const
+	{
+		typename VT::value_type s( 0 );
+		for ( unsigned j = 0; j < m_rowsPerMeasurement; j++ )
+			s += errorVector( i + j ) * errorVector( i + j );
+		return s;
+	}
+
+	unsigned m_rowsPerMeasurement;
+	Loss m_loss;
+};
+
+}}} // namespace Ubitrack::Math::Optimization
+
+#endif
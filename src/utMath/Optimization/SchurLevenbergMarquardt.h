@@ -0,0 +1,386 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Levenberg-Marquardt optimizer for block-sparse (bundle adjustment type) problems
+ * which marginalizes the point parameters using the Schur complement.
+ */
+
+#ifndef __UBITRACK_MATH_OPTIMIZATION_SCHURLEVENBERGMARQUARDT_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_SCHURLEVENBERGMARQUARDT_INCLUDED__
+
+
+
+#ifdef HAVE_LAPACK
+
+#include <vector>
+#include <limits>
+#include <math.h> // sqrt
+
+// Boost
+#include <boost/scoped_ptr.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include <boost/numeric/ublas/vector_proxy.hpp>
+
+#include <boost/numeric/bindings/lapack/posv.hpp>
+#include <boost/numeric/bindings/traits/ublas_vector2.hpp>
+
+// Ubitrack
+#include "../Vector.h"
+#include "../Matrix.h"
+#include "../FixedDecomposition.h"
+#include "Optimization.h"
+#include "OptTelemetry.h"
+
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+/**
+ * @ingroup math
+ * Specialize to \c boost::true_type for problem classes of \c schurLevenbergMarquardt which
+ * evaluate all observations in one call, e.g. on a GPU, with
+ * <tt>evaluateObservationsWithJacobian( params, predicted, cameraJacobians, pointJacobians )</tt>.
+ * The function fills the vector of all predicted measurements and the vectors of jacobian blocks
+ * which have one element per observation.
+ */
+template< class P >
+struct SchurBatchEvaluation
+	: public boost::false_type
+{};
+
+
+namespace Detail {
+
+/**
+ * @internal
+ * Stores the residuals and the non-zero jacobian blocks of all observations of a
+ * block-sparse least-squares problem.
+ */
+template< typename T, std::size_t M, std::size_t C, std::size_t B >
+struct SchurJacobianBlocks
+{
+	SchurJacobianBlocks( std::size_t nObservations )
+		: cameraJacobians( nObservations )
+		, pointJacobians( nObservations )
+		, measurementDiff( M * nObservations )
+	{}
+
+	std::vector< Math::Matrix< T, M, C > > cameraJacobians;
+	std::vector< Math::Matrix< T, M, B > > pointJacobians;
+	typename Math::Vector< T >::base_type measurementDiff;
+};
+
+
+/**
+ * @internal
+ * Evaluates all observations of a block-sparse problem one by one and fills the residual vector.
+ * @return the squared residual
+ */
+template< class P, class X, class Y, class JB >
+typename X::value_type evaluateSchurBlocks( const P& problem, const X& params, const Y& measurement, JB& blocks, boost::false_type )
+{
+	namespace ublas = boost::numeric::ublas;
+	typedef typename X::value_type T;
+	static const std::size_t M = P::measurementBlockSize;
+	static const std::size_t C = P::cameraBlockSize;
+	static const std::size_t B = P::pointBlockSize;
+
+	const std::size_t pointOffset = C * problem.cameraCount();
+	const std::size_t n_obs = problem.observationCount();
+
+	Math::Vector< T, M > estimated;
+	for ( std::size_t i = 0; i < n_obs; i++ )
+	{
+		const std::size_t iC = C * problem.observationCamera( i );
+		const std::size_t iP = pointOffset + B * problem.observationPoint( i );
+
+		problem.evaluateObservationWithJacobian( i, estimated,
+			ublas::subrange( params, iC, iC + C ), ublas::subrange( params, iP, iP + B ),
+			blocks.cameraJacobians[ i ], blocks.pointJacobians[ i ] );
+
+		ublas::noalias( ublas::subrange( blocks.measurementDiff, i * M, ( i + 1 ) * M ) ) =
+			ublas::subrange( measurement, i * M, ( i + 1 ) * M ) - estimated;
+	}
+
+	return ublas::inner_prod( blocks.measurementDiff, blocks.measurementDiff );
+}
+
+
+/**
+ * @internal
+ * Evaluates all observations of a block-sparse problem in one call and fills the residual vector.
+ * @return the squared residual
+ */
+template< class P, class X, class Y, class JB >
+typename X::value_type evaluateSchurBlocks( const P& problem, const X& params, const Y& measurement, JB& blocks, boost::true_type )
+{
+	namespace ublas = boost::numeric::ublas;
+
+	problem.evaluateObservationsWithJacobian( params, blocks.measurementDiff, blocks.cameraJacobians, blocks.pointJacobians );
+	blocks.measurementDiff = measurement - blocks.measurementDiff;
+
+	return ublas::inner_prod( blocks.measurementDiff, blocks.measurementDiff );
+}
+
+
+/**
+ * @internal
+ * Evaluates all observations of a block-sparse problem and fills the residual vector.
+ * @return the squared residual
+ */
+template< class P, class X, class Y, class JB >
+typename X::value_type evaluateSchurBlocks( const P& problem, const X& params, const Y& measurement, JB& blocks )
+{ return evaluateSchurBlocks( problem, params, measurement, blocks, typename SchurBatchEvaluation< P >::type() ); }
+
+} // namespace Detail
+
+
+/**
+ * @ingroup math
+ * Optimize a bundle-adjustment type problem using the levenberg marquardt optimizer.
+ *
+ * The parameter vector consists of a set of "camera" blocks followed by a set of "point" blocks.
+ * Every observation depends on exactly one camera block and one point block, so only the
+ * non-zero blocks of the jacobian are stored. In each step the point parameters are
+ * marginalized using the Schur complement and only the reduced camera system is solved
+ * using a dense cholesky decomposition. The point updates are computed by back-substitution.
+ *
+ * @par The problem class
+ * The problem class P must provide
+ * - the enum values \c measurementBlockSize, \c cameraBlockSize and \c pointBlockSize,
+ * - \c cameraCount(), \c pointCount() and \c observationCount(),
+ * - \c observationCamera( i ) and \c observationPoint( i ) giving the indices of the blocks observation i depends on,
+ * - a function \c evaluateObservationWithJacobian( i, result, cameraParams, pointParams, cameraJacobian, pointJacobian )
+ *   which computes the predicted measurement of observation i and the jacobians wrt. both parameter blocks,
+ *   or, if \c SchurBatchEvaluation is specialized, \c evaluateObservationsWithJacobian for all observations.
+ *
+ * @param problem the problem to optimize -- provides measurement estimates and jacobians
+ * @param params initial parameters on entry, optimized parameters on exit (camera blocks first, then point blocks)
+ * @param measurement the measurement vector (\c measurementBlockSize entries per observation)
+ * @param terminationCriteria functor that returns true if the optimization should terminate. Is called with
+ *   bool operator()( unsigned iteration, double currentError, double previousError )
+ * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
+ * @return the residual of the optimization process
+ */
+template< class P, class X, class Y, class TC, class NT >
+typename X::value_type schurLevenbergMarquardt( P& problem, X& params, const Y& measurement,
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(),
+	const typename X::value_type fStepSize = 1.0, const typename X::value_type fStepFactor = 10.0 )
+{
+	namespace lapack = boost::numeric::bindings::lapack;
+	namespace ublas = boost::numeric::ublas;
+	typedef typename X::value_type T;
+	typedef typename Math::Matrix< T >::base_type MatType;
+	typedef typename Math::Vector< T >::base_type VecType;
+	static const std::size_t M = P::measurementBlockSize;
+	static const std::size_t C = P::cameraBlockSize;
+	static const std::size_t B = P::pointBlockSize;
+	typedef Detail::SchurJacobianBlocks< T, M, C, B > BlockType;
+
+	const std::size_t n_cams = problem.cameraCount();
+	const std::size_t n_points = problem.pointCount();
+	const std::size_t n_obs = problem.observationCount();
+	const std::size_t n_camParams = C * n_cams;
+	const std::size_t n_params = params.size();
+	assert( n_params == n_camParams + B * n_points );
+	assert( measurement.size() == M * n_obs );
+
+	// observations of each point, needed to form the schur complement
+	std::vector< std::vector< std::size_t > > pointObservations( n_points );
+	for ( std::size_t i = 0; i < n_obs; i++ )
+		pointObservations[ problem.observationPoint( i ) ].push_back( i );
+
+	// create some matrices and vectors
+	boost::scoped_ptr< BlockType > pBlocks( new BlockType( n_obs ) );
+	boost::scoped_ptr< BlockType > pBlocks2( new BlockType( n_obs ) );
+	std::vector< Math::Matrix< T, C, C > > camHessian( n_cams );
+	std::vector< Math::Matrix< T, B, B > > pointHessian( n_points );
+	std::vector< Math::Matrix< T, C, B > > camPointHessian( n_obs );
+	std::vector< Math::Matrix< T, C, B > > schurFactors( n_obs );
+	VecType camGradient( n_camParams );
+	VecType pointGradient( B * n_points );
+	MatType reducedSystem( n_camParams, n_camParams );
+	VecType paramDiff( n_params );
+	VecType newParams( n_params );
+
+	// compute initial error
+	T fErrPrev = Detail::evaluateSchurBlocks( problem, params, measurement, *pBlocks );
+	OPT_LOG_DEBUG( "Schur Levenberg-Marquardt residual 0: " << fErrPrev );
+	const OptTelemetryRun telemetry( "Schur Levenberg-Marquardt" );
+	telemetry.iteration( 0, fErrPrev );
+
+	// start optimization loop
+	T fLambda = T( fStepSize );
+	std::size_t iteration = 0;
+	bool bTerminate = false;
+	while ( !bTerminate )
+	{
+		++iteration;
+
+		// accumulate the blocks of the normal equations
+		for ( std::size_t c = 0; c < n_cams; c++ )
+			camHessian[ c ] = ublas::zero_matrix< T >( C, C );
+		for ( std::size_t p = 0; p < n_points; p++ )
+			pointHessian[ p ] = ublas::zero_matrix< T >( B, B );
+		camGradient.clear();
+		pointGradient.clear();
+
+		for ( std::size_t i = 0; i < n_obs; i++ )
+		{
+			const std::size_t c = problem.observationCamera( i );
+			const std::size_t p = problem.observationPoint( i );
+			const Math::Matrix< T, M, C >& jC( pBlocks->cameraJacobians[ i ] );
+			const Math::Matrix< T, M, B >& jP( pBlocks->pointJacobians[ i ] );
+			const ublas::vector_range< const VecType > diff( pBlocks->measurementDiff, ublas::range( i * M, ( i + 1 ) * M ) );
+
+			ublas::noalias( camHessian[ c ] ) += ublas::prod( ublas::trans( jC ), jC );
+			ublas::noalias( pointHessian[ p ] ) += ublas::prod( ublas::trans( jP ), jP );
+			ublas::noalias( camPointHessian[ i ] ) = ublas::prod( ublas::trans( jC ), jP );
+			ublas::noalias( ublas::subrange( camGradient, c * C, ( c + 1 ) * C ) ) += ublas::prod( ublas::trans( jC ), diff );
+			ublas::noalias( ublas::subrange( pointGradient, p * B, ( p + 1 ) * B ) ) += ublas::prod( ublas::trans( jP ), diff );
+		}
+
+		// add lambda to diagonal
+		for ( std::size_t c = 0; c < n_cams; c++ )
+			for ( std::size_t j = 0; j < C; j++ )
+				camHessian[ c ]( j, j ) += fLambda;
+
+		bool bSingular = false;
+		for ( std::size_t p = 0; p < n_points && !bSingular; p++ )
+		{
+			for ( std::size_t j = 0; j < B; j++ )
+				pointHessian[ p ]( j, j ) += fLambda;
+			bSingular = !Math::choleskyInvert( pointHessian[ p ] );
+		}
+
+		// form the reduced camera system (lower triangle only)
+		if ( !bSingular )
+		{
+			reducedSystem.clear();
+			for ( std::size_t c = 0; c < n_cams; c++ )
+				ublas::subrange( reducedSystem, c * C, ( c + 1 ) * C, c * C, ( c + 1 ) * C ) = camHessian[ c ];
+			ublas::noalias( ublas::subrange( paramDiff, 0, n_camParams ) ) = camGradient;
+
+			for ( std::size_t p = 0; p < n_points; p++ )
+			{
+				const std::vector< std::size_t >& obs( pointObservations[ p ] );
+				const ublas::vector_range< VecType > gradP( pointGradient, ublas::range( p * B, ( p + 1 ) * B ) );
+
+				for ( std::size_t a = 0; a < obs.size(); a++ )
+				{
+					const std::size_t cA = problem.observationCamera( obs[ a ] );
+					ublas::noalias( schurFactors[ obs[ a ] ] ) = ublas::prod( camPointHessian[ obs[ a ] ], pointHessian[ p ] );
+					ublas::noalias( ublas::subrange( paramDiff, cA * C, ( cA + 1 ) * C ) ) -= ublas::prod( schurFactors[ obs[ a ] ], gradP );
+
+					for ( std::size_t b = 0; b < obs.size(); b++ )
+					{
+						const std::size_t cB = problem.observationCamera( obs[ b ] );
+						if ( cB > cA )
+							continue;
+						ublas::noalias( ublas::subrange( reducedSystem, cA * C, ( cA + 1 ) * C, cB * C, ( cB + 1 ) * C ) ) -=
+							ublas::prod( schurFactors[ obs[ a ] ], ublas::trans( camPointHessian[ obs[ b ] ] ) );
+					}
+				}
+			}
+
+			ublas::vector_range< VecType > camDiff( paramDiff, ublas::range( 0, n_camParams ) );
+			if ( n_camParams > 0 )
+			{
+				VecType camStep( camDiff );
+				bSingular = lapack::posv( 'L', reducedSystem, camStep ) != 0;
+				camDiff = camStep;
+			}
+		}
+
+		if ( bSingular )
+		{
+			// a failed decomposition counts as an iteration without improvement. If lambda overflows,
+			// the normal equations are not finite (e.g. NaN in the jacobian) and more damping cannot help
+			fLambda *= T( fStepFactor );
+			if ( !( fLambda <= std::numeric_limits< T >::max() ) )
+			{
+				OPT_LOG_DEBUG( "Error in cholesky decomposition, stopping at lambda " << fLambda );
+				break;
+			}
+			OPT_LOG_DEBUG( "Error in cholesky decomposition, increasing lambda" );
+			telemetry.iteration( iteration, fErrPrev, fLambda );
+			bTerminate = terminationCriteria( iteration, std::numeric_limits< T >::infinity(), fErrPrev );
+			continue;
+		}
+
+		// back-substitute the point updates
+		for ( std::size_t p = 0; p < n_points; p++ )
+		{
+			Math::Vector< T, B > rhs( ublas::subrange( pointGradient, p * B, ( p + 1 ) * B ) );
+			const std::vector< std::size_t >& obs( pointObservations[ p ] );
+			for ( std::size_t a = 0; a < obs.size(); a++ )
+			{
+				const std::size_t cA = problem.observationCamera( obs[ a ] );
+				ublas::noalias( rhs ) -= ublas::prod( ublas::trans( camPointHessian[ obs[ a ] ] ),
+					ublas::subrange( paramDiff, cA * C, ( cA + 1 ) * C ) );
+			}
+			ublas::noalias( ublas::subrange( paramDiff, n_camParams + p * B, n_camParams + ( p + 1 ) * B ) ) =
+				ublas::prod( pointHessian[ p ], rhs );
+		}
+
+		OPT_LOG_TRACE( "paramDiff: " << paramDiff );
+		ublas::noalias( newParams ) = params + paramDiff;
+
+		// normalize
+		normalize.evaluate( newParams, newParams );
+
+		// compute new error
+		const T fErr = Detail::evaluateSchurBlocks( problem, newParams, measurement, *pBlocks2 );
+		OPT_LOG_DEBUG( "Schur Levenberg-Marquardt residual " << iteration << ": " << fErr );
+		telemetry.iteration( iteration, fErr, fLambda );
+
+		// check if we should terminate
+		bTerminate = terminationCriteria( iteration, fErr, fErrPrev );
+
+		// update parameters
+		if ( fErr >= fErrPrev )
+			fLambda *= T( fStepFactor );
+		else
+		{
+			fLambda /= T( fStepFactor );
+			params = newParams;
+
+			// swap jacobian blocks and residuals
+			pBlocks.swap( pBlocks2 );
+
+			fErrPrev = fErr;
+		}
+	}
+
+	return fErrPrev;
+}
+
+}}} // namespace Ubitrack::Math::Optimization
+
+#endif	// HAVE_LAPACK
+
+#endif	// __UBITRACK_MATH_OPTIMIZATION_SCHURLEVENBERGMARQUARDT_INCLUDED__
@@ -0,0 +1,175 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Sparse jacobian in compressed row storage (CSR) for the sparse Levenberg-Marquardt optimizer
+ */
+
+#ifndef __UBITRACK_MATH_OPTIMIZATION_SPARSEJACOBIAN_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_SPARSEJACOBIAN_INCLUDED__
+
+#include <vector>
+#include <cstddef>
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+/**
+ * @ingroup math
+ * Jacobian matrix that only stores its non-zero elements, row by row.
+ *
+ * A problem fills the jacobian from scratch in each evaluation, appending the non-zero
+ * elements of each row in any column order and closing it with \c finishRow.
+ * The internal arrays keep their capacity, so refilling a jacobian with the same
+ * structure does not allocate:
+ * @code
+ * J.clear( nParams );
+ * for ( std::size_t i = 0; i < nObservations; i++ )
+ * {
+ *     J.push_back( iCamera, cameraJacobian( i ) ); // contiguous block of a row
+ *     J.push_back( iPoint, dxdp );
+ *     J.finishRow();
+ * }
+ * @endcode
+ * Each column must appear at most once per row.
+ *
+ * @tparam T builtin type of the elements (e.g \c double or \c float )
+ */
+template< typename T >
+class SparseJacobian
+{
+public:
+	typedef T value_type;
+
+	/** creates an empty jacobian with \c nCols columns */
+	SparseJacobian( const std::size_t nCols = 0 )
+		: m_rowStart( 1, 0 )
+		, m_size2( nCols )
+	{}
+
+	/** removes all rows, keeping the allocated memory */
+	void clear( const std::size_t nCols )
+	{
+		m_rowStart.resize( 1 );
+		m_columns.clear();
+		m_values.clear();
+		m_size2 = nCols;
+	}
+
+	/** adds an element to the current row */
+	void push_back( const std::size_t col, const T value )
+	{
+		m_columns.push_back( col );
+		m_values.push_back( value );
+	}
+
+	/** adds the elements of \c v to the current row, starting at column \c firstCol */
+	template< class VT >
+	void push_back( const std::size_t firstCol, const VT& v, const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+			push_back( firstCol + i, T( v( i ) ) );
+	}
+
+	/** closes the current row, the next elements go to a new row */
+	void finishRow()
+	{ m_rowStart.push_back( m_columns.size() ); }
+
+	/** number of rows */
+	std::size_t size1() const
+	{ return m_rowStart.size() - 1; }
+
+	/** number of columns */
+	std::size_t size2() const
+	{ return m_size2; }
+
+	/** number of stored elements */
+	std::size_t nonZeros() const
+	{ return m_values.size(); }
+
+	/** index of the first element of row \c i */
+	std::size_t rowBegin( const std::size_t i ) const
+	{ return m_rowStart[ i ]; }
+
+	/** index behind the last element of row \c i */
+	std::size_t rowEnd( const std::size_t i ) const
+	{ return m_rowStart[ i + 1 ]; }
+
+	/** column of the \c k-th element */
+	std::size_t column( const std::size_t k ) const
+	{ return m_columns[ k ]; }
+
+	/** value of the \c k-th element */
+	T value( const std::size_t k ) const
+	{ return m_values[ k ]; }
+
+	/** value of the \c k-th element */
+	T& value( const std::size_t k )
+	{ return m_values[ k ]; }
+
+	/** multiplies row \c i with \c w */
+	void scaleRow( const std::size_t i, const T w )
+	{
+		for ( std::size_t k = m_rowStart[ i ]; k < m_rowStart[ i + 1 ]; k++ )
+			m_values[ k ] *= w;
+	}
+
+	/** computes y = J * x */
+	template< class VT1, class VT2 >
+	void multiply( const VT1& x, VT2& y ) const
+	{
+		for ( std::size_t i = 0; i < size1(); i++ )
+		{
+			T sum = 0;
+			for ( std::size_t k = m_rowStart[ i ]; k < m_rowStart[ i + 1 ]; k++ )
+				sum += m_values[ k ] * x( m_columns[ k ] );
+			y( i ) = sum;
+		}
+	}
+
+	/** computes y = J^T * x */
+	template< class VT1, class VT2 >
+	void multiplyTransposed( const VT1& x, VT2& y ) const
+	{
+		for ( std::size_t j = 0; j < m_size2; j++ )
+			y( j ) = 0;
+		for ( std::size_t i = 0; i < size1(); i++ )
+			for ( std::size_t k = m_rowStart[ i ]; k < m_rowStart[ i + 1 ]; k++ )
+				y( m_columns[ k ] ) += m_values[ k ] * x( i );
+	}
+
+	/** true if both jacobians have their elements at the same positions */
+	bool samePattern( const SparseJacobian& other ) const
+	{ return m_size2 == other.m_size2 && m_rowStart == other.m_rowStart && m_columns == other.m_columns; }
+
+protected:
+	std::vector< std::size_t > m_rowStart;
+	std::vector< std::size_t > m_columns;
+	std::vector< T > m_values;
+	std::size_t m_size2;
+};
+
+}}} // namespace Ubitrack::Math::Optimization
+
+#endif	// __UBITRACK_MATH_OPTIMIZATION_SPARSEJACOBIAN_INCLUDED__
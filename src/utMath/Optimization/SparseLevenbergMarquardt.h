@@ -0,0 +1,576 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Levenberg-Marquardt optimizer for problems with a sparse jacobian
+ *
+ * The normal equations J^T J are assembled in a sparse format and solved by a
+ * sparse cholesky decomposition, so memory and time scale with the number of
+ * non-zero elements instead of the product of measurement and parameter count.
+ */
+
+#ifndef __UBITRACK_MATH_OPTIMIZATION_SPARSELEVENBERGMARQUARDT_INCLUDED__
+#define __UBITRACK_MATH_OPTIMIZATION_SPARSELEVENBERGMARQUARDT_INCLUDED__
+
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <math.h> // sqrt
+
+#include <boost/numeric/ublas/vector_proxy.hpp>
+
+// Ubitrack
+#include "../Vector.h"
+#include "Optimization.h"
+#include "OptTelemetry.h"
+#include "SparseJacobian.h"
+#include "RobustLoss.h"
+#include "../Gpu/Backend.h"
+
+
+namespace Ubitrack { namespace Math { namespace Optimization {
+
+/**
+ * possible solvers to use in sparse levenberg-marquardt optimization.
+ * \c sparseLmUseGpuConjugateGradient runs the conjugate gradients of \c Gpu::ConjugateGradientSolver,
+ * on the host if there is no CUDA device.
+ */
+enum SparseLmSolverType { sparseLmUseCholesky, sparseLmUseConjugateGradient, sparseLmUseGpuConjugateGradient };
+
+namespace Detail {
+
+/**
+ * @internal
+ * Sparse cholesky decomposition of J^T J + lambda I.
+ *
+ * \c analyze computes a fill-reducing minimum degree ordering, the elimination tree and
+ * the structure of the factor from the structure of the jacobian. \c factorize only
+ * computes the numbers and can be repeated as long as the structure does not change.
+ * The factor is computed row by row as in CSparse (T. Davis, Direct Methods for Sparse
+ * Linear Systems, 2006).
+ */
+template< typename T >
+class SparseCholesky
+{
+public:
+	/** true if the structure was analyzed for a jacobian with the same structure */
+	bool analyzed( const SparseJacobian< T >& J ) const
+	{ return m_pattern.size2() == J.size2() && m_pattern.samePattern( J ); }
+
+	/** computes ordering and structure of the decomposition */
+	void analyze( const SparseJacobian< T >& J )
+	{
+		const std::size_t n = J.size2();
+		m_pattern = J;
+
+		// graph of J^T J
+		std::vector< std::set< std::size_t > > graph( n );
+		for ( std::size_t r = 0; r < J.size1(); r++ )
+			for ( std::size_t a = J.rowBegin( r ); a < J.rowEnd( r ); a++ )
+				for ( std::size_t b = J.rowBegin( r ); b < a; b++ )
+				{
+					graph[ J.column( a ) ].insert( J.column( b ) );
+					graph[ J.column( b ) ].insert( J.column( a ) );
+				}
+
+		// minimum degree ordering on a copy of the graph
+		m_perm.resize( n );
+		m_iperm.resize( n );
+		{
+			std::vector< std::set< std::size_t > > elim( graph );
+			std::vector< bool > done( n, false );
+			for ( std::size_t k = 0; k < n; k++ )
+			{
+				std::size_t best = npos();
+				for ( std::size_t i = 0; i < n; i++ )
+					if ( !done[ i ] && ( best == npos() || elim[ i ].size() < elim[ best ].size() ) )
+						best = i;
+
+				// eliminating a node connects all its neighbours
+				const std::set< std::size_t >& adj( elim[ best ] );
+				for ( std::set< std::size_t >::const_iterator it = adj.begin(); it != adj.end(); ++it )
+				{
+					elim[ *it ].erase( best );
+					for ( std::set< std::size_t >::const_iterator it2 = adj.begin(); it2 != adj.end(); ++it2 )
+						if ( *it2 != *it )
+							elim[ *it ].insert( *it2 );
+				}
+				elim[ best ].clear();
+				done[ best ] = true;
+				m_perm[ k ] = best;
+				m_iperm[ best ] = k;
+			}
+		}
+
+		// upper triangle of the permuted matrix in compressed column storage, rows sorted
+		std::vector< std::vector< std::size_t > > columns( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const std::size_t pi = m_iperm[ i ];
+			columns[ pi ].push_back( pi );
+			for ( std::set< std::size_t >::const_iterator it = graph[ i ].begin(); it != graph[ i ].end(); ++it )
+				if ( m_iperm[ *it ] < pi )
+					columns[ pi ].push_back( m_iperm[ *it ] );
+		}
+		m_cp.assign( 1, 0 );
+		m_ci.clear();
+		for ( std::size_t j = 0; j < n; j++ )
+		{
+			std::sort( columns[ j ].begin(), columns[ j ].end() );
+			m_ci.insert( m_ci.end(), columns[ j ].begin(), columns[ j ].end() );
+			m_cp.push_back( m_ci.size() );
+		}
+		m_cx.resize( m_ci.size() );
+
+		// position of each product of two elements of a row in the packed matrix
+		m_products.clear();
+		for ( std::size_t r = 0; r < J.size1(); r++ )
+			for ( std::size_t a = J.rowBegin( r ); a < J.rowEnd( r ); a++ )
+				for ( std::size_t b = J.rowBegin( r ); b <= a; b++ )
+				{
+					const std::size_t pa = m_iperm[ J.column( a ) ];
+					const std::size_t pb = m_iperm[ J.column( b ) ];
+					const std::size_t i = std::min( pa, pb );
+					const std::size_t j = std::max( pa, pb );
+					m_products.push_back( std::lower_bound( m_ci.begin() + m_cp[ j ], m_ci.begin() + m_cp[ j + 1 ], i ) - m_ci.begin() );
+				}
+
+		// elimination tree
+		m_parent.assign( n, npos() );
+		std::vector< std::size_t > ancestor( n, npos() );
+		for ( std::size_t k = 0; k < n; k++ )
+			for ( std::size_t p = m_cp[ k ]; p < m_cp[ k + 1 ]; p++ )
+				for ( std::size_t i = m_ci[ p ]; i != npos() && i < k; )
+				{
+					const std::size_t next = ancestor[ i ];
+					ancestor[ i ] = k;
+					if ( next == npos() )
+						m_parent[ i ] = k;
+					i = next;
+				}
+
+		// column counts of the factor from the row structures
+		m_mark.assign( n, npos() );
+		m_stack.resize( n );
+		std::vector< std::size_t > counts( n, 1 );
+		for ( std::size_t k = 0; k < n; k++ )
+			for ( std::size_t top = reach( k ); top < n; top++ )
+				counts[ m_stack[ top ] ]++;
+		m_lp.assign( 1, 0 );
+		for ( std::size_t j = 0; j < n; j++ )
+			m_lp.push_back( m_lp.back() + counts[ j ] );
+		m_li.resize( m_lp.back() );
+		m_lx.resize( m_lp.back() );
+		m_work.resize( n );
+		m_next.resize( n );
+	}
+
+	/**
+	 * decomposes J^T J + lambda I.
+	 * @return false if the matrix is not (numerically) positive definite
+	 */
+	bool factorize( const SparseJacobian< T >& J, const T lambda )
+	{
+		const std::size_t n = J.size2();
+
+		// assemble J^T J in the precomputed pattern
+		std::fill( m_cx.begin(), m_cx.end(), T( 0 ) );
+		std::vector< std::size_t >::const_iterator it = m_products.begin();
+		for ( std::size_t r = 0; r < J.size1(); r++ )
+			for ( std::size_t a = J.rowBegin( r ); a < J.rowEnd( r ); a++ )
+				for ( std::size_t b = J.rowBegin( r ); b <= a; b++ )
+					m_cx[ *it++ ] += J.value( a ) * J.value( b );
+		for ( std::size_t j = 0; j < n; j++ )
+			m_cx[ m_cp[ j + 1 ] - 1 ] += lambda; // the diagonal is the last element of each column
+
+		// up-looking cholesky, row k of L is computed from the rows above
+		std::fill( m_work.begin(), m_work.end(), T( 0 ) );
+		std::fill( m_mark.begin(), m_mark.end(), npos() );
+		std::copy( m_lp.begin(), m_lp.end() - 1, m_next.begin() );
+		for ( std::size_t k = 0; k < n; k++ )
+		{
+			const std::size_t top0 = reach( k );
+			for ( std::size_t p = m_cp[ k ]; p < m_cp[ k + 1 ]; p++ )
+				m_work[ m_ci[ p ] ] = m_cx[ p ];
+			T d = m_work[ k ];
+			m_work[ k ] = 0;
+
+			for ( std::size_t top = top0; top < n; top++ )
+			{
+				const std::size_t i = m_stack[ top ];
+				const T lki = m_work[ i ] / m_lx[ m_lp[ i ] ];
+				m_work[ i ] = 0;
+				for ( std::size_t p = m_lp[ i ] + 1; p < m_next[ i ]; p++ )
+					m_work[ m_li[ p ] ] -= m_lx[ p ] * lki;
+				d -= lki * lki;
+				const std::size_t p = m_next[ i ]++;
+				m_li[ p ] = k;
+				m_lx[ p ] = lki;
+			}
+
+			if ( !( d > T( 0 ) ) )
+				return false;
+			const std::size_t p = m_next[ k ]++;
+			m_li[ p ] = k;
+			m_lx[ p ] = sqrt( d );
+		}
+		return true;
+	}
+
+	/** solves ( J^T J + lambda I ) x = b after \c factorize, overwriting b with x */
+	template< class VT >
+	void solve( VT& b )
+	{
+		const std::size_t n = m_perm.size();
+		for ( std::size_t k = 0; k < n; k++ )
+			m_work[ k ] = b( m_perm[ k ] );
+
+		// L y = P b
+		for ( std::size_t j = 0; j < n; j++ )
+		{
+			m_work[ j ] /= m_lx[ m_lp[ j ] ];
+			for ( std::size_t p = m_lp[ j ] + 1; p < m_lp[ j + 1 ]; p++ )
+				m_work[ m_li[ p ] ] -= m_lx[ p ] * m_work[ j ];
+		}
+
+		// L^T x = y
+		for ( std::size_t j = n; j-- > 0; )
+		{
+			for ( std::size_t p = m_lp[ j ] + 1; p < m_lp[ j + 1 ]; p++ )
+				m_work[ j ] -= m_lx[ p ] * m_work[ m_li[ p ] ];
+			m_work[ j ] /= m_lx[ m_lp[ j ] ];
+		}
+
+		for ( std::size_t k = 0; k < n; k++ )
+			b( m_perm[ k ] ) = m_work[ k ];
+	}
+
+	/** number of non-zero elements of the factor */
+	std::size_t factorNonZeros() const
+	{ return m_li.size(); }
+
+protected:
+	/// marks a missing node, e.g. the parent of a root
+	static std::size_t npos()
+	{ return std::size_t( -1 ); }
+
+	/// structure of row k of L in m_stack[ top .. n - 1 ], returns top
+	std::size_t reach( const std::size_t k )
+	{
+		const std::size_t n = m_parent.size();
+		std::size_t top = n;
+		m_mark[ k ] = k;
+		for ( std::size_t p = m_cp[ k ]; p < m_cp[ k + 1 ]; p++ )
+		{
+			std::size_t i = m_ci[ p ];
+			std::size_t len = 0;
+			for ( ; m_mark[ i ] != k; i = m_parent[ i ] )
+			{
+				m_stack[ len++ ] = i;
+				m_mark[ i ] = k;
+			}
+			while ( len > 0 )
+				m_stack[ --top ] = m_stack[ --len ];
+		}
+		return top;
+	}
+
+	SparseJacobian< T > m_pattern;
+	std::vector< std::size_t > m_perm;
+	std::vector< std::size_t > m_iperm;
+	std::vector< std::size_t > m_cp;
+	std::vector< std::size_t > m_ci;
+	std::vector< T > m_cx;
+	std::vector< std::size_t > m_products;
+	std::vector< std::size_t > m_parent;
+	std::vector< std::size_t > m_lp;
+	std::vector< std::size_t > m_li;
+	std::vector< T > m_lx;
+	std::vector< std::size_t > m_mark;
+	std::vector< std::size_t > m_stack;
+	std::vector< std::size_t > m_next;
+	std::vector< T > m_work;
+};
+
+
+/**
+ * @internal
+ * Solves ( J^T J + lambda I ) x = b by jacobi-preconditioned conjugate gradients
+ * without forming J^T J.
+ * @return the number of iterations
+ */
+template< typename T, class VT >
+std::size_t conjugateGradientSolve( const SparseJacobian< T >& J, const T lambda, const VT& b, VT& x,
+	const std::size_t maxIterations, const T tolerance )
+{
+	namespace ublas = boost::numeric::ublas;
+	typedef typename Math::Vector< T >::base_type VecType;
+	const std::size_t n = J.size2();
+
+	// diagonal of J^T J + lambda I
+	VecType invDiag( ublas::scalar_vector< T >( n, lambda ) );
+	for ( std::size_t k = 0; k < J.nonZeros(); k++ )
+		invDiag( J.column( k ) ) += J.value( k ) * J.value( k );
+	for ( std::size_t j = 0; j < n; j++ )
+		invDiag( j ) = 1 / invDiag( j );
+
+	VecType r( b );
+	VecType z( ublas::element_prod( invDiag, r ) );
+	VecType p( z );
+	VecType Jp( J.size1() );
+	VecType Ap( n );
+	x = ublas::zero_vector< T >( n );
+
+	T rz = ublas::inner_prod( r, z );
+	const T stop = tolerance * tolerance * ublas::inner_prod( b, b );
+	std::size_t iteration = 0;
+	while ( iteration < maxIterations && ublas::inner_prod( r, r ) > stop )
+	{
+		J.multiply( p, Jp );
+		J.multiplyTransposed( Jp, Ap );
+		ublas::noalias( Ap ) += lambda * p;
+
+		const T alpha = rz / ublas::inner_prod( p, Ap );
+		ublas::noalias( x ) += alpha * p;
+		ublas::noalias( r ) -= alpha * Ap;
+		ublas::noalias( z ) = ublas::element_prod( invDiag, r );
+
+		const T rzNew = ublas::inner_prod( r, z );
+		p = z + ( rzNew / rz ) * p;
+		rz = rzNew;
+		++iteration;
+	}
+	return iteration;
+}
+
+
+/**
+ * @internal
+ * multiply sparse jacobian and difference with the square root of the weight matrix
+ * @return the weighted squared error
+ */
+template< class WFT, class VT, typename T, class WT >
+T applySparseLmWeights( const WFT& weightFunction, VT& measurementDiff, SparseJacobian< T >& jacobian, WT& weightVector )
+{
+	weightFunction.computeWeights( measurementDiff, weightVector );
+	for ( std::size_t i = 0; i < measurementDiff.size(); i++ )
+	{
+		const T w = sqrt( weightVector( i ) );
+		measurementDiff( i ) *= w;
+		jacobian.scaleRow( i, w );
+	}
+	return boost::numeric::ublas::inner_prod( measurementDiff, measurementDiff );
+}
+
+/** @internal scales rows of a sparse jacobian */
+template< typename T >
+struct SparseLmRowScaler
+{
+	SparseLmRowScaler( SparseJacobian< T >& jacobian )
+		: m_jacobian( jacobian )
+	{}
+
+	void operator()( const std::size_t i, const T w )
+	{ m_jacobian.scaleRow( i, w ); }
+
+	SparseJacobian< T >& m_jacobian;
+};
+
+/**
+ * @internal
+ * robust losses compute the weights and scale the residuals and jacobian in one pass
+ * @return the sum of the losses
+ */
+template< class Loss, class VT, typename T, class WT >
+T applySparseLmWeights( const RobustWeightFunction< Loss >& weightFunction, VT& measurementDiff, SparseJacobian< T >& jacobian, WT& weightVector )
+{
+	SparseLmRowScaler< T > scaler( jacobian );
+	return weightFunction.weightRows( measurementDiff, weightVector, scaler );
+}
+
+} // namespace Detail
+
+
+/**
+ * @ingroup math
+ * Optimize a problem with a sparse jacobian using the levenberg marquardt optimizer.
+ *
+ * Works like \c weightedLevenbergMarquardt, but the jacobian is a \c SparseJacobian and the
+ * normal equations are solved using a sparse cholesky decomposition in a fill-reducing
+ * ordering. The ordering and structure of the decomposition are computed in the first
+ * iteration and reused as long as the structure of the jacobian does not change. If the
+ * decomposition fails, the solver switches to conjugate gradients, which never forms
+ * J^T J and can also be selected directly for very large problems, on a CUDA device with
+ * \c sparseLmUseGpuConjugateGradient.
+ *
+ * @par The problem class
+ * The problem class P must implement \c size() and a function
+ * <tt>evaluateWithJacobian( result, params, SparseJacobian< T >& J )</tt>
+ * which computes the predicted measurement and fills the non-zero elements of the jacobian.
+ *
+ * @param problem the problem to optimize -- provides measurement estimates and jacobians
+ * @param params initial parameters on entry, optimized parameters on exit
+ * @param measurement the measurement vector
+ * @param terminationCriteria functor that returns true if the optimization should terminate. Is called with
+ *   bool operator()( unsigned iteration, double currentError, double previousError )
+ * @param normalize a UnaryFunction called after each iteration to normalize the result. Only needs to implement \c evaluate()
+ * @param weightFunction computes the weights of the measurements from the residuals
+ * @param solver sparse solver to use
+ * @return the residual of the optimization process
+ */
+template< class P, class X, class Y, class TC, class NT, class WFT >
+typename X::value_type weightedSparseLevenbergMarquardt( P& problem, X& params, const Y& measurement,
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(),
+	const WFT& weightFunction = OptNoWeightFunction(), SparseLmSolverType solver = sparseLmUseCholesky,
+	const typename X::value_type fStepSize = 1.0, const typename X::value_type fStepFactor = 10.0 )
+{
+	namespace ublas = boost::numeric::ublas;
+	typedef typename X::value_type T;
+	typedef typename Math::Vector< T >::base_type VecType;
+
+	const std::size_t n_meas = measurement.size();
+	const std::size_t n_params = params.size();
+
+	// create some matrices and vectors
+	SparseJacobian< T > jacobian( n_params );
+	SparseJacobian< T > jacobian2( n_params );
+	SparseJacobian< T >* pJacobian = &jacobian;
+	SparseJacobian< T >* pJacobian2 = &jacobian2;
+	VecType measurementDiff( n_meas );
+	VecType measurementDiff2( n_meas );
+	VecType* pMeasurementDiff = &measurementDiff;
+	VecType* pMeasurementDiff2 = &measurementDiff2;
+	VecType estimatedMeasurement( n_meas );
+	VecType weightVector( weightFunction.noWeights() ? 0 : n_meas );
+	VecType gradient( n_params );
+	VecType paramDiff( n_params );
+	VecType newParams( n_params );
+	Detail::SparseCholesky< T > cholesky;
+	Gpu::ConjugateGradientSolver gpuSolver;
+
+	// compute initial error
+	problem.evaluateWithJacobian( estimatedMeasurement, params, *pJacobian );
+	ublas::noalias( *pMeasurementDiff ) = measurement - estimatedMeasurement;
+
+	// multiply jacobian and difference with sqare root of weight matrix and compute the error
+	T fErrPrev = weightFunction.noWeights() ? ublas::inner_prod( *pMeasurementDiff, *pMeasurementDiff ) :
+		Detail::applySparseLmWeights( weightFunction, *pMeasurementDiff, *pJacobian, weightVector );
+	OPT_LOG_DEBUG( "Sparse Levenberg-Marquardt residual 0: " << fErrPrev );
+	const OptTelemetryRun telemetry( "Sparse Levenberg-Marquardt" );
+	telemetry.iteration( 0, fErrPrev );
+
+	// start optimization loop
+	T fLambda = T( fStepSize );
+	std::size_t iteration = 0;
+	bool bTerminate = false;
+	while ( !bTerminate )
+	{
+		++iteration;
+
+		// do one optimization step
+		pJacobian->multiplyTransposed( *pMeasurementDiff, gradient );
+		if ( solver == sparseLmUseCholesky )
+		{
+			if ( !cholesky.analyzed( *pJacobian ) )
+			{
+				cholesky.analyze( *pJacobian );
+				OPT_LOG_DEBUG( "Sparse cholesky factor has " << cholesky.factorNonZeros() << " non-zeros" );
+			}
+
+			if ( !cholesky.factorize( *pJacobian, fLambda ) )
+			{
+				OPT_LOG_DEBUG( "Error in sparse cholesky decomposition, switching to conjugate gradients" );
+				solver = sparseLmUseConjugateGradient;
+				continue;
+			}
+			ublas::noalias( paramDiff ) = gradient;
+			cholesky.solve( paramDiff );
+		}
+		else if ( solver == sparseLmUseGpuConjugateGradient )
+		{
+			// the device keeps the pattern of the jacobian, only the values are copied in each iteration
+			gpuSolver.setJacobian( *pJacobian );
+			const std::size_t nCG = gpuSolver.solve( fLambda, gradient, paramDiff,
+				std::max< std::size_t >( 2 * n_params, 20 ), T( 1e-10 ) );
+			OPT_LOG_DEBUG( "GPU conjugate gradient iterations: " << nCG );
+		}
+		else
+		{
+			const std::size_t nCG = Detail::conjugateGradientSolve( *pJacobian, fLambda, gradient, paramDiff, 
+				std::max< std::size_t >( 2 * n_params, 20 ), T( 1e-10 ) );
+			OPT_LOG_DEBUG( "Conjugate gradient iterations: " << nCG );
+		}
+
+		OPT_LOG_TRACE( "paramDiff: " << paramDiff );
+		ublas::noalias( newParams ) = params + paramDiff;
+
+		// normalize
+		normalize.evaluate( newParams, newParams );
+
+		// compute new error
+		problem.evaluateWithJacobian( estimatedMeasurement, newParams, *pJacobian2 );
+		ublas::noalias( *pMeasurementDiff2 ) = measurement - estimatedMeasurement;
+
+		// multiply jacobian and difference with square root of weight matrix and compute the error
+		const T fErr = weightFunction.noWeights() ? ublas::inner_prod( *pMeasurementDiff2, *pMeasurementDiff2 ) :
+			Detail::applySparseLmWeights( weightFunction, *pMeasurementDiff2, *pJacobian2, weightVector );
+		OPT_LOG_DEBUG( "Sparse Levenberg-Marquardt residual " << iteration << ": " << fErr );
+		telemetry.iteration( iteration, fErr, fLambda );
+
+		// check if we should terminate
+		bTerminate = terminationCriteria( iteration, fErr, fErrPrev );
+
+		// update parameters
+		if ( fErr >= fErrPrev )
+			fLambda *= T( fStepFactor );
+		else
+		{
+			fLambda /= T( fStepFactor );
+			ublas::noalias( params ) = newParams;
+
+			// swap measurementDiff and jacobian
+			std::swap( pMeasurementDiff, pMeasurementDiff2 );
+			std::swap( pJacobian, pJacobian2 );
+
+			fErrPrev = fErr;
+		}
+	}
+
+	return fErrPrev;
+}
+
+/**
+ * @ingroup math
+ * Same as \c weightedSparseLevenbergMarquardt above, without weights.
+ */
+template< class P, class X, class Y, class TC, class NT >
+typename X::value_type sparseLevenbergMarquardt( P& problem, X& params, const Y& measurement,
+	const TC& terminationCriteria, const NT& normalize = OptNoNormalize(),
+	SparseLmSolverType solver = sparseLmUseCholesky, const typename X::value_type stepSize = 1.0, const typename X::value_type stepFactor = 10.0 )
+{ return weightedSparseLevenbergMarquardt( problem, params, measurement, terminationCriteria, normalize, OptNoWeightFunction(), solver, stepSize, stepFactor ); }
+
+}}} // namespace Ubitrack::Math::Optimization
+
+#endif	// __UBITRACK_MATH_OPTIMIZATION_SPARSELEVENBERGMARQUARDT_INCLUDED__
@@ -0,0 +1,207 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Symmetric matrices stored as packed upper triangle.
+ *
+ * A covariance matrix is symmetric, so a 6x6 pose covariance only has 21 distinct
+ * elements instead of 36, and a 3x3 position covariance 6 instead of 9. Lists of poses
+ * or points with errors are dominated by their covariances, \c PackedCovariance stores
+ * only the upper triangle and may use \c float elements to halve the memory again:
+ * @code
+ * Math::PackedCovariance< float, 6 > packed( errorPose.covariance() );
+ * Math::Matrix< double, 6, 6 > full;
+ * packed.toMatrix( full );
+ * @endcode
+ *
+ * Element access by \c operator() works like for a \c Matrix, with both triangles.
+ * \c PackedErrorPose and \c PackedErrorVector use this storage.
+ */
+
+#ifndef __UBITRACK_MATH_PACKEDCOVARIANCE_H_INCLUDED__
+#define __UBITRACK_MATH_PACKEDCOVARIANCE_H_INCLUDED__
+
+#include "Matrix.h"
+
+#include <algorithm>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * Symmetric N-by-N matrix that stores the upper triangle row by row.
+ *
+ * @param T element type of the storage
+ * @param N number of rows and columns
+ */
+template< typename T, std::size_t N >
+class PackedCovariance
+{
+public:
+	typedef T value_type;
+
+	/** number of stored elements */
+	static const std::size_t packedSize = N * ( N + 1 ) / 2;
+
+	/** the elements are not initialized, like those of a \c Matrix */
+	PackedCovariance()
+	{}
+
+	/**
+	 * packs the upper triangle of a symmetric matrix, which may be a \c Matrix or a
+	 * \c PackedCovariance of another element type
+	 */
+	template< class MT >
+	explicit PackedCovariance( const MT& m )
+	{
+		T* p = m_data;
+		for ( std::size_t i = 0; i < N; i++ )
+			for ( std::size_t j = i; j < N; j++ )
+				*p++ = static_cast< T >( m( i, j ) );
+	}
+
+	/** position of element ( i, j ) with i <= j in the packed storage */
+	static std::size_t index( const std::size_t i, const std::size_t j )
+	{ return i * N - i * ( i - 1 ) / 2 + j - i; }
+
+	/** element ( i, j ) of the full matrix */
+	T operator()( const std::size_t i, const std::size_t j ) const
+	{ return i <= j ? m_data[ index( i, j ) ] : m_data[ index( j, i ) ]; }
+
+	/** sets element ( i, j ) and ( j, i ) of the full matrix */
+	void set( const std::size_t i, const std::size_t j, const T v )
+	{ m_data[ i <= j ? index( i, j ) : index( j, i ) ] = v; }
+
+	/** unpacks into a full matrix, converting the elements */
+	template< typename U >
+	void toMatrix( Matrix< U, N, N >& m ) const
+	{
+		const T* p = m_data;
+		for ( std::size_t i = 0; i < N; i++ )
+			for ( std::size_t j = i; j < N; j++ )
+				m( i, j ) = m( j, i ) = static_cast< U >( *p++ );
+	}
+
+	/** the full matrix */
+	Matrix< T, N, N > matrix() const
+	{
+		Matrix< T, N, N > m;
+		toMatrix( m );
+		return m;
+	}
+
+	/** sets all elements to 0 */
+	void clear()
+	{ std::fill( m_data, m_data + packedSize, T( 0 ) ); }
+
+	/** the packed upper triangle, \c packedSize elements */
+	T* data()
+	{ return m_data; }
+
+	const T* data() const
+	{ return m_data; }
+
+	/**
+	 * (un-)serialization helper function
+	 */
+	template< class Archive >
+	void serialize( Archive& ar, const unsigned int )
+	{
+		for ( std::size_t i = 0; i < packedSize; i++ )
+			ar & m_data[ i ];
+	}
+
+protected:
+	T m_data[ packedSize ];
+};
+
+template< typename T, std::size_t N >
+const std::size_t PackedCovariance< T, N >::packedSize;
+
+
+/**
+ * Computes <tt>result = J * C * J^T</tt> for a packed symmetric \c C. Every element of \c C
+ * is read once and only the upper triangle of the result is computed, in the element
+ * type of the jacobian.
+ */
+template< typename T, typename U, std::size_t M, std::size_t N >
+void symmetricTransform( PackedCovariance< T, M >& result, const Matrix< U, M, N >& J, const PackedCovariance< T, N >& C )
+{
+	// jc = J * C, each off-diagonal element contributes to two columns
+	U jc[ M ][ N ];
+	for ( std::size_t i = 0; i < M; i++ )
+		for ( std::size_t k = 0; k < N; k++ )
+			jc[ i ][ k ] = 0;
+
+	const T* c = C.data();
+	for ( std::size_t l = 0; l < N; l++ )
+	{
+		const U diagonal( *c++ );
+		for ( std::size_t i = 0; i < M; i++ )
+			jc[ i ][ l ] += J( i, l ) * diagonal;
+		for ( std::size_t k = l + 1; k < N; k++ )
+		{
+			const U v( *c++ );
+			for ( std::size_t i = 0; i < M; i++ )
+			{
+				jc[ i ][ k ] += J( i, l ) * v;
+				jc[ i ][ l ] += J( i, k ) * v;
+			}
+		}
+	}
+
+	T* r = result.data();
+	for ( std::size_t i = 0; i < M; i++ )
+		for ( std::size_t j = i; j < M; j++ )
+		{
+			U s( 0 );
+			for ( std::size_t k = 0; k < N; k++ )
+				s += jc[ i ][ k ] * J( j, k );
+			*r++ = static_cast< T >( s );
+		}
+}
+
+
+/** computes <tt>result += J * C * J^T</tt>, see \c symmetricTransform */
+template< typename T, typename U, std::size_t M, std::size_t N >
+void addSymmetricTransform( PackedCovariance< T, M >& result, const Matrix< U, M, N >& J, const PackedCovariance< T, N >& C )
+{
+	PackedCovariance< T, M > product;
+	symmetricTransform( product, J, C );
+	for ( std::size_t i = 0; i < PackedCovariance< T, M >::packedSize; i++ )
+		result.data()[ i ] += product.data()[ i ];
+}
+
+
+/// @internal stream output operator
+template< typename T, std::size_t N >
+std::ostream& operator<<( std::ostream& s, const PackedCovariance< T, N >& c )
+{
+	s << c.matrix();
+	return s;
+}
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_PACKEDCOVARIANCE_H_INCLUDED__
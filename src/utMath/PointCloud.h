@@ -0,0 +1,272 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Point lists with one contiguous array per coordinate
+ *
+ * A \c std::vector< Math::Vector< T, N > > stores every point as a uBLAS vector of its own, so
+ * its coordinates cannot be passed to SIMD kernels or other libraries without copying.
+ * A \c PointCloud< T, N > keeps the points as structure of arrays: \c data( 0 ) points to
+ * all x coordinates, \c data( 1 ) to all y coordinates and so on.
+ * @code
+ * Math::PointCloud< double, 3 > cloud( points3d );   // from std::vector< Math::Vector3d >
+ * Math::Geometry::project_points( P, cloud, image ); // SIMD kernels of PointBatch.h
+ * std::vector< Math::Vector2d > points2d;
+ * image.toVectors( points2d );
+ * @endcode
+ *
+ * The iterators of a cloud return the points as \c Math::Vector by value, so the iterator
+ * based algorithms, e.g. \c k_means or the absolute orientation, work on clouds without a
+ * conversion. Points cannot be modified through the iterators, use \c set or the arrays.
+ */
+
+#ifndef __UBITRACK_MATH_POINTCLOUD_H_INCLUDED__
+#define __UBITRACK_MATH_POINTCLOUD_H_INCLUDED__
+
+#include "Vector.h"
+
+#include <vector>
+#include <cstddef>
+#include <iterator>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * Random access iterator over a container of points that returns the points by value,
+ * using the \c operator[] of the container. Used by \c PointCloud and \c PointView.
+ */
+template< class Points >
+class PointIndexIterator
+	: public std::iterator< std::random_access_iterator_tag, typename Points::value_type, std::ptrdiff_t
+		, const typename Points::value_type*, typename Points::value_type >
+{
+public:
+	typedef typename Points::value_type value_type;
+
+	PointIndexIterator()
+		: m_points( 0 ), m_index( 0 )
+	{}
+
+	PointIndexIterator( const Points* points, const std::size_t index )
+		: m_points( points ), m_index( index )
+	{}
+
+	value_type operator*() const
+	{ return ( *m_points )[ m_index ]; }
+
+	value_type operator[]( const std::ptrdiff_t n ) const
+	{ return ( *m_points )[ m_index + n ]; }
+
+	PointIndexIterator& operator++()
+	{ ++m_index; return *this; }
+
+	PointIndexIterator operator++( int )
+	{ PointIndexIterator old( *this ); ++m_index; return old; }
+
+	PointIndexIterator& operator--()
+	{ --m_index; return *this; }
+
+	PointIndexIterator operator--( int )
+	{ PointIndexIterator old( *this ); --m_index; return old; }
+
+	PointIndexIterator& operator+=( const std::ptrdiff_t n )
+	{ m_index += n; return *this; }
+
+	PointIndexIterator& operator-=( const std::ptrdiff_t n )
+	{ m_index -= n; return *this; }
+
+	PointIndexIterator operator+( const std::ptrdiff_t n ) const
+	{ return PointIndexIterator( m_points, m_index + n ); }
+
+	PointIndexIterator operator-( const std::ptrdiff_t n ) const
+	{ return PointIndexIterator( m_points, m_index - n ); }
+
+	std::ptrdiff_t operator-( const PointIndexIterator& other ) const
+	{ return static_cast< std::ptrdiff_t >( m_index ) - static_cast< std::ptrdiff_t >( other.m_index ); }
+
+	bool operator==( const PointIndexIterator& other ) const
+	{ return m_index == other.m_index; }
+
+	bool operator!=( const PointIndexIterator& other ) const
+	{ return m_index != other.m_index; }
+
+	bool operator<( const PointIndexIterator& other ) const
+	{ return m_index < other.m_index; }
+
+	bool operator>( const PointIndexIterator& other ) const
+	{ return m_index > other.m_index; }
+
+	bool operator<=( const PointIndexIterator& other ) const
+	{ return m_index <= other.m_index; }
+
+	bool operator>=( const PointIndexIterator& other ) const
+	{ return m_index >= other.m_index; }
+
+	/** index of the point in the container */
+	std::size_t index() const
+	{ return m_index; }
+
+protected:
+	const Points* m_points;
+	std::size_t m_index;
+};
+
+
+/**
+ * @ingroup math
+ * List of \c N dimensional points stored as \c N arrays of coordinates.
+ *
+ * @tparam T builtin type of the coordinates (e.g \c double or \c float )
+ * @tparam N dimension of the points
+ */
+template< typename T, std::size_t N >
+class PointCloud
+{
+public:
+	typedef Math::Vector< T, N > value_type;
+	typedef T coordinate_type;
+	typedef std::size_t size_type;
+	static const std::size_t dimension = N;
+
+	typedef PointIndexIterator< PointCloud > const_iterator;
+
+	/** empty cloud */
+	PointCloud()
+	{}
+
+	/** cloud of \c n points at the origin */
+	explicit PointCloud( const size_type n )
+	{ resize( n ); }
+
+	/** copies a list of points */
+	explicit PointCloud( const std::vector< value_type >& points )
+	{ assign( points.begin(), points.end() ); }
+
+	/** copies the points of the range [ iBegin, iEnd ) */
+	template< typename InputIterator >
+	PointCloud( const InputIterator iBegin, const InputIterator iEnd )
+	{ assign( iBegin, iEnd ); }
+
+	/** replaces the points with those of the range [ iBegin, iEnd ) */
+	template< typename InputIterator >
+	void assign( InputIterator iBegin, const InputIterator iEnd )
+	{
+		clear();
+		for ( ; iBegin != iEnd; ++iBegin )
+			push_back( *iBegin );
+	}
+
+	/** copies the points into a list of vectors */
+	void toVectors( std::vector< value_type >& points ) const
+	{
+		points.resize( size() );
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			for ( std::size_t c = 0; c < N; c++ )
+				points[ i ]( c ) = m_coords[ c ][ i ];
+	}
+
+	/** number of points */
+	size_type size() const
+	{ return m_coords[ 0 ].size(); }
+
+	bool empty() const
+	{ return m_coords[ 0 ].empty(); }
+
+	/** changes the number of points, new points are at the origin */
+	void resize( const size_type n )
+	{
+		for ( std::size_t c = 0; c < N; c++ )
+			m_coords[ c ].resize( n, T( 0 ) );
+	}
+
+	void reserve( const size_type n )
+	{
+		for ( std::size_t c = 0; c < N; c++ )
+			m_coords[ c ].reserve( n );
+	}
+
+	void clear()
+	{
+		for ( std::size_t c = 0; c < N; c++ )
+			m_coords[ c ].clear();
+	}
+
+	/** appends a point */
+	void push_back( const value_type& p )
+	{
+		for ( std::size_t c = 0; c < N; c++ )
+			m_coords[ c ].push_back( p( c ) );
+	}
+
+	/** returns point \c i */
+	value_type operator[]( const size_type i ) const
+	{
+		value_type p;
+		for ( std::size_t c = 0; c < N; c++ )
+			p( c ) = m_coords[ c ][ i ];
+		return p;
+	}
+
+	/** replaces point \c i */
+	void set( const size_type i, const value_type& p )
+	{
+		for ( std::size_t c = 0; c < N; c++ )
+			m_coords[ c ][ i ] = p( c );
+	}
+
+	/** coordinate \c c of point \c i */
+	T& operator()( const size_type i, const std::size_t c )
+	{ return m_coords[ c ][ i ]; }
+
+	const T& operator()( const size_type i, const std::size_t c ) const
+	{ return m_coords[ c ][ i ]; }
+
+	/** the contiguous array of coordinate \c c of all points, 0 if the cloud is empty */
+	T* data( const std::size_t c )
+	{ return m_coords[ c ].empty() ? 0 : &m_coords[ c ][ 0 ]; }
+
+	const T* data( const std::size_t c ) const
+	{ return m_coords[ c ].empty() ? 0 : &m_coords[ c ][ 0 ]; }
+
+	const_iterator begin() const
+	{ return const_iterator( this, 0 ); }
+
+	const_iterator end() const
+	{ return const_iterator( this, size() ); }
+
+protected:
+	std::vector< T > m_coords[ N ];
+};
+
+typedef PointCloud< double, 2 > PointCloud2d;
+typedef PointCloud< double, 3 > PointCloud3d;
+typedef PointCloud< float, 2 > PointCloud2f;
+typedef PointCloud< float, 3 > PointCloud3f;
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_POINTCLOUD_H_INCLUDED__
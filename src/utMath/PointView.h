@@ -0,0 +1,180 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Views on points in buffers of other libraries
+ *
+ * A \c PointView< T, N > reads \c N dimensional points from a buffer that is owned by
+ * someone else, e.g. a \c std::vector< cv::Point2f > or an \c Eigen::Matrix3Xd, without
+ * copying them. Coordinate \c c of point \c i is read from
+ * <tt>data[ i * pointStride + c * coordStride ]</tt>, with both strides counted in elements:
+ * @code
+ * std::vector< cv::Point2f > corners;         // x, y, x, y, ...
+ * Math::PointView2f image( &corners[ 0 ].x, corners.size() );
+ *
+ * Eigen::Matrix3Xd model;                     // column major, one point per column
+ * Math::PointView3d object( model.data(), model.cols() );
+ *
+ * Eigen::Matrix< double, Eigen::Dynamic, 3 > rows; // column major, one point per row
+ * Math::PointView3d object2( rows.data(), rows.rows(), 1, rows.rows() );
+ * @endcode
+ * The iterators return the points as \c Math::Vector by value, like those of
+ * \c Math::PointCloud. The buffer must stay valid while the view is used.
+ *
+ * \c storePose writes a pose as homogeneous matrix into such a buffer.
+ */
+
+#ifndef __UBITRACK_MATH_POINTVIEW_H_INCLUDED__
+#define __UBITRACK_MATH_POINTVIEW_H_INCLUDED__
+
+#include "Vector.h"
+#include "Matrix.h"
+#include "Pose.h"
+#include "PointCloud.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * Read-only view on \c N dimensional points in a strided buffer.
+ *
+ * @tparam T builtin type of the coordinates (e.g \c double or \c float )
+ * @tparam N dimension of the points
+ */
+template< typename T, std::size_t N >
+class PointView
+{
+public:
+	typedef Math::Vector< T, N > value_type;
+	typedef T coordinate_type;
+	typedef std::size_t size_type;
+	typedef PointIndexIterator< PointView > const_iterator;
+	static const std::size_t dimension = N;
+
+	/** empty view */
+	PointView()
+		: m_data( 0 ), m_size( 0 ), m_pointStride( N ), m_coordStride( 1 )
+	{}
+
+	/**
+	 * @param data first coordinate of the first point
+	 * @param size number of points
+	 * @param pointStride distance between two points, in elements of \c T
+	 * @param coordStride distance between two coordinates of a point, in elements of \c T
+	 */
+	PointView( const T* data, const size_type size, const std::ptrdiff_t pointStride = N, const std::ptrdiff_t coordStride = 1 )
+		: m_data( data ), m_size( size ), m_pointStride( pointStride ), m_coordStride( coordStride )
+	{}
+
+	/** view on a list of vectors, the coordinates are stored in the vectors themselves */
+	explicit PointView( const std::vector< value_type >& points )
+		: m_data( points.empty() ? 0 : &points[ 0 ]( 0 ) )
+		, m_size( points.size() )
+		, m_pointStride( points.size() > 1 ? &points[ 1 ]( 0 ) - &points[ 0 ]( 0 ) : std::ptrdiff_t( N ) )
+		, m_coordStride( 1 )
+	{}
+
+	size_type size() const
+	{ return m_size; }
+
+	bool empty() const
+	{ return m_size == 0; }
+
+	/** returns point \c i */
+	value_type operator[]( const size_type i ) const
+	{
+		value_type p;
+		const T* point = m_data + i * m_pointStride;
+		for ( std::size_t c = 0; c < N; c++ )
+			p( c ) = point[ c * m_coordStride ];
+		return p;
+	}
+
+	/** coordinate \c c of point \c i */
+	const T& operator()( const size_type i, const std::size_t c ) const
+	{ return m_data[ i * m_pointStride + c * m_coordStride ]; }
+
+	const_iterator begin() const
+	{ return const_iterator( this, 0 ); }
+
+	const_iterator end() const
+	{ return const_iterator( this, m_size ); }
+
+protected:
+	const T* m_data;
+	size_type m_size;
+	std::ptrdiff_t m_pointStride;
+	std::ptrdiff_t m_coordStride;
+};
+
+typedef PointView< double, 2 > PointView2d;
+typedef PointView< double, 3 > PointView3d;
+typedef PointView< float, 2 > PointView2f;
+typedef PointView< float, 3 > PointView3f;
+
+
+/**
+ * @ingroup math
+ * Writes a pose as homogeneous transformation matrix into a buffer of another library.
+ * Element ( r, c ) is written to <tt>data[ r * rowStride + c * colStride ]</tt>.
+ *
+ * @code
+ * cv::Matx44d m;
+ * Math::storePose( pose, m.val );                    // row major 4x4
+ * Eigen::Matrix4d e;
+ * Math::storePose( pose, e.data(), 1, 4 );           // column major 4x4
+ * double rt[ 12 ];
+ * Math::storePose( pose, rt, 4, 1, 3 );              // row major 3x4 [R|t]
+ * @endcode
+ *
+ * @param pose the pose
+ * @param data element ( 0, 0 ) of the matrix
+ * @param rowStride distance between two rows, in elements of \c T
+ * @param colStride distance between two columns, in elements of \c T
+ * @param rows 4 for the full matrix, 3 for [R|t] only
+ */
+template< typename T >
+void storePose( const Math::Pose& pose, T* data, const std::ptrdiff_t rowStride = 4, const std::ptrdiff_t colStride = 1, const std::size_t rows = 4 )
+{
+	Math::Matrix< double, 3, 3 > rotation;
+	pose.rotation().toMatrix( rotation );
+	for ( std::size_t r = 0; r < 3; r++ )
+	{
+		for ( std::size_t c = 0; c < 3; c++ )
+			data[ r * rowStride + c * colStride ] = static_cast< T >( rotation( r, c ) );
+		data[ r * rowStride + 3 * colStride ] = static_cast< T >( pose.translation()( r ) );
+	}
+	if ( rows > 3 )
+		for ( std::size_t c = 0; c < 4; c++ )
+			data[ 3 * rowStride + c * colStride ] = T( c == 3 ? 1 : 0 );
+}
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_POINTVIEW_H_INCLUDED__
@@ -23,6 +23,8 @@
 
 
 #include "Pose.h"
+#include "PoseOperations.h"
+#include "PoseListOperations.h"
 #include "Matrix.h"
 
 namespace Ubitrack { namespace Math {
@@ -39,21 +41,23 @@ Pose::Pose( const Matrix< double, 0, 0 >& mat )
 
 Pose Pose::operator~( ) const
 {
-	Quaternion rinv( ~(m_rotation) );
-	return Pose( rinv, -( rinv * m_translation ) );
+	Pose result;
+	invert( *this, result );
+	return result;
 }
 
 Pose Pose::operator*( const Pose& Q ) const
 {
-	return Pose(
-		  m_rotation * Q.rotation(),
-		( m_rotation * Q.translation() ) + m_translation
-	);
+	Pose result;
+	multiply( *this, Q, result );
+	return result;
 }
 
 Vector< double, 3 > Pose::operator*( const Vector< double, 3 >& x ) const
 {
-	return Vector< double, 3 >( ( m_rotation * x ) + m_translation );
+	Vector< double, 3 > result;
+	transform( *this, x, result );
+	return result;
 }
 
 bool Pose::operator==( const Pose& other ) const
@@ -96,13 +100,8 @@ std::ostream& operator<<( std::ostream& s, const std::vector<Pose>& p )
 
 std::vector<Pose> linearInterpolate ( const std::vector<Pose>& x, const std::vector<Pose>& y, double t )
 {
-	std::vector<Pose> result(x.size());
-	for (unsigned int i=0; i<x.size(); i++) {
-		result[i] = Pose( 
-			slerp( x[i].rotation(), y[i].rotation(), t ), 
-			linearInterpolate( x[i].translation(), y[i].translation(), t ) 
-			);
-	}
+	std::vector<Pose> result;
+	interpolatePoseList( x, y, t, result );
 	return result;
 }
 
@@ -221,7 +221,7 @@ UBITRACK_EXPORT std::ostream& operator<<( std::ostream& s, const std::vector<Pos
 
 /**
  * performs a linear interpolation between two lists of poses
- * using SLERP and vector interpolation
+ * using SLERP and vector interpolation, see \c interpolatePoseList
  * @param x first pose-list
  * @param y second pose-list
  * @param t interpolation point between 0.0 and 1.0
@@ -0,0 +1,810 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+#include "PoseListOperations.h"
+#include "Util/simd_traits.h"
+
+#include <utUtil/Exception.h>
+
+#include <cmath>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace Ubitrack { namespace Math {
+
+namespace {
+
+typedef boost::function< void ( std::size_t, std::size_t ) > RangeTask;
+
+/// @internal number of elements unpacked at once, small enough to stay in the L1 cache
+static const std::size_t blockSize = 256;
+
+/// @internal executor state created by threadExecutor
+struct ThreadExecutor
+{
+	std::size_t nThreads;
+	std::size_t minChunk;
+
+	void operator()( const std::size_t n, const RangeTask& task ) const
+	{
+		const std::size_t nRanges = std::min( nThreads, std::max< std::size_t >( 1, n / minChunk ) );
+		if ( nRanges <= 1 )
+		{
+			task( 0, n );
+			return;
+		}
+
+		// the calling thread computes the last range itself
+		boost::thread_group threads;
+		const std::size_t step = ( n + nRanges - 1 ) / nRanges;
+		std::size_t begin = 0;
+		for ( ; begin + step < n; begin += step )
+			threads.create_thread( boost::bind( task, begin, begin + step ) );
+		task( begin, n );
+		threads.join_all();
+	}
+};
+
+/// @internal executor state created by poolExecutor
+struct PoolExecutor
+{
+	Ubitrack::Util::Executor* executor;
+	std::size_t grain;
+
+	void operator()( const std::size_t n, const RangeTask& task ) const
+	{
+		executor->parallelFor( 0, n, grain, task );
+	}
+};
+
+/// @internal executor state created by nodeExecutor
+struct NodeExecutor
+{
+	Ubitrack::Util::Executor* executor;
+	std::size_t grain;
+
+	void operator()( const std::size_t n, const RangeTask& task ) const
+	{
+		executor->parallelForNodes( 0, n, grain, task );
+	}
+};
+
+/// @internal runs the task with the executor, or sequentially if there is none
+void run( const ListExecutor& executor, const std::size_t n, const RangeTask& task )
+{
+	if ( n == 0 )
+		return;
+	if ( executor.empty() )
+		task( 0, n );
+	else
+		executor( n, task );
+}
+
+/// @internal a block of poses as structure of arrays
+struct PoseBlock
+{
+	double qx[ blockSize ], qy[ blockSize ], qz[ blockSize ], qw[ blockSize ];
+	double tx[ blockSize ], ty[ blockSize ], tz[ blockSize ];
+
+	void load( const Pose* p, const std::size_t n )
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Quaternion& q( p[ i ].rotation() );
+			const Vector< double, 3 >& t( p[ i ].translation() );
+			qx[ i ] = q.x(); qy[ i ] = q.y(); qz[ i ] = q.z(); qw[ i ] = q.w();
+			tx[ i ] = t( 0 ); ty[ i ] = t( 1 ); tz[ i ] = t( 2 );
+		}
+	}
+
+	void store( Pose* p, const std::size_t n ) const
+	{
+		for ( std::size_t i = 0; i < n; i++ )
+			p[ i ] = Pose( Quaternion( qx[ i ], qy[ i ], qz[ i ], qw[ i ] ), Vector< double, 3 >( tx[ i ], ty[ i ], tz[ i ] ) );
+	}
+};
+
+/// @internal components and rotation matrix of a constant pose, broadcast to packs
+template< class Pack >
+struct PoseCoefficients
+{
+	typedef typename Pack::type pack_type;
+	pack_type qx, qy, qz, qw;
+	pack_type r[ 3 ][ 3 ];
+	pack_type t[ 3 ];
+
+	explicit PoseCoefficients( const Pose& p )
+	{
+		const Quaternion& q( p.rotation() );
+		const double x = q.x(), y = q.y(), z = q.z(), w = q.w();
+		qx = Pack::set1( x ); qy = Pack::set1( y ); qz = Pack::set1( z ); qw = Pack::set1( w );
+
+		// same terms as Quaternion::toMatrix
+		const double m[ 3 ][ 3 ] = {
+			{ 1 - 2 * ( y * y + z * z ), 2 * ( x * y - z * w ), 2 * ( x * z + y * w ) },
+			{ 2 * ( x * y + z * w ), 1 - 2 * ( x * x + z * z ), 2 * ( y * z - x * w ) },
+			{ 2 * ( x * z - y * w ), 2 * ( y * z + x * w ), 1 - 2 * ( x * x + y * y ) } };
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			for ( std::size_t j = 0; j < 3; j++ )
+				r[ i ][ j ] = Pack::set1( m[ i ][ j ] );
+			t[ i ] = Pack::set1( p.translation()( i ) );
+		}
+	}
+
+	/// y = R * x + t
+	void apply( const pack_type x, const pack_type y, const pack_type z, pack_type (&out)[ 3 ] ) const
+	{
+		for ( std::size_t i = 0; i < 3; i++ )
+			out[ i ] = Pack::add( Pack::add( Pack::add( Pack::mul( r[ i ][ 0 ], x ), Pack::mul( r[ i ][ 1 ], y ) ), Pack::mul( r[ i ][ 2 ], z ) ), t[ i ] );
+	}
+};
+
+/// @internal a * b - c * d
+template< class Pack >
+inline typename Pack::type mulSub( const typename Pack::type a, const typename Pack::type b
+	, const typename Pack::type c, const typename Pack::type d )
+{ return Pack::sub( Pack::mul( a, b ), Pack::mul( c, d ) ); }
+
+/// @internal Hamilton product of the rotations ( aw, ax, ay, az ) * ( bw, bx, by, bz )
+template< class Pack >
+inline void quaternionProduct( const typename Pack::type aw, const typename Pack::type ax, const typename Pack::type ay, const typename Pack::type az
+	, const typename Pack::type bw, const typename Pack::type bx, const typename Pack::type by, const typename Pack::type bz
+	, typename Pack::type (&r)[ 4 ] )
+{
+	r[ 0 ] = Pack::sub( mulSub< Pack >( aw, bw, ax, bx ), Pack::add( Pack::mul( ay, by ), Pack::mul( az, bz ) ) );
+	r[ 1 ] = Pack::add( Pack::add( Pack::mul( aw, bx ), Pack::mul( ax, bw ) ), mulSub< Pack >( ay, bz, az, by ) );
+	r[ 2 ] = Pack::add( Pack::add( Pack::mul( aw, by ), Pack::mul( ay, bw ) ), mulSub< Pack >( az, bx, ax, bz ) );
+	r[ 3 ] = Pack::add( Pack::add( Pack::mul( aw, bz ), Pack::mul( az, bw ) ), mulSub< Pack >( ax, by, ay, bx ) );
+}
+
+/// @internal rotates v by the unit quaternion ( w, u ) as v + 2w (u x v) + 2 u x (u x v)
+template< class Pack >
+inline void rotate( const typename Pack::type w, const typename Pack::type ux, const typename Pack::type uy, const typename Pack::type uz
+	, const typename Pack::type vx, const typename Pack::type vy, const typename Pack::type vz, typename Pack::type (&r)[ 3 ] )
+{
+	const typename Pack::type two = Pack::set1( 2 );
+	const typename Pack::type cx = Pack::mul( two, mulSub< Pack >( uy, vz, uz, vy ) );
+	const typename Pack::type cy = Pack::mul( two, mulSub< Pack >( uz, vx, ux, vz ) );
+	const typename Pack::type cz = Pack::mul( two, mulSub< Pack >( ux, vy, uy, vx ) );
+	r[ 0 ] = Pack::add( Pack::add( vx, Pack::mul( w, cx ) ), mulSub< Pack >( uy, cz, uz, cy ) );
+	r[ 1 ] = Pack::add( Pack::add( vy, Pack::mul( w, cy ) ), mulSub< Pack >( uz, cx, ux, cz ) );
+	r[ 2 ] = Pack::add( Pack::add( vz, Pack::mul( w, cz ) ), mulSub< Pack >( ux, cy, uy, cx ) );
+}
+
+/// @internal block = a * block
+template< class Pack >
+std::size_t multiplyLeft( const PoseCoefficients< Pack >& a, std::size_t i, const std::size_t n, PoseBlock& b )
+{
+	typedef typename Pack::type pack_type;
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		pack_type q[ 4 ], t[ 3 ];
+		quaternionProduct< Pack >( a.qw, a.qx, a.qy, a.qz
+			, Pack::load( b.qw + i ), Pack::load( b.qx + i ), Pack::load( b.qy + i ), Pack::load( b.qz + i ), q );
+		a.apply( Pack::load( b.tx + i ), Pack::load( b.ty + i ), Pack::load( b.tz + i ), t );
+		Pack::store( b.qw + i, q[ 0 ] ); Pack::store( b.qx + i, q[ 1 ] ); Pack::store( b.qy + i, q[ 2 ] ); Pack::store( b.qz + i, q[ 3 ] );
+		Pack::store( b.tx + i, t[ 0 ] ); Pack::store( b.ty + i, t[ 1 ] ); Pack::store( b.tz + i, t[ 2 ] );
+	}
+	return i;
+}
+
+/// @internal block = block * a
+template< class Pack >
+std::size_t multiplyRight( const PoseCoefficients< Pack >& a, std::size_t i, const std::size_t n, PoseBlock& b )
+{
+	typedef typename Pack::type pack_type;
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type w = Pack::load( b.qw + i ), x = Pack::load( b.qx + i ), y = Pack::load( b.qy + i ), z = Pack::load( b.qz + i );
+		pack_type q[ 4 ], t[ 3 ];
+		quaternionProduct< Pack >( w, x, y, z, a.qw, a.qx, a.qy, a.qz, q );
+		rotate< Pack >( w, x, y, z, a.t[ 0 ], a.t[ 1 ], a.t[ 2 ], t );
+		Pack::store( b.qw + i, q[ 0 ] ); Pack::store( b.qx + i, q[ 1 ] ); Pack::store( b.qy + i, q[ 2 ] ); Pack::store( b.qz + i, q[ 3 ] );
+		Pack::store( b.tx + i, Pack::add( t[ 0 ], Pack::load( b.tx + i ) ) );
+		Pack::store( b.ty + i, Pack::add( t[ 1 ], Pack::load( b.ty + i ) ) );
+		Pack::store( b.tz + i, Pack::add( t[ 2 ], Pack::load( b.tz + i ) ) );
+	}
+	return i;
+}
+
+/// @internal block = ~block
+template< class Pack >
+std::size_t invert( std::size_t i, const std::size_t n, PoseBlock& b )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type zero = Pack::set1( 0 );
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type w = Pack::load( b.qw + i );
+		const pack_type x = Pack::sub( zero, Pack::load( b.qx + i ) );
+		const pack_type y = Pack::sub( zero, Pack::load( b.qy + i ) );
+		const pack_type z = Pack::sub( zero, Pack::load( b.qz + i ) );
+		pack_type t[ 3 ];
+		rotate< Pack >( w, x, y, z, Pack::load( b.tx + i ), Pack::load( b.ty + i ), Pack::load( b.tz + i ), t );
+		Pack::store( b.qx + i, x ); Pack::store( b.qy + i, y ); Pack::store( b.qz + i, z );
+		Pack::store( b.tx + i, Pack::sub( zero, t[ 0 ] ) );
+		Pack::store( b.ty + i, Pack::sub( zero, t[ 1 ] ) );
+		Pack::store( b.tz + i, Pack::sub( zero, t[ 2 ] ) );
+	}
+	return i;
+}
+
+/// @internal d = | a - b | for components given as structure of arrays
+template< class Pack >
+std::size_t distance( std::size_t i, const std::size_t n, const double* const (&a)[ 3 ], const double* const (&b)[ 3 ], double* d )
+{
+	typedef typename Pack::type pack_type;
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type dx = Pack::sub( Pack::load( a[ 0 ] + i ), Pack::load( b[ 0 ] + i ) );
+		const pack_type dy = Pack::sub( Pack::load( a[ 1 ] + i ), Pack::load( b[ 1 ] + i ) );
+		const pack_type dz = Pack::sub( Pack::load( a[ 2 ] + i ), Pack::load( b[ 2 ] + i ) );
+		Pack::store( d + i, Pack::sqrt( Pack::add( Pack::add( Pack::mul( dx, dx ), Pack::mul( dy, dy ) ), Pack::mul( dz, dz ) ) ) );
+	}
+	return i;
+}
+
+
+/// @internal range task applying a pose to a part of a list
+struct MultiplyTask
+{
+	const PoseCoefficients< Util::simd_pack< double > > packed;
+	const PoseCoefficients< Util::simd_scalar< double > > scalar;
+	const bool bLeft;
+	const Pose* in;
+	Pose* out;
+
+	MultiplyTask( const Pose& p, const bool left, const Pose* i, Pose* o )
+		: packed( p ), scalar( p ), bLeft( left ), in( i ), out( o )
+	{}
+
+	void operator()( const std::size_t begin, const std::size_t end ) const
+	{
+		PoseBlock block;
+		for ( std::size_t b = begin; b < end; b += blockSize )
+		{
+			const std::size_t n = std::min( blockSize, end - b );
+			block.load( in + b, n );
+			if ( bLeft )
+				multiplyLeft( scalar, multiplyLeft( packed, 0, n, block ), n, block );
+			else
+				multiplyRight( scalar, multiplyRight( packed, 0, n, block ), n, block );
+			block.store( out + b, n );
+		}
+	}
+};
+
+void invertRange( const Pose* in, Pose* out, const std::size_t begin, const std::size_t end )
+{
+	PoseBlock block;
+	for ( std::size_t b = begin; b < end; b += blockSize )
+	{
+		const std::size_t n = std::min( blockSize, end - b );
+		block.load( in + b, n );
+		invert< Util::simd_scalar< double > >( invert< Util::simd_pack< double > >( 0, n, block ), n, block );
+		block.store( out + b, n );
+	}
+}
+
+/// @internal two blocks of rotations and their weights in the interpolation
+struct InterpolationBlock
+{
+	double ax[ blockSize ], ay[ blockSize ], az[ blockSize ], aw[ blockSize ];
+	double bx[ blockSize ], by[ blockSize ], bz[ blockSize ], bw[ blockSize ];
+	double wa[ blockSize ], wb[ blockSize ];
+
+	void set( const std::size_t i, const Quaternion& a, const Quaternion& b )
+	{
+		ax[ i ] = a.x(); ay[ i ] = a.y(); az[ i ] = a.z(); aw[ i ] = a.w();
+		bx[ i ] = b.x(); by[ i ] = b.y(); bz[ i ] = b.z(); bw[ i ] = b.w();
+	}
+
+	Quaternion get( const std::size_t i ) const
+	{ return Quaternion( ax[ i ], ay[ i ], az[ i ], aw[ i ] ); }
+
+	double dot( const std::size_t i ) const
+	{ return ax[ i ] * bx[ i ] + ay[ i ] * by[ i ] + az[ i ] * bz[ i ] + aw[ i ] * bw[ i ]; }
+};
+
+/**
+ * @internal block weights as computed by slerp. The first rotation is negated on the longer
+ * path by the sign of its weight, close rotations are interpolated linearly.
+ */
+void slerpWeights( const double t, const std::size_t n, InterpolationBlock& b )
+{
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const double d = b.dot( i );
+		const double s = d < 0 ? -1 : 1;
+		const double c = s * d;
+		if ( c > 0.9999 )
+		{
+			b.wa[ i ] = s * ( 1.0 - t );
+			b.wb[ i ] = t;
+		}
+		else
+		{
+			const double omega = std::acos( c );
+			const double sinOmega = std::sin( omega );
+			b.wa[ i ] = s * std::sin( ( 1.0 - t ) * omega ) / sinOmega;
+			b.wb[ i ] = std::sin( t * omega ) / sinOmega;
+		}
+	}
+}
+
+/**
+ * @internal block weights of the corrected linear interpolation. The interpolation point
+ * is moved by a cubic in \c t with coefficients that are polynomials in the cosine, fitted
+ * to the slerp angles (A. Kapoulkine, "Approximating slerp", 2015). Without branches, so
+ * the compiler can vectorize the loop.
+ */
+void fastWeights( const double t, const std::size_t n, InterpolationBlock& b )
+{
+	const double h = t - 0.5;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const double d = b.dot( i );
+		const double s = d < 0 ? -1 : 1;
+		const double c = s * d;
+		const double ka = 1.0904 + c * ( -3.2452 + c * ( 3.55645 - c * 1.43519 ) );
+		const double kb = 0.848013 + c * ( -1.06021 + c * 0.215638 );
+		const double ct = t + t * h * ( t - 1.0 ) * ( ka * h * h + kb );
+		b.wa[ i ] = s * ( 1.0 - ct );
+		b.wb[ i ] = ct;
+	}
+}
+
+/// @internal a = normalize( wa * a + wb * b )
+template< class Pack >
+std::size_t combine( std::size_t i, const std::size_t n, InterpolationBlock& b )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type one = Pack::set1( 1 );
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type wa = Pack::load( b.wa + i ), wb = Pack::load( b.wb + i );
+		const pack_type x = Pack::add( Pack::mul( wa, Pack::load( b.ax + i ) ), Pack::mul( wb, Pack::load( b.bx + i ) ) );
+		const pack_type y = Pack::add( Pack::mul( wa, Pack::load( b.ay + i ) ), Pack::mul( wb, Pack::load( b.by + i ) ) );
+		const pack_type z = Pack::add( Pack::mul( wa, Pack::load( b.az + i ) ), Pack::mul( wb, Pack::load( b.bz + i ) ) );
+		const pack_type w = Pack::add( Pack::mul( wa, Pack::load( b.aw + i ) ), Pack::mul( wb, Pack::load( b.bw + i ) ) );
+		const pack_type norm = Pack::sqrt( Pack::add( Pack::add( Pack::mul( x, x ), Pack::mul( y, y ) )
+			, Pack::add( Pack::mul( z, z ), Pack::mul( w, w ) ) ) );
+		const pack_type s = Pack::div( one, norm );
+		Pack::store( b.ax + i, Pack::mul( x, s ) ); Pack::store( b.ay + i, Pack::mul( y, s ) );
+		Pack::store( b.az + i, Pack::mul( z, s ) ); Pack::store( b.aw + i, Pack::mul( w, s ) );
+	}
+	return i;
+}
+
+/// @internal interpolates the block rotations, the results replace the first rotations
+void interpolate( const double t, const RotationInterpolation mode, const std::size_t n, InterpolationBlock& b )
+{
+	if ( mode == fastInterpolation )
+		fastWeights( t, n, b );
+	else
+		slerpWeights( t, n, b );
+	combine< Util::simd_scalar< double > >( combine< Util::simd_pack< double > >( 0, n, b ), n, b );
+}
+
+void interpolateRange( const Pose* x, const Pose* y, const double t, const RotationInterpolation mode
+	, Pose* out, const std::size_t begin, const std::size_t end )
+{
+	InterpolationBlock block;
+	for ( std::size_t s = begin; s < end; s += blockSize )
+	{
+		const std::size_t n = std::min( blockSize, end - s );
+		for ( std::size_t i = 0; i < n; i++ )
+			block.set( i, x[ s + i ].rotation(), y[ s + i ].rotation() );
+		interpolate( t, mode, n, block );
+		for ( std::size_t i = 0; i < n; i++ )
+			out[ s + i ] = Pose( block.get( i ), linearInterpolate( x[ s + i ].translation(), y[ s + i ].translation(), t ) );
+	}
+}
+
+void interpolateQuaternionRange( const Quaternion* x, const Quaternion* y, const double t, const RotationInterpolation mode
+	, Quaternion* out, const std::size_t begin, const std::size_t end )
+{
+	InterpolationBlock block;
+	for ( std::size_t s = begin; s < end; s += blockSize )
+	{
+		const std::size_t n = std::min( blockSize, end - s );
+		for ( std::size_t i = 0; i < n; i++ )
+			block.set( i, x[ s + i ], y[ s + i ] );
+		interpolate( t, mode, n, block );
+		for ( std::size_t i = 0; i < n; i++ )
+			out[ s + i ] = block.get( i );
+	}
+}
+
+void transformRange( const PoseCoefficients< Util::simd_scalar< double > >* m, const Vector< double, 3 >* in
+	, Vector< double, 3 >* out, const std::size_t begin, const std::size_t end )
+{
+	// the positions are contiguous triples already, unpacking them would cost more than the kernel saves
+	for ( std::size_t i = begin; i < end; i++ )
+	{
+		double r[ 3 ];
+		m->apply( in[ i ]( 0 ), in[ i ]( 1 ), in[ i ]( 2 ), r );
+		out[ i ]( 0 ) = r[ 0 ];
+		out[ i ]( 1 ) = r[ 1 ];
+		out[ i ]( 2 ) = r[ 2 ];
+	}
+}
+
+template< class Element >
+const Vector< double, 3 >& position( const Element& e );
+
+template<>
+const Vector< double, 3 >& position( const Vector< double, 3 >& e )
+{ return e; }
+
+template<>
+const Vector< double, 3 >& position( const Pose& e )
+{ return e.translation(); }
+
+template< class Element, class Out >
+void distanceRange( const Element* a, const Element* b, Out* out, const std::size_t begin, const std::size_t end )
+{
+	double pa[ 3 ][ blockSize ], pb[ 3 ][ blockSize ], d[ blockSize ];
+	const double* const ca[ 3 ] = { pa[ 0 ], pa[ 1 ], pa[ 2 ] };
+	const double* const cb[ 3 ] = { pb[ 0 ], pb[ 1 ], pb[ 2 ] };
+	for ( std::size_t s = begin; s < end; s += blockSize )
+	{
+		const std::size_t n = std::min( blockSize, end - s );
+		for ( std::size_t i = 0; i < n; i++ )
+			for ( std::size_t j = 0; j < 3; j++ )
+			{
+				pa[ j ][ i ] = position( a[ s + i ] )( j );
+				pb[ j ][ i ] = position( b[ s + i ] )( j );
+			}
+		distance< Util::simd_scalar< double > >( distance< Util::simd_pack< double > >( 0, n, ca, cb, d ), n, ca, cb, d );
+		for ( std::size_t i = 0; i < n; i++ )
+			out[ s + i ] = Out( d[ i ] );
+	}
+}
+
+template< class Element, class Out >
+void distances( const std::vector< Element >& a, const std::vector< Element >& b, std::vector< Out >& result, const ListExecutor& executor )
+{
+	if ( a.size() != b.size() )
+		UBITRACK_THROW( "Cannot compute distances between lists of different size" );
+	result.resize( a.size() );
+	if ( !a.empty() )
+		run( executor, a.size(), boost::bind( &distanceRange< Element, Out >, &a[ 0 ], &b[ 0 ], &result[ 0 ], _1, _2 ) );
+}
+
+
+/// @internal a block of rotation matrices and the resulting quaternions, element ( r, c ) is m[ 3 * c + r ]
+struct RotationBlock
+{
+	double qx[ blockSize ], qy[ blockSize ], qz[ blockSize ], qw[ blockSize ];
+	double m[ 9 ][ blockSize ];
+};
+
+/**
+ * @internal block quaternions from the block matrices. The component with the largest
+ * diagonal term is computed from the square root and the others from the off-diagonal
+ * terms, as in the matrix constructor of Quaternion, but the cases are chosen by selects,
+ * so the compiler can vectorize the loop.
+ */
+void matrixToQuaternion( const std::size_t n, RotationBlock& b )
+{
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const double m00 = b.m[ 0 ][ i ], m10 = b.m[ 1 ][ i ], m20 = b.m[ 2 ][ i ];
+		const double m01 = b.m[ 3 ][ i ], m11 = b.m[ 4 ][ i ], m21 = b.m[ 5 ][ i ];
+		const double m02 = b.m[ 6 ][ i ], m12 = b.m[ 7 ][ i ], m22 = b.m[ 8 ][ i ];
+
+		// four times the squares of w, x, y and z
+		const double tw = 1 + m00 + m11 + m22;
+		const double tx = 1 + m00 - m11 - m22;
+		const double ty = 1 - m00 + m11 - m22;
+		const double tz = 1 - m00 - m11 + m22;
+		const bool bw = tw >= tx && tw >= ty && tw >= tz;
+		const bool bx = !bw && tx >= ty && tx >= tz;
+		const bool by = !bw && !bx && ty >= tz;
+		const double t = bw ? tw : ( bx ? tx : ( by ? ty : tz ) );
+
+		const double r = 0.5 * std::sqrt( t );
+		const double h = 0.25 / r;
+		const double a = ( m21 - m12 ) * h, c = ( m02 - m20 ) * h, e = ( m10 - m01 ) * h;
+		const double d = ( m01 + m10 ) * h, f = ( m02 + m20 ) * h, g = ( m12 + m21 ) * h;
+		const double w = bw ? r : ( bx ? a : ( by ? c : e ) );
+		const double x = bw ? a : ( bx ? r : ( by ? d : f ) );
+		const double y = bw ? c : ( bx ? d : ( by ? r : g ) );
+		const double z = bw ? e : ( bx ? f : ( by ? g : r ) );
+
+		// normalize to a non-negative real part
+		const double s = ( w < 0 ? -1 : 1 ) / std::sqrt( w * w + x * x + y * y + z * z );
+		b.qw[ i ] = w * s;
+		b.qx[ i ] = x * s;
+		b.qy[ i ] = y * s;
+		b.qz[ i ] = z * s;
+	}
+}
+
+void quaternionToMatrixRange( const Quaternion* in, Matrix< double, 3, 3 >* out, const std::size_t begin, const std::size_t end )
+{
+	// the matrices are written in place, unpacking the quaternions would cost more than the kernel saves
+	for ( std::size_t i = begin; i < end; i++ )
+		in[ i ].toMatrix( out[ i ] );
+}
+
+void matrixToQuaternionRange( const Matrix< double, 3, 3 >* in, Quaternion* out, const std::size_t begin, const std::size_t end )
+{
+	RotationBlock block;
+	for ( std::size_t s = begin; s < end; s += blockSize )
+	{
+		const std::size_t n = std::min( blockSize, end - s );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const double* m = &in[ s + i ]( 0, 0 );
+			for ( std::size_t j = 0; j < 9; j++ )
+				block.m[ j ][ i ] = m[ j ];
+		}
+		matrixToQuaternion( n, block );
+		for ( std::size_t i = 0; i < n; i++ )
+			out[ s + i ] = Quaternion( block.qx[ i ], block.qy[ i ], block.qz[ i ], block.qw[ i ] );
+	}
+}
+
+void eulerRange( const Vector< double, 3 >* in, Quaternion* out, const std::size_t begin, const std::size_t end )
+{
+	for ( std::size_t i = begin; i < end; i++ )
+		out[ i ] = Quaternion( in[ i ]( 0 ), in[ i ]( 1 ), in[ i ]( 2 ) );
+}
+
+void logarithmRange( const Quaternion* in, Vector< double, 3 >* out, const std::size_t begin, const std::size_t end )
+{
+	for ( std::size_t i = begin; i < end; i++ )
+		out[ i ] = in[ i ].toLogarithm();
+}
+
+/// @internal a block of rotation vectors, their squared angles and the resulting quaternions
+struct ExponentialBlock
+{
+	double rx[ blockSize ], ry[ blockSize ], rz[ blockSize ], theta2[ blockSize ];
+	double qx[ blockSize ], qy[ blockSize ], qz[ blockSize ], qw[ blockSize ];
+};
+
+/// @internal number of terms of the series in ExponentialSeries
+static const std::size_t seriesSize = 16;
+
+/// @internal largest squared angle of ExponentialSeries, ( 2 pi )^2
+static const double maxSeriesAngle2 = 4 * 9.8696044010893586188;
+
+/**
+ * @internal coefficients of sin( theta / 2 ) / theta and cos( theta / 2 ) as series in
+ * -theta^2 / 4. Up to an angle of 2 pi the omitted terms are below 1e-17, so the quaternions
+ * are computed without trigonometric functions, square roots or branches.
+ */
+struct ExponentialSeries
+{
+	double sinc[ seriesSize ];
+	double cos[ seriesSize ];
+
+	ExponentialSeries()
+	{
+		// 1 / ( 2k + 1 )! / 2 and 1 / ( 2k )!
+		double f = 1;
+		for ( std::size_t k = 0; k < seriesSize; k++ )
+		{
+			cos[ k ] = 1 / f;
+			f *= 2 * k + 1;
+			sinc[ k ] = 0.5 / f;
+			f *= 2 * k + 2;
+		}
+	}
+};
+
+/// @internal block quaternions from block rotation vectors with angles of at most 2 pi
+template< class Pack >
+std::size_t exponential( const ExponentialSeries& series, std::size_t i, const std::size_t n, ExponentialBlock& b )
+{
+	typedef typename Pack::type pack_type;
+	const pack_type minusQuarter = Pack::set1( -0.25 );
+	for ( ; i + Pack::size <= n; i += Pack::size )
+	{
+		const pack_type z = Pack::mul( minusQuarter, Pack::load( b.theta2 + i ) );
+		pack_type s = Pack::set1( series.sinc[ seriesSize - 1 ] );
+		pack_type c = Pack::set1( series.cos[ seriesSize - 1 ] );
+		for ( std::size_t k = seriesSize - 1; k-- > 0; )
+		{
+			s = Pack::add( Pack::mul( s, z ), Pack::set1( series.sinc[ k ] ) );
+			c = Pack::add( Pack::mul( c, z ), Pack::set1( series.cos[ k ] ) );
+		}
+		Pack::store( b.qx + i, Pack::mul( s, Pack::load( b.rx + i ) ) );
+		Pack::store( b.qy + i, Pack::mul( s, Pack::load( b.ry + i ) ) );
+		Pack::store( b.qz + i, Pack::mul( s, Pack::load( b.rz + i ) ) );
+		Pack::store( b.qw + i, c );
+	}
+	return i;
+}
+
+void exponentialRange( const Vector< double, 3 >* in, Quaternion* out, const std::size_t begin, const std::size_t end )
+{
+	const ExponentialSeries series;
+	ExponentialBlock block;
+	for ( std::size_t s = begin; s < end; s += blockSize )
+	{
+		const std::size_t n = std::min( blockSize, end - s );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Vector< double, 3 >& r( in[ s + i ] );
+			block.rx[ i ] = r( 0 ); block.ry[ i ] = r( 1 ); block.rz[ i ] = r( 2 );
+			block.theta2[ i ] = r( 0 ) * r( 0 ) + r( 1 ) * r( 1 ) + r( 2 ) * r( 2 );
+		}
+		exponential< Util::simd_scalar< double > >( series, exponential< Util::simd_pack< double > >( series, 0, n, block ), n, block );
+
+		// larger angles are rare, e.g. unwrapped integrated rotations
+		for ( std::size_t i = 0; i < n; i++ )
+			out[ s + i ] = block.theta2[ i ] <= maxSeriesAngle2
+				? Quaternion( block.qx[ i ], block.qy[ i ], block.qz[ i ], block.qw[ i ] )
+				: Quaternion::fromLogarithm( in[ s + i ] );
+	}
+}
+
+/// @internal resizes the result and runs the range function on the whole lists
+template< class In, class Out >
+void convert( const std::vector< In >& in, std::vector< Out >& result, const ListExecutor& executor
+	, void ( *range )( const In*, Out*, std::size_t, std::size_t ) )
+{
+	result.resize( in.size() );
+	if ( !in.empty() )
+		run( executor, in.size(), boost::bind( range, &in[ 0 ], &result[ 0 ], _1, _2 ) );
+}
+
+} // anonymous namespace
+
+
+ListExecutor threadExecutor( const std::size_t nThreads, const std::size_t minChunk )
+{
+	ThreadExecutor executor;
+	executor.nThreads = nThreads ? nThreads : std::max< std::size_t >( 1, boost::thread::hardware_concurrency() );
+	executor.minChunk = std::max< std::size_t >( 1, minChunk );
+	return executor;
+}
+
+ListExecutor poolExecutor( Ubitrack::Util::Executor& executor, const std::size_t grain )
+{
+	PoolExecutor pool;
+	pool.executor = &executor;
+	pool.grain = std::max< std::size_t >( 1, grain );
+	return pool;
+}
+
+ListExecutor nodeExecutor( Ubitrack::Util::Executor& executor, const std::size_t grain )
+{
+	NodeExecutor node;
+	node.executor = &executor;
+	node.grain = std::max< std::size_t >( 1, grain );
+	return node;
+}
+
+void multiplyPoseList( const Pose& p, const std::vector< Pose >& poses, std::vector< Pose >& result, const ListExecutor& executor )
+{
+	result.resize( poses.size() );
+	if ( !poses.empty() )
+	{
+		const MultiplyTask task( p, true, &poses[ 0 ], &result[ 0 ] );
+		run( executor, poses.size(), boost::cref( task ) );
+	}
+}
+
+void multiplyPoseList( const std::vector< Pose >& poses, const Pose& p, std::vector< Pose >& result, const ListExecutor& executor )
+{
+	result.resize( poses.size() );
+	if ( !poses.empty() )
+	{
+		const MultiplyTask task( p, false, &poses[ 0 ], &result[ 0 ] );
+		run( executor, poses.size(), boost::cref( task ) );
+	}
+}
+
+void invertPoseList( const std::vector< Pose >& poses, std::vector< Pose >& result, const ListExecutor& executor )
+{
+	result.resize( poses.size() );
+	if ( !poses.empty() )
+		run( executor, poses.size(), boost::bind( &invertRange, &poses[ 0 ], &result[ 0 ], _1, _2 ) );
+}
+
+void interpolatePoseList( const std::vector< Pose >& x, const std::vector< Pose >& y, const double t
+	, std::vector< Pose >& result, const ListExecutor& executor, const RotationInterpolation mode )
+{
+	if ( x.size() != y.size() )
+		UBITRACK_THROW( "Cannot interpolate between pose lists of different size" );
+	result.resize( x.size() );
+	if ( !x.empty() )
+		run( executor, x.size(), boost::bind( &interpolateRange, &x[ 0 ], &y[ 0 ], t, mode, &result[ 0 ], _1, _2 ) );
+}
+
+void interpolateQuaternionList( const std::vector< Quaternion >& x, const std::vector< Quaternion >& y, const double t
+	, std::vector< Quaternion >& result, const ListExecutor& executor, const RotationInterpolation mode )
+{
+	if ( x.size() != y.size() )
+		UBITRACK_THROW( "Cannot interpolate between rotation lists of different size" );
+	result.resize( x.size() );
+	if ( !x.empty() )
+		run( executor, x.size(), boost::bind( &interpolateQuaternionRange, &x[ 0 ], &y[ 0 ], t, mode, &result[ 0 ], _1, _2 ) );
+}
+
+void transformPositionList( const Pose& p, const std::vector< Vector< double, 3 > >& positions
+	, std::vector< Vector< double, 3 > >& result, const ListExecutor& executor )
+{
+	const PoseCoefficients< Util::simd_scalar< double > > m( p );
+	result.resize( positions.size() );
+	if ( !positions.empty() )
+		run( executor, positions.size(), boost::bind( &transformRange, &m, &positions[ 0 ], &result[ 0 ], _1, _2 ) );
+}
+
+void positionDistances( const std::vector< Vector< double, 3 > >& a, const std::vector< Vector< double, 3 > >& b
+	, std::vector< double >& result, const ListExecutor& executor )
+{
+	distances( a, b, result, executor );
+}
+
+void positionDistances( const std::vector< Pose >& a, const std::vector< Pose >& b
+	, std::vector< double >& result, const ListExecutor& executor )
+{
+	distances( a, b, result, executor );
+}
+
+void positionDistances( const std::vector< Vector< double, 3 > >& a, const std::vector< Vector< double, 3 > >& b
+	, std::vector< Scalar< double > >& result, const ListExecutor& executor )
+{
+	distances( a, b, result, executor );
+}
+
+void quaternionsToMatrices( const std::vector< Quaternion >& rotations
+	, std::vector< Matrix< double, 3, 3 > >& result, const ListExecutor& executor )
+{
+	convert( rotations, result, executor, &quaternionToMatrixRange );
+}
+
+void matricesToQuaternions( const std::vector< Matrix< double, 3, 3 > >& matrices
+	, std::vector< Quaternion >& result, const ListExecutor& executor )
+{
+	convert( matrices, result, executor, &matrixToQuaternionRange );
+}
+
+void eulerAnglesToQuaternions( const std::vector< Vector< double, 3 > >& angles
+	, std::vector< Quaternion >& result, const ListExecutor& executor )
+{
+	convert( angles, result, executor, &eulerRange );
+}
+
+void quaternionLogarithms( const std::vector< Quaternion >& rotations
+	, std::vector< Vector< double, 3 > >& result, const ListExecutor& executor )
+{
+	convert( rotations, result, executor, &logarithmRange );
+}
+
+void quaternionsFromLogarithms( const std::vector< Vector< double, 3 > >& logarithms
+	, std::vector< Quaternion >& result, const ListExecutor& executor )
+{
+	convert( logarithms, result, executor, &exponentialRange );
+}
+
+} } // namespace Ubitrack::Math
@@ -0,0 +1,186 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Operations on whole lists of poses and positions.
+ *
+ * The functions process the lists in blocks that are unpacked into one array per
+ * component (structure of arrays), so the arithmetic runs on \c Util::simd_pack
+ * registers. The blocks can be distributed over several threads by passing a
+ * \c ListExecutor, e.g. one created by \c threadExecutor, or by \c poolExecutor to share the
+ * threads of the process executor with the other algorithms:
+ * @code
+ * const Math::ListExecutor executor( Math::poolExecutor() );
+ * Math::multiplyPoseList( offset, poses, result, executor );
+ * @endcode
+ *
+ * The result list is resized to the size of the input and may be the same list as the
+ * input, a result that already has the right size is not reallocated.
+ * For measurements see utMeasurement/ListOperations.h.
+ *
+ * Interpolated rotations are computed as \c slerp does, or with the faster approximation
+ * \c fastInterpolation when a small error is acceptable, e.g. for upsampling poses for display.
+ *
+ * The rotation conversions at the end give the same results as the corresponding
+ * \c Quaternion member functions and constructors, e.g. for importing recorded rotations.
+ * The conversion from matrices to quaternions runs on blocks without branches, the exponential
+ * on packs with series instead of trigonometric functions (see LieGroups.h). The others are
+ * cheap or need trigonometric functions per element and only gain from the executor.
+ */
+
+#ifndef __UBITRACK_MATH_POSELISTOPERATIONS_H_INCLUDED__
+#define __UBITRACK_MATH_POSELISTOPERATIONS_H_INCLUDED__
+
+#include <utCore.h>
+#include "Pose.h"
+#include "Vector.h"
+#include "Matrix.h"
+#include "Scalar.h"
+#include <utUtil/Executor.h>
+
+#include <vector>
+#include <boost/function.hpp>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * Executes \c task( begin, end ) for disjoint ranges that together cover [ 0, n ) and
+ * returns when all ranges are done. An empty executor runs the whole range in the
+ * calling thread.
+ */
+typedef boost::function< void ( std::size_t n, const boost::function< void ( std::size_t, std::size_t ) >& task ) > ListExecutor;
+
+/**
+ * returns an executor that splits lists into at most \c nThreads ranges of at least
+ * \c minChunk elements and runs them on own threads. Smaller lists run in the calling thread.
+ * @param nThreads number of threads, 0 uses all cores
+ * @param minChunk minimal number of elements per thread
+ */
+UBITRACK_EXPORT ListExecutor threadExecutor( std::size_t nThreads = 0, std::size_t minChunk = 4096 );
+
+/**
+ * returns an executor that runs the ranges on a shared \c Util::Executor instead of own
+ * threads, see Executor.h. Lists are split into ranges of at most \c grain elements.
+ * @param executor the pool of threads, must outlive the returned \c ListExecutor
+ * @param grain maximum number of elements per range
+ */
+UBITRACK_EXPORT ListExecutor poolExecutor( Ubitrack::Util::Executor& executor = Ubitrack::Util::Executor::instance(), std::size_t grain = 4096 );
+
+/**
+ * like \c poolExecutor, but runs one contiguous shard of each list on every NUMA node of the
+ * executor, see \c Util::Executor::parallelForNodes. Element \c i of a list of \c n elements
+ * always runs on the same node, so data that is first touched through this executor stays local.
+ */
+UBITRACK_EXPORT ListExecutor nodeExecutor( Ubitrack::Util::Executor& executor = Ubitrack::Util::Executor::instance(), std::size_t grain = 4096 );
+
+/**
+ * how lists of rotations are interpolated. Both take the shorter path between the rotations,
+ * i.e. a quaternion is negated if the dot product of the two quaternions is negative.
+ * - \c slerpInterpolation gives the same results as \c slerp. The trigonometric functions
+ *   are evaluated per element, only the weighted sums and normalization run on packs.
+ * - \c fastInterpolation interpolates the quaternions linearly with an interpolation point
+ *   that is corrected by a polynomial in the cosine of the angle between them, and normalizes
+ *   the result. It needs no trigonometric functions, the angle to the slerp result stays below
+ *   1e-3 rad for rotations of up to 180 degrees apart.
+ */
+enum RotationInterpolation { slerpInterpolation, fastInterpolation };
+
+/** computes <tt>result[ i ] = p * poses[ i ]</tt> */
+UBITRACK_EXPORT void multiplyPoseList( const Pose& p, const std::vector< Pose >& poses, std::vector< Pose >& result
+	, const ListExecutor& executor = ListExecutor() );
+
+/** computes <tt>result[ i ] = poses[ i ] * p</tt> */
+UBITRACK_EXPORT void multiplyPoseList( const std::vector< Pose >& poses, const Pose& p, std::vector< Pose >& result
+	, const ListExecutor& executor = ListExecutor() );
+
+/** computes <tt>result[ i ] = ~poses[ i ]</tt> */
+UBITRACK_EXPORT void invertPoseList( const std::vector< Pose >& poses, std::vector< Pose >& result
+	, const ListExecutor& executor = ListExecutor() );
+
+/**
+ * interpolates between corresponding poses of two lists of the same size as
+ * \c linearInterpolate( const Pose&, const Pose&, double ) does
+ * @param t interpolation point between 0.0 and 1.0
+ * @param mode the interpolation of the rotations
+ */
+UBITRACK_EXPORT void interpolatePoseList( const std::vector< Pose >& x, const std::vector< Pose >& y, double t
+	, std::vector< Pose >& result, const ListExecutor& executor = ListExecutor()
+	, RotationInterpolation mode = slerpInterpolation );
+
+/**
+ * interpolates between corresponding rotations of two lists of the same size as \c slerp does
+ * @param t interpolation point between 0.0 and 1.0
+ * @param mode the interpolation of the rotations
+ */
+UBITRACK_EXPORT void interpolateQuaternionList( const std::vector< Quaternion >& x, const std::vector< Quaternion >& y, double t
+	, std::vector< Quaternion >& result, const ListExecutor& executor = ListExecutor()
+	, RotationInterpolation mode = slerpInterpolation );
+
+/** computes <tt>result[ i ] = p * positions[ i ]</tt> */
+UBITRACK_EXPORT void transformPositionList( const Pose& p, const std::vector< Vector< double, 3 > >& positions
+	, std::vector< Vector< double, 3 > >& result, const ListExecutor& executor = ListExecutor() );
+
+/** computes the euclidean distances between corresponding positions of two lists of the same size */
+UBITRACK_EXPORT void positionDistances( const std::vector< Vector< double, 3 > >& a, const std::vector< Vector< double, 3 > >& b
+	, std::vector< double >& result, const ListExecutor& executor = ListExecutor() );
+
+/** computes the euclidean distances between corresponding positions as scalars, e.g. for a \c DistanceList */
+UBITRACK_EXPORT void positionDistances( const std::vector< Vector< double, 3 > >& a, const std::vector< Vector< double, 3 > >& b
+	, std::vector< Scalar< double > >& result, const ListExecutor& executor = ListExecutor() );
+
+/** computes the euclidean distances between the translations of corresponding poses of two lists of the same size */
+UBITRACK_EXPORT void positionDistances( const std::vector< Pose >& a, const std::vector< Pose >& b
+	, std::vector< double >& result, const ListExecutor& executor = ListExecutor() );
+
+/** converts unit quaternions to rotation matrices as \c Quaternion::toMatrix does */
+UBITRACK_EXPORT void quaternionsToMatrices( const std::vector< Quaternion >& rotations
+	, std::vector< Matrix< double, 3, 3 > >& result, const ListExecutor& executor = ListExecutor() );
+
+/**
+ * converts rotation matrices to normalized quaternions that describe the same rotation as
+ * the \c Quaternion matrix constructor, with a non-negative real part
+ */
+UBITRACK_EXPORT void matricesToQuaternions( const std::vector< Matrix< double, 3, 3 > >& matrices
+	, std::vector< Quaternion >& result, const ListExecutor& executor = ListExecutor() );
+
+/** converts Euler angles ( x, y, z ) to quaternions as the \c Quaternion( x, y, z ) constructor does */
+UBITRACK_EXPORT void eulerAnglesToQuaternions( const std::vector< Vector< double, 3 > >& angles
+	, std::vector< Quaternion >& result, const ListExecutor& executor = ListExecutor() );
+
+/** computes the logarithms of quaternions as \c Quaternion::toLogarithm does */
+UBITRACK_EXPORT void quaternionLogarithms( const std::vector< Quaternion >& rotations
+	, std::vector< Vector< double, 3 > >& result, const ListExecutor& executor = ListExecutor() );
+
+/**
+ * creates quaternions from their logarithms as \c Quaternion::fromLogarithm does. Angles up to
+ * 2 pi are evaluated on packs, larger ones per element.
+ */
+UBITRACK_EXPORT void quaternionsFromLogarithms( const std::vector< Vector< double, 3 > >& logarithms
+	, std::vector< Quaternion >& result, const ListExecutor& executor = ListExecutor() );
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_POSELISTOPERATIONS_H_INCLUDED__
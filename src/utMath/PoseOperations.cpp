@@ -0,0 +1,235 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+#include "PoseOperations.h"
+
+namespace Ubitrack { namespace Math {
+
+namespace {
+
+/// @internal components of a pose as plain numbers
+struct PoseData
+{
+	double qx, qy, qz, qw;
+	double t[ 3 ];
+
+	explicit PoseData( const Pose& p )
+		: qx( p.rotation().x() ), qy( p.rotation().y() ), qz( p.rotation().z() ), qw( p.rotation().w() )
+	{
+		const Vector< double, 3 >& v( p.translation() );
+		t[ 0 ] = v( 0 );
+		t[ 1 ] = v( 1 );
+		t[ 2 ] = v( 2 );
+	}
+
+	/// conjugate of the rotation
+	void conjugate()
+	{ qx = -qx; qy = -qy; qz = -qz; }
+
+	Pose toPose() const
+	{ return Pose( Quaternion( qx, qy, qz, qw ), Vector< double, 3 >( t[ 0 ], t[ 1 ], t[ 2 ] ) ); }
+};
+
+/// @internal r = q * v * q^*, using v + 2w (u x v) + 2 u x (u x v) with u = imaginary part of q
+inline void rotate( const PoseData& q, const double v[ 3 ], double r[ 3 ] )
+{
+	const double cx = 2 * ( q.qy * v[ 2 ] - q.qz * v[ 1 ] );
+	const double cy = 2 * ( q.qz * v[ 0 ] - q.qx * v[ 2 ] );
+	const double cz = 2 * ( q.qx * v[ 1 ] - q.qy * v[ 0 ] );
+	const double r0 = v[ 0 ] + q.qw * cx + ( q.qy * cz - q.qz * cy );
+	const double r1 = v[ 1 ] + q.qw * cy + ( q.qz * cx - q.qx * cz );
+	const double r2 = v[ 2 ] + q.qw * cz + ( q.qx * cy - q.qy * cx );
+	r[ 0 ] = r0;
+	r[ 1 ] = r1;
+	r[ 2 ] = r2;
+}
+
+/// @internal Hamilton product r = a * b of the rotations, r may alias a or b
+inline void multiplyRotation( const PoseData& a, const PoseData& b, PoseData& r )
+{
+	const double w = a.qw * b.qw - a.qx * b.qx - a.qy * b.qy - a.qz * b.qz;
+	const double x = a.qw * b.qx + a.qx * b.qw + a.qy * b.qz - a.qz * b.qy;
+	const double y = a.qw * b.qy - a.qx * b.qz + a.qy * b.qw + a.qz * b.qx;
+	const double z = a.qw * b.qz + a.qx * b.qy - a.qy * b.qx + a.qz * b.qw;
+	r.qw = w;
+	r.qx = x;
+	r.qy = y;
+	r.qz = z;
+}
+
+/// @internal r = a * b, r may alias a or b
+inline void multiply( const PoseData& a, const PoseData& b, PoseData& r )
+{
+	double t[ 3 ];
+	rotate( a, b.t, t );
+	const double t0 = t[ 0 ] + a.t[ 0 ];
+	const double t1 = t[ 1 ] + a.t[ 1 ];
+	const double t2 = t[ 2 ] + a.t[ 2 ];
+	multiplyRotation( a, b, r );
+	r.t[ 0 ] = t0;
+	r.t[ 1 ] = t1;
+	r.t[ 2 ] = t2;
+}
+
+/// @internal p = ~p
+inline void invert( PoseData& p )
+{
+	p.conjugate();
+	double t[ 3 ];
+	rotate( p, p.t, t );
+	p.t[ 0 ] = -t[ 0 ];
+	p.t[ 1 ] = -t[ 1 ];
+	p.t[ 2 ] = -t[ 2 ];
+}
+
+/// @internal rotation matrix and translation of a pose, row-major
+struct PoseMatrix
+{
+	double r[ 3 ][ 3 ];
+	double t[ 3 ];
+
+	explicit PoseMatrix( const PoseData& q )
+	{
+		// same terms as Quaternion::toMatrix
+		const double xx = q.qx * q.qx, yy = q.qy * q.qy, zz = q.qz * q.qz;
+		const double xy = q.qx * q.qy, xz = q.qx * q.qz, yz = q.qy * q.qz;
+		const double wx = q.qw * q.qx, wy = q.qw * q.qy, wz = q.qw * q.qz;
+		r[ 0 ][ 0 ] = 1 - 2 * ( yy + zz ); r[ 0 ][ 1 ] = 2 * ( xy - wz );     r[ 0 ][ 2 ] = 2 * ( xz + wy );
+		r[ 1 ][ 0 ] = 2 * ( xy + wz );     r[ 1 ][ 1 ] = 1 - 2 * ( xx + zz ); r[ 1 ][ 2 ] = 2 * ( yz - wx );
+		r[ 2 ][ 0 ] = 2 * ( xz - wy );     r[ 2 ][ 1 ] = 2 * ( yz + wx );     r[ 2 ][ 2 ] = 1 - 2 * ( xx + yy );
+		t[ 0 ] = q.t[ 0 ];
+		t[ 1 ] = q.t[ 1 ];
+		t[ 2 ] = q.t[ 2 ];
+	}
+
+	/// y = R * x + t, written as multiply-add chains that the compiler can contract to FMA
+	void apply( const double x0, const double x1, const double x2, double* y ) const
+	{
+		y[ 0 ] = r[ 0 ][ 0 ] * x0 + ( r[ 0 ][ 1 ] * x1 + ( r[ 0 ][ 2 ] * x2 + t[ 0 ] ) );
+		y[ 1 ] = r[ 1 ][ 0 ] * x0 + ( r[ 1 ][ 1 ] * x1 + ( r[ 1 ][ 2 ] * x2 + t[ 1 ] ) );
+		y[ 2 ] = r[ 2 ][ 0 ] * x0 + ( r[ 2 ][ 1 ] * x1 + ( r[ 2 ][ 2 ] * x2 + t[ 2 ] ) );
+	}
+};
+
+} // anonymous namespace
+
+
+void multiply( const Pose& a, const Pose& b, Pose& result )
+{
+	PoseData r( b );
+	multiply( PoseData( a ), r, r );
+	result = r.toPose();
+}
+
+void invert( const Pose& p, Pose& result )
+{
+	PoseData r( p );
+	invert( r );
+	result = r.toPose();
+}
+
+void invertMultiply( const Pose& a, const Pose& b, Pose& result )
+{
+	PoseData ai( a );
+	invert( ai );
+	PoseData r( b );
+	multiply( ai, r, r );
+	result = r.toPose();
+}
+
+void multiplyInvert( const Pose& a, const Pose& b, Pose& result )
+{
+	PoseData r( b );
+	invert( r );
+	multiply( PoseData( a ), r, r );
+	result = r.toPose();
+}
+
+Pose invertMultiply( const Pose& a, const Pose& b )
+{
+	Pose result;
+	invertMultiply( a, b, result );
+	return result;
+}
+
+Pose multiplyInvert( const Pose& a, const Pose& b )
+{
+	Pose result;
+	multiplyInvert( a, b, result );
+	return result;
+}
+
+void transform( const Pose& p, const Vector< double, 3 >& x, Vector< double, 3 >& result )
+{
+	const PoseData q( p );
+	const double v[ 3 ] = { x( 0 ), x( 1 ), x( 2 ) };
+	double r[ 3 ];
+	rotate( q, v, r );
+	result( 0 ) = r[ 0 ] + q.t[ 0 ];
+	result( 1 ) = r[ 1 ] + q.t[ 1 ];
+	result( 2 ) = r[ 2 ] + q.t[ 2 ];
+}
+
+void transformPoints( const Pose& p, const std::vector< Vector< double, 3 > >& points
+	, std::vector< Vector< double, 3 > >& result )
+{
+	const PoseMatrix m( ( PoseData( p ) ) );
+	const std::size_t n = points.size();
+	result.resize( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const double* x = points[ i ].content();
+		m.apply( x[ 0 ], x[ 1 ], x[ 2 ], result[ i ].content() );
+	}
+}
+
+void multiplyPoses( const Pose& p, const std::vector< Pose >& poses, std::vector< Pose >& result )
+{
+	const PoseData a( p );
+	const PoseMatrix m( a );
+	const std::size_t n = poses.size();
+	result.resize( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		PoseData r( poses[ i ] );
+		multiplyRotation( a, r, r );
+		m.apply( r.t[ 0 ], r.t[ 1 ], r.t[ 2 ], r.t );
+		result[ i ] = r.toPose();
+	}
+}
+
+void multiplyPoses( const std::vector< Pose >& poses, const Pose& p, std::vector< Pose >& result )
+{
+	const PoseData b( p );
+	const std::size_t n = poses.size();
+	result.resize( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		PoseData r( poses[ i ] );
+		multiply( r, b, r );
+		result[ i ] = r.toPose();
+	}
+}
+
+} } // namespace Ubitrack::Math
@@ -0,0 +1,92 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Non-allocating pose composition and batch transformations.
+ *
+ * The functions write their result into an existing object and compute quaternion
+ * products and rotations directly on the components, without going through
+ * \c boost::math::quaternion and ublas expression temporaries. The operators of
+ * \c Pose use them as well. Results may alias the arguments.
+ *
+ * The batch functions convert the rotation of the pose to a matrix once and apply it
+ * to all elements. Rotations assume unit quaternions as \c Quaternion::operator*
+ * does.
+ */
+
+#ifndef __UBITRACK_MATH_POSEOPERATIONS_H_INCLUDED__
+#define __UBITRACK_MATH_POSEOPERATIONS_H_INCLUDED__
+
+#include <utCore.h>
+#include "Pose.h"
+
+#include <vector>
+
+namespace Ubitrack { namespace Math {
+
+/** computes <tt>result = a * b</tt> */
+UBITRACK_EXPORT void multiply( const Pose& a, const Pose& b, Pose& result );
+
+/** computes <tt>result = ~p</tt> */
+UBITRACK_EXPORT void invert( const Pose& p, Pose& result );
+
+/** computes <tt>result = ~a * b</tt>, the pose of \c b relative to \c a */
+UBITRACK_EXPORT void invertMultiply( const Pose& a, const Pose& b, Pose& result );
+
+/** computes <tt>result = a * ~b</tt> */
+UBITRACK_EXPORT void multiplyInvert( const Pose& a, const Pose& b, Pose& result );
+
+/** @return <tt>~a * b</tt> */
+UBITRACK_EXPORT Pose invertMultiply( const Pose& a, const Pose& b );
+
+/** @return <tt>a * ~b</tt> */
+UBITRACK_EXPORT Pose multiplyInvert( const Pose& a, const Pose& b );
+
+/** computes <tt>result = p * x</tt> for a single point */
+UBITRACK_EXPORT void transform( const Pose& p, const Vector< double, 3 >& x, Vector< double, 3 >& result );
+
+/**
+ * transforms all \c points by the pose \c p.
+ * \c result is resized to the number of points and may be the same list as \c points.
+ */
+UBITRACK_EXPORT void transformPoints( const Pose& p, const std::vector< Vector< double, 3 > >& points
+	, std::vector< Vector< double, 3 > >& result );
+
+/**
+ * computes <tt>result[ i ] = p * poses[ i ]</tt> for all \c poses.
+ * \c result is resized to the number of poses and may be the same list as \c poses.
+ */
+UBITRACK_EXPORT void multiplyPoses( const Pose& p, const std::vector< Pose >& poses, std::vector< Pose >& result );
+
+/**
+ * computes <tt>result[ i ] = poses[ i ] * p</tt> for all \c poses, e.g. to apply a fixed offset.
+ * \c result is resized to the number of poses and may be the same list as \c poses.
+ */
+UBITRACK_EXPORT void multiplyPoses( const std::vector< Pose >& poses, const Pose& p, std::vector< Pose >& result );
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_POSEOPERATIONS_H_INCLUDED__
@@ -0,0 +1,408 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Implementation of the cumulative B-spline pose trajectory
+ */
+
+#include "PoseSpline.h"
+#include "VectorFunctions.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <utUtil/Exception.h>
+
+#ifdef HAVE_LAPACK
+#include "Optimization/LevenbergMarquardt.h"
+#endif
+
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+using Ubitrack::Math::Vector;
+using Ubitrack::Math::Quaternion;
+
+/** cumulative cubic basis functions B_1..B_3 and their first and second derivatives wrt. u */
+void cumulativeBasis( const double u, double* b, double* db, double* ddb )
+{
+	const double u2 = u * u;
+	const double u3 = u2 * u;
+	b[ 0 ] = ( 5 + 3 * u - 3 * u2 + u3 ) / 6;
+	b[ 1 ] = ( 1 + 3 * u + 3 * u2 - 2 * u3 ) / 6;
+	b[ 2 ] = u3 / 6;
+	if ( db )
+	{
+		db[ 0 ] = ( 1 - 2 * u + u2 ) / 2;
+		db[ 1 ] = ( 1 + 2 * u - 2 * u2 ) / 2;
+		db[ 2 ] = u2 / 2;
+	}
+	if ( ddb )
+	{
+		ddb[ 0 ] = u - 1;
+		ddb[ 1 ] = 1 - 2 * u;
+		ddb[ 2 ] = u;
+	}
+}
+
+/** R_0 prod_j Exp( b_j d_j ) for the three increments d following R_0 */
+Quaternion cumulativeRotation( const Quaternion& r0, const Vector< double, 3 >* d, const double* b )
+{
+	Quaternion r( r0 );
+	for ( std::size_t j = 0; j < 3; j++ )
+		r = r * Quaternion::fromLogarithm( Vector< double, 3 >( b[ j ] * d[ j ] ) );
+	return r;
+}
+
+} // anonymous namespace
+
+namespace Ubitrack { namespace Math {
+
+PoseSpline::PoseSpline()
+	: m_startTime( 0 )
+	, m_interval( 1 )
+{}
+
+
+PoseSpline::PoseSpline( double startTime, double interval, const std::vector< Pose >& controlPoses )
+	: m_startTime( startTime )
+	, m_interval( interval )
+{
+	if ( !( interval > 0 ) )
+		UBITRACK_THROW( "Pose spline interval must be positive" );
+	setControlPoses( controlPoses );
+}
+
+
+void PoseSpline::setControlPoses( const std::vector< Pose >& controlPoses )
+{
+	if ( controlPoses.size() < 4 )
+		UBITRACK_THROW( "Pose spline needs at least four control poses" );
+	m_controlPoses = controlPoses;
+	updateIncrements();
+}
+
+
+void PoseSpline::updateIncrements()
+{
+	m_rotationIncrements.resize( m_controlPoses.size() );
+	m_rotationIncrements[ 0 ] = Vector< double, 3 >( 0, 0, 0 );
+	for ( std::size_t k = 1; k < m_controlPoses.size(); k++ )
+		m_rotationIncrements[ k ] = Quaternion( ~m_controlPoses[ k - 1 ].rotation() * m_controlPoses[ k ].rotation() ).toLogarithm();
+}
+
+
+std::size_t PoseSpline::segment( double t, double& u ) const
+{
+	const std::size_t nSegments = m_controlPoses.size() - 3;
+	const double s = ( t - m_startTime ) / m_interval;
+	if ( !( s > 0 ) )
+	{
+		u = 0;
+		return 0;
+	}
+	if ( s >= nSegments )
+	{
+		u = 1;
+		return nSegments - 1;
+	}
+	const std::size_t i = static_cast< std::size_t >( s );
+	u = s - i;
+	return i;
+}
+
+
+Pose PoseSpline::evaluate( double t ) const
+{
+	if ( m_controlPoses.empty() )
+		UBITRACK_THROW( "Evaluating an empty pose spline" );
+
+	double u;
+	const std::size_t i = segment( t, u );
+	double b[ 3 ];
+	cumulativeBasis( u, b, 0, 0 );
+
+	Vector< double, 3 > p( m_controlPoses[ i ].translation() );
+	for ( std::size_t j = 0; j < 3; j++ )
+		p += b[ j ] * ( m_controlPoses[ i + j + 1 ].translation() - m_controlPoses[ i + j ].translation() );
+
+	return Pose( cumulativeRotation( m_controlPoses[ i ].rotation(), &m_rotationIncrements[ i + 1 ], b ), p );
+}
+
+
+void PoseSpline::evaluate( double t, Pose& pose, Vector< double, 3 >& velocity, Vector< double, 3 >& acceleration,
+	Vector< double, 3 >& angularVelocity, Vector< double, 3 >& angularAcceleration ) const
+{
+	if ( m_controlPoses.empty() )
+		UBITRACK_THROW( "Evaluating an empty pose spline" );
+
+	double u;
+	const std::size_t i = segment( t, u );
+	double b[ 3 ], db[ 3 ], ddb[ 3 ];
+	cumulativeBasis( u, b, db, ddb );
+	const double dt = 1 / m_interval;
+	const double dt2 = dt * dt;
+
+	Vector< double, 3 > p( m_controlPoses[ i ].translation() );
+	velocity = Vector< double, 3 >( 0, 0, 0 );
+	acceleration = Vector< double, 3 >( 0, 0, 0 );
+
+	// body angular velocity and acceleration, following R_j = R_j-1 A_j with A_j = Exp( b_j d_j ):
+	// w_j = A_j^T w_j-1 + b'_j d_j, w'_j = A_j^T w'_j-1 + b''_j d_j + ( A_j^T w_j-1 ) x ( b'_j d_j )
+	Quaternion r( m_controlPoses[ i ].rotation() );
+	angularVelocity = Vector< double, 3 >( 0, 0, 0 );
+	angularAcceleration = Vector< double, 3 >( 0, 0, 0 );
+
+	for ( std::size_t j = 0; j < 3; j++ )
+	{
+		const Vector< double, 3 > dp( m_controlPoses[ i + j + 1 ].translation() - m_controlPoses[ i + j ].translation() );
+		p += b[ j ] * dp;
+		velocity += ( db[ j ] * dt ) * dp;
+		acceleration += ( ddb[ j ] * dt2 ) * dp;
+
+		const Vector< double, 3 >& d( m_rotationIncrements[ i + j + 1 ] );
+		const Quaternion a( Quaternion::fromLogarithm( Vector< double, 3 >( b[ j ] * d ) ) );
+		const Quaternion aInv( ~a );
+		const Vector< double, 3 > rotated( aInv * angularVelocity );
+		const Vector< double, 3 > dw( ( db[ j ] * dt ) * d );
+		angularAcceleration = aInv * angularAcceleration;
+		angularAcceleration += ( ddb[ j ] * dt2 ) * d + cross_product( rotated, dw );
+		angularVelocity = rotated + dw;
+		r = r * a;
+	}
+
+	pose = Pose( r, p );
+}
+
+
+void PoseSpline::evaluate( const double* times, std::size_t n, Pose* poses ) const
+{
+	if ( m_controlPoses.empty() )
+		UBITRACK_THROW( "Evaluating an empty pose spline" );
+
+	for ( std::size_t k = 0; k < n; k++ )
+		poses[ k ] = evaluate( times[ k ] );
+}
+
+
+void PoseSpline::evaluate( const std::vector< double >& times, std::vector< Pose >& poses ) const
+{
+	poses.resize( times.size() );
+	if ( !times.empty() )
+		evaluate( &times[ 0 ], times.size(), &poses[ 0 ] );
+}
+
+
+#ifdef HAVE_LAPACK
+
+namespace {
+
+/**
+ * @internal residuals of a spline fit: per sample the spline position and the rotation angle
+ * Log( R_sample^-1 R( t ) ). The parameters are per control pose the position and a rotation
+ * vector applied on the right of the initial control rotation.
+ */
+class SplineFitProblem
+{
+public:
+	SplineFitProblem( const std::vector< double >& times, const std::vector< Pose >& poses,
+		const std::vector< Quaternion >& initialRotations, double startTime, double interval )
+		: m_times( times )
+		, m_poses( poses )
+		, m_initialRotations( initialRotations )
+		, m_startTime( startTime )
+		, m_interval( interval )
+		, m_rotations( initialRotations.size() )
+	{}
+
+	std::size_t size() const
+	{ return 6 * m_times.size(); }
+
+	/** control rotation \c k for the parameters */
+	template< class VT >
+	Quaternion rotation( const VT& input, std::size_t k ) const
+	{
+		const Vector< double, 3 > delta( input( 6 * k + 3 ), input( 6 * k + 4 ), input( 6 * k + 5 ) );
+		return m_initialRotations[ k ] * Quaternion::fromLogarithm( delta );
+	}
+
+	/** segment and basis of sample \c s */
+	std::size_t segment( std::size_t s, double* b ) const
+	{
+		const std::size_t nSegments = m_initialRotations.size() - 3;
+		double x = std::max( 0.0, ( m_times[ s ] - m_startTime ) / m_interval );
+		std::size_t i = std::min( static_cast< std::size_t >( x ), nSegments - 1 );
+		cumulativeBasis( std::min( x - i, 1.0 ), b, 0, 0 );
+		return i;
+	}
+
+	/** rotation residual of sample \c s for the control rotations r[ 0..3 ] of its segment */
+	Vector< double, 3 > rotationResidual( std::size_t s, const Quaternion* r, const double* b ) const
+	{
+		Vector< double, 3 > d[ 3 ];
+		for ( std::size_t j = 0; j < 3; j++ )
+			d[ j ] = Quaternion( ~r[ j ] * r[ j + 1 ] ).toLogarithm();
+		return Quaternion( ~m_poses[ s ].rotation() * cumulativeRotation( r[ 0 ], d, b ) ).toLogarithm();
+	}
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		for ( std::size_t k = 0; k < m_rotations.size(); k++ )
+			m_rotations[ k ] = rotation( input, k );
+
+		double b[ 3 ];
+		for ( std::size_t s = 0; s < m_times.size(); s++ )
+		{
+			const std::size_t i = segment( s, b );
+			const double w[ 4 ] = { 1 - b[ 0 ], b[ 0 ] - b[ 1 ], b[ 1 ] - b[ 2 ], b[ 2 ] };
+			for ( std::size_t c = 0; c < 3; c++ )
+			{
+				double p = 0;
+				for ( std::size_t j = 0; j < 4; j++ )
+					p += w[ j ] * input( 6 * ( i + j ) + c );
+				result( 6 * s + c ) = p;
+			}
+			ublas::subrange( result, 6 * s + 3, 6 * s + 6 ) = rotationResidual( s, &m_rotations[ i ], b );
+		}
+	}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		evaluate( result, input );
+		jacobianFromRotations( J );
+	}
+
+	template< class VT2, class MT >
+	void jacobian( const VT2& input, MT& J ) const
+	{
+		for ( std::size_t k = 0; k < m_rotations.size(); k++ )
+			m_rotations[ k ] = rotation( input, k );
+		jacobianFromRotations( J );
+	}
+
+protected:
+	/** the positions are linear in the parameters, the rotations are differentiated numerically */
+	template< class MT >
+	void jacobianFromRotations( MT& J ) const
+	{
+		const double h = 1e-6;
+		J.clear();
+		double b[ 3 ];
+		for ( std::size_t s = 0; s < m_times.size(); s++ )
+		{
+			const std::size_t i = segment( s, b );
+			const double w[ 4 ] = { 1 - b[ 0 ], b[ 0 ] - b[ 1 ], b[ 1 ] - b[ 2 ], b[ 2 ] };
+			for ( std::size_t j = 0; j < 4; j++ )
+				for ( std::size_t c = 0; c < 3; c++ )
+					J( 6 * s + c, 6 * ( i + j ) + c ) = w[ j ];
+
+			Quaternion r[ 4 ];
+			std::copy( m_rotations.begin() + i, m_rotations.begin() + i + 4, r );
+			for ( std::size_t j = 0; j < 4; j++ )
+				for ( std::size_t c = 0; c < 3; c++ )
+				{
+					Vector< double, 3 > delta( 0, 0, 0 );
+					delta( c ) = h;
+					r[ j ] = m_rotations[ i + j ] * Quaternion::fromLogarithm( delta );
+					const Vector< double, 3 > plus( rotationResidual( s, r, b ) );
+					delta( c ) = -h;
+					r[ j ] = m_rotations[ i + j ] * Quaternion::fromLogarithm( delta );
+					const Vector< double, 3 > minus( rotationResidual( s, r, b ) );
+					r[ j ] = m_rotations[ i + j ];
+					for ( std::size_t row = 0; row < 3; row++ )
+						J( 6 * s + 3 + row, 6 * ( i + j ) + 3 + c ) = ( plus( row ) - minus( row ) ) / ( 2 * h );
+				}
+		}
+	}
+
+	const std::vector< double >& m_times;
+	const std::vector< Pose >& m_poses;
+	const std::vector< Quaternion >& m_initialRotations;
+	double m_startTime;
+	double m_interval;
+	mutable std::vector< Quaternion > m_rotations;
+};
+
+/** the sample pose at time \c t, interpolated linearly and clamped to the samples */
+Pose interpolateSamples( const std::vector< double >& times, const std::vector< Pose >& poses, double t )
+{
+	const std::size_t k = std::lower_bound( times.begin(), times.end(), t ) - times.begin();
+	if ( k == 0 )
+		return poses.front();
+	if ( k == times.size() )
+		return poses.back();
+	const double span = times[ k ] - times[ k - 1 ];
+	return linearInterpolate( poses[ k - 1 ], poses[ k ], span > 0 ? ( t - times[ k - 1 ] ) / span : 0.0 );
+}
+
+} // anonymous namespace
+
+
+PoseSpline PoseSpline::fit( const std::vector< double >& times, const std::vector< Pose >& poses, double interval,
+	std::size_t iterations )
+{
+	if ( times.size() != poses.size() || times.size() < 2 )
+		UBITRACK_THROW( "Pose spline fit needs at least two samples with times" );
+	if ( !( interval > 0 ) )
+		UBITRACK_THROW( "Pose spline interval must be positive" );
+
+	const double startTime = times.front();
+	const std::size_t nSegments = std::max< std::size_t >( 1,
+		static_cast< std::size_t >( std::ceil( ( times.back() - startTime ) / interval - 1e-9 ) ) );
+	const std::size_t nControl = nSegments + 3;
+
+	// initial control poses from the samples
+	std::vector< Quaternion > initialRotations( nControl );
+	Vector< double > params( 6 * nControl );
+	params.clear();
+	for ( std::size_t k = 0; k < nControl; k++ )
+	{
+		const Pose p( interpolateSamples( times, poses, startTime + ( double( k ) - 1 ) * interval ) );
+		initialRotations[ k ] = p.rotation();
+		ublas::subrange( params, 6 * k, 6 * k + 3 ) = p.translation();
+	}
+
+	Vector< double > measurement( 6 * times.size() );
+	measurement.clear();
+	for ( std::size_t s = 0; s < times.size(); s++ )
+		ublas::subrange( measurement, 6 * s, 6 * s + 3 ) = poses[ s ].translation();
+
+	SplineFitProblem problem( times, poses, initialRotations, startTime, interval );
+	Optimization::levenbergMarquardt( problem, params, measurement,
+		Optimization::OptTerminate( iterations, 1e-12 ), Optimization::OptNoNormalize() );
+
+	std::vector< Pose > control( nControl );
+	for ( std::size_t k = 0; k < nControl; k++ )
+		control[ k ] = Pose( problem.rotation( params, k ), Vector< double, 3 >( ublas::subrange( params, 6 * k, 6 * k + 3 ) ) );
+	return PoseSpline( startTime, interval, control );
+}
+
+#endif // HAVE_LAPACK
+
+} } // namespace Ubitrack::Math
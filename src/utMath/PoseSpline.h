@@ -0,0 +1,158 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup math
+ * @file
+ * Continuous-time pose trajectory as cumulative cubic B-spline
+ */
+
+#ifndef __UBITRACK_MATH_POSESPLINE_H_INCLUDED__
+#define __UBITRACK_MATH_POSESPLINE_H_INCLUDED__
+
+#include <vector>
+
+#include <utCore.h>
+#include "Vector.h"
+#include "Quaternion.h"
+#include "Pose.h"
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * @ingroup math
+ * A pose trajectory on R3 x SO(3), represented by a uniform cumulative cubic B-spline.
+ *
+ * Control pose \c k belongs to the time <tt>startTime + ( k - 1 ) * interval</tt>, and the pose
+ * at time \c t with <tt>u = ( t - startTime ) / interval - i</tt> in segment \c i is
+ * <pre>
+ * p( t ) = p_i + sum_j=1..3 B_j( u ) ( p_i+j - p_i+j-1 )
+ * R( t ) = R_i prod_j=1..3 Exp( B_j( u ) Log( R_i+j-1^-1 R_i+j ) )
+ * </pre>
+ * with the cumulative basis functions \c B_j. Unlike \c linearInterpolate between neighbouring
+ * samples this needs no search, is twice continuously differentiable and gives velocities and
+ * accelerations in closed form. The logarithms of the control increments are computed when the
+ * control poses are set, so an evaluation costs three quaternion exponentials.
+ *
+ * Each segment depends on four control poses, so a spline with \c n control poses is defined
+ * between \c startTime and <tt>startTime + ( n - 3 ) * interval</tt>. Times outside of this
+ * range are clamped.
+ *
+ * Times are given in seconds, relative to any origin, e.g. <tt>( t - t0 ) * 1e-9</tt> for
+ * \c Measurement::Timestamp values.
+ */
+class UBITRACK_EXPORT PoseSpline
+{
+public:
+	/** constructs an empty spline */
+	PoseSpline();
+
+	/**
+	 * Constructs a spline from control poses.
+	 * @param startTime start of the first segment in seconds
+	 * @param interval time between two control poses in seconds
+	 * @param controlPoses at least four control poses
+	 * @throws Util::Exception if the interval is not positive or there are less than four control poses
+	 */
+	PoseSpline( double startTime, double interval, const std::vector< Pose >& controlPoses );
+
+	/** replaces the control poses, keeping start time and interval */
+	void setControlPoses( const std::vector< Pose >& controlPoses );
+
+	/** the control poses */
+	const std::vector< Pose >& controlPoses() const
+	{ return m_controlPoses; }
+
+	/** start of the valid time range */
+	double startTime() const
+	{ return m_startTime; }
+
+	/** end of the valid time range */
+	double endTime() const
+	{ return m_startTime + m_interval * ( m_controlPoses.size() < 3 ? 0 : m_controlPoses.size() - 3 ); }
+
+	/** time between two control poses */
+	double interval() const
+	{ return m_interval; }
+
+	/** evaluates the pose at time \c t */
+	Pose evaluate( double t ) const;
+
+	/**
+	 * Evaluates the pose and its derivatives at time \c t.
+	 * @param t the time in seconds
+	 * @param pose the pose
+	 * @param velocity linear velocity in world coordinates
+	 * @param acceleration linear acceleration in world coordinates
+	 * @param angularVelocity angular velocity in body coordinates, as \c RotationVelocity
+	 * @param angularAcceleration derivative of \c angularVelocity
+	 */
+	void evaluate( double t, Pose& pose, Vector< double, 3 >& velocity, Vector< double, 3 >& acceleration,
+		Vector< double, 3 >& angularVelocity, Vector< double, 3 >& angularAcceleration ) const;
+
+	/**
+	 * Evaluates the poses at many times.
+	 * @param times \c n times in seconds
+	 * @param n number of times
+	 * @param poses array of \c n poses that receives the result
+	 */
+	void evaluate( const double* times, std::size_t n, Pose* poses ) const;
+
+	/** same as above for vectors, resizes \c poses */
+	void evaluate( const std::vector< double >& times, std::vector< Pose >& poses ) const;
+
+#ifdef HAVE_LAPACK
+	/**
+	 * Fits a spline to pose samples with the levenberg-marquardt optimizer, minimizing the
+	 * squared position differences plus the squared rotation angles between the spline and the
+	 * samples. The initial control poses are interpolated from the samples.
+	 * @param times the sample times in seconds, sorted
+	 * @param poses the pose samples
+	 * @param interval time between two control poses, should cover several samples
+	 * @param iterations maximum number of optimizer iterations
+	 * @return the spline covering the time range of the samples
+	 * @throws Util::Exception if there are less than two samples or the sizes do not match
+	 */
+	static PoseSpline fit( const std::vector< double >& times, const std::vector< Pose >& poses, double interval,
+		std::size_t iterations = 10 );
+#endif
+
+protected:
+	/// @internal finds the segment and the position \c u in it
+	std::size_t segment( double t, double& u ) const;
+
+	/// @internal logarithms of the rotation increments
+	void updateIncrements();
+
+	double m_startTime;
+	double m_interval;
+	std::vector< Pose > m_controlPoses;
+
+	/// Log( R_k-1^-1 R_k ), the first entry is unused
+	std::vector< Vector< double, 3 > > m_rotationIncrements;
+};
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_POSESPLINE_H_INCLUDED__
@@ -0,0 +1,312 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Products of chains of small fixed-size matrices.
+ *
+ * Chains like <tt>K * R * [R|t] * x</tt> are usually written as nested \c ublas::prod
+ * calls, which evaluate left to right and store a full temporary matrix after every
+ * step. \c productChain multiplies three or four factors whose dimensions are known at
+ * compile time. It picks the association order with the fewest multiplications (the
+ * classic matrix-chain ordering, solved at compile time) and evaluates each three
+ * factor chain in a single kernel that only keeps one row or column of the
+ * intermediate product on the stack:
+ * @code
+ * Math::Vector< double, 3 > x( Math::productChain( K, Rt, offset, p ) );
+ * @endcode
+ *
+ * The last factor may be a \c Math::Vector, which is treated as a single column.
+ * Mismatching dimensions fail to compile. \c productChainInto writes into an existing
+ * result, which must not alias any of the factors.
+ */
+
+#ifndef __UBITRACK_MATH_PRODUCTCHAIN_H_INCLUDED__
+#define __UBITRACK_MATH_PRODUCTCHAIN_H_INCLUDED__
+
+#include <boost/static_assert.hpp>
+
+#include "Util/type_traits.h"
+#include "Vector.h"
+#include "Matrix.h"
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * Association order of the chain A * B * C with dimensions
+ * ( M x K ) * ( K x L ) * ( L x N ).
+ */
+template< std::size_t M, std::size_t K, std::size_t L, std::size_t N >
+struct ChainOrder3
+{
+	enum {
+		/// multiplications of ( A * B ) * C
+		leftCost = M * K * L + M * L * N,
+
+		/// multiplications of A * ( B * C )
+		rightCost = K * L * N + M * K * N,
+
+		/// nonzero if A * ( B * C ) is evaluated
+		rightFirst = rightCost < leftCost,
+
+		/// multiplications of the chosen order
+		cost = rightFirst ? rightCost : leftCost
+	};
+};
+
+
+/**
+ * Association order of the chain A * B * C * D with dimensions
+ * ( M x K ) * ( K x L ) * ( L x P ) * ( P x N ).
+ *
+ * The chain is split once at the outer level, the three factor part (if any) is
+ * then ordered by \c ChainOrder3.
+ */
+template< std::size_t M, std::size_t K, std::size_t L, std::size_t P, std::size_t N >
+struct ChainOrder4
+{
+	enum {
+		/// multiplications of A * ( B * C * D )
+		cost1 = ChainOrder3< K, L, P, N >::cost + M * K * N,
+
+		/// multiplications of ( A * B ) * ( C * D )
+		cost2 = M * K * L + L * P * N + M * L * N,
+
+		/// multiplications of ( A * B * C ) * D
+		cost3 = ChainOrder3< M, K, L, P >::cost + M * P * N,
+
+		/// number of leading factors before the outer split (1, 2 or 3)
+		split = ( cost1 <= cost2 && cost1 <= cost3 ) ? 1 : ( cost2 <= cost3 ? 2 : 3 ),
+
+		/// multiplications of the chosen order
+		cost = split == 1 ? cost1 : ( split == 2 ? cost2 : cost3 )
+	};
+};
+
+
+namespace Detail {
+
+/// @internal uniform element access to matrices and to vectors as single columns
+template< class X >
+struct ChainOperand;
+
+/// @internal matrix factor
+template< typename T, std::size_t R, std::size_t C >
+struct ChainOperand< Matrix< T, R, C > >
+{
+	enum { rows = R, cols = C };
+
+	/// type of a product with this factor at the end of the chain and N rows
+	template< std::size_t N >
+	struct result
+	{ typedef Matrix< T, N, C > type; };
+
+	static T get( const Matrix< T, R, C >& x, const std::size_t i, const std::size_t j )
+	{ return x( i, j ); }
+
+	static T& ref( Matrix< T, R, C >& x, const std::size_t i, const std::size_t j )
+	{ return x( i, j ); }
+};
+
+/// @internal vector factor
+template< typename T, std::size_t R >
+struct ChainOperand< Vector< T, R > >
+{
+	enum { rows = R, cols = 1 };
+
+	template< std::size_t N >
+	struct result
+	{ typedef Vector< T, N > type; };
+
+	static T get( const Vector< T, R >& x, const std::size_t i, const std::size_t )
+	{ return x( i ); }
+
+	static T& ref( Vector< T, R >& x, const std::size_t i, const std::size_t )
+	{ return x( i ); }
+};
+
+/// @internal product of two factors, r = a * b
+template< typename T, std::size_t M, std::size_t K, class B, class R >
+inline void chainMultiply( const Matrix< T, M, K >& a, const B& b, R& r )
+{
+	typedef ChainOperand< B > OpB;
+	for ( std::size_t j = 0; j < OpB::cols; j++ )
+		for ( std::size_t i = 0; i < M; i++ )
+		{
+			T sum = a( i, 0 ) * OpB::get( b, 0, j );
+			for ( std::size_t k = 1; k < K; k++ )
+				sum += a( i, k ) * OpB::get( b, k, j );
+			ChainOperand< R >::ref( r, i, j ) = sum;
+		}
+}
+
+/// @internal fused A * ( B * C ), keeps one column of B * C
+template< typename T, std::size_t M, std::size_t K, std::size_t L, class C, class R >
+inline void chainMultiply( const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const C& c, R& r, const Ubitrack::Util::true_type )
+{
+	typedef ChainOperand< C > OpC;
+	T t[ K ];
+	for ( std::size_t j = 0; j < OpC::cols; j++ )
+	{
+		for ( std::size_t k = 0; k < K; k++ )
+		{
+			T sum = b( k, 0 ) * OpC::get( c, 0, j );
+			for ( std::size_t l = 1; l < L; l++ )
+				sum += b( k, l ) * OpC::get( c, l, j );
+			t[ k ] = sum;
+		}
+		for ( std::size_t i = 0; i < M; i++ )
+		{
+			T sum = a( i, 0 ) * t[ 0 ];
+			for ( std::size_t k = 1; k < K; k++ )
+				sum += a( i, k ) * t[ k ];
+			ChainOperand< R >::ref( r, i, j ) = sum;
+		}
+	}
+}
+
+/// @internal fused ( A * B ) * C, keeps one row of A * B
+template< typename T, std::size_t M, std::size_t K, std::size_t L, class C, class R >
+inline void chainMultiply( const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const C& c, R& r, const Ubitrack::Util::false_type )
+{
+	typedef ChainOperand< C > OpC;
+	T u[ L ];
+	for ( std::size_t i = 0; i < M; i++ )
+	{
+		for ( std::size_t l = 0; l < L; l++ )
+		{
+			T sum = a( i, 0 ) * b( 0, l );
+			for ( std::size_t k = 1; k < K; k++ )
+				sum += a( i, k ) * b( k, l );
+			u[ l ] = sum;
+		}
+		for ( std::size_t j = 0; j < OpC::cols; j++ )
+		{
+			T sum = u[ 0 ] * OpC::get( c, 0, j );
+			for ( std::size_t l = 1; l < L; l++ )
+				sum += u[ l ] * OpC::get( c, l, j );
+			ChainOperand< R >::ref( r, i, j ) = sum;
+		}
+	}
+}
+
+} // namespace Detail
+
+
+/**
+ * Computes r = a * b * c in the cheaper association order.
+ *
+ * @param a first factor, M x K
+ * @param b second factor, K x L
+ * @param c last factor, L x N matrix or L-vector
+ * @param r the result, M x N matrix or M-vector, must not alias a factor
+ */
+template< typename T, std::size_t M, std::size_t K, std::size_t L, class C >
+inline void productChainInto( const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const C& c,
+	typename Detail::ChainOperand< C >::template result< M >::type& r )
+{
+	BOOST_STATIC_ASSERT( Detail::ChainOperand< C >::rows == L );
+	Detail::chainMultiply( a, b, c, r, typename Ubitrack::Util::constant_value< bool,
+		ChainOrder3< M, K, L, Detail::ChainOperand< C >::cols >::rightFirst != 0 >::type() );
+}
+
+/** returns a * b * c, see above */
+template< typename T, std::size_t M, std::size_t K, std::size_t L, class C >
+inline typename Detail::ChainOperand< C >::template result< M >::type productChain(
+	const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const C& c )
+{
+	typename Detail::ChainOperand< C >::template result< M >::type r;
+	productChainInto( a, b, c, r );
+	return r;
+}
+
+
+namespace Detail {
+
+/// @internal A * ( B * C * D )
+template< typename T, std::size_t M, std::size_t K, std::size_t L, std::size_t P, class D, class R >
+inline void chainMultiply4( const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const Matrix< T, L, P >& c,
+	const D& d, R& r, const Ubitrack::Util::constant_value< std::size_t, 1 > )
+{
+	typename ChainOperand< D >::template result< K >::type t;
+	productChainInto( b, c, d, t );
+	chainMultiply( a, t, r );
+}
+
+/// @internal ( A * B ) * ( C * D )
+template< typename T, std::size_t M, std::size_t K, std::size_t L, std::size_t P, class D, class R >
+inline void chainMultiply4( const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const Matrix< T, L, P >& c,
+	const D& d, R& r, const Ubitrack::Util::constant_value< std::size_t, 2 > )
+{
+	Matrix< T, M, L > ab;
+	chainMultiply( a, b, ab );
+	typename ChainOperand< D >::template result< L >::type cd;
+	chainMultiply( c, d, cd );
+	chainMultiply( ab, cd, r );
+}
+
+/// @internal ( A * B * C ) * D
+template< typename T, std::size_t M, std::size_t K, std::size_t L, std::size_t P, class D, class R >
+inline void chainMultiply4( const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const Matrix< T, L, P >& c,
+	const D& d, R& r, const Ubitrack::Util::constant_value< std::size_t, 3 > )
+{
+	Matrix< T, M, P > abc;
+	productChainInto( a, b, c, abc );
+	chainMultiply( abc, d, r );
+}
+
+} // namespace Detail
+
+
+/**
+ * Computes r = a * b * c * d in the cheapest association order.
+ *
+ * @param a first factor, M x K
+ * @param b second factor, K x L
+ * @param c third factor, L x P
+ * @param d last factor, P x N matrix or P-vector
+ * @param r the result, M x N matrix or M-vector, must not alias a factor
+ */
+template< typename T, std::size_t M, std::size_t K, std::size_t L, std::size_t P, class D >
+inline void productChainInto( const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const Matrix< T, L, P >& c,
+	const D& d, typename Detail::ChainOperand< D >::template result< M >::type& r )
+{
+	BOOST_STATIC_ASSERT( Detail::ChainOperand< D >::rows == P );
+	Detail::chainMultiply4( a, b, c, d, r, typename Ubitrack::Util::constant_value< std::size_t,
+		ChainOrder4< M, K, L, P, Detail::ChainOperand< D >::cols >::split >::type() );
+}
+
+/** returns a * b * c * d, see above */
+template< typename T, std::size_t M, std::size_t K, std::size_t L, std::size_t P, class D >
+inline typename Detail::ChainOperand< D >::template result< M >::type productChain(
+	const Matrix< T, M, K >& a, const Matrix< T, K, L >& b, const Matrix< T, L, P >& c, const D& d )
+{
+	typename Detail::ChainOperand< D >::template result< M >::type r;
+	productChainInto( a, b, c, d, r );
+	return r;
+}
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_PRODUCTCHAIN_H_INCLUDED__
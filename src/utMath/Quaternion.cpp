@@ -25,6 +25,7 @@
 #include "Quaternion.h"
 #include <iomanip>
 #include "Matrix.h"
+#include "LieGroups.h"
 #include <boost/math/constants/constants.hpp>
 
 
@@ -228,35 +229,13 @@ Vector< double, 3 > Quaternion::operator*( const Vector< double, 3 >& vec ) cons
 
 Vector< double, 3 > Quaternion::toLogarithm() const
 {
-	// always take the quaternion with w > 0
-	double s = w() >= 0 ? 1 : -1;
-	double omega;
-	if ( w() * s < 1.0 )
-		omega = 2 * acos( w() * s );
-	else
-		omega = 0.0;
-	
-	double imagLen = sqrt( x()*x() + y()*y() + z()*z() );
-	if ( imagLen > 1e-12 )
-	{
-		s = s * omega / imagLen;
-		return Vector< double, 3 >( x() * s, y() * s, z() * s );
-	}
-	else
-		return Vector< double, 3 >( 0, 0, 0 );
+	return Lie::logSO3( *this );
 }
 
 
 Quaternion Quaternion::fromLogarithm( const Vector< double, 3 >& v )
 {
-	double omega = boost::numeric::ublas::norm_2( v );
-	if ( omega > 1e-12 )
-	{
-		double s = sin( omega / 2 ) / omega;
-		return Quaternion( s * v( 0 ), s * v( 1 ), s * v( 2 ), cos( omega / 2 ) );
-	}
-	else
-		return Quaternion( 0, 0, 0, 1 );
+	return Lie::SO3Terms< double >( v ).quaternion();
 }
 
 
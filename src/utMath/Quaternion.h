@@ -61,7 +61,7 @@ class UBITRACK_EXPORT Quaternion
 {
 	
 	friend class boost::serialization::access;
-
+
 	public:
 
 		typedef double value_type;
@@ -187,6 +187,16 @@ class UBITRACK_EXPORT Quaternion
 		template< class M >
 		void toMatrix( M& matrix ) const;
 
+		/**
+		 * sets the rotation of a given matrix from a quaternion stored in a vector as ( x, y, z, w ),
+		 * see \c fromVector. Other than <tt>fromVector( v ).toMatrix( matrix )</tt> everything is
+		 * computed in the element type of the matrix, e.g. for \c float parameter vectors.
+		 * @param v vector containing the quaternion
+		 * @param matrix a boost::numeric::ublas::matrix, where the rotation will be set
+		 */
+		template< class VType, class M >
+		static void vectorToMatrix( const VType& v, M& matrix );
+
 		/**
 		 * sets the given axis-angle parameters to represent the value of this quaternion.
 		 * Note: Call normalize() in case of doubt for proper operation.
@@ -288,13 +298,21 @@ UBITRACK_EXPORT std::ostream& operator<<( std::ostream& s, const Quaternion& q )
 
 template< class M >
 void Quaternion::toMatrix( M& matrix ) const
+{
+	typedef typename M::value_type T;
+	vectorToMatrix( Vector< T, 4 >( T( x() ), T( y() ), T( z() ), T( w() ) ), matrix );
+}
+
+
+template< class VType, class M >
+void Quaternion::vectorToMatrix( const VType& v, M& matrix )
 {
 	typedef typename M::value_type T;
 
-	T X = T( x() );
-	T Y = T( y() );
-	T Z = T( z() );
-	T W = T( w() );
+	T X = T( v( 0 ) );
+	T Y = T( v( 1 ) );
+	T Z = T( v( 2 ) );
+	T W = T( v( 3 ) );
 
 	T xx = X * X;
 	T xy = X * Y;
@@ -0,0 +1,372 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Fast random number engine with per-thread instances and bulk generation
+ */
+
+#include "Engine.h"
+#include <utMath/Util/simd_traits.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <boost/math/constants/constants.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace Ubitrack { namespace Math { namespace Random {
+
+namespace {
+
+inline boost::uint64_t rotl( const boost::uint64_t x, const int k )
+{
+	return ( x << k ) | ( x >> ( 64 - k ) );
+}
+
+/// splitmix64, expands the seed into the state
+inline boost::uint64_t splitMix( boost::uint64_t& x )
+{
+	boost::uint64_t z = ( x += 0x9e3779b97f4a7c15ULL );
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+	return z ^ ( z >> 31 );
+}
+
+/// jump polynomials for 2^128 and 2^192 steps
+const boost::uint64_t g_jump[ 4 ] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+const boost::uint64_t g_longJump[ 4 ] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+
+/// uniform double in [ 0, 1 ) from the upper 52 bits, by setting the mantissa of a number in [ 1, 2 )
+inline double toUnitDouble( const boost::uint64_t x )
+{
+	const boost::uint64_t bits = ( x >> 12 ) | 0x3ff0000000000000ULL;
+	double d;
+	std::memcpy( &d, &bits, sizeof( d ) );
+	return d - 1.0;
+}
+
+/// uniform float in [ 0, 1 ) from the upper 23 of 32 bits
+inline float toUnitFloat( const boost::uint32_t x )
+{
+	const boost::uint32_t bits = ( x >> 9 ) | 0x3f800000u;
+	float f;
+	std::memcpy( &f, &bits, sizeof( f ) );
+	return f - 1.0f;
+}
+
+/// values[ i ] = values[ i ] * factor + offset with the SIMD packs
+template< typename T >
+void scale( T* values, const std::size_t n, const T factor, const T offset )
+{
+	typedef Math::Util::simd_pack< T > Pack;
+	const typename Pack::type f = Pack::set1( factor );
+	const typename Pack::type o = Pack::set1( offset );
+	std::size_t i = 0;
+	for ( ; i + Pack::size <= n; i += Pack::size )
+		Pack::store( values + i, Pack::add( Pack::mul( Pack::load( values + i ), f ), o ) );
+	for ( ; i < n; i++ )
+		values[ i ] = values[ i ] * factor + offset;
+}
+
+/**
+ * Box-Muller transform of pairs of uniform numbers in [ 0, 1 ) into pairs of standard normal
+ * numbers: r = sqrt( -2 log( 1 - u ) ), the logarithm stays scalar, the square root uses the packs.
+ */
+template< typename T >
+void boxMuller( T* values, const std::size_t pairs )
+{
+	const T twoPi = boost::math::constants::two_pi< T >();
+	T* radius = values;
+	T* angle = values + pairs;
+	for ( std::size_t i = 0; i < pairs; i++ )
+		radius[ i ] = T( -2 ) * std::log( T( 1 ) - radius[ i ] );
+
+	typedef Math::Util::simd_pack< T > Pack;
+	std::size_t i = 0;
+	for ( ; i + Pack::size <= pairs; i += Pack::size )
+		Pack::store( radius + i, Pack::sqrt( Pack::load( radius + i ) ) );
+	for ( ; i < pairs; i++ )
+		radius[ i ] = std::sqrt( radius[ i ] );
+
+	for ( std::size_t k = 0; k < pairs; k++ )
+	{
+		const T r = radius[ k ];
+		const T a = twoPi * angle[ k ];
+		radius[ k ] = r * std::cos( a );
+		angle[ k ] = r * std::sin( a );
+	}
+}
+
+Engine g_master;
+boost::mutex g_masterMutex;
+boost::thread_specific_ptr< Engine > g_threadEngine;
+
+} // anonymous namespace
+
+
+Engine::Engine( const boost::uint64_t s )
+{
+	seed( s );
+}
+
+
+Engine::Engine( const boost::uint64_t s, const std::size_t stream )
+{
+	seed( s );
+	for ( std::size_t i = 0; i < stream; i++ )
+		jump( g_longJump );
+}
+
+
+void Engine::seed( const boost::uint64_t s )
+{
+	// the first stream from splitmix64, every further one 2^128 steps behind its predecessor
+	boost::uint64_t x = s;
+	for ( std::size_t w = 0; w < 4; w++ )
+		std::fill( m_state[ w ], m_state[ w ] + lanes, splitMix( x ) );
+	for ( std::size_t l = 1; l < lanes; l++ )
+		jump( g_jump, l );
+	m_next = lanes;
+}
+
+
+void Engine::step( result_type* out )
+{
+	// independent streams, written as loops over the lanes so they can be vectorized
+	result_type* s0 = m_state[ 0 ];
+	result_type* s1 = m_state[ 1 ];
+	result_type* s2 = m_state[ 2 ];
+	result_type* s3 = m_state[ 3 ];
+	for ( std::size_t l = 0; l < lanes; l++ )
+		out[ l ] = rotl( s1[ l ] * 5, 7 ) * 9;
+	for ( std::size_t l = 0; l < lanes; l++ )
+	{
+		const result_type t = s1[ l ] << 17;
+		s2[ l ] ^= s0[ l ];
+		s3[ l ] ^= s1[ l ];
+		s1[ l ] ^= s2[ l ];
+		s0[ l ] ^= s3[ l ];
+		s2[ l ] ^= t;
+		s3[ l ] = rotl( s3[ l ], 45 );
+	}
+}
+
+
+void Engine::jump( const boost::uint64_t* polynomial, const std::size_t firstLane )
+{
+	result_type jumped[ 4 ][ lanes ];
+	std::memset( jumped, 0, sizeof( jumped ) );
+	result_type discard[ lanes ];
+	for ( std::size_t i = 0; i < 4; i++ )
+		for ( int b = 0; b < 64; b++ )
+		{
+			if ( polynomial[ i ] & ( boost::uint64_t( 1 ) << b ) )
+				for ( std::size_t w = 0; w < 4; w++ )
+					for ( std::size_t l = 0; l < lanes; l++ )
+						jumped[ w ][ l ] ^= m_state[ w ][ l ];
+			step( discard );
+		}
+	for ( std::size_t w = 0; w < 4; w++ )
+		std::copy( jumped[ w ] + firstLane, jumped[ w ] + lanes, m_state[ w ] + firstLane );
+	m_next = lanes;
+}
+
+
+Engine Engine::split()
+{
+	Engine current( *this );
+	jump( g_longJump );
+	return current;
+}
+
+
+double Engine::uniform01()
+{
+	return toUnitDouble( ( *this )() );
+}
+
+
+Engine::result_type Engine::below( const result_type n )
+{
+	// rejection of the incomplete last interval
+	const result_type limit = max() - max() % n;
+	result_type x;
+	do
+		x = ( *this )();
+	while ( x >= limit );
+	return x % n;
+}
+
+
+void Engine::fill( result_type* out, const std::size_t n )
+{
+	std::size_t i = 0;
+	for ( ; i < n && m_next < lanes; i++ )
+		out[ i ] = m_buffer[ m_next++ ];
+	for ( ; i + lanes <= n; i += lanes )
+		step( out + i );
+	for ( ; i < n; i++ )
+		out[ i ] = ( *this )();
+}
+
+
+void Engine::uniform( double* out, const std::size_t n, const double min, const double max )
+{
+	result_type bits[ 64 ];
+	for ( std::size_t i = 0; i < n; i += 64 )
+	{
+		const std::size_t m = std::min< std::size_t >( 64, n - i );
+		fill( bits, m );
+		for ( std::size_t j = 0; j < m; j++ )
+			out[ i + j ] = toUnitDouble( bits[ j ] );
+	}
+	scale( out, n, max - min, min );
+}
+
+
+void Engine::uniform( float* out, const std::size_t n, const float min, const float max )
+{
+	// two floats from every 64 bit number
+	result_type bits[ 64 ];
+	for ( std::size_t i = 0; i < n; i += 128 )
+	{
+		const std::size_t m = std::min< std::size_t >( 128, n - i );
+		fill( bits, ( m + 1 ) / 2 );
+		for ( std::size_t j = 0; j < m; j++ )
+			out[ i + j ] = toUnitFloat( boost::uint32_t( bits[ j / 2 ] >> ( 32 * ( j % 2 ) ) ) );
+	}
+	scale( out, n, max - min, min );
+}
+
+
+void Engine::normal( double* out, const std::size_t n, const double mu, const double sigma )
+{
+	const std::size_t pairs = n / 2;
+	uniform( out, 2 * pairs );
+	boxMuller( out, pairs );
+	if ( n % 2 )
+	{
+		double last[ 2 ];
+		uniform( last, 2 );
+		boxMuller( last, 1 );
+		out[ n - 1 ] = last[ 0 ];
+	}
+	scale( out, n, sigma, mu );
+}
+
+
+void Engine::normal( float* out, const std::size_t n, const float mu, const float sigma )
+{
+	const std::size_t pairs = n / 2;
+	uniform( out, 2 * pairs );
+	boxMuller( out, pairs );
+	if ( n % 2 )
+	{
+		float last[ 2 ];
+		uniform( last, 2 );
+		boxMuller( last, 1 );
+		out[ n - 1 ] = last[ 0 ];
+	}
+	scale( out, n, sigma, mu );
+}
+
+
+void Engine::quaternions( Math::Quaternion* out, const std::size_t n )
+{
+	// uniform unit quaternions from three uniform numbers, see http://planning.cs.uiuc.edu/node198.html
+	if ( !n )
+		return;
+	std::vector< double > u( 5 * n );
+	uniform( &u[ 0 ], 3 * n );
+	double* x = &u[ 0 ];
+	double* rootX = &u[ 3 * n ];
+	double* rootXInv = &u[ 4 * n ];
+	for ( std::size_t i = 0; i < n; i++ )
+		rootXInv[ i ] = 1.0 - x[ i ];
+	std::copy( x, x + n, rootX );
+
+	typedef Math::Util::simd_pack< double > Pack;
+	std::size_t i = 0;
+	for ( ; i + Pack::size <= 2 * n; i += Pack::size )
+		Pack::store( rootX + i, Pack::sqrt( Pack::load( rootX + i ) ) );
+	for ( ; i < 2 * n; i++ )
+		rootX[ i ] = std::sqrt( rootX[ i ] );
+
+	const double twoPi = boost::math::constants::two_pi< double >();
+	const double* y = x + n;
+	const double* z = x + 2 * n;
+	for ( std::size_t k = 0; k < n; k++ )
+	{
+		const double piy2 = twoPi * y[ k ];
+		const double piz2 = twoPi * z[ k ];
+		out[ k ] = Math::Quaternion( rootXInv[ k ] * std::sin( piy2 ), rootXInv[ k ] * std::cos( piy2 ),
+			rootX[ k ] * std::sin( piz2 ), rootX[ k ] * std::cos( piz2 ) );
+	}
+}
+
+
+void Engine::poses( Math::Pose* out, const std::size_t n, const double min, const double max )
+{
+	if ( !n )
+		return;
+	std::vector< Math::Quaternion > rotations( n );
+	quaternions( &rotations[ 0 ], n );
+	std::vector< double > translations( 3 * n );
+	uniform( &translations[ 0 ], 3 * n, min, max );
+	for ( std::size_t i = 0; i < n; i++ )
+		out[ i ] = Math::Pose( rotations[ i ],
+			Math::Vector< double, 3 >( translations[ 3 * i ], translations[ 3 * i + 1 ], translations[ 3 * i + 2 ] ) );
+}
+
+
+Engine& threadEngine()
+{
+	Engine* e = g_threadEngine.get();
+	if ( !e )
+	{
+		boost::mutex::scoped_lock lock( g_masterMutex );
+		e = new Engine( g_master.split() );
+		g_threadEngine.reset( e );
+	}
+	return *e;
+}
+
+
+void seed( const boost::uint64_t s )
+{
+	threadEngine().seed( s );
+}
+
+
+void seedThreads( const boost::uint64_t s )
+{
+	boost::mutex::scoped_lock lock( g_masterMutex );
+	g_master.seed( s );
+}
+
+}}} // namespace Ubitrack::Math::Random
@@ -0,0 +1,165 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Fast random number engine with per-thread instances and bulk generation
+ *
+ * \c Random::Engine is a xoshiro256** generator (Blackman and Vigna) that runs several
+ * independent streams side by side, so one step produces a small block of numbers and the
+ * compiler can vectorize the state update. The bulk functions fill whole arrays with
+ * uniform or normal variates, random unit quaternions or random poses; the conversions and
+ * scalings use the SIMD packs of utMath.
+ *
+ * Every thread has its own engine, returned by \c threadEngine(), which is used by the
+ * functions and functors in Scalar.h, Vector.h, Rotation.h etc. The engines of new threads are
+ * split off a common master engine, so they produce non-overlapping sequences:
+ * @code
+ * Math::Random::seed( 42 );                      // reproducible numbers on this thread
+ * std::vector< double > noise( 100000 );
+ * Math::Random::threadEngine().normal( &noise[ 0 ], noise.size(), 0.0, 0.01 );
+ *
+ * Math::Random::Engine worker( Math::Random::threadEngine().split() ); // an independent stream
+ * @endcode
+ * The engine can also be used as generator of the boost random distributions.
+ */
+
+#ifndef __UBITRACK_MATH_RANDOM_ENGINE_H_INCLUDED__
+#define __UBITRACK_MATH_RANDOM_ENGINE_H_INCLUDED__
+
+#include <utCore.h>
+#include <utMath/Pose.h>
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+namespace Ubitrack { namespace Math { namespace Random {
+
+/**
+ * @ingroup math
+ * xoshiro256** random number engine with \c lanes interleaved streams.
+ *
+ * The streams of one engine are 2^128 numbers apart, \c split moves the engine 2^192
+ * numbers ahead and returns the previous state, so engines created by splitting never overlap.
+ */
+class UBITRACK_EXPORT Engine
+{
+public:
+	typedef boost::uint64_t result_type;
+
+	/// number of interleaved streams
+	static const std::size_t lanes = 4;
+
+	/** creates an engine, whose state is derived from \c seed */
+	explicit Engine( const boost::uint64_t seed = 0 );
+
+	/** creates the engine of \c seed after \c stream calls of \c split, e.g. for worker \c stream */
+	Engine( const boost::uint64_t seed, const std::size_t stream );
+
+	/** restarts the engine with a new seed */
+	void seed( const boost::uint64_t seed );
+
+	/** next 64 random bits */
+	result_type operator()()
+	{
+		if ( m_next == lanes )
+			refill();
+		return m_buffer[ m_next++ ];
+	}
+
+	static result_type min()
+	{ return 0; }
+
+	static result_type max()
+	{ return ~result_type( 0 ); }
+
+	/** returns the current engine and moves this one to an independent stream */
+	Engine split();
+
+	/** uniformly distributed number in [ 0, 1 ) */
+	double uniform01();
+
+	/** uniformly distributed integer in [ 0, n ), n > 0 */
+	result_type below( const result_type n );
+
+	/** fills \c n 64 bit numbers */
+	void fill( result_type* out, const std::size_t n );
+
+	/** fills \c n uniformly distributed numbers in [ min, max ) */
+	void uniform( double* out, const std::size_t n, const double min = 0, const double max = 1 );
+	void uniform( float* out, const std::size_t n, const float min = 0, const float max = 1 );
+
+	/** fills \c n normally distributed numbers */
+	void normal( double* out, const std::size_t n, const double mu = 0, const double sigma = 1 );
+	void normal( float* out, const std::size_t n, const float mu = 0, const float sigma = 1 );
+
+	/** fills \c n uniformly distributed unit quaternions */
+	void quaternions( Math::Quaternion* out, const std::size_t n );
+
+	/** fills \c n poses with uniformly distributed rotations and translations in [ min, max ) */
+	void poses( Math::Pose* out, const std::size_t n, const double min, const double max );
+
+protected:
+	/// advances all streams and writes one number per stream
+	void step( result_type* out );
+
+	void refill()
+	{
+		step( m_buffer );
+		m_next = 0;
+	}
+
+	/// applies a jump polynomial to the streams from \c firstLane on
+	void jump( const boost::uint64_t* polynomial, const std::size_t firstLane = 0 );
+
+	/// the four state words of every stream
+	result_type m_state[ 4 ][ lanes ];
+
+	/// numbers of the last step that have not been returned yet
+	result_type m_buffer[ lanes ];
+	std::size_t m_next;
+};
+
+
+/**
+ * @ingroup math
+ * the engine of the calling thread. On first use it is split off the master engine.
+ */
+UBITRACK_EXPORT Engine& threadEngine();
+
+/**
+ * @ingroup math
+ * seeds the engine of the calling thread
+ */
+UBITRACK_EXPORT void seed( const boost::uint64_t s );
+
+/**
+ * @ingroup math
+ * seeds the master engine, from which threads split off their engines on first use
+ */
+UBITRACK_EXPORT void seedThreads( const boost::uint64_t s );
+
+}}} // namespace Ubitrack::Math::Random
+
+#endif // __UBITRACK_MATH_RANDOM_ENGINE_H_INCLUDED__
@@ -43,7 +43,6 @@
 	#include <boost/random/uniform_01.hpp>
 	#include <boost/random/uniform_int.hpp>
 	#include <boost/random/uniform_real.hpp>
-	#include <boost/random/mersenne_twister.hpp>
 	#include <boost/random/variate_generator.hpp>
 	#include <boost/random/normal_distribution.hpp>
 #else
@@ -53,14 +52,10 @@
 
 
 #include <utUtil/StaticAssert.h>
+#include "Engine.h"
 
 namespace Ubitrack { namespace Math { namespace Random {
 
-#ifdef RANDOM_BOOST
-/// Random Number Generator used every call
-static boost::mt19937 RNG; 
-#endif
-
 /** 
  * Function that produces a one dimensional random number of a given normal distribution.
  *
@@ -74,7 +69,7 @@ T distribute_normal( const T mu , const T sigma )
 {
 #ifdef RANDOM_BOOST
 	boost::normal_distribution< T > normalDist( mu, sigma ); //Normal (=Gaussian) distribution
-	boost::variate_generator< boost::mt19937&, boost::normal_distribution< T > > Generator( RNG, normalDist );
+	boost::variate_generator< Engine&, boost::normal_distribution< T > > Generator( threadEngine(), normalDist );
 	return Generator();
 #else
 	UBITRACK_STATIC_ASSERT( true == false, FUNCTION_NOT_IMPLEMENTED_YET );
@@ -98,7 +93,7 @@ inline T distribute_uniform( const T min, const T max )
 {
 #ifdef RANDOM_BOOST
 	boost::uniform_int< T > uniformDist( min, max ); // Uniform distribution
-	boost::variate_generator < boost::mt19937&, boost::uniform_int< T > > Generator( RNG, uniformDist );
+	boost::variate_generator < Engine&, boost::uniform_int< T > > Generator( threadEngine(), uniformDist );
 	return Generator();
 #else
 	/// @todo: change this, it will not work the way it is
@@ -114,7 +109,7 @@ inline float distribute_uniform< float >( const float min, const float max )
 {
 #ifdef RANDOM_BOOST
 	boost::uniform_real< float > uniformDist( min, max ); // Uniform distribution
-	boost::variate_generator < boost::mt19937&, boost::uniform_real< float > > Generator( RNG, uniformDist );
+	boost::variate_generator < Engine&, boost::uniform_real< float > > Generator( threadEngine(), uniformDist );
 	return Generator();
 
 #else
@@ -130,7 +125,7 @@ inline double distribute_uniform< double >( const double min, const double max )
 {
 #ifdef RANDOM_BOOST
 	boost::uniform_real< double > uniformDist( min, max ); // Uniform distribution
-	boost::variate_generator < boost::mt19937&, boost::uniform_real< double > > Generator( RNG, uniformDist );
+	boost::variate_generator < Engine&, boost::uniform_real< double > > Generator( threadEngine(), uniformDist );
 	return Generator();
 #else
 	/// @todo: change this, right now it's no good idea for uniform distribution if boost rng is not available
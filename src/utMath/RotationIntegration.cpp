@@ -0,0 +1,140 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Integration of sampled rotation velocities
+ */
+
+#include "RotationIntegration.h"
+#include "PoseListOperations.h"
+#include "VectorFunctions.h"
+#include "LieGroups.h"
+
+#include <cmath>
+#include <vector>
+
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+
+#include <utUtil/Exception.h>
+
+namespace Ubitrack { namespace Math {
+
+namespace {
+
+/** increment of a trapezoidal step with coning correction */
+Vector< double, 3 > secondOrderStep( const Vector< double, 3 >& w0, const Vector< double, 3 >& w1, double dt )
+{
+	return ( 0.5 * dt ) * ( w0 + w1 ) + ( dt * dt / 12.0 ) * cross_product( w0, w1 );
+}
+
+/** increment of a fourth order Magnus step over the samples at t0, t0 + h0 and t0 + h0 + h1 */
+Vector< double, 3 > fourthOrderStep( const Vector< double, 3 >& w0, const Vector< double, 3 >& w1, const Vector< double, 3 >& w2
+	, double h0, double h1 )
+{
+	const double h = h0 + h1;
+	const double sqrt3 = std::sqrt( 3.0 );
+
+	// Lagrange interpolation through ( 0, w0 ), ( h0, w1 ), ( h, w2 ) at the Gauss points
+	Vector< double, 3 > g[ 2 ];
+	for ( int i = 0; i < 2; i++ )
+	{
+		const double s = h * ( 0.5 + ( i ? sqrt3 : -sqrt3 ) / 6.0 );
+		const double l0 = ( s - h0 ) * ( s - h ) / ( h0 * h );
+		const double l1 = s * ( s - h ) / ( -h0 * h1 );
+		const double l2 = s * ( s - h0 ) / ( h * h1 );
+		g[ i ] = l0 * w0 + l1 * w1 + l2 * w2;
+	}
+
+	return ( 0.5 * h ) * ( g[ 0 ] + g[ 1 ] ) + ( sqrt3 * h * h / 12.0 ) * cross_product( g[ 0 ], g[ 1 ] );
+}
+
+} // anonymous namespace
+
+
+Quaternion integrateRotationVelocities( const RotationVelocity* velocities, const double* times, const std::size_t n
+	, const RotationIntegrationOrder order, Matrix< double, 3, 3 >* jacobian )
+{
+	if ( jacobian )
+		*jacobian = Matrix< double, 3, 3 >::zeros();
+	if ( n < 2 )
+		return Quaternion();
+
+	for ( std::size_t k = 1; k < n; k++ )
+		if ( !( times[ k ] > times[ k - 1 ] ) )
+			UBITRACK_THROW( "Rotation velocity samples must have strictly increasing timestamps" );
+
+	// increments and the time spanned by each of them
+	std::vector< Vector< double, 3 > > steps;
+	std::vector< double > spans;
+	steps.reserve( n - 1 );
+	spans.reserve( n - 1 );
+
+	std::size_t k = 0;
+	if ( order == rotationIntegrationFourthOrder )
+		for ( ; k + 2 < n; k += 2 )
+		{
+			const double h0 = times[ k + 1 ] - times[ k ];
+			const double h1 = times[ k + 2 ] - times[ k + 1 ];
+			steps.push_back( fourthOrderStep( velocities[ k ], velocities[ k + 1 ], velocities[ k + 2 ], h0, h1 ) );
+			spans.push_back( h0 + h1 );
+		}
+
+	for ( ; k + 1 < n; k++ )
+	{
+		const double dt = times[ k + 1 ] - times[ k ];
+		if ( order == rotationIntegrationFirstOrder )
+			steps.push_back( dt * velocities[ k ] );
+		else
+			steps.push_back( secondOrderStep( velocities[ k ], velocities[ k + 1 ], dt ) );
+		spans.push_back( dt );
+	}
+
+	std::vector< Quaternion > rotations;
+	quaternionsFromLogarithms( steps, rotations );
+
+	Quaternion delta( rotations[ 0 ] );
+	for ( std::size_t i = 1; i < rotations.size(); i++ )
+		delta *= rotations[ i ];
+
+	if ( jacobian )
+	{
+		// J_k+1 = Exp( phi_k )^T J_k + Jr( phi_k ) dt_k, neglecting the dependence of the coning terms
+		Matrix< double, 3, 3 > r;
+		Matrix< double, 3, 3 > jr;
+		Matrix< double, 3, 3 > tmp;
+		for ( std::size_t i = 0; i < steps.size(); i++ )
+		{
+			const Lie::SO3Terms< double > terms( steps[ i ] );
+			terms.matrix( r );
+			terms.rightJacobian( jr );
+			noalias( tmp ) = prod( trans( r ), *jacobian );
+			noalias( *jacobian ) = tmp + spans[ i ] * jr;
+		}
+	}
+
+	return delta;
+}
+
+} } // namespace Ubitrack::Math
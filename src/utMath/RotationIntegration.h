@@ -0,0 +1,83 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Integration of sampled rotation velocities
+ */
+
+#ifndef __UBITRACK_MATH_ROTATIONINTEGRATION_H_INCLUDED__
+#define __UBITRACK_MATH_ROTATIONINTEGRATION_H_INCLUDED__
+
+#include <cstddef>
+
+#include <utCore.h>
+#include "Vector.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "RotationVelocity.h"
+
+namespace Ubitrack { namespace Math {
+
+/** order of the rotation increment computed between rotation velocity samples */
+enum RotationIntegrationOrder
+{
+	/** zero order hold of each sample, as \c RotationVelocity::integrate does */
+	rotationIntegrationFirstOrder,
+	/** trapezoidal rule with the coning correction <tt>dt^2 / 12 ( w_k x w_k+1 )</tt> */
+	rotationIntegrationSecondOrder,
+	/**
+	 * fourth order Magnus expansion over pairs of intervals, evaluating the quadratic interpolant
+	 * of three samples at the two Gauss points. An odd last interval is integrated with second order.
+	 */
+	rotationIntegrationFourthOrder
+};
+
+/**
+ * @ingroup math
+ * Integrates a block of body frame rotation velocities in one call.
+ *
+ * The velocities \c w are sampled at the strictly increasing \c times, and the result is the
+ * rotation \c delta between the first and the last sample, such that <tt>q( t_n-1 ) = q( t_0 ) * delta</tt>,
+ * which is the convention of \c RotationVelocity. The increments of all steps are exponentiated
+ * together with \c quaternionsFromLogarithms, only their product is accumulated sequentially.
+ *
+ * If \c jacobian is given, it receives the derivative of the logarithm of \c delta with respect to
+ * a common change of all samples, i.e. <tt>delta( w + d ) = delta( w ) * exp( J d )</tt>, which is how
+ * errors of the velocity propagate into the rotation of a filter.
+ *
+ * @param velocities \c n rotation velocities in rad/s
+ * @param times \c n timestamps in seconds
+ * @param n number of samples. Less than two samples give the identity.
+ * @param order integration order
+ * @param jacobian optional 3x3 derivative of the increment
+ * @return the rotation between the first and the last sample
+ * @throws Util::Exception if the timestamps are not strictly increasing
+ */
+UBITRACK_EXPORT Quaternion integrateRotationVelocities( const RotationVelocity* velocities, const double* times, std::size_t n
+	, RotationIntegrationOrder order = rotationIntegrationSecondOrder, Matrix< double, 3, 3 >* jacobian = 0 );
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_ROTATIONINTEGRATION_H_INCLUDED__
@@ -0,0 +1,192 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Lazily computed rotation matrices of quaternions and poses.
+ *
+ * Converting a \c Quaternion to a 3x3 matrix costs about 30 floating point operations,
+ * which is more than rotating a single point with the matrix. Code that rotates many
+ * points, or that evaluates a function repeatedly with mostly unchanged rotations
+ * (e.g. Jacobian and residual of an optimizer step), can keep a
+ * \c RotationMatrixCache next to the quaternion. It converts on first use and then
+ * returns the stored matrix until a different quaternion is set:
+ * @code
+ * Math::RotationMatrixCache< double > cache;
+ * for ( ... )
+ *     noalias( rotated ) = ublas::prod( cache.matrix( q ), point );
+ * @endcode
+ *
+ * \c CachedPose does the same for a \c Pose and applies it to points.
+ *
+ * The caches are plain values without synchronization, so do not share one instance
+ * between threads.
+ */
+
+#ifndef __UBITRACK_MATH_ROTATIONMATRIXCACHE_H_INCLUDED__
+#define __UBITRACK_MATH_ROTATIONMATRIXCACHE_H_INCLUDED__
+
+#include "Quaternion.h"
+#include "Pose.h"
+#include "Matrix.h"
+#include "Vector.h"
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * Quaternion together with its rotation matrix, which is computed when it is first
+ * requested after the quaternion has changed.
+ *
+ * @param T element type of the matrix
+ */
+template< typename T >
+class RotationMatrixCache
+{
+public:
+	typedef Matrix< T, 3, 3 > matrix_type;
+
+	/** creates a cache of the identity rotation */
+	RotationMatrixCache()
+		: m_quaternion()
+		, m_valid( false )
+	{}
+
+	/** creates a cache of the rotation \c q */
+	explicit RotationMatrixCache( const Quaternion& q )
+		: m_quaternion( q )
+		, m_valid( false )
+	{}
+
+	/** sets the rotation, the matrix is only discarded if \c q differs from the current rotation */
+	void setRotation( const Quaternion& q )
+	{
+		if ( q == m_quaternion )
+			return;
+		m_quaternion = q;
+		m_valid = false;
+	}
+
+	/** the current rotation */
+	const Quaternion& rotation() const
+	{ return m_quaternion; }
+
+	/** the rotation matrix of the current rotation */
+	const matrix_type& matrix() const
+	{
+		if ( !m_valid )
+		{
+			m_quaternion.toMatrix( m_matrix );
+			m_valid = true;
+		}
+		return m_matrix;
+	}
+
+	/** sets the rotation to \c q and returns its rotation matrix */
+	const matrix_type& matrix( const Quaternion& q )
+	{
+		setRotation( q );
+		return matrix();
+	}
+
+	/** true, if the matrix of the current rotation has already been computed */
+	bool valid() const
+	{ return m_valid; }
+
+protected:
+	Quaternion m_quaternion;
+	mutable matrix_type m_matrix;
+	mutable bool m_valid;
+};
+
+
+/**
+ * Pose that keeps the rotation matrix of its rotation for transforming points.
+ *
+ * @param T element type of the matrix and of the transformed points
+ */
+template< typename T >
+class CachedPose
+{
+public:
+	typedef typename RotationMatrixCache< T >::matrix_type matrix_type;
+
+	/** creates an identity pose */
+	CachedPose()
+		: m_translation( 0, 0, 0 )
+	{}
+
+	/** creates a cached view of \c p */
+	explicit CachedPose( const Pose& p )
+		: m_rotation( p.rotation() )
+		, m_translation( p.translation() )
+	{}
+
+	/** sets the pose, the matrix is kept if the rotation has not changed */
+	void setPose( const Pose& p )
+	{
+		m_rotation.setRotation( p.rotation() );
+		m_translation = p.translation();
+	}
+
+	/** returns the pose */
+	Pose pose() const
+	{ return Pose( m_rotation.rotation(), m_translation ); }
+
+	/** the rotation of the pose */
+	const Quaternion& rotation() const
+	{ return m_rotation.rotation(); }
+
+	/** the translation of the pose */
+	const Vector< double, 3 >& translation() const
+	{ return m_translation; }
+
+	/** the rotation matrix of the pose */
+	const matrix_type& rotationMatrix() const
+	{ return m_rotation.matrix(); }
+
+	/** computes <tt>result = R * x + t</tt>, \c result must not alias \c x */
+	void transform( const Vector< T, 3 >& x, Vector< T, 3 >& result ) const
+	{
+		const matrix_type& r( m_rotation.matrix() );
+		result( 0 ) = r( 0, 0 ) * x( 0 ) + r( 0, 1 ) * x( 1 ) + r( 0, 2 ) * x( 2 ) + T( m_translation( 0 ) );
+		result( 1 ) = r( 1, 0 ) * x( 0 ) + r( 1, 1 ) * x( 1 ) + r( 1, 2 ) * x( 2 ) + T( m_translation( 1 ) );
+		result( 2 ) = r( 2, 0 ) * x( 0 ) + r( 2, 1 ) * x( 1 ) + r( 2, 2 ) * x( 2 ) + T( m_translation( 2 ) );
+	}
+
+	/** transforms the point \c x */
+	Vector< T, 3 > operator*( const Vector< T, 3 >& x ) const
+	{
+		Vector< T, 3 > result;
+		transform( x, result );
+		return result;
+	}
+
+protected:
+	RotationMatrixCache< T > m_rotation;
+	Vector< double, 3 > m_translation;
+};
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_ROTATIONMATRIXCACHE_H_INCLUDED__
@@ -0,0 +1,282 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Storage array with a small inline buffer for the dynamic-size matrices and vectors.
+ *
+ * Parameter and state vectors of filters and optimizers, and their covariances, have a size that
+ * is only known at runtime but mostly small. \c SmallArray keeps up to \c Inline elements within
+ * the object and only allocates from the heap for larger sizes, so these objects can be created
+ * and copied without touching the allocator. It is a model of the ublas storage concept and is
+ * used as the storage of \c Math::Vector< T, 0 > and \c Math::Matrix< T, 0, 0 >.
+ *
+ * Unlike \c ublas::unbounded_array, swapping two arrays copies the elements if one of them is
+ * stored inline, and the elements of a newly sized array are not initialized.
+ */
+
+#ifndef __UBITRACK_MATH_SMALLARRAY_H_INCLUDED__
+#define __UBITRACK_MATH_SMALLARRAY_H_INCLUDED__
+
+#include <cstddef>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_pod.hpp>
+#include <boost/numeric/ublas/storage.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/array.hpp>
+
+namespace Ubitrack { namespace Math {
+
+/**
+ * Storage of up to \c Inline elements within the object, with a heap allocated fallback.
+ *
+ * @tparam T builtin element type
+ * @tparam Inline number of elements stored without heap allocation
+ * @tparam Alloc allocator of the heap storage
+ */
+template< typename T, std::size_t Inline, typename Alloc = std::allocator< T > >
+class SmallArray
+	: public boost::numeric::ublas::storage_array< SmallArray< T, Inline, Alloc > >
+{
+	BOOST_STATIC_ASSERT( boost::is_pod< T >::value );
+
+public:
+	typedef Alloc allocator_type;
+	typedef typename Alloc::size_type size_type;
+	typedef typename Alloc::difference_type difference_type;
+	typedef T value_type;
+	typedef const T& const_reference;
+	typedef T& reference;
+	typedef const T* const_pointer;
+	typedef T* pointer;
+	typedef const_pointer const_iterator;
+	typedef pointer iterator;
+	typedef std::reverse_iterator< const_iterator > const_reverse_iterator;
+	typedef std::reverse_iterator< iterator > reverse_iterator;
+
+	/** number of elements stored inline */
+	static const std::size_t inline_size = Inline;
+
+	explicit SmallArray( const Alloc& a = Alloc() )
+		: m_alloc( a )
+		, m_size( 0 )
+		, m_data( m_inline )
+	{}
+
+	/** creates an array of \c size uninitialized elements */
+	explicit SmallArray( size_type size, const Alloc& a = Alloc() )
+		: m_alloc( a )
+		, m_size( size )
+		, m_data( acquire( size ) )
+	{}
+
+	SmallArray( size_type size, const value_type& init, const Alloc& a = Alloc() )
+		: m_alloc( a )
+		, m_size( size )
+		, m_data( acquire( size ) )
+	{
+		std::fill( m_data, m_data + m_size, init );
+	}
+
+	SmallArray( const SmallArray& a )
+		: boost::numeric::ublas::storage_array< SmallArray< T, Inline, Alloc > >()
+		, m_alloc( a.m_alloc )
+		, m_size( a.m_size )
+		, m_data( acquire( a.m_size ) )
+	{
+		std::copy( a.m_data, a.m_data + m_size, m_data );
+	}
+
+	~SmallArray()
+	{ release(); }
+
+	/** resizes the array, the contents are undefined afterwards */
+	void resize( size_type size )
+	{
+		if ( size == m_size )
+			return;
+		release();
+		m_data = acquire( size );
+		m_size = size;
+	}
+
+	/** resizes the array, preserving the contents and initializing new elements with \c init */
+	void resize( size_type size, value_type init )
+	{
+		if ( size == m_size )
+			return;
+		pointer data = acquire( size );
+		if ( data != m_data )
+		{
+			std::copy( m_data, m_data + std::min( size, m_size ), data );
+			release();
+		}
+		if ( size > m_size )
+			std::fill( data + m_size, data + size, init );
+		m_data = data;
+		m_size = size;
+	}
+
+	size_type max_size() const
+	{ return m_alloc.max_size(); }
+
+	bool empty() const
+	{ return m_size == 0; }
+
+	size_type size() const
+	{ return m_size; }
+
+	/** @return true if the elements are stored in the object */
+	bool isInline() const
+	{ return m_data == m_inline; }
+
+	const_reference operator[]( size_type i ) const
+	{
+		BOOST_UBLAS_CHECK( i < m_size, boost::numeric::ublas::bad_index() );
+		return m_data[ i ];
+	}
+
+	reference operator[]( size_type i )
+	{
+		BOOST_UBLAS_CHECK( i < m_size, boost::numeric::ublas::bad_index() );
+		return m_data[ i ];
+	}
+
+	SmallArray& operator=( const SmallArray& a )
+	{
+		if ( this != &a )
+		{
+			resize( a.m_size );
+			std::copy( a.m_data, a.m_data + m_size, m_data );
+		}
+		return *this;
+	}
+
+	SmallArray& assign_temporary( SmallArray& a )
+	{
+		swap( a );
+		return *this;
+	}
+
+	/** exchanges the contents, only the pointers if both arrays are on the heap */
+	void swap( SmallArray& a )
+	{
+		if ( this == &a )
+			return;
+
+		if ( !isInline() && !a.isInline() )
+		{
+			std::swap( m_data, a.m_data );
+			std::swap( m_size, a.m_size );
+		}
+		else if ( isInline() && a.isInline() )
+		{
+			const size_type n = std::max( m_size, a.m_size );
+			std::swap_ranges( m_inline, m_inline + n, a.m_inline );
+			std::swap( m_size, a.m_size );
+		}
+		else
+		{
+			SmallArray& inlined = isInline() ? *this : a;
+			SmallArray& heap = isInline() ? a : *this;
+			std::copy( inlined.m_inline, inlined.m_inline + inlined.m_size, heap.m_inline );
+			inlined.m_data = heap.m_data;
+			heap.m_data = heap.m_inline;
+			std::swap( m_size, a.m_size );
+		}
+	}
+
+	friend void swap( SmallArray& a1, SmallArray& a2 )
+	{ a1.swap( a2 ); }
+
+	const_iterator begin() const
+	{ return m_data; }
+
+	const_iterator end() const
+	{ return m_data + m_size; }
+
+	iterator begin()
+	{ return m_data; }
+
+	iterator end()
+	{ return m_data + m_size; }
+
+	const_reverse_iterator rbegin() const
+	{ return const_reverse_iterator( end() ); }
+
+	const_reverse_iterator rend() const
+	{ return const_reverse_iterator( begin() ); }
+
+	reverse_iterator rbegin()
+	{ return reverse_iterator( end() ); }
+
+	reverse_iterator rend()
+	{ return reverse_iterator( begin() ); }
+
+	allocator_type get_allocator()
+	{ return m_alloc; }
+
+private:
+	friend class boost::serialization::access;
+
+	template< class Archive >
+	void serialize( Archive& ar, const unsigned int )
+	{
+		boost::serialization::collection_size_type s( m_size );
+		ar & boost::serialization::make_nvp( "size", s );
+		if ( Archive::is_loading::value )
+			resize( s );
+		ar & boost::serialization::make_array( m_data, m_size );
+	}
+
+	/** returns storage for \c size elements, inline if possible */
+	pointer acquire( size_type size )
+	{
+		if ( size <= Inline )
+			return m_inline;
+		return m_alloc.allocate( size );
+	}
+
+	/** frees the heap storage, if any */
+	void release()
+	{
+		if ( !isInline() )
+			m_alloc.deallocate( m_data, m_size );
+		m_data = m_inline;
+	}
+
+	Alloc m_alloc;
+	size_type m_size;
+	pointer m_data;
+	T m_inline[ Inline ];
+};
+
+} } // namespace Ubitrack::Math
+
+#endif // __UBITRACK_MATH_SMALLARRAY_H_INCLUDED__
@@ -31,6 +31,9 @@
  * @author Christian Waechter <christian.waechter@in.tum.de> (modified)
  */
 
+#ifndef __UBITRACK_MATH_STOCHASTIC_AVERAGE_H__
+#define __UBITRACK_MATH_STOCHASTIC_AVERAGE_H__
+
 // Ubitrack
 #include "../Scalar.h"
 #include "../Pose.h"
@@ -40,6 +43,10 @@
 
 #include "../Blas2.h" // outer_product
 #include "../Util/TypeToVector.h" // castToVector
+#include <utUtil/Exception.h>
+
+// std
+#include <vector>
 
 namespace Ubitrack { namespace Math { namespace Stochastic {
 
@@ -151,7 +158,7 @@ struct Average< ResultType, 1 >
 
 /// overloaded unary bracket operator for Quaternion measurements, that brings all rotation measurements in the same hemisphere
 template<>
-void Average< Math::Quaternion >::operator() ( const value_type& value )
+inline void Average< Math::Quaternion >::operator() ( const value_type& value )
 {
 	++m_counter;
 	mean_type tmp;
@@ -161,7 +168,7 @@ void Average< Math::Quaternion >::operator() ( const value_type& value )
 
 /// overloaded getAverage function for Quaternion measurements, when new struct is available this should not be necessary anymore.
 template<>
-Math::Quaternion Average< Math::Quaternion >::getAverage() const
+inline Math::Quaternion Average< Math::Quaternion >::getAverage() const
 {
 	const mean_type mean = m_mean / m_counter;
 	return Quaternion( mean[ 0 ], mean[ 1 ], mean[ 2 ], mean[ 3 ] ).normalize();
@@ -169,7 +176,7 @@ Math::Quaternion Average< Math::Quaternion >::getAverage() const
 
 /// overloaded unary bracket operator for pose measurements, that brings all rotation measurements in the same hemisphere
 template<>
-void Average< Math::Pose >::operator() ( const value_type& value )
+inline void Average< Math::Pose >::operator() ( const value_type& value )
 {
 	++m_counter;
 	mean_type tmp;
@@ -188,7 +195,7 @@ void Average< Math::Pose >::operator() ( const value_type& value )
 
 /// overloaded getAverage function for Pose measurements, when new struct is available this should not be necessary anymore as well.
 template<>
-Math::Pose Average< Math::Pose >::getAverage() const
+inline Math::Pose Average< Math::Pose >::getAverage() const
 {
 	
 	const mean_type mean = m_mean / m_counter;
@@ -317,4 +324,372 @@ public:
 	
 };
 
+
+namespace Detail {
+
+/**
+ * @internal describes how the moving averages below sum up the samples of a result type and
+ * how they turn the sums into the result, which is left to the corresponding \c Average.
+ */
+template< typename ResultType, std::size_t N = Util::TypeToVector< ResultType >::size >
+struct AverageTraits
+{
+	typedef Average< ResultType > average_type;
+	typedef typename average_type::value_type value_type;
+	typedef value_type input_type;
+	typedef typename average_type::precision_type precision_type;
+	typedef Math::Vector< precision_type, N > vector_type;
+	typedef Math::Matrix< precision_type, N, N > matrix_type;
+	static const bool covariance = false;
+
+	static void convert( const input_type& value, const vector_type&, vector_type& result )
+	{ Util::castToVector( value, result ); }
+
+	static value_type average( const vector_type& sum, const matrix_type&, const precision_type weight )
+	{
+		average_type a;
+		a.m_counter = 1;
+		a.m_mean = sum / weight;
+		return a.getAverage();
+	}
+};
+
+/// @internal built-in types and Math::Scalar
+template< typename ResultType >
+struct AverageTraits< ResultType, 1 >
+{
+	typedef Average< ResultType > average_type;
+	typedef typename average_type::value_type value_type;
+	typedef value_type input_type;
+	typedef typename average_type::precision_type precision_type;
+	typedef Math::Vector< precision_type, 1 > vector_type;
+	typedef Math::Matrix< precision_type, 1, 1 > matrix_type;
+	static const bool covariance = false;
+
+	static void convert( const input_type& value, const vector_type&, vector_type& result )
+	{ result( 0 ) = static_cast< precision_type >( value ); }
+
+	static value_type average( const vector_type& sum, const matrix_type&, const precision_type weight )
+	{
+		average_type a;
+		a.m_counter = 1;
+		a.m_mean = sum( 0 ) / weight;
+		return a.getAverage();
+	}
+};
+
+/**
+ * @internal flips the quaternion stored at \c offset into the hemisphere of the reference sum,
+ * or of the positive real part if the sum is zero. Aligning with the current mean instead of
+ * the real part keeps rotations of about 180 degrees together.
+ */
+template< typename VectorType >
+void alignQuaternion( VectorType& v, const VectorType& reference, const std::size_t offset )
+{
+	typename VectorType::value_type dot( 0 );
+	for ( std::size_t i = offset; i < offset + 4; i++ )
+		dot += v( i ) * reference( i );
+	if ( dot < 0 || ( dot == 0 && v( offset + 3 ) < 0 ) )
+		for ( std::size_t i = offset; i < offset + 4; i++ )
+			v( i ) = -v( i );
+}
+
+/// @internal quaternions, the normalized sum of aligned quaternions approximates the mean rotation
+template<>
+struct AverageTraits< Math::Quaternion, 4 >
+	: public AverageTraits< Math::Vector< double, 4 >, 4 >
+{
+	typedef Average< Math::Quaternion > average_type;
+	typedef Math::Quaternion value_type;
+	typedef value_type input_type;
+
+	static void convert( const input_type& value, const vector_type& reference, vector_type& result )
+	{
+		Util::castToVector( value, result );
+		alignQuaternion( result, reference, 0 );
+	}
+
+	static value_type average( const vector_type& sum, const matrix_type&, const precision_type weight )
+	{
+		average_type a;
+		a.m_counter = 1;
+		a.m_mean = sum / weight;
+		return a.getAverage();
+	}
+};
+
+/// @internal poses, as translation and aligned quaternion
+template<>
+struct AverageTraits< Math::Pose, 7 >
+	: public AverageTraits< Math::Vector< double, 7 >, 7 >
+{
+	typedef Average< Math::Pose > average_type;
+	typedef Math::Pose value_type;
+	typedef value_type input_type;
+
+	static void convert( const input_type& value, const vector_type& reference, vector_type& result )
+	{
+		Util::castToVector( value, result );
+		alignQuaternion( result, reference, 3 );
+	}
+
+	static value_type average( const vector_type& sum, const matrix_type&, const precision_type weight )
+	{
+		average_type a;
+		a.m_counter = 1;
+		a.m_mean = sum / weight;
+		return a.getAverage();
+	}
+};
+
+/// @internal vectors with covariance
+template< typename T, std::size_t N >
+struct AverageTraits< Math::ErrorVector< T, N >, N >
+	: public AverageTraits< Math::Vector< T, N >, N >
+{
+	typedef AverageTraits< Math::Vector< T, N >, N > super;
+	typedef Average< Math::ErrorVector< T, N > > average_type;
+	typedef Math::ErrorVector< T, N > value_type;
+	typedef Math::Vector< T, N > input_type;
+	static const bool covariance = true;
+
+	static value_type average( const typename super::vector_type& sum, const typename super::matrix_type& outer, const T weight )
+	{
+		average_type a;
+		a.m_counter = 1;
+		a.m_mean = sum / weight;
+		a.m_covariance = outer / weight;
+		return a.getAverage();
+	}
+};
+
+/// @internal poses with covariance
+template<>
+struct AverageTraits< Math::ErrorPose, 7 >
+	: public AverageTraits< Math::Pose, 7 >
+{
+	typedef Average< Math::ErrorPose > average_type;
+	typedef Math::ErrorPose value_type;
+	static const bool covariance = true;
+
+	static value_type average( const vector_type& sum, const matrix_type& outer, const precision_type weight )
+	{
+		average_type a;
+		a.m_counter = 1;
+		a.m_mean = sum / weight;
+		a.m_covariance = outer / weight;
+		return a.getAverage();
+	}
+};
+
+} // namespace Detail
+
+
+/**
+ * @brief Average of the last samples of a stream.
+ *
+ * Computes the same results as \c Average over the last \c window samples, for all types
+ * supported by \c Average. The samples of the window are kept in a ring buffer and their
+ * sums are updated when a sample enters or leaves the window, so each sample costs constant
+ * time, independent of the window size. The sums are recomputed from the buffer after every
+ * \c window samples, which keeps the rounding errors of the updates from growing.
+ *
+ * Quaternions are added in the hemisphere of the current sum, so the result approximates the
+ * mean rotation also for rotations of about 180 degrees.
+ @code
+ SlidingAverage< Math::ErrorPose > averager( 1000 );
+ averager( pose ); // for each new measurement
+ const Math::ErrorPose mean = averager.getAverage();
+ @endcode
+ */
+template< typename ResultType >
+class SlidingAverage
+{
+public:
+	typedef Detail::AverageTraits< ResultType > traits_type;
+
+	/** the type of the result */
+	typedef typename traits_type::value_type value_type;
+
+	/** the type of the samples */
+	typedef typename traits_type::input_type input_type;
+
+	typedef typename traits_type::precision_type precision_type;
+	typedef typename traits_type::vector_type vector_type;
+	typedef typename traits_type::matrix_type matrix_type;
+
+	/** constructor, the window holds at least one sample */
+	explicit SlidingAverage( const std::size_t window )
+		: m_window( window )
+	{
+		if ( window == 0 )
+			UBITRACK_THROW( "the window of a sliding average must not be empty" );
+		m_samples.reserve( window );
+		reset();
+	}
+
+	/** removes all samples */
+	void reset()
+	{
+		m_samples.clear();
+		m_next = 0;
+		m_sum = vector_type::zeros();
+		m_outer = matrix_type::zeros();
+	}
+
+	/** adds a sample, the oldest sample leaves a full window */
+	void operator() ( const input_type& value )
+	{
+		vector_type v;
+		traits_type::convert( value, m_sum, v );
+
+		if ( m_samples.size() < m_window )
+			m_samples.push_back( v );
+		else
+		{
+			remove( m_samples[ m_next ] );
+			m_samples[ m_next ] = v;
+			m_next = ( m_next + 1 ) % m_window;
+			if ( m_next == 0 )
+			{
+				recompute();
+				return;
+			}
+		}
+		add( v );
+	}
+
+	/** number of samples in the window */
+	std::size_t size() const
+	{ return m_samples.size(); }
+
+	/** the average of the samples in the window, throws if there are none */
+	value_type getAverage() const
+	{
+		if ( m_samples.empty() )
+			UBITRACK_THROW( "cannot average an empty window" );
+		return traits_type::average( m_sum, m_outer, static_cast< precision_type >( m_samples.size() ) );
+	}
+
+protected:
+	/// @internal
+	void add( const vector_type& v )
+	{
+		m_sum += v;
+		if ( traits_type::covariance )
+			m_outer += Math::outer_product( v, v );
+	}
+
+	/// @internal
+	void remove( const vector_type& v )
+	{
+		m_sum -= v;
+		if ( traits_type::covariance )
+			m_outer -= Math::outer_product( v, v );
+	}
+
+	/// @internal sums up the samples in the buffer again
+	void recompute()
+	{
+		m_sum = vector_type::zeros();
+		m_outer = matrix_type::zeros();
+		for ( std::size_t i = 0; i < m_samples.size(); i++ )
+			add( m_samples[ i ] );
+	}
+
+	/** maximum number of samples */
+	std::size_t m_window;
+
+	/** ring buffer of the converted samples */
+	std::vector< vector_type > m_samples;
+
+	/** position of the oldest sample in a full window */
+	std::size_t m_next;
+
+	/** sum of the samples in the window */
+	vector_type m_sum;
+
+	/** sum of the outer products of the samples, for the types with covariance */
+	matrix_type m_outer;
+};
+
+
+/**
+ * @brief Exponentially weighted moving average of a stream.
+ *
+ * Each new sample gets the weight \c alpha, the weight of all previous samples is scaled
+ * by <tt>1 - alpha</tt>. The weights are normalized by their sum, so the first samples are
+ * not biased towards zero. Supports all types of \c Average, the covariance types estimate
+ * the exponentially weighted covariance.
+ */
+template< typename ResultType >
+class ExponentialAverage
+{
+public:
+	typedef Detail::AverageTraits< ResultType > traits_type;
+
+	/** the type of the result */
+	typedef typename traits_type::value_type value_type;
+
+	/** the type of the samples */
+	typedef typename traits_type::input_type input_type;
+
+	typedef typename traits_type::precision_type precision_type;
+	typedef typename traits_type::vector_type vector_type;
+	typedef typename traits_type::matrix_type matrix_type;
+
+	/** constructor, \c alpha must be in ( 0, 1 ] */
+	explicit ExponentialAverage( const precision_type alpha )
+		: m_alpha( alpha )
+	{
+		if ( !( alpha > 0 && alpha <= 1 ) )
+			UBITRACK_THROW( "the weight of an exponential average must be in ( 0, 1 ]" );
+		reset();
+	}
+
+	/** removes all samples */
+	void reset()
+	{
+		m_weight = 0;
+		m_sum = vector_type::zeros();
+		m_outer = matrix_type::zeros();
+	}
+
+	/** adds a sample */
+	void operator() ( const input_type& value )
+	{
+		vector_type v;
+		traits_type::convert( value, m_sum, v );
+
+		const precision_type decay = 1 - m_alpha;
+		m_weight = decay * m_weight + 1;
+		m_sum = decay * m_sum + v;
+		if ( traits_type::covariance )
+			m_outer = decay * m_outer + Math::outer_product( v, v );
+	}
+
+	/** the weighted average, throws if there are no samples */
+	value_type getAverage() const
+	{
+		if ( m_weight == 0 )
+			UBITRACK_THROW( "cannot average without samples" );
+		return traits_type::average( m_sum, m_outer, m_weight );
+	}
+
+protected:
+	/** the weight of a new sample */
+	precision_type m_alpha;
+
+	/** the sum of the weights, divided by alpha */
+	precision_type m_weight;
+
+	/** the weighted sum of the samples, divided by alpha */
+	vector_type m_sum;
+
+	/** the weighted sum of the outer products of the samples, for the types with covariance */
+	matrix_type m_outer;
+};
+
 } } } // namespace Ubitrack::Math::Stochastic
+
+#endif //__UBITRACK_MATH_STOCHASTIC_AVERAGE_H__
@@ -36,8 +36,10 @@
 
 #ifdef HAVE_LAPACK
 
+#include <cmath>
 #include <utMath/Matrix.h>
 #include <utMath/Vector.h>
+#include <utMath/MatrixArena.h>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/vector_proxy.hpp>
 #include <boost/numeric/ublas/symmetric.hpp>
@@ -48,92 +50,10 @@
 #include <boost/numeric/bindings/blas/blas.hpp>
 #include <boost/numeric/bindings/lapack/syev.hpp>
 #include <boost/numeric/bindings/lapack/gesvd.hpp>
+#include <boost/numeric/bindings/lapack/posv.hpp>
 
 namespace Ubitrack { namespace Math { namespace Stochastic {
 
-
-/**
- * @ingroup math
- * Performs backward propagation of covariance.
- * 
- * FIXME: this function doesn't seeem to work correctly. 
- * Use backwardPropagationIdentity, which gives different (and more plausible) results.
- *
- * Given a function y = f(x), known parameters x and a covariance matrix E of y, the backward propagation
- * computes the covariance C of the parameters x. size(E) >= size(C).
- *
- * @param result matrix C where the resulting covariance is stored
- * @param input matrix containing the input covariance E
- * @param function class modeled after \c UnaryFunctionPrototype, describes the measurement function f
- * @param params parameters x of the function f.
- */
-template< class MT1, class MT2, class F, class VT1 > 
-void backwardPropagation( MT1& result, const MT2& input, const F& function, const VT1& params )
-{
-	// !!!! FIXME: this function doesn't seeem to work.  !!!!!
-	// Use backwardPropagationIdentity, which gives different results
-	
-	namespace lapack = boost::numeric::bindings::lapack;
-	namespace blas = boost::numeric::bindings::blas;
-	namespace ublas = boost::numeric::ublas;
-
-	typedef typename MT1::value_type VType;
-	typedef typename Math::Matrix< VType, 0, 0 > MatType;
-
-	// evaluate jacobian
-	MatType jacobian( input.size1(), result.size1() );
-	function.jacobian( params, jacobian );
-	
-	// factorize E into Q^T * T * Q
-	MatType Q( input );
-	Math::Vector< VType > t( input.size1() );
-	lapack::syev( 'V', 'U', Q, t, lapack::minimal_workspace() );
-	
-	// compute Q * J
-	MatType QJ( jacobian.size1(), jacobian.size2() );
-	blas::gemm( Q, jacobian, QJ );
-
-    // compute T^(-1/2)	
-	VType precision( t( 0 ) * VType( 1e-8 ) );
-	for ( unsigned i = 0; i < result.size1(); i++ )
-		if ( t( i ) < precision )
-			t( i ) = 0;
-		else
-			t( i ) = 1 / sqrt( t( i ) );
-
-	// compute J' = T^(-1/2) * Q * J
-	for ( unsigned i = 0; i < result.size1(); i++ )
-		ublas::row( QJ, i ) *= t( i );
-
-	// perform SVD on QJ
-	MatType dummyU( function.size(), function.size() );
-	MatType dummyVt( result.size1(), result.size1() );
-	Math::Vector< VType > s( result.size1() );
-	lapack::gesvd( 'N', 'O', QJ, s, dummyU, dummyVt );
-
-	// compute singular values of pseudo-inverse
-	precision = s( 0 ) * VType( 1e-8 );
-	for ( unsigned i = 0; i < s.size(); i++ )
-		if ( s( i ) < precision )
-			s( i ) = 0;
-		else
-			s( i ) = 1 / s( i );
-
-	// compute covariance
-	for ( unsigned i = 0; i < s.size(); i++ )
-		ublas::row( QJ, i ) *= s( i );
-
-	blas::syrk( 'U', 'T', VType( 1 ), ublas::subrange( QJ, 0, s.size(), 0, s.size() ), VType( 0 ), result );
-
-	// fill lower half of matrix
-	for ( unsigned r = 1; r < result.size1(); r++ )
-		for ( unsigned c = 0; c < r; c++ )
-			result( r, c ) = result( c, r );
-}
-		
-
-		
-
 /**
  * @ingroup math
  * Performs backward propagation of covariance where the input covariance is identity multiplied by some factor \c s.
@@ -141,6 +61,8 @@ void backwardPropagation( MT1& result, const MT2& input, const F& function, cons
  * Given a function y = f(x), known parameters x and a covariance matrix E = s * I of y, the backward propagation
  * computes the covariance C of the parameters x. size(E) >= size(C).
  *
+ * This version computes the pseudo-inverse by an SVD, so it also handles jacobians without full column rank.
+ *
  * @param result matrix C where the resulting covariance is stored
  * @param s scaling factor of input covariance E. E = s * I
  * @param jacobian Jacobian matrix of the function f evaluated at x.
@@ -154,17 +76,19 @@ void backwardPropagationIdentity( MT1& result, typename MT1::value_type s, MT3&
 	namespace ublas = boost::numeric::ublas;
 
 	typedef typename MT1::value_type VType;
-	typedef typename Math::Matrix< VType, 0, 0 > MatType;
+	typedef typename MT3::value_type JType;
+	typedef typename Math::ArenaMatrix< JType >::type MatType;
 
-	// perform SVD on the jacobian
-	MatType dummyU( jacobian.size1(), jacobian.size1() );
+	// perform SVD on the jacobian, U is not referenced
+	Math::MatrixArena::Scope arena;
+	MatType dummyU( 1, 1 );
 	MatType dummyVt( result.size1(), result.size1() );
-	Math::Vector< VType > v( result.size1() );
+	typename Math::ArenaVector< JType >::type v( result.size1() );
 	lapack::gesvd( 'N', 'O', jacobian, v, dummyU, dummyVt );
 
 	// compute singular values of pseudo-inverse, multiplied by sqrt(s)
-	VType precision( v( 0 ) * VType( 1e-8 ) );
-	VType sSqrt = sqrt( s );
+	JType precision( v( 0 ) * JType( 1e-8 ) );
+	JType sSqrt = std::sqrt( JType( s ) );
 	for ( unsigned i = 0; i < v.size(); i++ )
 		if ( v( i ) < precision )
 			v( i ) = 0;
@@ -175,103 +99,200 @@ void backwardPropagationIdentity( MT1& result, typename MT1::value_type s, MT3&
 	for ( unsigned i = 0; i < v.size(); i++ )
 		ublas::row( jacobian, i ) *= v( i );
 
-	blas::syrk( 'U', 'T', VType( 1 ), ublas::subrange( jacobian, 0, v.size(), 0, v.size() ), VType( 0 ), result );
+	MatType covariance( result.size1(), result.size1() );
+	blas::syrk( 'U', 'T', JType( 1 ), ublas::subrange( jacobian, 0, v.size(), 0, v.size() ), JType( 0 ), covariance );
 	
-	// fill lower half of matrix
-	for ( unsigned r = 1; r < result.size1(); r++ )
-		for ( unsigned c = 0; c < r; c++ )
-			result( r, c ) = result( c, r );
+	// copy upper half and fill lower half of matrix
+	for ( unsigned c = 0; c < result.size1(); c++ )
+		for ( unsigned r = 0; r <= c; r++ )
+			result( r, c ) = result( c, r ) = VType( covariance( r, c ) );
 }
 
 
 /**
  * @ingroup math
- * Performs backward propagation of covariance where the input covariance is identity multiplied by some factor \c s.
+ * Performs backward propagation of covariance where the input covariance E is a diagonal matrix given by
+ * the vector \c e.
  *
- * Given a function y = f(x), known parameters x and a covariance matrix E = s * I of y, the backward propagation
+ * Given a function y = f(x), known parameters x and a covariance matrix E = diag( e ) of y, the backward propagation
  * computes the covariance C of the parameters x. size(E) >= size(C).
  *
+ * This version computes the pseudo-inverse by an SVD, so it also handles jacobians without full column rank.
+ *
  * @param result matrix C where the resulting covariance is stored
- * @param s scaling factor of input covariance E. E = s * I
- * @param function class modeled after \c UnaryFunctionPrototype, describes the measurement function f
- * @param params parameters x of the function f.
+ * @param input vector e containing the diagonal elements of the input covariance E
+ * @param jacobian of the function f evaluated at x. Note: must be column_major and will be modified.
  */
-template< class MT1, class F, class VT1 > 
-void backwardPropagationIdentity( MT1& result, typename MT1::value_type s, const F& function, const VT1& params )
+template< class MT1, class VT2, class MT3 > 
+void backwardPropagationDiagonal( MT1& result, const VT2& input, MT3& jacobian )
 {
 	namespace ublas = boost::numeric::ublas;
 
+	typedef typename MT3::value_type JType;
+
+	// multiply jacobian with E^(-1/2)
+	for ( unsigned i = 0; i < jacobian.size1(); i++ )
+		ublas::row( jacobian, i ) *= JType( 1 ) / std::sqrt( JType( input( i ) ) );
+
+	backwardPropagationIdentity( result, typename MT1::value_type( 1 ), jacobian );
+}
+
+
+namespace Detail {
+
+/**
+ * @internal
+ * Computes the covariance <tt>( W^T * W )^-1</tt> of a whitened double precision jacobian \c W.
+ *
+ * \c W^T*W is computed by \c syrk and inverted by a Cholesky decomposition, using only the upper triangle,
+ * which needs about half the flops of the SVD. The columns are equilibrated first, so different units of
+ * rotation and translation do not affect the rank decision. If the normal matrix is numerically close to
+ * singular, the SVD based pseudo-inverse is used instead. \c W is modified.
+ */
+template< class MT1 >
+void whitenedCovariance( MT1& result, Math::ArenaMatrixd& W )
+{
+	namespace lapack = boost::numeric::bindings::lapack;
+	namespace blas = boost::numeric::bindings::blas;
+
 	typedef typename MT1::value_type VType;
-	typedef typename Math::Matrix< VType, 0, 0 > MatType;
 
-	// evaluate jacobian J
-	MatType jacobian( function.size(), result.size1() );
-	function.jacobian( params, jacobian );
-	
-	backwardPropagationIdentity( result, s, jacobian );
+	// smallest pivot of the equilibrated Cholesky factor, relative to a diagonal of ones,
+	// for which ( W^T * W )^-1 is still accurate to about 1e-8 relative
+	const double minPivot = 1e-4;
+
+	const std::size_t n = result.size1();
+	Math::ArenaMatrixd normal( n, n );
+	blas::syrk( 'U', 'T', 1.0, W, 0.0, normal );
+
+	Math::ArenaVectord scale( n );
+	bool factorized = true;
+	for ( std::size_t i = 0; i < n && factorized; i++ )
+		if ( normal( i, i ) > 0 )
+			scale( i ) = 1.0 / std::sqrt( normal( i, i ) );
+		else
+			factorized = false;
+
+	if ( factorized )
+	{
+		for ( std::size_t c = 0; c < n; c++ )
+			for ( std::size_t r = 0; r <= c; r++ )
+				normal( r, c ) *= scale( r ) * scale( c );
+
+		factorized = lapack::potrf( 'U', normal ) == 0;
+		for ( std::size_t i = 0; i < n && factorized; i++ )
+			factorized = normal( i, i ) >= minPivot;
+	}
+
+	if ( !factorized )
+	{
+		backwardPropagationIdentity( result, VType( 1 ), W );
+		return;
+	}
+
+	lapack::potri( 'U', normal );
+	for ( std::size_t c = 0; c < n; c++ )
+		for ( std::size_t r = 0; r <= c; r++ )
+			result( r, c ) = result( c, r ) = VType( normal( r, c ) * scale( r ) * scale( c ) );
 }
 
+} // namespace Detail
+
 
 /**
  * @ingroup math
- * Performs backward propagation of covariance where the input covariance E is a diagonal matrix given by
- * the vector \c e.
+ * Performs backward propagation of covariance.
  *
- * Given a function y = f(x), known parameters x and a covariance matrix E = diag( e ) of y, the backward propagation
- * computes the covariance C of the parameters x. size(E) >= size(C).
+ * Given a function y = f(x), known parameters x and a covariance matrix E of y, the backward propagation
+ * computes the covariance C = ( J^T * E^-1 * J )^-1 of the parameters x, where J is the jacobian of f.
+ * size(E) >= size(C).
+ *
+ * E is factorized by a Cholesky decomposition E = U^T * U and the jacobian whitened to U^-T * J. If E
+ * is only positive semi-definite, its eigen decomposition is used instead, ignoring directions of zero
+ * variance. All temporaries are taken from the \c MatrixArena.
  *
  * @param result matrix C where the resulting covariance is stored
- * @param input vector e containing the diagonal elements of the input covariance E
- * @param jacobian of the function f evaluated at x. Note: must be column_major and will be modified.
+ * @param input matrix containing the input covariance E
+ * @param function class modeled after \c UnaryFunctionPrototype, describes the measurement function f
+ * @param params parameters x of the function f.
  */
-template< class MT1, class VT2, class MT3 > 
-void backwardPropagationDiagonal( MT1& result, const VT2& input, MT3& jacobian )
+template< class MT1, class MT2, class F, class VT1 > 
+void backwardPropagation( MT1& result, const MT2& input, const F& function, const VT1& params )
 {
 	namespace lapack = boost::numeric::bindings::lapack;
 	namespace blas = boost::numeric::bindings::blas;
 	namespace ublas = boost::numeric::ublas;
 
-	typedef typename MT1::value_type VType;
-	typedef typename Math::Matrix< VType, 0, 0 > MatType;
+	const std::size_t m = input.size1();
+	Math::MatrixArena::Scope arena;
 
-	// multiply jacobian with E^(-1/2)
-	for ( unsigned i = 0; i < result.size1(); i++ )
-		ublas::row( jacobian, i ) *= VType( 1 ) / sqrt( input( i ) );
+	// evaluate jacobian
+	Math::ArenaMatrixd W( m, result.size1() );
+	function.jacobian( params, W );
+
+	// whiten the jacobian by E = U^T * U: W = U^-T * J
+	Math::ArenaMatrixd factor( input );
+	if ( lapack::potrf( 'U', factor ) == 0 )
+		blas::trsm( 'L', 'U', 'T', 'N', 1.0, factor, W );
+	else
+	{
+		// E = Q * T * Q^T: W = T^(-1/2) * Q^T * J
+		factor = input;
+		Math::ArenaVectord t( m );
+		lapack::syev( 'V', 'U', factor, t, lapack::minimal_workspace() );
+
+		const double precision( t( m - 1 ) * 1e-8 );
+		for ( std::size_t i = 0; i < m; i++ )
+			t( i ) = t( i ) < precision ? 0.0 : 1.0 / std::sqrt( t( i ) );
+
+		Math::ArenaMatrixd QW( m, W.size2() );
+		blas::gemm( 'T', 'N', 1.0, factor, W, 0.0, QW );
+		for ( std::size_t i = 0; i < m; i++ )
+			ublas::row( QW, i ) *= t( i );
+		W.swap( QW );
+	}
+
+	Detail::whitenedCovariance( result, W );
+}
 
-	// perform SVD on jacobian
-	MatType dummyU( jacobian.size1(), jacobian.size1() );
-	MatType dummyVt( result.size1(), result.size1() );
-	Math::Vector< VType > s( result.size1() );
-	lapack::gesvd( 'N', 'O', jacobian, s, dummyU, dummyVt );
-
-	// compute singular values of pseudo-inverse
-	VType precision = s( 0 ) * VType( 1e-8 );
-	for ( unsigned i = 0; i < s.size(); i++ )
-		if ( s( i ) < precision )
-			s( i ) = 0;
-		else
-			s( i ) = 1 / s( i );
 
-	// compute covariance
-	for ( unsigned i = 0; i < s.size(); i++ )
-		ublas::row( jacobian, i ) *= s( i );
+/**
+ * @ingroup math
+ * Performs backward propagation of covariance where the input covariance is identity multiplied by some factor \c s.
+ *
+ * Given a function y = f(x), known parameters x and a covariance matrix E = s * I of y, the backward propagation
+ * computes the covariance C = s * ( J^T * J )^-1 of the parameters x. size(E) >= size(C).
+ *
+ * The inverse is computed in double precision by a Cholesky decomposition and only falls back to the SVD
+ * for nearly rank-deficient jacobians. All temporaries are taken from the \c MatrixArena, so calls per frame
+ * do not allocate in steady state.
+ *
+ * @param result matrix C where the resulting covariance is stored
+ * @param s scaling factor of input covariance E. E = s * I
+ * @param function class modeled after \c UnaryFunctionPrototype, describes the measurement function f
+ * @param params parameters x of the function f.
+ */
+template< class MT1, class F, class VT1 > 
+void backwardPropagationIdentity( MT1& result, typename MT1::value_type s, const F& function, const VT1& params )
+{
+	Math::MatrixArena::Scope arena;
 
-	blas::syrk( 'U', 'T', VType( 1 ), ublas::subrange( jacobian, 0, s.size(), 0, s.size() ), VType( 0 ), result );
+	// evaluate jacobian J and whiten it by s^(-1/2)
+	Math::ArenaMatrixd W( function.size(), result.size1() );
+	function.jacobian( params, W );
+	W /= std::sqrt( double( s ) );
 
-	// fill lower half of matrix
-	for ( unsigned r = 1; r < result.size1(); r++ )
-		for ( unsigned c = 0; c < r; c++ )
-			result( r, c ) = result( c, r );
+	Detail::whitenedCovariance( result, W );
 }
 
-		
+
 /**
  * @ingroup math
  * Performs backward propagation of covariance where the input covariance E is a diagonal matrix given by
  * the vector \c e.
  *
  * Given a function y = f(x), known parameters x and a covariance matrix E = diag( e ) of y, the backward propagation
- * computes the covariance C of the parameters x. size(E) >= size(C).
+ * computes the covariance C of the parameters x. size(E) >= size(C). See \c backwardPropagationIdentity.
  *
  * @param result matrix C where the resulting covariance is stored
  * @param input vector e containing the diagonal elements of the input covariance E
@@ -283,14 +304,15 @@ void backwardPropagationDiagonal( MT1& result, const VT2& input, const F& functi
 {
 	namespace ublas = boost::numeric::ublas;
 
-	typedef typename MT1::value_type VType;
-	typedef typename Math::Matrix< VType, 0, 0 > MatType;
+	Math::MatrixArena::Scope arena;
 
-	// evaluate jacobian
-	MatType jacobian( input.size(), result.size1() );
-	function.jacobian( params, jacobian );
+	// evaluate jacobian and multiply it with E^(-1/2)
+	Math::ArenaMatrixd W( input.size(), result.size1() );
+	function.jacobian( params, W );
+	for ( std::size_t i = 0; i < W.size1(); i++ )
+		ublas::row( W, i ) *= 1.0 / std::sqrt( double( input( i ) ) );
 
-	backwardPropagationDiagonal( result, input, jacobian );
+	Detail::whitenedCovariance( result, W );
 }
 		
 }}} // namespace Ubitrack::Math::Stochastic
@@ -40,6 +40,10 @@
 #include "../Vector.h"
 #include "../Matrix.h"
 #include "../ErrorVector.h"
+#include "../PoseListOperations.h"	// ListExecutor
+
+#include <vector>
+#include <boost/bind.hpp>
 
 namespace Ubitrack { namespace Math { namespace Stochastic {
 
@@ -98,41 +102,26 @@ ErrorVector< VType, M > transformWithCovariance( const F& f, const ErrorVector<
 }
 
 
+namespace Detail {
+
 /**
- * Apply a function f that updates a subvector of a given vector from another subvector 
- * of the same vector and update the covariance matrix.
- * 
- * Example usage: time update of a kalman filter.
- *
- * Note: The subvectors may overlap.
- *
- * @param f, see \c transform
- * @param value the vector to be transformed
- * @param covariance covariance of the vector
- * @param iOutBegin first index of the subvector to be updated
- * @param iOutEnd index of element after the subvector to be updated
- * @param iInBegin first index of subvector used as input to f
- * @param iInEnd index of element after subvector used as input to f
+ * @internal
+ * Implementation of \c transformRangeInternalWithCovariance, with the temporary \c result (nOutSize),
+ * \c jacobian (nOutSize x nInSize) and \c im (nOutSize x value.size()) provided by the caller.
  */
-template< class F, class VT, class MT > 
+template< class F, class VT, class MT, class RV, class JM, class IM >
 void transformRangeInternalWithCovariance( const F& f, VT& value, MT& covariance, 
-	unsigned iOutBegin, unsigned iOutEnd, unsigned iInBegin, unsigned iInEnd )
+	unsigned iOutBegin, unsigned iOutEnd, unsigned iInBegin, unsigned iInEnd, RV& result, JM& jacobian, IM& im )
 {
 	namespace ublas = boost::numeric::ublas;
-	typedef typename VT::value_type			VType;
-	typedef typename Math::Matrix< VType >	MatrixType;
-	
 	const unsigned nOutSize = iOutEnd - iOutBegin;
-	const unsigned nInSize = iInEnd - iInBegin;
-	Math::Vector< VType > result( nOutSize );
 	
 	// compute result and jacobian
-	MatrixType jacobian( nOutSize, nInSize );
 	f.evaluateWithJacobian( result, ublas::subrange( value, iInBegin, iInEnd ), jacobian );
 	ublas::subrange( value, iOutBegin, iOutEnd ) = result;
 	
 	// transform covariance in a block-matrix fashion
-	MatrixType im( ublas::prod( jacobian, ublas::subrange( covariance, iInBegin, iInEnd, 0, value.size() ) ) );
+	noalias( im ) = ublas::prod( jacobian, ublas::subrange( covariance, iInBegin, iInEnd, 0, value.size() ) );
 	
 	// the left/upper row/column
 	if ( iOutBegin > 0 )
@@ -157,13 +146,55 @@ void transformRangeInternalWithCovariance( const F& f, VT& value, MT& covariance
 	}		
 }
 
+} // namespace Detail
+
+
+/**
+ * Apply a function f that updates a subvector of a given vector from another subvector 
+ * of the same vector and update the covariance matrix.
+ * 
+ * Example usage: time update of a kalman filter.
+ *
+ * Note: The subvectors may overlap.
+ *
+ * @param f, see \c transform
+ * @param value the vector to be transformed
+ * @param covariance covariance of the vector
+ * @param iOutBegin first index of the subvector to be updated
+ * @param iOutEnd index of element after the subvector to be updated
+ * @param iInBegin first index of subvector used as input to f
+ * @param iInEnd index of element after subvector used as input to f
+ */
+template< class F, class VT, class MT > 
+void transformRangeInternalWithCovariance( const F& f, VT& value, MT& covariance, 
+	unsigned iOutBegin, unsigned iOutEnd, unsigned iInBegin, unsigned iInEnd )
+{
+	typedef typename VT::value_type			VType;
+	typedef typename Math::Matrix< VType >	MatrixType;
+	
+	const unsigned nOutSize = iOutEnd - iOutBegin;
+	const unsigned nInSize = iInEnd - iInBegin;
+	Math::Vector< VType > result( nOutSize );
+	MatrixType jacobian( nOutSize, nInSize );
+	MatrixType im( nOutSize, value.size() );
+	Detail::transformRangeInternalWithCovariance( f, value, covariance, iOutBegin, iOutEnd, iInBegin, iInEnd, result, jacobian, im );
+}
+
 
-/** Overload for \c ErrorVector */
+/** Overload for \c ErrorVector, the temporaries have a fixed size and live on the stack */
 template< unsigned N, class F, class VType > inline 
 void transformRangeInternalWithCovariance( const F& f, ErrorVector< VType, N >& v,
 	unsigned iOutBegin, unsigned iOutEnd, unsigned iInBegin, unsigned iInEnd )
 {
-	transformRangeInternalWithCovariance( f, v.value, v.covariance, iOutBegin, iOutEnd, iInBegin, iInEnd );
+	namespace ublas = boost::numeric::ublas;
+	Math::Vector< VType, N > resultStorage;
+	Math::Matrix< VType, N, N > jacobianStorage;
+	Math::Matrix< VType, N, N > imStorage;
+	ublas::vector_range< Math::Vector< VType, N > > result( resultStorage, ublas::range( 0, iOutEnd - iOutBegin ) );
+	ublas::matrix_range< Math::Matrix< VType, N, N > > jacobian( jacobianStorage, 
+		ublas::range( 0, iOutEnd - iOutBegin ), ublas::range( 0, iInEnd - iInBegin ) );
+	ublas::matrix_range< Math::Matrix< VType, N, N > > im( imStorage, ublas::range( 0, iOutEnd - iOutBegin ), ublas::range( 0, N ) );
+	Detail::transformRangeInternalWithCovariance( f, v.value, v.covariance, iOutBegin, iOutEnd, iInBegin, iInEnd, result, jacobian, im );
 }
 
 
@@ -203,6 +234,122 @@ ErrorVector< VType, M > binarytransformWithCovariance( const F& f, const ErrorVe
 }
 
 
+/**
+ * Computes <tt>result = J * C * J^T</tt> for fixed-size matrices and a symmetric \c C.
+ * Only the upper triangle of the result is computed and then mirrored.
+ */
+template< typename T, std::size_t M, std::size_t N >
+void symmetricTransform( Math::Matrix< T, M, M >& result, const Math::Matrix< T, M, N >& J, const Math::Matrix< T, N, N >& C )
+{
+	T jc[ M ][ N ];
+	for ( std::size_t i = 0; i < M; i++ )
+		for ( std::size_t k = 0; k < N; k++ )
+		{
+			T s( 0 );
+			for ( std::size_t l = 0; l < N; l++ )
+				s += J( i, l ) * C( l, k );
+			jc[ i ][ k ] = s;
+		}
+
+	for ( std::size_t i = 0; i < M; i++ )
+		for ( std::size_t j = i; j < M; j++ )
+		{
+			T s( 0 );
+			for ( std::size_t k = 0; k < N; k++ )
+				s += jc[ i ][ k ] * J( j, k );
+			result( i, j ) = result( j, i ) = s;
+		}
+}
+
+
+/** computes <tt>result += J * C * J^T</tt>, see \c symmetricTransform */
+template< typename T, std::size_t M, std::size_t N >
+void addSymmetricTransform( Math::Matrix< T, M, M >& result, const Math::Matrix< T, M, N >& J, const Math::Matrix< T, N, N >& C )
+{
+	Math::Matrix< T, M, M > product;
+	symmetricTransform( product, J, C );
+	for ( std::size_t i = 0; i < M; i++ )
+		for ( std::size_t j = 0; j < M; j++ )
+			result( i, j ) += product( i, j );
+}
+
+
+namespace Detail {
+
+/// @internal transforms the elements [ begin, end ) with their own jacobians
+template< class F, typename T, std::size_t M, std::size_t N >
+void transformRangeWithCovariance( const F& f, const std::vector< ErrorVector< T, N > >& in, std::vector< ErrorVector< T, M > >& out,
+	const std::size_t begin, const std::size_t end )
+{
+	Math::Matrix< T, M, N > jacobian;
+	for ( std::size_t i = begin; i < end; i++ )
+	{
+		Math::Vector< T, M > value;
+		f.evaluateWithJacobian( value, in[ i ].value, jacobian );
+		symmetricTransform( out[ i ].covariance, jacobian, in[ i ].covariance );
+		out[ i ].value = value;
+	}
+}
+
+/// @internal transforms the elements [ begin, end ) by an affine function
+template< typename T, std::size_t M, std::size_t N >
+void affineRangeWithCovariance( const Math::Matrix< T, M, N >& A, const Math::Vector< T, M >& b,
+	const std::vector< ErrorVector< T, N > >& in, std::vector< ErrorVector< T, M > >& out, const std::size_t begin, const std::size_t end )
+{
+	for ( std::size_t i = begin; i < end; i++ )
+	{
+		Math::Vector< T, M > value( b );
+		for ( std::size_t j = 0; j < M; j++ )
+			for ( std::size_t k = 0; k < N; k++ )
+				value( j ) += A( j, k ) * in[ i ].value( k );
+		symmetricTransform( out[ i ].covariance, A, in[ i ].covariance );
+		out[ i ].value = value;
+	}
+}
+
+} // namespace Detail
+
+
+/**
+ * Transforms a list of vectors with covariance by a function f, like \c transformWithCovariance applied
+ * to each element. The jacobians are fixed-size matrices and the result is written into \c out, which is
+ * resized to the size of the input and may be the input list, so a reused result list needs no allocation.
+ *
+ * @param f function object as described at \c transformWithCovariance, for fixed-size vectors
+ * @param in the input list
+ * @param out the transformed list
+ * @param executor distributes the elements, the default runs them in the calling thread
+ */
+template< class F, typename T, std::size_t M, std::size_t N >
+void transformListWithCovariance( const F& f, const std::vector< ErrorVector< T, N > >& in, std::vector< ErrorVector< T, M > >& out,
+	const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	out.resize( in.size() );
+	if ( executor.empty() )
+		Detail::transformRangeWithCovariance( f, in, out, 0, in.size() );
+	else
+		executor( in.size(), boost::bind( &Detail::transformRangeWithCovariance< F, T, M, N >,
+			boost::cref( f ), boost::cref( in ), boost::ref( out ), _1, _2 ) );
+}
+
+
+/**
+ * Transforms a list of vectors with covariance by the affine function <tt>A * x + b</tt>, whose jacobian
+ * \c A is shared by all elements, e.g. the rotation of a pose. See \c transformListWithCovariance.
+ */
+template< typename T, std::size_t M, std::size_t N >
+void transformListWithCovariance( const Math::Matrix< T, M, N >& A, const Math::Vector< T, M >& b,
+	const std::vector< ErrorVector< T, N > >& in, std::vector< ErrorVector< T, M > >& out,
+	const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	out.resize( in.size() );
+	if ( executor.empty() )
+		Detail::affineRangeWithCovariance( A, b, in, out, 0, in.size() );
+	else
+		executor( in.size(), boost::bind( &Detail::affineRangeWithCovariance< T, M, N >,
+			boost::cref( A ), boost::cref( b ), boost::cref( in ), boost::ref( out ), _1, _2 ) );
+}
+
 }}} // namespace Ubitrack::Math::Stochastic
 
 #endif	// __UBITRACK_MATH_STOCHASTIC_COVARIANCETRANSFORM_H_INCLUDED__
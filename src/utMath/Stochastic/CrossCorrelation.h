@@ -0,0 +1,428 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Cross-correlation of time series over many lags, e.g. for estimating the latency between two trackers.
+ *
+ * \c correlation computes the normalized correlation of two aligned ranges. Scanning L candidate lags with
+ * it costs O(N * L). The functions here compute the same normalized correlation for all lags at once:
+ * - \c crossCorrelation computes the raw cross products of all lags by an FFT in O(N log N) and normalizes
+ *   them with the means and variances of each overlap, which are taken from prefix sums,
+ * - \c SlidingCrossCorrelation keeps the correlations of all lags over the last samples of two streams and
+ *   updates them in O(L) per new pair of samples,
+ * - \c correlationPeak finds the maximum with sub-sample accuracy by a parabola through its neighbours.
+ *
+ * Lags are counted as in <tt>correlation( a[ i ], b[ i + lag ] )</tt>: a positive lag means that the
+ * signal appears in \c b later than in \c a. The correlations of lags -L..L are stored as
+ * <tt>result[ L + lag ]</tt>.
+ */
+
+#ifndef __UBITRACK_MATH_STOCHASTIC_CROSSCORRELATION_H_INCLUDED__
+#define __UBITRACK_MATH_STOCHASTIC_CROSSCORRELATION_H_INCLUDED__
+
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <algorithm>
+
+#include <utUtil/Exception.h>
+
+namespace Ubitrack { namespace Math { namespace Stochastic {
+
+namespace Detail {
+
+/// @internal twiddle factors exp( -2 pi i j / n ) for j < n / 2 of an FFT of size n
+inline void fftTwiddles( std::vector< std::complex< double > >& twiddles, const std::size_t n )
+{
+	const double pi = 3.14159265358979323846;
+	twiddles.resize( n / 2 );
+	for ( std::size_t j = 0; j < n / 2; j++ )
+		twiddles[ j ] = std::complex< double >( std::cos( 2 * pi * j / n ), -std::sin( 2 * pi * j / n ) );
+}
+
+/**
+ * @internal in-place iterative radix-2 forward FFT, the size must be a power of two
+ * and the twiddle factors must be computed for this size
+ */
+inline void fft( std::vector< std::complex< double > >& data, const std::vector< std::complex< double > >& twiddles )
+{
+	const std::size_t n = data.size();
+
+	// bit reversal permutation
+	for ( std::size_t i = 1, j = 0; i < n; i++ )
+	{
+		std::size_t bit = n >> 1;
+		for ( ; j & bit; bit >>= 1 )
+			j ^= bit;
+		j ^= bit;
+		if ( i < j )
+			std::swap( data[ i ], data[ j ] );
+	}
+
+	// butterflies on the interleaved real and imaginary parts
+	double* d = reinterpret_cast< double* >( &data[ 0 ] );
+	const double* w = reinterpret_cast< const double* >( &twiddles[ 0 ] );
+	for ( std::size_t len = 2; len <= n; len <<= 1 )
+	{
+		const std::size_t half = len / 2;
+		const std::size_t stride = n / len;
+		for ( std::size_t i = 0; i < n; i += len )
+			for ( std::size_t j = 0; j < half; j++ )
+			{
+				double* u = d + 2 * ( i + j );
+				double* x = u + 2 * half;
+				const double* wj = w + 2 * j * stride;
+				const double vr = x[ 0 ] * wj[ 0 ] - x[ 1 ] * wj[ 1 ];
+				const double vi = x[ 0 ] * wj[ 1 ] + x[ 1 ] * wj[ 0 ];
+				const double ur = u[ 0 ];
+				const double ui = u[ 1 ];
+				u[ 0 ] = ur + vr;
+				u[ 1 ] = ui + vi;
+				x[ 0 ] = ur - vr;
+				x[ 1 ] = ui - vi;
+			}
+	}
+}
+
+/// @internal normalized correlation from the sums over n pairs, 0 if a variance vanishes
+inline double normalizedCorrelation( const double n, const double sx, const double sy,
+	const double sxx, const double syy, const double sxy )
+{
+	const double varX = sxx - sx * sx / n;
+	const double varY = syy - sy * sy / n;
+	if ( !( varX > 0 ) || !( varY > 0 ) )
+		return 0;
+	return ( sxy - sx * sy / n ) / std::sqrt( varX * varY );
+}
+
+} // namespace Detail
+
+
+/**
+ * Computes the normalized correlations of two sequences for all lags -maxLag..maxLag.
+ *
+ * <tt>result[ maxLag + lag ]</tt> is the correlation of the pairs <tt>( a[ i ], b[ i + lag ] )</tt> that exist
+ * in both sequences, with the means and variances of that overlap, i.e. the value of \c correlation applied
+ * to the overlapping ranges. Lags with fewer than \c minOverlap pairs or a constant overlap get 0.
+ *
+ * @param a first sequence
+ * @param b second sequence
+ * @param maxLag largest absolute lag
+ * @param result the 2 * maxLag + 1 correlations
+ * @param minOverlap minimum number of pairs for a correlation
+ */
+template< typename T >
+void crossCorrelation( const std::vector< T >& a, const std::vector< T >& b, const std::size_t maxLag,
+	std::vector< T >& result, const std::size_t minOverlap = 2 )
+{
+	const std::size_t na = a.size();
+	const std::size_t nb = b.size();
+	result.assign( 2 * maxLag + 1, T( 0 ) );
+	if ( na == 0 || nb == 0 )
+		return;
+
+	// the correlation does not depend on offsets, so center both sequences for accuracy
+	double meanA( 0 );
+	double meanB( 0 );
+	for ( std::size_t i = 0; i < na; i++ )
+		meanA += a[ i ];
+	for ( std::size_t i = 0; i < nb; i++ )
+		meanB += b[ i ];
+	meanA /= na;
+	meanB /= nb;
+
+	// prefix sums of the centered values and their squares
+	std::vector< double > sumA( na + 1, 0.0 ), sumAA( na + 1, 0.0 );
+	std::vector< double > sumB( nb + 1, 0.0 ), sumBB( nb + 1, 0.0 );
+	for ( std::size_t i = 0; i < na; i++ )
+	{
+		const double x = a[ i ] - meanA;
+		sumA[ i + 1 ] = sumA[ i ] + x;
+		sumAA[ i + 1 ] = sumAA[ i ] + x * x;
+	}
+	for ( std::size_t i = 0; i < nb; i++ )
+	{
+		const double y = b[ i ] - meanB;
+		sumB[ i + 1 ] = sumB[ i ] + y;
+		sumBB[ i + 1 ] = sumBB[ i ] + y * y;
+	}
+
+	// cross products of all lags: ifft( conj( fft( a ) ) * fft( b ) ), zero padded against wrap around.
+	// Both real sequences are transformed at once as z = a + i * b.
+	std::size_t n = 1;
+	while ( n < na + nb )
+		n <<= 1;
+	std::vector< std::complex< double > > twiddles;
+	Detail::fftTwiddles( twiddles, n );
+	std::vector< std::complex< double > > z( n );
+	for ( std::size_t i = 0; i < na; i++ )
+		z[ i ].real( a[ i ] - meanA );
+	for ( std::size_t i = 0; i < nb; i++ )
+		z[ i ].imag( b[ i ] - meanB );
+	Detail::fft( z, twiddles );
+
+	// A = ( Z[ k ] + conj( Z[ n - k ] ) ) / 2, B = ( Z[ k ] - conj( Z[ n - k ] ) ) / 2i, product conj( A ) * B,
+	// stored conjugated, as the inverse FFT is computed as conj( fft( conj( x ) ) )
+	std::vector< std::complex< double > > p( n );
+	for ( std::size_t k = 0; k < n; k++ )
+	{
+		const std::complex< double > zk( z[ k ] );
+		const std::complex< double > zn( std::conj( z[ ( n - k ) & ( n - 1 ) ] ) );
+		const double ar = 0.5 * ( zk.real() + zn.real() );
+		const double ai = 0.5 * ( zk.imag() + zn.imag() );
+		const double br = 0.5 * ( zk.imag() - zn.imag() );
+		const double bi = -0.5 * ( zk.real() - zn.real() );
+		p[ k ] = std::complex< double >( ar * br + ai * bi, -( ar * bi - ai * br ) );
+	}
+	Detail::fft( p, twiddles );
+
+	for ( std::size_t l = 0; l < result.size(); l++ )
+	{
+		const long lag = long( l ) - long( maxLag );
+
+		// overlap a[ begin, end ) with b[ begin + lag, end + lag )
+		const long begin = std::max( 0L, -lag );
+		const long end = std::min( long( na ), long( nb ) - lag );
+		if ( end - begin < long( std::max< std::size_t >( minOverlap, 1 ) ) )
+			continue;
+
+		const double count = double( end - begin );
+		const double sxy = p[ lag >= 0 ? lag : long( n ) + lag ].real() / n;
+		result[ l ] = T( Detail::normalizedCorrelation( count,
+			sumA[ end ] - sumA[ begin ], sumB[ end + lag ] - sumB[ begin + lag ],
+			sumAA[ end ] - sumAA[ begin ], sumBB[ end + lag ] - sumBB[ begin + lag ], sxy ) );
+	}
+}
+
+
+/**
+ * Finds the maximum of a list of correlations with sub-sample accuracy.
+ *
+ * The position of the largest value is refined by the vertex of the parabola through it and its two
+ * neighbours. At the borders, the integer position is returned.
+ *
+ * @param correlations the correlations, e.g. from \c crossCorrelation
+ * @param peak if not 0, receives the interpolated value at the maximum
+ * @return the fractional index of the maximum, subtract maxLag to get the lag
+ */
+template< typename T >
+T correlationPeak( const std::vector< T >& correlations, T* peak = 0 )
+{
+	if ( correlations.empty() )
+		UBITRACK_THROW( "correlation peak of an empty list" );
+
+	const std::size_t i = std::max_element( correlations.begin(), correlations.end() ) - correlations.begin();
+	T offset( 0 );
+	T value( correlations[ i ] );
+	if ( i > 0 && i + 1 < correlations.size() )
+	{
+		const T left( correlations[ i - 1 ] );
+		const T right( correlations[ i + 1 ] );
+		const T curvature( left - 2 * value + right );
+		if ( curvature < 0 )
+		{
+			offset = T( 0.5 ) * ( left - right ) / curvature;
+			value -= T( 0.25 ) * ( left - right ) * offset;
+		}
+	}
+
+	if ( peak )
+		*peak = value;
+	return T( i ) + offset;
+}
+
+
+/**
+ * Normalized correlations of two streams for all lags -maxLag..maxLag over a sliding window.
+ *
+ * The samples of both streams are added in pairs with \c push. For each lag, the correlation is computed over
+ * the last \c window pairs <tt>( a[ i ], b[ i + lag ] )</tt> that are complete, i.e. whose later sample has
+ * arrived. Each \c push updates the sums of all lags in O(maxLag). To bound the accumulated rounding error, the
+ * sums are recomputed from the stored samples once per \c window samples.
+ *
+ * @code
+ * Stochastic::SlidingCrossCorrelation< double > engine( 500, 50 );
+ * for each new sample pair: engine.push( imuSpeed, opticalSpeed );
+ * engine.correlations( c );
+ * double lag = Stochastic::correlationPeak( c ) - 50;
+ * @endcode
+ */
+template< typename T >
+class SlidingCrossCorrelation
+{
+public:
+	/**
+	 * @param window number of pairs per lag
+	 * @param maxLag largest absolute lag
+	 */
+	SlidingCrossCorrelation( const std::size_t window, const std::size_t maxLag )
+		: m_window( window )
+		, m_maxLag( maxLag )
+		, m_history( window + maxLag + 1 )
+		, m_a( m_history, 0.0 )
+		, m_b( m_history, 0.0 )
+		, m_sums( 2 * maxLag + 1 )
+	{
+		if ( window < 2 )
+			UBITRACK_THROW( "sliding cross correlation needs a window of at least two samples" );
+		reset();
+	}
+
+	/** removes all samples */
+	void reset()
+	{
+		m_count = 0;
+		m_sinceRecompute = 0;
+		m_offsetA = m_offsetB = 0;
+		std::fill( m_sums.begin(), m_sums.end(), Sums() );
+	}
+
+	/** number of samples pushed since construction or \c reset */
+	std::size_t count() const
+	{ return m_count; }
+
+	/** adds a pair of samples of both streams at the same time */
+	void push( const T a, const T b )
+	{
+		// samples are stored relative to the first ones, which removes most of the offset
+		if ( m_count == 0 )
+		{
+			m_offsetA = a;
+			m_offsetB = b;
+		}
+		const std::size_t t = m_count++;
+		m_a[ t % m_history ] = a - m_offsetA;
+		m_b[ t % m_history ] = b - m_offsetB;
+
+		if ( ++m_sinceRecompute >= m_window )
+		{
+			recompute();
+			return;
+		}
+
+		// the pairs completed at time t are ( a[ t - lag ], b[ t ] ) for positive and ( a[ t ], b[ t + lag ] ) for negative
+		// lags, the pairs leaving the window are those completed at time t - window
+		const std::size_t L = m_maxLag;
+		const bool bLeave = t >= m_window;
+		const std::size_t tOld = bLeave ? t - m_window : 0;
+
+		// positions of the samples k steps before t and before t - window in the ring buffers
+		std::size_t iNew = t % m_history;
+		std::size_t iOld = tOld % m_history;
+		const double aNew = m_a[ iNew ];
+		const double bNew = m_b[ iNew ];
+		const double aOld = m_a[ iOld ];
+		const double bOld = m_b[ iOld ];
+		for ( std::size_t k = 0; k <= L && k <= t; k++ )
+		{
+			Sums& sPositive( m_sums[ L + k ] );
+			sPositive.add( m_a[ iNew ], bNew, 1.0 );
+			if ( k > 0 )
+				m_sums[ L - k ].add( aNew, m_b[ iNew ], 1.0 );
+
+			if ( bLeave && k <= tOld )
+			{
+				sPositive.add( m_a[ iOld ], bOld, -1.0 );
+				if ( k > 0 )
+					m_sums[ L - k ].add( aOld, m_b[ iOld ], -1.0 );
+			}
+
+			iNew = iNew ? iNew - 1 : m_history - 1;
+			iOld = iOld ? iOld - 1 : m_history - 1;
+		}
+	}
+
+	/**
+	 * Computes the correlations of all lags, <tt>result[ maxLag + lag ]</tt>.
+	 * Lags with fewer than two pairs or a constant window get 0.
+	 */
+	void correlations( std::vector< T >& result ) const
+	{
+		result.resize( m_sums.size() );
+		for ( std::size_t l = 0; l < m_sums.size(); l++ )
+		{
+			const Sums& s( m_sums[ l ] );
+			result[ l ] = s.n < 2 ? T( 0 ) : T( Detail::normalizedCorrelation( s.n, s.x, s.y, s.xx, s.yy, s.xy ) );
+		}
+	}
+
+protected:
+	/// @internal sums over the pairs of one lag
+	struct Sums
+	{
+		double n, x, y, xx, yy, xy;
+
+		Sums()
+			: n( 0 ), x( 0 ), y( 0 ), xx( 0 ), yy( 0 ), xy( 0 )
+		{}
+
+		void add( const double a, const double b, const double w )
+		{
+			n += w;
+			x += w * a;
+			y += w * b;
+			xx += w * a * a;
+			yy += w * b * b;
+			xy += w * a * b;
+		}
+	};
+
+	/// @internal sums all lags from the stored samples
+	void recompute()
+	{
+		m_sinceRecompute = 0;
+		const long lagMax( m_maxLag );
+		const long last( m_count - 1 );
+		for ( long lag = -lagMax; lag <= lagMax; lag++ )
+		{
+			Sums& s( m_sums[ lag + lagMax ] );
+			s = Sums();
+
+			// pairs with a[ ia ], b[ ia + lag ] completed at times ( last - window, last ]
+			const long lastA = lag >= 0 ? last - lag : last;
+			for ( long ia = std::max( lastA - long( m_window ) + 1, std::max( 0L, -lag ) ); ia <= lastA; ia++ )
+				s.add( m_a[ ia % m_history ], m_b[ ( ia + lag ) % m_history ], 1.0 );
+		}
+	}
+
+	std::size_t m_window;
+	std::size_t m_maxLag;
+	std::size_t m_history;
+	std::size_t m_count;
+	std::size_t m_sinceRecompute;
+	double m_offsetA;
+	double m_offsetB;
+
+	/// ring buffers of the last samples of both streams
+	std::vector< double > m_a;
+	std::vector< double > m_b;
+
+	/// sums of each lag, index maxLag + lag
+	std::vector< Sums > m_sums;
+};
+
+}}} // namespace Ubitrack::Math::Stochastic
+
+#endif // __UBITRACK_MATH_STOCHASTIC_CROSSCORRELATION_H_INCLUDED__
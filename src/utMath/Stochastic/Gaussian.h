@@ -28,8 +28,14 @@
 // Ubitrack
 #include <utUtil/Exception.h>
 // #include <utUtil/StaticAssert.h>
+#include "Weighted.h"
+#include "../PoseListOperations.h"	// ListExecutor
 
 //std 
+#include <cmath>
+#include <vector>
+#include <iterator>
+#include <algorithm>
 #include <iomanip> // stream output
 
 namespace Ubitrack{ namespace Math { namespace Stochastic {
@@ -117,11 +123,8 @@ bool estimate_gaussian( const InputIterator itBegin, const InputIterator itEnd,
 	
 	{ // calculate mean value
 		for( InputIterator it ( itBegin ); it != itEnd; ++it, ++n )
-		{
-			std::cout << n << "\n";
 			for( std::size_t i( 0 ); i < N; ++i )
 				gaussian.mean[ i ] += (*it)[ i ];
-		}
 		if( n < 1 )
 			return false;
 			
@@ -140,8 +143,6 @@ bool estimate_gaussian( const InputIterator itBegin, const InputIterator itEnd,
 			gaussian.covariance[ i ] /= n;
 	}
 	
-	std::cout <<"Finished With Variance" << std::endl;
-	
 	{ //sum up the squared diagonal entries
 		for( std::size_t i( 0 ); i < N; ++i )	
 			gaussian.variance += ( gaussian.covariance[i*N+i] );
@@ -178,6 +179,7 @@ bool estimate_gaussian_fast( const InputIterator itBegin, const InputIterator it
 };
 
 
+/// @internal estimates the Gaussian of the values whose index equals \c comp_value, see \c estimate_gaussians_index for all clusters at once
 template< typename T, std::size_t N, typename InputIterator1, typename InputIterator2 >
 bool estimate_gaussian_index( const InputIterator1 itBegin, const InputIterator1 itEnd, const InputIterator2 itIndices, const typename std::iterator_traits< InputIterator2 >::value_type comp_value, Gaussian< T, N > &gaussian )
 {
@@ -222,6 +224,328 @@ bool estimate_gaussian_index( const InputIterator1 itBegin, const InputIterator1
 
 
 
+/**
+ * Incremental estimation of a Gaussian distribution from a stream of samples.
+ *
+ * The mean and the covariance are updated with each sample by West's weighted
+ * version of Welford's algorithm in O(N^2), without storing the samples. An optional
+ * forgetting factor in ( 0, 1 ] scales down the weight of all previous samples with
+ * each new one, so the estimate follows slowly changing distributions, e.g. the
+ * jitter of a tracked target. Accumulators of disjoint parts of the samples, e.g. of
+ * several threads, can be merged (Chan et al.).
+ *
+ * Like \c Average, the accumulator can be applied to a container with \c std::for_each:
+ @code
+ GaussianAccumulator< double, 3 > accumulator( 0.99 );
+ accumulator = std::for_each( points.begin(), points.end(), accumulator );
+ Gaussian< double, 3 > gaussian;
+ accumulator.gaussian( gaussian );
+ @endcode
+ *
+ * The covariance is normalized by the sum of the weights, as in \c estimate_gaussian.
+ */
+template< typename T, std::size_t N >
+class GaussianAccumulator
+{
+public:
+	/** typedef to built-in type of the Gaussian distribution */
+	typedef T value_type;
+
+	/** dimension of the Gaussian distribution */
+	static const std::size_t size = N;
+
+	/** constructor, the forgetting factor must be in ( 0, 1 ] */
+	explicit GaussianAccumulator( const T forgetting = 1 )
+		: m_forgetting( forgetting )
+	{
+		if ( !( forgetting > 0 && forgetting <= 1 ) )
+			UBITRACK_THROW( "forgetting factor of a Gaussian accumulator must be in ( 0, 1 ]" );
+		reset();
+	}
+
+	/** removes all samples */
+	void reset()
+	{
+		m_count = 0;
+		m_weight = 0;
+		std::fill( m_mean, m_mean + N, static_cast< T >( 0 ) );
+		std::fill( m_scatter, m_scatter + N * N, static_cast< T >( 0 ) );
+	}
+
+	/** adds a sample with a weight, the sample type needs a subscript operator */
+	template< typename VType >
+	void add( const VType& value, const T w = 1 )
+	{
+		if ( !( w > 0 ) )
+			return;
+
+		const T previous = m_forgetting * m_weight;
+		m_weight = previous + w;
+		m_count++;
+
+		T d[ N ];
+		for( std::size_t i( 0 ); i < N; ++i )
+		{
+			d[ i ] = value[ i ] - m_mean[ i ];
+			m_mean[ i ] += d[ i ] * ( w / m_weight );
+		}
+
+		// the scatter of the old samples decays with their weight
+		const T f = w * previous / m_weight;
+		for( std::size_t i1( 0 ); i1 < N; ++i1 )
+			for( std::size_t i2( i1 ); i2 < N; ++i2 )
+				m_scatter[ i1*N+i2 ] = m_forgetting * m_scatter[ i1*N+i2 ] + f * d[ i1 ] * d[ i2 ];
+	}
+
+	/** adds a sample with weight one */
+	template< typename VType >
+	void operator()( const VType& value )
+	{ add( value ); }
+
+	/**
+	 * adds the samples of another accumulator, as if they had been added to this one.
+	 * The samples of both accumulators are treated as equally old.
+	 */
+	void merge( const GaussianAccumulator& other )
+	{
+		if ( other.m_count == 0 )
+			return;
+		if ( m_count == 0 )
+		{
+			const T forgetting = m_forgetting;
+			*this = other;
+			m_forgetting = forgetting;
+			return;
+		}
+
+		const T weight = m_weight + other.m_weight;
+		T d[ N ];
+		for( std::size_t i( 0 ); i < N; ++i )
+		{
+			d[ i ] = other.m_mean[ i ] - m_mean[ i ];
+			m_mean[ i ] += d[ i ] * ( other.m_weight / weight );
+		}
+
+		const T f = m_weight * other.m_weight / weight;
+		for( std::size_t i1( 0 ); i1 < N; ++i1 )
+			for( std::size_t i2( i1 ); i2 < N; ++i2 )
+				m_scatter[ i1*N+i2 ] += other.m_scatter[ i1*N+i2 ] + f * d[ i1 ] * d[ i2 ];
+
+		m_weight = weight;
+		m_count += other.m_count;
+	}
+
+	/** number of samples added so far */
+	std::size_t count() const
+	{ return m_count; }
+
+	/** sum of the weights of the samples, reduced by the forgetting factor */
+	T weight() const
+	{ return m_weight; }
+
+	/** the current mean */
+	const T* mean() const
+	{ return m_mean; }
+
+	/** returns the current estimate, false if there are no samples yet */
+	bool gaussian( Gaussian< T, N >& result ) const
+	{
+		Stochastic::reset( result );
+		if ( m_count == 0 )
+			return false;
+
+		std::copy( m_mean, m_mean + N, result.mean );
+		for( std::size_t i1( 0 ); i1 < N; ++i1 )
+			for( std::size_t i2( i1 ); i2 < N; ++i2 )
+				result.covariance[ i2*N+i1 ] = result.covariance[ i1*N+i2 ] = m_scatter[ i1*N+i2 ] / m_weight;
+
+		for( std::size_t i( 0 ); i < N; ++i )
+			result.variance += result.covariance[ i*N+i ];
+		result.standardDeviation = std::sqrt( result.variance );
+		return true;
+	}
+
+protected:
+	/** factor applied to the weight of the previous samples with each new one */
+	T m_forgetting;
+
+	/** number of samples */
+	std::size_t m_count;
+
+	/** sum of the (decayed) weights */
+	T m_weight;
+
+	/** the weighted mean */
+	T m_mean[ N ];
+
+	/** upper triangle of the weighted sum of the outer products of the deviations from the mean */
+	T m_scatter[ N * N ];
+};
+
+
+/// @internal random access iterator over a constant weight of one
+template< typename T >
+struct unit_weight_iterator
+{
+	typedef T value_type;
+
+	T operator*() const
+	{ return T( 1 ); }
+
+	unit_weight_iterator& operator++()
+	{ return *this; }
+
+	unit_weight_iterator operator+( const std::ptrdiff_t ) const
+	{ return *this; }
+};
+
+/// @internal adds each value to the accumulator of its cluster, indices of \c nClusters or above are skipped
+template< typename T, std::size_t N, typename InputIterator1, typename InputIterator2, typename InputIterator3 >
+void accumulate_gaussians_index( InputIterator1 it, const InputIterator1 itEnd, InputIterator2 indexIter, InputIterator3 weightIter, const std::size_t nClusters, GaussianAccumulator< T, N >* accumulators )
+{
+	for( ; it != itEnd; ++it, ++indexIter, ++weightIter )
+	{
+		const std::size_t k = static_cast< std::size_t >( *indexIter );
+		if( k < nClusters )
+			accumulators[ k ].add( *it, *weightIter );
+	}
+}
+
+/// @internal the weight of a plain Gaussian is ignored
+template< typename T, std::size_t N >
+void set_mixture_weight( Gaussian< T, N >&, const T )
+{}
+
+/// @internal sets the weight of a weighted Gaussian
+template< typename T, std::size_t N, typename W >
+void set_mixture_weight( Weighted< Gaussian< T, N >, W >& gaussian, const T weight )
+{ gaussian.weight = static_cast< W >( weight ); }
+
+/// @internal writes the Gaussians of the accumulators, returns false if a cluster has no values
+template< typename T, std::size_t N, typename OutputIterator >
+bool gaussians_from_accumulators( const GaussianAccumulator< T, N >* accumulators, const std::size_t nClusters, OutputIterator itGaussians )
+{
+	T total( 0 );
+	for( std::size_t k( 0 ); k < nClusters; ++k )
+		total += accumulators[ k ].weight();
+
+	bool bAll( true );
+	for( std::size_t k( 0 ); k < nClusters; ++k, ++itGaussians )
+	{
+		bAll = accumulators[ k ].gaussian( *itGaussians ) && bAll;
+		set_mixture_weight( *itGaussians, total > 0 ? accumulators[ k ].weight() / total : T( 0 ) );
+	}
+	return bAll;
+}
+
+/// @internal accumulates blocks of values into one set of accumulators per block
+template< typename T, std::size_t N, typename InputIterator1, typename InputIterator2, typename InputIterator3 >
+struct gaussians_index_blocks
+{
+	enum { blockSize = 4096 };
+
+	InputIterator1 values;
+	InputIterator2 indices;
+	InputIterator3 weights;
+	std::size_t n;
+	std::size_t nClusters;
+	GaussianAccumulator< T, N >* accumulators;
+
+	void operator()( const std::size_t begin, const std::size_t end ) const
+	{
+		for( std::size_t b( begin ); b < end; ++b )
+		{
+			const std::size_t first( b * blockSize );
+			const std::size_t last( std::min< std::size_t >( first + blockSize, n ) );
+			accumulate_gaussians_index( values + first, values + last, indices + first, weights + first, nClusters, accumulators + b * nClusters );
+		}
+	}
+};
+
+/// @internal estimates the Gaussians from blocks of values, the partial sums are merged in the order of the blocks
+template< typename T, std::size_t N, typename InputIterator1, typename InputIterator2, typename InputIterator3, typename OutputIterator >
+bool estimate_gaussians_index_blocks( const InputIterator1 itBegin, const InputIterator1 itEnd, const InputIterator2 itIndices, const InputIterator3 itWeights, const std::size_t nClusters, OutputIterator itGaussians, const Math::ListExecutor& executor )
+{
+	typedef gaussians_index_blocks< T, N, InputIterator1, InputIterator2, InputIterator3 > blocks_type;
+	const std::size_t n( std::distance( itBegin, itEnd ) );
+	const std::size_t nBlocks( ( n + blocks_type::blockSize - 1 ) / blocks_type::blockSize );
+	std::vector< GaussianAccumulator< T, N > > accumulators( std::max< std::size_t >( nBlocks, 1 ) * nClusters );
+
+	const blocks_type blocks = { itBegin, itIndices, itWeights, n, nClusters, accumulators.empty() ? 0 : &accumulators[ 0 ] };
+	if( executor.empty() || nBlocks < 2 )
+		blocks( 0, nBlocks );
+	else
+		executor( nBlocks, blocks );
+
+	for( std::size_t b( 1 ); b < nBlocks; ++b )
+		for( std::size_t k( 0 ); k < nClusters; ++k )
+			accumulators[ k ].merge( accumulators[ b * nClusters + k ] );
+	return gaussians_from_accumulators( accumulators.empty() ? 0 : &accumulators[ 0 ], nClusters, itGaussians );
+}
+
+/**
+ * Estimates the Gaussians of all clusters in one pass over the values and their cluster indices.
+ *
+ * Gives the same Gaussians as calling \c estimate_gaussian_index for each cluster, which walks
+ * all values once per cluster. Values with an index of \c nClusters or above, e.g. outliers marked
+ * with -1, are skipped. If the output iterator points to \c Weighted Gaussians, their weights are
+ * set to the fraction of the values in the cluster, as in a Gaussian mixture.
+ *
+ * @param itBegin iterator to the first value, the value type needs a subscript operator
+ * @param itEnd iterator behind the last value
+ * @param itIndices iterator to the cluster index of the first value
+ * @param nClusters number of clusters
+ * @param itGaussians iterator to \c nClusters Gaussians (or weighted Gaussians) to overwrite
+ * @return false if a cluster has no values, its Gaussian is zero
+ */
+template< typename InputIterator1, typename InputIterator2, typename OutputIterator >
+bool estimate_gaussians_index( const InputIterator1 itBegin, const InputIterator1 itEnd, const InputIterator2 itIndices, const std::size_t nClusters, OutputIterator itGaussians )
+{
+	typedef typename std::iterator_traits< OutputIterator >::value_type gaussian_type;
+	typedef typename gaussian_type::value_type T;
+	return estimate_gaussians_index( itBegin, itEnd, itIndices, unit_weight_iterator< T >(), nClusters, itGaussians );
+}
+
+/**
+ * Estimates the weighted Gaussians of all clusters in one pass, see above. The covariances are
+ * normalized by the sum of the weights of each cluster, the weights of \c Weighted Gaussians are
+ * the fractions of the total weight in the clusters.
+ */
+template< typename InputIterator1, typename InputIterator2, typename InputIterator3, typename OutputIterator >
+bool estimate_gaussians_index( const InputIterator1 itBegin, const InputIterator1 itEnd, const InputIterator2 itIndices, const InputIterator3 itWeights, const std::size_t nClusters, OutputIterator itGaussians )
+{
+	typedef typename std::iterator_traits< OutputIterator >::value_type gaussian_type;
+	typedef typename gaussian_type::value_type T;
+	static const std::size_t N = gaussian_type::size;
+	std::vector< GaussianAccumulator< T, N > > accumulators( nClusters );
+	if( nClusters == 0 )
+		return true;
+	accumulate_gaussians_index( itBegin, itEnd, itIndices, itWeights, nClusters, &accumulators[ 0 ] );
+	return gaussians_from_accumulators( &accumulators[ 0 ], nClusters, itGaussians );
+}
+
+/**
+ * Estimates the Gaussians of all clusters in one pass, see above, with blocks of values distributed
+ * by the executor. Each block has its own accumulators, which are merged in the order of the blocks,
+ * so the result does not depend on the number of threads. The iterators must be random access iterators.
+ */
+template< typename InputIterator1, typename InputIterator2, typename OutputIterator >
+bool estimate_gaussians_index( const InputIterator1 itBegin, const InputIterator1 itEnd, const InputIterator2 itIndices, const std::size_t nClusters, OutputIterator itGaussians, const Math::ListExecutor& executor )
+{
+	typedef typename std::iterator_traits< OutputIterator >::value_type gaussian_type;
+	typedef typename gaussian_type::value_type T;
+	return estimate_gaussians_index( itBegin, itEnd, itIndices, unit_weight_iterator< T >(), nClusters, itGaussians, executor );
+}
+
+/** weighted version of the estimation with an executor, see above */
+template< typename InputIterator1, typename InputIterator2, typename InputIterator3, typename OutputIterator >
+bool estimate_gaussians_index( const InputIterator1 itBegin, const InputIterator1 itEnd, const InputIterator2 itIndices, const InputIterator3 itWeights, const std::size_t nClusters, OutputIterator itGaussians, const Math::ListExecutor& executor )
+{
+	typedef typename std::iterator_traits< OutputIterator >::value_type gaussian_type;
+	return estimate_gaussians_index_blocks< typename gaussian_type::value_type, gaussian_type::size >( itBegin, itEnd, itIndices, itWeights, nClusters, itGaussians, executor );
+}
+
+
 /** @internal overrides the stream output to have nicely aligned data */
 template< typename T, std::size_t N >
 std::ostream& operator<<( std::ostream& s, const Gaussian< T, N >& gauss )
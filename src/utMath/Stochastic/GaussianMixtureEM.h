@@ -0,0 +1,452 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math stochastic
+ * @file
+ *
+ * Expectation maximization of Gaussian mixture models for large sets of fixed-size vectors.
+ *
+ * \c GaussianMixtureEM estimates the same mixtures of \c Weighted< Gaussian< T, N > > as
+ * \c expectation_maximization, but is meant for hundreds of thousands of samples:
+ * - the Cholesky factor and the normalization of each component are computed once
+ *   per iteration instead of once per evaluated density,
+ * - the log densities of a block of samples are computed by \c Util::simd_pack on the
+ *   samples in structure of arrays layout, and the responsibilities are normalized
+ *   by a log-sum-exp, which does not underflow for samples far from all components,
+ * - the expectation step accumulates the sufficient statistics of the maximization step,
+ *   so the samples are visited once per iteration,
+ * - the blocks of samples can be distributed over several threads with a \c Math::ListExecutor.
+ *
+ * The statistics of each block are merged in block order, so the result does not depend
+ * on the executor. As the executor gets the number of blocks, create it with a small chunk size:
+ * @code
+ * std::vector< Stochastic::Weighted< Stochastic::Gaussian< double, 3 >, double > > mixture( initial );
+ * Stochastic::GaussianMixtureEM< double, 3 > em;
+ * em.estimate( points, mixture, Math::threadExecutor( 0, 1 ) );
+ * // em.logDensities() holds log p( x ) of each point, e.g. to reject outliers
+ * @endcode
+ */
+
+#ifndef __UBITRACK_MATH_STOCHASTIC_GAUSSIANMIXTUREEM_H_INCLUDED__
+#define __UBITRACK_MATH_STOCHASTIC_GAUSSIANMIXTUREEM_H_INCLUDED__
+
+#include "Gaussian.h"
+#include "Weighted.h"
+#include "../Vector.h"
+#include "../PoseListOperations.h"	// ListExecutor
+#include "../Util/simd_traits.h"
+
+#include <utUtil/Exception.h>
+#include <utUtil/TracingProvider.h>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include <boost/bind.hpp>
+#include <boost/static_assert.hpp>
+
+namespace Ubitrack { namespace Math { namespace Stochastic {
+
+/**
+ * @ingroup math stochastic
+ * Gaussian mixture estimation of \c Math::Vector< T, N >, see GaussianMixtureEM.h.
+ *
+ * @tparam T the element type, \c float or \c double
+ * @tparam N the dimension of the samples
+ */
+template< typename T, std::size_t N >
+class GaussianMixtureEM
+{
+	BOOST_STATIC_ASSERT( N > 0 );
+
+public:
+	typedef Math::Vector< T, N > vector_type;
+	typedef Weighted< Gaussian< T, N >, T > component_type;
+
+	/**
+	 * Constructor.
+	 * @param maxIterations maximum number of maximization steps of \c estimate
+	 * @param threshold \c estimate stops if the mean log-likelihood changes by less than this fraction
+	 * @param regularization added to the diagonal of the estimated covariances, keeps components
+	 *   of (nearly) coplanar samples invertible
+	 */
+	GaussianMixtureEM( const std::size_t maxIterations = 100, const T threshold = T( 1e-5 ), const T regularization = T( 0 ) )
+		: m_maxIterations( maxIterations )
+		, m_threshold( threshold )
+		, m_regularization( regularization )
+		, m_iterations( 0 )
+	{}
+
+	/**
+	 * Refines the mixture by expectation maximization, starting from the given components.
+	 * Components that lose all samples or whose covariance is singular get a weight of zero
+	 * and keep their parameters.
+	 * @param points the samples
+	 * @param components the initial mixture, replaced by the estimated one
+	 * @param executor distributes the blocks of samples, the default runs them in the calling thread
+	 * @return the mean log-likelihood of the samples under the estimated mixture
+	 */
+	T estimate( const std::vector< vector_type >& points, std::vector< component_type >& components,
+		const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		if ( points.empty() || components.empty() )
+			UBITRACK_THROW( "expectation maximization requires samples and components" );
+
+		const std::size_t n = points.size();
+		const std::size_t nBlocks = ( n + blockSize - 1 ) / blockSize;
+		m_logDensities.resize( n );
+		m_blockLikelihoods.resize( nBlocks );
+		m_blockStatistics.resize( nBlocks * components.size() * statisticsSize );
+
+		double likelihood = 0;
+		for ( m_iterations = 0; ; m_iterations++ )
+		{
+			prepareComponents( components );
+			run( executor, nBlocks, boost::bind( &GaussianMixtureEM::expectationBlocks, this, &points[ 0 ], n, true, _1, _2 ) );
+
+			double newLikelihood = 0;
+			for ( std::size_t b = 0; b < nBlocks; b++ )
+				newLikelihood += m_blockLikelihoods[ b ];
+			newLikelihood /= n;
+			TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION( "gaussian_mixture_em", m_iterations, components.size(), newLikelihood );
+
+			const bool bConverged = m_iterations > 0 && std::fabs( likelihood - newLikelihood ) < m_threshold * std::fabs( likelihood );
+			likelihood = newLikelihood;
+			if ( bConverged || m_iterations == m_maxIterations )
+				break;
+
+			maximization( components, n, nBlocks );
+		}
+		return static_cast< T >( likelihood );
+	}
+
+	/**
+	 * Computes the log densities of the samples under the mixture without changing it.
+	 * @return the mean log-likelihood of the samples
+	 */
+	T evaluate( const std::vector< vector_type >& points, const std::vector< component_type >& components,
+		const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		if ( components.empty() )
+			UBITRACK_THROW( "expectation maximization requires samples and components" );
+
+		const std::size_t n = points.size();
+		m_logDensities.resize( n );
+		if ( n == 0 )
+			return T( 0 );
+
+		const std::size_t nBlocks = ( n + blockSize - 1 ) / blockSize;
+		m_blockLikelihoods.resize( nBlocks );
+		prepareComponents( components );
+		run( executor, nBlocks, boost::bind( &GaussianMixtureEM::expectationBlocks, this, &points[ 0 ], n, false, _1, _2 ) );
+
+		double likelihood = 0;
+		for ( std::size_t b = 0; b < nBlocks; b++ )
+			likelihood += m_blockLikelihoods[ b ];
+		return static_cast< T >( likelihood / n );
+	}
+
+	/** log densities of the samples of the last call to \c estimate or \c evaluate under the resulting mixture */
+	const std::vector< T >& logDensities() const
+	{ return m_logDensities; }
+
+	/** number of maximization steps of the last call to \c estimate */
+	std::size_t iterations() const
+	{ return m_iterations; }
+
+protected:
+	/// number of samples per block of the expectation step, a multiple of all SIMD pack sizes
+	enum { blockSize = 256 };
+
+	/// number of statistics per component and block: weight, first and second moments
+	enum { statisticsSize = 1 + N + ( N * ( N + 1 ) ) / 2 };
+
+	/// @internal a component prepared for the evaluation of its log density
+	struct Prepared
+	{
+		/// the mean
+		T mean[ N ];
+
+		/// row-wise lower triangle of the Cholesky factor of the covariance
+		T cholesky[ N * N ];
+
+		/// logarithm of the weight and the normalization of the density
+		T logConstant;
+
+		/// false, if the weight is zero or the covariance is singular
+		bool valid;
+	};
+
+	/// @internal runs the task with the executor, or sequentially if there is none
+	static void run( const Math::ListExecutor& executor, const std::size_t n, const boost::function< void ( std::size_t, std::size_t ) >& task )
+	{
+		if ( n == 0 )
+			return;
+		if ( executor.empty() )
+			task( 0, n );
+		else
+			executor( n, task );
+	}
+
+	/// @internal factorizes the covariances, throws if no component remains
+	void prepareComponents( const std::vector< component_type >& components )
+	{
+		const T logNormalization = T( -0.5 * N * std::log( 2 * 3.14159265358979323846 ) );
+
+		m_prepared.resize( components.size() );
+		bool bAnyValid = false;
+		for ( std::size_t k = 0; k < components.size(); k++ )
+		{
+			const component_type& c( components[ k ] );
+			Prepared& p( m_prepared[ k ] );
+			std::copy( c.mean, c.mean + N, p.mean );
+			std::fill( p.cholesky, p.cholesky + N * N, T( 0 ) );
+			p.valid = c.weight > 0;
+
+			T logDeterminant( 0 );
+			for ( std::size_t j = 0; j < N && p.valid; j++ )
+				for ( std::size_t l = 0; l <= j; l++ )
+				{
+					T s = c.covariance[ j * N + l ];
+					for ( std::size_t m = 0; m < l; m++ )
+						s -= p.cholesky[ j * N + m ] * p.cholesky[ l * N + m ];
+					if ( l < j )
+						p.cholesky[ j * N + l ] = s / p.cholesky[ l * N + l ];
+					else if ( s > 0 && s == s )
+					{
+						p.cholesky[ j * N + j ] = std::sqrt( s );
+						logDeterminant += std::log( s );
+					}
+					else
+						p.valid = false;
+				}
+
+			p.logConstant = p.valid ? std::log( c.weight ) + logNormalization - T( 0.5 ) * logDeterminant : T( 0 );
+			bAnyValid = bAnyValid || p.valid;
+		}
+
+		if ( !bAnyValid )
+			UBITRACK_THROW( "expectation maximization: all components have zero weight or a singular covariance" );
+	}
+
+	/// @internal copies the differences of the samples of a block to the mean of the component to d
+	static void centerBlock( const vector_type* x, const std::size_t m, const std::size_t mPadded, const T* mean, T* d )
+	{
+		for ( std::size_t j = 0; j < N; j++ )
+		{
+			T* dj( d + j * blockSize );
+			for ( std::size_t i = 0; i < m; i++ )
+				dj[ i ] = x[ i ]( j ) - mean[ j ];
+			std::fill( dj + m, dj + mPadded, T( 0 ) );
+		}
+	}
+
+	/// @internal log density of the centered samples d under the component, by forward substitution with the Cholesky factor
+	static void logDensityBlock( const Prepared& p, const std::size_t mPadded, const T* d, T* y, T* logp )
+	{
+		typedef Util::simd_pack< T > Pack;
+		const typename Pack::type half( Pack::set1( T( -0.5 ) ) );
+		const typename Pack::type constant( Pack::set1( p.logConstant ) );
+
+		for ( std::size_t i = 0; i < mPadded; i += Pack::size )
+		{
+			typename Pack::type acc( Pack::set1( T( 0 ) ) );
+			for ( std::size_t j = 0; j < N; j++ )
+			{
+				typename Pack::type yj( Pack::load( d + j * blockSize + i ) );
+				for ( std::size_t l = 0; l < j; l++ )
+					yj = Pack::sub( yj, Pack::mul( Pack::set1( p.cholesky[ j * N + l ] ), Pack::load( y + l * blockSize + i ) ) );
+				yj = Pack::div( yj, Pack::set1( p.cholesky[ j * N + j ] ) );
+				Pack::store( y + j * blockSize + i, yj );
+				acc = Pack::add( acc, Pack::mul( yj, yj ) );
+			}
+			Pack::store( logp + i, Pack::add( constant, Pack::mul( half, acc ) ) );
+		}
+	}
+
+	/// @internal expectation step on the blocks [ begin, end ), optionally accumulating the statistics of each block
+	void expectationBlocks( const vector_type* points, const std::size_t n, const bool bStatistics, const std::size_t begin, const std::size_t end )
+	{
+		typedef Util::simd_pack< T > Pack;
+		const std::size_t nComponents = m_prepared.size();
+		const T minusInf = -std::numeric_limits< T >::infinity();
+
+		std::vector< T > d( N * blockSize );
+		std::vector< T > y( N * blockSize );
+		std::vector< T > logp( nComponents * blockSize );
+		// the largest log term of each sample, then one over the sum of the scaled terms
+		std::vector< T > scale( blockSize );
+
+		for ( std::size_t b = begin; b < end; b++ )
+		{
+			const std::size_t i0 = b * blockSize;
+			const std::size_t m = std::min( std::size_t( blockSize ), n - i0 );
+			const std::size_t mPadded = ( ( m + Pack::size - 1 ) / Pack::size ) * Pack::size;
+			const vector_type* x( points + i0 );
+
+			// log of weight times density of each component
+			for ( std::size_t k = 0; k < nComponents; k++ )
+				if ( m_prepared[ k ].valid )
+				{
+					centerBlock( x, m, mPadded, m_prepared[ k ].mean, &d[ 0 ] );
+					logDensityBlock( m_prepared[ k ], mPadded, &d[ 0 ], &y[ 0 ], &logp[ k * blockSize ] );
+				}
+				else
+					std::fill( &logp[ k * blockSize ], &logp[ k * blockSize ] + mPadded, minusInf );
+
+			// log-sum-exp over the components, relative to the largest term
+			for ( std::size_t i = 0; i < mPadded; i += Pack::size )
+			{
+				typename Pack::type mx( Pack::load( &logp[ i ] ) );
+				for ( std::size_t k = 1; k < nComponents; k++ )
+					mx = Pack::max( mx, Pack::load( &logp[ k * blockSize + i ] ) );
+				Pack::store( &scale[ i ], mx );
+			}
+			// the scaled terms replace the log densities, their normalized values are the responsibilities
+			double likelihood = 0;
+			for ( std::size_t i = 0; i < m; i++ )
+			{
+				T s( 0 );
+				for ( std::size_t k = 0; k < nComponents; k++ )
+					s += logp[ k * blockSize + i ] = std::exp( logp[ k * blockSize + i ] - scale[ i ] );
+				m_logDensities[ i0 + i ] = scale[ i ] + std::log( s );
+				likelihood += m_logDensities[ i0 + i ];
+				scale[ i ] = T( 1 ) / s;
+			}
+			m_blockLikelihoods[ b ] = likelihood;
+
+			if ( !bStatistics )
+				continue;
+
+			// responsibilities and moments about the current means
+			for ( std::size_t k = 0; k < nComponents; k++ )
+			{
+				double* stats( &m_blockStatistics[ ( b * nComponents + k ) * statisticsSize ] );
+				std::fill( stats, stats + statisticsSize, 0.0 );
+				if ( !m_prepared[ k ].valid )
+					continue;
+
+				T* gamma( &logp[ k * blockSize ] );
+				for ( std::size_t i = 0; i < m; i++ )
+					gamma[ i ] *= scale[ i ];
+
+				centerBlock( x, m, mPadded, m_prepared[ k ].mean, &d[ 0 ] );
+				for ( std::size_t i = 0; i < m; i++ )
+					stats[ 0 ] += gamma[ i ];
+
+				double* s2( stats + 1 + N );
+				for ( std::size_t j = 0; j < N; j++ )
+				{
+					const T* dj( &d[ j * blockSize ] );
+					T* gj( &y[ j * blockSize ] );
+					double sFirst( 0 );
+					for ( std::size_t i = 0; i < m; i++ )
+					{
+						gj[ i ] = gamma[ i ] * dj[ i ];
+						sFirst += gj[ i ];
+					}
+					stats[ 1 + j ] = sFirst;
+
+					for ( std::size_t l = j; l < N; l++, s2++ )
+					{
+						const T* dl( &d[ l * blockSize ] );
+						double sProduct( 0 );
+						for ( std::size_t i = 0; i < m; i++ )
+							sProduct += gj[ i ] * dl[ i ];
+						*s2 = sProduct;
+					}
+				}
+			}
+		}
+	}
+
+	/// @internal merges the statistics of the blocks in order and re-estimates the components
+	void maximization( std::vector< component_type >& components, const std::size_t n, const std::size_t nBlocks )
+	{
+		const std::size_t nComponents = components.size();
+		std::vector< double > stats( statisticsSize );
+		for ( std::size_t k = 0; k < nComponents; k++ )
+		{
+			if ( !m_prepared[ k ].valid )
+			{
+				components[ k ].weight = 0;
+				continue;
+			}
+
+			std::fill( stats.begin(), stats.end(), 0.0 );
+			for ( std::size_t b = 0; b < nBlocks; b++ )
+			{
+				const double* blockStats( &m_blockStatistics[ ( b * nComponents + k ) * statisticsSize ] );
+				for ( std::size_t s = 0; s < statisticsSize; s++ )
+					stats[ s ] += blockStats[ s ];
+			}
+
+			component_type& c( components[ k ] );
+			const double weight = stats[ 0 ];
+			if ( !( weight > 0 ) )
+			{
+				c.weight = 0;
+				continue;
+			}
+
+			// the moments are taken about the old mean
+			double shift[ N ];
+			for ( std::size_t j = 0; j < N; j++ )
+			{
+				shift[ j ] = stats[ 1 + j ] / weight;
+				c.mean[ j ] = static_cast< T >( m_prepared[ k ].mean[ j ] + shift[ j ] );
+			}
+
+			const double* s2( &stats[ 1 + N ] );
+			for ( std::size_t j = 0; j < N; j++ )
+				for ( std::size_t l = j; l < N; l++, s2++ )
+					c.covariance[ l * N + j ] = c.covariance[ j * N + l ] = static_cast< T >( *s2 / weight - shift[ j ] * shift[ l ] );
+
+			c.variance = 0;
+			for ( std::size_t j = 0; j < N; j++ )
+			{
+				c.covariance[ j * N + j ] += m_regularization;
+				c.variance += c.covariance[ j * N + j ];
+			}
+			c.standardDeviation = std::sqrt( c.variance );
+			c.weight = static_cast< T >( weight / n );
+		}
+	}
+
+	std::size_t m_maxIterations;
+	T m_threshold;
+	T m_regularization;
+	std::size_t m_iterations;
+
+	std::vector< Prepared > m_prepared;
+	std::vector< T > m_logDensities;
+	std::vector< double > m_blockLikelihoods;
+	std::vector< double > m_blockStatistics;
+};
+
+} } } // namespace Ubitrack::Math::Stochastic
+
+#endif // __UBITRACK_MATH_STOCHASTIC_GAUSSIANMIXTUREEM_H_INCLUDED__
@@ -0,0 +1,138 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * Chi-square gating of kalman filter measurements
+ */
+
+#ifndef __UBITRACK_MATH_STOCHASTIC_INNOVATIONGATE_H_INCLUDED__
+#define __UBITRACK_MATH_STOCHASTIC_INNOVATIONGATE_H_INCLUDED__
+
+#include <limits>
+#include <cassert>
+
+#include <boost/math/distributions/chi_squared.hpp>
+
+namespace Ubitrack { namespace Math { namespace Stochastic {
+
+/**
+ * Gate on the innovation of a kalman filter measurement update.
+ *
+ * For a measurement \c z with predicted measurement \c h and innovation covariance
+ * <tt>S = H * P * H^T + R</tt>, the update computes the squared Mahalanobis distance
+ * <tt>d^2 = ( z - h )^T * S^-1 * ( z - h )</tt> from the factorization of \c S it needs for the
+ * gain anyway, and rejects the measurement without changing the state if \c d^2 exceeds the
+ * threshold. For a consistent filter \c d^2 is chi-square distributed with as many degrees of
+ * freedom as the measurement has elements, so \c chiSquare gives the threshold for a desired
+ * probability of accepting a correct measurement.
+ */
+struct InnovationGate
+{
+	/** constructs a gate with the given threshold, the default accepts every measurement */
+	explicit InnovationGate( double threshold = std::numeric_limits< double >::infinity() )
+		: threshold( threshold )
+		, distance( 0 )
+	{}
+
+	/**
+	 * Returns a gate that accepts a correct measurement with \c dof elements with the given probability,
+	 * e.g. 0.997. A probability of 0 or 1 returns a gate that accepts every measurement.
+	 */
+	static InnovationGate chiSquare( std::size_t dof, double probability )
+	{
+		if ( probability <= 0 || probability >= 1 )
+			return InnovationGate();
+		return InnovationGate( boost::math::quantile( boost::math::chi_squared_distribution< double >( double( dof ) ), probability ) );
+	}
+
+	/** returns true if a squared distance passes the gate */
+	bool accepts( double squaredDistance ) const
+	{ return squaredDistance <= threshold; }
+
+	/** measurements with a larger squared Mahalanobis distance of the innovation are rejected */
+	double threshold;
+
+	/** set by the update to the squared Mahalanobis distance of the last innovation */
+	double distance;
+};
+
+
+/**
+ * Chi-square gates with the same probability for measurements of different sizes, as used by the
+ * filters in utTracking. The thresholds are computed once when the probability is set, and the
+ * filters count the measurements they rejected here.
+ */
+class InnovationGates
+{
+public:
+	/** the largest measurement size */
+	static const std::size_t maxSize = 9;
+
+	/** constructor, gating is disabled */
+	InnovationGates()
+		: m_probability( 0 )
+		, m_rejected( 0 )
+	{}
+
+	/**
+	 * Sets the probability with which a correct measurement passes its gate, e.g. 0.997.
+	 * 0 disables gating.
+	 */
+	void setProbability( double probability )
+	{
+		m_probability = probability;
+		for ( std::size_t i = 1; i <= maxSize; i++ )
+			m_gates[ i ] = InnovationGate::chiSquare( i, probability );
+	}
+
+	/** returns the probability, 0 if gating is disabled */
+	double probability() const
+	{ return m_probability; }
+
+	/** returns the gate for measurements with \c size elements, 0 if gating is disabled */
+	InnovationGate* gate( std::size_t size )
+	{
+		assert( size > 0 && size <= maxSize );
+		return m_probability > 0 && m_probability < 1 ? &m_gates[ size ] : 0;
+	}
+
+	/** counts a rejected measurement */
+	void countRejected()
+	{ m_rejected++; }
+
+	/** returns the number of rejected measurements */
+	std::size_t rejected() const
+	{ return m_rejected; }
+
+protected:
+	double m_probability;
+	std::size_t m_rejected;
+	InnovationGate m_gates[ maxSize + 1 ];
+};
+
+} } } // namespace Ubitrack::Math::Stochastic
+
+#endif
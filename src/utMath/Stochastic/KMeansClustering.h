@@ -0,0 +1,547 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math stochastic
+ * @file
+ *
+ * k-means clustering of large sets of fixed-size vectors.
+ *
+ * \c KMeansClustering implements the same clustering as \c k_means, but is meant for
+ * hundreds of thousands of points, e.g. 3D marker detections:
+ * - the centroids are seeded by greedy k-means++ (squared distance weighting),
+ * - the distances of a point to all centroids are computed with \c Util::simd_pack
+ *   on the centroids in structure of arrays layout,
+ * - Hamerly's bounds skip the distance computations for most points once the
+ *   centroids settle,
+ * - the assignment step runs on blocks of points that can be distributed over
+ *   several threads with a \c Math::ListExecutor,
+ * - \c miniBatchUpdate refines the centroids from small batches of streaming data
+ *   (Sculley, "Web-scale k-means clustering", 2010).
+ *
+ * The points are split into blocks of a fixed size, whose partial sums are reduced in order,
+ * so the result does not depend on the executor. As the executor gets the number of blocks,
+ * create it with a small chunk size:
+ * @code
+ * Stochastic::KMeansClustering< double, 3 > kmeans( 16 );
+ * kmeans.cluster( points, Math::threadExecutor( 0, 1 ) );
+ * const std::vector< std::size_t >& indices( kmeans.indices() );
+ * @endcode
+ *
+ * The seeding uses the global generator of Random/Scalar.h.
+ */
+
+#ifndef __UBITRACK_MATH_STOCHASTIC_KMEANSCLUSTERING_H_INCLUDED__
+#define __UBITRACK_MATH_STOCHASTIC_KMEANSCLUSTERING_H_INCLUDED__
+
+#include "Gaussian.h"
+#include "../Vector.h"
+#include "../PoseListOperations.h"	// ListExecutor
+#include "../Random/Scalar.h"
+#include "../Util/simd_traits.h"
+
+#include <utUtil/Exception.h>
+#include <utUtil/Progress.h>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include <boost/bind.hpp>
+#include <boost/static_assert.hpp>
+
+namespace Ubitrack { namespace Math { namespace Stochastic {
+
+/**
+ * @ingroup math stochastic
+ * k-means clustering of \c Math::Vector< T, N >, see KMeansClustering.h.
+ *
+ * @tparam T the element type, \c float or \c double
+ * @tparam N the dimension of the points
+ */
+template< typename T, std::size_t N >
+class KMeansClustering
+{
+	BOOST_STATIC_ASSERT( N > 0 );
+
+public:
+	typedef Math::Vector< T, N > vector_type;
+
+	/**
+	 * Constructor.
+	 * @param nClusters number of clusters
+	 * @param maxIterations maximum number of iterations of \c cluster
+	 * @param tolerance \c cluster stops if no centroid moves farther than this
+	 */
+	KMeansClustering( const std::size_t nClusters, const std::size_t maxIterations = 100, const T tolerance = T( 0 ) )
+		: m_nClusters( nClusters )
+		, m_maxIterations( maxIterations )
+		, m_tolerance( tolerance )
+		, m_stride( ( ( nClusters + Util::simd_pack< T >::size - 1 ) / Util::simd_pack< T >::size ) * Util::simd_pack< T >::size )
+		, m_iterations( 0 )
+	{
+		if ( nClusters == 0 )
+			UBITRACK_THROW( "k-means requires at least one cluster" );
+	}
+
+	/** replaces the centroids, e.g. by the result of the last frame */
+	void setCentroids( const std::vector< vector_type >& centroids )
+	{
+		if ( centroids.size() != m_nClusters )
+			UBITRACK_THROW( "wrong number of k-means centroids" );
+		m_centroids = centroids;
+		m_counts.assign( m_nClusters, 0 );
+	}
+
+	/**
+	 * chooses the centroids from the points by greedy k-means++: each further centroid is the best of
+	 * <tt>2 + log( k )</tt> candidates, which are drawn with a probability proportional to the squared
+	 * distance of a point to the closest centroid so far
+	 */
+	void seed( const std::vector< vector_type >& points, const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		const std::size_t n = points.size();
+		if ( n < m_nClusters )
+			UBITRACK_THROW( "k-means requires at least as many points as clusters" );
+
+		const std::size_t nBlocks = ( n + blockSize - 1 ) / blockSize;
+		const std::size_t nTrials = 2 + static_cast< std::size_t >( std::log( double( m_nClusters ) ) );
+		m_blockPotentials.resize( nBlocks );
+		m_minDistances.assign( n, std::numeric_limits< T >::max() );
+
+		m_centroids.clear();
+		m_centroids.push_back( points[ Math::Random::distribute_uniform< std::size_t >( 0, n - 1 ) ] );
+		while ( m_centroids.size() < m_nClusters )
+		{
+			run( executor, nBlocks, boost::bind( &KMeansClustering::updateSeedDistances, this, &points[ 0 ], n, _1, _2 ) );
+			double sum = 0;
+			for ( std::size_t i = 0; i < n; i++ )
+				sum += m_minDistances[ i ];
+
+			// keep the candidate that reduces the sum of the squared distances most
+			std::size_t best = 0;
+			double bestPotential = std::numeric_limits< double >::max();
+			for ( std::size_t t = 0; t < nTrials; t++ )
+			{
+				const std::size_t candidate = sampleSeed( sum );
+				run( executor, nBlocks, boost::bind( &KMeansClustering::potentialBlocks, this, &points[ 0 ], n, candidate, _1, _2 ) );
+				double potential = 0;
+				for ( std::size_t b = 0; b < nBlocks; b++ )
+					potential += m_blockPotentials[ b ];
+				if ( potential < bestPotential )
+				{
+					bestPotential = potential;
+					best = candidate;
+				}
+			}
+			m_centroids.push_back( points[ best ] );
+		}
+		m_counts.assign( m_nClusters, 0 );
+	}
+
+	/**
+	 * clusters the points by Lloyd's algorithm, pruned with Hamerly's bounds. If no centroids have been
+	 * seeded or set before, the centroids are seeded by \c seed. Clusters that lose all points keep their
+	 * centroid.
+	 * @param points the points to cluster, at least as many as clusters
+	 * @param executor distributes the blocks of points, the default runs them in the calling thread
+	 * @return the sum of the squared distances of the points to their centroids
+	 */
+	T cluster( const std::vector< vector_type >& points, const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		const std::size_t n = points.size();
+		if ( n < m_nClusters )
+			UBITRACK_THROW( "k-means requires at least as many points as clusters" );
+		if ( m_centroids.size() != m_nClusters )
+			seed( points, executor );
+
+		const std::size_t nBlocks = ( n + blockSize - 1 ) / blockSize;
+		m_indices.resize( n );
+		m_upper.resize( n );
+		m_lower.resize( n );
+		m_blockSums.resize( nBlocks * m_nClusters * N );
+		m_blockCounts.resize( nBlocks * m_nClusters );
+		m_blockChanges.resize( nBlocks );
+		m_movement.assign( m_nClusters, T( 0 ) );
+
+		// initial assignment computes all distances
+		prepareCentroids();
+		run( executor, nBlocks, boost::bind( &KMeansClustering::assignBlocks, this, &points[ 0 ], n, true, _1, _2 ) );
+
+		for ( m_iterations = 1; m_iterations <= m_maxIterations; m_iterations++ )
+		{
+			const T maxMovement = updateCentroids( nBlocks );
+			Ubitrack::Util::reportProgress( "k_means", m_iterations, maxMovement );
+			if ( maxMovement <= m_tolerance || m_iterations == m_maxIterations )
+				break;
+
+			prepareCentroids();
+			run( executor, nBlocks, boost::bind( &KMeansClustering::assignBlocks, this, &points[ 0 ], n, false, _1, _2 ) );
+
+			std::size_t changes = 0;
+			for ( std::size_t b = 0; b < nBlocks; b++ )
+				changes += m_blockChanges[ b ];
+			if ( changes == 0 )
+				break;
+		}
+
+		// the bounds are not exact, so compute the final distances
+		T fInertia( 0 );
+		for ( std::size_t i = 0; i < n; i++ )
+			fInertia += squaredDistance( points[ i ], m_centroids[ m_indices[ i ] ] );
+		return fInertia;
+	}
+
+	/**
+	 * Updates the centroids with a batch of points by mini-batch k-means. Each centroid moves towards
+	 * the points assigned to it with a learning rate of one over the number of points it got so far,
+	 * the counts are kept over calls until the centroids are seeded or set again. If there are no
+	 * centroids yet, they are seeded from the batch.
+	 */
+	void miniBatchUpdate( const std::vector< vector_type >& batch, const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		if ( m_centroids.size() != m_nClusters )
+			seed( batch, executor );
+		if ( batch.empty() )
+			return;
+
+		const std::size_t nBlocks = ( batch.size() + blockSize - 1 ) / blockSize;
+		m_indices.resize( batch.size() );
+		prepareCentroids();
+		run( executor, nBlocks, boost::bind( &KMeansClustering::nearestBlocks, this, &batch[ 0 ], batch.size(), _1, _2 ) );
+
+		for ( std::size_t i = 0; i < batch.size(); i++ )
+		{
+			const std::size_t k = m_indices[ i ];
+			const T eta = T( 1 ) / ++m_counts[ k ];
+			m_centroids[ k ] += eta * ( batch[ i ] - m_centroids[ k ] );
+		}
+	}
+
+	/** assigns each point to the closest centroid */
+	void assign( const std::vector< vector_type >& points, std::vector< std::size_t >& indices,
+		const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		if ( m_centroids.size() != m_nClusters )
+			UBITRACK_THROW( "k-means centroids have not been computed" );
+
+		m_indices.resize( points.size() );
+		prepareCentroids();
+		if ( !points.empty() )
+			run( executor, ( points.size() + blockSize - 1 ) / blockSize,
+				boost::bind( &KMeansClustering::nearestBlocks, this, &points[ 0 ], points.size(), _1, _2 ) );
+		indices = m_indices;
+	}
+
+	/**
+	 * estimates the Gaussian of each cluster in one pass over the points of the last call to \c cluster
+	 * or \c assign, see \c estimate_gaussians_index. The weights of \c Weighted Gaussians are set to the
+	 * fractions of the points in the clusters.
+	 * @param points the points that were clustered
+	 * @param itGaussians iterator to as many Gaussians as clusters
+	 * @param executor distributes the blocks of points, the default runs them in the calling thread
+	 * @return false if a cluster has no points
+	 */
+	template< typename OutputIterator >
+	bool gaussians( const std::vector< vector_type >& points, OutputIterator itGaussians,
+		const Math::ListExecutor& executor = Math::ListExecutor() ) const
+	{
+		if ( points.size() != m_indices.size() )
+			UBITRACK_THROW( "k-means indices do not belong to the points" );
+		return estimate_gaussians_index( points.begin(), points.end(), m_indices.begin(), m_nClusters, itGaussians, executor );
+	}
+
+	/** the centroids */
+	const std::vector< vector_type >& centroids() const
+	{ return m_centroids; }
+
+	/** indices of the centroids of the points of the last call to \c cluster, \c assign or \c miniBatchUpdate */
+	const std::vector< std::size_t >& indices() const
+	{ return m_indices; }
+
+	/** number of iterations of the last call to \c cluster */
+	std::size_t iterations() const
+	{ return m_iterations; }
+
+protected:
+	/// number of points per block of the assignment step
+	enum { blockSize = 1024 };
+
+	/// @internal runs the task with the executor, or sequentially if there is none
+	static void run( const Math::ListExecutor& executor, const std::size_t n, const boost::function< void ( std::size_t, std::size_t ) >& task )
+	{
+		if ( n == 0 )
+			return;
+		if ( executor.empty() )
+			task( 0, n );
+		else
+			executor( n, task );
+	}
+
+	/// @internal
+	static T squaredDistance( const vector_type& a, const vector_type& b )
+	{
+		T d( 0 );
+		for ( std::size_t j = 0; j < N; j++ )
+			d += ( a( j ) - b( j ) ) * ( a( j ) - b( j ) );
+		return d;
+	}
+
+	/// @internal squared distances of x to all centroids, d must hold m_stride values
+	void squaredDistances( const vector_type& x, T* d ) const
+	{
+		typedef Util::simd_pack< T > Pack;
+		const T* soa( &m_soa[ 0 ] );
+		typename Pack::type px[ N ];
+		for ( std::size_t j = 0; j < N; j++ )
+			px[ j ] = Pack::set1( x( j ) );
+
+		for ( std::size_t c = 0; c < m_stride; c += Pack::size )
+		{
+			typename Pack::type diff = Pack::sub( Pack::load( soa + c ), px[ 0 ] );
+			typename Pack::type acc = Pack::mul( diff, diff );
+			for ( std::size_t j = 1; j < N; j++ )
+			{
+				diff = Pack::sub( Pack::load( soa + j * m_stride + c ), px[ j ] );
+				acc = Pack::add( acc, Pack::mul( diff, diff ) );
+			}
+			Pack::store( d + c, acc );
+		}
+	}
+
+	/// @internal index of the closest centroid and the squared distances to the closest and second closest
+	std::size_t nearest( const vector_type& x, T* d, T& dBest, T& dSecond ) const
+	{
+		squaredDistances( x, d );
+		std::size_t best = 0;
+		dBest = d[ 0 ];
+		dSecond = std::numeric_limits< T >::max();
+		for ( std::size_t k = 1; k < m_nClusters; k++ )
+			if ( d[ k ] < dBest )
+			{
+				dSecond = dBest;
+				dBest = d[ k ];
+				best = k;
+			}
+			else if ( d[ k ] < dSecond )
+				dSecond = d[ k ];
+		return best;
+	}
+
+	/// @internal copies the centroids to the structure of arrays and computes half the distance to the closest other centroid
+	void prepareCentroids()
+	{
+		m_soa.assign( N * m_stride, T( 0 ) );
+		for ( std::size_t k = 0; k < m_nClusters; k++ )
+			for ( std::size_t j = 0; j < N; j++ )
+				m_soa[ j * m_stride + k ] = m_centroids[ k ]( j );
+
+		m_halfDistances.resize( m_nClusters );
+		for ( std::size_t k = 0; k < m_nClusters; k++ )
+		{
+			T d = std::numeric_limits< T >::max();
+			for ( std::size_t l = 0; l < m_nClusters; l++ )
+				if ( l != k )
+					d = std::min( d, squaredDistance( m_centroids[ k ], m_centroids[ l ] ) );
+			m_halfDistances[ k ] = m_nClusters > 1 ? T( 0.5 ) * std::sqrt( d ) : std::numeric_limits< T >::max();
+		}
+	}
+
+	/// @internal assignment step of Hamerly's algorithm on the blocks [ begin, end ), accumulates the sums of each block
+	void assignBlocks( const vector_type* points, const std::size_t n, const bool bInitial, const std::size_t begin, const std::size_t end )
+	{
+		std::vector< T > d( m_stride );
+		T maxMovement( 0 );
+		for ( std::size_t k = 0; k < m_nClusters; k++ )
+			maxMovement = std::max( maxMovement, m_movement[ k ] );
+
+		for ( std::size_t b = begin; b < end; b++ )
+		{
+			T* sums( &m_blockSums[ b * m_nClusters * N ] );
+			std::size_t* counts( &m_blockCounts[ b * m_nClusters ] );
+			std::fill( sums, sums + m_nClusters * N, T( 0 ) );
+			std::fill( counts, counts + m_nClusters, std::size_t( 0 ) );
+			std::size_t changes = 0;
+
+			const std::size_t iEnd = std::min( n, ( b + 1 ) * blockSize );
+			for ( std::size_t i = b * blockSize; i < iEnd; i++ )
+			{
+				const vector_type& x( points[ i ] );
+				std::size_t a = m_indices[ i ];
+				if ( bInitial )
+				{
+					T dBest, dSecond;
+					a = nearest( x, &d[ 0 ], dBest, dSecond );
+					m_upper[ i ] = std::sqrt( dBest );
+					m_lower[ i ] = std::sqrt( dSecond );
+				}
+				else
+				{
+					// move the bounds with the centroids
+					m_upper[ i ] += m_movement[ a ];
+					m_lower[ i ] -= maxMovement;
+
+					const T bound = std::max( m_halfDistances[ a ], m_lower[ i ] );
+					if ( m_upper[ i ] > bound )
+					{
+						m_upper[ i ] = std::sqrt( squaredDistance( x, m_centroids[ a ] ) );
+						if ( m_upper[ i ] > bound )
+						{
+							T dBest, dSecond;
+							const std::size_t best = nearest( x, &d[ 0 ], dBest, dSecond );
+							m_upper[ i ] = std::sqrt( dBest );
+							m_lower[ i ] = std::sqrt( dSecond );
+							if ( best != a )
+							{
+								a = best;
+								changes++;
+							}
+						}
+					}
+				}
+
+				m_indices[ i ] = a;
+				counts[ a ]++;
+				for ( std::size_t j = 0; j < N; j++ )
+					sums[ a * N + j ] += x( j );
+			}
+			m_blockChanges[ b ] = changes;
+		}
+	}
+
+	/// @internal moves the centroids to the means of their points
+	T updateCentroids( const std::size_t nBlocks )
+	{
+		T maxMovement( 0 );
+		for ( std::size_t k = 0; k < m_nClusters; k++ )
+		{
+			std::size_t count = 0;
+			vector_type sum( vector_type::zeros() );
+			for ( std::size_t b = 0; b < nBlocks; b++ )
+			{
+				count += m_blockCounts[ b * m_nClusters + k ];
+				for ( std::size_t j = 0; j < N; j++ )
+					sum( j ) += m_blockSums[ ( b * m_nClusters + k ) * N + j ];
+			}
+
+			m_movement[ k ] = 0;
+			if ( count == 0 )
+				continue;
+
+			sum /= T( count );
+			m_movement[ k ] = std::sqrt( squaredDistance( sum, m_centroids[ k ] ) );
+			maxMovement = std::max( maxMovement, m_movement[ k ] );
+			m_centroids[ k ] = sum;
+		}
+		return maxMovement;
+	}
+
+	/// @internal closest centroids of the points in the blocks [ begin, end )
+	void nearestBlocks( const vector_type* points, const std::size_t n, const std::size_t begin, const std::size_t end )
+	{
+		std::vector< T > d( m_stride );
+		T dBest, dSecond;
+		for ( std::size_t i = begin * blockSize; i < std::min( n, end * blockSize ); i++ )
+			m_indices[ i ] = nearest( points[ i ], &d[ 0 ], dBest, dSecond );
+	}
+
+	/// @internal draws a point with a probability proportional to m_minDistances, whose sum is given
+	std::size_t sampleSeed( const double sum ) const
+	{
+		const std::size_t n = m_minDistances.size();
+
+		// only duplicates of the centroids left, any point will do
+		if ( !( sum > 0 ) )
+			return Math::Random::distribute_uniform< std::size_t >( 0, n - 1 );
+
+		double r = Math::Random::distribute_uniform< double >( 0, sum );
+		std::size_t last = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			if ( m_minDistances[ i ] > 0 )
+			{
+				if ( r <= m_minDistances[ i ] )
+					return i;
+				r -= m_minDistances[ i ];
+				last = i;
+			}
+		return last;
+	}
+
+	/// @internal updates the squared distances to the closest seeded centroid with the last one in the blocks [ begin, end )
+	void updateSeedDistances( const vector_type* points, const std::size_t n, const std::size_t begin, const std::size_t end )
+	{
+		const vector_type& c( m_centroids.back() );
+		for ( std::size_t i = begin * blockSize; i < std::min( n, end * blockSize ); i++ )
+			m_minDistances[ i ] = std::min( m_minDistances[ i ], squaredDistance( points[ i ], c ) );
+	}
+
+	/// @internal sums of the squared distances in the blocks [ begin, end ), if the candidate was added to the centroids
+	void potentialBlocks( const vector_type* points, const std::size_t n, const std::size_t candidate, const std::size_t begin, const std::size_t end )
+	{
+		const vector_type& c( points[ candidate ] );
+		for ( std::size_t b = begin; b < end; b++ )
+		{
+			double potential = 0;
+			for ( std::size_t i = b * blockSize; i < std::min( n, ( b + 1 ) * blockSize ); i++ )
+				potential += std::min( m_minDistances[ i ], squaredDistance( points[ i ], c ) );
+			m_blockPotentials[ b ] = potential;
+		}
+	}
+
+	std::size_t m_nClusters;
+	std::size_t m_maxIterations;
+	T m_tolerance;
+
+	/// number of centroids rounded up to whole simd packs
+	std::size_t m_stride;
+
+	std::size_t m_iterations;
+	std::vector< vector_type > m_centroids;
+
+	/// number of points of each centroid in mini-batch mode
+	std::vector< std::size_t > m_counts;
+
+	/// centroids as structure of arrays, coordinate j of centroid k is at j * m_stride + k
+	std::vector< T > m_soa;
+
+	/// half the distance of each centroid to its closest other centroid
+	std::vector< T > m_halfDistances;
+
+	/// distance each centroid moved in the last update
+	std::vector< T > m_movement;
+
+	std::vector< std::size_t > m_indices;
+	std::vector< T > m_upper;
+	std::vector< T > m_lower;
+	std::vector< T > m_minDistances;
+	std::vector< double > m_blockPotentials;
+
+	std::vector< T > m_blockSums;
+	std::vector< std::size_t > m_blockCounts;
+	std::vector< std::size_t > m_blockChanges;
+};
+
+} } } // namespace Ubitrack::Math::Stochastic
+
+#endif // __UBITRACK_MATH_STOCHASTIC_KMEANSCLUSTERING_H_INCLUDED__
@@ -39,6 +39,9 @@
 #include <boost/numeric/bindings/lapack/posv.hpp>
 #include <boost/numeric/bindings/lapack/gesv.hpp>
 #include "../ErrorVector.h"
+#include "../FixedDecomposition.h"
+#include "InnovationGate.h"
+#include <cassert>
 
 // to turn on logging of internal processing, create a log4cpp::Category object called "logger"
 // and #define KALMAN_LOGGING before including this header 
@@ -55,6 +58,44 @@
 
 namespace Ubitrack { namespace Math { namespace Stochastic {
 
+namespace Detail {
+
+/**
+ * @internal
+ * Computes the squared Mahalanobis distance of the innovation from the upper cholesky factor
+ * <tt>S = U^T * U</tt> of the innovation covariance, as left in the upper triangle by \c potrf,
+ * stores it in the gate and returns true if it passes.
+ */
+template< class MFactor, class VInnovation >
+bool gateInnovationUpper( InnovationGate& gate, const MFactor& u, const VInnovation& innovation )
+{
+	typedef typename VInnovation::value_type VType;
+	const std::size_t n( innovation.size() );
+	Math::Vector< VType > z( n );
+	VType d2( 0 );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		VType sum = innovation( i );
+		for ( std::size_t k = 0; k < i; k++ )
+			sum -= u( k, i ) * z( k );
+		z( i ) = sum / u( i, i );
+		d2 += z( i ) * z( i );
+	}
+	gate.distance = d2;
+	return gate.accepts( d2 );
+}
+
+/// @internal same as \c gateInnovationUpper, but with the full inverse of the innovation covariance
+template< class MInverse, class VInnovation >
+bool gateInnovationInverse( InnovationGate& gate, const MInverse& inverse, const VInnovation& innovation )
+{
+	namespace ublas = boost::numeric::ublas;
+	gate.distance = ublas::inner_prod( innovation, ublas::prod( inverse, innovation ) );
+	return gate.accepts( gate.distance );
+}
+
+} // namespace Detail
+
 /**
  * Heavily templated function that performs a measurement update of a kalman filter.
  *
@@ -67,10 +108,13 @@ namespace Ubitrack { namespace Math { namespace Stochastic {
  * @param measurementCov reference to measurement covariance
  * @param iBegin index of first element of state vector used as input to the measurement function (usually 0).
  * @param iEnd index of element after subvector of state used as input to measurement function (usually state.size()).
+ * @param pGate if given, the measurement is rejected if its innovation does not pass the gate, see \c InnovationGate
+ * @return false if the measurement was rejected by the gate
  */
 template< class VState, class MStateCov, class MF, class VMeas, class MMeasCov >
-void kalmanMeasurementUpdate( VState& state, MStateCov& stateCov, const MF& measurementFunction, 
-	const VMeas& measurement, const MMeasCov& measurementCov, std::size_t iBegin, std::size_t iEnd )
+bool kalmanMeasurementUpdate( VState& state, MStateCov& stateCov, const MF& measurementFunction, 
+	const VMeas& measurement, const MMeasCov& measurementCov, std::size_t iBegin, std::size_t iEnd,
+	InnovationGate* pGate = 0 )
 {
 	namespace ublas = boost::numeric::ublas;
 	namespace blas = boost::numeric::bindings::blas;
@@ -100,8 +144,13 @@ void kalmanMeasurementUpdate( VState& state, MStateCov& stateCov, const MF& meas
 	noalias( matInv ) += measurementCov;
 
 	KALMAN_LOG_TRACE( "before inversion: " << matInv );
+	const Math::Vector< VType > innovation( measurement - predicted );
 	if ( lapack::potrf( 'U', matInv ) == 0 )
+	{
+		if ( pGate && !Detail::gateInnovationUpper( *pGate, matInv, innovation ) )
+			return false;
 		lapack::potri( 'U', matInv );
+	}
 	else
 	{
 		// problem in the cholesky decomposition, try something else instead.
@@ -115,6 +164,8 @@ void kalmanMeasurementUpdate( VState& state, MStateCov& stateCov, const MF& meas
 		Math::Vector< int > ipiv( measSize );			
 		lapack::getrf( matInv, ipiv );
 		lapack::getri( matInv, ipiv );
+		if ( pGate && !Detail::gateInnovationInverse( *pGate, matInv, innovation ) )
+			return false;
 	}
 	KALMAN_LOG_TRACE( "after inversion: " << matInv );
 	
@@ -128,23 +179,223 @@ void kalmanMeasurementUpdate( VState& state, MStateCov& stateCov, const MF& meas
 	KALMAN_LOG_DEBUG( "kalman gain: " << kalmanGain );
 
 	// update state
-	noalias( state ) += ublas::prod( kalmanGain, measurement - predicted );
+	noalias( state ) += ublas::prod( kalmanGain, innovation );
 	noalias( stateCov ) -= ublas::prod( kalmanGain, ublas::trans( matTemp ) );
 	
 	KALMAN_LOG_DEBUG( "state after: " << state );
 	KALMAN_LOG_DEBUG( "covariance after: " << stateCov );
+	return true;
+}
+
+
+namespace Detail {
+
+/**
+ * @internal
+ * Computes the gain <tt>K = P * H^T * S^-1</tt> from <tt>P * H^T</tt> and the cholesky factor
+ * <tt>S = L * L^T</tt> of the innovation covariance.
+ */
+template< typename T, std::size_t N, std::size_t M >
+void kalmanGain( Math::Matrix< T, N, M >& gain, const Math::Matrix< T, N, M >& pht, const Math::Matrix< T, M, M >& l )
+{
+	// solve S * k_r = pht_r for each row r of the gain
+	for ( std::size_t r = 0; r < N; r++ )
+	{
+		T y[ M ];
+		for ( std::size_t i = 0; i < M; i++ )
+		{
+			T sum = pht( r, i );
+			for ( std::size_t k = 0; k < i; k++ )
+				sum -= l( i, k ) * y[ k ];
+			y[ i ] = sum / l( i, i );
+		}
+		for ( std::size_t i = M; i-- > 0; )
+		{
+			T sum = y[ i ];
+			for ( std::size_t k = i + 1; k < M; k++ )
+				sum -= l( k, i ) * y[ k ];
+			y[ i ] = sum / l( i, i );
+		}
+		for ( std::size_t i = 0; i < M; i++ )
+			gain( r, i ) = y[ i ];
+	}
+}
+
+/**
+ * @internal
+ * Computes the squared Mahalanobis distance of the innovation from the lower cholesky factor
+ * <tt>S = L * L^T</tt> of the innovation covariance, stores it in the gate and returns true if it passes.
+ */
+template< typename T, std::size_t M >
+bool gateInnovation( InnovationGate& gate, const Math::Matrix< T, M, M >& l, const T* innovation )
+{
+	T z[ M ];
+	T d2( 0 );
+	for ( std::size_t i = 0; i < M; i++ )
+	{
+		T sum = innovation[ i ];
+		for ( std::size_t k = 0; k < i; k++ )
+			sum -= l( i, k ) * z[ k ];
+		z[ i ] = sum / l( i, i );
+		d2 += z[ i ] * z[ i ];
+	}
+	gate.distance = d2;
+	return gate.accepts( d2 );
+}
+
+/// @internal adds <tt>K * R * K^T</tt> to the lower triangle of the covariance and mirrors it
+template< typename T, std::size_t N, std::size_t M >
+void kalmanAddGainNoise( Math::Matrix< T, N, N >& stateCov, const Math::Matrix< T, N, M >& gain, const Math::Matrix< T, M, M >& measurementCov )
+{
+	Math::Matrix< T, N, M > kr;
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c < M; c++ )
+		{
+			T sum = 0;
+			for ( std::size_t k = 0; k < M; k++ )
+				sum += gain( r, k ) * measurementCov( k, c );
+			kr( r, c ) = sum;
+		}
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c <= r; c++ )
+		{
+			T sum = stateCov( r, c );
+			for ( std::size_t k = 0; k < M; k++ )
+				sum += kr( r, k ) * gain( c, k );
+			stateCov( r, c ) = stateCov( c, r ) = sum;
+		}
+}
+
+} // namespace Detail
+
+
+/**
+ * Measurement update of a kalman filter with fixed-size state and measurement.
+ *
+ * The whole state is the input of the measurement function. All temporaries have fixed size and live
+ * on the stack, the innovation covariance is inverted by the unrolled \c Math::cholesky, and the
+ * covariance is updated in Joseph form <tt>( I - K H ) P ( I - K H )^T + K R K^T</tt>, which keeps it
+ * symmetric and positive semi-definite. If the innovation covariance is not positive definite, the
+ * generic update with its general matrix inversion is used instead.
+ *
+ * With a gate, the cholesky factor of the innovation covariance is used for both the gate and the
+ * gain, so a rejected measurement costs only the innovation covariance and its factorization.
+ *
+ * @param state reference to state vector. Should contain the predicted value of a time update and 
+ *     will be updated by the measurement.
+ * @param stateCov reference to state vector covariance matrix.
+ * @param measurementFunction function object of the measurement function. Must be modeled after 
+ *   the \c Ubitrack::Algorithm::Function::Prototype
+ * @param measurement reference to measurement vector
+ * @param measurementCov reference to measurement covariance
+ * @param pGate if given, the measurement is rejected if its innovation does not pass the gate, see \c InnovationGate
+ * @return false if the measurement was rejected by the gate
+ */
+template< typename T, std::size_t N, std::size_t M, class MF >
+bool kalmanMeasurementUpdate( Math::Vector< T, N >& state, Math::Matrix< T, N, N >& stateCov, const MF& measurementFunction, 
+	const Math::Vector< T, M >& measurement, const Math::Matrix< T, M, M >& measurementCov, InnovationGate* pGate = 0 )
+{
+	// compute predicted measurement and jacobian
+	Math::Vector< T, M > predicted;
+	Math::Matrix< T, M, N > jacobian;
+	measurementFunction.evaluateWithJacobian( predicted, state, jacobian );
+
+	// pht = P * H^T, innovation covariance S = H * P * H^T + R
+	Math::Matrix< T, N, M > pht;
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c < M; c++ )
+		{
+			T sum = 0;
+			for ( std::size_t k = 0; k < N; k++ )
+				sum += stateCov( r, k ) * jacobian( c, k );
+			pht( r, c ) = sum;
+		}
+	Math::Matrix< T, M, M > innovationCov;
+	for ( std::size_t r = 0; r < M; r++ )
+		for ( std::size_t c = 0; c <= r; c++ )
+		{
+			T sum = measurementCov( r, c );
+			for ( std::size_t k = 0; k < N; k++ )
+				sum += jacobian( r, k ) * pht( k, c );
+			innovationCov( r, c ) = innovationCov( c, r ) = sum;
+		}
+
+	Math::Matrix< T, M, M > l;
+	if ( !Math::cholesky( innovationCov, l ) )
+	{
+		KALMAN_LOG_NOTICE( "Problem in cholesky decomposition for KF. Trying something else." );
+		return kalmanMeasurementUpdate( state, stateCov, measurementFunction, measurement, measurementCov, 0, N, pGate );
+	}
+
+	T innovation[ M ];
+	for ( std::size_t k = 0; k < M; k++ )
+		innovation[ k ] = measurement( k ) - predicted( k );
+	if ( pGate && !Detail::gateInnovation( *pGate, l, innovation ) )
+		return false;
+
+	Math::Matrix< T, N, M > gain;
+	Detail::kalmanGain( gain, pht, l );
+	KALMAN_LOG_DEBUG( "kalman gain: " << gain );
+
+	// update state
+	for ( std::size_t r = 0; r < N; r++ )
+	{
+		T sum = 0;
+		for ( std::size_t k = 0; k < M; k++ )
+			sum += gain( r, k ) * innovation[ k ];
+		state( r ) += sum;
+	}
+
+	// Joseph form: A = I - K * H, P = A * P * A^T + K * R * K^T
+	Math::Matrix< T, N, N > a;
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c < N; c++ )
+		{
+			T sum = r == c ? T( 1 ) : T( 0 );
+			for ( std::size_t k = 0; k < M; k++ )
+				sum -= gain( r, k ) * jacobian( k, c );
+			a( r, c ) = sum;
+		}
+	Math::Matrix< T, N, N > ap;
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c < N; c++ )
+		{
+			T sum = 0;
+			for ( std::size_t k = 0; k < N; k++ )
+				sum += a( r, k ) * stateCov( k, c );
+			ap( r, c ) = sum;
+		}
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c <= r; c++ )
+		{
+			T sum = 0;
+			for ( std::size_t k = 0; k < N; k++ )
+				sum += ap( r, k ) * a( c, k );
+			stateCov( r, c ) = sum;
+		}
+	Detail::kalmanAddGainNoise( stateCov, gain, measurementCov );
+	
+	KALMAN_LOG_DEBUG( "state after: " << state );
+	KALMAN_LOG_DEBUG( "covariance after: " << stateCov );
+	return true;
 }
 
 
 /**
  * Overload for parameters of type \c ErrorVector.
+ * If the whole state is the input of the measurement function, the fixed-size update is used.
  */
 template< std::size_t N, std::size_t M, class MF >
-void kalmanMeasurementUpdate( Math::ErrorVector< double, N >& state, const MF& measurementFunction, 
-	const Math::ErrorVector< double, M >& measurement, const std::size_t iBegin = 0, const std::size_t iEnd = N )
+bool kalmanMeasurementUpdate( Math::ErrorVector< double, N >& state, const MF& measurementFunction, 
+	const Math::ErrorVector< double, M >& measurement, const std::size_t iBegin = 0, const std::size_t iEnd = N,
+	InnovationGate* pGate = 0 )
 {
-	kalmanMeasurementUpdate( state.value, state.covariance, measurementFunction, 
-		measurement.value, measurement.covariance, iBegin, iEnd );
+	if ( iBegin == 0 && iEnd == N )
+		return kalmanMeasurementUpdate( state.value, state.covariance, measurementFunction, 
+			measurement.value, measurement.covariance, pGate );
+	else
+		return kalmanMeasurementUpdate( state.value, state.covariance, measurementFunction, 
+			measurement.value, measurement.covariance, iBegin, iEnd, pGate );
 }
 
 
@@ -159,10 +410,13 @@ void kalmanMeasurementUpdate( Math::ErrorVector< double, N >& state, const MF& m
  * @param measurementCov reference to measurement covariance
  * @param iBegin index of first element of state vector to update
  * @param iEnd index of element after subvector of state vector to update
+ * @param pGate if given, the measurement is rejected if its innovation does not pass the gate, see \c InnovationGate
+ * @return false if the measurement was rejected by the gate
  */
 template< class VState, class MStateCov, class VMeas, class MMeasCov >
-void kalmanMeasurementUpdateIdentity( VState& state, MStateCov& stateCov,  
-	const VMeas& measurement, const MMeasCov& measurementCov, const std::size_t iBegin, const std::size_t iEnd )
+bool kalmanMeasurementUpdateIdentity( VState& state, MStateCov& stateCov,  
+	const VMeas& measurement, const MMeasCov& measurementCov, const std::size_t iBegin, const std::size_t iEnd,
+	InnovationGate* pGate = 0 )
 {
 	namespace ublas = boost::numeric::ublas;
 	namespace blas = boost::numeric::bindings::blas;
@@ -185,8 +439,13 @@ void kalmanMeasurementUpdateIdentity( VState& state, MStateCov& stateCov,
 	MatrixType matInv( ublas::subrange( stateCov, iBegin, iEnd, iBegin, iEnd ) + measurementCov );
 
 	KALMAN_LOG_TRACE( "before inversion: " << matInv );
+	const Math::Vector< VType > innovation( measurement - predicted );
 	if ( lapack::potrf( 'U', matInv ) == 0 )
+	{
+		if ( pGate && !Detail::gateInnovationUpper( *pGate, matInv, innovation ) )
+			return false;
 		lapack::potri( 'U', matInv );
+	}
 	else
 	{
 		// problem in the cholesky decomposition, try something else instead.
@@ -199,6 +458,8 @@ void kalmanMeasurementUpdateIdentity( VState& state, MStateCov& stateCov,
 		Math::Vector< int > ipiv( measSize );			
 		lapack::getrf( matInv, ipiv );
 		lapack::getri( matInv, ipiv );
+		if ( pGate && !Detail::gateInnovationInverse( *pGate, matInv, innovation ) )
+			return false;
 	}
 	KALMAN_LOG_TRACE( "after inversion: " << matInv );
 	
@@ -211,31 +472,121 @@ void kalmanMeasurementUpdateIdentity( VState& state, MStateCov& stateCov,
 	KALMAN_LOG_DEBUG( "kalman gain: " << kalmanGain );
 	
 	// update state
-	noalias( state ) += ublas::prod( kalmanGain, measurement - predicted );
+	noalias( state ) += ublas::prod( kalmanGain, innovation );
 	noalias( stateCov ) -= ublas::prod( kalmanGain, ublas::trans( matTemp ) );
 
 	KALMAN_LOG_DEBUG( "state after: " << state );
 	KALMAN_LOG_DEBUG( "covariance after: " << stateCov );
+	return true;
 }
 
 /**
- * Overload for parameters of type \c ErrorVector.
+ * Measurement update with fixed-size state and measurement for cases where the measurement is the sub-vector
+ * <tt>[ iBegin, iBegin + M )</tt> of the state. Like the fixed-size \c kalmanMeasurementUpdate, this uses only
+ * the stack and the Joseph form, which here reduces to <tt>A P A^T</tt> with <tt>A P = P - K P_b</tt>, where
+ * \c P_b are the rows of the sub-vector.
+ *
+ * @param state reference to state vector. Should contain the predicted value of a time update and 
+ *     will be updated by the measurement.
+ * @param stateCov reference to state vector covariance matrix.
+ * @param measurement reference to measurement vector
+ * @param measurementCov reference to measurement covariance
+ * @param iBegin index of first element of state vector to update
+ * @param pGate if given, the measurement is rejected if its innovation does not pass the gate, see \c InnovationGate
+ * @return false if the measurement was rejected by the gate
  */
-template< std::size_t N, std::size_t M >
-void kalmanMeasurementUpdateIdentity( Math::ErrorVector< double, N >& state, 
-	const Math::ErrorVector< double, M >& measurement, const std::size_t iBegin, const std::size_t iEnd )
+template< typename T, std::size_t N, std::size_t M >
+bool kalmanMeasurementUpdateIdentity( Math::Vector< T, N >& state, Math::Matrix< T, N, N >& stateCov,  
+	const Math::Vector< T, M >& measurement, const Math::Matrix< T, M, M >& measurementCov, const std::size_t iBegin,
+	InnovationGate* pGate = 0 )
 {
-	kalmanMeasurementUpdateIdentity( state.value, state.covariance,  
-		measurement.value, measurement.covariance, iBegin, iEnd );
+	assert( iBegin + M <= N );
+
+	// pht = P * H^T are the columns of the sub-vector, S = P_bb + R
+	Math::Matrix< T, N, M > pht;
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c < M; c++ )
+			pht( r, c ) = stateCov( r, iBegin + c );
+	Math::Matrix< T, M, M > innovationCov;
+	for ( std::size_t r = 0; r < M; r++ )
+		for ( std::size_t c = 0; c < M; c++ )
+			innovationCov( r, c ) = stateCov( iBegin + r, iBegin + c ) + measurementCov( r, c );
+
+	Math::Matrix< T, M, M > l;
+	if ( !Math::cholesky( innovationCov, l ) )
+	{
+		KALMAN_LOG_NOTICE( "Problem in cholesky decomposition for KF. Trying something else." );
+		return kalmanMeasurementUpdateIdentity( state, stateCov, measurement, measurementCov, iBegin, iBegin + M, pGate );
+	}
+
+	// the innovation is computed first, as the sub-vector is updated as well
+	T innovation[ M ];
+	for ( std::size_t k = 0; k < M; k++ )
+		innovation[ k ] = measurement( k ) - state( iBegin + k );
+	if ( pGate && !Detail::gateInnovation( *pGate, l, innovation ) )
+		return false;
+
+	Math::Matrix< T, N, M > gain;
+	Detail::kalmanGain( gain, pht, l );
+	KALMAN_LOG_DEBUG( "kalman gain: " << gain );
+
+	// update state
+	for ( std::size_t r = 0; r < N; r++ )
+	{
+		T sum = 0;
+		for ( std::size_t k = 0; k < M; k++ )
+			sum += gain( r, k ) * innovation[ k ];
+		state( r ) += sum;
+	}
+
+	// Joseph form: A P = P - K P_b, A P A^T = A P - ( A P )_b^T K^T, which is ( A P )^T - ...
+	Math::Matrix< T, N, N > ap;
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c < N; c++ )
+		{
+			T sum = stateCov( r, c );
+			for ( std::size_t k = 0; k < M; k++ )
+				sum -= gain( r, k ) * stateCov( iBegin + k, c );
+			ap( r, c ) = sum;
+		}
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c <= r; c++ )
+		{
+			T sum = ap( r, c );
+			for ( std::size_t k = 0; k < M; k++ )
+				sum -= ap( r, iBegin + k ) * gain( c, k );
+			stateCov( r, c ) = sum;
+		}
+	Detail::kalmanAddGainNoise( stateCov, gain, measurementCov );
+
+	KALMAN_LOG_DEBUG( "state after: " << state );
+	KALMAN_LOG_DEBUG( "covariance after: " << stateCov );
+	return true;
 }
 
 
-// TODO: kalmanMeasurementUpdate without iBegin and iEnd (using optimized uBlas)
+/**
+ * Overload for parameters of type \c ErrorVector.
+ * If the updated sub-vector has the size of the measurement, the fixed-size update is used.
+ */
+template< std::size_t N, std::size_t M >
+bool kalmanMeasurementUpdateIdentity( Math::ErrorVector< double, N >& state, 
+	const Math::ErrorVector< double, M >& measurement, const std::size_t iBegin, const std::size_t iEnd,
+	InnovationGate* pGate = 0 )
+{
+	if ( iEnd == iBegin + M && iEnd <= N )
+		return kalmanMeasurementUpdateIdentity( state.value, state.covariance,  
+			measurement.value, measurement.covariance, iBegin, pGate );
+	else
+		return kalmanMeasurementUpdateIdentity( state.value, state.covariance,  
+			measurement.value, measurement.covariance, iBegin, iEnd, pGate );
+}
 
 } } } // namespace Ubitrack::Math::Stochastic
 
 #undef KALMAN_LOG_DEBUG
 #undef KALMAN_LOG_TRACE
+#undef KALMAN_LOG_NOTICE
 
 #endif // HAVE_LAPACK
 
@@ -0,0 +1,376 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup tracking
+ * @file
+ * Kalman filter updates on a UD-factorized covariance.
+ *
+ * The covariance is kept as <tt>P = U * D * U^T</tt> with a unit upper triangular \c U and a
+ * diagonal \c D. Both are packed into one matrix: the strict upper triangle holds \c U, the
+ * diagonal holds \c D, the lower triangle is unused. A covariance in this form stays symmetric
+ * and positive semi-definite by construction, which keeps long-running filters stable also in
+ * single precision.
+ *
+ * - the measurement update decorrelates the measurement and applies Bierman's scalar updates,
+ *   <tt>O( N^2 M )</tt> instead of the <tt>O( N^3 )</tt> of the Joseph form,
+ * - linear transformations of the covariance, e.g. the time update, use Thornton's modified
+ *   weighted Gram-Schmidt orthogonalization.
+ *
+ * All functions work on fixed-size \c Math::Matrix and \c Math::Vector and do not need LAPACK.
+ */
+
+#ifndef __UBITRACK_MATH_STOCHASTIC_KALMANUD_H_INCLUDED__
+#define __UBITRACK_MATH_STOCHASTIC_KALMANUD_H_INCLUDED__
+
+#include <cassert>
+#include <limits>
+
+#include "../Vector.h"
+#include "../Matrix.h"
+#include "InnovationGate.h"
+
+namespace Ubitrack { namespace Math { namespace Stochastic {
+
+/** representation of the covariance in a kalman filter */
+enum KalmanCovarianceForm { kalmanFullCovariance, kalmanUDFactors };
+
+
+/**
+ * Computes the packed UD factors of a symmetric positive semi-definite matrix.
+ * Negative pivots caused by rounding are set to zero, together with their column of \c U.
+ * @param a the matrix, only the upper triangle is used
+ * @param ud receives the packed factors
+ * @return false if a pivot was not positive
+ */
+template< typename T, std::size_t N >
+bool udFactorize( const Math::Matrix< T, N, N >& a, Math::Matrix< T, N, N >& ud )
+{
+	bool bPositive = true;
+	for ( std::size_t j = N; j-- > 0; )
+	{
+		T d = a( j, j );
+		for ( std::size_t k = j + 1; k < N; k++ )
+			d -= ud( k, k ) * ud( j, k ) * ud( j, k );
+
+		if ( !( d > 0 ) )
+		{
+			bPositive = false;
+			ud( j, j ) = 0;
+			for ( std::size_t i = 0; i < j; i++ )
+				ud( i, j ) = 0;
+			continue;
+		}
+
+		ud( j, j ) = d;
+		for ( std::size_t i = 0; i < j; i++ )
+		{
+			T sum = a( i, j );
+			for ( std::size_t k = j + 1; k < N; k++ )
+				sum -= ud( k, k ) * ud( i, k ) * ud( j, k );
+			ud( i, j ) = sum / d;
+		}
+	}
+	return bPositive;
+}
+
+
+/**
+ * Computes <tt>P = U * D * U^T</tt> from packed UD factors.
+ */
+template< typename T, std::size_t N >
+void udCompose( const Math::Matrix< T, N, N >& ud, Math::Matrix< T, N, N >& p )
+{
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = r; c < N; c++ )
+		{
+			// U( r, k ) is zero for k < r and one for k == r
+			T sum = ud( c, c ) * ( c == r ? T( 1 ) : ud( r, c ) );
+			for ( std::size_t k = c + 1; k < N; k++ )
+				sum += ud( r, k ) * ud( k, k ) * ud( c, k );
+			p( r, c ) = p( c, r ) = sum;
+		}
+}
+
+
+/**
+ * Replaces the factors of \c P by the factors of <tt>A * P * A^T + diag( q )</tt>, using Thornton's
+ * modified weighted Gram-Schmidt orthogonalization of <tt>[ A * U, I ]</tt> with weights
+ * <tt>( D, q )</tt>. Elements of \c q that are zero are skipped.
+ *
+ * @param ud packed factors, updated in place
+ * @param a the linear transformation, e.g. the jacobian of a time update
+ * @param q diagonal noise added after the transformation
+ */
+template< typename T, std::size_t N >
+void udTransform( Math::Matrix< T, N, N >& ud, const Math::Matrix< T, N, N >& a, const Math::Vector< T, N >& q )
+{
+	// w = A * U, zero elements of A are skipped, as jacobians of time updates are sparse
+	Math::Matrix< T, N, N > w;
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t c = 0; c < N; c++ )
+			w( r, c ) = a( r, c );
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t k = 0; k < N; k++ )
+		{
+			const T f = a( r, k );
+			if ( f != 0 )
+				for ( std::size_t c = k + 1; c < N; c++ )
+					w( r, c ) += f * ud( k, c );
+		}
+
+	// the noise columns form the identity at the start, only the nonzero ones are stored
+	std::size_t noiseIndex[ N ];
+	std::size_t nNoise = 0;
+	for ( std::size_t k = 0; k < N; k++ )
+		if ( q( k ) != 0 )
+			noiseIndex[ nNoise++ ] = k;
+	Math::Matrix< T, N, N > e;
+	for ( std::size_t r = 0; r < N; r++ )
+		for ( std::size_t k = 0; k < nNoise; k++ )
+			e( r, k ) = r == noiseIndex[ k ] ? T( 1 ) : T( 0 );
+
+	T d[ N ];
+	for ( std::size_t i = 0; i < N; i++ )
+		d[ i ] = ud( i, i );
+
+	for ( std::size_t j = N; j-- > 0; )
+	{
+		// weighted row j
+		T wd[ N ];
+		T ed[ N ];
+		T dj = 0;
+		for ( std::size_t k = 0; k < N; k++ )
+		{
+			wd[ k ] = d[ k ] * w( j, k );
+			dj += wd[ k ] * w( j, k );
+		}
+		for ( std::size_t k = 0; k < nNoise; k++ )
+		{
+			ed[ k ] = q( noiseIndex[ k ] ) * e( j, k );
+			dj += ed[ k ] * e( j, k );
+		}
+		ud( j, j ) = dj;
+
+		for ( std::size_t i = 0; i < j; i++ )
+		{
+			if ( !( dj > 0 ) )
+			{
+				ud( i, j ) = 0;
+				continue;
+			}
+
+			T sum = 0;
+			for ( std::size_t k = 0; k < N; k++ )
+				sum += w( i, k ) * wd[ k ];
+			for ( std::size_t k = 0; k < nNoise; k++ )
+				sum += e( i, k ) * ed[ k ];
+			const T u = sum / dj;
+			ud( i, j ) = u;
+
+			for ( std::size_t k = 0; k < N; k++ )
+				w( i, k ) -= u * w( j, k );
+			for ( std::size_t k = 0; k < nNoise; k++ )
+				e( i, k ) -= u * e( j, k );
+		}
+	}
+}
+
+
+namespace Detail {
+
+/**
+ * @internal
+ * Bierman's scalar updates of the decorrelated measurement elements. Returns the squared
+ * Mahalanobis distance of the innovation, the sum of the squared scalar innovations divided by
+ * their variances, and stops as soon as it exceeds \c maxDistance.
+ */
+template< typename T, std::size_t N, std::size_t M >
+T udScalarUpdates( Math::Vector< T, N >& state, Math::Matrix< T, N, N >& ud, const Math::Matrix< T, M, N >& jacobian,
+	const Math::Vector< T, M >& residual, const Math::Matrix< T, M, M >& measurementUD, const T maxDistance )
+{
+	// the residual of each element is corrected by the previous updates
+	const Math::Vector< T, N > predictedState( state );
+	T distance( 0 );
+	for ( std::size_t m = 0; m < M; m++ )
+	{
+		T y = residual( m );
+		for ( std::size_t c = 0; c < N; c++ )
+			y -= jacobian( m, c ) * ( state( c ) - predictedState( c ) );
+
+		// f = U^T * h, v = D * f
+		T f[ N ];
+		T v[ N ];
+		for ( std::size_t j = 0; j < N; j++ )
+		{
+			T sum = jacobian( m, j );
+			for ( std::size_t i = 0; i < j; i++ )
+				sum += ud( i, j ) * jacobian( m, i );
+			f[ j ] = sum;
+			v[ j ] = ud( j, j ) * sum;
+		}
+
+		// Bierman's update of U and D, b accumulates the unscaled gain
+		T b[ N ];
+		T alpha = measurementUD( m, m );
+		for ( std::size_t j = 0; j < N; j++ )
+		{
+			const T beta = alpha;
+			alpha += v[ j ] * f[ j ];
+			b[ j ] = v[ j ];
+			if ( !( alpha > 0 ) )
+				continue;
+
+			// with a zero variance so far, all previous gain elements are zero as well
+			const T lambda = beta > 0 ? -f[ j ] / beta : T( 0 );
+			ud( j, j ) *= beta / alpha;
+			for ( std::size_t i = 0; i < j; i++ )
+			{
+				const T u = ud( i, j );
+				ud( i, j ) = u + lambda * b[ i ];
+				b[ i ] += v[ j ] * u;
+			}
+		}
+
+		if ( alpha > 0 )
+		{
+			// alpha is the variance of y
+			distance += y * y / alpha;
+			if ( distance > maxDistance )
+				return distance;
+
+			for ( std::size_t j = 0; j < N; j++ )
+				state( j ) += b[ j ] / alpha * y;
+		}
+	}
+	return distance;
+}
+
+} // namespace Detail
+
+
+/**
+ * Measurement update of a kalman filter with a UD-factorized covariance.
+ *
+ * The measurement function is linearized once at the predicted state. The measurement covariance
+ * is factorized the same way as the state covariance, the measurement is decorrelated with its
+ * factors and then integrated element by element with Bierman's scalar update, which does not
+ * invert any matrix. The measurement covariance may be singular.
+ *
+ * The squared Mahalanobis distance for a gate is the sum over the scalar updates, which do not
+ * form the innovation covariance. With a gate, the updates therefore work on copies of the state and
+ * the factors, which are only written back if the measurement passes, and stop as soon as the
+ * distance exceeds the threshold. The distance stored in the gate for a rejected measurement
+ * is then a lower bound.
+ *
+ * @param state reference to state vector. Should contain the predicted value of a time update and
+ *     will be updated by the measurement.
+ * @param ud packed UD factors of the state covariance, see \c udFactorize
+ * @param measurementFunction function object of the measurement function. Must be modeled after
+ *   the \c Ubitrack::Algorithm::Function::Prototype
+ * @param measurement reference to measurement vector
+ * @param measurementCov reference to measurement covariance
+ * @param pGate if given, the measurement is rejected if its innovation does not pass the gate, see \c InnovationGate
+ * @return false if the measurement was rejected by the gate
+ */
+template< typename T, std::size_t N, std::size_t M, class MF >
+bool kalmanMeasurementUpdateUD( Math::Vector< T, N >& state, Math::Matrix< T, N, N >& ud, const MF& measurementFunction,
+	const Math::Vector< T, M >& measurement, const Math::Matrix< T, M, M >& measurementCov, InnovationGate* pGate = 0 )
+{
+	// compute predicted measurement and jacobian
+	Math::Vector< T, M > predicted;
+	Math::Matrix< T, M, N > jacobian;
+	measurementFunction.evaluateWithJacobian( predicted, state, jacobian );
+
+	// R = V * E * V^T, multiply residual and jacobian by V^-1, so the elements become independent
+	Math::Matrix< T, M, M > measurementUD;
+	udFactorize( measurementCov, measurementUD );
+	Math::Vector< T, M > residual( measurement - predicted );
+	for ( std::size_t i = M; i-- > 0; )
+		for ( std::size_t k = i + 1; k < M; k++ )
+		{
+			residual( i ) -= measurementUD( i, k ) * residual( k );
+			for ( std::size_t c = 0; c < N; c++ )
+				jacobian( i, c ) -= measurementUD( i, k ) * jacobian( k, c );
+		}
+
+	if ( !pGate )
+	{
+		Detail::udScalarUpdates( state, ud, jacobian, residual, measurementUD, std::numeric_limits< T >::infinity() );
+		return true;
+	}
+
+	Math::Vector< T, N > gatedState( state );
+	Math::Matrix< T, N, N > gatedUD( ud );
+	pGate->distance = Detail::udScalarUpdates( gatedState, gatedUD, jacobian, residual, measurementUD, T( pGate->threshold ) );
+	if ( !pGate->accepts( pGate->distance ) )
+		return false;
+	state = gatedState;
+	ud = gatedUD;
+	return true;
+}
+
+
+namespace Detail {
+
+/// @internal measurement function that extracts the sub-vector [ iBegin, iBegin + M ) of the state
+template< std::size_t M >
+struct SubVectorMeasurement
+{
+	std::size_t m_begin;
+
+	SubVectorMeasurement( std::size_t iBegin )
+		: m_begin( iBegin )
+	{}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& jacobian ) const
+	{
+		for ( std::size_t r = 0; r < M; r++ )
+		{
+			result( r ) = input( m_begin + r );
+			for ( std::size_t c = 0; c < jacobian.size2(); c++ )
+				jacobian( r, c ) = c == m_begin + r ? 1 : 0;
+		}
+	}
+};
+
+} // namespace Detail
+
+
+/**
+ * Measurement update with a UD-factorized covariance for cases where the measurement is the
+ * sub-vector <tt>[ iBegin, iBegin + M )</tt> of the state, see \c kalmanMeasurementUpdateIdentity.
+ */
+template< typename T, std::size_t N, std::size_t M >
+bool kalmanMeasurementUpdateIdentityUD( Math::Vector< T, N >& state, Math::Matrix< T, N, N >& ud,
+	const Math::Vector< T, M >& measurement, const Math::Matrix< T, M, M >& measurementCov, const std::size_t iBegin,
+	InnovationGate* pGate = 0 )
+{
+	assert( iBegin + M <= N );
+	return kalmanMeasurementUpdateUD( state, ud, Detail::SubVectorMeasurement< M >( iBegin ), measurement, measurementCov, pGate );
+}
+
+} } } // namespace Ubitrack::Math::Stochastic
+
+#endif
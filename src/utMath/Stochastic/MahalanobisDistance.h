@@ -27,10 +27,13 @@
  
 #include "Gaussian.h"
 
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
 // Ubitrack
 #include <utUtil/Exception.h>
-#include <utUtil/StaticAssert.h>
-#include "../Functors/MatrixFunctors.h"
+#include "../Util/simd_traits.h"
 
 namespace Ubitrack{ namespace Math { namespace Stochastic {
 
@@ -39,65 +42,139 @@ namespace Ubitrack{ namespace Math { namespace Stochastic {
 template< typename T >
 struct MahalanobisDistance{};
 
+/**
+ * Mahalanobis distance of points to a Gaussian distribution.
+ *
+ * The covariance is factorized once by a Cholesky decomposition C = L * L^T in the constructor, so
+ * each evaluation is a forward substitution y = L^-1 * ( x - mean ) and the squared distance is y^T * y.
+ * For gating many candidates, \c squaredDistances evaluates a list of points in blocks with
+ * \c Util::simd_pack, several points per instruction.
+ *
+ * The mean and the factor are copied, the Gaussian does not need to outlive the distance object.
+ */
 template< typename T, std::size_t N >
 struct MahalanobisDistance< Gaussian< T, N > >
 {
 	typedef T value_type;
 		
 protected:
-	const Math::Functors::matrix_determinant m_determinant;
-	const Math::Functors::matrix_inverse m_inverter;
-	const Gaussian< T, N > &gaussian;
-	value_type inv_covariance [ N * N ];
-	bool valid;
+	/// number of points per block of \c squaredDistances, a multiple of all SIMD pack sizes
+	enum { blockSize = 64 };
+
+	/// the mean of the distribution
+	value_type m_mean[ N ];
+
+	/// row-wise lower triangle of the Cholesky factor of the covariance
+	value_type m_cholesky[ N * N ];
+
+	/// reciprocals of the diagonal of the Cholesky factor
+	value_type m_inverseDiagonal[ N ];
 	
 public:
+	/**
+	 * Factorizes the covariance of the Gaussian.
+	 * Throws an exception if the covariance is not positive definite.
+	 */
 	MahalanobisDistance( const Gaussian< T, N >& gauss )
-		: m_determinant( )
-		, m_inverter( )
-		, gaussian( gauss )
-		, valid( false )
 		{
-			std::copy( gaussian.covariance, gaussian.covariance+(N*N), inv_covariance );
-			
-			Math::Matrix< value_type, N, N > CovMat( inv_covariance );
-			const value_type det = m_determinant( CovMat );
-			
-			if( det != det || det == 0 ) //trick to check if the value is valid
-				UBITRACK_THROW( "Cannot calculate covariance inverse, determinant is NaN." );
-			
-			CovMat = m_inverter( CovMat );
-			std::copy( CovMat.content(), CovMat.content()+(N*N), inv_covariance );
+			std::copy( gauss.mean, gauss.mean + N, m_mean );
+			std::fill( m_cholesky, m_cholesky + N * N, value_type( 0 ) );
+			for( std::size_t j( 0 ); j<N; ++j )
+				for( std::size_t l( 0 ); l<=j; ++l )
+				{
+					value_type s = gauss.covariance[ j*N+l ];
+					for( std::size_t m( 0 ); m<l; ++m )
+						s -= m_cholesky[ j*N+m ] * m_cholesky[ l*N+m ];
+					if( l < j )
+						m_cholesky[ j*N+l ] = s * m_inverseDiagonal[ l ];
+					else if( s > 0 && s == s ) //trick to check if the value is valid
+					{
+						m_cholesky[ j*N+j ] = std::sqrt( s );
+						m_inverseDiagonal[ j ] = value_type( 1 ) / m_cholesky[ j*N+j ];
+					}
+					else
+						UBITRACK_THROW( "Cannot factorize covariance, it is not positive definite." );
+				}
 		}
 	
 	
+	/** squared distance of the point, without the square root */
+	template< typename vector_type >
+	value_type squared( const vector_type& vec ) const
+	{
+		// forward substitution L * y = n-diff
+		value_type y[ N ];
+		value_type dot_product( 0 );
+		for( std::size_t j( 0 ); j<N; ++j )
+		{
+			value_type yj = vec[ j ] - m_mean[ j ];
+			for( std::size_t l( 0 ); l<j; ++l )
+				yj -= m_cholesky[ j*N+l ] * y[ l ];
+			y[ j ] = yj * m_inverseDiagonal[ j ];
+			dot_product += y[ j ] * y[ j ];
+		}
+		return dot_product;
+	}
+
 	// calculate a distance of the point
 	template< typename vector_type >
 	value_type operator()( const vector_type& vec ) const
 	{
-		// calculate a difference vector: n-diff
-		value_type value[ N ];
-		for( std::size_t i( 0 ); i<N; ++i )
-			value[ i ] = ( vec[ i ] - gaussian.mean[ i ] );
-		
-		// generate a temporary result
-		value_type sol_vec[ N ];
-		std::fill( sol_vec, sol_vec+N, 0 );
-		
-		// calculate: (n-by-n covariance^-1) * n-diff
-		for( std::size_t i1( 0 ); i1<N; ++i1 )
-			for( std::size_t i2( 0 ); i2<N; ++i2 )
-				sol_vec[ i1 ] += inv_covariance[ i1*N+i2 ] * value[ i2 ];
+		return std::sqrt( squared( vec ) );
+	}
 
-		// dot product of n-diff and temporary result
-		value_type dot_product( 0 );
-		for( std::size_t i( 0 ); i<N; ++i )
-			dot_product += sol_vec[ i ] * value[ i ];
-			
-		return std::sqrt( dot_product );
+	/**
+	 * Computes the squared distances of \c n points, <tt>result[ i ] = squared( points[ i ] )</tt>.
+	 * The points are indexed by \c operator[] like in \c operator().
+	 */
+	template< typename vector_type >
+	void squaredDistances( const vector_type* points, const std::size_t n, value_type* result ) const
+	{
+		typedef Util::simd_pack< value_type > Pack;
+
+		// centered points and solutions of a block in structure of arrays layout
+		value_type d[ N * blockSize ];
+		value_type y[ N * blockSize ];
+		for( std::size_t begin( 0 ); begin<n; begin += blockSize )
+		{
+			const std::size_t m = std::min< std::size_t >( blockSize, n - begin );
+			const std::size_t mPadded = ( ( m + Pack::size - 1 ) / Pack::size ) * Pack::size;
+			for( std::size_t j( 0 ); j<N; ++j )
+			{
+				value_type* dj( d + j*blockSize );
+				for( std::size_t i( 0 ); i<m; ++i )
+					dj[ i ] = points[ begin+i ][ j ] - m_mean[ j ];
+				std::fill( dj + m, dj + mPadded, value_type( 0 ) );
+			}
+
+			for( std::size_t i( 0 ); i<mPadded; i += Pack::size )
+			{
+				typename Pack::type acc( Pack::set1( value_type( 0 ) ) );
+				for( std::size_t j( 0 ); j<N; ++j )
+				{
+					typename Pack::type yj( Pack::load( d + j*blockSize + i ) );
+					for( std::size_t l( 0 ); l<j; ++l )
+						yj = Pack::sub( yj, Pack::mul( Pack::set1( m_cholesky[ j*N+l ] ), Pack::load( y + l*blockSize + i ) ) );
+					yj = Pack::mul( yj, Pack::set1( m_inverseDiagonal[ j ] ) );
+					Pack::store( y + j*blockSize + i, yj );
+					acc = Pack::add( acc, Pack::mul( yj, yj ) );
+				}
+				Pack::store( d + i, acc );
+			}
+			std::copy( d, d + m, result + begin );
+		}
+	}
+
+	/** computes the squared distances of a list of points, \c result is resized to the size of the list */
+	template< typename vector_type >
+	void squaredDistances( const std::vector< vector_type >& points, std::vector< value_type >& result ) const
+	{
+		result.resize( points.size() );
+		if( !points.empty() )
+			squaredDistances( &points[ 0 ], points.size(), &result[ 0 ] );
 	}
 };
 
 } } } // namespace Ubitrack::Math::Stochastic
 
-#endif //__UBITRACK_MATH_STOCHASTIC_MAHALANOBIS_DISTANCE_H__
\ No newline at end of file
+#endif //__UBITRACK_MATH_STOCHASTIC_MAHALANOBIS_DISTANCE_H__
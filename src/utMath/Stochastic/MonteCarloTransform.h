@@ -0,0 +1,300 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Monte Carlo propagation of a Gaussian through an estimator
+ */
+
+#ifndef __UBITRACK_MATH_MONTECARLOTRANSFORM_H_INCLUDED__
+#define __UBITRACK_MATH_MONTECARLOTRANSFORM_H_INCLUDED__
+
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/ErrorVector.h>
+#include <utMath/PoseListOperations.h>	// ListExecutor
+#include <utMath/Random/Engine.h>
+#include <utMath/Stochastic/Gaussian.h>
+#include <utUtil/Exception.h>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+
+namespace Ubitrack { namespace Math { namespace Stochastic {
+
+/**
+ * Monte Carlo transform of a Gaussian through a function from \c N to \c M dimensions.
+ *
+ * Draws samples of the input Gaussian, evaluates the function for each sample and estimates
+ * the mean and the covariance of the results. Unlike the \c UnscentedTransform this makes no
+ * assumption about the smoothness of the function, so it can validate the analytic covariances
+ * of nonlinear estimators, e.g. of \c backwardPropagation or \c singleCameraPoseError.
+ *
+ * The function has the same interface as the single point functions of \c UnscentedTransform:
+ * @verbatim
+ * void evaluate( Math::Vector< T, M >& result, const Math::Vector< T, N >& point ) const
+ * @endverbatim
+ * It is called from several threads at once if a \c Math::ListExecutor is given.
+ *
+ * The samples are evaluated in rounds of \c batchesPerRound batches of \c batchSize samples.
+ * Each batch draws its samples from its own engine, split off a \c Random::Engine with the given
+ * seed, and collects the results in its own \c GaussianAccumulator. The accumulators are merged in
+ * the order of the batches, so the result only depends on the seed and not on the executor.
+ * After each round the covariance is compared with that of the previous round, and the
+ * transform stops early if no element changed by more than \c tolerance times the largest
+ * variance.
+ *
+ * @tparam T the element type
+ * @tparam N dimension of the input
+ * @tparam M dimension of the output
+ */
+template< typename T, std::size_t N, std::size_t M >
+class MonteCarloTransform
+{
+public:
+	typedef Math::Vector< T, N > input_vector;
+	typedef Math::Matrix< T, N, N > input_matrix;
+	typedef Math::Vector< T, M > output_vector;
+	typedef Math::Matrix< T, M, M > output_matrix;
+
+	/** parameters of the transform */
+	struct Parameters
+	{
+		Parameters()
+			: maxSamples( 100000 )
+			, minSamples( 4000 )
+			, batchSize( 500 )
+			, batchesPerRound( 8 )
+			, tolerance( T( 1e-2 ) )
+			, seed( 0 )
+		{}
+
+		/** the transform stops after this number of samples, even if it has not converged */
+		std::size_t maxSamples;
+
+		/** the convergence is not tested before this number of samples */
+		std::size_t minSamples;
+
+		/** number of samples drawn and accumulated by one task */
+		std::size_t batchSize;
+
+		/** number of batches between two convergence tests, the parallelism of the executor */
+		std::size_t batchesPerRound;
+
+		/** maximum change of the covariance within a round, relative to the largest variance, 0 disables early stopping */
+		T tolerance;
+
+		/** seed of the random number streams */
+		boost::uint64_t seed;
+	};
+
+	/** constructor */
+	explicit MonteCarloTransform( const Parameters& params = Parameters() )
+		: m_params( params )
+		, m_firstBatch( 0 )
+		, m_samples( 0 )
+		, m_bConverged( false )
+	{
+		if ( m_params.batchSize == 0 || m_params.batchesPerRound == 0 )
+			UBITRACK_THROW( "monte carlo transform: batch size and batches per round must not be zero" );
+	}
+
+	/**
+	 * Transforms the Gaussian by a function that evaluates single points with \c evaluate.
+	 * @param f the function as described in the class documentation
+	 * @param mean the input mean
+	 * @param covariance the input covariance, must be positive semi-definite
+	 * @param resultMean the mean of the result
+	 * @param resultCovariance the (unbiased) sample covariance of the result
+	 * @param executor distributes the batches, the default evaluates them in the calling thread
+	 * @return true if the estimate converged before \c maxSamples were drawn
+	 */
+	template< class F >
+	bool transform( const F& f, const input_vector& mean, const input_matrix& covariance,
+		output_vector& resultMean, output_matrix& resultCovariance, const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		factorize( covariance );
+		m_mean = mean;
+		m_total.reset();
+		m_samples = 0;
+		m_bConverged = false;
+
+		const boost::function< void ( std::size_t, std::size_t ) > task(
+			boost::bind( &MonteCarloTransform::template evaluateBatches< F >, this, boost::cref( f ), _1, _2 ) );
+
+		Random::Engine master( m_params.seed );
+		output_matrix previous( output_matrix::zeros() );
+		std::size_t firstBatch = 0;
+		while ( m_samples < m_params.maxSamples )
+		{
+			const std::size_t maxBatches = ( m_params.maxSamples - m_samples + m_params.batchSize - 1 ) / m_params.batchSize;
+			const std::size_t nBatches = std::min( m_params.batchesPerRound, maxBatches );
+			m_firstBatch = firstBatch;
+			m_batches.assign( nBatches, GaussianAccumulator< T, M >() );
+			m_engines.resize( nBatches );
+			for ( std::size_t i = 0; i < nBatches; i++ )
+				m_engines[ i ] = master.split();
+			if ( executor.empty() )
+				task( 0, nBatches );
+			else
+				executor( nBatches, task );
+
+			for ( std::size_t i = 0; i < nBatches; i++ )
+				m_total.merge( m_batches[ i ] );
+			firstBatch += nBatches;
+			m_samples = m_total.count();
+
+			result( resultMean, resultCovariance );
+			if ( m_params.tolerance > 0 && m_samples >= m_params.minSamples && hasConverged( previous, resultCovariance ) )
+			{
+				m_bConverged = true;
+				break;
+			}
+			previous = resultCovariance;
+		}
+		return m_bConverged;
+	}
+
+	/** overload for \c ErrorVector */
+	template< class F >
+	ErrorVector< T, M > transform( const F& f, const ErrorVector< T, N >& in, const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		ErrorVector< T, M > result;
+		transform( f, in.value, in.covariance, result.value, result.covariance, executor );
+		return result;
+	}
+
+	/** number of samples evaluated by the last transformation */
+	std::size_t samples() const
+	{ return m_samples; }
+
+	/** true if the last transformation stopped early */
+	bool converged() const
+	{ return m_bConverged; }
+
+	/** the parameters */
+	const Parameters& parameters() const
+	{ return m_params; }
+
+protected:
+	/// @internal lower Cholesky factor of a positive semi-definite covariance
+	void factorize( const input_matrix& covariance )
+	{
+		m_factor = input_matrix::zeros();
+		for ( std::size_t j = 0; j < N; j++ )
+			for ( std::size_t l = 0; l <= j; l++ )
+			{
+				T s = covariance( j, l );
+				for ( std::size_t k = 0; k < l; k++ )
+					s -= m_factor( j, k ) * m_factor( l, k );
+				if ( l < j )
+					m_factor( j, l ) = m_factor( l, l ) > 0 ? s / m_factor( l, l ) : T( 0 );
+				else if ( s >= -std::numeric_limits< T >::epsilon() * covariance( j, j ) * N )
+					m_factor( j, j ) = std::sqrt( std::max( s, T( 0 ) ) );
+				else
+					UBITRACK_THROW( "monte carlo transform: covariance is not positive semi-definite" );
+			}
+	}
+
+	/// @internal evaluates the batches [ begin, end ) of the current round
+	template< class F >
+	void evaluateBatches( const F& f, const std::size_t begin, const std::size_t end )
+	{
+		std::vector< T > normals( N * m_params.batchSize );
+		input_vector point;
+		output_vector value;
+		for ( std::size_t b = begin; b < end; b++ )
+		{
+			const std::size_t batch = m_firstBatch + b;
+			const std::size_t n = std::min( m_params.batchSize, m_params.maxSamples - batch * m_params.batchSize );
+			m_engines[ b ].normal( &normals[ 0 ], N * n );
+
+			GaussianAccumulator< T, M >& accumulator( m_batches[ b ] );
+			for ( std::size_t i = 0; i < n; i++ )
+			{
+				const T* z = &normals[ i * N ];
+				for ( std::size_t j = 0; j < N; j++ )
+				{
+					T d = 0;
+					for ( std::size_t k = 0; k <= j; k++ )
+						d += m_factor( j, k ) * z[ k ];
+					point( j ) = m_mean( j ) + d;
+				}
+				f.evaluate( value, point );
+				accumulator.add( value );
+			}
+		}
+	}
+
+	/// @internal mean and unbiased covariance of all samples so far
+	void result( output_vector& resultMean, output_matrix& resultCovariance ) const
+	{
+		Gaussian< T, M > gaussian;
+		m_total.gaussian( gaussian );
+		const T correction = m_samples > 1 ? T( m_samples ) / T( m_samples - 1 ) : T( 1 );
+		for ( std::size_t i = 0; i < M; i++ )
+		{
+			resultMean( i ) = gaussian.mean[ i ];
+			for ( std::size_t j = 0; j < M; j++ )
+				resultCovariance( i, j ) = correction * gaussian.covariance[ i * M + j ];
+		}
+	}
+
+	/// @internal compares the covariance with that of the previous round
+	bool hasConverged( const output_matrix& previous, const output_matrix& current ) const
+	{
+		T scale = 0;
+		T change = 0;
+		for ( std::size_t i = 0; i < M; i++ )
+		{
+			scale = std::max( scale, current( i, i ) );
+			for ( std::size_t j = 0; j < M; j++ )
+				change = std::max( change, T( std::fabs( current( i, j ) - previous( i, j ) ) ) );
+		}
+		return change <= m_params.tolerance * scale;
+	}
+
+	Parameters m_params;
+
+	input_vector m_mean;
+	input_matrix m_factor;
+
+	/// index of the first batch of the current round
+	std::size_t m_firstBatch;
+	std::vector< GaussianAccumulator< T, M > > m_batches;
+	std::vector< Random::Engine > m_engines;
+	GaussianAccumulator< T, M > m_total;
+
+	std::size_t m_samples;
+	bool m_bConverged;
+};
+
+}}} // namespace Ubitrack::Math::Stochastic
+
+#endif
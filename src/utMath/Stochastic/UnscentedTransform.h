@@ -32,13 +32,233 @@
 #include <utMath/Pose.h>
 #include <utMath/Vector.h>
 #include <utMath/Matrix.h>
+#include <utMath/ErrorVector.h>
+#include <utMath/Blas2.h>	// outer_product
+#include <utMath/PoseListOperations.h>	// ListExecutor
 #include <utMath/Optimization/LevenbergMarquardt.h>
+#include <utUtil/Exception.h>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <boost/bind.hpp>
 
 // #include <boost/numeric/ublas/matrix_proxy.hpp>
 // #include <boost/numeric/ublas/vector_proxy.hpp>
 
 namespace Ubitrack { namespace Math { namespace Stochastic {
 
+/**
+ * Unscented transform of a Gaussian through a function from \c N to \c M dimensions.
+ *
+ * Implements the scaled unscented transform (Julier 2002, Wan and van der Merwe 2000) with
+ * <tt>2 N + 1</tt> sigma points. The weights and the scaling are computed once in the constructor.
+ * The Cholesky factor of the input covariance is kept and only recomputed if the next
+ * covariance differs, so propagating many means with the same covariance (e.g. the same
+ * measurement noise for every pose) needs a single factorization.
+ *
+ * The function gets all sigma points in one call, which allows it to vectorize or parallelize
+ * the evaluation:
+ * @verbatim
+ * void evaluateBatch( std::vector< Math::Vector< T, M > >& results, const std::vector< Math::Vector< T, N > >& points ) const
+ * @endverbatim
+ * Functions that only evaluate single points
+ * @verbatim
+ * void evaluate( Math::Vector< T, M >& result, const Math::Vector< T, N >& point ) const
+ * @endverbatim
+ * are used by \c transformEach, which can distribute the sigma points over several threads with
+ * a \c Math::ListExecutor. This pays off for expensive functions, e.g. an optimization per point.
+ *
+ * The mean and the covariance of the result are computed in the euclidean space of the output
+ * vector, so outputs like quaternions need their own averaging.
+ *
+ * @tparam T the element type
+ * @tparam N dimension of the input
+ * @tparam M dimension of the output
+ */
+template< typename T, std::size_t N, std::size_t M >
+class UnscentedTransform
+{
+public:
+	typedef Math::Vector< T, N > input_vector;
+	typedef Math::Matrix< T, N, N > input_matrix;
+	typedef Math::Vector< T, M > output_vector;
+	typedef Math::Matrix< T, M, M > output_matrix;
+	typedef Math::Matrix< T, N, M > cross_matrix;
+
+	/** number of sigma points */
+	static const std::size_t size = 2 * N + 1;
+
+	/**
+	 * Constructor.
+	 * @param alpha spread of the sigma points around the mean, in ( 0, 1 ]
+	 * @param beta prior knowledge about the distribution, 2 is optimal for Gaussians
+	 * @param kappa secondary scaling parameter, usually 0 or 3 - N
+	 */
+	UnscentedTransform( const T alpha = 1, const T beta = 2, const T kappa = 0 )
+		: m_points( size )
+		, m_results( size )
+		, m_bFactorized( false )
+		, m_factorizations( 0 )
+	{
+		const T lambda = alpha * alpha * ( N + kappa ) - N;
+		if ( !( N + lambda > 0 ) )
+			UBITRACK_THROW( "unscented transform: alpha and kappa result in a non-positive spread" );
+
+		m_scale = std::sqrt( N + lambda );
+		m_meanWeight0 = lambda / ( N + lambda );
+		m_covarianceWeight0 = m_meanWeight0 + 1 - alpha * alpha + beta;
+		m_weight = T( 1 ) / ( 2 * ( N + lambda ) );
+	}
+
+	/**
+	 * Computes the sigma points of a Gaussian, the first is the mean. The covariance must be positive definite.
+	 */
+	const std::vector< input_vector >& sigmaPoints( const input_vector& mean, const input_matrix& covariance )
+	{
+		factorize( covariance );
+		m_points[ 0 ] = mean;
+		for ( std::size_t i = 0; i < N; i++ )
+			for ( std::size_t j = 0; j < N; j++ )
+			{
+				m_points[ 1 + i ]( j ) = mean( j ) + m_scaledFactor( j, i );
+				m_points[ 1 + N + i ]( j ) = mean( j ) - m_scaledFactor( j, i );
+			}
+		return m_points;
+	}
+
+	/**
+	 * Transforms the Gaussian by a function that evaluates all sigma points in one call to \c evaluateBatch.
+	 * @param f the function as described in the class documentation
+	 * @param mean the input mean
+	 * @param covariance the input covariance
+	 * @param resultMean the mean of the result
+	 * @param resultCovariance the covariance of the result
+	 */
+	template< class F >
+	void transform( const F& f, const input_vector& mean, const input_matrix& covariance,
+		output_vector& resultMean, output_matrix& resultCovariance )
+	{
+		sigmaPoints( mean, covariance );
+		f.evaluateBatch( m_results, m_points );
+		if ( m_results.size() != size )
+			UBITRACK_THROW( "unscented transform: wrong number of function results" );
+		combine( resultMean, resultCovariance );
+	}
+
+	/**
+	 * Transforms the Gaussian by a function that evaluates single points with \c evaluate.
+	 * @param executor distributes the sigma points, the default evaluates them in the calling thread
+	 */
+	template< class F >
+	void transformEach( const F& f, const input_vector& mean, const input_matrix& covariance,
+		output_vector& resultMean, output_matrix& resultCovariance, const Math::ListExecutor& executor = Math::ListExecutor() )
+	{
+		sigmaPoints( mean, covariance );
+		const boost::function< void ( std::size_t, std::size_t ) > task(
+			boost::bind( &UnscentedTransform::template evaluateRange< F >, this, boost::cref( f ), _1, _2 ) );
+		if ( executor.empty() )
+			task( 0, size );
+		else
+			executor( size, task );
+		combine( resultMean, resultCovariance );
+	}
+
+	/** overload for \c ErrorVector, using \c evaluateBatch */
+	template< class F >
+	ErrorVector< T, M > transform( const F& f, const ErrorVector< T, N >& in )
+	{
+		ErrorVector< T, M > result;
+		transform( f, in.value, in.covariance, result.value, result.covariance );
+		return result;
+	}
+
+	/** cross covariance of the input and the result of the last transformation, e.g. for a Kalman gain */
+	const cross_matrix& crossCovariance() const
+	{ return m_crossCovariance; }
+
+	/** number of Cholesky factorizations computed so far */
+	std::size_t factorizations() const
+	{ return m_factorizations; }
+
+protected:
+	/// @internal computes the scaled lower Cholesky factor, unless the covariance has not changed
+	void factorize( const input_matrix& covariance )
+	{
+		if ( m_bFactorized && std::equal( covariance.data().begin(), covariance.data().end(), m_covariance.data().begin() ) )
+			return;
+
+		m_bFactorized = false;
+		m_scaledFactor = input_matrix::zeros();
+		for ( std::size_t j = 0; j < N; j++ )
+			for ( std::size_t l = 0; l <= j; l++ )
+			{
+				T s = covariance( j, l );
+				for ( std::size_t k = 0; k < l; k++ )
+					s -= m_scaledFactor( j, k ) * m_scaledFactor( l, k );
+				if ( l < j )
+					m_scaledFactor( j, l ) = s / m_scaledFactor( l, l );
+				else if ( s > 0 )
+					m_scaledFactor( j, j ) = std::sqrt( s );
+				else
+					UBITRACK_THROW( "unscented transform: covariance is not positive definite" );
+			}
+		m_scaledFactor *= m_scale;
+
+		m_covariance = covariance;
+		m_bFactorized = true;
+		m_factorizations++;
+	}
+
+	/// @internal evaluates the sigma points [ begin, end )
+	template< class F >
+	void evaluateRange( const F& f, const std::size_t begin, const std::size_t end )
+	{
+		for ( std::size_t i = begin; i < end; i++ )
+			f.evaluate( m_results[ i ], m_points[ i ] );
+	}
+
+	/// @internal weighted mean and covariances of the results
+	void combine( output_vector& resultMean, output_matrix& resultCovariance )
+	{
+		resultMean = m_meanWeight0 * m_results[ 0 ];
+		for ( std::size_t i = 1; i < size; i++ )
+			resultMean += m_weight * m_results[ i ];
+
+		output_vector d( m_results[ 0 ] - resultMean );
+		resultCovariance = m_covarianceWeight0 * Math::outer_product( d, d );
+		m_crossCovariance = Math::Matrix< T, N, M >::zeros();
+		for ( std::size_t i = 1; i < size; i++ )
+		{
+			d = m_results[ i ] - resultMean;
+			resultCovariance += m_weight * Math::outer_product( d, d );
+
+			// the deviations of the input points are the scaled columns of the factor
+			const std::size_t column = ( i - 1 ) % N;
+			const T sign = i <= N ? m_weight : -m_weight;
+			for ( std::size_t j = 0; j < N; j++ )
+				for ( std::size_t k = 0; k < M; k++ )
+					m_crossCovariance( j, k ) += sign * m_scaledFactor( j, column ) * d( k );
+		}
+	}
+
+	T m_scale;
+	T m_meanWeight0;
+	T m_covarianceWeight0;
+	T m_weight;
+
+	std::vector< input_vector > m_points;
+	std::vector< output_vector > m_results;
+	cross_matrix m_crossCovariance;
+
+	bool m_bFactorized;
+	std::size_t m_factorizations;
+	input_matrix m_covariance;
+	input_matrix m_scaledFactor;
+};
+
+
 /**
  * Performs an Unscented Transform based on a set of measurements in 2D, a given variance (the probability distribution
  * in 2D is assumed to be isotrophic)  a 2D->6D function, and returns the predicted 6D covariance.
@@ -128,7 +348,7 @@ Math::Matrix< double, 6, 6 > unscentedTransform(
 	// std::cout << std::endl;
 	
 	// Compute average pose
-	Math::Vector< double, 7 > avgPose( Math::Vector< double, 7 >::zeros(); );
+	Math::Vector< double, 7 > avgPose( Math::Vector< double, 7 >::zeros() );
 	for ( typename std::vector< Math::Vector< VType > >::iterator it = optimizedParameters.begin();
 			it != optimizedParameters.end(); it++ )
 	{
@@ -30,6 +30,7 @@
 #include "Weighted.h"
 #include <utUtil/Exception.h>
 #include <utUtil/StaticAssert.h>
+#include <utUtil/TracingProvider.h>
 #include "../Functors/MatrixFunctors.h"
  
 // std
@@ -77,7 +78,7 @@ struct Probability
 			{
 				// UBITRACK_THROW( "Cannot calculate covariance inverse, determinant is NaN or zero." );
 			
-				const value_type tmpconstant = 1 / std::sqrt( std::pow( static_cast< value_type >( 2.0 * 3.14159 ), size * static_cast< value_type >( 0.5 ) ) * std::fabs ( det ) );
+				const value_type tmpconstant = 1 / std::sqrt( std::pow( static_cast< value_type >( 2.0 * 3.14159265358979323846 ), static_cast< value_type >( size ) ) * std::fabs ( det ) );
 				constant = tmpconstant;
 				// if( constant != constant ) //trick to check if the value is valid
 					// UBITRACK_THROW( "Cannot reliable determine constant value of probability density function, it is NaN." );
@@ -258,6 +259,7 @@ typename std::iterator_traits< OutputIterator >::value_type::value_type expectat
 		
 		//check convergence criteria
 		const numeric_type newLikelihood = log_likelihood< numeric_type >( itBeginGauss, itEndGauss, itBegin, itEnd );
+		TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION( "expectation_maximization", i, k_cluster, newLikelihood );
 		if ( std::abs( likelihood - newLikelihood ) <  ( threshold * std::fabs( likelihood ) ) )
 			return newLikelihood;
 			
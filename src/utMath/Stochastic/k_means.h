@@ -36,12 +36,15 @@
 
 // Ubitrack
 #include "../Vector.h"
+#include "../PointCloud.h"
 #include "../Blas1.h" // InnnerProduct
 #include "../VectorFunctions.h" // Distance
 #include "../Random/Scalar.h" // Randomness needed for kmeans++
 
 // some helper header/template stuff
 #include <utUtil/StaticAssert.h>
+#include <utUtil/TracingProvider.h>
+#include <utUtil/Progress.h>
 #include "../Geometry/container_traits.h"
 #include "identity_iterator.h"
 
@@ -218,7 +221,9 @@ std::size_t copy_probability( const InputIterator iBegin, const InputIterator iE
 	// calculate distances to first element
 	std::vector< value_type > distances;
 	distances.reserve( n );
-	std::transform( iBegin, iEnd, Ubitrack::Util::identity< vector_type >( *itNewOut ).begin(), std::back_inserter( distances ), distanceFunc );
+	// copied, since iterators of e.g. a \c Math::PointCloud return the points by value
+	vector_type selected( *itNewOut );
+	std::transform( iBegin, iEnd, Ubitrack::Util::identity< vector_type >( selected ).begin(), std::back_inserter( distances ), distanceFunc );
 
 	value_type dist_sum = std::accumulate( distances.begin(), distances.end(), static_cast< value_type >( 0 ) );
 
@@ -242,7 +247,8 @@ std::size_t copy_probability( const InputIterator iBegin, const InputIterator iE
 		// calculate the distances to the new value
 		std::vector< value_type > distances_temp;
 		distances_temp.reserve( n );
-		std::transform( iBegin, iEnd, Ubitrack::Util::identity< vector_type >( *itNewOut ).begin(), std::back_inserter( distances_temp ), distanceFunc );
+		selected = *itNewOut;
+		std::transform( iBegin, iEnd, Ubitrack::Util::identity< vector_type >( selected ).begin(), std::back_inserter( distances_temp ), distanceFunc );
 
 		// determine the minimal distance to one of earlier chosen points
 		std::transform( distances.begin(), distances.end(), distances_temp.begin(), distances.begin(),
@@ -325,6 +331,8 @@ typename std::iterator_traits< OutputIterator >::value_type::value_type k_means(
 		norms1.reserve( n_cluster );
 		std::transform( itMeanBegin, itMeanEnd, means_temp.begin(), std::back_inserter( norms1 ), distanceFunc );
 		diff_error = std::accumulate( norms1.begin(), norms1.end(), static_cast< value_type >( 0 ) ) / n_cluster;
+		TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION( "k_means", i, n_cluster, diff_error );
+		Ubitrack::Util::reportProgress( "k_means", i + 1, diff_error );
 		
 		// store the new means values
 		itMeanEnd = std::copy( means_temp.begin(), means_temp.end(), itMeanBegin );
@@ -402,6 +410,18 @@ void k_means( const InputIterator iBeginValues, const InputIterator iEndValues,
 	std::copy( means.begin(), means.end(), itCentroids );
 };
 
+/**
+ * @ingroup math stochastic
+ * @brief overloaded function, determines k centroids of clusters from the points of a \c Math::PointCloud
+ *
+ * The points are read from the coordinate arrays of the cloud, see the iterator version above.
+ */ 
+template< typename T, std::size_t N, typename OutputIterator1, typename OutputIterator2 >
+void k_means( const Math::PointCloud< T, N >& points, const std::size_t n_cluster, OutputIterator1 itCentroids, OutputIterator2 itIndices )
+{
+	k_means( points.begin(), points.end(), n_cluster, itCentroids, itIndices );
+};
+
 } } } // namespace Ubitrack::Math::Stochastic
 
 #endif //__UBITRACK_MATH_STOCHASTIC_K_MEANS_H__
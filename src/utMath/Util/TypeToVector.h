@@ -165,7 +165,7 @@ struct TypeToVector
 
 /// @internal specialization of binary bracket operator for Quaternion type
 template<>
-void TypeToVector< Math::Quaternion >::operator() ( const Math::Quaternion &value, result_type &rhs ) const
+inline void TypeToVector< Math::Quaternion >::operator() ( const Math::Quaternion &value, result_type &rhs ) const
 {
 	rhs[ 0 ] = value.x();
 	rhs[ 1 ] = value.y();
@@ -175,14 +175,14 @@ void TypeToVector< Math::Quaternion >::operator() ( const Math::Quaternion &valu
 
 /// @internal specialization of unary bracket operator for Quaternion type
 template<>
-TypeToVector< Math::Quaternion >::result_type TypeToVector< Math::Quaternion >::operator() ( const Math::Quaternion &value ) const
+inline TypeToVector< Math::Quaternion >::result_type TypeToVector< Math::Quaternion >::operator() ( const Math::Quaternion &value ) const
 {
 	return result_type ( value.x(), value.y(), value.z(), value.w() );
 }
 
 /// @internal specialization of binary bracket operator for Pose type
 template<>
-void TypeToVector< Math::Pose >::operator() ( const Math::Pose &value, result_type &rhs ) const
+inline void TypeToVector< Math::Pose >::operator() ( const Math::Pose &value, result_type &rhs ) const
 {
 	rhs[ 0 ] = value.translation()[ 0 ];
 	rhs[ 1 ] = value.translation()[ 1 ];
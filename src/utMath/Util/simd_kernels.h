@@ -0,0 +1,132 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * SIMD kernels for the small fixed-size products of the Blas functors
+ *
+ * The functors in \c Blas1.h, \c Blas2.h and \c Blas3.h unroll their loops at
+ * compile time. For 3- and 4-element vectors and 3x3/4x4 matrices of \c float and
+ * \c double they call the kernels below instead, if the target provides a
+ * \c simd_pack (see simd_traits.h) that fits at least once into a column.
+ * Otherwise, and if \c UBITRACK_DISABLE_SIMD is defined, the recursive scalar
+ * implementation is used.
+ *
+ * All matrices are column-major as \c Math::Matrix, loads and stores work on
+ * unaligned memory and the result must not overlap the arguments.
+ */
+
+#ifndef __UBITRACK_MATH_UTIL_SIMD_KERNELS_H_INCLUDED__
+#define __UBITRACK_MATH_UTIL_SIMD_KERNELS_H_INCLUDED__
+
+#include "simd_traits.h"
+#include "type_traits.h"
+
+#include <cstddef> // std::size_t
+
+namespace Ubitrack { namespace Math { namespace Util {
+
+/**
+ * @internal true_type, if the kernels below are used for columns of length \c M
+ * (and \c N columns) of type \c T. The element types \c T1 and \c T2 of the
+ * other arguments must be the same as \c T.
+ */
+template< typename T, std::size_t M, std::size_t N = M, typename T1 = T, typename T2 = T >
+struct has_simd_kernel
+	: public Ubitrack::Util::constant_value< bool, ( simd_pack< T >::size > 1 ) && ( M >= simd_pack< T >::size )
+		&& ( M >= 3 ) && ( M <= 4 ) && ( N >= 3 ) && ( N <= 4 )
+		&& Ubitrack::Util::is_same< T, T1 >::value && Ubitrack::Util::is_same< T, T2 >::value >
+{};
+
+/** @internal inner product of two vectors with \c N elements */
+template< typename T, std::size_t N >
+T simd_dot( const T* a, const T* b )
+{
+	typedef simd_pack< T > Pack;
+	typename Pack::type acc = Pack::mul( Pack::load( a ), Pack::load( b ) );
+	std::size_t i = Pack::size;
+	for ( ; i + Pack::size <= N; i += Pack::size )
+		acc = Pack::add( acc, Pack::mul( Pack::load( a + i ), Pack::load( b + i ) ) );
+
+	T lanes[ Pack::size ];
+	Pack::store( lanes, acc );
+	T result( lanes[ 0 ] );
+	for ( std::size_t j = 1; j < Pack::size; j++ )
+		result += lanes[ j ];
+	for ( ; i < N; i++ )
+		result += a[ i ] * b[ i ];
+	return result;
+}
+
+/** @internal product y = A * x of a \c M x \c N matrix and a vector */
+template< typename T, std::size_t M, std::size_t N >
+void simd_gemv( const T* A, const T* x, T* y )
+{
+	typedef simd_pack< T > Pack;
+	std::size_t i = 0;
+	for ( ; i + Pack::size <= M; i += Pack::size )
+	{
+		typename Pack::type acc = Pack::mul( Pack::load( A + i ), Pack::set1( x[ 0 ] ) );
+		for ( std::size_t j = 1; j < N; j++ )
+			acc = Pack::add( acc, Pack::mul( Pack::load( A + j * M + i ), Pack::set1( x[ j ] ) ) );
+		Pack::store( y + i, acc );
+	}
+
+	// remaining rows
+	for ( ; i < M; i++ )
+	{
+		T sum( A[ i ] * x[ 0 ] );
+		for ( std::size_t j = 1; j < N; j++ )
+			sum += A[ j * M + i ] * x[ j ];
+		y[ i ] = sum;
+	}
+}
+
+/** @internal product C = A * B of a \c M x \c K and a \c K x \c N matrix */
+template< typename T, std::size_t M, std::size_t K, std::size_t N >
+void simd_gemm( const T* A, const T* B, T* C )
+{
+	for ( std::size_t j = 0; j < N; j++ )
+		simd_gemv< T, M, K >( A, B + j * K, C + j * M );
+}
+
+/** @internal outer product C = a * b^T of vectors with \c M and \c N elements */
+template< typename T, std::size_t M, std::size_t N >
+void simd_outer( const T* a, const T* b, T* C )
+{
+	typedef simd_pack< T > Pack;
+	for ( std::size_t j = 0; j < N; j++ )
+	{
+		const typename Pack::type bj = Pack::set1( b[ j ] );
+		std::size_t i = 0;
+		for ( ; i + Pack::size <= M; i += Pack::size )
+			Pack::store( C + j * M + i, Pack::mul( Pack::load( a + i ), bj ) );
+		for ( ; i < M; i++ )
+			C[ j * M + i ] = a[ i ] * b[ j ];
+	}
+}
+
+} } } // namespace Ubitrack::Math::Util
+
+#endif // __UBITRACK_MATH_UTIL_SIMD_KERNELS_H_INCLUDED__
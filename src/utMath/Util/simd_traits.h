@@ -0,0 +1,221 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup math
+ * @file
+ * Thin wrapper around the SIMD registers of the target platform
+ *
+ * \c simd_pack< T > provides the few arithmetic operations needed by the
+ * batch kernels for several values of type \c T at once. Depending on the
+ * compiler flags AVX, SSE2 or (64 bit) NEON instructions are used, otherwise
+ * a pack contains a single value. Define \c UBITRACK_DISABLE_SIMD to always
+ * use the scalar version.
+ *
+ * The packs are defined in a namespace named after the instruction set, so code
+ * compiled with different flags (e.g. the library and an application) does not
+ * share template instances that use different registers.
+ */
+
+#ifndef __UBITRACK_MATH_UTIL_SIMD_TRAITS_H_INCLUDED__
+#define __UBITRACK_MATH_UTIL_SIMD_TRAITS_H_INCLUDED__
+
+#include <cmath>
+#include <cstddef> // std::size_t
+
+#ifndef UBITRACK_DISABLE_SIMD
+	#if defined( __AVX__ )
+		#define UBITRACK_SIMD_AVX
+		#define UBITRACK_SIMD_NAMESPACE simd_avx
+		#include <immintrin.h>
+	#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+		#define UBITRACK_SIMD_SSE2
+		#define UBITRACK_SIMD_NAMESPACE simd_sse2
+		#include <emmintrin.h>
+	#elif defined( __ARM_NEON ) && defined( __aarch64__ )
+		#define UBITRACK_SIMD_NEON
+		#define UBITRACK_SIMD_NAMESPACE simd_neon
+		#include <arm_neon.h>
+	#endif
+#endif
+
+#ifndef UBITRACK_SIMD_NAMESPACE
+	#define UBITRACK_SIMD_NAMESPACE simd_none
+#endif
+
+namespace Ubitrack { namespace Math { namespace Util {
+
+/**
+ * @internal scalar version of a SIMD pack, used if no instruction set is available
+ * and for the remaining values behind the last full pack
+ *
+ * All loads and stores work on unaligned memory.
+ */
+template< typename T >
+struct simd_scalar
+{
+	typedef T type;
+	static const std::size_t size = 1;
+
+	static type load( const T* p ) { return *p; }
+	static void store( T* p, const type a ) { *p = a; }
+	static type set1( const T v ) { return v; }
+	static type add( const type a, const type b ) { return a + b; }
+	static type sub( const type a, const type b ) { return a - b; }
+	static type mul( const type a, const type b ) { return a * b; }
+	static type div( const type a, const type b ) { return a / b; }
+	static type sqrt( const type a ) { return std::sqrt( a ); }
+	static type max( const type a, const type b ) { return a < b ? b : a; }
+};
+
+namespace UBITRACK_SIMD_NAMESPACE {
+
+/// @internal widest SIMD pack available for type \c T, specialized below
+template< typename T >
+struct simd_pack
+	: public simd_scalar< T >
+{};
+
+#if defined( UBITRACK_SIMD_AVX )
+
+/// @internal AVX pack of 8 floats
+template<>
+struct simd_pack< float >
+{
+	typedef __m256 type;
+	static const std::size_t size = 8;
+
+	static type load( const float* p ) { return _mm256_loadu_ps( p ); }
+	static void store( float* p, const type a ) { _mm256_storeu_ps( p, a ); }
+	static type set1( const float v ) { return _mm256_set1_ps( v ); }
+	static type add( const type a, const type b ) { return _mm256_add_ps( a, b ); }
+	static type sub( const type a, const type b ) { return _mm256_sub_ps( a, b ); }
+	static type mul( const type a, const type b ) { return _mm256_mul_ps( a, b ); }
+	static type div( const type a, const type b ) { return _mm256_div_ps( a, b ); }
+	static type sqrt( const type a ) { return _mm256_sqrt_ps( a ); }
+	static type max( const type a, const type b ) { return _mm256_max_ps( a, b ); }
+};
+
+/// @internal AVX pack of 4 doubles
+template<>
+struct simd_pack< double >
+{
+	typedef __m256d type;
+	static const std::size_t size = 4;
+
+	static type load( const double* p ) { return _mm256_loadu_pd( p ); }
+	static void store( double* p, const type a ) { _mm256_storeu_pd( p, a ); }
+	static type set1( const double v ) { return _mm256_set1_pd( v ); }
+	static type add( const type a, const type b ) { return _mm256_add_pd( a, b ); }
+	static type sub( const type a, const type b ) { return _mm256_sub_pd( a, b ); }
+	static type mul( const type a, const type b ) { return _mm256_mul_pd( a, b ); }
+	static type div( const type a, const type b ) { return _mm256_div_pd( a, b ); }
+	static type sqrt( const type a ) { return _mm256_sqrt_pd( a ); }
+	static type max( const type a, const type b ) { return _mm256_max_pd( a, b ); }
+};
+
+#elif defined( UBITRACK_SIMD_SSE2 )
+
+/// @internal SSE pack of 4 floats
+template<>
+struct simd_pack< float >
+{
+	typedef __m128 type;
+	static const std::size_t size = 4;
+
+	static type load( const float* p ) { return _mm_loadu_ps( p ); }
+	static void store( float* p, const type a ) { _mm_storeu_ps( p, a ); }
+	static type set1( const float v ) { return _mm_set1_ps( v ); }
+	static type add( const type a, const type b ) { return _mm_add_ps( a, b ); }
+	static type sub( const type a, const type b ) { return _mm_sub_ps( a, b ); }
+	static type mul( const type a, const type b ) { return _mm_mul_ps( a, b ); }
+	static type div( const type a, const type b ) { return _mm_div_ps( a, b ); }
+	static type sqrt( const type a ) { return _mm_sqrt_ps( a ); }
+	static type max( const type a, const type b ) { return _mm_max_ps( a, b ); }
+};
+
+/// @internal SSE2 pack of 2 doubles
+template<>
+struct simd_pack< double >
+{
+	typedef __m128d type;
+	static const std::size_t size = 2;
+
+	static type load( const double* p ) { return _mm_loadu_pd( p ); }
+	static void store( double* p, const type a ) { _mm_storeu_pd( p, a ); }
+	static type set1( const double v ) { return _mm_set1_pd( v ); }
+	static type add( const type a, const type b ) { return _mm_add_pd( a, b ); }
+	static type sub( const type a, const type b ) { return _mm_sub_pd( a, b ); }
+	static type mul( const type a, const type b ) { return _mm_mul_pd( a, b ); }
+	static type div( const type a, const type b ) { return _mm_div_pd( a, b ); }
+	static type sqrt( const type a ) { return _mm_sqrt_pd( a ); }
+	static type max( const type a, const type b ) { return _mm_max_pd( a, b ); }
+};
+
+#elif defined( UBITRACK_SIMD_NEON )
+
+/// @internal NEON pack of 4 floats
+template<>
+struct simd_pack< float >
+{
+	typedef float32x4_t type;
+	static const std::size_t size = 4;
+
+	static type load( const float* p ) { return vld1q_f32( p ); }
+	static void store( float* p, const type a ) { vst1q_f32( p, a ); }
+	static type set1( const float v ) { return vdupq_n_f32( v ); }
+	static type add( const type a, const type b ) { return vaddq_f32( a, b ); }
+	static type sub( const type a, const type b ) { return vsubq_f32( a, b ); }
+	static type mul( const type a, const type b ) { return vmulq_f32( a, b ); }
+	static type div( const type a, const type b ) { return vdivq_f32( a, b ); }
+	static type sqrt( const type a ) { return vsqrtq_f32( a ); }
+	static type max( const type a, const type b ) { return vmaxq_f32( a, b ); }
+};
+
+/// @internal NEON pack of 2 doubles
+template<>
+struct simd_pack< double >
+{
+	typedef float64x2_t type;
+	static const std::size_t size = 2;
+
+	static type load( const double* p ) { return vld1q_f64( p ); }
+	static void store( double* p, const type a ) { vst1q_f64( p, a ); }
+	static type set1( const double v ) { return vdupq_n_f64( v ); }
+	static type add( const type a, const type b ) { return vaddq_f64( a, b ); }
+	static type sub( const type a, const type b ) { return vsubq_f64( a, b ); }
+	static type mul( const type a, const type b ) { return vmulq_f64( a, b ); }
+	static type div( const type a, const type b ) { return vdivq_f64( a, b ); }
+	static type sqrt( const type a ) { return vsqrtq_f64( a ); }
+	static type max( const type a, const type b ) { return vmaxq_f64( a, b ); }
+};
+
+#endif
+
+} // namespace UBITRACK_SIMD_NAMESPACE
+
+using namespace UBITRACK_SIMD_NAMESPACE;
+
+} } } // namespace Ubitrack::Math::Util
+
+#endif // __UBITRACK_MATH_UTIL_SIMD_TRAITS_H_INCLUDED__
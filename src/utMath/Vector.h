@@ -33,6 +33,8 @@
 #define __UBTRACK_MATH_VECTOR_H_INCLUDED__
 
 #include <utUtil/StaticAssert.h>
+#include <utUtil/AllocationTracker.h>
+#include <utMath/SmallArray.h>
 
 #include <assert.h>
 #include <cstddef> //  std::size_t
@@ -223,8 +225,9 @@ template< typename T, std::size_t N = 0 > class Vector
  * @ingroup math
  * @brief Specialization of \b Vector for memory allocation during runtime.
  *
- * The size of the \b Vector is determined at runtime, the heap is used
- * for memory allocation in this case.
+ * The size of the \b Vector is determined at runtime. Up to 32 elements
+ * are stored within the object, the heap is used for larger vectors. The heap
+ * storage is counted by the \c Util::AllocationTracker if tracking is enabled.
  * Many functions are dropped since they are not necessary yet ( e.g. \c serialize ).
  *
  * @note Please see Vector for more details on the stack allocated version.
@@ -233,11 +236,13 @@ template< typename T, std::size_t N = 0 > class Vector
  */
 template< typename T >
 class Vector< T, 0 >
-	: public boost::numeric::ublas::vector< T, boost::numeric::ublas::unbounded_array< T > >
+	: public boost::numeric::ublas::vector< T, Math::SmallArray< T, 32,
+		typename Ubitrack::Util::TrackedAllocator< T, Ubitrack::Util::AllocationTracker::MathStorage >::type > >
 {
 	public:
 		// some typedefs for templated algorithm design
-		typedef boost::numeric::ublas::vector< T, boost::numeric::ublas::unbounded_array< T > > base_type;
+		typedef boost::numeric::ublas::vector< T, Math::SmallArray< T, 32,
+			typename Ubitrack::Util::TrackedAllocator< T, Ubitrack::Util::AllocationTracker::MathStorage >::type > > base_type;
 		typedef Math::Vector< T, 0 >			self_type;
 		typedef T								value_type;
 		typedef typename base_type::size_type	size_type;
@@ -0,0 +1,218 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup datastructures
+ * @file
+ * Measurement with the payload stored by value
+ */
+
+
+#ifndef _Ubitrack_Measurement_InlineMeasurement_INCLUDED_
+#define _Ubitrack_Measurement_InlineMeasurement_INCLUDED_
+
+#include "Measurement.h"
+
+#include <boost/static_assert.hpp>
+
+namespace Ubitrack { namespace Measurement {
+
+// forward declaration of InlineMeasurement
+template< typename Type > class InlineMeasurement;
+
+// small single measurements, the lists stay shared
+typedef InlineMeasurement< Math::Scalar< double > > InlineDistance;
+typedef InlineMeasurement< Math::Scalar< int > > InlineButton;
+typedef InlineMeasurement< Math::Vector< double, 2 > > InlinePosition2D;
+typedef InlineMeasurement< Math::Vector< double, 3 > > InlinePosition;
+typedef InlineMeasurement< Math::Quaternion > InlineRotation;
+typedef InlineMeasurement< Math::Pose > InlinePose;
+
+
+/**
+ * stream output operator
+ */
+template< typename Type >
+std::ostream& operator<< ( std::ostream& s, const InlineMeasurement< Type >& m )
+{
+	if ( m.invalid() )
+		return s << "INVALID";
+	else
+	{
+		char buffer[ timestampStringSize ];
+		timestampToShortString( m.m_timestamp, buffer );
+		return s << *m << " " << buffer;
+	}
+}
+
+
+/**
+ * @ingroup datastructures
+ * InlineMeasurement: measurement of a small, fixed-size payload that is stored
+ * next to the timestamp instead of behind a \c shared_ptr.
+ *
+ * Copying an \c InlineMeasurement copies the payload, so it behaves like a value and
+ * never touches the heap. The payload is accessed with pointer syntax as with
+ * \c Measurement, so most code works with both variants.
+ *
+ * Conversion from and to the shared \c Measurement< Type > is explicit, as it
+ * copies the payload:
+ * @verbatim
+Measurement::InlinePose a( Measurement::Pose( t, pose ) );
+Measurement::Pose b( a.shared() );
+@endverbatim
+ *
+ * Only use this for payloads of a few dozen bytes such as positions, rotations,
+ * poses and buttons. Lists and other large payloads should be kept in a
+ * \c Measurement, where copying is cheap.
+ *
+ * @param Type data type of payload.
+ */
+template< typename Type >
+class InlineMeasurement
+{
+	// larger payloads are cheaper to pass around in a shared Measurement
+	BOOST_STATIC_ASSERT( sizeof( Type ) <= 128 );
+
+	public:
+		/// short-cut that defines the contentype of the underlying data-structure
+		typedef Type value_type;
+
+		/// short-cut to built-in type of time measurement
+		typedef Timestamp timestamp_type;
+
+		/// the shared measurement type with the same payload
+		typedef Measurement< Type > shared_type;
+
+	protected:
+
+		/// timestamp associated with the measurement
+		timestamp_type m_timestamp;
+
+		/// the payload
+		Type m_value;
+
+		/// static const timestamp that defines an invalid timestamp
+		static const timestamp_type INVALID = 0;
+
+	public:
+
+		/**
+		 * Default Constructor.
+		 * The payload is default constructed and the measurement flagged as invalid.
+		 */
+		InlineMeasurement()
+			: m_timestamp( INVALID )
+			, m_value()
+		{ }
+
+		/** Construct from timestamp and payload. */
+		InlineMeasurement( const timestamp_type t, const Type& m )
+			: m_timestamp( t )
+			, m_value( m )
+		{ }
+
+		/**
+		 * Construct from a shared measurement by copying its payload.
+		 * A measurement without payload results in a default constructed one.
+		 */
+		explicit InlineMeasurement( const shared_type& m )
+			: m_timestamp( m.time() )
+			, m_value( m.get() ? *m : Type() )
+		{ }
+
+		/** returns a shared measurement with a copy of the payload */
+		shared_type shared() const
+		{ return shared_type( m_timestamp, m_value ); }
+
+		/**
+		 * set the internal timestamp
+		 */
+		void time( const timestamp_type t )
+		{ m_timestamp = t; }
+
+		/**
+		 * get the internal timestamp
+		 */
+		Timestamp time() const
+		{ return m_timestamp; }
+
+		/** pointer-like access to the payload */
+		Type& operator*()
+		{ return m_value; }
+
+		/** pointer-like access to the payload */
+		const Type& operator*() const
+		{ return m_value; }
+
+		/** pointer-like access to the payload */
+		Type* operator->()
+		{ return &m_value; }
+
+		/** pointer-like access to the payload */
+		const Type* operator->() const
+		{ return &m_value; }
+
+		/** pointer to the payload, never 0 */
+		Type* get()
+		{ return &m_value; }
+
+		/** pointer to the payload, never 0 */
+		const Type* get() const
+		{ return &m_value; }
+
+		/**
+		 * Checks, if measurement is valid
+		 */
+		bool invalid() const
+		{ return m_timestamp == INVALID; }
+
+		/**
+		 * Sets the current measurement as invalid
+		 */
+		void invalidate()
+		{ m_timestamp = INVALID; }
+
+	protected:
+
+		// make ostream operator as friend
+		friend std::ostream& operator<< <> ( std::ostream& s, const InlineMeasurement< Type >& m );
+
+		// make  boost-serialization friend for data serialization
+		friend class ::boost::serialization::access;
+
+		/**
+		 * (un-)serialization helper function, same layout as \c Measurement
+		 */
+		template< class Archive >
+		void serialize( Archive& ar, const unsigned int version )
+		{
+			ar & m_timestamp;
+			ar & m_value;
+		}
+};
+
+} } // namespace Ubitrack::Measurement
+
+#endif // _Ubitrack_Measurement_InlineMeasurement_INCLUDED_
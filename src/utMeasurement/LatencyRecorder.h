@@ -0,0 +1,108 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup datastructures
+ * @file
+ * Latency histograms of measurements at their sinks
+ */
+
+#ifndef _Ubitrack_Measurement_LatencyRecorder_INCLUDED_
+#define _Ubitrack_Measurement_LatencyRecorder_INCLUDED_
+
+#include "Measurement.h"
+
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/utility.hpp>
+
+#include <utUtil/OS.h>
+#include <utUtil/HistogramBlockTimer.h>
+
+namespace Ubitrack { namespace Measurement {
+
+/**
+ * @ingroup datastructures
+ * Records the latency of the measurements consumed by one sink, from their creation to the call
+ * of \c record, in a \c Util::HistogramBlockTimer named <tt>latency.</tt> followed by the name of
+ * the sink. As the timer is part of the \c Util::TimerRegistry, the percentiles of all sinks are
+ * reported continuously by its reporter.
+ *
+ * Creation times are only recorded with \c UBITRACK_MEASUREMENT_LATENCY, see
+ * \c Measurement::created. Without it, \c record does nothing and the timer stays empty, so it
+ * does not show up in the reports. Measurements without creation time, e.g. deserialized ones,
+ * are skipped as well.
+ * @verbatim
+static Measurement::LatencyRecorder g_latency( "render" );
+...
+g_latency.record( pose );
+@endverbatim
+ */
+class LatencyRecorder
+	: private boost::noncopyable
+{
+public:
+	/**
+	 * constructs an empty recorder
+	 * @param sSink name of the sink, the timer is called <tt>latency.sSink</tt>
+	 * @param sLoggingCategory log4cpp category to which to print the result when the recorder is destroyed
+	 */
+	explicit LatencyRecorder( const std::string& sSink, const std::string& sLoggingCategory = std::string() )
+		: m_timer( "latency." + sSink, sLoggingCategory )
+		, m_maxHops( 0 )
+	{}
+
+	/** records the latency of a measurement that arrived at the sink, may be called concurrently */
+	template< typename Type >
+	void record( const Measurement< Type >& m )
+	{
+		const long long created = m.created();
+		if ( created == 0 )
+			return;
+
+		const long long now = Util::getHighPerformanceCounter();
+		m_timer.addMeasurement( now > created ? static_cast< unsigned long long >( now - created ) : 0 );
+
+		unsigned maxHops = m_maxHops.load( boost::memory_order_relaxed );
+		while ( m.hops() > maxHops && !m_maxHops.compare_exchange_weak( maxHops, m.hops(), boost::memory_order_relaxed ) )
+			;
+	}
+
+	/** the timer with the latency histogram */
+	const Util::HistogramBlockTimer& timer() const
+	{ return m_timer; }
+
+	/** the largest number of hops of a recorded measurement */
+	unsigned maxHops() const
+	{ return m_maxHops.load( boost::memory_order_relaxed ); }
+
+protected:
+	Util::HistogramBlockTimer m_timer;
+	boost::atomic< unsigned > m_maxHops;
+};
+
+} } // namespace Ubitrack::Measurement
+
+#endif
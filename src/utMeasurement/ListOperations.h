@@ -0,0 +1,139 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup datastructures
+ * @file
+ * Operations on list measurements, e.g. \c PoseList and \c PositionList
+ *
+ * Thin wrappers around utMath/PoseListOperations.h. The result measurement gets the
+ * timestamp of the input. Its payload is written in place if no other measurement
+ * refers to it, so a result that is reused with lists of the same size needs no
+ * allocation:
+ * @code
+ * Measurement::PoseList result;
+ * while ( ... )
+ *     Measurement::multiply( offset, poses, result );
+ * @endcode
+ */
+
+#ifndef _Ubitrack_Measurement_ListOperations_INCLUDED_
+#define _Ubitrack_Measurement_ListOperations_INCLUDED_
+
+#include "Measurement.h"
+
+#include <utMath/PoseListOperations.h>
+#include <utMath/ErrorPose.h>
+
+namespace Ubitrack { namespace Measurement {
+
+/**
+ * prepares \c m to receive a list of \c n elements with timestamp \c t and returns the list.
+ * The payload is only replaced if \c m has none or shares it with other measurements.
+ */
+template< typename T >
+std::vector< T >& reuseList( Measurement< std::vector< T > >& m, const Timestamp t, const std::size_t n )
+{
+	if ( !m.get() || !m.unique() )
+		m = Measurement< std::vector< T > >( t, boost::shared_ptr< std::vector< T > >( new std::vector< T >( n ) ) );
+	else
+	{
+		m.time( t );
+		m->resize( n );
+	}
+	return *m;
+}
+
+/** computes <tt>result[ i ] = p * poses[ i ]</tt> */
+inline void multiply( const Math::Pose& p, const PoseList& poses, PoseList& result
+	, const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	// the input may be the result, so take a reference first
+	const PoseList in( poses );
+	Math::multiplyPoseList( p, *in, reuseList( result, in.time(), in->size() ), executor );
+}
+
+/** computes <tt>result[ i ] = poses[ i ] * p</tt> */
+inline void multiply( const PoseList& poses, const Math::Pose& p, PoseList& result
+	, const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	const PoseList in( poses );
+	Math::multiplyPoseList( *in, p, reuseList( result, in.time(), in->size() ), executor );
+}
+
+/** computes <tt>result[ i ] = ~poses[ i ]</tt> */
+inline void invert( const PoseList& poses, PoseList& result, const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	const PoseList in( poses );
+	Math::invertPoseList( *in, reuseList( result, in.time(), in->size() ), executor );
+}
+
+/**
+ * interpolates between two pose lists of the same size, the timestamp is
+ * interpolated as well
+ * @param t interpolation point between 0.0 and 1.0
+ */
+inline void interpolate( const PoseList& x, const PoseList& y, const double t, PoseList& result
+	, const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	const PoseList inX( x ), inY( y );
+	const Timestamp time = inX.time() + static_cast< Timestamp >( t * ( static_cast< double >( inY.time() ) - static_cast< double >( inX.time() ) ) );
+	Math::interpolatePoseList( *inX, *inY, t, reuseList( result, time, inX->size() ), executor );
+}
+
+/** computes <tt>result[ i ] = p * positions[ i ]</tt> */
+inline void transform( const Math::Pose& p, const PositionList& positions, PositionList& result
+	, const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	const PositionList in( positions );
+	Math::transformPositionList( p, *in, reuseList( result, in.time(), in->size() ), executor );
+}
+
+/** computes <tt>result[ i ] = p * positions[ i ]</tt> and the covariances of the result */
+inline void transform( const Math::Pose& p, const ErrorPositionList& positions, ErrorPositionList& result
+	, const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	const ErrorPositionList in( positions );
+	Math::transformErrorPositionList( p, *in, reuseList( result, in.time(), in->size() ), executor );
+}
+
+/** computes <tt>result[ i ] = p * positions[ i ]</tt>, propagating the errors of the pose and of the positions */
+inline void transform( const Math::ErrorPose& p, const ErrorPositionList& positions, ErrorPositionList& result
+	, const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	const ErrorPositionList in( positions );
+	Math::transformErrorPositionList( p, *in, reuseList( result, in.time(), in->size() ), executor );
+}
+
+/** computes the distances between corresponding positions of two lists of the same size */
+inline void distances( const PositionList& a, const PositionList& b, DistanceList& result
+	, const Math::ListExecutor& executor = Math::ListExecutor() )
+{
+	const PositionList inA( a ), inB( b );
+	Math::positionDistances( *inA, *inB, reuseList( result, inA.time(), inA->size() ), executor );
+}
+
+} } // namespace Ubitrack::Measurement
+
+#endif // _Ubitrack_Measurement_ListOperations_INCLUDED_
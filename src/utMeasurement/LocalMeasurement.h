@@ -0,0 +1,303 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup datastructures
+ * @file
+ * Measurement with a non-atomic reference count for single-threaded use
+ */
+
+
+#ifndef _Ubitrack_Measurement_LocalMeasurement_INCLUDED_
+#define _Ubitrack_Measurement_LocalMeasurement_INCLUDED_
+
+#include "Measurement.h"
+
+#include <boost/make_shared.hpp>
+
+namespace Ubitrack { namespace Measurement {
+
+// forward declaration of LocalMeasurement
+template< typename Type > class LocalMeasurement;
+
+typedef LocalMeasurement< Math::Scalar< double > > LocalDistance;
+typedef LocalMeasurement< Math::Scalar< int > > LocalButton;
+typedef LocalMeasurement< Math::Vector< double, 2 > > LocalPosition2D;
+typedef LocalMeasurement< Math::Vector< double, 3 > > LocalPosition;
+typedef LocalMeasurement< Math::Quaternion > LocalRotation;
+typedef LocalMeasurement< Math::Pose > LocalPose;
+typedef LocalMeasurement< std::vector< Math::Vector< double, 2 > > > LocalPositionList2;
+typedef LocalMeasurement< std::vector< Math::Vector< double, 3 > > > LocalPositionList;
+typedef LocalMeasurement< std::vector< Math::Pose > > LocalPoseList;
+
+
+/**
+ * stream output operator
+ */
+template< typename Type >
+std::ostream& operator<< ( std::ostream& s, const LocalMeasurement< Type >& m )
+{
+	if ( m.invalid() )
+		return s << "INVALID";
+	else
+	{
+		char buffer[ timestampStringSize ];
+		timestampToShortString( m.m_timestamp, buffer );
+		return s << *m << " " << buffer;
+	}
+}
+
+
+/**
+ * @ingroup datastructures
+ * LocalMeasurement: measurement handle whose copies share the payload like
+ * \c Measurement, but count their references without atomic operations.
+ *
+ * All copies of a \c LocalMeasurement refer to one small node that holds a plain
+ * reference count and the payload. Copying and destroying handles therefore costs
+ * an ordinary increment and decrement, which pays off in offline replay and in
+ * per-camera worker threads that pass measurements around a lot but never hand
+ * them to another thread.
+ *
+ * A \c LocalMeasurement and all its copies must stay on the thread that created
+ * them. At thread boundaries convert explicitly to the thread-safe form, which
+ * shares the payload without copying it:
+ * @verbatim
+Measurement::LocalPose a( t, pose );        // worker thread
+Measurement::Pose b( a.shared() );          // hand b to other threads
+Measurement::LocalPose c( b );              // and back on the receiving thread
+@endverbatim
+ *
+ * As with \c Measurement, \c writable gives copy-on-write access. It also copies if
+ * the payload has been handed out through \c shared.
+ *
+ * @param Type data type of payload.
+ */
+template< typename Type >
+class LocalMeasurement
+{
+	public:
+		/// short-cut that defines the contentype of the underlying data-structure
+		typedef Type value_type;
+
+		/// short-cut to built-in type of time measurement
+		typedef Timestamp timestamp_type;
+
+		/// the thread-safe measurement type with the same payload
+		typedef Measurement< Type > shared_type;
+
+	protected:
+
+		/// node shared by all copies of a handle
+		struct Node
+		{
+			explicit Node( const boost::shared_ptr< Type >& p )
+				: refs( 1 )
+				, payload( p )
+			{ }
+
+			/// number of handles referring to the node, only touched by the owning thread
+			std::size_t refs;
+
+			/// the payload, its atomic count only changes on conversions
+			boost::shared_ptr< Type > payload;
+		};
+
+		/// timestamp associated with the measurement
+		timestamp_type m_timestamp;
+
+		/// the shared node, 0 if the measurement has no payload
+		Node* m_node;
+
+		/// static const timestamp that defines an invalid timestamp
+		static const timestamp_type INVALID = 0;
+
+	public:
+
+		/** Default Constructor. The measurement is invalid and has no payload. */
+		LocalMeasurement()
+			: m_timestamp( INVALID )
+			, m_node( 0 )
+		{ }
+
+		/** Construct from timestamp, without payload. */
+		explicit LocalMeasurement( const timestamp_type t )
+			: m_timestamp( t )
+			, m_node( 0 )
+		{ }
+
+		/** Construct from timestamp and payload. */
+		LocalMeasurement( const timestamp_type t, const Type& m )
+			: m_timestamp( t )
+			, m_node( new Node( boost::make_shared< Type >( m ) ) )
+		{ }
+
+		/** Construct from timestamp and payload \c shared_ptr. */
+		LocalMeasurement( const timestamp_type t, const boost::shared_ptr< Type >& p )
+			: m_timestamp( t )
+			, m_node( p ? new Node( p ) : 0 )
+		{ }
+
+		/**
+		 * Construct from a thread-safe measurement, sharing its payload.
+		 * Call this on the thread that will own the new handle.
+		 */
+		explicit LocalMeasurement( const shared_type& m )
+			: m_timestamp( m.time() )
+			, m_node( m ? new Node( m ) : 0 )
+		{ }
+
+		/** Copy constructor, shares the payload */
+		LocalMeasurement( const LocalMeasurement& m )
+			: m_timestamp( m.m_timestamp )
+			, m_node( m.m_node )
+		{ acquire(); }
+
+		~LocalMeasurement()
+		{ release(); }
+
+		/** assignment, shares the payload */
+		LocalMeasurement& operator=( const LocalMeasurement& m )
+		{
+			Node* node = m.m_node;
+			if ( node )
+				++node->refs;
+			release();
+			m_node = node;
+			m_timestamp = m.m_timestamp;
+			return *this;
+		}
+
+		/**
+		 * returns a thread-safe measurement sharing the payload, which may be passed
+		 * to other threads
+		 */
+		shared_type shared() const
+		{ return shared_type( m_timestamp, m_node ? m_node->payload : boost::shared_ptr< Type >() ); }
+
+		/** creates a measurement with the same timestamp and a copy of the payload */
+		LocalMeasurement clone() const
+		{
+			if ( !m_node )
+				return LocalMeasurement( m_timestamp );
+			return LocalMeasurement( m_timestamp, *m_node->payload );
+		}
+
+		/**
+		 * set the internal timestamp
+		 */
+		void time( const timestamp_type t )
+		{ m_timestamp = t; }
+
+		/**
+		 * get the internal timestamp
+		 */
+		Timestamp time() const
+		{ return m_timestamp; }
+
+		/** pointer-like access to the payload */
+		Type& operator*() const
+		{ return *m_node->payload; }
+
+		/** pointer-like access to the payload */
+		Type* operator->() const
+		{ return m_node->payload.get(); }
+
+		/** pointer to the payload, 0 if there is none */
+		Type* get() const
+		{ return m_node ? m_node->payload.get() : 0; }
+
+		/** number of \c LocalMeasurement handles referring to the payload */
+		std::size_t use_count() const
+		{ return m_node ? m_node->refs : 0; }
+
+		/** true if this is the only handle and the payload was not handed out by \c shared */
+		bool unique() const
+		{ return m_node && m_node->refs == 1 && m_node->payload.unique(); }
+
+		/**
+		 * Copy-on-write access to the payload, see \c Measurement::writable.
+		 * The payload is copied if other handles or thread-safe measurements refer to it.
+		 */
+		Type& writable()
+		{
+			if ( m_node && !unique() )
+			{
+				Node* node = new Node( boost::make_shared< Type >( *m_node->payload ) );
+				release();
+				m_node = node;
+			}
+			return *m_node->payload;
+		}
+
+		/**
+		 * Checks, if measurement is valid
+		 */
+		bool invalid() const
+		{ return m_timestamp == INVALID; }
+
+		/**
+		 * Sets the current measurement as invalid
+		 */
+		void invalidate()
+		{ m_timestamp = INVALID; }
+
+	protected:
+
+		/** adds a reference to the current node */
+		void acquire()
+		{
+			if ( m_node )
+				++m_node->refs;
+		}
+
+		/** drops the reference to the current node, deleting it with the last one */
+		void release()
+		{
+			if ( m_node && --m_node->refs == 0 )
+				delete m_node;
+			m_node = 0;
+		}
+
+		// make ostream operator as friend
+		friend std::ostream& operator<< <> ( std::ostream& s, const LocalMeasurement< Type >& m );
+
+		// make  boost-serialization friend for data serialization
+		friend class ::boost::serialization::access;
+
+		/**
+		 * (un-)serialization helper function, same layout as \c Measurement
+		 */
+		template< class Archive >
+		void serialize( Archive& ar, const unsigned int version )
+		{
+			ar & m_timestamp;
+			if ( !m_node )
+				m_node = new Node( boost::make_shared< Type >() );
+			ar & *m_node->payload;
+		}
+};
+
+} } // namespace Ubitrack::Measurement
+
+#endif // _Ubitrack_Measurement_LocalMeasurement_INCLUDED_
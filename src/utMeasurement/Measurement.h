@@ -43,6 +43,10 @@
 #include <utMath/Scalar.h>
 #include <utMath/RotationVelocity.h>
 #include <utMath/CameraIntrinsics.h>
+#include <utUtil/AllocationTracker.h>
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+#include <utUtil/OS.h>
+#endif
 
 // std
 #include <vector>
@@ -50,6 +54,9 @@
 
 // Boost
 #include <boost/shared_ptr.hpp>
+#ifdef UBITRACK_TRACK_ALLOCATIONS
+#include <boost/make_shared.hpp>
+#endif
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/vector.hpp>
 
@@ -107,7 +114,9 @@ std::ostream& operator<< ( std::ostream& s, const Measurement< Type >& m )
     if ( m.invalid() ) {
         return s << "INVALID";
     } else {
-	    return s << *m << " " << timestampToShortString( m.m_timestamp );
+	    char buffer[ timestampStringSize ];
+	    timestampToShortString( m.m_timestamp, buffer );
+	    return s << *m << " " << buffer;
     }
 }
 
@@ -127,7 +136,14 @@ Measurement< X > b = a;
 *a = dataE; 
 @endverbatim
  * results in \c b being changed to \c dataE, too! Use \c Measurement::clone 
- * to copy data instead.
+ * to copy data instead, or \c Measurement::writable for copy-on-write access,
+ * which only copies if the payload is actually shared:
+@verbatim 
+Measurement< X > a( t, dataD ); 
+Measurement< X > b = a; 
+a.writable() = dataE; // copies, b keeps dataD
+a.writable() = dataF; // a is the only owner now, no copy
+@endverbatim
  *
  * @param Type data type of payload.
  */
@@ -148,6 +164,14 @@ class Measurement
 		/// timestamp associated with the measurement
 		timestamp_type m_timestamp;
 
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+		/// high performance counter when the measurement was created
+		long long m_created;
+
+		/// number of components the measurement passed, saturates at 255
+		unsigned char m_hops;
+#endif
+
         /// static const timestamp that defines an invalid timestamp
         static const timestamp_type INVALID = 0;
 	
@@ -159,36 +183,36 @@ class Measurement
 		 */
 		Measurement( )
             : m_timestamp ( INVALID )
-		{ }
+		{ resetLatency( 0 ); }
 
 		/** Construct from timestamp. The payload is empty. */
 		explicit Measurement( const timestamp_type t )
 			: m_timestamp( t )
-		{ }
+		{ resetLatency( currentLatencyCounter() ); }
 
 		/** Construct from payload \c shared_ptr, with timestamp of 0. */
 		explicit Measurement( boost::shared_ptr< Type > p )
 			: boost::shared_ptr< Type >( p )
 			, m_timestamp( 0 )
-		{ }
+		{ resetLatency( currentLatencyCounter() ); }
 		
 		/** Construct from payload reference (content will be copied), with timestamp of 0. */
 		explicit Measurement( const Type& m )
-			: boost::shared_ptr< Type>( new Type( m ) )
+			: boost::shared_ptr< Type>( newPayload( m ) )
 			, m_timestamp( 0 )
-		{ }
+		{ resetLatency( currentLatencyCounter() ); }
 
 		/** Construct from timestamp and payload \c shared_ptr. */
 		Measurement( const timestamp_type t, boost::shared_ptr< Type > p )
 			: boost::shared_ptr< Type>( p )
 			, m_timestamp( t )
-		{ }
+		{ resetLatency( currentLatencyCounter() ); }
 
 		/** Construct from timestamp and payload reference (content will be copied). */
 		Measurement( const timestamp_type t, const Type& m )
-			: boost::shared_ptr< Type>( new Type( m ) )
+			: boost::shared_ptr< Type>( newPayload( m ) )
 			, m_timestamp( t )
-		{ }
+		{ resetLatency( currentLatencyCounter() ); }
 
 		/**
 		 * set the internal timestamp
@@ -207,12 +231,29 @@ class Measurement
 		 */
 		Measurement clone() const
 		{
-			if ( this->get() != 0 )
-				return Measurement( m_timestamp, *(this->get()) ); 
-			else
-				return Measurement( m_timestamp );
+			Measurement m( this->get() != 0 ? Measurement( m_timestamp, *(this->get()) ) : Measurement( m_timestamp ) );
+			m.copyLatency( *this );
+			return m;
         }
 
+		/**
+		 * Copy-on-write access to the payload.
+		 *
+		 * Returns a reference to a payload that no other measurement refers to. The payload is
+		 * copied first if it is shared (<tt>use_count() > 1</tt>), otherwise it is returned as is,
+		 * so code that may modify a measurement does not need a defensive \c clone. Read-only
+		 * access through \c operator* or \c get never copies.
+		 *
+		 * Other threads must not copy this measurement object during the call, copies that were
+		 * made before are safe to use concurrently.
+		 */
+		Type& writable()
+		{
+			if ( this->get() != 0 && !this->unique() )
+				boost::shared_ptr< Type >::operator=( newPayload( *this->get() ) );
+			return *this->get();
+		}
+
         /**
          * Checks, if measurement is valid
          */
@@ -231,10 +272,114 @@ class Measurement
 
         template< typename Type2 >
         Measurement< Type2 > constCast() {
-            return Measurement< Type2 > ( m_timestamp, boost::const_pointer_cast< Type2 >( *this ) );
+            Measurement< Type2 > m( m_timestamp, boost::const_pointer_cast< Type2 >( *this ) );
+            m.copyLatency( *this );
+            return m;
         }
 
+		/**
+		 * Returns the high performance counter (see \c Util::getHighPerformanceCounter) at the creation
+		 * of the measurement, or 0 if it was not recorded. Only recorded if the library and its users are
+		 * built with \c UBITRACK_MEASUREMENT_LATENCY, so the time a measurement spends between its creation
+		 * and its consumption can be measured without an external tracer, see \c LatencyRecorder.
+		 * Copies keep the creation time, and so do measurements computed from others if the component
+		 * calls \c derivedFrom.
+		 */
+		long long created() const
+		{
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+			return m_created;
+#else
+			return 0;
+#endif
+		}
+
+		/** number of components the measurement passed, see \c addHop, 0 without \c UBITRACK_MEASUREMENT_LATENCY */
+		unsigned hops() const
+		{
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+			return m_hops;
+#else
+			return 0;
+#endif
+		}
+
+		/** counts a component the measurement passed, e.g. a queue or a filter that forwards it */
+		void addHop()
+		{
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+			if ( m_hops < 255 )
+				m_hops++;
+#endif
+		}
+
+		/**
+		 * Marks this measurement as computed from \c source: takes over its creation time and counts one
+		 * hop more, so the latency covers the whole pipeline and not only the last component.
+		 */
+		template< typename Type2 >
+		void derivedFrom( const Measurement< Type2 >& source )
+		{
+			copyLatency( source );
+			addHop();
+		}
+
+		/** true if the creation time and hops of measurements are recorded */
+		static bool latencyEnabled()
+		{
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+			return true;
+#else
+			return false;
+#endif
+		}
+
 	protected:
+
+		template< typename > friend class Measurement;
+
+		/// @internal the current high performance counter, if latencies are recorded
+		static long long currentLatencyCounter()
+		{
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+			return Util::getHighPerformanceCounter();
+#else
+			return 0;
+#endif
+		}
+
+		/// @internal sets the creation time and clears the hops
+		void resetLatency( long long created )
+		{
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+			m_created = created;
+			m_hops = 0;
+#else
+			( void )created;
+#endif
+		}
+
+		/// @internal copies creation time and hops from another measurement
+		template< typename Type2 >
+		void copyLatency( const Measurement< Type2 >& other )
+		{
+#ifdef UBITRACK_MEASUREMENT_LATENCY
+			m_created = other.m_created;
+			m_hops = other.m_hops;
+#else
+			( void )other;
+#endif
+		}
+
+		/** copies a payload, counted by the \c Util::AllocationTracker if tracking is enabled */
+		static boost::shared_ptr< Type > newPayload( const Type& m )
+		{
+#ifdef UBITRACK_TRACK_ALLOCATIONS
+			return boost::allocate_shared< Type >( Util::TrackingAllocator< Type, Util::AllocationTracker::MeasurementPayload >(), m );
+#else
+			return boost::shared_ptr< Type >( new Type( m ) );
+#endif
+		}
 	
 		// make ostream operator as friend
 		friend std::ostream& operator<< <> ( std::ostream& s, const Measurement< Type >& m );
@@ -0,0 +1,90 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup datastructures
+ * @file
+ * Pooled allocation of measurement payloads
+ *
+ * The constructors of \c Measurement that copy a payload allocate the payload and the
+ * reference count of the \c shared_ptr separately on the heap. For high-rate streams
+ * (e.g. inertial sensors at 1 kHz) use \c makePooled instead, which allocates both in a
+ * single block taken from a thread-safe pool. Released blocks go back to the pool and
+ * are reused by the next measurement of the same type:
+ * @code
+ * Measurement::Rotation m( Measurement::makePooled( t, Math::Quaternion( x, y, z, w ) ) );
+ * @endcode
+ *
+ * The resulting measurement behaves exactly like one created with <tt>new</tt>, only
+ * \c Measurement::clone still allocates from the heap.
+ */
+
+
+#ifndef _Ubitrack_Measurement_MeasurementPool_INCLUDED_
+#define _Ubitrack_Measurement_MeasurementPool_INCLUDED_
+
+#include "Measurement.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/pool/pool_alloc.hpp>
+
+namespace Ubitrack { namespace Measurement {
+
+/**
+ * allocator used for the pooled payloads of type \c Type.
+ *
+ * \c boost::allocate_shared rebinds the allocator to its combined control block and
+ * payload type, so each payload type gets an own singleton pool (shared only with types
+ * of the same block size) that is protected by a mutex. The pool grows in steps of
+ * \c NextSize blocks and never returns memory to the system.
+ */
+template< typename Type >
+struct PoolAllocator
+{
+	/// number of blocks the pool allocates when it runs empty for the first time
+	static const unsigned NextSize = 64;
+
+	typedef boost::fast_pool_allocator< Type, boost::default_user_allocator_new_delete,
+		boost::details::pool::default_mutex, NextSize > type;
+};
+
+
+/** creates a measurement with timestamp \c t and a pooled copy of the payload \c m */
+template< typename Type >
+Measurement< Type > makePooled( const Timestamp t, const Type& m )
+{
+	return Measurement< Type >( t, boost::allocate_shared< Type >( typename PoolAllocator< Type >::type(), m ) );
+}
+
+
+/** creates a measurement with timestamp \c t and a default constructed pooled payload */
+template< typename Type >
+Measurement< Type > makePooled( const Timestamp t )
+{
+	return Measurement< Type >( t, boost::allocate_shared< Type >( typename PoolAllocator< Type >::type() ) );
+}
+
+} } // namespace Ubitrack::Measurement
+
+#endif // _Ubitrack_Measurement_MeasurementPool_INCLUDED_
@@ -0,0 +1,347 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup datastructures
+ * @file
+ * Ring buffer of the recent measurements of a stream with interpolated lookup by timestamp
+ */
+
+
+#ifndef _Ubitrack_Measurement_MeasurementRingBuffer_INCLUDED_
+#define _Ubitrack_Measurement_MeasurementRingBuffer_INCLUDED_
+
+#include "Measurement.h"
+
+#include <utUtil/Exception.h>
+
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+
+namespace Ubitrack { namespace Measurement {
+
+/**
+ * @ingroup datastructures
+ * Interpolation of payloads for \c MeasurementRingBuffer::sampleAt.
+ *
+ * The default uses the \c Math::linearInterpolate overload of the payload, which is
+ * \c slerp for \c Math::Quaternion. Specialize it for other payloads.
+ */
+template< typename Type >
+struct MeasurementInterpolation
+{
+	static Type interpolate( const Type& a, const Type& b, const double t )
+	{ return Math::linearInterpolate( a, b, t ); }
+};
+
+/** scalars are interpolated linearly */
+template< typename Builtin >
+struct MeasurementInterpolation< Math::Scalar< Builtin > >
+{
+	static Math::Scalar< Builtin > interpolate( const Math::Scalar< Builtin >& a, const Math::Scalar< Builtin >& b, const double t )
+	{ return Math::Scalar< Builtin >( static_cast< Builtin >( ( 1 - t ) * a.m_value + t * b.m_value ) ); }
+};
+
+
+/**
+ * @ingroup datastructures
+ * Keeps the last measurements of a stream in a preallocated ring buffer and looks them up by time,
+ * e.g. to align a stream to the timestamps of another one.
+ *
+ * Timestamps and payloads are stored by value in one contiguous array of fixed capacity, the
+ * oldest measurement is overwritten when the buffer is full. Lookups are binary searches over the
+ * timestamps, which must not decrease from one \c push to the next.
+ *
+ * One thread pushes measurements, any number of threads look them up at the same time without
+ * locks: every slot is guarded by a sequence number like \c Util::SeqLock, and a lookup that
+ * read a slot which was overwritten meanwhile starts again. Lookups are only cheap as long as the
+ * capacity covers the time the readers lag behind. As with \c Util::SeqLock, the payload must be
+ * copyable without allocations, e.g. poses, rotations and fixed-size vectors, but no lists.
+ *
+ * The slots are initialized by the constructor, so on NUMA machines the buffer is allocated on the
+ * node of the constructing thread. Construct it on the thread that pushes, or \c place it there.
+ *
+ * @code
+ * Measurement::MeasurementRingBuffer< Math::Pose > poses( 256 );
+ * poses.push( pose );                        // tracker thread
+ * Measurement::Pose p( poses.sampleAt( t ) ); // any thread, invalid if t is not covered
+ * @endcode
+ *
+ * @param Type data type of payload.
+ */
+template< typename Type >
+class MeasurementRingBuffer
+{
+public:
+	/// short-cut that defines the contentype of the underlying data-structure
+	typedef Type value_type;
+
+	/** creates an empty buffer for \c capacity measurements */
+	explicit MeasurementRingBuffer( const std::size_t capacity )
+		: m_capacity( capacity )
+		, m_slots( new Slot[ capacity ] )
+		, m_written( 0 )
+		, m_first( 0 )
+		, m_lastTime( 0 )
+	{
+		if ( capacity == 0 )
+			UBITRACK_THROW( "Ring buffer needs a capacity of at least one measurement" );
+	}
+
+	/**
+	 * moves the slots to memory allocated and first touched by the calling thread, i.e. on its
+	 * NUMA node. Removes all measurements and must only be called by the thread that pushes,
+	 * while no other thread looks up measurements.
+	 */
+	void place()
+	{
+		boost::scoped_array< Slot > slots( new Slot[ m_capacity ] );
+		m_slots.swap( slots );
+		m_written.store( 0, boost::memory_order_relaxed );
+		m_first.store( 0, boost::memory_order_release );
+		m_lastTime = 0;
+	}
+
+	/** maximum number of measurements */
+	std::size_t capacity() const
+	{ return m_capacity; }
+
+	/** current number of measurements */
+	std::size_t size() const
+	{
+		unsigned long long head, first;
+		range( head, first );
+		return static_cast< std::size_t >( head - first );
+	}
+
+	/** returns if the buffer contains no measurements */
+	bool empty() const
+	{ return size() == 0; }
+
+	/**
+	 * appends a measurement, overwriting the oldest one if the buffer is full.
+	 * Must only be called by one thread at a time.
+	 */
+	void push( const Timestamp t, const Type& value )
+	{
+		if ( t < m_lastTime )
+			UBITRACK_THROW( "Measurements must be pushed in the order of their timestamps" );
+		m_lastTime = t;
+
+		const unsigned long long index = m_written.load( boost::memory_order_relaxed );
+		Slot& slot( m_slots[ index % m_capacity ] );
+		slot.sequence.store( 2 * index + 1, boost::memory_order_relaxed );
+		boost::atomic_thread_fence( boost::memory_order_release );
+		slot.time = t;
+		slot.value = value;
+		slot.sequence.store( 2 * index + 2, boost::memory_order_release );
+		m_written.store( index + 1, boost::memory_order_release );
+	}
+
+	/** appends a measurement, see above */
+	void push( const Measurement< Type >& m )
+	{ push( m.time(), *m ); }
+
+	/** removes all measurements, must only be called by the thread that pushes */
+	void clear()
+	{
+		m_first.store( m_written.load( boost::memory_order_relaxed ), boost::memory_order_release );
+		m_lastTime = 0;
+	}
+
+	/**
+	 * interpolates the measurements before and after a point in time.
+	 * @param t the point in time, must lie between the oldest and the newest measurement
+	 * @param value receives the interpolated payload
+	 * @return false if \c t is not covered by the buffer
+	 */
+	bool sampleAt( const Timestamp t, Type& value ) const
+	{
+		while ( true )
+		{
+			unsigned long long head, first;
+			range( head, first );
+			unsigned long long next;
+			if ( !lowerBound( t, head, first, next ) )
+				continue;
+			if ( next == head )
+				return false;
+
+			Timestamp tNext;
+			if ( !read( next, tNext, &value ) )
+				continue;
+			if ( tNext == t )
+				return true;
+			if ( next == first )
+				return false;
+
+			Timestamp tPrevious;
+			Type previous;
+			if ( !read( next - 1, tPrevious, &previous ) )
+				continue;
+			const double f = static_cast< double >( t - tPrevious ) / static_cast< double >( tNext - tPrevious );
+			value = MeasurementInterpolation< Type >::interpolate( previous, value, f );
+			return true;
+		}
+	}
+
+	/** interpolates the measurements at \c t as above, the result is invalid if \c t is not covered */
+	Measurement< Type > sampleAt( const Timestamp t ) const
+	{
+		Type value;
+		if ( !sampleAt( t, value ) )
+			return Measurement< Type >();
+		return Measurement< Type >( t, value );
+	}
+
+	/**
+	 * finds the measurement closest in time, without interpolation
+	 * @param t the point in time
+	 * @param found receives the timestamp of the measurement
+	 * @param value receives the payload of the measurement
+	 * @return false if the buffer is empty
+	 */
+	bool nearest( const Timestamp t, Timestamp& found, Type& value ) const
+	{
+		while ( true )
+		{
+			unsigned long long head, first;
+			range( head, first );
+			if ( head == first )
+				return false;
+			unsigned long long next;
+			if ( !lowerBound( t, head, first, next ) )
+				continue;
+
+			// the closer of the neighbours around t
+			unsigned long long index = next == head ? head - 1 : next;
+			if ( next != head && next != first )
+			{
+				Timestamp tNext, tPrevious;
+				if ( !read( next, tNext, 0 ) || !read( next - 1, tPrevious, 0 ) )
+					continue;
+				if ( t - tPrevious < tNext - t )
+					index = next - 1;
+			}
+			if ( read( index, found, &value ) )
+				return true;
+		}
+	}
+
+	/** returns the newest measurement, invalid if the buffer is empty */
+	Measurement< Type > latest() const
+	{
+		while ( true )
+		{
+			unsigned long long head, first;
+			range( head, first );
+			if ( head == first )
+				return Measurement< Type >();
+			Timestamp t;
+			Type value;
+			if ( read( head - 1, t, &value ) )
+				return Measurement< Type >( t, value );
+		}
+	}
+
+protected:
+	/** a measurement with its sequence number, which is 2 ( index + 1 ) when it holds measurement \c index and odd while it is written */
+	struct Slot
+	{
+		Slot()
+			: sequence( 0 )
+			, time( 0 )
+			, value()
+		{}
+
+		boost::atomic< unsigned long long > sequence;
+		Timestamp time;
+		Type value;
+	};
+
+	/** indices [ first, head ) of the measurements that are currently available */
+	void range( unsigned long long& head, unsigned long long& first ) const
+	{
+		// first is loaded before head, as a concurrent clear may move it up to the current head
+		first = m_first.load( boost::memory_order_acquire );
+		head = m_written.load( boost::memory_order_acquire );
+		if ( head - first > m_capacity )
+			first = head - m_capacity;
+	}
+
+	/** reads measurement \c index, returns false if it was overwritten */
+	bool read( const unsigned long long index, Timestamp& t, Type* pValue ) const
+	{
+		const Slot& slot( m_slots[ index % m_capacity ] );
+		const unsigned long long expected = 2 * index + 2;
+		if ( slot.sequence.load( boost::memory_order_acquire ) != expected )
+			return false;
+		t = slot.time;
+		if ( pValue )
+			*pValue = slot.value;
+		boost::atomic_thread_fence( boost::memory_order_acquire );
+		return slot.sequence.load( boost::memory_order_relaxed ) == expected;
+	}
+
+	/** finds the first measurement in [ first, head ) not older than \c t, returns false if one was overwritten */
+	bool lowerBound( const Timestamp t, const unsigned long long head, unsigned long long first, unsigned long long& result ) const
+	{
+		unsigned long long last = head;
+		while ( first < last )
+		{
+			const unsigned long long mid = first + ( last - first ) / 2;
+			Timestamp tMid;
+			if ( !read( mid, tMid, 0 ) )
+				return false;
+			if ( tMid < t )
+				first = mid + 1;
+			else
+				last = mid;
+		}
+		result = first;
+		return true;
+	}
+
+	/** number of slots */
+	const std::size_t m_capacity;
+
+	/** the slots, measurement \c index is stored at index % capacity */
+	boost::scoped_array< Slot > m_slots;
+
+	/** number of measurements pushed so far and the index of the first one after the last \c clear */
+	boost::atomic< unsigned long long > m_written;
+	boost::atomic< unsigned long long > m_first;
+
+	/** timestamp of the last measurement, only used by the thread that pushes */
+	Timestamp m_lastTime;
+
+private:
+	// not copyable
+	MeasurementRingBuffer( const MeasurementRingBuffer& );
+	MeasurementRingBuffer& operator=( const MeasurementRingBuffer& );
+};
+
+} } // namespace Ubitrack::Measurement
+
+#endif // _Ubitrack_Measurement_MeasurementRingBuffer_INCLUDED_
@@ -0,0 +1,313 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup datastructures
+ * @file
+ * Joins several measurement streams into tuples of synchronized measurements
+ */
+
+
+#ifndef _Ubitrack_Measurement_StreamSynchronizer_INCLUDED_
+#define _Ubitrack_Measurement_StreamSynchronizer_INCLUDED_
+
+#include "Measurement.h"
+#include "MeasurementRingBuffer.h"	// MeasurementInterpolation
+
+#include <utUtil/Exception.h>
+
+#include <boost/tuple/tuple.hpp>
+#include <boost/circular_buffer.hpp>
+
+namespace Ubitrack { namespace Measurement {
+
+namespace Detail {
+
+/** result of sampling a stream at a reference time */
+enum SyncStatus { syncOk = 0, syncWait = 1, syncDrop = 2 };
+
+/** the pending measurements of one input of a \c StreamSynchronizer */
+template< typename Type >
+class SyncQueue
+{
+public:
+	typedef std::pair< Timestamp, Type > entry_type;
+
+	void setCapacity( const std::size_t capacity )
+	{ m_entries.set_capacity( capacity ); }
+
+	/** appends a measurement, the oldest one is dropped if the queue is full */
+	void push( const Timestamp t, const Type& value )
+	{
+		if ( !m_entries.empty() && t < m_entries.back().first )
+			UBITRACK_THROW( "Measurements must be pushed in the order of their timestamps" );
+		m_entries.push_back( entry_type( t, value ) );
+	}
+
+	/**
+	 * samples the stream at a reference time, which must not decrease from call to call.
+	 * Measurements that are older than needed for \c t are dropped.
+	 */
+	SyncStatus sample( const Timestamp t, Type& value, const bool bInterpolate, const Timestamp tolerance )
+	{
+		while ( m_entries.size() >= 2 && m_entries[ 1 ].first <= t )
+			m_entries.pop_front();
+
+		// a later measurement may still be closer
+		if ( m_entries.empty() || m_entries.back().first < t )
+			return syncWait;
+
+		const entry_type& a( m_entries.front() );
+		if ( a.first >= t )
+		{
+			// only measurements at or after t
+			if ( a.first - t > tolerance || ( bInterpolate && a.first != t ) )
+				return syncDrop;
+			value = a.second;
+			return syncOk;
+		}
+
+		// a before t, b after it
+		const entry_type& b( m_entries[ 1 ] );
+		if ( bInterpolate )
+		{
+			if ( t - a.first > tolerance || b.first - t > tolerance )
+				return syncDrop;
+			value = MeasurementInterpolation< Type >::interpolate( a.second, b.second,
+				static_cast< double >( t - a.first ) / static_cast< double >( b.first - a.first ) );
+		}
+		else
+		{
+			const entry_type& closer( t - a.first <= b.first - t ? a : b );
+			if ( ( closer.first > t ? closer.first - t : t - closer.first ) > tolerance )
+				return syncDrop;
+			value = closer.second;
+		}
+		return syncOk;
+	}
+
+	bool empty() const
+	{ return m_entries.empty(); }
+
+	const entry_type& front() const
+	{ return m_entries.front(); }
+
+	void popFront()
+	{ m_entries.pop_front(); }
+
+	void clear()
+	{ m_entries.clear(); }
+
+protected:
+	boost::circular_buffer< entry_type > m_entries;
+};
+
+/** maps a tuple of payload types to a tuple of queues */
+template< typename Types >
+struct SyncQueues;
+
+template<>
+struct SyncQueues< boost::tuples::null_type >
+{
+	typedef boost::tuples::null_type type;
+};
+
+template< typename Head, typename Tail >
+struct SyncQueues< boost::tuples::cons< Head, Tail > >
+{
+	typedef boost::tuples::cons< SyncQueue< Head >, typename SyncQueues< Tail >::type > type;
+};
+
+/** @internal operations on all queues of a tuple */
+inline void setSyncCapacity( const boost::tuples::null_type&, std::size_t )
+{}
+
+template< typename Head, typename Tail >
+void setSyncCapacity( boost::tuples::cons< Head, Tail >& queues, const std::size_t capacity )
+{
+	queues.get_head().setCapacity( capacity );
+	setSyncCapacity( queues.get_tail(), capacity );
+}
+
+inline void clearSync( const boost::tuples::null_type& )
+{}
+
+template< typename Head, typename Tail >
+void clearSync( boost::tuples::cons< Head, Tail >& queues )
+{
+	queues.get_head().clear();
+	clearSync( queues.get_tail() );
+}
+
+inline SyncStatus sampleSync( const boost::tuples::null_type&, const boost::tuples::null_type&, Timestamp, bool, Timestamp )
+{ return syncOk; }
+
+/** samples all queues, one that must drop the reference time decides over ones that wait */
+template< typename QueueHead, typename QueueTail, typename ValueHead, typename ValueTail >
+SyncStatus sampleSync( boost::tuples::cons< QueueHead, QueueTail >& queues, boost::tuples::cons< ValueHead, ValueTail >& values,
+	const Timestamp t, const bool bInterpolate, const Timestamp tolerance )
+{
+	const SyncStatus head = queues.get_head().sample( t, values.get_head(), bInterpolate, tolerance );
+	if ( head == syncDrop )
+		return syncDrop;
+	const SyncStatus tail = sampleSync( queues.get_tail(), values.get_tail(), t, bInterpolate, tolerance );
+	return head > tail ? head : tail;
+}
+
+} // namespace Detail
+
+
+/**
+ * @ingroup datastructures
+ * Joins up to five measurement streams into tuples of measurements at common timestamps, e.g.
+ * poses of an optical tracker with the rotation velocities of an IMU.
+ *
+ * The first stream is the reference: a tuple is formed for every reference measurement as soon
+ * as all other streams have a measurement at or after its timestamp. The other streams are
+ * sampled at the reference timestamp either by the nearest measurement or by interpolating the
+ * measurements before and after it, see \c MeasurementInterpolation. Only measurements within
+ * \c tolerance of the reference timestamp are used, otherwise the reference measurement is dropped.
+ *
+ * Measurements that are older than the ones needed for the current reference timestamp are
+ * dropped. A reference measurement is also dropped if a stream has not covered it after the
+ * newest measurement of any stream is \c maxDelay younger, e.g. because a sensor stopped sending.
+ * Each stream keeps at most \c capacity measurements in a preallocated queue, so pushing and
+ * joining take amortized constant time per measurement and allocate no memory.
+ *
+ * The payloads must support \c MeasurementInterpolation in both modes. The synchronizer is not
+ * thread-safe, as the streams usually arrive in one thread.
+ *
+ * @code
+ * Measurement::StreamSynchronizer< Math::Pose, Math::RotationVelocity > sync(
+ *     Measurement::StreamSynchronizer< Math::Pose, Math::RotationVelocity >::nearest, 5000000 );
+ * sync.push< 0 >( pose );
+ * sync.push< 1 >( velocity );
+ * Measurement::Timestamp t;
+ * boost::tuple< Math::Pose, Math::RotationVelocity > tuple;
+ * while ( sync.pop( t, tuple ) )
+ *     ...
+ * @endcode
+ */
+template< typename T0, typename T1,
+	typename T2 = boost::tuples::null_type, typename T3 = boost::tuples::null_type, typename T4 = boost::tuples::null_type >
+class StreamSynchronizer
+{
+public:
+	/** the payloads of a tuple */
+	typedef boost::tuple< T0, T1, T2, T3, T4 > value_type;
+
+	/** how streams are sampled at the reference timestamps */
+	enum Mode { nearest, interpolate };
+
+	/**
+	 * creates a synchronizer without measurements
+	 * @param mode how streams are sampled at the reference timestamps
+	 * @param tolerance maximum time between the reference timestamp and the measurements used
+	 * @param maxDelay time after which a reference measurement that is not covered by all streams is dropped
+	 * @param capacity maximum number of pending measurements per stream
+	 */
+	StreamSynchronizer( const Mode mode, const Timestamp tolerance, const Timestamp maxDelay = 1000000000ULL, const std::size_t capacity = 64 )
+		: m_mode( mode )
+		, m_tolerance( tolerance )
+		, m_maxDelay( maxDelay )
+		, m_newest( 0 )
+		, m_dropped( 0 )
+	{
+		if ( capacity == 0 )
+			UBITRACK_THROW( "Stream synchronizer needs a capacity of at least one measurement" );
+		Detail::setSyncCapacity( m_queues, capacity );
+	}
+
+	/** adds a measurement to stream \c I, timestamps of a stream must not decrease */
+	template< int I >
+	void push( const Timestamp t, const typename boost::tuples::element< I, value_type >::type& value )
+	{
+		boost::tuples::get< I >( m_queues ).push( t, value );
+		m_newest = std::max( m_newest, t );
+	}
+
+	/** adds a measurement to stream \c I */
+	template< int I >
+	void push( const Measurement< typename boost::tuples::element< I, value_type >::type >& m )
+	{ push< I >( m.time(), *m ); }
+
+	/**
+	 * returns the next synchronized tuple
+	 * @param t receives the timestamp of the reference measurement
+	 * @param values receives the payloads of all streams
+	 * @return false if no tuple is complete yet
+	 */
+	bool pop( Timestamp& t, value_type& values )
+	{
+		Detail::SyncQueue< T0 >& reference( m_queues.get_head() );
+		while ( !reference.empty() )
+		{
+			const Timestamp tReference = reference.front().first;
+			const Detail::SyncStatus status = Detail::sampleSync( m_queues.get_tail(), values.get_tail(), tReference,
+				m_mode == interpolate, m_tolerance );
+			if ( status == Detail::syncOk )
+			{
+				t = tReference;
+				values.get_head() = reference.front().second;
+				reference.popFront();
+				return true;
+			}
+			if ( status == Detail::syncWait && m_newest - tReference <= m_maxDelay )
+				return false;
+
+			reference.popFront();
+			m_dropped++;
+		}
+		return false;
+	}
+
+	/** removes all pending measurements */
+	void clear()
+	{
+		Detail::clearSync( m_queues );
+		m_newest = 0;
+	}
+
+	/** number of reference measurements that were dropped without forming a tuple */
+	std::size_t droppedCount() const
+	{ return m_dropped; }
+
+protected:
+	/** sampling parameters */
+	Mode m_mode;
+	Timestamp m_tolerance;
+	Timestamp m_maxDelay;
+
+	/** the pending measurements of every stream, the reference first */
+	typename Detail::SyncQueues< typename value_type::inherited >::type m_queues;
+
+	/** newest timestamp of any stream */
+	Timestamp m_newest;
+
+	std::size_t m_dropped;
+};
+
+} } // namespace Ubitrack::Measurement
+
+#endif // _Ubitrack_Measurement_StreamSynchronizer_INCLUDED_
@@ -23,29 +23,148 @@
 
 #include "Timestamp.h"
 
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/mutex.hpp>
+
 #ifdef _MSC_VER
 
 	#include <sys/timeb.h>
 	#include <time.h>
 
 	#include <utUtil/OS.h>
+	#include <utUtil/CleanWindows.h>
 	#include "TimestampSync.h"
 
-	#include <log4cpp/Category.hh>
-	static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Measurement.Timestamp" ) );
+	#include <utUtil/LazyLogger.h>
+	static Ubitrack::Util::LazyLogger logger( "Ubitrack.Measurement.Timestamp" );
 
 #else
     #include <stdio.h>
 
 	#include <sys/time.h>
+	#include <time.h>
 
 #endif
 
 namespace Ubitrack { namespace Measurement {
 
+namespace {
+
+/// the selected ClockSource, initialized from UBITRACK_CLOCK on first use
+boost::atomic< int > g_clockSource( clockRealtime );
+boost::once_flag g_clockInit = BOOST_ONCE_INIT;
+
+/// offset of the monotonic clock to the real time in ns, written only by calibrateMonotonicClock
+boost::atomic< long long > g_monotonicOffset( 0 );
+
+#ifdef _MSC_VER
+
+/// the synchronization of the performance counter is not thread-safe
+boost::mutex g_syncMutex;
+
+/// the real time clock, 10ms resolution
+Timestamp realtimeClock()
+{
+	struct _timeb wintime;
+	#if _MSC_VER < 1400
+		_ftime( &wintime );
+	#else
+		_ftime_s( &wintime );
+	#endif
+	return Timestamp( wintime.time ) * 1000000000 + Timestamp( wintime.millitm ) * 1000000;
+}
+
+/// the performance counter in ns
+Timestamp monotonicClock()
+{
+	static const long long freq = static_cast< long long >( Util::getHighPerformanceFrequency() );
+	const long long ticks = Util::getHighPerformanceCounter();
+	// split to avoid an overflow of ticks * 1e9
+	return Timestamp( ticks / freq ) * 1000000000 + Timestamp( ( ticks % freq ) * 1000000000 / freq );
+}
+
+#else
+
+Timestamp readClock( clockid_t clock )
+{
+	struct timespec ts;
+	clock_gettime( clock, &ts );
+	return ((Timestamp)(ts.tv_sec)) * 1000000000 + ((Timestamp)(ts.tv_nsec));
+}
+
+/// the real time clock, read through the vDSO on Linux, so usually without a syscall
+Timestamp realtimeClock()
+{
+	return readClock( CLOCK_REALTIME );
+}
+
+/// the raw hardware clock without NTP slewing, if available
+Timestamp monotonicClock()
+{
+#ifdef CLOCK_MONOTONIC_RAW
+	return readClock( CLOCK_MONOTONIC_RAW );
+#else
+	return readClock( CLOCK_MONOTONIC );
+#endif
+}
+
+#endif
+
+void initClock()
+{
+	calibrateMonotonicClock();
+	const char* source = std::getenv( "UBITRACK_CLOCK" );
+	if ( source && std::strcmp( source, "monotonic" ) == 0 )
+		g_clockSource.store( clockMonotonic );
+}
+
+} // anonymous namespace
+
+
+void calibrateMonotonicClock()
+{
+	// take the real time reading with the shortest bracket of monotonic readings
+	long long bestOffset = 0;
+	Timestamp bestBracket = ~Timestamp( 0 );
+	for ( int i = 0; i < 5; i++ )
+	{
+		const Timestamp before = monotonicClock();
+		const Timestamp rtc = realtimeClock();
+		const Timestamp after = monotonicClock();
+		if ( after - before < bestBracket )
+		{
+			bestBracket = after - before;
+			bestOffset = static_cast< long long >( rtc - ( before + ( after - before ) / 2 ) );
+		}
+	}
+	g_monotonicOffset.store( bestOffset );
+}
+
+
+void setClockSource( ClockSource source )
+{
+	boost::call_once( g_clockInit, &initClock );
+	g_clockSource.store( source );
+}
+
+
+ClockSource getClockSource()
+{
+	boost::call_once( g_clockInit, &initClock );
+	return static_cast< ClockSource >( g_clockSource.load() );
+}
+
 
 Timestamp now()
 {
+	boost::call_once( g_clockInit, &initClock );
+	if ( g_clockSource.load( boost::memory_order_relaxed ) == clockMonotonic )
+		return monotonicClock() + g_monotonicOffset.load( boost::memory_order_relaxed );
+
 #ifdef _MSC_VER
 
 	// Windows time has bad resolution (10ms), therefore we prefer to use the High Performance Counter 
@@ -55,15 +174,10 @@ Timestamp now()
 	long long hiPerf = Util::getHighPerformanceCounter();
 	
 	// read RTC
-	struct _timeb wintime;
-	#if _MSC_VER < 1400
-		_ftime( &wintime );
-	#else
-		_ftime_s( &wintime );
-	#endif
-	Timestamp rtc = Timestamp( wintime.time ) * 1000000000 + Timestamp( wintime.millitm ) * 1000000;
+	Timestamp rtc = realtimeClock();
 
 	// synchronization
+	boost::mutex::scoped_lock l( g_syncMutex );
 	static TimestampSync synchronizer( 1e9 );
 	static bool bUseHpc = true;
 	static double lastHpcFreq;
@@ -98,45 +212,53 @@ Timestamp now()
 #else
 
 	// Unix time
-	struct timeval tv;
-	gettimeofday( &tv, 0 );
-	return ((Timestamp)(tv.tv_sec)) * 1000000000 + ((Timestamp)(tv.tv_usec)) * 1000;
+	return realtimeClock();
 
 #endif	
 }
 
 
-std::string timestampToString( Timestamp t )
+Timestamp nowCoarse()
 {
-	std::string result;
-	time_t mytime = (time_t)(t/1000000000);
-	#if !defined( _MSC_VER ) || _MSC_VER >= 1400
-		char buffer[50]; // asctime requires at least 26 bytes
-		struct tm temp;
-	#endif
+#ifdef _MSC_VER
+	// file time: 100ns intervals since 1601
+	FILETIME ft;
+	GetSystemTimeAsFileTime( &ft );
+	const unsigned long long t = ( static_cast< unsigned long long >( ft.dwHighDateTime ) << 32 ) | ft.dwLowDateTime;
+	return ( t - 116444736000000000ULL ) * 100;
+#elif defined( CLOCK_REALTIME_COARSE )
+	return readClock( CLOCK_REALTIME_COARSE );
+#else
+	return realtimeClock();
+#endif
+}
 
-	#ifdef _MSC_VER
-		#if _MSC_VER >= 1400
-			gmtime_s( &temp, &mytime );
-			asctime_s( buffer, sizeof(buffer), &temp );
-			result = buffer;
-		#else
-			result = asctime( gmtime( &mytime ) );
-		#endif			
-	#else
-		gmtime_r( &mytime, &temp );
-		asctime_r( &temp, buffer );
-		result = buffer;
-	#endif
 
-	result.replace( result.length()-1, 4, " UTC" );
-	return result;
+namespace {
+
+/// writes \c n decimal digits of \c value with leading zeros and returns the end
+inline char* writeDigits( char* p, unsigned value, const int n )
+{
+	for ( int i = n - 1; i >= 0; i-- )
+	{
+		p[ i ] = static_cast< char >( '0' + value % 10 );
+		value /= 10;
+	}
+	return p + n;
 }
 
+/// hour, minute and second of the last second converted to local time, packed as ( second << 17 ) | ( h << 12 ) | ( m << 6 ) | s
+boost::atomic< unsigned long long > g_lastLocalSecond( ~0ULL );
 
-std::string timestampToShortString( Timestamp t )
+/// local time of day of a time in seconds since epoch, packed as above
+unsigned localTimeOfDay( const unsigned long long seconds )
 {
-	time_t mytime = (time_t)(t/1000000000);
+	// any thread may refresh the cache, as all of them store correct values
+	const unsigned long long cached = g_lastLocalSecond.load( boost::memory_order_relaxed );
+	if ( ( cached >> 17 ) == seconds )
+		return static_cast< unsigned >( cached & 0x1ffff );
+
+	time_t mytime = static_cast< time_t >( seconds );
 	struct tm temp;
 	struct tm* pTm = &temp;
 
@@ -150,9 +272,85 @@ std::string timestampToShortString( Timestamp t )
 		localtime_r( &mytime, &temp );
 	#endif
 
-	char buffer[ 32 ];
-	sprintf( buffer, "%02d:%02d:%02d.%06d", pTm->tm_hour, pTm->tm_min, pTm->tm_sec, int( ( t / 1000 ) % 1000000 ) );
-	return std::string( buffer );
+	const unsigned timeOfDay = ( pTm->tm_hour << 12 ) | ( pTm->tm_min << 6 ) | pTm->tm_sec;
+	g_lastLocalSecond.store( ( seconds << 17 ) | timeOfDay, boost::memory_order_relaxed );
+	return timeOfDay;
+}
+
+} // anonymous namespace
+
+
+std::size_t timestampToString( Timestamp t, char* buffer )
+{
+	static const char weekdays[] = "SunMonTueWedThuFriSat";
+	static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+	const unsigned long long seconds = t / 1000000000;
+	const unsigned long long days = seconds / 86400;
+	const unsigned secondOfDay = static_cast< unsigned >( seconds % 86400 );
+
+	// civil date of the day since epoch, in eras of 400 years starting at March 1st
+	const unsigned long long z = days + 719468;
+	const unsigned long long era = z / 146097;
+	const unsigned doe = static_cast< unsigned >( z - era * 146097 );
+	const unsigned yoe = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365;
+	const unsigned doy = doe - ( 365 * yoe + yoe / 4 - yoe / 100 );
+	const unsigned mp = ( 5 * doy + 2 ) / 153;
+	const unsigned day = doy - ( 153 * mp + 2 ) / 5 + 1;
+	const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+	const unsigned long long year = yoe + era * 400 + ( month <= 2 ? 1 : 0 );
+
+	// like asctime: "Fri Mar  2 11:41:41 2007"
+	char* p = buffer;
+	std::memcpy( p, weekdays + 3 * ( ( days + 4 ) % 7 ), 3 );
+	p[ 3 ] = ' ';
+	std::memcpy( p + 4, months + 3 * ( month - 1 ), 3 );
+	p[ 7 ] = ' ';
+	p[ 8 ] = day < 10 ? ' ' : static_cast< char >( '0' + day / 10 );
+	p[ 9 ] = static_cast< char >( '0' + day % 10 );
+	p[ 10 ] = ' ';
+	p = writeDigits( p + 11, secondOfDay / 3600, 2 );
+	*p++ = ':';
+	p = writeDigits( p, secondOfDay / 60 % 60, 2 );
+	*p++ = ':';
+	p = writeDigits( p, secondOfDay % 60, 2 );
+	*p++ = ' ';
+	int nYearDigits = 1;
+	for ( unsigned long long y = year; y >= 10; y /= 10 )
+		nYearDigits++;
+	p = writeDigits( p, static_cast< unsigned >( year ), nYearDigits );
+	std::memcpy( p, " UTC", 5 );
+	return p + 4 - buffer;
+}
+
+
+std::string timestampToString( Timestamp t )
+{
+	char buffer[ timestampStringSize ];
+	return std::string( buffer, timestampToString( t, buffer ) );
+}
+
+
+std::size_t timestampToShortString( Timestamp t, char* buffer )
+{
+	// "11:41:41.521021"
+	const unsigned timeOfDay = localTimeOfDay( t / 1000000000 );
+	char* p = writeDigits( buffer, timeOfDay >> 12, 2 );
+	*p++ = ':';
+	p = writeDigits( p, ( timeOfDay >> 6 ) & 0x3f, 2 );
+	*p++ = ':';
+	p = writeDigits( p, timeOfDay & 0x3f, 2 );
+	*p++ = '.';
+	p = writeDigits( p, static_cast< unsigned >( ( t / 1000 ) % 1000000 ), 6 );
+	*p = 0;
+	return p - buffer;
+}
+
+
+std::string timestampToShortString( Timestamp t )
+{
+	char buffer[ timestampStringSize ];
+	return std::string( buffer, timestampToShortString( t, buffer ) );
 }
 
 } } // namespace Ubitrack::Measurement
@@ -34,6 +34,7 @@
 #define _Ubitrack_Measurement_Timestamp_INCLUDED_
 
 #include <string>
+#include <cstddef>
 #include <utCore.h>
 
 namespace Ubitrack { namespace Measurement {
@@ -41,15 +42,67 @@ namespace Ubitrack { namespace Measurement {
 /// Timestamp: nanoseconds since epoch (UNIX birth)
 typedef unsigned long long int Timestamp;
 
+/**
+ * clocks that can be used by \c now().
+ *
+ * Both clocks return nanoseconds since epoch. The monotonic clock never jumps, but as the
+ * offset to the real time is only calibrated once, it does not follow adjustments of the
+ * system clock (e.g. by NTP) and may drift from it by a few ppm.
+ */
+enum ClockSource
+{
+	/// the real time clock of the operating system (default)
+	clockRealtime,
+
+	/// CLOCK_MONOTONIC_RAW resp. the performance counter, with a calibrated offset to the real time
+	clockMonotonic
+};
+
 /// retrieve the current system time as Timestamp
 UBITRACK_EXPORT Timestamp now();
 
+/**
+ * retrieve the current system time with a resolution of a few milliseconds.
+ * Cheaper than \c now() and meant for logging, not for measurements.
+ */
+UBITRACK_EXPORT Timestamp nowCoarse();
+
+/**
+ * selects the clock used by \c now() in all threads.
+ * The initial clock is \c clockRealtime, unless the environment variable \c UBITRACK_CLOCK
+ * is set to \c monotonic.
+ */
+UBITRACK_EXPORT void setClockSource( ClockSource source );
+
+/// the clock currently used by \c now()
+UBITRACK_EXPORT ClockSource getClockSource();
+
+/// recomputes the offset of the monotonic clock to the real time, e.g. after the system clock was set
+UBITRACK_EXPORT void calibrateMonotonicClock();
+
 /// convert a Timestamp to a string (returns something like "Fri Mar 02 11:41:41 2007 UTC")
 UBITRACK_EXPORT std::string timestampToString( Timestamp );
 
 /// convert a Timestamp to a shorter string (returns something like "11:41:41.521021")
 UBITRACK_EXPORT std::string timestampToShortString( Timestamp );
 
+/// size of the buffers for the following functions, including the terminating zero
+static const std::size_t timestampStringSize = 32;
+
+/**
+ * writes the same string as \c timestampToString( Timestamp ) into a buffer of \c timestampStringSize
+ * characters and returns its length. The date is computed with integer arithmetic, without
+ * \c gmtime and without allocations.
+ */
+UBITRACK_EXPORT std::size_t timestampToString( Timestamp, char* buffer );
+
+/**
+ * writes the same string as \c timestampToShortString( Timestamp ) into a buffer of \c timestampStringSize
+ * characters and returns its length. The local time of day is cached for the last second, so
+ * \c localtime is only called once per second, e.g. when logging many measurements.
+ */
+UBITRACK_EXPORT std::size_t timestampToShortString( Timestamp, char* buffer );
+
 } } // namespace Ubitrack::Measurement
 
 #endif // _Ubitrack_Measurement_Timestamp_INCLUDED_
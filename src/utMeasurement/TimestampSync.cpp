@@ -79,6 +79,27 @@ void TimestampSync::setFrequency( double approxNativeFreq, double approxLocalFre
 
 	
 Timestamp TimestampSync::convertNativeToLocal( double native, Timestamp local )
+{
+	boost::mutex::scoped_lock l( m_updateMutex );
+	return update( native, local );
+}
+
+
+void TimestampSync::convertNativeToLocal( const std::vector< double >& native, Timestamp local, std::vector< Timestamp >& result )
+{
+	result.resize( native.size() );
+	if ( native.empty() )
+		return;
+
+	boost::mutex::scoped_lock l( m_updateMutex );
+	update( native.back(), local );
+	const ClockModel model( m_model.load() );
+	for ( std::size_t i = 0; i < native.size(); i++ )
+		result[ i ] = model.toLocal( native[ i ] );
+}
+
+
+Timestamp TimestampSync::update( double native, Timestamp local )
 {
 	// initialization on first event;
 	if ( m_events == 0 )
@@ -131,6 +152,13 @@ Timestamp TimestampSync::convertNativeToLocal( double native, Timestamp local )
 	m_lastNative = native;
 	m_events++;
 
+	ClockModel model;
+	model.native = native;
+	model.local = m_estLocal;
+	model.gain = m_estGain;
+	model.events = m_events;
+	m_model.store( model );
+
 	return m_estLocal;
 }
 
@@ -32,11 +32,42 @@
 #ifndef _Ubitrack_Measurement_TimestampSync_INCLUDED_
 #define _Ubitrack_Measurement_TimestampSync_INCLUDED_
 
+#include <vector>
+
 #include <utCore.h>
 #include <utMeasurement/Timestamp.h>
+#include <utUtil/SeqLock.h>
+
+#include <boost/thread/mutex.hpp>
 
 namespace Ubitrack { namespace Measurement {
 
+/**
+ * The linear relation between a native clock and the local clock, as estimated by
+ * \c TimestampSync and \c TimestampSyncLS: the native time \c native corresponds to the
+ * local time \c local, and the local clock advances by \c gain per native unit.
+ */
+struct ClockModel
+{
+	ClockModel()
+		: native( 0.0 )
+		, local( 0 )
+		, gain( 0.0 )
+		, events( 0 )
+	{}
+
+	/** converts a native time to a local time */
+	Timestamp toLocal( const double n ) const
+	{ return local + static_cast< long long >( ( n - native ) * gain ); }
+
+	double native;
+	Timestamp local;
+	double gain;
+
+	/** number of timestamps the model is based on, 0 if there is no model yet */
+	unsigned events;
+};
+
 /**
  * Class that handles synchronization between two different clocks.
  *
@@ -44,6 +75,10 @@ namespace Ubitrack { namespace Measurement {
  * The sensors native clock is assumed to be precise whereas the local timestamp can have considerable
  * jitter when not using a real-time operating system. The shift and scaling between the clocks is
  * computed online using a kalman filter.
+ *
+ * The synchronization may be used by several threads: updates by \c convertNativeToLocal are
+ * serialized by a mutex, and the resulting \c ClockModel is published by a \c Util::SeqLock,
+ * so \c toLocal converts without locks and without changing the estimate.
  */
 class UBITRACK_EXPORT TimestampSync
 {
@@ -88,13 +123,54 @@ public:
 	 */
 	Timestamp convertNativeToLocal( double native, Timestamp local );
 
+	/**
+	 * Add a packet of sensor timestamps that arrived at the given system clock value, e.g. the
+	 * samples of one USB frame of an IMU.
+	 *
+	 * The estimate is updated once with the last timestamp of the packet, which corresponds to
+	 * the arrival time, and all timestamps are converted with the updated estimate.
+	 *
+	 * @param native native sensor clock values in increasing order
+	 * @param local system clock value at the arrival of the packet
+	 * @param result receives the sensor times converted to local times
+	 */
+	void convertNativeToLocal( const std::vector< double >& native, Timestamp local, std::vector< Timestamp >& result );
+
+	/**
+	 * Converts a sensor timestamp with the current estimate without updating it, lock-free.
+	 *
+	 * @param native native sensor clock value
+	 * @param local receives the sensor time converted to a local time
+	 * @return false if no timestamp was added yet
+	 */
+	bool toLocal( double native, Timestamp& local ) const
+	{
+		const ClockModel model( m_model.load() );
+		if ( model.events == 0 )
+			return false;
+		local = model.toLocal( native );
+		return true;
+	}
+
+	/** returns the current estimate of the clock relation */
+	ClockModel getClockModel() const
+	{ return m_model.load(); }
+
 	/**
 	 * returns the number of timestamps processed
 	 */
 	unsigned getEventCount() const
-	{ return m_events; }
+	{ return m_model.load().events; }
 	
 protected:
+	/** updates the estimate with a timestamp, the caller holds the update mutex */
+	Timestamp update( double native, Timestamp local );
+
+	// serializes the updates
+	boost::mutex m_updateMutex;
+
+	// the estimate as seen by readers
+	Util::SeqLock< ClockModel > m_model;
 
 	// number of treated events
 	unsigned m_events;
@@ -32,7 +32,7 @@
 #ifndef _Ubitrack_Measurement_TimestampSyncLS_INCLUDED_
 #define _Ubitrack_Measurement_TimestampSyncLS_INCLUDED_
 
-#define DEBUG_TIMESTAMP_SYNC
+//#define DEBUG_TIMESTAMP_SYNC
 
 #ifdef DEBUG_TIMESTAMP_SYNC
 #include <iostream>
@@ -40,9 +40,15 @@
 // #include <cmath>
 #endif
 
+#include <cmath>
 #include <algorithm>
+#include <vector>
 #include <utCore.h>
 #include <utMeasurement/Timestamp.h>
+#include <utMeasurement/TimestampSync.h>	// ClockModel
+#include <utUtil/SeqLock.h>
+
+#include <boost/thread/mutex.hpp>
 
 namespace Ubitrack { namespace Measurement {
 
@@ -58,16 +64,29 @@ static const double g_fDeviationWeight = 0.01;
 /**
  * see class TimestampSync.
  * This does the same thing, but using an exponentially weighted recursive least-squares algorithm.
+ * The fit accumulates the variance and covariance of the deviations from the running means
+ * instead of raw moments, so it stays precise over long sessions, and forgets old measurements
+ * to follow changes of the drift.
+ * Updates are serialized and the estimate is published for lock-free conversions in the same way.
  */
 UBITRACK_EXPORT class TimestampSyncLS
 {
 public:
-	TimestampSyncLS()
+	/**
+	 * Constructor.
+	 * @param fWeight weight of new measurements in the exponentially weighted averages after the
+	 *   first 100, which are averaged with equal weights. Smaller weights give smoother estimates,
+	 *   larger ones follow changes of the drift faster.
+	 */
+	explicit TimestampSyncLS( double fWeight = g_fWeight )
 		: m_events( 0 )
+		, m_firstLocal( 0 )
+		, m_firstNative( 0.0 )
+		, m_fWeight( fWeight )
 		, m_avgNative( 0.0 )
-		, m_avgNativeSquare( 0.0 )
 		, m_avgLocal( 0.0 )
-		, m_avgLocalNative( 0.0 )
+		, m_varNative( 0.0 )
+		, m_covLocalNative( 0.0 )
 		, m_outlierBudget( 0 )
 		, m_avgDeviationSquare( 1e6 * 1e6 )
 	{}
@@ -78,21 +97,70 @@ public:
 	}
 
 	Timestamp convertNativeToLocal( double native, Timestamp local )
+	{
+		boost::mutex::scoped_lock l( m_updateMutex );
+		return update( native, local );
+	}
+
+	/** see \c TimestampSync::convertNativeToLocal for packets of timestamps */
+	void convertNativeToLocal( const std::vector< double >& native, Timestamp local, std::vector< Timestamp >& result )
+	{
+		result.resize( native.size() );
+		if ( native.empty() )
+			return;
+
+		boost::mutex::scoped_lock l( m_updateMutex );
+		const Timestamp last = update( native.back(), local );
+
+		// during the first measurements, the input times are returned
+		const ClockModel model( m_model.load() );
+		for ( std::size_t i = 0; i < native.size(); i++ )
+			result[ i ] = model.events ? model.toLocal( native[ i ] ) : last;
+	}
+
+	/** converts a sensor timestamp with the current estimate without updating it, see \c TimestampSync::toLocal */
+	bool toLocal( double native, Timestamp& local ) const
+	{
+		const ClockModel model( m_model.load() );
+		if ( model.events == 0 )
+			return false;
+		local = model.toLocal( native );
+		return true;
+	}
+
+	/** returns the current estimate of the clock relation, \c events is 0 while there is none yet */
+	ClockModel getClockModel() const
+	{ return m_model.load(); }
+
+	unsigned getEventCount() const
+	{
+		boost::mutex::scoped_lock l( m_updateMutex );
+		return m_events;
+	}
+	
+protected:
+	/** updates the estimate with a timestamp, the caller holds the update mutex */
+	Timestamp update( double native, Timestamp local )
 	{
 		if ( m_events == 0 )
+		{
 			m_firstLocal = local;
+			m_firstNative = native;
+		}
 
-		double fLocal = static_cast< double >( local - m_firstLocal );
-		double fExtrapolated, deviationSquare, thresholdSquare;
-		double fGain, var;
+		// times relative to the first event, the fit uses deviations from the means
+		const double fNative = native - m_firstNative;
+		const double fLocal = static_cast< double >( static_cast< long long >( local - m_firstLocal ) );
+		const double dNative = fNative - m_avgNative;
+		const double dLocal = fLocal - m_avgLocal;
+		double fExtrapolated, deviationSquare = 0.0, thresholdSquare = 0.0;
+		double fGain = 1.0;
 		
 		if ( m_events > 10 )
 		{
 			// extrapolate
-			var =  m_avgNativeSquare - m_avgNative * m_avgNative;
-			double fOffset = m_avgNativeSquare * m_avgLocal - m_avgNative * m_avgLocalNative;
-			fGain = m_avgLocalNative - m_avgLocal * m_avgNative;
-			fExtrapolated = ( native * fGain + fOffset ) / var;
+			fGain = m_covLocalNative / m_varNative;
+			fExtrapolated = m_avgLocal + fGain * dNative;
 		
 			// compute threshold
 			double deviation = fExtrapolated - fLocal;
@@ -100,21 +168,16 @@ public:
 			thresholdSquare = m_avgDeviationSquare * 9;
 		}
 		else
-		{
 			fExtrapolated = fLocal;
-#ifdef DEBUG_TIMESTAMP_SYNC
-			fGain = 1.0; var = 1.0; // only for debug printing
-#endif
-		}
 		
-		// perform averaging
+		// exponentially weighted means and covariances
 		if ( m_events < 100 || deviationSquare < thresholdSquare || m_outlierBudget < 0 )
 		{
-			double fWeight = m_events < 100 ? 1.0 / ( m_events + 1 ) : g_fWeight;
-			m_avgNative += ( native - m_avgNative ) * fWeight;
-			m_avgLocal += ( fLocal - m_avgLocal ) * fWeight;
-			m_avgNativeSquare += ( native * native - m_avgNativeSquare ) * fWeight;
-			m_avgLocalNative += ( fLocal * native - m_avgLocalNative ) * fWeight;
+			double fWeight = m_events < 100 ? 1.0 / ( m_events + 1 ) : m_fWeight;
+			m_avgNative += dNative * fWeight;
+			m_avgLocal += dLocal * fWeight;
+			m_varNative = ( 1.0 - fWeight ) * ( m_varNative + fWeight * dNative * dNative );
+			m_covLocalNative = ( 1.0 - fWeight ) * ( m_covLocalNative + fWeight * dNative * dLocal );
 
 			if ( m_events > 10 )
 				m_avgDeviationSquare += ( deviationSquare - m_avgDeviationSquare ) * g_fDeviationWeight;
@@ -128,29 +191,45 @@ public:
  		if ( native < 1e9  )
 			std::cerr << std::setprecision( 15 ) << native << " " << local / 1000 << " " << 
 				static_cast< long long >( fLocal-fExtrapolated ) / 1000 << " " << 
-				fGain / var * 1e-9 << " " << ( m_firstLocal + static_cast< long long >( fExtrapolated ) ) / 1000 << " " << 
+				fGain * 1e-9 << " " << ( m_firstLocal + static_cast< long long >( fExtrapolated ) ) / 1000 << " " << 
 				std::sqrt( m_avgDeviationSquare ) * 3 / 1000 << std::endl;
 #endif
 				
 		m_events++;
 
+		// publish the regression once it is determined
+		if ( m_events > 10 )
+		{
+			ClockModel model;
+			model.gain = m_covLocalNative / m_varNative;
+			model.native = m_firstNative + m_avgNative;
+			model.local = m_firstLocal + static_cast< long long >( m_avgLocal );
+			model.events = m_events;
+			m_model.store( model );
+		}
+
 		// return the input value for the first 10 times
-		return m_firstLocal + static_cast< Timestamp >( fExtrapolated );
+		return m_firstLocal + static_cast< long long >( fExtrapolated );
 	}
 
-	unsigned getEventCount() const
-	{ return m_events; }
-	
-protected:
+	// serializes the updates
+	mutable boost::mutex m_updateMutex;
+
+	// the estimate as seen by readers
+	Util::SeqLock< ClockModel > m_model;
 
 	unsigned m_events;
 	Timestamp m_firstLocal;
+	double m_firstNative;
 	
-	// variables for recursive exponentially-weighted least squares
+	// weight of new measurements
+	double m_fWeight;
+
+	// exponentially weighted means of the times relative to the first event, and their variance and covariance
 	double m_avgNative;
-	double m_avgNativeSquare;
 	double m_avgLocal;
-	double m_avgLocalNative;
+	double m_varNative;
+	double m_covLocalNative;
 
 	// variables for outlier detection
 	int m_outlierBudget;
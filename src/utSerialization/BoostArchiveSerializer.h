@@ -83,6 +83,7 @@ struct BoostArchiveSerializationFormat
 
 /**
  * \brief Serialize an object.  Stream here should normally be a boost::archive::binary_oarchive
+ * or, for many small messages, a reused Util::MessageOArchive (see utUtil/MessageArchive.h)
  */
 template<typename T, typename Stream>
 inline void serialize(Stream& stream, const T& t)
@@ -92,6 +93,7 @@ inline void serialize(Stream& stream, const T& t)
 
 /**
  * \brief Deserialize an object.  Stream here should normally be a boost::archive::binary_iarchive
+ * or, for many small messages, a reused Util::MessageIArchive (see utUtil/MessageArchive.h)
  */
 template<typename T, typename Stream>
 inline void deserialize(Stream& stream, T& t)
@@ -0,0 +1,482 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Columnar, block compressed files of one measurement stream
+ */
+
+#include "utSerialization/ColumnarLog.h"
+#include "utUtil/TraceSpan.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace ColumnarLog {
+
+namespace {
+
+/// beginning of each file, followed by the version, the header size and the column count
+const char g_fileMagic[8] = { 'U', 'T', 'C', 'O', 'L', 0, 0, 0 };
+const uint32_t g_fileVersion = 1;
+
+/// beginning of each block and of the index
+const uint32_t g_blockMagic = 0x4b4c4255; // "UBLK"
+const uint32_t g_indexMagic = 0x58444955; // "UIDX"
+
+/// last bytes of a file with index, preceded by the offset of the index
+const char g_footerMagic[8] = { 'U', 'T', 'C', 'O', 'L', 'I', 'D', 'X' };
+const std::size_t g_footerSize = 16;
+
+/// header of each block, followed by \c size bytes of column sizes and column data
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t columns;
+    uint64_t rows;
+    uint64_t first;
+    uint64_t last;
+    uint64_t size;
+};
+
+inline uint64_t padded(uint64_t size)
+{
+    return (size+7) & ~uint64_t(7);
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v)
+{
+    while (v>=0x80) {
+        out.push_back(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+uint64_t getVarint(const uint8_t*& p, const uint8_t* end)
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift<64; shift += 7) {
+        if (p==end)
+            UBITRACK_THROW("Corrupt timestamp column in columnar log");
+        const uint8_t byte = *p++;
+        v |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return v;
+    }
+    UBITRACK_THROW("Corrupt timestamp column in columnar log");
+}
+
+/// timestamps as zigzag varints of the difference of consecutive differences
+void encodeTimes(const std::vector<uint64_t>& times, std::vector<uint8_t>& out)
+{
+    int64_t delta = 0;
+    for (std::size_t i = 1; i<times.size(); ++i) {
+        const int64_t d = int64_t(times[i]-times[i-1]);
+        const int64_t dd = d-delta;
+        putVarint(out, (uint64_t(dd) << 1) ^ uint64_t(dd >> 63));
+        delta = d;
+    }
+}
+
+void decodeTimes(const uint8_t* p, const uint8_t* end, uint64_t first, std::size_t rows, std::vector<uint64_t>& times)
+{
+    times.resize(rows);
+    if (!rows)
+        return;
+    times[0] = first;
+    int64_t delta = 0;
+    for (std::size_t i = 1; i<rows; ++i) {
+        const uint64_t z = getVarint(p, end);
+        delta += int64_t(z >> 1) ^ -int64_t(z & 1);
+        times[i] = times[i-1]+uint64_t(delta);
+    }
+}
+
+/**
+ * doubles XOR-ed with their predecessor. A byte with the number of leading and trailing
+ * zero bytes of the result is followed by the remaining bytes.
+ */
+void encodeDoubles(const std::vector<double>& values, std::vector<uint8_t>& out)
+{
+    uint64_t previous = 0;
+    for (std::size_t i = 0; i<values.size(); ++i) {
+        uint64_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        const uint64_t x = bits ^ previous;
+        previous = bits;
+
+        if (!x) {
+            out.push_back(8 << 4);
+            continue;
+        }
+        unsigned lead = 0, trail = 0;
+        while (!(x >> (56-8*lead) & 0xff))
+            ++lead;
+        while (!(x >> (8*trail) & 0xff))
+            ++trail;
+        out.push_back(uint8_t(lead << 4 | trail));
+        for (unsigned b = trail; b<8-lead; ++b)
+            out.push_back(uint8_t(x >> (8*b)));
+    }
+}
+
+void decodeDoubles(const uint8_t* p, const uint8_t* end, std::size_t rows, double* values)
+{
+    uint64_t previous = 0;
+    for (std::size_t i = 0; i<rows; ++i) {
+        if (p==end)
+            UBITRACK_THROW("Corrupt data column in columnar log");
+        const unsigned lead = *p >> 4;
+        const unsigned trail = *p++ & 0x0f;
+        if (lead+trail>8 || end-p<std::ptrdiff_t(8-lead-trail))
+            UBITRACK_THROW("Corrupt data column in columnar log");
+
+        uint64_t x = 0;
+        for (unsigned b = trail; b<8-lead; ++b)
+            x |= uint64_t(*p++) << (8*b);
+        previous ^= x;
+        memcpy(&values[i], &previous, sizeof(previous));
+    }
+}
+
+} // anonymous namespace
+
+
+Writer::Writer(const std::string& fileName, const std::vector<std::string>& columns,
+    const std::string& type, std::size_t blockRows)
+    : m_file(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc)
+    , m_offset(0)
+    , m_blockRows(std::max(blockRows, std::size_t(1)))
+    , m_columns(columns.size())
+{
+    if (!m_file.good())
+        UBITRACK_THROW("Could not open file " + fileName + " for writing");
+
+    std::string names(type.c_str(), type.size()+1);
+    for (std::size_t i = 0; i<columns.size(); ++i)
+        names.append(columns[i].c_str(), columns[i].size()+1);
+
+    const uint32_t nColumns = (uint32_t) columns.size();
+    const uint32_t headerSize = (uint32_t) padded(sizeof(g_fileMagic)+4*sizeof(uint32_t)+names.size());
+    std::vector<char> header(headerSize, 0);
+    memcpy(&header[0], g_fileMagic, sizeof(g_fileMagic));
+    memcpy(&header[8], &g_fileVersion, sizeof(uint32_t));
+    memcpy(&header[12], &headerSize, sizeof(uint32_t));
+    memcpy(&header[16], &nColumns, sizeof(uint32_t));
+    memcpy(&header[24], names.data(), names.size());
+    m_file.write(&header[0], headerSize);
+    m_offset = headerSize;
+
+    for (std::size_t c = 0; c<m_columns.size(); ++c)
+        m_columns[c].reserve(m_blockRows);
+    m_times.reserve(m_blockRows);
+}
+
+
+Writer::~Writer()
+{
+    try {
+        if (m_file.is_open())
+            close();
+    }
+    catch (...) {
+    }
+}
+
+
+void Writer::writeRow(Measurement::Timestamp t, const double* values)
+{
+    const uint64_t last = !m_times.empty() ? m_times.back() : !m_blocks.empty() ? m_blocks.back().last : 0;
+    if (t<last)
+        UBITRACK_THROW("Timestamps of a columnar log must not decrease");
+
+    m_times.push_back(t);
+    for (std::size_t c = 0; c<m_columns.size(); ++c)
+        m_columns[c].push_back(values[c]);
+    if (m_times.size()>=m_blockRows)
+        writeBlock();
+}
+
+
+void Writer::flush()
+{
+    if (!m_times.empty())
+        writeBlock();
+    m_file.flush();
+}
+
+
+void Writer::writeBlock()
+{
+    // attributes: rows, columns, bytes
+    UBITRACK_TRACE_SPAN("columnar_log_block", m_times.size(), m_columns.size());
+    // column sizes first, then the columns
+    m_encoded.clear();
+    m_sizes.assign(m_columns.size()+1, 0);
+    encodeTimes(m_times, m_encoded);
+    m_sizes[0] = (uint32_t) m_encoded.size();
+    for (std::size_t c = 0; c<m_columns.size(); ++c) {
+        const std::size_t before = m_encoded.size();
+        encodeDoubles(m_columns[c], m_encoded);
+        m_sizes[c+1] = (uint32_t) (m_encoded.size()-before);
+    }
+
+    const std::size_t dataSize = m_sizes.size()*sizeof(uint32_t)+m_encoded.size();
+    UBITRACK_TRACE_SPAN_SET(2, sizeof(BlockHeader)+padded(dataSize));
+    BlockHeader header = { g_blockMagic, (uint32_t) m_columns.size(), m_times.size(),
+        m_times.front(), m_times.back(), padded(dataSize) };
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.write(reinterpret_cast<const char*>(&m_sizes[0]), m_sizes.size()*sizeof(uint32_t));
+    if (!m_encoded.empty())
+        m_file.write(reinterpret_cast<const char*>(&m_encoded[0]), m_encoded.size());
+    const char padding[8] = { 0 };
+    m_file.write(padding, header.size-dataSize);
+    if (!m_file.good())
+        UBITRACK_THROW("Could not write columnar log");
+
+    BlockInfo info = { m_offset, header.rows, header.first, header.last };
+    m_blocks.push_back(info);
+    m_offset += sizeof(header)+header.size;
+
+    m_times.clear();
+    for (std::size_t c = 0; c<m_columns.size(); ++c)
+        m_columns[c].clear();
+}
+
+
+void Writer::close()
+{
+    flush();
+
+    const uint64_t indexOffset = m_offset;
+    const uint32_t index[2] = { g_indexMagic, (uint32_t) m_blocks.size() };
+    m_file.write(reinterpret_cast<const char*>(index), sizeof(index));
+    if (!m_blocks.empty())
+        m_file.write(reinterpret_cast<const char*>(&m_blocks[0]), m_blocks.size()*sizeof(BlockInfo));
+    m_file.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    m_file.write(g_footerMagic, sizeof(g_footerMagic));
+    m_file.close();
+}
+
+
+Reader::Reader(const std::string& fileName)
+    : m_file(fileName)
+    , m_headerSize(0)
+{
+    const std::size_t fixedSize = sizeof(g_fileMagic)+4*sizeof(uint32_t);
+    if (m_file.size()<fixedSize || memcmp(m_file.data(), g_fileMagic, sizeof(g_fileMagic))!=0)
+        UBITRACK_THROW("Not a columnar log file: " + fileName);
+    uint32_t version, headerSize, nColumns;
+    memcpy(&version, m_file.data()+8, sizeof(uint32_t));
+    memcpy(&headerSize, m_file.data()+12, sizeof(uint32_t));
+    memcpy(&nColumns, m_file.data()+16, sizeof(uint32_t));
+    if (version!=g_fileVersion)
+        UBITRACK_THROW("Unsupported columnar log version in " + fileName);
+    if (headerSize<fixedSize || headerSize>m_file.size())
+        UBITRACK_THROW("Corrupt columnar log header in " + fileName);
+    m_headerSize = headerSize;
+
+    // type name and column names
+    const char* name = reinterpret_cast<const char*>(m_file.data())+fixedSize;
+    const char* end = reinterpret_cast<const char*>(m_file.data())+headerSize;
+    for (uint32_t i = 0; i<=nColumns; ++i) {
+        const std::size_t length = strnlen(name, end-name);
+        if (name+length==end)
+            UBITRACK_THROW("Corrupt columnar log header in " + fileName);
+        if (i==0)
+            m_type.assign(name, length);
+        else
+            m_columns.push_back(std::string(name, length));
+        name += length+1;
+    }
+
+    if (!readIndex())
+        scanBlocks();
+
+    for (std::size_t b = 0; b<m_blocks.size(); ++b) {
+        BlockHeader header;
+        if (m_blocks[b].offset+sizeof(header)>m_file.size())
+            UBITRACK_THROW("Corrupt columnar log index in " + fileName);
+        memcpy(&header, m_file.data()+m_blocks[b].offset, sizeof(header));
+        if (header.magic!=g_blockMagic || header.columns!=nColumns || header.rows!=m_blocks[b].rows
+            || m_blocks[b].offset+sizeof(header)+header.size>m_file.size()
+            || (m_columns.size()+1)*sizeof(uint32_t)>header.size)
+            UBITRACK_THROW("Corrupt columnar log index in " + fileName);
+    }
+}
+
+
+std::size_t Reader::findColumn(const std::string& name) const
+{
+    std::vector<std::string>::const_iterator it = std::find(m_columns.begin(), m_columns.end(), name);
+    if (it==m_columns.end())
+        UBITRACK_THROW("No column named " + name);
+    return it-m_columns.begin();
+}
+
+
+std::size_t Reader::rowCount() const
+{
+    std::size_t rows = 0;
+    for (std::size_t b = 0; b<m_blocks.size(); ++b)
+        rows += m_blocks[b].rows;
+    return rows;
+}
+
+
+const uint8_t* Reader::columnData(const BlockInfo& block, std::size_t c, std::size_t& size) const
+{
+    const uint8_t* sizes = m_file.data()+block.offset+sizeof(BlockHeader);
+    const uint8_t* data = sizes+(m_columns.size()+1)*sizeof(uint32_t);
+
+    uint64_t offset = 0;
+    for (std::size_t i = 0; i<=c; ++i) {
+        uint32_t s;
+        memcpy(&s, sizes+i*sizeof(uint32_t), sizeof(s));
+        size = s;
+        if (i<c)
+            offset += s;
+    }
+
+    BlockHeader header;
+    memcpy(&header, m_file.data()+block.offset, sizeof(header));
+    if ((data-sizes)+offset+size>header.size)
+        UBITRACK_THROW("Corrupt block in columnar log");
+    return data+offset;
+}
+
+
+void Reader::read(Measurement::Timestamp from, Measurement::Timestamp to, const std::vector<std::size_t>& columns,
+    std::vector<Measurement::Timestamp>& times, std::vector<std::vector<double> >& values) const
+{
+    for (std::size_t i = 0; i<columns.size(); ++i)
+        if (columns[i]>=m_columns.size())
+            UBITRACK_THROW("Column index out of range");
+
+    times.clear();
+    values.assign(columns.size(), std::vector<double>());
+    if (from>to)
+        return;
+
+    // first block that ends at or after from
+    std::size_t lo = 0, hi = m_blocks.size();
+    while (lo<hi) {
+        const std::size_t mid = (lo+hi)/2;
+        if (m_blocks[mid].last<from)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+
+    std::vector<uint64_t> blockTimes;
+    std::vector<double> column;
+    for (std::size_t b = lo; b<m_blocks.size() && m_blocks[b].first<=to; ++b) {
+        const BlockInfo& block = m_blocks[b];
+        std::size_t size;
+        const uint8_t* data = columnData(block, 0, size);
+        decodeTimes(data, data+size, block.first, block.rows, blockTimes);
+
+        const std::size_t begin = std::lower_bound(blockTimes.begin(), blockTimes.end(), from)-blockTimes.begin();
+        const std::size_t end = std::upper_bound(blockTimes.begin(), blockTimes.end(), to)-blockTimes.begin();
+        if (begin==end)
+            continue;
+        times.insert(times.end(), blockTimes.begin()+begin, blockTimes.begin()+end);
+
+        // values are chained within a column, so the column is decoded up to the last row needed
+        column.resize(end);
+        for (std::size_t i = 0; i<columns.size(); ++i) {
+            data = columnData(block, columns[i]+1, size);
+            decodeDoubles(data, data+size, end, &column[0]);
+            values[i].insert(values[i].end(), column.begin()+begin, column.end());
+        }
+    }
+}
+
+
+void Reader::readRows(Measurement::Timestamp from, Measurement::Timestamp to, const std::vector<std::string>& names,
+    std::vector<Measurement::Timestamp>& times, std::vector<double>& rows) const
+{
+    if (names!=m_columns)
+        UBITRACK_THROW("The columns of the log do not match the requested type, stored type is " + m_type);
+
+    std::vector<std::size_t> columns(names.size());
+    for (std::size_t c = 0; c<columns.size(); ++c)
+        columns[c] = c;
+    std::vector<std::vector<double> > values;
+    read(from, to, columns, times, values);
+
+    rows.resize(times.size()*columns.size());
+    for (std::size_t c = 0; c<columns.size(); ++c)
+        for (std::size_t r = 0; r<times.size(); ++r)
+            rows[r*columns.size()+c] = values[c][r];
+}
+
+
+bool Reader::readIndex()
+{
+    const std::size_t size = m_file.size();
+    if (size<m_headerSize+2*sizeof(uint32_t)+g_footerSize)
+        return false;
+    if (memcmp(m_file.data()+size-sizeof(g_footerMagic), g_footerMagic, sizeof(g_footerMagic))!=0)
+        return false;
+
+    uint64_t offset;
+    memcpy(&offset, m_file.data()+size-g_footerSize, sizeof(offset));
+    if (offset<m_headerSize || offset+2*sizeof(uint32_t)>size-g_footerSize)
+        return false;
+
+    uint32_t index[2];
+    memcpy(index, m_file.data()+offset, sizeof(index));
+    if (index[0]!=g_indexMagic || offset+sizeof(index)+index[1]*sizeof(BlockInfo)!=size-g_footerSize)
+        return false;
+
+    m_blocks.resize(index[1]);
+    if (index[1])
+        memcpy(&m_blocks[0], m_file.data()+offset+sizeof(index), index[1]*sizeof(BlockInfo));
+    return true;
+}
+
+
+void Reader::scanBlocks()
+{
+    uint64_t offset = m_headerSize;
+    while (offset+sizeof(BlockHeader)<=m_file.size()) {
+        BlockHeader header;
+        memcpy(&header, m_file.data()+offset, sizeof(header));
+
+        // stop at the first incomplete block
+        if (header.magic!=g_blockMagic || offset+sizeof(header)+header.size>m_file.size())
+            break;
+        BlockInfo info = { offset, header.rows, header.first, header.last };
+        m_blocks.push_back(info);
+        offset += sizeof(header)+header.size;
+    }
+}
+
+} // ColumnarLog
+} // Serialization
+} // Ubitrack
@@ -0,0 +1,442 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Columnar, block compressed files of one measurement stream, for offline analysis
+ *
+ * A columnar log stores the measurements of one stream as a table: a timestamp column and
+ * one column of doubles per component of the payload, e.g. tx, ty, tz, qx, qy, qz, qw of a
+ * pose followed by the upper triangle of the covariance for error types. The rows are
+ * grouped into blocks, and every column of a block is compressed on its own:
+ * @verbatim
+file   := header { block } [ index footer ]
+header := magic, version, header size, column count, type name, column names
+block  := block header (rows, first and last timestamp), column sizes (uint32 x (columns + 1)),
+          timestamp column, data columns
+@endverbatim
+ * Timestamps are stored as zigzag varints of the second difference, which takes one byte
+ * per row for regular sampling. Doubles are XOR-ed with the previous value of their column
+ * and stored without the zero bytes at both ends of the result, so slowly changing and
+ * repeated values take few bytes.
+ *
+ * The index at the end of the file holds the time range of every block. Reading a time range
+ * only decodes the blocks overlapping it, and only the requested columns of these blocks; a
+ * file without index, e.g. after a crash, is read by walking the block headers:
+ * @code
+ * Serialization::ColumnarLog::TypedWriter< Math::ErrorPose > writer( "target1.utcol" );
+ * writer.write( errorPose );
+ * writer.close();
+ *
+ * Serialization::ColumnarLog::Reader reader( "target1.utcol" );
+ * std::vector< std::size_t > columns;
+ * columns.push_back( reader.findColumn( "tz" ) );
+ * std::vector< Measurement::Timestamp > times;
+ * std::vector< std::vector< double > > values;
+ * reader.read( from, to, columns, times, values );
+ * @endcode
+ *
+ * Lists such as \c Measurement::PoseList are stored as one row per element with the
+ * timestamp of the list, and \c Reader::readLists groups consecutive rows with equal timestamps
+ * again. Empty lists are therefore not stored. The files use the byte order of the writing machine.
+ */
+
+#ifndef UBITRACK_COLUMNARLOG_H
+#define UBITRACK_COLUMNARLOG_H
+
+#include <utCore.h>
+#include <utMeasurement/Measurement.h>
+#include <utUtil/MappedFile.h>
+#include <utUtil/Exception.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <typeinfo>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/utility.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace ColumnarLog {
+
+/**
+ * Maps a payload type to its columns. Specializations provide the number of columns, their
+ * names, and the conversion of a value from and to one row.
+ */
+template<typename T>
+struct ColumnTraits;
+
+template<>
+struct ColumnTraits<Math::Scalar<double> > {
+    static const std::size_t columns = 1;
+    static std::string name(std::size_t)
+    { return "value"; }
+    static void extract(const Math::Scalar<double>& v, double* row)
+    { row[0] = v; }
+    static void assemble(const double* row, Math::Scalar<double>& v)
+    { v = row[0]; }
+};
+
+template<std::size_t N>
+struct ColumnTraits<Math::Vector<double, N> > {
+    static const std::size_t columns = N;
+    static std::string name(std::size_t i)
+    {
+        static const char* names[] = { "x", "y", "z", "w" };
+        return N<=4 ? std::string(names[i]) : "v" + boost::lexical_cast<std::string>(i);
+    }
+    static void extract(const Math::Vector<double, N>& v, double* row)
+    {
+        for (std::size_t i = 0; i<N; ++i)
+            row[i] = v(i);
+    }
+    static void assemble(const double* row, Math::Vector<double, N>& v)
+    {
+        for (std::size_t i = 0; i<N; ++i)
+            v(i) = row[i];
+    }
+};
+
+template<>
+struct ColumnTraits<Math::Quaternion> {
+    static const std::size_t columns = 4;
+    static std::string name(std::size_t i)
+    {
+        static const char* names[] = { "qx", "qy", "qz", "qw" };
+        return names[i];
+    }
+    static void extract(const Math::Quaternion& q, double* row)
+    {
+        row[0] = q.x(); row[1] = q.y(); row[2] = q.z(); row[3] = q.w();
+    }
+    static void assemble(const double* row, Math::Quaternion& q)
+    { q = Math::Quaternion(row[0], row[1], row[2], row[3]); }
+};
+
+template<>
+struct ColumnTraits<Math::Pose> {
+    static const std::size_t columns = 7;
+    static std::string name(std::size_t i)
+    {
+        static const char* names[] = { "tx", "ty", "tz", "qx", "qy", "qz", "qw" };
+        return names[i];
+    }
+    static void extract(const Math::Pose& p, double* row)
+    {
+        for (std::size_t i = 0; i<3; ++i)
+            row[i] = p.translation()(i);
+        ColumnTraits<Math::Quaternion>::extract(p.rotation(), row+3);
+    }
+    static void assemble(const double* row, Math::Pose& p)
+    {
+        Math::Quaternion q;
+        ColumnTraits<Math::Quaternion>::assemble(row+3, q);
+        p = Math::Pose(q, Math::Vector<double, 3>(row[0], row[1], row[2]));
+    }
+};
+
+/// @internal columns of the upper triangle of a symmetric N x N matrix, named cIJ
+template<std::size_t N>
+struct UpperTriangleColumns {
+    static const std::size_t columns = N*(N+1)/2;
+    static std::string name(std::size_t k)
+    {
+        std::size_t i = 0;
+        while (k>=N-i)
+            k -= N-i++;
+        return "c" + boost::lexical_cast<std::string>(i) + boost::lexical_cast<std::string>(i+k);
+    }
+    template<typename M>
+    static void extract(const M& m, double* row)
+    {
+        for (std::size_t i = 0; i<N; ++i)
+            for (std::size_t j = i; j<N; ++j)
+                *row++ = m(i, j);
+    }
+    template<typename M>
+    static void assemble(const double* row, M& m)
+    {
+        for (std::size_t i = 0; i<N; ++i)
+            for (std::size_t j = i; j<N; ++j)
+                m(i, j) = m(j, i) = *row++;
+    }
+};
+
+template<std::size_t N>
+struct ColumnTraits<Math::ErrorVector<double, N> > {
+    static const std::size_t columns = N+UpperTriangleColumns<N>::columns;
+    static std::string name(std::size_t i)
+    {
+        return i<N ? ColumnTraits<Math::Vector<double, N> >::name(i) : UpperTriangleColumns<N>::name(i-N);
+    }
+    static void extract(const Math::ErrorVector<double, N>& v, double* row)
+    {
+        ColumnTraits<Math::Vector<double, N> >::extract(v.value, row);
+        UpperTriangleColumns<N>::extract(v.covariance, row+N);
+    }
+    static void assemble(const double* row, Math::ErrorVector<double, N>& v)
+    {
+        ColumnTraits<Math::Vector<double, N> >::assemble(row, v.value);
+        UpperTriangleColumns<N>::assemble(row+N, v.covariance);
+    }
+};
+
+template<>
+struct ColumnTraits<Math::ErrorPose> {
+    static const std::size_t columns = 7+UpperTriangleColumns<6>::columns;
+    static std::string name(std::size_t i)
+    {
+        return i<7 ? ColumnTraits<Math::Pose>::name(i) : UpperTriangleColumns<6>::name(i-7);
+    }
+    static void extract(const Math::ErrorPose& p, double* row)
+    {
+        ColumnTraits<Math::Pose>::extract(p, row);
+        UpperTriangleColumns<6>::extract(p.covariance(), row+7);
+    }
+    static void assemble(const double* row, Math::ErrorPose& p)
+    {
+        Math::Pose pose;
+        ColumnTraits<Math::Pose>::assemble(row, pose);
+        Math::Matrix<double, 6, 6> covariance;
+        UpperTriangleColumns<6>::assemble(row+7, covariance);
+        p = Math::ErrorPose(pose, covariance);
+    }
+};
+
+/** the column names of payload type \c T */
+template<typename T>
+std::vector<std::string> columnNames()
+{
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i<ColumnTraits<T>::columns; ++i)
+        names.push_back(ColumnTraits<T>::name(i));
+    return names;
+}
+
+
+/// @internal position and time range of a block in the file
+struct BlockInfo {
+    uint64_t offset;
+    uint64_t rows;
+    uint64_t first;
+    uint64_t last;
+};
+
+
+/**
+ * Writes rows of doubles with timestamps into a columnar log. Rows are buffered and written
+ * as one block when \c blockRows rows are collected.
+ *
+ * Not thread-safe, the timestamps must not decrease.
+ */
+class UBITRACK_EXPORT Writer
+    : private boost::noncopyable
+{
+public:
+    /**
+     * creates (or overwrites) the file \c fileName
+     * @param columns names of the data columns
+     * @param type name of the payload type, for diagnostics only
+     * @param blockRows number of rows per block
+     */
+    Writer(const std::string& fileName, const std::vector<std::string>& columns,
+        const std::string& type = std::string(), std::size_t blockRows = 4096);
+
+    /** closes the file, if not done before */
+    ~Writer();
+
+    /** number of data columns */
+    std::size_t columnCount() const
+    { return m_columns.size(); }
+
+    /** appends a row of \c columnCount() values */
+    void writeRow(Measurement::Timestamp t, const double* values);
+
+    /** writes the buffered rows as a block */
+    void flush();
+
+    /** flushes the rows, writes the index and closes the file */
+    void close();
+
+protected:
+    void writeBlock();
+
+    std::ofstream m_file;
+    uint64_t m_offset;
+    std::size_t m_blockRows;
+
+    /// buffered rows, by column
+    std::vector<uint64_t> m_times;
+    std::vector<std::vector<double> > m_columns;
+
+    /// encoding buffers
+    std::vector<uint8_t> m_encoded;
+    std::vector<uint32_t> m_sizes;
+
+    std::vector<BlockInfo> m_blocks;
+};
+
+
+/**
+ * Writes measurements, or lists of them, of payload type \c T into a columnar log.
+ */
+template<typename T>
+class TypedWriter
+    : public Writer
+{
+public:
+    explicit TypedWriter(const std::string& fileName, std::size_t blockRows = 4096)
+        : Writer(fileName, columnNames<T>(), typeid(T).name(), blockRows)
+    {}
+
+    /** appends a payload with timestamp \c t */
+    void write(Measurement::Timestamp t, const T& value)
+    {
+        double row[ColumnTraits<T>::columns];
+        ColumnTraits<T>::extract(value, row);
+        writeRow(t, row);
+    }
+
+    /** appends every element of a list as a row with timestamp \c t */
+    void write(Measurement::Timestamp t, const std::vector<T>& values)
+    {
+        for (std::size_t i = 0; i<values.size(); ++i)
+            write(t, values[i]);
+    }
+
+    /** appends a measurement with payload */
+    template<typename P>
+    void write(const Measurement::Measurement<P>& m)
+    {
+        if (!m)
+            UBITRACK_THROW("Cannot log a measurement without payload");
+        write(m.time(), *m);
+    }
+};
+
+
+/**
+ * Maps a columnar log into memory and reads time ranges of selected columns.
+ * Throws a \c Util::Exception if the file is not a columnar log.
+ */
+class UBITRACK_EXPORT Reader
+    : private boost::noncopyable
+{
+public:
+    explicit Reader(const std::string& fileName);
+
+    /** number of data columns */
+    std::size_t columnCount() const
+    { return m_columns.size(); }
+
+    /** name of column \c i */
+    const std::string& columnName(std::size_t i) const
+    { return m_columns.at(i); }
+
+    /** index of the column \c name, throws if there is none */
+    std::size_t findColumn(const std::string& name) const;
+
+    /** compiler specific name of the payload type, for diagnostics only */
+    const std::string& typeName() const
+    { return m_type; }
+
+    /** blocks of the file in temporal order */
+    const std::vector<BlockInfo>& blocks() const
+    { return m_blocks; }
+
+    /** total number of rows */
+    std::size_t rowCount() const;
+
+    /**
+     * reads the rows with timestamps in [ from, to ]
+     * @param columns indices of the columns to read
+     * @param times receives the timestamps of the rows
+     * @param values receives one vector per requested column with the values of the rows
+     */
+    void read(Measurement::Timestamp from, Measurement::Timestamp to, const std::vector<std::size_t>& columns,
+        std::vector<Measurement::Timestamp>& times, std::vector<std::vector<double> >& values) const;
+
+    /** reads the measurements with timestamps in [ from, to ], the columns must match \c T */
+    template<typename T>
+    void read(Measurement::Timestamp from, Measurement::Timestamp to, std::vector<Measurement::Measurement<T> >& result) const
+    {
+        std::vector<Measurement::Timestamp> times;
+        std::vector<double> rows;
+        readRows(from, to, columnNames<T>(), times, rows);
+
+        result.clear();
+        for (std::size_t r = 0; r<times.size(); ++r) {
+            boost::shared_ptr<T> value(new T());
+            ColumnTraits<T>::assemble(&rows[r*ColumnTraits<T>::columns], *value);
+            result.push_back(Measurement::Measurement<T>(times[r], value));
+        }
+    }
+
+    /** reads the lists with timestamps in [ from, to ], the columns must match \c T */
+    template<typename T>
+    void readLists(Measurement::Timestamp from, Measurement::Timestamp to,
+        std::vector<Measurement::Measurement<std::vector<T> > >& result) const
+    {
+        std::vector<Measurement::Timestamp> times;
+        std::vector<double> rows;
+        readRows(from, to, columnNames<T>(), times, rows);
+
+        result.clear();
+        for (std::size_t r = 0; r<times.size(); ++r) {
+            if (r==0 || times[r]!=times[r-1])
+                result.push_back(Measurement::Measurement<std::vector<T> >(times[r], boost::shared_ptr<std::vector<T> >(new std::vector<T>())));
+            result.back()->push_back(T());
+            ColumnTraits<T>::assemble(&rows[r*ColumnTraits<T>::columns], result.back()->back());
+        }
+    }
+
+protected:
+    /// reads the columns \c names interleaved by row
+    void readRows(Measurement::Timestamp from, Measurement::Timestamp to, const std::vector<std::string>& names,
+        std::vector<Measurement::Timestamp>& times, std::vector<double>& rows) const;
+
+    /// reads the index written by the writer, returns false if there is none
+    bool readIndex();
+
+    /// walks through all block headers
+    void scanBlocks();
+
+    /// the encoded column c of block b, c = 0 are the timestamps
+    const uint8_t* columnData(const BlockInfo& block, std::size_t c, std::size_t& size) const;
+
+    Util::MappedFile m_file;
+    std::size_t m_headerSize;
+    std::string m_type;
+    std::vector<std::string> m_columns;
+    std::vector<BlockInfo> m_blocks;
+};
+
+} // ColumnarLog
+} // Serialization
+} // Ubitrack
+
+#endif //UBITRACK_COLUMNARLOG_H
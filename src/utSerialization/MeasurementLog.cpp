@@ -0,0 +1,330 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Chunked, indexed log files of measurement streams
+ */
+
+#include "utSerialization/MeasurementLog.h"
+#include "utUtil/TraceSpan.h"
+#include "utUtil/AllocationTracker.h"
+
+#include <cstring>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace MeasurementLog {
+
+namespace {
+
+/// beginning of each log file, followed by the version
+const char g_fileMagic[8] = { 'U', 'T', 'L', 'O', 'G', 0, 0, 0 };
+const uint32_t g_fileVersion = 1;
+const std::size_t g_fileHeaderSize = 16;
+
+/// beginning of each record
+const uint32_t g_recordMagic = 0x4b525455; // "UTRK"
+
+/// last bytes of a file with index, preceded by the offset of the index record
+const char g_footerMagic[8] = { 'U', 'T', 'L', 'O', 'G', 'I', 'D', 'X' };
+const std::size_t g_footerSize = 16;
+
+inline uint64_t padded(uint64_t size)
+{
+    return (size+7) & ~uint64_t(7);
+}
+
+} // anonymous namespace
+
+
+/// @internal measurements of one stream that are not written yet
+struct Writer::StreamBuffer {
+    unsigned id;
+    std::vector<uint64_t> timestamps;
+    std::vector<uint32_t> offsets;
+    std::vector<uint8_t, Util::TrackedAllocator<uint8_t, Util::AllocationTracker::SerializerBuffer>::type> payload;
+};
+
+
+Writer::Writer(const std::string& fileName, std::size_t chunkSize)
+    : m_file(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc)
+    , m_offset(0)
+    , m_chunkSize(chunkSize)
+{
+    if (!m_file.good())
+        UBITRACK_THROW("Could not open file " + fileName + " for writing");
+
+    char header[g_fileHeaderSize] = { 0 };
+    memcpy(header, g_fileMagic, sizeof(g_fileMagic));
+    memcpy(header+sizeof(g_fileMagic), &g_fileVersion, sizeof(g_fileVersion));
+    m_file.write(header, g_fileHeaderSize);
+    m_offset = g_fileHeaderSize;
+}
+
+
+Writer::~Writer()
+{
+    try {
+        if (m_file.is_open())
+            close();
+    }
+    catch (...) {
+    }
+    for (std::size_t i = 0; i<m_streams.size(); ++i)
+        delete m_streams[i];
+}
+
+
+unsigned Writer::addStream(const std::string& name, const std::string& type)
+{
+    StreamBuffer* buffer = new StreamBuffer;
+    buffer->id = (unsigned) m_streams.size();
+    buffer->offsets.push_back(0);
+    m_streams.push_back(buffer);
+
+    std::vector<const void*> parts;
+    std::vector<std::size_t> sizes;
+    parts.push_back(name.c_str());
+    sizes.push_back(name.size()+1);
+    parts.push_back(type.c_str());
+    sizes.push_back(type.size()+1);
+
+    RecordHeader header = { g_recordMagic, RECORD_STREAM, buffer->id, 0, 0, 0, 0 };
+    writeRecord(header, parts, sizes);
+    return buffer->id;
+}
+
+
+uint8_t* Writer::append(unsigned stream, Measurement::Timestamp t, uint32_t size)
+{
+    if (stream>=m_streams.size())
+        UBITRACK_THROW("Unknown log stream");
+    StreamBuffer& buffer = *m_streams[stream];
+    if (!buffer.timestamps.empty() && t<buffer.timestamps.back())
+        UBITRACK_THROW("Timestamps of a log stream must not decrease");
+
+    const std::size_t begin = buffer.payload.size();
+    buffer.timestamps.push_back(t);
+    buffer.offsets.push_back((uint32_t) (begin+size));
+    buffer.payload.resize(begin+size);
+    return buffer.payload.empty() ? 0 : &buffer.payload[0]+begin;
+}
+
+
+void Writer::committed(unsigned stream)
+{
+    if (m_streams[stream]->payload.size()>=m_chunkSize)
+        writeChunk(*m_streams[stream]);
+}
+
+
+void Writer::writeChunk(StreamBuffer& buffer)
+{
+    const std::size_t count = buffer.timestamps.size();
+    if (!count)
+        return;
+
+    std::vector<const void*> parts;
+    std::vector<std::size_t> sizes;
+    parts.push_back(&buffer.timestamps[0]);
+    sizes.push_back(count*sizeof(uint64_t));
+    parts.push_back(&buffer.offsets[0]);
+    sizes.push_back((count+1)*sizeof(uint32_t));
+    parts.push_back(buffer.payload.empty() ? 0 : &buffer.payload[0]);
+    sizes.push_back(buffer.payload.size());
+
+    RecordHeader header = { g_recordMagic, RECORD_CHUNK, buffer.id, (uint32_t) count, 0,
+                            buffer.timestamps.front(), buffer.timestamps.back() };
+    writeRecord(header, parts, sizes);
+
+    // keep the capacity for the next chunk
+    buffer.timestamps.clear();
+    buffer.offsets.resize(1);
+    buffer.payload.clear();
+}
+
+
+void Writer::writeRecord(RecordHeader& header, const std::vector<const void*>& parts, const std::vector<std::size_t>& sizes)
+{
+    if (!m_file.is_open())
+        UBITRACK_THROW("Log file is already closed");
+
+    header.size = 0;
+    for (std::size_t i = 0; i<sizes.size(); ++i)
+        header.size += padded(sizes[i]);
+    // attributes: record type, measurements, bytes
+    UBITRACK_TRACE_SPAN("measurement_log_record", header.type, header.count, sizeof(header)+header.size);
+
+    RecordInfo info = { header, m_offset };
+    if (header.type!=RECORD_INDEX)
+        m_records.push_back(info);
+
+    const char zeros[8] = { 0 };
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (std::size_t i = 0; i<parts.size(); ++i) {
+        if (sizes[i])
+            m_file.write(static_cast<const char*>(parts[i]), sizes[i]);
+        m_file.write(zeros, padded(sizes[i])-sizes[i]);
+    }
+    m_offset += sizeof(header)+header.size;
+
+    if (!m_file.good())
+        UBITRACK_THROW("Could not write to log file");
+}
+
+
+void Writer::flush()
+{
+    for (std::size_t i = 0; i<m_streams.size(); ++i)
+        writeChunk(*m_streams[i]);
+    m_file.flush();
+}
+
+
+void Writer::close()
+{
+    flush();
+
+    const uint64_t indexOffset = m_offset;
+    std::vector<const void*> parts(1, m_records.empty() ? 0 : &m_records[0]);
+    std::vector<std::size_t> sizes(1, m_records.size()*sizeof(RecordInfo));
+    RecordHeader header = { g_recordMagic, RECORD_INDEX, 0, (uint32_t) m_records.size(), 0, 0, 0 };
+    writeRecord(header, parts, sizes);
+
+    m_file.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    m_file.write(g_footerMagic, sizeof(g_footerMagic));
+    m_file.close();
+}
+
+
+Reader::Reader(const std::string& fileName)
+    : m_file(fileName)
+{
+    if (m_file.size()<g_fileHeaderSize || memcmp(m_file.data(), g_fileMagic, sizeof(g_fileMagic))!=0)
+        UBITRACK_THROW("Not a measurement log file: " + fileName);
+    uint32_t version;
+    memcpy(&version, m_file.data()+sizeof(g_fileMagic), sizeof(version));
+    if (version!=g_fileVersion)
+        UBITRACK_THROW("Unsupported measurement log version in " + fileName);
+
+    std::vector<RecordInfo> records;
+    if (!readIndex(records))
+        scanRecords(records);
+
+    for (std::vector<RecordInfo>::const_iterator it = records.begin(); it!=records.end(); ++it) {
+        if (it->offset+sizeof(RecordHeader)+it->header.size>m_file.size())
+            UBITRACK_THROW("Corrupt measurement log index in " + fileName);
+
+        if (it->header.type==RECORD_STREAM) {
+            if (it->header.stream>=m_streams.size())
+                m_streams.resize(it->header.stream+1);
+            const char* name = reinterpret_cast<const char*>(recordData(*it));
+            StreamInfo& info = m_streams[it->header.stream];
+            info.name = std::string(name, strnlen(name, it->header.size));
+            const std::size_t typeOffset = padded(info.name.size()+1);
+            if (typeOffset<it->header.size)
+                info.type = std::string(name+typeOffset, strnlen(name+typeOffset, it->header.size-typeOffset));
+        }
+        else if (it->header.type==RECORD_CHUNK) {
+            if (it->header.stream>=m_streams.size())
+                UBITRACK_THROW("Measurement log chunk of unknown stream in " + fileName);
+            m_streams[it->header.stream].chunks.push_back(*it);
+        }
+    }
+}
+
+
+const StreamInfo& Reader::stream(unsigned id) const
+{
+    if (id>=m_streams.size())
+        UBITRACK_THROW("Unknown log stream");
+    return m_streams[id];
+}
+
+
+unsigned Reader::findStream(const std::string& name) const
+{
+    unsigned result = (unsigned) m_streams.size();
+    for (unsigned i = 0; i<m_streams.size(); ++i) {
+        if (m_streams[i].name==name) {
+            if (result!=m_streams.size())
+                UBITRACK_THROW("Several log streams named " + name);
+            result = i;
+        }
+    }
+    if (result==m_streams.size())
+        UBITRACK_THROW("No log stream named " + name);
+    return result;
+}
+
+
+bool Reader::readIndex(std::vector<RecordInfo>& records) const
+{
+    const std::size_t size = m_file.size();
+    if (size<g_fileHeaderSize+sizeof(RecordHeader)+g_footerSize)
+        return false;
+    if (memcmp(m_file.data()+size-sizeof(g_footerMagic), g_footerMagic, sizeof(g_footerMagic))!=0)
+        return false;
+
+    uint64_t offset;
+    memcpy(&offset, m_file.data()+size-g_footerSize, sizeof(offset));
+    if (offset<g_fileHeaderSize || offset+sizeof(RecordHeader)>size-g_footerSize)
+        return false;
+
+    RecordHeader header;
+    memcpy(&header, m_file.data()+offset, sizeof(header));
+    if (header.magic!=g_recordMagic || header.type!=RECORD_INDEX
+        || header.count*sizeof(RecordInfo)>header.size
+        || offset+sizeof(RecordHeader)+header.size>size-g_footerSize)
+        return false;
+
+    records.resize(header.count);
+    if (header.count)
+        memcpy(&records[0], m_file.data()+offset+sizeof(RecordHeader), header.count*sizeof(RecordInfo));
+    return true;
+}
+
+
+void Reader::scanRecords(std::vector<RecordInfo>& records) const
+{
+    uint64_t offset = g_fileHeaderSize;
+    while (offset+sizeof(RecordHeader)<=m_file.size()) {
+        RecordInfo info;
+        memcpy(&info.header, m_file.data()+offset, sizeof(RecordHeader));
+        info.offset = offset;
+
+        // stop at the first incomplete record
+        if (info.header.magic!=g_recordMagic || offset+sizeof(RecordHeader)+info.header.size>m_file.size())
+            break;
+        if (info.header.type!=RECORD_INDEX)
+            records.push_back(info);
+        offset += sizeof(RecordHeader)+info.header.size;
+    }
+}
+
+} // MeasurementLog
+} // Serialization
+} // Ubitrack
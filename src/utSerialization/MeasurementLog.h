@@ -0,0 +1,359 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Chunked, indexed log files of measurement streams
+ *
+ * A log file holds any number of named measurement streams. The measurements of each
+ * stream are collected into chunks, which are written interleaved as they fill up:
+ * @verbatim
+file   := header { stream | chunk } [ index footer ]
+chunk  := record header, timestamps (uint64 x count), offsets (uint32 x (count + 1)), payloads
+@endverbatim
+ * The payloads use the ROS binary format (see ROSBinarySerialization.h), so fixed-size
+ * math types and lists of them are stored as packed blocks. When the writer is closed, an
+ * index of all records and a footer pointing to it are appended. A file without
+ * index, e.g. after a crash, is still readable; the reader then walks the record headers.
+ *
+ * The reader maps the file into memory and decodes measurements on access. Seeking by
+ * timestamp is a binary search over the chunks followed by one within the chunk, and
+ * payloads of simple types (such as \c Math::Scalar) can be used directly from the mapped
+ * file without copying:
+ * @code
+ * Serialization::MeasurementLog::Writer writer( "session.utlog" );
+ * unsigned id = writer.addStream< Math::Pose >( "ART.Target1" );
+ * writer.write( id, pose );
+ * writer.close();
+ *
+ * Serialization::MeasurementLog::Reader reader( "session.utlog" );
+ * Serialization::MeasurementLog::StreamReader< Math::Pose > poses( reader, "ART.Target1" );
+ * Measurement::Pose m;
+ * poses.read( poses.lowerBound( t ), m );
+ * @endcode
+ *
+ * The files use the byte order of the writing machine.
+ */
+
+#ifndef UBITRACK_MEASUREMENTLOG_H
+#define UBITRACK_MEASUREMENTLOG_H
+
+#include "utSerialization/ROSBinarySerialization.h"
+
+#include <utMeasurement/Measurement.h>
+#include <utUtil/MappedFile.h>
+#include <utUtil/Exception.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <typeinfo>
+#include <algorithm>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/static_assert.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace MeasurementLog {
+
+/// @internal header of each record in the file, followed by \c size bytes of data
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t stream;
+    uint32_t count;
+    /// size of the data following the header (multiple of 8)
+    uint64_t size;
+    /// timestamps of the first and last measurement in a chunk
+    uint64_t first;
+    uint64_t last;
+};
+
+/// @internal a record and its position in the file
+struct RecordInfo {
+    RecordHeader header;
+    uint64_t offset;
+};
+
+/// @internal record types
+enum RecordType {
+  RECORD_STREAM = 1,
+  RECORD_CHUNK = 2,
+  RECORD_INDEX = 3
+};
+
+
+/**
+ * Writes measurement streams into a log file. Measurements are buffered per stream and
+ * written as one chunk when the buffered payload reaches \c chunkSize bytes.
+ *
+ * Not thread-safe, the timestamps of each stream must not decrease.
+ */
+class UBITRACK_EXPORT Writer
+    : private boost::noncopyable
+{
+public:
+    /** creates (or overwrites) the log file \c fileName */
+    Writer(const std::string& fileName, std::size_t chunkSize = 64*1024);
+
+    /** closes the file, if not done before */
+    ~Writer();
+
+    /** adds a stream of payload type \c T and returns its id */
+    template<typename T>
+    unsigned addStream(const std::string& name)
+    {
+        return addStream(name, typeid(T).name());
+    }
+
+    /** appends a measurement with payload to a stream */
+    template<typename T>
+    void write(unsigned stream, const Measurement::Measurement<T>& m)
+    {
+        if (!m)
+            UBITRACK_THROW("Cannot log a measurement without payload");
+        write(stream, m.time(), *m);
+    }
+
+    /** appends a payload with timestamp \c t to a stream */
+    template<typename T>
+    void write(unsigned stream, Measurement::Timestamp t, const T& value)
+    {
+        ROSBinary::LStream length;
+        length.next(value);
+        ROSBinary::OStream out(append(stream, t, length.getLength()), length.getLength());
+        out.next(value);
+        committed(stream);
+    }
+
+    /** writes all buffered measurements to the file */
+    void flush();
+
+    /** flushes all streams, writes the index and closes the file */
+    void close();
+
+protected:
+    struct StreamBuffer;
+
+    unsigned addStream(const std::string& name, const std::string& type);
+
+    /// reserves the space for a measurement of \c size bytes in the buffer of \c stream
+    uint8_t* append(unsigned stream, Measurement::Timestamp t, uint32_t size);
+
+    /// writes the chunk of \c stream if it is full
+    void committed(unsigned stream);
+
+    void writeChunk(StreamBuffer& buffer);
+    void writeRecord(RecordHeader& header, const std::vector<const void*>& parts, const std::vector<std::size_t>& sizes);
+
+    std::ofstream m_file;
+    uint64_t m_offset;
+    std::size_t m_chunkSize;
+    std::vector<StreamBuffer*> m_streams;
+    std::vector<RecordInfo> m_records;
+};
+
+
+/** description of a stream in a log file */
+struct StreamInfo {
+    std::string name;
+    /// compiler specific name of the payload type, for diagnostics only
+    std::string type;
+    /// all chunks of the stream in temporal order
+    std::vector<RecordInfo> chunks;
+};
+
+
+/**
+ * Maps a log file into memory and provides the list of streams.
+ * Throws a \c Util::Exception if the file is not a measurement log.
+ */
+class UBITRACK_EXPORT Reader
+    : private boost::noncopyable
+{
+public:
+    explicit Reader(const std::string& fileName);
+
+    /** number of streams in the file */
+    std::size_t streamCount() const
+    { return m_streams.size(); }
+
+    /** stream by id */
+    const StreamInfo& stream(unsigned id) const;
+
+    /** stream by name, throws if there are none or several with that name */
+    unsigned findStream(const std::string& name) const;
+
+    /** data of the record (after its header) */
+    const uint8_t* recordData(const RecordInfo& record) const
+    { return m_file.data()+record.offset+sizeof(RecordHeader); }
+
+protected:
+    /// reads the index written by the writer, returns false if there is none
+    bool readIndex(std::vector<RecordInfo>& records) const;
+
+    /// walks through all record headers
+    void scanRecords(std::vector<RecordInfo>& records) const;
+
+    Util::MappedFile m_file;
+    std::vector<StreamInfo> m_streams;
+};
+
+
+/**
+ * Random access to the measurements of one stream in a log file. Measurements are
+ * numbered from 0 to size() - 1 in temporal order.
+ */
+template<typename T>
+class StreamReader
+{
+public:
+    typedef Measurement::Measurement<T> MeasurementType;
+
+    /** accesses the stream \c name */
+    StreamReader(const Reader& reader, const std::string& name)
+        : m_reader(reader)
+        , m_info(reader.stream(reader.findStream(name)))
+    {
+        init();
+    }
+
+    /** accesses the stream with the given id */
+    StreamReader(const Reader& reader, unsigned id)
+        : m_reader(reader)
+        , m_info(reader.stream(id))
+    {
+        init();
+    }
+
+    /** number of measurements */
+    std::size_t size() const
+    { return m_firstIndex.back(); }
+
+    /** timestamp of measurement \c i */
+    Measurement::Timestamp time(std::size_t i) const
+    {
+        std::size_t c = chunk(i);
+        return timestamps(c)[i-m_firstIndex[c]];
+    }
+
+    /**
+     * reads measurement \c i. The payload of \c m is overwritten in place if it is not
+     * shared with other measurements.
+     */
+    void read(std::size_t i, MeasurementType& m) const
+    {
+        std::size_t c = chunk(i);
+        std::size_t j = i-m_firstIndex[c];
+        if (!m.unique())
+            m = MeasurementType(timestamps(c)[j], boost::shared_ptr<T>(new T()));
+        else
+            m.time(timestamps(c)[j]);
+
+        const uint32_t* o = offsets(c);
+        ROSBinary::IStream in(const_cast<uint8_t*>(payloads(c)+o[j]), o[j+1]-o[j]);
+        in.next(*m);
+    }
+
+    /** reads and returns measurement \c i */
+    MeasurementType operator[](std::size_t i) const
+    {
+        MeasurementType m;
+        read(i, m);
+        return m;
+    }
+
+    /** index of the first measurement with a timestamp not before \c t, size() if there is none */
+    std::size_t lowerBound(Measurement::Timestamp t) const
+    {
+        // first chunk that ends at or after t
+        std::size_t lo = 0, hi = m_info.chunks.size();
+        while (lo<hi) {
+            std::size_t mid = (lo+hi)/2;
+            if (m_info.chunks[mid].header.last<t)
+                lo = mid+1;
+            else
+                hi = mid;
+        }
+        if (lo==m_info.chunks.size())
+            return size();
+
+        const uint64_t* begin = timestamps(lo);
+        const uint64_t* end = begin+m_info.chunks[lo].header.count;
+        return m_firstIndex[lo]+(std::lower_bound(begin, end, t)-begin);
+    }
+
+    /**
+     * direct pointer to the payload of measurement \c i in the mapped file, only
+     * available for simple types whose stream layout equals their memory layout
+     */
+    const T* data(std::size_t i) const
+    {
+        BOOST_STATIC_ASSERT(Traits::IsSimple<T>::value);
+        std::size_t c = chunk(i);
+        return reinterpret_cast<const T*>(payloads(c)+offsets(c)[i-m_firstIndex[c]]);
+    }
+
+protected:
+    void init()
+    {
+        m_firstIndex.push_back(0);
+        for (std::size_t c = 0; c<m_info.chunks.size(); ++c)
+            m_firstIndex.push_back(m_firstIndex.back()+m_info.chunks[c].header.count);
+    }
+
+    /// chunk containing measurement i
+    std::size_t chunk(std::size_t i) const
+    {
+        if (i>=size())
+            UBITRACK_THROW("Measurement index out of range");
+        return std::upper_bound(m_firstIndex.begin(), m_firstIndex.end(), i)-m_firstIndex.begin()-1;
+    }
+
+    const uint64_t* timestamps(std::size_t c) const
+    { return reinterpret_cast<const uint64_t*>(m_reader.recordData(m_info.chunks[c])); }
+
+    const uint32_t* offsets(std::size_t c) const
+    { return reinterpret_cast<const uint32_t*>(timestamps(c)+m_info.chunks[c].header.count); }
+
+    const uint8_t* payloads(std::size_t c) const
+    {
+        const std::size_t n = m_info.chunks[c].header.count+1;
+        return reinterpret_cast<const uint8_t*>(offsets(c))+((n*sizeof(uint32_t)+7) & ~std::size_t(7));
+    }
+
+    const Reader& m_reader;
+    const StreamInfo& m_info;
+    /// index of the first measurement of each chunk, and the total count
+    std::vector<std::size_t> m_firstIndex;
+};
+
+} // MeasurementLog
+} // Serialization
+} // Ubitrack
+
+#endif //UBITRACK_MEASUREMENTLOG_H
@@ -0,0 +1,348 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Direct deserialization of msgpack encoded measurements
+ *
+ * The adaptors in MsgpackSerializer.h first unpack a message into a tree of
+ * \c msgpack::object and then convert the tree element by element. For large lists
+ * (e.g. a \c PoseList with thousands of poses) this costs one zone allocation per
+ * element and a second copy of all data.
+ *
+ * \c MsgpackArchive::deserializeDirect decodes the wire format written by
+ * \c MsgpackArchive::serialize straight into the destination. If the destination
+ * measurement already holds a payload that is not shared with other measurements,
+ * the payload is overwritten in place, and lists keep their capacity, so a
+ * measurement that is reused across messages needs no allocation in steady state:
+ * @code
+ * Measurement::PoseList poses;
+ * while ( receive( buffer ) )
+ *     MsgpackArchive::deserializeDirect( buffer.data(), buffer.size(), poses );
+ * @endcode
+ *
+ * Supported payloads are arithmetic types, \c Math::Scalar, fixed-size \c Math::Vector and
+ * \c Math::Matrix, \c Math::Quaternion, \c Math::Pose, \c std::vector of those and
+ * \c Measurement::Measurement of all of them. This reader has no dependency on the
+ * msgpack library.
+ */
+
+#ifndef UBITRACK_MSGPACKDIRECTREADER_H
+#define UBITRACK_MSGPACKDIRECTREADER_H
+
+#include "utSerialization/Exception.h"
+
+#include "utMeasurement/Measurement.h"
+
+#include <cstring>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/utility/enable_if.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_floating_point.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace MsgpackArchive {
+
+/**
+ * Sequential reader of the msgpack wire format on a contiguous buffer.
+ * Throws \c StreamOverrunException if the buffer ends within an element and
+ * \c Util::Exception if an element does not have the expected type.
+ */
+class DirectReader
+{
+public:
+	DirectReader( const char* data, std::size_t size )
+		: m_begin( reinterpret_cast< const unsigned char* >( data ) )
+		, m_pos( m_begin )
+		, m_end( m_begin + size )
+	{}
+
+	/** number of bytes read so far */
+	std::size_t consumed() const
+	{ return m_pos - m_begin; }
+
+	/** skips a nil element and returns true, if the next element is nil */
+	bool readNil()
+	{
+		if ( *require( 1 ) != 0xc0 )
+			return false;
+		++m_pos;
+		return true;
+	}
+
+	/** reads the header of an array and returns the number of elements */
+	std::size_t readArrayHeader()
+	{
+		const unsigned char tag = *require( 1 );
+		if ( ( tag & 0xf0 ) == 0x90 )
+		{
+			++m_pos;
+			return tag & 0x0f;
+		}
+		if ( tag == 0xdc )
+			return static_cast< std::size_t >( readBigEndian( 2 ) );
+		if ( tag == 0xdd )
+			return static_cast< std::size_t >( readBigEndian( 4 ) );
+		UBITRACK_THROW( "msgpack: expected an array" );
+	}
+
+	/** reads the header of an array that must have \c n elements */
+	void readArrayHeader( const std::size_t n )
+	{
+		if ( readArrayHeader() != n )
+			UBITRACK_THROW( "msgpack: array has a wrong number of elements" );
+	}
+
+	/** reads a floating point or integer element as double */
+	double readDouble()
+	{
+		const unsigned char tag = *require( 1 );
+		if ( tag == 0xcb )
+		{
+			const boost::uint64_t bits = readBigEndian( 8 );
+			double d;
+			std::memcpy( &d, &bits, sizeof( d ) );
+			return d;
+		}
+		if ( tag == 0xca )
+		{
+			const boost::uint32_t bits = static_cast< boost::uint32_t >( readBigEndian( 4 ) );
+			float f;
+			std::memcpy( &f, &bits, sizeof( f ) );
+			return f;
+		}
+		return static_cast< double >( readInteger() );
+	}
+
+	/** reads a signed or unsigned integer element */
+	boost::int64_t readInteger()
+	{
+		const unsigned char tag = *require( 1 );
+		if ( tag <= 0x7f )
+		{
+			++m_pos;
+			return tag;
+		}
+		if ( tag >= 0xe0 )
+		{
+			++m_pos;
+			return static_cast< signed char >( tag );
+		}
+		switch ( tag )
+		{
+			case 0xcc: return static_cast< boost::int64_t >( readBigEndian( 1 ) );
+			case 0xcd: return static_cast< boost::int64_t >( readBigEndian( 2 ) );
+			case 0xce: return static_cast< boost::int64_t >( readBigEndian( 4 ) );
+			case 0xcf: return static_cast< boost::int64_t >( readBigEndian( 8 ) );
+			case 0xd0: return static_cast< boost::int8_t >( readBigEndian( 1 ) );
+			case 0xd1: return static_cast< boost::int16_t >( readBigEndian( 2 ) );
+			case 0xd2: return static_cast< boost::int32_t >( readBigEndian( 4 ) );
+			case 0xd3: return static_cast< boost::int64_t >( readBigEndian( 8 ) );
+		}
+		UBITRACK_THROW( "msgpack: expected a number" );
+	}
+
+	/** reads an unsigned integer element, e.g. a timestamp */
+	boost::uint64_t readUnsigned()
+	{
+		// uint64 values above the signed range are only representable as 0xcf
+		if ( *require( 1 ) == 0xcf )
+			return readBigEndian( 8 );
+		return static_cast< boost::uint64_t >( readInteger() );
+	}
+
+protected:
+	/// returns the current position, after checking that n more bytes are available
+	const unsigned char* require( const std::size_t n ) const
+	{
+		if ( static_cast< std::size_t >( m_end - m_pos ) < n )
+			throw StreamOverrunException( "msgpack: buffer ends within an element" );
+		return m_pos;
+	}
+
+	/// skips the type tag and reads a big endian number of n bytes
+	boost::uint64_t readBigEndian( const std::size_t n )
+	{
+		const unsigned char* p = require( n + 1 ) + 1;
+		boost::uint64_t v = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			v = ( v << 8 ) | p[ i ];
+		m_pos = p + n;
+		return v;
+	}
+
+	const unsigned char* m_begin;
+	const unsigned char* m_pos;
+	const unsigned char* m_end;
+};
+
+
+/**
+ * decodes one element of type \c T in place, specialized for all supported types
+ */
+template< typename T, typename Enable = void >
+struct DirectFormat;
+
+/// @internal floating point types
+template< typename T >
+struct DirectFormat< T, typename boost::enable_if_c< boost::is_floating_point< T >::value >::type >
+{
+	static void read( DirectReader& r, T& v )
+	{ v = static_cast< T >( r.readDouble() ); }
+};
+
+/// @internal integer types
+template< typename T >
+struct DirectFormat< T, typename boost::enable_if_c< boost::is_integral< T >::value >::type >
+{
+	static void read( DirectReader& r, T& v )
+	{ v = static_cast< T >( r.readUnsigned() ); }
+};
+
+/// @internal Math::Scalar
+template< typename T >
+struct DirectFormat< Math::Scalar< T > >
+{
+	static void read( DirectReader& r, Math::Scalar< T >& v )
+	{ DirectFormat< T >::read( r, v.m_value ); }
+};
+
+/// @internal fixed size Math::Vector
+template< typename T, std::size_t N >
+struct DirectFormat< Math::Vector< T, N > >
+{
+	static void read( DirectReader& r, Math::Vector< T, N >& v )
+	{
+		const std::size_t n = r.readArrayHeader();
+		if ( N == 0 )
+			v.resize( n );
+		else if ( n != N )
+			UBITRACK_THROW( "msgpack: vector has a wrong number of elements" );
+		for ( std::size_t i = 0; i < n; i++ )
+			DirectFormat< T >::read( r, v( i ) );
+	}
+};
+
+/// @internal fixed size Math::Matrix, same element order as the packer
+template< typename T, std::size_t M, std::size_t N >
+struct DirectFormat< Math::Matrix< T, M, N > >
+{
+	static void read( DirectReader& r, Math::Matrix< T, M, N >& v )
+	{
+		r.readArrayHeader( M * N );
+		for ( std::size_t i = 0; i < M; i++ )
+			for ( std::size_t j = 0; j < N; j++ )
+				DirectFormat< T >::read( r, v( i, j ) );
+	}
+};
+
+/// @internal Math::Quaternion as [ x, y, z, w ]
+template<>
+struct DirectFormat< Math::Quaternion >
+{
+	static void read( DirectReader& r, Math::Quaternion& v )
+	{
+		r.readArrayHeader( 4 );
+		const double x = r.readDouble();
+		const double y = r.readDouble();
+		const double z = r.readDouble();
+		const double w = r.readDouble();
+		v = Math::Quaternion( x, y, z, w );
+	}
+};
+
+/// @internal Math::Pose as [ rotation, translation ]
+template<>
+struct DirectFormat< Math::Pose >
+{
+	static void read( DirectReader& r, Math::Pose& v )
+	{
+		r.readArrayHeader( 2 );
+		Math::Quaternion q;
+		Math::Vector< double, 3 > t;
+		DirectFormat< Math::Quaternion >::read( r, q );
+		DirectFormat< Math::Vector< double, 3 > >::read( r, t );
+		v = Math::Pose( q, t );
+	}
+};
+
+/// @internal lists, the existing capacity is reused
+template< typename T >
+struct DirectFormat< std::vector< T > >
+{
+	static void read( DirectReader& r, std::vector< T >& v )
+	{
+		v.resize( r.readArrayHeader() );
+		for ( typename std::vector< T >::iterator it = v.begin(); it != v.end(); ++it )
+			DirectFormat< T >::read( r, *it );
+	}
+};
+
+/// @internal measurements as [ timestamp, payload ] or nil
+template< typename T >
+struct DirectFormat< Measurement::Measurement< T > >
+{
+	static void read( DirectReader& r, Measurement::Measurement< T >& v )
+	{
+		if ( r.readNil() )
+		{
+			v.invalidate();
+			v.reset();
+			return;
+		}
+
+		r.readArrayHeader( 2 );
+		const Measurement::Timestamp t = r.readUnsigned();
+
+		// never overwrite a payload that other measurements refer to
+		if ( !v.unique() )
+			v = Measurement::Measurement< T >( t, boost::shared_ptr< T >( new T() ) );
+		else
+			v.time( t );
+		DirectFormat< T >::read( r, *v );
+	}
+};
+
+
+/**
+ * \brief Deserialize an object directly from a buffer containing msgpack data.
+ * @return the number of bytes read
+ */
+template< typename T >
+inline std::size_t deserializeDirect( const char* data, std::size_t size, T& t )
+{
+	DirectReader reader( data, size );
+	DirectFormat< T >::read( reader, t );
+	return reader.consumed();
+}
+
+} // MsgpackArchive
+} // Serialization
+} // Ubitrack
+
+#endif //UBITRACK_MSGPACKDIRECTREADER_H
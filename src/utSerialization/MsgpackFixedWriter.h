@@ -0,0 +1,345 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Msgpack encoding of fixed-size math types
+ *
+ * The msgpack encoding of a fixed-size math type of floating point numbers has a length
+ * known at compile time: the array headers depend only on the dimensions, and every
+ * \c double takes 9 bytes. \c FixedFormat<T>::length is this length, or 0 for types of
+ * variable length, and \c FixedFormat<T>::write encodes a value into a buffer of that length.
+ * The packer adaptors in MsgpackSerializer.h use it to append a whole \c Math::ErrorPose as
+ * one block instead of packing 47 elements one by one.
+ *
+ * The encoding is the same as that of the generic adaptors, so it can be read by the msgpack
+ * unpacker and by \c deserializeDirect. This writer has no dependency on the msgpack library.
+ */
+
+#ifndef UBITRACK_MSGPACKFIXEDWRITER_H
+#define UBITRACK_MSGPACKFIXEDWRITER_H
+
+#include "utMeasurement/Measurement.h"
+
+#include <cstring>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace MsgpackArchive {
+
+/**
+ * Sequential writer of the msgpack wire format into a buffer that is large enough.
+ */
+class FixedWriter
+{
+public:
+	explicit FixedWriter( char* data )
+		: m_begin( reinterpret_cast< unsigned char* >( data ) )
+		, m_pos( m_begin )
+	{}
+
+	/** number of bytes written so far */
+	std::size_t written() const
+	{ return m_pos - m_begin; }
+
+	/** writes the header of an array of \c n elements */
+	void writeArrayHeader( const std::size_t n )
+	{
+		if ( n < 16 )
+			*m_pos++ = static_cast< unsigned char >( 0x90 | n );
+		else if ( n < 0x10000 )
+		{
+			*m_pos++ = 0xdc;
+			writeBigEndian( n, 2 );
+		}
+		else
+		{
+			*m_pos++ = 0xdd;
+			writeBigEndian( n, 4 );
+		}
+	}
+
+	/** writes a double as float 64 element */
+	void writeDouble( const double v )
+	{
+		boost::uint64_t bits;
+		std::memcpy( &bits, &v, sizeof( bits ) );
+		*m_pos++ = 0xcb;
+		writeBigEndian( bits, 8 );
+	}
+
+	/** writes a float as float 32 element */
+	void writeFloat( const float v )
+	{
+		boost::uint32_t bits;
+		std::memcpy( &bits, &v, sizeof( bits ) );
+		*m_pos++ = 0xca;
+		writeBigEndian( bits, 4 );
+	}
+
+protected:
+	void writeBigEndian( const boost::uint64_t v, const std::size_t n )
+	{
+		for ( std::size_t i = n; i > 0; i-- )
+			*m_pos++ = static_cast< unsigned char >( v >> ( 8 * ( i - 1 ) ) );
+	}
+
+	unsigned char* m_begin;
+	unsigned char* m_pos;
+};
+
+
+/** length of the header of an array with \c n elements */
+inline std::size_t arrayHeaderLength( const std::size_t n )
+{ return n < 16 ? 1 : n < 0x10000 ? 3 : 5; }
+
+/// @internal compile time version of arrayHeaderLength
+template< std::size_t N >
+struct ArrayHeaderLength
+{
+	static const std::size_t value = N < 16 ? 1 : N < 0x10000 ? 3 : 5;
+};
+
+
+/**
+ * encodes a value of fixed length, specialized for all supported types. Types of
+ * variable length have \c length 0 and no \c write.
+ */
+template< typename T >
+struct FixedFormat
+{
+	static const std::size_t length = 0;
+};
+
+/// @internal double
+template<>
+struct FixedFormat< double >
+{
+	static const std::size_t length = 9;
+
+	static void write( FixedWriter& w, const double v )
+	{ w.writeDouble( v ); }
+};
+
+/// @internal float
+template<>
+struct FixedFormat< float >
+{
+	static const std::size_t length = 5;
+
+	static void write( FixedWriter& w, const float v )
+	{ w.writeFloat( v ); }
+};
+
+/// @internal Math::Scalar
+template< typename T >
+struct FixedFormat< Math::Scalar< T > >
+{
+	static const std::size_t length = FixedFormat< T >::length;
+
+	static void write( FixedWriter& w, const Math::Scalar< T >& v )
+	{ FixedFormat< T >::write( w, v.m_value ); }
+};
+
+/// @internal fixed size Math::Vector
+template< typename T, std::size_t N >
+struct FixedFormat< Math::Vector< T, N > >
+{
+	static const std::size_t length = N > 0 && FixedFormat< T >::length > 0 ?
+		ArrayHeaderLength< N >::value + N * FixedFormat< T >::length : 0;
+
+	static void write( FixedWriter& w, const Math::Vector< T, N >& v )
+	{
+		w.writeArrayHeader( N );
+		for ( std::size_t i = 0; i < N; i++ )
+			FixedFormat< T >::write( w, v( i ) );
+	}
+};
+
+/// @internal fixed size Math::Matrix, row by row
+template< typename T, std::size_t M, std::size_t N >
+struct FixedFormat< Math::Matrix< T, M, N > >
+{
+	static const std::size_t length = M * N > 0 && FixedFormat< T >::length > 0 ?
+		ArrayHeaderLength< M * N >::value + M * N * FixedFormat< T >::length : 0;
+
+	static void write( FixedWriter& w, const Math::Matrix< T, M, N >& v )
+	{
+		w.writeArrayHeader( M * N );
+		for ( std::size_t i = 0; i < M; i++ )
+			for ( std::size_t j = 0; j < N; j++ )
+				FixedFormat< T >::write( w, v( i, j ) );
+	}
+};
+
+/// @internal Math::Quaternion as [ x, y, z, w ]
+template<>
+struct FixedFormat< Math::Quaternion >
+{
+	static const std::size_t length = 1 + 4 * 9;
+
+	static void write( FixedWriter& w, const Math::Quaternion& v )
+	{
+		w.writeArrayHeader( 4 );
+		w.writeDouble( v.x() );
+		w.writeDouble( v.y() );
+		w.writeDouble( v.z() );
+		w.writeDouble( v.w() );
+	}
+};
+
+/// @internal Math::Pose as [ rotation, translation ]
+template<>
+struct FixedFormat< Math::Pose >
+{
+	static const std::size_t length = 1 + FixedFormat< Math::Quaternion >::length + FixedFormat< Math::Vector< double, 3 > >::length;
+
+	static void write( FixedWriter& w, const Math::Pose& v )
+	{
+		w.writeArrayHeader( 2 );
+		FixedFormat< Math::Quaternion >::write( w, v.rotation() );
+		FixedFormat< Math::Vector< double, 3 > >::write( w, v.translation() );
+	}
+};
+
+/// @internal Math::ErrorVector as [ value, covariance ]
+template< typename T, std::size_t N >
+struct FixedFormat< Math::ErrorVector< T, N > >
+{
+	static const std::size_t length = FixedFormat< Math::Vector< T, N > >::length > 0 ?
+		1 + FixedFormat< Math::Vector< T, N > >::length + FixedFormat< Math::Matrix< T, N, N > >::length : 0;
+
+	static void write( FixedWriter& w, const Math::ErrorVector< T, N >& v )
+	{
+		w.writeArrayHeader( 2 );
+		FixedFormat< Math::Vector< T, N > >::write( w, v.value );
+		FixedFormat< Math::Matrix< T, N, N > >::write( w, v.covariance );
+	}
+};
+
+/// @internal Math::ErrorPose as [ rotation, translation, covariance ]
+template<>
+struct FixedFormat< Math::ErrorPose >
+{
+	static const std::size_t length = 1 + FixedFormat< Math::Quaternion >::length
+		+ FixedFormat< Math::Vector< double, 3 > >::length + FixedFormat< Math::Matrix< double, 6, 6 > >::length;
+
+	static void write( FixedWriter& w, const Math::ErrorPose& v )
+	{
+		w.writeArrayHeader( 3 );
+		FixedFormat< Math::Quaternion >::write( w, v.rotation() );
+		FixedFormat< Math::Vector< double, 3 > >::write( w, v.translation() );
+		FixedFormat< Math::Matrix< double, 6, 6 > >::write( w, v.covariance() );
+	}
+};
+
+/// @internal Math::PackedCovariance as array of its upper triangle
+template< typename T, std::size_t N >
+struct FixedFormat< Math::PackedCovariance< T, N > >
+{
+	static const std::size_t packedSize = Math::PackedCovariance< T, N >::packedSize;
+	static const std::size_t length = FixedFormat< T >::length > 0 ?
+		ArrayHeaderLength< packedSize >::value + packedSize * FixedFormat< T >::length : 0;
+
+	static void write( FixedWriter& w, const Math::PackedCovariance< T, N >& v )
+	{
+		w.writeArrayHeader( packedSize );
+		for ( std::size_t i = 0; i < packedSize; i++ )
+			FixedFormat< T >::write( w, v.data()[ i ] );
+	}
+};
+
+/// @internal Math::PackedErrorVector as [ value, packed covariance ]
+template< typename T, std::size_t N, typename C >
+struct FixedFormat< Math::PackedErrorVector< T, N, C > >
+{
+	static const std::size_t length = FixedFormat< Math::Vector< T, N > >::length > 0 && FixedFormat< Math::PackedCovariance< C, N > >::length > 0 ?
+		1 + FixedFormat< Math::Vector< T, N > >::length + FixedFormat< Math::PackedCovariance< C, N > >::length : 0;
+
+	static void write( FixedWriter& w, const Math::PackedErrorVector< T, N, C >& v )
+	{
+		w.writeArrayHeader( 2 );
+		FixedFormat< Math::Vector< T, N > >::write( w, v.value );
+		FixedFormat< Math::PackedCovariance< C, N > >::write( w, v.covariance );
+	}
+};
+
+/// @internal Math::PackedErrorPose as [ rotation, translation, packed covariance ]
+template< typename C >
+struct FixedFormat< Math::PackedErrorPose< C > >
+{
+	static const std::size_t length = 1 + FixedFormat< Math::Quaternion >::length
+		+ FixedFormat< Math::Vector< double, 3 > >::length + FixedFormat< Math::PackedCovariance< C, 6 > >::length;
+
+	static void write( FixedWriter& w, const Math::PackedErrorPose< C >& v )
+	{
+		w.writeArrayHeader( 3 );
+		FixedFormat< Math::Quaternion >::write( w, v.rotation() );
+		FixedFormat< Math::Vector< double, 3 > >::write( w, v.translation() );
+		FixedFormat< Math::PackedCovariance< C, 6 > >::write( w, v.packedCovariance() );
+	}
+};
+
+
+/**
+ * maximum length of the msgpack encoding of a value, 0 if it is not known in advance.
+ * Exact for fixed-size types and lists of them.
+ */
+template< typename T >
+struct FixedLength
+{
+	static std::size_t get( const T& )
+	{ return FixedFormat< T >::length; }
+};
+
+/// @internal lists of fixed-size types
+template< typename T >
+struct FixedLength< std::vector< T > >
+{
+	static std::size_t get( const std::vector< T >& v )
+	{ return FixedFormat< T >::length > 0 ? arrayHeaderLength( v.size() ) + v.size() * FixedFormat< T >::length : 0; }
+};
+
+/// @internal measurements, with up to 9 bytes for the timestamp
+template< typename T >
+struct FixedLength< Measurement::Measurement< T > >
+{
+	static std::size_t get( const Measurement::Measurement< T >& m )
+	{
+		if ( !m )
+			return 1;
+		const std::size_t payload = FixedLength< T >::get( *m );
+		return payload > 0 ? 1 + 9 + payload : 0;
+	}
+};
+
+} // MsgpackArchive
+} // Serialization
+} // Ubitrack
+
+#endif //UBITRACK_MSGPACKFIXEDWRITER_H
@@ -38,11 +38,14 @@
 
 #include "utSerialization/BaseSerializer.h"
 #include "utSerialization/SerializationFormat.h"
+#include "utSerialization/MsgpackDirectReader.h"
+#include "utSerialization/MsgpackFixedWriter.h"
 
 #include "utMeasurement/Measurement.h"
 
 #include <boost/array.hpp>
 #include <boost/call_traits.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 #include <boost/utility/enable_if.hpp>
 
 #ifdef HAVE_MSGPACK
@@ -80,13 +83,80 @@ struct MsgpackSerializationFormat {
   }
 
 
+  /// exact for fixed-size math types and lists of them, 0 if the length is not known in advance
   inline static uint32_t maxSerializedLength(typename boost::call_traits<T>::param_type t)
   {
-      return 0;
+      return (uint32_t) FixedLength<T>::get(t);
   }
 };
 
 
+/**
+ * \brief Append the encoding of a fixed-size type to a packer as one block, see MsgpackFixedWriter.h
+ */
+template<typename T, typename Stream>
+inline void packFixed(msgpack::packer<Stream>& o, const T& v)
+{
+    char buffer[FixedFormat<T>::length];
+    FixedWriter writer(buffer);
+    FixedFormat<T>::write(writer, v);
+    // the body of a bin element is appended to the stream as it is
+    o.pack_bin_body(buffer, (uint32_t) FixedFormat<T>::length);
+}
+
+/// @internal the elements of an array object, which must have n elements
+inline const msgpack::object* arrayElements(msgpack::object const& o, std::size_t n)
+{
+    if (o.type!=msgpack::type::ARRAY || o.via.array.size!=n) throw msgpack::type_error();
+    return o.via.array.ptr;
+}
+
+/// @internal converts an element of a fixed-size type
+template<typename T>
+inline void convertElement(msgpack::object const& o, T& v)
+{
+    msgpack::adaptor::convert<T>()(o, v);
+}
+
+/// @internal floating point elements without the generic conversion
+inline void convertElement(msgpack::object const& o, double& v)
+{
+    switch (o.type) {
+    case msgpack::type::FLOAT64:
+    case msgpack::type::FLOAT32:
+        v = o.via.f64;
+        break;
+    case msgpack::type::POSITIVE_INTEGER:
+        v = (double) o.via.u64;
+        break;
+    case msgpack::type::NEGATIVE_INTEGER:
+        v = (double) o.via.i64;
+        break;
+    default:
+        throw msgpack::type_error();
+    }
+}
+
+inline void convertElement(msgpack::object const& o, float& v)
+{
+    double d;
+    convertElement(o, d);
+    v = (float) d;
+}
+
+/// @internal converts a quaternion [ x, y, z, w ]
+inline void convertQuaternion(msgpack::object const& o, Math::Quaternion& v)
+{
+    const msgpack::object* p = arrayElements(o, 4);
+    double x, y, z, w;
+    convertElement(p[0], x);
+    convertElement(p[1], y);
+    convertElement(p[2], z);
+    convertElement(p[3], w);
+    v = Math::Quaternion(x, y, z, w);
+}
+
+
 /**
  * \brief Serialize an object.  Stream here should normally be a boost::archive::binary_oarchive
  */
@@ -105,6 +175,17 @@ inline void deserialize(Stream& stream, T& t)
     BaseSerializer<T, MsgpackSerializationFormat<T> >::read(stream, t);
 }
 
+/**
+ * \brief Deserialize an object from the unparsed data of an unpacker without building a
+ * msgpack::object tree, see MsgpackDirectReader.h
+ */
+template<typename T>
+inline void deserializeDirect(msgpack::unpacker& pac, T& t)
+{
+    std::size_t consumed = deserializeDirect(pac.nonparsed_buffer(), pac.nonparsed_size(), t);
+    pac.skip_nonparsed_buffer(consumed);
+}
+
 /**
  * \brief Determine the serialized length of an object
  */
@@ -271,9 +352,11 @@ struct convert<Ubitrack::Math::Vector<T, N> > {
       if (N>0) {
           if (num_elements!=N) throw msgpack::type_error();
       }
+      else {
+          v.resize(num_elements);
+      }
       for (std::size_t i = 0; i<num_elements; ++i) {
-		  msgpack::adaptor::convert<T>()(o.via.array.ptr[i], v(i));
-          //v(i) = o.via.array.ptr[i].as<T>();
+          Ubitrack::Serialization::MsgpackArchive::convertElement(o.via.array.ptr[i], v(i));
       }
       return o;
   }
@@ -283,6 +366,20 @@ template<typename T, std::size_t N>
 struct pack<Ubitrack::Math::Vector<T, N> > {
   template<typename Stream>
   msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::Vector<T, N>& v) const
+  {
+      write(o, v, boost::integral_constant<bool, (Ubitrack::Serialization::MsgpackArchive::FixedFormat<Ubitrack::Math::Vector<T, N> >::length>0)>());
+      return o;
+  }
+
+  /// fixed-size vectors of floating point numbers in one block
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::Vector<T, N>& v, boost::true_type)
+  {
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
+  }
+
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::Vector<T, N>& v, boost::false_type)
   {
       std::size_t num_elements = N;
       if (num_elements == 0) {
@@ -292,7 +389,6 @@ struct pack<Ubitrack::Math::Vector<T, N> > {
       for (std::size_t i = 0; i<num_elements; ++i) {
           o.pack(v(i));
       }
-      return o;
   }
 };
 
@@ -309,14 +405,14 @@ struct object_with_zone<Ubitrack::Math::Vector<T, N> > {
       o.via.array.ptr = static_cast<msgpack::object*>(
               o.zone.allocate_align(sizeof(msgpack::object)*o.via.array.size));
       for (std::size_t i = 0; i<num_elements; ++i) {
-          o.via.array.ptr[0] = msgpack::object(v(i), o.zone);
+          o.via.array.ptr[i] = msgpack::object(v(i), o.zone);
       }
   }
 };
 
 
 /*
- * Ubitrack::Math::Matrix<T, M, N>
+ * Ubitrack::Math::Matrix<T, M, N>, row by row
  */
 #if !defined(MSGPACK_USE_CPP03)
 template<typename T, std::size_t M, std::size_t N>
@@ -334,7 +430,7 @@ struct as<Ubitrack::Math::Matrix<T, M, N>, typename std::enable_if<msgpack::has_
       Ubitrack::Math::Matrix<T, M, N> result(M, N);
       for (std::size_t i = 0; i<M; ++i) {
           for (std::size_t j = 0; j<N; ++j) {
-              std::size_t idx = i*M + j;
+              std::size_t idx = i*N + j;
               result(i,j) = o.via.array.ptr[idx].as<T>();
           }
       }
@@ -347,19 +443,14 @@ template<typename T, std::size_t M, std::size_t N>
 struct convert<Ubitrack::Math::Matrix<T, M, N> > {
   msgpack::object const& operator()(msgpack::object const& o, Ubitrack::Math::Matrix<T, M, N>& v) const
   {
-      if (o.type!=msgpack::type::ARRAY) throw msgpack::type_error();
-      std::size_t num_elements = o.via.array.size;
-      if ((M>0) && (N>0)) {
-          if (num_elements!=M*N) throw msgpack::type_error();
-      } else {
+      if ((M==0) || (N==0)) {
           // cannot unpack dynamically sized matrix without knowing dimensions ...
           throw msgpack::type_error();
       }
+      const msgpack::object* p = Ubitrack::Serialization::MsgpackArchive::arrayElements(o, M*N);
       for (std::size_t i = 0; i<M; ++i) {
           for (std::size_t j = 0; j<N; ++j) {
-              std::size_t idx = i*M + j;
-			  msgpack::adaptor::convert<T>()(o.via.array.ptr[idx], v(i, j));
-              //v(i,j) = o.via.array.ptr[idx].as<T>();
+              Ubitrack::Serialization::MsgpackArchive::convertElement(*p++, v(i, j));
           }
       }
       return o;
@@ -370,6 +461,20 @@ template<typename T, std::size_t M, std::size_t N>
 struct pack<Ubitrack::Math::Matrix<T, M, N> > {
   template<typename Stream>
   msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::Matrix<T, M, N>& v) const
+  {
+      write(o, v, boost::integral_constant<bool, (Ubitrack::Serialization::MsgpackArchive::FixedFormat<Ubitrack::Math::Matrix<T, M, N> >::length>0)>());
+      return o;
+  }
+
+  /// fixed-size matrices of floating point numbers in one block
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::Matrix<T, M, N>& v, boost::true_type)
+  {
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
+  }
+
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::Matrix<T, M, N>& v, boost::false_type)
   {
       std::size_t num_elements = M*N;
       if (num_elements == 0) {
@@ -379,11 +484,9 @@ struct pack<Ubitrack::Math::Matrix<T, M, N> > {
       o.pack_array((uint32_t)num_elements);
       for (std::size_t i = 0; i<M; ++i) {
           for (std::size_t j = 0; j<N; ++j) {
-              std::size_t idx = i*M + j;
               o.pack(v(i,j));
           }
       }
-      return o;
   }
 };
 
@@ -402,7 +505,7 @@ struct object_with_zone<Ubitrack::Math::Matrix<T, M, N> > {
               o.zone.allocate_align(sizeof(msgpack::object)*o.via.array.size));
       for (std::size_t i = 0; i<M; ++i) {
           for (std::size_t j = 0; j<N; ++j) {
-              std::size_t idx = i*M + j;
+              std::size_t idx = i*N + j;
               o.via.array.ptr[idx] = msgpack::object(v(i,j), o.zone);
           }
       }
@@ -421,18 +524,18 @@ template<>
 struct as<Ubitrack::Math::Quaternion> {
   Ubitrack::Math::Quaternion operator()(msgpack::object const& o) const
   {
-      return Ubitrack::Math::Quaternion::fromVector(o.as<Ubitrack::Math::Vector<double, 4> >());
+      Ubitrack::Math::Quaternion q;
+      Ubitrack::Serialization::MsgpackArchive::convertQuaternion(o, q);
+      return q;
   }
 };
-#endif 
+#endif
 
 template<>
 struct convert<Ubitrack::Math::Quaternion > {
   msgpack::object const& operator()(msgpack::object const& o, Ubitrack::Math::Quaternion& v) const
   {
-	  Ubitrack::Math::Vector<double, 4> vec;
-	  msgpack::adaptor::convert<Ubitrack::Math::Vector<double, 4> >()(o, vec);
-      v = Ubitrack::Math::Quaternion::fromVector(vec);
+      Ubitrack::Serialization::MsgpackArchive::convertQuaternion(o, v);
       return o;
   }
 };
@@ -442,9 +545,7 @@ struct pack<Ubitrack::Math::Quaternion > {
   template<typename Stream>
   msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::Quaternion& v) const
   {
-      Ubitrack::Math::Vector<double, 4> vec;
-      v.toVector(vec);
-      o.pack(vec);
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
       return o;
   }
 };
@@ -539,12 +640,11 @@ template<>
 struct convert<Ubitrack::Math::Pose > {
   msgpack::object const& operator()(msgpack::object const& o, Ubitrack::Math::Pose& v) const
   {
-      if (o.type!=msgpack::type::ARRAY) throw msgpack::type_error();
-      if (o.via.array.size != 2) throw msgpack::type_error();
+      const msgpack::object* p = Ubitrack::Serialization::MsgpackArchive::arrayElements(o, 2);
 	  Ubitrack::Math::Quaternion quat;
 	  Ubitrack::Math::Vector<double, 3> vec;
-	  msgpack::adaptor::convert<Ubitrack::Math::Quaternion>()(o.via.array.ptr[0], quat);
-	  msgpack::adaptor::convert<Ubitrack::Math::Vector<double, 3> >()(o.via.array.ptr[1], vec);
+	  Ubitrack::Serialization::MsgpackArchive::convertQuaternion(p[0], quat);
+	  msgpack::adaptor::convert<Ubitrack::Math::Vector<double, 3> >()(p[1], vec);
       v = Ubitrack::Math::Pose(quat, vec);
       return o;
   }
@@ -555,9 +655,7 @@ struct pack<Ubitrack::Math::Pose > {
   template<typename Stream>
   msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::Pose& v) const
   {
-      o.pack_array(2);
-      o.pack(v.rotation());
-      o.pack(v.translation());
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
       return o;
   }
 };
@@ -599,13 +697,9 @@ template<typename T, std::size_t N>
 struct convert<Ubitrack::Math::ErrorVector<T, N> > {
   msgpack::object const& operator()(msgpack::object const& o, Ubitrack::Math::ErrorVector<T, N>& v) const
   {
-      if (o.type!=msgpack::type::ARRAY) throw msgpack::type_error();
-      if (o.via.array.size != 2) throw msgpack::type_error();
-	  Ubitrack::Math::Vector<T, N> vec;
-	  Ubitrack::Math::Matrix<T, N, N> cov;
-	  msgpack::adaptor::convert<Ubitrack::Math::Vector<T, N> >()(o.via.array.ptr[0], vec);
-	  msgpack::adaptor::convert<Ubitrack::Math::Matrix<T, N, N> >()(o.via.array.ptr[1], cov);
-      v = Ubitrack::Math::ErrorVector<T, N>(vec, cov);
+      const msgpack::object* p = Ubitrack::Serialization::MsgpackArchive::arrayElements(o, 2);
+	  msgpack::adaptor::convert<Ubitrack::Math::Vector<T, N> >()(p[0], v.value);
+	  msgpack::adaptor::convert<Ubitrack::Math::Matrix<T, N, N> >()(p[1], v.covariance);
       return o;
   }
 };
@@ -614,11 +708,24 @@ template<typename T, std::size_t N>
 struct pack<Ubitrack::Math::ErrorVector<T, N> > {
   template<typename Stream>
   msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::ErrorVector<T, N>& v) const
+  {
+      write(o, v, boost::integral_constant<bool, (Ubitrack::Serialization::MsgpackArchive::FixedFormat<Ubitrack::Math::ErrorVector<T, N> >::length>0)>());
+      return o;
+  }
+
+  /// fixed-size vectors of floating point numbers in one block
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::ErrorVector<T, N>& v, boost::true_type)
+  {
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
+  }
+
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::ErrorVector<T, N>& v, boost::false_type)
   {
       o.pack_array(2);
       o.pack(v.value);
       o.pack(v.covariance);
-      return o;
   }
 };
 
@@ -660,14 +767,13 @@ template<>
 struct convert<Ubitrack::Math::ErrorPose > {
   msgpack::object const& operator()(msgpack::object const& o, Ubitrack::Math::ErrorPose& v) const
   {
-      if (o.type!=msgpack::type::ARRAY) throw msgpack::type_error();
-      if (o.via.array.size != 3) throw msgpack::type_error();
+      const msgpack::object* p = Ubitrack::Serialization::MsgpackArchive::arrayElements(o, 3);
 	  Ubitrack::Math::Quaternion quat;
 	  Ubitrack::Math::Vector<double, 3> vec;
 	  Ubitrack::Math::Matrix<double, 6, 6> cov;
-	  msgpack::adaptor::convert<Ubitrack::Math::Quaternion>()(o.via.array.ptr[0], quat);
-	  msgpack::adaptor::convert<Ubitrack::Math::Vector<double, 3> >()(o.via.array.ptr[1], vec);
-	  msgpack::adaptor::convert<Ubitrack::Math::Matrix<double, 6, 6> >()(o.via.array.ptr[2], cov);
+	  Ubitrack::Serialization::MsgpackArchive::convertQuaternion(p[0], quat);
+	  msgpack::adaptor::convert<Ubitrack::Math::Vector<double, 3> >()(p[1], vec);
+	  msgpack::adaptor::convert<Ubitrack::Math::Matrix<double, 6, 6> >()(p[2], cov);
       v = Ubitrack::Math::ErrorPose(quat, vec, cov);
       return o;
   }
@@ -678,10 +784,7 @@ struct pack<Ubitrack::Math::ErrorPose > {
   template<typename Stream>
   msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::ErrorPose& v) const
   {
-      o.pack_array(3);
-      o.pack(v.rotation());
-      o.pack(v.translation());
-      o.pack(v.covariance());
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
       return o;
   }
 };
@@ -701,6 +804,161 @@ struct object_with_zone<Ubitrack::Math::ErrorPose > {
 };
 
 
+/*
+ * Ubitrack::Math::PackedCovariance<T,N>, the upper triangle row by row
+ */
+template<typename T, std::size_t N>
+struct convert<Ubitrack::Math::PackedCovariance<T, N> > {
+  msgpack::object const& operator()(msgpack::object const& o, Ubitrack::Math::PackedCovariance<T, N>& v) const
+  {
+      const std::size_t packedSize = Ubitrack::Math::PackedCovariance<T, N>::packedSize;
+      const msgpack::object* p = Ubitrack::Serialization::MsgpackArchive::arrayElements(o, packedSize);
+      for (std::size_t i = 0; i<packedSize; ++i) {
+          Ubitrack::Serialization::MsgpackArchive::convertElement(p[i], v.data()[i]);
+      }
+      return o;
+  }
+};
+
+template<typename T, std::size_t N>
+struct pack<Ubitrack::Math::PackedCovariance<T, N> > {
+  template<typename Stream>
+  msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::PackedCovariance<T, N>& v) const
+  {
+      write(o, v, boost::integral_constant<bool, (Ubitrack::Serialization::MsgpackArchive::FixedFormat<Ubitrack::Math::PackedCovariance<T, N> >::length>0)>());
+      return o;
+  }
+
+  /// floating point numbers in one block
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::PackedCovariance<T, N>& v, boost::true_type)
+  {
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
+  }
+
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::PackedCovariance<T, N>& v, boost::false_type)
+  {
+      const std::size_t packedSize = Ubitrack::Math::PackedCovariance<T, N>::packedSize;
+      o.pack_array((uint32_t)packedSize);
+      for (std::size_t i = 0; i<packedSize; ++i) {
+          o.pack(v.data()[i]);
+      }
+  }
+};
+
+template<typename T, std::size_t N>
+struct object_with_zone<Ubitrack::Math::PackedCovariance<T, N> > {
+  void operator()(msgpack::object::with_zone& o, const Ubitrack::Math::PackedCovariance<T, N>& v) const
+  {
+      o.type = type::ARRAY;
+      o.via.array.size = (uint32_t)Ubitrack::Math::PackedCovariance<T, N>::packedSize;
+      o.via.array.ptr = static_cast<msgpack::object*>(
+              o.zone.allocate_align(sizeof(msgpack::object)*o.via.array.size));
+      for (std::size_t i = 0; i<o.via.array.size; ++i) {
+          o.via.array.ptr[i] = msgpack::object(v.data()[i], o.zone);
+      }
+  }
+};
+
+
+/*
+ * Ubitrack::Math::PackedErrorVector<T,N,C>
+ */
+template<typename T, std::size_t N, typename C>
+struct convert<Ubitrack::Math::PackedErrorVector<T, N, C> > {
+  msgpack::object const& operator()(msgpack::object const& o, Ubitrack::Math::PackedErrorVector<T, N, C>& v) const
+  {
+      const msgpack::object* p = Ubitrack::Serialization::MsgpackArchive::arrayElements(o, 2);
+      msgpack::adaptor::convert<Ubitrack::Math::Vector<T, N> >()(p[0], v.value);
+      msgpack::adaptor::convert<Ubitrack::Math::PackedCovariance<C, N> >()(p[1], v.covariance);
+      return o;
+  }
+};
+
+template<typename T, std::size_t N, typename C>
+struct pack<Ubitrack::Math::PackedErrorVector<T, N, C> > {
+  template<typename Stream>
+  msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::PackedErrorVector<T, N, C>& v) const
+  {
+      write(o, v, boost::integral_constant<bool, (Ubitrack::Serialization::MsgpackArchive::FixedFormat<Ubitrack::Math::PackedErrorVector<T, N, C> >::length>0)>());
+      return o;
+  }
+
+  /// fixed-size vectors of floating point numbers in one block
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::PackedErrorVector<T, N, C>& v, boost::true_type)
+  {
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
+  }
+
+  template<typename Stream>
+  static void write(msgpack::packer<Stream>& o, const Ubitrack::Math::PackedErrorVector<T, N, C>& v, boost::false_type)
+  {
+      o.pack_array(2);
+      o.pack(v.value);
+      o.pack(v.covariance);
+  }
+};
+
+template<typename T, std::size_t N, typename C>
+struct object_with_zone<Ubitrack::Math::PackedErrorVector<T, N, C> > {
+  void operator()(msgpack::object::with_zone& o, const Ubitrack::Math::PackedErrorVector<T, N, C>& v) const
+  {
+      o.type = type::ARRAY;
+      o.via.array.size = 2;
+      o.via.array.ptr = static_cast<msgpack::object*>(
+              o.zone.allocate_align(sizeof(msgpack::object)*o.via.array.size));
+      o.via.array.ptr[0] = msgpack::object(v.value, o.zone);
+      o.via.array.ptr[1] = msgpack::object(v.covariance, o.zone);
+  }
+};
+
+
+/*
+ * Ubitrack::Math::PackedErrorPose<C>
+ */
+template<typename C>
+struct convert<Ubitrack::Math::PackedErrorPose<C> > {
+  msgpack::object const& operator()(msgpack::object const& o, Ubitrack::Math::PackedErrorPose<C>& v) const
+  {
+      const msgpack::object* p = Ubitrack::Serialization::MsgpackArchive::arrayElements(o, 3);
+      Ubitrack::Math::Quaternion quat;
+      Ubitrack::Math::Vector<double, 3> vec;
+      Ubitrack::Math::PackedCovariance<C, 6> cov;
+      Ubitrack::Serialization::MsgpackArchive::convertQuaternion(p[0], quat);
+      msgpack::adaptor::convert<Ubitrack::Math::Vector<double, 3> >()(p[1], vec);
+      msgpack::adaptor::convert<Ubitrack::Math::PackedCovariance<C, 6> >()(p[2], cov);
+      v = Ubitrack::Math::PackedErrorPose<C>(quat, vec, cov);
+      return o;
+  }
+};
+
+template<typename C>
+struct pack<Ubitrack::Math::PackedErrorPose<C> > {
+  template<typename Stream>
+  msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const Ubitrack::Math::PackedErrorPose<C>& v) const
+  {
+      Ubitrack::Serialization::MsgpackArchive::packFixed(o, v);
+      return o;
+  }
+};
+
+template<typename C>
+struct object_with_zone<Ubitrack::Math::PackedErrorPose<C> > {
+  void operator()(msgpack::object::with_zone& o, const Ubitrack::Math::PackedErrorPose<C>& v) const
+  {
+      o.type = type::ARRAY;
+      o.via.array.size = 3;
+      o.via.array.ptr = static_cast<msgpack::object*>(
+              o.zone.allocate_align(sizeof(msgpack::object)*o.via.array.size));
+      o.via.array.ptr[0] = msgpack::object(v.rotation(), o.zone);
+      o.via.array.ptr[1] = msgpack::object(v.translation(), o.zone);
+      o.via.array.ptr[2] = msgpack::object(v.packedCovariance(), o.zone);
+  }
+};
+
+
 /*
  * Ubitrack::Math::CameraIntrinsics<T>
  */
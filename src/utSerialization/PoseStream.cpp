@@ -0,0 +1,365 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Compact encoding of pose streams for network transport
+ */
+
+#include "utSerialization/PoseStream.h"
+#include "utMath/Util/simd_traits.h"
+#include "utUtil/Exception.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <boost/shared_ptr.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace PoseStream {
+
+namespace {
+
+const uint8_t g_keyframeFlag = 0x01;
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v)
+{
+    while (v>=0x80) {
+        out.push_back(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+uint64_t getVarint(const uint8_t*& p, const uint8_t* end)
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift<64; shift += 7) {
+        if (p==end)
+            UBITRACK_THROW("Truncated pose stream message");
+        const uint8_t byte = *p++;
+        v |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return v;
+    }
+    UBITRACK_THROW("Corrupt varint in pose stream message");
+}
+
+inline uint64_t zigzag(int64_t v)
+{
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t z)
+{
+    return int64_t(z >> 1) ^ -int64_t(z & 1);
+}
+
+/// little endian integer of n bytes
+void putBytes(std::vector<uint8_t>& out, uint64_t v, std::size_t n)
+{
+    for (std::size_t i = 0; i<n; ++i, v >>= 8)
+        out.push_back(uint8_t(v));
+}
+
+uint64_t getBytes(const uint8_t*& p, const uint8_t* end, std::size_t n)
+{
+    if (std::size_t(end-p)<n)
+        UBITRACK_THROW("Truncated pose stream message");
+    uint64_t v = 0;
+    for (std::size_t i = 0; i<n; ++i)
+        v |= uint64_t(*p++) << (8*i);
+    return v;
+}
+
+inline std::size_t rotationBytes(unsigned bits)
+{
+    return (2+3*bits+7)/8;
+}
+
+inline bool validRotationBits(unsigned bits)
+{
+    return bits>=4 && bits<=20;
+}
+
+/// values[i] = values[i]*factor+offset, with the SIMD packs of utMath
+void scale(double* values, std::size_t n, double factor, double offset = 0.0)
+{
+    typedef Math::Util::simd_pack<double> Pack;
+    const Pack::type f = Pack::set1(factor);
+    const Pack::type o = Pack::set1(offset);
+    std::size_t i = 0;
+    for (; i+Pack::size<=n; i += Pack::size)
+        Pack::store(values+i, Pack::add(Pack::mul(Pack::load(values+i), f), o));
+    for (; i<n; ++i)
+        values[i] = values[i]*factor+offset;
+}
+
+/// w[i] = sqrt(max(0, 1-a[i]^2-b[i]^2-c[i]^2)), the largest component of unit quaternions
+void largestComponents(const double* a, const double* b, const double* c, double* w, std::size_t n)
+{
+    typedef Math::Util::simd_pack<double> Pack;
+    const Pack::type one = Pack::set1(1.0);
+    const Pack::type zero = Pack::set1(0.0);
+    std::size_t i = 0;
+    for (; i+Pack::size<=n; i += Pack::size) {
+        const Pack::type va = Pack::load(a+i);
+        const Pack::type vb = Pack::load(b+i);
+        const Pack::type vc = Pack::load(c+i);
+        const Pack::type squares = Pack::add(Pack::add(Pack::mul(va, va), Pack::mul(vb, vb)), Pack::mul(vc, vc));
+        Pack::store(w+i, Pack::sqrt(Pack::max(Pack::sub(one, squares), zero)));
+    }
+    for (; i<n; ++i)
+        w[i] = std::sqrt(std::max(1.0-a[i]*a[i]-b[i]*b[i]-c[i]*c[i], 0.0));
+}
+
+/**
+ * smallest three encoding of a rotation: the index of the largest component, followed by
+ * the other components, which lie in [ -1/sqrt(2), 1/sqrt(2) ], quantized to \c bits bits
+ */
+uint64_t packRotation(const Math::Quaternion& q, unsigned bits)
+{
+    const double c[4] = { q.x(), q.y(), q.z(), q.w() };
+    std::size_t largest = 0;
+    for (std::size_t i = 1; i<4; ++i)
+        if (std::fabs(c[i])>std::fabs(c[largest]))
+            largest = i;
+
+    // q and -q are the same rotation, so the largest component is made positive
+    const double norm = std::sqrt(c[0]*c[0]+c[1]*c[1]+c[2]*c[2]+c[3]*c[3]);
+    const double factor = (c[largest]<0 ? -1.0 : 1.0)*std::sqrt(0.5)/norm;
+    const double maxValue = double((uint64_t(1) << bits)-1);
+
+    uint64_t packed = largest;
+    unsigned shift = 2;
+    for (std::size_t i = 0; i<4; ++i) {
+        if (i==largest)
+            continue;
+        // c[ i ] * sqrt(2) is in [ -1, 1 ]
+        const double v = std::min(std::max(c[i]*factor*2.0, -1.0), 1.0);
+        packed |= uint64_t(std::floor((v+1.0)*0.5*maxValue+0.5)) << shift;
+        shift += bits;
+    }
+    return packed;
+}
+
+} // anonymous namespace
+
+
+Encoder::Encoder(const Parameters& parameters)
+    : m_parameters(parameters)
+    , m_keyframeDue(true)
+    , m_sinceKeyframe(0)
+    , m_sequence(0)
+    , m_time(0)
+{
+    if (!(parameters.translationResolution>0))
+        UBITRACK_THROW("Pose stream translation resolution must be positive");
+    if (!validRotationBits(parameters.rotationBits))
+        UBITRACK_THROW("Pose stream rotation bits must be between 4 and 20");
+}
+
+
+void Encoder::encode(const Measurement::Pose& pose, std::vector<uint8_t>& message)
+{
+    encode(pose.time(), std::vector<Math::Pose>(1, *pose), message);
+}
+
+
+void Encoder::encode(const Measurement::PoseList& poses, std::vector<uint8_t>& message)
+{
+    encode(poses.time(), *poses, message);
+}
+
+
+void Encoder::encode(Measurement::Timestamp t, const std::vector<Math::Pose>& poses, std::vector<uint8_t>& message)
+{
+    const std::size_t n = poses.size();
+    const bool keyframe = m_keyframeDue || m_sinceKeyframe>=m_parameters.keyframeInterval || m_translations.size()!=3*n;
+
+    // quantize all translations at once
+    m_scaled.resize(3*n);
+    for (std::size_t i = 0; i<n; ++i)
+        for (std::size_t j = 0; j<3; ++j)
+            m_scaled[3*i+j] = poses[i].translation()(j);
+    if (n)
+        scale(&m_scaled[0], 3*n, 1.0/m_parameters.translationResolution);
+    m_quantized.resize(3*n);
+    for (std::size_t i = 0; i<3*n; ++i)
+        m_quantized[i] = int64_t(std::floor(m_scaled[i]+0.5));
+
+    message.clear();
+    message.push_back(keyframe ? g_keyframeFlag : 0);
+    message.push_back(++m_sequence);
+    putVarint(message, n);
+    if (keyframe) {
+        uint64_t resolution;
+        memcpy(&resolution, &m_parameters.translationResolution, sizeof(resolution));
+        putBytes(message, resolution, 8);
+        message.push_back(uint8_t(m_parameters.rotationBits));
+        putVarint(message, t);
+        m_translations.assign(3*n, 0);
+    }
+    else
+        putVarint(message, zigzag(int64_t(t-m_time)));
+
+    const std::size_t nRotationBytes = rotationBytes(m_parameters.rotationBits);
+    for (std::size_t i = 0; i<n; ++i) {
+        for (std::size_t j = 0; j<3; ++j)
+            putVarint(message, zigzag(m_quantized[3*i+j]-m_translations[3*i+j]));
+        putBytes(message, packRotation(poses[i].rotation(), m_parameters.rotationBits), nRotationBytes);
+    }
+
+    m_translations.swap(m_quantized);
+    m_time = t;
+    m_keyframeDue = false;
+    m_sinceKeyframe = keyframe ? 1 : m_sinceKeyframe+1;
+}
+
+
+Decoder::Decoder()
+    : m_synchronized(false)
+    , m_sequence(0)
+    , m_resolution(0)
+    , m_rotationBits(0)
+    , m_time(0)
+{
+}
+
+
+bool Decoder::decode(const uint8_t* data, std::size_t size, Measurement::Timestamp& t, std::vector<Math::Pose>& poses)
+{
+    const uint8_t* p = data;
+    const uint8_t* end = data+size;
+    const uint8_t flags = uint8_t(getBytes(p, end, 1));
+    const uint8_t sequence = uint8_t(getBytes(p, end, 1));
+    if (flags & ~g_keyframeFlag)
+        UBITRACK_THROW("Unknown flags in pose stream message");
+
+    const bool keyframe = (flags & g_keyframeFlag)!=0;
+    const bool inSequence = m_synchronized && sequence==uint8_t(m_sequence+1);
+    m_sequence = sequence;
+    if (!keyframe && !inSequence) {
+        m_synchronized = false;
+        return false;
+    }
+
+    // the state is only valid again if the whole message can be read
+    m_synchronized = false;
+    const uint64_t n = getVarint(p, end);
+    if (keyframe) {
+        uint64_t resolution = getBytes(p, end, 8);
+        memcpy(&m_resolution, &resolution, sizeof(m_resolution));
+        m_rotationBits = unsigned(getBytes(p, end, 1));
+        if (!validRotationBits(m_rotationBits) || !(m_resolution>0))
+            UBITRACK_THROW("Invalid parameters in pose stream keyframe");
+        m_time = getVarint(p, end);
+    }
+    else {
+        if (3*n!=m_translations.size())
+            UBITRACK_THROW("Pose count changed without pose stream keyframe");
+        m_time += Measurement::Timestamp(unzigzag(getVarint(p, end)));
+    }
+
+    // every pose takes at least 3 bytes for the translation
+    const std::size_t nRotationBytes = rotationBytes(m_rotationBits);
+    if (n>std::size_t(end-p)/(3+nRotationBytes))
+        UBITRACK_THROW("Truncated pose stream message");
+    if (keyframe)
+        m_translations.assign(3*n, 0);
+
+    // the components of the rotations in arrays of the three small ones, the largest one and
+    // the index of the largest one, followed by the translations
+    m_components.resize(8*n);
+    double* small = n ? &m_components[0] : 0;
+    double* largest = small+3*n;
+    double* index = small+4*n;
+    double* translations = small+5*n;
+    const uint64_t mask = (uint64_t(1) << m_rotationBits)-1;
+    for (std::size_t i = 0; i<n; ++i) {
+        for (std::size_t j = 0; j<3; ++j) {
+            m_translations[3*i+j] += unzigzag(getVarint(p, end));
+            translations[3*i+j] = double(m_translations[3*i+j]);
+        }
+        uint64_t packed = getBytes(p, end, nRotationBytes);
+        index[i] = double(packed & 3);
+        packed >>= 2;
+        for (std::size_t j = 0; j<3; ++j, packed >>= m_rotationBits)
+            small[j*n+i] = double(packed & mask);
+    }
+
+    // back from [ 0, 2^bits - 1 ] to [ -1/sqrt(2), 1/sqrt(2) ]
+    const double maxValue = double(mask);
+    if (n) {
+        scale(small, 3*n, std::sqrt(2.0)/maxValue, -std::sqrt(0.5));
+        largestComponents(small, small+n, small+2*n, largest, n);
+        scale(translations, 3*n, m_resolution);
+    }
+
+    poses.resize(n);
+    for (std::size_t i = 0; i<n; ++i) {
+        double c[4];
+        const std::size_t k = std::size_t(index[i]);
+        for (std::size_t j = 0, s = 0; j<4; ++j)
+            c[j] = j==k ? largest[i] : small[(s++)*n+i];
+        Math::Quaternion q(c[0], c[1], c[2], c[3]);
+        q.normalize();
+        poses[i] = Math::Pose(q, Math::Vector<double, 3>(translations[3*i], translations[3*i+1], translations[3*i+2]));
+    }
+
+    t = m_time;
+    m_synchronized = true;
+    return true;
+}
+
+
+bool Decoder::decode(const uint8_t* data, std::size_t size, Measurement::PoseList& poses)
+{
+    Measurement::Timestamp t;
+    boost::shared_ptr<std::vector<Math::Pose> > result(new std::vector<Math::Pose>());
+    if (!decode(data, size, t, *result))
+        return false;
+    poses = Measurement::PoseList(t, result);
+    return true;
+}
+
+
+bool Decoder::decode(const uint8_t* data, std::size_t size, Measurement::Pose& pose)
+{
+    Measurement::Timestamp t;
+    std::vector<Math::Pose> result;
+    if (!decode(data, size, t, result))
+        return false;
+    if (result.size()!=1)
+        UBITRACK_THROW("Pose stream message does not hold a single pose");
+    pose = Measurement::Pose(t, result[0]);
+    return true;
+}
+
+} // namespace PoseStream
+} // namespace Serialization
+} // namespace Ubitrack
@@ -0,0 +1,188 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Compact encoding of pose streams for network transport
+ *
+ * The encoder turns each \c Measurement::Pose or \c Measurement::PoseList into one message
+ * of a few bytes per pose, for sending many targets at high rates over wireless links:
+ * - translations are stored in fixed point with a configurable resolution,
+ * - rotations use the "smallest three" encoding: the index of the largest quaternion
+ *   component and the other three components, quantized to \c rotationBits bits each,
+ * - keyframes hold the absolute values, the other messages the differences of the
+ *   timestamp and of the quantized translations to the previous message.
+ *
+ * @verbatim
+message  := flags (uint8), sequence (uint8), pose count (varint), [ resolution (double), rotation bits (uint8) ],
+            time (varint, zigzag varint of the difference if not a keyframe), { pose }
+pose     := tx, ty, tz (zigzag varints), rotation (2 + 3 * rotation bits, little endian, whole bytes)
+@endverbatim
+ * The resolution and the number of rotation bits are only part of keyframes, which are
+ * sent every \c keyframeInterval messages, whenever the number of poses changes and on request,
+ * e.g. when a client joins. The error of a translation component is at most half the
+ * resolution, and the quantization does not accumulate over the difference messages.
+ * With the defaults a pose takes about 9 bytes at walking speed and 240 Hz, compared to
+ * 56 bytes for the doubles:
+ * @code
+ * Serialization::PoseStream::Encoder encoder;
+ * std::vector< uint8_t > message;
+ * encoder.encode( poses, message );
+ * send( socket, &message[ 0 ], message.size(), 0 );
+ *
+ * Serialization::PoseStream::Decoder decoder;
+ * Measurement::PoseList received;
+ * if ( !decoder.decode( data, size, received ) )
+ *     ; // lost a message, wait for the next keyframe
+ * @endcode
+ * The scaling of the translations and the reconstruction of the quaternions work on whole
+ * lists with the SIMD packs of utMath. Covariances of error poses are not transmitted.
+ */
+
+#ifndef UBITRACK_POSESTREAM_H
+#define UBITRACK_POSESTREAM_H
+
+#include <utCore.h>
+#include <utMeasurement/Measurement.h>
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace PoseStream {
+
+/**
+ * Settings of the encoder. The decoder takes them from the keyframes.
+ */
+struct Parameters {
+    Parameters()
+        : translationResolution(1e-4)
+        , rotationBits(15)
+        , keyframeInterval(240)
+    {}
+
+    /// size of a translation step, in the unit of the poses (0.1 mm for meters)
+    double translationResolution;
+
+    /// bits per quaternion component, between 4 and 20
+    unsigned rotationBits;
+
+    /// number of messages from one keyframe to the next
+    unsigned keyframeInterval;
+};
+
+
+/**
+ * Encodes a stream of poses or pose lists into messages.
+ * Not thread-safe.
+ */
+class UBITRACK_EXPORT Encoder
+    : private boost::noncopyable
+{
+public:
+    /** throws a \c Util::Exception if the parameters are out of range */
+    explicit Encoder(const Parameters& parameters = Parameters());
+
+    const Parameters& parameters() const
+    { return m_parameters; }
+
+    /** encodes the next measurement into \c message, replacing its contents */
+    void encode(const Measurement::Pose& pose, std::vector<uint8_t>& message);
+
+    /** encodes the next list of poses into \c message, replacing its contents */
+    void encode(const Measurement::PoseList& poses, std::vector<uint8_t>& message);
+
+    /** encodes the next list of poses with timestamp \c t into \c message */
+    void encode(Measurement::Timestamp t, const std::vector<Math::Pose>& poses, std::vector<uint8_t>& message);
+
+    /** makes the next message a keyframe */
+    void requestKeyframe()
+    { m_keyframeDue = true; }
+
+protected:
+    Parameters m_parameters;
+
+    /// state of the last message
+    bool m_keyframeDue;
+    unsigned m_sinceKeyframe;
+    uint8_t m_sequence;
+    Measurement::Timestamp m_time;
+    std::vector<int64_t> m_translations;
+
+    /// scratch buffers
+    std::vector<double> m_scaled;
+    std::vector<int64_t> m_quantized;
+};
+
+
+/**
+ * Decodes the messages of one encoder.
+ *
+ * Messages that are not keyframes can only be decoded if their predecessor was, so after a
+ * lost message \c decode returns false until the next keyframe arrives. Malformed messages
+ * throw a \c Util::Exception.
+ */
+class UBITRACK_EXPORT Decoder
+    : private boost::noncopyable
+{
+public:
+    Decoder();
+
+    /**
+     * decodes a message with the poses of one timestamp
+     * @return false if the message refers to a message that was not received
+     */
+    bool decode(const uint8_t* data, std::size_t size, Measurement::Timestamp& t, std::vector<Math::Pose>& poses);
+
+    /** decodes a message into a pose list measurement */
+    bool decode(const uint8_t* data, std::size_t size, Measurement::PoseList& poses);
+
+    /** decodes a message of a single pose into a measurement */
+    bool decode(const uint8_t* data, std::size_t size, Measurement::Pose& pose);
+
+    /** true after a keyframe was received and no message since then was lost */
+    bool synchronized() const
+    { return m_synchronized; }
+
+protected:
+    bool m_synchronized;
+    uint8_t m_sequence;
+    double m_resolution;
+    unsigned m_rotationBits;
+    Measurement::Timestamp m_time;
+    std::vector<int64_t> m_translations;
+
+    /// scratch buffers
+    std::vector<double> m_components;
+};
+
+} // namespace PoseStream
+} // namespace Serialization
+} // namespace Ubitrack
+
+#endif //UBITRACK_POSESTREAM_H
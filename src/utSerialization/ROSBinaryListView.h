@@ -0,0 +1,312 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Lazy views on serialized lists
+ *
+ * Deserializing a \c std::vector of poses decodes every element, even if the consumer only
+ * looks at a few of them. A \c ROSBinary::ListView<T> is read from the stream instead of the
+ * vector, remembers where the elements are and decodes an element when it is accessed:
+ * @code
+ * Serialization::ROSBinary::IStream stream( data, length );
+ * Serialization::ROSBinary::PoseListView poses;
+ * stream >> poses;
+ * if ( poses.size() > target )
+ *     Math::Pose p = poses[ target ];
+ * @endcode
+ * The view has the read-only interface of a \c std::vector (\c size, \c operator[], \c at,
+ * \c front, \c back, random access iterators), so templates written for lists accept it,
+ * and \c toVector decodes all elements. Elements are returned by value.
+ *
+ * Views support the packed math types and simple types (e.g. the \c Math::Scalar elements of
+ * an \c IDList), whose stream layout has a fixed size per element. The stream format is the
+ * same as that of the \c std::vector, serializing a view copies the encoded elements.
+ *
+ * A view reads from the buffer of the stream, which must stay valid while the view is used.
+ * Only views read from a \c ScatterIStream copy the elements, as the stream may assemble them
+ * in a temporary buffer.
+ */
+
+#ifndef UBITRACK_ROSBINARYLISTVIEW_H
+#define UBITRACK_ROSBINARYLISTVIEW_H
+
+#include "utSerialization/ROSBinarySerialization.h"
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+namespace ROSBinary {
+
+/**
+ * \brief Layout of the elements of a view, default implementation does nothing
+ */
+template<typename T, class Enabled = void>
+struct ElementLayout {};
+
+/**
+ * \brief packed math types
+ */
+template<typename T>
+struct ElementLayout<T, typename boost::enable_if<mt::IsPacked<T> >::type>
+        : public PackedLayout<T> {};
+
+/**
+ * \brief simple types, which are stored as they are in memory
+ */
+template<typename T>
+struct ElementLayout<T, typename boost::enable_if<mt::IsSimple<T> >::type> {
+  static const uint32_t size = sizeof(T);
+
+  inline static void read(const uint8_t* data, T& t)
+  {
+      memcpy(&t, data, size);
+  }
+};
+
+class ScatterIStream;
+
+/**
+ * \brief true if pointers returned by Stream::advance stay valid after the next call
+ */
+template<typename Stream>
+struct HasStableBuffer: public mt::TrueType {};
+
+template<>
+struct HasStableBuffer<ScatterIStream>: public mt::FalseType {};
+
+
+/**
+ * \brief Read-only view on a serialized list, decodes elements on access
+ */
+template<typename T>
+class ListView {
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    /// elements are decoded into temporaries
+    typedef T const_reference;
+    typedef const_reference reference;
+
+    /**
+     * \brief Random access iterator, dereferencing decodes the element
+     */
+    class const_iterator
+            : public boost::iterator_facade<const_iterator, const T, boost::random_access_traversal_tag, T> {
+    public:
+        const_iterator()
+                :m_data(0) {}
+
+        explicit const_iterator(const uint8_t* data)
+                :m_data(data) {}
+
+    private:
+        friend class boost::iterator_core_access;
+
+        T dereference() const
+        {
+            T t;
+            ElementLayout<T>::read(m_data, t);
+            return t;
+        }
+
+        bool equal(const const_iterator& other) const
+        {
+            return m_data==other.m_data;
+        }
+
+        void increment()
+        {
+            m_data += ElementLayout<T>::size;
+        }
+
+        void decrement()
+        {
+            m_data -= ElementLayout<T>::size;
+        }
+
+        void advance(difference_type n)
+        {
+            m_data += n*difference_type(ElementLayout<T>::size);
+        }
+
+        difference_type distance_to(const const_iterator& other) const
+        {
+            return (other.m_data-m_data)/difference_type(ElementLayout<T>::size);
+        }
+
+        const uint8_t* m_data;
+    };
+    typedef const_iterator iterator;
+
+    /** an empty list */
+    ListView()
+            :m_data(0), m_size(0) {}
+
+    /**
+     * \brief a view on \c count encoded elements at \c data, which is not copied
+     */
+    ListView(const uint8_t* data, std::size_t count)
+            :m_data(data), m_size(count) {}
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size==0;
+    }
+
+    /** decodes element i */
+    T operator[](std::size_t i) const
+    {
+        T t;
+        ElementLayout<T>::read(m_data+i*ElementLayout<T>::size, t);
+        return t;
+    }
+
+    /**
+     * \brief decodes element i
+     * \throws Util::Exception if i is out of range
+     */
+    T at(std::size_t i) const
+    {
+        if (i>=m_size)
+            UBITRACK_THROW("List view index out of range");
+        return (*this)[i];
+    }
+
+    T front() const
+    {
+        return (*this)[0];
+    }
+
+    T back() const
+    {
+        return (*this)[m_size-1];
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(m_data);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(m_data+m_size*ElementLayout<T>::size);
+    }
+
+    /** decodes all elements */
+    void toVector(std::vector<T>& v) const
+    {
+        v.resize(m_size);
+        for (std::size_t i = 0; i<m_size; ++i)
+            ElementLayout<T>::read(m_data+i*ElementLayout<T>::size, v[i]);
+    }
+
+    std::vector<T> toVector() const
+    {
+        std::vector<T> v;
+        toVector(v);
+        return v;
+    }
+
+    /** the encoded elements */
+    const uint8_t* data() const
+    {
+        return m_data;
+    }
+
+    /** length of the encoded elements in bytes */
+    uint32_t byteSize() const
+    {
+        return (uint32_t) (m_size*ElementLayout<T>::size);
+    }
+
+    /**
+     * \brief copies the encoded elements, so the view no longer depends on the buffer of the stream
+     */
+    void detach()
+    {
+        boost::shared_ptr<std::vector<uint8_t> > copy(new std::vector<uint8_t>(m_data, m_data+byteSize()));
+        m_owned = copy;
+        m_data = copy->empty() ? 0 : &copy->front();
+    }
+
+protected:
+    const uint8_t* m_data;
+    std::size_t m_size;
+    /// set by detach
+    boost::shared_ptr<std::vector<uint8_t> > m_owned;
+};
+
+
+/**
+ * \brief Serializer for list views, same format as the std::vector
+ */
+template<typename T>
+struct ROSBinarySerializationFormat<ListView<T> > {
+  template<typename Stream>
+  inline static void write(Stream& stream, const ListView<T>& v)
+  {
+      uint32_t len = (uint32_t) v.size();
+      stream.next(len);
+      writeBlock(stream, v.data(), v.byteSize());
+  }
+
+  template<typename Stream>
+  inline static void read(Stream& stream, ListView<T>& v)
+  {
+      uint32_t len;
+      stream.next(len);
+      v = ListView<T>(stream.advance(len*ElementLayout<T>::size), len);
+      if (!HasStableBuffer<Stream>::value)
+          v.detach();
+  }
+
+  inline static uint32_t maxSerializedLength(const ListView<T>& v)
+  {
+      return 4+v.byteSize();
+  }
+};
+
+typedef ListView<Ubitrack::Math::Pose> PoseListView;
+typedef ListView<Ubitrack::Math::Vector<double, 3> > PositionListView;
+typedef ListView<Ubitrack::Math::Vector<double, 2> > Position2DListView;
+typedef ListView<Ubitrack::Math::Scalar<unsigned long> > IDListView;
+typedef ListView<Ubitrack::Math::Scalar<double> > DistanceListView;
+
+} // namespace ROSBinary
+} // namespace Serialization
+} // namespace Ubitrack
+
+#endif //UBITRACK_ROSBINARYLISTVIEW_H
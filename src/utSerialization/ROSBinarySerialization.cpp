@@ -30,9 +30,6 @@
  */
 
 
-#ifdef ENABLE_ROSBINARY
-
-#include "utSerialization/Serialization.h"
 #include "utSerialization/ROSBinarySerialization.h"
 
 
@@ -51,8 +48,6 @@ void throwStreamOverrun()
 }
 }
 
-#endif // ENABLE_ROSBINARY
-
 
 
 
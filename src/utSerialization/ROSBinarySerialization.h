@@ -33,9 +33,16 @@
 #ifndef UBITRACK_BINARYSERIALIZATION_H
 #define UBITRACK_BINARYSERIALIZATION_H
 
-#include "utSerialization/Serialization.h.h"
+#include "utSerialization/BaseSerializer.h"
 #include "utSerialization/SerializationFormat.h"
 
+#include "utMath/Vector.h"
+#include "utMath/Quaternion.h"
+#include "utMath/Pose.h"
+#include "utMath/ErrorPose.h"
+#include "utMath/ErrorVector.h"
+#include "utMath/Scalar.h"
+
 #include <boost/array.hpp>
 #include <boost/call_traits.hpp>
 #include <boost/utility/enable_if.hpp>
@@ -43,12 +50,21 @@
 #include <boost/mpl/or.hpp>
 #include <boost/mpl/not.hpp>
 
+#include <cstring>
 #include <string>
 #include <vector>
 #include <map>
 #include <set>
 #include <list>
 
+#if defined(__GNUC__)
+  #define ROSBINARY_FORCE_INLINE __attribute__((always_inline)) inline
+#elif defined(_MSC_VER)
+  #define ROSBINARY_FORCE_INLINE __forceinline
+#else
+  #define ROSBINARY_FORCE_INLINE inline
+#endif
+
 namespace Ubitrack {
 namespace Serialization {
 namespace ROSBinary {
@@ -56,6 +72,21 @@ namespace ROSBinary {
 namespace mpl = boost::mpl;
 namespace mt = Ubitrack::Serialization::Traits;
 
+/**
+ * \brief throws a StreamOverrunException, kept out of line to keep the stream code small
+ */
+UBITRACK_EXPORT void throwStreamOverrun();
+
+/**
+ * \brief Writes a block of bytes to a stream. Streams that can refer to the data instead of
+ * copying it (see ScatterGather.h) overload this function.
+ */
+template<typename Stream>
+inline void writeBlock(Stream& stream, const void* data, uint32_t len)
+{
+    memcpy(stream.advance(len), data, len);
+}
+
 /**
  * \brief Templated serialization class.  Default implementation provides backwards compatibility with
  * old message types.
@@ -98,7 +129,7 @@ struct ROSBinarySerializationFormat {
 template<typename T, typename Stream>
 inline void serialize(Stream& stream, const T& t)
 {
-    Serializer<T, ROSBinarySerializationFormat<T> >::write(stream, t);
+    BaseSerializer<T, ROSBinarySerializationFormat<T> >::write(stream, t);
 }
 
 /**
@@ -107,7 +138,7 @@ inline void serialize(Stream& stream, const T& t)
 template<typename T, typename Stream>
 inline void deserialize(Stream& stream, T& t)
 {
-    Serializer<T, ROSBinarySerializationFormat<T> >::read(stream, t);
+    BaseSerializer<T, ROSBinarySerializationFormat<T> >::read(stream, t);
 }
 
 /**
@@ -116,7 +147,7 @@ inline void deserialize(Stream& stream, T& t)
 template<typename T>
 inline uint32_t maxSerializationLength(const T& t)
 {
-    return Serializer<T, ROSBinarySerializationFormat<T> >::maxSerializedLength(t);
+    return BaseSerializer<T, ROSBinarySerializationFormat<T> >::maxSerializedLength(t);
 }
 
 #define ROSBINARY_CREATE_SIMPLE_SERIALIZER(Type) \
@@ -189,7 +220,7 @@ struct ROSBinarySerializationFormat<std::basic_string<char, std::char_traits<cha
       stream.next((uint32_t) len);
 
       if (len>0) {
-          memcpy(stream.advance((uint32_t) len), str.data(), len);
+          writeBlock(stream, str.data(), (uint32_t) len);
       }
   }
 
@@ -212,6 +243,249 @@ struct ROSBinarySerializationFormat<std::basic_string<char, std::char_traits<cha
   }
 };
 
+/**
+ * \brief Stream layout of the fixed-size math types.
+ *
+ * ublas vectors store their size next to the elements and quaternions keep w first, so
+ * these types are not simple. Their layout follows geometry_msgs: vectors are N packed
+ * elements, quaternions are (x, y, z, w), and poses are the translation followed by the
+ * rotation. Default implementation does nothing.
+ */
+template<typename T>
+struct PackedLayout {};
+
+template<typename T, std::size_t N>
+struct PackedLayout<Ubitrack::Math::Vector<T, N> > {
+  static const uint32_t size = N*sizeof(T);
+
+  inline static void write(uint8_t* data, const Ubitrack::Math::Vector<T, N>& v)
+  {
+      memcpy(data, &v(0), size);
+  }
+
+  inline static void read(const uint8_t* data, Ubitrack::Math::Vector<T, N>& v)
+  {
+      memcpy(&v(0), data, size);
+  }
+};
+
+template<>
+struct PackedLayout<Ubitrack::Math::Quaternion> {
+  static const uint32_t size = 4*sizeof(double);
+
+  inline static void write(uint8_t* data, const Ubitrack::Math::Quaternion& q)
+  {
+      const double xyzw[4] = { q.x(), q.y(), q.z(), q.w() };
+      memcpy(data, xyzw, size);
+  }
+
+  inline static void read(const uint8_t* data, Ubitrack::Math::Quaternion& q)
+  {
+      double xyzw[4];
+      memcpy(xyzw, data, size);
+      q = Ubitrack::Math::Quaternion(xyzw[0], xyzw[1], xyzw[2], xyzw[3]);
+  }
+};
+
+template<>
+struct PackedLayout<Ubitrack::Math::Pose> {
+  typedef PackedLayout<Ubitrack::Math::Vector<double, 3> > TranslationLayout;
+  typedef PackedLayout<Ubitrack::Math::Quaternion> RotationLayout;
+  static const uint32_t size = TranslationLayout::size+RotationLayout::size;
+
+  inline static void write(uint8_t* data, const Ubitrack::Math::Pose& p)
+  {
+      TranslationLayout::write(data, p.translation());
+      RotationLayout::write(data+TranslationLayout::size, p.rotation());
+  }
+
+  inline static void read(const uint8_t* data, Ubitrack::Math::Pose& p)
+  {
+      Ubitrack::Math::Vector<double, 3> t;
+      Ubitrack::Math::Quaternion q;
+      TranslationLayout::read(data, t);
+      RotationLayout::read(data+TranslationLayout::size, q);
+      p = Ubitrack::Math::Pose(q, t);
+  }
+};
+
+/// packed covariances are their upper triangle
+template<typename T, std::size_t N>
+struct PackedLayout<Ubitrack::Math::PackedCovariance<T, N> > {
+  static const uint32_t size = Ubitrack::Math::PackedCovariance<T, N>::packedSize*sizeof(T);
+
+  inline static void write(uint8_t* data, const Ubitrack::Math::PackedCovariance<T, N>& c)
+  {
+      memcpy(data, c.data(), size);
+  }
+
+  inline static void read(const uint8_t* data, Ubitrack::Math::PackedCovariance<T, N>& c)
+  {
+      memcpy(c.data(), data, size);
+  }
+};
+
+/// poses with packed covariance are the pose followed by the covariance
+template<typename C>
+struct PackedLayout<Ubitrack::Math::PackedErrorPose<C> > {
+  typedef PackedLayout<Ubitrack::Math::Pose> PoseLayout;
+  typedef PackedLayout<Ubitrack::Math::PackedCovariance<C, 6> > CovarianceLayout;
+  static const uint32_t size = PoseLayout::size+CovarianceLayout::size;
+
+  inline static void write(uint8_t* data, const Ubitrack::Math::PackedErrorPose<C>& p)
+  {
+      PoseLayout::write(data, p);
+      CovarianceLayout::write(data+PoseLayout::size, p.packedCovariance());
+  }
+
+  inline static void read(const uint8_t* data, Ubitrack::Math::PackedErrorPose<C>& p)
+  {
+      Ubitrack::Math::Pose pose;
+      Ubitrack::Math::PackedCovariance<C, 6> covariance;
+      PoseLayout::read(data, pose);
+      CovarianceLayout::read(data+PoseLayout::size, covariance);
+      p = Ubitrack::Math::PackedErrorPose<C>(pose, covariance);
+  }
+};
+
+/// vectors with packed covariance are the vector followed by the covariance
+template<typename T, std::size_t N, typename C>
+struct PackedLayout<Ubitrack::Math::PackedErrorVector<T, N, C> > {
+  typedef PackedLayout<Ubitrack::Math::Vector<T, N> > ValueLayout;
+  typedef PackedLayout<Ubitrack::Math::PackedCovariance<C, N> > CovarianceLayout;
+  static const uint32_t size = ValueLayout::size+CovarianceLayout::size;
+
+  inline static void write(uint8_t* data, const Ubitrack::Math::PackedErrorVector<T, N, C>& v)
+  {
+      ValueLayout::write(data, v.value);
+      CovarianceLayout::write(data+ValueLayout::size, v.covariance);
+  }
+
+  inline static void read(const uint8_t* data, Ubitrack::Math::PackedErrorVector<T, N, C>& v)
+  {
+      ValueLayout::read(data, v.value);
+      CovarianceLayout::read(data+ValueLayout::size, v.covariance);
+  }
+};
+
+/**
+ * \brief Serializer for packed types, copies the object into one block of the stream
+ */
+template<typename T>
+struct PackedSerializationFormat {
+  template<typename Stream>
+  inline static void write(Stream& stream, const T& t)
+  {
+      PackedLayout<T>::write(stream.advance(PackedLayout<T>::size), t);
+  }
+
+  template<typename Stream>
+  inline static void read(Stream& stream, T& t)
+  {
+      PackedLayout<T>::read(stream.advance(PackedLayout<T>::size), t);
+  }
+
+  inline static uint32_t maxSerializedLength(const T&)
+  {
+      return PackedLayout<T>::size;
+  }
+};
+
+template<typename T, std::size_t N>
+struct ROSBinarySerializationFormat<Ubitrack::Math::Vector<T, N> >
+        : public PackedSerializationFormat<Ubitrack::Math::Vector<T, N> > {};
+
+template<>
+struct ROSBinarySerializationFormat<Ubitrack::Math::Quaternion>
+        : public PackedSerializationFormat<Ubitrack::Math::Quaternion> {};
+
+template<>
+struct ROSBinarySerializationFormat<Ubitrack::Math::Pose>
+        : public PackedSerializationFormat<Ubitrack::Math::Pose> {};
+
+template<typename T, std::size_t N>
+struct ROSBinarySerializationFormat<Ubitrack::Math::PackedCovariance<T, N> >
+        : public PackedSerializationFormat<Ubitrack::Math::PackedCovariance<T, N> > {};
+
+template<typename C>
+struct ROSBinarySerializationFormat<Ubitrack::Math::PackedErrorPose<C> >
+        : public PackedSerializationFormat<Ubitrack::Math::PackedErrorPose<C> > {};
+
+template<typename T, std::size_t N, typename C>
+struct ROSBinarySerializationFormat<Ubitrack::Math::PackedErrorVector<T, N, C> >
+        : public PackedSerializationFormat<Ubitrack::Math::PackedErrorVector<T, N, C> > {};
+
+/**
+ * \brief Serializer for Math::Scalar, which has the layout of its builtin type
+ */
+template<typename T>
+struct ROSBinarySerializationFormat<Ubitrack::Math::Scalar<T> > {
+  template<typename Stream>
+  inline static void write(Stream& stream, const Ubitrack::Math::Scalar<T>& v)
+  {
+      ROSBinarySerializationFormat<T>::write(stream, v.m_value);
+  }
+
+  template<typename Stream>
+  inline static void read(Stream& stream, Ubitrack::Math::Scalar<T>& v)
+  {
+      ROSBinarySerializationFormat<T>::read(stream, v.m_value);
+  }
+
+  inline static uint32_t maxSerializedLength(const Ubitrack::Math::Scalar<T>&)
+  {
+      return sizeof(T);
+  }
+};
+
+} // namespace ROSBinary
+
+namespace Traits {
+
+template<typename T, std::size_t N>
+struct IsFixedSize<Ubitrack::Math::Vector<T, N> >: public TrueType {};
+template<typename T>
+struct IsFixedSize<Ubitrack::Math::Vector<T, 0> >: public FalseType {};
+template<typename T, std::size_t N>
+struct IsPacked<Ubitrack::Math::Vector<T, N> >: public TrueType {};
+template<typename T>
+struct IsPacked<Ubitrack::Math::Vector<T, 0> >: public FalseType {};
+
+template<>
+struct IsFixedSize<Ubitrack::Math::Quaternion>: public TrueType {};
+template<>
+struct IsPacked<Ubitrack::Math::Quaternion>: public TrueType {};
+
+template<>
+struct IsFixedSize<Ubitrack::Math::Pose>: public TrueType {};
+template<>
+struct IsPacked<Ubitrack::Math::Pose>: public TrueType {};
+
+template<typename T, std::size_t N>
+struct IsFixedSize<Ubitrack::Math::PackedCovariance<T, N> >: public TrueType {};
+template<typename T, std::size_t N>
+struct IsPacked<Ubitrack::Math::PackedCovariance<T, N> >: public TrueType {};
+
+template<typename C>
+struct IsFixedSize<Ubitrack::Math::PackedErrorPose<C> >: public TrueType {};
+template<typename C>
+struct IsPacked<Ubitrack::Math::PackedErrorPose<C> >: public TrueType {};
+
+template<typename T, std::size_t N, typename C>
+struct IsFixedSize<Ubitrack::Math::PackedErrorVector<T, N, C> >: public TrueType {};
+template<typename T, std::size_t N, typename C>
+struct IsPacked<Ubitrack::Math::PackedErrorVector<T, N, C> >: public TrueType {};
+
+// a scalar only consists of its value, so lists of scalars can be memcpy'd
+template<typename T>
+struct IsSimple<Ubitrack::Math::Scalar<T> >: public IsSimple<T> {};
+template<typename T>
+struct IsFixedSize<Ubitrack::Math::Scalar<T> >: public IsFixedSize<T> {};
+
+} // namespace Traits
+
+namespace ROSBinary {
+
 /**
  * \brief Vector serializer.  Default implementation does nothing
  */
@@ -280,7 +554,7 @@ struct VectorSerializer<T, ContainerAllocator, typename boost::enable_if<mt::IsS
       stream.next(len);
       if (!v.empty()) {
           const uint32_t data_len = len*(uint32_t) sizeof(T);
-          memcpy(stream.advance(data_len), &v.front(), data_len);
+          writeBlock(stream, &v.front(), data_len);
       }
   }
 
@@ -310,7 +584,8 @@ template<typename T, class ContainerAllocator>
 struct VectorSerializer<T,
                         ContainerAllocator,
                         typename boost::enable_if<mpl::and_<mt::IsFixedSize<T>,
-                                                            mpl::not_<mt::IsSimple<T> > > >::type> {
+                                                            mpl::not_<mt::IsSimple<T> >,
+                                                            mpl::not_<mt::IsPacked<T> > > >::type> {
   typedef std::vector<T, typename ContainerAllocator::template rebind<T>::other> VecType;
   typedef typename VecType::iterator IteratorType;
   typedef typename VecType::const_iterator ConstIteratorType;
@@ -351,6 +626,49 @@ struct VectorSerializer<T,
   }
 };
 
+/**
+ * \brief Vector serializer, specialized for packed types. The whole list is written into
+ * one block of the stream, so the bounds are only checked once.
+ */
+template<typename T, class ContainerAllocator>
+struct VectorSerializer<T, ContainerAllocator, typename boost::enable_if<mt::IsPacked<T> >::type> {
+  typedef std::vector<T, typename ContainerAllocator::template rebind<T>::other> VecType;
+  typedef typename VecType::iterator IteratorType;
+  typedef typename VecType::const_iterator ConstIteratorType;
+
+  template<typename Stream>
+  inline static void write(Stream& stream, const VecType& v)
+  {
+      uint32_t len = (uint32_t) v.size();
+      stream.next(len);
+      uint8_t* data = stream.advance(len*PackedLayout<T>::size);
+      ConstIteratorType it = v.begin();
+      ConstIteratorType end = v.end();
+      for (; it!=end; ++it, data += PackedLayout<T>::size) {
+          PackedLayout<T>::write(data, *it);
+      }
+  }
+
+  template<typename Stream>
+  inline static void read(Stream& stream, VecType& v)
+  {
+      uint32_t len;
+      stream.next(len);
+      const uint8_t* data = stream.advance(len*PackedLayout<T>::size);
+      v.resize(len);
+      IteratorType it = v.begin();
+      IteratorType end = v.end();
+      for (; it!=end; ++it, data += PackedLayout<T>::size) {
+          PackedLayout<T>::read(data, *it);
+      }
+  }
+
+  inline static uint32_t maxSerializedLength(const VecType& v)
+  {
+      return 4+(uint32_t) v.size()*PackedLayout<T>::size;
+  }
+};
+
 /**
  * \brief serialize version for std::vector
  */
@@ -375,7 +693,7 @@ inline void deserialize(Stream& stream, std::vector<T, ContainerAllocator>& t)
 template<typename T, class ContainerAllocator>
 inline uint32_t maxSerializationLength(const std::vector<T, ContainerAllocator>& t)
 {
-    return VectorSerializer<T, ContainerAllocator>::serializedLength(t);
+    return VectorSerializer<T, ContainerAllocator>::maxSerializedLength(t);
 }
 
 /**
@@ -439,7 +757,7 @@ struct ArraySerializer<T, N, typename boost::enable_if<mt::IsSimple<T> >::type>
   inline static void write(Stream& stream, const ArrayType& v)
   {
       const uint32_t data_len = N*sizeof(T);
-      memcpy(stream.advance(data_len), &v.front(), data_len);
+      writeBlock(stream, &v.front(), data_len);
   }
 
   template<typename Stream>
@@ -517,7 +835,7 @@ inline void deserialize(Stream& stream, boost::array<T, N>& t)
 template<typename T, size_t N>
 inline uint32_t maxSerializationLength(const boost::array<T, N>& t)
 {
-    return ArraySerializer<T, N>::serializedLength(t);
+    return ArraySerializer<T, N>::maxSerializedLength(t);
 }
 
 
@@ -0,0 +1,226 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Pooled buffers and scatter-gather streams for the binary serialization
+ */
+
+#include "utSerialization/ScatterGather.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+
+/// @internal released buffers, shared with the buffers in use
+struct BufferPool::FreeList {
+    explicit FreeList(std::size_t _maxFree)
+        : maxFree(_maxFree)
+    {}
+
+    ~FreeList()
+    {
+        for (std::size_t i = 0; i<buffers.size(); ++i)
+            delete buffers[i];
+    }
+
+    /// deleter of the buffers
+    static void release(const boost::shared_ptr<FreeList>& freeList, Bytes* buffer)
+    {
+        {
+            boost::mutex::scoped_lock lock(freeList->mutex);
+            if (freeList->buffers.size()<freeList->maxFree) {
+                freeList->buffers.push_back(buffer);
+                return;
+            }
+        }
+        delete buffer;
+    }
+
+    std::size_t maxFree;
+    mutable boost::mutex mutex;
+    std::vector<Bytes*> buffers;
+};
+
+
+BufferPool::BufferPool(std::size_t bufferSize, std::size_t maxFree)
+    : m_bufferSize(bufferSize)
+    , m_free(new FreeList(maxFree))
+{
+}
+
+
+BufferPool::Buffer BufferPool::acquire(std::size_t size)
+{
+    size = std::max(size, m_bufferSize);
+    Bytes* buffer = 0;
+    {
+        boost::mutex::scoped_lock lock(m_free->mutex);
+        if (!m_free->buffers.empty()) {
+            buffer = m_free->buffers.back();
+            m_free->buffers.pop_back();
+        }
+    }
+
+    if (!buffer)
+        buffer = new Bytes(size);
+    else if (buffer->size()<size)
+        buffer->resize(size);
+    return Buffer(buffer, boost::bind(&FreeList::release, m_free, _1));
+}
+
+
+std::size_t BufferPool::freeCount() const
+{
+    boost::mutex::scoped_lock lock(m_free->mutex);
+    return m_free->buffers.size();
+}
+
+
+namespace ROSBinary {
+
+GatherOStream::GatherOStream(BufferPool& pool, uint32_t referenceSize)
+    : m_pool(pool)
+    , m_referenceSize(referenceSize)
+    , m_pos(0)
+    , m_end(0)
+    , m_size(0)
+{
+}
+
+
+uint8_t* GatherOStream::advance(uint32_t len)
+{
+    if (std::size_t(m_end-m_pos)<len) {
+        m_chunks.push_back(m_pool.acquire(len));
+        m_pos = &m_chunks.back()->front();
+        m_end = m_pos+m_chunks.back()->size();
+    }
+
+    uint8_t* data = m_pos;
+    m_pos += len;
+    addSegment(data, len);
+    return data;
+}
+
+
+void GatherOStream::write(const void* data, uint32_t len)
+{
+    if (len<m_referenceSize)
+        memcpy(advance(len), data, len);
+    else
+        addSegment(static_cast<const uint8_t*>(data), len);
+}
+
+
+void GatherOStream::addSegment(const uint8_t* data, std::size_t len)
+{
+    m_size += len;
+    if (!m_segments.empty()) {
+        Segment& last = m_segments.back();
+        if (static_cast<const uint8_t*>(last.data)+last.size==data) {
+            last.size += len;
+            return;
+        }
+    }
+    Segment segment = { data, len };
+    m_segments.push_back(segment);
+}
+
+
+void GatherOStream::copyTo(uint8_t* dest) const
+{
+    for (std::size_t i = 0; i<m_segments.size(); ++i) {
+        memcpy(dest, m_segments[i].data, m_segments[i].size);
+        dest += m_segments[i].size;
+    }
+}
+
+
+void GatherOStream::clear()
+{
+    m_chunks.clear();
+    m_segments.clear();
+    m_pos = m_end = 0;
+    m_size = 0;
+}
+
+
+ScatterIStream::ScatterIStream(const std::vector<Segment>& fragments)
+    : m_fragments(fragments)
+    , m_fragment(0)
+    , m_offset(0)
+    , m_left(0)
+{
+    for (std::size_t i = 0; i<m_fragments.size(); ++i)
+        m_left += m_fragments[i].size;
+}
+
+
+uint8_t* ScatterIStream::advance(uint32_t len)
+{
+    if (len>m_left)
+        throwStreamOverrun();
+    m_left -= len;
+
+    // skip exhausted fragments
+    while (m_fragment<m_fragments.size() && m_offset==m_fragments[m_fragment].size) {
+        ++m_fragment;
+        m_offset = 0;
+    }
+    if (!len)
+        return 0;
+
+    const Segment& fragment = m_fragments[m_fragment];
+    uint8_t* data = const_cast<uint8_t*>(static_cast<const uint8_t*>(fragment.data))+m_offset;
+    if (fragment.size-m_offset>=len) {
+        m_offset += len;
+        return data;
+    }
+
+    // assemble items spanning fragments
+    m_scratch.resize(len);
+    std::size_t copied = 0;
+    while (copied<len) {
+        const Segment& f = m_fragments[m_fragment];
+        const std::size_t n = std::min(f.size-m_offset, len-copied);
+        memcpy(&m_scratch[copied], static_cast<const uint8_t*>(f.data)+m_offset, n);
+        copied += n;
+        m_offset += n;
+        if (m_offset==f.size && copied<len) {
+            ++m_fragment;
+            m_offset = 0;
+        }
+    }
+    return &m_scratch[0];
+}
+
+} // namespace ROSBinary
+} // namespace Serialization
+} // namespace Ubitrack
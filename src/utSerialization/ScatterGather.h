@@ -0,0 +1,248 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Pooled buffers and scatter-gather streams for the binary serialization
+ *
+ * A \c BufferPool hands out byte buffers and takes them back when they are released, so
+ * sending a message per measurement needs no allocation in steady state.
+ *
+ * \c ROSBinary::GatherOStream serializes into a list of segments instead of one contiguous
+ * buffer. Small items are copied into pooled chunks, while large blocks of simple types
+ * (e.g. a list of \c Math::Scalar<double>) are only referenced, so the segments can be
+ * passed to \c writev or \c sendmsg without concatenating them first:
+ * @code
+ * Serialization::BufferPool pool;
+ * Serialization::ROSBinary::GatherOStream out( pool );
+ * out << *distances;
+ * writev( socket, reinterpret_cast< const iovec* >( &out.segments()[ 0 ] ), out.segments().size() );
+ * out.clear();
+ * @endcode
+ * Referenced data must stay valid until the segments have been sent, e.g. by keeping the
+ * measurement.
+ *
+ * \c ROSBinary::ScatterIStream deserializes from a list of received fragments. Items within
+ * a fragment are read in place, only items spanning fragments are assembled in a scratch buffer.
+ */
+
+#ifndef UBITRACK_SCATTERGATHER_H
+#define UBITRACK_SCATTERGATHER_H
+
+#include "utSerialization/ROSBinarySerialization.h"
+#include "utUtil/AllocationTracker.h"
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+
+/**
+ * Thread-safe pool of byte buffers. Buffers are returned to the pool when the last copy
+ * of their \c shared_ptr is released, which may happen after the pool is destroyed.
+ */
+class UBITRACK_EXPORT BufferPool
+    : private boost::noncopyable
+{
+public:
+    /// byte vector, counted as serializer buffer if allocation tracking is enabled
+    typedef std::vector<uint8_t, Util::TrackedAllocator<uint8_t, Util::AllocationTracker::SerializerBuffer>::type> Bytes;
+    typedef boost::shared_ptr<Bytes> Buffer;
+
+    /**
+     * @param bufferSize minimum size of the buffers
+     * @param maxFree number of released buffers that are kept for reuse
+     */
+    explicit BufferPool(std::size_t bufferSize = 64*1024, std::size_t maxFree = 16);
+
+    /**
+     * returns a buffer of at least \c max(size, bufferSize) bytes. The contents are undefined.
+     * The buffer must not be resized.
+     */
+    Buffer acquire(std::size_t size = 0);
+
+    /** number of released buffers waiting for reuse */
+    std::size_t freeCount() const;
+
+    /** minimum size of the buffers */
+    std::size_t bufferSize() const
+    { return m_bufferSize; }
+
+protected:
+    struct FreeList;
+
+    std::size_t m_bufferSize;
+    boost::shared_ptr<FreeList> m_free;
+};
+
+
+/**
+ * A contiguous part of a message. The members are in the order of the POSIX \c iovec.
+ */
+struct Segment {
+    const void* data;
+    std::size_t size;
+};
+
+
+namespace ROSBinary {
+
+/**
+ * \brief Output stream into a list of segments
+ *
+ * Blocks written with \c write that are at least \c referenceSize bytes long are referenced
+ * instead of copied. Everything else is copied into chunks taken from the pool.
+ */
+class UBITRACK_EXPORT GatherOStream
+    : private boost::noncopyable
+{
+public:
+    static const StreamType stream_type = stream_types::Output;
+
+    GatherOStream(BufferPool& pool, uint32_t referenceSize = 1024);
+
+    /**
+     * \brief Reserves len contiguous bytes in the current chunk and returns a pointer to them
+     */
+    uint8_t* advance(uint32_t len);
+
+    /**
+     * \brief Appends a block of bytes, by reference if it is large enough
+     */
+    void write(const void* data, uint32_t len);
+
+    /**
+     * \brief Serialize an item to this output stream
+     */
+    template<typename T>
+    inline void next(const T& t)
+    {
+        serialize(*this, t);
+    }
+
+    template<typename T>
+    inline GatherOStream& operator<<(const T& t)
+    {
+        serialize(*this, t);
+        return *this;
+    }
+
+    /** the segments of the message, valid until \c clear */
+    const std::vector<Segment>& segments() const
+    { return m_segments; }
+
+    /** total number of bytes written */
+    std::size_t size() const
+    { return m_size; }
+
+    /** copies the whole message into \c dest, which must hold \c size() bytes */
+    void copyTo(uint8_t* dest) const;
+
+    /** starts a new message and returns the chunks to the pool */
+    void clear();
+
+protected:
+    /// appends a segment, or extends the last one if it ends at data
+    void addSegment(const uint8_t* data, std::size_t len);
+
+    BufferPool& m_pool;
+    uint32_t m_referenceSize;
+    std::vector<BufferPool::Buffer> m_chunks;
+    /// free space in the last chunk
+    uint8_t* m_pos;
+    uint8_t* m_end;
+    std::vector<Segment> m_segments;
+    std::size_t m_size;
+};
+
+/**
+ * \brief Writes large blocks of simple types by reference
+ */
+inline void writeBlock(GatherOStream& stream, const void* data, uint32_t len)
+{
+    stream.write(data, len);
+}
+
+
+/**
+ * \brief Input stream over a list of received fragments
+ *
+ * The fragments are not copied and must stay valid while the stream is used.
+ */
+class UBITRACK_EXPORT ScatterIStream
+    : private boost::noncopyable
+{
+public:
+    static const StreamType stream_type = stream_types::Input;
+
+    explicit ScatterIStream(const std::vector<Segment>& fragments);
+
+    /**
+     * \brief Advances the stream by len bytes and returns a pointer to them, which is
+     * valid until the next call.
+     * \throws StreamOverrunException if less than len bytes are left
+     */
+    uint8_t* advance(uint32_t len);
+
+    /**
+     * \brief Returns the number of bytes left in the stream
+     */
+    uint32_t getLength() const
+    { return (uint32_t) m_left; }
+
+    /**
+     * \brief Deserialize an item from this input stream
+     */
+    template<typename T>
+    inline void next(T& t)
+    {
+        deserialize(*this, t);
+    }
+
+    template<typename T>
+    inline ScatterIStream& operator>>(T& t)
+    {
+        deserialize(*this, t);
+        return *this;
+    }
+
+protected:
+    std::vector<Segment> m_fragments;
+    /// current fragment and position within it
+    std::size_t m_fragment;
+    std::size_t m_offset;
+    std::size_t m_left;
+    /// items spanning fragments
+    std::vector<uint8_t> m_scratch;
+};
+
+} // namespace ROSBinary
+} // namespace Serialization
+} // namespace Ubitrack
+
+#endif //UBITRACK_SCATTERGATHER_H
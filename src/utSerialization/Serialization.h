@@ -35,6 +35,7 @@
 
 #include "utSerialization/BoostArchiveSerializer.h"
 #include "utSerialization/MsgpackSerializer.h"
+#include "utUtil/TraceSpan.h"
 
 
 #include <boost/array.hpp>
@@ -68,6 +69,8 @@ enum SerializationProtocol {
 template<typename T, typename Stream>
 inline void serialize(const SerializationProtocol p, Stream& stream, const T& t)
 {
+    // attributes: protocol
+    UBITRACK_TRACE_SPAN("serialize", p);
     switch(p) {
     case PROTOCOL_BOOST_TEXT:
     {
@@ -97,6 +100,8 @@ inline void serialize(const SerializationProtocol p, Stream& stream, const T& t)
 template<typename T, typename Stream>
 inline void deserialize(const SerializationProtocol p, Stream& stream, T& t)
 {
+    // attributes: protocol
+    UBITRACK_TRACE_SPAN("deserialize", p);
     switch(p) {
     case PROTOCOL_BOOST_TEXT:
     {
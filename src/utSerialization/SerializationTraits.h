@@ -72,6 +72,13 @@ struct IsSimple: public FalseType {};
  */
 template<typename M>
 struct IsFixedSize: public FalseType {};
+/**
+ * \brief A packed datatype is a fixed-size type whose serialized form is one block of known length that is
+ * filled by copying contiguous parts of the object, but that cannot be memcpy'd as a whole (e.g. because it
+ * stores its size or its elements in a different order). Lists of packed types are written as one block.
+ */
+template<typename M>
+struct IsPacked: public FalseType {};
 /**
  * \brief HasHeader informs whether or not there is a header that gets serialized as the first thing in the message
  */
@@ -0,0 +1,600 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Lock-free transport of measurements between processes through shared memory
+ *
+ * A \c SharedMemoryWriter publishes the measurements of one type into a ring of slots in a
+ * named \c Util::SharedMemory region, any number of \c SharedMemoryReader in other processes
+ * on the same machine read them without locks and without system calls:
+ * @code
+ * // tracker process
+ * Serialization::SharedMemoryWriter< Math::Pose > writer( "ubitrack.head", 64 );
+ * writer.write( pose );
+ *
+ * // renderer process, once per frame
+ * Serialization::SharedMemoryReader< Math::Pose > reader( "ubitrack.head" );
+ * Measurement::Pose latest;
+ * if ( reader.latest( latest ) )
+ *     render( *latest );
+ * @endcode
+ * Lists are written with a maximum number of elements, which fixes the size of the slots:
+ * @code
+ * Serialization::SharedMemoryWriter< std::vector< Math::Vector< double, 3 > > > points( "ubitrack.markers", 16, 200 );
+ * @endcode
+ *
+ * Layout of the region, all fields in the byte order of the machine:
+ * @verbatim
+header   := magic (uint32), version (uint32), type (uint32), max elements (uint32),
+            capacity (uint64), slot size (uint64), padding to 64 bytes,
+            head (atomic uint64), padding to 128 bytes
+slot     := sequence (atomic uint64), time (uint64), payload (doubles), padding to a multiple of 64 bytes
+payload  := fixed size types: their elements, e.g. qx qy qz qw tx ty tz for poses
+            lists: number of elements (double), max elements * element payload
+@endverbatim
+ * Each slot is a sequence lock: before writing message \c n into slot <tt>n % capacity</tt> the
+ * single writer sets the sequence of the slot to <tt>2n + 1</tt>, afterwards to <tt>2n + 2</tt>,
+ * and then advances \c head to <tt>n + 1</tt>. A reader copies a slot and accepts the copy only
+ * if the sequence was <tt>2n + 2</tt> before and after copying, otherwise the writer has
+ * overwritten the slot in the meantime. So the writer never waits for readers, and a slow
+ * reader loses the oldest messages instead of slowing down the writer; \c lost counts them.
+ * Slots are aligned to cache lines, so readers of one slot do not disturb the writer of the next.
+ *
+ * The region is owned by the writer. When the writer is destroyed the name is removed, readers
+ * keep reading the last values and must be recreated to see a new writer with the same name.
+ * Requires lock-free 64 bit atomics, which all supported platforms have.
+ */
+
+#ifndef __UBITRACK_SERIALIZATION_SHAREDMEMORYRING_H_INCLUDED__
+#define __UBITRACK_SERIALIZATION_SHAREDMEMORYRING_H_INCLUDED__
+
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Quaternion.h>
+#include <utMath/Pose.h>
+#include <utMath/ErrorPose.h>
+#include <utMath/ErrorVector.h>
+#include <utMeasurement/Measurement.h>
+#include <utUtil/SharedMemory.h>
+#include <utUtil/Exception.h>
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+namespace Ubitrack { namespace Serialization {
+
+/**
+ * Conversion of a type to the payload of a shared memory slot. The specializations have:
+ * @verbatim
+static const boost::uint32_t typeId;                            // identifies the type in the header
+static const bool isList;                                       // true if the size depends on maxElements
+static std::size_t doubles( std::size_t maxElements );          // size of the payload
+static void encode( const T& value, double* p, std::size_t maxElements );
+static void decode( const double* p, T& value, std::size_t maxElements );
+@endverbatim
+ * Only \c decode of lists may allocate.
+ */
+template< class T >
+struct SharedMemoryCodec;
+
+
+template< std::size_t N >
+struct SharedMemoryCodec< Math::Vector< double, N > >
+{
+	static const boost::uint32_t typeId = 0x10 + N;
+	static const bool isList = false;
+
+	static std::size_t doubles( std::size_t )
+	{ return N; }
+
+	static void encode( const Math::Vector< double, N >& v, double* p, std::size_t )
+	{
+		for ( std::size_t i = 0; i < N; i++ )
+			p[ i ] = v( i );
+	}
+
+	static void decode( const double* p, Math::Vector< double, N >& v, std::size_t )
+	{
+		for ( std::size_t i = 0; i < N; i++ )
+			v( i ) = p[ i ];
+	}
+};
+
+
+template<>
+struct SharedMemoryCodec< Math::Quaternion >
+{
+	static const boost::uint32_t typeId = 0x01;
+	static const bool isList = false;
+
+	static std::size_t doubles( std::size_t )
+	{ return 4; }
+
+	static void encode( const Math::Quaternion& q, double* p, std::size_t )
+	{
+		p[ 0 ] = q.x();
+		p[ 1 ] = q.y();
+		p[ 2 ] = q.z();
+		p[ 3 ] = q.w();
+	}
+
+	static void decode( const double* p, Math::Quaternion& q, std::size_t )
+	{ q = Math::Quaternion( p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] ); }
+};
+
+
+template<>
+struct SharedMemoryCodec< Math::Pose >
+{
+	static const boost::uint32_t typeId = 0x02;
+	static const bool isList = false;
+
+	static std::size_t doubles( std::size_t )
+	{ return 7; }
+
+	static void encode( const Math::Pose& pose, double* p, std::size_t )
+	{
+		SharedMemoryCodec< Math::Quaternion >::encode( pose.rotation(), p, 0 );
+		SharedMemoryCodec< Math::Vector< double, 3 > >::encode( pose.translation(), p + 4, 0 );
+	}
+
+	static void decode( const double* p, Math::Pose& pose, std::size_t )
+	{
+		Math::Quaternion q;
+		Math::Vector< double, 3 > t;
+		SharedMemoryCodec< Math::Quaternion >::decode( p, q, 0 );
+		SharedMemoryCodec< Math::Vector< double, 3 > >::decode( p + 4, t, 0 );
+		pose = Math::Pose( q, t );
+	}
+};
+
+
+template<>
+struct SharedMemoryCodec< Math::ErrorPose >
+{
+	static const boost::uint32_t typeId = 0x03;
+	static const bool isList = false;
+
+	static std::size_t doubles( std::size_t )
+	{ return 7 + 36; }
+
+	static void encode( const Math::ErrorPose& pose, double* p, std::size_t )
+	{
+		SharedMemoryCodec< Math::Pose >::encode( pose, p, 0 );
+		const Math::Matrix< double, 6, 6 >& c( pose.covariance() );
+		for ( std::size_t i = 0; i < 6; i++ )
+			for ( std::size_t j = 0; j < 6; j++ )
+				p[ 7 + 6 * i + j ] = c( i, j );
+	}
+
+	static void decode( const double* p, Math::ErrorPose& pose, std::size_t )
+	{
+		Math::Pose mean;
+		SharedMemoryCodec< Math::Pose >::decode( p, mean, 0 );
+		Math::Matrix< double, 6, 6 > c;
+		for ( std::size_t i = 0; i < 6; i++ )
+			for ( std::size_t j = 0; j < 6; j++ )
+				c( i, j ) = p[ 7 + 6 * i + j ];
+		pose = Math::ErrorPose( mean, c );
+	}
+};
+
+
+template< std::size_t N >
+struct SharedMemoryCodec< Math::ErrorVector< double, N > >
+{
+	static const boost::uint32_t typeId = 0x20 + N;
+	static const bool isList = false;
+
+	static std::size_t doubles( std::size_t )
+	{ return N + N * N; }
+
+	static void encode( const Math::ErrorVector< double, N >& v, double* p, std::size_t )
+	{
+		SharedMemoryCodec< Math::Vector< double, N > >::encode( v.value, p, 0 );
+		for ( std::size_t i = 0; i < N; i++ )
+			for ( std::size_t j = 0; j < N; j++ )
+				p[ N + N * i + j ] = v.covariance( i, j );
+	}
+
+	static void decode( const double* p, Math::ErrorVector< double, N >& v, std::size_t )
+	{
+		SharedMemoryCodec< Math::Vector< double, N > >::decode( p, v.value, 0 );
+		for ( std::size_t i = 0; i < N; i++ )
+			for ( std::size_t j = 0; j < N; j++ )
+				v.covariance( i, j ) = p[ N + N * i + j ];
+	}
+};
+
+
+/** lists of fixed size types with at most \c maxElements elements */
+template< class E >
+struct SharedMemoryCodec< std::vector< E > >
+{
+	static const boost::uint32_t typeId = 0x100 + SharedMemoryCodec< E >::typeId;
+	static const bool isList = true;
+
+	static std::size_t doubles( std::size_t maxElements )
+	{ return 1 + maxElements * SharedMemoryCodec< E >::doubles( 0 ); }
+
+	static void encode( const std::vector< E >& v, double* p, std::size_t maxElements )
+	{
+		if ( v.size() > maxElements )
+			UBITRACK_THROW( "Shared memory transport: list has more elements than the slots can hold" );
+		const std::size_t elementSize = SharedMemoryCodec< E >::doubles( 0 );
+		p[ 0 ] = static_cast< double >( v.size() );
+		for ( std::size_t i = 0; i < v.size(); i++ )
+			SharedMemoryCodec< E >::encode( v[ i ], p + 1 + i * elementSize, 0 );
+	}
+
+	static void decode( const double* p, std::vector< E >& v, std::size_t maxElements )
+	{
+		const std::size_t elementSize = SharedMemoryCodec< E >::doubles( 0 );
+		const std::size_t n = std::min( static_cast< std::size_t >( p[ 0 ] ), maxElements );
+		v.resize( n );
+		for ( std::size_t i = 0; i < n; i++ )
+			SharedMemoryCodec< E >::decode( p + 1 + i * elementSize, v[ i ], 0 );
+	}
+};
+
+
+namespace Detail {
+
+/** @internal fixed part of the header, followed by \c head at \c headOffset */
+struct SharedMemoryRingHeader
+{
+	boost::uint32_t magic;
+	boost::uint32_t version;
+	boost::uint32_t typeId;
+	boost::uint32_t maxElements;
+	boost::uint64_t capacity;
+	boost::uint64_t slotSize;
+};
+
+/** @internal fixed part of a slot, followed by the payload */
+struct SharedMemorySlot
+{
+	boost::atomic< boost::uint64_t > sequence;
+	boost::uint64_t time;
+};
+
+/** @internal layout of a ring region, shared by writer and reader */
+class SharedMemoryRing
+	: private boost::noncopyable
+{
+public:
+	static const boost::uint32_t magic = 0x52447475; // "utDR"
+	static const boost::uint32_t version = 1;
+	static const std::size_t headOffset = 64;
+	static const std::size_t slotsOffset = 128;
+	static const std::size_t cacheLine = 64;
+
+	/** bytes per slot, rounded up to whole cache lines */
+	static std::size_t slotSize( std::size_t payloadDoubles )
+	{
+		const std::size_t bytes = sizeof( SharedMemorySlot ) + payloadDoubles * sizeof( double );
+		return ( bytes + cacheLine - 1 ) / cacheLine * cacheLine;
+	}
+
+	const SharedMemoryRingHeader& header() const
+	{ return *reinterpret_cast< const SharedMemoryRingHeader* >( m_memory->data() ); }
+
+	boost::atomic< boost::uint64_t >& head() const
+	{ return *reinterpret_cast< boost::atomic< boost::uint64_t >* >( m_memory->data() + headOffset ); }
+
+	SharedMemorySlot& slot( boost::uint64_t n ) const
+	{
+		return *reinterpret_cast< SharedMemorySlot* >( m_memory->data() + slotsOffset
+			+ static_cast< std::size_t >( n % m_capacity ) * m_slotSize );
+	}
+
+	static double* payload( SharedMemorySlot& s )
+	{ return reinterpret_cast< double* >( &s + 1 ); }
+
+	const std::string& name() const
+	{ return m_memory->name(); }
+
+	std::size_t capacity() const
+	{ return m_capacity; }
+
+	std::size_t maxElements() const
+	{ return m_maxElements; }
+
+	std::size_t payloadDoubles() const
+	{ return m_payloadDoubles; }
+
+protected:
+	/** creates a ring */
+	SharedMemoryRing( const std::string& name, boost::uint32_t typeId, std::size_t capacity, std::size_t maxElements, std::size_t payloadDoubles )
+		: m_capacity( capacity )
+		, m_maxElements( maxElements )
+		, m_payloadDoubles( payloadDoubles )
+		, m_slotSize( slotSize( payloadDoubles ) )
+	{
+		if ( capacity < 2 )
+			UBITRACK_THROW( "Shared memory transport: the ring needs at least two slots" );
+		m_memory.reset( new Util::SharedMemory( name, slotsOffset + capacity * m_slotSize ) );
+
+		// the new region is filled with zeros, a zero sequence is never valid
+		SharedMemoryRingHeader& h( *reinterpret_cast< SharedMemoryRingHeader* >( m_memory->data() ) );
+		new ( &head() ) boost::atomic< boost::uint64_t >( 0 );
+		checkLockFree();
+		for ( std::size_t i = 0; i < capacity; i++ )
+			new ( &slot( i ).sequence ) boost::atomic< boost::uint64_t >( 0 );
+		h.version = version;
+		h.typeId = typeId;
+		h.maxElements = static_cast< boost::uint32_t >( maxElements );
+		h.capacity = capacity;
+		h.slotSize = m_slotSize;
+
+		// readers that open the region in the meantime see no magic and fail
+		boost::atomic_thread_fence( boost::memory_order_release );
+		h.magic = magic;
+	}
+
+	/** opens an existing ring */
+	SharedMemoryRing( const std::string& name, boost::uint32_t typeId )
+		: m_memory( new Util::SharedMemory( name ) )
+	{
+		if ( m_memory->size() < slotsOffset )
+			UBITRACK_THROW( "Shared memory " + name + " is too small for a measurement ring" );
+		const SharedMemoryRingHeader& h( header() );
+		if ( h.magic != magic || h.version != version )
+			UBITRACK_THROW( "Shared memory " + name + " does not contain an initialized measurement ring" );
+		boost::atomic_thread_fence( boost::memory_order_acquire );
+		if ( h.typeId != typeId )
+			UBITRACK_THROW( "Shared memory " + name + " contains measurements of a different type" );
+		m_capacity = static_cast< std::size_t >( h.capacity );
+		m_maxElements = h.maxElements;
+		m_slotSize = static_cast< std::size_t >( h.slotSize );
+		if ( m_capacity < 2 || m_slotSize % cacheLine != 0 || slotsOffset + m_capacity * m_slotSize > m_memory->size() )
+			UBITRACK_THROW( "Shared memory " + name + " has an invalid layout" );
+		m_payloadDoubles = ( m_slotSize - sizeof( SharedMemorySlot ) ) / sizeof( double );
+		checkLockFree();
+	}
+
+	void checkLockFree() const
+	{
+		// other processes can only see atomics that are not implemented with a local lock
+		if ( !head().is_lock_free() )
+			UBITRACK_THROW( "Shared memory transport: 64 bit atomics are not lock-free on this platform" );
+	}
+
+	boost::scoped_ptr< Util::SharedMemory > m_memory;
+	std::size_t m_capacity;
+	std::size_t m_maxElements;
+	std::size_t m_payloadDoubles;
+	std::size_t m_slotSize;
+};
+
+} // namespace Detail
+
+
+/**
+ * Publishes measurements of type \c T into a new shared memory ring.
+ * There must be only one writer per ring, \c write is not thread-safe.
+ */
+template< class T >
+class SharedMemoryWriter
+	: public Detail::SharedMemoryRing
+{
+public:
+	typedef SharedMemoryCodec< T > codec_type;
+
+	/**
+	 * creates the ring, replacing an existing one with the same name
+	 * @param name name of the shared memory region
+	 * @param capacity number of slots, readers that fall further behind lose messages
+	 * @param maxElements maximum number of elements of lists, ignored for other types
+	 */
+	SharedMemoryWriter( const std::string& name, std::size_t capacity = 64, std::size_t maxElements = 0 )
+		: Detail::SharedMemoryRing( name, codec_type::typeId, capacity, checkedMaxElements( maxElements ),
+			codec_type::doubles( checkedMaxElements( maxElements ) ) )
+		, m_next( 0 )
+	{}
+
+	/** publishes a value with a timestamp, throws if a list has more than \c maxElements elements */
+	void write( Measurement::Timestamp t, const T& value )
+	{
+		if ( codec_type::isList )
+			checkSize( value );
+
+		Detail::SharedMemorySlot& s( slot( m_next ) );
+		s.sequence.store( 2 * m_next + 1, boost::memory_order_relaxed );
+		boost::atomic_thread_fence( boost::memory_order_release );
+		s.time = t;
+		codec_type::encode( value, payload( s ), m_maxElements );
+		s.sequence.store( 2 * m_next + 2, boost::memory_order_release );
+		head().store( ++m_next, boost::memory_order_release );
+	}
+
+	/** publishes a measurement */
+	void write( const Measurement::Measurement< T >& m )
+	{ write( m.time(), *m ); }
+
+	/** number of published measurements */
+	boost::uint64_t written() const
+	{ return m_next; }
+
+protected:
+	static std::size_t checkedMaxElements( std::size_t maxElements )
+	{
+		if ( !codec_type::isList )
+			return 0;
+		if ( maxElements == 0 )
+			UBITRACK_THROW( "Shared memory transport: lists need a maximum number of elements" );
+		return maxElements;
+	}
+
+	template< class V >
+	void checkSize( const V& ) const
+	{}
+
+	template< class E >
+	void checkSize( const std::vector< E >& v ) const
+	{
+		// before touching the slot, so readers never see a partial message
+		if ( v.size() > m_maxElements )
+			UBITRACK_THROW( "Shared memory transport: list has more elements than the slots can hold" );
+	}
+
+	boost::uint64_t m_next;
+};
+
+
+/**
+ * Reads measurements of type \c T from a shared memory ring created by a \c SharedMemoryWriter.
+ * Each reader has its own position in the stream, a reader must not be used by several threads
+ * at once.
+ */
+template< class T >
+class SharedMemoryReader
+	: public Detail::SharedMemoryRing
+{
+public:
+	typedef SharedMemoryCodec< T > codec_type;
+
+	/** opens the ring, throws if it does not exist or holds a different type */
+	explicit SharedMemoryReader( const std::string& name )
+		: Detail::SharedMemoryRing( name, codec_type::typeId )
+		, m_next( 0 )
+		, m_lost( 0 )
+	{
+		m_buffer.resize( payloadDoubles() );
+	}
+
+	/**
+	 * reads the most recent value in constant time, independent of how many were published
+	 * since the last call. Subsequent calls of \c next continue after this value.
+	 * @return false if nothing has been published yet
+	 */
+	bool latest( Measurement::Timestamp& t, T& value )
+	{
+		while ( true )
+		{
+			const boost::uint64_t h = head().load( boost::memory_order_acquire );
+			if ( h == 0 )
+				return false;
+			// only fails if the writer wrapped around the whole ring during the copy
+			if ( copy( h - 1, t ) )
+			{
+				m_next = h;
+				codec_type::decode( &m_buffer[ 0 ], value, maxElements() );
+				return true;
+			}
+		}
+	}
+
+	/** \c latest for measurements, allocates a new payload */
+	bool latest( Measurement::Measurement< T >& m )
+	{
+		Measurement::Timestamp t;
+		boost::shared_ptr< T > p( new T );
+		if ( !latest( t, *p ) )
+			return false;
+		m = Measurement::Measurement< T >( t, p );
+		return true;
+	}
+
+	/**
+	 * reads the next value that this reader has not seen yet. If the reader fell behind by more
+	 * than the capacity of the ring, it continues with the oldest value that is still available
+	 * and adds the skipped ones to \c lost.
+	 * @return false if there is no new value
+	 */
+	bool next( Measurement::Timestamp& t, T& value )
+	{
+		while ( true )
+		{
+			const boost::uint64_t h = head().load( boost::memory_order_acquire );
+			if ( m_next >= h )
+				return false;
+
+			// the slot of message h - capacity may be overwritten right now
+			const boost::uint64_t oldest = h >= capacity() ? h - capacity() + 1 : 0;
+			if ( m_next < oldest )
+			{
+				m_lost += oldest - m_next;
+				m_next = oldest;
+			}
+
+			if ( copy( m_next, t ) )
+			{
+				m_next++;
+				codec_type::decode( &m_buffer[ 0 ], value, maxElements() );
+				return true;
+			}
+		}
+	}
+
+	/** \c next for measurements, allocates a new payload */
+	bool next( Measurement::Measurement< T >& m )
+	{
+		Measurement::Timestamp t;
+		boost::shared_ptr< T > p( new T );
+		if ( !next( t, *p ) )
+			return false;
+		m = Measurement::Measurement< T >( t, p );
+		return true;
+	}
+
+	/** true if \c next would return a value */
+	bool available() const
+	{ return head().load( boost::memory_order_acquire ) > m_next; }
+
+	/** number of values skipped by \c next because the reader was too slow */
+	boost::uint64_t lost() const
+	{ return m_lost; }
+
+protected:
+	/** copies the payload of message \c n into the buffer, false if it has been overwritten */
+	bool copy( boost::uint64_t n, Measurement::Timestamp& t )
+	{
+		Detail::SharedMemorySlot& s( slot( n ) );
+		const boost::uint64_t expected = 2 * n + 2;
+		if ( s.sequence.load( boost::memory_order_acquire ) != expected )
+			return false;
+		t = s.time;
+		std::memcpy( &m_buffer[ 0 ], payload( s ), m_buffer.size() * sizeof( double ) );
+		boost::atomic_thread_fence( boost::memory_order_acquire );
+		return s.sequence.load( boost::memory_order_relaxed ) == expected;
+	}
+
+	boost::uint64_t m_next;
+	boost::uint64_t m_lost;
+	std::vector< double > m_buffer;
+};
+
+} } // namespace Ubitrack::Serialization
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Streaming writer with bounded, asynchronously flushed buffers
+ */
+
+#include "utSerialization/StreamingWriter.h"
+#include "utUtil/TraceSpan.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+
+StreamingWriter::StreamingWriter(const Sink& sink, std::size_t chunkSize, std::size_t chunks)
+    : m_sink(sink)
+    , m_chunkSize(chunkSize)
+    , m_chunks(std::max(chunks, std::size_t(2)))
+    , m_current(0)
+    , m_stop(false)
+    , m_bytesWritten(0)
+{
+    for (std::size_t i = 0; i<m_chunks.size(); ++i) {
+        m_chunks[i].data.resize(m_chunkSize);
+        m_chunks[i].used = 0;
+        m_free.push_back(&m_chunks[i]);
+    }
+    m_current = m_free.front();
+    m_free.pop_front();
+
+    m_thread.reset(new boost::thread(boost::bind(&StreamingWriter::run, this)));
+}
+
+
+StreamingWriter::~StreamingWriter()
+{
+    try {
+        flush();
+    }
+    catch (...) {
+    }
+
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_queued.notify_all();
+    m_thread->join();
+}
+
+
+uint8_t* StreamingWriter::reserve(uint32_t size)
+{
+    if (size>m_chunkSize)
+        throw StreamOverrunException("Object is larger than the chunks of the streaming writer");
+
+    // the current chunk belongs to the calling thread, only switching chunks needs the lock
+    if (m_current->used+size>m_chunkSize) {
+        boost::mutex::scoped_lock lock(m_mutex);
+        checkError();
+        if (m_free.empty())
+            throw StreamOverrunException("Streaming writer overrun, the sink does not keep up");
+        submit();
+    }
+
+    uint8_t* data = &m_current->data[0]+m_current->used;
+    m_current->used += size;
+    return data;
+}
+
+
+void StreamingWriter::submit()
+{
+    m_queue.push_back(m_current);
+    m_current = m_free.front();
+    m_free.pop_front();
+    m_queued.notify_one();
+}
+
+
+void StreamingWriter::checkError() const
+{
+    if (!m_error.empty())
+        UBITRACK_THROW("Streaming writer sink failed: " + m_error);
+}
+
+
+void StreamingWriter::flush()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_current->used>0) {
+        // flushing may wait, unlike write
+        while (m_free.empty())
+            m_consumed.wait(lock);
+        submit();
+    }
+    while (!m_queue.empty())
+        m_consumed.wait(lock);
+    checkError();
+}
+
+
+std::size_t StreamingWriter::pendingChunks() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_queue.size();
+}
+
+
+bool StreamingWriter::congested() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_free.empty();
+}
+
+
+uint64_t StreamingWriter::bytesWritten() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_bytesWritten;
+}
+
+
+void StreamingWriter::run()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (true) {
+        while (m_queue.empty() && !m_stop)
+            m_queued.wait(lock);
+        if (m_queue.empty())
+            return;
+
+        // the chunk stays in the queue while the sink works on it
+        Chunk* chunk = m_queue.front();
+        lock.unlock();
+        std::string error;
+        try {
+            // attributes: bytes
+            UBITRACK_TRACE_SPAN("streaming_writer_sink", chunk->used);
+            m_sink(&chunk->data[0], chunk->used);
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+        }
+        catch (...) {
+            error = "unknown exception";
+        }
+        lock.lock();
+
+        if (!error.empty() && m_error.empty())
+            m_error = error;
+        else if (error.empty())
+            m_bytesWritten += chunk->used;
+        chunk->used = 0;
+        m_queue.pop_front();
+        m_free.push_back(chunk);
+        m_consumed.notify_all();
+    }
+}
+
+} // Serialization
+} // Ubitrack
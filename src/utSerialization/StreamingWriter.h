@@ -0,0 +1,148 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup serialization
+ * @file
+ * Streaming writer with bounded, asynchronously flushed buffers
+ *
+ * The serializers write single objects into a caller provided stream. A recorder running
+ * in the tracking thread however should neither allocate per measurement nor wait for
+ * disk or network I/O. The \c StreamingWriter serializes objects in the ROS binary format
+ * into a fixed number of reusable chunks. Full chunks are passed to a sink function on a
+ * background thread, while the caller continues with the next free chunk:
+ * @code
+ * std::ofstream file( "poses.bin", std::ios::binary );
+ * Serialization::StreamingWriter writer( boost::bind( &writeToFile, boost::ref( file ), _1, _2 ) );
+ * writer.write( pose );
+ * @endcode
+ *
+ * With the default of two chunks this is double buffering. \c write never blocks: if all
+ * chunks are waiting for the sink, i.e. the consumer really falls behind, it throws a
+ * \c StreamOverrunException and the object is not written. \c pendingChunks
+ * and \c congested report the back-pressure before that happens.
+ */
+
+#ifndef UBITRACK_STREAMINGWRITER_H
+#define UBITRACK_STREAMINGWRITER_H
+
+#include "utSerialization/ROSBinarySerialization.h"
+#include "utUtil/AllocationTracker.h"
+
+#include <deque>
+#include <vector>
+#include <string>
+
+#include <boost/utility.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace Ubitrack {
+namespace Serialization {
+
+class UBITRACK_EXPORT StreamingWriter
+    : private boost::noncopyable
+{
+public:
+    /** receives the data of one chunk, called on the background thread */
+    typedef boost::function<void (const uint8_t* data, std::size_t size)> Sink;
+
+    /**
+     * starts the background thread
+     * @param sink function that consumes the full chunks, e.g. writes them to a file
+     * @param chunkSize size of each chunk in bytes, also the maximum size of one object
+     * @param chunks number of chunks, at least 2
+     */
+    StreamingWriter(const Sink& sink, std::size_t chunkSize = 64*1024, std::size_t chunks = 2);
+
+    /** flushes all data and stops the background thread */
+    ~StreamingWriter();
+
+    /**
+     * serializes an object into the current chunk.
+     * \throws StreamOverrunException if the object does not fit into a chunk or no chunk is free
+     * \throws Util::Exception if the sink failed before
+     */
+    template<typename T>
+    void write(const T& t)
+    {
+        ROSBinary::LStream length;
+        length.next(t);
+        ROSBinary::OStream out(reserve(length.getLength()), length.getLength());
+        out.next(t);
+    }
+
+    /** passes the current chunk to the sink and waits until all data is consumed */
+    void flush();
+
+    /** number of chunks that wait for or are being processed by the sink */
+    std::size_t pendingChunks() const;
+
+    /** true if all spare chunks are pending, so the next full chunk will cause an overrun */
+    bool congested() const;
+
+    /** number of bytes passed to the sink so far */
+    uint64_t bytesWritten() const;
+
+protected:
+    struct Chunk {
+        std::vector<uint8_t, Util::TrackedAllocator<uint8_t, Util::AllocationTracker::SerializerBuffer>::type> data;
+        std::size_t used;
+    };
+
+    /// returns space for size bytes in the current chunk, switching to a free chunk if necessary
+    uint8_t* reserve(uint32_t size);
+
+    /// queues the current chunk and takes a free one, the mutex must be locked
+    void submit();
+
+    /// throws if the sink failed, the mutex must be locked
+    void checkError() const;
+
+    /// background thread
+    void run();
+
+    Sink m_sink;
+    std::size_t m_chunkSize;
+    std::vector<Chunk> m_chunks;
+    Chunk* m_current;
+    std::deque<Chunk*> m_free;
+    std::deque<Chunk*> m_queue;
+
+    mutable boost::mutex m_mutex;
+    boost::condition_variable m_queued;
+    boost::condition_variable m_consumed;
+    bool m_stop;
+    std::string m_error;
+    uint64_t m_bytesWritten;
+    boost::scoped_ptr<boost::thread> m_thread;
+};
+
+} // Serialization
+} // Ubitrack
+
+#endif //UBITRACK_STREAMINGWRITER_H
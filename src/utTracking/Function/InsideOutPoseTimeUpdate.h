@@ -37,6 +37,8 @@
 #include <boost/numeric/ublas/vector_proxy.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
 #include "LinearTimeUpdate.h"
 #include "QuaternionTimeUpdate.h"
 #include <utMath/Optimization/Function/QuaternionVectorRotation.h>
@@ -92,23 +94,23 @@ public:
 		// update position
 
 		// rotate angular velocity into the translation coordinate frame
-		ublas::vector< T > angVelRotated( 3 );
-		ublas::matrix< T, ublas::column_major > jAngVelRotatedQ( 3, 4 );
-		ublas::matrix< T, ublas::column_major > jAngVelRotatedV( 3, 3 );
+		Math::Vector< T, 3 > angVelRotated;
+		Math::Matrix< T, 3, 4 > jAngVelRotatedQ;
+		Math::Matrix< T, 3, 3 > jAngVelRotatedV;
 		Math::Optimization::Function::QuaternionVectorRotation().evaluateWithJacobian( angVelRotated,
 			ublas::subrange( input, rs, rs + 4 ), ublas::subrange( input, rs + 4, rs + 7 ),
 			jAngVelRotatedQ, jAngVelRotatedV );
 
 		// integrate angular velocity
-		ublas::vector< T > transUpdateRotation( 4 );
-		ublas::matrix< T, ublas::column_major > jTransRotIntegrate( 4, 3 );
+		Math::Vector< T, 4 > transUpdateRotation;
+		Math::Matrix< T, 4, 3 > jTransRotIntegrate;
 		Math::Optimization::Function::RotationVelocityIntegration( m_deltaTime ).evaluateWithJacobian( 
 			transUpdateRotation, angVelRotated, jTransRotIntegrate );
 
 		// rotate translation by new quaternion
-		ublas::vector< T > newTranslationTmp( 3 );
-		ublas::matrix< T, ublas::column_major > jRotateTranslationQ( 3, 4 );
-		ublas::matrix< T, ublas::column_major > jRotateTranslationV( 3, 3 );
+		Math::Vector< T, 3 > newTranslationTmp;
+		Math::Matrix< T, 3, 4 > jRotateTranslationQ;
+		Math::Matrix< T, 3, 3 > jRotateTranslationV;
 		Math::Optimization::Function::QuaternionVectorRotation().evaluateWithJacobian( newTranslationTmp,
 			transUpdateRotation, ublas::subrange( input, 0, 3 ), jRotateTranslationQ, jRotateTranslationV );
 
@@ -127,7 +129,7 @@ public:
 
 		// jacobian d translation/d rotation
 		{
-		ublas::matrix< T, ublas::column_major > jAcc( ublas::prod( jRotateTranslationQ, jTransRotIntegrate ) );
+		Math::Matrix< T, 3, 3 > jAcc( ublas::prod( jRotateTranslationQ, jTransRotIntegrate ) );
 		noalias( ublas::subrange( jacobian, 0, 3, rs, rs + 4 ) ) = ublas::prod( jAcc, jAngVelRotatedQ );
 
 		// jacobian d translation / d angular velocity
@@ -149,7 +151,7 @@ public:
 			noalias( ublas::subrange( jacobian, 3, 6, 3, 6 ) ) = jRotateTranslationV;
 
 			// jacobian d velocity/d rotation
-			ublas::matrix< T, ublas::column_major > jAcc( ublas::prod( jRotateTranslationQ, jTransRotIntegrate ) );
+			Math::Matrix< T, 3, 3 > jAcc( ublas::prod( jRotateTranslationQ, jTransRotIntegrate ) );
 			noalias( ublas::subrange( jacobian, 3, 6, rs, rs + 4 ) ) = ublas::prod( jAcc, jAngVelRotatedQ );
 
 			// jacobian d velocity / d angular velocity
@@ -58,6 +58,25 @@ public:
 	unsigned size() const
 	{ return m_size; }
 	
+	/**
+	 * Updates the vector without computing the jacobian.
+	 * @param result vector to put the result in
+	 * @param input vector with (vectorSize * (1 + \c order)) elements containing the input vector and \c order derivatives
+	 */
+	template< class VectorType1, class VectorType2 > 
+	void evaluate( VectorType1& result, const VectorType2& input ) const
+	{
+		for ( unsigned k = 0; k < m_size; k++ )
+			result( k ) = input( k );
+		double t = 1;
+		for ( unsigned i = 1; i <= m_order; i++ )
+		{
+			t *= m_deltaTime / i;
+			for ( unsigned k = 0; k < m_size; k++ )
+				result( k ) += t * input( m_size * i + k );
+		}
+	}
+
 	/**
 	 * @param result vector to put the result in
 	 * @param input vector with (vectorSize * (1 + \c order)) elements containing the input vector and \c order derivatives
@@ -66,20 +85,24 @@ public:
 	template< class VectorType1, class VectorType2, class MT > 
 	void evaluateWithJacobian( VectorType1& result, const VectorType2& input, MT& jacobian ) const
 	{
-		namespace ublas = boost::numeric::ublas;
+		typedef typename MT::value_type T;
 
-		result = ublas::subrange( input, 0, m_size );
-		ublas::subrange( jacobian, 0, m_size, 0, m_size ) = 
-			ublas::identity_matrix< typename MT::value_type >( m_size, m_size );
-		
-		typename MT::value_type t = 1;
-		for ( unsigned i = 1; i <= m_order; i++ )
+		// block i of the jacobian is dt^i / i! times the identity
+		T t = 1;
+		for ( unsigned i = 0; i <= m_order; i++ )
 		{
-			t *= static_cast< typename MT::value_type >( m_deltaTime ) / i;
-			
-			result += t * ublas::subrange( input, m_size * i, m_size * (i+1) );
-			ublas::subrange( jacobian, 0, m_size, m_size * i, m_size * (i+1) ) = 
-				t * ublas::identity_matrix< typename MT::value_type >( m_size, m_size );
+			if ( i > 0 )
+				t *= static_cast< T >( m_deltaTime ) / i;
+
+			for ( unsigned c = 0; c < m_size; c++ )
+				for ( unsigned r = 0; r < m_size; r++ )
+					jacobian( r, m_size * i + c ) = r == c ? t : T( 0 );
+
+			for ( unsigned k = 0; k < m_size; k++ )
+				if ( i == 0 )
+					result( k ) = input( k );
+				else
+					result( k ) += t * input( m_size * i + k );
 		}
 	}
 
@@ -75,22 +75,17 @@ public:
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& jacobian ) const
 	{
 		namespace ublas = boost::numeric::ublas;
+		typedef typename MT::value_type T;
 		const int rs = 3 + 3 * m_posOrder; // start of rotation
 		const int ts = size(); // total size
+
+		// only the blocks written below are not zero
+		for ( int c = 0; c < ts; c++ )
+			for ( int r = 0; r < ts; r++ )
+				jacobian( r, c ) = T( 0 );
 		
 		// update position and its derivatives
-		for ( int i = 0; i <= m_posOrder; i++ )
-		{
-			const int s = 3 * i;
-			ublas::vector_range< VT1 > resultSubRange( result, ublas::range( s, s + 3 ) );
-			ublas::matrix_range< MT > jacobianSubRange( jacobian, ublas::range( s, s + 3 ), ublas::range( s, rs ) );
-			LinearTimeUpdate( m_deltaTime, 3, m_posOrder - i )
-				.evaluateWithJacobian( resultSubRange, ublas::subrange( input, s, rs ), jacobianSubRange );
-			ublas::subrange( jacobian, s, s + 3, 0, s ) = 
-				ublas::zero_matrix< typename MT::value_type >( 3, s );
-			ublas::subrange( jacobian, s, s + 3, rs, ts ) = 
-				ublas::zero_matrix< typename MT::value_type >( 3, ts - rs );
-		}
+		linearUpdate( result, input, jacobian, 0, m_posOrder );
 		
 		// update the rotation quaternion
 		if ( m_rotOrder >= 0 )
@@ -99,25 +94,42 @@ public:
 			ublas::matrix_range< MT > jacobianSubRange( jacobian, ublas::range( rs, rs + 4 ), ublas::range( rs, ts ) );
 			QuaternionTimeUpdate( m_deltaTime, m_rotOrder )
 				.evaluateWithJacobian( resultSubRange, ublas::subrange( input, rs, ts ), jacobianSubRange );
-			ublas::subrange( jacobian, rs, rs + 4, 0, rs ) = 
-				ublas::zero_matrix< typename MT::value_type >( 4, rs );
 		}
 		
 		// update the quaternion derivatives
-		for ( int i = 1; i <= m_rotOrder; i++ )
+		if ( m_rotOrder >= 1 )
+			linearUpdate( result, input, jacobian, rs + 4, m_rotOrder - 1 );
+	}
+
+protected:
+	/**
+	 * Updates a 3-vector and its \c order derivatives starting at \c start. Derivative \c i
+	 * becomes <tt>sum_k dt^k / k! * derivative( i + k )</tt>.
+	 */
+	template< class VT1, class VT2, class MT > 
+	void linearUpdate( VT1& result, const VT2& input, MT& jacobian, const int start, const int order ) const
+	{
+		typedef typename MT::value_type T;
+		for ( int i = 0; i <= order; i++ )
 		{
-			const int s = rs + 1 + 3 * i;
-			ublas::vector_range< VT1 > resultSubRange( result, ublas::range( s, s + 3 ) );
-			ublas::matrix_range< MT > jacobianSubRange( jacobian, ublas::range( s, s + 3 ), ublas::range( s, ts ) );
-			LinearTimeUpdate( m_deltaTime, 3, m_rotOrder - i )
-				.evaluateWithJacobian( resultSubRange, ublas::subrange( input, s, ts ), jacobianSubRange );
-			ublas::subrange( jacobian, s, s + 3, 0, s ) = 
-				ublas::zero_matrix< typename MT::value_type >( 3, s );
+			const int s = start + 3 * i;
+			T t = 1;
+			for ( int k = 0; k <= order - i; k++ )
+			{
+				if ( k > 0 )
+					t *= static_cast< T >( m_deltaTime ) / k;
+				for ( int r = 0; r < 3; r++ )
+				{
+					jacobian( s + r, s + 3 * k + r ) = t;
+					if ( k == 0 )
+						result( s + r ) = input( s + r );
+					else
+						result( s + r ) += t * input( s + 3 * k + r );
+				}
+			}
 		}
-
 	}
 
-protected:
 	double m_deltaTime;
 	int m_posOrder;
 	int m_rotOrder;
@@ -32,6 +32,8 @@
 #ifndef __UBITRACK_TRACKING_FUNCTION_QUATERNIONTIMEUPDATE_H_INCLUDED__
 #define __UBITRACK_TRACKING_FUNCTION_QUATERNIONTIMEUPDATE_H_INCLUDED__
 
+#include <cmath>
+
 #include <utMath/Quaternion.h>
 #include <utMath/RotationVelocity.h>
 #include <boost/numeric/ublas/vector_proxy.hpp>
@@ -58,6 +60,20 @@ public:
 	unsigned size() const
 	{ return 4; }
 	
+	/**
+	 * Updates the quaternion without computing the jacobian.
+	 * @param result 4-vector to put the result quaternion in
+	 * @param input vector with (4 + 3 * \c order) elements containing the input quaternions and \c order derivatives
+	 */
+	template< class VT1, class VT2 > 
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		double r[ 4 ];
+		integrate( input, r );
+		for ( unsigned k = 0; k < 4; k++ )
+			result( k ) = r[ k ];
+	}
+
 	/**
 	 * @param result 4-vector to put the result quaternion in
 	 * @param input vector with (4 + 3 * \c order) elements containing the input quaternions and \c order derivatives
@@ -66,40 +82,102 @@ public:
 	template< class VT1, class VT2, class MT > 
 	void evaluateWithJacobian( VT1& result, const VT2& input, MT& jacobian ) const
 	{
-		namespace ublas = boost::numeric::ublas;
-		
-		Math::Quaternion q( Math::Quaternion::fromVector( input ) );
-		Math::Quaternion r( q );
+		typedef typename MT::value_type T;
+
+		const double qx = input( 0 );
+		const double qy = input( 1 );
+		const double qz = input( 2 );
+		const double qw = input( 3 );
+
 		double t = m_deltaTime;
 		for ( unsigned i = 0; i < m_order; i++ )
 		{
-			Math::RotationVelocity v( ublas::subrange( input, 4 + 3 * i, 4 + 3 * ( i + 1 ) ) );
-			r = r * v.integrate( t );
 			t *= m_deltaTime;
+			const double h = t / 2;
+			const unsigned c = 4 + i * 3;
 			
-			jacobian( 0, 4 + i * 3 + 0 ) =  t * q.w() / 2;
-			jacobian( 0, 4 + i * 3 + 1 ) = -t * q.z() / 2;
-			jacobian( 0, 4 + i * 3 + 2 ) =  t * q.y() / 2;
+			jacobian( 0, c + 0 ) = T(  h * qw );
+			jacobian( 0, c + 1 ) = T( -h * qz );
+			jacobian( 0, c + 2 ) = T(  h * qy );
 			
-			jacobian( 1, 4 + i * 3 + 0 ) =  t * q.z() / 2;
-			jacobian( 1, 4 + i * 3 + 1 ) =  t * q.w() / 2;
-			jacobian( 1, 4 + i * 3 + 2 ) = -t * q.x() / 2;
+			jacobian( 1, c + 0 ) = T(  h * qz );
+			jacobian( 1, c + 1 ) = T(  h * qw );
+			jacobian( 1, c + 2 ) = T( -h * qx );
 
-			jacobian( 2, 4 + i * 3 + 0 ) = -t * q.y() / 2;
-			jacobian( 2, 4 + i * 3 + 1 ) =  t * q.x() / 2;
-			jacobian( 2, 4 + i * 3 + 2 ) =  t * q.w() / 2;
+			jacobian( 2, c + 0 ) = T( -h * qy );
+			jacobian( 2, c + 1 ) = T(  h * qx );
+			jacobian( 2, c + 2 ) = T(  h * qw );
 			
-			jacobian( 3, 4 + i * 3 + 0 ) = -t * q.x() / 2;
-			jacobian( 3, 4 + i * 3 + 1 ) = -t * q.y() / 2;
-			jacobian( 3, 4 + i * 3 + 2 ) = -t * q.z() / 2;
+			jacobian( 3, c + 0 ) = T( -h * qx );
+			jacobian( 3, c + 1 ) = T( -h * qy );
+			jacobian( 3, c + 2 ) = T( -h * qz );
 		}
-		
-		r.toVector( result );
 
-		ublas::subrange( jacobian, 0, 4, 0, 4 ) = ublas::identity_matrix< typename MT::value_type >( 4 );
+		for ( unsigned r = 0; r < 4; r++ )
+			for ( unsigned c = 0; c < 4; c++ )
+				jacobian( r, c ) = r == c ? T( 1 ) : T( 0 );
+
+		double q[ 4 ];
+		integrate( input, q );
+		for ( unsigned k = 0; k < 4; k++ )
+			result( k ) = q[ k ];
 	}
 
 protected:
+	/**
+	 * Multiplies the input quaternion with the integrated derivatives, in the same way as
+	 * <tt>q * RotationVelocity( v ).integrate( t )</tt>, but without temporaries. The integration of
+	 * a rotation velocity uses the series of sin and cos for small angles, as IMU-driven updates
+	 * typically rotate by less than 0.01 rad per step.
+	 */
+	template< class VT >
+	void integrate( const VT& input, double q[ 4 ] ) const
+	{
+		q[ 0 ] = input( 0 );
+		q[ 1 ] = input( 1 );
+		q[ 2 ] = input( 2 );
+		q[ 3 ] = input( 3 );
+
+		double t = m_deltaTime;
+		for ( unsigned i = 0; i < m_order; i++ )
+		{
+			// d = quaternion of the rotation vector v * t
+			const double vx = input( 4 + 3 * i ) * t;
+			const double vy = input( 5 + 3 * i ) * t;
+			const double vz = input( 6 + 3 * i ) * t;
+			const double angle2 = vx * vx + vy * vy + vz * vz;
+			double s;
+			double dw;
+			if ( angle2 < 1e-4 )
+			{
+				// sin( a / 2 ) / a and cos( a / 2 ), the remainders are below 1e-18
+				s = 0.5 - angle2 * ( 1.0 / 48 ) + angle2 * angle2 * ( 1.0 / 3840 );
+				dw = 1.0 - angle2 * ( 1.0 / 8 ) + angle2 * angle2 * ( 1.0 / 384 );
+			}
+			else
+			{
+				const double angle = std::sqrt( angle2 );
+				s = std::sin( angle / 2 ) / angle;
+				dw = std::cos( angle / 2 );
+			}
+			const double dx = s * vx;
+			const double dy = s * vy;
+			const double dz = s * vz;
+
+			// q = q * d
+			const double x = q[ 3 ] * dx + q[ 0 ] * dw + q[ 1 ] * dz - q[ 2 ] * dy;
+			const double y = q[ 3 ] * dy - q[ 0 ] * dz + q[ 1 ] * dw + q[ 2 ] * dx;
+			const double z = q[ 3 ] * dz + q[ 0 ] * dy - q[ 1 ] * dx + q[ 2 ] * dw;
+			const double w = q[ 3 ] * dw - q[ 0 ] * dx - q[ 1 ] * dy - q[ 2 ] * dz;
+			q[ 0 ] = x;
+			q[ 1 ] = y;
+			q[ 2 ] = z;
+			q[ 3 ] = w;
+
+			t *= m_deltaTime;
+		}
+	}
+
 		double m_deltaTime;
 		unsigned m_order;
 };
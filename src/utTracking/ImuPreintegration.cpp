@@ -0,0 +1,231 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * implementation of the IMU preintegration
+ */
+
+#include "ImuPreintegration.h"
+
+#include <cmath>
+#include <utMath/LieGroups.h>
+#include <utUtil/Exception.h>
+
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+typedef Ubitrack::Math::Matrix< double, 3, 3 > Matrix3;
+typedef Ubitrack::Math::Vector< double, 3 > Vector3;
+
+/** the cross product matrix [ v ]x */
+Matrix3 skew( const Vector3& v )
+{
+	Matrix3 m;
+	m( 0, 0 ) = 0;       m( 0, 1 ) = -v( 2 ); m( 0, 2 ) = v( 1 );
+	m( 1, 0 ) = v( 2 );  m( 1, 1 ) = 0;       m( 1, 2 ) = -v( 0 );
+	m( 2, 0 ) = -v( 1 ); m( 2, 1 ) = v( 0 );  m( 2, 2 ) = 0;
+	return m;
+}
+
+/** m = a * b * a^T for 3x3 blocks */
+Matrix3 sandwich( const Matrix3& a, const Matrix3& b )
+{
+	const Matrix3 ab( ublas::prod( a, b ) );
+	return Matrix3( ublas::prod( ab, ublas::trans( a ) ) );
+}
+
+} // anonymous namespace
+
+namespace Ubitrack { namespace Tracking {
+
+ImuPreintegration::ImuPreintegration( double gyroNoiseDensity, double accelNoiseDensity )
+	: m_gyroNoise2( gyroNoiseDensity * gyroNoiseDensity )
+	, m_accelNoise2( accelNoiseDensity * accelNoiseDensity )
+	, m_gyroBias( Vector3::zeros() )
+	, m_accelBias( Vector3::zeros() )
+{
+	reset();
+}
+
+
+void ImuPreintegration::setBias( const Math::Vector< double, 3 >& gyroBias, const Math::Vector< double, 3 >& accelBias )
+{
+	m_gyroBias = gyroBias;
+	m_accelBias = accelBias;
+}
+
+
+void ImuPreintegration::reset( Measurement::Timestamp t0 )
+{
+	reset();
+	m_bStarted = true;
+	m_startTime = t0;
+	m_endTime = t0;
+}
+
+
+void ImuPreintegration::reset()
+{
+	m_bStarted = false;
+	m_startTime = 0;
+	m_endTime = 0;
+	m_deltaTime = 0;
+	m_samples = 0;
+
+	m_deltaRotation = Math::Quaternion();
+	m_deltaRotationMatrix = Matrix3::identity();
+	m_deltaVelocity = Vector3::zeros();
+	m_deltaPosition = Vector3::zeros();
+	m_covariance = Math::Matrix< double, 9, 9 >::zeros();
+
+	m_dRdbg = Matrix3::zeros();
+	m_dVdbg = Matrix3::zeros();
+	m_dVdba = Matrix3::zeros();
+	m_dPdbg = Matrix3::zeros();
+	m_dPdba = Matrix3::zeros();
+}
+
+
+void ImuPreintegration::addSample( const Measurement::RotationVelocity& gyro )
+{
+	integrate( gyro.time(), *gyro, 0 );
+}
+
+
+void ImuPreintegration::addSample( const Measurement::RotationVelocity& gyro, const Math::Vector< double, 3 >& accel )
+{
+	integrate( gyro.time(), *gyro, &accel );
+}
+
+
+void ImuPreintegration::integrate( Measurement::Timestamp t, const Math::Vector< double, 3 >& gyro, const Math::Vector< double, 3 >* pAccel )
+{
+	if ( !m_bStarted )
+	{
+		// the first sample only starts the interval
+		m_bStarted = true;
+		m_startTime = t;
+		m_endTime = t;
+		return;
+	}
+
+	if ( t <= m_endTime )
+		return;
+
+	const double dt = ( t - m_endTime ) * 1e-9;
+	const Vector3 phi( ( gyro - m_gyroBias ) * dt );
+	const Math::Lie::SO3Terms< double > terms( phi );
+	const Math::Quaternion step( terms.quaternion() );
+	Matrix3 stepMatrix;
+	terms.matrix( stepMatrix );
+	const Matrix3 stepT( ublas::trans( stepMatrix ) );
+	Matrix3 jr;
+	terms.rightJacobian( jr );
+	const Matrix3 gyroNoise( ( m_gyroNoise2 * dt ) * ublas::prod( jr, ublas::trans( jr ) ) );
+
+	if ( !pAccel )
+	{
+		// rotation only: P_R = Exp( phi )^T P_R Exp( phi ) + Jr Qg Jr^T
+		Matrix3 pR( ublas::subrange( m_covariance, 0, 3, 0, 3 ) );
+		ublas::subrange( m_covariance, 0, 3, 0, 3 ) = sandwich( stepT, pR ) + gyroNoise;
+	}
+	else
+	{
+		const Vector3 a( *pAccel - m_accelBias );
+		const Matrix3& dR( m_deltaRotationMatrix );
+		const Matrix3 dRa( ublas::prod( dR, skew( a ) ) );
+		const double dt2 = 0.5 * dt * dt;
+
+		// bias jacobians, using the increments before this sample
+		const Matrix3 dRadRdbg( ublas::prod( dRa, m_dRdbg ) );
+		m_dPdba += dt * m_dVdba - dt2 * dR;
+		m_dPdbg += dt * m_dVdbg - dt2 * dRadRdbg;
+		m_dVdba -= dt * dR;
+		m_dVdbg -= dt * dRadRdbg;
+
+		// error propagation P = A P A^T + B Q B^T with
+		// A = [ Exp( phi )^T, 0, 0; -dR [ a ]x dt, I, 0; -1/2 dR [ a ]x dt^2, I dt, I ]
+		Math::Matrix< double, 9, 9 > A( Math::Matrix< double, 9, 9 >::identity() );
+		ublas::subrange( A, 0, 3, 0, 3 ) = stepT;
+		ublas::subrange( A, 3, 6, 0, 3 ) = -dt * dRa;
+		ublas::subrange( A, 6, 9, 0, 3 ) = -dt2 * dRa;
+		ublas::subrange( A, 6, 9, 3, 6 ) = dt * Matrix3::identity();
+		const Math::Matrix< double, 9, 9 > AP( ublas::prod( A, m_covariance ) );
+		m_covariance = ublas::prod( AP, ublas::trans( A ) );
+
+		// accelerometer noise enters through B_a = [ 0; dR dt; 1/2 dR dt^2 ], as dR is a rotation dR dR^T = I
+		const double qa = m_accelNoise2 * dt;
+		ublas::subrange( m_covariance, 0, 3, 0, 3 ) += gyroNoise;
+		ublas::subrange( m_covariance, 3, 6, 3, 6 ) += ( qa * dt * dt ) * Matrix3::identity();
+		ublas::subrange( m_covariance, 3, 6, 6, 9 ) += ( qa * dt * dt2 ) * Matrix3::identity();
+		ublas::subrange( m_covariance, 6, 9, 3, 6 ) += ( qa * dt * dt2 ) * Matrix3::identity();
+		ublas::subrange( m_covariance, 6, 9, 6, 9 ) += ( qa * dt2 * dt2 ) * Matrix3::identity();
+
+		// increments
+		const Vector3 dRaVec( ublas::prod( dR, a ) );
+		m_deltaPosition += dt * m_deltaVelocity + dt2 * dRaVec;
+		m_deltaVelocity += dt * dRaVec;
+	}
+
+	// rotation jacobian and increment
+	const Matrix3 rotated( ublas::prod( stepT, m_dRdbg ) );
+	m_dRdbg = rotated - dt * jr;
+
+	m_deltaRotation = m_deltaRotation * step;
+	m_deltaRotation.normalize();
+	m_deltaRotation.toMatrix( m_deltaRotationMatrix );
+
+	m_deltaTime += dt;
+	m_endTime = t;
+	m_samples++;
+}
+
+
+Math::Quaternion ImuPreintegration::correctedDeltaRotation( const Math::Vector< double, 3 >& gyroBias ) const
+{
+	const Vector3 correction( ublas::prod( m_dRdbg, Vector3( gyroBias - m_gyroBias ) ) );
+	return m_deltaRotation * Math::Quaternion::fromLogarithm( correction );
+}
+
+
+Math::ErrorVector< double, 3 > ImuPreintegration::meanRotationVelocity() const
+{
+	if ( m_deltaTime <= 0 )
+		UBITRACK_THROW( "No IMU samples integrated" );
+
+	const Vector3 phi( m_deltaRotation.toLogarithm() );
+	Matrix3 jrInv;
+	Math::Lie::SO3Terms< double >( phi ).inverseRightJacobian( jrInv );
+	const Matrix3 pR( ublas::subrange( m_covariance, 0, 3, 0, 3 ) );
+
+	Math::ErrorVector< double, 3 > v;
+	v.value = phi / m_deltaTime;
+	v.covariance = sandwich( jrInv, pR ) / ( m_deltaTime * m_deltaTime );
+	return v;
+}
+
+} } // namespace Ubitrack::Tracking
@@ -0,0 +1,195 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * Preintegration of inertial measurements between two optical updates
+ */
+
+#ifndef __UBITRACK_TRACKING_IMUPREINTEGRATION_H_INCLUDED__
+#define __UBITRACK_TRACKING_IMUPREINTEGRATION_H_INCLUDED__
+
+#include <utCore.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Quaternion.h>
+#include <utMath/ErrorVector.h>
+#include <utMeasurement/Measurement.h>
+
+namespace Ubitrack { namespace Tracking {
+
+/**
+ * Accumulates gyroscope and, optionally, accelerometer samples into a single relative motion
+ * increment, following Forster et al., "On-Manifold Preintegration for Real-Time Visual-Inertial
+ * Odometry". For samples with angular velocity \c w and acceleration \c a in body coordinates
+ * and a sampling interval \c dt the increments are
+ * <pre>
+ * dR <- dR Exp( ( w - bg ) dt )
+ * dv <- dv + dR ( a - ba ) dt
+ * dp <- dp + dv dt + 1/2 dR ( a - ba ) dt^2
+ * </pre>
+ * with the body rotation \c dR composed on the right, as in \c Math::RotationVelocity. Gravity
+ * is not removed, it is added when the increment is applied to a state.
+ *
+ * Together with the increments the 9x9 covariance of the rotation, velocity and position errors
+ * and the jacobians with respect to the biases \c bg and \c ba are propagated, so a bias estimate
+ * that changes after integration can be applied to first order. Each sample costs a constant
+ * amount of work and nothing is allocated.
+ *
+ * The samples of an interval must all be passed to the same overload of \c addSample. With
+ * gyroscope samples only, the velocity and position increments and their covariance stay zero.
+ *
+ * To feed a \c PoseKalmanFilter, whose state contains no copy of the previous pose for a relative
+ * update, the rotation increment is inserted as its mean angular velocity before the next optical
+ * pose:
+ * @code
+ * filter.addRotationVelocityMeasurement( imu.middleTime(), imu.meanRotationVelocity() );
+ * filter.addPoseMeasurement( pose );
+ * imu.reset( pose.time() );
+ * @endcode
+ * This replaces one filter update per gyroscope sample by one per optical update.
+ */
+class UBITRACK_EXPORT ImuPreintegration
+{
+public:
+	/**
+	 * Constructor.
+	 * @param gyroNoiseDensity white noise of the gyroscope in rad / ( s sqrt( Hz ) )
+	 * @param accelNoiseDensity white noise of the accelerometer in m / ( s^2 sqrt( Hz ) )
+	 */
+	explicit ImuPreintegration( double gyroNoiseDensity = 1e-3, double accelNoiseDensity = 1e-2 );
+
+	/** sets the biases that are subtracted from the following samples */
+	void setBias( const Math::Vector< double, 3 >& gyroBias, const Math::Vector< double, 3 >& accelBias );
+
+	/** starts a new interval at \c t0, the first sample is integrated from \c t0 */
+	void reset( Measurement::Timestamp t0 );
+
+	/** starts a new interval at the timestamp of the next sample */
+	void reset();
+
+	/**
+	 * Integrates a gyroscope sample over the time since the previous sample (or the start of the
+	 * interval). Samples that are not newer than the previous one are ignored.
+	 */
+	void addSample( const Measurement::RotationVelocity& gyro );
+
+	/** integrates a gyroscope sample and an accelerometer sample taken at the same time */
+	void addSample( const Measurement::RotationVelocity& gyro, const Math::Vector< double, 3 >& accel );
+
+	/** start of the interval */
+	Measurement::Timestamp startTime() const
+	{ return m_startTime; }
+
+	/** timestamp of the last integrated sample */
+	Measurement::Timestamp endTime() const
+	{ return m_endTime; }
+
+	/** the middle of the interval, where the mean angular velocity is measured best */
+	Measurement::Timestamp middleTime() const
+	{ return m_startTime + ( m_endTime - m_startTime ) / 2; }
+
+	/** length of the interval in seconds */
+	double deltaTime() const
+	{ return m_deltaTime; }
+
+	/** number of integrated samples */
+	std::size_t sampleCount() const
+	{ return m_samples; }
+
+	/** rotation from the body at the end to the body at the start of the interval */
+	const Math::Quaternion& deltaRotation() const
+	{ return m_deltaRotation; }
+
+	/** velocity increment in body coordinates at the start, without gravity */
+	const Math::Vector< double, 3 >& deltaVelocity() const
+	{ return m_deltaVelocity; }
+
+	/** position increment in body coordinates at the start, without gravity */
+	const Math::Vector< double, 3 >& deltaPosition() const
+	{ return m_deltaPosition; }
+
+	/** covariance of the rotation (right-perturbed), velocity and position errors */
+	const Math::Matrix< double, 9, 9 >& covariance() const
+	{ return m_covariance; }
+
+	/** @name jacobians of the increments with respect to the biases */
+	/** @{ */
+	const Math::Matrix< double, 3, 3 >& rotationGyroBiasJacobian() const
+	{ return m_dRdbg; }
+
+	const Math::Matrix< double, 3, 3 >& velocityGyroBiasJacobian() const
+	{ return m_dVdbg; }
+
+	const Math::Matrix< double, 3, 3 >& velocityAccelBiasJacobian() const
+	{ return m_dVdba; }
+
+	const Math::Matrix< double, 3, 3 >& positionGyroBiasJacobian() const
+	{ return m_dPdbg; }
+
+	const Math::Matrix< double, 3, 3 >& positionAccelBiasJacobian() const
+	{ return m_dPdba; }
+	/** @} */
+
+	/** the rotation increment corrected to first order for a new gyroscope bias */
+	Math::Quaternion correctedDeltaRotation( const Math::Vector< double, 3 >& gyroBias ) const;
+
+	/**
+	 * The mean angular velocity over the interval, <tt>Log( dR ) / dt</tt>, with its covariance.
+	 * @throws Util::Exception if nothing was integrated yet
+	 */
+	Math::ErrorVector< double, 3 > meanRotationVelocity() const;
+
+protected:
+	/// @internal integrates one sample
+	void integrate( Measurement::Timestamp t, const Math::Vector< double, 3 >& gyro, const Math::Vector< double, 3 >* pAccel );
+
+	double m_gyroNoise2;
+	double m_accelNoise2;
+	Math::Vector< double, 3 > m_gyroBias;
+	Math::Vector< double, 3 > m_accelBias;
+
+	bool m_bStarted;
+	Measurement::Timestamp m_startTime;
+	Measurement::Timestamp m_endTime;
+	double m_deltaTime;
+	std::size_t m_samples;
+
+	Math::Quaternion m_deltaRotation;
+	Math::Matrix< double, 3, 3 > m_deltaRotationMatrix;
+	Math::Vector< double, 3 > m_deltaVelocity;
+	Math::Vector< double, 3 > m_deltaPosition;
+	Math::Matrix< double, 9, 9 > m_covariance;
+
+	Math::Matrix< double, 3, 3 > m_dRdbg;
+	Math::Matrix< double, 3, 3 > m_dVdbg;
+	Math::Matrix< double, 3, 3 > m_dVdba;
+	Math::Matrix< double, 3, 3 > m_dPdbg;
+	Math::Matrix< double, 3, 3 > m_dPdba;
+};
+
+} } // namespace Ubitrack::Tracking
+
+#endif
@@ -0,0 +1,401 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * implementation of the bank of pose kalman filters
+ */
+
+#include "PoseFilterBank.h"
+#ifdef HAVE_LAPACK
+
+#include <algorithm>
+#include <cmath>
+#include <boost/bind.hpp>
+#include <utUtil/Exception.h>
+#include "Function/QuaternionTimeUpdate.h"
+
+namespace {
+
+/**
+ * Applies the linear chain <tt>x_k += sum_j dt^j / j! x_( k + j )</tt>, k = 0..order, to the 3-vectors
+ * starting at element \c first of a lane block. Element \c e of all lanes is at <tt>data + e * step</tt>.
+ * Ascending k only reads elements that are not updated yet, so this works in place.
+ */
+template< std::size_t L >
+inline void taylorChain( double* data, const std::size_t first, const std::size_t step, const int order, const double taylor[][ L ] )
+{
+	for ( int k = 0; k < order; k++ )
+		for ( std::size_t c = 0; c < 3; c++ )
+		{
+			double* xr = data + ( first + 3 * k + c ) * step;
+			for ( int j = 1; k + j <= order; j++ )
+			{
+				const double* xs = data + ( first + 3 * ( k + j ) + c ) * step;
+				for ( std::size_t l = 0; l < L; l++ )
+					xr[ l ] += taylor[ j ][ l ] * xs[ l ];
+			}
+		}
+}
+
+/** orders measurement indices by target, measurements of the same target keep their order */
+template< class M >
+struct TargetLess
+{
+	const std::vector< std::pair< std::size_t, M > >& measurements;
+
+	TargetLess( const std::vector< std::pair< std::size_t, M > >& m )
+		: measurements( m )
+	{}
+
+	bool operator()( const std::size_t a, const std::size_t b ) const
+	{ return measurements[ a ].first < measurements[ b ].first; }
+};
+
+}
+
+namespace ublas = boost::numeric::ublas;
+
+namespace Ubitrack { namespace Tracking {
+
+template< int PosOrder, int OriOrder >
+PoseFilterBank< PosOrder, OriOrder >::PoseFilterBank( const LinearPoseMotionModel& motionModel )
+	: m_motionModel( motionModel )
+	, m_stride( 0 )
+{
+	if ( m_motionModel.posOrder() != PosOrder || m_motionModel.oriOrder() != OriOrder )
+		UBITRACK_THROW( "PoseFilterBank: orders of the motion model do not match the bank" );
+
+	// the process noise is only accessible through addNoise
+	typename FilterType::CovarianceType noise( FilterType::CovarianceType::zeros() );
+	m_motionModel.addNoise( noise, 1.0 );
+	for ( std::size_t i = 0; i < stateSize; i++ )
+		m_processNoise[ i ] = noise( i, i );
+}
+
+
+template< int PosOrder, int OriOrder >
+std::size_t PoseFilterBank< PosOrder, OriOrder >::addTarget()
+{
+	const std::size_t target = m_times.size();
+	if ( target == m_stride )
+		relayout( std::max< std::size_t >( laneBlock, 2 * m_stride ), Math::ListExecutor() );
+
+	m_times.push_back( 0 );
+	setFilter( target, FilterType( m_motionModel ) );
+	return target;
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::reserve( std::size_t targets, const Math::ListExecutor& executor )
+{
+	targets = std::max( targets, size() );
+	relayout( std::max< std::size_t >( 1, ( targets + laneBlock - 1 ) / laneBlock ) * laneBlock, executor );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::relayout( const std::size_t stride, const Math::ListExecutor& executor )
+{
+	// new[] leaves the doubles untouched, the pages are placed by the thread that first writes them
+	boost::scoped_array< double > states( new double[ stateSize * stride ] );
+	boost::scoped_array< double > covariances( new double[ stateSize * stateSize * stride ] );
+	const std::size_t nBlocks = stride / laneBlock;
+	if ( executor.empty() )
+		relayoutRange( states.get(), covariances.get(), stride, 0, nBlocks );
+	else
+		executor( nBlocks, boost::bind( &PoseFilterBank::relayoutRange, this, states.get(), covariances.get(), stride, _1, _2 ) );
+	m_states.swap( states );
+	m_covariances.swap( covariances );
+	m_stride = stride;
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::relayoutRange( double* states, double* covariances, const std::size_t stride,
+	const std::size_t begin, const std::size_t end ) const
+{
+	const std::size_t l0 = begin * laneBlock;
+	const std::size_t l1 = end * laneBlock;
+	const std::size_t copied = std::max( l0, std::min( l1, size() ) );
+	for ( std::size_t i = 0; i < stateSize; i++ )
+	{
+		std::copy( m_states.get() + i * m_stride + l0, m_states.get() + i * m_stride + copied, states + i * stride + l0 );
+		std::fill( states + i * stride + copied, states + i * stride + l1, 0.0 );
+	}
+	for ( std::size_t i = 0; i < stateSize * stateSize; i++ )
+	{
+		std::copy( m_covariances.get() + i * m_stride + l0, m_covariances.get() + i * m_stride + copied, covariances + i * stride + l0 );
+		std::fill( covariances + i * stride + copied, covariances + i * stride + l1, 0.0 );
+	}
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::getFilter( std::size_t target, FilterType& filter ) const
+{
+	assert( target < size() );
+	typename FilterType::StateType state;
+	typename FilterType::CovarianceType covariance;
+	for ( std::size_t i = 0; i < stateSize; i++ )
+		state( i ) = m_states[ i * m_stride + target ];
+	for ( std::size_t r = 0; r < stateSize; r++ )
+		for ( std::size_t c = 0; c < stateSize; c++ )
+			covariance( r, c ) = m_covariances[ ( r * stateSize + c ) * m_stride + target ];
+	filter.setState( state, covariance, m_times[ target ] );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::setFilter( std::size_t target, const FilterType& filter )
+{
+	assert( target < size() );
+	for ( std::size_t i = 0; i < stateSize; i++ )
+		m_states[ i * m_stride + target ] = filter.state()( i );
+	for ( std::size_t r = 0; r < stateSize; r++ )
+		for ( std::size_t c = 0; c < stateSize; c++ )
+			m_covariances[ ( r * stateSize + c ) * m_stride + target ] = filter.covariance()( r, c );
+	m_times[ target ] = filter.time();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::timeUpdate( Measurement::Timestamp t, const Math::ListExecutor& executor )
+{
+	// distribute whole lane blocks, so no two threads write the same block
+	const std::size_t nBlocks = ( m_times.size() + laneBlock - 1 ) / laneBlock;
+	if ( nBlocks == 0 )
+		return;
+	if ( executor.empty() )
+		timeUpdateRange( t, 0, nBlocks );
+	else
+		executor( nBlocks, boost::bind( &PoseFilterBank::timeUpdateRange, this, t, _1, _2 ) );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::timeUpdateRange( Measurement::Timestamp t, std::size_t begin, std::size_t end )
+{
+	const std::size_t n = stateSize;
+	const std::size_t iR = 3 * ( PosOrder + 1 ); // first index of orientation
+	const std::size_t nOri = 4 + 3 * OriOrder;
+	const std::size_t s = m_stride;
+	double* x = m_states.get();
+	double* p = m_covariances.get();
+
+	for ( std::size_t b = begin * laneBlock; b < end * laneBlock; b += laneBlock )
+	{
+		// time differences, targets without measurement, already at t or beyond the last target are not changed
+		double dt[ laneBlock ];
+		bool bAny = false;
+		for ( std::size_t l = 0; l < laneBlock; l++ )
+		{
+			const Measurement::Timestamp time = b + l < m_times.size() ? m_times[ b + l ] : 0;
+			dt[ l ] = ( time == 0 || time == t ) ? 0.0 : ( (long long int)( t - time ) ) * 1e-9;
+			bAny = bAny || dt[ l ] != 0;
+		}
+		if ( !bAny )
+			continue;
+
+		// taylor coefficients dt^j / j! of the position and rotation velocity chains
+		double taylor[ maxChainOrder + 1 ][ laneBlock ];
+		for ( std::size_t l = 0; l < laneBlock; l++ )
+			taylor[ 0 ][ l ] = 1;
+		for ( int j = 1; j <= maxChainOrder; j++ )
+			for ( std::size_t l = 0; l < laneBlock; l++ )
+				taylor[ j ][ l ] = taylor[ j - 1 ][ l ] * dt[ l ] / j;
+
+		// the quaternion rows are the only nonlinear part, their jacobian is computed per target
+		double jQuat[ 4 ][ 4 + 3 * OriOrder ][ laneBlock ];
+		for ( std::size_t l = 0; l < laneBlock; l++ )
+		{
+			Math::Matrix< double, 4, 4 + 3 * OriOrder > jacobian( Math::Matrix< double, 4, 4 + 3 * OriOrder >::zeros() );
+			if ( dt[ l ] == 0 )
+				ublas::subrange( jacobian, 0, 4, 0, 4 ) = Math::Matrix< double, 4, 4 >::identity();
+			else
+			{
+				Math::Vector< double, 4 + 3 * OriOrder > ori;
+				Math::Vector< double, 4 > quat;
+				for ( std::size_t i = 0; i < nOri; i++ )
+					ori( i ) = x[ ( iR + i ) * s + b + l ];
+				Function::QuaternionTimeUpdate( dt[ l ], OriOrder ).evaluateWithJacobian( quat, ori, jacobian );
+				for ( std::size_t i = 0; i < 4; i++ )
+					x[ ( iR + i ) * s + b + l ] = quat( i );
+			}
+			for ( std::size_t i = 0; i < 4; i++ )
+				for ( std::size_t j = 0; j < nOri; j++ )
+					jQuat[ i ][ j ][ l ] = jacobian( i, j );
+		}
+
+		// linear part of the state
+		taylorChain( x + b, 0, s, PosOrder, taylor );
+		taylorChain( x + b, iR + 4, s, OriOrder - 1, taylor );
+
+		// covariance rows, P = F P
+		for ( std::size_t col = 0; col < n; col++ )
+			transformLanes( p + col * s + b, n * s, iR, jQuat, taylor );
+
+		// covariance columns, P = P F^T
+		for ( std::size_t row = 0; row < n; row++ )
+			transformLanes( p + row * n * s + b, s, iR, jQuat, taylor );
+
+		// process noise
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			double* pd = p + ( i * n + i ) * s + b;
+			for ( std::size_t l = 0; l < laneBlock; l++ )
+				pd[ l ] += std::fabs( dt[ l ] ) * m_processNoise[ i ];
+		}
+
+		for ( std::size_t l = 0; l < laneBlock; l++ )
+			if ( dt[ l ] != 0 )
+				m_times[ b + l ] = t;
+	}
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::transformLanes( double* data, const std::size_t step, const std::size_t iR,
+	const double jQuat[][ 4 + 3 * OriOrder ][ laneBlock ], const double taylor[][ laneBlock ] )
+{
+	// the quaternion from the old orientation elements
+	double quat[ 4 ][ laneBlock ];
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		for ( std::size_t l = 0; l < laneBlock; l++ )
+			quat[ i ][ l ] = 0;
+		for ( std::size_t j = 0; j < 4 + 3 * OriOrder; j++ )
+		{
+			const double* e = data + ( iR + j ) * step;
+			for ( std::size_t l = 0; l < laneBlock; l++ )
+				quat[ i ][ l ] += jQuat[ i ][ j ][ l ] * e[ l ];
+		}
+	}
+
+	// the linear chains
+	taylorChain( data, 0, step, PosOrder, taylor );
+	taylorChain( data, iR + 4, step, OriOrder - 1, taylor );
+
+	for ( std::size_t i = 0; i < 4; i++ )
+		std::copy( quat[ i ], quat[ i ] + laneBlock, data + ( iR + i ) * step );
+}
+
+
+template< int PosOrder, int OriOrder >
+template< class M >
+void PoseFilterBank< PosOrder, OriOrder >::measurementRange( const std::vector< std::pair< std::size_t, M > >& measurements,
+	void ( FilterType::*update )( const M& ), std::size_t begin, std::size_t end )
+{
+	FilterType filter( m_motionModel );
+	for ( std::size_t g = begin; g < end; g++ )
+	{
+		const std::size_t target = measurements[ m_order[ m_groups[ g ] ] ].first;
+		getFilter( target, filter );
+		for ( std::size_t i = m_groups[ g ]; i < m_groups[ g + 1 ]; i++ )
+			( filter.*update )( measurements[ m_order[ i ] ].second );
+		setFilter( target, filter );
+	}
+}
+
+
+template< int PosOrder, int OriOrder >
+template< class M >
+void PoseFilterBank< PosOrder, OriOrder >::addMeasurements( const std::vector< std::pair< std::size_t, M > >& measurements,
+	void ( FilterType::*update )( const M& ), const Math::ListExecutor& executor )
+{
+	if ( measurements.empty() )
+		return;
+
+	// group the measurements by target
+	m_order.resize( measurements.size() );
+	for ( std::size_t i = 0; i < measurements.size(); i++ )
+	{
+		if ( measurements[ i ].first >= size() )
+			UBITRACK_THROW( "PoseFilterBank: measurement for unknown target" );
+		m_order[ i ] = i;
+	}
+	std::stable_sort( m_order.begin(), m_order.end(), TargetLess< M >( measurements ) );
+	m_groups.clear();
+	for ( std::size_t i = 0; i < m_order.size(); i++ )
+		if ( i == 0 || measurements[ m_order[ i ] ].first != measurements[ m_order[ i - 1 ] ].first )
+			m_groups.push_back( i );
+	const std::size_t nGroups = m_groups.size();
+	m_groups.push_back( m_order.size() );
+
+	if ( executor.empty() )
+		measurementRange( measurements, update, 0, nGroups );
+	else
+		executor( nGroups, boost::bind( &PoseFilterBank::template measurementRange< M >, this, boost::cref( measurements ), update, _1, _2 ) );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::addPoseMeasurements( const std::vector< std::pair< std::size_t, Measurement::ErrorPose > >& measurements,
+	const Math::ListExecutor& executor )
+{
+	addMeasurements( measurements, &FilterType::addPoseMeasurement, executor );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::addRotationMeasurements( const std::vector< std::pair< std::size_t, Measurement::Rotation > >& measurements,
+	const Math::ListExecutor& executor )
+{
+	addMeasurements( measurements, &FilterType::addRotationMeasurement, executor );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseFilterBank< PosOrder, OriOrder >::addRotationVelocityMeasurements( const std::vector< std::pair< std::size_t, Measurement::RotationVelocity > >& measurements,
+	const Math::ListExecutor& executor )
+{
+	addMeasurements( measurements, &FilterType::addRotationVelocityMeasurement, executor );
+}
+
+
+template< int PosOrder, int OriOrder >
+Measurement::ErrorPose PoseFilterBank< PosOrder, OriOrder >::predictPose( std::size_t target, Measurement::Timestamp t ) const
+{
+	FilterType filter( m_motionModel );
+	getFilter( target, filter );
+	return filter.predictPose( t );
+}
+
+
+// the common motion model orders
+template class PoseFilterBank< 0, 0 >;
+template class PoseFilterBank< 0, 1 >;
+template class PoseFilterBank< 0, 2 >;
+template class PoseFilterBank< 1, 0 >;
+template class PoseFilterBank< 1, 1 >;
+template class PoseFilterBank< 1, 2 >;
+template class PoseFilterBank< 2, 0 >;
+template class PoseFilterBank< 2, 1 >;
+template class PoseFilterBank< 2, 2 >;
+
+} } // namespace Ubitrack::Tracking
+
+#endif // HAVE_LAPACK
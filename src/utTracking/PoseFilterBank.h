@@ -0,0 +1,189 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * Kalman filtering of the poses of many targets with the same motion model
+ */
+
+#ifndef __UBITRACK_TRACKING_POSEFILTERBANK_H_INCLUDED__
+#define __UBITRACK_TRACKING_POSEFILTERBANK_H_INCLUDED__
+
+
+#ifdef HAVE_LAPACK
+
+#include <vector>
+#include <utility>
+
+#include <boost/scoped_array.hpp>
+
+#include <utCore.h>
+#include <utMath/PoseListOperations.h>
+#include "PoseKalmanFilterT.h"
+
+namespace Ubitrack { namespace Tracking {
+
+/**
+ * A bank of pose kalman filters with the same motion model, one per tracked target. Each target
+ * behaves like a \c PoseKalmanFilterT without inside-out mode.
+ *
+ * States and covariances of all targets are stored as structure of arrays, with one lane per target:
+ * element \c i of all states is one contiguous array, as is element <tt>( r, c )</tt> of all covariances.
+ * - \c timeUpdate forwards all targets to a common timestamp in loops over blocks of lanes. The
+ *   position and rotation velocity chains have the same linear transition for all targets, only the
+ *   jacobian of the quaternion rows is computed per target.
+ * - the \c addXxxMeasurements methods apply lists of measurements of several targets. The targets
+ *   are distributed over a \c Math::ListExecutor, the measurements of one target are applied in the
+ *   order of the list.
+ *
+ * On NUMA machines, \c reserve the final number of targets with the executor of the updates, e.g.
+ * \c Math::nodeExecutor, so the lanes of each lane block are allocated on the node that forwards them
+ * in \c timeUpdate.
+ *
+ * Like \c PoseKalmanFilterT, the bank is instantiated for orders between 0 and 2.
+ */
+template< int PosOrder, int OriOrder >
+class UBITRACK_EXPORT PoseFilterBank
+{
+public:
+	/** type of the filter of one target */
+	typedef PoseKalmanFilterT< PosOrder, OriOrder > FilterType;
+
+	/** size of the state vector of one target */
+	static const std::size_t stateSize = FilterType::stateSize;
+
+	/**
+	 * Constructor.
+	 * @param motionModel Motion model of all targets. Its orders must match the template parameters.
+	 */
+	PoseFilterBank( const LinearPoseMotionModel& motionModel );
+
+	/** adds a target in the initial state of a new filter and returns its index */
+	std::size_t addTarget();
+
+	/**
+	 * allocates the lanes of \c targets targets. The lane blocks are initialized, and thereby placed
+	 * in memory, by the executor, in the same ranges as \c timeUpdate distributes them once the bank
+	 * has \c targets targets.
+	 * @param targets number of targets, at least the current number
+	 * @param executor distributes the lane blocks, the default runs them in the calling thread
+	 */
+	void reserve( std::size_t targets, const Math::ListExecutor& executor = Math::ListExecutor() );
+
+	/** returns the number of targets */
+	std::size_t size() const
+	{ return m_times.size(); }
+
+	/**
+	 * Forwards all targets that have received a measurement to time \c t.
+	 * @param t the common timestamp
+	 * @param executor distributes the targets, the default runs them in the calling thread
+	 */
+	void timeUpdate( Measurement::Timestamp t, const Math::ListExecutor& executor = Math::ListExecutor() );
+
+	/** integrates a list of (target, measurement) pairs, see \c PoseKalmanFilter::addPoseMeasurement */
+	void addPoseMeasurements( const std::vector< std::pair< std::size_t, Measurement::ErrorPose > >& measurements,
+		const Math::ListExecutor& executor = Math::ListExecutor() );
+
+	/** integrates a list of (target, measurement) pairs, see \c PoseKalmanFilter::addRotationMeasurement */
+	void addRotationMeasurements( const std::vector< std::pair< std::size_t, Measurement::Rotation > >& measurements,
+		const Math::ListExecutor& executor = Math::ListExecutor() );
+
+	/** integrates a list of (target, measurement) pairs, see \c PoseKalmanFilter::addRotationVelocityMeasurement */
+	void addRotationVelocityMeasurements( const std::vector< std::pair< std::size_t, Measurement::RotationVelocity > >& measurements,
+		const Math::ListExecutor& executor = Math::ListExecutor() );
+
+	/** computes the pose of a target for a given time, see \c PoseKalmanFilter::predictPose */
+	Measurement::ErrorPose predictPose( std::size_t target, Measurement::Timestamp t ) const;
+
+	/** copies state, covariance and timestamp of a target into a filter */
+	void getFilter( std::size_t target, FilterType& filter ) const;
+
+	/** sets state, covariance and timestamp of a target from a filter */
+	void setFilter( std::size_t target, const FilterType& filter );
+
+protected:
+	/** number of targets that are processed together in the time update */
+	static const std::size_t laneBlock = 16;
+
+	/** longest of the linear position and rotation velocity chains */
+	static const int maxChainOrder = PosOrder > OriOrder ? PosOrder : OriOrder;
+
+	/** moves the lanes to new arrays with the given stride, a multiple of \c laneBlock */
+	void relayout( std::size_t stride, const Math::ListExecutor& executor );
+
+	/** copies the lane blocks [ begin, end ) to the new arrays, the lanes without target are zeroed */
+	void relayoutRange( double* states, double* covariances, std::size_t stride, std::size_t begin, std::size_t end ) const;
+
+	/** forwards the lane blocks [ begin, end ) to time t */
+	void timeUpdateRange( Measurement::Timestamp t, std::size_t begin, std::size_t end );
+
+	/**
+	 * applies the time update jacobian to one row or column of the covariances of a lane block,
+	 * element \c e of all lanes is at <tt>data + e * step</tt>
+	 */
+	static void transformLanes( double* data, std::size_t step, std::size_t iR,
+		const double jQuat[][ 4 + 3 * OriOrder ][ laneBlock ], const double taylor[][ laneBlock ] );
+
+	/** applies the measurements of the target groups [ begin, end ) */
+	template< class M >
+	void measurementRange( const std::vector< std::pair< std::size_t, M > >& measurements, void ( FilterType::*update )( const M& ),
+		std::size_t begin, std::size_t end );
+
+	/** groups the measurements by target and applies them */
+	template< class M >
+	void addMeasurements( const std::vector< std::pair< std::size_t, M > >& measurements, void ( FilterType::*update )( const M& ),
+		const Math::ListExecutor& executor );
+
+	/** the motion model */
+	LinearPoseMotionModel m_motionModel;
+
+	/** diagonal of the process noise per second */
+	double m_processNoise[ stateSize ];
+
+	/** number of lanes allocated in each array */
+	std::size_t m_stride;
+
+	/** the states, element i of target k at <tt>i * m_stride + k</tt>, allocated without initialization */
+	boost::scoped_array< double > m_states;
+
+	/** the covariances, element ( r, c ) of target k at <tt>( r * stateSize + c ) * m_stride + k</tt> */
+	boost::scoped_array< double > m_covariances;
+
+	/** timestamps of the states */
+	std::vector< Measurement::Timestamp > m_times;
+
+	/** measurement indices sorted by target, reused between calls */
+	std::vector< std::size_t > m_order;
+
+	/** start of each target group in \c m_order, reused between calls */
+	std::vector< std::size_t > m_groups;
+};
+
+} } // namespace Ubitrack::Tracking
+
+#endif // HAVE_LAPACK
+
+#endif
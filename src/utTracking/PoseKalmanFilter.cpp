@@ -36,13 +36,15 @@
 #include <utMath/Stochastic/CovarianceTransform.h>
 #include <utMath/Optimization/Function/VectorNormalize.h>
 #include <utUtil/Exception.h>
+#include <utUtil/TracingProvider.h>
+#include <utUtil/TraceSpan.h>
 #include "Function/PoseTimeUpdate.h"
 #include "Function/InsideOutPoseTimeUpdate.h"
 #include "Function/InvertRotationVelocity.h"
 
 // get a logger
-#include <log4cpp/Category.hh>
-static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Tracking.PoseKalmanFilter" ) );
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Tracking.PoseKalmanFilter" );
 
 #define KALMAN_LOGGING
 #include <utMath/Stochastic/Kalman.h>
@@ -72,6 +74,31 @@ struct PoseMeasurement
 	}
 };
 
+template< int PosOrder >
+Ubitrack::Tracking::PoseKalmanFilterBase* createFixedFilter( const Ubitrack::Tracking::LinearPoseMotionModel& motionModel, bool bInsideOut )
+{
+	using Ubitrack::Tracking::PoseKalmanFilterT;
+	switch ( motionModel.oriOrder() )
+	{
+	case 0: return new PoseKalmanFilterT< PosOrder, 0 >( motionModel, bInsideOut );
+	case 1: return new PoseKalmanFilterT< PosOrder, 1 >( motionModel, bInsideOut );
+	case 2: return new PoseKalmanFilterT< PosOrder, 2 >( motionModel, bInsideOut );
+	default: return 0;
+	}
+}
+
+/** returns a fixed-size filter for the orders of the motion model, or 0 if there is none */
+Ubitrack::Tracking::PoseKalmanFilterBase* createFixedFilter( const Ubitrack::Tracking::LinearPoseMotionModel& motionModel, bool bInsideOut )
+{
+	switch ( motionModel.posOrder() )
+	{
+	case 0: return createFixedFilter< 0 >( motionModel, bInsideOut );
+	case 1: return createFixedFilter< 1 >( motionModel, bInsideOut );
+	case 2: return createFixedFilter< 2 >( motionModel, bInsideOut );
+	default: return 0;
+	}
+}
+
 }
 
 namespace Ubitrack { namespace Tracking {
@@ -89,11 +116,70 @@ PoseKalmanFilter::PoseKalmanFilter( const LinearPoseMotionModel& motionModel, bo
 	// initialize state (apart from the zeroing above)
 	if ( m_motionModel.oriOrder() >= 0 )
 		m_state( 6 + 3 * m_motionModel.posOrder() ) = 1;
+
+	m_pFixed.reset( createFixedFilter( m_motionModel, m_bInsideOut ) );
+}
+
+
+PoseKalmanFilter::PoseKalmanFilter( const PoseKalmanFilter& other )
+	: m_motionModel( other.m_motionModel )
+	, m_bInsideOut( other.m_bInsideOut )
+	, m_state( other.m_state )
+	, m_covariance( other.m_covariance )
+	, m_time( other.m_time )
+	, m_gates( other.m_gates )
+	, m_pFixed( other.m_pFixed ? other.m_pFixed->clone() : 0 )
+{
+}
+
+
+PoseKalmanFilter& PoseKalmanFilter::operator=( const PoseKalmanFilter& other )
+{
+	if ( this != &other )
+	{
+		m_motionModel = other.m_motionModel;
+		m_bInsideOut = other.m_bInsideOut;
+		m_state = other.m_state;
+		m_covariance = other.m_covariance;
+		m_time = other.m_time;
+		m_gates = other.m_gates;
+		m_pFixed.reset( other.m_pFixed ? other.m_pFixed->clone() : 0 );
+	}
+	return *this;
+}
+
+
+PoseKalmanFilter::StateType PoseKalmanFilter::getState() const
+{
+	if ( !m_pFixed )
+		return m_state;
+
+	StateType state;
+	m_pFixed->getState( state );
+	return state;
+}
+
+
+PoseKalmanFilter::CovarianceType PoseKalmanFilter::getCovariance() const
+{
+	if ( !m_pFixed )
+		return m_covariance;
+
+	CovarianceType covariance;
+	m_pFixed->getCovariance( covariance );
+	return covariance;
 }
 
 
 void PoseKalmanFilter::addPoseMeasurement( const Measurement::ErrorPose& m )
 {
+	UBITRACK_TRACE_SPAN( "kalman_update_pose", 7 );
+	if ( m_pFixed )
+	{
+		m_pFixed->addPoseMeasurement( m );
+		return;
+	}
+
 	assert( m_motionModel.posOrder() >= 0 && m_motionModel.oriOrder() >= 0 );
 	int iR = 3 * ( m_motionModel.posOrder() + 1 ); // shortcut for first index of orientation
 	ublas::vector_range< StateType > rotSubState( m_state, ublas::range( iR, iR + 4 ) );
@@ -120,7 +206,9 @@ void PoseKalmanFilter::addPoseMeasurement( const Measurement::ErrorPose& m )
 		ublas::subrange( v.value, 3, 7 ) *= -1;
 	
 	// measurement update:
-	Math::Stochastic::kalmanMeasurementUpdate( m_state, m_covariance, PoseMeasurement( iR ), v.value, v.covariance, 0, iR + 4 );
+	TRACEPOINT_TRACKING_KALMAN_UPDATE( m.time(), "pose", 7 );
+	if ( !Math::Stochastic::kalmanMeasurementUpdate( m_state, m_covariance, PoseMeasurement( iR ), v.value, v.covariance, 0, iR + 4, m_gates.gate( 7 ) ) )
+		rejectMeasurement( 7 );
 
 	// normalize quaternion
 	normalize();
@@ -129,6 +217,13 @@ void PoseKalmanFilter::addPoseMeasurement( const Measurement::ErrorPose& m )
 
 void PoseKalmanFilter::addRotationMeasurement( const Measurement::Rotation& m )
 {
+	UBITRACK_TRACE_SPAN( "kalman_update_rotation", 4 );
+	if ( m_pFixed )
+	{
+		m_pFixed->addRotationMeasurement( m );
+		return;
+	}
+
 	assert( m_motionModel.oriOrder() >= 0 );
 	int iR = 3 + 3 * m_motionModel.posOrder(); // shortcut for first index of orientation
 	ublas::vector_range< StateType > rotSubState( m_state, ublas::range( iR, iR + 4 ) );
@@ -150,7 +245,9 @@ void PoseKalmanFilter::addRotationMeasurement( const Measurement::Rotation& m )
 		v.value *= -1;
 	
 	// measurement update:
-	Math::Stochastic::kalmanMeasurementUpdateIdentity( m_state, m_covariance, v.value, v.covariance, iR, iR + 4 );
+	TRACEPOINT_TRACKING_KALMAN_UPDATE( m.time(), "rotation", 4 );
+	if ( !Math::Stochastic::kalmanMeasurementUpdateIdentity( m_state, m_covariance, v.value, v.covariance, iR, iR + 4, m_gates.gate( 4 ) ) )
+		rejectMeasurement( 4 );
 
 	// normalize quaternion
 	normalize();
@@ -159,54 +256,126 @@ void PoseKalmanFilter::addRotationMeasurement( const Measurement::Rotation& m )
 
 void PoseKalmanFilter::addRotationVelocityMeasurement( const Measurement::RotationVelocity& m )
 {
+	addRotationVelocityMeasurement( m.time(),
+		Math::ErrorVector< double, 3 >( *m, Math::Matrix< double, 3, 3 >::identity() * 1e-11 ) ); // magic number, tune here
+}
+
+
+void PoseKalmanFilter::addInverseRotationVelocityMeasurement( const Measurement::RotationVelocity& m )
+{
+	addInverseRotationVelocityMeasurement( m.time(),
+		Math::ErrorVector< double, 3 >( *m, Math::Matrix< double, 3, 3 >::identity() * 1e-11 ) ); // magic number, tune here
+}
+
+
+void PoseKalmanFilter::addRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity )
+{
+	UBITRACK_TRACE_SPAN( "kalman_update_rotation_velocity", 3 );
+	if ( m_pFixed )
+	{
+		m_pFixed->addRotationVelocityMeasurement( t, velocity );
+		return;
+	}
+
 	assert( m_motionModel.oriOrder() >= 1 );
 	
 	if ( m_time == 0 )
 		return;
 	
 	// time update: forward filter to requested timestamp
-	timeUpdate( m.time() );
-	
-	// create measurement as ErrorVector
-	Math::ErrorVector< double, 3 > v;
-	v.value = *m;
-	v.covariance = Math::Matrix< double, 3, 3 >::identity() * 1e-11; // magic number, tune here
+	timeUpdate( t );
 	
 	// measurement update:
 	int iV = 4 + 3 * ( m_motionModel.posOrder() + 1 ); // shortcut for first index of rotation velocity
-	Math::Stochastic::kalmanMeasurementUpdateIdentity( m_state, m_covariance, v.value, v.covariance, iV, iV + 3 );
+	TRACEPOINT_TRACKING_KALMAN_UPDATE( t, "rotation_velocity", 3 );
+	if ( !Math::Stochastic::kalmanMeasurementUpdateIdentity( m_state, m_covariance, velocity.value, velocity.covariance, iV, iV + 3, m_gates.gate( 3 ) ) )
+		rejectMeasurement( 3 );
 
 	// normalize quaternion
 	normalize();
 }
 
 
-void PoseKalmanFilter::addInverseRotationVelocityMeasurement( const Measurement::RotationVelocity& m )
+void PoseKalmanFilter::addInverseRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity )
 {
+	UBITRACK_TRACE_SPAN( "kalman_update_inverse_rotation_velocity", 3 );
+	if ( m_pFixed )
+	{
+		m_pFixed->addInverseRotationVelocityMeasurement( t, velocity );
+		return;
+	}
+
 	assert( m_motionModel.oriOrder() >= 1 );
 	
 	if ( m_time == 0 )
 		return;
 	
 	// time update: forward filter to requested timestamp
-	timeUpdate( m.time() );
-	
-	// create measurement as ErrorVector
-	Math::ErrorVector< double, 3 > v;
-	v.value = *m;
-	v.covariance = Math::Matrix< double, 3, 3 >::identity() * 1e-11; // magic number, tune here
+	timeUpdate( t );
 	
 	// measurement update:
 	int iR = 3 * ( m_motionModel.posOrder() + 1 ); // shortcut for first index of orientation
-	Math::Stochastic::kalmanMeasurementUpdate( m_state, m_covariance, Function::InvertRotationVelocity(), v.value, v.covariance, iR, iR + 7 );
+	TRACEPOINT_TRACKING_KALMAN_UPDATE( t, "inverse_rotation_velocity", 3 );
+	if ( !Math::Stochastic::kalmanMeasurementUpdate( m_state, m_covariance, Function::InvertRotationVelocity(), velocity.value, velocity.covariance, iR, iR + 7, m_gates.gate( 3 ) ) )
+		rejectMeasurement( 3 );
 
 	// normalize quaternion
 	normalize();
 }
 
 
+void PoseKalmanFilter::setHistoryDepth( std::size_t depth )
+{
+	if ( !m_pFixed )
+		UBITRACK_THROW( "PoseKalmanFilter supports a measurement history only for orders between 0 and 2" );
+	m_pFixed->setHistoryDepth( depth );
+}
+
+
+void PoseKalmanFilter::setCovarianceForm( Math::Stochastic::KalmanCovarianceForm form )
+{
+	if ( !m_pFixed )
+	{
+		if ( form != Math::Stochastic::kalmanFullCovariance )
+			UBITRACK_THROW( "PoseKalmanFilter supports a UD-factorized covariance only for orders between 0 and 2" );
+		return;
+	}
+	m_pFixed->setCovarianceForm( form );
+}
+
+
+void PoseKalmanFilter::setInnovationGate( double probability )
+{
+	if ( m_pFixed )
+		m_pFixed->setInnovationGate( probability );
+	else
+		m_gates.setProbability( probability );
+}
+
+
+std::size_t PoseKalmanFilter::rejectedMeasurements() const
+{
+	if ( m_pFixed )
+		return m_pFixed->rejectedMeasurements();
+	return m_gates.rejected();
+}
+
+
+void PoseKalmanFilter::rejectMeasurement( std::size_t size )
+{
+	LOG4CPP_DEBUG( logger, "Measurement rejected, squared innovation distance " << m_gates.gate( size )->distance );
+	m_gates.countRejected();
+}
+
+
 void PoseKalmanFilter::timeUpdate( Measurement::Timestamp t )
 {
+	if ( m_pFixed )
+	{
+		m_pFixed->timeUpdate( t );
+		return;
+	}
+
 	// only update time for the first measurement
 	if ( m_time == 0 || m_time == t )
 	{
@@ -268,6 +437,9 @@ void PoseKalmanFilter::normalize()
 
 Measurement::ErrorPose PoseKalmanFilter::predictPose( Measurement::Timestamp t )
 {
+	if ( m_pFixed )
+		return m_pFixed->predictPose( t );
+
 	// have measurements?
 	if ( !m_time )
 		UBITRACK_THROW( "kalman filter not (yet) initialized" );
@@ -308,6 +480,38 @@ Measurement::ErrorPose PoseKalmanFilter::predictPose( Measurement::Timestamp t )
 }
 
 
+Measurement::Pose PoseKalmanFilter::extrapolatePose( Measurement::Timestamp t ) const
+{
+	if ( m_pFixed )
+		return m_pFixed->extrapolatePose( t );
+
+	// have measurements?
+	if ( !m_time )
+		UBITRACK_THROW( "kalman filter not (yet) initialized" );
+
+	const int iR = 3 * ( m_motionModel.posOrder() + 1 );
+	const double dt = ( (long long int)( t - m_time ) ) * 1e-9;
+
+	Math::Vector< double, 3 > position;
+	Math::Vector< double, 4 > rotation;
+	if ( m_bInsideOut )
+	{
+		Math::Vector< double > newState( m_state.size() );
+		Math::Matrix< double, 0, 0 > jacobian( m_state.size(), m_state.size() );
+		Function::InsideOutPoseTimeUpdate( dt, m_motionModel.posOrder() ).evaluateWithJacobian( newState, m_state, jacobian );
+		position = ublas::subrange( newState, 0, 3 );
+		rotation = ublas::subrange( newState, iR, iR + 4 );
+	}
+	else
+	{
+		Function::LinearTimeUpdate( dt, 3, m_motionModel.posOrder() ).evaluate( position, ublas::subrange( m_state, 0, iR ) );
+		Function::QuaternionTimeUpdate( dt, m_motionModel.oriOrder() ).evaluate( rotation, ublas::subrange( m_state, iR, m_state.size() ) );
+	}
+
+	return Measurement::Pose( t, Math::Pose( Math::Quaternion::fromVector( rotation ).normalize(), position ) );
+}
+
+
 } } // namespace Ubitrack::Tracking
 
 #endif // HAVE_LAPACK
@@ -39,7 +39,9 @@
 #include <utCore.h>
 #include <utMath/ErrorVector.h>
 #include <utMeasurement/Measurement.h>
+#include <boost/scoped_ptr.hpp>
 #include "LinearPoseMotionModel.h"
+#include "PoseKalmanFilterT.h"
 
 namespace Ubitrack { namespace Tracking {
 
@@ -58,6 +60,9 @@ namespace Ubitrack { namespace Tracking {
  *
  * Unfortunately, covariances of measurements and process noise can't be 
  * configured at the moment.
+ *
+ * For position and orientation orders between 0 and 2, the work is done by a \c PoseKalmanFilterT
+ * with fixed-size state and covariance. Other orders use dynamic matrices.
  */
 class UBITRACK_EXPORT PoseKalmanFilter
 {
@@ -71,6 +76,12 @@ public:
 	 */
 	PoseKalmanFilter( const LinearPoseMotionModel& motionModel, bool bInsideOut = false );
 
+	/** copy constructor, copies the state of the filter */
+	PoseKalmanFilter( const PoseKalmanFilter& other );
+
+	/** assignment operator, copies the state of the filter */
+	PoseKalmanFilter& operator=( const PoseKalmanFilter& other );
+
 	/** 
 	 * integrate an absolute pose measurement.
 	 * @param m the measured pose with timestamp and error
@@ -102,11 +113,56 @@ public:
 	 */
 	void addInverseRotationVelocityMeasurement( const Measurement::RotationVelocity& m );
 	
+	/**
+	 * Integrates an angular velocity measurement with its covariance, e.g. the mean rotation
+	 * velocity of an \c ImuPreintegration. The other overload assumes a fixed, very small covariance.
+	 * @param t timestamp of the measurement
+	 * @param velocity the measured angular velocity
+	 */
+	void addRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity );
+
+	/**
+	 * Integrates an inverted angular velocity measurement with its covariance.
+	 * @param t timestamp of the measurement
+	 * @param velocity the measured angular velocity
+	 */
+	void addInverseRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity );
+	
+	/**
+	 * Keeps a history of the last \c depth measurements, so measurements that arrive late are fused at
+	 * their timestamp, see \c PoseKalmanFilterT::setHistoryDepth. Only available for position and
+	 * orientation orders between 0 and 2.
+	 */
+	void setHistoryDepth( std::size_t depth );
+
+	/**
+	 * Selects a UD-factorized or the full covariance, see \c PoseKalmanFilterT::setCovarianceForm. Only
+	 * available for position and orientation orders between 0 and 2.
+	 */
+	void setCovarianceForm( Math::Stochastic::KalmanCovarianceForm form );
+
+	/**
+	 * Rejects measurements whose innovation is unlikely under the predicted state and covariance,
+	 * e.g. flipped marker poses, see \c PoseKalmanFilterT::setInnovationGate.
+	 * @param probability with which a correct measurement passes, e.g. 0.997, 0 (the default) disables gating
+	 */
+	void setInnovationGate( double probability );
+
+	/** returns the number of measurement updates rejected by the gate */
+	std::size_t rejectedMeasurements() const;
+
 	/**
 	 * compute a rotation for a given time, which may lie in the future
 	 */
 	Measurement::ErrorPose predictPose( Measurement::Timestamp t );
 
+	/**
+	 * Computes the pose for a given time without the covariance, which is much cheaper than
+	 * \c predictPose. For orders between 0 and 2, this may be called from other threads, e.g. render
+	 * threads, while measurements are added, see \c PoseKalmanFilterT::extrapolatePose.
+	 */
+	Measurement::Pose extrapolatePose( Measurement::Timestamp t ) const;
+
 	/** type of internal state representation */
 	typedef Math::Vector< double > StateType;
 
@@ -114,12 +170,10 @@ public:
 	typedef Math::Matrix< double, 0, 0 > CovarianceType;
 
 	/** returns the internal state */
-	const StateType& getState() const
-	{ return m_state; }
+	StateType getState() const;
 
 	/** returns the internal covariance */
-	const CovarianceType& getCovariance() const
-	{ return m_covariance; }
+	CovarianceType getCovariance() const;
 
 	/** returns the motion model */
 	const LinearPoseMotionModel& getMotionModel() const
@@ -137,6 +191,9 @@ protected:
 	
 	/** normalizes the state */
 	void normalize();
+
+	/** logs and counts a measurement rejected by the gate for its size */
+	void rejectMeasurement( std::size_t size );
 	
 	/** the motion model */
 	LinearPoseMotionModel m_motionModel;
@@ -152,6 +209,12 @@ protected:
 	
 	/** timestamp of the current state */
 	Measurement::Timestamp m_time;
+
+	/** the innovation gates */
+	Math::Stochastic::InnovationGates m_gates;
+
+	/** the fixed-size filter for common orders, if set, the members above are unused */
+	boost::scoped_ptr< PoseKalmanFilterBase > m_pFixed;
 };
 
 } } // namespace Ubitrack::Tracking
@@ -0,0 +1,814 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * implementation of the pose kalman filter with fixed state size
+ */
+
+#include "PoseKalmanFilterT.h"
+#ifdef HAVE_LAPACK
+
+#include <utMath/Stochastic/CovarianceTransform.h>
+#include <utMath/Stochastic/KalmanUD.h>
+#include <utMath/Optimization/Function/VectorNormalize.h>
+#include <utUtil/Exception.h>
+#include <utUtil/TracingProvider.h>
+#include <utUtil/TraceSpan.h>
+#include "Function/PoseTimeUpdate.h"
+#include "Function/InsideOutPoseTimeUpdate.h"
+#include "Function/InvertRotationVelocity.h"
+
+// get a logger
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Tracking.PoseKalmanFilter" );
+
+#define KALMAN_LOGGING
+#include <utMath/Stochastic/Kalman.h>
+
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** sets all elements of a matrix to zero */
+template< class MT >
+void clearMatrix( MT& m )
+{
+	for ( std::size_t r = 0; r < m.size1(); r++ )
+		for ( std::size_t c = 0; c < m.size2(); c++ )
+			m( r, c ) = 0;
+}
+
+/** pose measurement, with a jacobian over the whole state */
+struct FullPoseMeasurement
+{
+	std::size_t m_rotStart;
+
+	FullPoseMeasurement( std::size_t rotStart )
+		: m_rotStart( rotStart )
+	{}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& jacobian ) const
+	{
+		clearMatrix( jacobian );
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			result( i ) = input( i );
+			jacobian( i, i ) = 1;
+		}
+		for ( std::size_t i = 0; i < 4; i++ )
+		{
+			result( 3 + i ) = input( m_rotStart + i );
+			jacobian( 3 + i, m_rotStart + i ) = 1;
+		}
+	}
+};
+
+/** inverted rotation velocity, with a jacobian over the whole state */
+struct FullInvertRotationVelocity
+{
+	std::size_t m_rotStart;
+
+	FullInvertRotationVelocity( std::size_t rotStart )
+		: m_rotStart( rotStart )
+	{}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& jacobian ) const
+	{
+		clearMatrix( jacobian );
+		ublas::matrix_range< MT > jacobianSubRange( jacobian, ublas::range( 0, 3 ), ublas::range( m_rotStart, m_rotStart + 7 ) );
+		Ubitrack::Tracking::Function::InvertRotationVelocity()
+			.evaluateWithJacobian( result, ublas::subrange( input, m_rotStart, m_rotStart + 7 ), jacobianSubRange );
+	}
+};
+
+/** exposes a vector as the diagonal of a matrix, to collect the process noise of \c LinearPoseMotionModel::addNoise */
+template< class VT >
+struct DiagonalAdaptor
+{
+	VT& m_diagonal;
+
+	DiagonalAdaptor( VT& diagonal )
+		: m_diagonal( diagonal )
+	{}
+
+	double& operator()( std::size_t i, std::size_t j )
+	{
+		assert( i == j );
+		return m_diagonal( i );
+	}
+};
+
+/**
+ * Computes the block at rows \c r and columns \c c of <tt>F P F^T</tt> for a block-diagonal jacobian \c F,
+ * where the rows and columns each lie in one diagonal block of \c F, of size \c R and \c C. Only the
+ * blocks <tt>F_rr P_rc F_cc^T</tt> contribute, and zero elements of the jacobian are skipped. The result
+ * is written to both the block and its transpose.
+ */
+template< std::size_t R, std::size_t C, class MT >
+void blockDiagonalTransform( MT& result, const MT& jacobian, const MT& covariance, const std::size_t r, const std::size_t c )
+{
+	// fp = F_rr * P_rc
+	double fp[ R ][ C ];
+	for ( std::size_t i = 0; i < R; i++ )
+	{
+		for ( std::size_t j = 0; j < C; j++ )
+			fp[ i ][ j ] = 0;
+		for ( std::size_t k = 0; k < R; k++ )
+		{
+			const double f = jacobian( r + i, r + k );
+			if ( f != 0 )
+				for ( std::size_t j = 0; j < C; j++ )
+					fp[ i ][ j ] += f * covariance( r + k, c + j );
+		}
+	}
+
+	// result = fp * F_cc^T, only the lower triangle of diagonal blocks
+	for ( std::size_t i = 0; i < R; i++ )
+		for ( std::size_t j = 0; j < ( r == c ? i + 1 : C ); j++ )
+		{
+			double sum = 0;
+			for ( std::size_t l = 0; l < C; l++ )
+			{
+				const double f = jacobian( c + j, c + l );
+				if ( f != 0 )
+					sum += fp[ i ][ l ] * f;
+			}
+			result( r + i, c + j ) = result( c + j, r + i ) = sum;
+		}
+}
+
+}
+
+namespace Ubitrack { namespace Tracking {
+
+template< int PosOrder, int OriOrder >
+PoseKalmanFilterT< PosOrder, OriOrder >::PoseKalmanFilterT( const LinearPoseMotionModel& motionModel, bool bInsideOut )
+	: m_motionModel( motionModel )
+	, m_bInsideOut( bInsideOut )
+	, m_state( StateType::zeros() )
+	, m_covariance( CovarianceType::identity() )
+	, m_time( 0 )
+	, m_covarianceForm( Math::Stochastic::kalmanFullCovariance )
+	, m_historyBegin( 0 )
+	, m_historySize( 0 )
+{
+	if ( m_motionModel.posOrder() != PosOrder || m_motionModel.oriOrder() != OriOrder )
+		UBITRACK_THROW( "PoseKalmanFilterT: orders of the motion model do not match the filter" );
+	if ( bInsideOut && ( PosOrder > 1 || OriOrder != 1 ) )
+		UBITRACK_THROW( "PoseKalmanFilter needs posOrder==1 or 0 and oriOrder==1 when inside-out mode is used!" );
+
+	// initialize state (apart from the zeroing above)
+	m_state( 6 + 3 * PosOrder ) = 1;
+}
+
+
+template< int PosOrder, int OriOrder >
+PoseKalmanFilterBase* PoseKalmanFilterT< PosOrder, OriOrder >::clone() const
+{
+	return new PoseKalmanFilterT( *this );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::setHistoryDepth( std::size_t depth )
+{
+	m_history.clear();
+	m_history.resize( depth );
+	m_historyBegin = 0;
+	m_historySize = 0;
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::setCovarianceForm( Math::Stochastic::KalmanCovarianceForm form )
+{
+	if ( form == m_covarianceForm )
+		return;
+
+	const CovarianceType covariance( m_covariance );
+	if ( form == Math::Stochastic::kalmanUDFactors )
+	{
+		if ( !Math::Stochastic::udFactorize( covariance, m_covariance ) )
+			LOG4CPP_NOTICE( logger, "Covariance is not positive definite, singular directions are dropped" );
+	}
+	else
+		Math::Stochastic::udCompose( covariance, m_covariance );
+	m_covarianceForm = form;
+
+	// the snapshots of the history are in the old form
+	setHistoryDepth( m_history.size() );
+}
+
+
+template< int PosOrder, int OriOrder >
+typename PoseKalmanFilterT< PosOrder, OriOrder >::CovarianceType PoseKalmanFilterT< PosOrder, OriOrder >::covariance() const
+{
+	if ( m_covarianceForm == Math::Stochastic::kalmanFullCovariance )
+		return m_covariance;
+
+	CovarianceType covariance;
+	Math::Stochastic::udCompose( m_covariance, covariance );
+	return covariance;
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::setState( const StateType& state, const CovarianceType& covariance, Measurement::Timestamp t )
+{
+	m_state = state;
+	if ( m_covarianceForm == Math::Stochastic::kalmanFullCovariance )
+		m_covariance = covariance;
+	else
+		Math::Stochastic::udFactorize( covariance, m_covariance );
+	m_time = t;
+	publish();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::setInnovationGate( double probability )
+{
+	m_gates.setProbability( probability );
+}
+
+
+template< int PosOrder, int OriOrder >
+template< std::size_t M, class MF >
+bool PoseKalmanFilterT< PosOrder, OriOrder >::measurementUpdate( const MF& measurementFunction,
+	const Math::Vector< double, M >& measurement, const Math::Matrix< double, M, M >& measurementCov )
+{
+	Math::Stochastic::InnovationGate* pGate = m_gates.gate( M );
+	bool bFused;
+	if ( m_covarianceForm == Math::Stochastic::kalmanFullCovariance )
+		bFused = Math::Stochastic::kalmanMeasurementUpdate( m_state, m_covariance, measurementFunction, measurement, measurementCov, pGate );
+	else
+		bFused = Math::Stochastic::kalmanMeasurementUpdateUD( m_state, m_covariance, measurementFunction, measurement, measurementCov, pGate );
+
+	if ( !bFused )
+	{
+		LOG4CPP_DEBUG( logger, "Measurement rejected, squared innovation distance " << pGate->distance );
+		m_gates.countRejected();
+	}
+	return bFused;
+}
+
+
+template< int PosOrder, int OriOrder >
+template< std::size_t M >
+bool PoseKalmanFilterT< PosOrder, OriOrder >::measurementUpdateIdentity( const Math::Vector< double, M >& measurement,
+	const Math::Matrix< double, M, M >& measurementCov, std::size_t iBegin )
+{
+	Math::Stochastic::InnovationGate* pGate = m_gates.gate( M );
+	bool bFused;
+	if ( m_covarianceForm == Math::Stochastic::kalmanFullCovariance )
+		bFused = Math::Stochastic::kalmanMeasurementUpdateIdentity( m_state, m_covariance, measurement, measurementCov, iBegin, pGate );
+	else
+		bFused = Math::Stochastic::kalmanMeasurementUpdateIdentityUD( m_state, m_covariance, measurement, measurementCov, iBegin, pGate );
+
+	if ( !bFused )
+	{
+		LOG4CPP_DEBUG( logger, "Measurement rejected, squared innovation distance " << pGate->distance );
+		m_gates.countRejected();
+	}
+	return bFused;
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::addPoseMeasurement( const Measurement::ErrorPose& m )
+{
+	if ( m_history.empty() )
+		updatePose( m.time(), *m );
+	else
+	{
+		HistoryEntry entry;
+		entry.type = poseMeasurement;
+		entry.time = m.time();
+		entry.pose = *m;
+		addToHistory( entry );
+	}
+
+	publish();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::addRotationMeasurement( const Measurement::Rotation& m )
+{
+	if ( m_history.empty() )
+		updateRotation( m.time(), *m );
+	else
+	{
+		HistoryEntry entry;
+		entry.type = rotationMeasurement;
+		entry.time = m.time();
+		entry.rotation = *m;
+		addToHistory( entry );
+	}
+
+	publish();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::addRotationVelocityMeasurement( const Measurement::RotationVelocity& m )
+{
+	addRotationVelocityMeasurement( m.time(),
+		Math::ErrorVector< double, 3 >( *m, Math::Matrix< double, 3, 3 >::identity() * 1e-11 ) ); // magic number, tune here
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::addRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity )
+{
+	if ( m_history.empty() )
+		updateRotationVelocity( t, velocity );
+	else
+	{
+		HistoryEntry entry;
+		entry.type = rotationVelocityMeasurement;
+		entry.time = t;
+		entry.velocity = velocity;
+		addToHistory( entry );
+	}
+
+	publish();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::addInverseRotationVelocityMeasurement( const Measurement::RotationVelocity& m )
+{
+	addInverseRotationVelocityMeasurement( m.time(),
+		Math::ErrorVector< double, 3 >( *m, Math::Matrix< double, 3, 3 >::identity() * 1e-11 ) ); // magic number, tune here
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::addInverseRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity )
+{
+	if ( m_history.empty() )
+		updateInverseRotationVelocity( t, velocity );
+	else
+	{
+		HistoryEntry entry;
+		entry.type = inverseRotationVelocityMeasurement;
+		entry.time = t;
+		entry.velocity = velocity;
+		addToHistory( entry );
+	}
+
+	publish();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::addToHistory( const HistoryEntry& entry )
+{
+	// the new measurement goes behind all measurements that are not newer
+	std::size_t k = m_historySize;
+	while ( k > 0 && historyAt( k - 1 ).time > entry.time )
+		k--;
+
+	if ( k < m_historySize )
+	{
+		// go back to the state before the first newer measurement
+		const HistoryEntry& first( historyAt( k ) );
+		if ( first.stateTime > entry.time )
+		{
+			LOG4CPP_NOTICE( logger, "Dropping measurement at t=" << entry.time << ", which is older than the history" );
+			return;
+		}
+		LOG4CPP_DEBUG( logger, "Out-of-sequence measurement at t=" << entry.time << ", replaying " << m_historySize - k << " measurements" );
+		m_state = first.state;
+		m_covariance = first.covariance;
+		m_time = first.stateTime;
+	}
+
+	// when the history is full, drop the oldest measurement, or do not keep the new one if it would be the oldest
+	bool bKeep = true;
+	if ( m_historySize == m_history.size() )
+	{
+		if ( k == 0 )
+			bKeep = false;
+		else
+		{
+			m_historyBegin = ( m_historyBegin + 1 ) % m_history.size();
+			m_historySize--;
+			k--;
+		}
+	}
+
+	if ( bKeep )
+	{
+		// insert the new measurement at k
+		for ( std::size_t i = m_historySize; i > k; i-- )
+			historyAt( i ) = historyAt( i - 1 );
+		historyAt( k ) = entry;
+		m_historySize++;
+	}
+	else
+		applyMeasurement( entry );
+
+	// apply the new and all newer measurements, each with a snapshot of the state before it
+	for ( std::size_t i = k; i < m_historySize; i++ )
+	{
+		HistoryEntry& e( historyAt( i ) );
+		e.state = m_state;
+		e.covariance = m_covariance;
+		e.stateTime = m_time;
+		applyMeasurement( e );
+	}
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::applyMeasurement( const HistoryEntry& entry )
+{
+	switch ( entry.type )
+	{
+	case poseMeasurement:
+		updatePose( entry.time, entry.pose );
+		break;
+	case rotationMeasurement:
+		updateRotation( entry.time, entry.rotation );
+		break;
+	case rotationVelocityMeasurement:
+		updateRotationVelocity( entry.time, entry.velocity );
+		break;
+	case inverseRotationVelocityMeasurement:
+		updateInverseRotationVelocity( entry.time, entry.velocity );
+		break;
+	}
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::updatePose( Measurement::Timestamp t, const Math::ErrorPose& pose )
+{
+	UBITRACK_TRACE_SPAN( "kalman_update_pose", 7 );
+	const std::size_t iR = 3 * ( PosOrder + 1 ); // shortcut for first index of orientation
+	ublas::vector_range< StateType > rotSubState( m_state, ublas::range( iR, iR + 4 ) );
+
+	// on first update, set pose
+	if ( m_time == 0 )
+	{
+		ublas::subrange( m_state, 0, 3 ) = pose.translation();
+		pose.rotation().toVector( rotSubState );
+	}
+
+	// time update: forward filter to requested timestamp
+	forward( t );
+
+	// create measurement as ErrorVector
+	Math::ErrorVector< double, 7 > v;
+	pose.toAdditiveErrorVector( v );
+	LOG4CPP_TRACE( logger, "Additive covariance: " << v.covariance );
+
+	// negate quaternion
+	if ( ublas::inner_prod( rotSubState, ublas::subrange( v.value, 3, 7 ) ) < 0 )
+		ublas::subrange( v.value, 3, 7 ) *= -1;
+
+	// measurement update:
+	TRACEPOINT_TRACKING_KALMAN_UPDATE( t, "pose", 7 );
+	measurementUpdate( FullPoseMeasurement( iR ), v.value, v.covariance );
+
+	// normalize quaternion
+	normalize();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::updateRotation( Measurement::Timestamp t, const Math::Quaternion& rotation )
+{
+	UBITRACK_TRACE_SPAN( "kalman_update_rotation", 4 );
+	const std::size_t iR = 3 + 3 * PosOrder; // shortcut for first index of orientation
+	ublas::vector_range< StateType > rotSubState( m_state, ublas::range( iR, iR + 4 ) );
+
+	// on first update, set quaternion
+	if ( m_time == 0 )
+		rotation.toVector( rotSubState );
+
+	// time update: forward filter to requested timestamp
+	forward( t );
+
+	// create measurement as ErrorVector
+	Math::ErrorVector< double, 4 > v;
+	rotation.toVector( v.value );
+	v.covariance = Math::Matrix< double, 4, 4 >::identity() * 0.004; // magic number, tune here
+
+	// invert quaternion if necessary
+	if ( ublas::inner_prod( rotSubState, v.value ) < 0 )
+		v.value *= -1;
+
+	// measurement update:
+	TRACEPOINT_TRACKING_KALMAN_UPDATE( t, "rotation", 4 );
+	measurementUpdateIdentity( v.value, v.covariance, iR );
+
+	// normalize quaternion
+	normalize();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::updateRotationVelocity( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity )
+{
+	UBITRACK_TRACE_SPAN( "kalman_update_rotation_velocity", 3 );
+	assert( OriOrder >= 1 );
+
+	if ( m_time == 0 )
+		return;
+
+	// time update: forward filter to requested timestamp
+	forward( t );
+
+	// measurement update:
+	const std::size_t iV = 4 + 3 * ( PosOrder + 1 ); // shortcut for first index of rotation velocity
+	TRACEPOINT_TRACKING_KALMAN_UPDATE( t, "rotation_velocity", 3 );
+	measurementUpdateIdentity( velocity.value, velocity.covariance, iV );
+
+	// normalize quaternion
+	normalize();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::updateInverseRotationVelocity( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity )
+{
+	UBITRACK_TRACE_SPAN( "kalman_update_inverse_rotation_velocity", 3 );
+	assert( OriOrder >= 1 );
+
+	if ( m_time == 0 )
+		return;
+
+	// time update: forward filter to requested timestamp
+	forward( t );
+
+	// measurement update:
+	const std::size_t iR = 3 * ( PosOrder + 1 ); // shortcut for first index of orientation
+	TRACEPOINT_TRACKING_KALMAN_UPDATE( t, "inverse_rotation_velocity", 3 );
+	measurementUpdate( FullInvertRotationVelocity( iR ), velocity.value, velocity.covariance );
+
+	// normalize quaternion
+	normalize();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::timeUpdate( Measurement::Timestamp t )
+{
+	forward( t );
+	publish();
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::forward( Measurement::Timestamp t )
+{
+	// only update time for the first measurement
+	if ( m_time == 0 || m_time == t )
+	{
+		m_time = t;
+		return;
+	}
+
+	double dt = ( (long long int)( t - m_time ) ) * 1e-9;
+	LOG4CPP_DEBUG( logger, "Time update to t = " << t << ", dt = " << dt );
+	predict( dt, m_state, m_covariance );
+
+	m_time = t;
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::predict( double dt, StateType& state, CovarianceType& covariance ) const
+{
+	// compute the new state and the jacobian of the time update
+	StateType newState;
+	CovarianceType jacobian;
+	if ( m_bInsideOut )
+		Function::InsideOutPoseTimeUpdate( dt, PosOrder ).evaluateWithJacobian( newState, m_state, jacobian );
+	else
+		Function::PoseTimeUpdate( dt, PosOrder, OriOrder ).evaluateWithJacobian( newState, m_state, jacobian );
+
+	if ( m_covarianceForm == Math::Stochastic::kalmanUDFactors )
+	{
+		// transform the factors and add the process noise in one step
+		StateType noise( StateType::zeros() );
+		DiagonalAdaptor< StateType > noiseDiagonal( noise );
+		m_motionModel.addNoise( noiseDiagonal, dt );
+		covariance = m_covariance;
+		Math::Stochastic::udTransform( covariance, jacobian, noise );
+		state = newState;
+		return;
+	}
+
+	CovarianceType newCovariance;
+	if ( m_bInsideOut )
+		Math::Stochastic::symmetricTransform( newCovariance, jacobian, m_covariance );
+	else
+	{
+		// the jacobian is block-diagonal with the position and the orientation block
+		const std::size_t iR = 3 * ( PosOrder + 1 );
+		blockDiagonalTransform< 3 * ( PosOrder + 1 ), 3 * ( PosOrder + 1 ) >( newCovariance, jacobian, m_covariance, 0, 0 );
+		blockDiagonalTransform< 3 * ( PosOrder + 1 ), 4 + 3 * OriOrder >( newCovariance, jacobian, m_covariance, 0, iR );
+		blockDiagonalTransform< 4 + 3 * OriOrder, 4 + 3 * OriOrder >( newCovariance, jacobian, m_covariance, iR, iR );
+	}
+	state = newState;
+	covariance = newCovariance;
+
+	// add process noise
+	m_motionModel.addNoise( covariance, dt );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::normalize()
+{
+	const std::size_t iR = 3 * ( PosOrder + 1 );
+
+	// normalize quaternion
+	Math::Vector< double, 4 > q;
+	Math::Matrix< double, 4, 4 > jacobian;
+	Math::Optimization::Function::VectorNormalize( 4 ).evaluateWithJacobian( q, ublas::subrange( m_state, iR, iR + 4 ), jacobian );
+	ublas::subrange( m_state, iR, iR + 4 ) = q;
+
+	if ( m_covarianceForm == Math::Stochastic::kalmanUDFactors )
+	{
+		CovarianceType transform( CovarianceType::identity() );
+		ublas::subrange( transform, iR, iR + 4, iR, iR + 4 ) = jacobian;
+		Math::Stochastic::udTransform( m_covariance, transform, StateType::zeros() );
+	}
+	else
+	{
+		// transform the rows and columns of the quaternion, jp = J * P_q
+		Math::Matrix< double, 4, stateSize > jp;
+		for ( std::size_t r = 0; r < 4; r++ )
+			for ( std::size_t c = 0; c < stateSize; c++ )
+			{
+				double sum = 0;
+				for ( std::size_t k = 0; k < 4; k++ )
+					sum += jacobian( r, k ) * m_covariance( iR + k, c );
+				jp( r, c ) = sum;
+			}
+		for ( std::size_t r = 0; r < 4; r++ )
+		{
+			for ( std::size_t c = 0; c < stateSize; c++ )
+				if ( c < iR || c >= iR + 4 )
+					m_covariance( iR + r, c ) = m_covariance( c, iR + r ) = jp( r, c );
+			for ( std::size_t c = 0; c < 4; c++ )
+			{
+				double sum = 0;
+				for ( std::size_t k = 0; k < 4; k++ )
+					sum += jp( r, iR + k ) * jacobian( c, k );
+				m_covariance( iR + r, iR + c ) = sum;
+			}
+		}
+	}
+
+	if ( OriOrder >= 1 )
+	{
+		// check if rotation velocity is too big and reset it in this case
+		if ( ublas::norm_2( ublas::subrange( m_state, iR + 4, iR + 7 ) ) > 10.0 )
+		{
+			LOG4CPP_NOTICE( logger, "Kalman Filter orientation instability detected. Resetting orientation derivatives." );
+			for ( std::size_t i = iR + 4; i < stateSize; i++ )
+				m_state( i ) = 0;
+		}
+	}
+}
+
+
+template< int PosOrder, int OriOrder >
+Measurement::ErrorPose PoseKalmanFilterT< PosOrder, OriOrder >::predictPose( Measurement::Timestamp t )
+{
+	// have measurements?
+	if ( !m_time )
+		UBITRACK_THROW( "kalman filter not (yet) initialized" );
+
+	const std::size_t iR = 3 * ( PosOrder + 1 );
+
+	double dt = ( (long long int)( t - m_time ) ) * 1e-9;
+	LOG4CPP_DEBUG( logger, "predicting for t=" << t << ", dt=" << dt );
+
+	// update state
+	StateType newState;
+	CovarianceType newCovariance;
+	predict( dt, newState, newCovariance );
+	if ( m_covarianceForm == Math::Stochastic::kalmanUDFactors )
+	{
+		const CovarianceType factors( newCovariance );
+		Math::Stochastic::udCompose( factors, newCovariance );
+	}
+	LOG4CPP_TRACE( logger, "predicted state:" << newState );
+
+	// convert to 7x7 error
+	Math::ErrorVector< double, 7 > newPose;
+	ublas::subrange( newPose.value, 0, 3 ) = ublas::subrange( newState, 0, 3 );
+	ublas::subrange( newPose.value, 3, 7 ) = ublas::subrange( newState, iR, iR + 4 );
+	ublas::subrange( newPose.covariance, 0, 3, 0, 3 ) = ublas::subrange( newCovariance, 0, 3, 0, 3 );
+	ublas::subrange( newPose.covariance, 0, 3, 3, 7 ) = ublas::subrange( newCovariance, 0, 3, iR, iR + 4 );
+	ublas::subrange( newPose.covariance, 3, 7, 0, 3 ) = ublas::subrange( newCovariance, iR, iR + 4, 0, 3 );
+	ublas::subrange( newPose.covariance, 3, 7, 3, 7 ) = ublas::subrange( newCovariance, iR, iR + 4, iR, iR + 4 );
+
+	LOG4CPP_DEBUG( logger, "predicted pose and covariance: " << newPose.value << std::endl << newPose.covariance );
+	return Measurement::ErrorPose( t, Math::ErrorPose::fromAdditiveErrorVector( newPose ) );
+}
+
+
+template< int PosOrder, int OriOrder >
+Measurement::Pose PoseKalmanFilterT< PosOrder, OriOrder >::extrapolatePose( Measurement::Timestamp t ) const
+{
+	const Snapshot snapshot( m_snapshot.load() );
+	if ( !snapshot.time )
+		UBITRACK_THROW( "kalman filter not (yet) initialized" );
+
+	const std::size_t iR = 3 * ( PosOrder + 1 );
+	const double dt = ( (long long int)( t - snapshot.time ) ) * 1e-9;
+
+	Math::Vector< double, 3 > position;
+	Math::Vector< double, 4 > rotation;
+	if ( m_bInsideOut )
+	{
+		// the translation depends on the rotation, use the full update and ignore the jacobian
+		StateType newState;
+		CovarianceType jacobian;
+		Function::InsideOutPoseTimeUpdate( dt, PosOrder ).evaluateWithJacobian( newState, snapshot.state, jacobian );
+		position = ublas::subrange( newState, 0, 3 );
+		rotation = ublas::subrange( newState, iR, iR + 4 );
+	}
+	else
+	{
+		Function::LinearTimeUpdate( dt, 3, PosOrder ).evaluate( position, ublas::subrange( snapshot.state, 0, iR ) );
+		Function::QuaternionTimeUpdate( dt, OriOrder ).evaluate( rotation, ublas::subrange( snapshot.state, iR, stateSize ) );
+	}
+
+	return Measurement::Pose( t, Math::Pose( Math::Quaternion::fromVector( rotation ).normalize(), position ) );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::publish()
+{
+	Snapshot snapshot;
+	snapshot.state = m_state;
+	snapshot.time = m_time;
+	m_snapshot.store( snapshot );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::getState( Math::Vector< double >& state ) const
+{
+	state.resize( stateSize );
+	state = m_state;
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseKalmanFilterT< PosOrder, OriOrder >::getCovariance( Math::Matrix< double, 0, 0 >& covariance ) const
+{
+	covariance.resize( stateSize, stateSize );
+	covariance = this->covariance();
+}
+
+
+// the common motion model orders
+template class PoseKalmanFilterT< 0, 0 >;
+template class PoseKalmanFilterT< 0, 1 >;
+template class PoseKalmanFilterT< 0, 2 >;
+template class PoseKalmanFilterT< 1, 0 >;
+template class PoseKalmanFilterT< 1, 1 >;
+template class PoseKalmanFilterT< 1, 2 >;
+template class PoseKalmanFilterT< 2, 0 >;
+template class PoseKalmanFilterT< 2, 1 >;
+template class PoseKalmanFilterT< 2, 2 >;
+
+} } // namespace Ubitrack::Tracking
+
+#endif // HAVE_LAPACK
@@ -0,0 +1,288 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * Kalman filtering of poses with a state size fixed at compile time
+ */
+
+#ifndef __UBITRACK_TRACKING_POSEKALMANFILTERT_H_INCLUDED__
+#define __UBITRACK_TRACKING_POSEKALMANFILTERT_H_INCLUDED__
+
+
+#ifdef HAVE_LAPACK
+
+#include <vector>
+
+#include <utCore.h>
+#include <utMath/ErrorVector.h>
+#include <utMath/Stochastic/KalmanUD.h>
+#include <utMath/Stochastic/InnovationGate.h>
+#include <utMeasurement/Measurement.h>
+#include <utUtil/SeqLock.h>
+#include "LinearPoseMotionModel.h"
+
+namespace Ubitrack { namespace Tracking {
+
+/**
+ * Interface of the pose kalman filters with a fixed state size, which allows \c PoseKalmanFilter
+ * to select one at runtime. The methods are documented at \c PoseKalmanFilter.
+ */
+class UBITRACK_EXPORT PoseKalmanFilterBase
+{
+public:
+	virtual ~PoseKalmanFilterBase()
+	{}
+
+	/** returns a copy of this filter */
+	virtual PoseKalmanFilterBase* clone() const = 0;
+
+	virtual void addPoseMeasurement( const Measurement::ErrorPose& m ) = 0;
+	virtual void addRotationMeasurement( const Measurement::Rotation& m ) = 0;
+	virtual void addRotationVelocityMeasurement( const Measurement::RotationVelocity& m ) = 0;
+	virtual void addInverseRotationVelocityMeasurement( const Measurement::RotationVelocity& m ) = 0;
+	virtual void addRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity ) = 0;
+	virtual void addInverseRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity ) = 0;
+	virtual Measurement::ErrorPose predictPose( Measurement::Timestamp t ) = 0;
+	virtual Measurement::Pose extrapolatePose( Measurement::Timestamp t ) const = 0;
+	virtual void timeUpdate( Measurement::Timestamp t ) = 0;
+	virtual void setHistoryDepth( std::size_t depth ) = 0;
+	virtual void setCovarianceForm( Math::Stochastic::KalmanCovarianceForm form ) = 0;
+	virtual void setInnovationGate( double probability ) = 0;
+	virtual std::size_t rejectedMeasurements() const = 0;
+
+	/** copies the internal state into a dynamic vector */
+	virtual void getState( Math::Vector< double >& state ) const = 0;
+
+	/** copies the internal covariance into a dynamic matrix */
+	virtual void getCovariance( Math::Matrix< double, 0, 0 >& covariance ) const = 0;
+};
+
+
+/**
+ * Pose kalman filter for a motion model with \c PosOrder position and \c OriOrder orientation
+ * derivatives. Same as \c PoseKalmanFilter, but state, covariance and the jacobians of the time
+ * and measurement updates have fixed size, so an update does not need the heap.
+ *
+ * The filter is instantiated in the library for all combinations of \c PosOrder and \c OriOrder
+ * between 0 and 2.
+ */
+template< int PosOrder, int OriOrder >
+class UBITRACK_EXPORT PoseKalmanFilterT
+	: public PoseKalmanFilterBase
+{
+public:
+	/** size of the state vector */
+	static const std::size_t stateSize = 7 + 3 * ( PosOrder + OriOrder );
+
+	/** type of internal state representation */
+	typedef Math::Vector< double, stateSize > StateType;
+
+	/** type of internal covariance representation */
+	typedef Math::Matrix< double, stateSize, stateSize > CovarianceType;
+
+	/**
+	 * Constructor.
+	 * @param motionModel Motion model that defines the process noise. Its orders must match the template parameters.
+	 * @param bInsideOut if true, a motion model is used that assumes a correlation between orientation and
+	 * translation, e.g. when a non-moveable object is tracked by a mobile camera.
+	 */
+	PoseKalmanFilterT( const LinearPoseMotionModel& motionModel, bool bInsideOut = false );
+
+	PoseKalmanFilterBase* clone() const;
+
+	void addPoseMeasurement( const Measurement::ErrorPose& m );
+	void addRotationMeasurement( const Measurement::Rotation& m );
+	void addRotationVelocityMeasurement( const Measurement::RotationVelocity& m );
+	void addInverseRotationVelocityMeasurement( const Measurement::RotationVelocity& m );
+	void addRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity );
+	void addInverseRotationVelocityMeasurement( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity );
+	Measurement::ErrorPose predictPose( Measurement::Timestamp t );
+	void timeUpdate( Measurement::Timestamp t );
+
+	/**
+	 * Computes the pose for a given time from the state after the last completed update, without
+	 * the covariance. Can be called from other threads while measurements are added: each update
+	 * publishes its result through a \c Util::SeqLock, which the caller copies without blocking
+	 * the updating thread.
+	 */
+	Measurement::Pose extrapolatePose( Measurement::Timestamp t ) const;
+
+	/**
+	 * Keeps the last \c depth measurements together with the state before each of them, so a
+	 * measurement that arrives after newer ones is fused at its own timestamp: the filter returns
+	 * to the state before the first newer measurement, applies the late one and then replays the
+	 * newer ones. Measurements older than the history are dropped. The history is allocated here,
+	 * a depth of 0 (the default) turns it off and late measurements are integrated backwards in time.
+	 */
+	void setHistoryDepth( std::size_t depth );
+
+	/**
+	 * Selects how the covariance is stored and updated. With \c Math::Stochastic::kalmanUDFactors, the
+	 * filter keeps the UD factors of the covariance, see utMath/Stochastic/KalmanUD.h, which remain
+	 * symmetric and positive semi-definite in long runs and make measurement updates cheaper.
+	 * The current covariance is converted and the measurement history is cleared.
+	 */
+	void setCovarianceForm( Math::Stochastic::KalmanCovarianceForm form );
+
+	/** returns how the covariance is stored */
+	Math::Stochastic::KalmanCovarianceForm covarianceForm() const
+	{ return m_covarianceForm; }
+
+	/**
+	 * Rejects measurements whose innovation is unlikely under the predicted state and covariance,
+	 * e.g. flipped marker poses. A correct measurement passes with the given probability, see
+	 * \c Math::Stochastic::InnovationGate. The gate reuses the factorization of the innovation
+	 * covariance of the update. 0 (the default) disables gating.
+	 */
+	void setInnovationGate( double probability );
+
+	/** returns the number of measurement updates rejected by the gate, replayed ones count again */
+	std::size_t rejectedMeasurements() const
+	{ return m_gates.rejected(); }
+
+	void getState( Math::Vector< double >& state ) const;
+	void getCovariance( Math::Matrix< double, 0, 0 >& covariance ) const;
+
+	/** returns the internal state */
+	const StateType& state() const
+	{ return m_state; }
+
+	/** returns the covariance, composed from its factors in the UD form */
+	CovarianceType covariance() const;
+
+	/** returns the motion model */
+	const LinearPoseMotionModel& getMotionModel() const
+	{ return m_motionModel; }
+
+	/** returns the timestamp of the state, 0 before the first measurement */
+	Measurement::Timestamp time() const
+	{ return m_time; }
+
+	/** replaces state, covariance and timestamp, e.g. when filters are stored elsewhere between updates */
+	void setState( const StateType& state, const CovarianceType& covariance, Measurement::Timestamp t );
+
+protected:
+	/** kinds of measurements in the history */
+	enum MeasurementType { poseMeasurement, rotationMeasurement, rotationVelocityMeasurement, inverseRotationVelocityMeasurement };
+
+	/** a measurement in the history with the state before it */
+	struct HistoryEntry
+	{
+		MeasurementType type;
+		Measurement::Timestamp time;
+		Math::ErrorPose pose;
+		Math::Quaternion rotation;
+		Math::ErrorVector< double, 3 > velocity;
+
+		StateType state;
+		CovarianceType covariance;
+		Measurement::Timestamp stateTime;
+	};
+
+	/** the measurement updates */
+	void updatePose( Measurement::Timestamp t, const Math::ErrorPose& pose );
+	void updateRotation( Measurement::Timestamp t, const Math::Quaternion& rotation );
+	void updateRotationVelocity( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity );
+	void updateInverseRotationVelocity( Measurement::Timestamp t, const Math::ErrorVector< double, 3 >& velocity );
+
+	/** measurement update of the covariance in its current form, returns false if the gate rejected the measurement */
+	template< std::size_t M, class MF >
+	bool measurementUpdate( const MF& measurementFunction, const Math::Vector< double, M >& measurement,
+		const Math::Matrix< double, M, M >& measurementCov );
+
+	/** measurement update of the sub-vector [ iBegin, iBegin + M ) of the state */
+	template< std::size_t M >
+	bool measurementUpdateIdentity( const Math::Vector< double, M >& measurement,
+		const Math::Matrix< double, M, M >& measurementCov, std::size_t iBegin );
+
+	/** applies a measurement of the history */
+	void applyMeasurement( const HistoryEntry& entry );
+
+	/** inserts a measurement into the history at its timestamp and applies it and all newer ones */
+	void addToHistory( const HistoryEntry& entry );
+
+	/** returns the i-th oldest entry of the history */
+	HistoryEntry& historyAt( std::size_t i )
+	{ return m_history[ ( m_historyBegin + i ) % m_history.size() ]; }
+
+	/** state and timestamp published for \c extrapolatePose */
+	struct Snapshot
+	{
+		StateType state;
+		Measurement::Timestamp time;
+	};
+
+	/** forwards the filter to time t */
+	void forward( Measurement::Timestamp t );
+
+	/** publishes the current state for \c extrapolatePose */
+	void publish();
+
+	/** forwards state and covariance, in the form of the filter, by dt seconds and adds the process noise */
+	void predict( double dt, StateType& state, CovarianceType& covariance ) const;
+
+	/** normalizes the state */
+	void normalize();
+
+	/** the motion model */
+	LinearPoseMotionModel m_motionModel;
+
+	/** inside-out motion model? */
+	bool m_bInsideOut;
+
+	/** the state */
+	StateType m_state;
+
+	/** the covariance, or its packed UD factors */
+	CovarianceType m_covariance;
+
+	/** timestamp of the current state */
+	Measurement::Timestamp m_time;
+
+	/** how \c m_covariance is stored */
+	Math::Stochastic::KalmanCovarianceForm m_covarianceForm;
+
+	/** the innovation gates */
+	Math::Stochastic::InnovationGates m_gates;
+
+	/** ring buffer of the last measurements, preallocated by \c setHistoryDepth */
+	std::vector< HistoryEntry > m_history;
+
+	/** index of the oldest entry in \c m_history */
+	std::size_t m_historyBegin;
+
+	/** number of entries in \c m_history */
+	std::size_t m_historySize;
+
+	/** the last completed state */
+	Util::SeqLock< Snapshot > m_snapshot;
+};
+
+} } // namespace Ubitrack::Tracking
+
+#endif // HAVE_LAPACK
+
+#endif
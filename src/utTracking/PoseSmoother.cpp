@@ -0,0 +1,273 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * implementation of the pose smoother
+ */
+
+#include "PoseSmoother.h"
+#ifdef HAVE_LAPACK
+
+#include <cmath>
+#include <utMath/FixedDecomposition.h>
+#include <utUtil/Exception.h>
+#include "Function/PoseTimeUpdate.h"
+#include "Function/InsideOutPoseTimeUpdate.h"
+
+// get a logger
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Tracking.PoseSmoother" );
+
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** stores the lower triangle of a symmetric matrix row by row */
+template< class MT >
+void packLower( const MT& m, double* packed )
+{
+	for ( std::size_t r = 0; r < m.size1(); r++ )
+		for ( std::size_t c = 0; c <= r; c++ )
+			*packed++ = m( r, c );
+}
+
+/** restores a symmetric matrix from its packed lower triangle */
+template< class MT >
+void unpackLower( const double* packed, MT& m )
+{
+	for ( std::size_t r = 0; r < m.size1(); r++ )
+		for ( std::size_t c = 0; c <= r; c++ )
+			m( r, c ) = m( c, r ) = *packed++;
+}
+
+template< class VT >
+void storeVector( const VT& v, double* data )
+{
+	for ( std::size_t i = 0; i < v.size(); i++ )
+		data[ i ] = v( i );
+}
+
+template< class VT >
+void loadVector( const double* data, VT& v )
+{
+	for ( std::size_t i = 0; i < v.size(); i++ )
+		v( i ) = data[ i ];
+}
+
+}
+
+namespace Ubitrack { namespace Tracking {
+
+template< int PosOrder, int OriOrder >
+PoseSmoother< PosOrder, OriOrder >::PoseSmoother( const LinearPoseMotionModel& motionModel, const Sink& sink,
+	std::size_t window, std::size_t lag, bool bInsideOut )
+	: m_filter( motionModel, bInsideOut )
+	, m_sink( sink )
+	, m_lag( lag )
+	, m_bInsideOut( bInsideOut )
+	, m_times( window )
+	, m_filteredStates( window * stateSize )
+	, m_filteredCovariances( window * packedSize )
+	, m_predictedStates( window * stateSize )
+	, m_predictedCovariances( window * packedSize )
+	, m_begin( 0 )
+	, m_size( 0 )
+{
+	if ( lag >= window )
+		UBITRACK_THROW( "smoother lag must be smaller than the window" );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseSmoother< PosOrder, OriOrder >::addPoseMeasurement( const Measurement::ErrorPose& m )
+{
+	addMeasurement( m, &FilterType::addPoseMeasurement );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseSmoother< PosOrder, OriOrder >::addRotationMeasurement( const Measurement::Rotation& m )
+{
+	addMeasurement( m, &FilterType::addRotationMeasurement );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseSmoother< PosOrder, OriOrder >::addRotationVelocityMeasurement( const Measurement::RotationVelocity& m )
+{
+	addMeasurement( m, &FilterType::addRotationVelocityMeasurement );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseSmoother< PosOrder, OriOrder >::addInverseRotationVelocityMeasurement( const Measurement::RotationVelocity& m )
+{
+	addMeasurement( m, &FilterType::addInverseRotationVelocityMeasurement );
+}
+
+
+template< int PosOrder, int OriOrder >
+template< class M >
+void PoseSmoother< PosOrder, OriOrder >::addMeasurement( const M& m, void ( FilterType::*update )( const M& ) )
+{
+	const bool bNewStep = m_size == 0 || m.time() != m_times[ slot( m_size - 1 ) ];
+	if ( m_size && m.time() < m_times[ slot( m_size - 1 ) ] )
+		UBITRACK_THROW( "measurements must be passed to the smoother in temporal order" );
+
+	if ( bNewStep )
+	{
+		if ( m_size == m_times.size() )
+			smooth( m_size - m_lag );
+
+		// record the prediction for the new step
+		m_filter.timeUpdate( m.time() );
+		const std::size_t s = slot( m_size );
+		m_times[ s ] = m.time();
+		storeVector( m_filter.state(), &m_predictedStates[ s * stateSize ] );
+		packLower( m_filter.covariance(), &m_predictedCovariances[ s * packedSize ] );
+		m_size++;
+	}
+
+	( m_filter.*update )( m );
+
+	const std::size_t s = slot( m_size - 1 );
+	storeVector( m_filter.state(), &m_filteredStates[ s * stateSize ] );
+	packLower( m_filter.covariance(), &m_filteredCovariances[ s * packedSize ] );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseSmoother< PosOrder, OriOrder >::flush()
+{
+	smooth( m_size );
+}
+
+
+template< int PosOrder, int OriOrder >
+void PoseSmoother< PosOrder, OriOrder >::smooth( std::size_t n )
+{
+	if ( !m_size )
+		return;
+
+	const std::size_t iR = 3 * ( PosOrder + 1 );
+	LOG4CPP_DEBUG( logger, "Smoothing " << m_size << " steps, passing on " << n );
+
+	// smoothed estimate of the following step, starts with the filtered newest step
+	StateType smoothedState;
+	CovarianceType smoothedCovariance;
+	loadVector( &m_filteredStates[ slot( m_size - 1 ) * stateSize ], smoothedState );
+	unpackLower( &m_filteredCovariances[ slot( m_size - 1 ) * packedSize ], smoothedCovariance );
+
+	for ( std::size_t k = m_size - 1; k-- > 0; )
+	{
+		const std::size_t s = slot( k );
+		const std::size_t sNext = slot( k + 1 );
+
+		StateType state;
+		CovarianceType covariance;
+		StateType predictedState;
+		CovarianceType predictedCovariance;
+		loadVector( &m_filteredStates[ s * stateSize ], state );
+		unpackLower( &m_filteredCovariances[ s * packedSize ], covariance );
+		loadVector( &m_predictedStates[ sNext * stateSize ], predictedState );
+		unpackLower( &m_predictedCovariances[ sNext * packedSize ], predictedCovariance );
+
+		// jacobian of the time update to the following step, at the filtered state
+		const double dt = ( (long long int)( m_times[ sNext ] - m_times[ s ] ) ) * 1e-9;
+		StateType newState;
+		CovarianceType jacobian;
+		if ( m_bInsideOut )
+			Function::InsideOutPoseTimeUpdate( dt, PosOrder ).evaluateWithJacobian( newState, state, jacobian );
+		else
+			Function::PoseTimeUpdate( dt, PosOrder, OriOrder ).evaluateWithJacobian( newState, state, jacobian );
+
+		// gain = P F^T ( P^- )^-1
+		if ( Math::choleskyInvert( predictedCovariance ) )
+		{
+			const CovarianceType pf( ublas::prod( covariance, ublas::trans( jacobian ) ) );
+			const CovarianceType gain( ublas::prod( pf, predictedCovariance ) );
+
+			unpackLower( &m_predictedCovariances[ sNext * packedSize ], predictedCovariance );
+			const StateType stateDiff( smoothedState - predictedState );
+			const CovarianceType covarianceDiff( smoothedCovariance - predictedCovariance );
+			const CovarianceType gd( ublas::prod( gain, covarianceDiff ) );
+
+			smoothedState = state + ublas::prod( gain, stateDiff );
+			smoothedCovariance = covariance + ublas::prod( gd, ublas::trans( gain ) );
+		}
+		else
+		{
+			LOG4CPP_NOTICE( logger, "Predicted covariance at t=" << m_times[ sNext ] << " is not positive definite, keeping the filtered estimate" );
+			smoothedState = state;
+			smoothedCovariance = covariance;
+		}
+
+		if ( k < n )
+		{
+			storeVector( smoothedState, &m_filteredStates[ s * stateSize ] );
+			packLower( smoothedCovariance, &m_filteredCovariances[ s * packedSize ] );
+		}
+	}
+
+	// pass on the oldest steps
+	for ( std::size_t k = 0; k < n; k++ )
+	{
+		const std::size_t s = slot( k );
+		StateType state;
+		CovarianceType covariance;
+		loadVector( &m_filteredStates[ s * stateSize ], state );
+		unpackLower( &m_filteredCovariances[ s * packedSize ], covariance );
+
+		Math::ErrorVector< double, 7 > pose;
+		ublas::subrange( pose.value, 0, 3 ) = ublas::subrange( state, 0, 3 );
+		ublas::subrange( pose.value, 3, 7 ) = ublas::subrange( state, iR, iR + 4 ) / ublas::norm_2( ublas::subrange( state, iR, iR + 4 ) );
+		ublas::subrange( pose.covariance, 0, 3, 0, 3 ) = ublas::subrange( covariance, 0, 3, 0, 3 );
+		ublas::subrange( pose.covariance, 0, 3, 3, 7 ) = ublas::subrange( covariance, 0, 3, iR, iR + 4 );
+		ublas::subrange( pose.covariance, 3, 7, 0, 3 ) = ublas::subrange( covariance, iR, iR + 4, 0, 3 );
+		ublas::subrange( pose.covariance, 3, 7, 3, 7 ) = ublas::subrange( covariance, iR, iR + 4, iR, iR + 4 );
+
+		m_sink( Measurement::ErrorPose( m_times[ s ], Math::ErrorPose::fromAdditiveErrorVector( pose ) ) );
+	}
+
+	m_begin = slot( n );
+	m_size -= n;
+}
+
+
+// the common motion model orders
+template class PoseSmoother< 0, 0 >;
+template class PoseSmoother< 0, 1 >;
+template class PoseSmoother< 0, 2 >;
+template class PoseSmoother< 1, 0 >;
+template class PoseSmoother< 1, 1 >;
+template class PoseSmoother< 1, 2 >;
+template class PoseSmoother< 2, 0 >;
+template class PoseSmoother< 2, 1 >;
+template class PoseSmoother< 2, 2 >;
+
+} } // namespace Ubitrack::Tracking
+
+#endif // HAVE_LAPACK
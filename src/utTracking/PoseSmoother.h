@@ -0,0 +1,161 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup tracking
+ * @file
+ * Offline smoothing of recorded pose measurements
+ */
+
+#ifndef __UBITRACK_TRACKING_POSESMOOTHER_H_INCLUDED__
+#define __UBITRACK_TRACKING_POSESMOOTHER_H_INCLUDED__
+
+
+#ifdef HAVE_LAPACK
+
+#include <vector>
+#include <boost/function.hpp>
+
+#include <utCore.h>
+#include "PoseKalmanFilterT.h"
+
+namespace Ubitrack { namespace Tracking {
+
+/**
+ * Rauch-Tung-Striebel smoother for recorded sessions. The measurements are passed, in temporal order,
+ * through a \c PoseKalmanFilterT with the same motion model, and the backward pass combines each filtered
+ * state with the states after it:
+ * <pre>
+ * C_k   = P_k F_k+1^T ( P^-_k+1 )^-1
+ * x^s_k = x_k + C_k ( x^s_k+1 - x^-_k+1 )
+ * P^s_k = P_k + C_k ( P^s_k+1 - P^-_k+1 ) C_k^T
+ * </pre>
+ * where \c x_k, \c P_k are filtered and \c x^-_k, \c P^-_k predicted before the measurement of step \c k.
+ * Each timestamp is one step, measurements with the same timestamp are fused into one.
+ *
+ * The forward pass stores per step only the timestamp, both states and the lower triangles of both
+ * covariances in arrays that are allocated by the constructor. The time update jacobian is recomputed
+ * in the backward pass, which overwrites the filtered with the smoothed values.
+ *
+ * To bound the memory of long sessions, at most \c window steps are kept. When the window is full, it is
+ * smoothed and all but the last \c lag steps are passed to the sink. The last steps are kept for the next
+ * window, as their smoothed estimates still change with later measurements; \c lag should cover a few time
+ * constants of the motion model. \c flush smooths and passes on all remaining steps.
+ */
+template< int PosOrder, int OriOrder >
+class UBITRACK_EXPORT PoseSmoother
+{
+public:
+	/** type of the forward filter */
+	typedef PoseKalmanFilterT< PosOrder, OriOrder > FilterType;
+
+	/** size of the state vector */
+	static const std::size_t stateSize = FilterType::stateSize;
+
+	/** receives the smoothed poses in temporal order */
+	typedef boost::function< void ( const Measurement::ErrorPose& ) > Sink;
+
+	/**
+	 * Constructor.
+	 * @param motionModel Motion model of the forward filter. Its orders must match the template parameters.
+	 * @param sink receives the smoothed poses
+	 * @param window maximum number of steps that are kept
+	 * @param lag number of steps that are kept for the next window, smaller than \c window
+	 * @param bInsideOut use the inside-out motion model, see \c PoseKalmanFilter
+	 */
+	PoseSmoother( const LinearPoseMotionModel& motionModel, const Sink& sink, std::size_t window = 1024,
+		std::size_t lag = 256, bool bInsideOut = false );
+
+	/** integrates a pose measurement, see \c PoseKalmanFilter::addPoseMeasurement */
+	void addPoseMeasurement( const Measurement::ErrorPose& m );
+
+	/** integrates a rotation measurement, see \c PoseKalmanFilter::addRotationMeasurement */
+	void addRotationMeasurement( const Measurement::Rotation& m );
+
+	/** integrates a rotation velocity measurement, see \c PoseKalmanFilter::addRotationVelocityMeasurement */
+	void addRotationVelocityMeasurement( const Measurement::RotationVelocity& m );
+
+	/** integrates an inverse rotation velocity measurement, see \c PoseKalmanFilter::addInverseRotationVelocityMeasurement */
+	void addInverseRotationVelocityMeasurement( const Measurement::RotationVelocity& m );
+
+	/** smooths all kept steps and passes them to the sink, e.g. at the end of a session */
+	void flush();
+
+	/** returns the number of steps that have not been passed to the sink */
+	std::size_t size() const
+	{ return m_size; }
+
+	/** returns the forward filter */
+	const FilterType& filter() const
+	{ return m_filter; }
+
+protected:
+	typedef typename FilterType::StateType StateType;
+	typedef typename FilterType::CovarianceType CovarianceType;
+
+	/** number of elements of a packed lower triangle */
+	static const std::size_t packedSize = stateSize * ( stateSize + 1 ) / 2;
+
+	/** forwards the filter to the timestamp of a measurement, applies it and records the step */
+	template< class M >
+	void addMeasurement( const M& m, void ( FilterType::*update )( const M& ) );
+
+	/** runs the backward pass over all kept steps and passes the oldest \c n to the sink */
+	void smooth( std::size_t n );
+
+	/** returns the array index of the i-th oldest step */
+	std::size_t slot( std::size_t i ) const
+	{ return ( m_begin + i ) % m_times.size(); }
+
+	/** the forward filter */
+	FilterType m_filter;
+
+	/** receives the smoothed poses */
+	Sink m_sink;
+
+	/** number of steps kept for the next window */
+	std::size_t m_lag;
+
+	/** inside-out motion model? */
+	bool m_bInsideOut;
+
+	/** ring buffers of the steps, one entry or block of \c stateSize or \c packedSize elements per slot */
+	std::vector< Measurement::Timestamp > m_times;
+	std::vector< double > m_filteredStates;
+	std::vector< double > m_filteredCovariances;
+	std::vector< double > m_predictedStates;
+	std::vector< double > m_predictedCovariances;
+
+	/** slot of the oldest step */
+	std::size_t m_begin;
+
+	/** number of kept steps */
+	std::size_t m_size;
+};
+
+} } // namespace Ubitrack::Tracking
+
+#endif // HAVE_LAPACK
+
+#endif
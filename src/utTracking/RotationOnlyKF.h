@@ -36,9 +36,14 @@
 
 #ifdef HAVE_LAPACK
 
+#include <vector>
+
 #include <utCore.h>
 #include <utMath/ErrorVector.h>
+#include <utMath/RotationIntegration.h>
+#include <utMath/Stochastic/InnovationGate.h>
 #include <utMeasurement/Measurement.h>
+#include <utUtil/SeqLock.h>
 
 namespace Ubitrack { namespace Tracking {
 
@@ -77,11 +82,35 @@ public:
 	 * @param m the measured angular velocity with timestamp
 	 */
 	void addVelocityMeasurement( const Measurement::RotationVelocity& m );
+
+	/**
+	 * integrate a block of angular velocity measurements, e.g. from a gyroscope.
+	 * The first sample is integrated as a single measurement, then the rotation is propagated
+	 * over the sampled rates with \c Math::integrateRotationVelocities instead of the constant
+	 * velocity of the motion model, and the last sample updates the velocity.
+	 * @param m angular velocities with strictly increasing timestamps
+	 * @param order order of the rotation integration
+	 */
+	void addVelocityMeasurements( const std::vector< Measurement::RotationVelocity >& m
+		, Math::RotationIntegrationOrder order = Math::rotationIntegrationSecondOrder );
 	
 	/**
-	 * compute a rotation for a given time, which may lie in the future
+	 * Rejects measurements whose innovation is unlikely under the predicted state and covariance,
+	 * see \c Math::Stochastic::InnovationGate.
+	 * @param probability with which a correct measurement passes, e.g. 0.997, 0 (the default) disables gating
 	 */
-	Measurement::Rotation predict( Measurement::Timestamp t );
+	void setInnovationGate( double probability );
+
+	/** returns the number of measurements rejected by the gate */
+	std::size_t rejectedMeasurements() const
+	{ return m_gates.rejected(); }
+
+	/**
+	 * compute a rotation for a given time, which may lie in the future.
+	 * Uses the state after the last completed measurement, so it can be called from other threads
+	 * while measurements are added.
+	 */
+	Measurement::Rotation predict( Measurement::Timestamp t ) const;
 
 	/** get internal state (mostly for debugging) */
 	const Math::Vector< double, 7 >& getState() const
@@ -90,12 +119,31 @@ public:
 protected:
 	/** performs a time update of the internal state */
 	void timeUpdate( Measurement::Timestamp t );
+
+	/** publishes the current state for \c predict */
+	void publish();
+
+	/** logs and counts a measurement rejected by the gate for its size */
+	void rejectMeasurement( std::size_t size );
+
+	/** state and timestamp published for \c predict */
+	struct Snapshot
+	{
+		Math::Vector< double, 7 > state;
+		Measurement::Timestamp time;
+	};
 	
 	/** the state */
 	Math::ErrorVector< double, 7 > m_state;
 	
 	/** timestamp of the current state */
 	Measurement::Timestamp m_time;
+
+	/** the innovation gates */
+	Math::Stochastic::InnovationGates m_gates;
+
+	/** the last completed state */
+	Util::SeqLock< Snapshot > m_snapshot;
 };
 
 } } // namespace Ubitrack::Tracking
@@ -38,8 +38,8 @@
 #include "Function/QuaternionTimeUpdate.h"
 
 // get a logger
-#include <log4cpp/Category.hh>
-static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Tracking.RotationOnlyKF" ) );
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Tracking.RotationOnlyKF" );
 #define KALMAN_LOGGING
 
 #include <utMath/Stochastic/Kalman.h>
@@ -48,6 +48,14 @@ namespace ublas = boost::numeric::ublas;
 
 namespace Ubitrack { namespace Tracking {
 
+namespace {
+
+/** variance of an angular velocity measurement, magic number, tune here */
+const double velocityVariance = 0.00001;
+
+} // anonymous namespace
+
+
 RotationOnlyKF::RotationOnlyKF()
 {
 	// initialize state
@@ -56,6 +64,16 @@ RotationOnlyKF::RotationOnlyKF()
 	m_state.covariance = Math::Matrix< double, 7, 7 >::identity();
 
 	m_time = 0;
+	publish();
+}
+
+
+void RotationOnlyKF::publish()
+{
+	Snapshot snapshot;
+	snapshot.state = m_state.value;
+	snapshot.time = m_time;
+	m_snapshot.store( snapshot );
 }
 
 
@@ -74,10 +92,13 @@ void RotationOnlyKF::addRotationMeasurement( const Measurement::Rotation& m )
 	v.covariance = Math::Matrix< double, 4, 4 >::identity() * 0.004; // magic number, tune here
 	
 	// measurement update:
-	Math::Stochastic::kalmanMeasurementUpdateIdentity< 7, 4 >( m_state, v, 0, 4 );
+	if ( !Math::Stochastic::kalmanMeasurementUpdateIdentity< 7, 4 >( m_state, v, 0, 4, m_gates.gate( 4 ) ) )
+		rejectMeasurement( 4 );
 
 	// normalize quaternion
 	Math::Stochastic::transformRangeInternalWithCovariance< 7 >( Math::Optimization::Function::VectorNormalize( 4 ), m_state, 0, 4, 0, 4 );
+
+	publish();
 }
 
 
@@ -89,13 +110,89 @@ void RotationOnlyKF::addVelocityMeasurement( const Measurement::RotationVelocity
 	// create measurement as ErrorVector
 	Math::ErrorVector< double, 3 > v;
 	v.value = *m;
-	v.covariance = Math::Matrix< double, 3, 3 >::identity() * 0.00001; // magic number, tune here
+	v.covariance = Math::Matrix< double, 3, 3 >::identity() * velocityVariance;
 	
 	// measurement update:
-	Math::Stochastic::kalmanMeasurementUpdateIdentity< 7, 3 >( m_state, v, 4, 7 );
+	if ( !Math::Stochastic::kalmanMeasurementUpdateIdentity< 7, 3 >( m_state, v, 4, 7, m_gates.gate( 3 ) ) )
+		rejectMeasurement( 3 );
 
 	// normalize quaternion
 	Math::Stochastic::transformRangeInternalWithCovariance< 7 >( Math::Optimization::Function::VectorNormalize( 4 ), m_state, 0, 4, 0, 4 );
+
+	publish();
+}
+
+
+void RotationOnlyKF::addVelocityMeasurements( const std::vector< Measurement::RotationVelocity >& m
+	, Math::RotationIntegrationOrder order )
+{
+	if ( m.empty() )
+		return;
+
+	addVelocityMeasurement( m.front() );
+	if ( m.size() == 1 )
+		return;
+
+	std::vector< Math::RotationVelocity > velocities( m.size() );
+	std::vector< double > times( m.size() );
+	for ( std::size_t k = 0; k < m.size(); k++ )
+	{
+		velocities[ k ] = *m[ k ];
+		times[ k ] = ( (long long int)( m[ k ].time() - m.front().time() ) ) * 1e-9;
+	}
+	Math::Matrix< double, 3, 3 > jacobian;
+	const Math::Quaternion d( Math::integrateRotationVelocities( &velocities[ 0 ], &times[ 0 ], m.size(), order, &jacobian ) );
+
+	// q = q * d, which is linear in q
+	const double dx = d.x();
+	const double dy = d.y();
+	const double dz = d.z();
+	const double dw = d.w();
+	Math::Matrix< double, 7, 7 > f( Math::Matrix< double, 7, 7 >::identity() );
+	f( 0, 0 ) =  dw; f( 0, 1 ) =  dz; f( 0, 2 ) = -dy; f( 0, 3 ) = dx;
+	f( 1, 0 ) = -dz; f( 1, 1 ) =  dw; f( 1, 2 ) =  dx; f( 1, 3 ) = dy;
+	f( 2, 0 ) =  dy; f( 2, 1 ) = -dx; f( 2, 2 ) =  dw; f( 2, 3 ) = dz;
+	f( 3, 0 ) = -dx; f( 3, 1 ) = -dy; f( 3, 2 ) = -dz; f( 3, 3 ) = dw;
+
+	const Math::Vector< double, 7 > state( ublas::prod( f, m_state.value ) );
+	m_state.value = state;
+	const Math::Matrix< double, 7, 7 > fp( ublas::prod( f, m_state.covariance ) );
+	m_state.covariance = ublas::prod( fp, ublas::trans( f ) );
+
+	// a common error of the rates rotates by exp( jacobian * error ) on the right
+	const double qx = m_state.value( 0 );
+	const double qy = m_state.value( 1 );
+	const double qz = m_state.value( 2 );
+	const double qw = m_state.value( 3 );
+	Math::Matrix< double, 4, 3 > g;
+	g( 0, 0 ) =  qw; g( 0, 1 ) = -qz; g( 0, 2 ) =  qy;
+	g( 1, 0 ) =  qz; g( 1, 1 ) =  qw; g( 1, 2 ) = -qx;
+	g( 2, 0 ) = -qy; g( 2, 1 ) =  qx; g( 2, 2 ) =  qw;
+	g( 3, 0 ) = -qx; g( 3, 1 ) = -qy; g( 3, 2 ) = -qz;
+	const Math::Matrix< double, 4, 3 > gj( ublas::prod( g, jacobian ) * 0.5 );
+	ublas::subrange( m_state.covariance, 0, 4, 0, 4 ) += ublas::prod( gj, ublas::trans( gj ) ) * velocityVariance;
+
+	// process noise of the motion model for the elapsed time
+	const double dt = times.back();
+	ublas::subrange( m_state.covariance, 0, 4, 0, 4 ) += Math::Matrix< double, 4, 4 >::identity() * ( 0.001 * dt * dt );
+	ublas::subrange( m_state.covariance, 4, 7, 4, 7 ) += Math::Matrix< double, 3, 3 >::identity() * ( 4.0 * dt * dt );
+	m_time = m.back().time();
+
+	// the state is at the time of the last sample, which now only updates the velocity
+	addVelocityMeasurement( m.back() );
+}
+
+
+void RotationOnlyKF::setInnovationGate( double probability )
+{
+	m_gates.setProbability( probability );
+}
+
+
+void RotationOnlyKF::rejectMeasurement( std::size_t size )
+{
+	LOG4CPP_DEBUG( logger, "Measurement rejected, squared innovation distance " << m_gates.gate( size )->distance );
+	m_gates.countRejected();
 }
 
 
@@ -123,13 +220,15 @@ void RotationOnlyKF::timeUpdate( Measurement::Timestamp t )
 }
 
 
-Measurement::Rotation RotationOnlyKF::predict( Measurement::Timestamp t )
+Measurement::Rotation RotationOnlyKF::predict( Measurement::Timestamp t ) const
 {
-	// time update: forward filter to requested timestamp
-	double dt = ( t - m_time ) * 1e-9;
-	Math::ErrorVector< double, 4 > result = Math::Stochastic::transformWithCovariance< 4, 7 >( Function::QuaternionTimeUpdate( dt ), m_state );
+	// forward the last published state to the requested timestamp, the covariance is not needed
+	const Snapshot snapshot( m_snapshot.load() );
+	double dt = ( (long long int)( t - snapshot.time ) ) * 1e-9;
+	Math::Vector< double, 4 > result;
+	Function::QuaternionTimeUpdate( dt ).evaluate( result, snapshot.state );
 	
-	return Measurement::Rotation( t, Math::Quaternion::fromVector( result.value ).normalize() );
+	return Measurement::Rotation( t, Math::Quaternion::fromVector( result ).normalize() );
 }
 
 
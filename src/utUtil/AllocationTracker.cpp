@@ -0,0 +1,132 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup util
+ * @file
+ * Counters of the tracked allocations
+ */
+
+#include "AllocationTracker.h"
+#include "NoAllocationGuard.h"
+
+#include <boost/atomic.hpp>
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+struct Counters
+{
+	boost::atomic< unsigned long long > allocations;
+	boost::atomic< unsigned long long > deallocations;
+	boost::atomic< unsigned long long > bytes;
+	boost::atomic< unsigned long long > liveBytes;
+	boost::atomic< unsigned long long > peakBytes;
+};
+
+/// zero-initialized before any dynamic initialization, so static objects can allocate
+Counters g_counters[ AllocationTracker::CategoryCount ];
+
+const char* const g_names[ AllocationTracker::CategoryCount ] =
+{
+	"math_storage",
+	"measurement_payload",
+	"serializer_buffer"
+};
+
+} // anonymous namespace
+
+
+bool AllocationTracker::enabled()
+{
+#ifdef UBITRACK_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+const char* AllocationTracker::name( Category category )
+{
+	return category < CategoryCount ? g_names[ category ] : "unknown";
+}
+
+
+void AllocationTracker::allocated( Category category, std::size_t bytes )
+{
+	// with the guarded operator new, the allocation has already been reported
+	if ( !NoAllocationGuard::operatorNewReports() )
+		NoAllocationGuard::allocation( bytes, name( category ) );
+
+	Counters& c( g_counters[ category ] );
+	c.allocations.fetch_add( 1, boost::memory_order_relaxed );
+	c.bytes.fetch_add( bytes, boost::memory_order_relaxed );
+	const unsigned long long live = c.liveBytes.fetch_add( bytes, boost::memory_order_relaxed ) + bytes;
+	unsigned long long peak = c.peakBytes.load( boost::memory_order_relaxed );
+	while ( live > peak && !c.peakBytes.compare_exchange_weak( peak, live, boost::memory_order_relaxed ) )
+		;
+}
+
+
+void AllocationTracker::deallocated( Category category, std::size_t bytes )
+{
+	Counters& c( g_counters[ category ] );
+	c.deallocations.fetch_add( 1, boost::memory_order_relaxed );
+	c.liveBytes.fetch_sub( bytes, boost::memory_order_relaxed );
+}
+
+
+std::vector< AllocationStatistics > AllocationTracker::snapshot()
+{
+	std::vector< AllocationStatistics > result( CategoryCount );
+	for ( int i = 0; i < CategoryCount; i++ )
+	{
+		const Counters& c( g_counters[ i ] );
+		AllocationStatistics& s( result[ i ] );
+		s.category = g_names[ i ];
+		s.allocations = c.allocations.load( boost::memory_order_relaxed );
+		s.deallocations = c.deallocations.load( boost::memory_order_relaxed );
+		s.bytes = c.bytes.load( boost::memory_order_relaxed );
+		s.liveBytes = c.liveBytes.load( boost::memory_order_relaxed );
+		s.peakBytes = c.peakBytes.load( boost::memory_order_relaxed );
+	}
+	return result;
+}
+
+
+void AllocationTracker::reset()
+{
+	for ( int i = 0; i < CategoryCount; i++ )
+	{
+		Counters& c( g_counters[ i ] );
+		c.allocations.store( 0, boost::memory_order_relaxed );
+		c.deallocations.store( 0, boost::memory_order_relaxed );
+		c.bytes.store( 0, boost::memory_order_relaxed );
+		c.peakBytes.store( c.liveBytes.load( boost::memory_order_relaxed ), boost::memory_order_relaxed );
+	}
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,203 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup util
+ * @file
+ * Optional accounting of the heap allocations of the library containers
+ *
+ * When the library is built with \c UBITRACK_TRACK_ALLOCATIONS, the containers that
+ * utcore allocates most take their memory through a \c TrackingAllocator, which counts
+ * allocations and bytes per category:
+ * - \c AllocationTracker::MathStorage: storage of the dynamic-size \c Math::Vector< T >
+ *   and \c Math::Matrix< T >, including the temporaries of the estimators
+ * - \c AllocationTracker::MeasurementPayload: payloads copied into a \c Measurement
+ * - \c AllocationTracker::SerializerBuffer: pooled buffers and streaming writer chunks
+ *
+ * The statistics are read with \c AllocationTracker::snapshot or
+ * \c TimerRegistry::allocationSnapshot, and the timer reporter appends them to every report.
+ * Tracked allocations inside a \c NoAllocationGuard are reported as violations.
+ *
+ * Without \c UBITRACK_TRACK_ALLOCATIONS, \c TrackedAllocator< T, C >::type is
+ * \c std::allocator< T >, so the containers are exactly the untracked ones and nothing
+ * is counted. The define changes the types of the containers, so the library and all
+ * code using it must be compiled with the same setting.
+ *
+ * Only the memory of the containers themselves is counted. E.g. for a
+ * \c Measurement::PositionList, the payload is the \c std::vector object, but not the
+ * elements it holds.
+ */
+
+#ifndef __UBITRACK_UTIL_ALLOCATIONTRACKER_H_INCLUDED__
+#define __UBITRACK_UTIL_ALLOCATIONTRACKER_H_INCLUDED__
+
+#include <new>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+/** allocation statistics of one category at the time of a snapshot */
+struct AllocationStatistics
+{
+	std::string category;
+
+	/// number of allocations and deallocations since the start or the last reset
+	unsigned long long allocations;
+	unsigned long long deallocations;
+
+	/// bytes allocated in total
+	unsigned long long bytes;
+
+	/// bytes currently allocated, and the maximum of it
+	unsigned long long liveBytes;
+	unsigned long long peakBytes;
+};
+
+
+/**
+ * Process-wide counters of the tracked allocations.
+ */
+class UBITRACK_EXPORT AllocationTracker
+{
+public:
+	/** the tracked kinds of allocations */
+	enum Category
+	{
+		MathStorage = 0,
+		MeasurementPayload,
+		SerializerBuffer,
+		CategoryCount
+	};
+
+	/** true if the library was built with \c UBITRACK_TRACK_ALLOCATIONS */
+	static bool enabled();
+
+	/** name of a category, as used in the reports */
+	static const char* name( Category category );
+
+	/** counts an allocation of \c bytes */
+	static void allocated( Category category, std::size_t bytes );
+
+	/** counts a deallocation of \c bytes */
+	static void deallocated( Category category, std::size_t bytes );
+
+	/** current statistics of all categories */
+	static std::vector< AllocationStatistics > snapshot();
+
+	/**
+	 * resets the counters. The live bytes are kept, as the memory is still allocated,
+	 * and become the new peak.
+	 */
+	static void reset();
+};
+
+
+/**
+ * Standard allocator that takes memory from the heap and counts it in the category \c C
+ * of the \c AllocationTracker.
+ */
+template< typename T, AllocationTracker::Category C >
+class TrackingAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template< typename U >
+	struct rebind
+	{ typedef TrackingAllocator< U, C > other; };
+
+	TrackingAllocator()
+	{}
+
+	template< typename U >
+	TrackingAllocator( const TrackingAllocator< U, C >& )
+	{}
+
+	pointer address( reference x ) const
+	{ return &x; }
+
+	const_pointer address( const_reference x ) const
+	{ return &x; }
+
+	pointer allocate( size_type n, const void* = 0 )
+	{
+		pointer p = static_cast< pointer >( ::operator new( n * sizeof( T ) ) );
+		AllocationTracker::allocated( C, n * sizeof( T ) );
+		return p;
+	}
+
+	void deallocate( pointer p, size_type n )
+	{
+		::operator delete( p );
+		AllocationTracker::deallocated( C, n * sizeof( T ) );
+	}
+
+	size_type max_size() const
+	{ return std::numeric_limits< size_type >::max() / sizeof( T ); }
+
+	void construct( pointer p, const T& v )
+	{ new( p ) T( v ); }
+
+	void destroy( pointer p )
+	{ p->~T(); }
+
+	template< typename U >
+	bool operator==( const TrackingAllocator< U, C >& ) const
+	{ return true; }
+
+	template< typename U >
+	bool operator!=( const TrackingAllocator< U, C >& ) const
+	{ return false; }
+};
+
+
+/**
+ * The allocator of the tracked containers: a \c TrackingAllocator if the library is built
+ * with \c UBITRACK_TRACK_ALLOCATIONS, \c std::allocator otherwise.
+ */
+template< typename T, AllocationTracker::Category C >
+struct TrackedAllocator
+{
+#ifdef UBITRACK_TRACK_ALLOCATIONS
+	typedef TrackingAllocator< T, C > type;
+#else
+	typedef std::allocator< T > type;
+#endif
+};
+
+} } // namespace Ubitrack::Util
+
+#endif //__UBITRACK_UTIL_ALLOCATIONTRACKER_H_INCLUDED__
@@ -0,0 +1,181 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Operations running asynchronously on an \c Executor
+ *
+ * \c async queues a function on an executor and returns a \c Future for its result. The
+ * function runs with a \c ProgressScope, so the iterative algorithms it calls report to the
+ * progress callback and stop when the future is cancelled:
+ * @code
+ * Util::Future< Math::Pose > result( Util::async< Math::Pose >(
+ *     boost::bind( &calibrate, measurements ), Util::CancellationToken(), &showProgress ) );
+ * ...
+ * if ( userPressedCancel )
+ *     result.cancel();
+ * Math::Pose pose( result.get() ); // throws Util::OperationCancelled after cancel
+ * @endcode
+ * The progress callback is called on the threads running the operation. On an inline
+ * executor \c async runs the function before it returns.
+ */
+
+#ifndef __UBITRACK_UTIL_ASYNC_H_INCLUDED__
+#define __UBITRACK_UTIL_ASYNC_H_INCLUDED__
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <utUtil/Executor.h>
+#include <utUtil/Progress.h>
+
+namespace Ubitrack { namespace Util {
+
+namespace Detail {
+
+/// @internal state shared by a \c Future and its task
+template< class T >
+struct AsyncState
+	: private boost::noncopyable
+{
+	AsyncState( Executor& executor, const CancellationToken& token )
+		: group( executor )
+		, token( token )
+		, bFinished( false )
+	{}
+
+	/** runs the function with the progress context, exceptions are kept for \c Future::get */
+	static void run( const boost::shared_ptr< AsyncState > pState, const boost::function< T () > f, const ProgressContext context )
+	{
+		try
+		{
+			ProgressScope scope( context );
+			context.check();
+			pState->value = f();
+		}
+		// copied with their static type, current_exception only knows exceptions thrown with boost::enable_current_exception
+		catch ( const OperationCancelled& e )
+		{
+			pState->error = boost::copy_exception( e );
+		}
+		catch ( const Exception& e )
+		{
+			pState->error = boost::copy_exception( e );
+		}
+		catch ( ... )
+		{
+			pState->error = boost::current_exception();
+		}
+		pState->bFinished.store( true, boost::memory_order_release );
+	}
+
+	TaskGroup group;
+	CancellationToken token;
+	boost::atomic< bool > bFinished;
+	T value;
+	boost::exception_ptr error;
+};
+
+} // namespace Detail
+
+/**
+ * Result of an operation started by \c async. Copies refer to the same operation.
+ */
+template< class T >
+class Future
+{
+public:
+	/** an invalid future, \c valid() is false */
+	Future()
+	{}
+
+	/** true if the future refers to an operation */
+	bool valid() const
+	{ return m_pState.get() != 0; }
+
+	/** true if the operation has finished, with a result or an exception */
+	bool ready() const
+	{ return m_pState->bFinished.load( boost::memory_order_acquire ); }
+
+	/** waits for the operation, executing queued tasks of the executor in the meantime */
+	void wait() const
+	{ m_pState->group.wait(); }
+
+	/**
+	 * waits for the operation and returns its result
+	 * @throws OperationCancelled if the operation was cancelled, or the exception of the operation
+	 */
+	const T& get() const
+	{
+		wait();
+		if ( m_pState->error )
+			boost::rethrow_exception( m_pState->error );
+		return m_pState->value;
+	}
+
+	/**
+	 * requests the cancellation of the operation. It stops at the next iteration boundary of
+	 * the running algorithm, or does not start at all.
+	 */
+	void cancel()
+	{ m_pState->token.cancel(); }
+
+	/** the cancellation token of the operation */
+	const CancellationToken& token() const
+	{ return m_pState->token; }
+
+protected:
+	template< class U >
+	friend Future< U > async( const boost::function< U () >&, const CancellationToken&, const ProgressCallback&, Executor& );
+
+	explicit Future( const boost::shared_ptr< Detail::AsyncState< T > >& pState )
+		: m_pState( pState )
+	{}
+
+	boost::shared_ptr< Detail::AsyncState< T > > m_pState;
+};
+
+/**
+ * runs a function on an executor
+ * @param f the operation
+ * @param token cancels the operation, also cancelled by \c Future::cancel
+ * @param progress receives the iterations of the algorithms called by \c f
+ * @param executor the executor running the operation
+ */
+template< class T >
+Future< T > async( const boost::function< T () >& f, const CancellationToken& token = CancellationToken()
+	, const ProgressCallback& progress = ProgressCallback(), Executor& executor = Executor::instance() )
+{
+	boost::shared_ptr< Detail::AsyncState< T > > pState( new Detail::AsyncState< T >( executor, token ) );
+	pState->group.run( boost::bind( &Detail::AsyncState< T >::run, pState, f, ProgressContext( token, progress ) ) );
+	return Future< T >( pState );
+}
+
+} } // namespace Ubitrack::Util
+
+#endif
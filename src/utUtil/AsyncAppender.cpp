@@ -0,0 +1,201 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Asynchronous log4cpp appender
+ */
+
+#include "AsyncAppender.h"
+
+#include <boost/bind.hpp>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4290 )
+#endif
+
+#include <log4cpp/LoggingEvent.hh>
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+namespace Ubitrack { namespace Util {
+
+AsyncAppender::AsyncAppender( const std::string& name, log4cpp::Appender& target,
+	std::size_t queueSize, OverflowPolicy policy )
+	: log4cpp::AppenderSkeleton( name )
+	, m_target( target )
+	, m_policy( policy )
+	, m_queue( queueSize )
+	, m_queued( 0 )
+	, m_written( 0 )
+	, m_dropped( 0 )
+	, m_idle( false )
+	, m_stop( false )
+{
+	m_thread.reset( new boost::thread( boost::bind( &AsyncAppender::run, this ) ) );
+}
+
+
+AsyncAppender::~AsyncAppender()
+{
+	close();
+}
+
+
+void AsyncAppender::close()
+{
+	if ( !m_thread )
+		return;
+
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_stop.store( true );
+		m_wakeup.notify_one();
+	}
+	m_thread->join();
+	m_thread.reset();
+
+	// events queued while the writer was shutting down
+	while ( log4cpp::LoggingEvent* event = pop() )
+		write( event );
+}
+
+
+bool AsyncAppender::reopen()
+{
+	return m_target.reopen();
+}
+
+
+void AsyncAppender::setLayout( log4cpp::Layout* )
+{
+}
+
+
+void AsyncAppender::flush()
+{
+	const boost::uint64_t queued = m_queued.load();
+	while ( m_written.load() < queued && !m_stop.load() )
+	{
+		{
+			boost::mutex::scoped_lock lock( m_mutex );
+			m_wakeup.notify_one();
+		}
+		boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+	}
+}
+
+
+void AsyncAppender::_append( const log4cpp::LoggingEvent& event )
+{
+	if ( m_stop.load( boost::memory_order_relaxed ) )
+	{
+		// no writer thread anymore
+		m_target.doAppend( event );
+		return;
+	}
+
+	log4cpp::LoggingEvent* copy = new log4cpp::LoggingEvent( event );
+	while ( !m_queue.push( copy ) )
+	{
+		if ( m_policy == DropWhenFull )
+		{
+			m_dropped.fetch_add( 1, boost::memory_order_relaxed );
+			delete copy;
+			return;
+		}
+		if ( m_stop.load() )
+		{
+			write( copy );
+			return;
+		}
+		boost::this_thread::yield();
+	}
+	m_queued.fetch_add( 1 );
+
+	// wake up the writer if it is waiting, pairs with the fence in run
+	boost::atomic_thread_fence( boost::memory_order_seq_cst );
+	if ( m_idle.load( boost::memory_order_relaxed ) )
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_wakeup.notify_one();
+	}
+}
+
+
+log4cpp::LoggingEvent* AsyncAppender::pop()
+{
+	log4cpp::LoggingEvent* event = 0;
+	m_queue.pop( event );
+	return event;
+}
+
+
+void AsyncAppender::write( log4cpp::LoggingEvent* event )
+{
+	try
+	{
+		m_target.doAppend( *event );
+	}
+	catch ( ... )
+	{
+		// there is nobody to report to
+	}
+	delete event;
+	m_written.fetch_add( 1 );
+}
+
+
+void AsyncAppender::run()
+{
+	for ( ;; )
+	{
+		while ( log4cpp::LoggingEvent* event = pop() )
+			write( event );
+
+		if ( m_stop.load() )
+			return;
+
+		m_idle.store( true, boost::memory_order_relaxed );
+		boost::atomic_thread_fence( boost::memory_order_seq_cst );
+
+		if ( !m_queue.empty() )
+		{
+			m_idle.store( false, boost::memory_order_relaxed );
+			continue;
+		}
+
+		{
+			boost::mutex::scoped_lock lock( m_mutex );
+			// the timeout only guards against missed notifications
+			if ( !m_stop.load() )
+				m_wakeup.timed_wait( lock, boost::posix_time::milliseconds( 100 ) );
+		}
+		m_idle.store( false, boost::memory_order_relaxed );
+	}
+}
+
+} } // namespace Ubitrack::Util
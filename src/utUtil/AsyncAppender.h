@@ -0,0 +1,173 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Asynchronous log4cpp appender
+ *
+ * An \c AsyncAppender moves the layout formatting and the I/O of another appender to a
+ * background thread. The logging thread only copies the event, whose message has already
+ * been formatted by the \c LOG4CPP_* macro, into a bounded lock-free queue:
+ * @code
+ * log4cpp::Appender* file = new log4cpp::FileAppender( "file", "ubitrack.log" );
+ * Util::AsyncAppender* async = new Util::AsyncAppender( "file.async", *file );
+ * log4cpp::Category::getRoot().addAppender( async );
+ * @endcode
+ *
+ * When the queue is full, new events are either dropped and counted or the logging thread
+ * waits for the writer, depending on the \c OverflowPolicy. After \c close, events are passed
+ * to the target synchronously.
+ *
+ * \c initLogging installs asynchronous appenders when the configuration file contains
+ * \c ubitrack.async=true, see Logging.h.
+ */
+
+#ifndef __UBITRACK_UTIL_ASYNCAPPENDER_H_INCLUDED__
+#define __UBITRACK_UTIL_ASYNCAPPENDER_H_INCLUDED__
+
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4290 )
+#endif
+
+#include <log4cpp/AppenderSkeleton.hh>
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+#include <utCore.h>
+#include <utUtil/MpscQueue.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Appender that passes the events to a target appender on a background thread.
+ *
+ * The queue is a \c MpscQueue of event copies, so logging threads neither lock nor wait for
+ * each other. The target is not owned and must outlive the
+ * \c AsyncAppender. Only the writer thread calls it until \c close.
+ */
+class UBITRACK_EXPORT AsyncAppender
+	: public log4cpp::AppenderSkeleton
+	, private boost::noncopyable
+{
+public:
+	/** what happens to an event when the queue is full */
+	enum OverflowPolicy
+	{
+		/** the event is dropped and counted, the logging thread never waits */
+		DropWhenFull,
+		/** the logging thread waits until the writer has made room */
+		BlockWhenFull
+	};
+
+	/**
+	 * starts the writer thread
+	 * @param name name of this appender
+	 * @param target appender that writes the events
+	 * @param queueSize number of events that can be queued, rounded up to a power of two
+	 * @param policy what to do when the queue is full
+	 */
+	AsyncAppender( const std::string& name, log4cpp::Appender& target,
+		std::size_t queueSize = 8192, OverflowPolicy policy = DropWhenFull );
+
+	/** writes the queued events and stops the writer thread */
+	virtual ~AsyncAppender();
+
+	/** writes the queued events and stops the writer thread. The target is not closed. */
+	virtual void close();
+
+	/** reopens the target */
+	virtual bool reopen();
+
+	/** the target does the formatting */
+	virtual bool requiresLayout() const
+	{ return false; }
+
+	/** the layout is ignored, set it on the target instead */
+	virtual void setLayout( log4cpp::Layout* layout );
+
+	/** waits until all events queued before the call have been written */
+	void flush();
+
+	/** number of events dropped because the queue was full */
+	boost::uint64_t droppedCount() const
+	{ return m_dropped.load( boost::memory_order_relaxed ); }
+
+	/** number of events the queue can hold */
+	std::size_t capacity() const
+	{ return m_queue.capacity(); }
+
+	/** behaviour when the queue is full */
+	OverflowPolicy policy() const
+	{ return m_policy; }
+
+	/** the appender that writes the events */
+	log4cpp::Appender& target()
+	{ return m_target; }
+
+protected:
+	/** queues a copy of the event */
+	virtual void _append( const log4cpp::LoggingEvent& event );
+
+	/** takes the next event from the queue, 0 if it is empty */
+	log4cpp::LoggingEvent* pop();
+
+	/** writes an event to the target and deletes it */
+	void write( log4cpp::LoggingEvent* event );
+
+	/** main loop of the writer thread */
+	void run();
+
+	log4cpp::Appender& m_target;
+	OverflowPolicy m_policy;
+
+	/// popped by the writer thread, and by \c close after it has stopped
+	MpscQueue< log4cpp::LoggingEvent* > m_queue;
+
+	boost::atomic< boost::uint64_t > m_queued;
+	boost::atomic< boost::uint64_t > m_written;
+	boost::atomic< boost::uint64_t > m_dropped;
+
+	/// set while the writer thread waits for events, producers only lock to wake it up then
+	boost::atomic< bool > m_idle;
+	boost::atomic< bool > m_stop;
+	boost::mutex m_mutex;
+	boost::condition_variable m_wakeup;
+	boost::scoped_ptr< boost::thread > m_thread;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
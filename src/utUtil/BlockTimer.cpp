@@ -33,12 +33,15 @@
 #include <iomanip>
 
 #include "BlockTimer.h"
+#include "FlightRecorder.h"
 
 namespace Ubitrack { namespace Util { 
 
 
 BlockTimer::~BlockTimer()
 {
+	TimerRegistry::instance().remove( this );
+
 	if ( m_pLogger && m_nRuns ) 
 	{ 
 		std::ostringstream s;
@@ -48,6 +51,68 @@ BlockTimer::~BlockTimer()
 }
 
 
+void BlockTimer::initCounters()
+{
+	for ( unsigned i = 0; i < PerfCounterValues::nEvents; i++ )
+		m_counters[ i ].store( 0, boost::memory_order_relaxed );
+	TimerRegistry::instance().add( this );
+}
+
+
+void BlockTimer::addCounters( const PerfCounterValues& start, const PerfCounterValues& stop )
+{
+	const unsigned valid = start.valid & stop.valid;
+	const std::size_t nRuns = m_nCounterRuns.load( boost::memory_order_relaxed );
+	m_counterEvents.store( nRuns ? m_counterEvents.load( boost::memory_order_relaxed ) & valid : valid, boost::memory_order_relaxed );
+	for ( unsigned i = 0; i < PerfCounterValues::nEvents; i++ )
+		if ( valid & ( 1u << i ) )
+			m_counters[ i ].store( m_counters[ i ].load( boost::memory_order_relaxed ) + stop.counts[ i ] - start.counts[ i ], boost::memory_order_relaxed );
+	m_nCounterRuns.store( nRuns + 1, boost::memory_order_relaxed );
+}
+
+
+PerfCounterValues BlockTimer::getCounters() const
+{
+	PerfCounterValues values;
+	values.valid = m_counterEvents.load( boost::memory_order_relaxed );
+	for ( unsigned i = 0; i < PerfCounterValues::nEvents; i++ )
+		if ( values.valid & ( 1u << i ) )
+			values.counts[ i ] = m_counters[ i ].load( boost::memory_order_relaxed );
+	return values;
+}
+
+
+void BlockTimer::setDumpThreshold( double ms )
+{
+	m_dumpThreshold.store( ms > 0 ? static_cast< unsigned long long >( ms * getHighPerformanceFrequency() / 1000 ) : ~0ULL,
+		boost::memory_order_relaxed );
+}
+
+
+double BlockTimer::getDumpThreshold() const
+{
+	const unsigned long long threshold = m_dumpThreshold.load( boost::memory_order_relaxed );
+	return threshold == ~0ULL ? 0.0 : threshold / getHighPerformanceFrequency() * 1000;
+}
+
+
+void BlockTimer::thresholdExceeded( unsigned long long ticks )
+{
+	const double ms = ticks / getHighPerformanceFrequency() * 1000;
+	const long long end = getMonotonicTime();
+	FlightRecorder::recordAt( end - static_cast< long long >( ms * 1e6 ), 'B', "block_timer", 0,
+		FlightValue(), FlightValue(), FlightValue(), m_sName.c_str() );
+	FlightRecorder::recordAt( end, 'E', "block_timer", "ms", ms, FlightValue(), FlightValue(), m_sName.c_str() );
+
+	std::ostringstream reason;
+	reason << "block timer " << m_sName << " took " << ms << "ms";
+	const std::string sPath( FlightRecorder::trigger( reason.str() ) );
+	if ( m_pLogger && !sPath.empty() )
+		m_pLogger->log( log4cpp::Priority::warn, reason.str() + ", flight recorder dump written to " + sPath,
+			m_sCodeFile.c_str(), m_nCodeLine );
+}
+
+
 void BlockTimer::initializeStart( const char* sCodeFile, unsigned nCodeLine )
 { 
 	m_sCodeFile = sCodeFile; 
@@ -57,7 +122,7 @@ void BlockTimer::initializeStart( const char* sCodeFile, unsigned nCodeLine )
 
 void BlockTimer::initializeEnd()
 {
-	m_bInitialized = true;
+	m_bInitialized.store( true, boost::memory_order_release );
 	/// @todo add automatic hierarchy detection
 }
 
@@ -73,7 +138,11 @@ std::ostream& operator<<( std::ostream& s, const BlockTimer& t )
 		<< ", avg: " << std::setw( 7 ) << t.getAvgTime() << "ms"
 		<< ", totalRuntime: " << std::setw( 7 ) << totalRunTime << "ms"
 		<< ", call per second: " << std::setw( 7 ) <<  t.getRuns() / (totalRunTime/1000.0);
-		
+
+	const PerfCounterValues counters( t.getCounters() );
+	if ( counters.has( PerfCounterValues::Instructions ) && counters.has( PerfCounterValues::Cycles ) && counters.counts[ PerfCounterValues::Cycles ] )
+		s << ", ipc: " << std::setw( 5 ) << double( counters.counts[ PerfCounterValues::Instructions ] ) / counters.counts[ PerfCounterValues::Cycles ];
+	return s;
 }
 
 } } // namespace Ubitrack::Util
@@ -35,8 +35,12 @@
 #include <iostream>
 #include <log4cpp/Category.hh>
 #include <boost/utility.hpp>
+#include <boost/atomic.hpp>
 #include <utCore.h>
 #include <utUtil/OS.h>
+#include <utUtil/TimerRegistry.h>
+#include <utUtil/SamplingProfiler.h>
+#include <utUtil/PerfCounters.h>
 
 namespace Ubitrack { namespace Util {
 
@@ -53,6 +57,15 @@ UBITRACK_EXPORT std::ostream& operator<<( std::ostream& s, const BlockTimer& t )
  *
  * The timer is started by instantiating a \c Time object and stopped when it leaves scope. 
  * The result of multiple runs is summed up. The BlockTimer result can be directly printed to an ostream.
+ * A BlockTimer must only be used by one thread, see \c HistogramBlockTimer for timing concurrent code.
+ * All timers join the \c TimerRegistry, which can read their statistics at any time.
+ *
+ * With \c enableCounters, each run also reads the hardware performance counters of the thread
+ * (see \c PerfCounters) before and after the block, so the registry can report the cycles,
+ * instructions per cycle, cache and branch misses per run. This costs two system calls per run.
+ *
+ * With \c setDumpThreshold, a run that takes longer than the threshold is recorded in the
+ * \c FlightRecorder and triggers a dump of the recent events of all threads.
  */
 class UBITRACK_EXPORT BlockTimer
 {
@@ -69,6 +82,8 @@ public:
 		 */
 		Time( BlockTimer& rTimer )
 			: m_rTimer( rTimer )
+			, m_bProfiled( SamplingProfiler::push( rTimer.getName().c_str() ) )
+			, m_bCounters( rTimer.countersEnabled() && PerfCounters::read( m_startCounters ) )
 			, m_startTime( getHighPerformanceCounter() )
 		{}
 		
@@ -81,6 +96,8 @@ public:
 		 */
 		Time( BlockTimer& rTimer, const char* sCodeFile, unsigned nCodeLine )
 			: m_rTimer( rTimer )
+			, m_bProfiled( SamplingProfiler::push( rTimer.getName().c_str() ) )
+			, m_bCounters( rTimer.countersEnabled() && PerfCounters::read( m_startCounters ) )
 			, m_startTime( getHighPerformanceCounter() )
 		{
 			if ( !m_rTimer.initialized() )
@@ -92,14 +109,32 @@ public:
 		 */
 		~Time()
 		{ 
-			m_rTimer.addMeasurement( getHighPerformanceCounter() - m_startTime ); 
+			const unsigned long long ticks = getHighPerformanceCounter() - m_startTime;
+			m_rTimer.addMeasurement( ticks ); 
+			if ( ticks > m_rTimer.m_dumpThreshold.load( boost::memory_order_relaxed ) )
+				m_rTimer.thresholdExceeded( ticks );
+
+			if ( m_bCounters )
+			{
+				PerfCounterValues stopCounters;
+				PerfCounters::read( stopCounters );
+				m_rTimer.addCounters( m_startCounters, stopCounters );
+			}
 			
 			if ( !m_rTimer.initialized() )
 				m_rTimer.initializeEnd();
+
+			if ( m_bProfiled )
+				SamplingProfiler::pop();
 		}
 
 	protected:
 		BlockTimer& m_rTimer;
+		/// the name of the timer is on the stack of the sampling profiler
+		const bool m_bProfiled;
+		/// hardware counters at the start, declared before m_bCounters which reads them
+		PerfCounterValues m_startCounters;
+		const bool m_bCounters;
 		unsigned long long m_startTime;
 	};
 
@@ -111,11 +146,16 @@ public:
 	BlockTimer( const std::string& sName, const std::string& sLoggingCategory = std::string() )
 		: m_sName( sName )
 		, m_pLogger( sLoggingCategory.empty() ? 0 : &log4cpp::Category::getInstance( sLoggingCategory ) )
+		, m_nCodeLine( 0 )
 		, m_bInitialized( false )
 		, m_nRuns( 0 )
 		, m_nTicks( 0 )
+		, m_bCounters( false )
+		, m_counterEvents( 0 )
+		, m_nCounterRuns( 0 )
+		, m_dumpThreshold( ~0ULL )
 		, m_startTime( getHighPerformanceCounter() )
-	{}
+	{ initCounters(); }
 
 	/** 
 	 * constructs and empty block timer object
@@ -125,33 +165,78 @@ public:
 	BlockTimer( const std::string& sName, log4cpp::Category& logger )
 		: m_sName( sName )
 		, m_pLogger( &logger )
+		, m_nCodeLine( 0 )
 		, m_bInitialized( false )
 		, m_nRuns( 0 )
 		, m_nTicks( 0 )
+		, m_bCounters( false )
+		, m_counterEvents( 0 )
+		, m_nCounterRuns( 0 )
+		, m_dumpThreshold( ~0ULL )
 		, m_startTime( getHighPerformanceCounter() )
-	{}
+	{ initCounters(); }
 
 	/** destructor, prints result if a stream was given to the constructor */
 	~BlockTimer();
 	
-	/** adds a timer run to the internal state */
+	/**
+	 * adds a timer run to the internal state.
+	 * There is only one writer, the atomics just allow the registry to read concurrently.
+	 */
 	void addMeasurement( unsigned long long ticks )
-	{ m_nRuns++; m_nTicks += ticks; }
+	{
+		m_nRuns.store( m_nRuns.load( boost::memory_order_relaxed ) + 1, boost::memory_order_relaxed );
+		m_nTicks.store( m_nTicks.load( boost::memory_order_relaxed ) + ticks, boost::memory_order_relaxed );
+	}
 	
+	/**
+	 * adds the hardware counters of a run. Only events that were read at the start and
+	 * at the end of the run are counted.
+	 */
+	void addCounters( const PerfCounterValues& start, const PerfCounterValues& stop );
+
+	/** enables or disables reading the hardware counters in each run */
+	void enableCounters( bool bEnable = true )
+	{ m_bCounters.store( bEnable, boost::memory_order_relaxed ); }
+
+	/** are the hardware counters read in each run? */
+	bool countersEnabled() const
+	{ return m_bCounters.load( boost::memory_order_relaxed ); }
+
+	/**
+	 * returns the sums of the hardware counters over all runs with counters. Events that
+	 * were not available in all of these runs are not valid.
+	 */
+	PerfCounterValues getCounters() const;
+
+	/** returns the number of runs that read the hardware counters */
+	std::size_t getCounterRuns() const
+	{ return m_nCounterRuns.load( boost::memory_order_relaxed ); }
+
+	/**
+	 * Sets the duration of a run above which the \c FlightRecorder writes a dump, see
+	 * \c FlightRecorder::trigger. A threshold of 0 disables the dumps, which is the default.
+	 * @param ms threshold in milliseconds
+	 */
+	void setDumpThreshold( double ms );
+
+	/** returns the dump threshold in milliseconds, 0 if disabled */
+	double getDumpThreshold() const;
+
 	const std::string& getName() const
 	{ return m_sName; }
 	
 	/** returns the total time in ms */
 	double getTotalTime() const
-	{ return m_nTicks / getHighPerformanceFrequency() * 1000; }
+	{ return m_nTicks.load( boost::memory_order_relaxed ) / getHighPerformanceFrequency() * 1000; }
 	
 	/** returns the average time in ms */
 	double getAvgTime() const
-	{ return m_nTicks / ( getHighPerformanceFrequency() * m_nRuns ) * 1000; }
+	{ return m_nTicks.load( boost::memory_order_relaxed ) / ( getHighPerformanceFrequency() * getRuns() ) * 1000; }
 	
 	/** returns the number of times the timer was run */
 	std::size_t getRuns() const
-	{ return m_nRuns; }
+	{ return m_nRuns.load( boost::memory_order_relaxed ); }
 	
 	/** returns the time when the timer was started */
 	unsigned long long getStartTime() const
@@ -159,7 +244,15 @@ public:
 	
 	/** Are the additional informations about the timer initialized? */
 	bool initialized() const
-	{ return m_bInitialized; }
+	{ return m_bInitialized.load( boost::memory_order_acquire ); }
+
+	/** code location of the timed block, only valid after initialization */
+	const std::string& getCodeFile() const
+	{ return m_sCodeFile; }
+
+	/** code location of the timed block, only valid after initialization */
+	unsigned getCodeLine() const
+	{ return m_nCodeLine; }
 	
 	/** Initialization at begin of first run. Sets the code location (for more useful output) */
 	void initializeStart( const char* sCodeFile, unsigned nCodeLine );
@@ -172,12 +265,28 @@ protected:
 	log4cpp::Category* m_pLogger;
 	std::string m_sCodeFile;
 	unsigned m_nCodeLine;
-	bool m_bInitialized;
+	boost::atomic< bool > m_bInitialized;
 	
 	
-	std::size_t m_nRuns;
-	unsigned long long m_nTicks;
+	boost::atomic< std::size_t > m_nRuns;
+	boost::atomic< unsigned long long > m_nTicks;
+
+	boost::atomic< bool > m_bCounters;
+	/// events counted in all runs with counters
+	boost::atomic< unsigned > m_counterEvents;
+	boost::atomic< std::size_t > m_nCounterRuns;
+	boost::atomic< unsigned long long > m_counters[ PerfCounterValues::nEvents ];
+
+	/// runs longer than this number of ticks trigger a flight recorder dump
+	boost::atomic< unsigned long long > m_dumpThreshold;
+
 	const unsigned long long m_startTime;
+
+private:
+	void initCounters();
+
+	/** records a run that exceeded the dump threshold and triggers the dump */
+	void thresholdExceeded( unsigned long long ticks );
 };
 
 
@@ -25,6 +25,13 @@
  * @file
  * Provides functions to read and write calibration files.
  *
+ * Text calibration files are read through the binary cache of \c CalibStore, if the
+ * environment variable \c UBITRACK_CALIB_CACHE names a snapshot file.
+ *
+ * Binary calibration files use the \c PortableBinaryOArchive, which can be read on all
+ * platforms. Binary files written with the boost binary archive by earlier versions are
+ * still read.
+ *
  * @author Daniel Pustka <daniel.pustka@in.tum.de>
  */
  
@@ -33,6 +40,8 @@
 
 #include <utMeasurement/Measurement.h> //includes already SharedPtr
 #include <utUtil/Exception.h>
+#include <utUtil/CalibStore.h>
+#include <utUtil/PortableBinaryArchive.h>
 
 #include <string>
 #include <fstream>
@@ -41,11 +50,10 @@
 #include <boost/archive/text_oarchive.hpp>
 
 #include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
 
 // get a logger
-#include <log4cpp/Category.hh>
-static log4cpp::Category& calibLogger( log4cpp::Category::getInstance( "Ubitrack.Utils.CalibFile" ) );
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger calibLogger( "Ubitrack.Utils.CalibFile" );
 
 namespace Ubitrack { namespace Util {
 
@@ -58,6 +66,11 @@ namespace Ubitrack { namespace Util {
 template< typename T >
 void readCalibFile( const std::string& sFile, T& result )
 {
+	// use the binary copy, if the file has not changed since it was cached
+	CalibStore* store = CalibStore::global();
+	if ( store && store->load( sFile, result ) )
+		return;
+
 	// create ifstream
 	std::ifstream stream( sFile.c_str() );
 	if ( !stream.good() )
@@ -71,6 +84,9 @@ void readCalibFile( const std::string& sFile, T& result )
     } catch (std::exception& ) {
         UBITRACK_THROW( "Could not read ubitrack file" );
     }
+
+	if ( store )
+		store->insert( sFile, result );
 }
 
 /**
@@ -87,10 +103,15 @@ void readBinaryCalibFile(const std::string& sFile, T& result)
 		UBITRACK_THROW("Could not open file " + sFile + " for reading");
 
 	try {
-		// create iarchive
-		boost::archive::binary_iarchive archive(stream);
-		// read data
-		archive >> result;
+		if (PortableBinaryIArchive::hasHeader(stream)) {
+			PortableBinaryIArchive archive(stream);
+			archive >> result;
+		}
+		else {
+			// file of an earlier version, only readable on the platform that wrote it
+			boost::archive::binary_iarchive archive(stream);
+			archive >> result;
+		}
 	}
 	catch (std::exception& e) {
 		std::string tmp = e.what();
@@ -110,6 +131,11 @@ void readCalibFile( const std::string& sFile, Measurement::Measurement< T >& res
 	// initialize measurement
 	result = Measurement::Measurement< T >( 0, boost::shared_ptr< T >( new T() ) );
 
+	// use the binary copy, if the file has not changed since it was cached
+	CalibStore* store = CalibStore::global();
+	if ( store && store->load( sFile, result ) )
+		return;
+
 	// create ifstream
 	std::ifstream stream( sFile.c_str() );
 	if ( !stream.good() )
@@ -124,6 +150,9 @@ void readCalibFile( const std::string& sFile, Measurement::Measurement< T >& res
     } catch (std::exception& ) {
         UBITRACK_THROW( "Wrong file format" );
     }
+
+	if ( store )
+		store->insert( sFile, result );
 }
 
 /** 
@@ -178,6 +207,10 @@ void writeCalibFile( const std::string& sFile, const T& data )
 
 	// read data
 	archive << data;
+
+	// the cached copy is outdated, even if the modification time did not change
+	if ( CalibStore* store = CalibStore::global() )
+		store->invalidate( sFile );
 }
 
 /**
@@ -193,11 +226,13 @@ void writeBinaryCalibFile(const std::string& sFile, const T& data)
 	if (!stream.good())
 		UBITRACK_THROW("Could not open file " + sFile + " for writing");
 
-	// create iarchive
-	boost::archive::binary_oarchive archive(stream);
+	// create oarchive
+	PortableBinaryOArchive archive(stream);
 
-	// read data
+	// write data
 	archive << data;
+	if (!stream.flush())
+		UBITRACK_THROW("Could not write file " + sFile);
 }
 } } // namespace Ubitrack::Util
 
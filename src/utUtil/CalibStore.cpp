@@ -0,0 +1,339 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Binary cache of calibration files
+ */
+
+#include "CalibStore.h"
+#include "MappedFile.h"
+#include "Exception.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <boost/version.hpp>
+#include <boost/filesystem.hpp>
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Util.CalibStore" );
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+/*
+ * Snapshot layout, all numbers in native byte order:
+ *   "UTCALIB2", uint32 boost version, uint32 platform, uint32 number of entries
+ * followed by the entries:
+ *   uint32 length, file name, uint32 length, type name, int64 mtime, uint64 file size,
+ *   uint64 length, portable binary archive of the object without header
+ */
+const char g_magic[ 8 ] = { 'U', 'T', 'C', 'A', 'L', 'I', 'B', '2' };
+const boost::uint32_t g_platform = sizeof( void* ) * 256 + sizeof( long );
+
+/// sequential reader on the mapped snapshot
+class SnapshotReader
+{
+public:
+	SnapshotReader( const unsigned char* data, std::size_t size )
+		: m_pos( reinterpret_cast< const char* >( data ) )
+		, m_end( m_pos + size )
+	{}
+
+	template< typename T >
+	bool read( T& v )
+	{
+		if ( static_cast< std::size_t >( m_end - m_pos ) < sizeof( T ) )
+			return false;
+		std::memcpy( &v, m_pos, sizeof( T ) );
+		m_pos += sizeof( T );
+		return true;
+	}
+
+	/// returns the next n bytes, 0 if the snapshot is too short
+	const char* skip( const boost::uint64_t n )
+	{
+		if ( static_cast< boost::uint64_t >( m_end - m_pos ) < n )
+			return 0;
+		const char* p = m_pos;
+		m_pos += n;
+		return p;
+	}
+
+	bool readString( std::string& s )
+	{
+		boost::uint32_t n;
+		const char* p;
+		if ( !read( n ) || !( p = skip( n ) ) )
+			return false;
+		s.assign( p, n );
+		return true;
+	}
+
+protected:
+	const char* m_pos;
+	const char* m_end;
+};
+
+template< typename T >
+void writeValue( std::ostream& out, const T& v )
+{ out.write( reinterpret_cast< const char* >( &v ), sizeof( T ) ); }
+
+void writeString( std::ostream& out, const std::string& s )
+{
+	writeValue( out, static_cast< boost::uint32_t >( s.size() ) );
+	out.write( s.data(), s.size() );
+}
+
+boost::mutex g_globalMutex;
+boost::scoped_ptr< CalibStore > g_globalStore;
+bool g_globalInitialized = false;
+
+} // anonymous namespace
+
+
+CalibStore::CalibStore( const std::string& snapshotFile )
+	: m_snapshotFile( snapshotFile )
+	, m_modified( false )
+{
+	open();
+}
+
+
+CalibStore::~CalibStore()
+{
+	try
+	{
+		save();
+	}
+	catch ( std::exception& e )
+	{
+		LOG4CPP_WARN( logger, "Could not save calibration snapshot " << m_snapshotFile << ": " << e.what() );
+	}
+}
+
+
+CalibStore* CalibStore::global()
+{
+	boost::mutex::scoped_lock l( g_globalMutex );
+	if ( !g_globalInitialized )
+	{
+		g_globalInitialized = true;
+		const char* snapshot = std::getenv( "UBITRACK_CALIB_CACHE" );
+		if ( snapshot && *snapshot )
+			g_globalStore.reset( new CalibStore( snapshot ) );
+	}
+	return g_globalStore.get();
+}
+
+
+void CalibStore::enableGlobal( const std::string& snapshotFile )
+{
+	boost::mutex::scoped_lock l( g_globalMutex );
+	g_globalInitialized = true;
+	g_globalStore.reset();
+	g_globalStore.reset( new CalibStore( snapshotFile ) );
+}
+
+
+void CalibStore::disableGlobal()
+{
+	boost::mutex::scoped_lock l( g_globalMutex );
+	g_globalInitialized = true;
+	g_globalStore.reset();
+}
+
+
+void CalibStore::invalidate( const std::string& file )
+{
+	boost::mutex::scoped_lock l( m_mutex );
+	EntryMap::iterator it = m_entries.lower_bound( Key( file, std::string() ) );
+	while ( it != m_entries.end() && it->first.first == file )
+	{
+		m_entries.erase( it++ );
+		m_modified = true;
+	}
+}
+
+
+std::size_t CalibStore::size() const
+{
+	boost::mutex::scoped_lock l( m_mutex );
+	return m_entries.size();
+}
+
+
+bool CalibStore::find( const std::string& file, const char* type, std::string& bytes )
+{
+	Stamp s;
+	if ( !stamp( file, s ) )
+		return false;
+
+	boost::mutex::scoped_lock l( m_mutex );
+	EntryMap::const_iterator it = m_entries.find( Key( file, type ) );
+	if ( it == m_entries.end() || !( it->second.stamp == s ) )
+		return false;
+
+	if ( it->second.mapped )
+		bytes.assign( it->second.mapped, it->second.length );
+	else
+		bytes = it->second.owned;
+	return true;
+}
+
+
+void CalibStore::store( const std::string& file, const char* type, const std::string& bytes )
+{
+	Entry entry;
+	if ( !stamp( file, entry.stamp ) )
+		return;
+	entry.mapped = 0;
+	entry.length = bytes.size();
+	entry.owned = bytes;
+
+	boost::mutex::scoped_lock l( m_mutex );
+	m_entries[ Key( file, type ) ] = entry;
+	m_modified = true;
+}
+
+
+bool CalibStore::stamp( const std::string& file, Stamp& s )
+{
+	boost::system::error_code ec;
+	const std::time_t mtime = boost::filesystem::last_write_time( file, ec );
+	if ( ec )
+		return false;
+	const boost::uintmax_t size = boost::filesystem::file_size( file, ec );
+	if ( ec )
+		return false;
+
+	s.mtime = mtime;
+	s.size = size;
+	return true;
+}
+
+
+void CalibStore::open()
+{
+	m_entries.clear();
+	m_mapping.reset();
+
+	boost::system::error_code ec;
+	if ( !boost::filesystem::exists( m_snapshotFile, ec ) )
+		return;
+
+	try
+	{
+		m_mapping.reset( new MappedFile( m_snapshotFile ) );
+	}
+	catch ( const Util::Exception& e )
+	{
+		LOG4CPP_WARN( logger, e.what() );
+		return;
+	}
+	SnapshotReader reader( m_mapping->data(), m_mapping->size() );
+
+	const char* magic = reader.skip( sizeof( g_magic ) );
+	boost::uint32_t version, platform, count;
+	if ( !magic || std::memcmp( magic, g_magic, sizeof( g_magic ) ) || !reader.read( version ) || !reader.read( platform ) ||
+		version != BOOST_VERSION || platform != g_platform || !reader.read( count ) )
+	{
+		LOG4CPP_NOTICE( logger, "Ignoring calibration snapshot " << m_snapshotFile << " of another version" );
+		m_mapping.reset();
+		return;
+	}
+
+	for ( boost::uint32_t i = 0; i < count; i++ )
+	{
+		Key key;
+		Entry entry;
+		boost::uint64_t length;
+		if ( !reader.readString( key.first ) || !reader.readString( key.second ) || !reader.read( entry.stamp.mtime ) ||
+			!reader.read( entry.stamp.size ) || !reader.read( length ) || !( entry.mapped = reader.skip( length ) ) )
+		{
+			LOG4CPP_WARN( logger, "Calibration snapshot " << m_snapshotFile << " is truncated" );
+			// the complete entries are still valid, rewrite the file without the rest
+			m_modified = true;
+			break;
+		}
+		entry.length = static_cast< std::size_t >( length );
+		m_entries[ key ] = entry;
+	}
+
+	LOG4CPP_DEBUG( logger, "Opened calibration snapshot " << m_snapshotFile << " with " << m_entries.size() << " entries" );
+}
+
+
+void CalibStore::save()
+{
+	boost::mutex::scoped_lock l( m_mutex );
+	if ( !m_modified )
+		return;
+
+	// write a new file, as the mapping of the old one is still in use
+	const std::string tmpFile( m_snapshotFile + ".tmp" );
+	{
+		std::ofstream out( tmpFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		if ( !out.good() )
+			UBITRACK_THROW( "Could not open file " + tmpFile + " for writing" );
+
+		out.write( g_magic, sizeof( g_magic ) );
+		writeValue( out, static_cast< boost::uint32_t >( BOOST_VERSION ) );
+		writeValue( out, g_platform );
+		writeValue( out, static_cast< boost::uint32_t >( m_entries.size() ) );
+		for ( EntryMap::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it )
+		{
+			writeString( out, it->first.first );
+			writeString( out, it->first.second );
+			writeValue( out, it->second.stamp.mtime );
+			writeValue( out, it->second.stamp.size );
+			writeValue( out, static_cast< boost::uint64_t >( it->second.length ) );
+			out.write( it->second.mapped ? it->second.mapped : it->second.owned.data(), it->second.length );
+		}
+
+		if ( !out.good() )
+			UBITRACK_THROW( "Could not write file " + tmpFile );
+	}
+
+	// keep the entries if the snapshot cannot be replaced
+	for ( EntryMap::iterator it = m_entries.begin(); it != m_entries.end(); ++it )
+		if ( it->second.mapped )
+		{
+			it->second.owned.assign( it->second.mapped, it->second.length );
+			it->second.mapped = 0;
+		}
+	m_mapping.reset();
+
+	boost::system::error_code ec;
+	boost::filesystem::rename( tmpFile, m_snapshotFile, ec );
+	if ( ec )
+		UBITRACK_THROW( "Could not replace " + m_snapshotFile + ": " + ec.message() );
+
+	m_modified = false;
+	open();
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,192 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Binary cache of calibration files
+ *
+ * Reading a text calibration file runs the complete Boost.Serialization text parser,
+ * which dominates the start-up time of configurations with hundreds of calibration
+ * files. A \c CalibStore keeps a binary copy of every calibration object in a single
+ * memory-mapped snapshot file. Opening the snapshot only reads its index, every object
+ * is decoded from the mapping on first access.
+ *
+ * Entries are keyed by the file name and the type of the object and remember the
+ * modification time and size of the text file, so an edited calibration file is
+ * parsed again and its entry replaced. Changes are written back to the snapshot by
+ * \c save and on destruction.
+ *
+ * \c readCalibFile uses the global store, which is enabled by setting the environment
+ * variable \c UBITRACK_CALIB_CACHE to the name of the snapshot file or by calling
+ * \c CalibStore::enableGlobal. The objects are stored with the \c PortableBinaryOArchive,
+ * but the index of the snapshot is only valid for the boost version and platform that
+ * wrote it, otherwise the snapshot is ignored.
+ */
+
+#ifndef __UBITRACK_UTIL_CALIBSTORE_H_INCLUDED__
+#define __UBITRACK_UTIL_CALIBSTORE_H_INCLUDED__
+
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <typeinfo>
+
+#include <boost/utility.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <utCore.h>
+#include <utUtil/PortableBinaryArchive.h>
+
+namespace Ubitrack { namespace Util {
+
+class MappedFile;
+
+/**
+ * Memory-mapped binary snapshot of calibration objects. All methods are thread-safe.
+ */
+class UBITRACK_EXPORT CalibStore
+	: private boost::noncopyable
+{
+public:
+	/** opens the snapshot \c snapshotFile, a missing or invalid snapshot results in an empty store */
+	explicit CalibStore( const std::string& snapshotFile );
+
+	/** writes modified entries to the snapshot */
+	~CalibStore();
+
+	/** the global store used by \c readCalibFile, 0 if caching is disabled */
+	static CalibStore* global();
+
+	/** enables the global store with the given snapshot, replacing an existing one */
+	static void enableGlobal( const std::string& snapshotFile );
+
+	/** saves and disables the global store */
+	static void disableGlobal();
+
+	/**
+	 * retrieves the object read from \c file, if its entry is still up to date.
+	 * @return false if there is no entry, in which case \c result is unchanged
+	 */
+	template< typename T >
+	bool load( const std::string& file, T& result )
+	{
+		std::string bytes;
+		if ( !find( file, typeid( T ).name(), bytes ) )
+			return false;
+
+		try
+		{
+			Buffer buffer( bytes );
+			std::istream stream( &buffer );
+			PortableBinaryIArchive archive( stream, false );
+			archive >> result;
+		}
+		catch ( std::exception& )
+		{
+			// a damaged entry is treated as missing and replaced by the caller
+			return false;
+		}
+		return true;
+	}
+
+	/** stores the object read from \c file for the current version of \c file */
+	template< typename T >
+	void insert( const std::string& file, const T& data )
+	{
+		std::ostringstream stream( std::ios::out | std::ios::binary );
+		{
+			PortableBinaryOArchive archive( stream, false );
+			archive << data;
+		}
+		store( file, typeid( T ).name(), stream.str() );
+	}
+
+	/** removes all entries of \c file, e.g. after writing it */
+	void invalidate( const std::string& file );
+
+	/** writes the snapshot, if entries have changed since it was opened */
+	void save();
+
+	/** number of entries */
+	std::size_t size() const;
+
+protected:
+	/// @internal read-only stream buffer on a string, avoids another copy into a stringstream
+	struct Buffer
+		: public std::streambuf
+	{
+		explicit Buffer( const std::string& s )
+		{
+			char* p = const_cast< char* >( s.data() );
+			setg( p, p, p + s.size() );
+		}
+	};
+
+	/// @internal version of a calibration file
+	struct Stamp
+	{
+		boost::int64_t mtime;
+		boost::uint64_t size;
+
+		bool operator==( const Stamp& other ) const
+		{ return mtime == other.mtime && size == other.size; }
+	};
+
+	/// @internal an entry either points into the mapped snapshot or owns its data
+	struct Entry
+	{
+		Stamp stamp;
+		const char* mapped;
+		std::size_t length;
+		std::string owned;
+	};
+
+	/// (file name, type name)
+	typedef std::pair< std::string, std::string > Key;
+	typedef std::map< Key, Entry > EntryMap;
+
+	/// copies the data of an up-to-date entry, false if there is none
+	bool find( const std::string& file, const char* type, std::string& bytes );
+
+	/// adds or replaces the entry
+	void store( const std::string& file, const char* type, const std::string& bytes );
+
+	/// maps the snapshot and reads its index
+	void open();
+
+	/// current version of \c file, false if it does not exist
+	static bool stamp( const std::string& file, Stamp& s );
+
+	std::string m_snapshotFile;
+	boost::scoped_ptr< MappedFile > m_mapping;
+	EntryMap m_entries;
+	bool m_modified;
+	mutable boost::mutex m_mutex;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -295,4 +295,62 @@ void ETWUbitrackGpuDownload(unsigned int bytes) {
 	EventWriteVisionGpuDownload(bytes);
 };
 
+void ETWUbitrackLmIteration(unsigned int iteration, double residual, double lambda, int solver) {
+	if (!UBITRACK_Context.IsEnabled)
+	{
+		return;
+	}
+
+	EventWriteOptimizationLmIteration(iteration, residual, lambda, solver);
+};
+
+void ETWUbitrackRansac(unsigned int iterations, unsigned int inliers, unsigned int values) {
+	if (!UBITRACK_Context.IsEnabled)
+	{
+		return;
+	}
+
+	EventWriteOptimizationRansac(iterations, inliers, values);
+};
+
+void ETWUbitrackKalmanUpdate(unsigned long long int timestamp, _In_z_ PCSTR updateType, unsigned int dimension) {
+	if (!UBITRACK_Context.IsEnabled)
+	{
+		return;
+	}
+
+	EventWriteTrackingKalmanUpdate(timestamp, updateType, dimension);
+};
+
+void ETWUbitrackClusteringIteration(_In_z_ PCSTR algorithm, unsigned int iteration, unsigned int clusters, double value) {
+	if (!UBITRACK_Context.IsEnabled)
+	{
+		return;
+	}
+
+	EventWriteStochasticClusteringIteration(algorithm, iteration, clusters, value);
+};
+
+int64 ETWUbitrackSpanBegin(_In_z_ PCSTR name, unsigned long long int attr0, unsigned long long int attr1, unsigned long long int attr2) {
+	if (!UBITRACK_Context.IsEnabled)
+	{
+		return 0;
+	}
+
+	int64 nTime = GetQPCTime();
+	EventWriteSpanBegin(name, attr0, attr1, attr2);
+	return nTime;
+};
+
+int64 ETWUbitrackSpanEnd(_In_z_ PCSTR name, unsigned long long int attr0, unsigned long long int attr1, unsigned long long int attr2, int64 nStartTime) {
+	if (!UBITRACK_Context.IsEnabled)
+	{
+		return 0;
+	}
+
+	int64 nTime = GetQPCTime();
+	EventWriteSpanEnd(name, attr0, attr1, attr2, QPCToMS(nTime - nStartTime));
+	return nTime;
+};
+
 #endif // ETW_MARKS_ENABLED
\ No newline at end of file
@@ -82,6 +82,12 @@ UBITRACK_EXPORT void __cdecl ETWUbitrackAllocateCpu(unsigned int bytes);
 UBITRACK_EXPORT void __cdecl ETWUbitrackAllocateGpu(unsigned int bytes);
 UBITRACK_EXPORT void __cdecl ETWUbitrackGpuUpload(unsigned int bytes);
 UBITRACK_EXPORT void __cdecl ETWUbitrackGpuDownload(unsigned int bytes);
+UBITRACK_EXPORT void __cdecl ETWUbitrackLmIteration(unsigned int iteration, double residual, double lambda, int solver);
+UBITRACK_EXPORT void __cdecl ETWUbitrackRansac(unsigned int iterations, unsigned int inliers, unsigned int values);
+UBITRACK_EXPORT void __cdecl ETWUbitrackKalmanUpdate(unsigned long long int timestamp, _In_z_ PCSTR updateType, unsigned int dimension);
+UBITRACK_EXPORT void __cdecl ETWUbitrackClusteringIteration(_In_z_ PCSTR algorithm, unsigned int iteration, unsigned int clusters, double value);
+UBITRACK_EXPORT int64 __cdecl ETWUbitrackSpanBegin(_In_z_ PCSTR name, unsigned long long int attr0, unsigned long long int attr1, unsigned long long int attr2);
+UBITRACK_EXPORT int64 __cdecl ETWUbitrackSpanEnd(_In_z_ PCSTR name, unsigned long long int attr0, unsigned long long int attr1, unsigned long long int attr2, int64 startTime);
 
 #else // ETW_MARKS_ENABLED
 
@@ -96,6 +102,12 @@ UBITRACK_EXPORT void __cdecl ETWUbitrackAllocateCpu(unsigned int bytes) {};
 UBITRACK_EXPORT void __cdecl ETWUbitrackAllocateGpu(unsigned int bytes) {};
 UBITRACK_EXPORT void __cdecl ETWUbitrackGpuUpload(unsigned int bytes) {};
 UBITRACK_EXPORT void __cdecl ETWUbitrackGpuDownload(unsigned int bytes) {};
+UBITRACK_EXPORT void __cdecl ETWUbitrackLmIteration(unsigned int iteration, double residual, double lambda, int solver) {};
+UBITRACK_EXPORT void __cdecl ETWUbitrackRansac(unsigned int iterations, unsigned int inliers, unsigned int values) {};
+UBITRACK_EXPORT void __cdecl ETWUbitrackKalmanUpdate(unsigned long long int timestamp, _In_z_ PCSTR updateType, unsigned int dimension) {};
+UBITRACK_EXPORT void __cdecl ETWUbitrackClusteringIteration(_In_z_ PCSTR algorithm, unsigned int iteration, unsigned int clusters, double value) {};
+UBITRACK_EXPORT int64 __cdecl ETWUbitrackSpanBegin(_In_z_ PCSTR name, unsigned long long int attr0, unsigned long long int attr1, unsigned long long int attr2) { return 0; };
+UBITRACK_EXPORT int64 __cdecl ETWUbitrackSpanEnd(_In_z_ PCSTR name, unsigned long long int attr0, unsigned long long int attr1, unsigned long long int attr2, int64 startTime) { return 0; };
 
 
 #endif // ETW_MARKS_ENABLED
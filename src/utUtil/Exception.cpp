@@ -33,8 +33,9 @@
 // std
 #include <iostream>
 
-#include <log4cpp/Category.hh>
-static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Util.Exception" ) );
+#include <utUtil/LazyLogger.h>
+#include <utUtil/FlightRecorder.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Util.Exception" );
 
 namespace Ubitrack { namespace Util {
 
@@ -45,6 +46,7 @@ Exception::Exception( const std::string& sMessage, unsigned nLine, const char* s
 	, m_sFile( sFile ? sFile : "" )
 {
 	LOG4CPP_DEBUG( logger, "Exception thrown in " << sFile << ":" << nLine << ", message: " << sMessage );
+	FlightRecorder::exceptionThrown( sMessage.c_str(), sFile, nLine );
 }
 
 /* bug fix/workaround for a problem with VS2005 which has problems when the exception class is
@@ -54,6 +56,18 @@ Exception::~Exception() throw()
 {}
 
 
+void throwException( const char* sMessage, unsigned nLine, const char* sFile )
+{
+	throw Exception( sMessage, nLine, sFile );
+}
+
+
+void throwException( const std::string& sMessage, unsigned nLine, const char* sFile )
+{
+	throw Exception( sMessage, nLine, sFile );
+}
+
+
 std::ostream& operator<<( std::ostream& o, const Exception& e )
 {
 	LOG4CPP_TRACE( logger, "Exception \"" << e.what() << "\" from " << e.file() << ":" << e.line() );
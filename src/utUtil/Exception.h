@@ -78,6 +78,16 @@ protected:
 UBITRACK_EXPORT std::ostream& operator<<( std::ostream& o, const Exception& e );
 
 
+/**
+ * Throws a \c Util::Exception. The message string and the exception are only built in this
+ * cold function, so throw sites add a single call to the code of their callers.
+ */
+UBITRACK_EXPORT UBITRACK_NORETURN UBITRACK_COLD void throwException( const char* sMessage, unsigned nLine, const char* sFile );
+
+/** Throws a \c Util::Exception with a message that has been built by the caller */
+UBITRACK_EXPORT UBITRACK_NORETURN UBITRACK_COLD void throwException( const std::string& sMessage, unsigned nLine, const char* sFile );
+
+
 } } // namespace Ubitrack::Util
 
 
@@ -85,6 +95,6 @@ UBITRACK_EXPORT std::ostream& operator<<( std::ostream& o, const Exception& e );
  * Macro to throw an exception.
  * File and line number will we generated automatically.
  */
-#define UBITRACK_THROW( message ) throw Ubitrack::Util::Exception( message, __LINE__, __FILE__ )
+#define UBITRACK_THROW( message ) Ubitrack::Util::throwException( message, __LINE__, __FILE__ )
 
 #endif
@@ -0,0 +1,496 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup util
+ * @file
+ * Work-stealing executor
+ */
+
+#include "Executor.h"
+#include "Exception.h"
+#include "OS.h"
+#include "Progress.h"
+
+#include <deque>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+struct QueuedTask
+{
+	TaskGroup* group;
+	Executor::Task task;
+
+	/// only executed by workers of the node of its deque, see TaskGroup::runOnNode
+	bool pinned;
+};
+
+/// @internal deque of one worker, or of the tasks submitted by other threads
+struct TaskQueue
+{
+	boost::mutex mutex;
+	std::deque< QueuedTask > tasks;
+};
+
+/// @internal splits a range in halves, queues the upper ones and runs the remaining lower part
+void splitRange( TaskGroup* group, const Executor::RangeFunction* f, std::size_t begin, std::size_t end, const std::size_t grain )
+{
+	while ( end - begin > grain )
+	{
+		if ( group->cancelled() )
+			return;
+		const std::size_t middle = begin + ( end - begin ) / 2;
+		group->run( boost::bind( &splitRange, group, f, middle, end, grain ) );
+		end = middle;
+	}
+	( *f )( begin, end );
+}
+
+/// settings of the process executor
+struct InstanceSettings
+{
+	InstanceSettings()
+		: pInstance( 0 )
+		, concurrency( 0 )
+	{}
+
+	boost::mutex mutex;
+	Executor* pInstance;
+	unsigned concurrency;
+	std::vector< unsigned > affinity;
+};
+
+InstanceSettings& instanceSettings()
+{
+	// never destroyed, so tasks may still run during the static destruction
+	static InstanceSettings* pSettings = new InstanceSettings;
+	return *pSettings;
+}
+
+} // anonymous namespace
+
+
+/// @internal
+struct Executor::Impl
+{
+	Impl( const unsigned nWorkers )
+		: queues( nWorkers + 1 )
+		, nodes( nWorkers + 1, 0 )
+		, queued( 0 )
+		, nextWorker( 0 )
+		, stop( false )
+	{}
+
+	/** index of the queue of the calling thread: its deque for workers, the shared queue otherwise */
+	std::size_t ownQueue() const;
+
+	/** takes a task from the own deque, the shared queue, or steals one from another worker */
+	bool pop( QueuedTask& task );
+
+	/** takes the oldest task of a queue, returns false if it is empty or the task is pinned to another node */
+	bool steal( std::size_t victim, bool bSameNode, QueuedTask& task );
+
+	/** index of the queue of a worker on the node, or the own queue if the node has no workers */
+	std::size_t nodeQueue( unsigned node );
+
+	/** body of worker \c index */
+	void work( std::size_t index, int cpu );
+
+	/// one deque per worker, the last one takes the tasks of other threads
+	std::vector< TaskQueue > queues;
+
+	/// NUMA node of the worker of each queue
+	std::vector< unsigned > nodes;
+
+	/// the workers of each node
+	std::vector< std::vector< std::size_t > > nodeWorkers;
+
+	boost::atomic< std::size_t > queued;
+
+	/// round robin over the workers of a node for pinned tasks
+	boost::atomic< std::size_t > nextWorker;
+
+	boost::mutex sleepMutex;
+	boost::condition_variable wakeUp;
+	bool stop;
+
+	boost::thread_group threads;
+};
+
+
+// the executor and index of the worker running on the calling thread
+#if defined( _MSC_VER )
+__declspec( thread ) const void* t_executor = 0;
+__declspec( thread ) std::size_t t_worker = 0;
+#else
+__thread const void* t_executor = 0;
+__thread std::size_t t_worker = 0;
+#endif
+
+
+std::size_t Executor::Impl::ownQueue() const
+{
+	return t_executor == this ? t_worker : queues.size() - 1;
+}
+
+
+bool Executor::Impl::pop( QueuedTask& task )
+{
+	if ( !queued.load( boost::memory_order_acquire ) )
+		return false;
+
+	// newest own task first, it works on data that is still in the cache
+	const std::size_t shared = queues.size() - 1;
+	const std::size_t own = ownQueue();
+	if ( own != shared )
+	{
+		boost::mutex::scoped_lock l( queues[ own ].mutex );
+		if ( !queues[ own ].tasks.empty() )
+		{
+			task = queues[ own ].tasks.back();
+			queues[ own ].tasks.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	// then the oldest, i.e. largest, tasks of the others, first those on the same NUMA node,
+	// whose data is in the local memory. Threads that are not workers have no node.
+	const bool bRemote = nodeWorkers.size() > 1 && own != shared;
+	for ( int pass = 0; pass < ( bRemote ? 2 : 1 ); pass++ )
+		for ( std::size_t i = 0; i < queues.size(); i++ )
+		{
+			const std::size_t victim = ( shared + own + i ) % queues.size();
+			if ( victim == own && own != shared )
+				continue;
+			const bool bSameNode = !bRemote || victim == shared || nodes[ victim ] == nodes[ own ];
+			if ( bSameNode == ( pass == 0 ) && steal( victim, bSameNode && own != shared, task ) )
+				return true;
+		}
+	return false;
+}
+
+
+bool Executor::Impl::steal( const std::size_t victim, const bool bSameNode, QueuedTask& task )
+{
+	boost::mutex::scoped_lock l( queues[ victim ].mutex );
+	if ( queues[ victim ].tasks.empty() || ( queues[ victim ].tasks.front().pinned && !bSameNode ) )
+		return false;
+	task = queues[ victim ].tasks.front();
+	queues[ victim ].tasks.pop_front();
+	queued--;
+	return true;
+}
+
+
+std::size_t Executor::Impl::nodeQueue( const unsigned node )
+{
+	const std::size_t own = ownQueue();
+	if ( node >= nodeWorkers.size() || nodeWorkers[ node ].empty() || ( own != queues.size() - 1 && nodes[ own ] == node ) )
+		return own;
+	return nodeWorkers[ node ][ nextWorker++ % nodeWorkers[ node ].size() ];
+}
+
+
+void Executor::Impl::work( const std::size_t index, const int cpu )
+{
+	if ( cpu >= 0 )
+		setThreadAffinity( static_cast< unsigned >( cpu ) );
+	t_executor = this;
+	t_worker = index;
+
+	QueuedTask task;
+	while ( true )
+	{
+		if ( pop( task ) )
+		{
+			task.group->execute( task.task );
+			task.task.clear();
+			continue;
+		}
+
+		// the queued tasks are pinned to other nodes or are being taken by other workers
+		if ( queued.load( boost::memory_order_acquire ) )
+		{
+			boost::this_thread::yield();
+			continue;
+		}
+
+		boost::mutex::scoped_lock l( sleepMutex );
+		while ( !stop && !queued )
+			wakeUp.wait( l );
+		if ( stop && !queued )
+			return;
+	}
+}
+
+
+Executor::Executor( unsigned concurrency, const std::vector< unsigned >& affinity )
+{
+	if ( !concurrency )
+		concurrency = std::max( 1u, boost::thread::hardware_concurrency() );
+	m_concurrency = concurrency;
+
+	const std::size_t nWorkers = concurrency - 1;
+	m_impl.reset( new Impl( nWorkers ) );
+
+	// unbound workers may run anywhere and are all counted on node 0
+	m_impl->nodeWorkers.resize( 1 );
+	for ( std::size_t i = 0; i < nWorkers; i++ )
+	{
+		if ( !affinity.empty() )
+			m_impl->nodes[ i ] = numaNodeOfCpu( affinity[ i % affinity.size() ] );
+		if ( m_impl->nodes[ i ] >= m_impl->nodeWorkers.size() )
+			m_impl->nodeWorkers.resize( m_impl->nodes[ i ] + 1 );
+		m_impl->nodeWorkers[ m_impl->nodes[ i ] ].push_back( i );
+	}
+
+	for ( std::size_t i = 0; i < nWorkers; i++ )
+	{
+		const int cpu = affinity.empty() ? -1 : static_cast< int >( affinity[ i % affinity.size() ] );
+		m_impl->threads.create_thread( boost::bind( &Impl::work, m_impl.get(), i, cpu ) );
+	}
+}
+
+
+Executor::~Executor()
+{
+	{
+		boost::mutex::scoped_lock l( m_impl->sleepMutex );
+		m_impl->stop = true;
+	}
+	m_impl->wakeUp.notify_all();
+	m_impl->threads.join_all();
+
+	// tasks queued by threads that are not workers after the workers stopped
+	while ( runOne() )
+		;
+}
+
+
+Executor& Executor::instance()
+{
+	InstanceSettings& settings( instanceSettings() );
+	boost::mutex::scoped_lock l( settings.mutex );
+	if ( !settings.pInstance )
+		settings.pInstance = new Executor( settings.concurrency, settings.affinity );
+	return *settings.pInstance;
+}
+
+
+void Executor::configureInstance( unsigned concurrency, const std::vector< unsigned >& affinity )
+{
+	InstanceSettings& settings( instanceSettings() );
+	boost::mutex::scoped_lock l( settings.mutex );
+	if ( settings.pInstance )
+		UBITRACK_THROW( "The executor of the process is already running" );
+	settings.concurrency = concurrency;
+	settings.affinity = affinity;
+}
+
+
+void Executor::parallelFor( const std::size_t begin, const std::size_t end, std::size_t grain, const RangeFunction& f )
+{
+	if ( end <= begin )
+		return;
+	grain = std::max< std::size_t >( 1, grain );
+	if ( isInline() || end - begin <= grain )
+	{
+		f( begin, end );
+		return;
+	}
+
+	TaskGroup group( *this );
+	group.run( boost::bind( &splitRange, &group, &f, begin, end, grain ) );
+	group.wait();
+}
+
+
+unsigned Executor::nodeCount() const
+{
+	return static_cast< unsigned >( m_impl->nodeWorkers.size() );
+}
+
+
+void Executor::parallelForNodes( const std::size_t begin, const std::size_t end, std::size_t grain, const RangeFunction& f )
+{
+	const std::size_t nNodes = nodeCount();
+	if ( nNodes <= 1 || isInline() )
+	{
+		parallelFor( begin, end, grain, f );
+		return;
+	}
+	if ( end <= begin )
+		return;
+	grain = std::max< std::size_t >( 1, grain );
+
+	// the shards only depend on the range and the nodes, so repeated loops touch the same memory from the same node
+	TaskGroup group( *this );
+	const std::size_t n = end - begin;
+	for ( std::size_t node = 0; node < nNodes; node++ )
+	{
+		const std::size_t shardBegin = begin + n * node / nNodes;
+		const std::size_t shardEnd = begin + n * ( node + 1 ) / nNodes;
+		if ( shardBegin < shardEnd )
+			group.runOnNode( static_cast< unsigned >( node ), boost::bind( &splitRange, &group, &f, shardBegin, shardEnd, grain ) );
+	}
+	group.wait();
+}
+
+
+void Executor::submit( TaskGroup* group, const Task& task, const int node )
+{
+	QueuedTask queuedTask;
+	queuedTask.group = group;
+	queuedTask.task = task;
+	queuedTask.pinned = node >= 0;
+
+	TaskQueue& queue( m_impl->queues[ node >= 0 ? m_impl->nodeQueue( static_cast< unsigned >( node ) ) : m_impl->ownQueue() ] );
+	{
+		boost::mutex::scoped_lock l( queue.mutex );
+		queue.tasks.push_back( queuedTask );
+	}
+	m_impl->queued++;
+
+	// the lock orders the wakeup after the check of a worker that is about to sleep
+	{
+		boost::mutex::scoped_lock l( m_impl->sleepMutex );
+	}
+	if ( queuedTask.pinned )
+		m_impl->wakeUp.notify_all();
+	else
+		m_impl->wakeUp.notify_one();
+}
+
+
+bool Executor::runOne()
+{
+	QueuedTask task;
+	if ( !m_impl->pop( task ) )
+		return false;
+	task.group->execute( task.task );
+	return true;
+}
+
+
+TaskGroup::TaskGroup( Executor& executor )
+	: m_executor( executor )
+	, m_pending( 0 )
+	, m_cancelled( false )
+{}
+
+
+TaskGroup::~TaskGroup()
+{
+	try
+	{
+		wait();
+	}
+	catch ( ... )
+	{}
+}
+
+
+void TaskGroup::run( const Executor::Task& task )
+{
+	m_pending++;
+	if ( m_executor.isInline() )
+		execute( task );
+	else
+		m_executor.submit( this, task );
+}
+
+
+void TaskGroup::runOnNode( const unsigned node, const Executor::Task& task )
+{
+	m_pending++;
+	if ( m_executor.isInline() )
+		execute( task );
+	else
+		m_executor.submit( this, task, static_cast< int >( node ) );
+}
+
+
+void TaskGroup::wait()
+{
+	while ( true )
+	{
+		{
+			boost::mutex::scoped_lock l( m_mutex );
+			if ( !m_pending )
+				break;
+		}
+
+		// help instead of blocking, the tasks of this group may be queued behind others
+		if ( m_executor.runOne() )
+			continue;
+
+		// all remaining tasks are running
+		boost::mutex::scoped_lock l( m_mutex );
+		if ( m_pending )
+			m_done.wait( l );
+	}
+
+	boost::exception_ptr error;
+	{
+		boost::mutex::scoped_lock l( m_mutex );
+		error = m_error;
+		m_error = boost::exception_ptr();
+	}
+	if ( error )
+		boost::rethrow_exception( error );
+}
+
+
+void TaskGroup::execute( const Executor::Task& task )
+{
+	if ( !m_cancelled )
+	{
+		try
+		{
+			// a thread waiting in a group with a progress context may execute unrelated tasks
+			ProgressScope isolation;
+			task();
+		}
+		catch ( ... )
+		{
+			boost::mutex::scoped_lock l( m_mutex );
+			if ( !m_error )
+				m_error = boost::current_exception();
+			m_cancelled = true;
+		}
+	}
+
+	// the waiting thread only destroys the group after it got the lock
+	boost::mutex::scoped_lock l( m_mutex );
+	if ( !--m_pending )
+		m_done.notify_all();
+}
+
+} } // namespace Ubitrack::Util
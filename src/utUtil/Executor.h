@@ -0,0 +1,274 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup util
+ * @file
+ * Process-wide work-stealing executor for the parallel algorithms
+ *
+ * An \c Executor owns a fixed set of worker threads. Every worker has a deque of tasks: it
+ * takes its own tasks from the back, so nested work stays in its caches, and idle workers
+ * steal from the front of the other deques, where the largest pieces of split ranges are.
+ * Threads that wait for a \c TaskGroup execute queued tasks instead of blocking, so parallel
+ * loops may be nested and called from within tasks.
+ * @code
+ * Util::Executor& executor( Util::Executor::instance() );
+ * executor.parallelFor( 0, points.size(), 1024, boost::bind( &transformRange, &points, _1, _2 ) );
+ * double sum = executor.parallelReduce( 0, n, 4096, 0.0, &sumRange, std::plus< double >() );
+ * @endcode
+ *
+ * The algorithms taking a \c Math::ListExecutor run on an executor with
+ * \c Math::poolExecutor, so a process can give all of them one pool of threads sized and
+ * pinned by its own scheduler with \c Executor::configureInstance.
+ *
+ * An executor with a concurrency of 1, e.g. the default instance on a single core machine,
+ * has no threads and runs everything inline in the calling thread.
+ *
+ * On NUMA machines the workers bound to CPUs belong to the node of their CPU. They steal from
+ * the workers of their own node before they steal from remote ones. \c parallelForNodes splits a
+ * range into one contiguous shard per node and runs each shard on the workers of its node, so
+ * memory that is first touched in such a loop is allocated on the node that later works on it:
+ * @code
+ * std::vector< unsigned > cpus; // all CPUs of both sockets
+ * Util::Executor::configureInstance( 0, cpus );
+ * Util::Executor::instance().parallelForNodes( 0, n, 1024, boost::bind( &initializeRange, &data, _1, _2 ) );
+ * @endcode
+ */
+
+#ifndef __UBITRACK_UTIL_EXECUTOR_H_INCLUDED__
+#define __UBITRACK_UTIL_EXECUTOR_H_INCLUDED__
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include <boost/atomic.hpp>
+#include <boost/utility.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+class TaskGroup;
+
+/**
+ * Pool of worker threads with work stealing.
+ */
+class UBITRACK_EXPORT Executor
+	: private boost::noncopyable
+{
+public:
+	typedef boost::function< void () > Task;
+
+	/** function on the index range [ begin, end ) */
+	typedef boost::function< void ( std::size_t begin, std::size_t end ) > RangeFunction;
+
+	/**
+	 * starts the worker threads
+	 * @param concurrency number of threads working on a parallel loop, including the calling
+	 *   thread, so \c concurrency - 1 workers are started. 0 uses all cores, 1 runs inline.
+	 * @param affinity CPUs to bind the workers to, worker \c i is bound to
+	 *   <tt>affinity[ i % affinity.size() ]</tt> and belongs to its NUMA node. Empty leaves the
+	 *   workers unbound, they are all counted on node 0.
+	 */
+	explicit Executor( unsigned concurrency = 0, const std::vector< unsigned >& affinity = std::vector< unsigned >() );
+
+	/** executes the queued tasks and stops the workers */
+	~Executor();
+
+	/**
+	 * the executor of the process, created with the settings of \c configureInstance or
+	 * with all cores on the first call
+	 */
+	static Executor& instance();
+
+	/**
+	 * sets the parameters of the process executor.
+	 * @throws Util::Exception if \c instance has been called before
+	 */
+	static void configureInstance( unsigned concurrency, const std::vector< unsigned >& affinity = std::vector< unsigned >() );
+
+	/** number of threads working on a parallel loop, including the calling thread */
+	unsigned concurrency() const
+	{ return m_concurrency; }
+
+	/** true if the executor has no workers and runs all tasks in the calling thread */
+	bool isInline() const
+	{ return m_concurrency <= 1; }
+
+	/** number of NUMA nodes up to the highest one a worker is bound to, 1 for unbound workers */
+	unsigned nodeCount() const;
+
+	/**
+	 * calls \c f on subranges of [ begin, end ) in parallel and returns when all are done.
+	 * The range is split in halves down to at most \c grain indices.
+	 * Exceptions thrown by \c f cancel the remaining subranges and are rethrown.
+	 */
+	void parallelFor( std::size_t begin, std::size_t end, std::size_t grain, const RangeFunction& f );
+
+	/**
+	 * like \c parallelFor, but splits [ begin, end ) into \c nodeCount contiguous shards first and
+	 * runs shard \c i on the workers of NUMA node \c i, see \c TaskGroup::runOnNode. The shards only
+	 * depend on the range, so loops over the same range touch the same memory from the same node.
+	 */
+	void parallelForNodes( std::size_t begin, std::size_t end, std::size_t grain, const RangeFunction& f );
+
+	/**
+	 * computes <tt>combine( ... combine( combine( identity, map( begin, begin + grain ) ), ... ), map( ..., end ) )</tt>,
+	 * with the calls of \c map in parallel. The ranges and the order of the combination
+	 * only depend on \c grain, so the result is the same for every number of threads.
+	 * @param map function <tt>T map( std::size_t begin, std::size_t end )</tt>
+	 * @param combine function <tt>T combine( const T&, const T& )</tt>
+	 */
+	template< typename T, class Map, class Combine >
+	T parallelReduce( const std::size_t begin, const std::size_t end, std::size_t grain, const T& identity
+		, const Map& map, const Combine& combine )
+	{
+		if ( end <= begin )
+			return identity;
+		grain = std::max< std::size_t >( 1, grain );
+		std::vector< T > partial( ( end - begin + grain - 1 ) / grain, identity );
+		parallelFor( 0, partial.size(), 1, ReduceChunks< T, Map >( begin, end, grain, map, partial ) );
+
+		T result( identity );
+		for ( std::size_t i = 0; i < partial.size(); i++ )
+			result = combine( result, partial[ i ] );
+		return result;
+	}
+
+protected:
+	friend class TaskGroup;
+
+	/// @internal applies the map function of parallelReduce to a range of chunks
+	template< typename T, class Map >
+	struct ReduceChunks
+	{
+		ReduceChunks( std::size_t begin, std::size_t end, std::size_t grain, const Map& map, std::vector< T >& partial )
+			: m_begin( begin ), m_end( end ), m_grain( grain ), m_map( &map ), m_partial( &partial )
+		{}
+
+		void operator()( const std::size_t c0, const std::size_t c1 ) const
+		{
+			for ( std::size_t c = c0; c < c1; c++ )
+			{
+				const std::size_t b = m_begin + c * m_grain;
+				( *m_partial )[ c ] = ( *m_map )( b, std::min( b + m_grain, m_end ) );
+			}
+		}
+
+		std::size_t m_begin;
+		std::size_t m_end;
+		std::size_t m_grain;
+		const Map* m_map;
+		std::vector< T >* m_partial;
+	};
+
+	/**
+	 * queues a task of a group, on the deque of the calling worker if it is one, or pinned to
+	 * a worker of \c node if that is not negative
+	 */
+	void submit( TaskGroup* group, const Task& task, int node = -1 );
+
+	/** executes one queued task, returns false if there is none */
+	bool runOne();
+
+	struct Impl;
+	boost::scoped_ptr< Impl > m_impl;
+	unsigned m_concurrency;
+};
+
+
+/**
+ * A set of tasks on an \c Executor that can be waited for and cancelled together.
+ *
+ * Tasks of a cancelled group that have not started yet are skipped. Running tasks are not
+ * interrupted, long tasks can poll \c cancelled. The first exception thrown by a task
+ * cancels the group and is rethrown by \c wait.
+ * @code
+ * Util::TaskGroup group;
+ * for ( std::size_t i = 0; i < cameras.size(); i++ )
+ *     group.run( boost::bind( &calibrate, boost::ref( cameras[ i ] ) ) );
+ * group.wait();
+ * @endcode
+ */
+class UBITRACK_EXPORT TaskGroup
+	: private boost::noncopyable
+{
+public:
+	explicit TaskGroup( Executor& executor = Executor::instance() );
+
+	/** waits for the remaining tasks, their exceptions are dropped */
+	~TaskGroup();
+
+	/** queues a task, or runs it immediately on an inline executor */
+	void run( const Executor::Task& task );
+
+	/**
+	 * queues a task that is only executed by workers of a NUMA node, see \c Executor::nodeCount.
+	 * Tasks it queues itself are preferably stolen by the same node. If the node has no workers,
+	 * this is the same as \c run.
+	 */
+	void runOnNode( unsigned node, const Executor::Task& task );
+
+	/**
+	 * returns when all tasks are done, executing queued tasks in the meantime.
+	 * Rethrows the first exception of a task.
+	 */
+	void wait();
+
+	/** skips all tasks of the group that have not started yet */
+	void cancel()
+	{ m_cancelled = true; }
+
+	/** true after \c cancel or an exception of a task */
+	bool cancelled() const
+	{ return m_cancelled; }
+
+	/** the executor of the tasks */
+	Executor& executor() const
+	{ return m_executor; }
+
+protected:
+	friend class Executor;
+
+	/** runs a task of this group unless it is cancelled, catching its exception */
+	void execute( const Executor::Task& task );
+
+	Executor& m_executor;
+	boost::atomic< std::size_t > m_pending;
+	boost::atomic< bool > m_cancelled;
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_done;
+	boost::exception_ptr m_error;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif //__UBITRACK_UTIL_EXECUTOR_H_INCLUDED__
@@ -0,0 +1,529 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+/**
+ * @ingroup util
+ * @file
+ * Implementation of the flight recorder
+ */
+
+#include "FlightRecorder.h"
+#include "OS.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+typedef FlightRecorder::Record Record;
+
+/**
+ * @internal ring of the records of one thread. Only the thread writes. Before it overwrites a
+ * slot it announces the record in \c claimed, so a reader that copied the ring can discard the
+ * records that were overwritten while it was copying, as in \c SeqLock.
+ */
+struct Ring
+{
+	Ring( std::size_t capacity, unsigned id )
+		: records( capacity )
+		, mask( capacity - 1 )
+		, claimed( 0 )
+		, head( 0 )
+		, floor( 0 )
+		, id( id )
+		, exited( false )
+	{}
+
+	std::vector< Record > records;
+	const std::size_t mask;
+	/// number of records that were started
+	boost::atomic< unsigned long long > claimed;
+	/// number of records that were completed
+	boost::atomic< unsigned long long > head;
+	/// records before this one were discarded by \c clear
+	boost::atomic< unsigned long long > floor;
+	const unsigned id;
+	/// the thread has exited, protected by the registry mutex
+	bool exited;
+};
+
+
+/// @internal the rings of exited threads are kept for dumps, up to this number
+const std::size_t maxExitedRings = 16;
+
+
+/// @internal all rings and the settings, never destroyed as threads may exit after the static destructors
+struct Registry
+{
+	Registry()
+		: nextId( 1 )
+		, capacity( FlightRecorder::defaultCapacity )
+		, window( 10000000000LL )
+		, dumpInterval( 10000000000LL )
+		, lastDump( 0 )
+		, dumps( 0 )
+		, dumpOnException( false )
+	{}
+
+	boost::mutex mutex;
+	std::vector< Ring* > rings;
+	unsigned nextId;
+
+	boost::atomic< std::size_t > capacity;
+	boost::atomic< long long > window;
+
+	/// protects the settings of triggered dumps and serializes their writing
+	boost::mutex dumpMutex;
+	std::string dumpDirectory;
+	long long dumpInterval;
+	long long lastDump;
+	unsigned dumps;
+	boost::atomic< bool > dumpOnException;
+};
+
+Registry& registry()
+{
+	static Registry* pRegistry = new Registry;
+	return *pRegistry;
+}
+
+
+boost::atomic< bool > g_running( false );
+
+#if defined( _MSC_VER )
+__declspec( thread ) Ring* t_ring = 0;
+#else
+__thread Ring* t_ring = 0;
+#endif
+
+void releaseRing( Ring* pRing )
+{
+	Registry& reg( registry() );
+	boost::mutex::scoped_lock lock( reg.mutex );
+	pRing->exited = true;
+
+	// drop the oldest rings of exited threads
+	std::size_t nExited = 0;
+	for ( std::size_t i = reg.rings.size(); i-- > 0; )
+		if ( reg.rings[ i ]->exited && ++nExited > maxExitedRings )
+		{
+			delete reg.rings[ i ];
+			reg.rings.erase( reg.rings.begin() + i );
+		}
+}
+
+/// @internal marks the ring of each thread as exited when the thread exits
+boost::thread_specific_ptr< Ring > g_ringOwner( &releaseRing );
+
+Ring* registerThread()
+{
+	Registry& reg( registry() );
+	Ring* pRing;
+	{
+		boost::mutex::scoped_lock lock( reg.mutex );
+		pRing = new Ring( reg.capacity.load( boost::memory_order_relaxed ), reg.nextId++ );
+		reg.rings.push_back( pRing );
+	}
+	g_ringOwner.reset( pRing );
+	t_ring = pRing;
+	return pRing;
+}
+
+
+void copyLabel( char* dst, const char* label, const char* detail )
+{
+	std::size_t n = 0;
+	for ( ; label && *label && n < Record::labelSize - 1; label++ )
+		dst[ n++ ] = *label;
+	if ( detail && *detail && n < Record::labelSize - 1 )
+	{
+		dst[ n++ ] = '/';
+		for ( ; *detail && n < Record::labelSize - 1; detail++ )
+			dst[ n++ ] = *detail;
+	}
+	dst[ n ] = 0;
+}
+
+
+void writeRecord( long long time, char phase, const char* name, const char* argNames,
+	const FlightValue& arg0, const FlightValue& arg1, const FlightValue& arg2, const char* label, const char* detail )
+{
+	Ring* pRing = t_ring;
+	if ( !pRing )
+		pRing = registerThread();
+
+	const unsigned long long index = pRing->head.load( boost::memory_order_relaxed );
+	pRing->claimed.store( index + 1, boost::memory_order_relaxed );
+	boost::atomic_thread_fence( boost::memory_order_release );
+
+	Record& r( pRing->records[ index & pRing->mask ] );
+	r.time = time;
+	r.name = name;
+	r.argNames = argNames;
+	const FlightValue* args[ 3 ] = { &arg0, &arg1, &arg2 };
+	r.types = 0;
+	for ( unsigned i = 0; i < 3; i++ )
+	{
+		r.args[ i ].u = args[ i ]->asUnsigned();
+		r.types |= static_cast< unsigned char >( args[ i ]->type() << ( 2 * i ) );
+	}
+	copyLabel( r.label, label, detail );
+	r.phase = phase;
+
+	pRing->head.store( index + 1, boost::memory_order_release );
+}
+
+
+struct EventTimeLess
+{
+	bool operator()( const FlightRecorder::Event& a, const FlightRecorder::Event& b ) const
+	{ return a.record.time < b.record.time; }
+};
+
+
+/** @internal copies the records of a ring newer than \c since */
+void readRing( const Ring& ring, long long since, std::vector< FlightRecorder::Event >& events )
+{
+	const unsigned long long capacity = ring.records.size();
+	const unsigned long long head = ring.head.load( boost::memory_order_acquire );
+	unsigned long long first = std::max( ring.floor.load( boost::memory_order_relaxed ), head > capacity ? head - capacity : 0 );
+
+	std::vector< Record > copy;
+	copy.reserve( static_cast< std::size_t >( head - first ) );
+	for ( unsigned long long i = first; i < head; i++ )
+		copy.push_back( ring.records[ i & ring.mask ] );
+
+	// discard the records that the thread overwrote meanwhile
+	boost::atomic_thread_fence( boost::memory_order_acquire );
+	const unsigned long long claimed = ring.claimed.load( boost::memory_order_relaxed );
+	const unsigned long long valid = claimed > capacity ? claimed - capacity : 0;
+
+	const std::size_t nBefore = events.size();
+	for ( unsigned long long i = std::max( first, valid ); i < head; i++ )
+	{
+		const Record& r( copy[ static_cast< std::size_t >( i - first ) ] );
+		if ( r.time < since )
+			continue;
+		FlightRecorder::Event e;
+		e.thread = ring.id;
+		e.record = r;
+		events.push_back( e );
+	}
+
+	// events recorded with recordAt may be out of order
+	std::stable_sort( events.begin() + nBefore, events.end(), EventTimeLess() );
+}
+
+
+void writeString( std::ostream& os, const char* s )
+{
+	os << '"';
+	for ( ; *s; s++ )
+	{
+		const unsigned char c = static_cast< unsigned char >( *s );
+		if ( c == '"' || c == '\\' )
+			os << '\\' << *s;
+		else if ( c < 0x20 )
+			os << "\\u00" << "0123456789abcdef"[ c >> 4 ] << "0123456789abcdef"[ c & 15 ];
+		else
+			os << *s;
+	}
+	os << '"';
+}
+
+
+/** @internal writes nanoseconds as microseconds with three decimals */
+void writeMicroseconds( std::ostream& os, long long ns )
+{
+	os << ns / 1000 << '.' << std::setw( 3 ) << std::setfill( '0' ) << ns % 1000 << std::setfill( ' ' );
+}
+
+
+void writeArgs( std::ostream& os, const Record& r )
+{
+	os << "\"args\":{";
+	bool bFirst = true;
+	if ( r.label[ 0 ] )
+	{
+		os << "\"label\":";
+		writeString( os, r.label );
+		bFirst = false;
+	}
+
+	const char* names = r.argNames;
+	for ( unsigned i = 0; i < 3 && names && *names; i++ )
+	{
+		const char* end = std::strchr( names, ',' );
+		if ( !end )
+			end = names + std::strlen( names );
+
+		if ( !bFirst )
+			os << ',';
+		bFirst = false;
+		os << '"' << std::string( names, end ) << "\":";
+		switch ( ( r.types >> ( 2 * i ) ) & 3 )
+		{
+		case FlightValue::Signed:
+			os << r.args[ i ].i;
+			break;
+		case FlightValue::Floating:
+			// JSON has no representation of inf and nan
+			if ( r.args[ i ].d - r.args[ i ].d == 0 )
+				os << std::setprecision( 9 ) << r.args[ i ].d;
+			else
+				os << "null";
+			break;
+		default:
+			os << r.args[ i ].u;
+		}
+
+		names = *end ? end + 1 : end;
+	}
+	os << '}';
+}
+
+
+int processId()
+{
+#ifdef _WIN32
+	return _getpid();
+#else
+	return static_cast< int >( getpid() );
+#endif
+}
+
+} // anonymous namespace
+
+
+void FlightRecorder::start( std::size_t capacity, double windowSeconds )
+{
+	std::size_t rounded = 1;
+	while ( rounded < capacity )
+		rounded <<= 1;
+
+	Registry& reg( registry() );
+	reg.capacity.store( rounded, boost::memory_order_relaxed );
+	reg.window.store( static_cast< long long >( windowSeconds * 1e9 ), boost::memory_order_relaxed );
+	g_running.store( true, boost::memory_order_release );
+}
+
+
+void FlightRecorder::stop()
+{
+	g_running.store( false, boost::memory_order_release );
+}
+
+
+bool FlightRecorder::running()
+{
+	return g_running.load( boost::memory_order_relaxed );
+}
+
+
+void FlightRecorder::clear()
+{
+	Registry& reg( registry() );
+	boost::mutex::scoped_lock lock( reg.mutex );
+	for ( std::size_t i = reg.rings.size(); i-- > 0; )
+		if ( reg.rings[ i ]->exited )
+		{
+			delete reg.rings[ i ];
+			reg.rings.erase( reg.rings.begin() + i );
+		}
+		else
+			reg.rings[ i ]->floor.store( reg.rings[ i ]->claimed.load( boost::memory_order_relaxed ), boost::memory_order_relaxed );
+}
+
+
+void FlightRecorder::setDumpDirectory( const std::string& sDirectory )
+{
+	Registry& reg( registry() );
+	boost::mutex::scoped_lock lock( reg.dumpMutex );
+	reg.dumpDirectory = sDirectory;
+}
+
+
+void FlightRecorder::setDumpInterval( double seconds )
+{
+	Registry& reg( registry() );
+	boost::mutex::scoped_lock lock( reg.dumpMutex );
+	reg.dumpInterval = static_cast< long long >( seconds * 1e9 );
+}
+
+
+void FlightRecorder::setDumpOnException( bool bEnable )
+{
+	registry().dumpOnException.store( bEnable, boost::memory_order_relaxed );
+}
+
+
+void FlightRecorder::record( char phase, const char* name, const char* argNames,
+	FlightValue arg0, FlightValue arg1, FlightValue arg2, const char* label, const char* detail )
+{
+	if ( g_running.load( boost::memory_order_relaxed ) )
+		writeRecord( getMonotonicTime(), phase, name, argNames, arg0, arg1, arg2, label, detail );
+}
+
+
+void FlightRecorder::recordAt( long long time, char phase, const char* name, const char* argNames,
+	FlightValue arg0, FlightValue arg1, FlightValue arg2, const char* label, const char* detail )
+{
+	if ( g_running.load( boost::memory_order_relaxed ) )
+		writeRecord( time, phase, name, argNames, arg0, arg1, arg2, label, detail );
+}
+
+
+std::vector< FlightRecorder::Event > FlightRecorder::snapshot()
+{
+	Registry& reg( registry() );
+	const long long since = getMonotonicTime() - reg.window.load( boost::memory_order_relaxed );
+
+	std::vector< Event > events;
+	boost::mutex::scoped_lock lock( reg.mutex );
+	for ( std::size_t i = 0; i < reg.rings.size(); i++ )
+		readRing( *reg.rings[ i ], since, events );
+	return events;
+}
+
+
+void FlightRecorder::dump( std::ostream& os, const std::string& sReason )
+{
+	const std::vector< Event > events( snapshot() );
+	const int pid = processId();
+
+	os << "{\"traceEvents\":[";
+	bool bFirst = true;
+	unsigned lastThread = 0;
+	for ( std::size_t i = 0; i < events.size(); i++ )
+	{
+		const Event& e( events[ i ] );
+		if ( !bFirst )
+			os << ',';
+		bFirst = false;
+
+		if ( e.thread != lastThread )
+		{
+			os << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << e.thread
+				<< ",\"args\":{\"name\":\"thread " << e.thread << "\"}},";
+			lastThread = e.thread;
+		}
+
+		os << "\n{\"name\":";
+		writeString( os, e.record.name );
+		os << ",\"cat\":\"ubitrack\",\"ph\":\"" << e.record.phase << "\",\"ts\":";
+		writeMicroseconds( os, e.record.time );
+		os << ",\"pid\":" << pid << ",\"tid\":" << e.thread;
+		if ( e.record.phase == 'i' )
+			os << ",\"s\":\"t\"";
+		os << ',';
+		writeArgs( os, e.record );
+		os << '}';
+	}
+	os << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"reason\":";
+	writeString( os, sReason.c_str() );
+	os << "}}\n";
+}
+
+
+bool FlightRecorder::dump( const std::string& sPath, const std::string& sReason )
+{
+	std::ofstream file( sPath.c_str() );
+	if ( !file )
+		return false;
+	dump( file, sReason );
+	file.close();
+	return !file.fail();
+}
+
+
+std::string FlightRecorder::trigger( const std::string& sReason )
+{
+	if ( !running() )
+		return std::string();
+
+	try
+	{
+		Registry& reg( registry() );
+		boost::mutex::scoped_try_lock lock( reg.dumpMutex );
+		if ( !lock.owns_lock() )
+			return std::string();
+
+		const long long now = getMonotonicTime();
+		if ( reg.dumps && now - reg.lastDump < reg.dumpInterval )
+			return std::string();
+		reg.lastDump = now;
+
+		record( 'i', "flight_recorder_dump", 0, FlightValue(), FlightValue(), FlightValue(), sReason.c_str() );
+
+		std::ostringstream path;
+		path << reg.dumpDirectory;
+		if ( !reg.dumpDirectory.empty() && reg.dumpDirectory[ reg.dumpDirectory.size() - 1 ] != '/'
+			&& reg.dumpDirectory[ reg.dumpDirectory.size() - 1 ] != '\\' )
+			path << '/';
+		path << "ubitrack-flight-" << static_cast< long long >( std::time( 0 ) ) << '-' << processId() << '-' << reg.dumps++ << ".json";
+
+		if ( dump( path.str(), sReason ) )
+			return path.str();
+	}
+	catch ( ... )
+	{}
+	return std::string();
+}
+
+
+void FlightRecorder::exceptionThrown( const char* sMessage, const char* sFile, unsigned nLine )
+{
+	if ( !running() )
+		return;
+
+	record( 'i', "exception", "line", nLine, FlightValue(), FlightValue(), sMessage );
+
+	if ( !registry().dumpOnException.load( boost::memory_order_relaxed ) )
+		return;
+
+	try
+	{
+		std::ostringstream reason;
+		reason << "exception at " << ( sFile ? sFile : "" ) << ':' << nLine << ": " << sMessage;
+		trigger( reason.str() );
+	}
+	catch ( ... )
+	{}
+}
+
+} } // namespace Ubitrack::Util
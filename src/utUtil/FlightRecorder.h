@@ -0,0 +1,229 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+/**
+ * @ingroup util
+ * @file
+ * Always-on in-memory trace of the recent events of all threads, dumped on anomalies
+ */
+
+#ifndef __UBITRACK_UTIL_FLIGHTRECORDER_H_INCLUDED__
+#define __UBITRACK_UTIL_FLIGHTRECORDER_H_INCLUDED__
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/type_traits/integral_constant.hpp>
+#include <boost/type_traits/is_floating_point.hpp>
+#include <boost/type_traits/is_signed.hpp>
+
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * A numeric argument of a flight recorder event, which keeps whether it was an unsigned,
+ * signed or floating point value.
+ */
+class FlightValue
+{
+public:
+	enum Type { Unsigned = 0, Signed = 1, Floating = 2 };
+
+	/** an unused argument */
+	FlightValue()
+		: m_type( Unsigned )
+	{ m_value.u = 0; }
+
+	template< class T >
+	FlightValue( T value )
+	{ assign( value, boost::is_floating_point< T >(), boost::is_signed< T >() ); }
+
+	Type type() const
+	{ return m_type; }
+
+	unsigned long long asUnsigned() const
+	{ return m_value.u; }
+
+	long long asSigned() const
+	{ return m_value.i; }
+
+	double asDouble() const
+	{ return m_value.d; }
+
+protected:
+	template< class T, class S >
+	void assign( T value, boost::true_type, S )
+	{ m_type = Floating; m_value.d = static_cast< double >( value ); }
+
+	template< class T >
+	void assign( T value, boost::false_type, boost::true_type )
+	{ m_type = Signed; m_value.i = static_cast< long long >( value ); }
+
+	template< class T >
+	void assign( T value, boost::false_type, boost::false_type )
+	{ m_type = Unsigned; m_value.u = static_cast< unsigned long long >( value ); }
+
+	Type m_type;
+	union { unsigned long long u; long long i; double d; } m_value;
+};
+
+
+/**
+ * Keeps the last seconds of trace events of all threads in memory and writes them to a file
+ * when something goes wrong, so a tracking stall in production can be analysed without a
+ * running LTTng or ETW session.
+ *
+ * Every thread writes its events into its own ring of fixed-size records without locks. A
+ * record takes 72 bytes, the default of 16384 records per thread keeps about ten seconds of
+ * a thread that dispatches a few hundred events per frame at 60 Hz. The rings are fed by
+ * \c UBITRACK_TRACE_SPAN and the \c TRACEPOINT_ macros of TracingProvider.h when the library
+ * is built with \c ENABLE_FLIGHT_RECORDER, independently of the system tracing backend.
+ *
+ * Recording starts with \c start, usually at the initialization of the application:
+ * @code
+ * Util::FlightRecorder::start();
+ * Util::FlightRecorder::setDumpDirectory( "/var/log/ubitrack" );
+ * Util::FlightRecorder::setDumpOnException( true );
+ * trackingTimer.setDumpThreshold( 200.0 ); // ms
+ * @endcode
+ *
+ * A dump is triggered by
+ * - \c trigger, e.g. from a watchdog or a user command,
+ * - a \c BlockTimer run longer than its \c setDumpThreshold,
+ * - the construction of a \c Util::Exception after \c setDumpOnException.
+ *
+ * Triggered dumps are written by the triggering thread and at most once per
+ * \c setDumpInterval, so a burst of exceptions does not stall the process with file I/O.
+ * The dumps are in the JSON trace event format, which chrome://tracing, Perfetto and
+ * speedscope open directly, with one track per thread.
+ *
+ * Names and argument names of the events are not copied and must be string literals. Labels,
+ * e.g. component names, are copied and truncated to \c Record::labelSize - 1 characters.
+ */
+class UBITRACK_EXPORT FlightRecorder
+{
+public:
+	/** one event in the ring of a thread */
+	struct Record
+	{
+		/** bytes of the label, including the terminating zero */
+		static const std::size_t labelSize = 22;
+
+		/** \c getMonotonicTime of the event */
+		long long time;
+		/** name of the event, a string literal */
+		const char* name;
+		/** comma-separated names of the arguments, a string literal or 0 */
+		const char* argNames;
+		/** the arguments, interpreted according to \c types */
+		union { unsigned long long u; long long i; double d; } args[ 3 ];
+		/** copy of the label, e.g. the component and port */
+		char label[ labelSize ];
+		/** phase in the trace event format: 'B' begin, 'E' end or 'i' instant */
+		char phase;
+		/** \c FlightValue::Type of the arguments, two bits each */
+		unsigned char types;
+	};
+
+	/** a record together with the number of its thread */
+	struct Event
+	{
+		unsigned thread;
+		Record record;
+	};
+
+	/** default number of records of each thread */
+	static const std::size_t defaultCapacity = 16384;
+
+	/**
+	 * Starts recording in all threads.
+	 * @param capacity records per thread, rounded up to a power of two. Threads that
+	 *   recorded before keep the capacity of their ring.
+	 * @param windowSeconds dumps only contain events of the last \c windowSeconds
+	 */
+	static void start( std::size_t capacity = defaultCapacity, double windowSeconds = 10.0 );
+
+	/** stops recording, the recorded events are kept and can still be dumped */
+	static void stop();
+
+	/** true between \c start and \c stop */
+	static bool running();
+
+	/** discards all recorded events */
+	static void clear();
+
+	/** directory of triggered dumps, the working directory by default */
+	static void setDumpDirectory( const std::string& sDirectory );
+
+	/** minimum time between two triggered dumps, 10 seconds by default */
+	static void setDumpInterval( double seconds );
+
+	/** triggers a dump when a \c Util::Exception is constructed, off by default */
+	static void setDumpOnException( bool bEnable );
+
+	/**
+	 * Records an event in the ring of the calling thread if the recorder is running.
+	 * @param phase 'B' at the begin of a block, 'E' at its end, 'i' for a single event
+	 * @param name name of the event, a string literal
+	 * @param argNames comma-separated names of the arguments, a string literal or 0
+	 * @param label optional label, copied
+	 * @param detail optional second part of the label, appended with a '/'
+	 */
+	static void record( char phase, const char* name, const char* argNames = 0,
+		FlightValue arg0 = FlightValue(), FlightValue arg1 = FlightValue(), FlightValue arg2 = FlightValue(),
+		const char* label = 0, const char* detail = 0 );
+
+	/** records an event that happened at \c time in \c getMonotonicTime, e.g. the begin of a block */
+	static void recordAt( long long time, char phase, const char* name, const char* argNames = 0,
+		FlightValue arg0 = FlightValue(), FlightValue arg1 = FlightValue(), FlightValue arg2 = FlightValue(),
+		const char* label = 0, const char* detail = 0 );
+
+	/** the events of the time window of all threads, ordered by thread and time */
+	static std::vector< Event > snapshot();
+
+	/** writes the events of the time window in the trace event format */
+	static void dump( std::ostream& os, const std::string& sReason = std::string() );
+
+	/**
+	 * writes the events of the time window to a file
+	 * @return false if the file could not be written
+	 */
+	static bool dump( const std::string& sPath, const std::string& sReason );
+
+	/**
+	 * Writes a dump to a new file in the dump directory, unless the recorder is not running,
+	 * another dump is being written or the last triggered dump is more recent than the dump
+	 * interval. Never throws.
+	 * @return the path of the file, empty if nothing was written
+	 */
+	static std::string trigger( const std::string& sReason );
+
+	/** records an exception and triggers a dump if enabled, called by \c Util::Exception */
+	static void exceptionThrown( const char* sMessage, const char* sFile, unsigned nLine );
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
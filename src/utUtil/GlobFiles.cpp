@@ -23,26 +23,42 @@
 
 #include "GlobFiles.h"
 
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
 // Boost
-#include <boost/regex.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
 
 // Ubitrack
 #include <utUtil/Exception.h>
 
-#include <log4cpp/Category.hh>
-static log4cpp::Category& logger( log4cpp::Category::getInstance( "Ubitrack.Util.GlobFiles" ) );
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Util.GlobFiles" );
 
 namespace Ubitrack { namespace Util {
 
+namespace {
 
+const GlobPattern g_imagePattern( ".*\\.(jpg|JPG|png|PNG|bmp|BMP)" );
+const GlobPattern g_calibrationPattern( ".*\\.(cal)" );
+const GlobPattern g_directoryPattern( "", true );
+const GlobPattern g_boostBinaryPattern( ".*\\.(BoostBinary)" );
 
-void globFiles( const std::string& directory, const std::string & patternString, std::list< boost::filesystem::path >& files, bool globDirectories)
+/// globs with a precompiled pattern
+void globFiles( const std::string& directory, const GlobPattern& pattern, std::list< boost::filesystem::path >& files )
 {
 	boost::filesystem::path testPath( directory );
 	if ( boost::filesystem::is_directory( testPath ) && boost::filesystem::exists( testPath ) )
 	{
-		boost::regex ext( patternString.c_str() );
-
 		// iterate directory
 		boost::filesystem::directory_iterator dirEnd;
 		for ( boost::filesystem::directory_iterator it( testPath ); it != dirEnd; it++ )
@@ -53,14 +69,14 @@ void globFiles( const std::string& directory, const std::string & patternString,
 			boost::filesystem::path p( *it );
 #endif
 			// check for files with suitable extension
-			if ( boost::filesystem::exists( p ) && ! boost::filesystem::is_directory( p ) && boost::regex_match( p.filename().string(), ext ) )
+			if ( boost::filesystem::exists( p ) && ! boost::filesystem::is_directory( p ) && pattern.matches( p.filename().string() ) )
 			{
 				LOG4CPP_TRACE( logger, "Adding file " << p << " to list" );
 
 				files.push_back( p );
 			}
 			// glob directories, if desired
-			else if ( globDirectories && boost::filesystem::exists( p ) && boost::filesystem::is_directory( p ) )
+			else if ( pattern.globDirectories() && boost::filesystem::exists( p ) && boost::filesystem::is_directory( p ) )
 			{
 				files.push_back( p );
 			}
@@ -87,20 +103,336 @@ void globFiles( const std::string& directory, const std::string & patternString,
 	}
 }
 
+} // anonymous namespace
+
+
+void globFiles( const std::string& directory, const std::string & patternString, std::list< boost::filesystem::path >& files, bool globDirectories)
+{
+	globFiles( directory, GlobPattern( patternString, globDirectories ), files );
+}
+
 void globFiles( const std::string& directory, const enum FilePattern pattern, std::list< boost::filesystem::path >& files )
 {
-	std::string patternString = "";
-	if ( pattern == PATTERN_DIRECTORIES )
-		globFiles ( directory, patternString, files, true);
-	else {
-		if ( pattern == PATTERN_OPENCV_IMAGE_FILES )
-			patternString = ".*\\.(jpg|JPG|png|PNG|bmp|BMP)";
-		else if ( pattern == PATTERN_UBITRACK_CALIBRATION_FILES )
-			patternString = ".*\\.(cal)";
-		else if (pattern == PATTERN_UBITRACK_BOOST_BINARY)
-			patternString = ".*\\.(BoostBinary)";
-		globFiles ( directory, patternString, files, false);
+	globFiles( directory, GlobPattern::get( pattern ), files );
+}
+
+
+GlobPattern::GlobPattern( const std::string& patternString, bool globDirectories )
+	: m_string( patternString )
+	, m_regex( patternString )
+	, m_globDirectories( globDirectories )
+{
+}
+
+
+const GlobPattern& GlobPattern::get( FilePattern pattern )
+{
+	switch ( pattern )
+	{
+	case PATTERN_OPENCV_IMAGE_FILES:
+		return g_imagePattern;
+	case PATTERN_UBITRACK_CALIBRATION_FILES:
+		return g_calibrationPattern;
+	case PATTERN_DIRECTORIES:
+		return g_directoryPattern;
+	case PATTERN_UBITRACK_BOOST_BINARY:
+		return g_boostBinaryPattern;
+	}
+	UBITRACK_THROW( "Unknown file pattern" );
+}
+
+
+bool naturalLess( const std::string& a, const std::string& b )
+{
+	std::size_t i = 0;
+	std::size_t j = 0;
+	while ( i < a.size() && j < b.size() )
+	{
+		if ( std::isdigit( static_cast< unsigned char >( a[ i ] ) ) && std::isdigit( static_cast< unsigned char >( b[ j ] ) ) )
+		{
+			// compare the numbers without leading zeros by length, then digit by digit
+			std::size_t ia = i;
+			std::size_t jb = j;
+			while ( ia < a.size() && a[ ia ] == '0' )
+				ia++;
+			while ( jb < b.size() && b[ jb ] == '0' )
+				jb++;
+			std::size_t ea = ia;
+			std::size_t eb = jb;
+			while ( ea < a.size() && std::isdigit( static_cast< unsigned char >( a[ ea ] ) ) )
+				ea++;
+			while ( eb < b.size() && std::isdigit( static_cast< unsigned char >( b[ eb ] ) ) )
+				eb++;
+
+			if ( ea - ia != eb - jb )
+				return ea - ia < eb - jb;
+			const int c = a.compare( ia, ea - ia, b, jb, eb - jb );
+			if ( c != 0 )
+				return c < 0;
+			// equal values, fewer leading zeros first
+			if ( ia - i != jb - j )
+				return ia - i < jb - j;
+			i = ea;
+			j = eb;
+		}
+		else
+		{
+			if ( a[ i ] != b[ j ] )
+				return static_cast< unsigned char >( a[ i ] ) < static_cast< unsigned char >( b[ j ] );
+			i++;
+			j++;
+		}
+	}
+	return a.size() - i < b.size() - j;
+}
+
+
+namespace {
+
+bool entryLess( const GlobEntry& a, const GlobEntry& b )
+{
+	return naturalLess( a.path.string(), b.path.string() );
+}
+
+} // anonymous namespace
+
+
+const GlobFileList::Entries& GlobFileList::entries() const
+{
+	if ( !m_sorted )
+	{
+		std::sort( m_entries.begin(), m_entries.end(), &entryLess );
+		m_sorted = true;
 	}
+	return m_entries;
+}
+
+
+std::vector< boost::filesystem::path > GlobFileList::paths() const
+{
+	const Entries& sorted = entries();
+	std::vector< boost::filesystem::path > result;
+	result.reserve( sorted.size() );
+	for ( std::size_t i = 0; i < sorted.size(); i++ )
+		result.push_back( sorted[ i ].path );
+	return result;
+}
+
+
+void GlobFileList::push_back( const GlobEntry& entry )
+{
+	m_entries.push_back( entry );
+	m_sorted = false;
+}
+
+
+void GlobFileList::clear()
+{
+	m_entries.clear();
+	m_sorted = true;
+}
+
+
+namespace {
+
+/// a directory entry, which is invalid if it could not be examined
+struct ScanItem
+{
+	GlobEntry entry;
+	bool valid;
+};
+
+/// queries type, size and modification time of an entry
+void examine( ScanItem& item )
+{
+#ifdef _WIN32
+	boost::system::error_code ec;
+	const boost::filesystem::file_status status = boost::filesystem::status( item.entry.path, ec );
+	item.valid = !ec && boost::filesystem::exists( status );
+	if ( !item.valid )
+		return;
+	item.entry.directory = boost::filesystem::is_directory( status );
+	item.entry.size = item.entry.directory ? 0 : boost::filesystem::file_size( item.entry.path, ec );
+	item.entry.mtime = boost::filesystem::last_write_time( item.entry.path, ec );
+	item.valid = !ec;
+#else
+	// one system call instead of three
+	struct stat st;
+	item.valid = ::stat( item.entry.path.c_str(), &st ) == 0;
+	if ( !item.valid )
+		return;
+	item.entry.directory = S_ISDIR( st.st_mode );
+	item.entry.size = item.entry.directory ? 0 : static_cast< boost::uintmax_t >( st.st_size );
+	item.entry.mtime = st.st_mtime;
+#endif
+}
+
+/// examines blocks of entries until none are left
+void examineItems( std::vector< ScanItem >* items, boost::atomic< std::size_t >* next )
+{
+	const std::size_t block = 64;
+	for ( std::size_t begin = next->fetch_add( block ); begin < items->size(); begin = next->fetch_add( block ) )
+		for ( std::size_t i = begin; i < std::min( begin + block, items->size() ); i++ )
+			examine( ( *items )[ i ] );
+}
+
+/// examines all entries in parallel
+void examineAll( std::vector< ScanItem >& items, unsigned threads )
+{
+	if ( threads == 0 )
+		threads = std::max( 1u, boost::thread::hardware_concurrency() );
+	threads = static_cast< unsigned >( std::min< std::size_t >( threads, items.size() / 64 + 1 ) );
+
+	boost::atomic< std::size_t > next( 0 );
+	boost::thread_group group;
+	for ( unsigned i = 1; i < threads; i++ )
+		group.create_thread( boost::bind( &examineItems, &items, &next ) );
+	examineItems( &items, &next );
+	group.join_all();
+}
+
+const char* g_indexHeader = "ubitrack-glob-index 1";
+
+/**
+ * reads the entries of a directory from an index that is still valid
+ * @param directory absolute path of the directory, the key of the index
+ * @param dir the directory as it was given, the entries are returned relative to it
+ */
+bool readIndex( const std::string& indexFile, const std::string& directory, const boost::filesystem::path& dir,
+	const std::time_t dirTime, std::vector< GlobEntry >& entries )
+{
+	std::ifstream in( indexFile.c_str() );
+	std::string line;
+	if ( !std::getline( in, line ) || line != g_indexHeader )
+		return false;
+	if ( !std::getline( in, line ) || line != directory )
+		return false;
+
+	// the directory may have changed within the resolution of its modification time after the index was written
+	long long indexDirTime;
+	long long writeTime;
+	if ( !std::getline( in, line ) || !( std::istringstream( line ) >> indexDirTime >> writeTime ) )
+		return false;
+	if ( indexDirTime != dirTime || indexDirTime + 2 > writeTime )
+		return false;
+
+	while ( std::getline( in, line ) )
+	{
+		std::istringstream s( line );
+		long long mtime;
+		boost::uintmax_t size;
+		char type;
+		if ( !( s >> mtime >> size >> type ) || s.get() != ' ' )
+			return false;
+		std::string name;
+		std::getline( s, name );
+
+		GlobEntry entry;
+		entry.path = dir / name;
+		entry.mtime = static_cast< std::time_t >( mtime );
+		entry.size = size;
+		entry.directory = type == 'd';
+		entries.push_back( entry );
+	}
+	return true;
+}
+
+/// replaces the index, failures are only logged
+void writeIndex( const std::string& indexFile, const std::string& directory, const std::time_t dirTime, const std::vector< ScanItem >& items )
+{
+	const std::string tmpFile = indexFile + ".tmp";
+	{
+		std::ofstream out( tmpFile.c_str() );
+		out << g_indexHeader << "\n" << directory << "\n"
+			<< static_cast< long long >( dirTime ) << " " << static_cast< long long >( std::time( 0 ) ) << "\n";
+		for ( std::size_t i = 0; i < items.size(); i++ )
+			if ( items[ i ].valid )
+			{
+				const GlobEntry& entry = items[ i ].entry;
+				out << static_cast< long long >( entry.mtime ) << " " << entry.size << " " << ( entry.directory ? 'd' : 'f' )
+					<< " " << entry.path.filename().string() << "\n";
+			}
+		out.flush();
+		if ( !out )
+		{
+			LOG4CPP_WARN( logger, "Could not write index file " << tmpFile );
+			return;
+		}
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::rename( tmpFile, indexFile, ec );
+	if ( ec )
+		LOG4CPP_WARN( logger, "Could not replace index file " << indexFile << ": " << ec.message() );
+}
+
+bool selected( const GlobEntry& entry, const GlobPattern& pattern )
+{
+	return entry.directory ? pattern.globDirectories() : pattern.matches( entry.path.filename().string() );
+}
+
+} // anonymous namespace
+
+
+bool scanFiles( const std::string& directory, const GlobPattern& pattern, GlobFileList& files, const GlobOptions& options )
+{
+	const boost::filesystem::path dir( directory );
+	boost::system::error_code ec;
+	const boost::filesystem::file_status status = boost::filesystem::status( dir, ec );
+	if ( ec || !boost::filesystem::exists( status ) )
+		UBITRACK_THROW( "Invalid path specified: " + directory );
+
+	if ( !boost::filesystem::is_directory( status ) )
+	{
+		ScanItem item;
+		item.entry.path = dir;
+		examine( item );
+		if ( item.valid )
+			files.push_back( item.entry );
+		return false;
+	}
+
+	const std::string dirString = boost::filesystem::absolute( dir ).string();
+	const std::time_t dirTime = boost::filesystem::last_write_time( dir, ec );
+
+	// unchanged directories are taken from the index
+	if ( !options.indexFile.empty() && !ec )
+	{
+		std::vector< GlobEntry > indexed;
+		if ( readIndex( options.indexFile, dirString, dir, dirTime, indexed ) )
+		{
+			for ( std::size_t i = 0; i < indexed.size(); i++ )
+				if ( selected( indexed[ i ], pattern ) )
+					files.push_back( indexed[ i ] );
+			LOG4CPP_DEBUG( logger, "Took " << indexed.size() << " entries of " << directory << " from the index" );
+			return true;
+		}
+	}
+
+	// the names are matched before any entry is examined, except when all entries are needed
+	const bool examineAllEntries = pattern.globDirectories() || !options.indexFile.empty();
+	std::vector< ScanItem > items;
+	boost::filesystem::directory_iterator dirEnd;
+	for ( boost::filesystem::directory_iterator it( dir ); it != dirEnd; it++ )
+		if ( examineAllEntries || pattern.matches( it->path().filename().string() ) )
+		{
+			ScanItem item;
+			item.entry.path = it->path();
+			item.valid = false;
+			items.push_back( item );
+		}
+
+	examineAll( items, options.threads );
+
+	for ( std::size_t i = 0; i < items.size(); i++ )
+		if ( items[ i ].valid && selected( items[ i ].entry, pattern ) )
+			files.push_back( items[ i ].entry );
+
+	if ( !options.indexFile.empty() && !ec )
+		writeIndex( options.indexFile, dirString, dirTime, items );
+
+	LOG4CPP_DEBUG( logger, "Scanned " << items.size() << " entries of " << directory );
+	return false;
 }
 
 } } // namespace Ubitrack::Util
@@ -31,8 +31,10 @@
 #ifndef __UBITRACK_UTIL_GLOBFILES_H_INCLUDED__
 #define __UBITRACK_UTIL_GLOBFILES_H_INCLUDED__
 
+#include <ctime>
 #include <list>
 #include <string>
+#include <vector>
 
 
 // Needed until boost version 1.45 because otherwise the deprecated version 2 would be used 
@@ -40,6 +42,8 @@
 #undef  BOOST_FILESYSTEM_VERSION
 #define BOOST_FILESYSTEM_VERSION 3
 #include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+#include <boost/cstdint.hpp>
 
 #include <utCore.h>	// UBITRACK_EXPORT
 
@@ -61,6 +65,143 @@ UBITRACK_EXPORT void globFiles( const std::string& directory, const std::string
 UBITRACK_EXPORT void globFiles( const std::string& directory, const enum FilePattern pattern, std::list< boost::filesystem::path >& files );
 
 
+/**
+ * A file name pattern, compiled once and reused for many directories and files.
+ */
+class UBITRACK_EXPORT GlobPattern
+{
+public:
+	/**
+	 * @param patternString regular expression the whole file name must match
+	 * @param globDirectories also return all directories, regardless of the pattern
+	 */
+	explicit GlobPattern( const std::string& patternString, bool globDirectories = false );
+
+	/** the precompiled pattern of a \c FilePattern */
+	static const GlobPattern& get( FilePattern pattern );
+
+	/** true if a file name matches */
+	bool matches( const std::string& fileName ) const
+	{ return boost::regex_match( fileName, m_regex ); }
+
+	/** true if directories are returned as well */
+	bool globDirectories() const
+	{ return m_globDirectories; }
+
+	/** the regular expression */
+	const std::string& str() const
+	{ return m_string; }
+
+protected:
+	std::string m_string;
+	boost::regex m_regex;
+	bool m_globDirectories;
+};
+
+
+/** a file found by \c scanFiles */
+struct GlobEntry
+{
+	boost::filesystem::path path;
+
+	/** last modification time */
+	std::time_t mtime;
+
+	/** size in bytes, 0 for directories */
+	boost::uintmax_t size;
+
+	bool directory;
+};
+
+
+/**
+ * Compares file names in natural order, i.e. runs of digits by their numeric value,
+ * so that \c frame9.png comes before \c frame10.png.
+ */
+UBITRACK_EXPORT bool naturalLess( const std::string& a, const std::string& b );
+
+
+/**
+ * Result of \c scanFiles. The entries are sorted in natural order of their paths when they are
+ * accessed the first time, so callers that only need the count do not pay for sorting.
+ */
+class UBITRACK_EXPORT GlobFileList
+{
+public:
+	typedef std::vector< GlobEntry > Entries;
+
+	GlobFileList()
+		: m_sorted( true )
+	{}
+
+	std::size_t size() const
+	{ return m_entries.size(); }
+
+	bool empty() const
+	{ return m_entries.empty(); }
+
+	/** the entries in natural order */
+	const Entries& entries() const;
+
+	/** the entry at position \c i in natural order */
+	const GlobEntry& operator[]( std::size_t i ) const
+	{ return entries()[ i ]; }
+
+	/** the paths in natural order */
+	std::vector< boost::filesystem::path > paths() const;
+
+	/** the entries in the order they were found */
+	const Entries& unsorted() const
+	{ return m_entries; }
+
+	void push_back( const GlobEntry& entry );
+
+	void clear();
+
+protected:
+	mutable Entries m_entries;
+	mutable bool m_sorted;
+};
+
+
+/** options of \c scanFiles */
+struct GlobOptions
+{
+	GlobOptions()
+		: threads( 0 )
+	{}
+
+	/** number of threads examining the directory entries, 0 for the number of CPUs */
+	unsigned threads;
+
+	/**
+	 * file that keeps the entries of the directory between calls, none if empty. When the
+	 * modification time of the directory has not changed since the index was written, the
+	 * entries are taken from the index without reading the directory. Files that are
+	 * rewritten in place do not change the directory and are not detected.
+	 */
+	std::string indexFile;
+};
+
+
+/**
+ * Retrieves all files in a directory whose names match a precompiled pattern.
+ *
+ * Unlike \c globFiles, the modification time and size of each entry are queried by several
+ * threads at once, which is much faster for directories of many files on network storage.
+ * With an index file, unchanged directories are enumerated without accessing them at all.
+ *
+ * @param directory directory to scan. A file is returned as the only entry.
+ * @param pattern file name pattern
+ * @param files receives the matching entries, in addition to its previous content
+ * @param options threads and index file
+ * @return true if the entries were taken from the index
+ * @throws Util::Exception if the directory does not exist
+ */
+UBITRACK_EXPORT bool scanFiles( const std::string& directory, const GlobPattern& pattern, GlobFileList& files,
+	const GlobOptions& options = GlobOptions() );
+
+
 } } // namespace Ubitrack::Util
 
 #endif
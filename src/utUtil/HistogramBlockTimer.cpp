@@ -0,0 +1,181 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Implementation of a thread-safe timer that records the latency distribution of code blocks
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#include "HistogramBlockTimer.h"
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+/// source of the shard indices of new threads
+boost::atomic< unsigned > g_nextShard( 0 );
+
+#if defined( _MSC_VER )
+__declspec( thread ) unsigned t_shard = 0;
+#else
+__thread unsigned t_shard = 0;
+#endif
+
+} // anonymous namespace
+
+
+HistogramBlockTimer::HistogramBlockTimer( const std::string& sName, const std::string& sLoggingCategory )
+	: m_sName( sName )
+	, m_pLogger( sLoggingCategory.empty() ? 0 : &log4cpp::Category::getInstance( sLoggingCategory ) )
+	, m_startTime( getHighPerformanceCounter() )
+{
+	init();
+}
+
+
+HistogramBlockTimer::HistogramBlockTimer( const std::string& sName, log4cpp::Category& logger )
+	: m_sName( sName )
+	, m_pLogger( &logger )
+	, m_startTime( getHighPerformanceCounter() )
+{
+	init();
+}
+
+
+HistogramBlockTimer::~HistogramBlockTimer()
+{
+	TimerRegistry::instance().remove( this );
+
+	if ( m_pLogger && getStatistics().runs )
+		report();
+}
+
+
+void HistogramBlockTimer::init()
+{
+	m_sCodeFile.store( 0 );
+	m_nCodeLine.store( 0 );
+	for ( unsigned s = 0; s < NShards; s++ )
+	{
+		m_shards[ s ].runs.store( 0 );
+		m_shards[ s ].ticks.store( 0 );
+		m_shards[ s ].max.store( 0 );
+		for ( unsigned i = 0; i < NBuckets; i++ )
+			m_shards[ s ].buckets[ i ].store( 0 );
+	}
+	TimerRegistry::instance().add( this );
+}
+
+
+unsigned HistogramBlockTimer::shardIndex()
+{
+	// 0 marks threads that have not been assigned a shard yet
+	if ( !t_shard )
+		t_shard = g_nextShard.fetch_add( 1, boost::memory_order_relaxed ) % NShards + 1;
+	return t_shard - 1;
+}
+
+
+boost::uint64_t HistogramBlockTimer::bucketUpperBound( unsigned i )
+{
+	if ( i < 8 )
+		return i;
+	const unsigned shift = i / 8 - 1;
+	const boost::uint64_t lower = static_cast< boost::uint64_t >( 8 + i % 8 ) << shift;
+	return lower + ( ( static_cast< boost::uint64_t >( 1 ) << shift ) - 1 );
+}
+
+
+HistogramBlockTimer::Statistics HistogramBlockTimer::getStatistics() const
+{
+	boost::uint64_t runs = 0;
+	boost::uint64_t ticks = 0;
+	boost::uint64_t max = 0;
+	boost::uint64_t buckets[ NBuckets ] = { 0 };
+	for ( unsigned s = 0; s < NShards; s++ )
+	{
+		const Shard& shard( m_shards[ s ] );
+		ticks += shard.ticks.load( boost::memory_order_relaxed );
+		max = std::max( max, shard.max.load( boost::memory_order_relaxed ) );
+		for ( unsigned i = 0; i < NBuckets; i++ )
+		{
+			// count the runs from the buckets, so percentiles are consistent with concurrent updates
+			const boost::uint64_t n = shard.buckets[ i ].load( boost::memory_order_relaxed );
+			buckets[ i ] += n;
+			runs += n;
+		}
+	}
+
+	const double msPerTick = 1000.0 / getHighPerformanceFrequency();
+	Statistics stats;
+	stats.runs = static_cast< std::size_t >( runs );
+	stats.total = ticks * msPerTick;
+	stats.avg = runs ? stats.total / runs : 0.0;
+	stats.max = max * msPerTick;
+
+	// smallest bucket covering the given fraction of runs, but never above the exact maximum
+	const double quantiles[ 3 ] = { 0.5, 0.99, 0.999 };
+	double* results[ 3 ] = { &stats.p50, &stats.p99, &stats.p999 };
+	unsigned i = 0;
+	boost::uint64_t count = 0;
+	for ( unsigned q = 0; q < 3; q++ )
+	{
+		const boost::uint64_t rank = static_cast< boost::uint64_t >( quantiles[ q ] * runs + 0.999999 );
+		while ( i < NBuckets && count + buckets[ i ] < rank )
+			count += buckets[ i++ ];
+		*results[ q ] = runs ? std::min( bucketUpperBound( std::min( i, NBuckets - 1 ) ), max ) * msPerTick : 0.0;
+	}
+
+	return stats;
+}
+
+
+void HistogramBlockTimer::report() const
+{
+	if ( !m_pLogger )
+		return;
+
+	std::ostringstream s;
+	s << *this;
+	m_pLogger->log( log4cpp::Priority::info, s.str(), getCodeFile().c_str(), getCodeLine() );
+}
+
+
+std::ostream& operator<<( std::ostream& s, const HistogramBlockTimer& t )
+{
+	const HistogramBlockTimer::Statistics stats( t.getStatistics() );
+	return s << std::setw( 30 ) << t.getName()
+		<< " runs: " << std::setw( 6 ) << stats.runs
+		<< ", total: " << std::setw( 7 ) << stats.total << "ms"
+		<< ", avg: " << std::setw( 7 ) << stats.avg << "ms"
+		<< ", p50: " << std::setw( 7 ) << stats.p50 << "ms"
+		<< ", p99: " << std::setw( 7 ) << stats.p99 << "ms"
+		<< ", p99.9: " << std::setw( 7 ) << stats.p999 << "ms"
+		<< ", max: " << std::setw( 7 ) << stats.max << "ms";
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,269 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Thread-safe timer that records the latency distribution of code blocks
+ */
+
+#ifndef __UBITRACK_UTIL_HISTOGRAM_BLOCK_TIMER_H_INCLUDED__
+#define __UBITRACK_UTIL_HISTOGRAM_BLOCK_TIMER_H_INCLUDED__
+
+#include <string>
+#include <iostream>
+#include <log4cpp/Category.hh>
+#include <boost/utility.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <utCore.h>
+#include <utUtil/OS.h>
+#include <utUtil/TimerRegistry.h>
+#include <utUtil/SamplingProfiler.h>
+
+namespace Ubitrack { namespace Util {
+
+// forward decl
+class HistogramBlockTimer;
+
+
+/** stream output operator for HistogramBlockTimers */
+UBITRACK_EXPORT std::ostream& operator<<( std::ostream& s, const HistogramBlockTimer& t );
+
+
+/**
+ * Times a block of execution from any number of threads and records a histogram of the run times.
+ *
+ * Unlike \c BlockTimer, which only sums up the runs in plain members, each thread adds its
+ * measurements to one of \c NShards shards with relaxed atomic operations, so threads
+ * neither lock nor write to the same cache lines (unless more than \c NShards threads use
+ * the timer). The run times are sorted into log-linear buckets with 8 sub-buckets per power
+ * of two, so the reported percentiles are at most 12.5% above the exact values. The maximum is
+ * exact.
+ *
+ * The shards are merged when the statistics are requested, which is safe while other threads
+ * keep timing. The result is printed to the logger on destruction or by \c report, and the
+ * timer is part of the snapshots of the \c TimerRegistry.
+ * @verbatim
+static Util::HistogramBlockTimer g_timer( "track", "Ubitrack.Timing" );
+{
+	UBITRACK_TIME_HISTOGRAM( g_timer );
+	...
+}
+@endverbatim
+ */
+class UBITRACK_EXPORT HistogramBlockTimer
+	: private boost::noncopyable
+{
+public:
+	/// number of shards, threads are distributed round-robin
+	static const unsigned NShards = 8;
+
+	/// number of buckets: 8 exact ones for small values, then 8 per power of two
+	static const unsigned NBuckets = 8 * 62;
+
+	/** times a block of execution */
+	class Time
+		: public boost::noncopyable
+	{
+	public:
+		/**
+		 * Starts timing of a block of execution.
+		 * @param rTimer HistogramBlockTimer object in which to store the result
+		 */
+		Time( HistogramBlockTimer& rTimer )
+			: m_rTimer( rTimer )
+			, m_bProfiled( SamplingProfiler::push( rTimer.getName().c_str() ) )
+			, m_startTime( getHighPerformanceCounter() )
+		{}
+
+		/**
+		 * Starts timing of a block of execution and sets the code location if not already set.
+		 * Internally used by the UBITRACK_TIME_HISTOGRAM macro.
+		 */
+		Time( HistogramBlockTimer& rTimer, const char* sCodeFile, unsigned nCodeLine )
+			: m_rTimer( rTimer )
+			, m_bProfiled( SamplingProfiler::push( rTimer.getName().c_str() ) )
+			, m_startTime( getHighPerformanceCounter() )
+		{
+			m_rTimer.setCodeLocation( sCodeFile, nCodeLine );
+		}
+
+		/**
+		 * Stops execution and stores the result in the timer given in the constructor
+		 */
+		~Time()
+		{
+			m_rTimer.addMeasurement( getHighPerformanceCounter() - m_startTime );
+			if ( m_bProfiled )
+				SamplingProfiler::pop();
+		}
+
+	protected:
+		HistogramBlockTimer& m_rTimer;
+		/// the name of the timer is on the stack of the sampling profiler
+		const bool m_bProfiled;
+		unsigned long long m_startTime;
+	};
+
+	/** merged statistics of all threads, times in ms */
+	struct Statistics
+	{
+		std::size_t runs;
+		double total;
+		double avg;
+		double p50;
+		double p99;
+		double p999;
+		double max;
+	};
+
+	/**
+	 * constructs an empty timer
+	 * @param sName name of the timer (for display)
+	 * @param sLoggingCategory log4cpp category to which to print the result when the timer object leaves scope
+	 */
+	HistogramBlockTimer( const std::string& sName, const std::string& sLoggingCategory = std::string() );
+
+	/**
+	 * constructs an empty timer
+	 * @param sName name of the timer (for display)
+	 * @param logger log4cpp logger to which to print the result when the timer object leaves scope
+	 */
+	HistogramBlockTimer( const std::string& sName, log4cpp::Category& logger );
+
+	/** destructor, prints result if a logger was given to the constructor */
+	~HistogramBlockTimer();
+
+	/** adds a timer run, may be called concurrently */
+	void addMeasurement( unsigned long long ticks )
+	{
+		Shard& shard( m_shards[ shardIndex() ] );
+		shard.runs.fetch_add( 1, boost::memory_order_relaxed );
+		shard.ticks.fetch_add( ticks, boost::memory_order_relaxed );
+		shard.buckets[ bucket( ticks ) ].fetch_add( 1, boost::memory_order_relaxed );
+
+		boost::uint64_t max = shard.max.load( boost::memory_order_relaxed );
+		while ( ticks > max && !shard.max.compare_exchange_weak( max, ticks, boost::memory_order_relaxed ) )
+			;
+	}
+
+	const std::string& getName() const
+	{ return m_sName; }
+
+	/** code location of the first timed block, empty if unknown */
+	std::string getCodeFile() const
+	{
+		const char* sCodeFile = m_sCodeFile.load( boost::memory_order_relaxed );
+		return sCodeFile ? sCodeFile : std::string();
+	}
+
+	/** code location of the first timed block */
+	unsigned getCodeLine() const
+	{ return m_nCodeLine.load( boost::memory_order_relaxed ); }
+
+	/** returns the time when the timer was started */
+	unsigned long long getStartTime() const
+	{ return m_startTime; }
+
+	/** merges the shards, may be called while other threads add measurements */
+	Statistics getStatistics() const;
+
+	/** prints the current statistics to the logger given in the constructor */
+	void report() const;
+
+	/** sets the code location printed with the result, if not already set */
+	void setCodeLocation( const char* sCodeFile, unsigned nCodeLine )
+	{
+		const char* expected = 0;
+		if ( !m_sCodeFile.load( boost::memory_order_relaxed ) &&
+			m_sCodeFile.compare_exchange_strong( expected, sCodeFile, boost::memory_order_relaxed ) )
+			m_nCodeLine.store( nCodeLine, boost::memory_order_relaxed );
+	}
+
+	/** index of the bucket containing the value \c ticks */
+	static unsigned bucket( boost::uint64_t ticks )
+	{
+		if ( ticks < 8 )
+			return static_cast< unsigned >( ticks );
+		const unsigned e = highestBit( ticks );
+		return ( e - 2 ) * 8 + static_cast< unsigned >( ( ticks >> ( e - 3 ) ) & 7 );
+	}
+
+	/** the largest value in bucket \c i */
+	static boost::uint64_t bucketUpperBound( unsigned i );
+
+protected:
+	/// @internal counters of one shard, on separate cache lines
+	struct Shard
+	{
+		boost::atomic< boost::uint64_t > runs;
+		boost::atomic< boost::uint64_t > ticks;
+		boost::atomic< boost::uint64_t > max;
+		boost::atomic< boost::uint64_t > buckets[ NBuckets ];
+		char padding[ 64 ];
+	};
+
+	/// shard of the calling thread
+	static unsigned shardIndex();
+
+	/// index of the highest bit set, v must not be 0
+	static unsigned highestBit( boost::uint64_t v )
+	{
+#ifdef __GNUC__
+		return 63 - __builtin_clzll( v );
+#else
+		unsigned e = 0;
+		while ( v >>= 1 )
+			e++;
+		return e;
+#endif
+	}
+
+	void init();
+
+	const std::string m_sName;
+	log4cpp::Category* m_pLogger;
+	boost::atomic< const char* > m_sCodeFile;
+	boost::atomic< unsigned > m_nCodeLine;
+	const unsigned long long m_startTime;
+
+	Shard m_shards[ NShards ];
+};
+
+
+#ifndef UBITRACK_NOTIME
+
+	/**
+	 * Macro for convenient timing with a HistogramBlockTimer.
+	 * Add to beginning of code block whose execution time you want to measure.
+	 * @param timer HistogramBlockTimer for aggregation of results
+	 */
+	#define UBITRACK_TIME_HISTOGRAM( timer ) Ubitrack::Util::HistogramBlockTimer::Time _timeVar_##timer( timer, __FILE__, __LINE__ )
+#else
+	#define UBITRACK_TIME_HISTOGRAM( timer )
+#endif
+
+
+} } // namespace Ubitrack::Util
+
+#endif //__UBITRACK_UTIL_HISTOGRAM_BLOCK_TIMER_H_INCLUDED__
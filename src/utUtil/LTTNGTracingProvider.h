@@ -142,6 +142,104 @@ TRACEPOINT_EVENT(
         )
 )
 
+TRACEPOINT_EVENT(
+        ubitrack,
+        optimization_lm_iteration,
+        TP_ARGS(
+            unsigned int, iteration,
+            double, residual,
+            double, lambda,
+            int, solver
+        ),
+        TP_FIELDS(
+            ctf_integer(unsigned int, iteration_field, iteration)
+            ctf_float(double, residual_field, residual)
+            ctf_float(double, lambda_field, lambda)
+            ctf_integer(int, solver_field, solver)
+        )
+)
+
+TRACEPOINT_EVENT(
+        ubitrack,
+        optimization_ransac,
+        TP_ARGS(
+            unsigned int, iterations,
+            unsigned int, inliers,
+            unsigned int, values
+        ),
+        TP_FIELDS(
+            ctf_integer(unsigned int, iterations_field, iterations)
+            ctf_integer(unsigned int, inliers_field, inliers)
+            ctf_integer(unsigned int, values_field, values)
+        )
+)
+
+TRACEPOINT_EVENT(
+        ubitrack,
+        tracking_kalman_update,
+        TP_ARGS(
+            unsigned long long int, timestamp,
+            const char*, update_type,
+            unsigned int, dimension
+        ),
+        TP_FIELDS(
+            ctf_integer(unsigned long long int, timestamp_field, timestamp)
+            ctf_string(update_type_field, update_type)
+            ctf_integer(unsigned int, dimension_field, dimension)
+        )
+)
+
+TRACEPOINT_EVENT(
+        ubitrack,
+        stochastic_clustering_iteration,
+        TP_ARGS(
+            const char*, algorithm,
+            unsigned int, iteration,
+            unsigned int, clusters,
+            double, value
+        ),
+        TP_FIELDS(
+            ctf_string(algorithm_field, algorithm)
+            ctf_integer(unsigned int, iteration_field, iteration)
+            ctf_integer(unsigned int, clusters_field, clusters)
+            ctf_float(double, value_field, value)
+        )
+)
+
+TRACEPOINT_EVENT(
+        ubitrack,
+        span_begin,
+        TP_ARGS(
+            const char*, name,
+            unsigned long long int, attr0,
+            unsigned long long int, attr1,
+            unsigned long long int, attr2
+        ),
+        TP_FIELDS(
+            ctf_string(name_field, name)
+            ctf_integer(unsigned long long int, attr0_field, attr0)
+            ctf_integer(unsigned long long int, attr1_field, attr1)
+            ctf_integer(unsigned long long int, attr2_field, attr2)
+        )
+)
+
+TRACEPOINT_EVENT(
+        ubitrack,
+        span_end,
+        TP_ARGS(
+            const char*, name,
+            unsigned long long int, attr0,
+            unsigned long long int, attr1,
+            unsigned long long int, attr2
+        ),
+        TP_FIELDS(
+            ctf_string(name_field, name)
+            ctf_integer(unsigned long long int, attr0_field, attr0)
+            ctf_integer(unsigned long long int, attr1_field, attr1)
+            ctf_integer(unsigned long long int, attr2_field, attr2)
+        )
+)
+
 #endif /* UBITRACK_LTTNGTRACINGPROVIDER_H */
 
 #include <lttng/tracepoint-event.h>
@@ -0,0 +1,100 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Logger handles that look up their log4cpp category on first use
+ *
+ * A namespace-scope <tt>static log4cpp::Category& logger( log4cpp::Category::getInstance( ... ) )</tt>
+ * looks up the category during static initialization, which takes the lock and searches the map
+ * of log4cpp in every translation unit defining it, before \c main. A \c LazyLogger only stores
+ * the name and looks up the category on the first log statement:
+ * @code
+ * static Ubitrack::Util::LazyLogger logger( "Ubitrack.Tracking.PoseKalmanFilter" );
+ * ...
+ * LOG4CPP_DEBUG( logger, "state: " << state );
+ * @endcode
+ * It works with the \c LOG4CPP_* macros and converts to <tt>log4cpp::Category&</tt>.
+ */
+
+#ifndef __UBITRACK_UTIL_LAZYLOGGER_H_INCLUDED__
+#define __UBITRACK_UTIL_LAZYLOGGER_H_INCLUDED__
+
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/utility.hpp>
+
+#include <log4cpp/Category.hh>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Handle of a log4cpp category that is looked up on first use and cached.
+ */
+class LazyLogger
+	: private boost::noncopyable
+{
+public:
+	/** @param sName name of the category, a string literal or other string that outlives the logger */
+	explicit LazyLogger( const char* sName )
+		: m_sName( sName )
+		, m_pCategory( 0 )
+	{}
+
+	/** the category, looked up on the first call. Concurrent first calls get the same category. */
+	log4cpp::Category& category() const
+	{
+		log4cpp::Category* pCategory = m_pCategory.load( boost::memory_order_acquire );
+		if ( !pCategory )
+		{
+			pCategory = &log4cpp::Category::getInstance( m_sName );
+			m_pCategory.store( pCategory, boost::memory_order_release );
+		}
+		return *pCategory;
+	}
+
+	operator log4cpp::Category&() const
+	{ return category(); }
+
+	/** used by the \c LOG4CPP_* macros */
+	bool isPriorityEnabled( log4cpp::Priority::Value priority ) const
+	{ return category().isPriorityEnabled( priority ); }
+
+	/** used by the \c LOG4CPP_* macros */
+	void log( log4cpp::Priority::Value priority, const std::string& message, const char* file = 0, unsigned line = 0 ) const
+	{ category().log( priority, message, file, line ); }
+
+	/** name of the category */
+	const char* name() const
+	{ return m_sName; }
+
+private:
+	const char* m_sName;
+	mutable boost::atomic< log4cpp::Category* > m_pCategory;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -49,13 +49,104 @@
 #pragma warning( pop )
 #endif
 
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include "Logging.h"
+#include "AsyncAppender.h"
 
 
 
 namespace Ubitrack { namespace Util {
 
+namespace {
+
+/// asynchronous appenders installed by initLogging, never deleted like the configured appenders
+std::vector< AsyncAppender* > g_asyncAppenders;
+boost::mutex g_asyncMutex;
+
+/// writes the queued events and switches the appenders to synchronous writing
+void closeAsyncAppenders()
+{
+	boost::mutex::scoped_lock lock( g_asyncMutex );
+	for ( std::size_t i = 0; i < g_asyncAppenders.size(); i++ )
+		g_asyncAppenders[ i ]->close();
+}
+
+std::string trim( const std::string& s )
+{
+	const std::string::size_type begin = s.find_first_not_of( " \t\r" );
+	if ( begin == std::string::npos )
+		return std::string();
+	return s.substr( begin, s.find_last_not_of( " \t\r" ) - begin + 1 );
+}
+
+/// reads the ubitrack.async keys, which log4cpp ignores
+bool readAsyncSettings( const char* sConfigFile, std::size_t& queueSize, AsyncAppender::OverflowPolicy& policy )
+{
+	bool enabled = false;
+	std::ifstream file( sConfigFile );
+	std::string line;
+	while ( std::getline( file, line ) )
+	{
+		const std::string::size_type eq = line.find( '=' );
+		if ( eq == std::string::npos || trim( line ).compare( 0, 1, "#" ) == 0 )
+			continue;
+
+		const std::string key = trim( line.substr( 0, eq ) );
+		const std::string value = trim( line.substr( eq + 1 ) );
+		if ( key == "ubitrack.async" )
+			enabled = value == "true";
+		else if ( key == "ubitrack.async.queueSize" )
+			queueSize = std::strtoul( value.c_str(), 0, 10 );
+		else if ( key == "ubitrack.async.policy" )
+			policy = value == "block" ? AsyncAppender::BlockWhenFull : AsyncAppender::DropWhenFull;
+	}
+	return enabled;
+}
+
+/// replaces every appender of every category by an asynchronous one writing to it
+void installAsyncAppenders( const std::size_t queueSize, const AsyncAppender::OverflowPolicy policy )
+{
+	boost::mutex::scoped_lock lock( g_asyncMutex );
+	std::map< log4cpp::Appender*, AsyncAppender* > wrapped;
+	boost::scoped_ptr< std::vector< log4cpp::Category* > > categories( log4cpp::Category::getCurrentCategories() );
+	for ( std::size_t i = 0; i < categories->size(); i++ )
+	{
+		log4cpp::Category* category = ( *categories )[ i ];
+		const log4cpp::AppenderSet appenders = category->getAllAppenders();
+		for ( log4cpp::AppenderSet::const_iterator it = appenders.begin(); it != appenders.end(); ++it )
+		{
+			// removing an owned appender would delete it
+			if ( dynamic_cast< AsyncAppender* >( *it ) || category->ownsAppender( *it ) )
+				continue;
+
+			AsyncAppender*& async = wrapped[ *it ];
+			if ( !async )
+			{
+				async = new AsyncAppender( ( *it )->getName() + ".async", **it, queueSize, policy );
+				g_asyncAppenders.push_back( async );
+			}
+			category->removeAppender( *it );
+			category->addAppender( *async );
+		}
+	}
+
+	// before the destructors of log4cpp run
+	static bool registered = false;
+	if ( !registered )
+		std::atexit( &closeAsyncAppenders );
+	registered = true;
+}
+
+} // anonymous namespace
+
 // Initializes the logger
 void initLogging( const char* sConfigFile )
 {
@@ -72,10 +163,18 @@ void initLogging( const char* sConfigFile )
 	log4cpp::Category::getInstance( "Ubitrack.Events" ).setPriority( log4cpp::Priority::NOTICE ); // default: NOTICE
 
 	#else
+	// appenders of a previous configuration continue synchronously
+	closeAsyncAppenders();
+
 	// try to initialize logging from file
 	try
 	{ 
 		log4cpp::PropertyConfigurator::configure( sConfigFile ); 
+
+		std::size_t queueSize = 8192;
+		AsyncAppender::OverflowPolicy policy = AsyncAppender::DropWhenFull;
+		if ( readAsyncSettings( sConfigFile, queueSize, policy ) )
+			installAsyncAppenders( queueSize, policy );
 		return;
 	}
 	catch ( ... )
@@ -95,4 +194,12 @@ void initLogging( const char* sConfigFile )
 	#endif
 }
 
+
+void flushLogging()
+{
+	boost::mutex::scoped_lock lock( g_asyncMutex );
+	for ( std::size_t i = 0; i < g_asyncAppenders.size(); i++ )
+		g_asyncAppenders[ i ]->flush();
+}
+
 } } // namespace Ubitrack::Util
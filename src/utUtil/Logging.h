@@ -35,9 +35,20 @@
 
 namespace Ubitrack { namespace Util {
 
-/** Initializes the logger */
+/**
+ * Initializes the logger from a log4cpp property file, or logs to stderr if it cannot be read.
+ *
+ * When the file contains \c ubitrack.async=true, every configured appender is wrapped in an
+ * \c AsyncAppender, so the logging threads do not wait for the formatting and the I/O. Further
+ * keys are \c ubitrack.async.queueSize (default 8192 events) and \c ubitrack.async.policy,
+ * \c drop (default) or \c block when the queue is full. The queued events are written when
+ * the program exits.
+ */
 void UBITRACK_EXPORT initLogging( const char* sConfigFile = "log4cpp.conf" );
 
+/** Waits until the events of the asynchronous appenders have been written, e.g. before an abort */
+void UBITRACK_EXPORT flushLogging();
+
 } } // namespace Ubitrack::Util
 
 #endif
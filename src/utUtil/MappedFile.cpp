@@ -0,0 +1,130 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Read-only memory mapping of files
+ */
+
+#include "MappedFile.h"
+#include "Exception.h"
+
+#ifdef _WIN32
+#include "CleanWindows.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Ubitrack { namespace Util {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile( const std::string& fileName )
+	: m_data( 0 )
+	, m_size( 0 )
+	, m_file( INVALID_HANDLE_VALUE )
+	, m_mapping( 0 )
+{
+	m_file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( m_file == INVALID_HANDLE_VALUE )
+		UBITRACK_THROW( "Could not open file " + fileName + " for reading" );
+
+	LARGE_INTEGER size;
+	if ( !GetFileSizeEx( m_file, &size ) )
+	{
+		CloseHandle( m_file );
+		UBITRACK_THROW( "Could not determine the size of " + fileName );
+	}
+	m_size = static_cast< std::size_t >( size.QuadPart );
+	if ( m_size == 0 )
+		return;
+
+	m_mapping = CreateFileMappingA( m_file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( m_mapping )
+		m_data = static_cast< const unsigned char* >( MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 ) );
+	if ( !m_data )
+	{
+		if ( m_mapping )
+			CloseHandle( m_mapping );
+		CloseHandle( m_file );
+		UBITRACK_THROW( "Could not map file " + fileName );
+	}
+}
+
+
+MappedFile::~MappedFile()
+{
+	if ( m_data )
+		UnmapViewOfFile( m_data );
+	if ( m_mapping )
+		CloseHandle( m_mapping );
+	if ( m_file != INVALID_HANDLE_VALUE )
+		CloseHandle( m_file );
+}
+
+#else // unix
+
+MappedFile::MappedFile( const std::string& fileName )
+	: m_data( 0 )
+	, m_size( 0 )
+{
+	const int fd = open( fileName.c_str(), O_RDONLY );
+	if ( fd < 0 )
+		UBITRACK_THROW( "Could not open file " + fileName + " for reading" );
+
+	struct stat info;
+	if ( fstat( fd, &info ) != 0 )
+	{
+		close( fd );
+		UBITRACK_THROW( "Could not determine the size of " + fileName );
+	}
+	m_size = static_cast< std::size_t >( info.st_size );
+
+	if ( m_size > 0 )
+	{
+		void* p = mmap( 0, m_size, PROT_READ, MAP_SHARED, fd, 0 );
+		if ( p == MAP_FAILED )
+		{
+			close( fd );
+			UBITRACK_THROW( "Could not map file " + fileName );
+		}
+		m_data = static_cast< const unsigned char* >( p );
+	}
+
+	// the mapping stays valid after closing the descriptor
+	close( fd );
+}
+
+
+MappedFile::~MappedFile()
+{
+	if ( m_data )
+		munmap( const_cast< unsigned char* >( m_data ), m_size );
+}
+
+#endif
+
+} } // namespace Ubitrack::Util
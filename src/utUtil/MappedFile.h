@@ -0,0 +1,76 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Read-only memory mapping of files
+ */
+
+#ifndef __UBITRACK_UTIL_MAPPEDFILE_H_INCLUDED__
+#define __UBITRACK_UTIL_MAPPEDFILE_H_INCLUDED__
+
+#include <string>
+
+#include <boost/utility.hpp>
+
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Maps a whole file read-only into memory. The operating system loads the pages
+ * on first access, so opening even very large files is cheap.
+ *
+ * Throws a \c Util::Exception if the file cannot be opened or mapped.
+ */
+class UBITRACK_EXPORT MappedFile
+	: private boost::noncopyable
+{
+public:
+	/** maps the file \c fileName */
+	explicit MappedFile( const std::string& fileName );
+
+	/** unmaps the file */
+	~MappedFile();
+
+	/** beginning of the mapped file, 0 for empty files */
+	const unsigned char* data() const
+	{ return m_data; }
+
+	/** size of the file in bytes */
+	std::size_t size() const
+	{ return m_size; }
+
+protected:
+	const unsigned char* m_data;
+	std::size_t m_size;
+
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#endif
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,408 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Lightweight reusable binary archive for boost::serialization
+ *
+ * \c MessageOArchive and \c MessageIArchive call the same \c serialize methods as the boost
+ * archives, but are meant for many small messages, e.g. measurements passed over a bridge:
+ * - no object tracking, no class information and no header, only the values are stored, so
+ *   pointers are not supported and the \c BOOST_CLASS_VERSION of the reading side must match
+ * - no streams and therefore no locale setup, the output archive appends to a buffer it owns
+ *   and the input archive reads from memory
+ * - both can be reset and reused, the output buffer keeps its capacity between messages
+ * - numbers are copied in the byte order and size of the host, \c Math::Vector and
+ *   \c Math::Matrix as one block of elements, so only processes on the same platform
+ *   can exchange messages. Use \c PortableBinaryOArchive for files.
+ *
+ * @code
+ * Util::MessageOArchive out; // one per connection
+ * out.reset();
+ * out << pose;
+ * send( out.data(), out.size() );
+ *
+ * Util::MessageIArchive in( received, nReceived );
+ * in >> pose;
+ * @endcode
+ */
+
+#ifndef __UBITRACK_UTIL_MESSAGEARCHIVE_H_INCLUDED__
+#define __UBITRACK_UTIL_MESSAGEARCHIVE_H_INCLUDED__
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/mpl/bool.hpp>
+#include <boost/type_traits.hpp>
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/item_version_type.hpp>
+
+#include <utUtil/Exception.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Quaternion.h>
+
+namespace Ubitrack { namespace Util {
+
+/// @internal true for the types that are copied as bytes
+template< typename T >
+struct MessageArchiveBytes
+	: public boost::mpl::bool_< boost::is_arithmetic< T >::value || boost::is_enum< T >::value >
+{};
+
+
+/**
+ * Writes objects to a reusable buffer.
+ * Provides an archive class for boost::serialization.
+ */
+class MessageOArchive
+{
+public:
+	/**
+	 * creates an empty archive
+	 * @param capacity number of bytes to reserve
+	 */
+	explicit MessageOArchive( const std::size_t capacity = 256 )
+	{ m_data.reserve( capacity ); }
+
+	/** removes the written data, the memory is kept for the next message */
+	void reset()
+	{ m_data.clear(); }
+
+	/** the written bytes, valid until the next write or \c reset */
+	const char* data() const
+	{ return m_data.empty() ? 0 : &m_data[ 0 ]; }
+
+	/** number of written bytes */
+	std::size_t size() const
+	{ return m_data.size(); }
+
+	/** the buffer, e.g. to swap it with a message queue */
+	std::vector< char >& buffer()
+	{ return m_data; }
+
+	/// forward << to &
+	template< class T >
+	MessageOArchive& operator<<( const T& v )
+	{ return *this & v; }
+
+	/// write operator for numbers and classes (calls serialize)
+	template< class T >
+	MessageOArchive& operator&( const T& v )
+	{ save( v, MessageArchiveBytes< T >() ); return *this; }
+
+	/// write operator for strings
+	MessageOArchive& operator&( const std::string& v )
+	{
+		writeSize( v.size() );
+		writeBytes( v.data(), v.size() );
+		return *this;
+	}
+
+	/// write operator for std::vector
+	template< class T, class A >
+	MessageOArchive& operator&( const std::vector< T, A >& v )
+	{
+		writeSize( v.size() );
+		if ( !v.empty() )
+			saveArray( &v[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// write operator for vectors, dynamic vectors start with their size
+	template< class T, std::size_t N >
+	MessageOArchive& operator&( const Math::Vector< T, N >& v )
+	{
+		if ( N == 0 )
+			writeSize( v.size() );
+		if ( v.size() )
+			saveArray( &v.data()[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// write operator for matrices, dynamic matrices start with their dimensions
+	template< class T, std::size_t M, std::size_t N >
+	MessageOArchive& operator&( const Math::Matrix< T, M, N >& v )
+	{
+		if ( M * N == 0 )
+		{
+			writeSize( v.size1() );
+			writeSize( v.size2() );
+		}
+		if ( v.size1() * v.size2() )
+			saveArray( &v.data()[ 0 ], v.size1() * v.size2() );
+		return *this;
+	}
+
+	/// write operator for quaternions
+	MessageOArchive& operator&( const Math::Quaternion& v )
+	{
+		const double q[ 4 ] = { v.x(), v.y(), v.z(), v.w() };
+		writeBytes( q, sizeof( q ) );
+		return *this;
+	}
+
+	#if BOOST_VERSION >= 103500
+		/// write operator for collection_size_type
+		MessageOArchive& operator&( const boost::serialization::collection_size_type& v )
+		{ writeSize( v ); return *this; }
+	#endif
+	#if BOOST_VERSION >= 104400
+		/// write operator for item_version_type
+		MessageOArchive& operator&( const boost::serialization::item_version_type& v )
+		{ const unsigned int i = v; writeBytes( &i, sizeof( i ) ); return *this; }
+	#endif
+
+	/// let nvps through
+	template< class T >
+	MessageOArchive& operator&( const boost::serialization::nvp< T >& v )
+	{ return *this & v.const_value(); }
+
+	/// writes raw bytes
+	void save_binary( const void* p, std::size_t n )
+	{ writeBytes( p, n ); }
+
+	// required for boost::serialization
+	typedef boost::mpl::bool_<false> is_loading;
+	typedef boost::mpl::bool_<true> is_saving;
+	unsigned int get_library_version() const
+	{ return 0; }
+
+protected:
+	/// classes get the version of the writing program, it is not stored
+	template< class T >
+	void save( const T& v, boost::mpl::false_ )
+	{ boost::serialization::serialize( *this, const_cast< T& >( v ), boost::serialization::version< T >::value ); }
+
+	template< class T >
+	void save( const T& v, boost::mpl::true_ )
+	{ writeBytes( &v, sizeof( T ) ); }
+
+	/// writes n elements, numbers as one block
+	template< class T >
+	void saveArray( const T* p, const std::size_t n )
+	{
+		if ( MessageArchiveBytes< T >::value )
+			writeBytes( p, n * sizeof( T ) );
+		else
+			for ( std::size_t i = 0; i < n; i++ )
+				*this & p[ i ];
+	}
+
+	void writeSize( const boost::uint64_t n )
+	{ writeBytes( &n, sizeof( n ) ); }
+
+	void writeBytes( const void* p, const std::size_t n )
+	{
+		const char* c = static_cast< const char* >( p );
+		m_data.insert( m_data.end(), c, c + n );
+	}
+
+	/// the written data
+	std::vector< char > m_data;
+};
+
+
+/**
+ * Reads objects from a block of memory written by a \c MessageOArchive.
+ * Provides an archive class for boost::serialization.
+ */
+class MessageIArchive
+{
+public:
+	/** creates an archive without data, see \c reset */
+	MessageIArchive()
+		: m_pos( 0 )
+		, m_end( 0 )
+	{}
+
+	/**
+	 * creates an archive on a message, which must stay valid while it is read
+	 * @param p the message
+	 * @param n size of the message in bytes
+	 */
+	MessageIArchive( const void* p, const std::size_t n )
+	{ reset( p, n ); }
+
+	/** starts reading the next message */
+	void reset( const void* p, const std::size_t n )
+	{
+		m_pos = static_cast< const char* >( p );
+		m_end = m_pos + n;
+	}
+
+	/** number of bytes not read yet */
+	std::size_t remaining() const
+	{ return m_end - m_pos; }
+
+	/// forward >> to &
+	template< class T >
+	MessageIArchive& operator>>( T& v )
+	{ return *this & v; }
+
+	/// read operator for numbers and classes (calls serialize)
+	template< class T >
+	MessageIArchive& operator&( T& v )
+	{ load( v, MessageArchiveBytes< T >() ); return *this; }
+
+	/// read operator for strings
+	MessageIArchive& operator&( std::string& v )
+	{
+		const std::size_t n = readSize( 1 );
+		v.assign( m_pos, n );
+		m_pos += n;
+		return *this;
+	}
+
+	/// read operator for std::vector
+	template< class T, class A >
+	MessageIArchive& operator&( std::vector< T, A >& v )
+	{
+		v.resize( readSize( MessageArchiveBytes< T >::value ? sizeof( T ) : 1 ) );
+		if ( !v.empty() )
+			loadArray( &v[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// read operator for vectors
+	template< class T, std::size_t N >
+	MessageIArchive& operator&( Math::Vector< T, N >& v )
+	{
+		if ( N == 0 )
+			v.resize( readSize( sizeof( T ) ), false );
+		if ( v.size() )
+			loadArray( &v.data()[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// read operator for matrices
+	template< class T, std::size_t M, std::size_t N >
+	MessageIArchive& operator&( Math::Matrix< T, M, N >& v )
+	{
+		if ( M * N == 0 )
+		{
+			const std::size_t size1 = readSize( 1 );
+			const std::size_t size2 = readSize( 1 );
+			if ( size1 && size2 > remaining() / ( size1 * sizeof( T ) ) )
+				UBITRACK_THROW( "Unexpected end of message" );
+			v.resize( size1, size2, false );
+		}
+		if ( v.size1() * v.size2() )
+			loadArray( &v.data()[ 0 ], v.size1() * v.size2() );
+		return *this;
+	}
+
+	/// read operator for quaternions
+	MessageIArchive& operator&( Math::Quaternion& v )
+	{
+		double q[ 4 ];
+		readBytes( q, sizeof( q ) );
+		v = Math::Quaternion( q[ 0 ], q[ 1 ], q[ 2 ], q[ 3 ] );
+		return *this;
+	}
+
+	#if BOOST_VERSION >= 103500
+		/// read operator for collection_size_type
+		MessageIArchive& operator&( boost::serialization::collection_size_type& v )
+		{ v = boost::serialization::collection_size_type( readSize( 1 ) ); return *this; }
+	#endif
+	#if BOOST_VERSION >= 104400
+		/// read operator for item_version_type
+		MessageIArchive& operator&( boost::serialization::item_version_type& v )
+		{ unsigned int i; readBytes( &i, sizeof( i ) ); v = boost::serialization::item_version_type( i ); return *this; }
+	#endif
+
+	/// let const-nvps through
+	template< class T >
+	MessageIArchive& operator&( const boost::serialization::nvp< T >& v )
+	{ return *this & v.value(); }
+
+	/// reads raw bytes
+	void load_binary( void* p, std::size_t n )
+	{ readBytes( p, n ); }
+
+	// required for boost::serialization
+	typedef boost::mpl::bool_<true> is_loading;
+	typedef boost::mpl::bool_<false> is_saving;
+	unsigned int get_library_version() const
+	{ return 0; }
+	void reset_object_address( void*, void* )
+	{}
+
+protected:
+	/// classes get the version of the reading program
+	template< class T >
+	void load( T& v, boost::mpl::false_ )
+	{ boost::serialization::serialize( *this, v, boost::serialization::version< T >::value ); }
+
+	template< class T >
+	void load( T& v, boost::mpl::true_ )
+	{ readBytes( &v, sizeof( T ) ); }
+
+	/// reads n elements, numbers as one block
+	template< class T >
+	void loadArray( T* p, const std::size_t n )
+	{
+		if ( MessageArchiveBytes< T >::value )
+			readBytes( p, n * sizeof( T ) );
+		else
+			for ( std::size_t i = 0; i < n; i++ )
+				*this & p[ i ];
+	}
+
+	/**
+	 * reads a size and checks that the message has room for that many elements
+	 * of at least \c elementSize bytes, so corrupt messages do not allocate huge buffers
+	 */
+	std::size_t readSize( const std::size_t elementSize )
+	{
+		boost::uint64_t n;
+		readBytes( &n, sizeof( n ) );
+		if ( n > remaining() / elementSize )
+			UBITRACK_THROW( "Unexpected end of message" );
+		return static_cast< std::size_t >( n );
+	}
+
+	void readBytes( void* p, const std::size_t n )
+	{
+		if ( n > remaining() )
+			UBITRACK_THROW( "Unexpected end of message" );
+		std::memcpy( p, m_pos, n );
+		m_pos += n;
+	}
+
+	/// the next byte to read
+	const char* m_pos;
+
+	/// the end of the message
+	const char* m_end;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * A bounded queue that many threads append to without locks
+ */
+
+#ifndef __UBITRACK_UTIL_MPSCQUEUE_H_INCLUDED__
+#define __UBITRACK_UTIL_MPSCQUEUE_H_INCLUDED__
+
+#include <cstddef>
+
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/utility.hpp>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Bounded multi-producer single-consumer queue.
+ *
+ * Every slot carries a sequence number that tells whether it is free or filled in the current
+ * round, so producers only compete for the head index and never wait for each other or the
+ * consumer. \c push fails when the queue is full, it is up to the caller to drop the value or
+ * try again. \c pop must only be called by one thread at a time.
+ *
+ * \c T must be default constructible and copyable, values are copied in and out of the slots.
+ */
+template< class T >
+class MpscQueue
+	: private boost::noncopyable
+{
+public:
+	/** constructor, the capacity is rounded up to a power of two */
+	explicit MpscQueue( const std::size_t capacity )
+		: m_mask( 0 )
+		, m_head( 0 )
+		, m_tail( 0 )
+	{
+		std::size_t size = 2;
+		while ( size < capacity )
+			size *= 2;
+		m_mask = size - 1;
+
+		m_slots.reset( new Slot[ size ] );
+		for ( std::size_t i = 0; i < size; i++ )
+			m_slots[ i ].sequence.store( i, boost::memory_order_relaxed );
+	}
+
+	/** appends a value, returns false if the queue is full */
+	bool push( const T& value )
+	{
+		std::size_t pos = m_head.load( boost::memory_order_relaxed );
+		for ( ;; )
+		{
+			Slot& slot = m_slots[ pos & m_mask ];
+			const std::size_t sequence = slot.sequence.load( boost::memory_order_acquire );
+			const std::ptrdiff_t diff = static_cast< std::ptrdiff_t >( sequence - pos );
+			if ( diff == 0 )
+			{
+				// the slot is free, try to claim it
+				if ( m_head.compare_exchange_weak( pos, pos + 1, boost::memory_order_relaxed ) )
+				{
+					slot.value = value;
+					slot.sequence.store( pos + 1, boost::memory_order_release );
+					return true;
+				}
+			}
+			else if ( diff < 0 )
+				// the consumer has not taken the value of the previous round yet
+				return false;
+			else
+				// another producer claimed the slot
+				pos = m_head.load( boost::memory_order_relaxed );
+		}
+	}
+
+	/** takes the oldest value, returns false if the queue is empty */
+	bool pop( T& value )
+	{
+		Slot& slot = m_slots[ m_tail & m_mask ];
+		if ( slot.sequence.load( boost::memory_order_acquire ) != m_tail + 1 )
+			return false;
+
+		value = slot.value;
+		slot.sequence.store( m_tail + m_mask + 1, boost::memory_order_release );
+		m_tail++;
+		return true;
+	}
+
+	/** true if \c pop would fail, must be called by the consumer */
+	bool empty() const
+	{ return m_slots[ m_tail & m_mask ].sequence.load( boost::memory_order_acquire ) != m_tail + 1; }
+
+	/** number of values the queue can hold */
+	std::size_t capacity() const
+	{ return m_mask + 1; }
+
+protected:
+	/// @internal
+	struct Slot
+	{
+		boost::atomic< std::size_t > sequence;
+		T value;
+	};
+
+	boost::scoped_array< Slot > m_slots;
+	std::size_t m_mask;
+	boost::atomic< std::size_t > m_head;
+	/// only used by the consumer
+	std::size_t m_tail;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Implementation of the guard against heap allocations
+ */
+
+#include "NoAllocationGuard.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#include <boost/atomic.hpp>
+
+#if defined( __GLIBC__ )
+#include <execinfo.h>
+#elif defined( _WIN32 )
+#include "CleanWindows.h"
+#endif
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Util.NoAllocationGuard" );
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+/// maximum number of frames in the logged backtraces
+const int g_maxFrames = 32;
+
+// plain thread locals, so operator new can use them before any dynamic initialization
+#if defined( _MSC_VER )
+/// action of the innermost guard of the thread, -1 without guard
+__declspec( thread ) int t_action = -1;
+__declspec( thread ) unsigned long long t_violations = 0;
+/// set while a violation is logged, the logging allocates itself
+__declspec( thread ) bool t_reporting = false;
+#else
+__thread int t_action = -1;
+__thread unsigned long long t_violations = 0;
+__thread bool t_reporting = false;
+#endif
+
+boost::atomic< bool > g_operatorNewReports( false );
+
+void logViolation( const std::size_t bytes, const char* source )
+{
+	std::ostringstream s;
+	s << "Heap allocation of " << bytes << " bytes (" << source << ") in a region without allocations";
+
+#if defined( __GLIBC__ )
+	void* frames[ g_maxFrames ];
+	const int nFrames = backtrace( frames, g_maxFrames );
+	char** symbols = backtrace_symbols( frames, nFrames );
+	for ( int i = 2; i < nFrames; i++ )
+		s << "\n    " << ( symbols ? symbols[ i ] : "?" );
+	std::free( symbols );
+#elif defined( _WIN32 )
+	void* frames[ g_maxFrames ];
+	const USHORT nFrames = CaptureStackBackTrace( 2, g_maxFrames, frames, 0 );
+	for ( USHORT i = 0; i < nFrames; i++ )
+		s << "\n    " << frames[ i ];
+#endif
+
+	LOG4CPP_ERROR( logger, s.str() );
+}
+
+} // anonymous namespace
+
+
+NoAllocationGuard::NoAllocationGuard( Action action )
+	: m_previousAction( t_action )
+	, m_startViolations( t_violations )
+{
+	t_action = action;
+}
+
+
+NoAllocationGuard::~NoAllocationGuard()
+{
+	t_action = m_previousAction;
+}
+
+
+std::size_t NoAllocationGuard::violations() const
+{
+	return static_cast< std::size_t >( t_violations - m_startViolations );
+}
+
+
+bool NoAllocationGuard::active()
+{
+	return t_action >= 0;
+}
+
+
+void NoAllocationGuard::allocation( std::size_t bytes, const char* source )
+{
+	if ( t_action < 0 || t_reporting )
+		return;
+
+	t_violations++;
+	if ( t_action == Count )
+		return;
+
+	t_reporting = true;
+	try
+	{
+		logViolation( bytes, source );
+	}
+	catch ( ... )
+	{}
+	t_reporting = false;
+
+	if ( t_action == Abort )
+		std::abort();
+}
+
+
+bool NoAllocationGuard::operatorNewReports()
+{
+	return g_operatorNewReports.load( boost::memory_order_relaxed );
+}
+
+
+void NoAllocationGuard::setOperatorNewReports()
+{
+	g_operatorNewReports.store( true, boost::memory_order_relaxed );
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,112 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Diagnostic guard against heap allocations in real-time code
+ */
+
+#ifndef __UBITRACK_UTIL_NOALLOCATIONGUARD_H_INCLUDED__
+#define __UBITRACK_UTIL_NOALLOCATIONGUARD_H_INCLUDED__
+
+#include <cstddef>
+
+#include <boost/utility.hpp>
+
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Scoped region of a thread that must not allocate from the heap, e.g. the steady state of a
+ * 1 kHz control loop.
+ *
+ * While a guard exists on a thread, every heap allocation of that thread that is reported to
+ * \c NoAllocationGuard::allocation is a violation. Violations are counted and, depending on the
+ * action of the innermost guard, logged with a backtrace to \c Ubitrack.Util.NoAllocationGuard
+ * or logged and trapped with \c abort, so a debugger stops at the allocation.
+ *
+ * Allocations are reported
+ * - by the tracked containers if the library is built with \c UBITRACK_TRACK_ALLOCATIONS (see
+ *   \c AllocationTracker): storage of the dynamic-size vectors and matrices, measurement
+ *   payloads and serializer buffers,
+ * - by the global \c operator \c new of an executable that includes \c NoAllocationGuardNew.h
+ *   in one of its source files. This covers all allocations, including the formatting of log
+ *   messages and standard containers. The tracked containers then report only once.
+ *
+ * Without either, the guards are inactive and cost nothing.
+ *
+ * @code
+ * Util::NoAllocationGuard guard( Util::NoAllocationGuard::Abort );
+ * filter.addPoseMeasurement( m );
+ * @endcode
+ */
+class UBITRACK_EXPORT NoAllocationGuard
+	: private boost::noncopyable
+{
+public:
+	/** what happens on a violation */
+	enum Action
+	{
+		/// only count it, see \c violations
+		Count,
+		/// count it and log it with a backtrace
+		Log,
+		/// log it and abort the process
+		Abort
+	};
+
+	/** starts a region without allocations on the calling thread */
+	explicit NoAllocationGuard( Action action = Log );
+
+	/** ends the region, an enclosing guard becomes active again */
+	~NoAllocationGuard();
+
+	/** number of allocations of the thread since the guard was created */
+	std::size_t violations() const;
+
+	/** is a guard active on the calling thread? */
+	static bool active();
+
+	/**
+	 * reports a heap allocation of the calling thread.
+	 * @param bytes size of the allocation
+	 * @param source kind of allocation for the log, e.g. the category of a tracked allocation
+	 */
+	static void allocation( std::size_t bytes, const char* source );
+
+	/** true if \c operator \c new reports all allocations, see \c NoAllocationGuardNew.h */
+	static bool operatorNewReports();
+
+	/** @internal called by the \c operator \c new of \c NoAllocationGuardNew.h */
+	static void setOperatorNewReports();
+
+protected:
+	const int m_previousAction;
+	const unsigned long long m_startViolations;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Global operator new that reports all allocations to \c NoAllocationGuard
+ *
+ * Include this header in exactly one source file of an executable, never in a library or a
+ * header. It replaces the global \c operator \c new and \c operator \c delete of the program
+ * with versions based on \c malloc and \c free, which report every allocation of a thread with
+ * an active \c NoAllocationGuard. Outside of guards an allocation costs one thread local test.
+ */
+
+#ifndef __UBITRACK_UTIL_NOALLOCATIONGUARDNEW_H_INCLUDED__
+#define __UBITRACK_UTIL_NOALLOCATIONGUARDNEW_H_INCLUDED__
+
+#include <new>
+#include <cstdlib>
+
+#include <utUtil/NoAllocationGuard.h>
+
+#if __cplusplus >= 201103L || defined( _MSC_VER )
+	#define UBITRACK_NEW_THROWS
+	#define UBITRACK_NEW_NOTHROW throw()
+#else
+	#define UBITRACK_NEW_THROWS throw( std::bad_alloc )
+	#define UBITRACK_NEW_NOTHROW throw()
+#endif
+
+namespace {
+
+/// tells the tracked allocators that operator new already reports their allocations
+struct NoAllocationGuardOperatorNew
+{
+	NoAllocationGuardOperatorNew()
+	{ Ubitrack::Util::NoAllocationGuard::setOperatorNewReports(); }
+} g_noAllocationGuardOperatorNew;
+
+inline void* guardedMalloc( std::size_t bytes )
+{
+	Ubitrack::Util::NoAllocationGuard::allocation( bytes, "operator new" );
+	return std::malloc( bytes ? bytes : 1 );
+}
+
+} // anonymous namespace
+
+
+void* operator new( std::size_t bytes ) UBITRACK_NEW_THROWS
+{
+	void* p = guardedMalloc( bytes );
+	if ( !p )
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[]( std::size_t bytes ) UBITRACK_NEW_THROWS
+{
+	void* p = guardedMalloc( bytes );
+	if ( !p )
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new( std::size_t bytes, const std::nothrow_t& ) UBITRACK_NEW_NOTHROW
+{ return guardedMalloc( bytes ); }
+
+void* operator new[]( std::size_t bytes, const std::nothrow_t& ) UBITRACK_NEW_NOTHROW
+{ return guardedMalloc( bytes ); }
+
+void operator delete( void* p ) UBITRACK_NEW_NOTHROW
+{ std::free( p ); }
+
+void operator delete[]( void* p ) UBITRACK_NEW_NOTHROW
+{ std::free( p ); }
+
+void operator delete( void* p, const std::nothrow_t& ) UBITRACK_NEW_NOTHROW
+{ std::free( p ); }
+
+void operator delete[]( void* p, const std::nothrow_t& ) UBITRACK_NEW_NOTHROW
+{ std::free( p ); }
+
+#undef UBITRACK_NEW_THROWS
+#undef UBITRACK_NEW_NOTHROW
+
+#endif
@@ -30,15 +30,56 @@
 
 #include "OS.h"
 
+#include <algorithm>
+
 #ifdef WIN32
 #include "CleanWindows.h"
 #else
+#include <errno.h>
 #include <time.h>
 #include <sys/time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#endif
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+#endif
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+#endif
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
 #endif
 
 namespace Ubitrack { namespace Util {
 
+namespace {
+
+/// hint to the CPU that this is a busy-wait loop
+inline void cpuRelax()
+{
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+	_mm_pause();
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+	__builtin_ia32_pause();
+#endif
+}
+
+/// busy-waits until the deadline
+void spinUntil( const long long deadline )
+{
+	while ( getMonotonicTime() < deadline )
+		cpuRelax();
+}
+
+} // anonymous namespace
+
 #ifdef _WIN32
 
 void sleep( unsigned ms, unsigned )
@@ -62,6 +103,76 @@ double getHighPerformanceFrequency()
 	return static_cast< double >( counter.QuadPart );
 }
 
+
+long long getMonotonicTime()
+{
+	static const double nsPerTick = 1e9 / getHighPerformanceFrequency();
+	return static_cast< long long >( getHighPerformanceCounter() * nsPerTick );
+}
+
+
+void sleepUntil( long long deadline, long long spinNs )
+{
+	const long long wakeup = deadline - spinNs;
+	const long long remaining = wakeup - getMonotonicTime();
+	if ( remaining > 0 )
+	{
+		// high-resolution timers exist since Windows 10 1803, older versions round to the timer tick
+		HANDLE timer = CreateWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+		if ( !timer )
+			timer = CreateWaitableTimerExW( NULL, NULL, 0, TIMER_ALL_ACCESS );
+
+		// negative due times are relative, in units of 100 ns
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -( remaining / 100 );
+		if ( timer && SetWaitableTimer( timer, &dueTime, 0, NULL, NULL, FALSE ) )
+			WaitForSingleObject( timer, INFINITE );
+		else
+			Sleep( static_cast< DWORD >( remaining / 1000000 ) );
+		if ( timer )
+			CloseHandle( timer );
+	}
+	spinUntil( deadline );
+}
+
+
+bool setRealtimePriority( int )
+{
+	return SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL ) != 0;
+}
+
+
+bool setThreadAffinity( unsigned cpu )
+{
+	if ( cpu >= sizeof( DWORD_PTR ) * 8 )
+		return false;
+	return SetThreadAffinityMask( GetCurrentThread(), DWORD_PTR( 1 ) << cpu ) != 0;
+}
+
+
+unsigned numaNodeCount()
+{
+	ULONG highest = 0;
+	if ( !GetNumaHighestNodeNumber( &highest ) )
+		return 1;
+	return static_cast< unsigned >( highest ) + 1;
+}
+
+
+unsigned numaNodeOfCpu( unsigned cpu )
+{
+	UCHAR node = 0;
+	if ( cpu > 255 || !GetNumaProcessorNode( static_cast< UCHAR >( cpu ), &node ) || node == 0xff )
+		return 0;
+	return node;
+}
+
+
+unsigned currentNumaNode()
+{
+	return numaNodeOfCpu( GetCurrentProcessorNumber() );
+}
+
 #else // unix
 
 void sleep( unsigned ms, unsigned ns )
@@ -86,7 +197,209 @@ double getHighPerformanceFrequency()
 {
 	return 1000000.0;
 }
+
+
+#ifdef __APPLE__
+
+long long getMonotonicTime()
+{
+	static mach_timebase_info_data_t timebase;
+	if ( timebase.denom == 0 )
+		mach_timebase_info( &timebase );
+	return static_cast< long long >( mach_absolute_time() * timebase.numer / timebase.denom );
+}
+
+
+void sleepUntil( long long deadline, long long spinNs )
+{
+	// no absolute sleep, the remaining time is computed right before sleeping
+	const long long remaining = deadline - spinNs - getMonotonicTime();
+	if ( remaining > 0 )
+	{
+		timespec t;
+		t.tv_sec = remaining / 1000000000;
+		t.tv_nsec = remaining % 1000000000;
+		nanosleep( &t, NULL );
+	}
+	spinUntil( deadline );
+}
+
+
+bool setThreadAffinity( unsigned cpu )
+{
+	// only a hint to keep threads with the same tag on the same L2 cache
+	thread_affinity_policy_data_t policy = { static_cast< integer_t >( cpu + 1 ) };
+	return thread_policy_set( pthread_mach_thread_np( pthread_self() ), THREAD_AFFINITY_POLICY,
+		reinterpret_cast< thread_policy_t >( &policy ), THREAD_AFFINITY_POLICY_COUNT ) == KERN_SUCCESS;
+}
+
+
+// Mac OS has no NUMA machines
+unsigned numaNodeCount()
+{
+	return 1;
+}
+
+
+unsigned numaNodeOfCpu( unsigned )
+{
+	return 0;
+}
+
+
+unsigned currentNumaNode()
+{
+	return 0;
+}
+
+#else
+
+long long getMonotonicTime()
+{
+	timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+void sleepUntil( long long deadline, long long spinNs )
+{
+	const long long wakeup = deadline - spinNs;
+	timespec t;
+	t.tv_sec = wakeup / 1000000000;
+	t.tv_nsec = wakeup % 1000000000;
+	// restarted after signals, with the same absolute time
+	while ( wakeup > getMonotonicTime() && clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL ) == EINTR )
+		;
+	spinUntil( deadline );
+}
+
+
+bool setThreadAffinity( unsigned cpu )
+{
+	if ( cpu >= CPU_SETSIZE )
+		return false;
+	cpu_set_t set;
+	CPU_ZERO( &set );
+	CPU_SET( cpu, &set );
+	// 0 is the calling thread
+	return sched_setaffinity( 0, sizeof( set ), &set ) == 0;
+}
+
+
+namespace {
+
+/**
+ * reads a list of the form "0-3,8,10-11" from a sysfs file
+ * @param largest receives the largest entry
+ * @return true if the list contains \c value
+ */
+bool readSysfsList( const char* path, const unsigned value, unsigned& largest )
+{
+	largest = 0;
+	FILE* f = fopen( path, "r" );
+	if ( !f )
+		return false;
+
+	bool bFound = false;
+	unsigned first, last;
+	while ( fscanf( f, "%u", &first ) == 1 )
+	{
+		last = first;
+		int c = fgetc( f );
+		if ( c == '-' && fscanf( f, "%u", &last ) == 1 )
+			c = fgetc( f );
+		bFound = bFound || ( first <= value && value <= last );
+		largest = std::max( largest, last );
+		if ( c != ',' )
+			break;
+	}
+	fclose( f );
+	return bFound;
+}
+
+/// the number of nodes from sysfs, 1 without NUMA support
+unsigned readNumaNodeCount()
+{
+	unsigned largest;
+	if ( !readSysfsList( "/sys/devices/system/node/online", 0, largest ) )
+		return 1;
+	return largest + 1;
+}
+
+} // anonymous namespace
+
+
+unsigned numaNodeCount()
+{
+	static const unsigned nNodes = readNumaNodeCount();
+	return nNodes;
+}
+
+
+unsigned numaNodeOfCpu( unsigned cpu )
+{
+	char path[ 64 ];
+	unsigned largest;
+	for ( unsigned node = 0; node < numaNodeCount(); node++ )
+	{
+		snprintf( path, sizeof( path ), "/sys/devices/system/node/node%u/cpulist", node );
+		if ( readSysfsList( path, cpu, largest ) )
+			return node;
+	}
+	return 0;
+}
+
+
+unsigned currentNumaNode()
+{
+	const int cpu = sched_getcpu();
+	return cpu < 0 ? 0 : numaNodeOfCpu( static_cast< unsigned >( cpu ) );
+}
+
+#endif
+
+
+bool setRealtimePriority( int priority )
+{
+	sched_param param;
+	param.sched_priority = priority;
+	return pthread_setschedparam( pthread_self(), SCHED_FIFO, &param ) == 0;
+}
 	
 #endif
 
+
+PeriodicScheduler::PeriodicScheduler( long long periodNs, long long spinNs )
+	: m_period( periodNs )
+	, m_spin( spinNs )
+	, m_deadline( getMonotonicTime() )
+	, m_missed( 0 )
+{
+}
+
+
+void PeriodicScheduler::wait()
+{
+	long long next = m_deadline + m_period;
+
+	// skip whole periods that have passed already
+	const long long late = getMonotonicTime() - next;
+	if ( late >= m_period )
+	{
+		const long long skipped = late / m_period;
+		next += skipped * m_period;
+		m_missed += skipped;
+	}
+
+	sleepUntil( next, m_spin );
+	m_deadline = next;
+}
+
+
+void PeriodicScheduler::reset()
+{
+	m_deadline = getMonotonicTime();
+}
+
 } } // namespace Ubitrack::Util
@@ -50,6 +50,106 @@ UBITRACK_EXPORT long long getHighPerformanceCounter();
 /** retrieves the high performance counter frequency in Hz */
 UBITRACK_EXPORT double getHighPerformanceFrequency();
 
+/** retrieves a monotonic clock in nanoseconds, the reference of \c sleepUntil */
+UBITRACK_EXPORT long long getMonotonicTime();
+
+/**
+ * Holds execution until the monotonic clock reaches a deadline.
+ *
+ * The thread sleeps until \c spinNs before the deadline on an absolute timer
+ * (\c clock_nanosleep with \c TIMER_ABSTIME, a high-resolution waitable timer on Windows),
+ * so late wakeups do not accumulate, and busy-waits for the rest. A few hundred microseconds of
+ * spinning hide the timer slack of Linux and the coarse timers of Windows.
+ *
+ * @param deadline time to wake up, as returned by \c getMonotonicTime
+ * @param spinNs nanoseconds before the deadline at which to stop sleeping and start spinning
+ */
+UBITRACK_EXPORT void sleepUntil( long long deadline, long long spinNs = 0 );
+
+/**
+ * Gives the calling thread a real-time priority (\c SCHED_FIFO, or
+ * \c THREAD_PRIORITY_TIME_CRITICAL on Windows), e.g. for fixed-rate output to a controller.
+ *
+ * @param priority \c SCHED_FIFO priority, between 1 and 99. Ignored on Windows.
+ * @return false if the operating system refused, usually for lack of permissions
+ */
+UBITRACK_EXPORT bool setRealtimePriority( int priority = 50 );
+
+/**
+ * Binds the calling thread to one CPU.
+ * @return false if the CPU does not exist or binding is not supported
+ */
+UBITRACK_EXPORT bool setThreadAffinity( unsigned cpu );
+
+/**
+ * number of NUMA nodes of the machine, 1 if the topology is unknown
+ */
+UBITRACK_EXPORT unsigned numaNodeCount();
+
+/**
+ * the NUMA node a CPU belongs to, 0 if the topology is unknown
+ */
+UBITRACK_EXPORT unsigned numaNodeOfCpu( unsigned cpu );
+
+/**
+ * the NUMA node of the CPU the calling thread runs on at the moment.
+ * Only meaningful for threads bound with \c setThreadAffinity.
+ */
+UBITRACK_EXPORT unsigned currentNumaNode();
+
+
+/**
+ * Wakes a thread up at a fixed rate without drift.
+ *
+ * The deadlines are multiples of the period after the construction (or \c reset), so the
+ * time spent between calls to \c wait and late wakeups do not shift the following ones:
+ * @code
+ * Util::PeriodicScheduler scheduler( 1000000 ); // 1 kHz
+ * while ( running )
+ * {
+ *     scheduler.wait();
+ *     sendPrediction( scheduler.deadline() );
+ * }
+ * @endcode
+ * If the thread misses whole periods, they are skipped and counted instead of being
+ * caught up in a burst: \c wait returns immediately for the last deadline that has passed
+ * and continues on the original grid.
+ */
+class UBITRACK_EXPORT PeriodicScheduler
+{
+public:
+	/**
+	 * starts the schedule, the first deadline is one period from now
+	 * @param periodNs period in nanoseconds
+	 * @param spinNs time to busy-wait before each deadline, see \c sleepUntil
+	 */
+	explicit PeriodicScheduler( long long periodNs, long long spinNs = 200000 );
+
+	/** waits for the next deadline */
+	void wait();
+
+	/** restarts the schedule, the next deadline is one period from now */
+	void reset();
+
+	/** the deadline of the last \c wait, in \c getMonotonicTime */
+	long long deadline() const
+	{ return m_deadline; }
+
+	/** period in nanoseconds */
+	long long period() const
+	{ return m_period; }
+
+	/** number of periods that were skipped because \c wait was called too late */
+	unsigned long long missedPeriods() const
+	{ return m_missed; }
+
+protected:
+	long long m_period;
+	long long m_spin;
+	long long m_deadline;
+	unsigned long long m_missed;
+};
+
 } } // namespace Ubitrack::Util
 
 #endif
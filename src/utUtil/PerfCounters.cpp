@@ -0,0 +1,176 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Implementation of the hardware performance counters
+ */
+
+#include "PerfCounters.h"
+
+#ifdef _WIN32
+#include "CleanWindows.h"
+#elif defined( __linux__ )
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+#if defined( _WIN32 )
+
+unsigned readCounters( PerfCounterValues& values )
+{
+	ULONG64 cycles;
+	if ( !QueryThreadCycleTime( GetCurrentThread(), &cycles ) )
+		return 0;
+	values.counts[ PerfCounterValues::Cycles ] = cycles;
+	values.valid = 1u << PerfCounterValues::Cycles;
+	return values.valid;
+}
+
+#elif defined( __linux__ )
+
+/// @internal the counters of one thread, opened as one group led by the first event that could be opened
+class ThreadCounters
+{
+public:
+	ThreadCounters()
+		: m_nOpen( 0 )
+		, m_valid( 0 )
+	{
+		static const struct { PerfCounterValues::Event event; boost::uint32_t type; boost::uint64_t config; } events[] = {
+			{ PerfCounterValues::Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PerfCounterValues::Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PerfCounterValues::L1Misses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+				| ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ) },
+			{ PerfCounterValues::LlcMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ PerfCounterValues::BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+		};
+
+		for ( unsigned i = 0; i < PerfCounterValues::nEvents; i++ )
+		{
+			perf_event_attr attr;
+			memset( &attr, 0, sizeof( attr ) );
+			attr.size = sizeof( attr );
+			attr.type = events[ i ].type;
+			attr.config = events[ i ].config;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP;
+
+			// the kernel rejects events that cannot be scheduled together with the group
+			const int fd = static_cast< int >( syscall( __NR_perf_event_open, &attr, 0, -1, m_nOpen ? m_fds[ 0 ] : -1, 0 ) );
+			if ( fd < 0 )
+				continue;
+			m_fds[ m_nOpen ] = fd;
+			m_events[ m_nOpen++ ] = events[ i ].event;
+			m_valid |= 1u << events[ i ].event;
+		}
+	}
+
+	~ThreadCounters()
+	{
+		for ( unsigned i = 0; i < m_nOpen; i++ )
+			close( m_fds[ i ] );
+	}
+
+	unsigned valid() const
+	{ return m_valid; }
+
+	unsigned read( PerfCounterValues& values ) const
+	{
+		if ( !m_nOpen )
+			return 0;
+
+		// number of events followed by their values, in the order they were added to the group
+		boost::uint64_t buffer[ 1 + PerfCounterValues::nEvents ];
+		const ssize_t n = ::read( m_fds[ 0 ], buffer, sizeof( buffer ) );
+		if ( n < static_cast< ssize_t >( ( 1 + m_nOpen ) * sizeof( boost::uint64_t ) ) || buffer[ 0 ] != m_nOpen )
+			return 0;
+
+		for ( unsigned i = 0; i < m_nOpen; i++ )
+			values.counts[ m_events[ i ] ] = buffer[ 1 + i ];
+		values.valid = m_valid;
+		return m_valid;
+	}
+
+protected:
+	int m_fds[ PerfCounterValues::nEvents ];
+	PerfCounterValues::Event m_events[ PerfCounterValues::nEvents ];
+	unsigned m_nOpen;
+	unsigned m_valid;
+};
+
+/// @internal the counters of each thread, closed when the thread exits
+boost::thread_specific_ptr< ThreadCounters > t_counters;
+
+const ThreadCounters& threadCounters()
+{
+	if ( !t_counters.get() )
+		t_counters.reset( new ThreadCounters );
+	return *t_counters;
+}
+
+unsigned readCounters( PerfCounterValues& values )
+{
+	return threadCounters().read( values );
+}
+
+#else
+
+unsigned readCounters( PerfCounterValues& )
+{
+	return 0;
+}
+
+#endif
+
+} // anonymous namespace
+
+
+unsigned PerfCounters::available()
+{
+#if defined( __linux__ ) && !defined( _WIN32 )
+	return threadCounters().valid();
+#else
+	PerfCounterValues values;
+	return readCounters( values );
+#endif
+}
+
+
+unsigned PerfCounters::read( PerfCounterValues& values )
+{
+	return readCounters( values );
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,98 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Hardware performance counters of the calling thread
+ */
+
+#ifndef __UBITRACK_UTIL_PERFCOUNTERS_H_INCLUDED__
+#define __UBITRACK_UTIL_PERFCOUNTERS_H_INCLUDED__
+
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Values of the hardware event counters of a thread, or differences of two readings.
+ * Only the events whose bit is set in \c valid are counted on this system.
+ */
+struct PerfCounterValues
+{
+	/** counted events, also the bit positions in \c valid */
+	enum Event
+	{
+		Cycles,
+		Instructions,
+		/// level 1 data cache read misses
+		L1Misses,
+		/// last level cache misses
+		LlcMisses,
+		BranchMisses,
+		nEvents
+	};
+
+	PerfCounterValues()
+		: valid( 0 )
+	{
+		for ( unsigned i = 0; i < nEvents; i++ )
+			counts[ i ] = 0;
+	}
+
+	bool has( Event e ) const
+	{ return ( valid & ( 1u << e ) ) != 0; }
+
+	unsigned valid;
+	unsigned long long counts[ nEvents ];
+};
+
+
+/**
+ * Reads hardware performance counters of the calling thread.
+ *
+ * On Linux all events are counted with \c perf_event_open in user space. The counters of a
+ * thread are opened as one group on its first \c read, so they are always scheduled together,
+ * and closed when the thread exits. Events the CPU or the virtual machine does not support are
+ * left out. If \c perf_event_open is not permitted (see \c /proc/sys/kernel/perf_event_paranoid)
+ * no events are counted.
+ *
+ * On Windows only the cycles of the thread are available, through \c QueryThreadCycleTime.
+ * Other systems have no counters.
+ */
+class UBITRACK_EXPORT PerfCounters
+{
+public:
+	/** events that can be counted on the calling thread, as bits of \c PerfCounterValues::valid */
+	static unsigned available();
+
+	/**
+	 * reads the counters of the calling thread.
+	 * @return the events that were read, 0 if there are no counters
+	 */
+	static unsigned read( PerfCounterValues& values );
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
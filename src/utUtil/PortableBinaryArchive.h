@@ -0,0 +1,544 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Portable binary archive for boost::serialization
+ *
+ * \c PortableBinaryOArchive and \c PortableBinaryIArchive call the same \c serialize methods
+ * as the boost text archives, but store the values in a compact binary format that is the
+ * same on all platforms:
+ * - the archive starts with "UTBA" and the uint32 format version, unless it is embedded
+ *   in another file (e.g. the snapshot of \c CalibStore)
+ * - all numbers are little endian, \c float and \c double in IEEE 754 format
+ * - \c bool and \c char take one byte, \c short two, \c int four, \c long, \c long \c long and
+ *   \c size_t eight bytes, so 32 and 64 bit platforms read each other's files
+ * - sizes of strings, \c std::vector and dynamic vectors and matrices are uint64
+ * - \c Math::Vector and \c Math::Matrix are stored as their elements, matrices column by column,
+ *   and \c Math::Quaternion as x, y, z, w. Floating point elements are copied as one block
+ *   on little endian hosts.
+ * - the version of every other class is stored as uint32 when the class occurs for the first
+ *   time and passed to all its \c serialize calls, so the \c BOOST_CLASS_VERSION mechanism
+ *   works as with the boost archives
+ *
+ * There is no object tracking, pointers are not supported.
+ */
+
+#ifndef __UBITRACK_UTIL_PORTABLEBINARYARCHIVE_H_INCLUDED__
+#define __UBITRACK_UTIL_PORTABLEBINARYARCHIVE_H_INCLUDED__
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/mpl/bool.hpp>
+#include <boost/mpl/if.hpp>
+#include <boost/mpl/int.hpp>
+#include <boost/type_traits.hpp>
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/item_version_type.hpp>
+
+#include <utUtil/Exception.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Quaternion.h>
+
+namespace Ubitrack { namespace Util {
+
+/// @internal helpers of the portable binary archives
+namespace PortableBinary {
+
+/// format version written into the header
+const boost::uint32_t formatVersion = 1;
+
+/// length of the header
+const std::size_t headerLength = 8;
+
+/// @internal magic number at the start of the header
+inline const char* magic()
+{ return "UTBA"; }
+
+/// @internal true if the host stores numbers in the byte order of the archive
+inline bool littleEndianHost()
+{
+	const boost::uint16_t one = 1;
+	return *reinterpret_cast< const unsigned char* >( &one ) == 1;
+}
+
+/// @internal how values are stored: 0 class, 1 floating point, 2 integer, 3 enum
+template< typename T >
+struct Kind
+	: public boost::mpl::int_< boost::is_floating_point< T >::value ? 1 :
+		boost::is_integral< T >::value ? 2 : boost::is_enum< T >::value ? 3 : 0 >
+{};
+
+/// @internal number of bytes of an integer, \c long uses eight bytes on all platforms
+template< typename T >
+struct IntegerSize
+{
+	static const std::size_t value = ( sizeof( T ) > 4 || boost::is_same< T, long >::value ||
+		boost::is_same< T, unsigned long >::value ) ? 8 : sizeof( T );
+};
+
+} // namespace PortableBinary
+
+
+/**
+ * Writes objects in the portable binary format to a stream.
+ * Provides an archive class for boost::serialization.
+ */
+class PortableBinaryOArchive
+{
+public:
+	/**
+	 * construct archive on a binary stream
+	 * @param header write the header, false for archives embedded in other files
+	 */
+	explicit PortableBinaryOArchive( std::ostream& s, const bool header = true )
+		: m_buffer( *s.rdbuf() )
+	{
+		if ( header )
+		{
+			writeBytes( PortableBinary::magic(), 4 );
+			writeInteger( PortableBinary::formatVersion, 4 );
+		}
+	}
+
+	/// forward << to &
+	template< class T >
+	PortableBinaryOArchive& operator<<( const T& v )
+	{ return *this & v; }
+
+	/// write operator for numbers and classes (calls serialize)
+	template< class T >
+	PortableBinaryOArchive& operator&( const T& v )
+	{ save( v, PortableBinary::Kind< T >() ); return *this; }
+
+	/// write operator for strings
+	PortableBinaryOArchive& operator&( const std::string& v )
+	{
+		writeInteger( v.size(), 8 );
+		writeBytes( v.data(), v.size() );
+		return *this;
+	}
+
+	/// write operator for std::vector
+	template< class T, class A >
+	PortableBinaryOArchive& operator&( const std::vector< T, A >& v )
+	{
+		writeInteger( v.size(), 8 );
+		if ( !v.empty() )
+			saveArray( &v[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// write operator for vectors, dynamic vectors start with their size
+	template< class T, std::size_t N >
+	PortableBinaryOArchive& operator&( const Math::Vector< T, N >& v )
+	{
+		if ( N == 0 )
+			writeInteger( v.size(), 8 );
+		if ( v.size() )
+			saveArray( &v.data()[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// write operator for matrices, dynamic matrices start with their dimensions
+	template< class T, std::size_t M, std::size_t N >
+	PortableBinaryOArchive& operator&( const Math::Matrix< T, M, N >& v )
+	{
+		if ( M * N == 0 )
+		{
+			writeInteger( v.size1(), 8 );
+			writeInteger( v.size2(), 8 );
+		}
+		if ( v.size1() * v.size2() )
+			saveArray( &v.data()[ 0 ], v.size1() * v.size2() );
+		return *this;
+	}
+
+	/// write operator for quaternions
+	PortableBinaryOArchive& operator&( const Math::Quaternion& v )
+	{
+		const double q[ 4 ] = { v.x(), v.y(), v.z(), v.w() };
+		saveArray( q, 4 );
+		return *this;
+	}
+
+	#if BOOST_VERSION >= 103500
+		/// write operator for collection_size_type
+		PortableBinaryOArchive& operator&( const boost::serialization::collection_size_type& v )
+		{ writeInteger( std::size_t( v ), 8 ); return *this; }
+	#endif
+	#if BOOST_VERSION >= 104400
+		/// write operator for item_version_type
+		PortableBinaryOArchive& operator&( const boost::serialization::item_version_type& v )
+		{ writeInteger( static_cast< unsigned int >( v ), 4 ); return *this; }
+	#endif
+
+	/// let nvps through
+	template< class T >
+	PortableBinaryOArchive& operator&( const boost::serialization::nvp< T >& v )
+	{ return *this & v.const_value(); }
+
+	/// writes raw bytes
+	void save_binary( const void* p, std::size_t n )
+	{ writeBytes( p, n ); }
+
+	// required for boost::serialization
+	typedef boost::mpl::bool_<false> is_loading;
+	typedef boost::mpl::bool_<true> is_saving;
+	unsigned int get_library_version() const
+	{ return 0; }
+
+protected:
+	/// classes, the version is written on their first occurrence
+	template< class T >
+	void save( const T& v, boost::mpl::int_< 0 > )
+	{ boost::serialization::serialize( *this, const_cast< T& >( v ), classVersion< T >() ); }
+
+	template< class T >
+	void save( const T& v, boost::mpl::int_< 1 > )
+	{ saveArray( &v, 1 ); }
+
+	template< class T >
+	void save( const T& v, boost::mpl::int_< 2 > )
+	{ writeInteger( v, PortableBinary::IntegerSize< T >::value ); }
+
+	template< class T >
+	void save( const T& v, boost::mpl::int_< 3 > )
+	{ writeInteger( static_cast< int >( v ), 4 ); }
+
+	/// writes n elements
+	template< class T >
+	void saveArray( const T* p, std::size_t n )
+	{
+		if ( PortableBinary::Kind< T >::value == 1 && PortableBinary::littleEndianHost() )
+			writeBytes( p, n * sizeof( T ) );
+		else
+			for ( std::size_t i = 0; i < n; i++ )
+				saveElement( p[ i ], PortableBinary::Kind< T >() );
+	}
+
+	template< class T, int K >
+	void saveElement( const T& v, boost::mpl::int_< K > )
+	{ *this & v; }
+
+	/// floating point numbers on big endian hosts
+	template< class T >
+	void saveElement( const T& v, boost::mpl::int_< 1 > )
+	{
+		typedef typename boost::mpl::if_c< sizeof( T ) == 8, boost::uint64_t, boost::uint32_t >::type Bits;
+		Bits bits;
+		std::memcpy( &bits, &v, sizeof( T ) );
+		writeInteger( bits, sizeof( T ) );
+	}
+
+	/// writes the lower n bytes of v, little endian
+	template< class T >
+	void writeInteger( const T v, const std::size_t n )
+	{
+		const boost::uint64_t u = static_cast< boost::uint64_t >( v );
+		unsigned char bytes[ 8 ];
+		for ( std::size_t i = 0; i < n; i++ )
+			bytes[ i ] = static_cast< unsigned char >( u >> ( 8 * i ) );
+		writeBytes( bytes, n );
+	}
+
+	void writeBytes( const void* p, const std::size_t n )
+	{
+		if ( std::size_t( m_buffer.sputn( static_cast< const char* >( p ), n ) ) != n )
+			UBITRACK_THROW( "Stream write failure" );
+	}
+
+	/// returns the version of a class and writes it, if the class occurs for the first time
+	template< class T >
+	unsigned int classVersion()
+	{
+		for ( std::size_t i = 0; i < m_versions.size(); i++ )
+			if ( *m_versions[ i ].first == typeid( T ) )
+				return m_versions[ i ].second;
+
+		const unsigned int version = boost::serialization::version< T >::value;
+		m_versions.push_back( std::make_pair( &typeid( T ), version ) );
+		writeInteger( version, 4 );
+		return version;
+	}
+
+	std::streambuf& m_buffer;
+
+	/// versions of the classes written so far
+	std::vector< std::pair< const std::type_info*, unsigned int > > m_versions;
+};
+
+
+/**
+ * Reads objects in the portable binary format from a stream.
+ * Provides an archive class for boost::serialization.
+ */
+class PortableBinaryIArchive
+{
+public:
+	/**
+	 * construct archive on a binary stream
+	 * @param header read and check the header, false for archives embedded in other files
+	 * @throws Util::Exception if the header is missing or of a newer format version
+	 */
+	explicit PortableBinaryIArchive( std::istream& s, const bool header = true )
+		: m_buffer( *s.rdbuf() )
+		, m_formatVersion( PortableBinary::formatVersion )
+	{
+		if ( header )
+		{
+			char m[ 4 ];
+			readBytes( m, 4 );
+			if ( std::memcmp( m, PortableBinary::magic(), 4 ) != 0 )
+				UBITRACK_THROW( "Not a portable binary archive" );
+			m_formatVersion = static_cast< boost::uint32_t >( readInteger( 4 ) );
+			if ( m_formatVersion > PortableBinary::formatVersion )
+				UBITRACK_THROW( "Portable binary archive has a newer format version" );
+		}
+	}
+
+	/**
+	 * checks if a stream starts with the header of a portable binary archive.
+	 * The position of the stream is not changed.
+	 */
+	static bool hasHeader( std::istream& s )
+	{
+		const std::istream::pos_type pos = s.tellg();
+		char m[ 4 ];
+		const bool found = s.read( m, 4 ) && std::memcmp( m, PortableBinary::magic(), 4 ) == 0;
+		s.clear();
+		s.seekg( pos );
+		return found;
+	}
+
+	/** format version of the archive */
+	boost::uint32_t formatVersion() const
+	{ return m_formatVersion; }
+
+	/// forward >> to &
+	template< class T >
+	PortableBinaryIArchive& operator>>( T& v )
+	{ return *this & v; }
+
+	/// read operator for numbers and classes (calls serialize)
+	template< class T >
+	PortableBinaryIArchive& operator&( T& v )
+	{ load( v, PortableBinary::Kind< T >() ); return *this; }
+
+	/// read operator for strings
+	PortableBinaryIArchive& operator&( std::string& v )
+	{
+		v.resize( readSize() );
+		if ( !v.empty() )
+			readBytes( &v[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// read operator for std::vector
+	template< class T, class A >
+	PortableBinaryIArchive& operator&( std::vector< T, A >& v )
+	{
+		v.resize( readSize() );
+		if ( !v.empty() )
+			loadArray( &v[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// read operator for vectors
+	template< class T, std::size_t N >
+	PortableBinaryIArchive& operator&( Math::Vector< T, N >& v )
+	{
+		if ( N == 0 )
+			v.resize( readSize(), false );
+		if ( v.size() )
+			loadArray( &v.data()[ 0 ], v.size() );
+		return *this;
+	}
+
+	/// read operator for matrices
+	template< class T, std::size_t M, std::size_t N >
+	PortableBinaryIArchive& operator&( Math::Matrix< T, M, N >& v )
+	{
+		if ( M * N == 0 )
+		{
+			const std::size_t size1 = readSize();
+			v.resize( size1, readSize(), false );
+		}
+		if ( v.size1() * v.size2() )
+			loadArray( &v.data()[ 0 ], v.size1() * v.size2() );
+		return *this;
+	}
+
+	/// read operator for quaternions
+	PortableBinaryIArchive& operator&( Math::Quaternion& v )
+	{
+		double q[ 4 ];
+		loadArray( q, 4 );
+		v = Math::Quaternion( q[ 0 ], q[ 1 ], q[ 2 ], q[ 3 ] );
+		return *this;
+	}
+
+	#if BOOST_VERSION >= 103500
+		/// read operator for collection_size_type
+		PortableBinaryIArchive& operator&( boost::serialization::collection_size_type& v )
+		{ v = boost::serialization::collection_size_type( readSize() ); return *this; }
+	#endif
+	#if BOOST_VERSION >= 104400
+		/// read operator for item_version_type
+		PortableBinaryIArchive& operator&( boost::serialization::item_version_type& v )
+		{ v = boost::serialization::item_version_type( static_cast< unsigned int >( readInteger( 4 ) ) ); return *this; }
+	#endif
+
+	/// let const-nvps through
+	template< class T >
+	PortableBinaryIArchive& operator&( const boost::serialization::nvp< T >& v )
+	{ return *this & v.value(); }
+
+	/// reads raw bytes
+	void load_binary( void* p, std::size_t n )
+	{ readBytes( p, n ); }
+
+	// required for boost::serialization
+	typedef boost::mpl::bool_<true> is_loading;
+	typedef boost::mpl::bool_<false> is_saving;
+	unsigned int get_library_version() const
+	{ return 0; }
+	void reset_object_address( void*, void* )
+	{}
+
+protected:
+	/// classes, the version is read on their first occurrence
+	template< class T >
+	void load( T& v, boost::mpl::int_< 0 > )
+	{ boost::serialization::serialize( *this, v, classVersion< T >() ); }
+
+	template< class T >
+	void load( T& v, boost::mpl::int_< 1 > )
+	{ loadArray( &v, 1 ); }
+
+	template< class T >
+	void load( T& v, boost::mpl::int_< 2 > )
+	{
+		const std::size_t n = PortableBinary::IntegerSize< T >::value;
+		boost::uint64_t u = readInteger( n );
+		// sign extension
+		if ( boost::is_signed< T >::value && n < 8 && ( u >> ( 8 * n - 1 ) ) & 1 )
+			u |= ~boost::uint64_t( 0 ) << ( 8 * n );
+		v = static_cast< T >( u );
+		if ( static_cast< boost::uint64_t >( v ) != u )
+			UBITRACK_THROW( "Integer in portable binary archive is out of range" );
+	}
+
+	template< class T >
+	void load( T& v, boost::mpl::int_< 3 > )
+	{
+		int i;
+		load( i, boost::mpl::int_< 2 >() );
+		v = static_cast< T >( i );
+	}
+
+	/// reads n elements
+	template< class T >
+	void loadArray( T* p, std::size_t n )
+	{
+		if ( PortableBinary::Kind< T >::value == 1 && PortableBinary::littleEndianHost() )
+			readBytes( p, n * sizeof( T ) );
+		else
+			for ( std::size_t i = 0; i < n; i++ )
+				loadElement( p[ i ], PortableBinary::Kind< T >() );
+	}
+
+	template< class T, int K >
+	void loadElement( T& v, boost::mpl::int_< K > )
+	{ *this & v; }
+
+	/// floating point numbers on big endian hosts
+	template< class T >
+	void loadElement( T& v, boost::mpl::int_< 1 > )
+	{
+		typedef typename boost::mpl::if_c< sizeof( T ) == 8, boost::uint64_t, boost::uint32_t >::type Bits;
+		const Bits bits = static_cast< Bits >( readInteger( sizeof( T ) ) );
+		std::memcpy( &v, &bits, sizeof( T ) );
+	}
+
+	/// reads n bytes, little endian
+	boost::uint64_t readInteger( const std::size_t n )
+	{
+		unsigned char bytes[ 8 ];
+		readBytes( bytes, n );
+		boost::uint64_t u = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+			u |= boost::uint64_t( bytes[ i ] ) << ( 8 * i );
+		return u;
+	}
+
+	std::size_t readSize()
+	{
+		const boost::uint64_t u = readInteger( 8 );
+		if ( u != static_cast< std::size_t >( u ) )
+			UBITRACK_THROW( "Size in portable binary archive is out of range" );
+		return static_cast< std::size_t >( u );
+	}
+
+	void readBytes( void* p, const std::size_t n )
+	{
+		if ( std::size_t( m_buffer.sgetn( static_cast< char* >( p ), n ) ) != n )
+			UBITRACK_THROW( "Unexpected end of portable binary archive" );
+	}
+
+	/// returns the version of a class, which is read if the class occurs for the first time
+	template< class T >
+	unsigned int classVersion()
+	{
+		for ( std::size_t i = 0; i < m_versions.size(); i++ )
+			if ( *m_versions[ i ].first == typeid( T ) )
+				return m_versions[ i ].second;
+
+		const unsigned int version = static_cast< unsigned int >( readInteger( 4 ) );
+		if ( version > boost::serialization::version< T >::value )
+			UBITRACK_THROW( std::string( "Portable binary archive has a newer version of " ) + typeid( T ).name() );
+		m_versions.push_back( std::make_pair( &typeid( T ), version ) );
+		return version;
+	}
+
+	std::streambuf& m_buffer;
+
+	boost::uint32_t m_formatVersion;
+
+	/// versions of the classes read so far
+	std::vector< std::pair< const std::type_info*, unsigned int > > m_versions;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Implementation of progress reports and cancellation
+ */
+
+#include "Progress.h"
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+// the innermost scope of the calling thread
+#if defined( _MSC_VER )
+__declspec( thread ) const ProgressScope* t_scope = 0;
+#else
+__thread const ProgressScope* t_scope = 0;
+#endif
+
+} // anonymous namespace
+
+
+boost::atomic< unsigned > ProgressScope::s_nActive( 0 );
+
+
+OperationCancelled::OperationCancelled( unsigned nLine, const char* sFile )
+	: Exception( "Operation cancelled", nLine, sFile )
+{}
+
+
+void ProgressContext::report( const char* algorithm, std::size_t iteration, double residual, double lambda ) const
+{
+	if ( m_callback )
+	{
+		ProgressRecord record;
+		record.algorithm = algorithm;
+		record.iteration = iteration;
+		record.residual = residual;
+		record.lambda = lambda;
+		m_callback( record );
+	}
+	check();
+}
+
+
+ProgressContext ProgressContext::current()
+{
+	return t_scope ? t_scope->m_context : ProgressContext();
+}
+
+
+ProgressScope::ProgressScope()
+	: m_pPrevious( t_scope )
+	, m_bActive( false )
+{
+	t_scope = this;
+}
+
+
+ProgressScope::ProgressScope( const ProgressContext& context )
+	: m_context( context )
+	, m_pPrevious( t_scope )
+	, m_bActive( !context.empty() )
+{
+	t_scope = this;
+	if ( m_bActive )
+		s_nActive++;
+}
+
+
+ProgressScope::~ProgressScope()
+{
+	t_scope = m_pPrevious;
+	if ( m_bActive )
+		s_nActive--;
+}
+
+
+void ProgressScope::reportCurrent( const char* algorithm, std::size_t iteration, double residual, double lambda )
+{
+	if ( t_scope )
+		t_scope->m_context.report( algorithm, iteration, residual, lambda );
+}
+
+
+void ProgressScope::checkCurrent()
+{
+	if ( t_scope )
+		t_scope->m_context.check();
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,207 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup util
+ * @file
+ * Progress reports and cancellation of long-running operations
+ *
+ * An operation, e.g. a calibration running on the \c Executor, is given a \c ProgressContext
+ * with a \c CancellationToken and a \c ProgressCallback. While a \c ProgressScope with the
+ * context is alive, the iterative algorithms called on the same thread report their iterations
+ * to the callback and throw \c OperationCancelled at the next iteration boundary after the token
+ * was cancelled:
+ * @code
+ * Util::CancellationToken token;
+ * Util::ProgressScope scope( Util::ProgressContext( token, &showProgress ) );
+ * Math::Optimization::levenbergMarquardt( ... ); // calls showProgress once per iteration
+ * @endcode
+ * While no scope is active, \c reportProgress and \c checkCancellation test a single flag.
+ * Algorithms that distribute their iterations over other threads take the context of the
+ * calling thread with \c ProgressContext::current.
+ */
+
+#ifndef __UBITRACK_UTIL_PROGRESS_H_INCLUDED__
+#define __UBITRACK_UTIL_PROGRESS_H_INCLUDED__
+
+#include <cstddef>
+
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <utCore.h>
+#include <utUtil/Exception.h>
+
+namespace Ubitrack { namespace Util {
+
+/** thrown by an operation that stopped because its \c CancellationToken was cancelled */
+class UBITRACK_EXPORT OperationCancelled
+	: public Exception
+{
+public:
+	OperationCancelled( unsigned nLine = 0, const char* sFile = NULL );
+};
+
+/** one iteration of a long-running algorithm */
+struct ProgressRecord
+{
+	/** name of the algorithm, a string literal */
+	const char* algorithm;
+
+	/** iteration within the algorithm, 0 for the initial state */
+	std::size_t iteration;
+
+	/** residual after the iteration, e.g. the fraction of outliers for RANSAC */
+	double residual;
+
+	/** damping of Levenberg-Marquardt etc., 0 if not applicable */
+	double lambda;
+};
+
+/** receives the iterations of an operation */
+typedef boost::function< void ( const ProgressRecord& ) > ProgressCallback;
+
+/**
+ * Shared flag to request the cancellation of an operation. Copies refer to the same flag.
+ */
+class CancellationToken
+{
+public:
+	CancellationToken()
+		: m_pFlag( new boost::atomic< bool >( false ) )
+	{}
+
+	/** requests the cancellation, may be called from any thread */
+	void cancel()
+	{ m_pFlag->store( true, boost::memory_order_relaxed ); }
+
+	/** true after \c cancel was called on any copy */
+	bool cancelled() const
+	{ return m_pFlag->load( boost::memory_order_relaxed ); }
+
+protected:
+	friend class ProgressContext;
+	boost::shared_ptr< boost::atomic< bool > > m_pFlag;
+};
+
+/**
+ * The cancellation token and progress callback of an operation, both optional.
+ */
+class UBITRACK_EXPORT ProgressContext
+{
+public:
+	/** a context without token and callback */
+	ProgressContext()
+	{}
+
+	ProgressContext( const CancellationToken& token, const ProgressCallback& callback = ProgressCallback() )
+		: m_pCancelled( token.m_pFlag )
+		, m_callback( callback )
+	{}
+
+	/** true if the context has a token or a callback */
+	bool empty() const
+	{ return !m_pCancelled && !m_callback; }
+
+	/** true if the token was cancelled */
+	bool cancelled() const
+	{ return m_pCancelled && m_pCancelled->load( boost::memory_order_relaxed ); }
+
+	/** @throws OperationCancelled if the token was cancelled */
+	void check() const
+	{
+		if ( cancelled() )
+			throw OperationCancelled( __LINE__, __FILE__ );
+	}
+
+	/**
+	 * calls the callback with an iteration, then checks the token
+	 * @throws OperationCancelled if the token was cancelled
+	 */
+	void report( const char* algorithm, std::size_t iteration, double residual, double lambda = 0.0 ) const;
+
+	/** the context of the innermost \c ProgressScope of the calling thread */
+	static ProgressContext current();
+
+protected:
+	boost::shared_ptr< const boost::atomic< bool > > m_pCancelled;
+	ProgressCallback m_callback;
+};
+
+/**
+ * Makes a \c ProgressContext the context of the calling thread while it exists. Scopes nest,
+ * the previous context is restored by the destructor.
+ */
+class UBITRACK_EXPORT ProgressScope
+	: private boost::noncopyable
+{
+public:
+	/** hides the context of enclosing scopes, e.g. while a thread executes unrelated tasks */
+	ProgressScope();
+
+	explicit ProgressScope( const ProgressContext& context );
+
+	~ProgressScope();
+
+	/** true while a scope with a token or callback exists on any thread */
+	static bool anyActive()
+	{ return s_nActive.load( boost::memory_order_relaxed ) != 0; }
+
+	/** @internal \c ProgressContext::report on the context of the calling thread */
+	static void reportCurrent( const char* algorithm, std::size_t iteration, double residual, double lambda );
+
+	/** @internal \c ProgressContext::check on the context of the calling thread */
+	static void checkCurrent();
+
+protected:
+	friend class ProgressContext;
+
+	ProgressContext m_context;
+	const ProgressScope* m_pPrevious;
+	const bool m_bActive;
+
+	static boost::atomic< unsigned > s_nActive;
+};
+
+/**
+ * reports an iteration to the context of the calling thread and throws \c OperationCancelled
+ * if it was cancelled
+ */
+inline void reportProgress( const char* algorithm, std::size_t iteration, double residual, double lambda = 0.0 )
+{
+	if ( ProgressScope::anyActive() )
+		ProgressScope::reportCurrent( algorithm, iteration, residual, lambda );
+}
+
+/** throws \c OperationCancelled if the context of the calling thread was cancelled */
+inline void checkCancellation()
+{
+	if ( ProgressScope::anyActive() )
+		ProgressScope::checkCurrent();
+}
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,331 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+/**
+ * @ingroup util
+ * @file
+ * Implementation of the sampling profiler
+ */
+
+#include "SamplingProfiler.h"
+#include "OS.h"
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <time.h>
+#endif
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+/**
+ * @internal stack of the active scopes of one thread, written by its thread and read by the
+ * sampling threads with the sequence protocol of \c SeqLock
+ */
+struct ThreadStack
+{
+	ThreadStack()
+		: sequence( 0 )
+		, depth( 0 )
+	{
+		for ( unsigned i = 0; i < SamplingProfiler::maxDepth; i++ )
+			frames[ i ].store( 0, boost::memory_order_relaxed );
+#ifdef __linux__
+		hasClock = pthread_getcpuclockid( pthread_self(), &clock ) == 0;
+#endif
+	}
+
+	boost::atomic< unsigned > sequence;
+	boost::atomic< unsigned > depth;
+	boost::atomic< const char* > frames[ SamplingProfiler::maxDepth ];
+#ifdef __linux__
+	clockid_t clock;
+	bool hasClock;
+#endif
+};
+
+
+/// @internal all thread stacks, never destroyed as threads may exit after the static destructors
+struct Registry
+{
+	boost::mutex mutex;
+	std::vector< ThreadStack* > stacks;
+};
+
+Registry& registry()
+{
+	static Registry* pRegistry = new Registry;
+	return *pRegistry;
+}
+
+
+/// @internal number of running profilers, threads only push scopes while it is not zero
+boost::atomic< unsigned > g_running( 0 );
+
+#if defined( _MSC_VER )
+__declspec( thread ) ThreadStack* t_stack = 0;
+#else
+__thread ThreadStack* t_stack = 0;
+#endif
+
+void releaseStack( ThreadStack* pStack )
+{
+	Registry& reg( registry() );
+	{
+		boost::mutex::scoped_lock lock( reg.mutex );
+		reg.stacks.erase( std::remove( reg.stacks.begin(), reg.stacks.end(), pStack ), reg.stacks.end() );
+	}
+	delete pStack;
+}
+
+/// @internal owns the stack of each thread and removes it when the thread exits
+boost::thread_specific_ptr< ThreadStack > g_stackOwner( &releaseStack );
+
+ThreadStack* registerThread()
+{
+	ThreadStack* pStack = new ThreadStack;
+	{
+		Registry& reg( registry() );
+		boost::mutex::scoped_lock lock( reg.mutex );
+		reg.stacks.push_back( pStack );
+	}
+	g_stackOwner.reset( pStack );
+	t_stack = pStack;
+	return pStack;
+}
+
+} // anonymous namespace
+
+
+/// @internal the sampling thread and the recorded samples
+struct SamplingProfiler::Sampler
+{
+	Sampler( unsigned periodUs, bool cpuOnly )
+		: period( std::max( periodUs, 1u ) * 1000LL )
+		, cpuOnly( cpuOnly )
+		, stop( false )
+		, samples( 0 )
+	{}
+
+	void run()
+	{
+		PeriodicScheduler scheduler( period, 0 );
+		while ( !stop.load( boost::memory_order_acquire ) )
+		{
+			scheduler.wait();
+			sample();
+		}
+	}
+
+	void sample()
+	{
+		std::vector< std::string > stacks;
+		std::map< const void*, long long > cpuTimes;
+		{
+			Registry& reg( registry() );
+			boost::mutex::scoped_lock lock( reg.mutex );
+			for ( std::size_t i = 0; i < reg.stacks.size(); i++ )
+			{
+				const ThreadStack& s( *reg.stacks[ i ] );
+				if ( !s.depth.load( boost::memory_order_relaxed ) )
+					continue;
+
+#ifdef __linux__
+				if ( cpuOnly && s.hasClock )
+				{
+					// only threads that ran since the last sample
+					timespec ts;
+					if ( clock_gettime( s.clock, &ts ) != 0 )
+						continue;
+					const long long cpu = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+					cpuTimes[ &s ] = cpu;
+					std::map< const void*, long long >::const_iterator it = lastCpuTimes.find( &s );
+					if ( it == lastCpuTimes.end() || it->second == cpu )
+						continue;
+				}
+#endif
+
+				std::string stack;
+				if ( readStack( s, stack ) )
+					stacks.push_back( stack );
+			}
+		}
+		lastCpuTimes.swap( cpuTimes );
+
+		boost::mutex::scoped_lock lock( mutex );
+		for ( std::size_t i = 0; i < stacks.size(); i++ )
+			counts[ stacks[ i ] ]++;
+		samples += stacks.size();
+	}
+
+	/** copies a stack, fails if the thread changed it meanwhile */
+	static bool readStack( const ThreadStack& s, std::string& stack )
+	{
+		const unsigned sequence = s.sequence.load( boost::memory_order_acquire );
+		if ( sequence & 1 )
+			return false;
+
+		const char* frames[ SamplingProfiler::maxDepth ];
+		const unsigned depth = std::min( s.depth.load( boost::memory_order_relaxed ), SamplingProfiler::maxDepth );
+		for ( unsigned i = 0; i < depth; i++ )
+			frames[ i ] = s.frames[ i ].load( boost::memory_order_relaxed );
+
+		boost::atomic_thread_fence( boost::memory_order_acquire );
+		if ( s.sequence.load( boost::memory_order_relaxed ) != sequence )
+			return false;
+
+		for ( unsigned i = 0; i < depth; i++ )
+		{
+			if ( i )
+				stack += ';';
+			stack += frames[ i ];
+		}
+		return !stack.empty();
+	}
+
+	const long long period;
+	const bool cpuOnly;
+	boost::atomic< bool > stop;
+	boost::scoped_ptr< boost::thread > pThread;
+
+	/// only used by the sampling thread
+	std::map< const void*, long long > lastCpuTimes;
+
+	mutable boost::mutex mutex;
+	std::map< std::string, unsigned long long > counts;
+	unsigned long long samples;
+};
+
+
+SamplingProfiler::SamplingProfiler( unsigned periodUs, bool cpuOnly )
+	: m_pSampler( new Sampler( periodUs, cpuOnly ) )
+{
+}
+
+
+SamplingProfiler::~SamplingProfiler()
+{
+	stop();
+}
+
+
+void SamplingProfiler::start()
+{
+	if ( m_pSampler->pThread )
+		return;
+
+	g_running.fetch_add( 1, boost::memory_order_relaxed );
+	m_pSampler->stop.store( false, boost::memory_order_release );
+	m_pSampler->lastCpuTimes.clear();
+	m_pSampler->pThread.reset( new boost::thread( boost::bind( &Sampler::run, m_pSampler.get() ) ) );
+}
+
+
+void SamplingProfiler::stop()
+{
+	if ( !m_pSampler->pThread )
+		return;
+
+	m_pSampler->stop.store( true, boost::memory_order_release );
+	m_pSampler->pThread->join();
+	m_pSampler->pThread.reset();
+	g_running.fetch_sub( 1, boost::memory_order_relaxed );
+}
+
+
+bool SamplingProfiler::running() const
+{
+	return m_pSampler->pThread.get() != 0;
+}
+
+
+void SamplingProfiler::clear()
+{
+	boost::mutex::scoped_lock lock( m_pSampler->mutex );
+	m_pSampler->counts.clear();
+	m_pSampler->samples = 0;
+}
+
+
+unsigned long long SamplingProfiler::sampleCount() const
+{
+	boost::mutex::scoped_lock lock( m_pSampler->mutex );
+	return m_pSampler->samples;
+}
+
+
+std::map< std::string, unsigned long long > SamplingProfiler::collapsedStacks() const
+{
+	boost::mutex::scoped_lock lock( m_pSampler->mutex );
+	return m_pSampler->counts;
+}
+
+
+void SamplingProfiler::writeCollapsed( std::ostream& os ) const
+{
+	const std::map< std::string, unsigned long long > counts( collapsedStacks() );
+	for ( std::map< std::string, unsigned long long >::const_iterator it = counts.begin(); it != counts.end(); ++it )
+		os << it->first << ' ' << it->second << '\n';
+}
+
+
+bool SamplingProfiler::push( const char* name )
+{
+	if ( !g_running.load( boost::memory_order_relaxed ) )
+		return false;
+
+	ThreadStack* pStack = t_stack;
+	if ( !pStack )
+		pStack = registerThread();
+
+	const unsigned sequence = pStack->sequence.load( boost::memory_order_relaxed );
+	pStack->sequence.store( sequence + 1, boost::memory_order_relaxed );
+	boost::atomic_thread_fence( boost::memory_order_release );
+	const unsigned depth = pStack->depth.load( boost::memory_order_relaxed );
+	if ( depth < maxDepth )
+		pStack->frames[ depth ].store( name, boost::memory_order_relaxed );
+	pStack->depth.store( depth + 1, boost::memory_order_relaxed );
+	pStack->sequence.store( sequence + 2, boost::memory_order_release );
+	return true;
+}
+
+
+void SamplingProfiler::pop()
+{
+	ThreadStack* pStack = t_stack;
+	const unsigned sequence = pStack->sequence.load( boost::memory_order_relaxed );
+	pStack->sequence.store( sequence + 1, boost::memory_order_relaxed );
+	boost::atomic_thread_fence( boost::memory_order_release );
+	pStack->depth.store( pStack->depth.load( boost::memory_order_relaxed ) - 1, boost::memory_order_relaxed );
+	pStack->sequence.store( sequence + 2, boost::memory_order_release );
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,153 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+/**
+ * @ingroup util
+ * @file
+ * In-process sampling profiler over the active block timers and trace spans
+ */
+
+#ifndef __UBITRACK_UTIL_SAMPLINGPROFILER_H_INCLUDED__
+#define __UBITRACK_UTIL_SAMPLINGPROFILER_H_INCLUDED__
+
+#include <map>
+#include <ostream>
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Attributes CPU time to the instrumented scopes of the library without perf or ETW.
+ *
+ * While a profiler runs, every thread keeps a stack of the names of its active
+ * \c BlockTimer::Time and \c HistogramBlockTimer::Time scopes and \c UBITRACK_TRACE_SPAN
+ * spans. The stacks are written by their threads without locks. A sampling thread looks at
+ * all stacks once per period and counts each stack of a thread that used CPU time since the
+ * previous sample, so a Levenberg-Marquardt run inside a RANSAC run is counted as
+ * \c "ransac;levenberg_marquardt".
+ *
+ * The counts are exported as collapsed stacks, one line per stack, which \c flamegraph.pl
+ * and speedscope read directly:
+ * @code
+ * Util::SamplingProfiler profiler( 1000 ); // 1 kHz
+ * profiler.start();
+ * ...
+ * profiler.stop();
+ * std::ofstream out( "ubitrack.folded" );
+ * profiler.writeCollapsed( out );
+ * @endcode
+ *
+ * The per-thread CPU time is only available on Linux. On other systems, samples are taken
+ * from all threads in an instrumented scope, which attributes wall time instead.
+ *
+ * Scope names are not copied when they are pushed. They must be string literals or names
+ * of timers that outlive the profiling.
+ */
+class UBITRACK_EXPORT SamplingProfiler
+	: private boost::noncopyable
+{
+public:
+	/** maximum depth of the recorded stacks, deeper scopes are counted to their parent */
+	static const unsigned maxDepth = 32;
+
+	/**
+	 * @param periodUs sampling period in microseconds
+	 * @param cpuOnly only count threads that used CPU time since the last sample. Without
+	 *   this, a thread waiting in an instrumented scope is counted as well.
+	 */
+	explicit SamplingProfiler( unsigned periodUs = 1000, bool cpuOnly = true );
+
+	/** stops sampling */
+	~SamplingProfiler();
+
+	/** starts the sampling thread, the threads start recording their scopes from now on */
+	void start();
+
+	/** stops the sampling thread, the samples are kept */
+	void stop();
+
+	/** true between \c start and \c stop */
+	bool running() const;
+
+	/** discards the samples */
+	void clear();
+
+	/** number of recorded samples */
+	unsigned long long sampleCount() const;
+
+	/** the samples by stack, with frames separated by \c ';' */
+	std::map< std::string, unsigned long long > collapsedStacks() const;
+
+	/** writes the collapsed stacks as "frame;frame;frame count" lines */
+	void writeCollapsed( std::ostream& os ) const;
+
+	/**
+	 * Pushes a scope on the stack of the calling thread if any profiler is running.
+	 * @return true if the scope was pushed and must be popped
+	 */
+	static bool push( const char* name );
+
+	/** pops the innermost scope of the calling thread */
+	static void pop();
+
+protected:
+	struct Sampler;
+	boost::scoped_ptr< Sampler > m_pSampler;
+};
+
+
+/**
+ * Pushes a name onto the profiler stack of the thread for the lifetime of the object. Takes
+ * (and ignores) the attributes of \c UBITRACK_TRACE_SPAN, which expands to this class when
+ * event tracing is disabled.
+ */
+class ProfilerScope
+	: private boost::noncopyable
+{
+public:
+	explicit ProfilerScope( const char* name, unsigned long long = 0, unsigned long long = 0, unsigned long long = 0 )
+		: m_bPushed( SamplingProfiler::push( name ) )
+	{}
+
+	~ProfilerScope()
+	{
+		if ( m_bPushed )
+			SamplingProfiler::pop();
+	}
+
+	/** attributes are only traced by \c TraceSpan */
+	void set( unsigned, unsigned long long )
+	{}
+
+protected:
+	const bool m_bPushed;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
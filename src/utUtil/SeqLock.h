@@ -0,0 +1,113 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * A value that is published by one thread and read by others without locks
+ */
+
+#ifndef __UBITRACK_UTIL_SEQLOCK_H_INCLUDED__
+#define __UBITRACK_UTIL_SEQLOCK_H_INCLUDED__
+
+#include <boost/atomic.hpp>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * A sequence lock around a copy of a value.
+ *
+ * One writer publishes new values with \c store, any number of readers take consistent copies
+ * with \c load. The writer never waits. A reader retries its copy when a \c store ran
+ * concurrently, so reads are only cheap when the value is small and rarely written compared to
+ * the duration of a copy, e.g. a filter state that is read by render threads.
+ *
+ * \c T must be copyable without allocations or pointers to shared data, as a reader may copy
+ * a half-written value before discarding it, e.g. fixed-size vectors and matrices.
+ */
+template< class T >
+class SeqLock
+{
+public:
+	/** constructor, value-initializes the value */
+	SeqLock()
+		: m_sequence( 0 )
+		, m_value()
+	{}
+
+	/** constructor with an initial value */
+	explicit SeqLock( const T& value )
+		: m_sequence( 0 )
+		, m_value( value )
+	{}
+
+	/** copies the current value of another lock */
+	SeqLock( const SeqLock& other )
+		: m_sequence( 0 )
+		, m_value( other.load() )
+	{}
+
+	/** publishes the current value of another lock */
+	SeqLock& operator=( const SeqLock& other )
+	{
+		store( other.load() );
+		return *this;
+	}
+
+	/** publishes a new value, must only be called by one thread at a time */
+	void store( const T& value )
+	{
+		const unsigned sequence = m_sequence.load( boost::memory_order_relaxed );
+		m_sequence.store( sequence + 1, boost::memory_order_relaxed );
+		boost::atomic_thread_fence( boost::memory_order_release );
+		m_value = value;
+		m_sequence.store( sequence + 2, boost::memory_order_release );
+	}
+
+	/** returns a copy of the last published value */
+	T load() const
+	{
+		T value;
+		unsigned before;
+		unsigned after;
+		do
+		{
+			before = m_sequence.load( boost::memory_order_acquire );
+			value = m_value;
+			boost::atomic_thread_fence( boost::memory_order_acquire );
+			after = m_sequence.load( boost::memory_order_relaxed );
+		}
+		while ( ( before & 1 ) || before != after );
+		return value;
+	}
+
+protected:
+	/** odd while a store is in progress, incremented by 2 with each store */
+	boost::atomic< unsigned > m_sequence;
+
+	/** the value */
+	T m_value;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
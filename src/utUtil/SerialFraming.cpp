@@ -0,0 +1,218 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Framing of serial data streams
+ */
+
+#include "SerialFraming.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <utUtil/Exception.h>
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Util.SerialFraming" );
+
+// last, as it defines the parity macros N, O and E
+#include "SerialPort.h"
+
+namespace Ubitrack { namespace Util {
+
+LengthPrefixParser::LengthPrefixParser( std::size_t lengthOffset, std::size_t lengthBytes, std::size_t headerSize,
+	std::size_t trailerSize, bool bigEndian, std::size_t maxLength )
+	: m_lengthOffset( lengthOffset )
+	, m_lengthBytes( lengthBytes )
+	, m_headerSize( headerSize )
+	, m_trailerSize( trailerSize )
+	, m_bigEndian( bigEndian )
+	, m_maxLength( maxLength )
+{
+	if ( lengthBytes < 1 || lengthBytes > 4 || lengthOffset + lengthBytes > headerSize )
+		UBITRACK_THROW( "Invalid length field" );
+}
+
+
+long LengthPrefixParser::operator()( const unsigned char* data, std::size_t size ) const
+{
+	if ( size < m_headerSize )
+		return 0;
+
+	std::size_t length = 0;
+	for ( std::size_t i = 0; i < m_lengthBytes; i++ )
+	{
+		const std::size_t byte = m_bigEndian ? i : m_lengthBytes - 1 - i;
+		length = ( length << 8 ) | data[ m_lengthOffset + byte ];
+	}
+
+	length += m_headerSize + m_trailerSize;
+	if ( length > m_maxLength )
+		return -1;
+	return size >= length ? long( length ) : 0;
+}
+
+
+long cobsDecode( unsigned char* data, std::size_t size )
+{
+	if ( size > 0 && data[ size - 1 ] == 0 )
+		size--;
+
+	// the decoded data is never longer than the encoded data, so it can overwrite it
+	std::size_t in = 0;
+	std::size_t out = 0;
+	while ( in < size )
+	{
+		const unsigned char code = data[ in++ ];
+		if ( code == 0 || in + code - 1 > size )
+			return -1;
+		for ( unsigned char i = 1; i < code; i++ )
+			data[ out++ ] = data[ in++ ];
+		if ( code != 0xff && in < size )
+			data[ out++ ] = 0;
+	}
+	return long( out );
+}
+
+
+std::size_t cobsEncode( const unsigned char* data, std::size_t size, unsigned char* out )
+{
+	std::size_t code = 0;
+	std::size_t pos = 1;
+	unsigned char n = 1;
+	for ( std::size_t i = 0; i < size; i++ )
+	{
+		if ( data[ i ] != 0 )
+		{
+			out[ pos++ ] = data[ i ];
+			n++;
+		}
+		if ( data[ i ] == 0 || n == 0xff )
+		{
+			out[ code ] = n;
+			code = pos++;
+			n = 1;
+		}
+	}
+	out[ code ] = n;
+	out[ pos++ ] = 0;
+	return pos;
+}
+
+
+FrameBuffer::FrameBuffer( const FrameParser& parser, const FrameDecoder& decoder, std::size_t size )
+	: m_parser( parser )
+	, m_decoder( decoder )
+	, m_buffer( size )
+	, m_begin( 0 )
+	, m_end( 0 )
+{
+	if ( size == 0 )
+		UBITRACK_THROW( "Frame buffer must not be empty" );
+}
+
+
+unsigned char* FrameBuffer::prepare( std::size_t& space )
+{
+	if ( m_begin == m_end )
+		m_begin = m_end = 0;
+
+	// incomplete frames are moved to the front when less than a quarter is left
+	if ( m_begin > 0 && m_buffer.size() - m_end < m_buffer.size() / 4 )
+	{
+		std::memmove( &m_buffer[ 0 ], &m_buffer[ m_begin ], m_end - m_begin );
+		m_end -= m_begin;
+		m_begin = 0;
+	}
+
+	if ( m_end == m_buffer.size() )
+	{
+		LOG4CPP_WARN( logger, "Receive buffer is full without a complete frame, dropping " << m_end << " bytes" );
+		m_begin = m_end = 0;
+	}
+
+	space = m_buffer.size() - m_end;
+	return &m_buffer[ m_end ];
+}
+
+
+void FrameBuffer::commit( std::size_t n, std::vector< Frame >& frames )
+{
+	frames.clear();
+	m_end += n;
+	while ( m_begin < m_end )
+	{
+		unsigned char* data = &m_buffer[ m_begin ];
+		std::size_t length = m_end - m_begin;
+		if ( m_parser )
+		{
+			const long result = m_parser( data, length );
+			if ( result == 0 )
+				break;
+			if ( result < 0 )
+			{
+				m_begin += std::min( std::size_t( -result ), length );
+				continue;
+			}
+			length = std::min( std::size_t( result ), length );
+		}
+		m_begin += length;
+
+		if ( m_decoder )
+		{
+			const long decoded = m_decoder( data, length );
+			if ( decoded < 0 )
+			{
+				LOG4CPP_DEBUG( logger, "Dropping invalid frame of " << length << " bytes" );
+				continue;
+			}
+			length = std::size_t( decoded );
+		}
+
+		const Frame frame = { data, length };
+		frames.push_back( frame );
+	}
+}
+
+
+FrameReader::FrameReader( SerialPort& port, const FrameParser& parser, const FrameDecoder& decoder, std::size_t bufferSize )
+	: m_port( port )
+	, m_buffer( parser, decoder, bufferSize )
+{
+}
+
+
+Measurement::Timestamp FrameReader::read( std::vector< Frame >& frames )
+{
+	std::size_t space;
+	unsigned char* data = m_buffer.prepare( space );
+	const unsigned long n = m_port.read( data, (unsigned long)space );
+
+	// one clock read for all frames of the chunk
+	const Measurement::Timestamp arrival = n > 0 ? Measurement::now() : 0;
+	m_buffer.commit( n, frames );
+	return arrival;
+}
+
+} } // namespace Ubitrack::Util
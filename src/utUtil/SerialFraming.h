@@ -0,0 +1,253 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Framing of serial data streams
+ *
+ * Sensor drivers receive packets that are delimited by a fixed length, a length field or
+ * a delimiter. A \c FrameBuffer receives the data in chunks, splits them into frames with
+ * a \c FrameParser and optionally decodes the frames in place, e.g. COBS. The frames point
+ * into the buffer and are not copied.
+ *
+ * All frames completed by one chunk share the time at which the chunk was received, so
+ * the clock is read once per read call instead of once per sample. Drivers with a sensor
+ * clock correct these times with the packet version of \c TimestampSync::convertNativeToLocal.
+ *
+ * \c FrameReader reads frames with blocking \c SerialPort::read calls, \c SerialPortReactor
+ * uses the same buffer for asynchronous reads.
+ */
+
+#ifndef __UBITRACK_UTIL_SERIALFRAMING_H_INCLUDED__
+#define __UBITRACK_UTIL_SERIALFRAMING_H_INCLUDED__
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/utility.hpp>
+#include <boost/function.hpp>
+
+#include <utCore.h>
+#include <utMeasurement/Timestamp.h>
+
+namespace Ubitrack { namespace Util {
+
+// forward decls
+class SerialPort;
+
+
+/**
+ * Splits received data into frames.
+ * @return the length of a complete frame at the start of \c data, 0 if more data is
+ *   needed, or minus the number of bytes to skip to resynchronize
+ */
+typedef boost::function< long( const unsigned char* data, std::size_t size ) > FrameParser;
+
+/**
+ * Decodes a complete frame in place.
+ * @return the decoded length, or a negative number to drop an invalid frame
+ */
+typedef boost::function< long( unsigned char* data, std::size_t size ) > FrameDecoder;
+
+
+/** a frame in the receive buffer */
+struct Frame
+{
+	const unsigned char* data;
+	std::size_t size;
+};
+
+
+/** frame parser for packets of a fixed length */
+struct FixedLengthParser
+{
+	explicit FixedLengthParser( std::size_t length )
+		: m_length( length )
+	{}
+
+	long operator()( const unsigned char*, std::size_t size ) const
+	{ return size >= m_length ? long( m_length ) : 0; }
+
+	std::size_t m_length;
+};
+
+
+/** frame parser for packets terminated by a delimiter, e.g. NMEA sentences ending with '\\n' */
+struct DelimiterParser
+{
+	explicit DelimiterParser( unsigned char delimiter )
+		: m_delimiter( delimiter )
+	{}
+
+	long operator()( const unsigned char* data, std::size_t size ) const
+	{
+		for ( std::size_t i = 0; i < size; i++ )
+			if ( data[ i ] == m_delimiter )
+				return long( i + 1 );
+		return 0;
+	}
+
+	unsigned char m_delimiter;
+};
+
+
+/**
+ * frame parser for packets with a length field. A frame consists of \c headerSize bytes,
+ * which contain the length field, the number of bytes given by the length field and
+ * \c trailerSize bytes, e.g. a checksum.
+ */
+struct UBITRACK_EXPORT LengthPrefixParser
+{
+	/**
+	 * @param lengthOffset position of the length field in the header
+	 * @param lengthBytes size of the length field, 1 to 4 bytes
+	 * @param headerSize length of the header including the length field
+	 * @param trailerSize bytes following the payload
+	 * @param bigEndian byte order of the length field
+	 * @param maxLength frames that would be longer are treated as garbage and skipped byte by byte
+	 */
+	LengthPrefixParser( std::size_t lengthOffset, std::size_t lengthBytes, std::size_t headerSize,
+		std::size_t trailerSize = 0, bool bigEndian = false, std::size_t maxLength = 4096 );
+
+	long operator()( const unsigned char* data, std::size_t size ) const;
+
+	std::size_t m_lengthOffset;
+	std::size_t m_lengthBytes;
+	std::size_t m_headerSize;
+	std::size_t m_trailerSize;
+	bool m_bigEndian;
+	std::size_t m_maxLength;
+};
+
+
+/** frame parser for COBS encoded frames, which end with a zero byte */
+struct CobsParser
+{
+	long operator()( const unsigned char* data, std::size_t size ) const
+	{
+		// zero bytes between frames
+		if ( size > 0 && data[ 0 ] == 0 )
+			return -1;
+		return DelimiterParser( 0 )( data, size );
+	}
+};
+
+
+/**
+ * decodes a COBS frame in place, the terminating zero byte is removed.
+ * @return the decoded length or -1 if the frame is invalid
+ */
+UBITRACK_EXPORT long cobsDecode( unsigned char* data, std::size_t size );
+
+/**
+ * encodes \c size bytes with COBS, including the terminating zero byte.
+ * \c out must have room for <tt>size + size / 254 + 2</tt> bytes.
+ * @return the encoded length
+ */
+UBITRACK_EXPORT std::size_t cobsEncode( const unsigned char* data, std::size_t size, unsigned char* out );
+
+
+/**
+ * Receive buffer that splits the data into frames. Data is read directly into the
+ * buffer, and an incomplete frame is moved to the front when less than a quarter
+ * of the buffer is left.
+ */
+class UBITRACK_EXPORT FrameBuffer
+	: private boost::noncopyable
+{
+public:
+	/**
+	 * @param parser splits the data into frames, an empty parser makes every chunk a frame
+	 * @param decoder decodes the frames in place, may be empty
+	 * @param size size of the buffer, must be larger than the longest frame
+	 */
+	explicit FrameBuffer( const FrameParser& parser, const FrameDecoder& decoder = FrameDecoder(), std::size_t size = 64 * 1024 );
+
+	/**
+	 * returns where the next chunk is to be received. This invalidates the frames of
+	 * the previous chunk.
+	 * @param space receives the number of bytes that can be written
+	 */
+	unsigned char* prepare( std::size_t& space );
+
+	/**
+	 * adds \c n bytes received after \c prepare and replaces the contents of \c frames
+	 * with the complete frames
+	 */
+	void commit( std::size_t n, std::vector< Frame >& frames );
+
+	/** number of received bytes that are not part of a complete frame yet */
+	std::size_t pending() const
+	{ return m_end - m_begin; }
+
+	/** drops all pending data */
+	void clear()
+	{ m_begin = m_end = 0; }
+
+protected:
+	FrameParser m_parser;
+	FrameDecoder m_decoder;
+	std::vector< unsigned char > m_buffer;
+
+	/// pending data is in [ m_begin, m_end )
+	std::size_t m_begin;
+	std::size_t m_end;
+};
+
+
+/**
+ * Reads frames from a port with blocking reads. Each call of \c read reads all data the
+ * port has received, up to the free space in the buffer, with a single system call.
+ */
+class UBITRACK_EXPORT FrameReader
+	: private boost::noncopyable
+{
+public:
+	/**
+	 * @param port the port, opened with \c SerialPort::open
+	 * @param parser splits the data into frames
+	 * @param decoder decodes the frames in place, may be empty
+	 * @param bufferSize size of the receive buffer, must be larger than the longest frame
+	 */
+	FrameReader( SerialPort& port, const FrameParser& parser, const FrameDecoder& decoder = FrameDecoder(),
+		std::size_t bufferSize = 64 * 1024 );
+
+	/**
+	 * reads once, waiting as configured by the \c vtime and \c vmin of the port, and replaces
+	 * the contents of \c frames with the completed frames, which are valid until the next call.
+	 * @return the time at which the data was received, 0 if nothing was received
+	 */
+	Measurement::Timestamp read( std::vector< Frame >& frames );
+
+	/** the receive buffer */
+	FrameBuffer& buffer()
+	{ return m_buffer; }
+
+protected:
+	SerialPort& m_port;
+	FrameBuffer m_buffer;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
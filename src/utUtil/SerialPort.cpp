@@ -47,6 +47,21 @@ namespace Ubitrack { namespace Util {
 	* @brief Opens the serial port and configures it
 	*/
 void SerialPort::open( int vtime, int vmin )
+{
+	openPort( false, vtime, vmin );
+}
+
+
+/** @fn void SerialPort::openAsync()
+	* @brief Opens the serial port for overlapped reads
+	*/
+void SerialPort::openAsync()
+{
+	openPort( true, 0, 0 );
+}
+
+
+void SerialPort::openPort( bool async, int vtime, int vmin )
 {
 	DCB   dcb;
 
@@ -59,7 +74,7 @@ void SerialPort::open( int vtime, int vmin )
 	                            0,                             // Device isn't shared.
 	                            NULL,                          // Get default security.
 	                            OPEN_EXISTING,                 // Specify action to take.
-	                            0,                             // Flags and Atrributes.
+	                            async ? FILE_FLAG_OVERLAPPED : 0, // Flags and Atrributes.
 	                            NULL);                         // Template file.
 
 	if (m_hSerialPort == NULL) UBITRACK_THROW("Failed to open port.");
@@ -68,10 +83,19 @@ void SerialPort::open( int vtime, int vmin )
 	{
 		COMMTIMEOUTS  timeOuts;
 
-		timeOuts.ReadIntervalTimeout          = 0xFFFFFFFF;
-		timeOuts.ReadTotalTimeoutConstant     = vtime*100;
+		if ( async )
+		{
+			// overlapped reads complete after the first bytes, instead of immediately
+			timeOuts.ReadIntervalTimeout          = 1;
+			timeOuts.ReadTotalTimeoutConstant     = 0;
+		}
+		else
+		{
+			timeOuts.ReadIntervalTimeout          = 0xFFFFFFFF;
+			timeOuts.ReadTotalTimeoutConstant     = vtime*100;
+		}
 		timeOuts.ReadTotalTimeoutMultiplier   = 0;
-		timeOuts.WriteTotalTimeoutConstant    = vtime*100;
+		timeOuts.WriteTotalTimeoutConstant    = async ? 0 : vtime*100;
 		timeOuts.WriteTotalTimeoutMultiplier  = 0;
 
 		if (SetCommTimeouts(m_hSerialPort, &timeOuts) == 0) UBITRACK_THROW("Failed to set timeouts.");
@@ -102,6 +126,7 @@ void SerialPort::open( int vtime, int vmin )
 	}
 
 	// The serial port was opened successfully!
+	m_async = async;
 	m_portOpen = true;
 }
 
@@ -139,6 +164,9 @@ unsigned long SerialPort::read( unsigned char* buffer, unsigned long size )
 	if((m_portOpen != true) || (m_hSerialPort == NULL))
 		return -1;
 
+	if ( m_async )
+		UBITRACK_THROW( "Port is opened for asynchronous reads" );
+
 	ClearCommError(m_hSerialPort, &errorFlags, &comStat);
 	if(!comStat.cbInQue)
 		return 0;
@@ -173,7 +201,19 @@ unsigned long SerialPort::send( const unsigned char* buffer, unsigned long size
 	if((m_portOpen != true) || (m_hSerialPort == NULL))
 		return(0);
 
-	WriteFile(m_hSerialPort, buffer, size, &numBytesWritten, NULL);
+	if ( m_async )
+	{
+		// handles opened for overlapped I/O need an OVERLAPPED structure
+		OVERLAPPED overlapped;
+		memset( &overlapped, 0, sizeof( overlapped ) );
+		overlapped.hEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+		numBytesWritten = 0;
+		if ( !WriteFile( m_hSerialPort, buffer, size, &numBytesWritten, &overlapped ) && GetLastError() == ERROR_IO_PENDING )
+			GetOverlappedResult( m_hSerialPort, &overlapped, &numBytesWritten, TRUE );
+		CloseHandle( overlapped.hEvent );
+	}
+	else
+		WriteFile(m_hSerialPort, buffer, size, &numBytesWritten, NULL);
 //  printf("sent: ");
 //  for (int i=0; i<numBytesWritten; ++i) {
 //	  printf("%02X ", sendBuf[i]);
@@ -212,6 +252,12 @@ unsigned long SerialPort::bytesOnRead()
 	*/
 void SerialPort::flush()
 {
+	if ( m_async )
+	{
+		PurgeComm( m_hSerialPort, PURGE_RXCLEAR | PURGE_TXCLEAR );
+		return;
+	}
+
 	unsigned char buf[1000];
 	// Read serial port data
 	while(bytesOnRead() != 0)
@@ -244,6 +290,17 @@ void SerialPort::sendBreak()
 namespace Ubitrack { namespace Util {
 
 void SerialPort::open( int vtime, int vmin )
+{
+	openPort( false, vtime, vmin );
+}
+
+void SerialPort::openAsync()
+{
+	// the reactor uses non-blocking reads, which return whatever has arrived
+	openPort( true, 0, 1 );
+}
+
+void SerialPort::openPort( bool async, int vtime, int vmin )
 {
 	if ( m_portOpen )
 	{
@@ -316,6 +373,7 @@ void SerialPort::open( int vtime, int vmin )
 	if ( tcsetattr( m_fileDescriptor, TCSANOW, &m_termiosCurrent ) < 0 )
 		UBITRACK_THROW( "Cannot set port parameter" );
 
+	m_async = async;
 	m_portOpen = true;
 }
 
@@ -332,6 +390,7 @@ void SerialPort::close()
 	}
 
 	::close( m_fileDescriptor );
+	m_portOpen = false;
 }
 
 unsigned long SerialPort::read( unsigned char* buffer, unsigned long size )
@@ -341,6 +400,9 @@ unsigned long SerialPort::read( unsigned char* buffer, unsigned long size )
 	if ( !m_portOpen )
 		UBITRACK_THROW( "Port is not open" );
 
+	if ( m_async )
+		UBITRACK_THROW( "Port is opened for asynchronous reads" );
+
 	readBytes = ::read( m_fileDescriptor, (void*) buffer, size );
 
 	if ( readBytes < 0 )
@@ -66,6 +66,7 @@ public:
 		: m_portName( port )
 		, m_baudRate( baudRate )
 		, m_portOpen( false )
+		, m_async( false )
 		, m_bits( bits )
 		, m_parity( parity )
 		, m_stop( stop )
@@ -78,6 +79,13 @@ public:
 
 
 	void open( int vtime = 5, int vmin = 0 );
+
+	/**
+	 * opens the port for asynchronous reads by a \c SerialPortReactor.
+	 * Do not call \c read on a port opened this way.
+	 */
+	void openAsync();
+
 	void close();
 
 	unsigned long send( const unsigned char* buffer, unsigned long size );
@@ -92,11 +100,37 @@ public:
 		return m_baudRate;
 	}
 
+	bool isOpen() const
+	{
+		return m_portOpen;
+	}
+
+#ifdef _WIN32
+	typedef HANDLE NativeHandle;
+#else
+	typedef int NativeHandle;
+#endif
+
+	/** the handle of the open port */
+	NativeHandle nativeHandle() const
+	{
+#ifdef _WIN32
+		return m_hSerialPort;
+#else
+		return m_fileDescriptor;
+#endif
+	}
+
 protected:
 
+	/** opens the port, with overlapped I/O on windows if \c async is set */
+	void openPort( bool async, int vtime, int vmin );
+
+
 	std::string m_portName;
 	unsigned long m_baudRate;
 	bool m_portOpen;
+	bool m_async;
 	int m_bits, m_parity, m_stop;
 
 #ifdef _WIN32
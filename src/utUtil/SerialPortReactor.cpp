@@ -0,0 +1,299 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Event-driven reading of many serial ports on one thread
+ */
+
+#include "SerialPortReactor.h"
+
+#include <map>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <utUtil/Exception.h>
+
+#ifndef _WIN32
+	#include <unistd.h>
+#endif
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Util.SerialPortReactor" );
+
+// last, as it defines the parity macros N, O and E
+#include "SerialPort.h"
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+/// a registered port, only accessed by the I/O thread
+struct Port
+{
+	Port( boost::asio::io_service& service, const PacketHandler& _handler, const BatchHandler& _batchHandler,
+		const FrameParser& parser, const FrameDecoder& decoder, std::size_t bufferSize )
+		: stream( service )
+		, buffer( parser, decoder, bufferSize )
+		, handler( _handler )
+		, batchHandler( _batchHandler )
+		, closed( false )
+	{}
+
+	/// passes the complete packets to the handler
+	void dispatch( Measurement::Timestamp arrival )
+	{
+		if ( frames.empty() )
+			return;
+
+		if ( batchHandler )
+			call( batchHandler, &frames[ 0 ], frames.size(), arrival );
+		else
+			for ( std::size_t i = 0; i < frames.size() && !closed; i++ )
+				call( handler, frames[ i ].data, frames[ i ].size, arrival );
+	}
+
+	/// a failing handler does not stop the port
+	template< class Handler, class Data >
+	static void call( const Handler& h, Data data, std::size_t size, Measurement::Timestamp arrival )
+	{
+		try
+		{
+			h( data, size, arrival );
+		}
+		catch ( std::exception& e )
+		{
+			LOG4CPP_ERROR( logger, "Serial packet handler failed: " << e.what() );
+		}
+	}
+
+	boost::asio::serial_port stream;
+	FrameBuffer buffer;
+
+	/// packets of the last chunk
+	std::vector< Frame > frames;
+
+	PacketHandler handler;
+	BatchHandler batchHandler;
+
+	/// set by remove, completions of outstanding reads are ignored
+	bool closed;
+};
+
+typedef boost::shared_ptr< Port > PortPtr;
+
+} // anonymous namespace
+
+
+struct SerialPortReactor::Impl
+{
+	Impl()
+		: work( new boost::asio::io_service::work( service ) )
+		, nextChannel( 0 )
+	{
+		thread = boost::thread( boost::bind( &Impl::run, this ) );
+	}
+
+	void run()
+	{
+		service.run();
+	}
+
+	void startRead( const PortPtr& port )
+	{
+		if ( port->closed )
+			return;
+
+		std::size_t space;
+		unsigned char* data = port->buffer.prepare( space );
+		port->stream.async_read_some( boost::asio::buffer( data, space ),
+			boost::bind( &Impl::onRead, this, port, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred ) );
+	}
+
+	void onRead( const PortPtr& port, const boost::system::error_code& error, std::size_t bytes )
+	{
+		// the whole packet has arrived when the read completes
+		const Measurement::Timestamp arrival = Measurement::now();
+		if ( port->closed )
+			return;
+
+		if ( error )
+		{
+			LOG4CPP_ERROR( logger, "Error reading serial port, stopped reading: " << error.message() );
+			return;
+		}
+
+		port->buffer.commit( bytes, port->frames );
+		port->dispatch( arrival );
+		startRead( port );
+	}
+
+	/// closes ports on the I/O thread and signals \c done
+	void close( const std::vector< PortPtr >& closing, bool* done )
+	{
+		for ( std::size_t i = 0; i < closing.size(); i++ )
+		{
+			closing[ i ]->closed = true;
+			boost::system::error_code ignored;
+			closing[ i ]->stream.close( ignored );
+		}
+
+		boost::mutex::scoped_lock lock( mutex );
+		*done = true;
+		closed.notify_all();
+	}
+
+	/// closes ports and waits until no handler of them can run anymore
+	void closeAndWait( const std::vector< PortPtr >& closing )
+	{
+		bool done = false;
+		if ( boost::this_thread::get_id() == thread.get_id() )
+		{
+			close( closing, &done );
+			return;
+		}
+
+		service.post( boost::bind( &Impl::close, this, closing, &done ) );
+		boost::mutex::scoped_lock lock( mutex );
+		while ( !done )
+			closed.wait( lock );
+	}
+
+	boost::asio::io_service service;
+	boost::scoped_ptr< boost::asio::io_service::work > work;
+	boost::thread thread;
+
+	mutable boost::mutex mutex;
+	boost::condition_variable closed;
+	std::map< Channel, PortPtr > ports;
+	Channel nextChannel;
+};
+
+
+SerialPortReactor::SerialPortReactor()
+	: m_impl( new Impl )
+{
+}
+
+
+SerialPortReactor::~SerialPortReactor()
+{
+	std::vector< PortPtr > closing;
+	{
+		boost::mutex::scoped_lock lock( m_impl->mutex );
+		for ( std::map< Channel, PortPtr >::iterator it = m_impl->ports.begin(); it != m_impl->ports.end(); ++it )
+			closing.push_back( it->second );
+		m_impl->ports.clear();
+	}
+	m_impl->closeAndWait( closing );
+
+	// the thread ends when the aborted reads have completed
+	m_impl->work.reset();
+	m_impl->thread.join();
+}
+
+
+SerialPortReactor::Channel SerialPortReactor::add( SerialPort& port, const PacketHandler& handler,
+	const FrameParser& parser, std::size_t bufferSize )
+{
+	return addPort( port, handler, BatchHandler(), parser, FrameDecoder(), bufferSize );
+}
+
+
+SerialPortReactor::Channel SerialPortReactor::addBatched( SerialPort& port, const BatchHandler& handler,
+	const FrameParser& parser, const FrameDecoder& decoder, std::size_t bufferSize )
+{
+	return addPort( port, PacketHandler(), handler, parser, decoder, bufferSize );
+}
+
+
+SerialPortReactor::Channel SerialPortReactor::addPort( SerialPort& port, const PacketHandler& handler,
+	const BatchHandler& batchHandler, const FrameParser& parser, const FrameDecoder& decoder, std::size_t bufferSize )
+{
+	if ( !port.isOpen() )
+		UBITRACK_THROW( "Serial port is not open" );
+
+	PortPtr p( new Port( m_impl->service, handler, batchHandler, parser, decoder, bufferSize ) );
+
+	// read from a duplicate of the handle, which is closed by remove
+#ifdef _WIN32
+	HANDLE handle;
+	if ( !DuplicateHandle( GetCurrentProcess(), port.nativeHandle(), GetCurrentProcess(), &handle, 0, FALSE, DUPLICATE_SAME_ACCESS ) )
+		UBITRACK_THROW( "Cannot duplicate serial port handle" );
+#else
+	const int handle = ::dup( port.nativeHandle() );
+	if ( handle < 0 )
+		UBITRACK_THROW( "Cannot duplicate serial port handle" );
+#endif
+
+	boost::system::error_code error;
+	p->stream.assign( handle, error );
+	if ( error )
+	{
+#ifdef _WIN32
+		CloseHandle( handle );
+#else
+		::close( handle );
+#endif
+		UBITRACK_THROW( "Cannot read serial port asynchronously: " + error.message() );
+	}
+
+	Channel channel;
+	{
+		boost::mutex::scoped_lock lock( m_impl->mutex );
+		channel = m_impl->nextChannel++;
+		m_impl->ports[ channel ] = p;
+	}
+	m_impl->service.post( boost::bind( &Impl::startRead, m_impl.get(), p ) );
+	return channel;
+}
+
+
+void SerialPortReactor::remove( Channel channel )
+{
+	std::vector< PortPtr > closing;
+	{
+		boost::mutex::scoped_lock lock( m_impl->mutex );
+		std::map< Channel, PortPtr >::iterator it = m_impl->ports.find( channel );
+		if ( it == m_impl->ports.end() )
+			return;
+		closing.push_back( it->second );
+		m_impl->ports.erase( it );
+	}
+	m_impl->closeAndWait( closing );
+}
+
+
+std::size_t SerialPortReactor::size() const
+{
+	boost::mutex::scoped_lock lock( m_impl->mutex );
+	return m_impl->ports.size();
+}
+
+} } // namespace Ubitrack::Util
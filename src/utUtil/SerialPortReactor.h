@@ -0,0 +1,136 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Event-driven reading of many serial ports on one thread
+ *
+ * Reading a serial port with \c SerialPort::read needs a thread per port, which wakes up
+ * on the \c VTIME timeout and adds latency jitter to every packet. A \c SerialPortReactor
+ * waits for all its ports at once (epoll/kqueue or I/O completion ports, via boost::asio)
+ * on one I/O thread:
+ * @code
+ * Util::SerialPort port( "/dev/ttyUSB0", 115200 );
+ * port.openAsync();
+ * Util::SerialPortReactor reactor;
+ * reactor.add( port, boost::bind( &Imu::onPacket, this, _1, _2, _3 ), Util::FixedLengthParser( 32 ) );
+ * @endcode
+ *
+ * Every port has a preallocated \c FrameBuffer, into which the data is read directly.
+ * A frame parser finds the complete packets, which are passed to the handler in place,
+ * together with the time at which the read completed. Without a parser, the handler
+ * receives every chunk of data as it arrives. \c addBatched passes all packets of a
+ * chunk in one call.
+ *
+ * Handlers and parsers run on the I/O thread and must not block.
+ */
+
+#ifndef __UBITRACK_UTIL_SERIALPORTREACTOR_H_INCLUDED__
+#define __UBITRACK_UTIL_SERIALPORTREACTOR_H_INCLUDED__
+
+#include <cstddef>
+
+#include <boost/utility.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <utCore.h>
+#include <utMeasurement/Timestamp.h>
+#include <utUtil/SerialFraming.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Receives a packet, which is only valid during the call.
+ * @param arrival time at which the last byte of the packet was received
+ */
+typedef boost::function< void( const unsigned char* data, std::size_t size, Measurement::Timestamp arrival ) > PacketHandler;
+
+/**
+ * Receives all packets completed by one chunk of data, which are only valid during the call.
+ * @param arrival time at which the chunk was received
+ */
+typedef boost::function< void( const Frame* frames, std::size_t count, Measurement::Timestamp arrival ) > BatchHandler;
+
+
+/**
+ * Reads any number of serial ports on one I/O thread. All methods are thread-safe.
+ */
+class UBITRACK_EXPORT SerialPortReactor
+	: private boost::noncopyable
+{
+public:
+	/** identifies a registered port */
+	typedef unsigned Channel;
+
+	/** starts the I/O thread */
+	SerialPortReactor();
+
+	/** removes all ports and stops the I/O thread */
+	~SerialPortReactor();
+
+	/**
+	 * starts reading a port, which has to be opened with \c SerialPort::openAsync and
+	 * must stay open until it is removed.
+	 * @param port the port
+	 * @param handler receives the packets
+	 * @param parser splits the data into packets, an empty parser passes all data as it arrives
+	 * @param bufferSize size of the receive buffer, must be larger than the longest packet
+	 * @return channel to remove the port
+	 */
+	Channel add( SerialPort& port, const PacketHandler& handler, const FrameParser& parser = FrameParser(),
+		std::size_t bufferSize = 64 * 1024 );
+
+	/**
+	 * starts reading a port and passes the packets of each chunk in one call.
+	 * @param port the port, opened with \c SerialPort::openAsync
+	 * @param handler receives the packets
+	 * @param parser splits the data into packets
+	 * @param decoder decodes the packets in place, may be empty
+	 * @param bufferSize size of the receive buffer, must be larger than the longest packet
+	 * @return channel to remove the port
+	 */
+	Channel addBatched( SerialPort& port, const BatchHandler& handler, const FrameParser& parser,
+		const FrameDecoder& decoder = FrameDecoder(), std::size_t bufferSize = 64 * 1024 );
+
+	/**
+	 * stops reading a port. When this returns, the handler is not called anymore,
+	 * unless this is called by the handler itself.
+	 */
+	void remove( Channel channel );
+
+	/** number of registered ports */
+	std::size_t size() const;
+
+protected:
+	/// registers a port with either handler
+	Channel addPort( SerialPort& port, const PacketHandler& handler, const BatchHandler& batchHandler,
+		const FrameParser& parser, const FrameDecoder& decoder, std::size_t bufferSize );
+
+	struct Impl;
+	boost::scoped_ptr< Impl > m_impl;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Named shared memory regions
+ */
+
+#include "SharedMemory.h"
+#include "Exception.h"
+
+#ifdef _WIN32
+#include "CleanWindows.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Ubitrack { namespace Util {
+
+#ifdef _WIN32
+
+namespace {
+	// session local names do not need special privileges
+	std::string mappingName( const std::string& name )
+	{ return "Local\\" + name; }
+}
+
+
+SharedMemory::SharedMemory( const std::string& name, std::size_t size )
+	: m_name( name )
+	, m_data( 0 )
+	, m_size( size )
+	, m_bOwner( true )
+	, m_mapping( 0 )
+{
+	const unsigned long long size64 = size;
+	m_mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+		static_cast< DWORD >( size64 >> 32 ), static_cast< DWORD >( size64 & 0xFFFFFFFF ), mappingName( name ).c_str() );
+	if ( m_mapping && GetLastError() == ERROR_ALREADY_EXISTS )
+	{
+		// mappings cannot be replaced while another process holds them
+		CloseHandle( m_mapping );
+		UBITRACK_THROW( "Shared memory " + name + " is still in use" );
+	}
+	if ( m_mapping )
+		m_data = static_cast< unsigned char* >( MapViewOfFile( m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size ) );
+	if ( !m_data )
+	{
+		if ( m_mapping )
+			CloseHandle( m_mapping );
+		UBITRACK_THROW( "Could not create shared memory " + name );
+	}
+}
+
+
+SharedMemory::SharedMemory( const std::string& name )
+	: m_name( name )
+	, m_data( 0 )
+	, m_size( 0 )
+	, m_bOwner( false )
+	, m_mapping( 0 )
+{
+	m_mapping = OpenFileMappingA( FILE_MAP_ALL_ACCESS, FALSE, mappingName( name ).c_str() );
+	if ( m_mapping )
+		m_data = static_cast< unsigned char* >( MapViewOfFile( m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0 ) );
+	if ( !m_data )
+	{
+		if ( m_mapping )
+			CloseHandle( m_mapping );
+		UBITRACK_THROW( "Could not open shared memory " + name );
+	}
+
+	// the size of the view, rounded up to whole pages
+	MEMORY_BASIC_INFORMATION info;
+	VirtualQuery( m_data, &info, sizeof( info ) );
+	m_size = info.RegionSize;
+}
+
+
+SharedMemory::~SharedMemory()
+{
+	if ( m_data )
+		UnmapViewOfFile( m_data );
+	if ( m_mapping )
+		CloseHandle( m_mapping );
+}
+
+
+void SharedMemory::remove( const std::string& )
+{
+	// the mapping disappears with its last handle
+}
+
+#else // unix
+
+namespace {
+	std::string objectName( const std::string& name )
+	{ return "/" + name; }
+}
+
+
+SharedMemory::SharedMemory( const std::string& name, std::size_t size )
+	: m_name( name )
+	, m_data( 0 )
+	, m_size( size )
+	, m_bOwner( true )
+{
+	// a new object, so readers of a previous one are not affected by the different layout
+	shm_unlink( objectName( name ).c_str() );
+	const int fd = shm_open( objectName( name ).c_str(), O_RDWR | O_CREAT | O_EXCL, 0666 );
+	if ( fd < 0 )
+		UBITRACK_THROW( "Could not create shared memory " + name );
+
+	if ( ftruncate( fd, static_cast< off_t >( size ) ) != 0 )
+	{
+		close( fd );
+		shm_unlink( objectName( name ).c_str() );
+		UBITRACK_THROW( "Could not resize shared memory " + name );
+	}
+
+	void* p = mmap( 0, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( p == MAP_FAILED )
+	{
+		shm_unlink( objectName( name ).c_str() );
+		UBITRACK_THROW( "Could not map shared memory " + name );
+	}
+	m_data = static_cast< unsigned char* >( p );
+}
+
+
+SharedMemory::SharedMemory( const std::string& name )
+	: m_name( name )
+	, m_data( 0 )
+	, m_size( 0 )
+	, m_bOwner( false )
+{
+	const int fd = shm_open( objectName( name ).c_str(), O_RDWR, 0 );
+	if ( fd < 0 )
+		UBITRACK_THROW( "Could not open shared memory " + name );
+
+	struct stat info;
+	if ( fstat( fd, &info ) != 0 || info.st_size == 0 )
+	{
+		close( fd );
+		UBITRACK_THROW( "Could not determine the size of shared memory " + name );
+	}
+	m_size = static_cast< std::size_t >( info.st_size );
+
+	void* p = mmap( 0, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	// the mapping stays valid after closing the descriptor
+	close( fd );
+	if ( p == MAP_FAILED )
+		UBITRACK_THROW( "Could not map shared memory " + name );
+	m_data = static_cast< unsigned char* >( p );
+}
+
+
+SharedMemory::~SharedMemory()
+{
+	if ( m_data )
+		munmap( m_data, m_size );
+	if ( m_bOwner )
+		shm_unlink( objectName( m_name ).c_str() );
+}
+
+
+void SharedMemory::remove( const std::string& name )
+{
+	shm_unlink( objectName( name ).c_str() );
+}
+
+#endif
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,99 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Named shared memory regions
+ */
+
+#ifndef __UBITRACK_UTIL_SHAREDMEMORY_H_INCLUDED__
+#define __UBITRACK_UTIL_SHAREDMEMORY_H_INCLUDED__
+
+#include <string>
+
+#include <boost/utility.hpp>
+
+#include <utCore.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Maps a named region of memory read-write, for exchanging data between processes on the
+ * same machine. On unix this is a POSIX shared memory object, on Windows a mapping backed by
+ * the paging file. Names should start with a letter and must not contain slashes.
+ *
+ * The process that creates the region owns its name: the destructor removes the name, so
+ * other processes can no longer open it, but existing mappings stay valid until they are
+ * unmapped.
+ *
+ * Throws a \c Util::Exception if the region cannot be created, opened or mapped.
+ */
+class UBITRACK_EXPORT SharedMemory
+	: private boost::noncopyable
+{
+public:
+	/**
+	 * creates a region of \c size bytes, filled with zeros. An existing region with the
+	 * same name, e.g. left over from a crashed process, is replaced.
+	 */
+	SharedMemory( const std::string& name, std::size_t size );
+
+	/** opens the existing region \c name with its whole size */
+	explicit SharedMemory( const std::string& name );
+
+	/** unmaps the region and removes the name if it was created by this object */
+	~SharedMemory();
+
+	/** beginning of the region */
+	unsigned char* data() const
+	{ return m_data; }
+
+	/** size of the region in bytes */
+	std::size_t size() const
+	{ return m_size; }
+
+	/** name of the region */
+	const std::string& name() const
+	{ return m_name; }
+
+	/** true if the region was created by this object */
+	bool owner() const
+	{ return m_bOwner; }
+
+	/** removes the name of a region, does nothing if it does not exist */
+	static void remove( const std::string& name );
+
+protected:
+	std::string m_name;
+	unsigned char* m_data;
+	std::size_t m_size;
+	bool m_bOwner;
+
+#ifdef _WIN32
+	void* m_mapping;
+#endif
+};
+
+} } // namespace Ubitrack::Util
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Outcome of operations that fail in expected ways, without exceptions
+ */
+
+#ifndef __UBITRACK_UTIL_STATUS_H_INCLUDED__
+#define __UBITRACK_UTIL_STATUS_H_INCLUDED__
+
+#include <utCore.h>
+#include <utUtil/Exception.h>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * Result of an operation that can fail as part of normal operation, e.g. an estimator given a
+ * degenerate sample by RANSAC. Returning a \c Status costs no more than returning a pointer,
+ * while throwing and catching an exception costs microseconds, which adds up when it happens
+ * for many hypotheses.
+ *
+ * A \c Status converts to \c bool, so functions returning it can be used where a \c bool
+ * result is expected:
+ * @code
+ * Util::Status estimate( Math::Pose& pose, const std::vector< Math::Vector3d >& points )
+ * {
+ *     if ( collinear( points ) )
+ *         return Util::Status( Util::Status::Degenerate, "collinear points" );
+ *     ...
+ *     return Util::Status();
+ * }
+ * @endcode
+ * Callers that cannot handle the failure turn it into an exception with \c UBITRACK_CHECK_STATUS.
+ */
+class Status
+{
+	/// @internal safe-bool idiom, which converts to \c bool but not to integers
+	typedef const char* Status::*BoolType;
+
+public:
+	enum Code
+	{
+		Ok = 0,
+		/** the input does not determine a unique result, e.g. collinear points */
+		Degenerate,
+		/** an iterative method did not converge */
+		NotConverged,
+		/** a decomposition or solver failed */
+		NumericalError,
+		/** the input does not fulfill the requirements of the operation */
+		InvalidArgument
+	};
+
+	/** a successful result */
+	Status()
+		: m_code( Ok )
+		, m_message( "" )
+	{}
+
+	/**
+	 * a failure
+	 * @param code reason of the failure
+	 * @param message description, must be a string literal as it is not copied
+	 */
+	Status( Code code, const char* message )
+		: m_code( code )
+		, m_message( message )
+	{}
+
+	/** true on success */
+	bool ok() const
+	{ return m_code == Ok; }
+
+	/** true on success */
+	operator BoolType() const
+	{ return m_code == Ok ? &Status::m_message : 0; }
+
+	Code code() const
+	{ return m_code; }
+
+	/** description of the failure, empty on success */
+	const char* message() const
+	{ return m_message; }
+
+	/** throws a \c Util::Exception with the message of a failure */
+	void check( unsigned nLine = 0, const char* sFile = 0 ) const
+	{
+		if ( UBITRACK_UNLIKELY( m_code != Ok ) )
+			throwException( m_message, nLine, sFile );
+	}
+
+protected:
+	Code m_code;
+	const char* m_message;
+};
+
+} } // namespace Ubitrack::Util
+
+
+/**
+ * Throws an exception if a \c Util::Status is a failure.
+ * File and line number will be generated automatically.
+ */
+#define UBITRACK_CHECK_STATUS( status ) ( status ).check( __LINE__, __FILE__ )
+
+#endif
@@ -0,0 +1,389 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Process-wide registry of all block timers and periodic export of their statistics
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread_time.hpp>
+
+#include <utMeasurement/Timestamp.h>
+
+#include "TimerRegistry.h"
+#include "BlockTimer.h"
+#include "HistogramBlockTimer.h"
+
+#include <utUtil/LazyLogger.h>
+static Ubitrack::Util::LazyLogger logger( "Ubitrack.Util.TimerRegistry" );
+
+namespace Ubitrack { namespace Util {
+
+namespace {
+
+bool compareByName( const TimerStatistics& a, const TimerStatistics& b )
+{
+	return a.name < b.name || ( a.name == b.name && ( a.codeFile < b.codeFile || ( a.codeFile == b.codeFile && a.codeLine < b.codeLine ) ) );
+}
+
+/// identifies the same timer over consecutive snapshots
+std::string timerKey( const TimerStatistics& s )
+{
+	std::ostringstream key;
+	key << s.name << '@' << s.codeFile << ':' << s.codeLine;
+	return key.str();
+}
+
+void writeJsonString( std::ostream& out, const std::string& s )
+{
+	out << '"';
+	for ( std::string::const_iterator it = s.begin(); it != s.end(); ++it )
+		if ( *it == '"' || *it == '\\' )
+			out << '\\' << *it;
+		else if ( static_cast< unsigned char >( *it ) < 0x20 )
+			out << ' ';
+		else
+			out << *it;
+	out << '"';
+}
+
+/// statsd uses ':' and '|' as separators and does not allow blanks in metric names
+std::string statsdName( const std::string& s )
+{
+	std::string name( s );
+	for ( std::string::iterator it = name.begin(); it != name.end(); ++it )
+		if ( *it == ':' || *it == '|' || *it == '@' || std::isspace( static_cast< unsigned char >( *it ) ) )
+			*it = '_';
+	return name;
+}
+
+/// counter values per run of a block timer
+void setCounters( TimerStatistics& s, const BlockTimer& t )
+{
+	const std::size_t nRuns = t.getCounterRuns();
+	const PerfCounterValues counters( t.getCounters() );
+	s.hasCounters = nRuns && counters.valid;
+	double* const perRun[ PerfCounterValues::nEvents ] = { &s.cycles, &s.instructions, &s.l1Misses, &s.llcMisses, &s.branchMisses };
+	for ( unsigned i = 0; i < PerfCounterValues::nEvents; i++ )
+		*perRun[ i ] = s.hasCounters && counters.has( PerfCounterValues::Event( i ) ) ? double( counters.counts[ i ] ) / nRuns : -1.0;
+	s.ipc = s.cycles > 0 && s.instructions >= 0 ? s.instructions / s.cycles : -1.0;
+}
+
+void clearCounters( TimerStatistics& s )
+{
+	s.hasCounters = false;
+	s.cycles = s.instructions = s.ipc = s.l1Misses = s.llcMisses = s.branchMisses = -1.0;
+}
+
+typedef std::pair< const char*, double > NamedCounter;
+
+/// the available counters of a timer with their names in the reports
+std::vector< NamedCounter > namedCounters( const TimerStatistics& s )
+{
+	std::vector< NamedCounter > result;
+	if ( !s.hasCounters )
+		return result;
+	const NamedCounter counters[] = { NamedCounter( "cycles", s.cycles ), NamedCounter( "instructions", s.instructions ),
+		NamedCounter( "ipc", s.ipc ), NamedCounter( "l1_misses", s.l1Misses ), NamedCounter( "llc_misses", s.llcMisses ),
+		NamedCounter( "branch_misses", s.branchMisses ) };
+	for ( std::size_t i = 0; i < sizeof( counters ) / sizeof( counters[ 0 ] ); i++ )
+		if ( counters[ i ].second >= 0 )
+			result.push_back( counters[ i ] );
+	return result;
+}
+
+/// time elapsed since the high performance counter value \c start, in s
+double secondsSince( const unsigned long long start )
+{
+	return ( getHighPerformanceCounter() - start ) / getHighPerformanceFrequency();
+}
+
+} // anonymous namespace
+
+
+TimerRegistry& TimerRegistry::instance()
+{
+	// constructed by the first timer, so it outlives all static timers
+	static TimerRegistry registry;
+	return registry;
+}
+
+
+TimerRegistry::TimerRegistry()
+	: m_stopReporter( false )
+{}
+
+
+TimerRegistry::~TimerRegistry()
+{
+	stopReporter();
+}
+
+
+void TimerRegistry::add( const BlockTimer* timer )
+{
+	boost::mutex::scoped_lock l( m_mutex );
+	m_blockTimers.insert( timer );
+}
+
+
+void TimerRegistry::remove( const BlockTimer* timer )
+{
+	boost::mutex::scoped_lock l( m_mutex );
+	m_blockTimers.erase( timer );
+}
+
+
+void TimerRegistry::add( const HistogramBlockTimer* timer )
+{
+	boost::mutex::scoped_lock l( m_mutex );
+	m_histogramTimers.insert( timer );
+}
+
+
+void TimerRegistry::remove( const HistogramBlockTimer* timer )
+{
+	boost::mutex::scoped_lock l( m_mutex );
+	m_histogramTimers.erase( timer );
+}
+
+
+std::vector< TimerStatistics > TimerRegistry::snapshot() const
+{
+	std::vector< TimerStatistics > result;
+	boost::mutex::scoped_lock l( m_mutex );
+
+	for ( std::set< const BlockTimer* >::const_iterator it = m_blockTimers.begin(); it != m_blockTimers.end(); ++it )
+	{
+		const BlockTimer& t( **it );
+		TimerStatistics s;
+		s.runs = t.getRuns();
+		if ( !s.runs )
+			continue;
+		s.name = t.getName();
+		s.codeLine = t.initialized() ? t.getCodeLine() : 0;
+		if ( t.initialized() )
+			s.codeFile = t.getCodeFile();
+		s.total = t.getTotalTime();
+		s.avg = s.total / s.runs;
+		s.rate = s.runs / secondsSince( t.getStartTime() );
+		s.hasPercentiles = false;
+		s.p50 = s.p99 = s.p999 = s.max = 0.0;
+		setCounters( s, t );
+		result.push_back( s );
+	}
+
+	for ( std::set< const HistogramBlockTimer* >::const_iterator it = m_histogramTimers.begin(); it != m_histogramTimers.end(); ++it )
+	{
+		const HistogramBlockTimer& t( **it );
+		const HistogramBlockTimer::Statistics stats( t.getStatistics() );
+		if ( !stats.runs )
+			continue;
+		TimerStatistics s;
+		s.name = t.getName();
+		s.codeFile = t.getCodeFile();
+		s.codeLine = t.getCodeLine();
+		s.runs = stats.runs;
+		s.total = stats.total;
+		s.avg = stats.avg;
+		s.rate = s.runs / secondsSince( t.getStartTime() );
+		s.hasPercentiles = true;
+		s.p50 = stats.p50;
+		s.p99 = stats.p99;
+		s.p999 = stats.p999;
+		s.max = stats.max;
+		clearCounters( s );
+		result.push_back( s );
+	}
+
+	std::sort( result.begin(), result.end(), compareByName );
+	return result;
+}
+
+
+std::string TimerRegistry::format( const std::vector< TimerStatistics >& stats, Format format )
+{
+	std::ostringstream out;
+	const Measurement::Timestamp now( Measurement::now() );
+	for ( std::vector< TimerStatistics >::const_iterator it = stats.begin(); it != stats.end(); ++it )
+	{
+		if ( format == JsonLines )
+		{
+			out << "{\"timestamp\":" << now << ",\"name\":";
+			writeJsonString( out, it->name );
+			out << ",\"file\":";
+			writeJsonString( out, it->codeFile );
+			out << ",\"line\":" << it->codeLine
+				<< ",\"runs\":" << it->runs
+				<< ",\"rate\":" << it->rate
+				<< ",\"total_ms\":" << it->total
+				<< ",\"avg_ms\":" << it->avg;
+			if ( it->hasPercentiles )
+				out << ",\"p50_ms\":" << it->p50
+					<< ",\"p99_ms\":" << it->p99
+					<< ",\"p999_ms\":" << it->p999
+					<< ",\"max_ms\":" << it->max;
+			const std::vector< NamedCounter > counters( namedCounters( *it ) );
+			for ( std::vector< NamedCounter >::const_iterator c = counters.begin(); c != counters.end(); ++c )
+				out << ",\"" << c->first << "\":" << c->second;
+			out << "}\n";
+		}
+		else
+		{
+			const std::string name( statsdName( it->name ) );
+			out << name << ".runs:" << it->runs << "|g\n"
+				<< name << ".rate:" << it->rate << "|g\n"
+				<< name << ".avg:" << it->avg << "|g\n";
+			if ( it->hasPercentiles )
+				out << name << ".p50:" << it->p50 << "|g\n"
+					<< name << ".p99:" << it->p99 << "|g\n"
+					<< name << ".p999:" << it->p999 << "|g\n"
+					<< name << ".max:" << it->max << "|g\n";
+			const std::vector< NamedCounter > counters( namedCounters( *it ) );
+			for ( std::vector< NamedCounter >::const_iterator c = counters.begin(); c != counters.end(); ++c )
+				out << name << '.' << c->first << ':' << c->second << "|g\n";
+		}
+	}
+	return out.str();
+}
+
+
+std::vector< AllocationStatistics > TimerRegistry::allocationSnapshot() const
+{
+	return AllocationTracker::snapshot();
+}
+
+
+std::string TimerRegistry::format( const std::vector< AllocationStatistics >& stats, Format format )
+{
+	std::ostringstream out;
+	const Measurement::Timestamp now( Measurement::now() );
+	for ( std::vector< AllocationStatistics >::const_iterator it = stats.begin(); it != stats.end(); ++it )
+	{
+		if ( format == JsonLines )
+		{
+			out << "{\"timestamp\":" << now << ",\"allocations\":";
+			writeJsonString( out, it->category );
+			out << ",\"count\":" << it->allocations
+				<< ",\"frees\":" << it->deallocations
+				<< ",\"bytes\":" << it->bytes
+				<< ",\"live_bytes\":" << it->liveBytes
+				<< ",\"peak_bytes\":" << it->peakBytes
+				<< "}\n";
+		}
+		else
+		{
+			const std::string name( "allocations." + statsdName( it->category ) );
+			out << name << ".count:" << it->allocations << "|g\n"
+				<< name << ".bytes:" << it->bytes << "|g\n"
+				<< name << ".live_bytes:" << it->liveBytes << "|g\n"
+				<< name << ".peak_bytes:" << it->peakBytes << "|g\n";
+		}
+	}
+	return out.str();
+}
+
+
+void TimerRegistry::startReporter( unsigned intervalMs, Format format, const Sink& sink )
+{
+	stopReporter();
+	m_stopReporter = false;
+	m_reporter.reset( new boost::thread( boost::bind( &TimerRegistry::reporterLoop, this, intervalMs, format, sink ) ) );
+}
+
+
+void TimerRegistry::stopReporter()
+{
+	if ( !m_reporter )
+		return;
+
+	{
+		boost::mutex::scoped_lock l( m_reporterMutex );
+		m_stopReporter = true;
+	}
+	m_reporterCondition.notify_all();
+	m_reporter->join();
+	m_reporter.reset();
+}
+
+
+void TimerRegistry::reporterLoop( unsigned intervalMs, Format format, Sink sink )
+{
+	std::map< std::string, std::size_t > previousRuns;
+	boost::system_time deadline( boost::get_system_time() );
+	while ( true )
+	{
+		deadline += boost::posix_time::milliseconds( intervalMs );
+		{
+			boost::mutex::scoped_lock l( m_reporterMutex );
+			while ( !m_stopReporter && m_reporterCondition.timed_wait( l, deadline ) )
+				;
+			if ( m_stopReporter )
+				return;
+		}
+
+		// rates of the last interval instead of the whole lifetime
+		std::vector< TimerStatistics > stats( snapshot() );
+		std::map< std::string, std::size_t > runs;
+		for ( std::vector< TimerStatistics >::iterator it = stats.begin(); it != stats.end(); ++it )
+		{
+			const std::string key( timerKey( *it ) );
+			std::map< std::string, std::size_t >::const_iterator prev = previousRuns.find( key );
+			if ( prev != previousRuns.end() && prev->second <= it->runs )
+				it->rate = ( it->runs - prev->second ) * 1000.0 / intervalMs;
+			runs[ key ] = it->runs;
+		}
+		previousRuns.swap( runs );
+
+		std::string report( TimerRegistry::format( stats, format ) );
+		if ( AllocationTracker::enabled() )
+			report += TimerRegistry::format( allocationSnapshot(), format );
+		if ( report.empty() )
+			continue;
+
+		try
+		{
+			if ( sink )
+				sink( report );
+			else
+			{
+				std::istringstream lines( report );
+				std::string line;
+				while ( std::getline( lines, line ) )
+					LOG4CPP_INFO( logger, line );
+			}
+		}
+		catch ( const std::exception& e )
+		{
+			LOG4CPP_ERROR( logger, "Timer report failed: " << e.what() );
+		}
+	}
+}
+
+} } // namespace Ubitrack::Util
@@ -0,0 +1,174 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the 
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @file
+ * Process-wide registry of all block timers and periodic export of their statistics
+ */
+
+#ifndef __UBITRACK_UTIL_TIMER_REGISTRY_H_INCLUDED__
+#define __UBITRACK_UTIL_TIMER_REGISTRY_H_INCLUDED__
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <utCore.h>
+#include <utUtil/AllocationTracker.h>
+
+namespace Ubitrack { namespace Util {
+
+// forward decls
+class BlockTimer;
+class HistogramBlockTimer;
+
+
+/** statistics of one timer at the time of a snapshot, times in ms */
+struct TimerStatistics
+{
+	std::string name;
+
+	/// code location of the first timed block, empty if unknown
+	std::string codeFile;
+	unsigned codeLine;
+
+	std::size_t runs;
+	double total;
+	double avg;
+
+	/// runs per second since the timer was created, or since the previous report
+	double rate;
+
+	/// percentiles and maximum, only recorded by \c HistogramBlockTimer
+	bool hasPercentiles;
+	double p50;
+	double p99;
+	double p999;
+	double max;
+
+	/**
+	 * hardware counters per run, only recorded by \c BlockTimer with enabled counters.
+	 * Events that are not available on the system are negative.
+	 */
+	bool hasCounters;
+	double cycles;
+	double instructions;
+	/// instructions per cycle
+	double ipc;
+	double l1Misses;
+	double llcMisses;
+	double branchMisses;
+};
+
+
+/**
+ * Registry of all \c BlockTimer and \c HistogramBlockTimer objects of the process.
+ *
+ * Timers add themselves on construction and remove themselves on destruction, so the
+ * statistics of a long-running process can be inspected at any time with \c snapshot,
+ * instead of only when the timers are destroyed at shutdown.
+ *
+ * \c startReporter starts a thread that periodically formats a snapshot either as JSON
+ * lines or as statsd text and passes it to a sink, by default the log4cpp category
+ * \c Ubitrack.Util.TimerRegistry. Timers without runs are not reported.
+ */
+class UBITRACK_EXPORT TimerRegistry
+	: private boost::noncopyable
+{
+public:
+	/** output formats of the reporter */
+	enum Format
+	{
+		/// one JSON object per timer and line
+		JsonLines,
+
+		/// statsd gauges, e.g. <tt>name.p99:0.42|g</tt>, one per line
+		Statsd
+	};
+
+	/** receives the formatted reports */
+	typedef boost::function< void( const std::string& ) > Sink;
+
+	/** the registry of the process */
+	static TimerRegistry& instance();
+
+	/** stops the reporter */
+	~TimerRegistry();
+
+	void add( const BlockTimer* timer );
+	void remove( const BlockTimer* timer );
+	void add( const HistogramBlockTimer* timer );
+	void remove( const HistogramBlockTimer* timer );
+
+	/** current statistics of all timers that have been run, sorted by name */
+	std::vector< TimerStatistics > snapshot() const;
+
+	/** formats the statistics, one line per timer */
+	static std::string format( const std::vector< TimerStatistics >& stats, Format format );
+
+	/**
+	 * current statistics of the tracked allocations, see \c AllocationTracker. The reporter
+	 * appends them to each report if the library is built with \c UBITRACK_TRACK_ALLOCATIONS.
+	 */
+	std::vector< AllocationStatistics > allocationSnapshot() const;
+
+	/** formats the allocation statistics, one line per category */
+	static std::string format( const std::vector< AllocationStatistics >& stats, Format format );
+
+	/**
+	 * starts (or restarts) the background reporter.
+	 * @param intervalMs time between two reports
+	 * @param format output format
+	 * @param sink receiver of the reports, an empty sink logs to log4cpp
+	 */
+	void startReporter( unsigned intervalMs, Format format = JsonLines, const Sink& sink = Sink() );
+
+	/** stops the background reporter */
+	void stopReporter();
+
+protected:
+	TimerRegistry();
+
+	/// body of the reporter thread
+	void reporterLoop( unsigned intervalMs, Format format, Sink sink );
+
+	mutable boost::mutex m_mutex;
+	std::set< const BlockTimer* > m_blockTimers;
+	std::set< const HistogramBlockTimer* > m_histogramTimers;
+
+	boost::scoped_ptr< boost::thread > m_reporter;
+	boost::mutex m_reporterMutex;
+	boost::condition_variable m_reporterCondition;
+	bool m_stopReporter;
+};
+
+} } // namespace Ubitrack::Util
+
+#endif //__UBITRACK_UTIL_TIMER_REGISTRY_H_INCLUDED__
@@ -0,0 +1,191 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+/**
+ * @ingroup dataflow_framework
+ * @file
+ * Scoped tracing spans with numeric attributes
+ *
+ * A span traces the execution of a block, e.g. an estimator or the serialization of a
+ * measurement, with an event at its begin and one at its end. It carries up to three numeric
+ * attributes such as the problem size, the number of iterations or the number of bytes:
+ * @code
+ * Math::Pose estimatePose( const std::vector< Math::Vector3d >& points )
+ * {
+ *     UBITRACK_TRACE_SPAN( "pose_estimation_3d3d", points.size() );
+ *     ...
+ *     UBITRACK_TRACE_SPAN_SET( 1, iterations );
+ * }
+ * @endcode
+ * The attributes are reported with both events, so values that are only known at the end,
+ * like the iteration count, can be set with \c UBITRACK_TRACE_SPAN_SET before leaving the
+ * block. There can be only one span per block.
+ *
+ * The events are sent to the tracing backend selected in TracingProvider.h:
+ * - LTTng: \c ubitrack:span_begin and \c ubitrack:span_end
+ * - DTrace: \c span-begin and \c span-end, with the duration in nanoseconds at the end
+ * - ETW: \c SpanBegin and \c SpanEnd, with the duration in milliseconds at the end
+ *
+ * With \c ENABLE_FLIGHT_RECORDER, the begin and end of each span are also recorded by the
+ * \c FlightRecorder while it runs, as \c 'B' and \c 'E' events with the attributes \c attr0
+ * to \c attr2.
+ *
+ * Spans are also scopes of the \c SamplingProfiler. Without \c ENABLE_EVENT_TRACING and
+ * \c ENABLE_FLIGHT_RECORDER, a span is only a \c ProfilerScope, which costs a call when no profiler runs, and
+ * \c UBITRACK_TRACE_SPAN_SET expands to nothing. Defining \c UBITRACK_NO_PROFILER_SCOPES
+ * removes the spans of such builds completely.
+ */
+
+#ifndef UBITRACK_TRACESPAN_H
+#define UBITRACK_TRACESPAN_H
+
+#include <utUtil/TracingProvider.h>
+#include <utUtil/SamplingProfiler.h>
+
+#if defined(ENABLE_EVENT_TRACING) || defined(ENABLE_FLIGHT_RECORDER)
+
+#include <utCore.h>
+
+#if defined(ENABLE_EVENT_TRACING) && defined(HAVE_DTRACE) && !defined(DISABLE_DTRACE)
+#include <utUtil/OS.h>
+#endif
+
+#include <boost/utility.hpp>
+
+namespace Ubitrack { namespace Util {
+
+/**
+ * RAII object behind \c UBITRACK_TRACE_SPAN. Use the macros instead of this class, so the
+ * spans disappear from builds without tracing.
+ */
+class TraceSpan
+	: private boost::noncopyable
+{
+public:
+	/**
+	 * sends the begin event
+	 * @param name name of the span, must be a string literal
+	 * @param attr0 first attribute, e.g. the problem size
+	 * @param attr1 second attribute, e.g. the number of iterations
+	 * @param attr2 third attribute, e.g. the number of bytes
+	 */
+	explicit TraceSpan( const char* name, unsigned long long attr0 = 0, unsigned long long attr1 = 0,
+		unsigned long long attr2 = 0 )
+		: m_name( name )
+		, m_start( 0 )
+		, m_scope( name )
+	{
+		m_attr[ 0 ] = attr0;
+		m_attr[ 1 ] = attr1;
+		m_attr[ 2 ] = attr2;
+
+#ifdef ENABLE_FLIGHT_RECORDER
+		FlightRecorder::record( 'B', m_name, "attr0,attr1,attr2", m_attr[ 0 ], m_attr[ 1 ], m_attr[ 2 ] );
+#endif
+#ifdef ENABLE_EVENT_TRACING
+#if defined(HAVE_DTRACE) && !defined(DISABLE_DTRACE)
+		if ( UBITRACK_SPAN_BEGIN_ENABLED() || UBITRACK_SPAN_END_ENABLED() )
+		{
+			m_start = getMonotonicTime();
+			UBITRACK_SPAN_BEGIN( m_name, m_attr[ 0 ], m_attr[ 1 ], m_attr[ 2 ] );
+		}
+#endif
+#ifdef HAVE_ETW
+		m_start = ETWUbitrackSpanBegin( m_name, m_attr[ 0 ], m_attr[ 1 ], m_attr[ 2 ] );
+#endif
+#ifdef HAVE_LTTNGUST
+		tracepoint( ubitrack, span_begin, m_name, m_attr[ 0 ], m_attr[ 1 ], m_attr[ 2 ] );
+#endif
+#endif // ENABLE_EVENT_TRACING
+	}
+
+	/** sends the end event */
+	~TraceSpan()
+	{
+#ifdef ENABLE_FLIGHT_RECORDER
+		FlightRecorder::record( 'E', m_name, "attr0,attr1,attr2", m_attr[ 0 ], m_attr[ 1 ], m_attr[ 2 ] );
+#endif
+#ifdef ENABLE_EVENT_TRACING
+#if defined(HAVE_DTRACE) && !defined(DISABLE_DTRACE)
+		if ( UBITRACK_SPAN_END_ENABLED() && m_start )
+			UBITRACK_SPAN_END( m_name, m_attr[ 0 ], m_attr[ 1 ], m_attr[ 2 ], getMonotonicTime() - m_start );
+#endif
+#ifdef HAVE_ETW
+		ETWUbitrackSpanEnd( m_name, m_attr[ 0 ], m_attr[ 1 ], m_attr[ 2 ], m_start );
+#endif
+#ifdef HAVE_LTTNGUST
+		tracepoint( ubitrack, span_end, m_name, m_attr[ 0 ], m_attr[ 1 ], m_attr[ 2 ] );
+#endif
+#endif // ENABLE_EVENT_TRACING
+	}
+
+	/** changes attribute \c i (0 to 2), which is reported with the end event */
+	void set( unsigned i, unsigned long long value )
+	{
+		if ( i < 3 )
+			m_attr[ i ] = value;
+	}
+
+protected:
+	const char* m_name;
+	unsigned long long m_attr[ 3 ];
+	/// start time of the backend, 0 if the end event is not needed
+	long long m_start;
+	ProfilerScope m_scope;
+};
+
+} } // namespace Ubitrack::Util
+
+/*
+ * UBITRACK_TRACE_SPAN(name, attr0, attr1, attr2)
+ * traces the execution of the enclosing block
+ * parameters:
+ * - name: name of the span, a string literal
+ * - attr0, attr1, attr2: optional numeric attributes
+ *
+ * example:
+ * UBITRACK_TRACE_SPAN("homography_dlt", fromPoints.size())
+ */
+#define UBITRACK_TRACE_SPAN( ... ) Ubitrack::Util::TraceSpan ___ubitrack_trace_span( __VA_ARGS__ )
+
+/*
+ * UBITRACK_TRACE_SPAN_SET(index, value)
+ * sets an attribute of the span of the enclosing block
+ *
+ * example:
+ * UBITRACK_TRACE_SPAN_SET(1, iterations)
+ */
+#define UBITRACK_TRACE_SPAN_SET( index, value ) ___ubitrack_trace_span.set( index, static_cast< unsigned long long >( value ) )
+
+#elif !defined( UBITRACK_NO_PROFILER_SCOPES )
+
+#define UBITRACK_TRACE_SPAN( ... ) Ubitrack::Util::ProfilerScope ___ubitrack_trace_span( __VA_ARGS__ )
+#define UBITRACK_TRACE_SPAN_SET( index, value )
+
+#else // ENABLE_EVENT_TRACING || ENABLE_FLIGHT_RECORDER
+
+#define UBITRACK_TRACE_SPAN( ... )
+#define UBITRACK_TRACE_SPAN_SET( index, value )
+
+#endif // ENABLE_EVENT_TRACING || ENABLE_FLIGHT_RECORDER
+
+#endif // UBITRACK_TRACESPAN_H
@@ -26,12 +26,80 @@
  * @file
  * The main include for tracing the eventqueue activity
  *
+ * Scoped spans around estimators, serializers and filter updates are in TraceSpan.h.
+ *
+ * With \c ENABLE_FLIGHT_RECORDER, the tracepoints are also recorded by the
+ * \c Util::FlightRecorder while it runs, with or without a tracing backend.
+ *
  * @author Ulrich Eck <ueck@net-labs.de>
  */ 
 
 #ifndef UBITRACK_TRACINGPROVIDER_H
 #define UBITRACK_TRACINGPROVIDER_H
 
+#ifdef ENABLE_FLIGHT_RECORDER
+
+#include <utUtil/FlightRecorder.h>
+
+/*
+ * UBITRACK_FLIGHT_*(...)
+ * records a tracepoint in the flight recorder, called by the TRACEPOINT_ macro of the same name
+ */
+#define UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)\
+  Ubitrack::Util::FlightRecorder::record('B', "eventqueue_dispatch", "domain,priority", event_domain, event_priority,\
+    Ubitrack::Util::FlightValue(), component_name, component_port);
+#define UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)\
+  Ubitrack::Util::FlightRecorder::record('E', "eventqueue_dispatch", "domain,priority", event_domain, event_priority,\
+    Ubitrack::Util::FlightValue(), component_name, component_port);
+#define UBITRACK_FLIGHT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)\
+  Ubitrack::Util::FlightRecorder::record('i', "measurement_create", "domain,priority", event_domain, event_priority,\
+    Ubitrack::Util::FlightValue(), component_name, component_port);
+#define UBITRACK_FLIGHT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)\
+  Ubitrack::Util::FlightRecorder::record('i', "measurement_receive", "domain,priority", event_domain, event_priority,\
+    Ubitrack::Util::FlightValue(), component_name, component_port);
+
+#define UBITRACK_FLIGHT_VISION_ALLOCATE_CPU(bytes)\
+  Ubitrack::Util::FlightRecorder::record('i', "vision_allocate_cpu", "bytes", bytes);
+#define UBITRACK_FLIGHT_VISION_ALLOCATE_GPU(bytes)\
+  Ubitrack::Util::FlightRecorder::record('i', "vision_allocate_gpu", "bytes", bytes);
+#define UBITRACK_FLIGHT_VISION_GPU_UPLOAD(bytes)\
+  Ubitrack::Util::FlightRecorder::record('i', "vision_gpu_upload", "bytes", bytes);
+#define UBITRACK_FLIGHT_VISION_GPU_DOWNLOAD(bytes)\
+  Ubitrack::Util::FlightRecorder::record('i', "vision_gpu_download", "bytes", bytes);
+
+#define UBITRACK_FLIGHT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)\
+  Ubitrack::Util::FlightRecorder::record('i', "lm_iteration", "iteration,residual,lambda", (unsigned int)(iteration),\
+    (double)(residual), (double)(lambda));
+#define UBITRACK_FLIGHT_OPTIMIZATION_RANSAC(iterations, inliers, values)\
+  Ubitrack::Util::FlightRecorder::record('i', "ransac_result", "iterations,inliers,values", (unsigned int)(iterations),\
+    (unsigned int)(inliers), (unsigned int)(values));
+#define UBITRACK_FLIGHT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)\
+  Ubitrack::Util::FlightRecorder::record('i', "kalman_update", "timestamp,dimension", timestamp, (unsigned int)(dimension),\
+    Ubitrack::Util::FlightValue(), update_type);
+#define UBITRACK_FLIGHT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)\
+  Ubitrack::Util::FlightRecorder::record('i', "clustering_iteration", "iteration,clusters,value", (unsigned int)(iteration),\
+    (unsigned int)(clusters), (double)(value), algorithm);
+
+#else // ENABLE_FLIGHT_RECORDER
+
+#define UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)
+#define UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)
+#define UBITRACK_FLIGHT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)
+#define UBITRACK_FLIGHT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)
+
+#define UBITRACK_FLIGHT_VISION_ALLOCATE_CPU(bytes)
+#define UBITRACK_FLIGHT_VISION_ALLOCATE_GPU(bytes)
+#define UBITRACK_FLIGHT_VISION_GPU_UPLOAD(bytes)
+#define UBITRACK_FLIGHT_VISION_GPU_DOWNLOAD(bytes)
+
+#define UBITRACK_FLIGHT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)
+#define UBITRACK_FLIGHT_OPTIMIZATION_RANSAC(iterations, inliers, values)
+#define UBITRACK_FLIGHT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)
+#define UBITRACK_FLIGHT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)
+
+#endif // ENABLE_FLIGHT_RECORDER
+
+
 #ifdef ENABLE_EVENT_TRACING
 
 #if defined(HAVE_DTRACE) && !defined(DISABLE_DTRACE)
@@ -64,17 +132,20 @@
 #define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)\
   if (UBITRACK_EVENTQUEUE_DISPATCH_BEGIN_ENABLED()) {\
     UBITRACK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port);\
-  }
+  }\
+  UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)
 #endif
 
 #ifdef HAVE_ETW
 #define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)\
-  ___ubitrack_tracing_startTime = ETWUbitrackEventQueueDispatchBegin(event_domain, event_priority, component_name, component_port);
+  ___ubitrack_tracing_startTime = ETWUbitrackEventQueueDispatchBegin(event_domain, event_priority, component_name, component_port);\
+  UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)
 #endif
 
 #ifdef HAVE_LTTNGUST
 #define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)\
-  tracepoint(ubitrack, eventqueue_dispatch_begin, event_domain, event_priority, component_name, component_port);
+  tracepoint(ubitrack, eventqueue_dispatch_begin, event_domain, event_priority, component_name, component_port);\
+  UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)
 #endif
 
 
@@ -96,17 +167,20 @@
 #define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)\
   if (UBITRACK_EVENTQUEUE_DISPATCH_END_ENABLED()) {\
     UBITRACK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port);\
-  }
+  }\
+  UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)
 #endif
 
 #ifdef HAVE_ETW
 #define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)\
-  ETWUbitrackEventQueueDispatchEnd(event_domain, event_priority, component_name, component_port,___ubitrack_tracing_startTime);
+  ETWUbitrackEventQueueDispatchEnd(event_domain, event_priority, component_name, component_port,___ubitrack_tracing_startTime);\
+  UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)
 #endif
 
 #ifdef HAVE_LTTNGUST
 #define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)\
-  tracepoint(ubitrack, eventqueue_dispatch_end, event_domain, event_priority, component_name, component_port);
+  tracepoint(ubitrack, eventqueue_dispatch_end, event_domain, event_priority, component_name, component_port);\
+  UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)
 #endif
 
 
@@ -126,17 +200,20 @@
 #define TRACEPOINT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)\
   if (UBITRACK_MEASUREMENT_CREATE_ENABLED()) {\
     UBITRACK_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port);\
-  }
+  }\
+  UBITRACK_FLIGHT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)
 #endif
 
 #ifdef HAVE_ETW
 #define TRACEPOINT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)\
-  ETWUbitrackMeasurementCreate(event_domain, event_priority, component_name, component_port);
+  ETWUbitrackMeasurementCreate(event_domain, event_priority, component_name, component_port);\
+  UBITRACK_FLIGHT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)
 #endif
 
 #ifdef HAVE_LTTNGUST
 #define TRACEPOINT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)\
-  tracepoint(ubitrack, measurement_create, event_domain, event_priority, component_name, component_port);
+  tracepoint(ubitrack, measurement_create, event_domain, event_priority, component_name, component_port);\
+  UBITRACK_FLIGHT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)
 #endif
 
 
@@ -156,17 +233,20 @@
 #define TRACEPOINT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)\
   if (UBITRACK_MEASUREMENT_RECEIVE_ENABLED()) {\
     UBITRACK_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port);\
-  }
+  }\
+  UBITRACK_FLIGHT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)
 #endif
 
 #ifdef HAVE_ETW
 #define TRACEPOINT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)\
-  ETWUbitrackMeasurementReceive(event_domain, event_priority, component_name, component_port);
+  ETWUbitrackMeasurementReceive(event_domain, event_priority, component_name, component_port);\
+  UBITRACK_FLIGHT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)
 #endif
 
 #ifdef HAVE_LTTNGUST
 #define TRACEPOINT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)\
-  tracepoint(ubitrack, measurement_receive, event_domain, event_priority, component_name, component_port);
+  tracepoint(ubitrack, measurement_receive, event_domain, event_priority, component_name, component_port);\
+  UBITRACK_FLIGHT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)
 #endif
 
 
@@ -183,17 +263,20 @@
 #define TRACEPOINT_VISION_ALLOCATE_CPU(bytes)\
   if (UBITRACK_VISION_ALLOCATE_CPU_ENABLED()) {\
     UBITRACK_VISION_ALLOCATE_CPU(bytes);\
-  }
+  }\
+  UBITRACK_FLIGHT_VISION_ALLOCATE_CPU(bytes)
 #endif
 
 #ifdef HAVE_ETW
 #define TRACEPOINT_VISION_ALLOCATE_CPU(bytes)\
-  ETWUbitrackAllocateCpu(bytes);
+  ETWUbitrackAllocateCpu(bytes);\
+  UBITRACK_FLIGHT_VISION_ALLOCATE_CPU(bytes)
 #endif
 
 #ifdef HAVE_LTTNGUST
 #define TRACEPOINT_VISION_ALLOCATE_CPU(bytes)\
-  tracepoint(ubitrack, vision_allocate_cpu, bytes);
+  tracepoint(ubitrack, vision_allocate_cpu, bytes);\
+  UBITRACK_FLIGHT_VISION_ALLOCATE_CPU(bytes)
 #endif
 
 
@@ -210,17 +293,20 @@
 #define TRACEPOINT_VISION_ALLOCATE_GPU(bytes)\
   if (UBITRACK_VISION_ALLOCATE_GPU_ENABLED()) {\
     UBITRACK_VISION_ALLOCATE_GPU(bytes);\
-  }
+  }\
+  UBITRACK_FLIGHT_VISION_ALLOCATE_GPU(bytes)
 #endif
 
 #ifdef HAVE_ETW
 #define TRACEPOINT_VISION_ALLOCATE_GPU(bytes)\
-  ETWUbitrackAllocateGpu(bytes);
+  ETWUbitrackAllocateGpu(bytes);\
+  UBITRACK_FLIGHT_VISION_ALLOCATE_GPU(bytes)
 #endif
 
 #ifdef HAVE_LTTNGUST
 #define TRACEPOINT_VISION_ALLOCATE_GPU(bytes)\
-  tracepoint(ubitrack, vision_allocate_gpu, bytes);
+  tracepoint(ubitrack, vision_allocate_gpu, bytes);\
+  UBITRACK_FLIGHT_VISION_ALLOCATE_GPU(bytes)
 #endif
 
 
@@ -237,17 +323,20 @@
 #define TRACEPOINT_VISION_GPU_UPLOAD(bytes)\
   if (UBITRACK_VISION_GPU_UPLOAD_ENABLED()) {\
     UBITRACK_VISION_GPU_UPLOAD(bytes);\
-  }
+  }\
+  UBITRACK_FLIGHT_VISION_GPU_UPLOAD(bytes)
 #endif
 
 #ifdef HAVE_ETW
 #define TRACEPOINT_VISION_GPU_UPLOAD(bytes)\
-  ETWUbitrackGpuUpload(bytes);
+  ETWUbitrackGpuUpload(bytes);\
+  UBITRACK_FLIGHT_VISION_GPU_UPLOAD(bytes)
 #endif
 
 #ifdef HAVE_LTTNGUST
 #define TRACEPOINT_VISION_GPU_UPLOAD(bytes)\
-  tracepoint(ubitrack, vision_gpu_upload, bytes);
+  tracepoint(ubitrack, vision_gpu_upload, bytes);\
+  UBITRACK_FLIGHT_VISION_GPU_UPLOAD(bytes)
 #endif
 
 
@@ -264,31 +353,173 @@
 #define TRACEPOINT_VISION_GPU_DOWNLOAD(bytes)\
   if (UBITRACK_VISION_GPU_DOWNLOAD_ENABLED()) {\
     UBITRACK_VISION_GPU_DOWNLOAD(bytes);\
-  }
+  }\
+  UBITRACK_FLIGHT_VISION_GPU_DOWNLOAD(bytes)
 #endif
 
 #ifdef HAVE_ETW
 #define TRACEPOINT_VISION_GPU_DOWNLOAD(bytes)\
-  ETWUbitrackGpuDownload(bytes);
+  ETWUbitrackGpuDownload(bytes);\
+  UBITRACK_FLIGHT_VISION_GPU_DOWNLOAD(bytes)
 #endif
 
 #ifdef HAVE_LTTNGUST
 #define TRACEPOINT_VISION_GPU_DOWNLOAD(bytes)\
-  tracepoint(ubitrack, vision_gpu_download, bytes);
+  tracepoint(ubitrack, vision_gpu_download, bytes);\
+  UBITRACK_FLIGHT_VISION_GPU_DOWNLOAD(bytes)
+#endif
+
+/*
+ * The tracepoints of the math and tracking code pass floating point values. DTrace probes only
+ * take integer arguments, so they receive these values in millionths, rounded towards zero.
+ */
+
+ /*
+ * TRACEPOINT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)
+ * traces one iteration of the levenberg-marquardt optimizer
+ * parameters:
+ * - iteration: number of the iteration, starting with 1
+ * - residual: squared (weighted) residual after the iteration
+ * - lambda: damping factor used in the iteration
+ * - solver: the Math::Optimization::LmSolverType
+ *
+ * example:
+ * TRACEPOINT_OPTIMIZATION_LM_ITERATION(iteration, fErr, fLambda, solver)
+ */
+#if defined(HAVE_DTRACE) && !defined(DISABLE_DTRACE)
+#define TRACEPOINT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)\
+  if (UBITRACK_OPTIMIZATION_LM_ITERATION_ENABLED()) {\
+    UBITRACK_OPTIMIZATION_LM_ITERATION((unsigned int)(iteration), (long long int)((residual) * 1e6), (long long int)((lambda) * 1e6), (int)(solver));\
+  }\
+  UBITRACK_FLIGHT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)
+#endif
+
+#ifdef HAVE_ETW
+#define TRACEPOINT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)\
+  ETWUbitrackLmIteration((unsigned int)(iteration), (double)(residual), (double)(lambda), (int)(solver));\
+  UBITRACK_FLIGHT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)
+#endif
+
+#ifdef HAVE_LTTNGUST
+#define TRACEPOINT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)\
+  tracepoint(ubitrack, optimization_lm_iteration, (unsigned int)(iteration), (double)(residual), (double)(lambda), (int)(solver));\
+  UBITRACK_FLIGHT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)
+#endif
+
+
+ /*
+ * TRACEPOINT_OPTIMIZATION_RANSAC(iterations, inliers, values)
+ * traces the end of a RANSAC (or PROSAC) run
+ * parameters:
+ * - iterations: number of hypotheses that were evaluated
+ * - inliers: number of inliers of the result, 0 if no result was found
+ * - values: number of input values
+ *
+ * example:
+ * TRACEPOINT_OPTIMIZATION_RANSAC(iRun + 1, nBestInliers, nValues)
+ */
+#if defined(HAVE_DTRACE) && !defined(DISABLE_DTRACE)
+#define TRACEPOINT_OPTIMIZATION_RANSAC(iterations, inliers, values)\
+  if (UBITRACK_OPTIMIZATION_RANSAC_ENABLED()) {\
+    UBITRACK_OPTIMIZATION_RANSAC((unsigned int)(iterations), (unsigned int)(inliers), (unsigned int)(values));\
+  }\
+  UBITRACK_FLIGHT_OPTIMIZATION_RANSAC(iterations, inliers, values)
+#endif
+
+#ifdef HAVE_ETW
+#define TRACEPOINT_OPTIMIZATION_RANSAC(iterations, inliers, values)\
+  ETWUbitrackRansac((unsigned int)(iterations), (unsigned int)(inliers), (unsigned int)(values));\
+  UBITRACK_FLIGHT_OPTIMIZATION_RANSAC(iterations, inliers, values)
+#endif
+
+#ifdef HAVE_LTTNGUST
+#define TRACEPOINT_OPTIMIZATION_RANSAC(iterations, inliers, values)\
+  tracepoint(ubitrack, optimization_ransac, (unsigned int)(iterations), (unsigned int)(inliers), (unsigned int)(values));\
+  UBITRACK_FLIGHT_OPTIMIZATION_RANSAC(iterations, inliers, values)
+#endif
+
+
+ /*
+ * TRACEPOINT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)
+ * traces a measurement update of a kalman filter
+ * parameters:
+ * - timestamp: timestamp of the measurement
+ * - update_type: kind of measurement, e.g. "pose"
+ * - dimension: dimension of the measurement vector
+ *
+ * example:
+ * TRACEPOINT_TRACKING_KALMAN_UPDATE(m.time(), "pose", 7)
+ */
+#if defined(HAVE_DTRACE) && !defined(DISABLE_DTRACE)
+#define TRACEPOINT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)\
+  if (UBITRACK_TRACKING_KALMAN_UPDATE_ENABLED()) {\
+    UBITRACK_TRACKING_KALMAN_UPDATE(timestamp, update_type, (unsigned int)(dimension));\
+  }\
+  UBITRACK_FLIGHT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)
+#endif
+
+#ifdef HAVE_ETW
+#define TRACEPOINT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)\
+  ETWUbitrackKalmanUpdate(timestamp, update_type, (unsigned int)(dimension));\
+  UBITRACK_FLIGHT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)
+#endif
+
+#ifdef HAVE_LTTNGUST
+#define TRACEPOINT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)\
+  tracepoint(ubitrack, tracking_kalman_update, timestamp, update_type, (unsigned int)(dimension));\
+  UBITRACK_FLIGHT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)
+#endif
+
+
+ /*
+ * TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)
+ * traces one iteration of a clustering algorithm
+ * parameters:
+ * - algorithm: name of the algorithm, "k_means" or "expectation_maximization"
+ * - iteration: number of the iteration, starting with 0
+ * - clusters: number of clusters
+ * - value: convergence measure, the mean change of the means for k_means, the log-likelihood for expectation_maximization
+ *
+ * example:
+ * TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION("k_means", i, n_cluster, diff_error)
+ */
+#if defined(HAVE_DTRACE) && !defined(DISABLE_DTRACE)
+#define TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)\
+  if (UBITRACK_STOCHASTIC_CLUSTERING_ITERATION_ENABLED()) {\
+    UBITRACK_STOCHASTIC_CLUSTERING_ITERATION(algorithm, (unsigned int)(iteration), (unsigned int)(clusters), (long long int)((value) * 1e6));\
+  }\
+  UBITRACK_FLIGHT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)
+#endif
+
+#ifdef HAVE_ETW
+#define TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)\
+  ETWUbitrackClusteringIteration(algorithm, (unsigned int)(iteration), (unsigned int)(clusters), (double)(value));\
+  UBITRACK_FLIGHT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)
+#endif
+
+#ifdef HAVE_LTTNGUST
+#define TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)\
+  tracepoint(ubitrack, stochastic_clustering_iteration, algorithm, (unsigned int)(iteration), (unsigned int)(clusters), (double)(value));\
+  UBITRACK_FLIGHT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)
 #endif
 
 
 #else // ENABLE_EVENT_TRACING
 
-#define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)
-#define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)
-#define TRACEPOINT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)
-#define TRACEPOINT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)
+#define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port) UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_BEGIN(event_domain, event_priority, component_name, component_port)
+#define TRACEPOINT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port) UBITRACK_FLIGHT_BLOCK_EVENTQUEUE_DISPATCH_END(event_domain, event_priority, component_name, component_port)
+#define TRACEPOINT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port) UBITRACK_FLIGHT_MEASUREMENT_CREATE(event_domain, event_priority, component_name, component_port)
+#define TRACEPOINT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port) UBITRACK_FLIGHT_MEASUREMENT_RECEIVE(event_domain, event_priority, component_name, component_port)
+
+#define TRACEPOINT_VISION_ALLOCATE_CPU(bytes) UBITRACK_FLIGHT_VISION_ALLOCATE_CPU(bytes)
+#define TRACEPOINT_VISION_ALLOCATE_GPU(bytes) UBITRACK_FLIGHT_VISION_ALLOCATE_GPU(bytes)
+#define TRACEPOINT_VISION_GPU_UPLOAD(bytes) UBITRACK_FLIGHT_VISION_GPU_UPLOAD(bytes)
+#define TRACEPOINT_VISION_GPU_DOWNLOAD(bytes) UBITRACK_FLIGHT_VISION_GPU_DOWNLOAD(bytes)
 
-#define TRACEPOINT_VISION_ALLOCATE_CPU(bytes)
-#define TRACEPOINT_VISION_ALLOCATE_GPU(bytes)
-#define TRACEPOINT_VISION_GPU_UPLOAD(bytes)
-#define TRACEPOINT_VISION_GPU_DOWNLOAD(bytes)
+#define TRACEPOINT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver) UBITRACK_FLIGHT_OPTIMIZATION_LM_ITERATION(iteration, residual, lambda, solver)
+#define TRACEPOINT_OPTIMIZATION_RANSAC(iterations, inliers, values) UBITRACK_FLIGHT_OPTIMIZATION_RANSAC(iterations, inliers, values)
+#define TRACEPOINT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension) UBITRACK_FLIGHT_TRACKING_KALMAN_UPDATE(timestamp, update_type, dimension)
+#define TRACEPOINT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value) UBITRACK_FLIGHT_STOCHASTIC_CLUSTERING_ITERATION(algorithm, iteration, clusters, value)
 
 #endif // ENABLE_EVENT_TRACING
 
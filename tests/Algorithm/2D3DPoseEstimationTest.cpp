@@ -6,10 +6,17 @@
 #include <utMath/Geometry/PointProjection.h>
 #include <utAlgorithm/PoseEstimation2D3D/PlanarPoseEstimation.h>
 #include <utAlgorithm/PoseEstimation2D3D/NonPlanarPoseEstimation.h>
+#include <utAlgorithm/PoseEstimation2D3D/ClosedFormPoseEstimation.h>
+#include <utAlgorithm/PoseEstimation2D3D/Ransac.h>
+#include <utAlgorithm/PoseEstimation2D3D/PoseTracker2D3D.h>
+#include <utAlgorithm/Function/MultiplePointProjectionError.h>
+#include <utAlgorithm/Function/MultipleCameraProjectionError.h>
+#include <utMath/Stochastic/BackwardPropagation.h>
 
 #include <utMath/Random/Scalar.h>
 #include <utMath/Random/Vector.h>
 #include <utMath/Random/Rotation.h>
+#include <utUtil/Exception.h>
 #include "../tools.h"
 
 #include <math.h>
@@ -88,6 +95,75 @@ void TestOptimizePose( const std::size_t n_runs, const T epsilon )
 	}
 }
 
+template< typename T >
+void TestOptimizePoses( const std::size_t n_problems )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randVector( -0.5, 0.5 );
+	typename Random::Vector< T, 3 >::Normal randPositionNoise( 0, 0.2 );
+
+	Matrix< T, 3, 3 > cam( Matrix< T, 3, 3 >::identity() );
+	cam( 0, 0 ) = 500;
+	cam( 1, 1 ) = 500;
+
+	// independent rigid bodies seen by one camera
+	std::vector< Pose > poses;
+	std::vector< std::vector< Vector< T, 2 > > > p2D( n_problems );
+	std::vector< std::vector< Vector< T, 3 > > > p3D( n_problems );
+	for ( std::size_t i = 0; i < n_problems; i++ )
+	{
+		const Quaternion rot( randQuat() );
+		Vector< T, 3 > trans( Random::distribute_uniform< T >( -5, 5 ), Random::distribute_uniform< T >( -5, 5 ), 
+			Random::distribute_uniform< T >( 10, 50 ) );
+		const Matrix< T, 3, 4 > proj( ublas::prod( cam, Matrix< T, 3, 4 >( rot, trans ) ) );
+
+		std::generate_n( std::back_inserter( p3D[ i ] ), Random::distribute_uniform< std::size_t >( 6, 20 ), randVector );
+		Geometry::project_points( proj, p3D[ i ].begin(), p3D[ i ].end(), std::back_inserter( p2D[ i ] ) );
+
+		poses.push_back( Pose( Quaternion( rot.x() + Random::distribute_uniform< T >( -0.05, 0.05 )
+			, rot.y(), rot.z(), rot.w() ).normalize(), trans + randPositionNoise() ) );
+	}
+
+	// a problem without points is skipped
+	poses.push_back( Pose() );
+	p2D.push_back( std::vector< Vector< T, 2 > >() );
+	p3D.push_back( std::vector< Vector< T, 3 > >() );
+
+	std::vector< Pose > sequential( poses );
+	std::vector< Pose > threaded( poses );
+	std::vector< Ubitrack::Algorithm::PoseEstimation2D3D::PoseOptimizationResult > results;
+	std::vector< Ubitrack::Algorithm::PoseEstimation2D3D::PoseOptimizationResult > threadedResults;
+	Ubitrack::Algorithm::PoseEstimation2D3D::optimizePoses( sequential, p2D, p3D, cam, results );
+	Ubitrack::Algorithm::PoseEstimation2D3D::optimizePoses( threaded, p2D, p3D, cam, threadedResults, 6, threadExecutor( 4, 1 ) );
+	BOOST_REQUIRE_EQUAL( results.size(), poses.size() );
+	BOOST_REQUIRE_EQUAL( threadedResults.size(), poses.size() );
+
+	for ( std::size_t i = 0; i < n_problems; i++ )
+	{
+		// same result as the single problem version, independent of the executor
+		Pose single( poses[ i ] );
+		const T fRes = Ubitrack::Algorithm::PoseEstimation2D3D::optimizePose( single, p2D[ i ], p3D[ i ], cam );
+		BOOST_CHECK_EQUAL( T( results[ i ].residual ), fRes );
+		BOOST_CHECK( single == sequential[ i ] );
+		BOOST_CHECK( threaded[ i ] == sequential[ i ] );
+		BOOST_CHECK_EQUAL( threadedResults[ i ].residual, results[ i ].residual );
+		BOOST_CHECK_EQUAL( threadedResults[ i ].iterations, results[ i ].iterations );
+
+		// stopped by convergence or the iteration limit
+		BOOST_CHECK( results[ i ].iterations > 0 );
+		BOOST_CHECK( results[ i ].converged || results[ i ].iterations >= 6 );
+	}
+
+	BOOST_CHECK( sequential.back() == Pose() );
+	BOOST_CHECK_EQUAL( results.back().iterations, 0u );
+	BOOST_CHECK( !results.back().converged );
+
+	// point lists must match the poses
+	p2D.pop_back();
+	BOOST_CHECK_THROW( Ubitrack::Algorithm::PoseEstimation2D3D::optimizePoses( sequential, p2D, p3D, cam, results ), 
+		Ubitrack::Util::Exception );
+}
+
 template< typename T >
 void Test2D3DPoseEstimationGeneral( const std::size_t n_runs, const T epsilon )
 {
@@ -144,10 +220,325 @@ void Test2D3DPoseEstimationGeneral( const std::size_t n_runs, const T epsilon )
 	//BOOST_MESSAGE( "Average number of iterations after " << n_runs << " runs: " << iter_count / n_runs );
 }
 
+/**
+ * condition of the P3P problem of the first three points, the normalized determinant of the
+ * jacobian of the law of cosines at the true distances. It vanishes when the camera center
+ * lies on the "danger cylinder" through the points, where no P3P solver is accurate.
+ */
+template< typename T >
+double p3pCondition( const Quaternion& rot, const Vector< T, 3 >& trans, const std::vector< Vector< T, 3 > >& p3D )
+{
+	Vector< double, 3 > p[ 3 ];
+	double s[ 3 ];
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		p[ i ] = rot * Vector< double, 3 >( p3D[ i ]( 0 ), p3D[ i ]( 1 ), p3D[ i ]( 2 ) ) + Vector< double, 3 >( trans( 0 ), trans( 1 ), trans( 2 ) );
+		s[ i ] = ublas::norm_2( p[ i ] );
+	}
+	const double cosA = ublas::inner_prod( p[ 1 ], p[ 2 ] ) / ( s[ 1 ] * s[ 2 ] );
+	const double cosB = ublas::inner_prod( p[ 0 ], p[ 2 ] ) / ( s[ 0 ] * s[ 2 ] );
+	const double cosC = ublas::inner_prod( p[ 0 ], p[ 1 ] ) / ( s[ 0 ] * s[ 1 ] );
+	const Vector< double, 3 > j0( 0, s[ 0 ] - s[ 2 ] * cosB, s[ 0 ] - s[ 1 ] * cosC );
+	const Vector< double, 3 > j1( s[ 1 ] - s[ 2 ] * cosA, 0, s[ 1 ] - s[ 0 ] * cosC );
+	const Vector< double, 3 > j2( s[ 2 ] - s[ 1 ] * cosA, s[ 2 ] - s[ 0 ] * cosB, 0 );
+	const double det = j0( 0 ) * ( j1( 1 ) * j2( 2 ) - j1( 2 ) * j2( 1 ) ) - j1( 0 ) * ( j0( 1 ) * j2( 2 ) - j0( 2 ) * j2( 1 ) )
+		+ j2( 0 ) * ( j0( 1 ) * j1( 2 ) - j0( 2 ) * j1( 1 ) );
+	return std::fabs( det ) / ( ublas::norm_2( j0 ) * ublas::norm_2( j1 ) * ublas::norm_2( j2 ) );
+}
+
+template< typename T >
+void TestClosedFormPoseEstimation( const std::size_t n_runs, const T epsilon )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randVector( -0.5, 0.5 ); // 3d Points
+	typename Random::Vector< T, 3 >::Uniform randTranslation( -2, 2 ); //translation
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		// random pose
+		Quaternion rot( randQuat( ) );
+		Vector< T, 3 > trans ( randTranslation() );
+		trans( 2 ) = Random::distribute_uniform< T >( 2, 5 );
+		const Matrix< T, 3, 4 > proj( rot, trans );
+
+		// every other run uses a planar target
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 4, 50 ) );
+		std::vector< Vector< T, 3 > > p3D;
+		p3D.reserve( n );
+		std::generate_n ( std::back_inserter( p3D ), n,  randVector );
+		if ( iRun % 2 )
+			for ( std::size_t i = 0; i < n; i++ )
+				p3D[ i ]( 2 ) = 0;
+
+		std::vector< Vector< T, 2 > > p2D;
+		p2D.reserve( n );
+		Geometry::project_points( proj, p3D.begin(), p3D.end(), std::back_inserter( p2D ) );
+
+		// skip the rare degenerate configurations
+		if ( p3pCondition( rot, trans, p3D ) < 1e-5 )
+			continue;
+
+		// one of the P3P solutions is the pose
+		std::vector< Pose > poses;
+		const std::size_t nSolutions = Ubitrack::Algorithm::PoseEstimation2D3D::estimatePosesP3P( p2D, poses, p3D );
+		BOOST_CHECK( nSolutions >= 1 && nSolutions <= 4 );
+		BOOST_CHECK_EQUAL( poses.size(), nSolutions );
+		T minDiff = 1;
+		for ( std::size_t i = 0; i < poses.size(); i++ )
+			minDiff = std::min( minDiff, T( quaternionDiff( poses[ i ].rotation(), rot ) + ublas::norm_2( poses[ i ].translation() - trans ) ) );
+		BOOST_CHECK_SMALL( minDiff, epsilon );
+
+		// the fourth point selects it
+		Pose p3pPose;
+		BOOST_CHECK( Ubitrack::Algorithm::PoseEstimation2D3D::estimatePoseP3P( p2D, p3pPose, p3D ) );
+		BOOST_CHECK_SMALL( T( quaternionDiff( p3pPose.rotation(), rot ) ), epsilon );
+		BOOST_CHECK_SMALL( T( ublas::norm_2( p3pPose.translation() - trans ) ), epsilon );
+
+		Pose epnpPose;
+		BOOST_CHECK( Ubitrack::Algorithm::PoseEstimation2D3D::estimatePoseEPnP( p2D, epnpPose, p3D ) );
+		const T rotDiff = quaternionDiff( epnpPose.rotation(), rot );
+		const T posDiff = ublas::norm_2( epnpPose.translation() - trans );
+		BOOST_CHECK_MESSAGE( rotDiff < epsilon, "\nEPnP using " << n << " points (rotation type:" << typeid( T ).name() << "):\n" << rot << " (expected )\n" << epnpPose.rotation()<< " (estimated)\n" );
+		BOOST_CHECK_MESSAGE( posDiff < epsilon, "\nEPnP using " << n << " points (translation type:" << typeid( T ).name() << "):\n" << trans << " (expected )\n" << epnpPose.translation()<< " (estimated)\n" );
+	}
+}
+
+template< typename T >
+void TestRansacPoseEstimation( const std::size_t n_runs, const T epsilon )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randVector( -0.5, 0.5 ); // 3d Points
+	typename Random::Vector< T, 3 >::Uniform randTranslation( -2, 2 ); //translation
+	typename Random::Vector< T, 2 >::Uniform randOutlier( -0.5, 0.5 );
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		Quaternion rot( randQuat( ) );
+		Vector< T, 3 > trans ( randTranslation() );
+		trans( 2 ) = Random::distribute_uniform< T >( 2, 5 );
+		const Matrix< T, 3, 4 > proj( rot, trans );
+
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 20, 50 ) );
+		std::vector< Vector< T, 3 > > p3D;
+		p3D.reserve( n );
+		std::generate_n ( std::back_inserter( p3D ), n,  randVector );
+		std::vector< Vector< T, 2 > > p2D;
+		p2D.reserve( n );
+		Geometry::project_points( proj, p3D.begin(), p3D.end(), std::back_inserter( p2D ) );
+
+		// replace a quarter of the observations by outlier
+		for ( std::size_t i = 0; i < n / 4; i++ )
+			p2D[ i ] = randOutlier();
+
+		const Optimization::RansacParameter< T > params( 1e-3, 4, n, 0.25 );
+		Pose pose;
+		BOOST_CHECK( Ubitrack::Algorithm::PoseEstimation2D3D::estimatePose6D_2D3D( p2D, pose, p3D, params ) );
+		BOOST_CHECK_SMALL( T( quaternionDiff( pose.rotation(), rot ) ), epsilon );
+		BOOST_CHECK_SMALL( T( ublas::norm_2( pose.translation() - trans ) ), epsilon );
+	}
+}
+
+void TestComputePoseInitialization( const std::size_t n_runs )
+{
+	typedef Ubitrack::Algorithm::PoseEstimation2D3D::InitializationMethod InitializationMethod;
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -0.5, 0.5 );
+
+	Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+	cam( 0, 0 ) = 500;
+	cam( 1, 1 ) = 500;
+	cam( 0, 2 ) = 320;
+	cam( 1, 2 ) = 240;
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		const Quaternion rot( randQuat() );
+		const Vector< double, 3 > trans( Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( -1, 1 ), 
+			Random::distribute_uniform< double >( 3, 6 ) );
+		const Matrix< double, 3, 4 > proj( ublas::prod( cam, Matrix< double, 3, 4 >( rot, trans ) ) );
+
+		std::vector< Vector< double, 3 > > p3D;
+		std::generate_n( std::back_inserter( p3D ), Random::distribute_uniform< std::size_t >( 6, 20 ), randVector );
+		std::vector< Vector< double, 2 > > p2D;
+		Geometry::project_points( proj, p3D.begin(), p3D.end(), std::back_inserter( p2D ) );
+
+		const InitializationMethod methods[ 2 ] = { Ubitrack::Algorithm::PoseEstimation2D3D::EPNP, Ubitrack::Algorithm::PoseEstimation2D3D::P3P };
+		for ( std::size_t m = 0; m < 2; m++ )
+		{
+			// without refinement the pose is the closed-form solution
+			double residual;
+			const ErrorPose pose = Ubitrack::Algorithm::PoseEstimation2D3D::computePose( p2D, p3D, cam, residual, false, methods[ m ] );
+			BOOST_CHECK_SMALL( residual, 1e-6 );
+			BOOST_CHECK_SMALL( quaternionDiff( pose.rotation(), rot ), 1e-6 );
+			BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - trans ), 1e-6 );
+		}
+
+		// the same in the ubitrack convention, with the camera looking along -z
+		Matrix< double, 3, 3 > camNegativeZ( cam );
+		camNegativeZ( 0, 2 ) = -320;
+		camNegativeZ( 1, 2 ) = -240;
+		camNegativeZ( 2, 2 ) = -1;
+		const Vector< double, 3 > transNegativeZ( trans( 0 ), trans( 1 ), -trans( 2 ) );
+		const Matrix< double, 3, 4 > projNegativeZ( ublas::prod( camNegativeZ, Matrix< double, 3, 4 >( rot, transNegativeZ ) ) );
+		std::vector< Vector< double, 2 > > p2DNegativeZ;
+		Geometry::project_points( projNegativeZ, p3D.begin(), p3D.end(), std::back_inserter( p2DNegativeZ ) );
+		for ( std::size_t m = 0; m < 2; m++ )
+		{
+			double residual;
+			const ErrorPose pose = Ubitrack::Algorithm::PoseEstimation2D3D::computePose( p2DNegativeZ, p3D, camNegativeZ, residual, false, methods[ m ] );
+			BOOST_CHECK_SMALL( residual, 1e-6 );
+			BOOST_CHECK_SMALL( quaternionDiff( pose.rotation(), rot ), 1e-6 );
+			BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - transNegativeZ ), 1e-6 );
+		}
+	}
+}
+
+void TestPoseTracker( const std::size_t n_runs )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -0.5, 0.5 );
+	Random::Vector< double, 3 >::Normal randAxis( 0, 1 );
+	Random::Vector< double, 2 >::Normal randNoise( 0, 0.5 );
+
+	Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+	cam( 0, 0 ) = 500;
+	cam( 1, 1 ) = 500;
+	cam( 0, 2 ) = 320;
+	cam( 1, 2 ) = 240;
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		std::vector< Vector< double, 3 > > p3D;
+		std::generate_n( std::back_inserter( p3D ), Random::distribute_uniform< std::size_t >( 6, 20 ), randVector );
+
+		Ubitrack::Algorithm::PoseEstimation2D3D::PoseTracker2D3D tracker( cam, 2.0, 6, Ubitrack::Algorithm::PoseEstimation2D3D::EPNP );
+		BOOST_CHECK( !tracker.isTracking() );
+
+		// a slow motion is tracked after the first frame
+		Pose pose( randQuat(), Vector< double, 3 >( 0, 0, 4 ) );
+		for ( std::size_t iFrame = 0; iFrame < 20; iFrame++ )
+		{
+			pose = Pose( Quaternion( randAxis(), 0.02 ), Vector< double, 3 >( randVector() * 0.02 ) ) * pose;
+			const Matrix< double, 3, 4 > proj( ublas::prod( cam, Matrix< double, 3, 4 >( pose.rotation(), pose.translation() ) ) );
+			std::vector< Vector< double, 2 > > p2D;
+			Geometry::project_points( proj, p3D.begin(), p3D.end(), std::back_inserter( p2D ) );
+			for ( std::size_t i = 0; i < p2D.size(); i++ )
+				p2D[ i ] += randNoise();
+
+			BOOST_CHECK( tracker.track( p2D, p3D ) );
+			BOOST_CHECK_EQUAL( tracker.wasInitialized(), iFrame == 0 );
+			BOOST_CHECK( tracker.residual() < 2.0 );
+			BOOST_CHECK_SMALL( quaternionDiff( tracker.pose().rotation(), pose.rotation() ), 0.05 );
+			BOOST_CHECK_SMALL( ublas::norm_2( tracker.pose().translation() - pose.translation() ), 0.1 );
+
+			// same result as the initialization of every frame
+			double residual;
+			const ErrorPose computed = Ubitrack::Algorithm::PoseEstimation2D3D::computePose( p2D, p3D, cam, residual, true, 
+				Ubitrack::Algorithm::PoseEstimation2D3D::EPNP );
+			BOOST_CHECK_SMALL( quaternionDiff( tracker.pose().rotation(), computed.rotation() ), 1e-4 );
+			BOOST_CHECK_SMALL( ublas::norm_2( tracker.pose().translation() - computed.translation() ), 1e-4 );
+			BOOST_CHECK_CLOSE( tracker.residual(), residual, 1.0 );
+			const ErrorPose errorPose( tracker.errorPose() );
+			for ( std::size_t i = 0; i < 6; i++ )
+				BOOST_CHECK_CLOSE( errorPose.covariance()( i, i ), computed.covariance()( i, i ), 1.0 );
+		}
+
+		// a jump either converges within the error bound or is initialized again
+		pose = Pose( randQuat(), Vector< double, 3 >( 0, 0, 4 ) );
+		const Matrix< double, 3, 4 > proj( ublas::prod( cam, Matrix< double, 3, 4 >( pose.rotation(), pose.translation() ) ) );
+		std::vector< Vector< double, 2 > > p2D;
+		Geometry::project_points( proj, p3D.begin(), p3D.end(), std::back_inserter( p2D ) );
+		BOOST_CHECK( tracker.track( p2D, p3D ) );
+		BOOST_CHECK( tracker.residual() < 2.0 );
+		BOOST_CHECK_SMALL( quaternionDiff( tracker.pose().rotation(), pose.rotation() ), 0.05 );
+
+		// after a reset the same frame is initialized
+		tracker.reset();
+		BOOST_CHECK( !tracker.isTracking() );
+		BOOST_CHECK( tracker.track( p2D, p3D ) );
+		BOOST_CHECK( tracker.wasInitialized() );
+		BOOST_CHECK_SMALL( quaternionDiff( tracker.pose().rotation(), pose.rotation() ), 1e-6 );
+	}
+}
+
+template< typename T >
+void TestPoseCovariance( const std::size_t n_runs, const T epsilon )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randVector( -0.5, 0.5 );
+
+	Matrix< T, 3, 3 > cam( Matrix< T, 3, 3 >::identity() );
+	cam( 0, 0 ) = 500;
+	cam( 1, 1 ) = 520;
+	cam( 0, 2 ) = -320;
+	cam( 1, 2 ) = -240;
+	cam( 2, 2 ) = -1;
+	const T imageError( 0.25 );
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		const Pose pose( randQuat(), Vector< double, 3 >( Random::distribute_uniform< double >( -1, 1 ), 
+			Random::distribute_uniform< double >( -1, 1 ), -Random::distribute_uniform< double >( 5, 20 ) ) );
+		std::vector< Vector< T, 3 > > p3D;
+		std::generate_n( std::back_inserter( p3D ), Random::distribute_uniform< std::size_t >( 4, 30 ), randVector );
+
+		// reference: backward propagation of the full jacobian
+		Vector< T, 7 > params;
+		pose.toVector( params );
+		Matrix< T, 6, 6 > reference;
+		Ubitrack::Algorithm::Function::MultiplePointProjectionError< T > projection( p3D, cam );
+		Stochastic::backwardPropagationIdentity( reference, imageError, projection, params );
+
+		const Matrix< T, 6, 6 > single( Ubitrack::Algorithm::PoseEstimation2D3D::singleCameraPoseError( pose, p3D, cam, imageError ) );
+		BOOST_CHECK_SMALL( T( ublas::norm_inf( single - reference ) / ublas::norm_inf( reference ) ), epsilon );
+
+		// two cameras, each seeing a part of the points
+		std::vector< Matrix< T, 3, 4 > > cameras;
+		cameras.push_back( Matrix< T, 3, 4 >( ublas::prod( cam, Matrix< T, 3, 4 >( Quaternion(), Vector< T, 3 >::zeros() ) ) ) );
+		cameras.push_back( Matrix< T, 3, 4 >( ublas::prod( cam, Matrix< T, 3, 4 >( Quaternion( 0, 0.3, 0 ), Vector< T, 3 >( 1, 0, 0 ) ) ) ) );
+		std::vector< std::pair< std::size_t, std::size_t > > observations;
+		for ( std::size_t i = 0; i < p3D.size(); i++ )
+		{
+			if ( i % 3 != 2 )
+				observations.push_back( std::make_pair( i, std::size_t( 0 ) ) );
+			if ( i % 3 != 0 )
+				observations.push_back( std::make_pair( i, std::size_t( 1 ) ) );
+		}
+		Ubitrack::Algorithm::Function::MultipleCameraProjectionError< T > multiProjection( p3D, cameras, observations );
+		Stochastic::backwardPropagationIdentity( reference, imageError, multiProjection, params );
+		const Matrix< T, 6, 6 > multiple( Ubitrack::Algorithm::PoseEstimation2D3D::multipleCameraPoseError( 
+			pose, p3D, cameras, observations, imageError ) );
+		BOOST_CHECK_SMALL( T( ublas::norm_inf( multiple - reference ) / ublas::norm_inf( reference ) ), epsilon );
+	}
+
+	// collinear points do not determine the rotation around their line, the pseudo-inverse is used
+	const Pose pose( randQuat(), Vector< double, 3 >( 0, 0, -10 ) );
+	const Vector< T, 3 > direction( randVector() );
+	std::vector< Vector< T, 3 > > p3D;
+	for ( std::size_t i = 0; i < 3; i++ )
+		p3D.push_back( direction * T( i ) );
+	Vector< T, 7 > params;
+	pose.toVector( params );
+	Matrix< T, 6, 6 > reference;
+	Ubitrack::Algorithm::Function::MultiplePointProjectionError< T > projection( p3D, cam );
+	Stochastic::backwardPropagationIdentity( reference, imageError, projection, params );
+	const Matrix< T, 6, 6 > single( Ubitrack::Algorithm::PoseEstimation2D3D::singleCameraPoseError( pose, p3D, cam, imageError ) );
+	BOOST_CHECK_SMALL( T( ublas::norm_inf( single - reference ) ), T( 1e-6 ) * T( ublas::norm_inf( reference ) ) );
+}
+
 void Test2D3DPoseEstimation()
 {
+	TestPoseTracker( 20 );
+	TestClosedFormPoseEstimation< float >( 1000, 1e-2f );
+	TestClosedFormPoseEstimation< double >( 1000, 1e-6 );
+	TestRansacPoseEstimation< double >( 100, 1e-6 );
+	TestComputePoseInitialization( 100 );
 	TestOptimizePose< float >( 1000, 1e-1f );
 	TestOptimizePose< double >( 1000, 1e-3 );
+	TestOptimizePoses< float >( 100 );
+	TestOptimizePoses< double >( 100 );
+	TestPoseCovariance< float >( 100, 1e-2f );
+	TestPoseCovariance< double >( 100, 1e-6 );
 	Test2D3DPoseEstimationGeneral< float >( 1000, 1e-01 );
 	Test2D3DPoseEstimationGeneral< double >( 1000, 1e-01 );
 }
@@ -1,4 +1,5 @@
 #include <utAlgorithm/3DPointReconstruction.h>
+#include <utAlgorithm/EpipolarMatching.h>
 #include <utMath/Geometry/PointProjection.h>
 #include <utMath/Stochastic/identity_iterator.h>
 
@@ -109,10 +110,231 @@ void TestMulitpleCameras( const std::size_t n_runs , const T epsilon )
 	}
 }
 
+template< typename T >
+void TestMultiViewTriangulation( const std::size_t n_runs, const T epsilon )
+{
+	typename Math::Random::Quaternion< T >::Uniform randQuat;
+	typename Math::Random::Vector< T, 3 >::Uniform randTranslation( -10., 10. );
+	typename Math::Random::Vector< T, 3 >::Uniform randVector( -1., 1. );
+
+	Math::Matrix< T, 3, 3 > K = Math::Matrix< T, 3, 3 >::identity();
+	K( 0, 0 ) = K( 1, 1 ) = 500;
+	K( 0, 2 ) = 320;
+	K( 1, 2 ) = 240;
+
+	const Math::ListExecutor executor( Math::threadExecutor( 2, 16 ) );
+
+	for( std::size_t j=0; j<n_runs; ++j )
+	{
+		const std::size_t n_cams( Math::Random::distribute_uniform< std::size_t >( 2, 12 ) );
+		std::vector< Math::Matrix< T, 3, 4 > > matrices;
+		for( std::size_t i( 0 ); i < n_cams; ++i )
+		{
+			Math::Matrix< T, 3, 4 > p( Math::Pose( randQuat(), randTranslation() ) );
+			matrices.push_back( boost::numeric::ublas::prod( K, p ) );
+		}
+		Algorithm::MultiViewTriangulation< T > triangulation( matrices );
+
+		// every point is seen by a random subset of at least two cameras
+		const std::size_t n( Math::Random::distribute_uniform< std::size_t >( 10, 100 ) );
+		std::vector< Math::Vector< T, 3 > > objPoints;
+		std::vector< typename Algorithm::MultiViewTriangulation< T >::Observation > observations;
+		std::vector< std::size_t > offsets;
+		for( std::size_t i( 0 ); i < n; ++i )
+		{
+			objPoints.push_back( randVector() );
+			offsets.push_back( observations.size() );
+			const std::size_t first( Math::Random::distribute_uniform< std::size_t >( 0, n_cams - 2 ) );
+			const std::size_t last( Math::Random::distribute_uniform< std::size_t >( first + 1, n_cams - 1 ) );
+			for( std::size_t c( first ); c <= last; ++c )
+				observations.push_back( typename Algorithm::MultiViewTriangulation< T >::Observation( c,
+					Math::Geometry::ProjectPoint()( matrices[ c ], objPoints.back() ) ) );
+		}
+		offsets.push_back( observations.size() );
+
+		std::vector< Math::Vector< T, 3 > > p3D;
+		std::vector< Math::Matrix< T, 3, 3 > > covariances;
+		triangulation.triangulate( observations, offsets, p3D, &covariances, T( 1 ), executor );
+		BOOST_REQUIRE_EQUAL( p3D.size(), n );
+		BOOST_REQUIRE_EQUAL( covariances.size(), n );
+		// random cameras may see a point along their baseline, its covariance is zero then
+		std::size_t nDetermined( 0 );
+		for( std::size_t i( 0 ); i < n; ++i )
+		{
+			BOOST_CHECK_SMALL( vectorDiff( p3D[ i ], objPoints[ i ] ), epsilon );
+			if( covariances[ i ]( 0, 0 ) > 0 && covariances[ i ]( 1, 1 ) > 0 && covariances[ i ]( 2, 2 ) > 0 )
+				nDetermined++;
+			for( std::size_t k( 0 ); k < 3; ++k )
+				for( std::size_t l( 0 ); l < 3; ++l )
+					BOOST_CHECK_EQUAL( covariances[ i ]( k, l ), covariances[ i ]( l, k ) );
+		}
+		BOOST_CHECK( nDetermined >= n - n / 10 );
+	}
+
+	// the covariance predicts the spread of the points reconstructed from noisy observations
+	{
+		std::vector< Math::Matrix< T, 3, 4 > > matrices;
+		const T angles[ 3 ] = { 0, T( 2.0 ), T( -2.0 ) };
+		for( std::size_t c( 0 ); c < 3; ++c )
+		{
+			const Math::Quaternion rot( Math::Vector< double, 3 >( 0, 1, 0 ), angles[ c ] );
+			const Math::Pose pose( rot, rot * Math::Vector< double, 3 >( 0, 0, -5 ) );
+			Math::Matrix< T, 3, 4 > p( ~pose );
+			matrices.push_back( boost::numeric::ublas::prod( K, p ) );
+		}
+		Algorithm::MultiViewTriangulation< T > triangulation( matrices );
+
+		typename Math::Random::Vector< T, 2 >::Normal randNoise( 0, 0.5 );
+		const Math::Vector< T, 3 > objPoint( 0.1, -0.2, 0.3 );
+		const std::size_t n( 2000 );
+		std::vector< std::vector< Math::Vector< T, 2 > > > imagePoints( 3 );
+		for( std::size_t c( 0 ); c < 3; ++c )
+			for( std::size_t i( 0 ); i < n; ++i )
+				imagePoints[ c ].push_back( Math::Geometry::ProjectPoint()( matrices[ c ], objPoint ) + randNoise() );
+
+		std::vector< Math::Vector< T, 3 > > p3D;
+		std::vector< Math::Matrix< T, 3, 3 > > covariances;
+		triangulation.triangulate( imagePoints, p3D, &covariances, T( 0.5 ) );
+
+		for( std::size_t k( 0 ); k < 3; ++k )
+		{
+			T variance( 0 );
+			for( std::size_t i( 0 ); i < n; ++i )
+				variance += ( p3D[ i ]( k ) - objPoint( k ) ) * ( p3D[ i ]( k ) - objPoint( k ) );
+			variance /= n;
+			BOOST_CHECK_CLOSE( variance, covariances[ 0 ]( k, k ), T( 15 ) );
+		}
+	}
+}
+
+/** candidates of the matcher must be exactly the pairs found by testing all of them */
+template< typename T >
+void checkEpipolarCandidates( const Math::Matrix< T, 3, 3 >& F, const std::vector< Math::Vector< T, 2 > >& points1,
+	const std::vector< Math::Vector< T, 2 > >& points2, const T maxDistance )
+{
+	std::vector< Algorithm::EpipolarCandidate< T > > candidates;
+	Algorithm::EpipolarMatcher< T >( F, points2, maxDistance ).match( points1, candidates );
+
+	std::vector< std::pair< std::size_t, std::size_t > > found;
+	for( std::size_t i( 0 ); i < candidates.size(); ++i )
+	{
+		found.push_back( std::make_pair( candidates[ i ].from, candidates[ i ].to ) );
+		BOOST_CHECK_SMALL( std::sqrt( candidates[ i ].distance )
+			- std::sqrt( Algorithm::pointToPointDist( points1[ candidates[ i ].from ], points2[ candidates[ i ].to ], F ) ), T( 1e-2 ) );
+	}
+	std::sort( found.begin(), found.end() );
+
+	std::vector< std::pair< std::size_t, std::size_t > > expected;
+	for( std::size_t i( 0 ); i < points1.size(); ++i )
+		for( std::size_t j( 0 ); j < points2.size(); ++j )
+			if( Algorithm::pointToPointDist( points1[ i ], points2[ j ], F ) <= maxDistance * maxDistance )
+				expected.push_back( std::make_pair( i, j ) );
+
+	BOOST_CHECK( found == expected );
+}
+
+template< typename T >
+void TestEpipolarMatching( const std::size_t n_runs )
+{
+	typename Math::Random::Quaternion< T >::Uniform randQuat;
+	typename Math::Random::Vector< T, 3 >::Uniform randTranslation( -10., 10. );
+	typename Math::Random::Vector< T, 3 >::Uniform randVector( -1., 1. );
+	typename Math::Random::Vector< T, 2 >::Uniform randImagePoint( 0., 640. );
+
+	Math::Matrix< double, 3, 3 > K = Math::Matrix< double, 3, 3 >::identity();
+	K( 0, 0 ) = K( 1, 1 ) = 500;
+	K( 0, 2 ) = 320;
+	K( 1, 2 ) = 240;
+	Math::Matrix< double, 3, 3 > Kinv = Math::Matrix< double, 3, 3 >::identity();
+	Kinv( 0, 0 ) = Kinv( 1, 1 ) = 1. / 500;
+	Kinv( 0, 2 ) = -320. / 500;
+	Kinv( 1, 2 ) = -240. / 500;
+
+	for( std::size_t j=0; j<n_runs; ++j )
+	{
+		// cameras looking at the origin
+		Math::Pose poses[ 2 ];
+		Math::Matrix< T, 3, 4 > P[ 2 ];
+		for( std::size_t c( 0 ); c < 2; ++c )
+		{
+			const Math::Quaternion rot( randQuat() );
+			poses[ c ] = ~Math::Pose( rot, rot * Math::Vector< double, 3 >( 0, 0, -8 ) );
+			Math::Matrix< double, 3, 4 > p( poses[ c ] );
+			P[ c ] = Math::Matrix< T, 3, 4 >( boost::numeric::ublas::prod( K, p ) );
+		}
+
+		// F = K^-T [t]_x R K^-1 from the relative pose
+		const Math::Pose rel( poses[ 1 ] * ~poses[ 0 ] );
+		const Math::Vector< double, 3 >& t( rel.translation() );
+		Math::Matrix< double, 3, 3 > tx( Math::Matrix< double, 3, 3 >::zeros() );
+		tx( 0, 1 ) = -t( 2 ); tx( 0, 2 ) = t( 1 );
+		tx( 1, 0 ) = t( 2 ); tx( 1, 2 ) = -t( 0 );
+		tx( 2, 0 ) = -t( 1 ); tx( 2, 1 ) = t( 0 );
+		Math::Matrix< double, 3, 3 > R;
+		rel.rotation().toMatrix( R );
+		const Math::Matrix< double, 3, 3 > E( boost::numeric::ublas::prod( tx, R ) );
+		const Math::Matrix< double, 3, 3 > KE( boost::numeric::ublas::prod( boost::numeric::ublas::trans( Kinv ), E ) );
+		const Math::Matrix< T, 3, 3 > F( Math::Matrix< double, 3, 3 >( boost::numeric::ublas::prod( KE, Kinv ) ) );
+
+		// projected points plus clutter in the second view
+		const std::size_t n( Math::Random::distribute_uniform< std::size_t >( 20, 200 ) );
+		std::vector< Math::Vector< T, 3 > > objPoints;
+		std::vector< Math::Vector< T, 2 > > points1;
+		std::vector< Math::Vector< T, 2 > > points2;
+		for( std::size_t i( 0 ); i < n; ++i )
+		{
+			objPoints.push_back( randVector() );
+			points1.push_back( Math::Geometry::ProjectPoint()( P[ 0 ], objPoints.back() ) );
+			points2.push_back( Math::Geometry::ProjectPoint()( P[ 1 ], objPoints.back() ) );
+		}
+		for( std::size_t i( 0 ); i < n; ++i )
+			points2.push_back( randImagePoint() );
+
+		checkEpipolarCandidates( F, points1, points2, T( 2 ) );
+		checkEpipolarCandidates( F, points1, points2, T( 20 ) );
+
+		// every point has a candidate, its true match. The assignment is expensive, so only a few points are used.
+		const std::size_t m( 15 );
+		const std::vector< Math::Vector< T, 2 > > matchPoints1( points1.begin(), points1.begin() + m );
+		std::vector< Math::Vector< T, 2 > > matchPoints2( points2.begin(), points2.begin() + m );
+		matchPoints2.insert( matchPoints2.end(), points2.end() - m, points2.end() );
+		const std::vector< Math::Vector< T, 3 > > p3D( Algorithm::reconstruct3DPoints( matchPoints1, matchPoints2, P[ 0 ], P[ 1 ], F, T( 1e-2 ) ) );
+		BOOST_CHECK_EQUAL( p3D.size(), m );
+		std::size_t nCorrect( 0 );
+		for( std::size_t i( 0 ); i < p3D.size(); ++i )
+			for( std::size_t k( 0 ); k < m; ++k )
+				if( vectorDiff( p3D[ i ], objPoints[ k ] ) < 1e-2 )
+				{
+					nCorrect++;
+					break;
+				}
+		BOOST_CHECK_EQUAL( nCorrect, p3D.size() );
+	}
+
+	// rectified stereo, the epipole lies at infinity and the epipolar lines are the rows
+	{
+		Math::Matrix< T, 3, 3 > F( Math::Matrix< T, 3, 3 >::zeros() );
+		F( 1, 2 ) = -1;
+		F( 2, 1 ) = 1;
+		std::vector< Math::Vector< T, 2 > > points1;
+		std::vector< Math::Vector< T, 2 > > points2;
+		for( std::size_t i( 0 ); i < 200; ++i )
+		{
+			points1.push_back( randImagePoint() );
+			points2.push_back( randImagePoint() );
+		}
+		checkEpipolarCandidates( F, points1, points2, T( 3 ) );
+	}
+}
+
 void Test3DPointReconstruction()
 {
 	Test2Cameras< float >( 1000, 1e-2f );
 	Test2Cameras< double >( 1000, 1e-3 );
 	TestMulitpleCameras< float >( 1000, 1e-2f );
 	TestMulitpleCameras< double >( 1000, 1e-3 );
+	TestMultiViewTriangulation< float >( 100, 1e-2f );
+	TestMultiViewTriangulation< double >( 100, 1e-6 );
+	TestEpipolarMatching< float >( 20 );
+	TestEpipolarMatching< double >( 20 );
 }
\ No newline at end of file
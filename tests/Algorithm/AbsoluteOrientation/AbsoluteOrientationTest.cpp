@@ -102,6 +102,19 @@ void testAbsoluteOrientationRandom( const std::size_t n_runs, const T epsilon )
 			BOOST_CHECK_MESSAGE( rotDiff < epsilon, "\nCompare rotation estimation using " << n_p3d << " points, error=" << rotDiff  << ":\n" << q << " (expected)\n" << estimatedPose.rotation() << " (estimated)\n" );
 		}
 		
+		{	// the point clouds give the same result
+			Pose cloudPose;
+			BOOST_CHECK( Ubitrack::Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( PointCloud< T, 3 >( leftFrame ), cloudPose, PointCloud< T, 3 >( rightFrame ) ) );
+			BOOST_CHECK_SMALL( double( quaternionDiff( cloudPose.rotation(), estimatedPose.rotation() ) ), 1e-6 );
+			BOOST_CHECK_SMALL( double( vectorDiff( cloudPose.translation(), estimatedPose.translation() ) ), 1e-4 );
+		}
+
+		{	// so do views on the vectors
+			Pose viewPose;
+			BOOST_CHECK( Ubitrack::Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( PointView< T, 3 >( leftFrame ), viewPose, PointView< T, 3 >( rightFrame ) ) );
+			BOOST_CHECK_SMALL( double( quaternionDiff( viewPose.rotation(), estimatedPose.rotation() ) ), 1e-6 );
+		}
+		
 		{	// calculate an residual error from input data
 			// const T err = Ubitrack::Algorithm::PoseEstimation3D3D::estimatePose6DResidual< T >( leftFrame.begin(), leftFrame.end(), estimatedPose, rightFrame.begin(), rightFrame.end() );
 			// std::cout << "Residual Error is " << err.first << " stdDev: " << err.second << std::endl;
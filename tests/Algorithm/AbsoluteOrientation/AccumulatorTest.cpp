@@ -0,0 +1,141 @@
+
+#include <utMath/Pose.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Geometry/PointTransformation.h>
+#include <utAlgorithm/PoseEstimation3D3D/AbsoluteOrientation.h>
+#include <utAlgorithm/PoseEstimation3D3D/Accumulator.h>
+#include <utAlgorithm/PoseEstimation3D3D/Pose6D.h>
+
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include "../../tools.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+using namespace Ubitrack::Math;
+using Ubitrack::Algorithm::PoseEstimation3D3D::AbsoluteOrientationAccumulator;
+
+template< typename T >
+void testAccumulatorRandom( const std::size_t n_runs, const T epsilon )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randVector( -100, 100 );
+	typename Random::Vector< T, 3 >::Normal randNoise( 0, 0.5 );
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		const std::size_t n = 4 + ( iRun % 60 );
+
+		std::vector< Vector< T, 3 > > rightFrame;
+		rightFrame.reserve( n );
+		std::generate_n( std::back_inserter( rightFrame ), n, randVector );
+
+		Ubitrack::Math::Quaternion q = randQuat();
+		Vector< T, 3 > t = randVector();
+		Matrix< T, 3, 4 > trafo( q, t );
+
+		// noisy points, such that the weights make a difference
+		std::vector< Vector< T, 3 > > leftFrame;
+		leftFrame.reserve( n );
+		Geometry::transform_points( trafo, rightFrame.begin(), rightFrame.end(), std::back_inserter( leftFrame ) );
+		for ( std::size_t i = 0; i < n; i++ )
+			leftFrame[ i ] += randNoise();
+
+		// the reference solution with separate passes for centroids and outer products
+		Vector< T, 3 > leftCentroid( Vector< T, 3 >::zeros() );
+		Vector< T, 3 > rightCentroid( Vector< T, 3 >::zeros() );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			leftCentroid += leftFrame[ i ] / static_cast< T >( n );
+			rightCentroid += rightFrame[ i ] / static_cast< T >( n );
+		}
+		Pose reference;
+		if ( !Ubitrack::Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( leftFrame.begin(), leftFrame.end(), reference,
+			rightFrame.begin(), rightFrame.end(), leftCentroid, rightCentroid ) )
+			continue;
+
+		// incremental accumulation
+		AbsoluteOrientationAccumulator< T > accumulator;
+		for ( std::size_t i = 0; i < n; i++ )
+			accumulator.add( leftFrame[ i ], rightFrame[ i ] );
+		BOOST_CHECK_EQUAL( accumulator.size(), n );
+		BOOST_CHECK_SMALL( vectorDiff( accumulator.centroidA(), leftCentroid ), epsilon );
+		BOOST_CHECK_SMALL( vectorDiff( accumulator.centroidB(), rightCentroid ), epsilon );
+
+		Pose pose;
+		BOOST_CHECK( accumulator.estimatePose( pose ) );
+		BOOST_CHECK_MESSAGE( quaternionDiff( pose.rotation(), reference.rotation() ) < epsilon,
+			"\nCompare rotation result using " << n << " points:\n" << reference.rotation() << " (expected)\n" << pose.rotation() << " (estimated)\n." );
+		BOOST_CHECK_SMALL( vectorDiff( pose.translation(), reference.translation() ), 100.0 * epsilon );
+
+		// two parts merged give the same result
+		const std::size_t split = n / 3;
+		AbsoluteOrientationAccumulator< T > first, second;
+		first.addRange( leftFrame.begin(), leftFrame.begin() + split, rightFrame.begin() );
+		second.addRange( leftFrame.begin() + split, leftFrame.end(), rightFrame.begin() + split );
+		first += second;
+		BOOST_CHECK_EQUAL( first.size(), n );
+		BOOST_CHECK_SMALL( matrixDiff( first.crossCovariance(), accumulator.crossCovariance() ), T( 100 ) * epsilon * static_cast< T >( n ) );
+		BOOST_CHECK_SMALL( first.estimateScale() - accumulator.estimateScale(), epsilon );
+
+		// integer weights are the same as repeated points
+		AbsoluteOrientationAccumulator< T > weighted, repeated;
+		std::vector< T > weights( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			weights[ i ] = static_cast< T >( 1 + i % 3 );
+			for ( std::size_t k = 0; k < 1 + i % 3; k++ )
+				repeated.add( leftFrame[ i ], rightFrame[ i ] );
+		}
+		weighted.addRange( leftFrame.begin(), leftFrame.end(), rightFrame.begin(), weights.begin() );
+		BOOST_CHECK_SMALL( weighted.weight() - repeated.weight(), epsilon );
+		Pose weightedPose, repeatedPose;
+		BOOST_CHECK( weighted.estimatePose( weightedPose ) );
+		BOOST_CHECK( repeated.estimatePose( repeatedPose ) );
+		BOOST_CHECK_SMALL( static_cast< T >( quaternionDiff( weightedPose.rotation(), repeatedPose.rotation() ) ), epsilon );
+		BOOST_CHECK_SMALL( vectorDiff( weightedPose.translation(), repeatedPose.translation() ), 100.0 * epsilon );
+	}
+}
+
+void testAccumulatorFarFromOrigin()
+{
+	// raw sums would cancel most digits for points at this distance
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	const Vector< double, 3 > offset( 1e7, -2e7, 5e6 );
+	const Ubitrack::Math::Quaternion q( Vector< double, 3 >( 1.0, 1.0, 1.5 ), 0.5 );
+	const Vector< double, 3 > t( -1.0, 3.0, 2.5 );
+
+	AbsoluteOrientationAccumulator< double > accumulator;
+	for ( std::size_t i = 0; i < 1000; i++ )
+	{
+		const Vector< double, 3 > b = randVector();
+		accumulator.add( q * b + t + offset, b + offset );
+	}
+
+	Pose pose;
+	BOOST_CHECK( accumulator.estimatePose( pose ) );
+	BOOST_CHECK_SMALL( quaternionDiff( pose.rotation(), q ), 1e-6 );
+	BOOST_CHECK_SMALL( accumulator.estimateScale() - 1.0, 1e-6 );
+}
+
+#ifndef HAVE_LAPACK
+
+void TestAbsOrientAccumulator()
+{
+	// Absolute Orientation does not work without lapack
+}
+
+#else // HAVE_LAPACK
+
+void TestAbsOrientAccumulator()
+{
+	testAccumulatorRandom< float >( 1000, 1e-2f );
+	testAccumulatorRandom< double >( 1000, 1e-6 );
+	testAccumulatorFarFromOrigin();
+}
+
+#endif // HAVE_LAPACK
@@ -86,6 +86,29 @@ void testCovarianceAbsoluteOrientationRandom( const std::size_t n_runs, const T
 			BOOST_CHECK_MESSAGE( posErr < epsilon, "\nCompare translation estimation using " << n_p3d << " points, stdDev=" << posErr  << ":\n" << t << " (expected)\n" << estimatedPose.translation() << " (estimated)\n");
 			BOOST_CHECK_MESSAGE( rotErr < epsilon, "\nCompare rotation estimation using " << n_p3d << " points, stdDev=" << rotErr  << ":\n" << q << " (expected)\n" << estimatedPose.rotation() << " (estimated)\n" );
 		}
+
+		{	// the fused estimation gives the residual and the covariance of the stacked jacobian
+			const T err = Ubitrack::Algorithm::PoseEstimation3D3D::estimatePose6DResidual< T >( leftFrame.begin(), leftFrame.end(), estimatedPose, rightFrame.begin(), rightFrame.end() );
+			Vector< T, 7 > params;
+			estimatedPose.toVector( params );
+			Ubitrack::Algorithm::PoseEstimation3D3D::Function::MultiplePointTransformationError< typename std::vector< Vector< T, 3 > >::iterator >
+				trafoFunc( rightFrame.begin(), rightFrame.end() );
+			Matrix< T, 6, 6 > reference;
+			Ubitrack::Math::Stochastic::backwardPropagationIdentity( reference, err, trafoFunc, params );
+
+			Pose fusedPose;
+			T fusedErr;
+			Matrix< T, 6, 6 > fused;
+			BOOST_CHECK( Ubitrack::Algorithm::PoseEstimation3D3D::estimatePose6D_3D3D( leftFrame, fusedPose, rightFrame, fusedErr, fused ) );
+			BOOST_CHECK_SMALL( quaternionDiff( fusedPose.rotation(), estimatedPose.rotation() ), 1e-9 );
+			BOOST_CHECK_CLOSE( fusedErr, err, T( 1e-3 ) );
+			T scale( 0 );
+			for ( std::size_t i = 0; i < 6; i++ )
+				scale = std::max( scale, std::fabs( reference( i, i ) ) );
+			for ( std::size_t i = 0; i < 6; i++ )
+				for ( std::size_t j = 0; j < 6; j++ )
+					BOOST_CHECK_SMALL( fused( i, j ) - reference( i, j ), scale * T( 1e-3 ) );
+		}
 	}
 	
 }
@@ -0,0 +1,128 @@
+
+#include <utMath/Pose.h>
+#include <utMath/Vector.h>
+#include <utMath/PoseListOperations.h>
+#include <utUtil/Exception.h>
+#include <utMath/Random/Vector.h>
+#include <utAlgorithm/PoseEstimation3D3D/IterativeClosestPoint.h>
+
+#include <algorithm>
+#include <cmath>
+#include "../../tools.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+using namespace Ubitrack::Math;
+using namespace Ubitrack::Algorithm::PoseEstimation3D3D;
+
+namespace {
+
+/** samples a curved surface that fixes all six degrees of freedom */
+template< typename T >
+void sampleSurface( const std::size_t n, std::vector< Vector< T, 3 > >& points )
+{
+	points.clear();
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t j = 0; j < n; j++ )
+		{
+			const double x = -2.0 + 4.0 * i / ( n - 1 );
+			const double y = -2.0 + 4.0 * j / ( n - 1 );
+			const double z = 0.3 * std::sin( 1.5 * x ) * std::cos( 1.3 * y ) + 0.1 * x * x - 0.05 * y * y * y;
+			points.push_back( Vector< T, 3 >( static_cast< T >( x ), static_cast< T >( y ), static_cast< T >( z ) ) );
+		}
+}
+
+/** the scan is a part of the model, moved away by the inverse of the pose */
+template< typename T >
+void makeScan( const std::vector< Vector< T, 3 > >& points, const Pose& pose, std::vector< Vector< T, 3 > >& scan )
+{
+	const Pose inverse( ~pose );
+	scan.clear();
+	for ( std::size_t i = 0; i < points.size(); i++ )
+		if ( std::fabs( points[ i ]( 0 ) ) < 1.5 && std::fabs( points[ i ]( 1 ) ) < 1.5 )
+		{
+			const Vector< double, 3 > p( inverse * Vector< double, 3 >( points[ i ]( 0 ), points[ i ]( 1 ), points[ i ]( 2 ) ) );
+			scan.push_back( Vector< T, 3 >( static_cast< T >( p( 0 ) ), static_cast< T >( p( 1 ) ), static_cast< T >( p( 2 ) ) ) );
+		}
+}
+
+template< typename T >
+void testIcp( IterativeClosestPoint< T >& icp, const std::vector< Vector< T, 3 > >& scene, const Pose& truth,
+	const IcpErrorMetric metric, const double epsilon )
+{
+	// warm start at the identity
+	const IcpParameter< T > params( 200, T( 0.5 ), T( 1e-7 ), T( 1e-7 ), 1, metric );
+	Pose pose;
+	BOOST_CHECK( icp.align( scene, pose, params ) );
+	BOOST_CHECK( icp.converged() );
+	BOOST_CHECK_EQUAL( icp.correspondences(), scene.size() );
+	BOOST_CHECK_MESSAGE( quaternionDiff( pose.rotation(), truth.rotation() ) < epsilon,
+		"\nrotation after " << icp.iterations() << " iterations:\n" << truth.rotation() << " (expected)\n" << pose.rotation() << " (estimated)" );
+	BOOST_CHECK_SMALL( vectorDiff( pose.translation(), truth.translation() ), epsilon );
+
+	// a warm start at the result needs few iterations
+	const std::size_t coldIterations = icp.iterations();
+	Pose warm( pose );
+	BOOST_CHECK( icp.align( scene, warm, params ) );
+	BOOST_CHECK( icp.iterations() < coldIterations );
+
+	// subsampling and threads
+	const IcpParameter< T > subsampled( 200, T( 0.5 ), T( 1e-7 ), T( 1e-7 ), 3, metric );
+	Pose serial, threaded;
+	BOOST_CHECK( icp.align( scene, serial, subsampled ) );
+	BOOST_CHECK_EQUAL( icp.correspondences(), ( scene.size() + 2 ) / 3 );
+	BOOST_CHECK( icp.align( scene, threaded, subsampled, threadExecutor( 3, 100 ) ) );
+	BOOST_CHECK_SMALL( quaternionDiff( serial.rotation(), threaded.rotation() ), 1e-12 );
+	BOOST_CHECK_SMALL( vectorDiff( serial.translation(), threaded.translation() ), 1e-12 );
+	BOOST_CHECK_SMALL( quaternionDiff( serial.rotation(), truth.rotation() ), 10 * epsilon );
+}
+
+template< typename T >
+void testPointToPoint()
+{
+	// on regular grids point to point ICP has local minima at the grid spacing, so a random cloud
+	typename Random::Vector< T, 3 >::Uniform randVector( -2, 2 );
+	std::vector< Vector< T, 3 > > model, scene;
+	std::generate_n( std::back_inserter( model ), 4000, randVector );
+
+	const Pose truth( Quaternion( Vector< double, 3 >( 0.2, -0.5, 1.0 ), 0.08 ), Vector< double, 3 >( 0.05, -0.08, 0.03 ) );
+	makeScan( model, truth, scene );
+
+	IterativeClosestPoint< T > icp( model );
+	testIcp( icp, scene, truth, IcpPointToPoint, 1e-5 );
+}
+
+template< typename T >
+void testPointToPlane( const double epsilon )
+{
+	// the scan samples the surface finer than the model
+	std::vector< Vector< T, 3 > > model, fine, scene;
+	sampleSurface( 80, model );
+	sampleSurface( 97, fine );
+
+	const Pose truth( Quaternion( Vector< double, 3 >( 0.2, -0.5, 1.0 ), 0.08 ), Vector< double, 3 >( 0.05, -0.08, 0.03 ) );
+	makeScan( fine, truth, scene );
+
+	IterativeClosestPoint< T > icp( model );
+	icp.estimateNormals( 8 );
+	testIcp( icp, scene, truth, IcpPointToPlane, epsilon );
+}
+
+} // anonymous namespace
+
+void TestIterativeClosestPoint()
+{
+	testPointToPoint< double >();
+	testPointToPlane< double >( 5e-3 );
+	testPointToPlane< float >( 1e-2 );
+
+	// point to plane without normals
+	std::vector< Vector< double, 3 > > model;
+	sampleSurface( 10, model );
+	IterativeClosestPoint< double > icp( model );
+	Pose pose;
+	BOOST_CHECK_THROW( icp.align( model, pose, IcpParameter< double >( 10, 1.0, 1e-6, 1e-6, 1, IcpPointToPlane ) ),
+		Ubitrack::Util::Exception );
+}
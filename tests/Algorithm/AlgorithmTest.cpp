@@ -5,25 +5,36 @@
 void TestTipCalibration();
 void TestRobustTipCalibration();
 void TestOptimizedTipCalibration();
+void TestIncrementalTipCalibration();
 void TestAbsOrientScale();
 void TestAbsOrientRotation3D();
+void TestAbsOrientAccumulator();
+void TestIterativeClosestPoint();
 void TestAbsoluteOrientation();
 void TestRobustAbsoluteOrientation();
 void TestOptimizedAbsoluteOrientation();
 void TestCovarianceAbsoluteOrientation();
+void TestPoseGraph();
 
 // old tests..
 void Test2D3DPoseEstimation();
+void TestSquareMarkerPose();
 void Test3DPointReconstruction();
 void TestBundleAdjustment();
+void TestBundleAdjustmentPartition();
+void TestAsyncCalibration();
 void TestDecomposeProjection();
 void TestFundamentalMatrix();
 void TestHomography();
 void TestProjectionDLT();
+void TestProjectionFunctions();
+void TestDisplayProjection();
 void TestCorrelation();
 void TestTsaiLenzHandEye();
 void TestDualHandEye();
 void TestHandEyeDataSelection();
+void TestOnlineHandEye();
+void TestCameraLens();
 
 AlgorithmTest::AlgorithmTest()
 	: boost::unit_test::test_suite( "AlgorithmTests" )
@@ -31,25 +42,36 @@ AlgorithmTest::AlgorithmTest()
 	add( BOOST_TEST_CASE( &TestTipCalibration ) );
 	add( BOOST_TEST_CASE( &TestRobustTipCalibration ) );
 	add( BOOST_TEST_CASE( &TestOptimizedTipCalibration ) );
+	add( BOOST_TEST_CASE( &TestIncrementalTipCalibration ) );
 	add( BOOST_TEST_CASE( &TestAbsOrientScale ) );
 	add( BOOST_TEST_CASE( &TestAbsOrientRotation3D ) );
+	add( BOOST_TEST_CASE( &TestAbsOrientAccumulator ) );
 	add( BOOST_TEST_CASE( &TestAbsoluteOrientation ) );
 	add( BOOST_TEST_CASE( &TestRobustAbsoluteOrientation ) );
 	add( BOOST_TEST_CASE( &TestOptimizedAbsoluteOrientation ) );
 	add( BOOST_TEST_CASE( &TestCovarianceAbsoluteOrientation ) );
+	add( BOOST_TEST_CASE( &TestIterativeClosestPoint ) );
+	add( BOOST_TEST_CASE( &TestPoseGraph ) );
 	
 	// old tests...
 	add( BOOST_TEST_CASE( &Test2D3DPoseEstimation ) );
+	add( BOOST_TEST_CASE( &TestSquareMarkerPose ) );
 	add( BOOST_TEST_CASE( &Test3DPointReconstruction ) );
 	add( BOOST_TEST_CASE( &TestBundleAdjustment ) );
+	add( BOOST_TEST_CASE( &TestBundleAdjustmentPartition ) );
+	add( BOOST_TEST_CASE( &TestAsyncCalibration ) );
 	add( BOOST_TEST_CASE( &TestDecomposeProjection ) );
 	add( BOOST_TEST_CASE( &TestFundamentalMatrix ) );
 	add( BOOST_TEST_CASE( &TestHomography ) );
 	add( BOOST_TEST_CASE( &TestProjectionDLT ) );
+	add( BOOST_TEST_CASE( &TestProjectionFunctions ) );
+	add( BOOST_TEST_CASE( &TestDisplayProjection ) );
 	add( BOOST_TEST_CASE( &TestTsaiLenzHandEye ) );
 	add( BOOST_TEST_CASE( &TestDualHandEye ) );
 	add( BOOST_TEST_CASE( &TestHandEyeDataSelection ) );
+	add( BOOST_TEST_CASE( &TestOnlineHandEye ) );
 	add( BOOST_TEST_CASE( &TestCorrelation ) );
+	add( BOOST_TEST_CASE( &TestCameraLens ) );
 	
 
 }
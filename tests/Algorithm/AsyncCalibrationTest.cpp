@@ -0,0 +1,135 @@
+#include <utAlgorithm/AsyncCalibration.h>
+#include <utAlgorithm/PoseEstimation6D6D/TsaiLenz.h>
+#include <utAlgorithm/ToolTip/TipCalibration.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utUtil/Exception.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/// collects the progress records of an operation
+struct ProgressLog
+{
+	void add( const Ubitrack::Util::ProgressRecord& record )
+	{
+		boost::mutex::scoped_lock l( mutex );
+		algorithms.push_back( record.algorithm );
+		residuals.push_back( record.residual );
+	}
+
+	boost::mutex mutex;
+	std::vector< std::string > algorithms;
+	std::vector< double > residuals;
+};
+
+void cancelAtFirstIteration( Ubitrack::Util::CancellationToken token, const Ubitrack::Util::ProgressRecord& record )
+{
+	if ( record.iteration >= 1 )
+		token.cancel();
+}
+
+} // anonymous namespace
+
+
+void TestAsyncCalibration()
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	Ubitrack::Util::Executor executor( 3 );
+
+	// tip calibration gives the same result as the synchronous call
+	std::vector< Pose > tipPoses;
+	const Vector< double, 3 > tip( 0.1, 0.2, 0.3 );
+	const Vector< double, 3 > pivot( 1, 2, 3 );
+	for ( std::size_t i = 0; i < 20; i++ )
+	{
+		const Quaternion q( randQuat() );
+		tipPoses.push_back( Pose( q, Vector< double, 3 >( pivot - q * tip ) ) );
+	}
+	const Algorithm::TipCalibrationResult tipResult( Algorithm::tipCalibrationAsync( tipPoses, Ubitrack::Util::CancellationToken(),
+		Ubitrack::Util::ProgressCallback(), executor ).get() );
+	BOOST_CHECK( tipResult.valid );
+	BOOST_CHECK_SMALL( ublas::norm_2( tipResult.pm - tip ), 1e-6 );
+	BOOST_CHECK_SMALL( ublas::norm_2( tipResult.pw - pivot ), 1e-6 );
+
+	// k-means of well separated clusters
+	std::vector< Vector< double, 3 > > points;
+	for ( std::size_t i = 0; i < 300; i++ )
+		points.push_back( Vector< double, 3 >( 10.0 * ( i % 3 ), 0, 0 ) + 0.5 * randVector() );
+	ProgressLog kMeansLog;
+	const Algorithm::KMeansResult kMeansResult( Algorithm::kMeansAsync( points, 3, Ubitrack::Util::CancellationToken(),
+		boost::bind( &ProgressLog::add, &kMeansLog, _1 ), executor ).get() );
+	BOOST_CHECK_EQUAL( kMeansResult.centroids.size(), 3u );
+	BOOST_REQUIRE_EQUAL( kMeansResult.indices.size(), points.size() );
+	for ( std::size_t i = 3; i < points.size(); i++ )
+		BOOST_CHECK_EQUAL( kMeansResult.indices[ i ], kMeansResult.indices[ i % 3 ] );
+	BOOST_CHECK( !kMeansLog.algorithms.empty() );
+	BOOST_CHECK_THROW( Algorithm::kMeansAsync( points, 0 ).get(), Ubitrack::Util::Exception );
+
+#ifdef HAVE_LAPACK
+	// hand-eye calibration gives the same result as the synchronous call
+	const Pose x( randQuat(), randVector() );
+	std::vector< Pose > hands, eyes;
+	for ( std::size_t i = 0; i < 40; i++ )
+	{
+		hands.push_back( Pose( randQuat(), Vector< double, 3 >( 3.0 * randVector() ) ) );
+		eyes.push_back( ~x * ~hands.back() );
+	}
+	const Pose expected( Algorithm::PoseEstimation6D6D::performHandEyeCalibration( hands, eyes, true ) );
+	const Pose handEye( Algorithm::performHandEyeCalibrationAsync( hands, eyes, true, Ubitrack::Util::CancellationToken(),
+		Ubitrack::Util::ProgressCallback(), executor ).get() );
+	BOOST_CHECK_SMALL( ublas::norm_2( handEye.translation() - expected.translation() ), 1e-9 );
+
+	Ubitrack::Util::CancellationToken handEyeToken;
+	handEyeToken.cancel();
+	BOOST_CHECK_THROW( Algorithm::performHandEyeCalibrationAsync( hands, eyes, true, handEyeToken, Ubitrack::Util::ProgressCallback(), executor ).get(),
+		Ubitrack::Util::OperationCancelled );
+
+	// bundle adjustment reports the iterations of the optimizer
+	const std::size_t nCams = 4;
+	const std::size_t nPoints = 30;
+	std::vector< Pose > cameras;
+	std::vector< Vector< double, 3 > > pts3D;
+	for ( std::size_t c = 0; c < nCams; c++ )
+		cameras.push_back( Pose( Quaternion::fromLogarithm( Vector< double, 3 >( 0.1 * randVector() ) ), Vector< double, 3 >( 0.5 * c, 0, 6 ) ) );
+	for ( std::size_t p = 0; p < nPoints; p++ )
+		pts3D.push_back( randVector() );
+	std::vector< std::vector< Vector< double, 2 > > > pts2D( nCams );
+	for ( std::size_t c = 0; c < nCams; c++ )
+		for ( std::size_t p = 0; p < nPoints; p++ )
+		{
+			const Vector< double, 3 > x( cameras[ c ] * pts3D[ p ] );
+			pts2D[ c ].push_back( Vector< double, 2 >( x( 0 ) / x( 2 ), x( 1 ) / x( 2 ) ) );
+		}
+	for ( std::size_t c = 1; c < nCams; c++ )
+		cameras[ c ] = Pose( cameras[ c ].rotation(), cameras[ c ].translation() + 0.02 * randVector() );
+	for ( std::size_t p = 0; p < nPoints; p++ )
+		pts3D[ p ] += 0.02 * randVector();
+
+	ProgressLog baLog;
+	const Algorithm::SimpleBundleAdjustmentResult baResult( Algorithm::simpleBundleAdjustmentAsync( pts2D, cameras, pts3D,
+		Algorithm::baSparseSchurSolver, Ubitrack::Util::CancellationToken(), boost::bind( &ProgressLog::add, &baLog, _1 ), executor ).get() );
+	BOOST_CHECK_EQUAL( baResult.cameras.size(), nCams );
+	BOOST_CHECK_EQUAL( baResult.points.size(), nPoints );
+	BOOST_REQUIRE( baLog.residuals.size() >= 2 );
+	BOOST_CHECK_EQUAL( baLog.algorithms.front(), "Schur Levenberg-Marquardt" );
+	BOOST_CHECK( baLog.residuals.back() < baLog.residuals.front() );
+
+	Ubitrack::Util::CancellationToken baToken;
+	BOOST_CHECK_THROW( Algorithm::simpleBundleAdjustmentAsync( pts2D, cameras, pts3D, Algorithm::baSparseSchurSolver, baToken,
+		boost::bind( &cancelAtFirstIteration, baToken, _1 ), executor ).get(), Ubitrack::Util::OperationCancelled );
+#endif
+}
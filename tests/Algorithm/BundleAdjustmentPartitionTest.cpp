@@ -0,0 +1,121 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <utAlgorithm/BundleAdjustmentPartition.h>
+#include <utMath/Random/Vector.h>
+#include <utUtil/Exception.h>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** a row of cameras looking at a strip of points, each camera sees the points in front of it */
+Algorithm::BundleAdjustmentNetwork stripNetwork( const std::size_t nCameras )
+{
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	Algorithm::BundleAdjustmentNetwork network;
+	for ( std::size_t c = 0; c < nCameras; c++ )
+		network.cameras.push_back( Pose( Quaternion::fromLogarithm( Vector< double, 3 >( 0.05 * randVector() ) ),
+			Vector< double, 3 >( -0.5 * c, 0, 8 ) ) );
+	for ( std::size_t p = 0; p < 15 * nCameras; p++ )
+	{
+		const Vector< double, 3 > r( randVector() );
+		network.points.push_back( Vector< double, 3 >( 0.5 * ( nCameras - 1 ) * ( r( 0 ) + 1 ) / 2, r( 1 ), r( 2 ) ) );
+	}
+	for ( std::size_t c = 0; c < nCameras; c++ )
+		for ( std::size_t p = 0; p < network.points.size(); p++ )
+			if ( std::fabs( network.points[ p ]( 0 ) - 0.5 * c ) < 1.6 )
+			{
+				const Vector< double, 3 > x( network.cameras[ c ] * network.points[ p ] );
+				network.observations.push_back( Algorithm::BundleAdjustmentNetwork::Observation( c, p, Vector< double, 2 >( x( 0 ) / x( 2 ), x( 1 ) / x( 2 ) ) ) );
+			}
+	return network;
+}
+
+/** solves each cluster after sending it and its solution through the serialization */
+struct RemoteSolver
+{
+	std::size_t* pCount;
+
+	void operator()( std::vector< Algorithm::BundleAdjustmentCluster >& clusters ) const
+	{
+		for ( std::size_t k = 0; k < clusters.size(); k++ )
+		{
+			std::vector< Algorithm::BundleAdjustmentCluster > remote( 1, Algorithm::deserializeCluster( Algorithm::serializeCluster( clusters[ k ] ) ) );
+			Algorithm::solveClustersLocally( remote );
+			clusters[ k ] = Algorithm::deserializeCluster( Algorithm::serializeCluster( remote[ 0 ] ) );
+			( *pCount )++;
+		}
+	}
+};
+
+} // anonymous namespace
+
+
+void TestBundleAdjustmentPartition()
+{
+	const std::size_t nCameras = 16;
+	const Algorithm::BundleAdjustmentNetwork truth( stripNetwork( nCameras ) );
+	BOOST_CHECK_SMALL( Algorithm::reprojectionError( truth ), 1e-20 );
+
+	// each camera is the core camera of exactly one cluster
+	Algorithm::BundleAdjustmentPartitionParameters params;
+	params.maxClusterCameras = 4;
+	params.overlapCameras = 2;
+	params.consensusRounds = 3;
+	const std::vector< Algorithm::BundleAdjustmentCluster > clusters( Algorithm::partitionNetwork( truth, params ) );
+	BOOST_CHECK( clusters.size() >= nCameras / params.maxClusterCameras );
+	std::vector< std::size_t > coreCount( nCameras, 0 );
+	for ( std::size_t k = 0; k < clusters.size(); k++ )
+	{
+		const Algorithm::BundleAdjustmentCluster& cluster( clusters[ k ] );
+		BOOST_CHECK( cluster.coreCameras <= params.maxClusterCameras );
+		BOOST_CHECK( cluster.cameraIds.size() <= cluster.coreCameras + params.overlapCameras );
+		BOOST_CHECK_EQUAL( cluster.network.cameras.size(), cluster.cameraIds.size() );
+		BOOST_CHECK_EQUAL( cluster.network.points.size(), cluster.pointIds.size() );
+		for ( std::size_t i = 0; i < cluster.coreCameras; i++ )
+			coreCount[ cluster.cameraIds[ i ] ]++;
+		BOOST_CHECK_SMALL( Algorithm::reprojectionError( cluster.network ), 1e-20 );
+	}
+	for ( std::size_t c = 0; c < nCameras; c++ )
+		BOOST_CHECK_EQUAL( coreCount[ c ], 1u );
+
+	// the serialized clusters are identical
+	const Algorithm::BundleAdjustmentCluster copy( Algorithm::deserializeCluster( Algorithm::serializeCluster( clusters[ 1 ] ) ) );
+	BOOST_CHECK( copy.cameraIds == clusters[ 1 ].cameraIds );
+	BOOST_CHECK( copy.pointIds == clusters[ 1 ].pointIds );
+	BOOST_CHECK_EQUAL( copy.coreCameras, clusters[ 1 ].coreCameras );
+	BOOST_REQUIRE_EQUAL( copy.network.observations.size(), clusters[ 1 ].network.observations.size() );
+	BOOST_CHECK_EQUAL( copy.network.observations.back().point, clusters[ 1 ].network.observations.back().point );
+	BOOST_CHECK_EQUAL( ublas::norm_2( copy.network.points.back() - clusters[ 1 ].network.points.back() ), 0.0 );
+	BOOST_CHECK_EQUAL( ublas::norm_2( copy.network.cameras[ 0 ].translation() - clusters[ 1 ].network.cameras[ 0 ].translation() ), 0.0 );
+	BOOST_CHECK_THROW( Algorithm::deserializeCluster( Algorithm::serializeCluster( clusters[ 1 ] ).substr( 0, 40 ) ), Ubitrack::Util::Exception );
+
+	// distributed bundle adjustment of a disturbed network, the clusters are sent through the serialization
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	Algorithm::BundleAdjustmentNetwork network( truth );
+	for ( std::size_t c = 0; c < nCameras; c++ )
+		network.cameras[ c ] = Pose( network.cameras[ c ].rotation() * Quaternion::fromLogarithm( Vector< double, 3 >( 0.01 * randVector() ) ),
+			network.cameras[ c ].translation() + 0.05 * randVector() );
+	for ( std::size_t p = 0; p < network.points.size(); p++ )
+		network.points[ p ] += 0.05 * randVector();
+	const double initialError = Algorithm::reprojectionError( network );
+
+	std::size_t solvedClusters = 0;
+	const RemoteSolver remoteSolver = { &solvedClusters };
+
+	const double error = Algorithm::distributedBundleAdjustment( network, params, remoteSolver );
+	BOOST_CHECK( solvedClusters >= params.consensusRounds * clusters.size() );
+	BOOST_CHECK_CLOSE( error, Algorithm::reprojectionError( network ), 1e-9 );
+	BOOST_CHECK( error < 0.1 * initialError );
+
+	// a final global refinement improves the merged solution
+	params.consensusRounds = 1;
+	params.refineGlobally = true;
+	BOOST_CHECK( Algorithm::distributedBundleAdjustment( network, params ) < error );
+
+	params.maxClusterCameras = 0;
+	BOOST_CHECK_THROW( Algorithm::partitionNetwork( truth, params ), Ubitrack::Util::Exception );
+}
@@ -0,0 +1,410 @@
+#include <utAlgorithm/CameraLens/Correction.h>
+#include <utAlgorithm/CameraLens/UndistortionGrid.h>
+#include <utAlgorithm/CameraLens/CameraModel.h>
+#include <utAlgorithm/CameraLens/IntrinsicCalibration.h>
+#include <utAlgorithm/Projection.h>
+#include <utMath/Optimization/RobustLoss.h>
+#include <utMath/Random/Scalar.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** some realistic intrinsics of a wide angle camera, in the ubitrack convention with K( 2, 2 ) = -1 */
+template< typename T >
+Math::CameraIntrinsics< T > randomIntrinsics()
+{
+	Matrix< T, 3, 3 > K( Matrix< T, 3, 3 >::identity() );
+	K( 0, 0 ) = Random::distribute_uniform< T >( 600, 800 );
+	K( 1, 1 ) = K( 0, 0 ) * Random::distribute_uniform< T >( 0.95, 1.05 );
+	K( 0, 2 ) = -Random::distribute_uniform< T >( 300, 340 );
+	K( 1, 2 ) = -Random::distribute_uniform< T >( 220, 260 );
+	K( 2, 2 ) = -1;
+
+	Vector< T, 6 > radial( Vector< T, 6 >::zeros() );
+	radial( 0 ) = Random::distribute_uniform< T >( -0.15, 0.1 );
+	radial( 1 ) = Random::distribute_uniform< T >( -0.02, 0.02 );
+	radial( 2 ) = Random::distribute_uniform< T >( -0.005, 0.005 );
+	Vector< T, 2 > tangential( Random::distribute_uniform< T >( -0.001, 0.001 ), Random::distribute_uniform< T >( -0.001, 0.001 ) );
+	return Math::CameraIntrinsics< T >( K, radial, tangential, 640, 480 );
+}
+
+template< typename T >
+void randomPixels( const std::size_t n, std::vector< Vector< T, 2 > >& points )
+{
+	points.clear();
+	for ( std::size_t i = 0; i < n; i++ )
+		points.push_back( Vector< T, 2 >( Random::distribute_uniform< T >( 0, 640 ), Random::distribute_uniform< T >( 0, 480 ) ) );
+}
+
+} // anonymous namespace
+
+
+template< typename T >
+void testBatchLensCorrection( const std::size_t n_runs, const T epsilon )
+{
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const Math::CameraIntrinsics< T > intrinsics( randomIntrinsics< T >() );
+
+		// odd number of points to exercise the remainder of the packs
+		std::vector< Vector< T, 2 > > points;
+		randomPixels( 101, points );
+
+		// batch distortion gives the same result as the single point version
+		std::vector< Vector< T, 2 > > distorted;
+		Algorithm::CameraLens::distort( intrinsics, points, distorted );
+		BOOST_REQUIRE_EQUAL( distorted.size(), points.size() );
+		for ( std::size_t i = 0; i < points.size(); i++ )
+		{
+			Vector< T, 2 > single;
+			Algorithm::CameraLens::distort( intrinsics, points[ i ], single );
+			BOOST_CHECK_SMALL( ublas::norm_2( single - distorted[ i ] ), epsilon );
+		}
+
+		// undistortion inverts the distortion
+		std::vector< Vector< T, 2 > > undistorted;
+		Algorithm::CameraLens::undistort( intrinsics, distorted, undistorted );
+		BOOST_REQUIRE_EQUAL( undistorted.size(), points.size() );
+		for ( std::size_t i = 0; i < points.size(); i++ )
+		{
+			BOOST_CHECK_SMALL( ublas::norm_2( undistorted[ i ] - points[ i ] ), epsilon );
+
+			Vector< T, 2 > single;
+			Algorithm::CameraLens::undistort( intrinsics, distorted[ i ], single );
+			BOOST_CHECK_SMALL( ublas::norm_2( single - undistorted[ i ] ), epsilon );
+		}
+
+		// in-place
+		Algorithm::CameraLens::undistort( intrinsics, distorted, distorted );
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			BOOST_CHECK_EQUAL( ublas::norm_2( undistorted[ i ] - distorted[ i ] ), 0 );
+	}
+}
+
+
+template< typename T >
+void testWideAngleUndistortion( const T epsilon )
+{
+	// strong barrel distortion, the corners are far from the initial guess
+	Matrix< T, 3, 3 > K( Matrix< T, 3, 3 >::identity() );
+	K( 0, 0 ) = 400;
+	K( 1, 1 ) = 400;
+	K( 0, 2 ) = -320;
+	K( 1, 2 ) = -240;
+	K( 2, 2 ) = -1;
+	Vector< T, 6 > radial( Vector< T, 6 >::zeros() );
+	radial( 0 ) = T( -0.35 );
+	radial( 1 ) = T( 0.12 );
+	radial( 2 ) = T( -0.02 );
+	const Math::CameraIntrinsics< T > intrinsics( K, radial, Vector< T, 2 >( T( 0.001 ), T( -0.002 ) ), 640, 480 );
+
+	std::vector< Vector< T, 2 > > points;
+	for ( int v = -80; v <= 560; v += 40 )
+		for ( int u = -100; u <= 740; u += 40 )
+			points.push_back( Vector< T, 2 >( T( u ), T( v ) ) );
+
+	std::vector< Vector< T, 2 > > distorted;
+	Algorithm::CameraLens::distort( intrinsics, points, distorted );
+
+	std::vector< Vector< T, 2 > > undistorted;
+	Algorithm::CameraLens::undistort( intrinsics, distorted, undistorted );
+	for ( std::size_t i = 0; i < points.size(); i++ )
+	{
+		BOOST_CHECK_SMALL( ublas::norm_2( undistorted[ i ] - points[ i ] ), epsilon );
+
+		Vector< T, 2 > single;
+		Algorithm::CameraLens::undistort( intrinsics, distorted[ i ], single );
+		BOOST_CHECK_SMALL( ublas::norm_2( single - points[ i ] ), epsilon );
+	}
+}
+
+template< typename T >
+void testUndistortionGrid( const std::size_t n_runs, const T epsilon )
+{
+	Algorithm::CameraLens::UndistortionGrid< T > grid;
+	BOOST_CHECK( !grid.valid() );
+
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const Math::CameraIntrinsics< T > intrinsics( randomIntrinsics< T >() );
+		BOOST_CHECK( grid.update( intrinsics ) );
+		BOOST_CHECK( !grid.update( intrinsics ) );
+		BOOST_CHECK( grid.valid() );
+
+		// copies share the version, equal parameters built separately are recognized as well
+		const Math::CameraIntrinsics< T > copy( intrinsics );
+		BOOST_CHECK_EQUAL( copy.version(), intrinsics.version() );
+		BOOST_CHECK( !grid.update( copy ) );
+		Math::CameraIntrinsics< T > modified( intrinsics.matrix, intrinsics.radial_params, intrinsics.tangential_params, 640, 480 );
+		BOOST_CHECK( !grid.update( modified ) );
+		modified.radial_params( 0 ) += T( 0.01 );
+		BOOST_CHECK( modified.version() != intrinsics.version() );
+		BOOST_CHECK( grid.update( modified ) );
+		BOOST_CHECK( grid.update( intrinsics ) );
+
+		std::vector< Vector< T, 2 > > distorted;
+		randomPixels( 101, distorted );
+		// some points outside of the image
+		distorted.push_back( Vector< T, 2 >( -10, 100 ) );
+		distorted.push_back( Vector< T, 2 >( 700, 500 ) );
+
+		std::vector< Vector< T, 2 > > expected;
+		Algorithm::CameraLens::undistort( intrinsics, distorted, expected );
+
+		std::vector< Vector< T, 2 > > undistorted;
+		grid.undistort( distorted, undistorted );
+		BOOST_REQUIRE_EQUAL( undistorted.size(), distorted.size() );
+		for ( std::size_t i = 0; i < distorted.size(); i++ )
+			BOOST_CHECK_SMALL( ublas::norm_2( undistorted[ i ] - expected[ i ] ), epsilon );
+	}
+}
+
+
+template< typename T >
+void testDerivedIntrinsics( const std::size_t n_runs, const T epsilon )
+{
+	Algorithm::OpenGLProjectionCache< T > projection;
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		Math::CameraIntrinsics< T > intrinsics( randomIntrinsics< T >() );
+		const std::size_t version = intrinsics.version();
+		BOOST_CHECK( version != 0 );
+		BOOST_CHECK_EQUAL( intrinsics.version(), version );
+
+		const Matrix< T, 3, 3 > identity( ublas::prod( intrinsics.inverse(), intrinsics.matrix ) );
+		BOOST_CHECK_SMALL( matrixDiff( identity, Matrix< T, 3, 3 >::identity() ), epsilon );
+
+		const Matrix< T, 4, 4 > expected( Algorithm::projectionMatrixToOpenGL( T( 0 ), T( 639 ), T( 0 ), T( 479 ), T( 0.1 ), T( 100 ), intrinsics.matrix ) );
+		BOOST_CHECK_SMALL( matrixDiff( projection( intrinsics, T( 0.1 ), T( 100 ) ), expected ), epsilon );
+
+		// a direct modification of a member is detected
+		intrinsics.matrix( 0, 1 ) = T( 0.5 );
+		BOOST_CHECK( intrinsics.version() != version );
+		const Matrix< T, 3, 3 > skewed( ublas::prod( intrinsics.inverse(), intrinsics.matrix ) );
+		BOOST_CHECK_SMALL( matrixDiff( skewed, Matrix< T, 3, 3 >::identity() ), epsilon );
+		const Matrix< T, 4, 4 > expectedSkewed( Algorithm::projectionMatrixToOpenGL( T( 0 ), T( 639 ), T( 0 ), T( 479 ), T( 0.1 ), T( 100 ), intrinsics.matrix ) );
+		BOOST_CHECK_SMALL( matrixDiff( projection( intrinsics, T( 0.1 ), T( 100 ) ), expectedSkewed ), epsilon );
+	}
+}
+
+
+template< typename T >
+void testCameraModel( const std::size_t n_runs, const T epsilon )
+{
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const Math::CameraIntrinsics< T > general( randomIntrinsics< T >() );
+
+		// the same lens with each of the calibration types
+		std::vector< Math::CameraIntrinsics< T > > types;
+		types.push_back( Math::CameraIntrinsics< T >( general.matrix, Vector< T, 2 >( general.radial_params( 0 ), general.radial_params( 1 ) ), general.tangential_params, 640, 480 ) );
+		types.push_back( Math::CameraIntrinsics< T >( general.matrix, Vector< T, 3 >( general.radial_params( 0 ), general.radial_params( 1 ), general.radial_params( 2 ) ), general.tangential_params, 640, 480 ) );
+		Vector< T, 6 > rational( general.radial_params );
+		rational( 3 ) = Random::distribute_uniform< T >( -0.1, 0.1 );
+		rational( 4 ) = Random::distribute_uniform< T >( -0.01, 0.01 );
+		types.push_back( Math::CameraIntrinsics< T >( general.matrix, rational, general.tangential_params, 640, 480 ) );
+
+		for ( std::size_t t = 0; t < types.size(); t++ )
+		{
+			const Math::CameraIntrinsics< T >& intrinsics( types[ t ] );
+			const Algorithm::CameraLens::CameraModel< T > model( intrinsics );
+
+			std::vector< Vector< T, 2 > > points;
+			randomPixels( 101, points );
+
+			// same results as the functions that take the intrinsics
+			std::vector< Vector< T, 2 > > distorted, expected;
+			model.distort( points, distorted );
+			Algorithm::CameraLens::distort( intrinsics, points, expected );
+			BOOST_REQUIRE_EQUAL( distorted.size(), points.size() );
+			for ( std::size_t i = 0; i < points.size(); i++ )
+			{
+				BOOST_CHECK_SMALL( ublas::norm_2( distorted[ i ] - expected[ i ] ), epsilon );
+				BOOST_CHECK_SMALL( ublas::norm_2( model.distort( points[ i ] ) - expected[ i ] ), epsilon );
+			}
+
+			std::vector< Vector< T, 2 > > undistorted;
+			model.undistort( distorted, undistorted );
+			Algorithm::CameraLens::undistort( intrinsics, distorted, expected );
+			for ( std::size_t i = 0; i < points.size(); i++ )
+			{
+				BOOST_CHECK_SMALL( ublas::norm_2( undistorted[ i ] - expected[ i ] ), epsilon );
+				BOOST_CHECK_SMALL( ublas::norm_2( undistorted[ i ] - points[ i ] ), epsilon );
+				BOOST_CHECK_SMALL( ublas::norm_2( model.undistort( distorted[ i ] ) - undistorted[ i ] ), epsilon );
+			}
+
+			// projection is the distortion of the ideal projection, points in front of the camera have negative z
+			std::vector< Vector< T, 3 > > points3D;
+			std::vector< Vector< T, 2 > > ideal;
+			for ( std::size_t i = 0; i < points.size(); i++ )
+			{
+				const Vector< T, 3 > p( Random::distribute_uniform< T >( -1, 1 ), Random::distribute_uniform< T >( -1, 1 ), -Random::distribute_uniform< T >( 2, 5 ) );
+				const Vector< T, 3 > h( ublas::prod( intrinsics.matrix, p ) );
+				points3D.push_back( p );
+				ideal.push_back( Vector< T, 2 >( h( 0 ) / h( 2 ), h( 1 ) / h( 2 ) ) );
+			}
+			std::vector< Vector< T, 2 > > projected;
+			model.project( points3D, projected );
+			Algorithm::CameraLens::distort( intrinsics, ideal, expected );
+			BOOST_REQUIRE_EQUAL( projected.size(), points3D.size() );
+			for ( std::size_t i = 0; i < points3D.size(); i++ )
+			{
+				BOOST_CHECK_SMALL( ublas::norm_2( projected[ i ] - expected[ i ] ), epsilon );
+				BOOST_CHECK_SMALL( ublas::norm_2( model.project( points3D[ i ] ) - expected[ i ] ), epsilon );
+			}
+		}
+	}
+
+	const Math::CameraIntrinsics< T > fisheye( Matrix< T, 3, 3 >::identity(), Vector< T, 4 >( 0.1, 0.01, 0, 0 ) );
+	BOOST_CHECK_THROW( Algorithm::CameraLens::CameraModel< T >( fisheye ).project( Vector< T, 3 >( 0, 0, -1 ) ), Ubitrack::Util::Exception );
+}
+
+
+template< typename T >
+void testIntrinsicCalibration( const std::size_t n_runs )
+{
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const Math::CameraIntrinsics< T > general( randomIntrinsics< T >() );
+		const Math::CameraIntrinsics< T > intrinsics( general.matrix, Vector< T, 3 >( general.radial_params( 0 ), general.radial_params( 1 ), general.radial_params( 2 ) ), general.tangential_params, 640, 480 );
+		const Algorithm::CameraLens::CameraModel< T > model( intrinsics );
+
+		// a chessboard with 8 x 6 corners in tilted views, with noise and some gross outliers
+		const std::size_t nViews = 20;
+		std::vector< std::vector< Vector< T, 3 > > > objectPoints( nViews );
+		std::vector< std::vector< Vector< T, 2 > > > imagePoints( nViews );
+		std::vector< Math::Pose > poses;
+		std::size_t nOutliers = 0;
+		for ( std::size_t v = 0; v < nViews; v++ )
+		{
+			const Math::Quaternion rot( Math::Quaternion::fromLogarithm( Vector< double, 3 >( Random::distribute_uniform< double >( -0.5, 0.5 )
+				, Random::distribute_uniform< double >( -0.5, 0.5 ), Random::distribute_uniform< double >( -0.3, 0.3 ) ) ) );
+			const Math::Pose pose( rot, Vector< double, 3 >( Random::distribute_uniform< double >( -0.05, 0.05 )
+				, Random::distribute_uniform< double >( -0.05, 0.05 ), -Random::distribute_uniform< double >( 0.4, 0.6 ) ) );
+			for ( std::size_t i = 0; i < 48; i++ )
+			{
+				const Vector< double, 3 > corner( 0.03 * ( i % 8 - 3.5 ), 0.03 * ( i / 8 - 2.5 ), 0 );
+				const Vector< double, 3 > p( pose * corner );
+				Vector< T, 2 > pixel( model.project( Vector< T, 3 >( T( p( 0 ) ), T( p( 1 ) ), T( p( 2 ) ) ) ) );
+				pixel( 0 ) += Random::distribute_normal< T >( 0, T( 0.2 ) );
+				pixel( 1 ) += Random::distribute_normal< T >( 0, T( 0.2 ) );
+				if ( ( v * 48 + i ) % 50 == 7 )
+				{
+					pixel( 0 ) += 25;
+					nOutliers++;
+				}
+				objectPoints[ v ].push_back( Vector< T, 3 >( T( corner( 0 ) ), T( corner( 1 ) ), T( corner( 2 ) ) ) );
+				imagePoints[ v ].push_back( pixel );
+			}
+
+			// perturbed initial pose
+			poses.push_back( Math::Pose( Math::Quaternion::fromLogarithm( Vector< double, 3 >( 0.02, -0.02, 0.01 ) ) * pose.rotation()
+				, pose.translation() + Vector< double, 3 >( 0.005, -0.005, 0.01 ) ) );
+		}
+		BOOST_REQUIRE( nOutliers > 0 );
+
+		// initial intrinsics without distortion and with an offset focal length and principal point
+		Math::CameraIntrinsics< T > initial( intrinsics );
+		initial.matrix( 0, 0 ) *= T( 1.05 );
+		initial.matrix( 1, 1 ) *= T( 0.95 );
+		initial.matrix( 0, 2 ) += 8;
+		initial.matrix( 1, 2 ) -= 8;
+		initial.radial_params = Vector< T, 6 >::zeros();
+		initial.tangential_params = Vector< T, 2 >::zeros();
+
+		Algorithm::CameraLens::IntrinsicCalibration< T > calibration( objectPoints, imagePoints );
+		BOOST_CHECK_EQUAL( calibration.viewCount(), nViews );
+		BOOST_CHECK_EQUAL( calibration.cornerCount(), nViews * 48 );
+
+		const Math::Optimization::CauchyLoss loss( 1.0 );
+		Math::CameraIntrinsics< T > result( initial );
+		std::vector< Math::Pose > resultPoses( poses );
+		calibration.optimize( result, resultPoses, loss, Algorithm::CameraLens::IntrinsicCalibrationParameter(), Math::threadExecutor( 3, 1 ) );
+		BOOST_CHECK( calibration.iterations() > 0 );
+
+		// the robust loss recovers the lens despite the outliers
+		BOOST_CHECK_SMALL( double( result.matrix( 0, 0 ) - intrinsics.matrix( 0, 0 ) ), 3.0 );
+		BOOST_CHECK_SMALL( double( result.matrix( 1, 1 ) - intrinsics.matrix( 1, 1 ) ), 3.0 );
+		BOOST_CHECK_SMALL( double( result.matrix( 0, 2 ) - intrinsics.matrix( 0, 2 ) ), 3.0 );
+		BOOST_CHECK_SMALL( double( result.matrix( 1, 2 ) - intrinsics.matrix( 1, 2 ) ), 3.0 );
+		BOOST_CHECK_EQUAL( result.matrix( 0, 1 ), intrinsics.matrix( 0, 1 ) );
+		BOOST_CHECK_EQUAL( result.matrix( 2, 2 ), intrinsics.matrix( 2, 2 ) );
+		BOOST_CHECK_EQUAL( result.radial_params( 3 ), T( 0 ) );
+
+		// inliers have the reprojection error of the noise
+		const Algorithm::CameraLens::CameraModel< T > resultModel( result );
+		double squaredError = 0;
+		std::size_t nInliers = 0;
+		for ( std::size_t v = 0; v < nViews; v++ )
+			for ( std::size_t i = 0; i < 48; i++ )
+			{
+				if ( ( v * 48 + i ) % 50 == 7 )
+					continue;
+				const Vector< double, 3 > p( resultPoses[ v ] * Vector< double, 3 >( objectPoints[ v ][ i ]( 0 ), objectPoints[ v ][ i ]( 1 ), objectPoints[ v ][ i ]( 2 ) ) );
+				const Vector< T, 2 > e( resultModel.project( Vector< T, 3 >( T( p( 0 ) ), T( p( 1 ) ), T( p( 2 ) ) ) ) - imagePoints[ v ][ i ] );
+				squaredError += double( e( 0 ) * e( 0 ) + e( 1 ) * e( 1 ) );
+				nInliers++;
+			}
+		BOOST_CHECK_SMALL( std::sqrt( squaredError / nInliers ), 0.5 );
+
+		// the same result without threads
+		Math::CameraIntrinsics< T > serial( initial );
+		std::vector< Math::Pose > serialPoses( poses );
+		calibration.optimize( serial, serialPoses, loss );
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t c = 0; c < 3; c++ )
+				BOOST_CHECK_EQUAL( serial.matrix( r, c ), result.matrix( r, c ) );
+		for ( std::size_t j = 0; j < 6; j++ )
+			BOOST_CHECK_EQUAL( serial.radial_params( j ), result.radial_params( j ) );
+
+		// least squares is pulled away by the outliers but converges on the inliers alone
+		std::vector< std::vector< Vector< T, 3 > > > inlierObjects( nViews );
+		std::vector< std::vector< Vector< T, 2 > > > inlierImages( nViews );
+		for ( std::size_t v = 0; v < nViews; v++ )
+			for ( std::size_t i = 0; i < 48; i++ )
+				if ( ( v * 48 + i ) % 50 != 7 )
+				{
+					inlierObjects[ v ].push_back( objectPoints[ v ][ i ] );
+					inlierImages[ v ].push_back( imagePoints[ v ][ i ] );
+				}
+		Algorithm::CameraLens::IntrinsicCalibration< T > inlierCalibration( inlierObjects, inlierImages );
+		Math::CameraIntrinsics< T > leastSquares( initial );
+		std::vector< Math::Pose > leastSquaresPoses( poses );
+		inlierCalibration.optimize( leastSquares, leastSquaresPoses );
+		BOOST_CHECK_SMALL( inlierCalibration.rmsError(), 0.5 );
+		BOOST_CHECK_SMALL( double( leastSquares.matrix( 0, 0 ) - intrinsics.matrix( 0, 0 ) ), 3.0 );
+	}
+
+	// one pose per view is required
+	std::vector< std::vector< Vector< T, 3 > > > objectPoints( 2, std::vector< Vector< T, 3 > >( 4, Vector< T, 3 >::zeros() ) );
+	std::vector< std::vector< Vector< T, 2 > > > imagePoints( 2, std::vector< Vector< T, 2 > >( 4, Vector< T, 2 >::zeros() ) );
+	Algorithm::CameraLens::IntrinsicCalibration< T > calibration( objectPoints, imagePoints );
+	Math::CameraIntrinsics< T > intrinsics( randomIntrinsics< T >() );
+	std::vector< Math::Pose > poses( 1 );
+	BOOST_CHECK_THROW( calibration.optimize( intrinsics, poses ), Ubitrack::Util::Exception );
+}
+
+
+void TestCameraLens()
+{
+	testBatchLensCorrection< double >( 10, 1e-6 );
+	testBatchLensCorrection< float >( 10, 1e-2f );
+	testWideAngleUndistortion< double >( 1e-8 );
+	testWideAngleUndistortion< float >( 1e-2f );
+	// the grid with a single refinement step is an approximation within a small fraction of a pixel
+	testUndistortionGrid< double >( 5, 1e-3 );
+	testUndistortionGrid< float >( 5, 1e-2f );
+	testDerivedIntrinsics< double >( 5, 1e-9 );
+	testDerivedIntrinsics< float >( 5, 1e-3f );
+	testCameraModel< double >( 5, 1e-6 );
+	testCameraModel< float >( 5, 1e-2f );
+	testIntrinsicCalibration< double >( 3 );
+	testIntrinsicCalibration< float >( 3 );
+}
@@ -68,6 +68,20 @@ void TestCorrelation()
 		delete v1;
 		delete v2;
 	}
+
+	{
+		// a smooth signal and a copy delayed by 12.5 samples
+		std::vector< double > left, right;
+		for ( int i = 0; i < 1000; i++ )
+		{
+			left.push_back( std::sin( 0.05 * i ) + 0.5 * std::sin( 0.013 * i * i / 100.0 ) );
+			right.push_back( std::sin( 0.05 * ( i - 12.5 ) ) + 0.5 * std::sin( 0.013 * ( i - 12.5 ) * ( i - 12.5 ) / 100.0 ) );
+		}
+		double correlation = 0;
+		BOOST_CHECK_SMALL( Ubitrack::Algorithm::estimateTimeOffset( left, right, 50, &correlation ) - 12.5, 0.05 );
+		BOOST_CHECK( correlation > 0.99 );
+		BOOST_CHECK_SMALL( Ubitrack::Algorithm::estimateTimeOffset( right, left, 50 ) + 12.5, 0.05 );
+	}
 }
 
 #endif // HAVE_LAPACK
@@ -0,0 +1,76 @@
+#include <utAlgorithm/DisplayProjection.h>
+#include <utAlgorithm/Projection.h>
+#include "../tools.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** largest difference to offAxisProjectionMatrix, relative to its largest element */
+double relativeError( const Matrix< double, 4, 4 >& m, Vector< double, 3 > eye, Vector< double, 3 > ll,
+	Vector< double, 3 > ul, Vector< double, 3 > lr, double n, double f, double sw, double sh )
+{
+	const Matrix< double, 4, 4 > reference( Algorithm::offAxisProjectionMatrix( eye, ll, ul, lr, n, f, sw, sh ) );
+	double error = 0, scale = 0;
+	for ( std::size_t i = 0; i < 4; i++ )
+		for ( std::size_t j = 0; j < 4; j++ )
+		{
+			error = std::max( error, std::fabs( m( i, j ) - reference( i, j ) ) );
+			scale = std::max( scale, std::fabs( reference( i, j ) ) );
+		}
+	return error / scale;
+}
+
+} // anonymous namespace
+
+
+void TestDisplayProjection()
+{
+	std::vector< Algorithm::DisplayProjection > screens;
+	std::vector< Vector< double, 3 > > corners;
+	for ( int iScreen = 0; iScreen < 5; iScreen++ )
+	{
+		// a rectangular screen with random position and orientation
+		Quaternion q( random( -1.0, 1.0 ), random( -1.0, 1.0 ), random( -1.0, 1.0 ), random( -1.0, 1.0 ) );
+		q.normalize();
+		const double sw = random( 0.5, 3.0 );
+		const double sh = random( 0.5, 3.0 );
+		const Vector< double, 3 > ll( randomVector< double, 3 >( 2.0 ) );
+		const Vector< double, 3 > lr( ll + q * Vector< double, 3 >( sw, 0, 0 ) );
+		const Vector< double, 3 > ul( ll + q * Vector< double, 3 >( 0, sh, 0 ) );
+		corners.push_back( ll );
+		corners.push_back( ul );
+		corners.push_back( lr );
+
+		const Algorithm::DisplayProjection screen( ll, ul, lr, 0.05, 50, sw, sh );
+		screens.push_back( Algorithm::DisplayProjection( ll, ul, lr, 0.05, 50 ) );
+		for ( int iEye = 0; iEye < 10; iEye++ )
+		{
+			// in front of the screen
+			const Vector< double, 3 > eye( ll + q * Vector< double, 3 >( random( -1.0, 4.0 ), random( -1.0, 4.0 ), random( 0.3, 3.0 ) ) );
+			BOOST_CHECK_SMALL( relativeError( screen.matrix( eye ), eye, ll, ul, lr, 0.05, 50, sw, sh ), 1e-10 );
+			BOOST_CHECK_SMALL( relativeError( screens.back().matrix( eye ), eye, ll, ul, lr, 0.05, 50, sw, sh ), 1e-10 );
+		}
+	}
+
+	// all screens for both eyes
+	const Vector< double, 3 > leftEye( -0.032, 1.7, 0.5 );
+	const Vector< double, 3 > rightEye( 0.032, 1.7, 0.5 );
+	std::vector< Matrix< double, 4, 4 > > matrices;
+	Algorithm::DisplayProjection::matrices( screens, leftEye, rightEye, matrices );
+	BOOST_CHECK_EQUAL( matrices.size(), 10u );
+	for ( std::size_t i = 0; i < screens.size(); i++ )
+	{
+		const Vector< double, 3 >& ll( corners[ 3 * i ] );
+		const Vector< double, 3 >& ul( corners[ 3 * i + 1 ] );
+		const Vector< double, 3 >& lr( corners[ 3 * i + 2 ] );
+		const double sw = boost::numeric::ublas::norm_2( lr - ll );
+		const double sh = boost::numeric::ublas::norm_2( ul - ll );
+		BOOST_CHECK_SMALL( relativeError( matrices[ 2 * i ], leftEye, ll, ul, lr, 0.05, 50, sw, sh ), 1e-10 );
+		BOOST_CHECK_SMALL( relativeError( matrices[ 2 * i + 1 ], rightEye, ll, ul, lr, 0.05, 50, sw, sh ), 1e-10 );
+	}
+}
@@ -7,6 +7,7 @@
 #include <boost/numeric/ublas/vector_proxy.hpp>
 
 #include <utAlgorithm/FundamentalMatrix.h>
+#include <utAlgorithm/FundamentalMatrixRansac.h>
 #include <utMath/MatrixOperations.h>
 #include "../tools.h"
 
@@ -14,6 +15,150 @@ using namespace Ubitrack;
 namespace ublas = boost::numeric::ublas;
 
 
+static void TestFundamentalMatrixRansac()
+{
+	for( int j=0; j<100; j++ )
+	{
+		// second camera looks at the points in front of the first camera from the side
+		const Math::Quaternion rot( randomVector< double, 3 >( 1.0 ), random( -0.3, 0.3 ) );
+		const Math::Vector< double, 3 > trans( random( 1.0, 2.0 ), random( -1.0, 1.0 ), random( -0.5, 0.5 ) );
+
+		std::vector< Math::Vector< double, 2 > > fromPoints;
+		std::vector< Math::Vector< double, 2 > > toPoints;
+		for( int i=0; i<60; i++ )
+		{
+			const Math::Vector< double, 3 > p( random( -2.0, 2.0 ), random( -2.0, 2.0 ), random( 4.0, 8.0 ) );
+			const Math::Vector< double, 3 > p2( rot * p + trans );
+			fromPoints.push_back( Math::Vector< double, 2 >( 500 * p( 0 ) / p( 2 ) + 320, 500 * p( 1 ) / p( 2 ) + 240 ) );
+			toPoints.push_back( Math::Vector< double, 2 >( 500 * p2( 0 ) / p2( 2 ) + 320, 500 * p2( 1 ) / p2( 2 ) + 240 ) );
+		}
+
+		// one of the solutions of the minimal problem fits all points
+		std::vector< Math::Matrix< double, 3, 3 > > solutions;
+		const std::size_t nSolutions = Algorithm::fundamentalMatrix7Point( fromPoints, toPoints, solutions );
+		BOOST_CHECK( nSolutions == 1 || nSolutions == 3 );
+		double minError = 1e10;
+		for ( std::size_t k = 0; k < nSolutions; k++ )
+		{
+			std::vector< double > distances;
+			Algorithm::fundamentalSampsonDistances( solutions[ k ], fromPoints, toPoints, distances );
+			minError = std::min( minError, *std::max_element( distances.begin(), distances.end() ) );
+		}
+		BOOST_CHECK_SMALL( minError, 1e-6 );
+
+		// every fifth correspondence is an outlier
+		std::vector< Math::Vector< double, 2 > > noisyPoints( toPoints );
+		for( std::size_t i = 0; i < noisyPoints.size(); i++ )
+		{
+			if ( i % 5 == 4 )
+				noisyPoints[ i ] = Math::Vector< double, 2 >( random( 0.0, 640.0 ), random( 0.0, 480.0 ) );
+			else
+				noisyPoints[ i ] = noisyPoints[ i ] + Math::Vector< double, 2 >( random( -0.2, 0.2 ), random( -0.2, 0.2 ) );
+		}
+
+		std::vector< bool > inliers;
+		Math::Matrix< double, 3, 3 > F;
+		const Math::Optimization::RansacParameter< double > params( 1.5, 8, noisyPoints.size(), 0.4, 0.999 );
+		const std::size_t nInlier = Algorithm::estimateFundamentalRansac( fromPoints, F, noisyPoints, params, &inliers );
+		BOOST_CHECK( nInlier >= 36 );
+
+		std::vector< double > distances;
+		Algorithm::fundamentalSampsonDistances( F, fromPoints, toPoints, distances );
+		std::size_t nCorrect = 0;
+		for( std::size_t i = 0; i < distances.size(); i++ )
+		{
+			nCorrect += inliers[ i ] == ( i % 5 != 4 );
+			BOOST_CHECK_SMALL( distances[ i ], 3.0 );
+		}
+		BOOST_CHECK( nCorrect >= 57 );
+	}
+}
+
+static void TestEssentialMatrix()
+{
+	Math::Matrix< double, 3, 3 > K = Math::Matrix< double, 3, 3 >::zeros();
+	K( 0, 0 ) = 500;
+	K( 0, 2 ) = -320;
+	K( 1, 1 ) = 500;
+	K( 1, 2 ) = -240;
+	K( 2, 2 ) = -1;
+
+	for( int j=0; j<100; j++ )
+	{
+		// the cameras look along the negative z axis
+		const Math::Quaternion rot( randomVector< double, 3 >( 1.0 ), random( -0.3, 0.3 ) );
+		const Math::Vector< double, 3 > trans( random( 1.0, 2.0 ), random( -1.0, 1.0 ), random( -0.5, 0.5 ) );
+
+		std::vector< Math::Vector< double, 2 > > fromPixels;
+		std::vector< Math::Vector< double, 2 > > toPixels;
+		std::vector< Math::Vector< double, 2 > > fromPoints;
+		std::vector< Math::Vector< double, 2 > > toPoints;
+		for( int i=0; i<60; i++ )
+		{
+			const Math::Vector< double, 3 > p( random( -2.0, 2.0 ), random( -2.0, 2.0 ), random( -8.0, -4.0 ) );
+			const Math::Vector< double, 3 > p2( rot * p + trans );
+			fromPixels.push_back( Math::Vector< double, 2 >( -500 * p( 0 ) / p( 2 ) + 320, -500 * p( 1 ) / p( 2 ) + 240 ) );
+			toPixels.push_back( Math::Vector< double, 2 >( -500 * p2( 0 ) / p2( 2 ) + 320, -500 * p2( 1 ) / p2( 2 ) + 240 ) );
+			fromPoints.push_back( Algorithm::normalizedImagePoint( K, fromPixels.back() ) );
+			toPoints.push_back( Algorithm::normalizedImagePoint( K, toPixels.back() ) );
+		}
+
+		// one of the solutions of the minimal problem fits all points
+		std::vector< Math::Matrix< double, 3, 3 > > solutions;
+		const std::size_t nSolutions = Algorithm::essentialMatrix5Point( fromPoints, toPoints, solutions );
+		BOOST_CHECK( nSolutions >= 1 && nSolutions <= 10 );
+		double minError = 1e10;
+		std::size_t bestSolution = 0;
+		for ( std::size_t k = 0; k < nSolutions; k++ )
+		{
+			std::vector< double > distances;
+			Algorithm::fundamentalSampsonDistances( solutions[ k ], fromPoints, toPoints, distances );
+			const double error = *std::max_element( distances.begin(), distances.end() );
+			if ( error < minError )
+			{
+				minError = error;
+				bestSolution = k;
+			}
+		}
+		BOOST_CHECK_SMALL( minError, 1e-8 );
+		if ( !nSolutions )
+			continue;
+
+		// the pose with the points in front of both cameras
+		std::size_t nInFront = 0;
+		const Math::Pose pose = Algorithm::poseFromEssentialMatrix( solutions[ bestSolution ], fromPixels, toPixels, K, K, &nInFront );
+		BOOST_CHECK_EQUAL( nInFront, 60u );
+		const Math::Vector< double, 3 > direction( trans / ublas::norm_2( trans ) );
+		BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - direction ), 1e-6 );
+		const Math::Vector< double, 3 > axis( 0.6, 0.0, 0.8 );
+		BOOST_CHECK_SMALL( ublas::norm_2( pose.rotation() * axis - rot * axis ), 1e-6 );
+
+		// every fifth correspondence is an outlier
+		std::vector< Math::Vector< double, 2 > > noisyPixels( toPixels );
+		for( std::size_t i = 0; i < noisyPixels.size(); i++ )
+		{
+			if ( i % 5 == 4 )
+				noisyPixels[ i ] = Math::Vector< double, 2 >( random( 0.0, 640.0 ), random( 0.0, 480.0 ) );
+			else
+				noisyPixels[ i ] = noisyPixels[ i ] + Math::Vector< double, 2 >( random( -0.2, 0.2 ), random( -0.2, 0.2 ) );
+		}
+
+		std::vector< bool > inliers;
+		Math::Matrix< double, 3, 3 > E;
+		const Math::Optimization::RansacParameter< double > params( 1.5, 6, noisyPixels.size(), 0.4, 0.999 );
+		const std::size_t nInlier = Algorithm::estimateEssentialRansac( fromPixels, E, noisyPixels, K, K, params, &inliers );
+		BOOST_CHECK( nInlier >= 36 );
+
+		std::size_t nCorrect = 0;
+		for( std::size_t i = 0; i < inliers.size(); i++ )
+			nCorrect += inliers[ i ] == ( i % 5 != 4 );
+		BOOST_CHECK( nCorrect >= 57 );
+
+		const Math::Pose ransacPose = Algorithm::poseFromEssentialMatrix( E, fromPixels, toPixels, K, K );
+		BOOST_CHECK_SMALL( ublas::norm_2( ransacPose.translation() - direction ), 0.1 );
+	}
+}
+
 void TestFundamentalMatrix()
 {
 	for( int j=0; j<100; j++ )
@@ -60,4 +205,7 @@ void TestFundamentalMatrix()
 
 		BOOST_CHECK_SMALL( homMatrixDiff( F, FTest ), 0.001 );
 	}
-}
\ No newline at end of file
+
+	TestFundamentalMatrixRansac();
+	TestEssentialMatrix();
+}
@@ -122,11 +122,66 @@ void testDualHandEyePoseRandom( const std::size_t n_runs, const T epsilon )
 	}
 }
 
+void testDualHandEyeAccumulator( const std::size_t n_runs )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -10., 10. );
+	
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 6, 30 ) );
+		const Pose pose( randQuat(), randVector() );
+
+		// relative motions a = x b x^-1 of eye and hand
+		std::vector< Pose > eyes;
+		std::vector< Pose > hands;
+		for( std::size_t i = 0; i<n; ++i )
+		{
+			hands.push_back( Pose( randQuat(), randVector() ) );
+			eyes.push_back( pose * hands.back() * ~pose );
+		}
+
+		Ubitrack::Algorithm::PoseEstimation6D6D::DualQuaternionAccumulator all;
+		Ubitrack::Algorithm::PoseEstimation6D6D::DualQuaternionAccumulator first;
+		Ubitrack::Algorithm::PoseEstimation6D6D::DualQuaternionAccumulator second;
+		for( std::size_t i = 0; i<n; ++i )
+		{
+			all.add( eyes[ i ], hands[ i ] );
+			( i < n / 2 ? first : second ).add( eyes[ i ], hands[ i ] );
+		}
+		BOOST_CHECK_EQUAL( all.size(), n );
+
+		Pose estimatedPose;
+		BOOST_CHECK( all.estimatePose( estimatedPose ) );
+		BOOST_CHECK_SMALL( quaternionDiff( estimatedPose.rotation(), pose.rotation() ), 1e-6 );
+		BOOST_CHECK_SMALL( vectorDiff( estimatedPose.translation(), pose.translation() ), 1e-6 );
+
+		// a subset by removing the other pairs gives the same equations as accumulating it
+		Ubitrack::Algorithm::PoseEstimation6D6D::DualQuaternionAccumulator subset( all );
+		subset -= first;
+		BOOST_CHECK_EQUAL( subset.size(), second.size() );
+		for( std::size_t r = 0; r < 8; ++r )
+			for( std::size_t c = r; c < 8; ++c )
+				BOOST_CHECK_SMALL( subset.normalMatrix()( r, c ) - second.normalMatrix()( r, c ), 1e-9 );
+
+		Pose subsetPose;
+		BOOST_CHECK( subset.estimatePose( subsetPose ) );
+		BOOST_CHECK_SMALL( quaternionDiff( subsetPose.rotation(), pose.rotation() ), 1e-6 );
+		BOOST_CHECK_SMALL( vectorDiff( subsetPose.translation(), pose.translation() ), 1e-6 );
+
+		// a single motion does not determine the pose
+		Ubitrack::Algorithm::PoseEstimation6D6D::DualQuaternionAccumulator single;
+		single.add( eyes[ 0 ], hands[ 0 ] );
+		BOOST_CHECK( !single.estimatePose( subsetPose ) );
+	}
+}
+
 void TestDualHandEye()
 {
 	// testDualHandEyeMatrixRandom< float >( 10, 1e-2f );
 	// testDualHandEyeMatrixRandom< double >( 10, 1e-6 );
 	testDualHandEyePoseRandom< double >( 100, 1e-6 );
+	testDualHandEyeAccumulator( 100 );
 }
 
 #endif // HAVE_LAPACK
@@ -81,7 +81,53 @@ void TestDataSelection( const std::size_t n_runs, const T epsilon )
 	BOOST_CHECK( 0 == 0 );
 }
 
+template< typename T >
+void TestRotationPairIndex( const std::size_t n_runs )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randVector( -10., 10. );
+	typename Random::Vector< T, 3 >::Normal randAxis( 0, 1 );
+	
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 100, 400 ) );
+		const T minAngle( Random::distribute_uniform< T >( 0.05, 2.0 ) );
+
+		// half of the runs with random rotations, half with a slow motion
+		std::vector< Pose > poses;
+		poses.reserve( n );
+		Quaternion q = randQuat();
+		for( std::size_t i = 0; i<n; ++i )
+		{
+			q = ( iRun % 2 ) ? Quaternion( Quaternion( randAxis(), 0.05 ) * q ) : randQuat();
+			poses.push_back( Pose( q, randVector() ) );
+		}
+
+		// compare with all pairs
+		std::vector< std::pair< std::size_t, std::size_t > > expected;
+		for( std::size_t i = 0; i<n; ++i )
+			for( std::size_t j = i+1; j<n; ++j )
+			{
+				const Quaternion d = ~poses[ j ].rotation() * poses[ i ].rotation();
+				if( 2 * std::acos( std::min( 1.0, std::fabs( d.w() ) ) ) >= minAngle )
+					expected.push_back( std::make_pair( i, j ) );
+			}
+
+		std::vector< std::pair< std::size_t, std::size_t > > pairs;
+		const Ubitrack::Algorithm::PoseEstimation6D6D::RotationPairIndex< T > index( poses.begin(), poses.end() );
+		index.distantPairs( minAngle, std::back_inserter( pairs ) );
+		std::sort( pairs.begin(), pairs.end() );
+
+		// pairs right at the threshold may differ by rounding
+		BOOST_CHECK_SMALL( double( pairs.size() ) - double( expected.size() ), 1.0 + 1e-3 * expected.size() );
+		std::vector< std::pair< std::size_t, std::size_t > > difference;
+		std::set_symmetric_difference( pairs.begin(), pairs.end(), expected.begin(), expected.end(), std::back_inserter( difference ) );
+		BOOST_CHECK( difference.size() <= 1 + expected.size() / 1000 );
+	}
+}
+
 void TestHandEyeDataSelection()
 {
 	TestDataSelection< double >( 10, 1e-6 );
+	TestRotationPairIndex< double >( 20 );
 }
@@ -0,0 +1,102 @@
+
+#include <utMath/Pose.h>
+#include <utMath/Vector.h>
+#include <utAlgorithm/OnlineHec.h>
+#include <utAlgorithm/PoseEstimation6D6D/TsaiLenz.h>
+
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include "../../tools.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+using namespace Ubitrack::Math;
+
+#ifndef HAVE_LAPACK
+void TestOnlineHandEye()
+{
+	// HandyEye does not work without lapack
+}
+#else // HAVE_LAPACK
+
+void testOnlineHandEyeRandom( const std::size_t n_runs, const double epsilon )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -10., 10. );
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 4, 30 ) );
+
+		// generate a random pose
+		const Quaternion q = randQuat();
+		const Vector< double, 3 > t = randVector();
+		const Pose pose( q, t );
+
+		std::vector< Pose > rightFrame;
+		std::vector< Pose > leftFrame;
+		Ubitrack::Algorithm::OnlineHec hec;
+		for( std::size_t i = 0; i<n; ++i )
+		{
+			const Pose p1( randQuat(), randVector() );
+			rightFrame.push_back( p1 );
+			leftFrame.push_back( ~(pose * p1) );
+			hec.addPoses( leftFrame.back(), rightFrame.back() );
+		}
+		BOOST_CHECK_EQUAL( hec.size(), n - 1 );
+
+		// same result as the batch solution on consecutive pairs
+		const Pose estimatedPose = hec.computeResult();
+		const Pose batchPose = Ubitrack::Algorithm::PoseEstimation6D6D::performHandEyeCalibration ( leftFrame, rightFrame, false );
+
+		const double rotDiff = quaternionDiff( estimatedPose.rotation(), q );
+		const double posDiff = vectorDiff( estimatedPose.translation(), t );
+		BOOST_CHECK_MESSAGE( rotDiff < epsilon, "\nEstimated rotation from " << n << " poses resulted in error " << rotDiff << " :\n" << q << " (expected)\n" << estimatedPose.rotation() << " (estimated)\n" );
+		BOOST_CHECK_MESSAGE( posDiff < epsilon, "\nEstimated position from " << n << " poses resulted in error " << posDiff << " :\n" << t << " (expected)\n" << estimatedPose.translation() << " (estimated)\n" );
+		BOOST_CHECK_SMALL( vectorDiff( estimatedPose.translation(), batchPose.translation() ), epsilon );
+	}
+}
+
+void testOnlineHandEyeSelection( const std::size_t n_runs, const double epsilon )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -10., 10. );
+	Random::Vector< double, 3 >::Normal randAxis( 0, 1 );
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		const Quaternion q = randQuat();
+		const Vector< double, 3 > t = randVector();
+		const Pose pose( q, t );
+
+		// a slow motion with small steps, which are only accepted when the rotation accumulates
+		Ubitrack::Algorithm::OnlineHec hec( 0.2, 0.1 );
+		Pose p1( randQuat(), randVector() );
+		const std::size_t n = 200;
+		for( std::size_t i = 0; i<n; ++i )
+		{
+			const Pose step( Quaternion( randAxis(), 0.05 ), randVector() * 0.01 );
+			p1 = step * p1;
+			hec.addPoses( ~(pose * p1), p1 );
+		}
+		BOOST_CHECK( hec.size() > 2 );
+		BOOST_CHECK( hec.size() < n / 4 );
+
+		const Pose estimatedPose = hec.computeResult();
+		const double rotDiff = quaternionDiff( estimatedPose.rotation(), q );
+		const double posDiff = vectorDiff( estimatedPose.translation(), t );
+		BOOST_CHECK_MESSAGE( rotDiff < epsilon, "\nEstimated rotation from " << hec.size() << " pairs resulted in error " << rotDiff << " :\n" << q << " (expected)\n" << estimatedPose.rotation() << " (estimated)\n" );
+		BOOST_CHECK_MESSAGE( posDiff < epsilon, "\nEstimated position from " << hec.size() << " pairs resulted in error " << posDiff << " :\n" << t << " (expected)\n" << estimatedPose.translation() << " (estimated)\n" );
+	}
+}
+
+void TestOnlineHandEye()
+{
+	testOnlineHandEyeRandom( 100, 1e-6 );
+	testOnlineHandEyeSelection( 20, 1e-6 );
+}
+
+#endif // HAVE_LAPACK
@@ -4,6 +4,7 @@
 #include <utMath/Matrix.h>
 #include <utMath/MatrixOperations.h>
 #include <utAlgorithm/PoseEstimation6D6D/TsaiLenz.h>
+#include <utMath/PoseListOperations.h>
 
 #include <utMath/Random/Scalar.h>
 #include <utMath/Random/Vector.h>
@@ -124,11 +125,59 @@ void testHandEyePoseRandom( const std::size_t n_runs, const T epsilon )
 	}
 }
 
+void testHandEyePoseNoisy( const std::size_t n_runs )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -10., 10. );
+	Random::Vector< double, 3 >::Normal randNoise( 0., 1e-3 );
+
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 10, 40 ) );
+		const Pose pose( randQuat(), randVector() );
+
+		std::vector< Pose > rightFrame;
+		std::vector< Pose > leftFrame;
+		std::vector< Matrix< double, 4, 4 > > rightMatrices;
+		std::vector< Matrix< double, 4, 4 > > leftMatrices;
+		for( std::size_t i = 0; i<n; ++i )
+		{
+			const Pose p1( randQuat(), randVector() );
+			const Pose p2( Quaternion::fromLogarithm( randNoise() ) * p1.rotation(), p1.translation() + randNoise() );
+			rightFrame.push_back( p1 );
+			leftFrame.push_back( ~( pose * p2 ) );
+			rightMatrices.push_back( Matrix< double, 4, 4 >( rightFrame.back() ) );
+			leftMatrices.push_back( Matrix< double, 4, 4 >( leftFrame.back() ) );
+		}
+
+		// the pose path solves the normal equations, the matrix path a QR decomposition of the same system
+		const Pose fromPoses = Ubitrack::Algorithm::PoseEstimation6D6D::performHandEyeCalibration( leftFrame, rightFrame, true );
+		const Pose fromMatrices = Ubitrack::Algorithm::PoseEstimation6D6D::performHandEyeCalibration( leftMatrices, rightMatrices, true );
+		BOOST_CHECK_SMALL( quaternionDiff( fromPoses.rotation(), fromMatrices.rotation() ), 1e-6 );
+		BOOST_CHECK_SMALL( vectorDiff( fromPoses.translation(), fromMatrices.translation() ), 1e-6 );
+		BOOST_CHECK_SMALL( quaternionDiff( fromPoses.rotation(), pose.rotation() ), 1e-2 );
+		BOOST_CHECK_SMALL( vectorDiff( fromPoses.translation(), pose.translation() ), 1e-1 );
+
+		// threads sum the same partial equations in the same order
+		const Pose threaded = Ubitrack::Algorithm::PoseEstimation6D6D::performHandEyeCalibration( leftFrame, rightFrame, true,
+			threadExecutor( 3, 2 ) );
+		BOOST_CHECK_EQUAL( quaternionDiff( threaded.rotation(), fromPoses.rotation() ), 0. );
+		BOOST_CHECK_EQUAL( vectorDiff( threaded.translation(), fromPoses.translation() ), 0. );
+
+		// consecutive pairs only
+		const Pose consecutive = Ubitrack::Algorithm::PoseEstimation6D6D::performHandEyeCalibration( leftFrame, rightFrame, false );
+		const Pose consecutiveMatrices = Ubitrack::Algorithm::PoseEstimation6D6D::performHandEyeCalibration( leftMatrices, rightMatrices, false );
+		BOOST_CHECK_SMALL( quaternionDiff( consecutive.rotation(), consecutiveMatrices.rotation() ), 1e-6 );
+		BOOST_CHECK_SMALL( vectorDiff( consecutive.translation(), consecutiveMatrices.translation() ), 1e-6 );
+	}
+}
+
 void TestTsaiLenzHandEye()
 {
 	testHandEyeMatrixRandom< float >( 100, 1e-2f );
 	testHandEyeMatrixRandom< double >( 100, 1e-6 );
 	testHandEyePoseRandom< double >( 100, 1e-6 );
+	testHandEyePoseNoisy( 20 );
 }
 
 #endif // HAVE_LAPACK
@@ -4,6 +4,7 @@
 #include <utMath/Random/Vector.h>
 #include <utMath/Random/Rotation.h>
 #include <utAlgorithm/Homography.h>
+#include <utAlgorithm/HomographyRansac.h>
 #include <utMath/Functors/MatrixFunctors.h>
 #include <utMath/Geometry/PointProjection.h>
 #include <utAlgorithm/PoseEstimation2D3D/PlanarPoseEstimation.h> // for PoseFromHomography
@@ -98,6 +99,10 @@ void TestHomographyDLT( const std::size_t n_runs, const T epsilon )
 		Matrix< T, 3, 3 > H = Ubitrack::Algorithm::homographyDLT( fromPoints, toPoints );
 
 		BOOST_CHECK_SMALL( homMatrixDiff( H, Htest ), epsilon );
+
+		// point clouds give the same result
+		const Matrix< T, 3, 3 > Hcloud = Ubitrack::Algorithm::homographyDLT( PointCloud< T, 2 >( fromPoints ), PointCloud< T, 2 >( toPoints ) );
+		BOOST_CHECK_SMALL( homMatrixDiff( Hcloud, H ), epsilon );
 	}
 }
 
@@ -158,11 +163,116 @@ void TestPoseFromHomography( const std::size_t n_runs, const T epsilon )
 	}
 }
 
+template < typename T >
+void TestHomography4Point( const std::size_t n_runs, const T epsilon )
+{
+	typename Random::Vector< T, 2 >::Uniform randVector( -100, 100 );
+
+	std::size_t nDegenerate = 0;
+	for ( std::size_t iTest = 0; iTest < n_runs; iTest++ )
+	{
+		Matrix< T, 3, 3 > Htest;
+		randomMatrix( Htest );
+
+		std::vector< Vector< T, 2 > > fromPoints;
+		std::generate_n ( std::back_inserter( fromPoints ), 4,  randVector );
+
+		std::vector< Vector< T, 2 > > toPoints( 4 );
+		for ( std::size_t i = 0; i < 4; ++i )
+		{
+			Vector< T, 3 > x( fromPoints[ i ]( 0 ), fromPoints[ i ]( 1 ), 1. );
+			Vector< T, 3 > xp = ublas::prod( Htest, x );
+			toPoints[ i ] = ublas::subrange( xp, 0, 2 ) / xp( 2 );
+		}
+
+		Matrix< T, 3, 3 > H;
+		if ( !Ubitrack::Algorithm::homography4Point( fromPoints, toPoints, H ) )
+		{
+			nDegenerate++;
+			continue;
+		}
+
+		// the four points are mapped exactly
+		std::vector< T > distances;
+		Ubitrack::Algorithm::homographySampsonDistances( H, fromPoints, toPoints, distances );
+		for ( std::size_t i = 0; i < 4; ++i )
+			BOOST_CHECK_SMALL( distances[ i ], epsilon * 100 );
+		BOOST_CHECK_SMALL( homMatrixDiff( H, Htest ), epsilon );
+	}
+	BOOST_CHECK( nDegenerate < n_runs / 10 );
+
+	// three collinear points are rejected
+	std::vector< Vector< T, 2 > > collinear( 4 );
+	collinear[ 0 ] = Vector< T, 2 >( 0, 0 );
+	collinear[ 1 ] = Vector< T, 2 >( 1, 1 );
+	collinear[ 2 ] = Vector< T, 2 >( 2, 2 );
+	collinear[ 3 ] = Vector< T, 2 >( 0, 1 );
+	Matrix< T, 3, 3 > H;
+	BOOST_CHECK( !Ubitrack::Algorithm::homography4Point( collinear, collinear, H ) );
+}
+
+template < typename T >
+void TestHomographyRansac( const std::size_t n_runs, const T epsilon )
+{
+	typename Random::Vector< T, 2 >::Uniform randVector( -100, 100 );
+	typename Random::Vector< T, 2 >::Normal randNoise( 0, 0.1 );
+
+	for ( std::size_t iTest = 0; iTest < n_runs; iTest++ )
+	{
+		// a random homography that keeps the points away from infinity
+		Matrix< T, 3, 3 > Htest( Matrix< T, 3, 3 >::identity() );
+		for ( std::size_t i = 0; i < 2; ++i )
+		{
+			for ( std::size_t j = 0; j < 2; ++j )
+				Htest( i, j ) += Random::distribute_uniform< T >( -0.3, 0.3 );
+			Htest( i, 2 ) = Random::distribute_uniform< T >( -20, 20 );
+			Htest( 2, i ) = Random::distribute_uniform< T >( -1e-3, 1e-3 );
+		}
+
+		const std::size_t n( Random::distribute_uniform< std::size_t >( 30, 100 ) );
+		std::vector< Vector< T, 2 > > fromPoints;
+		std::generate_n ( std::back_inserter( fromPoints ), n,  randVector );
+
+		// every fourth correspondence is an outlier
+		std::vector< Vector< T, 2 > > toPoints( n );
+		std::vector< Vector< T, 2 > > noisyPoints( n );
+		for ( std::size_t i = 0; i < n; ++i )
+		{
+			Vector< T, 3 > x( fromPoints[ i ]( 0 ), fromPoints[ i ]( 1 ), 1. );
+			Vector< T, 3 > xp = ublas::prod( Htest, x );
+			toPoints[ i ] = ublas::subrange( xp, 0, 2 ) / xp( 2 );
+			if ( i % 4 == 3 )
+				noisyPoints[ i ] = randVector();
+			else
+				noisyPoints[ i ] = toPoints[ i ] + randNoise();
+		}
+
+		std::vector< bool > inliers;
+		Matrix< T, 3, 3 > H;
+		const Ubitrack::Math::Optimization::RansacParameter< T > params( 1, 4, n, 0.4, 0.999 );
+		const std::size_t nInlier = Ubitrack::Algorithm::estimateHomographyRansac( fromPoints, H, noisyPoints, params, &inliers );
+		BOOST_CHECK( nInlier >= params.nMinInlier );
+		BOOST_CHECK_SMALL( homMatrixDiff( H, Htest ), epsilon );
+
+		std::vector< T > distances;
+		Ubitrack::Algorithm::homographySampsonDistances( H, fromPoints, toPoints, distances );
+		std::size_t nCorrect = 0;
+		for ( std::size_t i = 0; i < n; ++i )
+		{
+			nCorrect += inliers[ i ] == ( i % 4 != 3 );
+			BOOST_CHECK_SMALL( distances[ i ], T( 1 ) );
+		}
+		BOOST_CHECK( nCorrect >= n - 2 );
+	}
+}
+
 void TestHomography()
 {
 	TestHomographyDLTIdentity< double >( 1e-6 );
 	TestSquareHomography< double >( 1000, 1e-6 );
 	TestHomographyDLT< double >( 1000, 1e-6 );
+	TestHomography4Point< double >( 1000, 1e-6 );
+	TestHomographyRansac< double >( 100, 5e-2 );
 	// TestPoseFromHomography< double >( 1000, 1e-6 );
 	
 	TestHomographyDLTIdentity< float >( 1e-3f );
@@ -0,0 +1,90 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <utAlgorithm/PoseGraph.h>
+#include <utMath/Random/Vector.h>
+#include <utUtil/Exception.h>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+Pose randomIncrement( double translation, double rotation )
+{
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	return Pose( Quaternion::fromLogarithm( Vector< double, 3 >( rotation * randVector() ) ),
+		Vector< double, 3 >( translation * randVector() ) );
+}
+
+double poseDistance( const Pose& a, const Pose& b )
+{
+	return ublas::norm_2( a.translation() - b.translation() )
+		+ ublas::norm_2( Quaternion( ~a.rotation() * b.rotation() ).toLogarithm() );
+}
+
+} // anonymous namespace
+
+
+void TestPoseGraph()
+{
+	// a chain of trackers with loop closures
+	const std::size_t n = 300;
+	std::vector< Pose > truth( 1, Pose() );
+	for ( std::size_t i = 1; i < n; i++ )
+		truth.push_back( truth.back() * randomIncrement( 0.5, 0.3 ) );
+
+	Matrix< double, 6, 6 > covariance( Matrix< double, 6, 6 >::identity() * 1e-4 );
+	for ( std::size_t i = 3; i < 6; i++ )
+		covariance( i, i ) = 1e-5;
+
+	Algorithm::PoseGraph graph;
+	for ( std::size_t i = 0; i < n; i++ )
+		graph.addNode( i == 0 ? truth[ 0 ] : truth[ i ] * randomIncrement( 0.05, 0.05 ) );
+	for ( std::size_t i = 1; i < n; i++ )
+	{
+		graph.addEdge( i - 1, i, ErrorPose( ~truth[ i - 1 ] * truth[ i ], covariance ) );
+		if ( i >= 20 && i % 7 == 0 )
+			graph.addEdge( i, i - 20, ErrorPose( ~truth[ i ] * truth[ i - 20 ], covariance ) );
+	}
+	BOOST_CHECK( graph.cost() > 1 );
+
+	Algorithm::PoseGraph::Parameters params;
+	BOOST_CHECK_SMALL( graph.optimize( params ), 1e-8 );
+	BOOST_CHECK_EQUAL( graph.analyses(), 1u );
+	BOOST_CHECK( graph.iterations() < params.maxIterations );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( poseDistance( graph.pose( i ), truth[ i ] ), 1e-6 );
+
+	// a loop closure parallel to an existing one keeps the structure of the factor
+	graph.addEdge( 140, 120, ErrorPose( ~truth[ 140 ] * truth[ 120 ], covariance ) );
+	graph.optimize( params );
+	BOOST_CHECK_EQUAL( graph.analyses(), 1u );
+
+	// an outlier distorts the graph, unless it is ignored by a robust kernel
+	graph.addEdge( 50, 250, ErrorPose( ~truth[ 50 ] * truth[ 250 ] * randomIncrement( 2, 0.5 ), covariance ) );
+	Algorithm::PoseGraph distorted( graph );
+	distorted.optimize( params );
+	BOOST_CHECK( poseDistance( distorted.pose( 250 ), truth[ 250 ] ) > 1e-2 );
+
+	params.kernel = Algorithm::pgTukeyKernel;
+	params.kernelWidth = 5;
+	graph.optimize( params );
+	BOOST_CHECK_EQUAL( graph.analyses(), 2u );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( poseDistance( graph.pose( i ), truth[ i ] ), 1e-6 );
+
+	// without fixed nodes the first node defines the frame
+	Algorithm::PoseGraph pair;
+	pair.addNode( truth[ 0 ] );
+	pair.addNode( Pose() );
+	pair.addEdge( 0, 1, ErrorPose( ~truth[ 0 ] * truth[ 5 ], covariance ) );
+	pair.optimize();
+	BOOST_CHECK_SMALL( poseDistance( pair.pose( 1 ), truth[ 5 ] ), 1e-6 );
+	pair.setFixed( 1, true );
+	BOOST_CHECK( pair.isFixed( 1 ) );
+
+	BOOST_CHECK_THROW( pair.addEdge( 0, 0, ErrorPose( Pose(), covariance ) ), Ubitrack::Util::Exception );
+	BOOST_CHECK_THROW( pair.addEdge( 0, 1, ErrorPose( Pose(), Matrix< double, 6, 6 >::zeros() ) ), Ubitrack::Util::Exception );
+}
@@ -0,0 +1,220 @@
+#include <utMath/Matrix.h>
+#include <utMath/Vector.h>
+#include <utMath/Pose.h>
+#include <utMath/Random/Scalar.h>
+#include <utAlgorithm/Function/MultiplePointProjection.h>
+#include <utAlgorithm/Function/MultiplePointProjectionError.h>
+#include <utAlgorithm/Function/MultipleCameraProjection.h>
+#include <utAlgorithm/Function/MultipleCameraProjectionErrorART.h>
+#include <utAlgorithm/Function/SinglePointMultiProjection.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace Function = Ubitrack::Algorithm::Function;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/**
+ * largest difference of the jacobian to central differences of evaluate, relative to the largest entry.
+ * If \c quaternionBegin is given, the quaternion at this offset is only moved tangentially to the unit
+ * sphere, as the jacobian ignores the normalization of the rotation matrix.
+ */
+template< class F, class VT >
+double jacobianError( const F& f, const VT& input, const Matrix< double, 0, 0 >& J, const std::size_t quaternionBegin = 100 )
+{
+	const double h = 1e-6;
+	Vector< double > plus( f.size() );
+	Vector< double > minus( f.size() );
+	double maxError = 0;
+	double maxEntry = 0;
+	for ( std::size_t k = 0; k < input.size(); k++ )
+	{
+		// direction of the derivative
+		VT direction( input.size() );
+		for ( std::size_t l = 0; l < input.size(); l++ )
+			direction( l ) = l == k ? 1 : 0;
+		if ( k >= quaternionBegin && k < quaternionBegin + 4 )
+			for ( std::size_t l = quaternionBegin; l < quaternionBegin + 4; l++ )
+				direction( l ) -= input( k ) * input( l );
+
+		f.evaluate( plus, input + direction * h );
+		f.evaluate( minus, input - direction * h );
+		for ( std::size_t i = 0; i < f.size(); i++ )
+		{
+			double derivative = 0;
+			for ( std::size_t l = 0; l < input.size(); l++ )
+			{
+				derivative += J( i, l ) * direction( l );
+				maxEntry = std::max( maxEntry, std::fabs( J( i, l ) ) );
+			}
+			maxError = std::max( maxError, std::fabs( ( plus( i ) - minus( i ) ) / ( 2 * h ) - derivative ) );
+		}
+	}
+	return maxError / maxEntry;
+}
+
+/** checks that evaluateWithJacobian matches evaluate and jacobian, returns the jacobian */
+template< class F, class VT >
+Matrix< double, 0, 0 > checkFused( const F& f, const VT& input )
+{
+	Vector< double > result( f.size() );
+	Vector< double > fusedResult( f.size() );
+	Matrix< double, 0, 0 > J( f.size(), input.size() );
+	Matrix< double, 0, 0 > fusedJ( f.size(), input.size() );
+	f.evaluate( result, input );
+	f.jacobian( input, J );
+	f.evaluateWithJacobian( fusedResult, input, fusedJ );
+	for ( std::size_t i = 0; i < f.size(); i++ )
+	{
+		BOOST_CHECK_EQUAL( result( i ), fusedResult( i ) );
+		for ( std::size_t k = 0; k < input.size(); k++ )
+			BOOST_CHECK_EQUAL( J( i, k ), fusedJ( i, k ) );
+	}
+	return J;
+}
+
+/** the 7-vector (t, q) used as input by the projection functions */
+Vector< double, 7 > poseVector( const Pose& pose )
+{
+	Vector< double, 7 > v;
+	ublas::subrange( v, 0, 3 ) = pose.translation();
+	v( 3 ) = pose.rotation().x();
+	v( 4 ) = pose.rotation().y();
+	v( 5 ) = pose.rotation().z();
+	v( 6 ) = pose.rotation().w();
+	return v;
+}
+
+Vector< double, 3 > randomVector( const double range )
+{
+	return Vector< double, 3 >( Random::distribute_uniform< double >( -range, range ), Random::distribute_uniform< double >( -range, range ),
+		Random::distribute_uniform< double >( -range, range ) );
+}
+
+} // anonymous namespace
+
+
+void TestProjectionFunctions()
+{
+	Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::identity() );
+	cam( 0, 0 ) = 500;
+	cam( 1, 1 ) = 510;
+	cam( 0, 1 ) = 0.5;
+	cam( 0, 2 ) = 320;
+	cam( 1, 2 ) = 240;
+
+	std::vector< Vector< double, 3 > > p3D;
+	for ( std::size_t i = 0; i < 20; i++ )
+		p3D.push_back( randomVector( 1 ) );
+
+	Quaternion q( randomVector( 1 ), 1.0 );
+	q.normalize();
+	const Pose pose( q, Vector< double, 3 >( 0.1, -0.2, 6 ) );
+	const Vector< double, 7 > input( poseVector( pose ) );
+
+	// single camera projection against numerical differentiation
+	{
+		Function::MultiplePointProjection< double > f( p3D, cam );
+		BOOST_CHECK_SMALL( jacobianError( f, input, checkFused( f, input ), 3 ), 1e-6 );
+	}
+
+	// the error jacobian equals the derivative wrt. translation and small rotations applied before the pose
+	{
+		Function::MultiplePointProjectionError< double > f( p3D, cam );
+		Matrix< double, 0, 0 > J( f.size(), 6 );
+		f.jacobian( input, J );
+
+		Function::MultiplePointProjection< double > projection( p3D, cam );
+		Vector< double > plus( f.size() );
+		Vector< double > minus( f.size() );
+		const double h = 1e-6;
+		double maxError = 0;
+		for ( std::size_t k = 0; k < 6; k++ )
+		{
+			Vector< double, 3 > delta( 0, 0, 0 );
+			delta( k % 3 ) = h;
+			for ( int sign = -1; sign <= 1; sign += 2 )
+			{
+				const Pose error( k < 3 ? Quaternion() : Quaternion( delta( 0 ) * sign, delta( 1 ) * sign, delta( 2 ) * sign, 1 ).normalize(),
+					k < 3 ? Vector< double, 3 >( delta * double( sign ) ) : Vector< double, 3 >( 0, 0, 0 ) );
+				const Pose perturbed( pose.rotation() * error.rotation(), pose.translation() + error.translation() );
+				projection.evaluate( sign > 0 ? plus : minus, poseVector( perturbed ) );
+			}
+			for ( std::size_t i = 0; i < f.size(); i++ )
+				maxError = std::max( maxError, std::fabs( ( plus( i ) - minus( i ) ) / ( 2 * h ) - J( i, k ) ) );
+		}
+		BOOST_CHECK_SMALL( maxError, 1e-2 );
+	}
+
+	// multiple cameras with distortion
+	{
+		std::vector< Pose > camPoses;
+		std::vector< Matrix< double, 3, 3 > > camIntrinsics;
+		std::vector< Vector< double, 4 > > camDistortions;
+		std::vector< Matrix< double, 3, 4 > > cameras;
+		for ( std::size_t c = 0; c < 3; c++ )
+		{
+			camPoses.push_back( Pose( Quaternion( randomVector( 1 ), 0.1 ), randomVector( 0.2 ) ) );
+			camIntrinsics.push_back( cam );
+			camDistortions.push_back( Vector< double, 4 >( 0.1, -0.01, 0.001, -0.002 ) );
+			cameras.push_back( Matrix< double, 3, 4 >( ublas::prod( cam, Matrix< double, 3, 4 >( camPoses[ c ].rotation(), camPoses[ c ].translation() ) ) ) );
+		}
+		std::vector< std::pair< std::size_t, std::size_t > > visibilities;
+		std::vector< std::pair< unsigned, unsigned > > visibilitiesART;
+		for ( std::size_t i = 0; i < p3D.size(); i++ )
+			for ( std::size_t c = 0; c < 3; c++ )
+				if ( ( i + c ) % 3 != 0 )
+				{
+					visibilities.push_back( std::make_pair( i, c ) );
+					visibilitiesART.push_back( std::make_pair( unsigned( i ), unsigned( c ) ) );
+				}
+
+		Function::MultipleCameraProjection< double > f( p3D, camPoses, camIntrinsics, camDistortions, visibilities );
+		BOOST_CHECK_SMALL( jacobianError( f, input, checkFused( f, input ), 3 ), 1e-6 );
+
+		// without distortion the projection matches the camera matrices
+		const std::vector< Vector< double, 4 > > noDistortion( 3, Vector< double, 4 >( 0, 0, 0, 0 ) );
+		Function::MultipleCameraProjection< double > undistorted( p3D, camPoses, camIntrinsics, noDistortion, visibilities );
+		Vector< double > result( undistorted.size() );
+		undistorted.evaluate( result, input );
+		for ( std::size_t i = 0; i < visibilities.size(); i++ )
+		{
+			const Vector< double, 3 > x( ublas::prod( cameras[ visibilities[ i ].second ],
+				Vector< double, 4 >( ( pose * p3D[ visibilities[ i ].first ] )( 0 ), ( pose * p3D[ visibilities[ i ].first ] )( 1 ), ( pose * p3D[ visibilities[ i ].first ] )( 2 ), 1 ) ) );
+			BOOST_CHECK_CLOSE( result( 2 * i ), x( 0 ) / x( 2 ), 1e-6 );
+			BOOST_CHECK_CLOSE( result( 2 * i + 1 ), x( 1 ) / x( 2 ), 1e-6 );
+		}
+
+		// A.R.T. errors rotate around the center of gravity, the translation part is independent of it
+		Vector< double, 6 > inputART;
+		ublas::subrange( inputART, 0, 3 ) = pose.translation();
+		ublas::subrange( inputART, 3, 6 ) = pose.rotation().toLogarithm();
+		Function::MultipleCameraProjectionErrorART< double > art( p3D, cameras, visibilitiesART, Vector< double, 3 >( 0.1, 0.2, -0.1 ) );
+		Function::MultipleCameraProjectionErrorART< double > artOrigin( p3D, cameras, visibilitiesART );
+		Matrix< double, 0, 0 > J( art.size(), 6 );
+		Matrix< double, 0, 0 > JOrigin( art.size(), 6 );
+		art.jacobian( inputART, J );
+		artOrigin.jacobian( inputART, JOrigin );
+		for ( std::size_t i = 0; i < art.size(); i++ )
+			for ( std::size_t k = 0; k < 3; k++ )
+				BOOST_CHECK_CLOSE( J( i, k ), JOrigin( i, k ), 1e-9 );
+	}
+
+	// one point in several cameras
+	{
+		std::vector< Matrix< double, 3, 4 > > cameras;
+		for ( std::size_t c = 0; c < 4; c++ )
+		{
+			const Pose camPose( Quaternion( randomVector( 1 ), 0.2 ), Vector< double, 3 >( 0, 0, 5 ) + randomVector( 0.5 ) );
+			cameras.push_back( Matrix< double, 3, 4 >( ublas::prod( cam, Matrix< double, 3, 4 >( camPose.rotation(), camPose.translation() ) ) ) );
+		}
+		typedef std::vector< Matrix< double, 3, 4 > >::const_iterator Iterator;
+		Function::SinglePointMultiProjection< double, Iterator > f( cameras.begin(), cameras.end() );
+		const Vector< double, 3 > point( randomVector( 0.5 ) );
+		BOOST_CHECK_SMALL( jacobianError( f, point, checkFused( f, point ) ), 1e-6 );
+	}
+}
@@ -99,5 +99,31 @@ void TestDecomposeProjection()
 		BOOST_CHECK_SMALL( matrixDiff( r, rEst ), 1e-3f );
 		BOOST_CHECK_SMALL( vectorDiff( t, tEst ), 1e-3f );
 	}
+
+	// double precision, scaled projections with either sign, batched
+	std::vector< Matrix< double, 3, 4 > > projections;
+	std::vector< Matrix< double, 3, 3 > > ks, rs;
+	std::vector< Vector< double, 3 > > ts;
+	for ( int iTest = 0; iTest < 50; iTest++ )
+	{
+		Matrix< float, 3, 3 > k;
+		Matrix< float, 3, 3 > r;
+		Vector< float, 3 > t;
+		const Matrix< double, 3, 4 > p( randomProjection( k, r, t ) );
+		projections.push_back( p * random( 0.1, 10.0 ) * ( iTest % 2 ? -1.0 : 1.0 ) );
+		ks.push_back( k );
+		rs.push_back( r );
+		ts.push_back( t );
+	}
+	std::vector< Matrix< double, 3, 3 > > kEst, rEst;
+	std::vector< Vector< double, 3 > > tEst;
+	Ubitrack::Algorithm::decomposeProjections( kEst, rEst, tEst, projections );
+	BOOST_CHECK_EQUAL( kEst.size(), projections.size() );
+	for ( std::size_t i = 0; i < projections.size(); i++ )
+	{
+		BOOST_CHECK_SMALL( matrixDiff( ks[ i ], kEst[ i ] ), 1e-3 );
+		BOOST_CHECK_SMALL( matrixDiff( rs[ i ], rEst[ i ] ), 1e-5 );
+		BOOST_CHECK_SMALL( vectorDiff( ts[ i ], tEst[ i ] ), 1e-3 );
+	}
 }
 
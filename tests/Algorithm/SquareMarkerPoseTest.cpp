@@ -0,0 +1,131 @@
+#include <utAlgorithm/PoseEstimation2D3D/SquareMarkerPose.h>
+#include <utAlgorithm/PoseEstimation2D3D/PlanarPoseEstimation.h>
+#include <utAlgorithm/Homography.h>
+#include <utMath/Random/Scalar.h>
+#include <utUtil/Exception.h>
+#include "../tools.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+using namespace Ubitrack::Algorithm::PoseEstimation2D3D;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** the corners of a marker of the given size */
+Vector< double, 3 > markerCorner( std::size_t i, double size )
+{
+	const double x[ 4 ] = { -0.5, -0.5, 0.5, 0.5 };
+	const double y[ 4 ] = { 0.5, -0.5, -0.5, 0.5 };
+	return Vector< double, 3 >( x[ i ] * size, y[ i ] * size, 0 );
+}
+
+/** projects the corners of a marker, with gaussian noise */
+void projectMarker( const Matrix< double, 3, 3 >& cam, const Pose& pose, double size, double noise,
+	std::vector< Vector< double, 2 > >& corners )
+{
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		const Vector< double, 3 > p( ublas::prod( cam, pose * markerCorner( i, size ) ) );
+		corners.push_back( Vector< double, 2 >( p( 0 ) / p( 2 ) + Random::distribute_normal< double >( 0, noise ),
+			p( 1 ) / p( 2 ) + Random::distribute_normal< double >( 0, noise ) ) );
+	}
+}
+
+/** a marker in front of a camera looking along -z */
+Pose randomMarkerPose()
+{
+	// marker tilted by up to 57 degrees towards the camera
+	Vector< double, 3 > axis( Random::distribute_uniform< double >( -1, 1 ), Random::distribute_uniform< double >( -1, 1 ), 0 );
+	axis /= ublas::norm_2( axis );
+	const Quaternion q( Quaternion( axis, Random::distribute_uniform< double >( 0, 1.0 ) ) );
+	const Vector< double, 3 > t( Random::distribute_uniform< double >( -0.1, 0.1 ), Random::distribute_uniform< double >( -0.1, 0.1 ),
+		-Random::distribute_uniform< double >( 0.3, 1.5 ) );
+	return Pose( q, t );
+}
+
+} // anonymous namespace
+
+
+void TestSquareMarkerPose()
+{
+	// intrinsics in the ubitrack convention, K_33 = -1
+	Matrix< double, 3, 3 > cam( Matrix< double, 3, 3 >::zeros() );
+	cam( 0, 0 ) = 600;
+	cam( 1, 1 ) = 580;
+	cam( 0, 2 ) = -320;
+	cam( 1, 2 ) = -240;
+	cam( 2, 2 ) = -1;
+	const double size = 0.08;
+
+	const SquareMarkerPose estimator( cam, size );
+	const Matrix< double, 3, 3 > identity( ublas::prod( cam, estimator.inverseCamera() ) );
+	BOOST_CHECK_SMALL( matrixDiff( identity, Matrix< double, 3, 3 >::identity() ), 1e-12 );
+
+	// without noise the pose is exact, with and without the gauss-newton iterations
+	const SquareMarkerPose homographyOnly( CameraIntrinsics< double >( cam, Vector< double, 2 >::zeros(), Vector< double, 2 >::zeros() ), size, 0 );
+	for ( int iTest = 0; iTest < 50; iTest++ )
+	{
+		const Pose truth( randomMarkerPose() );
+		std::vector< Vector< double, 2 > > corners;
+		projectMarker( cam, truth, size, 0, corners );
+
+		Pose pose;
+		SquareMarkerResult result;
+		BOOST_CHECK( estimator.compute( corners, pose, &result ) );
+		BOOST_CHECK( result.valid );
+		BOOST_CHECK_SMALL( result.residual, 1e-6 );
+		BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - truth.translation() ), 1e-8 );
+		BOOST_CHECK_SMALL( 1 - std::fabs( Quaternion( ~pose.rotation() * truth.rotation() ).w() ), 1e-10 );
+
+		BOOST_CHECK( homographyOnly.compute( corners, pose ) );
+		BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - truth.translation() ), 1e-8 );
+	}
+
+	// with noise the iterations reduce the reprojection error below that of the homography pose,
+	// which is close to the pose of poseFromHomography
+	std::vector< Vector< double, 2 > > corners;
+	std::vector< Pose > truths;
+	for ( int iTest = 0; iTest < 200; iTest++ )
+	{
+		truths.push_back( randomMarkerPose() );
+		projectMarker( cam, truths.back(), size, 0.3, corners );
+	}
+	std::vector< Pose > poses, initialPoses;
+	std::vector< SquareMarkerResult > results, initialResults;
+	estimator.compute( corners, poses, results );
+	homographyOnly.compute( corners, initialPoses, initialResults );
+	BOOST_CHECK_EQUAL( poses.size(), truths.size() );
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+	{
+		BOOST_CHECK( results[ i ].valid );
+		BOOST_CHECK( results[ i ].residual <= initialResults[ i ].residual + 1e-9 );
+		BOOST_CHECK( results[ i ].residual < 1.0 );
+		BOOST_CHECK_SMALL( ublas::norm_2( poses[ i ].translation() - truths[ i ].translation() ), 0.05 * -truths[ i ].translation()( 2 ) );
+
+#ifdef HAVE_LAPACK
+		const std::vector< Vector< double, 2 > > marker( corners.begin() + 4 * i, corners.begin() + 4 * i + 4 );
+		Pose reference( poseFromHomography( Algorithm::squareHomography( marker ), estimator.inverseCamera() ) );
+		reference = Pose( reference.rotation(), reference.translation() * size );
+		BOOST_CHECK_SMALL( ublas::norm_2( initialPoses[ i ].translation() - reference.translation() ), 1e-6 );
+#endif
+	}
+
+	// the batch gives the same results in parallel
+	std::vector< Pose > parallelPoses;
+	std::vector< SquareMarkerResult > parallelResults;
+	estimator.compute( corners, parallelPoses, parallelResults, threadExecutor( 4, 16 ) );
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+		BOOST_CHECK_EQUAL( parallelResults[ i ].residual, results[ i ].residual );
+
+	// degenerate corners and markers behind the camera
+	std::vector< Vector< double, 2 > > collinear( 4, Vector< double, 2 >( 1, 2 ) );
+	collinear[ 1 ] = Vector< double, 2 >( 2, 3 );
+	collinear[ 2 ] = Vector< double, 2 >( 3, 4 );
+	Pose pose;
+	BOOST_CHECK( !estimator.compute( collinear, pose ) );
+	BOOST_CHECK_THROW( estimator.compute( std::vector< Vector< double, 2 > >( 3 ), pose ), Ubitrack::Util::Exception );
+}
@@ -70,11 +70,62 @@ void testTipCalibrationRandom( const std::size_t n_runs, const T epsilon )
 	}
 }
 
+template< typename T >
+void testTipCalibrationCovariance( const std::size_t n_runs )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Normal randNoise( 0, 1e-3 );
+	const Vector< T, 3 > tip( 0.1, -0.05, 0.2 );
+	const Vector< T, 3 > origin( 0.3, 0.2, -0.4 );
+
+	// the pivoting rotations stay fixed, only the noise of the translations changes
+	std::vector< Quaternion > rotations;
+	for ( std::size_t i = 0; i < 30; ++i )
+		rotations.push_back( randQuat() );
+
+	T predicted( 0 );
+	Vector< T, 3 > mean( 0, 0, 0 );
+	std::vector< Vector< T, 3 > > tips;
+	for ( std::size_t iRun = 0; iRun < n_runs; iRun++ )
+	{
+		std::vector< Pose > poses;
+		for ( std::size_t i = 0; i < rotations.size(); ++i )
+			poses.push_back( Pose( rotations[ i ], origin - rotations[ i ] * tip + randNoise() ) );
+
+		Vector< T, 3 > pm, pw, fusedPm, fusedPw;
+		std::pair< T, T > fusedError;
+		Matrix< T, 6, 6 > covariance;
+		BOOST_REQUIRE( Ubitrack::Algorithm::ToolTip::estimatePosition3D_6D( pw, poses, pm ) );
+		BOOST_REQUIRE( Ubitrack::Algorithm::ToolTip::estimatePosition3D_6D( fusedPw, poses, fusedPm, fusedError, covariance ) );
+
+		// same solution and error statistics as the separate passes
+		const std::pair< T, T > err = Ubitrack::Algorithm::ToolTip::estimatePosition3DError_6D( pw, poses, pm );
+		BOOST_CHECK_SMALL( vectorDiff( pm, fusedPm ), T( 1e-12 ) );
+		BOOST_CHECK_CLOSE( fusedError.first, err.first, T( 1e-8 ) );
+		BOOST_CHECK_CLOSE( fusedError.second, err.second, T( 1e-8 ) );
+
+		predicted += covariance( 0, 0 ) + covariance( 1, 1 ) + covariance( 2, 2 );
+		mean += pm;
+		tips.push_back( pm );
+	}
+
+	// the predicted variance of the tip agrees with the spread of the estimates
+	mean /= T( n_runs );
+	T empirical( 0 );
+	for ( std::size_t i = 0; i < tips.size(); i++ )
+		empirical += boost::numeric::ublas::inner_prod( tips[ i ] - mean, tips[ i ] - mean );
+	empirical /= T( n_runs - 1 );
+	predicted /= T( n_runs );
+	BOOST_CHECK_MESSAGE( empirical > 0.7 * predicted && empirical < 1.4 * predicted,
+		"\nTip variance " << empirical << " (empirical) " << predicted << " (predicted)" );
+}
+
 #ifdef HAVE_LAPACK
 
 void TestTipCalibration()
 {
 	testTipCalibrationRandom< double >( 10000, 1e-6 );
+	testTipCalibrationCovariance< double >( 300 );
 }
 
 #else // HAVE_LAPACK
@@ -0,0 +1,130 @@
+
+#include <utMath/Pose.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Optimization/RobustLoss.h>
+#include <utAlgorithm/ToolTip/TipCalibration.h>
+#include <utAlgorithm/ToolTip/ErrorEstimation.h>
+#include <utAlgorithm/ToolTip/IncrementalCalibration.h>
+
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include "../../tools.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+using namespace Ubitrack::Math;
+using Ubitrack::Algorithm::ToolTip::IncrementalTipCalibration;
+
+namespace {
+
+/** poses of a body pivoting about pw with the tip at pm in body coordinates */
+void makePivotPoses( const Vector< double, 3 >& pw, const Vector< double, 3 >& pm, const std::size_t n, const double noise,
+	std::vector< Pose >& poses )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Normal randNoise( 0, noise );
+	poses.clear();
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const Quaternion q( randQuat() );
+		poses.push_back( Pose( q, pw - q * pm + randNoise() ) );
+	}
+}
+
+void testIncrementalTipCalibration( const std::size_t nRuns )
+{
+	Random::Vector< double, 3 >::Uniform randVector( -.5, .5 );
+	for ( std::size_t iRun = 0; iRun < nRuns; iRun++ )
+	{
+		// the tracker origin is far from the pivot point
+		const Vector< double, 3 > pw( randVector() + Vector< double, 3 >( 100, -200, 50 ) );
+		const Vector< double, 3 > pm( randVector() );
+		const std::size_t n = 3 + iRun % 50;
+		std::vector< Pose > poses;
+		makePivotPoses( pw, pm, n, 1e-3, poses );
+
+		IncrementalTipCalibration< double > calibration( 20 );
+		for ( std::size_t i = 0; i < n; i++ )
+			calibration.add( poses[ i ] );
+		BOOST_CHECK_EQUAL( calibration.size(), n );
+		BOOST_CHECK_EQUAL( calibration.window().size(), std::min< std::size_t >( n, 20 ) );
+
+		Vector< double, 3 > estimatedPw, estimatedPm;
+		if ( !calibration.estimate( estimatedPw, estimatedPm ) )
+			continue;
+
+#ifdef HAVE_LAPACK
+		// same solution as the batch least-square
+		Vector< double, 3 > batchPw, batchPm;
+		if ( Ubitrack::Algorithm::ToolTip::estimatePosition3D_6D( batchPw, poses, batchPm ) )
+		{
+			BOOST_CHECK_SMALL( vectorDiff( estimatedPw, batchPw ), 1e-8 );
+			BOOST_CHECK_SMALL( vectorDiff( estimatedPm, batchPm ), 1e-8 );
+		}
+#endif
+
+		// the root mean square error from the sums equals the one of the poses
+		double sumSq = 0;
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Vector< double, 3 > d( poses[ i ] * estimatedPm - estimatedPw );
+			sumSq += d( 0 ) * d( 0 ) + d( 1 ) * d( 1 ) + d( 2 ) * d( 2 );
+		}
+		BOOST_CHECK_SMALL( calibration.rmsError( estimatedPw, estimatedPm ) - std::sqrt( sumSq / n ), 1e-7 );
+		BOOST_CHECK( calibration.rmsError( pw, pm ) < 5e-3 );
+
+		// window statistics equal the batch error of the last poses
+		const std::vector< Pose > last( poses.end() - calibration.window().size(), poses.end() );
+		const std::pair< double, double > expected = Ubitrack::Algorithm::ToolTip::estimatePosition3DError_6D( estimatedPw, last, estimatedPm );
+		const std::pair< double, double > windowErr = calibration.windowError( estimatedPw, estimatedPm );
+		BOOST_CHECK_SMALL( windowErr.first - expected.first, 1e-12 );
+		BOOST_CHECK_SMALL( windowErr.second - expected.second, 1e-12 );
+
+		if ( n > 20 )
+			BOOST_CHECK_SMALL( vectorDiff( estimatedPw, pw ), 1e-2 );
+	}
+}
+
+void testRobustTipCalibration()
+{
+	const Vector< double, 3 > pw( 0.3, -0.2, 1.5 );
+	const Vector< double, 3 > pm( 0.02, 0.01, -0.15 );
+	std::vector< Pose > poses;
+	makePivotPoses( pw, pm, 200, 1e-4, poses );
+
+	// every fifth pose slipped off the pivot
+	Random::Vector< double, 3 >::Uniform randOffset( -0.05, 0.05 );
+	for ( std::size_t i = 0; i < poses.size(); i += 5 )
+		poses[ i ] = Pose( poses[ i ].rotation(), poses[ i ].translation() + randOffset() );
+
+	IncrementalTipCalibration< double > calibration( 200 );
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+		calibration.add( poses[ i ] );
+
+	Vector< double, 3 > lsPw, lsPm, robustPw, robustPm;
+	BOOST_CHECK( calibration.estimate( lsPw, lsPm ) );
+	BOOST_CHECK( calibration.estimateRobust( robustPw, robustPm, Optimization::TukeyLoss( 0.005 ), 20 ) );
+	BOOST_CHECK_SMALL( vectorDiff( robustPw, pw ), 1e-3 );
+	BOOST_CHECK_SMALL( vectorDiff( robustPm, pm ), 1e-3 );
+	BOOST_CHECK( vectorDiff( robustPw, pw ) < vectorDiff( lsPw, pw ) );
+
+	// float results
+	IncrementalTipCalibration< float > calibrationf;
+	for ( std::size_t i = 1; i < poses.size(); i += 5 )
+		calibrationf.add( poses[ i ] );
+	Vector< float, 3 > pwf, pmf;
+	BOOST_CHECK( calibrationf.estimate( pwf, pmf ) );
+	BOOST_CHECK_SMALL( vectorDiff( pwf, Vector< float, 3 >( 0.3f, -0.2f, 1.5f ) ), 1e-3f );
+}
+
+} // anonymous namespace
+
+void TestIncrementalTipCalibration()
+{
+	testIncrementalTipCalibration( 1000 );
+	testRobustTipCalibration();
+}
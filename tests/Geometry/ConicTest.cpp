@@ -9,6 +9,8 @@
 #include <utMath/Geometry/ConicCovariance.h>
 
 #include <utMath/Geometry/QuadricFunctors.h>
+#include <utMath/Geometry/ConicBatch.h>
+#include <utMath/Geometry/EllipseFit.h>
 
 
 #include <algorithm> //std::transform
@@ -243,6 +245,179 @@ void testRandomQuadricProjection( const std::size_t n )
 }
 
 
+namespace {
+
+/** distance of two conics after normalization to unit length and the same sign */
+template< typename T >
+T conicDistance( const Ubitrack::Math::Vector< T, 6 >& c1, const Ubitrack::Math::Vector< T, 6 >& c2 )
+{
+	const Ubitrack::Math::Vector< T, 6 > n1( c1 / boost::numeric::ublas::norm_2( c1 ) );
+	const Ubitrack::Math::Vector< T, 6 > n2( c2 / boost::numeric::ublas::norm_2( c2 ) );
+	return std::min( boost::numeric::ublas::norm_2( n1 - n2 ), boost::numeric::ublas::norm_2( n1 + n2 ) );
+}
+
+/** the ellipse with the given center, semi-axes and angle of the first semi-axis */
+template< typename T >
+Ubitrack::Math::Vector< T, 6 > ellipseConic( const T cx, const T cy, const T axis1, const T axis2, const T angle )
+{
+	const T co = std::cos( angle );
+	const T si = std::sin( angle );
+	const T a = co * co / ( axis1 * axis1 ) + si * si / ( axis2 * axis2 );
+	const T b = 2 * co * si * ( 1 / ( axis1 * axis1 ) - 1 / ( axis2 * axis2 ) );
+	const T c = si * si / ( axis1 * axis1 ) + co * co / ( axis2 * axis2 );
+	Ubitrack::Math::Vector< T, 6 > conic;
+	conic( 0 ) = a;
+	conic( 1 ) = b;
+	conic( 2 ) = c;
+	conic( 3 ) = -2 * a * cx - b * cy;
+	conic( 4 ) = -2 * c * cy - b * cx;
+	conic( 5 ) = a * cx * cx + b * cx * cy + c * cy * cy - 1;
+	return conic;
+}
+
+} // anonymous namespace
+
+
+template< typename T >
+void testConicBatch( const std::size_t n, const T epsilon )
+{
+	// random ellipses, n is odd to exercise the remainder of the packs
+	std::vector< Ubitrack::Math::Vector< T, 6 > > conics;
+	for ( std::size_t i( 0 ); i < n; ++i )
+		conics.push_back( ellipseConic< T >( Random::distribute_uniform< T >( -100, 100 ), Random::distribute_uniform< T >( -100, 100 )
+			, Random::distribute_uniform< T >( 20, 40 ), Random::distribute_uniform< T >( 5, 15 ), Random::distribute_uniform< T >( -1.5, 1.5 ) ) );
+	std::vector< T > planar;
+	Geometry::vectors_to_planar( conics, planar );
+	BOOST_REQUIRE_EQUAL( planar.size(), 6 * n );
+
+	// inverse, in place
+	std::vector< T > inverse( planar );
+	Geometry::invert_conics_batch( n, &inverse[ 0 ], &inverse[ 0 ] );
+	std::vector< Ubitrack::Math::Vector< T, 6 > > inverseConics;
+	Geometry::planar_to_vectors( inverse, inverseConics );
+	BOOST_REQUIRE_EQUAL( inverseConics.size(), n );
+
+	std::vector< T > determinants( n );
+	Geometry::conic_determinants_batch( n, &planar[ 0 ], &determinants[ 0 ] );
+	std::vector< T > semiAxes( 2 * n );
+	Geometry::conic_semi_axes_batch( n, &planar[ 0 ], &semiAxes[ 0 ] );
+	std::vector< T > angles( n );
+	Geometry::conic_angles_batch( n, &planar[ 0 ], &angles[ 0 ] );
+
+	for ( std::size_t i( 0 ); i < n; ++i )
+	{
+		BOOST_CHECK_SMALL( conicDistance( inverseConics[ i ], Geometry::ConicInverse< T >()( conics[ i ] ) ), epsilon );
+		const T det = Geometry::ConicDeterminant< T >()( conics[ i ] );
+		BOOST_CHECK_SMALL( ( determinants[ i ] - det ) / det, epsilon );
+		const Ubitrack::Math::Vector< T, 2 > axes( Geometry::ConicSemiAxes< T >()( conics[ i ] ) );
+		BOOST_CHECK_SMALL( ( semiAxes[ i ] - axes( 0 ) ) / axes( 0 ), epsilon );
+		BOOST_CHECK_SMALL( ( semiAxes[ n + i ] - axes( 1 ) ) / axes( 1 ), epsilon );
+		BOOST_CHECK_SMALL( angles[ i ] - Geometry::ConicAngle< T >()( conics[ i ] ), epsilon );
+	}
+
+	// a camera looking at spheroids and ellipsoids around the origin from a distance of 10, in normalized image
+	// coordinates, as the determinants of the conics in pixel coordinates exceed the range of float
+	Quaternion rot( Quaternion::fromLogarithm( Ubitrack::Math::Vector< double, 3 >( Random::distribute_uniform< double >( -0.2, 0.2 )
+		, Random::distribute_uniform< double >( -0.2, 0.2 ), Random::distribute_uniform< double >( -3, 3 ) ) ) );
+	const Matrix< T, 3, 4 > projection( Pose( rot, Ubitrack::Math::Vector< double, 3 >( 0, 0, -10 ) ) );
+
+	std::vector< Ubitrack::Math::Vector< T, 4 > > spheroids;
+	std::vector< Ubitrack::Math::Vector< T, 6 > > ellipsoids;
+	for ( std::size_t i( 0 ); i < n; ++i )
+	{
+		spheroids.push_back( Ubitrack::Math::Vector< T, 4 >( Random::distribute_uniform< T >( 0.1, 0.5 ), Random::distribute_uniform< T >( 0.1, 0.5 )
+			, Random::distribute_uniform< T >( -2, 2 ), Random::distribute_uniform< T >( -2, 2 ) ) );
+		Ubitrack::Math::Vector< T, 6 > ellipsoid;
+		for ( std::size_t k( 0 ); k < 3; ++k )
+		{
+			ellipsoid( k ) = Random::distribute_uniform< T >( 0.1, 0.5 );
+			ellipsoid( 3 + k ) = Random::distribute_uniform< T >( -2, 2 );
+		}
+		ellipsoids.push_back( ellipsoid );
+	}
+	std::vector< Ubitrack::Math::Vector< T, 10 > > quadrics;
+	std::transform( ellipsoids.begin(), ellipsoids.end(), std::back_inserter( quadrics ), Geometry::Ellipsoid2Quadric< T >() );
+
+	std::vector< T > planarSpheroids, planarEllipsoids, planarQuadrics;
+	Geometry::vectors_to_planar( spheroids, planarSpheroids );
+	Geometry::vectors_to_planar( ellipsoids, planarEllipsoids );
+	Geometry::vectors_to_planar( quadrics, planarQuadrics );
+
+	std::vector< T > projected( 6 * n );
+	std::vector< Ubitrack::Math::Vector< T, 6 > > projectedConics;
+	Geometry::project_spheroids_batch( projection, n, &planarSpheroids[ 0 ], &projected[ 0 ] );
+	Geometry::planar_to_vectors( projected, projectedConics );
+	for ( std::size_t i( 0 ); i < n; ++i )
+		BOOST_CHECK_SMALL( conicDistance( projectedConics[ i ], Geometry::ProjectSpheroid< T >()( projection, spheroids[ i ] ) ), epsilon );
+
+	Geometry::project_ellipsoids_batch( projection, n, &planarEllipsoids[ 0 ], &projected[ 0 ] );
+	Geometry::planar_to_vectors( projected, projectedConics );
+	for ( std::size_t i( 0 ); i < n; ++i )
+		BOOST_CHECK_SMALL( conicDistance( projectedConics[ i ], Geometry::ProjectEllipsoid< T >()( projection, ellipsoids[ i ] ) ), epsilon );
+
+	// the quadric of an ellipsoid projects to the same conic
+	std::vector< T > projectedQuadrics( 6 * n );
+	Geometry::project_quadrics_batch( projection, n, &planarQuadrics[ 0 ], &projectedQuadrics[ 0 ] );
+	std::vector< Ubitrack::Math::Vector< T, 6 > > projectedQuadricConics;
+	Geometry::planar_to_vectors( projectedQuadrics, projectedQuadricConics );
+	for ( std::size_t i( 0 ); i < n; ++i )
+	{
+		BOOST_CHECK_SMALL( conicDistance( projectedQuadricConics[ i ], Geometry::ProjectQuadric< T >()( projection, quadrics[ i ] ) ), epsilon );
+		BOOST_CHECK_SMALL( conicDistance( projectedQuadricConics[ i ], projectedConics[ i ] ), epsilon );
+	}
+}
+
+
+template< typename T >
+void testEllipseFit( const std::size_t n, const T epsilon )
+{
+	for ( std::size_t run( 0 ); run < n; ++run )
+	{
+		const T cx = Random::distribute_uniform< T >( 100, 500 );
+		const T cy = Random::distribute_uniform< T >( 100, 400 );
+		const T axis1 = Random::distribute_uniform< T >( 40, 80 );
+		const T axis2 = Random::distribute_uniform< T >( 20, 40 );
+		const T angle = Random::distribute_uniform< T >( -1.5, 1.5 );
+		const Ubitrack::Math::Vector< T, 6 > truth( ellipseConic( cx, cy, axis1, axis2, angle ) );
+
+		// points on a part of the outline
+		std::vector< Ubitrack::Math::Vector< T, 2 > > points, noisyPoints;
+		for ( std::size_t i( 0 ); i < 60; ++i )
+		{
+			const T phi = static_cast< T >( 0.1 * i );
+			const T u = axis1 * std::cos( phi );
+			const T v = axis2 * std::sin( phi );
+			const Ubitrack::Math::Vector< T, 2 > p( cx + std::cos( angle ) * u - std::sin( angle ) * v, cy + std::sin( angle ) * u + std::cos( angle ) * v );
+			points.push_back( p );
+			noisyPoints.push_back( p + Ubitrack::Math::Vector< T, 2 >( Random::distribute_normal< T >( 0, 0.3 ), Random::distribute_normal< T >( 0, 0.3 ) ) );
+		}
+
+		Ubitrack::Math::Vector< T, 6 > conic;
+		BOOST_REQUIRE( Geometry::fitEllipse( points.begin(), points.end(), conic ) );
+		BOOST_CHECK_SMALL( conicDistance( conic, truth ), epsilon );
+		BOOST_CHECK_CLOSE( static_cast< T >( boost::numeric::ublas::norm_2( conic ) ), T( 1 ), T( 1e-3 ) );
+
+		// with noise the ellipse is close and the covariance is estimated
+		Matrix< T, 6, 6 > covariance;
+		BOOST_REQUIRE( Geometry::fitEllipse( noisyPoints.begin(), noisyPoints.end(), conic, covariance ) );
+		BOOST_CHECK( Geometry::IsConicEllipse< T >()( conic ) );
+		const Ubitrack::Math::Vector< T, 2 > center( Geometry::ConicCenter< T >()( conic ) );
+		BOOST_CHECK_SMALL( center( 0 ) - cx, T( 1 ) );
+		BOOST_CHECK_SMALL( center( 1 ) - cy, T( 1 ) );
+		const Ubitrack::Math::Vector< T, 2 > axes( Geometry::ConicSemiAxes< T >()( conic ) );
+		BOOST_CHECK_SMALL( std::max( axes( 0 ), axes( 1 ) ) - axis1, T( 1 ) );
+		BOOST_CHECK_SMALL( std::min( axes( 0 ), axes( 1 ) ) - axis2, T( 1 ) );
+		for ( std::size_t k( 0 ); k < 6; ++k )
+			BOOST_CHECK( covariance( k, k ) == covariance( k, k ) );
+	}
+
+	// not enough points
+	std::vector< Ubitrack::Math::Vector< T, 2 > > points( 4, Ubitrack::Math::Vector< T, 2 >( 1, 2 ) );
+	Ubitrack::Math::Vector< T, 6 > conic;
+	BOOST_CHECK( !Geometry::fitEllipse( points.begin(), points.end(), conic ) );
+}
+
+
 void TestConic()
 {
 	// float is usually not sufficient here
@@ -250,6 +425,10 @@ void TestConic()
 	testBasicConicFunctors< double >( 10000 );
 	testRandomQuadricProjection< float >( 10000 );
 	testRandomQuadricProjection< double >( 10000 );
+	testConicBatch< float >( 1001, 1e-3f );
+	testConicBatch< double >( 1001, 1e-9 );
+	testEllipseFit< float >( 20, 1e-4f );
+	testEllipseFit< double >( 20, 1e-9 );
 }
 
 
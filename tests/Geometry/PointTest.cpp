@@ -6,6 +6,8 @@
 
 #include <utMath/Geometry/PointProjection.h>
 #include <utMath/Geometry/PointTransformation.h>
+#include <utMath/Geometry/PointBatch.h>
+#include <utMath/Geometry/PointNormalization.h>
 
 #include "../tools.h"
 #include <boost/test/unit_test.hpp>
@@ -191,12 +193,152 @@ void testBasicPointProjection( const std::size_t n )
 	BOOST_CHECK_SMALL( 0.01, 0.02 );
 }
 
+// compares the batch kernels to the single point functors
+template< typename T >
+void testBatchPoints( const std::size_t n_max, const T epsilon )
+{
+	typename Random::Quaternion< T >::Uniform randQuat;
+	typename Random::Vector< T, 3 >::Uniform randTranslation( -10, 10 );
+	typename Random::Vector< T, 3 >::Uniform randPoints3D( -5, 5 );
+
+	// every number of points up to n_max to test the remainders of all pack sizes
+	for ( std::size_t n = 1; n <= n_max; n++ )
+	{
+		Quaternion rot( randQuat( ) );
+		Vector< T, 3 > trans ( randTranslation() );
+		trans( 2 ) += 20; // keep the points in front of the camera
+		Matrix< T, 4, 4 > mat4x4( rot, trans );
+		Matrix< T, 3, 4 > mat3x4( rot, trans );
+		Matrix< T, 3, 3 > mat3x3( rot );
+		mat3x3( 2, 2 ) += 20;
+
+		std::vector< T > x( n ), y( n ), z( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Vector< T, 3 > p( randPoints3D() );
+			x[ i ] = p( 0 ); y[ i ] = p( 1 ); z[ i ] = p( 2 );
+		}
+
+		std::vector< T > out1( n ), out2( n ), out3( n ), out4( n );
+
+		Geometry::project_points_batch( mat3x4, n, &x[ 0 ] , &y[ 0 ], &z[ 0 ], &out1[ 0 ], &out2[ 0 ] );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Vector< T, 2 > p = Geometry::ProjectPoint()( mat3x4, Vector< T, 3 >( x[ i ], y[ i ], z[ i ] ) );
+			BOOST_CHECK_SMALL( p( 0 ) - out1[ i ], epsilon );
+			BOOST_CHECK_SMALL( p( 1 ) - out2[ i ], epsilon );
+		}
+
+		Geometry::project_points_batch( mat3x3, n, &x[ 0 ] , &y[ 0 ], &out1[ 0 ], &out2[ 0 ] );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Vector< T, 2 > p = Geometry::ProjectPoint()( mat3x3, Vector< T, 2 >( x[ i ], y[ i ] ) );
+			BOOST_CHECK_SMALL( p( 0 ) - out1[ i ], epsilon );
+			BOOST_CHECK_SMALL( p( 1 ) - out2[ i ], epsilon );
+		}
+
+		Geometry::transform_points_batch( mat3x4, n, &x[ 0 ] , &y[ 0 ], &z[ 0 ], &out1[ 0 ], &out2[ 0 ], &out3[ 0 ] );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Vector< T, 3 > p = Geometry::TransformPoint()( mat3x4, Vector< T, 3 >( x[ i ], y[ i ], z[ i ] ) );
+			BOOST_CHECK_SMALL( p( 0 ) - out1[ i ], epsilon );
+			BOOST_CHECK_SMALL( p( 1 ) - out2[ i ], epsilon );
+			BOOST_CHECK_SMALL( p( 2 ) - out3[ i ], epsilon );
+		}
+
+		Geometry::transform_points_batch( mat4x4, n, &x[ 0 ] , &y[ 0 ], &z[ 0 ], &out1[ 0 ], &out2[ 0 ], &out3[ 0 ], &out4[ 0 ] );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			const Vector< T, 4 > p = Geometry::TransformPoint()( mat4x4, Vector< T, 3 >( x[ i ], y[ i ], z[ i ] ) );
+			BOOST_CHECK_SMALL( p( 0 ) - out1[ i ], epsilon );
+			BOOST_CHECK_SMALL( p( 1 ) - out2[ i ], epsilon );
+			BOOST_CHECK_SMALL( p( 2 ) - out3[ i ], epsilon );
+			BOOST_CHECK_SMALL( p( 3 ) - out4[ i ], epsilon );
+		}
+
+		// in-place transformation
+		Geometry::transform_points_batch( mat3x4, n, &x[ 0 ] , &y[ 0 ], &z[ 0 ], &out1[ 0 ], &out2[ 0 ], &out3[ 0 ] );
+		Geometry::transform_points_batch( mat3x4, n, &x[ 0 ] , &y[ 0 ], &z[ 0 ], &x[ 0 ] , &y[ 0 ], &z[ 0 ] );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			BOOST_CHECK_EQUAL( x[ i ], out1[ i ] );
+			BOOST_CHECK_EQUAL( y[ i ], out2[ i ] );
+			BOOST_CHECK_EQUAL( z[ i ], out3[ i ] );
+		}
+	}
+}
+
+// compares the normalization parameters to a two-pass computation in double
+template< typename T >
+void testPointNormalization( const std::size_t n_max, const T epsilon )
+{
+	// points far from the origin, where the mean of squares cancels
+	typename Random::Vector< T, 3 >::Uniform randPoints3D( -5, 5 );
+	const Vector< T, 3 > offset( 1000, -2000, 500 );
+
+	// every number of points up to n_max to test the remainders of all pack sizes, and a large number of points
+	for ( std::size_t n = 1; n <= n_max + 1; n++ )
+	{
+		const std::size_t nPoints = n <= n_max ? n : 5000;
+		std::vector< Vector< T, 3 > > points;
+		std::vector< T > x( nPoints ), y( nPoints ), z( nPoints );
+		for ( std::size_t i = 0; i < nPoints; i++ )
+		{
+			points.push_back( randPoints3D() + offset );
+			x[ i ] = points[ i ]( 0 ); y[ i ] = points[ i ]( 1 ); z[ i ] = points[ i ]( 2 );
+		}
+
+		Vector< double, 3 > mean( Vector< double, 3 >::zeros() );
+		for ( std::size_t i = 0; i < nPoints; i++ )
+			for ( std::size_t k = 0; k < 3; k++ )
+				mean( k ) += points[ i ]( k );
+		mean /= nPoints;
+		Vector< double, 3 > deviation( Vector< double, 3 >::zeros() );
+		for ( std::size_t i = 0; i < nPoints; i++ )
+			for ( std::size_t k = 0; k < 3; k++ )
+				deviation( k ) += ( points[ i ]( k ) - mean( k ) ) * ( points[ i ]( k ) - mean( k ) );
+		for ( std::size_t k = 0; k < 3; k++ )
+			deviation( k ) = std::sqrt( deviation( k ) / nPoints );
+
+		Vector< T, 3 > shift, scale;
+		Geometry::estimateNormalizationParameters( points.begin(), points.end(), shift, scale );
+		Vector< T, 3 > batchShift, batchScale;
+		Geometry::estimate_normalization_batch( nPoints, &x[ 0 ], &y[ 0 ], &z[ 0 ], batchShift, batchScale );
+		Vector< T, 2 > batchShift2, batchScale2;
+		Geometry::estimate_normalization_batch( nPoints, &x[ 0 ], &y[ 0 ], batchShift2, batchScale2 );
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			BOOST_CHECK_SMALL( static_cast< T >( shift( k ) - mean( k ) ), epsilon * 1000 );
+			BOOST_CHECK_SMALL( static_cast< T >( scale( k ) - deviation( k ) ), epsilon );
+			BOOST_CHECK_SMALL( batchShift( k ) - shift( k ), epsilon * 1000 );
+			BOOST_CHECK_SMALL( batchScale( k ) - scale( k ), epsilon );
+		}
+		BOOST_CHECK_EQUAL( batchShift2( 0 ), batchShift( 0 ) );
+		BOOST_CHECK_EQUAL( batchScale2( 1 ), batchScale( 1 ) );
+
+		// in-place normalization gives zero mean and unit deviation
+		if ( nPoints < 2 )
+			continue;
+		Geometry::normalize_points_batch( nPoints, batchShift, batchScale, &x[ 0 ], &y[ 0 ], &z[ 0 ], &x[ 0 ], &y[ 0 ], &z[ 0 ] );
+		Geometry::estimate_normalization_batch( nPoints, &x[ 0 ], &y[ 0 ], &z[ 0 ], shift, scale );
+		for ( std::size_t k = 0; k < 3; k++ )
+		{
+			BOOST_CHECK_SMALL( shift( k ), epsilon );
+			BOOST_CHECK_SMALL( scale( k ) - 1, epsilon );
+		}
+	}
+}
+
 void TestPoints()
 {
 	testBasicPointTransformations< float >( 10000 );
 	testBasicPointTransformations< double >( 10000 );
 	testBasicPointProjection< float >( 10000 );
 	testBasicPointProjection< double >( 10000 );
+	testBatchPoints< float >( 20, 1e-4f );
+	testBatchPoints< double >( 20, 1e-10 );
+	testPointNormalization< float >( 20, 1e-3f );
+	testPointNormalization< double >( 20, 1e-10 );
 }
 
 
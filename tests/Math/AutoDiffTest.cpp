@@ -0,0 +1,148 @@
+#include <utMath/Optimization/NewFunction/Function.h>
+#include <utMath/Optimization/NewFunction/AutoDiffFunction.h>
+#include <utMath/Optimization/NewFunction/Dehomogenization.h>
+#include <utMath/Optimization/NewFunction/LieRotation.h>
+#include <utAlgorithm/NewFunction/CameraIntrinsicsMultiplication.h>
+#include <utMath/Random/Vector.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+namespace NF = Ubitrack::Math::Optimization::Function;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/// Rodrigues' formula on an arbitrary scalar type, same convention as Quaternion::fromLogarithm
+template< class DestinationVector, class Param1, class Param2 >
+void rotateLie( DestinationVector& result, const Param1& r, const Param2& p )
+{
+	typedef typename DestinationVector::value_type T;
+	const T cross[ 3 ] = { r( 1 ) * p( 2 ) - r( 2 ) * p( 1 ), r( 2 ) * p( 0 ) - r( 0 ) * p( 2 ), r( 0 ) * p( 1 ) - r( 1 ) * p( 0 ) };
+	const T theta2 = r( 0 ) * r( 0 ) + r( 1 ) * r( 1 ) + r( 2 ) * r( 2 );
+	if ( theta2 < 1e-12 )
+	{
+		// first order approximation, the jacobian is exact at zero
+		for ( std::size_t i = 0; i < 3; i++ )
+			result( i ) = p( i ) + cross[ i ];
+		return;
+	}
+
+	const T theta = sqrt( theta2 );
+	const T a = sin( theta ) / theta;
+	const T b = ( 1 - cos( theta ) ) / theta2;
+	const T cross2[ 3 ] = { r( 1 ) * cross[ 2 ] - r( 2 ) * cross[ 1 ], r( 2 ) * cross[ 0 ] - r( 0 ) * cross[ 2 ], r( 0 ) * cross[ 1 ] - r( 1 ) * cross[ 0 ] };
+	for ( std::size_t i = 0; i < 3; i++ )
+		result( i ) = p( i ) + a * cross[ i ] + b * cross2[ i ];
+}
+
+struct AutoLieRotation
+	: public NF::AutoDiffFunction< AutoLieRotation, 3, 3, 3 >
+{
+	template< class DestinationVector, class Param1, class Param2 >
+	void evaluate( DestinationVector& result, const Param1& rotation, const Param2& point ) const
+	{ rotateLie( result, rotation, point ); }
+};
+
+struct AutoDehomogenization
+	: public NF::AutoDiffFunction< AutoDehomogenization, 2, 3 >
+{
+	template< class DestinationVector, class Param1 >
+	void evaluate( DestinationVector& result, const Param1& input ) const
+	{
+		result( 0 ) = input( 0 ) / input( 2 );
+		result( 1 ) = input( 1 ) / input( 2 );
+	}
+};
+
+struct AutoIntrinsics
+	: public NF::AutoDiffFunction< AutoIntrinsics, 2, 5, 2 >
+{
+	template< class DestinationVector, class Param1, class Param2 >
+	void evaluate( DestinationVector& result, const Param1& intr, const Param2& point ) const
+	{
+		result( 0 ) = -( intr( 0 ) * point( 0 ) + intr( 1 ) * point( 1 ) + intr( 2 ) );
+		result( 1 ) = -( intr( 3 ) * point( 1 ) + intr( 4 ) );
+	}
+};
+
+/// the whole projection in a single node, the point is never optimized
+struct AutoProjection
+	: public NF::AutoDiffFunction< AutoProjection, 2, 5, 3, 0 >
+{
+	template< class DestinationVector, class Param1, class Param2, class Param3 >
+	void evaluate( DestinationVector& result, const Param1& intr, const Param2& rotation, const Param3& point ) const
+	{
+		typedef typename DestinationVector::value_type T;
+		Math::Vector< T, 3 > p;
+		rotateLie( p, rotation, point );
+		const T x = p( 0 ) / p( 2 );
+		const T y = p( 1 ) / p( 2 );
+		result( 0 ) = -( intr( 0 ) * x + intr( 1 ) * y + intr( 2 ) );
+		result( 1 ) = -( intr( 3 ) * y + intr( 4 ) );
+	}
+};
+
+template< class F >
+void checkAgainst( const F& f, const Vector< double, 8 >& params, const Vector< double, 2 >& value, const Matrix< double, 2, 8 >& jacobian )
+{
+	Vector< double, 2 > v;
+	Matrix< double, 2, 8 > j;
+	f.evaluateWithJacobian( params, v, j );
+	BOOST_CHECK_SMALL( vectorDiffSum( v, value ), 1e-10 );
+	for ( std::size_t r = 0; r < 2; r++ )
+		for ( std::size_t c = 0; c < 8; c++ )
+			BOOST_CHECK_SMALL( j( r, c ) - jacobian( r, c ), 1e-8 );
+}
+
+} // anonymous namespace
+
+
+void TestAutoDiff()
+{
+	// derivatives of elementary operations
+	typedef NF::Dual< 2 > D;
+	const D x( 0.7, 0 );
+	const D y( -1.3, 1 );
+	const D f( sin( x ) * y + sqrt( x * x + y * y ) / exp( y ) - 2.0 / x + atan2( y, x ) );
+	const double n = std::sqrt( 0.7 * 0.7 + 1.3 * 1.3 );
+	const double e = std::exp( -1.3 );
+	BOOST_CHECK_CLOSE( f.value(), std::sin( 0.7 ) * -1.3 + n / e - 2.0 / 0.7 + std::atan2( -1.3, 0.7 ), 1e-12 );
+	BOOST_CHECK_CLOSE( f.derivative( 0 ), std::cos( 0.7 ) * -1.3 + 0.7 / n / e + 2.0 / ( 0.7 * 0.7 ) + 1.3 / ( n * n ), 1e-10 );
+	BOOST_CHECK_CLOSE( f.derivative( 1 ), std::sin( 0.7 ) + ( -1.3 / n - n ) / e + 0.7 / ( n * n ), 1e-10 );
+	BOOST_CHECK( x < y == false );
+	BOOST_CHECK( fabs( y ).derivative( 1 ) == -1 );
+
+	// composed functions with hand-written and automatic jacobians agree
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	for ( unsigned iTest = 0; iTest < 10; iTest++ )
+	{
+		Vector< double, 3 > point( randVector() );
+		point( 2 ) += 5;
+		Vector< double, 8 > params;
+		params( 0 ) = 500; params( 1 ) = 0.5; params( 2 ) = -320; params( 3 ) = 510; params( 4 ) = -240;
+		ublas::subrange( params, 5, 8 ) = iTest ? randVector() * 0.5 : Vector< double, 3 >( 0, 0, 0 );
+
+		const Vector< double, 3 > rotated( Quaternion::fromLogarithm( ublas::subrange( params, 5, 8 ) ) * point );
+		const Vector< double, 2 > expected( -( 500 * rotated( 0 ) / rotated( 2 ) + 0.5 * rotated( 1 ) / rotated( 2 ) - 320 ), -( 510 * rotated( 1 ) / rotated( 2 ) - 240 ) );
+
+		Vector< double, 2 > value;
+		Matrix< double, 2, 8 > jacobian;
+		( Algorithm::Function::CameraIntrinsicsMultiplication() << NF::parameter< 5 >( 0 ) <<
+			( NF::Dehomogenization< 3 >() <<
+				( NF::LieRotation() << NF::parameter< 3 >( 5 ) << NF::fixedParameterRef< 3 >( point ) ) ) )
+			.evaluateWithJacobian( params, value, jacobian );
+		BOOST_CHECK_SMALL( vectorDiffSum( value, expected ), 1e-8 );
+
+		checkAgainst( AutoIntrinsics() << NF::parameter< 5 >( 0 ) <<
+			( AutoDehomogenization() <<
+				( AutoLieRotation() << NF::parameter< 3 >( 5 ) << NF::fixedParameterRef< 3 >( point ) ) ),
+			params, value, jacobian );
+
+		checkAgainst( AutoProjection() << NF::parameter< 5 >( 0 ) << NF::parameter< 3 >( 5 ) << NF::fixedParameterRef< 3 >( point ),
+			params, value, jacobian );
+	}
+}
@@ -0,0 +1,131 @@
+#include <utMath/Optimization/Function/DiscreteJacobianApproximation.h>
+#include <utMath/Random/Vector.h>
+#include <utUtil/Exception.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+using namespace Ubitrack::Math::Optimization;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** chain of coupled quadratic terms, result i depends on parameters i and i + 1 only */
+struct ChainFunction
+{
+	std::size_t n;
+
+	ChainFunction( const std::size_t _n )
+		: n( _n )
+	{}
+
+	unsigned size() const
+	{ return static_cast< unsigned >( n - 1 ); }
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		for ( std::size_t i = 0; i + 1 < n; i++ )
+			result( i ) = input( i ) * input( i ) * input( i + 1 ) + std::sin( input( i + 1 ) );
+	}
+
+	template< class VT2, class MT >
+	void analyticJacobian( const VT2& input, MT& J ) const
+	{
+		J = ublas::zero_matrix< double >( n - 1, n );
+		for ( std::size_t i = 0; i + 1 < n; i++ )
+		{
+			J( i, i ) = 2 * input( i ) * input( i + 1 );
+			J( i, i + 1 ) = input( i ) * input( i ) + std::cos( input( i + 1 ) );
+		}
+	}
+};
+
+/** banded pattern of the chain */
+std::vector< std::vector< std::size_t > > chainPattern( const std::size_t n )
+{
+	std::vector< std::vector< std::size_t > > p( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		if ( i > 0 )
+			p[ i ].push_back( i - 1 );
+		if ( i + 1 < n )
+			p[ i ].push_back( i );
+	}
+	return p;
+}
+
+double maxDiff( const Matrix< double >& a, const Matrix< double >& b )
+{
+	double d = 0;
+	for ( std::size_t i = 0; i < a.size1(); i++ )
+		for ( std::size_t j = 0; j < a.size2(); j++ )
+			d = std::max( d, std::fabs( a( i, j ) - b( i, j ) ) );
+	return d;
+}
+
+} // anonymous namespace
+
+
+void TestDiscreteJacobian()
+{
+	typedef Function::DiscreteJacobianApproximation< ChainFunction > Approximation;
+	const std::size_t n = 40;
+	const ChainFunction f( n );
+
+	Vector< double > x( n );
+	Random::Vector< double, 1 >::Uniform randValue( -2, 2 );
+	for ( std::size_t i = 0; i < n; i++ )
+		x( i ) = randValue()( 0 );
+	x( 3 ) = 0;
+
+	Matrix< double > reference( n - 1, n );
+	f.analyticJacobian( x, reference );
+
+	// default behaviour: forward differences with relative steps
+	Approximation forward( f, 1e-6 );
+	Matrix< double > jForward( n - 1, n );
+	Vector< double > result( n - 1 );
+	forward.evaluateWithJacobian( result, x, jForward );
+	BOOST_CHECK_SMALL( maxDiff( jForward, reference ), 1e-4 );
+	BOOST_CHECK_EQUAL( forward.evaluationsPerJacobian( n ), n );
+
+	Vector< double > direct( n - 1 );
+	f.evaluate( direct, x );
+	BOOST_CHECK_SMALL( vectorDiffSum( result, direct ), 1e-15 );
+
+	// central differences are more accurate
+	Approximation central( f, 1e-4 );
+	central.setScheme( Approximation::centralDifference );
+	central.setStepPolicy( Approximation::scaledStep );
+	Matrix< double > jCentral( n - 1, n );
+	central.jacobian( x, jCentral );
+	BOOST_CHECK_SMALL( maxDiff( jCentral, reference ), 1e-7 );
+	BOOST_CHECK_EQUAL( central.evaluationsPerJacobian( n ), 2 * n );
+
+	// parallel evaluation gives exactly the sequential result
+	Approximation parallel( central );
+	parallel.setExecutor( threadExecutor( 4, 3 ) );
+	Matrix< double > jParallel( n - 1, n );
+	parallel.jacobian( x, jParallel );
+	BOOST_CHECK_EQUAL( maxDiff( jParallel, jCentral ), 0.0 );
+
+	// the banded pattern needs only a few groups of parameters
+	Approximation colored( central );
+	colored.setSparsity( chainPattern( n ) );
+	BOOST_CHECK_EQUAL( colored.evaluationsPerJacobian( n ), 2u * 2u );
+	Matrix< double > jColored( n - 1, n );
+	colored.jacobian( x, jColored );
+	BOOST_CHECK_EQUAL( maxDiff( jColored, jCentral ), 0.0 );
+
+	colored.setExecutor( threadExecutor( 2, 1 ) );
+	colored.jacobian( x, jColored );
+	BOOST_CHECK_EQUAL( maxDiff( jColored, jCentral ), 0.0 );
+
+	// the pattern must match the parameters
+	Vector< double > shorter( n - 1 );
+	Matrix< double > jShorter( n - 2, n - 1 );
+	BOOST_CHECK_THROW( colored.jacobian( shorter, jShorter ), Ubitrack::Util::Exception );
+}
@@ -0,0 +1,142 @@
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Optimization/Dogleg.h>
+#include <utMath/Optimization/LevenbergMarquardt.h>
+#include <utMath/Random/Scalar.h>
+
+#include <math.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** rosenbrock function as least squares problem, r = ( 10 ( y - x^2 ), 1 - x ), counting the evaluations */
+class Rosenbrock
+{
+public:
+	Rosenbrock()
+		: nEvaluations( 0 )
+		, nJacobians( 0 )
+	{}
+
+	std::size_t size() const
+	{ return 2; }
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input )
+	{
+		nEvaluations++;
+		result( 0 ) = 10 * ( input( 1 ) - input( 0 ) * input( 0 ) );
+		result( 1 ) = 1 - input( 0 );
+	}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J )
+	{
+		evaluate( result, input );
+		nJacobians++;
+		J( 0, 0 ) = -20 * input( 0 );
+		J( 0, 1 ) = 10;
+		J( 1, 0 ) = -1;
+		J( 1, 1 ) = 0;
+	}
+
+	std::size_t nEvaluations;
+	std::size_t nJacobians;
+};
+
+/** fits the curve y = a * exp( b * x ) + c to a set of samples */
+class ExponentialCurve
+{
+public:
+	ExponentialCurve( const std::vector< double >& x )
+		: m_x( x )
+	{}
+
+	std::size_t size() const
+	{ return m_x.size(); }
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		for ( std::size_t i = 0; i < m_x.size(); i++ )
+			result( i ) = input( 0 ) * exp( input( 1 ) * m_x[ i ] ) + input( 2 );
+	}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		for ( std::size_t i = 0; i < m_x.size(); i++ )
+		{
+			const double e = exp( input( 1 ) * m_x[ i ] );
+			result( i ) = input( 0 ) * e + input( 2 );
+			J( i, 0 ) = e;
+			J( i, 1 ) = input( 0 ) * m_x[ i ] * e;
+			J( i, 2 ) = 1;
+		}
+	}
+
+protected:
+	const std::vector< double >& m_x;
+};
+
+} // anonymous namespace
+
+
+void TestDogleg()
+{
+	// rosenbrock, starting at the classic point ( -1.2, 1 )
+	{
+		Rosenbrock problem;
+		Vector< double > params( 2 );
+		params( 0 ) = -1.2; params( 1 ) = 1;
+		Vector< double > zero( 2 );
+		zero.clear();
+
+		const double res = Optimization::dogleg( problem, params, zero, Optimization::OptTerminate( 200, 1e-12 ), Optimization::OptNoNormalize() );
+		BOOST_CHECK_SMALL( res, 1e-12 );
+		BOOST_CHECK_SMALL( params( 0 ) - 1, 1e-6 );
+		BOOST_CHECK_SMALL( params( 1 ) - 1, 1e-6 );
+
+		// jacobians are only evaluated for accepted steps
+		BOOST_CHECK( problem.nJacobians < problem.nEvaluations );
+
+		// same minimum as levenberg-marquardt, with fewer jacobians
+		Rosenbrock lmProblem;
+		Vector< double > lmParams( 2 );
+		lmParams( 0 ) = -1.2; lmParams( 1 ) = 1;
+		Optimization::levenbergMarquardt( lmProblem, lmParams, zero, Optimization::OptTerminate( 200, 1e-12 ), Optimization::OptNoNormalize() );
+		BOOST_CHECK_SMALL( lmParams( 0 ) - params( 0 ), 1e-6 );
+		BOOST_CHECK( problem.nJacobians < lmProblem.nJacobians );
+	}
+
+	// curve fitting gives the same result as levenberg-marquardt
+	for ( std::size_t run = 0; run < 10; run++ )
+	{
+		const std::size_t n = 30;
+		Vector< double, 3 > truth( Random::distribute_uniform< double >( 1, 2 ), Random::distribute_uniform< double >( 0.5, 1.5 ), Random::distribute_uniform< double >( -1, 1 ) );
+		std::vector< double > x( n );
+		Vector< double > y( n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			x[ i ] = 2.0 * i / n;
+			y( i ) = truth( 0 ) * exp( truth( 1 ) * x[ i ] ) + truth( 2 ) + Random::distribute_normal< double >( 0, 1e-3 );
+		}
+		ExponentialCurve curve( x );
+
+		Vector< double > params( 3 );
+		params( 0 ) = 1; params( 1 ) = 0; params( 2 ) = 0;
+		Vector< double > lmParams( params );
+
+		const double res = Optimization::dogleg( curve, params, y, Optimization::OptTerminate( 100, 1e-12 ), Optimization::OptNoNormalize() );
+		const double lmRes = Optimization::levenbergMarquardt( curve, lmParams, y, Optimization::OptTerminate( 100, 1e-12 ), Optimization::OptNoNormalize() );
+
+		BOOST_CHECK_SMALL( res - lmRes, 1e-8 );
+		for ( std::size_t i = 0; i < 3; i++ )
+			BOOST_CHECK_SMALL( params( i ) - lmParams( i ), 1e-5 );
+	}
+}
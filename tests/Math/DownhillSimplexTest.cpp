@@ -0,0 +1,115 @@
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/PoseListOperations.h>
+#include <utMath/Optimization/DownhillSimplex.h>
+
+#include <math.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** fits y = a * exp( b * x ) + c to samples of the curve */
+class ExponentialCurve
+{
+public:
+	ExponentialCurve( const std::vector< double >& x )
+		: m_x( x )
+	{}
+
+	std::size_t size() const
+	{ return m_x.size(); }
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		for ( std::size_t i = 0; i < m_x.size(); i++ )
+			result( i ) = input( 0 ) * exp( input( 1 ) * m_x[ i ] ) + input( 2 );
+	}
+
+	std::vector< double > m_x;
+};
+
+/** f( x ) = ( x^2 - 1 )^2 + 0.3 ( x - 1 )^2 with a local minimum near -1 and the global minimum at 1 */
+class DoubleWell
+{
+public:
+	std::size_t size() const
+	{ return 2; }
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input ) const
+	{
+		result( 0 ) = input( 0 ) * input( 0 ) - 1;
+		result( 1 ) = sqrt( 0.3 ) * ( input( 0 ) - 1 );
+	}
+};
+
+} // anonymous namespace
+
+
+void TestDownhillSimplex()
+{
+	std::vector< double > x;
+	for ( std::size_t i = 0; i < 20; i++ )
+		x.push_back( 0.1 * i );
+	const Vector< double, 3 > truth( 2.0, -0.5, 1.0 );
+	Vector< double > y( x.size() );
+	ExponentialCurve curve( x );
+	curve.evaluate( y, truth );
+
+	// sequential version finds the minimum
+	Vector< double > params( 3 );
+	params( 0 ) = 1.0; params( 1 ) = -1.0; params( 2 ) = 0.5;
+	Vector< double > parallel( params );
+	Vector< double > threaded( params );
+	const double res = Optimization::downhillSimplex( curve, params, y, 
+		Optimization::OptTerminate( 5000, 1e-12 ), Optimization::OptNoNormalize() );
+	BOOST_CHECK_SMALL( res, 1e-4 );
+	BOOST_CHECK_SMALL( ublas::norm_2( params - truth ), 1e-3 );
+
+	// the parallel version takes the same steps, with and without threads
+	const double resParallel = Optimization::parallelDownhillSimplex( curve, parallel, y, 
+		Optimization::OptTerminate( 5000, 1e-12 ), ListExecutor() );
+	const double resThreaded = Optimization::parallelDownhillSimplex( curve, threaded, y, 
+		Optimization::OptTerminate( 5000, 1e-12 ), threadExecutor( 4, 1 ) );
+	BOOST_CHECK_CLOSE( resParallel, res, 1e-6 );
+	BOOST_CHECK_SMALL( ublas::norm_2( parallel - params ), 1e-9 );
+	BOOST_CHECK_EQUAL( resThreaded, resParallel );
+	BOOST_CHECK_SMALL( ublas::norm_2( threaded - parallel ), 1e-12 );
+
+	// multiple starts find both minima and return the global one
+	DoubleWell well;
+	Vector< double > goal( 2 );
+	goal.clear();
+	std::vector< Vector< double > > starts;
+	const double startPoints[] = { -2.0, -0.8, 0.5, 2.0 };
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		starts.push_back( Vector< double >( 1 ) );
+		starts.back()( 0 ) = startPoints[ i ];
+	}
+	std::vector< Vector< double > > threadedStarts( starts );
+
+	std::vector< double > residuals;
+	std::vector< double > threadedResiduals;
+	const std::size_t best = Optimization::multiStartDownhillSimplex( well, starts, goal, 
+		Optimization::OptTerminate( 1000, 1e-12 ), residuals );
+	const std::size_t threadedBest = Optimization::multiStartDownhillSimplex( well, threadedStarts, goal, 
+		Optimization::OptTerminate( 1000, 1e-12 ), threadedResiduals, threadExecutor( 4, 1 ) );
+	BOOST_REQUIRE_EQUAL( residuals.size(), 4u );
+	BOOST_CHECK_SMALL( starts[ 0 ]( 0 ) + 1.0, 0.2 );
+	BOOST_CHECK_SMALL( starts[ best ]( 0 ) - 1.0, 1e-4 );
+	BOOST_CHECK_SMALL( residuals[ best ], 1e-4 );
+	BOOST_CHECK_EQUAL( threadedBest, best );
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		BOOST_CHECK( residuals[ best ] <= residuals[ i ] );
+		BOOST_CHECK_EQUAL( threadedResiduals[ i ], residuals[ i ] );
+	}
+}
@@ -0,0 +1,84 @@
+#include <utMath/ErrorPose.h>
+#include <utMath/ErrorVector.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** random positive definite covariance */
+Matrix< double, 6, 6 > randomCovariance()
+{
+	Matrix< double, 6, 6 > a;
+	randomMatrix( a );
+	Matrix< double, 6, 6 > c( ublas::prod( a, ublas::trans( a ) ) );
+	return Matrix< double, 6, 6 >( 1e-4 * c );
+}
+
+ErrorPose randomErrorPose()
+{
+	return ErrorPose( randomQuaternion(), randomVector< double, 3 >( 5.0 ), randomCovariance() );
+}
+
+template< class MT1, class MT2 >
+double maxDifference( const MT1& a, const MT2& b )
+{
+	double d = 0;
+	for ( std::size_t i = 0; i < a.size1(); i++ )
+		for ( std::size_t j = 0; j < a.size2(); j++ )
+			d = std::max( d, std::fabs( a( i, j ) - b( i, j ) ) / ( 1 + std::fabs( a( i, j ) ) ) );
+	return d;
+}
+
+template< class MT >
+bool isSymmetric( const MT& m )
+{
+	for ( std::size_t i = 0; i < m.size1(); i++ )
+		for ( std::size_t j = 0; j < i; j++ )
+			if ( m( i, j ) != m( j, i ) )
+				return false;
+	return true;
+}
+
+} // anonymous namespace
+
+
+void TestErrorPose()
+{
+	for ( std::size_t iTest = 0; iTest < 100; iTest++ )
+	{
+		const ErrorPose a( randomErrorPose() );
+		const ErrorPose b( randomErrorPose() );
+		const Pose poseA( a );
+		const Pose poseB( b );
+
+		// the errors of both poses are independent
+		const ErrorPose product( a * b );
+		BOOST_CHECK( isSymmetric( product.covariance() ) );
+		const Matrix< double, 6, 6 > sum( ( a * poseB ).covariance() + ( poseA * b ).covariance() );
+		BOOST_CHECK_SMALL( maxDifference( product.covariance(), sum ), 1e-12 );
+		BOOST_CHECK( isSymmetric( invertMultiply( a, b ).covariance() ) );
+
+		// a certain rotation only rotates the covariance: [ R P R^T, R Q ; Q^T R^T, S ]
+		Matrix< double, 6, 6 > rotation( ublas::identity_matrix< double >( 6 ) );
+		Matrix< double, 3, 3 > r;
+		a.rotation().toMatrix( r );
+		ublas::subrange( rotation, 0, 3, 0, 3 ) = r;
+		Matrix< double, 6, 6 > tmp( ublas::prod( rotation, b.covariance() ) );
+		Matrix< double, 6, 6 > rotated( ublas::prod( tmp, ublas::trans( rotation ) ) );
+		const ErrorPose rotatedB( Pose( a.rotation(), Vector< double, 3 >( 0, 0, 0 ) ) * b );
+		BOOST_CHECK_SMALL( maxDifference( rotatedB.covariance(), rotated ), 1e-12 );
+
+		// transforming a point equals the translation part of the pose product
+		const Vector< double, 3 > x( randomVector< double, 3 >( 5.0 ) );
+		const ErrorVector< double, 3 > transformed( a * x );
+		BOOST_CHECK( isSymmetric( transformed.covariance ) );
+		const ErrorPose translated( a * Pose( Quaternion(), x ) );
+		BOOST_CHECK_SMALL( maxDifference( transformed.covariance, ublas::subrange( translated.covariance(), 0, 3, 0, 3 ) ), 1e-12 );
+		BOOST_CHECK_SMALL( ublas::norm_2( transformed.value - translated.translation() ), 1e-12 );
+	}
+}
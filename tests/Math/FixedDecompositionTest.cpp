@@ -0,0 +1,151 @@
+#include <utMath/FixedDecomposition.h>
+#include <utMath/Blas3.h>
+#include <utMath/Random/Scalar.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+template< typename T, std::size_t M, std::size_t N >
+T orthogonalityError( const Matrix< T, M, N >& q )
+{
+	return matrixDiff( Matrix< T, N, N >( ublas::prod( ublas::trans( q ), q ) ), Matrix< T, N, N >::identity() );
+}
+
+template< typename T, std::size_t M, std::size_t N >
+void testSvd( const T epsilon )
+{
+	for ( std::size_t n = 0; n < 100; n++ )
+	{
+		Matrix< T, M, N > a;
+		randomMatrix( a );
+		a *= T( 0.01 );
+
+		// every fourth matrix is rank deficient
+		if ( n % 4 == 0 )
+			ublas::column( a, N - 1 ) = ublas::column( a, 0 ) * T( 2 );
+
+		Vector< T, N > s;
+		Matrix< T, M, M > u;
+		Matrix< T, N, N > vt;
+		BOOST_CHECK( svd( a, s, u, vt ) );
+
+		Matrix< T, M, N > sigma( Matrix< T, M, N >::zeros() );
+		for ( std::size_t i = 0; i < N; i++ )
+		{
+			sigma( i, i ) = s( i );
+			if ( i > 0 )
+				BOOST_CHECK( s( i - 1 ) >= s( i ) );
+		}
+		const Matrix< T, M, N > us( ublas::prod( u, sigma ) );
+		BOOST_CHECK_SMALL( matrixDiff( Matrix< T, M, N >( ublas::prod( us, vt ) ), a ), epsilon );
+		BOOST_CHECK_SMALL( orthogonalityError( u ), epsilon );
+		BOOST_CHECK_SMALL( orthogonalityError( vt ), epsilon );
+		if ( n % 4 == 0 )
+			BOOST_CHECK_SMALL( s( N - 1 ), epsilon );
+	}
+}
+
+template< typename T, std::size_t N >
+void testSymmetric( const T epsilon )
+{
+	for ( std::size_t n = 0; n < 100; n++ )
+	{
+		Matrix< T, N, N > b;
+		randomMatrix( b );
+		b *= T( 0.01 );
+		const Matrix< T, N, N > a( ublas::prod( ublas::trans( b ), b ) );
+
+		// eigen decomposition, only the upper triangle is used
+		Matrix< T, N, N > v( a );
+		for ( std::size_t i = 1; i < N; i++ )
+			v( i, 0 ) = T( 1000 );
+		Vector< T, N > w;
+		BOOST_CHECK( symmetricEigen( v, w ) );
+		BOOST_CHECK_SMALL( orthogonalityError( v ), epsilon );
+		for ( std::size_t i = 0; i < N; i++ )
+		{
+			const Vector< T, N > x( ublas::column( v, i ) );
+			BOOST_CHECK_SMALL( vectorDiffSum( Vector< T, N >( ublas::prod( a, x ) ), Vector< T, N >( w( i ) * x ) ), epsilon );
+			if ( i > 0 )
+				BOOST_CHECK( w( i - 1 ) <= w( i ) );
+		}
+
+		// cholesky, a is positive definite as b has full rank
+		Matrix< T, N, N > l;
+		BOOST_CHECK( cholesky( a, l ) );
+		BOOST_CHECK_SMALL( matrixDiff( Matrix< T, N, N >( ublas::prod( l, ublas::trans( l ) ) ), a ), epsilon );
+		BOOST_CHECK_EQUAL( l( 0, N - 1 ), T( 0 ) );
+
+		const Vector< T, N > x( randomVector< T, N >( 1 ) );
+		Vector< T, N > y( ublas::prod( a, x ) );
+		BOOST_CHECK( choleskySolve( a, y ) );
+		BOOST_CHECK_SMALL( vectorDiffSum( y, x ), epsilon * 100 );
+
+		Matrix< T, N, N > ai( a );
+		BOOST_CHECK( choleskyInvert( ai ) );
+		BOOST_CHECK_SMALL( matrixDiff( Matrix< T, N, N >( ublas::prod( ai, a ) ), Matrix< T, N, N >::identity() ), epsilon * 100 );
+
+		// indefinite matrices are rejected
+		Matrix< T, N, N > c( a );
+		c( N - 1, N - 1 ) = -c( N - 1, N - 1 );
+		BOOST_CHECK( !cholesky( c, l ) );
+		BOOST_CHECK( !choleskySolve( c, y ) );
+	}
+}
+
+template< typename T, std::size_t M, std::size_t N >
+void testLeastSquares( const T epsilon )
+{
+	for ( std::size_t n = 0; n < 100; n++ )
+	{
+		Matrix< T, M, N > a;
+		randomMatrix( a );
+		a *= T( 0.01 );
+		const Vector< T, N > x( randomVector< T, N >( 1 ) );
+		Vector< T, M > b( ublas::prod( a, x ) );
+
+		// residual orthogonal to the columns of a
+		const Vector< T, M > noise( randomVector< T, M >( 1 ) );
+		Vector< T, N > solution;
+		BOOST_CHECK( qrSolve( a, b, solution ) );
+		BOOST_CHECK_SMALL( vectorDiffSum( solution, x ), epsilon );
+
+		b += noise * T( 0.1 );
+		BOOST_CHECK( qrSolve( a, b, solution ) );
+		const Vector< T, M > residual( b - ublas::prod( a, solution ) );
+		BOOST_CHECK_SMALL( T( ublas::norm_inf( ublas::prod( ublas::trans( a ), residual ) ) ), epsilon );
+
+		// rank deficient
+		ublas::column( a, N - 1 ) = ublas::column( a, 0 );
+		BOOST_CHECK( !qrSolve( a, b, solution ) );
+	}
+}
+
+} // anonymous namespace
+
+
+void TestFixedDecomposition()
+{
+	testSvd< double, 2, 2 >( 1e-10 );
+	testSvd< double, 3, 2 >( 1e-10 );
+	testSvd< double, 3, 3 >( 1e-10 );
+	testSvd< double, 4, 4 >( 1e-10 );
+	testSvd< double, 9, 6 >( 1e-10 );
+	testSvd< float, 3, 3 >( 1e-4f );
+
+	testSymmetric< double, 2 >( 1e-9 );
+	testSymmetric< double, 3 >( 1e-9 );
+	testSymmetric< double, 4 >( 1e-9 );
+	testSymmetric< double, 6 >( 1e-9 );
+	testSymmetric< float, 4 >( 1e-3f );
+
+	testLeastSquares< double, 3, 3 >( 1e-8 );
+	testLeastSquares< double, 9, 3 >( 1e-8 );
+	testLeastSquares< double, 12, 6 >( 1e-8 );
+}
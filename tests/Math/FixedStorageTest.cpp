@@ -0,0 +1,77 @@
+#include <utMath/FixedStorage.h>
+#include <utMath/Blas1.h>
+#include <utMath/Blas2.h>
+#include <utMath/Blas3.h>
+#include <utMath/Random/Vector.h>
+
+#include <vector>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace ublas = boost::numeric::ublas;
+
+void TestFixedStorage()
+{
+	// nothing but the elements
+	BOOST_CHECK_EQUAL( sizeof( FixedVector< double, 3 > ), 3 * sizeof( double ) );
+	BOOST_CHECK_EQUAL( sizeof( FixedVector< float, 4 > ), 4 * sizeof( float ) );
+	BOOST_CHECK( sizeof( FixedVector< double, 3 > ) < sizeof( Vector< double, 3 > ) );
+	BOOST_CHECK( sizeof( FixedMatrix< double, 3, 3 > ) < sizeof( Matrix< double, 3, 3 > ) );
+
+	Random::Vector< double, 3 >::Uniform randVector( -10, 10 );
+	const double epsilon = 1e-10;
+	for ( std::size_t n = 0; n < 100; n++ )
+	{
+		const Vector< double, 3 > a( randVector() );
+		const Vector< double, 3 > b( randVector() );
+
+		// conversion from and to Math::Vector
+		const FixedVector< double, 3 > fa( a );
+		FixedVector< double, 3 > fb;
+		fb = b;
+		const Vector< double, 3 > back( fa );
+		BOOST_CHECK_SMALL( double( ublas::norm_2( back - a ) ), epsilon );
+
+		// copies are independent
+		FixedVector< double, 3 > fc( fa );
+		fc( 0 ) += 1.0;
+		BOOST_CHECK_EQUAL( fa( 0 ), a( 0 ) );
+
+		// ublas expressions and Blas1 functors
+		const FixedVector< double, 3 > sum( fa + 2.0 * fb );
+		BOOST_CHECK_SMALL( double( ublas::norm_2( sum - ( a + 2.0 * b ) ) ), epsilon );
+		BOOST_CHECK_SMALL( InnerProduct()( fa, fb ) - ublas::inner_prod( a, b ), epsilon );
+		BOOST_CHECK_SMALL( Norm_2()( fa ) - ublas::norm_2( a ), epsilon );
+
+		// Blas2 and Blas3 functors
+		const Matrix< double, 3, 3 > m( OuterProduct< Vector< double, 3 >, Vector< double, 3 >, Matrix< double, 3, 3 > >()( a, b ) );
+		FixedMatrix< double, 3, 3 > fm;
+		OuterProduct< Vector< double, 3 >, Vector< double, 3 >, Matrix< double, 3, 3 > >()( fa, fb, fm );
+		BOOST_CHECK_SMALL( double( ublas::norm_frobenius( fm - m ) ), epsilon );
+
+		FixedMatrix< double, 3, 3 > fmm;
+		Product< Matrix< double, 3, 3 >, Matrix< double, 3, 3 >, Matrix< double, 3, 3 > >()( fm, fm, fmm );
+		const Matrix< double, 3, 3 > mm( ublas::prod( m, m ) );
+		BOOST_CHECK_SMALL( double( ublas::norm_frobenius( fmm - mm ) ), epsilon * 1e4 );
+
+		const Matrix< double, 3, 3 > mBack( fmm );
+		BOOST_CHECK_SMALL( double( ublas::norm_frobenius( mBack - mm ) ), epsilon * 1e4 );
+		const FixedVector< double, 3 > fp( ublas::prod( fm, fa ) );
+		BOOST_CHECK_SMALL( double( ublas::norm_2( fp - ublas::prod( m, a ) ) ), epsilon * 1e2 );
+	}
+
+	// contiguous storage in containers
+	std::vector< FixedVector< double, 3 > > points( 10, FixedVector< double, 3 >( 1.0, 2.0, 3.0 ) );
+	BOOST_CHECK_EQUAL( &points[ 1 ]( 0 ) - &points[ 0 ]( 0 ), 3 );
+	BOOST_CHECK_EQUAL( points[ 9 ]( 2 ), 3.0 );
+
+	const FixedMatrix< double, 3, 3 > id( FixedMatrix< double, 3, 3 >::identity() );
+	BOOST_CHECK_EQUAL( id( 1, 1 ), 1.0 );
+	BOOST_CHECK_EQUAL( id( 0, 1 ), 0.0 );
+	const FixedVector< double, 4 > zero( FixedVector< double, 4 >::zeros() );
+	BOOST_CHECK_EQUAL( zero( 3 ), 0.0 );
+}
@@ -0,0 +1,147 @@
+#include <utMath/Gpu/Backend.h>
+#include <utMath/Optimization/SparseLevenbergMarquardt.h>
+#include <utMath/Geometry/PointProjection.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utMath/Pose.h>
+#include <utUtil/Exception.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+void TestGpuBackend()
+{
+	BOOST_CHECK_EQUAL( Gpu::available(), Gpu::deviceName() != "host" );
+
+	// batched projection as project_points
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	Random::Quaternion< double >::Uniform randQuat;
+	const Pose pose( randQuat(), Vector< double, 3 >( 0.1, -0.2, 5 ) );
+	const Matrix< double, 3, 4 > projection( pose.rotation(), pose.translation() );
+	std::vector< Vector< double, 3 > > points( 1000 );
+	for ( std::size_t i = 0; i < points.size(); i++ )
+		points[ i ] = randVector();
+
+	std::vector< Vector< double, 2 > > expected;
+	Geometry::project_points( projection, points.begin(), points.end(), std::back_inserter( expected ) );
+	std::vector< Vector< double, 2 > > projected;
+	Gpu::PointProjector projector;
+	projector.project( projection, points, projected );
+	BOOST_REQUIRE_EQUAL( projected.size(), points.size() );
+	for ( std::size_t i = 0; i < points.size(); i++ )
+		BOOST_CHECK_SMALL( ublas::norm_2( projected[ i ] - expected[ i ] ), 1e-12 );
+
+	// reprojection of bundle adjustment observations: 3 cameras looking at 5 points
+	const std::size_t nCams = 3;
+	const std::size_t nPoints = 5;
+	std::vector< std::size_t > cameras, pointIndices;
+	for ( std::size_t c = 0; c < nCams; c++ )
+		for ( std::size_t p = 0; p < nPoints; p++ )
+		{
+			cameras.push_back( c );
+			pointIndices.push_back( p );
+		}
+	std::vector< Pose > poses;
+	std::vector< double > params( 7 * nCams + 3 * nPoints );
+	for ( std::size_t c = 0; c < nCams; c++ )
+	{
+		poses.push_back( Pose( randQuat(), Vector< double, 3 >( 0.1 * c, 0.2, 6 ) ) );
+		Vector< double, 4 > q;
+		poses.back().rotation().toVector( q );
+		for ( std::size_t j = 0; j < 4; j++ )
+			params[ 7 * c + j ] = q( j );
+		for ( std::size_t j = 0; j < 3; j++ )
+			params[ 7 * c + 4 + j ] = poses.back().translation()( j );
+	}
+	for ( std::size_t p = 0; p < nPoints; p++ )
+	{
+		const Vector< double, 3 > x( randVector() );
+		for ( std::size_t j = 0; j < 3; j++ )
+			params[ 7 * nCams + 3 * p + j ] = x( j );
+	}
+
+	const std::size_t nObs = cameras.size();
+	Gpu::ReprojectionEvaluator evaluator( nCams, nPoints, cameras, pointIndices );
+	BOOST_CHECK_EQUAL( evaluator.observationCount(), nObs );
+	std::vector< double > predicted( 2 * nObs ), jCameras( 14 * nObs ), jPoints( 6 * nObs );
+	evaluator.evaluate( &params[ 0 ], &predicted[ 0 ], &jCameras[ 0 ], &jPoints[ 0 ] );
+
+	std::vector< double > shifted( predicted.size() ), unused( jCameras.size() ), unused2( jPoints.size() );
+	const double h = 1e-6;
+	for ( std::size_t i = 0; i < nObs; i++ )
+	{
+		const double* x = &params[ 7 * nCams + 3 * pointIndices[ i ] ];
+		const Vector< double, 3 > camPoint( poses[ cameras[ i ] ] * Vector< double, 3 >( x[ 0 ], x[ 1 ], x[ 2 ] ) );
+		BOOST_CHECK_SMALL( predicted[ 2 * i ] - camPoint( 0 ) / camPoint( 2 ), 1e-12 );
+		BOOST_CHECK_SMALL( predicted[ 2 * i + 1 ] - camPoint( 1 ) / camPoint( 2 ), 1e-12 );
+		BOOST_CHECK_SMALL( jCameras[ 14 * i + 4 ] - 1 / camPoint( 2 ), 1e-12 );
+	}
+
+	// the point and translation jacobians agree with central differences
+	for ( std::size_t j = 0; j < 3; j++ )
+	{
+		std::vector< double > plus( params ), minus( params );
+		plus[ 7 * nCams + j ] += h;
+		minus[ 7 * nCams + j ] -= h;
+		std::vector< double > predictedMinus( predicted.size() );
+		evaluator.evaluate( &plus[ 0 ], &shifted[ 0 ], &unused[ 0 ], &unused2[ 0 ] );
+		evaluator.evaluate( &minus[ 0 ], &predictedMinus[ 0 ], &unused[ 0 ], &unused2[ 0 ] );
+		// observations of point 0
+		for ( std::size_t i = 0; i < nObs; i += nPoints )
+			for ( std::size_t r = 0; r < 2; r++ )
+				BOOST_CHECK_SMALL( jPoints[ 6 * i + 3 * r + j ] - ( shifted[ 2 * i + r ] - predictedMinus[ 2 * i + r ] ) / ( 2 * h ), 1e-6 );
+
+		plus = params;
+		minus = params;
+		plus[ 4 + j ] += h;
+		minus[ 4 + j ] -= h;
+		evaluator.evaluate( &plus[ 0 ], &shifted[ 0 ], &unused[ 0 ], &unused2[ 0 ] );
+		evaluator.evaluate( &minus[ 0 ], &predictedMinus[ 0 ], &unused[ 0 ], &unused2[ 0 ] );
+		// observations of camera 0
+		for ( std::size_t i = 0; i < nPoints; i++ )
+			for ( std::size_t r = 0; r < 2; r++ )
+				BOOST_CHECK_SMALL( jCameras[ 14 * i + 7 * r + 4 + j ] - ( shifted[ 2 * i + r ] - predictedMinus[ 2 * i + r ] ) / ( 2 * h ), 1e-6 );
+	}
+
+	// conjugate gradients as the host solver of the sparse levenberg-marquardt
+	const std::size_t nRows = 60;
+	const std::size_t nCols = 20;
+	Optimization::SparseJacobian< double > J( nCols );
+	for ( std::size_t i = 0; i < nRows; i++ )
+	{
+		J.push_back( i % nCols, Random::distribute_uniform< double >( 1, 2 ) );
+		J.push_back( ( 7 * i + 3 ) % nCols, Random::distribute_uniform< double >( -1, 1 ) );
+		J.finishRow();
+	}
+	Vector< double > b( nCols ), expectedX( nCols ), x( nCols );
+	for ( std::size_t j = 0; j < nCols; j++ )
+		b( j ) = Random::distribute_uniform< double >( -1, 1 );
+
+	Gpu::ConjugateGradientSolver solver;
+	BOOST_CHECK_THROW( solver.solve( 0.1, b, x, 100, 1e-12 ), Ubitrack::Util::Exception );
+	for ( std::size_t run = 0; run < 2; run++ )
+	{
+		// the second run only changes the values, the pattern is kept
+		if ( run == 1 )
+			for ( std::size_t k = 0; k < J.nonZeros(); k++ )
+				J.value( k ) *= 1.5;
+
+		const std::size_t nExpected = Optimization::Detail::conjugateGradientSolve( J, 0.1, b, expectedX, 100, 1e-12 );
+		solver.setJacobian( J );
+		const std::size_t nIterations = solver.solve( 0.1, b, x, 100, 1e-12 );
+		BOOST_CHECK( nIterations <= nExpected + 1 && nIterations + 1 >= nExpected );
+		BOOST_CHECK_SMALL( ublas::norm_inf( x - expectedX ), 1e-9 );
+
+		// residual of the normal equations
+		Vector< double > Jx( nRows ), JtJx( nCols );
+		J.multiply( x, Jx );
+		J.multiplyTransposed( Jx, JtJx );
+		BOOST_CHECK_SMALL( ublas::norm_inf( JtJx + 0.1 * x - b ), 1e-9 );
+	}
+}
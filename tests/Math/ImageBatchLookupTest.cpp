@@ -0,0 +1,138 @@
+#include <utMath/Optimization/NewFunction/Function.h>
+#include <utMath/Optimization/NewFunction/ImageBatchLookup.h>
+#include <utMath/Random/Scalar.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+namespace NF = Ubitrack::Math::Optimization::Function;
+
+namespace {
+
+const int g_width = 64;
+const int g_height = 48;
+
+/** a quadratic function, reproduced exactly by the bicubic interpolation */
+double quadratic( const double x, const double y )
+{ return 0.01 * x * x + 0.02 * x * y - 0.005 * y * y + 0.5 * y + 3; }
+
+/** the same as ImageLookup */
+double bilinearReference( const std::vector< unsigned char >& image, const double x, const double y )
+{
+	const int ix = static_cast< int >( std::floor( x ) );
+	const int iy = static_cast< int >( std::floor( y ) );
+	const unsigned char* i = &image[ iy * g_width + ix ];
+	const double a = i[ 0 ] + ( x - ix ) * ( i[ 1 ] - i[ 0 ] );
+	const double b = i[ g_width ] + ( x - ix ) * ( i[ g_width + 1 ] - i[ g_width ] );
+	return a + ( y - iy ) * ( b - a );
+}
+
+} // anonymous namespace
+
+
+void TestImageBatchLookup()
+{
+	std::vector< unsigned char > bytes( g_width * g_height );
+	std::vector< float > smooth( g_width * g_height );
+	for ( int y = 0; y < g_height; y++ )
+		for ( int x = 0; x < g_width; x++ )
+		{
+			bytes[ y * g_width + x ] = static_cast< unsigned char >( Random::distribute_uniform< int >( 0, 255 ) );
+			smooth[ y * g_width + x ] = static_cast< float >( quadratic( x, y ) );
+		}
+	const NF::ImagePlane< unsigned char > byteImage( &bytes[ 0 ], g_width, g_height, g_width );
+	const NF::ImagePlane< float > smoothImage( &smooth[ 0 ], g_width, g_height, g_width * sizeof( float ) );
+
+	// random points, some outside of the image
+	const std::size_t n = 203;
+	std::vector< double > x( n ), y( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		x[ i ] = Random::distribute_uniform< double >( -2, g_width + 1 );
+		y[ i ] = Random::distribute_uniform< double >( -2, g_height + 1 );
+	}
+
+	// bilinear interpolation as in ImageLookup
+	std::vector< double > values( n ), gx( n ), gy( n );
+	NF::sampleImage( byteImage, NF::bilinearInterpolation, &x[ 0 ], &y[ 0 ], n, &values[ 0 ], &gx[ 0 ], &gy[ 0 ] );
+	for ( std::size_t i = 0; i < n; i++ )
+		if ( x[ i ] < 0 || x[ i ] >= g_width - 1 || y[ i ] < 0 || y[ i ] >= g_height - 1 )
+		{
+			BOOST_CHECK_EQUAL( values[ i ], 0.0 );
+			BOOST_CHECK_EQUAL( gx[ i ], 0.0 );
+		}
+		else
+		{
+			BOOST_CHECK_SMALL( values[ i ] - bilinearReference( bytes, x[ i ], y[ i ] ), 1e-9 );
+			// the gradients are the derivatives of the interpolation
+			const double h = 1e-4;
+			const double xh = std::floor( x[ i ] ) + 0.5;
+			const double dx = bilinearReference( bytes, xh + h, y[ i ] ) - bilinearReference( bytes, xh - h, y[ i ] );
+			double value, gradX, gradY;
+			NF::sampleImage( byteImage, NF::bilinearInterpolation, &xh, &y[ i ], 1, &value, &gradX, &gradY );
+			BOOST_CHECK_SMALL( gradX - dx / ( 2 * h ), 1e-6 );
+		}
+
+	// bicubic interpolation reproduces quadratic functions and their gradients in the interior
+	std::vector< float > cubicValues( n ), cubicGx( n ), cubicGy( n );
+	NF::sampleImage( smoothImage, NF::bicubicInterpolation, &x[ 0 ], &y[ 0 ], n, &cubicValues[ 0 ], &cubicGx[ 0 ], &cubicGy[ 0 ] );
+	std::size_t nInterior = 0;
+	for ( std::size_t i = 0; i < n; i++ )
+		if ( x[ i ] >= 1 && x[ i ] < g_width - 2 && y[ i ] >= 1 && y[ i ] < g_height - 2 )
+		{
+			nInterior++;
+			BOOST_CHECK_CLOSE( cubicValues[ i ], quadratic( x[ i ], y[ i ] ), 1e-3 );
+			BOOST_CHECK_SMALL( cubicGx[ i ] - ( 0.02 * x[ i ] + 0.02 * y[ i ] ), 1e-4 );
+			BOOST_CHECK_SMALL( cubicGy[ i ] - ( 0.02 * x[ i ] - 0.01 * y[ i ] + 0.5 ), 1e-4 );
+		}
+		else if ( x[ i ] < 0 || x[ i ] >= g_width - 1 || y[ i ] < 0 || y[ i ] >= g_height - 1 )
+			BOOST_CHECK_EQUAL( cubicValues[ i ], 0.0f );
+	BOOST_CHECK( nInterior > n / 2 );
+
+	// precomputed sobel gradients are exact for linear images
+	std::vector< unsigned char > ramp( g_width * g_height );
+	for ( int y = 0; y < g_height; y++ )
+		for ( int x = 0; x < g_width; x++ )
+			ramp[ y * g_width + x ] = static_cast< unsigned char >( x + 4 * y / 3 );
+	const NF::ImagePlane< unsigned char > rampImage( &ramp[ 0 ], g_width, g_height, g_width );
+	const NF::ImageGradients gradients( rampImage );
+	BOOST_CHECK_EQUAL( gradients.gx().row( 10 )[ 20 ], 1.0f );
+	BOOST_CHECK_EQUAL( gradients.gy().row( 0 )[ 20 ], 0.0f );
+
+	// as function, with jacobian
+	Vector< double, 8 > points;
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		points( 2 * i ) = 5.3 + 11.1 * i;
+		points( 2 * i + 1 ) = 7.8 + 6.2 * i;
+	}
+	Vector< double, 4 > result;
+	Matrix< double, 4, 8 > jacobian;
+	NF::ImageBatchLookup< float, 4 > lookup( smoothImage, 4, NF::bicubicInterpolation );
+	( lookup << NF::parameter< 8 >( 0 ) ).evaluateWithJacobian( points, result, jacobian );
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		const double px = points( 2 * i );
+		const double py = points( 2 * i + 1 );
+		BOOST_CHECK_CLOSE( result( i ), quadratic( px, py ), 1e-3 );
+		BOOST_CHECK_SMALL( jacobian( i, 2 * i ) - ( 0.02 * px + 0.02 * py ), 1e-4 );
+		BOOST_CHECK_SMALL( jacobian( i, 2 * i + 1 ) - ( 0.02 * px - 0.01 * py + 0.5 ), 1e-4 );
+		BOOST_CHECK_EQUAL( jacobian( i, ( 2 * i + 2 ) % 8 ), 0.0 );
+	}
+
+	// number of points known at run time, gradients from the sobel images
+	NF::ImageBatchLookup< unsigned char > rampLookup( rampImage, 4, NF::bilinearInterpolation, &gradients );
+	Vector< double > dynamicResult( 4 );
+	Matrix< double > dynamicJacobian( 4, 8 );
+	( rampLookup << NF::parameter< 8 >( 0 ) ).evaluateWithJacobian( points, dynamicResult, dynamicJacobian );
+	BOOST_CHECK_EQUAL( rampLookup.size(), 4u );
+	for ( std::size_t i = 0; i < 4; i++ )
+	{
+		BOOST_CHECK_SMALL( dynamicResult( i ) - bilinearReference( ramp, points( 2 * i ), points( 2 * i + 1 ) ), 1e-9 );
+		BOOST_CHECK_CLOSE( dynamicJacobian( i, 2 * i ), 1.0, 1e-9 );
+	}
+}
@@ -0,0 +1,165 @@
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Optimization/GaussNewton.h>
+
+#include <math.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** fits y = a * exp( b * x ) + c, optionally with residual-only evaluation, counting the jacobians */
+template< bool RESIDUAL >
+class ExponentialCurve
+{
+public:
+	ExponentialCurve( const std::vector< double >& x )
+		: m_x( x )
+		, nJacobians( 0 )
+	{}
+
+	std::size_t size() const
+	{ return m_x.size(); }
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J )
+	{
+		nJacobians++;
+		for ( std::size_t i = 0; i < m_x.size(); i++ )
+		{
+			const double e = exp( input( 1 ) * m_x[ i ] );
+			result( i ) = input( 0 ) * e + input( 2 );
+			J( i, 0 ) = e;
+			J( i, 1 ) = input( 0 ) * m_x[ i ] * e;
+			J( i, 2 ) = 1;
+		}
+	}
+
+	std::vector< double > m_x;
+	std::size_t nJacobians;
+};
+
+/** the same problem with separate residual and jacobian evaluation */
+class ResidualExponentialCurve
+	: public ExponentialCurve< true >
+{
+public:
+	ResidualExponentialCurve( const std::vector< double >& x )
+		: ExponentialCurve< true >( x )
+	{}
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input )
+	{
+		for ( std::size_t i = 0; i < m_x.size(); i++ )
+			result( i ) = input( 0 ) * exp( input( 1 ) * m_x[ i ] ) + input( 2 );
+	}
+
+	template< class VT2, class MT >
+	void jacobian( const VT2& input, MT& J )
+	{
+		Vector< double > result( m_x.size() );
+		evaluateWithJacobian( result, input, J );
+	}
+};
+
+/** samples the curve with parameters p */
+Vector< double > sampleCurve( const std::vector< double >& x, const Vector< double, 3 >& p )
+{
+	Vector< double > y( x.size() );
+	for ( std::size_t i = 0; i < x.size(); i++ )
+		y( i ) = p( 0 ) * exp( p( 1 ) * x[ i ] ) + p( 2 );
+	return y;
+}
+
+/** tracks slowly changing curve parameters over some frames */
+template< class Problem >
+void trackCurve( Problem& curve, const std::vector< double >& x, Optimization::IncrementalGaussNewton< double >& optimizer
+	, std::size_t& maxIterations, std::size_t& nJacobians )
+{
+	Vector< double, 3 > truth( 2.0, -0.5, 1.0 );
+	Vector< double, 3 > params( truth + Vector< double, 3 >( 0.2, 0.1, -0.1 ) );
+
+	maxIterations = 0;
+	curve.nJacobians = 0;
+	for ( std::size_t frame = 0; frame < 20; frame++ )
+	{
+		truth( 0 ) += 0.001;
+		truth( 1 ) -= 0.0005;
+		const Vector< double > y( sampleCurve( x, truth ) );
+
+		const double res = optimizer.optimize( curve, params, y );
+		BOOST_CHECK( optimizer.converged() );
+		BOOST_CHECK( res < 1e-4 );
+		BOOST_CHECK_SMALL( ublas::norm_2( params - truth ), 1e-6 );
+		if ( frame > 0 )
+			maxIterations = std::max( maxIterations, optimizer.iterations() );
+	}
+	nJacobians = curve.nJacobians;
+}
+
+} // anonymous namespace
+
+
+void TestIncrementalGaussNewton()
+{
+	std::vector< double > x;
+	for ( std::size_t i = 0; i < 30; i++ )
+		x.push_back( 0.1 * i );
+
+	// same result as a fixed number of iterations from scratch
+	{
+		const Vector< double, 3 > truth( 2.0, -0.5, 1.0 );
+		const Vector< double > y( sampleCurve( x, truth ) );
+		Vector< double, 3 > params( 2.5, -0.3, 0.5 );
+		Vector< double, 3 > reference( params );
+
+		ExponentialCurve< false > curve( x );
+		Optimization::gaussNewton( curve, reference, y, 10, Optimization::OptNoNormalize() );
+		Optimization::IncrementalGaussNewton< double > optimizer( 20, 1e-10 );
+		optimizer.optimize( curve, params, y );
+		BOOST_CHECK( optimizer.converged() );
+		BOOST_CHECK( optimizer.iterations() < 20 );
+		BOOST_CHECK_SMALL( ublas::norm_2( params - reference ), 1e-8 );
+		BOOST_CHECK_SMALL( ublas::norm_2( params - truth ), 1e-8 );
+	}
+
+	// warm started frames need few iterations, a problem with residual
+	// evaluation reuses the jacobian of previous iterations and frames
+	std::size_t maxIterations;
+	std::size_t nJacobians;
+	ExponentialCurve< false > curve( x );
+	Optimization::IncrementalGaussNewton< double > optimizer( 10, 1e-7 );
+	trackCurve( curve, x, optimizer, maxIterations, nJacobians );
+	BOOST_CHECK( maxIterations <= 3 );
+
+	std::size_t maxIterationsResidual;
+	std::size_t nJacobiansResidual;
+	ResidualExponentialCurve residualCurve( x );
+	Optimization::IncrementalGaussNewton< double > residualOptimizer( 10, 1e-7 );
+	trackCurve( residualCurve, x, residualOptimizer, maxIterationsResidual, nJacobiansResidual );
+	BOOST_CHECK( maxIterationsResidual <= 5 );
+	BOOST_CHECK( nJacobiansResidual < nJacobians );
+
+	// without reuse every iteration computes a jacobian
+	ResidualExponentialCurve freshCurve( x );
+	Optimization::IncrementalGaussNewton< double > freshOptimizer( 10, 1e-7, false );
+	trackCurve( freshCurve, x, freshOptimizer, maxIterations, nJacobiansResidual );
+	BOOST_CHECK_EQUAL( nJacobiansResidual, nJacobians );
+	BOOST_CHECK_EQUAL( freshOptimizer.jacobianEvaluations(), freshOptimizer.iterations() );
+
+	// a different problem size discards the stored factorization
+	std::vector< double > x2( x.begin(), x.begin() + 20 );
+	ResidualExponentialCurve smallCurve( x2 );
+	const Vector< double > y2( sampleCurve( x2, Vector< double, 3 >( 2.0, -0.5, 1.0 ) ) );
+	Vector< double, 3 > params( 2.1, -0.45, 0.9 );
+	residualOptimizer.optimize( smallCurve, params, y2 );
+	BOOST_CHECK( residualOptimizer.converged() );
+	BOOST_CHECK( residualOptimizer.jacobianEvaluations() >= 1 );
+	BOOST_CHECK_SMALL( ublas::norm_2( params - Vector< double, 3 >( 2.0, -0.5, 1.0 ) ), 1e-6 );
+}
@@ -0,0 +1,149 @@
+#include <utMath/Vector.h>
+#include <utMath/Geometry/KdTree.h>
+#include <utMath/PoseListOperations.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+
+#include <algorithm>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+template< typename T, std::size_t N >
+T squaredDistance( const Vector< T, N >& a, const Vector< T, N >& b )
+{
+	T d( 0 );
+	for ( std::size_t k = 0; k < N; k++ )
+		d += ( a( k ) - b( k ) ) * ( a( k ) - b( k ) );
+	return d;
+}
+
+template< typename T >
+void testKdTreeRandom( const std::size_t nPoints, const std::size_t leafSize )
+{
+	typename Random::Vector< T, 3 >::Uniform randVector( -10, 10 );
+
+	std::vector< Vector< T, 3 > > points;
+	std::generate_n( std::back_inserter( points ), nPoints, randVector );
+	// duplicates and points on a plane must not confuse the splits
+	for ( std::size_t i = 0; i < nPoints / 10; i++ )
+	{
+		points.push_back( points[ i ] );
+		points.push_back( Vector< T, 3 >( points[ i ]( 0 ), points[ i ]( 1 ), T( 0 ) ) );
+	}
+
+	Geometry::KdTree< T, 3 > tree( points, leafSize );
+	BOOST_CHECK_EQUAL( tree.size(), points.size() );
+
+	std::vector< std::pair< T, std::size_t > > neighbours;
+	for ( std::size_t q = 0; q < 200; q++ )
+	{
+		const Vector< T, 3 > query( randVector() );
+
+		std::vector< std::pair< T, std::size_t > > expected( points.size() );
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			expected[ i ] = std::make_pair( squaredDistance( query, points[ i ] ), i );
+		std::sort( expected.begin(), expected.end() );
+
+		// duplicates may return another index with the same distance
+		T distanceSq;
+		const std::size_t nearest = tree.nearest( query, std::numeric_limits< T >::max(), &distanceSq );
+		BOOST_REQUIRE( nearest != tree.invalid );
+		BOOST_CHECK_EQUAL( distanceSq, expected[ 0 ].first );
+		BOOST_CHECK_EQUAL( squaredDistance( query, points[ nearest ] ), expected[ 0 ].first );
+
+		// a radius smaller than the nearest distance finds nothing
+		BOOST_CHECK( tree.nearest( query, expected[ 0 ].first ) == tree.invalid );
+
+		tree.kNearest( query, 7, neighbours );
+		BOOST_REQUIRE_EQUAL( neighbours.size(), 7u );
+		for ( std::size_t k = 0; k < 7; k++ )
+		{
+			BOOST_CHECK_EQUAL( neighbours[ k ].first, expected[ k ].first );
+			BOOST_CHECK_EQUAL( squaredDistance( query, points[ neighbours[ k ].second ] ), expected[ k ].first );
+		}
+
+		// the radius limits the number of neighbours
+		tree.kNearest( query, 7, neighbours, expected[ 3 ].first );
+		BOOST_CHECK( neighbours.size() <= 3u );
+	}
+}
+
+template< typename T, std::size_t N >
+void testKdTreeQueries( const std::size_t nPoints, const T radius )
+{
+	typename Random::Vector< T, N >::Uniform randVector( -10, 10 );
+
+	std::vector< Vector< T, N > > points;
+	std::generate_n( std::back_inserter( points ), nPoints, randVector );
+	std::vector< Vector< T, N > > queries;
+	std::generate_n( std::back_inserter( queries ), 300, randVector );
+
+	Geometry::KdTree< T, N > tree( points );
+
+	// radius search against brute force
+	std::vector< std::vector< std::pair< T, std::size_t > > > inRadius;
+	tree.radiusSearch( queries, radius * radius, inRadius );
+	BOOST_REQUIRE_EQUAL( inRadius.size(), queries.size() );
+	for ( std::size_t q = 0; q < queries.size(); q++ )
+	{
+		std::vector< std::size_t > expected;
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			if ( squaredDistance( queries[ q ], points[ i ] ) < radius * radius )
+				expected.push_back( i );
+
+		std::vector< std::size_t > found;
+		for ( std::size_t i = 0; i < inRadius[ q ].size(); i++ )
+		{
+			BOOST_CHECK_EQUAL( inRadius[ q ][ i ].first, squaredDistance( queries[ q ], points[ inRadius[ q ][ i ].second ] ) );
+			found.push_back( inRadius[ q ][ i ].second );
+		}
+		std::sort( found.begin(), found.end() );
+		BOOST_CHECK( found == expected );
+	}
+
+	// batched queries give the results of single queries, also on several threads
+	const ListExecutor executor( threadExecutor( 4, 16 ) );
+	std::vector< std::size_t > indices;
+	std::vector< T > distancesSq;
+	tree.nearest( queries, indices, distancesSq, radius * radius, executor );
+	std::vector< std::vector< std::pair< T, std::size_t > > > neighbours;
+	tree.kNearest( queries, 5, neighbours, std::numeric_limits< T >::max(), executor );
+	std::vector< std::vector< std::pair< T, std::size_t > > > inRadiusThreaded;
+	tree.radiusSearch( queries, radius * radius, inRadiusThreaded, executor );
+	BOOST_REQUIRE_EQUAL( indices.size(), queries.size() );
+	BOOST_REQUIRE_EQUAL( neighbours.size(), queries.size() );
+	BOOST_CHECK( inRadiusThreaded == inRadius );
+
+	std::vector< std::pair< T, std::size_t > > single;
+	for ( std::size_t q = 0; q < queries.size(); q++ )
+	{
+		T distanceSq( radius * radius );
+		BOOST_CHECK_EQUAL( indices[ q ], tree.nearest( queries[ q ], radius * radius, &distanceSq ) );
+		BOOST_CHECK_EQUAL( distancesSq[ q ], distanceSq );
+
+		tree.kNearest( queries[ q ], 5, single );
+		BOOST_CHECK( neighbours[ q ] == single );
+	}
+}
+
+} // anonymous namespace
+
+void TestKdTree()
+{
+	// empty tree
+	Geometry::KdTree< double, 3 > empty;
+	BOOST_CHECK( empty.nearest( Vector< double, 3 >( 0, 0, 0 ) ) == empty.invalid );
+
+	testKdTreeRandom< float >( 1000, 8 );
+	testKdTreeRandom< double >( 2000, 1 );
+	testKdTreeRandom< double >( 50, 100 );
+
+	testKdTreeQueries< float, 2 >( 1000, 1.0f );
+	testKdTreeQueries< double, 3 >( 3000, 2.0 );
+}
@@ -0,0 +1,50 @@
+#include <utMath/LapackBackend.h>
+#include <utUtil/TimerRegistry.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack::Math;
+
+void TestLapackBackend()
+{
+	LapackBackend& backend( LapackBackend::instance() );
+	BOOST_CHECK( !backend.name().empty() );
+	BOOST_CHECK( backend.defaultThreads() >= 1 );
+	BOOST_CHECK_EQUAL( backend.threadControl(), backend.vendor() != LapackBackend::Default );
+	if ( !backend.threadControl() )
+		BOOST_CHECK_EQUAL( backend.threads(), 1 );
+
+	// nested scopes restore the number of threads
+	const int before = backend.threads();
+	{
+		LapackScope outer( 2 );
+		if ( backend.threadControl() )
+			BOOST_CHECK_EQUAL( backend.threads(), 2 );
+		{
+			LapackScope inner( 1, "Ubitrack.Test.LapackBackend" );
+			if ( backend.threadControl() )
+				BOOST_CHECK_EQUAL( backend.threads(), 1 );
+		}
+		if ( backend.threadControl() )
+			BOOST_CHECK_EQUAL( backend.threads(), 2 );
+	}
+	BOOST_CHECK_EQUAL( backend.threads(), before );
+
+	// the timer of the call site is named after the implementation and registered
+	Ubitrack::Util::HistogramBlockTimer& timer( backend.timer( "Ubitrack.Test.LapackBackend" ) );
+	BOOST_CHECK_EQUAL( timer.getName(), "Ubitrack.Test.LapackBackend." + backend.name() );
+	BOOST_CHECK( &timer == &backend.timer( "Ubitrack.Test.LapackBackend" ) );
+	{
+		LapackScope timed( 0, "Ubitrack.Test.LapackBackend" );
+	}
+
+	const std::vector< Ubitrack::Util::TimerStatistics > stats( Ubitrack::Util::TimerRegistry::instance().snapshot() );
+	bool bFound = false;
+	for ( std::size_t i = 0; i < stats.size(); i++ )
+		if ( stats[ i ].name == timer.getName() )
+		{
+			bFound = true;
+			BOOST_CHECK_EQUAL( stats[ i ].runs, 2u );
+		}
+	BOOST_CHECK( bFound );
+}
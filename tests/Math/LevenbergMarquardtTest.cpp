@@ -0,0 +1,432 @@
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Optimization/LevenbergMarquardt.h>
+#include <utMath/Optimization/OptTelemetry.h>
+#include <utMath/Random/Scalar.h>
+
+#include <math.h>
+#include <sstream>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** fits the curve y = a * exp( b * x ) + c to a set of samples */
+template< typename T >
+class ExponentialCurve
+{
+public:
+	ExponentialCurve( const std::vector< T >& x )
+		: m_x( x )
+	{}
+
+	std::size_t size() const
+	{ return m_x.size(); }
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		for ( std::size_t i = 0; i < m_x.size(); i++ )
+		{
+			const T e = exp( input( 1 ) * m_x[ i ] );
+			result( i ) = input( 0 ) * e + input( 2 );
+			J( i, 0 ) = e;
+			J( i, 1 ) = input( 0 ) * m_x[ i ] * e;
+			J( i, 2 ) = 1;
+		}
+	}
+
+protected:
+	const std::vector< T >& m_x;
+};
+
+/** the same curve with residual-only evaluation, counting the evaluations */
+template< typename T >
+class ResidualExponentialCurve
+	: public ExponentialCurve< T >
+{
+public:
+	ResidualExponentialCurve( const std::vector< T >& x )
+		: ExponentialCurve< T >( x )
+		, nEvaluations( 0 )
+		, nJacobians( 0 )
+	{}
+
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& input )
+	{
+		nEvaluations++;
+		for ( std::size_t i = 0; i < this->m_x.size(); i++ )
+			result( i ) = input( 0 ) * exp( input( 1 ) * this->m_x[ i ] ) + input( 2 );
+	}
+
+	template< class VT2, class MT >
+	void jacobian( const VT2& input, MT& J )
+	{
+		nJacobians++;
+		Vector< T > result( this->m_x.size() );
+		ExponentialCurve< T >::evaluateWithJacobian( result, input, J );
+	}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J )
+	{
+		nJacobians++;
+		ExponentialCurve< T >::evaluateWithJacobian( result, input, J );
+	}
+
+	std::size_t nEvaluations;
+	std::size_t nJacobians;
+};
+
+/** fits several independent exponential curves to the same sample positions */
+template< typename T >
+class ExponentialCurves
+{
+public:
+	ExponentialCurves( const std::vector< T >& x, const std::size_t nCurves )
+		: m_x( x )
+		, m_nCurves( nCurves )
+	{}
+
+	std::size_t size() const
+	{ return m_x.size() * m_nCurves; }
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		J.clear();
+		for ( std::size_t c = 0; c < m_nCurves; c++ )
+			for ( std::size_t i = 0; i < m_x.size(); i++ )
+			{
+				const std::size_t r = c * m_x.size() + i;
+				const T e = exp( input( 3 * c + 1 ) * m_x[ i ] );
+				result( r ) = input( 3 * c ) * e + input( 3 * c + 2 );
+				J( r, 3 * c ) = e;
+				J( r, 3 * c + 1 ) = input( 3 * c ) * m_x[ i ] * e;
+				J( r, 3 * c + 2 ) = 1;
+			}
+	}
+
+protected:
+	const std::vector< T >& m_x;
+	std::size_t m_nCurves;
+};
+
+template< typename T >
+void generateCurve( std::vector< T >& x, Vector< T >& y, const Vector< T, 3 >& params, const std::size_t n )
+{
+	x.resize( n );
+	y.resize( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		x[ i ] = T( 2 * i ) / n;
+		y( i ) = params( 0 ) * exp( params( 1 ) * x[ i ] ) + params( 2 ) + Random::distribute_normal< T >( 0, T( 1e-3 ) );
+	}
+}
+
+} // anonymous namespace
+
+
+template< typename T >
+void testLevenbergMarquardtWorkspace( const std::size_t n_runs, const T epsilon )
+{
+	Optimization::LevenbergMarquardtWorkspace< T > workspace;
+
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		// vary the problem size to exercise resizing of the workspace
+		const std::size_t n = 20 + 5 * ( run % 3 );
+		Vector< T, 3 > truth( Random::distribute_uniform< T >( 1, 2 ), Random::distribute_uniform< T >( 0.5, 1.5 ), Random::distribute_uniform< T >( -1, 1 ) );
+
+		std::vector< T > x;
+		Vector< T > y;
+		generateCurve( x, y, truth, n );
+		ExponentialCurve< T > curve( x );
+
+		Vector< T > paramDefault( 3 );
+		paramDefault( 0 ) = 1; paramDefault( 1 ) = 0; paramDefault( 2 ) = 0;
+		Vector< T > paramWorkspace( paramDefault );
+
+		const T resDefault = Optimization::levenbergMarquardt( curve, paramDefault, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize() );
+		const T resWorkspace = Optimization::levenbergMarquardt( workspace, curve, paramWorkspace, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize() );
+
+		BOOST_CHECK_EQUAL( workspace.measurementSize(), n );
+		BOOST_CHECK_EQUAL( workspace.parameterSize(), 3u );
+		BOOST_CHECK_SMALL( resDefault - resWorkspace, epsilon );
+		for ( std::size_t i = 0; i < 3; i++ )
+		{
+			BOOST_CHECK_SMALL( paramDefault( i ) - paramWorkspace( i ), epsilon );
+			BOOST_CHECK_SMALL( paramWorkspace( i ) - truth( i ), T( 1e-1 ) );
+		}
+	}
+}
+
+
+template< typename T >
+void testLevenbergMarquardtRowMajor( const std::size_t n_runs, const T epsilon )
+{
+	const Optimization::LmSolverType solvers[] = { Optimization::lmUseCholesky, Optimization::lmUseQR, Optimization::lmUseSVD, Optimization::lmUseCG };
+	const std::size_t nCurves = 4;
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		std::vector< T > x;
+		Vector< T > y( 30 * nCurves );
+		for ( std::size_t c = 0; c < nCurves; c++ )
+		{
+			Vector< T, 3 > curveTruth( Random::distribute_uniform< T >( 1, 2 ), Random::distribute_uniform< T >( 0.5, 1.5 ), Random::distribute_uniform< T >( -1, 1 ) );
+			Vector< T > curveY;
+			generateCurve( x, curveY, curveTruth, 30 );
+			boost::numeric::ublas::subrange( y, 30 * c, 30 * c + 30 ) = curveY;
+		}
+		ExponentialCurves< T > curves( x, nCurves );
+
+		// the row-major jacobian is handed to BLAS transposed and gives the same steps with every solver
+		for ( std::size_t s = 0; s < 4; s++ )
+		{
+			Vector< T > paramColumn( 3 * nCurves );
+			for ( std::size_t i = 0; i < paramColumn.size(); i++ )
+				paramColumn( i ) = i % 3 == 0 ? T( 1 ) : T( 0 );
+			Vector< T > paramRow( paramColumn );
+
+			Optimization::LevenbergMarquardtWorkspace< T > columnWorkspace;
+			Optimization::LevenbergMarquardtWorkspace< T, boost::numeric::ublas::row_major > rowWorkspace;
+			columnWorkspace.cgTolerance = rowWorkspace.cgTolerance = T( 1e-10 );
+			const T resColumn = Optimization::levenbergMarquardt( columnWorkspace, curves, paramColumn, y,
+				Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize(), solvers[ s ] );
+			const T resRow = Optimization::levenbergMarquardt( rowWorkspace, curves, paramRow, y,
+				Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize(), solvers[ s ] );
+
+			BOOST_CHECK_SMALL( resColumn - resRow, epsilon );
+			for ( std::size_t i = 0; i < paramColumn.size(); i++ )
+				BOOST_CHECK_SMALL( paramColumn( i ) - paramRow( i ), epsilon );
+		}
+	}
+}
+
+
+template< typename T >
+void testLevenbergMarquardtFixedSize( const std::size_t n_runs, const T epsilon )
+{
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		Vector< T, 3 > truth( Random::distribute_uniform< T >( 1, 2 ), Random::distribute_uniform< T >( 0.5, 1.5 ), Random::distribute_uniform< T >( -1, 1 ) );
+
+		std::vector< T > x;
+		Vector< T > y;
+		generateCurve( x, y, truth, 30 );
+		ExponentialCurve< T > curve( x );
+
+		// the fixed-size overload is chosen for Vector< T, 3 >
+		Vector< T, 3 > paramFixed( 1, 0, 0 );
+		Vector< T > paramDynamic( paramFixed );
+
+		const T resFixed = Optimization::levenbergMarquardt( curve, paramFixed, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize() );
+		const T resDynamic = Optimization::levenbergMarquardt( curve, paramDynamic, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize() );
+
+		BOOST_CHECK_SMALL( resFixed - resDynamic, epsilon );
+		for ( std::size_t i = 0; i < 3; i++ )
+			BOOST_CHECK_SMALL( paramFixed( i ) - paramDynamic( i ), epsilon );
+	}
+}
+
+
+template< typename T >
+void testLevenbergMarquardtConjugateGradient( const std::size_t n_runs, const T epsilon )
+{
+	const std::size_t nCurves = 8;
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		std::vector< T > x;
+		Vector< T > y( 30 * nCurves );
+		Vector< T > truth( 3 * nCurves );
+		for ( std::size_t c = 0; c < nCurves; c++ )
+		{
+			Vector< T, 3 > curveTruth( Random::distribute_uniform< T >( 1, 2 ), Random::distribute_uniform< T >( 0.5, 1.5 ), Random::distribute_uniform< T >( -1, 1 ) );
+			Vector< T > curveY;
+			generateCurve( x, curveY, curveTruth, 30 );
+			boost::numeric::ublas::subrange( y, 30 * c, 30 * c + 30 ) = curveY;
+			boost::numeric::ublas::subrange( truth, 3 * c, 3 * c + 3 ) = curveTruth;
+		}
+		ExponentialCurves< T > curves( x, nCurves );
+
+		Vector< T > paramCholesky( 3 * nCurves );
+		for ( std::size_t i = 0; i < paramCholesky.size(); i++ )
+			paramCholesky( i ) = i % 3 == 0 ? T( 1 ) : T( 0 );
+		Vector< T > paramJacobi( paramCholesky );
+		Vector< T > paramBlock( paramCholesky );
+
+		const T resCholesky = Optimization::levenbergMarquardt( curves, paramCholesky, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize() );
+
+		// jacobi preconditioner, solved to a tight tolerance
+		Optimization::LevenbergMarquardtWorkspace< T > workspace;
+		workspace.cgTolerance = T( 1e-10 );
+		const T resJacobi = Optimization::levenbergMarquardt( workspace, curves, paramJacobi, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize(), Optimization::lmUseCG );
+		BOOST_CHECK_EQUAL( workspace.jacobiSquare.size1(), 0u );
+
+		// the blocks match the parameters of each curve, so a single iteration solves each step
+		Optimization::LevenbergMarquardtWorkspace< T > blockWorkspace;
+		blockWorkspace.cgBlockSize = 3;
+		blockWorkspace.cgMaxIterations = 1;
+		const T resBlock = Optimization::levenbergMarquardt( blockWorkspace, curves, paramBlock, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize(), Optimization::lmUseCG );
+
+		BOOST_CHECK_SMALL( resCholesky - resJacobi, epsilon );
+		BOOST_CHECK_SMALL( resCholesky - resBlock, epsilon );
+		for ( std::size_t i = 0; i < paramCholesky.size(); i++ )
+		{
+			BOOST_CHECK_SMALL( paramCholesky( i ) - paramJacobi( i ), epsilon );
+			BOOST_CHECK_SMALL( paramCholesky( i ) - paramBlock( i ), epsilon );
+			BOOST_CHECK_SMALL( paramBlock( i ) - truth( i ), T( 1e-1 ) );
+		}
+	}
+}
+
+
+template< class X >
+void testLevenbergMarquardtResidualOnly( const std::size_t n_runs )
+{
+	typedef typename X::value_type T;
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		Vector< T, 3 > truth( Random::distribute_uniform< T >( 1, 2 ), Random::distribute_uniform< T >( 0.5, 1.5 ), Random::distribute_uniform< T >( -1, 1 ) );
+		std::vector< T > x;
+		Vector< T > y;
+		generateCurve( x, y, truth, 30 );
+		y( 3 ) += 1; // outlier for the weighted optimization
+		ExponentialCurve< T > curve( x );
+		ResidualExponentialCurve< T > residualCurve( x );
+
+		// start far away to get rejected steps
+		X params( 3 );
+		params( 0 ) = 10; params( 1 ) = -2; params( 2 ) = 5;
+		X residualParams( params );
+		X weightedParams( params );
+		X residualWeightedParams( params );
+
+		const T res = Optimization::levenbergMarquardt( curve, params, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize() );
+		const T resResidual = Optimization::levenbergMarquardt( residualCurve, residualParams, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize() );
+
+		// the optimization takes the same steps, but only computes jacobians for accepted steps
+		BOOST_CHECK_EQUAL( res, resResidual );
+		for ( std::size_t i = 0; i < 3; i++ )
+			BOOST_CHECK_EQUAL( params( i ), residualParams( i ) );
+		BOOST_CHECK( residualCurve.nJacobians < residualCurve.nEvaluations );
+
+		// same for weighted optimization
+		const Optimization::RobustWeightFunction< Optimization::HuberLoss > huber( 1, 0.01 );
+		const T resWeighted = Optimization::weightedLevenbergMarquardt( curve, weightedParams, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize(), huber );
+		const T resResidualWeighted = Optimization::weightedLevenbergMarquardt( residualCurve, residualWeightedParams, y,
+			Optimization::OptTerminate( 50, 1e-10 ), Optimization::OptNoNormalize(), huber );
+		BOOST_CHECK_EQUAL( resWeighted, resResidualWeighted );
+		for ( std::size_t i = 0; i < 3; i++ )
+			BOOST_CHECK_EQUAL( weightedParams( i ), residualWeightedParams( i ) );
+	}
+}
+
+
+void testLevenbergMarquardtTelemetry()
+{
+	std::vector< double > x;
+	Vector< double > y;
+	generateCurve( x, y, Vector< double, 3 >( 1.5, 1.0, 0.5 ), 20 );
+	ExponentialCurve< double > curve( x );
+	std::vector< Optimization::OptIterationRecord > records;
+
+	// nothing is recorded while the telemetry is disabled
+	Optimization::OptTelemetry::drain( records );
+	records.clear();
+	Vector< double > params( 3 );
+	params( 0 ) = 1; params( 1 ) = 0; params( 2 ) = 0;
+	Optimization::levenbergMarquardt( curve, params, y, Optimization::OptTerminate( 5 ), Optimization::OptNoNormalize() );
+	BOOST_CHECK_EQUAL( Optimization::OptTelemetry::drain( records ), 0u );
+
+	// one record for the initial residual and one per iteration
+	Optimization::OptTelemetry::enable();
+	params( 0 ) = 1; params( 1 ) = 0; params( 2 ) = 0;
+	const Optimization::OptTerminateRecord termination( 10 );
+	const double residual = Optimization::weightedLevenbergMarquardt( curve, params, y, termination,
+		Optimization::OptNoNormalize(), Optimization::OptNoWeightFunction(), Optimization::lmUseSVD );
+	Optimization::OptTelemetry::disable();
+
+	BOOST_CHECK_EQUAL( Optimization::OptTelemetry::drain( records ), termination.iterations() + 1 );
+	BOOST_REQUIRE_EQUAL( records.size(), termination.iterations() + 1 );
+	double best = records.front().residual;
+	for ( std::size_t i = 0; i < records.size(); i++ )
+	{
+		BOOST_CHECK_EQUAL( std::string( records[ i ].optimizer ), "Levenberg-Marquardt" );
+		BOOST_CHECK_EQUAL( records[ i ].run, records.front().run );
+		BOOST_CHECK_EQUAL( records[ i ].iteration, i );
+		BOOST_CHECK_EQUAL( records[ i ].rank, i == 0 ? -1 : 3 );
+		BOOST_CHECK( records[ i ].run > 0 );
+		best = std::min( best, records[ i ].residual );
+	}
+	BOOST_CHECK_EQUAL( best, residual );
+	BOOST_CHECK( records.back().lambda > 0.0 );
+
+	std::ostringstream s;
+	s << records[ 1 ];
+	BOOST_CHECK_EQUAL( s.str().find( "Levenberg-Marquardt run" ), 0u );
+	BOOST_CHECK( s.str().find( ", rank 3" ) != std::string::npos );
+}
+
+
+void testLevenbergMarquardtDeadline()
+{
+	std::vector< double > x;
+	Vector< double > y;
+	generateCurve( x, y, Vector< double, 3 >( 1.5, 1.0, 0.5 ), 20 );
+	ExponentialCurve< double > curve( x );
+
+	// a deadline far ahead does not change the result
+	Vector< double > params( 3 );
+	params( 0 ) = 1; params( 1 ) = 0; params( 2 ) = 0;
+	const Optimization::OptTerminateRecord relaxed( 50, 1e-10, Optimization::Deadline::in( 3600000000000LL ) );
+	Optimization::levenbergMarquardt( curve, params, y, relaxed, Optimization::OptNoNormalize() );
+	BOOST_CHECK( relaxed.converged() );
+	BOOST_CHECK( !relaxed.deadline().expired() );
+	BOOST_CHECK_SMALL( params( 0 ) - 1.5, 1e-1 );
+
+	// a passed deadline stops after the first iteration with the best result so far
+	params( 0 ) = 1; params( 1 ) = 0; params( 2 ) = 0;
+	const Optimization::OptTerminateRecord hurried( 50, 1e-10, Optimization::Deadline( 1 ) );
+	Optimization::levenbergMarquardt( curve, params, y, hurried, Optimization::OptNoNormalize() );
+	BOOST_CHECK_EQUAL( hurried.iterations(), 1u );
+	BOOST_CHECK( !hurried.converged() );
+	BOOST_CHECK( hurried.deadline().expired() );
+
+	// a default deadline never passes
+	const Optimization::Deadline never;
+	BOOST_CHECK( !never.isSet() );
+	BOOST_CHECK( !never.check() );
+	BOOST_CHECK( !never.expired() );
+}
+
+
+void TestLevenbergMarquardt()
+{
+	testLevenbergMarquardtWorkspace< double >( 10, 1e-8 );
+	testLevenbergMarquardtWorkspace< float >( 10, 1e-4f );
+	testLevenbergMarquardtRowMajor< double >( 5, 1e-8 );
+	testLevenbergMarquardtRowMajor< float >( 5, 1e-3f );
+	testLevenbergMarquardtFixedSize< double >( 10, 1e-8 );
+	testLevenbergMarquardtFixedSize< float >( 10, 1e-3f );
+	testLevenbergMarquardtConjugateGradient< double >( 5, 1e-6 );
+	testLevenbergMarquardtResidualOnly< Vector< double > >( 5 );
+	testLevenbergMarquardtResidualOnly< Vector< double, 3 > >( 5 );
+	testLevenbergMarquardtTelemetry();
+	testLevenbergMarquardtDeadline();
+}
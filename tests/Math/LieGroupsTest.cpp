@@ -0,0 +1,138 @@
+#include <utMath/LieGroups.h>
+#include <utMath/PoseListOperations.h>
+#include <utMath/Random/Vector.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/// the quaternion exponential with the closed form
+Quaternion referenceExp( const Vector< double, 3 >& r )
+{
+	const double theta = boost::numeric::ublas::norm_2( r );
+	if ( theta == 0 )
+		return Quaternion();
+	const double s = std::sin( theta / 2 ) / theta;
+	return Quaternion( s * r( 0 ), s * r( 1 ), s * r( 2 ), std::cos( theta / 2 ) );
+}
+
+/// rotation vector of the rotation that maps exp( r ) to exp( r + h e_j ) on the left, divided by h
+Vector< double, 3 > leftDifference( const Vector< double, 3 >& r, const std::size_t j, const double h )
+{
+	Vector< double, 3 > rh( r );
+	rh( j ) += h;
+	return Vector< double, 3 >( Lie::logSO3( Quaternion( Lie::expSO3( rh ) * ~Lie::expSO3( r ) ) ) / h );
+}
+
+void testRotationVector( const Vector< double, 3 >& r )
+{
+	const double epsilon = 1e-12;
+	const Lie::SO3Terms< double > terms( r );
+
+	const Quaternion q( terms.quaternion() );
+	BOOST_CHECK_SMALL( quaternionDiff( q, referenceExp( r ) ), epsilon );
+	BOOST_CHECK_SMALL( quaternionDiff( q, Quaternion::fromLogarithm( r ) ), epsilon );
+	BOOST_CHECK_SMALL( vectorDiffSum( Lie::logSO3( q ), r ), epsilon * ( 1 + norm_2( r ) ) );
+
+	Matrix< double, 3, 3 > m;
+	terms.matrix( m );
+	BOOST_CHECK_SMALL( matrixDiff( m, Matrix< double, 3, 3 >( q ) ), epsilon );
+
+	// jacobians against central differences and their inverses
+	Matrix< double, 3, 3 > jl, jr, jlInv, jrInv;
+	terms.leftJacobian( jl );
+	terms.rightJacobian( jr );
+	terms.inverseLeftJacobian( jlInv );
+	terms.inverseRightJacobian( jrInv );
+	const double h = 1e-6;
+	for ( std::size_t j = 0; j < 3; j++ )
+	{
+		const Vector< double, 3 > d( ( leftDifference( r, j, h ) + leftDifference( r, j, -h ) ) / 2 );
+		BOOST_CHECK_SMALL( vectorDiffSum( d, Vector< double, 3 >( boost::numeric::ublas::column( jl, j ) ) ), 1e-7 );
+	}
+	BOOST_CHECK_SMALL( matrixDiff( jr, Matrix< double, 3, 3 >( boost::numeric::ublas::trans( jl ) ) ), epsilon );
+	BOOST_CHECK_SMALL( matrixDiff( Matrix< double, 3, 3 >( boost::numeric::ublas::prod( jl, jlInv ) ), Matrix< double, 3, 3 >::identity() ), 1e-10 );
+	BOOST_CHECK_SMALL( matrixDiff( Matrix< double, 3, 3 >( boost::numeric::ublas::prod( jr, jrInv ) ), Matrix< double, 3, 3 >::identity() ), 1e-10 );
+
+	// rotation of a point
+	const Vector< double, 3 > v( 0.3, -1.2, 2.0 );
+	Vector< double, 3 > rotated;
+	Matrix< double, 3, 3 > jv;
+	terms.rotate( v, rotated, jv );
+	BOOST_CHECK_SMALL( vectorDiffSum( rotated, q * v ), epsilon );
+	for ( std::size_t j = 0; j < 3; j++ )
+	{
+		Vector< double, 3 > rp( r ), rm( r );
+		rp( j ) += h;
+		rm( j ) -= h;
+		const Vector< double, 3 > d( ( Lie::expSO3( rp ) * v - Lie::expSO3( rm ) * v ) / ( 2 * h ) );
+		BOOST_CHECK_SMALL( vectorDiffSum( d, Vector< double, 3 >( boost::numeric::ublas::column( jv, j ) ) ), 1e-7 );
+	}
+
+	// float terms
+	const Lie::SO3Terms< float > termsFloat( r );
+	BOOST_CHECK_SMALL( quaternionDiff( termsFloat.quaternion(), q ), 1e-6 );
+}
+
+} // anonymous namespace
+
+
+void TestLieGroups()
+{
+	Random::Vector< double, 3 >::Uniform randVector( -1.7, 1.7 );
+
+	// zero, both sides of the series threshold and larger angles
+	testRotationVector( Vector< double, 3 >( 0, 0, 0 ) );
+	testRotationVector( Vector< double, 3 >( 1e-9, -2e-9, 0 ) );
+	testRotationVector( Vector< double, 3 >( 1e-3, 2e-3, -1e-3 ) );
+	testRotationVector( Vector< double, 3 >( 2e-3, 2e-3, -1e-3 ) );
+	testRotationVector( Vector< double, 3 >( 0, 3.1, 0 ) );
+	for ( std::size_t i = 0; i < 50; i++ )
+		testRotationVector( randVector() );
+
+	// quaternions with negative real part and unnormalized quaternions
+	const Vector< double, 3 > r( 0.2, -0.4, 0.1 );
+	const Quaternion q( Lie::expSO3( r ) );
+	BOOST_CHECK_SMALL( vectorDiffSum( Lie::logSO3( Quaternion( -q ) ), r ), 1e-12 );
+	BOOST_CHECK_SMALL( vectorDiffSum( Lie::logSO3( Quaternion( 2.0 * q ) ), r ), 1e-12 );
+	BOOST_CHECK_SMALL( vectorDiffSum( Lie::logSO3( Quaternion( 0, 0, 0, 0 ) ), Vector< double, 3 >( 0, 0, 0 ) ), 1e-12 );
+
+	// SE(3) round trip and translation of a pure translation
+	for ( std::size_t i = 0; i < 20; i++ )
+	{
+		Vector< double, 6 > xi;
+		const Vector< double, 3 > a( randVector() ), b( randVector() );
+		for ( std::size_t j = 0; j < 3; j++ )
+		{
+			xi( j ) = a( j );
+			xi( j + 3 ) = b( j );
+		}
+		const Pose p( Lie::expSE3( xi ) );
+		BOOST_CHECK_SMALL( quaternionDiff( p.rotation(), Lie::expSO3( b ) ), 1e-12 );
+		BOOST_CHECK_SMALL( vectorDiffSum( Lie::logSE3( p ), xi ), 1e-10 );
+	}
+	Vector< double, 6 > translation( boost::numeric::ublas::zero_vector< double >( 6 ) );
+	translation( 0 ) = 1;
+	BOOST_CHECK_SMALL( vectorDiffSum( Lie::expSE3( translation ).translation(), Vector< double, 3 >( 1, 0, 0 ) ), 1e-12 );
+
+	// the series on packs, including the fallback for angles above 2 pi
+	Random::Vector< double, 3 >::Uniform randLarge( -4, 4 );
+	std::vector< Vector< double, 3 > > logs;
+	for ( std::size_t i = 0; i < 600; i++ )
+		logs.push_back( i % 7 == 0 ? randLarge() : randVector() );
+	logs.push_back( Vector< double, 3 >( 0, 0, 0 ) );
+	logs.push_back( Vector< double, 3 >( 0, 0, 6.28 ) );
+	std::vector< Quaternion > exps;
+	quaternionsFromLogarithms( logs, exps );
+	BOOST_REQUIRE_EQUAL( exps.size(), logs.size() );
+	for ( std::size_t i = 0; i < logs.size(); i++ )
+	{
+		const Quaternion expected( referenceExp( logs[ i ] ) );
+		BOOST_CHECK_SMALL( std::fabs( exps[ i ].x() - expected.x() ) + std::fabs( exps[ i ].y() - expected.y() )
+			+ std::fabs( exps[ i ].z() - expected.z() ) + std::fabs( exps[ i ].w() - expected.w() ), 1e-13 );
+	}
+}
@@ -6,6 +6,41 @@ void TestBlas2();
 void TestBlas3();
 void TestVectorFunctions();
 void TestLapack();
+void TestLevenbergMarquardt();
+void TestRansac();
+void TestFixedStorage();
+void TestSimdKernels();
+void TestPoseOperations();
+void TestPoseListOperations();
+void TestRotationMatrixCache();
+void TestLieGroups();
+void TestRotationIntegration();
+void TestFixedDecomposition();
+void TestMatrixBatch();
+void TestMatrixArena();
+void TestSmallArray();
+void TestLapackBackend();
+void TestGpuBackend();
+void TestProductChain();
+void TestRotationListConversions();
+void TestDiscreteJacobian();
+void TestAutoDiff();
+void TestSparseLevenbergMarquardt();
+void TestRobustLoss();
+void TestDogleg();
+void TestIncrementalGaussNewton();
+void TestDownhillSimplex();
+void TestMunkres();
+void TestKdTree();
+void TestUniformGrid();
+void TestPointCloud();
+void TestPointView();
+void TestPackedCovariance();
+void TestErrorPose();
+void TestRandomEngine();
+void TestImageBatchLookup();
+void TestSharedExpression();
+void TestPoseSpline();
 
 
 MathTest::MathTest()
@@ -16,4 +51,39 @@ MathTest::MathTest()
 	add( BOOST_TEST_CASE( &TestBlas3 ) );
 	add( BOOST_TEST_CASE( &TestVectorFunctions ) );
 	add( BOOST_TEST_CASE( &TestLapack ) );
+	add( BOOST_TEST_CASE( &TestLevenbergMarquardt ) );
+	add( BOOST_TEST_CASE( &TestRansac ) );
+	add( BOOST_TEST_CASE( &TestFixedStorage ) );
+	add( BOOST_TEST_CASE( &TestSimdKernels ) );
+	add( BOOST_TEST_CASE( &TestPoseOperations ) );
+	add( BOOST_TEST_CASE( &TestPoseListOperations ) );
+	add( BOOST_TEST_CASE( &TestRotationMatrixCache ) );
+	add( BOOST_TEST_CASE( &TestLieGroups ) );
+	add( BOOST_TEST_CASE( &TestRotationIntegration ) );
+	add( BOOST_TEST_CASE( &TestFixedDecomposition ) );
+	add( BOOST_TEST_CASE( &TestMatrixBatch ) );
+	add( BOOST_TEST_CASE( &TestMatrixArena ) );
+	add( BOOST_TEST_CASE( &TestSmallArray ) );
+	add( BOOST_TEST_CASE( &TestLapackBackend ) );
+	add( BOOST_TEST_CASE( &TestGpuBackend ) );
+	add( BOOST_TEST_CASE( &TestProductChain ) );
+	add( BOOST_TEST_CASE( &TestRotationListConversions ) );
+	add( BOOST_TEST_CASE( &TestDiscreteJacobian ) );
+	add( BOOST_TEST_CASE( &TestAutoDiff ) );
+	add( BOOST_TEST_CASE( &TestSparseLevenbergMarquardt ) );
+	add( BOOST_TEST_CASE( &TestRobustLoss ) );
+	add( BOOST_TEST_CASE( &TestDogleg ) );
+	add( BOOST_TEST_CASE( &TestIncrementalGaussNewton ) );
+	add( BOOST_TEST_CASE( &TestDownhillSimplex ) );
+	add( BOOST_TEST_CASE( &TestMunkres ) );
+	add( BOOST_TEST_CASE( &TestKdTree ) );
+	add( BOOST_TEST_CASE( &TestUniformGrid ) );
+	add( BOOST_TEST_CASE( &TestPointCloud ) );
+	add( BOOST_TEST_CASE( &TestPointView ) );
+	add( BOOST_TEST_CASE( &TestPackedCovariance ) );
+	add( BOOST_TEST_CASE( &TestErrorPose ) );
+	add( BOOST_TEST_CASE( &TestRandomEngine ) );
+	add( BOOST_TEST_CASE( &TestImageBatchLookup ) );
+	add( BOOST_TEST_CASE( &TestSharedExpression ) );
+	add( BOOST_TEST_CASE( &TestPoseSpline ) );
 }
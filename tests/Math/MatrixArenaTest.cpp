@@ -0,0 +1,121 @@
+#include <utMath/MatrixArena.h>
+#include <utMath/Matrix.h>
+
+#include "../tools.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#ifdef HAVE_LAPACK
+#include <boost/numeric/bindings/lapack/gesvd.hpp>
+#endif
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** runs scoped allocations on an own thread, which must not see the arena of others */
+void arenaWorker( const std::size_t n, bool& ok )
+{
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		MatrixArena::Scope arena;
+		ArenaMatrixd a( 10 + i % 7, 10 );
+		for ( std::size_t r = 0; r < a.size1(); r++ )
+			for ( std::size_t c = 0; c < a.size2(); c++ )
+				a( r, c ) = double( r * c + i );
+		const ArenaMatrixd b( ublas::prod( ublas::trans( a ), a ) );
+		if ( b( 0, 0 ) != double( i * i * a.size1() ) )
+			ok = false;
+	}
+}
+
+} // anonymous namespace
+
+
+void TestMatrixArena()
+{
+	// outside of a scope the heap is used
+	{
+		ArenaVectord v( 100 );
+		BOOST_CHECK( !MatrixArena::deallocate( &v( 0 ) ) );
+	}
+
+	const double* first;
+	{
+		MatrixArena::Scope arena;
+		BOOST_CHECK( MatrixArena::capacity() > 0 );
+
+		ArenaMatrixd a( 20, 30 );
+		randomMatrix( a );
+		first = &a( 0, 0 );
+		BOOST_CHECK_EQUAL( reinterpret_cast< std::size_t >( first ) % 16, 0u );
+
+		// arithmetic and assignment between arena and normal matrices
+		const Matrix< double > b( a );
+		ArenaMatrixd c( ublas::prod( ublas::trans( a ), b ) );
+		BOOST_CHECK_SMALL( matrixDiff( c, Matrix< double >( ublas::prod( ublas::trans( b ), b ) ) ), 1e-12 );
+
+		// inner scopes release only their own allocations
+		const double* inner;
+		{
+			MatrixArena::Scope innerArena;
+			ArenaVectord v( 10 );
+			inner = &v( 0 );
+		}
+		{
+			MatrixArena::Scope innerArena;
+			ArenaVectord v( 10 );
+			BOOST_CHECK( &v( 0 ) == inner );
+		}
+
+		// allocations larger than a block
+		ArenaMatrixd large( 300, 300, 1.0 );
+		BOOST_CHECK_EQUAL( large( 299, 299 ), 1.0 );
+		BOOST_CHECK( MatrixArena::capacity() >= 300 * 300 * sizeof( double ) );
+
+		// resizing reallocates within the arena
+		c.resize( 100, 100, false );
+		c( 99, 99 ) = 2.0;
+		BOOST_CHECK_EQUAL( c( 99, 99 ), 2.0 );
+	}
+
+	// the memory is reused by the next scope
+	{
+		MatrixArena::Scope arena;
+		ArenaMatrixd a( 20, 30 );
+		BOOST_CHECK( &a( 0, 0 ) == first );
+	}
+
+#ifdef HAVE_LAPACK
+	// arena types work with the lapack bindings
+	{
+		MatrixArena::Scope arena;
+		ArenaMatrixd a( 12, 5 );
+		randomMatrix( a );
+		Matrix< double > b( a );
+		ArenaVectord s( 5 );
+		Vector< double > sRef( 5 );
+		ArenaMatrixd u( 12, 12 ), vt( 5, 5 );
+		Matrix< double > uRef( 12, 12 ), vtRef( 5, 5 );
+		boost::numeric::bindings::lapack::gesvd( 'A', 'A', a, s, u, vt );
+		boost::numeric::bindings::lapack::gesvd( 'A', 'A', b, sRef, uRef, vtRef );
+		BOOST_CHECK_SMALL( vectorDiffSum( s, sRef ), 1e-10 );
+	}
+#endif
+
+	// every thread has an own arena
+	const unsigned nThreads = 4;
+	bool ok[ nThreads ];
+	boost::thread_group threads;
+	for ( unsigned i = 0; i < nThreads; i++ )
+	{
+		ok[ i ] = true;
+		threads.create_thread( boost::bind( &arenaWorker, 1000, boost::ref( ok[ i ] ) ) );
+	}
+	threads.join_all();
+	for ( unsigned i = 0; i < nThreads; i++ )
+		BOOST_CHECK( ok[ i ] );
+}
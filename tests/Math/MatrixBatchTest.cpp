@@ -0,0 +1,124 @@
+#include <utMath/MatrixBatch.h>
+#include <utMath/FixedDecomposition.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+template< typename T >
+void testMatrixBatch( const T epsilon )
+{
+	// not a multiple of the simd packs
+	const std::size_t n = 37;
+
+	std::vector< Matrix< T, 3, 4 > > a( n );
+	std::vector< Matrix< T, 4, 2 > > b( n );
+	std::vector< Matrix< T, 3, 2 > > c( n );
+	std::vector< Matrix< T, 5, 5 > > spd( n );
+	std::vector< Matrix< T, 5, 1 > > rhs( n );
+	for ( std::size_t k = 0; k < n; k++ )
+	{
+		randomMatrix( a[ k ] );
+		randomMatrix( b[ k ] );
+		randomMatrix( c[ k ] );
+		randomMatrix( rhs[ k ] );
+		Matrix< T, 5, 5 > r;
+		randomMatrix( r );
+		r *= T( 0.01 );
+		spd[ k ] = ublas::prod( ublas::trans( r ), r ) + Matrix< T, 5, 5 >::identity();
+	}
+
+	// conversion in both directions
+	const MatrixBatch< T, 3, 4 > batchA( a );
+	BOOST_REQUIRE_EQUAL( batchA.size(), n );
+	BOOST_CHECK_EQUAL( batchA( 5, 2, 1 ), a[ 5 ]( 2, 1 ) );
+	BOOST_CHECK_EQUAL( batchA.data( 2, 1 )[ 5 ], a[ 5 ]( 2, 1 ) );
+	std::vector< Matrix< T, 3, 4 > > copy;
+	batchA.toMatrices( copy );
+	BOOST_REQUIRE_EQUAL( copy.size(), n );
+	for ( std::size_t k = 0; k < n; k++ )
+		BOOST_CHECK_EQUAL( matrixDiff( copy[ k ], a[ k ] ), T( 0 ) );
+
+	// gemm and gemv
+	const MatrixBatch< T, 4, 2 > batchB( b );
+	MatrixBatch< T, 3, 2 > batchC( c );
+	batchGemm( batchA, batchB, batchC, T( 2 ), T( -1 ) );
+	MatrixBatch< T, 3, 2 > product;
+	batchGemm( batchA, batchB, product );
+	MatrixBatch< T, 3, 1 > y;
+	MatrixBatch< T, 4, 1 > x( n );
+	for ( std::size_t k = 0; k < n; k++ )
+		for ( std::size_t i = 0; i < 4; i++ )
+			x( k, i, 0 ) = b[ k ]( i, 1 );
+	batchGemv( batchA, x, y );
+	for ( std::size_t k = 0; k < n; k++ )
+	{
+		const Matrix< T, 3, 2 > ab( ublas::prod( a[ k ], b[ k ] ) );
+		const Matrix< T, 3, 2 > expected( T( 2 ) * ab - c[ k ] );
+		BOOST_CHECK_SMALL( matrixDiff( batchC[ k ], expected ), epsilon );
+		BOOST_CHECK_SMALL( matrixDiff( product[ k ], ab ), epsilon );
+		for ( std::size_t i = 0; i < 3; i++ )
+			BOOST_CHECK_CLOSE( y( k, i, 0 ), ab( i, 1 ), 100 * epsilon );
+	}
+
+	// cholesky decomposition and solve, one matrix is not positive definite
+	spd[ 11 ]( 2, 2 ) = -1;
+	MatrixBatch< T, 5, 5 > factors( spd );
+	std::vector< std::size_t > info;
+	BOOST_CHECK_EQUAL( batchCholesky( factors, &info ), 1u );
+	BOOST_REQUIRE_EQUAL( info.size(), n );
+	MatrixBatch< T, 5, 5 > solveFactors( spd );
+	MatrixBatch< T, 5, 1 > solutions( rhs );
+	BOOST_CHECK_EQUAL( batchCholeskySolve( solveFactors, solutions ), 1u );
+	for ( std::size_t k = 0; k < n; k++ )
+	{
+		Matrix< T, 5, 5 > l;
+		if ( k == 11 )
+		{
+			BOOST_CHECK( !cholesky( spd[ k ], l ) );
+			BOOST_CHECK( info[ k ] > 0 && info[ k ] <= 3 );
+			continue;
+		}
+		BOOST_CHECK_EQUAL( info[ k ], 0u );
+		BOOST_REQUIRE( cholesky( spd[ k ], l ) );
+		BOOST_CHECK_SMALL( matrixDiff( factors[ k ], l ), epsilon );
+
+		Vector< T, 5 > solution;
+		for ( std::size_t i = 0; i < 5; i++ )
+			solution( i ) = rhs[ k ]( i, 0 );
+		BOOST_REQUIRE( choleskySolve( spd[ k ], solution ) );
+		for ( std::size_t i = 0; i < 5; i++ )
+			BOOST_CHECK_SMALL( solutions( k, i, 0 ) - solution( i ), epsilon * ublas::norm_inf( solution ) );
+	}
+
+	// forward substitution only
+	MatrixBatch< T, 5, 1 > forward( rhs );
+	batchTriangularSolve( factors, forward );
+	MatrixBatch< T, 5, 1 > back;
+	batchGemm( factors, forward, back );
+	for ( std::size_t k = 0; k < n; k++ )
+		if ( k != 11 )
+			BOOST_CHECK_SMALL( matrixDiff( back[ k ], rhs[ k ] ), epsilon );
+
+	// resizing keeps the matrices
+	MatrixBatch< T, 3, 4 > resized( batchA );
+	resized.resize( n + 3 );
+	BOOST_CHECK_EQUAL( resized[ n - 1 ]( 1, 2 ), a[ n - 1 ]( 1, 2 ) );
+	BOOST_CHECK_EQUAL( resized[ n + 2 ]( 1, 2 ), T( 0 ) );
+	resized.clear();
+	BOOST_CHECK( resized.empty() );
+	BOOST_CHECK( resized.data( 0, 0 ) == 0 );
+}
+
+} // anonymous namespace
+
+void TestMatrixBatch()
+{
+	testMatrixBatch< float >( 1e-4f );
+	testMatrixBatch< double >( 1e-10 );
+}
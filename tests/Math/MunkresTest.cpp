@@ -0,0 +1,221 @@
+#include <utMath/Matrix.h>
+#include <utMath/Graph/Munkres.h>
+#include <utMath/Graph/SparseAssignment.h>
+#include <utMath/Random/Scalar.h>
+
+#include <set>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+typedef Graph::Munkres< double > Solver;
+
+/** best assignment by enumeration: most assigned rows first, then lowest cost */
+void bruteForce( const Matrix< double, 0, 0 >& costs, const double maxCost, std::size_t row, std::vector< bool >& usedCols,
+	std::size_t nAssigned, double cost, std::size_t& bestAssigned, double& bestCost )
+{
+	if ( row == costs.size1() )
+	{
+		if ( nAssigned > bestAssigned || ( nAssigned == bestAssigned && cost < bestCost ) )
+		{
+			bestAssigned = nAssigned;
+			bestCost = cost;
+		}
+		return;
+	}
+
+	bruteForce( costs, maxCost, row + 1, usedCols, nAssigned, cost, bestAssigned, bestCost );
+	for ( std::size_t col = 0; col < costs.size2(); col++ )
+		if ( !usedCols[ col ] && costs( row, col ) <= maxCost )
+		{
+			usedCols[ col ] = true;
+			bruteForce( costs, maxCost, row + 1, usedCols, nAssigned + 1, cost + costs( row, col ), bestAssigned, bestCost );
+			usedCols[ col ] = false;
+		}
+}
+
+/** checks that the match lists are consistent and returns the number of assigned rows */
+std::size_t checkAssignment( const Solver& solver, const Matrix< double, 0, 0 >& costs, const double maxCost )
+{
+	const std::vector< std::size_t > rowMatch( solver.getRowMatchList() );
+	const std::vector< std::size_t > colMatch( solver.getColMatchList() );
+	BOOST_REQUIRE_EQUAL( rowMatch.size(), costs.size1() );
+	BOOST_REQUIRE_EQUAL( colMatch.size(), costs.size2() );
+
+	const Matrix< double, 0, 0 > mask( solver.getMaskMatrix() );
+	std::size_t nAssigned = 0;
+	double cost = 0;
+	for ( std::size_t row = 0; row < costs.size1(); row++ )
+	{
+		if ( rowMatch[ row ] == Solver::unassigned )
+			continue;
+		BOOST_REQUIRE( rowMatch[ row ] < costs.size2() );
+		BOOST_CHECK_EQUAL( colMatch[ rowMatch[ row ] ], row );
+		BOOST_CHECK( costs( row, rowMatch[ row ] ) <= maxCost );
+		BOOST_CHECK_EQUAL( mask( row, rowMatch[ row ] ), 1.0 );
+		cost += costs( row, rowMatch[ row ] );
+		nAssigned++;
+	}
+	BOOST_CHECK_CLOSE( cost + 1, solver.getCost() + 1, 1e-9 );
+	return nAssigned;
+}
+
+void testAgainstBruteForce( const std::size_t nRows, const std::size_t nCols, const bool bGated )
+{
+	Matrix< double, 0, 0 > costs( nRows, nCols );
+	for ( std::size_t row = 0; row < nRows; row++ )
+		for ( std::size_t col = 0; col < nCols; col++ )
+			costs( row, col ) = Random::distribute_uniform< double >( 0, 10 );
+	const double maxCost = bGated ? 4.0 : 100.0;
+
+	std::vector< bool > usedCols( nCols, false );
+	std::size_t bestAssigned = 0;
+	double bestCost = 1e100;
+	bruteForce( costs, maxCost, 0, usedCols, 0, 0, bestAssigned, bestCost );
+
+	// dense input
+	Solver solver;
+	if ( bGated )
+		solver.setMatrix( costs, maxCost );
+	else
+		solver.setMatrix( costs );
+	solver.solve();
+	BOOST_CHECK_EQUAL( checkAssignment( solver, costs, maxCost ), bestAssigned );
+	BOOST_CHECK_CLOSE( solver.getCost() + 1, bestCost + 1, 1e-9 );
+
+	// the same pairs as sparse input
+	std::vector< Solver::Entry > entries;
+	for ( std::size_t row = 0; row < nRows; row++ )
+		for ( std::size_t col = 0; col < nCols; col++ )
+			if ( costs( row, col ) <= maxCost )
+				entries.push_back( Solver::Entry( row, col, costs( row, col ) ) );
+	solver.setSparseMatrix( nRows, nCols, entries );
+	solver.solve();
+	BOOST_CHECK_EQUAL( checkAssignment( solver, costs, maxCost ), bestAssigned );
+	BOOST_CHECK_CLOSE( solver.getCost() + 1, bestCost + 1, 1e-9 );
+}
+
+} // anonymous namespace
+
+
+void TestMunkres()
+{
+	// small problems of all shapes against enumeration
+	for ( std::size_t nRows = 1; nRows <= 6; nRows++ )
+		for ( std::size_t nCols = 1; nCols <= 6; nCols++ )
+			for ( std::size_t run = 0; run < 20; run++ )
+			{
+				testAgainstBruteForce( nRows, nCols, false );
+				testAgainstBruteForce( nRows, nCols, true );
+			}
+
+	// the classic example
+	{
+		Matrix< double, 0, 0 > costs( 3, 3 );
+		const double values[ 9 ] = { 1, 2, 3, 2, 4, 6, 3, 6, 9 };
+		for ( std::size_t i = 0; i < 9; i++ )
+			costs( i / 3, i % 3 ) = values[ i ];
+		Solver solver( costs );
+		solver.solve();
+		BOOST_CHECK_CLOSE( solver.getCost(), 10.0, 1e-9 );
+	}
+
+	// tracking: targets move a little between frames, the previous assignment is a warm start
+	{
+		const std::size_t nTargets = 150;
+		const std::size_t nBlobs = 200;
+		std::vector< double > targets( 2 * nTargets );
+		for ( std::size_t i = 0; i < targets.size(); i++ )
+			targets[ i ] = Random::distribute_uniform< double >( 0, 100 );
+
+		Solver solver;
+		Solver coldSolver;
+		std::vector< std::size_t > previous;
+		for ( std::size_t frame = 0; frame < 5; frame++ )
+		{
+			// blobs near the targets in shuffled order plus clutter
+			std::vector< double > blobs( 2 * nBlobs );
+			std::vector< std::size_t > order( nBlobs );
+			for ( std::size_t i = 0; i < nBlobs; i++ )
+				order[ i ] = ( i * 7 + frame ) % nBlobs;
+			for ( std::size_t i = 0; i < nBlobs; i++ )
+				for ( std::size_t k = 0; k < 2; k++ )
+					blobs[ 2 * order[ i ] + k ] = i < nTargets ? targets[ 2 * i + k ] + Random::distribute_uniform< double >( -0.5, 0.5 )
+						: Random::distribute_uniform< double >( 0, 100 );
+
+			Matrix< double, 0, 0 > costs( nTargets, nBlobs );
+			for ( std::size_t i = 0; i < nTargets; i++ )
+				for ( std::size_t j = 0; j < nBlobs; j++ )
+				{
+					const double dx = targets[ 2 * i ] - blobs[ 2 * j ];
+					const double dy = targets[ 2 * i + 1 ] - blobs[ 2 * j + 1 ];
+					costs( i, j ) = dx * dx + dy * dy;
+				}
+
+			solver.setMatrix( costs, 25.0 );
+			solver.solve( previous );
+			coldSolver.setMatrix( costs, 25.0 );
+			coldSolver.solve();
+			BOOST_CHECK_EQUAL( checkAssignment( solver, costs, 25.0 ), nTargets );
+			BOOST_CHECK_CLOSE( solver.getCost(), coldSolver.getCost(), 1e-9 );
+
+			previous = solver.getRowMatchList();
+			for ( std::size_t i = 0; i < nTargets; i++ )
+				for ( std::size_t k = 0; k < 2; k++ )
+					targets[ 2 * i + k ] = blobs[ 2 * previous[ i ] + k ];
+		}
+	}
+
+	// gated tracking problem split into components, against the monolithic sparse solve
+	{
+		const std::size_t nTargets = 400;
+		const std::size_t nBlobs = 450;
+		std::vector< Graph::SparseAssignment< double >::Entry > entries;
+		for ( std::size_t i = 0; i < nTargets; i++ )
+			for ( std::size_t j = 0; j < nBlobs; j++ )
+			{
+				// targets and blobs in clusters of about ten
+				const bool bSameCluster = i / 10 == j * nTargets / nBlobs / 10;
+				if ( bSameCluster && Random::distribute_uniform< double >( 0, 1 ) < 0.4 )
+					entries.push_back( Graph::SparseAssignment< double >::Entry( i, j, Random::distribute_uniform< double >( 0, 25 ) ) );
+			}
+
+		Solver solver;
+		solver.setSparseMatrix( nTargets, nBlobs, entries );
+		solver.solve();
+
+		Graph::SparseAssignment< double > assignment;
+		assignment.solve( nTargets, nBlobs, entries );
+		BOOST_CHECK( assignment.componentCount() >= nTargets / 10 );
+		BOOST_CHECK_CLOSE( assignment.getCost(), solver.getCost(), 1e-9 );
+
+		std::size_t nAssigned = 0;
+		std::size_t nSolverAssigned = 0;
+		std::set< std::pair< std::size_t, std::size_t > > allowed;
+		for ( std::size_t k = 0; k < entries.size(); k++ )
+			allowed.insert( std::make_pair( entries[ k ].row, entries[ k ].col ) );
+		for ( std::size_t i = 0; i < nTargets; i++ )
+		{
+			const std::size_t j = assignment.getRowMatchList()[ i ];
+			if ( solver.getRowMatchList()[ i ] != Solver::unassigned )
+				nSolverAssigned++;
+			if ( j == Graph::SparseAssignment< double >::unassigned )
+				continue;
+			nAssigned++;
+			BOOST_CHECK( allowed.count( std::make_pair( i, j ) ) == 1 );
+			BOOST_CHECK_EQUAL( assignment.getColMatchList()[ j ], i );
+		}
+		BOOST_CHECK_EQUAL( nAssigned, nSolverAssigned );
+
+		// the same with the components distributed over threads
+		Graph::SparseAssignment< double > parallelAssignment;
+		parallelAssignment.solve( nTargets, nBlobs, entries, threadExecutor( 4, 1 ) );
+		BOOST_CHECK_CLOSE( parallelAssignment.getCost(), solver.getCost(), 1e-9 );
+		BOOST_CHECK( parallelAssignment.getRowMatchList() == assignment.getRowMatchList() );
+	}
+}
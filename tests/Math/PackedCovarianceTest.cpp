@@ -0,0 +1,114 @@
+#include <utMath/ErrorPose.h>
+#include <utMath/ErrorVector.h>
+#include <utMath/PackedCovariance.h>
+#include <utMath/Stochastic/CovarianceTransform.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** random positive definite covariance */
+template< std::size_t N >
+Matrix< double, N, N > randomCovariance()
+{
+	Matrix< double, N, N > a;
+	randomMatrix( a );
+	Matrix< double, N, N > c( ublas::prod( a, ublas::trans( a ) ) );
+	return Matrix< double, N, N >( 1e-4 * c );
+}
+
+template< std::size_t N >
+double maxDifference( const Matrix< double, N, N >& a, const Matrix< double, N, N >& b )
+{
+	double d = 0;
+	for ( std::size_t i = 0; i < N; i++ )
+		for ( std::size_t j = 0; j < N; j++ )
+			d = std::max( d, std::fabs( a( i, j ) - b( i, j ) ) / ( 1 + std::fabs( a( i, j ) ) ) );
+	return d;
+}
+
+ErrorPose randomErrorPose()
+{
+	return ErrorPose( randomQuaternion(), randomVector< double, 3 >( 5.0 ), randomCovariance< 6 >() );
+}
+
+} // anonymous namespace
+
+
+void TestPackedCovariance()
+{
+	// storage and element access
+	BOOST_CHECK_EQUAL( ( PackedCovariance< float, 6 >::packedSize ), 21u );
+	BOOST_CHECK_EQUAL( ( PackedCovariance< double, 3 >::packedSize ), 6u );
+	BOOST_CHECK_EQUAL( sizeof( PackedCovariance< float, 6 > ), 21 * sizeof( float ) );
+
+	const Matrix< double, 6, 6 > c( randomCovariance< 6 >() );
+	const PackedCovariance< double, 6 > packed( c );
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < 6; j++ )
+			BOOST_CHECK_EQUAL( packed( i, j ), c( std::min( i, j ), std::max( i, j ) ) );
+	const std::size_t index24 = PackedCovariance< double, 6 >::index( 2, 4 );
+	BOOST_CHECK_EQUAL( packed.data()[ index24 ], c( 2, 4 ) );
+	BOOST_CHECK_EQUAL( packed.data()[ 20 ], c( 5, 5 ) );
+	BOOST_CHECK_SMALL( maxDifference( packed.matrix(), c ), 1e-15 );
+
+	PackedCovariance< double, 6 > modified( packed );
+	modified.set( 4, 1, 7.0 );
+	BOOST_CHECK_EQUAL( modified( 1, 4 ), 7.0 );
+	BOOST_CHECK_EQUAL( modified( 4, 1 ), 7.0 );
+
+	// the packed transform matches the full one
+	for ( std::size_t run = 0; run < 10; run++ )
+	{
+		Matrix< double, 3, 6 > J;
+		randomMatrix( J );
+		const Matrix< double, 6, 6 > C( randomCovariance< 6 >() );
+		Matrix< double, 3, 3 > full;
+		Stochastic::symmetricTransform( full, J, C );
+		PackedCovariance< double, 3 > result;
+		symmetricTransform( result, J, PackedCovariance< double, 6 >( C ) );
+		BOOST_CHECK_SMALL( maxDifference( result.matrix(), full ), 1e-12 );
+
+		addSymmetricTransform( result, J, PackedCovariance< double, 6 >( C ) );
+		BOOST_CHECK_SMALL( maxDifference( result.matrix(), Matrix< double, 3, 3 >( 2 * full ) ), 1e-12 );
+	}
+
+	// vectors with packed covariance
+	const ErrorVector< double, 3 > v( randomVector< double, 3 >( 5.0 ), randomCovariance< 3 >() );
+	const PackedErrorVector< double, 3, float > packedVector( v );
+	const ErrorVector< double, 3 > unpackedVector( packedVector.toErrorVector() );
+	BOOST_CHECK_EQUAL( unpackedVector.value( 1 ), v.value( 1 ) );
+	BOOST_CHECK_SMALL( maxDifference( unpackedVector.covariance, v.covariance ), 1e-6 );
+	BOOST_CHECK_EQUAL( packedVector.covariance( 2, 0 ), float( v.covariance( 0, 2 ) ) );
+
+	// pose operations give the same result as with full covariances
+	for ( std::size_t run = 0; run < 100; run++ )
+	{
+		const ErrorPose a( randomErrorPose() );
+		const ErrorPose b( randomErrorPose() );
+
+		const PackedErrorPose< double > pa( a );
+		const PackedErrorPose< double > pb( b );
+		BOOST_CHECK_SMALL( maxDifference( pa.covariance(), a.covariance() ), 1e-15 );
+
+		const ErrorPose product( a * b );
+		const PackedErrorPose< double > packedProduct( pa * pb );
+		BOOST_CHECK_SMALL( maxDifference( packedProduct.covariance(), product.covariance() ), 1e-10 );
+		BOOST_CHECK_SMALL( vectorDiffSum( packedProduct.translation(), product.translation() ), 1e-12 );
+
+		const ErrorPose relative( invertMultiply( a, b ) );
+		const ErrorPose packedRelative( invertMultiply( pa, pb ).toErrorPose() );
+		BOOST_CHECK_SMALL( maxDifference( packedRelative.covariance(), relative.covariance() ), 1e-10 );
+		BOOST_CHECK_SMALL( quaternionDiff( packedRelative.rotation(), relative.rotation() ), 1e-12 );
+
+		// float storage keeps single precision
+		const PackedErrorPose< float > fa( a );
+		const PackedErrorPose< float > fb( b );
+		BOOST_CHECK_SMALL( maxDifference( ( fa * fb ).covariance(), product.covariance() ), 1e-5 );
+	}
+}
@@ -0,0 +1,108 @@
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/PointCloud.h>
+#include <utMath/Geometry/PointBatch.h>
+#include <utMath/Geometry/PointProjection.h>
+#include <utMath/Geometry/PointTransformation.h>
+#include <utMath/Stochastic/k_means.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+template< typename T >
+void testPointCloud( const T epsilon )
+{
+	const std::size_t n = 37;
+	std::vector< Vector< T, 3 > > points;
+	for ( std::size_t i = 0; i < n; i++ )
+		points.push_back( randomVector< T, 3 >( 10 ) + Vector< T, 3 >( 0, 0, 20 ) );
+
+	// conversion in both directions
+	PointCloud< T, 3 > cloud( points );
+	BOOST_REQUIRE_EQUAL( cloud.size(), n );
+	BOOST_CHECK_EQUAL( cloud( 5, 1 ), points[ 5 ]( 1 ) );
+	BOOST_CHECK_EQUAL( cloud.data( 2 )[ 7 ], points[ 7 ]( 2 ) );
+	std::vector< Vector< T, 3 > > back;
+	cloud.toVectors( back );
+	BOOST_REQUIRE_EQUAL( back.size(), n );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK( vectorEqual( back[ i ], points[ i ] ) );
+
+	// iterators
+	BOOST_CHECK_EQUAL( std::size_t( std::distance( cloud.begin(), cloud.end() ) ), n );
+	BOOST_CHECK( vectorEqual( *( cloud.begin() + 3 ), points[ 3 ] ) );
+	BOOST_CHECK( vectorEqual( cloud.end()[ -1 ], points.back() ) );
+	PointCloud< T, 3 > copy( cloud.begin(), cloud.end() );
+	BOOST_CHECK( vectorEqual( copy[ n - 1 ], points.back() ) );
+
+	// modification
+	cloud.set( 2, Vector< T, 3 >( 1, 2, 3 ) );
+	BOOST_CHECK_EQUAL( cloud( 2, 2 ), T( 3 ) );
+	cloud.push_back( points[ 0 ] );
+	BOOST_CHECK_EQUAL( cloud.size(), n + 1 );
+	cloud.clear();
+	BOOST_CHECK( cloud.empty() );
+	BOOST_CHECK( cloud.data( 0 ) == 0 );
+
+	// batch kernels on the clouds match the iterator versions
+	Matrix< T, 3, 4 > P;
+	randomMatrix( P );
+	P( 2, 3 ) += 100;
+	std::vector< Vector< T, 2 > > projected;
+	Geometry::project_points( P, points.begin(), points.end(), std::back_inserter( projected ) );
+	PointCloud< T, 2 > image;
+	Geometry::project_points( P, PointCloud< T, 3 >( points ), image );
+	BOOST_REQUIRE_EQUAL( image.size(), n );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( vectorDiff( image[ i ], projected[ i ] ), epsilon );
+
+	Matrix< T, 3, 3 > H;
+	randomMatrix( H );
+	H( 2, 2 ) += 100;
+	std::vector< Vector< T, 2 > > projected2;
+	Geometry::project_points( H, projected.begin(), projected.end(), std::back_inserter( projected2 ) );
+	Geometry::project_points( H, image, image );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( vectorDiff( image[ i ], projected2[ i ] ), epsilon );
+
+	std::vector< Vector< T, 3 > > transformed;
+	Geometry::transform_points( P, points.begin(), points.end(), std::back_inserter( transformed ) );
+	PointCloud< T, 3 > moved( points );
+	Geometry::transform_points( P, moved, moved );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( vectorDiff( moved[ i ], transformed[ i ] ), epsilon );
+}
+
+} // anonymous namespace
+
+
+void TestPointCloud()
+{
+	testPointCloud< double >( 1e-10 );
+	testPointCloud< float >( 1e-3f );
+
+	// clustering reads the points from the cloud
+	PointCloud< double, 2 > cloud;
+	for ( std::size_t i = 0; i < 50; i++ )
+	{
+		cloud.push_back( Vector< double, 2 >( random( -0.1, 0.1 ), random( -0.1, 0.1 ) ) );
+		cloud.push_back( Vector< double, 2 >( 10 + random( -0.1, 0.1 ), random( -0.1, 0.1 ) ) );
+	}
+	std::vector< Vector< double, 2 > > centroids;
+	std::vector< std::size_t > indices;
+	Stochastic::k_means( cloud, 2, std::back_inserter( centroids ), std::back_inserter( indices ) );
+	BOOST_REQUIRE_EQUAL( centroids.size(), 2u );
+	BOOST_REQUIRE_EQUAL( indices.size(), cloud.size() );
+	for ( std::size_t i = 0; i < cloud.size(); i += 2 )
+		BOOST_CHECK( indices[ i ] != indices[ i + 1 ] );
+	BOOST_CHECK_SMALL( std::min( centroids[ 0 ]( 0 ), centroids[ 1 ]( 0 ) ), 0.1 );
+	BOOST_CHECK_CLOSE( std::max( centroids[ 0 ]( 0 ), centroids[ 1 ]( 0 ) ), 10.0, 1.0 );
+}
@@ -0,0 +1,78 @@
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Pose.h>
+#include <utMath/PointView.h>
+#include <utMath/Geometry/PointTransformation.h>
+
+#include <vector>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+void TestPointView()
+{
+	const std::size_t n = 11;
+	std::vector< Vector< double, 3 > > points;
+	for ( std::size_t i = 0; i < n; i++ )
+		points.push_back( randomVector< double, 3 >( 10 ) );
+
+	// interleaved x, y, z, like an array of cv::Point3d or an Eigen::Matrix3Xd
+	std::vector< double > interleaved;
+	// one array per coordinate, like a column major Eigen::Matrix< double, Dynamic, 3 >
+	std::vector< double > planar( 3 * n );
+	// interleaved with padding, like an array of cv::Vec4f
+	std::vector< float > padded;
+	for ( std::size_t i = 0; i < n; i++ )
+		for ( std::size_t c = 0; c < 3; c++ )
+		{
+			interleaved.push_back( points[ i ]( c ) );
+			planar[ c * n + i ] = points[ i ]( c );
+			padded.push_back( static_cast< float >( points[ i ]( c ) ) );
+			if ( c == 2 )
+				padded.push_back( -1.0f );
+		}
+
+	const PointView3d views[] = {
+		PointView3d( &interleaved[ 0 ], n ),
+		PointView3d( &planar[ 0 ], n, 1, n ),
+		PointView3d( points )
+	};
+	for ( std::size_t v = 0; v < 3; v++ )
+	{
+		BOOST_REQUIRE_EQUAL( views[ v ].size(), n );
+		for ( std::size_t i = 0; i < n; i++ )
+			BOOST_CHECK( vectorEqual( views[ v ][ i ], points[ i ] ) );
+		BOOST_CHECK_EQUAL( views[ v ]( 4, 2 ), points[ 4 ]( 2 ) );
+		BOOST_CHECK( vectorEqual( *( views[ v ].end() - 1 ), points.back() ) );
+	}
+
+	const PointView3f floats( &padded[ 0 ], n, 4 );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( vectorDiff( floats[ i ], Vector< float, 3 >( points[ i ]( 0 ), points[ i ]( 1 ), points[ i ]( 2 ) ) ), 1e-5f );
+
+	// iterator based algorithms read the views in place
+	std::vector< Vector< double, 3 > > copied( views[ 1 ].begin(), views[ 1 ].end() );
+	BOOST_CHECK( vectorEqual( copied[ 7 ], points[ 7 ] ) );
+	BOOST_CHECK( PointView3d().empty() );
+
+	// poses are stored as homogeneous matrices, row or column major
+	const Pose pose( Quaternion( 0.2, -0.4, 0.1, 0.9 ).normalize(), Vector< double, 3 >( 1, 2, 3 ) );
+	const Matrix< double, 4, 4 > expected( pose );
+	double rowMajor[ 16 ];
+	float colMajor[ 16 ];
+	double rt[ 12 ];
+	storePose( pose, rowMajor );
+	storePose( pose, colMajor, 1, 4 );
+	storePose( pose, rt, 4, 1, 3 );
+	for ( std::size_t r = 0; r < 4; r++ )
+		for ( std::size_t c = 0; c < 4; c++ )
+		{
+			BOOST_CHECK_SMALL( rowMajor[ r * 4 + c ] - expected( r, c ), 1e-12 );
+			BOOST_CHECK_SMALL( colMajor[ c * 4 + r ] - float( expected( r, c ) ), 1e-6f );
+			if ( r < 3 )
+				BOOST_CHECK_EQUAL( rt[ r * 4 + c ], rowMajor[ r * 4 + c ] );
+		}
+}
@@ -0,0 +1,177 @@
+#include <utMath/PoseListOperations.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utUtil/Exception.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+double poseDiff( const Pose& a, const Pose& b )
+{
+	return quaternionDiff( a.rotation(), b.rotation() ) + vectorDiffSum( a.translation(), b.translation() );
+}
+
+void testPoseLists( const std::size_t n, const ListExecutor& executor )
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -10, 10 );
+	const double epsilon = 1e-10;
+
+	const Pose p( randQuat(), randVector() );
+	std::vector< Pose > x, y;
+	std::vector< Vector< double, 3 > > positions, positions2;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		x.push_back( Pose( randQuat(), randVector() ) );
+		y.push_back( Pose( randQuat(), randVector() ) );
+		positions.push_back( randVector() );
+		positions2.push_back( randVector() );
+	}
+
+	std::vector< Pose > result;
+	multiplyPoseList( p, x, result, executor );
+	BOOST_REQUIRE_EQUAL( result.size(), n );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( poseDiff( result[ i ], p * x[ i ] ), epsilon );
+
+	// the result is reused without reallocation
+	const Pose* storage = result.empty() ? 0 : &result[ 0 ];
+	multiplyPoseList( x, p, result, executor );
+	BOOST_CHECK( result.empty() || &result[ 0 ] == storage );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( poseDiff( result[ i ], x[ i ] * p ), epsilon );
+
+	invertPoseList( x, result, executor );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( poseDiff( result[ i ], ~x[ i ] ), epsilon );
+
+	interpolatePoseList( x, y, 0.3, result, executor );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( poseDiff( result[ i ], linearInterpolate( x[ i ], y[ i ], 0.3 ) ), epsilon );
+
+	// the fast interpolation stays close to slerp, also on the longer path and for equal rotations
+	std::vector< Quaternion > qx, qy, slerped, fast;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		qx.push_back( x[ i ].rotation() );
+		qy.push_back( i % 3 == 0 ? Quaternion( -x[ i ].rotation() ) : y[ i ].rotation() );
+	}
+	for ( double t = 0; t <= 1.0; t += 0.25 )
+	{
+		interpolateQuaternionList( qx, qy, t, slerped, executor );
+		interpolateQuaternionList( qx, qy, t, fast, executor, fastInterpolation );
+		BOOST_REQUIRE_EQUAL( fast.size(), n );
+		for ( std::size_t i = 0; i < n; i++ )
+		{
+			BOOST_CHECK_SMALL( quaternionDiff( slerped[ i ], slerp( qx[ i ], qy[ i ], t ) ), epsilon );
+			const double d = std::fabs( slerped[ i ].x() * fast[ i ].x() + slerped[ i ].y() * fast[ i ].y()
+				+ slerped[ i ].z() * fast[ i ].z() + slerped[ i ].w() * fast[ i ].w() );
+			BOOST_CHECK_SMALL( 2 * std::acos( std::min( d, 1.0 ) ), 1e-3 );
+		}
+	}
+
+	// in place
+	std::vector< Pose > inPlace( x );
+	invertPoseList( inPlace, inPlace, executor );
+	invertPoseList( inPlace, inPlace, executor );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( poseDiff( inPlace[ i ], x[ i ] ), epsilon );
+
+	std::vector< Vector< double, 3 > > transformed;
+	transformPositionList( p, positions, transformed, executor );
+	BOOST_REQUIRE_EQUAL( transformed.size(), n );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( vectorDiffSum( transformed[ i ], p * positions[ i ] ), epsilon );
+
+	std::vector< double > d;
+	positionDistances( positions, positions2, d, executor );
+	BOOST_REQUIRE_EQUAL( d.size(), n );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( d[ i ] - boost::numeric::ublas::norm_2( positions[ i ] - positions2[ i ] ), epsilon );
+
+	positionDistances( x, y, d, executor );
+	for ( std::size_t i = 0; i < n; i++ )
+		BOOST_CHECK_SMALL( d[ i ] - boost::numeric::ublas::norm_2( x[ i ].translation() - y[ i ].translation() ), epsilon );
+}
+
+} // anonymous namespace
+
+
+void TestPoseListOperations()
+{
+	// block boundaries and the scalar tail
+	testPoseLists( 0, ListExecutor() );
+	testPoseLists( 1, ListExecutor() );
+	testPoseLists( 257, ListExecutor() );
+	testPoseLists( 1000, threadExecutor( 4, 100 ) );
+	testPoseLists( 3, threadExecutor( 4, 1 ) );
+
+	std::vector< Pose > a( 3 ), b( 4 ), result;
+	BOOST_CHECK_THROW( interpolatePoseList( a, b, 0.5, result ), Ubitrack::Util::Exception );
+	std::vector< Quaternion > qa( 3 ), qb( 4 ), qResult;
+	BOOST_CHECK_THROW( interpolateQuaternionList( qa, qb, 0.5, qResult ), Ubitrack::Util::Exception );
+}
+
+
+void TestRotationListConversions()
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randAngles( -3, 3 );
+	const double epsilon = 1e-10;
+
+	// include rotations by 180 degrees around all axes, for every case of the matrix conversion
+	std::vector< Quaternion > q;
+	q.push_back( Quaternion( 1, 0, 0, 0 ) );
+	q.push_back( Quaternion( 0, 1, 0, 0 ) );
+	q.push_back( Quaternion( 0, 0, 1, 0 ) );
+	q.push_back( Quaternion( 0, 0, 0, 1 ) );
+	std::vector< Vector< double, 3 > > angles;
+	for ( std::size_t i = 0; i < 600; i++ )
+	{
+		q.push_back( randQuat() );
+		angles.push_back( randAngles() );
+	}
+
+	std::vector< Matrix< double, 3, 3 > > m;
+	quaternionsToMatrices( q, m, threadExecutor( 2, 100 ) );
+	BOOST_REQUIRE_EQUAL( m.size(), q.size() );
+	for ( std::size_t i = 0; i < q.size(); i++ )
+		BOOST_CHECK_SMALL( matrixDiff( m[ i ], Matrix< double, 3, 3 >( q[ i ] ) ), epsilon );
+
+	std::vector< Quaternion > back;
+	matricesToQuaternions( m, back );
+	BOOST_REQUIRE_EQUAL( back.size(), q.size() );
+	for ( std::size_t i = 0; i < q.size(); i++ )
+	{
+		BOOST_CHECK_SMALL( quaternionDiff( back[ i ], q[ i ] ), epsilon );
+		BOOST_CHECK_SMALL( quaternionDiff( back[ i ], Quaternion( Matrix< double, 0, 0 >( m[ i ] ) ) ), epsilon );
+		BOOST_CHECK( back[ i ].w() >= 0 );
+	}
+
+	std::vector< Quaternion > euler;
+	eulerAnglesToQuaternions( angles, euler );
+	BOOST_REQUIRE_EQUAL( euler.size(), angles.size() );
+	for ( std::size_t i = 0; i < angles.size(); i++ )
+		BOOST_CHECK_SMALL( quaternionDiff( euler[ i ], Quaternion( angles[ i ]( 0 ), angles[ i ]( 1 ), angles[ i ]( 2 ) ) ), epsilon );
+
+	std::vector< Vector< double, 3 > > logs;
+	quaternionLogarithms( q, logs );
+	std::vector< Quaternion > exps;
+	quaternionsFromLogarithms( logs, exps, threadExecutor( 3, 1 ) );
+	BOOST_REQUIRE_EQUAL( exps.size(), q.size() );
+	for ( std::size_t i = 0; i < q.size(); i++ )
+	{
+		BOOST_CHECK_SMALL( vectorDiffSum( logs[ i ], q[ i ].toLogarithm() ), epsilon );
+		BOOST_CHECK_SMALL( quaternionDiff( exps[ i ], q[ i ] ), 1e-8 );
+	}
+
+	// empty lists
+	std::vector< Quaternion > none;
+	quaternionsToMatrices( none, m );
+	BOOST_CHECK( m.empty() );
+}
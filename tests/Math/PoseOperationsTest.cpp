@@ -0,0 +1,100 @@
+#include <utMath/PoseOperations.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** reference implementation of the pose product on boost::math::quaternion and ublas */
+Pose referenceMultiply( const Pose& a, const Pose& b )
+{
+	return Pose( Quaternion( a.rotation() * b.rotation() )
+		, Vector< double, 3 >( a.rotation() * b.translation() + a.translation() ) );
+}
+
+Pose referenceInvert( const Pose& p )
+{
+	const Quaternion rinv( ~p.rotation() );
+	return Pose( rinv, Vector< double, 3 >( -( rinv * p.translation() ) ) );
+}
+
+double poseDiff( const Pose& a, const Pose& b )
+{
+	return quaternionDiff( a.rotation(), b.rotation() ) + vectorDiffSum( a.translation(), b.translation() );
+}
+
+} // anonymous namespace
+
+
+void TestPoseOperations()
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -10, 10 );
+	const double epsilon = 1e-10;
+
+	for ( std::size_t n = 0; n < 1000; n++ )
+	{
+		const Pose a( randQuat(), randVector() );
+		const Pose b( randQuat(), randVector() );
+		const Vector< double, 3 > x( randVector() );
+
+		BOOST_CHECK_SMALL( poseDiff( a * b, referenceMultiply( a, b ) ), epsilon );
+		BOOST_CHECK_SMALL( poseDiff( ~a, referenceInvert( a ) ), epsilon );
+		BOOST_CHECK_SMALL( vectorDiffSum( a * x, Vector< double, 3 >( a.rotation() * x + a.translation() ) ), epsilon );
+		BOOST_CHECK_SMALL( poseDiff( invertMultiply( a, b ), referenceMultiply( referenceInvert( a ), b ) ), epsilon );
+		BOOST_CHECK_SMALL( poseDiff( multiplyInvert( a, b ), referenceMultiply( a, referenceInvert( b ) ) ), epsilon );
+
+		// results may alias the arguments
+		Pose c( a );
+		multiply( c, b, c );
+		BOOST_CHECK_SMALL( poseDiff( c, referenceMultiply( a, b ) ), epsilon );
+		c = b;
+		invertMultiply( a, c, c );
+		BOOST_CHECK_SMALL( poseDiff( c, referenceMultiply( referenceInvert( a ), b ) ), epsilon );
+		invert( c, c );
+		BOOST_CHECK_SMALL( poseDiff( c, referenceInvert( referenceMultiply( referenceInvert( a ), b ) ) ), epsilon );
+	}
+
+	// batch transformations
+	const Pose p( randQuat(), randVector() );
+	std::vector< Vector< double, 3 > > points;
+	std::vector< Pose > poses;
+	for ( std::size_t i = 0; i < 100; i++ )
+	{
+		points.push_back( randVector() );
+		poses.push_back( Pose( randQuat(), randVector() ) );
+	}
+
+	std::vector< Vector< double, 3 > > transformed;
+	transformPoints( p, points, transformed );
+	BOOST_REQUIRE_EQUAL( transformed.size(), points.size() );
+	for ( std::size_t i = 0; i < points.size(); i++ )
+		BOOST_CHECK_SMALL( vectorDiffSum( transformed[ i ], Vector< double, 3 >( p.rotation() * points[ i ] + p.translation() ) ), epsilon );
+
+	std::vector< Pose > left, right;
+	multiplyPoses( p, poses, left );
+	multiplyPoses( poses, p, right );
+	BOOST_REQUIRE_EQUAL( left.size(), poses.size() );
+	BOOST_REQUIRE_EQUAL( right.size(), poses.size() );
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+	{
+		BOOST_CHECK_SMALL( poseDiff( left[ i ], referenceMultiply( p, poses[ i ] ) ), epsilon );
+		BOOST_CHECK_SMALL( poseDiff( right[ i ], referenceMultiply( poses[ i ], p ) ), epsilon );
+	}
+
+	// in place
+	multiplyPoses( p, poses, poses );
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+		BOOST_CHECK_SMALL( poseDiff( poses[ i ], left[ i ] ), epsilon );
+	transformPoints( p, points, points );
+	for ( std::size_t i = 0; i < points.size(); i++ )
+		BOOST_CHECK_SMALL( vectorDiffSum( points[ i ], transformed[ i ] ), epsilon );
+
+	multiplyPoses( p, std::vector< Pose >(), poses );
+	BOOST_CHECK( poses.empty() );
+}
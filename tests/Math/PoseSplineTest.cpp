@@ -0,0 +1,103 @@
+#include <utMath/PoseSpline.h>
+#include <utMath/Blas1.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utUtil/Exception.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+double rotationAngle( const Quaternion& a, const Quaternion& b )
+{ return ublas::norm_2( Quaternion( ~a * b ).toLogarithm() ); }
+
+} // anonymous namespace
+
+void TestPoseSpline()
+{
+	const double t0 = 2.0;
+	const double dt = 0.1;
+	const Vector< double, 3 > p0( 1, -2, 0.5 );
+	const Vector< double, 3 > v( 0.3, 0.2, -1.0 );
+	const Vector< double, 3 > w( 0.5, -1.0, 2.0 );
+
+	// linear motion and constant angular velocity are reproduced exactly
+	std::vector< Pose > control;
+	for ( int k = 0; k < 8; k++ )
+		control.push_back( Pose( Quaternion::fromLogarithm( Vector< double, 3 >( w * ( ( k - 1 ) * dt ) ) ),
+			Vector< double, 3 >( p0 + v * ( ( k - 1 ) * dt ) ) ) );
+	const PoseSpline linear( t0, dt, control );
+	BOOST_CHECK_CLOSE( linear.endTime(), t0 + 5 * dt, 1e-9 );
+
+	for ( double t = t0; t <= linear.endTime(); t += 0.0137 )
+	{
+		Pose pose;
+		Vector< double, 3 > vel, acc, angVel, angAcc;
+		linear.evaluate( t, pose, vel, acc, angVel, angAcc );
+		BOOST_CHECK_SMALL( ublas::norm_2( pose.translation() - ( p0 + v * ( t - t0 ) ) ), 1e-9 );
+		BOOST_CHECK_SMALL( rotationAngle( pose.rotation(), Quaternion::fromLogarithm( Vector< double, 3 >( w * ( t - t0 ) ) ) ), 1e-9 );
+		BOOST_CHECK_SMALL( ublas::norm_2( vel - v ), 1e-9 );
+		BOOST_CHECK_SMALL( ublas::norm_2( acc ), 1e-7 );
+		BOOST_CHECK_SMALL( ublas::norm_2( angVel - w ), 1e-9 );
+		BOOST_CHECK_SMALL( ublas::norm_2( angAcc ), 1e-7 );
+	}
+
+	// derivatives of a random spline agree with finite differences
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	control[ 0 ] = Pose( Random::Quaternion< double >::Uniform()(), randVector() );
+	for ( std::size_t k = 1; k < control.size(); k++ )
+		control[ k ] = Pose( control[ k - 1 ].rotation() * Quaternion::fromLogarithm( Vector< double, 3 >( 0.5 * randVector() ) ),
+			Vector< double, 3 >( control[ k - 1 ].translation() + 0.2 * randVector() ) );
+	const PoseSpline spline( t0, dt, control );
+	const double h = 1e-5;
+	for ( double t = t0 + 0.01; t < spline.endTime() - 0.01; t += 0.0371 )
+	{
+		Pose pose, before, after;
+		Vector< double, 3 > vel, acc, angVel, angAcc, velBefore, velAfter, dummy, angVelBefore, angVelAfter;
+		spline.evaluate( t, pose, vel, acc, angVel, angAcc );
+		spline.evaluate( t - h, before, velBefore, dummy, angVelBefore, dummy );
+		spline.evaluate( t + h, after, velAfter, dummy, angVelAfter, dummy );
+
+		BOOST_CHECK_SMALL( ublas::norm_2( spline.evaluate( t ).translation() - pose.translation() ), 1e-12 );
+		BOOST_CHECK_SMALL( ublas::norm_2( vel - ( after.translation() - before.translation() ) / ( 2 * h ) ), 1e-4 );
+		BOOST_CHECK_SMALL( ublas::norm_2( acc - ( velAfter - velBefore ) / ( 2 * h ) ), 1e-3 );
+		const Vector< double, 3 > angVelNumeric( Quaternion( ~before.rotation() * after.rotation() ).toLogarithm() / ( 2 * h ) );
+		BOOST_CHECK_SMALL( ublas::norm_2( angVel - angVelNumeric ), 1e-3 );
+		BOOST_CHECK_SMALL( ublas::norm_2( angAcc - ( angVelAfter - angVelBefore ) / ( 2 * h ) ), 1e-2 );
+	}
+
+	// batch evaluation and clamping
+	std::vector< double > times;
+	for ( double t = t0 - 0.05; t < spline.endTime() + 0.05; t += 0.01 )
+		times.push_back( t );
+	std::vector< Pose > batch;
+	spline.evaluate( times, batch );
+	BOOST_CHECK_EQUAL( batch.size(), times.size() );
+	for ( std::size_t i = 0; i < times.size(); i++ )
+		BOOST_CHECK( batch[ i ] == spline.evaluate( times[ i ] ) );
+	BOOST_CHECK( spline.evaluate( t0 - 1 ) == spline.evaluate( t0 ) );
+
+	BOOST_CHECK_THROW( PoseSpline( t0, dt, std::vector< Pose >( 3 ) ), Ubitrack::Util::Exception );
+	BOOST_CHECK_THROW( PoseSpline( t0, 0, control ), Ubitrack::Util::Exception );
+
+#ifdef HAVE_LAPACK
+	// fitting samples of a smooth spline with the same knots recovers it
+	std::vector< Pose > samples;
+	times.clear();
+	for ( double t = t0; t <= spline.endTime() + 1e-9; t += 0.01 )
+		times.push_back( t );
+	spline.evaluate( times, samples );
+	const PoseSpline fitted( PoseSpline::fit( times, samples, dt, 20 ) );
+	BOOST_CHECK_CLOSE( fitted.endTime(), spline.endTime(), 1e-6 );
+	for ( std::size_t i = 0; i < times.size(); i++ )
+	{
+		const Pose p( fitted.evaluate( times[ i ] ) );
+		BOOST_CHECK_SMALL( ublas::norm_2( p.translation() - samples[ i ].translation() ), 1e-6 );
+		BOOST_CHECK_SMALL( rotationAngle( p.rotation(), samples[ i ].rotation() ), 1e-5 );
+	}
+#endif
+}
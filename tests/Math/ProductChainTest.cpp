@@ -0,0 +1,83 @@
+#include <utMath/ProductChain.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+template< typename T, std::size_t M, std::size_t K, std::size_t L, std::size_t N >
+void testChain3( const T epsilon )
+{
+	for ( std::size_t n = 0; n < 20; n++ )
+	{
+		Matrix< T, M, K > a;
+		Matrix< T, K, L > b;
+		Matrix< T, L, N > c;
+		randomMatrix( a );
+		randomMatrix( b );
+		randomMatrix( c );
+
+		const Matrix< T, M, L > ab( ublas::prod( a, b ) );
+		const Matrix< T, M, N > ref( ublas::prod( ab, c ) );
+		BOOST_CHECK_SMALL( matrixDiff( ref, productChain( a, b, c ) ), epsilon );
+
+		Vector< T, L > x( randomVector< T, L >( 100 ) );
+		const Vector< T, M > refx( ublas::prod( ab, x ) );
+		BOOST_CHECK_SMALL( vectorDiffSum( refx, productChain( a, b, x ) ) / ublas::norm_2( refx ), epsilon );
+	}
+}
+
+template< typename T, std::size_t M, std::size_t K, std::size_t L, std::size_t P, std::size_t N >
+void testChain4( const T epsilon )
+{
+	for ( std::size_t n = 0; n < 20; n++ )
+	{
+		Matrix< T, M, K > a;
+		Matrix< T, K, L > b;
+		Matrix< T, L, P > c;
+		Matrix< T, P, N > d;
+		randomMatrix( a );
+		randomMatrix( b );
+		randomMatrix( c );
+		randomMatrix( d );
+
+		const Matrix< T, M, L > ab( ublas::prod( a, b ) );
+		const Matrix< T, M, P > abc( ublas::prod( ab, c ) );
+		const Matrix< T, M, N > ref( ublas::prod( abc, d ) );
+		Matrix< T, M, N > result;
+		productChainInto( a, b, c, d, result );
+		BOOST_CHECK_SMALL( matrixDiff( ref, result ), epsilon );
+
+		Vector< T, P > x( randomVector< T, P >( 100 ) );
+		const Vector< T, M > refx( ublas::prod( abc, x ) );
+		BOOST_CHECK_SMALL( vectorDiffSum( refx, productChain( a, b, c, x ) ) / ublas::norm_2( refx ), epsilon );
+	}
+}
+
+} // anonymous namespace
+
+
+void TestProductChain()
+{
+	// association orders chosen at compile time
+	BOOST_CHECK( !( ChainOrder3< 3, 3, 4, 4 >::rightFirst ) );
+	BOOST_CHECK( ( ChainOrder3< 3, 3, 4, 1 >::rightFirst ) );
+	BOOST_CHECK_EQUAL( std::size_t( ChainOrder3< 2, 3, 4, 1 >::cost ), 18u );
+	BOOST_CHECK_EQUAL( std::size_t( ChainOrder4< 3, 3, 3, 4, 1 >::split ), 1u );
+	BOOST_CHECK_EQUAL( std::size_t( ChainOrder4< 1, 4, 4, 4, 4 >::split ), 3u );
+	BOOST_CHECK_EQUAL( std::size_t( ChainOrder4< 4, 4, 1, 4, 4 >::split ), 2u );
+
+	testChain3< double, 3, 3, 4, 4 >( 1e-12 );
+	testChain3< double, 2, 3, 4, 1 >( 1e-12 );
+	testChain3< double, 3, 4, 4, 6 >( 1e-12 );
+	testChain3< float, 3, 3, 3, 3 >( 1e-5f );
+
+	testChain4< double, 3, 3, 3, 4, 4 >( 1e-12 );
+	testChain4< double, 1, 4, 4, 4, 4 >( 1e-12 );
+	testChain4< double, 4, 4, 1, 4, 4 >( 1e-12 );
+	testChain4< double, 2, 2, 3, 4, 1 >( 1e-12 );
+}
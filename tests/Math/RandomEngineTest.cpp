@@ -0,0 +1,131 @@
+#include <utMath/Random/Engine.h>
+#include <utMath/Random/Scalar.h>
+
+#include <cmath>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+template< typename T >
+void meanAndDeviation( const std::vector< T >& v, double& mean, double& deviation )
+{
+	double sum = 0;
+	double sum2 = 0;
+	for ( std::size_t i = 0; i < v.size(); i++ )
+	{
+		sum += v[ i ];
+		sum2 += double( v[ i ] ) * v[ i ];
+	}
+	mean = sum / v.size();
+	deviation = std::sqrt( sum2 / v.size() - mean * mean );
+}
+
+template< typename T >
+void testBulk( Random::Engine& engine )
+{
+	// an odd number exercises the remainders
+	std::vector< T > values( 100001 );
+	engine.uniform( &values[ 0 ], values.size(), T( -2 ), T( 4 ) );
+	double mean, deviation;
+	meanAndDeviation( values, mean, deviation );
+	BOOST_CHECK_SMALL( mean - 1.0, 0.03 );
+	BOOST_CHECK_SMALL( deviation - 6.0 / std::sqrt( 12.0 ), 0.03 );
+	BOOST_CHECK( *std::min_element( values.begin(), values.end() ) >= T( -2 ) );
+	BOOST_CHECK( *std::max_element( values.begin(), values.end() ) < T( 4 ) );
+
+	engine.normal( &values[ 0 ], values.size(), T( 3 ), T( 0.5 ) );
+	meanAndDeviation( values, mean, deviation );
+	BOOST_CHECK_SMALL( mean - 3.0, 0.01 );
+	BOOST_CHECK_SMALL( deviation - 0.5, 0.01 );
+
+	// about 4.6 % beyond two standard deviations
+	std::size_t nTail = 0;
+	for ( std::size_t i = 0; i < values.size(); i++ )
+		if ( std::fabs( values[ i ] - T( 3 ) ) > T( 1 ) )
+			nTail++;
+	BOOST_CHECK_SMALL( double( nTail ) / values.size() - 0.0455, 0.005 );
+}
+
+void drawFromThread( std::vector< Random::Engine::result_type >& numbers )
+{
+	for ( std::size_t i = 0; i < numbers.size(); i++ )
+		numbers[ i ] = Random::threadEngine()();
+}
+
+} // anonymous namespace
+
+
+void TestRandomEngine()
+{
+	// reproducible, and the same numbers one by one and in bulk
+	Random::Engine a( 7 );
+	Random::Engine b( 7 );
+	std::vector< Random::Engine::result_type > bulk( 23 );
+	b();
+	b.fill( &bulk[ 0 ], bulk.size() );
+	a();
+	for ( std::size_t i = 0; i < bulk.size(); i++ )
+		BOOST_CHECK_EQUAL( a(), bulk[ i ] );
+
+	// streams
+	Random::Engine parent( 7 );
+	const Random::Engine child( parent.split() );
+	Random::Engine first( child );
+	Random::Engine second( 7, 1 );
+	BOOST_CHECK_EQUAL( first(), Random::Engine( 7 )() );
+	BOOST_CHECK_EQUAL( parent(), second() );
+	BOOST_CHECK( Random::Engine( 7 )() != Random::Engine( 8 )() );
+
+	// bounded integers
+	std::vector< std::size_t > counts( 10, 0 );
+	for ( std::size_t i = 0; i < 100000; i++ )
+		counts[ a.below( 10 ) ]++;
+	for ( std::size_t i = 0; i < counts.size(); i++ )
+		BOOST_CHECK_SMALL( double( counts[ i ] ) / 100000 - 0.1, 0.005 );
+
+	testBulk< double >( a );
+	testBulk< float >( a );
+
+	// unit quaternions without preferred direction
+	std::vector< Quaternion > q( 20000 );
+	a.quaternions( &q[ 0 ], q.size() );
+	double sum[ 4 ] = { 0, 0, 0, 0 };
+	for ( std::size_t i = 0; i < q.size(); i++ )
+	{
+		BOOST_CHECK_SMALL( q[ i ].x() * q[ i ].x() + q[ i ].y() * q[ i ].y() + q[ i ].z() * q[ i ].z() + q[ i ].w() * q[ i ].w() - 1.0, 1e-12 );
+		sum[ 0 ] += q[ i ].x();
+		sum[ 1 ] += q[ i ].y();
+		sum[ 2 ] += q[ i ].z();
+		sum[ 3 ] += q[ i ].w();
+	}
+	for ( std::size_t i = 0; i < 4; i++ )
+		BOOST_CHECK_SMALL( sum[ i ] / q.size(), 0.02 );
+
+	std::vector< Pose > poses( 1000 );
+	a.poses( &poses[ 0 ], poses.size(), -5.0, 5.0 );
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+		BOOST_CHECK( std::fabs( poses[ i ].translation()( 1 ) ) <= 5.0 );
+
+	// the engines of the threads are seeded explicitly or split off the master
+	Random::seed( 42 );
+	const double x = Random::distribute_uniform< double >( 0.0, 1.0 );
+	Random::seed( 42 );
+	BOOST_CHECK_EQUAL( Random::distribute_uniform< double >( 0.0, 1.0 ), x );
+
+	std::vector< Random::Engine::result_type > numbers1( 100 );
+	std::vector< Random::Engine::result_type > numbers2( 100 );
+	boost::thread thread1( boost::bind( &drawFromThread, boost::ref( numbers1 ) ) );
+	boost::thread thread2( boost::bind( &drawFromThread, boost::ref( numbers2 ) ) );
+	thread1.join();
+	thread2.join();
+	BOOST_CHECK( numbers1 != numbers2 );
+}
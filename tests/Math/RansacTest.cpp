@@ -0,0 +1,383 @@
+#include <utMath/Vector.h>
+#include <utMath/Optimization/Ransac.h>
+#include <utMath/Optimization/Prosac.h>
+#include <utMath/Random/Scalar.h>
+
+#include <math.h>
+#include <numeric>
+#include <algorithm>
+#include <set>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** robust fit of a line y = m * x + b to 2d points */
+template< typename T >
+struct LineRansac
+{
+	typedef T value_type;
+
+	struct Estimator
+	{
+		template< typename ForwardIterator >
+		bool operator()( Vector< T, 2 >& line, const ForwardIterator iBegin, const ForwardIterator iEnd ) const
+		{
+			T sx = 0, sy = 0, sxx = 0, sxy = 0;
+			const T n = static_cast< T >( std::distance( iBegin, iEnd ) );
+			for ( ForwardIterator it = iBegin; it != iEnd; ++it )
+			{
+				sx += ( *it )( 0 );
+				sy += ( *it )( 1 );
+				sxx += ( *it )( 0 ) * ( *it )( 0 );
+				sxy += ( *it )( 0 ) * ( *it )( 1 );
+			}
+			const T det = n * sxx - sx * sx;
+			if ( fabs( det ) < 1e-6 )
+				return false;
+			line( 0 ) = ( n * sxy - sx * sy ) / det;
+			line( 1 ) = ( sy - line( 0 ) * sx ) / n;
+			return true;
+		}
+	};
+
+	struct Evaluator
+	{
+		T operator()( const Vector< T, 2 >& line, const Vector< T, 2 >& p ) const
+		{ return fabs( line( 0 ) * p( 0 ) + line( 1 ) - p( 1 ) ); }
+	};
+};
+
+} // anonymous namespace
+
+
+void testRansacSampler( const std::size_t n_runs )
+{
+	const std::size_t nValues = 20;
+	const std::size_t setSize = 5;
+	Optimization::RansacSampler sampler( nValues, setSize );
+
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		sampler.draw();
+		BOOST_CHECK_EQUAL( std::size_t( std::distance( sampler.begin(), sampler.end() ) ), setSize );
+
+		const std::set< std::size_t > indices( sampler.begin(), sampler.end() );
+		BOOST_CHECK_EQUAL( indices.size(), setSize );
+		BOOST_CHECK( *indices.rbegin() < nValues );
+	}
+}
+
+
+void testInlierMask()
+{
+	Optimization::Detail::InlierMask mask( 130 );
+	BOOST_CHECK_EQUAL( mask.count(), 0u );
+	BOOST_CHECK_EQUAL( mask.next( 0 ), 130u );
+
+	const std::size_t indices[] = { 0, 5, 63, 64, 100, 129 };
+	for ( std::size_t i = 0; i < 6; i++ )
+		mask.set( indices[ i ] );
+	BOOST_CHECK_EQUAL( mask.count(), 6u );
+	BOOST_CHECK( mask.test( 63 ) && !mask.test( 62 ) );
+
+	std::size_t n = 0;
+	for ( std::size_t i = mask.next( 0 ); i < mask.size(); i = mask.next( i + 1 ) )
+		BOOST_CHECK_EQUAL( i, indices[ n++ ] );
+	BOOST_CHECK_EQUAL( n, 6u );
+
+	std::vector< bool > flags;
+	mask.toVector( flags );
+	BOOST_CHECK_EQUAL( flags.size(), 130u );
+	BOOST_CHECK( flags[ 100 ] && !flags[ 101 ] );
+
+	Optimization::Detail::InlierMask other( 130 );
+	other.swap( mask );
+	BOOST_CHECK_EQUAL( other.count(), 6u );
+	BOOST_CHECK_EQUAL( mask.count(), 0u );
+	other.clear();
+	BOOST_CHECK_EQUAL( other.count(), 0u );
+
+	// samples larger than the inline capacity move to the heap
+	Optimization::Detail::SampleBuffer< int, 4 > sample;
+	for ( int i = 0; i < 4; i++ )
+		sample.push_back( i );
+	sample.reserve( 10 );
+	for ( int i = 4; i < 10; i++ )
+		sample.push_back( i );
+	BOOST_CHECK_EQUAL( sample.size(), 10u );
+	BOOST_CHECK_EQUAL( std::accumulate( sample.begin(), sample.end(), 0 ), 45 );
+}
+
+
+template< typename T >
+void generateLinePoints( std::vector< Vector< T, 2 > >& points, const T m, const T b, const std::size_t n, const std::size_t nOutlier )
+{
+	points.clear();
+	points.reserve( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const T x = Random::distribute_uniform< T >( -5, 5 );
+		if ( i < nOutlier )
+			points.push_back( Vector< T, 2 >( x, Random::distribute_uniform< T >( -20, 20 ) ) );
+		else
+			points.push_back( Vector< T, 2 >( x, m * x + b + Random::distribute_normal< T >( 0, T( 1e-3 ) ) ) );
+	}
+}
+
+
+template< typename T >
+void testRansacLine( const std::size_t n_runs, const T epsilon )
+{
+	const std::size_t n = 200;
+	const T percentOutlier = 0.3;
+
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const T m = Random::distribute_uniform< T >( -2, 2 );
+		const T b = Random::distribute_uniform< T >( -1, 1 );
+
+		std::vector< Vector< T, 2 > > points;
+		const std::size_t nOutlier = static_cast< std::size_t >( percentOutlier * n );
+		generateLinePoints( points, m, b, n, nOutlier );
+
+		// adaptive termination by the intuitive constructor
+		const Optimization::RansacParameter< T > params( T( 0.05 ), 2, n, T( 0.4 ), T( 0.99 ) );
+		BOOST_CHECK( params.successProbability > 0 );
+
+		Vector< T, 2 > line;
+		const std::size_t nInlier = Optimization::ransac( points.begin(), points.end(), line, LineRansac< T >(), params );
+		BOOST_CHECK( nInlier >= n - nOutlier );
+		BOOST_CHECK_SMALL( line( 0 ) - m, epsilon );
+		BOOST_CHECK_SMALL( line( 1 ) - b, epsilon );
+	}
+}
+
+
+template< typename T >
+void testRansacParallel( const std::size_t n_runs, const T epsilon )
+{
+	const std::size_t n = 500;
+	const std::size_t nOutlier = 200;
+
+	// fewer pool threads than RANSAC threads
+	Ubitrack::Util::Executor executor( 2 );
+
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const T m = Random::distribute_uniform< T >( -2, 2 );
+		const T b = Random::distribute_uniform< T >( -1, 1 );
+
+		std::vector< Vector< T, 2 > > points;
+		generateLinePoints( points, m, b, n, nOutlier );
+
+		// adaptive and first-hit termination
+		for ( std::size_t mode = 0; mode < 2; mode++ )
+		{
+			const T successProbability = mode ? T( 0.99 ) : T( 0 );
+			const Optimization::RansacParameter< T > params( T( 0.05 ), 2, n - nOutlier - 20, std::size_t( 1000 ), successProbability, 4, static_cast< unsigned int >( run ) );
+
+			Vector< T, 2 > line1;
+			Vector< T, 2 > line2;
+			const std::size_t nInlier1 = Optimization::ransac( points.begin(), points.end(), line1, LineRansac< T >(), params );
+			const std::size_t nInlier2 = Optimization::ransac( points.begin(), points.end(), line2, LineRansac< T >(), params );
+
+			// same seed and number of threads must give the same result
+			BOOST_CHECK_EQUAL( nInlier1, nInlier2 );
+			BOOST_CHECK_EQUAL( line1( 0 ), line2( 0 ) );
+			BOOST_CHECK_EQUAL( line1( 1 ), line2( 1 ) );
+
+			// also as tasks of an executor
+			Optimization::RansacParameter< T > pooled( params );
+			pooled.executor = &executor;
+			Vector< T, 2 > line3;
+			BOOST_CHECK_EQUAL( Optimization::ransac( points.begin(), points.end(), line3, LineRansac< T >(), pooled ), nInlier1 );
+			BOOST_CHECK_EQUAL( line1( 0 ), line3( 0 ) );
+
+			BOOST_CHECK( nInlier1 >= params.nMinInlier );
+			BOOST_CHECK_SMALL( line1( 0 ) - m, epsilon );
+			BOOST_CHECK_SMALL( line1( 1 ) - b, epsilon );
+		}
+	}
+}
+
+
+template< typename T >
+void testProsacLine( const std::size_t n_runs, const T epsilon )
+{
+	const std::size_t n = 200;
+	const std::size_t nOutlier = 160;
+
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const T m = Random::distribute_uniform< T >( -2, 2 );
+		const T b = Random::distribute_uniform< T >( -1, 1 );
+
+		std::vector< Vector< T, 2 > > points;
+		generateLinePoints( points, m, b, n, nOutlier );
+
+		// inlier have better scores on average, but the best scored values still contain outlier
+		std::vector< T > scores( n );
+		for ( std::size_t i = 0; i < n; i++ )
+			scores[ i ] = Random::distribute_uniform< T >( 0, 1 ) + ( i < nOutlier ? T( 0 ) : T( 0.8 ) );
+
+		// far too few iterations for uniform sampling with 80% outlier
+		const Optimization::RansacParameter< T > params( T( 0.05 ), 2, 30, std::size_t( 20 ) );
+
+		Vector< T, 2 > line;
+		const std::size_t nInlier = Optimization::prosac( points.begin(), points.end(), scores.begin(), scores.end(), line, LineRansac< T >(), params );
+		BOOST_CHECK( nInlier >= params.nMinInlier );
+		BOOST_CHECK_SMALL( line( 0 ) - m, epsilon );
+		BOOST_CHECK_SMALL( line( 1 ) - b, epsilon );
+	}
+}
+
+
+template< typename T >
+void testRansacLocalOptimization( const std::size_t n_runs, const T epsilon )
+{
+	// wrong hypotheses are rejected after a few inconsistent values, good ones pass
+	Optimization::Detail::Sprt< T > sprt( T( 0.05 ), T( 0.5 ), T( 200 ) );
+	sprt.begin();
+	bool bPassed = true;
+	for ( std::size_t i = 0; i < 100; i++ )
+		bPassed = sprt.add( true ) && bPassed;
+	BOOST_CHECK( bPassed );
+	sprt.begin();
+	std::size_t nTested = 1;
+	while ( sprt.add( false ) )
+		nTested++;
+	BOOST_CHECK( nTested < 20 );
+	BOOST_CHECK( sprt.acceptance() > T( 0.9 ) && sprt.acceptance() < 1 );
+
+	const std::size_t n = 400;
+	const std::size_t nOutlier = 240;
+
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const T m = Random::distribute_uniform< T >( -2, 2 );
+		const T b = Random::distribute_uniform< T >( -1, 1 );
+
+		// the test assumes inlier and outlier to be mixed
+		std::vector< Vector< T, 2 > > points;
+		generateLinePoints( points, m, b, n, nOutlier );
+		std::random_shuffle( points.begin(), points.end() );
+
+		Optimization::RansacParameter< T > params( T( 0.05 ), 2, 40, std::size_t( 1000 ), T( 0.99 ) );
+		params.nLocalIterations = 10;
+		params.sprtDelta = T( 0.01 );
+
+		Vector< T, 2 > line;
+		const std::size_t nInlier = Optimization::ransac( points.begin(), points.end(), line, LineRansac< T >(), params );
+		BOOST_CHECK( nInlier >= n - nOutlier );
+		BOOST_CHECK_SMALL( line( 0 ) - m, epsilon );
+		BOOST_CHECK_SMALL( line( 1 ) - b, epsilon );
+
+		// the multithreaded version stays deterministic
+		Optimization::RansacParameter< T > parallel( T( 0.05 ), 2, 40, std::size_t( 1000 ), T( 0.99 ), 3, static_cast< unsigned int >( run ) );
+		parallel.nLocalIterations = 10;
+		parallel.sprtDelta = T( 0.01 );
+		Vector< T, 2 > line1;
+		Vector< T, 2 > line2;
+		const std::size_t nInlier1 = Optimization::ransac( points.begin(), points.end(), line1, LineRansac< T >(), parallel );
+		BOOST_CHECK_EQUAL( Optimization::ransac( points.begin(), points.end(), line2, LineRansac< T >(), parallel ), nInlier1 );
+		BOOST_CHECK_EQUAL( line1( 0 ), line2( 0 ) );
+		BOOST_CHECK( nInlier1 >= n - nOutlier );
+
+		// and so does PROSAC, with uninformative scores
+		const std::vector< T > scores( n, T( 1 ) );
+		Vector< T, 2 > line3;
+		BOOST_CHECK( Optimization::prosac( points.begin(), points.end(), scores.begin(), scores.end(), line3, LineRansac< T >(), params ) >= n - nOutlier );
+		BOOST_CHECK_SMALL( line3( 0 ) - m, epsilon );
+	}
+}
+
+
+template< typename T >
+void testPreemptiveRansac( const std::size_t n_runs, const T epsilon )
+{
+	const std::size_t n = 500;
+	const std::size_t nOutlier = 200;
+
+	for ( std::size_t run = 0; run < n_runs; run++ )
+	{
+		const T m = Random::distribute_uniform< T >( -2, 2 );
+		const T b = Random::distribute_uniform< T >( -1, 1 );
+
+		// the blocks are drawn in random order, sorted values do not matter
+		std::vector< Vector< T, 2 > > points;
+		generateLinePoints( points, m, b, n, nOutlier );
+
+		Optimization::RansacParameter< T > params( T( 0.05 ), 2, 200, std::size_t( 0 ), T( 0 ), 1, static_cast< unsigned int >( run ) );
+		params.nPreemptiveHypotheses = 64;
+		params.preemptiveBlockSize = 50;
+
+		Vector< T, 2 > line;
+		const std::size_t nInlier = Optimization::ransac( points.begin(), points.end(), line, LineRansac< T >(), params );
+		BOOST_CHECK( nInlier >= n - nOutlier );
+		BOOST_CHECK_SMALL( line( 0 ) - m, epsilon );
+		BOOST_CHECK_SMALL( line( 1 ) - b, epsilon );
+
+		// parallel scoring gives the same result
+		Optimization::RansacParameter< T > parallel( T( 0.05 ), 2, 200, std::size_t( 0 ), T( 0 ), 0, static_cast< unsigned int >( run ) );
+		parallel.nPreemptiveHypotheses = 64;
+		parallel.preemptiveBlockSize = 50;
+		Vector< T, 2 > line2;
+		BOOST_CHECK_EQUAL( Optimization::ransac( points.begin(), points.end(), line2, LineRansac< T >(), parallel ), nInlier );
+		BOOST_CHECK_EQUAL( line( 0 ), line2( 0 ) );
+		BOOST_CHECK_EQUAL( line( 1 ), line2( 1 ) );
+
+		// too few inlier
+		Optimization::RansacParameter< T > strict( T( 0.05 ), 2, n - nOutlier / 2, std::size_t( 0 ) );
+		strict.nPreemptiveHypotheses = 64;
+		BOOST_CHECK_EQUAL( Optimization::ransac( points.begin(), points.end(), line2, LineRansac< T >(), strict ), 0u );
+	}
+}
+
+
+template< typename T >
+void testRansacDeadline()
+{
+	std::vector< Vector< T, 2 > > points;
+	generateLinePoints( points, T( 1 ), T( 0 ), 100, 20 );
+	const std::vector< T > scores( points.size(), T( 1 ) );
+
+	// a passed deadline stops before the first hypothesis
+	Optimization::RansacParameter< T > params( T( 0.05 ), 2, 20, std::size_t( 100 ) );
+	params.deadline = Optimization::Deadline( 1 );
+	Vector< T, 2 > line;
+	BOOST_CHECK_EQUAL( Optimization::ransac( points.begin(), points.end(), line, LineRansac< T >(), params ), 0u );
+	BOOST_CHECK( params.deadline.expired() );
+	BOOST_CHECK_EQUAL( Optimization::prosac( points.begin(), points.end(), scores.begin(), scores.end(), line, LineRansac< T >(), params ), 0u );
+
+	Optimization::RansacParameter< T > parallel( T( 0.05 ), 2, 20, std::size_t( 100 ), T( 0.99 ), 3 );
+	parallel.deadline = Optimization::Deadline( 1 );
+	BOOST_CHECK_EQUAL( Optimization::ransac( points.begin(), points.end(), line, LineRansac< T >(), parallel ), 0u );
+
+	// one far ahead does not change the result
+	params.deadline = Optimization::Deadline::in( 3600000000000LL );
+	BOOST_CHECK( Optimization::ransac( points.begin(), points.end(), line, LineRansac< T >(), params ) >= 80u );
+	BOOST_CHECK( !params.deadline.expired() );
+}
+
+
+void TestRansac()
+{
+	testRansacSampler( 100 );
+	testInlierMask();
+	testRansacLine< double >( 10, 1e-2 );
+	testRansacLine< float >( 10, 1e-2f );
+	testRansacParallel< double >( 10, 1e-2 );
+	testRansacParallel< float >( 10, 1e-2f );
+	testProsacLine< double >( 10, 1e-2 );
+	testProsacLine< float >( 10, 1e-2f );
+	testRansacLocalOptimization< double >( 10, 1e-2 );
+	testRansacLocalOptimization< float >( 10, 1e-2f );
+	testPreemptiveRansac< double >( 10, 1e-2 );
+	testPreemptiveRansac< float >( 10, 1e-2f );
+	testRansacDeadline< double >();
+}
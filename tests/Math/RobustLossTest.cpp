@@ -0,0 +1,135 @@
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Optimization/LevenbergMarquardt.h>
+#include <utMath/Optimization/RobustLoss.h>
+#include <utMath/Random/Scalar.h>
+
+#include <math.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** fits a line y = a * x + b to 2D points, with one residual row per coordinate */
+class LineFit
+{
+public:
+	LineFit( const std::vector< double >& x )
+		: m_x( x )
+	{}
+
+	std::size_t size() const
+	{ return 2 * m_x.size(); }
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		J.clear();
+		for ( std::size_t i = 0; i < m_x.size(); i++ )
+		{
+			result( 2 * i ) = m_x[ i ];
+			result( 2 * i + 1 ) = input( 0 ) * m_x[ i ] + input( 1 );
+			J( 2 * i + 1, 0 ) = m_x[ i ];
+			J( 2 * i + 1, 1 ) = 1;
+		}
+	}
+
+protected:
+	const std::vector< double >& m_x;
+};
+
+/** checks that the weight is the derivative of the loss */
+template< class Loss >
+void checkDerivative( const Loss& loss )
+{
+	BOOST_CHECK_SMALL( loss.loss( 0.0 ), 1e-12 );
+	for ( double s = 0.05; s < 20.0; s *= 1.7 )
+	{
+		const double h = 1e-6 * s;
+		const double d = ( loss.loss( s + h ) - loss.loss( s - h ) ) / ( 2 * h );
+		BOOST_CHECK_SMALL( d - loss.weight( s ), 1e-6 );
+		BOOST_CHECK( loss.weight( s ) <= 1.0 );
+	}
+}
+
+/** fits a line to data with outliers and returns the largest parameter error */
+template< class Loss >
+double fitWithOutliers( const Loss& loss, const std::vector< double >& x, const Vector< double >& y )
+{
+	LineFit line( x );
+
+	// start at the least squares solution
+	Vector< double > params( 2 );
+	params( 0 ) = 0; params( 1 ) = 0;
+	Optimization::levenbergMarquardt( line, params, y, Optimization::OptTerminate( 10, 1e-10 ), Optimization::OptNoNormalize() );
+
+	Optimization::weightedLevenbergMarquardt( line, params, y, Optimization::OptTerminate( 50, 1e-10 ),
+		Optimization::OptNoNormalize(), Optimization::RobustWeightFunction< Loss >( 2, loss ) );
+	return std::max( fabs( params( 0 ) - 2 ), fabs( params( 1 ) + 1 ) );
+}
+
+} // anonymous namespace
+
+
+void TestRobustLoss()
+{
+	checkDerivative( Optimization::HuberLoss( 1.5 ) );
+	checkDerivative( Optimization::CauchyLoss( 1.5 ) );
+	checkDerivative( Optimization::GemanMcClureLoss( 1.5 ) );
+	checkDerivative( Optimization::TukeyLoss( 1.5 ) );
+	BOOST_CHECK_EQUAL( Optimization::TukeyLoss( 1.5 ).weight( 3.0 ), 0.0 );
+
+	// the fused weighting gives the same result as computeWeights
+	Vector< double > errors( 6 );
+	for ( std::size_t i = 0; i < errors.size(); i++ )
+		errors( i ) = Random::distribute_normal< double >( 0, 2 );
+	Optimization::RobustWeightFunction< Optimization::CauchyLoss > cauchy( 2, 1.0 );
+	Vector< double > weights( 6 );
+	cauchy.computeWeights( errors, weights );
+
+	Matrix< double > J( 6, 3 );
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			J( i, j ) = double( i + j );
+	Matrix< double > weightedJ( J );
+	Vector< double > weightedErrors( errors );
+	Vector< double > fusedWeights( 6 );
+	Optimization::Detail::applyLmWeights( cauchy, weightedErrors, weightedJ, fusedWeights );
+	for ( std::size_t i = 0; i < 6; i++ )
+	{
+		BOOST_CHECK_CLOSE( weights( i ), fusedWeights( i ), 1e-10 );
+		BOOST_CHECK_CLOSE( weightedErrors( i ), errors( i ) * sqrt( weights( i ) ), 1e-10 );
+		for ( std::size_t j = 0; j < 3; j++ )
+			BOOST_CHECK_CLOSE( weightedJ( i, j ) + 1, J( i, j ) * sqrt( weights( i ) ) + 1, 1e-10 );
+	}
+	BOOST_CHECK_EQUAL( weights( 0 ), weights( 1 ) );
+
+	// line y = 2 x - 1 with 20% gross outliers
+	const std::size_t n = 50;
+	std::vector< double > x( n );
+	Vector< double > y( 2 * n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		x[ i ] = double( i ) / n * 10;
+		y( 2 * i ) = x[ i ];
+		y( 2 * i + 1 ) = 2 * x[ i ] - 1 + Random::distribute_normal< double >( 0, 0.05 );
+		if ( i % 5 == 2 )
+			y( 2 * i + 1 ) += Random::distribute_uniform< double >( 5, 20 );
+	}
+
+	LineFit line( x );
+	Vector< double > lsq( 2 );
+	lsq( 0 ) = 0; lsq( 1 ) = 0;
+	Optimization::levenbergMarquardt( line, lsq, y, Optimization::OptTerminate( 10, 1e-10 ), Optimization::OptNoNormalize() );
+	const double lsqError = std::max( fabs( lsq( 0 ) - 2 ), fabs( lsq( 1 ) + 1 ) );
+	BOOST_CHECK( lsqError > 0.5 );
+
+	BOOST_CHECK_SMALL( fitWithOutliers( Optimization::HuberLoss( 0.2 ), x, y ), 0.5 * lsqError );
+	BOOST_CHECK_SMALL( fitWithOutliers( Optimization::CauchyLoss( 0.2 ), x, y ), 0.1 );
+	BOOST_CHECK_SMALL( fitWithOutliers( Optimization::GemanMcClureLoss( 0.2 ), x, y ), 0.1 );
+	BOOST_CHECK_SMALL( fitWithOutliers( Optimization::TukeyLoss( 4.0 ), x, y ), 0.1 );
+}
@@ -0,0 +1,108 @@
+#include <utMath/RotationIntegration.h>
+#include <utMath/LieGroups.h>
+#include <utUtil/Exception.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/// coning motion q( t ) = Exp( a t e_z ) Exp( b e_x ) Exp( c t e_z )
+struct ConingMotion
+{
+	double a, b, c;
+
+	Quaternion rotation( double t ) const
+	{
+		return Quaternion( Quaternion( Vector< double, 3 >( 0, 0, 1 ), a * t )
+			* Quaternion( Vector< double, 3 >( 1, 0, 0 ), b ) * Quaternion( Vector< double, 3 >( 0, 0, 1 ), c * t ) );
+	}
+
+	/// body frame rate ~q2 * ( 0, 0, a ) + ( 0, 0, c ) with q2 = Exp( b e_x ) Exp( c t e_z )
+	RotationVelocity velocity( double t ) const
+	{
+		const Quaternion q2( Quaternion( Vector< double, 3 >( 1, 0, 0 ), b ) * Quaternion( Vector< double, 3 >( 0, 0, 1 ), c * t ) );
+		return RotationVelocity( ~q2 * Vector< double, 3 >( 0, 0, a ) + Vector< double, 3 >( 0, 0, c ) );
+	}
+};
+
+/// samples the motion at n equidistant times in [ 0, 1 ] and returns the rotation error of the integral
+double integrationError( const ConingMotion& motion, std::size_t n, RotationIntegrationOrder order )
+{
+	std::vector< RotationVelocity > velocities;
+	std::vector< double > times;
+	for ( std::size_t k = 0; k < n; k++ )
+	{
+		times.push_back( double( k ) / ( n - 1 ) );
+		velocities.push_back( motion.velocity( times.back() ) );
+	}
+	const Quaternion delta( integrateRotationVelocities( &velocities[ 0 ], &times[ 0 ], n, order ) );
+	const Quaternion expected( ~motion.rotation( 0 ) * motion.rotation( 1 ) );
+	return norm_2( Lie::logSO3( Quaternion( ~expected * delta ) ) );
+}
+
+} // anonymous namespace
+
+
+void TestRotationIntegration()
+{
+	// constant rates are integrated exactly by all orders, with irregular timestamps
+	const RotationVelocity w( 0.4, -1.1, 2.3 );
+	const double times[] = { 0.0, 0.01, 0.025, 0.03, 0.05, 0.07, 0.1 };
+	const RotationVelocity constant[] = { w, w, w, w, w, w, w };
+	const Quaternion expected( w.integrate( 0.1 ) );
+	BOOST_CHECK_SMALL( quaternionDiff( integrateRotationVelocities( constant, times, 7, rotationIntegrationFirstOrder ), expected ), 1e-12 );
+	BOOST_CHECK_SMALL( quaternionDiff( integrateRotationVelocities( constant, times, 7, rotationIntegrationSecondOrder ), expected ), 1e-12 );
+	BOOST_CHECK_SMALL( quaternionDiff( integrateRotationVelocities( constant, times, 7, rotationIntegrationFourthOrder ), expected ), 1e-12 );
+	BOOST_CHECK_SMALL( quaternionDiff( integrateRotationVelocities( constant, times, 6, rotationIntegrationFourthOrder )
+		, w.integrate( 0.07 ) ), 1e-12 );
+	BOOST_CHECK_SMALL( quaternionDiff( integrateRotationVelocities( constant, times, 1 ), Quaternion() ), 1e-12 );
+
+	// a time varying rate: errors decrease with the order and converge with their rates
+	const ConingMotion motion = { 2.0, 0.5, 3.0 };
+	const double first = integrationError( motion, 51, rotationIntegrationFirstOrder );
+	const double second = integrationError( motion, 51, rotationIntegrationSecondOrder );
+	const double fourth = integrationError( motion, 51, rotationIntegrationFourthOrder );
+	BOOST_CHECK_LT( second, first );
+	BOOST_CHECK_LT( fourth, second );
+	BOOST_CHECK_LT( fourth, 1e-5 );
+	BOOST_CHECK_GT( second / integrationError( motion, 101, rotationIntegrationSecondOrder ), 3.5 );
+	BOOST_CHECK_GT( fourth / integrationError( motion, 101, rotationIntegrationFourthOrder ), 12.0 );
+
+	// the jacobian against central differences of a common rate change
+	std::vector< RotationVelocity > velocities;
+	std::vector< double > sampleTimes;
+	for ( std::size_t k = 0; k < 21; k++ )
+	{
+		sampleTimes.push_back( 0.02 * k );
+		velocities.push_back( motion.velocity( sampleTimes.back() ) );
+	}
+	const RotationIntegrationOrder orders[] = { rotationIntegrationFirstOrder, rotationIntegrationSecondOrder, rotationIntegrationFourthOrder };
+	for ( std::size_t o = 0; o < 3; o++ )
+	{
+		Matrix< double, 3, 3 > jacobian;
+		const Quaternion delta( integrateRotationVelocities( &velocities[ 0 ], &sampleTimes[ 0 ], 21, orders[ o ], &jacobian ) );
+		const double h = 1e-6;
+		for ( std::size_t j = 0; j < 3; j++ )
+		{
+			std::vector< RotationVelocity > plus( velocities ), minus( velocities );
+			for ( std::size_t k = 0; k < plus.size(); k++ )
+			{
+				plus[ k ]( j ) += h;
+				minus[ k ]( j ) -= h;
+			}
+			const Vector< double, 3 > d( ( Lie::logSO3( Quaternion( ~delta * integrateRotationVelocities( &plus[ 0 ], &sampleTimes[ 0 ], 21, orders[ o ] ) ) )
+				- Lie::logSO3( Quaternion( ~delta * integrateRotationVelocities( &minus[ 0 ], &sampleTimes[ 0 ], 21, orders[ o ] ) ) ) ) / ( 2 * h ) );
+			// exact for first order, the coning terms are neglected otherwise
+			BOOST_CHECK_SMALL( vectorDiffSum( d, Vector< double, 3 >( boost::numeric::ublas::column( jacobian, j ) ) )
+				, o == 0 ? 1e-7 : 1e-2 );
+		}
+	}
+
+	// timestamps must increase
+	const double unordered[] = { 0.0, 0.02, 0.02 };
+	BOOST_CHECK_THROW( integrateRotationVelocities( constant, unordered, 3 ), Ubitrack::Util::Exception );
+}
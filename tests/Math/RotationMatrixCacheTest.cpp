@@ -0,0 +1,62 @@
+#include <utMath/RotationMatrixCache.h>
+#include <utMath/Geometry/PointTransformation.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+void TestRotationMatrixCache()
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -10, 10 );
+	const double epsilon = 1e-10;
+
+	// the default is the identity
+	RotationMatrixCache< double > cache;
+	BOOST_CHECK( !cache.valid() );
+	BOOST_CHECK_SMALL( matrixDiff( cache.matrix(), Matrix< double, 3, 3 >::identity() ), epsilon );
+	BOOST_CHECK( cache.valid() );
+
+	for ( std::size_t n = 0; n < 100; n++ )
+	{
+		const Quaternion q( randQuat() );
+		const Matrix< double, 3, 3 > expected( q );
+
+		// a new rotation invalidates the matrix, setting the same one again keeps it
+		cache.setRotation( q );
+		BOOST_CHECK( !cache.valid() );
+		BOOST_CHECK_SMALL( matrixDiff( cache.matrix(), expected ), epsilon );
+		cache.setRotation( q );
+		BOOST_CHECK( cache.valid() );
+		BOOST_CHECK_SMALL( matrixDiff( cache.matrix( q ), expected ), epsilon );
+
+		// float matrices
+		RotationMatrixCache< float > cacheFloat( q );
+		BOOST_CHECK_SMALL( double( cacheFloat.matrix()( 1, 2 ) - expected( 1, 2 ) ), 1e-6 );
+
+		// points transformed with a cached pose
+		const Pose p( q, randVector() );
+		CachedPose< double > cached( p );
+		const Vector< double, 3 > x( randVector() );
+		BOOST_CHECK_SMALL( vectorDiffSum( cached * x, p * x ), epsilon );
+		BOOST_CHECK_SMALL( vectorDiffSum( Geometry::TransformPoint()( cached, x ), p * x ), epsilon );
+
+		std::vector< Vector< double, 3 > > points( 10 ), transformed;
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			points[ i ] = randVector();
+		Geometry::transform_points( cached, points.begin(), points.end(), std::back_inserter( transformed ) );
+		BOOST_CHECK_EQUAL( transformed.size(), points.size() );
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			BOOST_CHECK_SMALL( vectorDiffSum( transformed[ i ], p * points[ i ] ), epsilon );
+
+		// a new translation keeps the matrix
+		cached.setPose( Pose( q, Vector< double, 3 >( 1, 2, 3 ) ) );
+		BOOST_CHECK_SMALL( vectorDiffSum( cached.translation(), Vector< double, 3 >( 1, 2, 3 ) ), epsilon );
+		BOOST_CHECK_SMALL( quaternionDiff( cached.pose().rotation(), q ), epsilon );
+		BOOST_CHECK_SMALL( matrixDiff( cached.rotationMatrix(), expected ), epsilon );
+	}
+}
@@ -0,0 +1,73 @@
+#include <utMath/Optimization/NewFunction/Function.h>
+#include <utMath/Optimization/NewFunction/Addition.h>
+#include <utMath/Optimization/NewFunction/LieRotation.h>
+#include <utMath/Optimization/NewFunction/LinearTransformation.h>
+#include <utMath/Random/Vector.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+namespace NF = Ubitrack::Math::Optimization::Function;
+namespace ublas = boost::numeric::ublas;
+
+void TestSharedExpression()
+{
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	Matrix< double, 3, 3 > A, B, C;
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		ublas::row( A, i ) = randVector();
+		ublas::row( B, i ) = randVector();
+		ublas::row( C, i ) = randVector();
+	}
+	const Matrix< double, 3, 3 > AB( A + B );
+
+	for ( unsigned iTest = 0; iTest < 10; iTest++ )
+	{
+		const Vector< double, 3 > point( randVector() );
+		Vector< double, 6 > params;
+		ublas::subrange( params, 0, 3 ) = randVector();
+		ublas::subrange( params, 3, 6 ) = randVector();
+
+		// A R p + B R p + C q, with the rotation computed once
+		NF::SharedResult< 3 > rotated;
+		Vector< double, 3 > value;
+		Matrix< double, 3, 6 > jacobian;
+		( NF::Addition< 3 >()
+			<< ( NF::Addition< 3 >()
+				<< ( NF::LinearTransformation< 3, 3 >( A ) << NF::shared( rotated, NF::LieRotation() << NF::parameter< 3 >( 0 ) << NF::fixedParameterRef< 3 >( point ) ) )
+				<< ( NF::LinearTransformation< 3, 3 >( B ) << NF::shared( rotated, NF::LieRotation() << NF::parameter< 3 >( 0 ) << NF::fixedParameterRef< 3 >( point ) ) ) )
+			<< ( NF::LinearTransformation< 3, 3 >( C ) << NF::parameter< 3 >( 3 ) ) )
+			.evaluateWithJacobian( params, value, jacobian );
+		BOOST_CHECK_EQUAL( rotated.evaluations(), 1u );
+
+		// ( A + B ) R p + C q
+		Vector< double, 3 > expected;
+		Matrix< double, 3, 6 > expectedJacobian;
+		( NF::Addition< 3 >()
+			<< ( NF::LinearTransformation< 3, 3 >( AB ) << ( NF::LieRotation() << NF::parameter< 3 >( 0 ) << NF::fixedParameterRef< 3 >( point ) ) )
+			<< ( NF::LinearTransformation< 3, 3 >( C ) << NF::parameter< 3 >( 3 ) ) )
+			.evaluateWithJacobian( params, expected, expectedJacobian );
+
+		BOOST_CHECK_SMALL( vectorDiffSum( value, expected ), 1e-10 );
+		BOOST_CHECK_SMALL( vectorDiffSum( rotated.value(), Vector< double, 3 >( Quaternion::fromLogarithm( ublas::subrange( params, 0, 3 ) ) * point ) ), 1e-10 );
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t c = 0; c < 6; c++ )
+				BOOST_CHECK_SMALL( jacobian( r, c ) - expectedJacobian( r, c ), 1e-10 );
+
+		// every top-level call recomputes the shared result once
+		typedef NF::LinearTransformation< 3, 3 > Linear;
+		const Vector< double, 6 > otherParams( params * 0.5 );
+		const NF::Detail::Binder< Linear, NF::Detail::Shared< 3, NF::Detail::Binder< NF::Detail::Binder< NF::LieRotation, NF::Detail::Parameter< 3 > >, NF::Detail::FixedParameterRef< 3, Vector< double, 3 > > > > >
+			f( Linear( A ) << NF::shared( rotated, NF::LieRotation() << NF::parameter< 3 >( 0 ) << NF::fixedParameterRef< 3 >( point ) ) );
+		f.evaluate( otherParams, value );
+		Matrix< double, 3, 6 > singleJacobian;
+		f.jacobian( otherParams, singleJacobian );
+		BOOST_CHECK_EQUAL( rotated.evaluations(), 3u );
+		const Vector< double, 3 > rotatedOther( Quaternion::fromLogarithm( ublas::subrange( otherParams, 0, 3 ) ) * point );
+		BOOST_CHECK_SMALL( vectorDiffSum( value, Vector< double, 3 >( ublas::prod( A, rotatedOther ) ) ), 1e-10 );
+	}
+}
@@ -0,0 +1,56 @@
+#include <utMath/Blas1.h>
+#include <utMath/Blas2.h>
+#include <utMath/Blas3.h>
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Matrix.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+/** compares the functors for the sizes that use the SIMD kernels with ublas */
+template< typename T, std::size_t M, std::size_t N >
+void testSimdKernels( const std::size_t n, const T epsilon )
+{
+	typename Random::Vector< T, M >::Uniform randVectorM( -1, 1 );
+	typename Random::Vector< T, N >::Uniform randVectorN( -1, 1 );
+	typename Random::Matrix< T, M, N >::Uniform randMatrixMN( -1, 1 );
+	typename Random::Matrix< T, N, M >::Uniform randMatrixNM( -1, 1 );
+
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const Vector< T, M > a( randVectorM() );
+		const Vector< T, M > b( randVectorM() );
+		const Vector< T, N > c( randVectorN() );
+		const Matrix< T, M, N > A( randMatrixMN() );
+		const Matrix< T, N, M > B( randMatrixNM() );
+
+		BOOST_CHECK_SMALL( T( inner_product( a, b ) - ublas::inner_prod( a, b ) ), epsilon );
+		BOOST_CHECK_SMALL( T( norm_2( a ) - ublas::norm_2( a ) ), epsilon );
+
+		const Matrix< T, M, N > outer( OuterProduct< Vector< T, M >, Vector< T, N >, Matrix< T, M, N > >()( a, c ) );
+		BOOST_CHECK_SMALL( T( ublas::norm_frobenius( outer - ublas::outer_prod( a, c ) ) ), epsilon );
+
+		const Vector< T, M > Ac( Product< Matrix< T, M, N >, Vector< T, N >, Vector< T, M > >()( A, c ) );
+		BOOST_CHECK_SMALL( vectorDiffSum( Ac, Vector< T, M >( ublas::prod( A, c ) ) ), epsilon );
+
+		const Matrix< T, M, M > AB( Product< Matrix< T, M, N >, Matrix< T, N, M >, Matrix< T, M, M > >()( A, B ) );
+		BOOST_CHECK_SMALL( T( ublas::norm_frobenius( AB - ublas::prod( A, B ) ) ), epsilon );
+	}
+}
+
+void TestSimdKernels()
+{
+	testSimdKernels< double, 3, 3 >( 1000, 1e-12 );
+	testSimdKernels< double, 4, 4 >( 1000, 1e-12 );
+	testSimdKernels< double, 3, 4 >( 1000, 1e-12 );
+	testSimdKernels< double, 4, 3 >( 1000, 1e-12 );
+	testSimdKernels< float, 3, 3 >( 1000, 1e-5f );
+	testSimdKernels< float, 4, 4 >( 1000, 1e-5f );
+	testSimdKernels< float, 4, 3 >( 1000, 1e-5f );
+}
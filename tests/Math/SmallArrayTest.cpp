@@ -0,0 +1,115 @@
+#include <utMath/Matrix.h>
+#include <utMath/Vector.h>
+#include <utMath/MatrixOperations.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+template< typename T >
+Vector< T > sequence( const std::size_t n, const T offset )
+{
+	Vector< T > v( n );
+	for ( std::size_t i = 0; i < n; i++ )
+		v( i ) = offset + T( i );
+	return v;
+}
+
+template< typename T >
+bool isSequence( const Vector< T >& v, const std::size_t n, const T offset )
+{
+	if ( v.size() != n )
+		return false;
+	for ( std::size_t i = 0; i < n; i++ )
+		if ( v( i ) != offset + T( i ) )
+			return false;
+	return true;
+}
+
+template< typename T >
+void testVectorStorage()
+{
+	// small vectors are stored inline, large ones on the heap
+	Vector< T > small( sequence< T >( 6, 1 ) );
+	Vector< T > large( sequence< T >( 100, 2 ) );
+	BOOST_CHECK( small.data().isInline() );
+	BOOST_CHECK( !large.data().isInline() );
+
+	// copies
+	Vector< T > copy( small );
+	BOOST_CHECK( isSequence( copy, 6, T( 1 ) ) );
+	copy = large;
+	BOOST_CHECK( isSequence( copy, 100, T( 2 ) ) );
+	copy = small;
+	BOOST_CHECK( copy.data().isInline() );
+	BOOST_CHECK( isSequence( copy, 6, T( 1 ) ) );
+
+	// preserving resizes across the inline capacity
+	Vector< T > grow( sequence< T >( 20, 3 ) );
+	grow.resize( 40, true );
+	BOOST_CHECK( !grow.data().isInline() );
+	BOOST_CHECK_EQUAL( grow( 19 ), T( 22 ) );
+	grow.resize( 10, true );
+	BOOST_CHECK( grow.data().isInline() );
+	BOOST_CHECK( isSequence( grow, 10, T( 3 ) ) );
+
+	// swaps of all combinations of inline and heap storage
+	Vector< T > a( sequence< T >( 6, 1 ) );
+	Vector< T > b( sequence< T >( 9, 5 ) );
+	a.swap( b );
+	BOOST_CHECK( isSequence( a, 9, T( 5 ) ) && isSequence( b, 6, T( 1 ) ) );
+	Vector< T > c( sequence< T >( 50, 7 ) );
+	a.swap( c );
+	BOOST_CHECK( isSequence( a, 50, T( 7 ) ) && isSequence( c, 9, T( 5 ) ) );
+	BOOST_CHECK( !a.data().isInline() && c.data().isInline() );
+	c.swap( a );
+	BOOST_CHECK( isSequence( c, 50, T( 7 ) ) && isSequence( a, 9, T( 5 ) ) );
+	Vector< T > d( sequence< T >( 60, 8 ) );
+	c.swap( d );
+	BOOST_CHECK( isSequence( c, 60, T( 8 ) ) && isSequence( d, 50, T( 7 ) ) );
+
+	// expressions
+	const Vector< T > sum( small + small );
+	BOOST_CHECK_EQUAL( sum( 5 ), T( 12 ) );
+	BOOST_CHECK_EQUAL( Vector< T >::zeros( 4 )( 3 ), T( 0 ) );
+}
+
+template< typename T >
+void testMatrixStorage( const std::size_t n, const T epsilon )
+{
+	Matrix< T > a( n, n );
+	for ( std::size_t r = 0; r < n; r++ )
+		for ( std::size_t c = 0; c < n; c++ )
+			a( r, c ) = random( T( -1 ), T( 1 ) ) + ( r == c ? T( n ) : T( 0 ) );
+	BOOST_CHECK_EQUAL( a.data().isInline(), n * n <= 256 );
+
+	// the storage is handed to LAPACK
+	const Matrix< T > inv( invert_matrix( a ) );
+	const Matrix< T > identity( ublas::prod( a, inv ) );
+	BOOST_CHECK_SMALL( matrixDiff( identity, Matrix< T >( ublas::identity_matrix< T >( n ) ) ), epsilon );
+
+	Matrix< T > b( a );
+	b.resize( n + 20, n + 20, true );
+	BOOST_CHECK( !b.data().isInline() );
+	BOOST_CHECK_EQUAL( b( n - 1, n - 1 ), a( n - 1, n - 1 ) );
+}
+
+} // anonymous namespace
+
+
+void TestSmallArray()
+{
+	testVectorStorage< double >();
+	testVectorStorage< float >();
+#ifdef HAVE_LAPACK
+	testMatrixStorage< double >( 6, 1e-10 );
+	testMatrixStorage< double >( 16, 1e-10 );
+	testMatrixStorage< double >( 30, 1e-10 );
+	testMatrixStorage< float >( 12, 1e-4f );
+#endif
+}
@@ -0,0 +1,187 @@
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/Optimization/LevenbergMarquardt.h>
+#include <utMath/Optimization/SparseLevenbergMarquardt.h>
+#include <utMath/Random/Scalar.h>
+
+#include <math.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/**
+ * fits the curves y = a_g * exp( b_g * x ) + c to several groups of samples, where
+ * each group has own parameters a_g, b_g and the offset c is shared by all groups
+ */
+class GroupedCurves
+{
+public:
+	GroupedCurves( const std::vector< double >& x, const std::size_t nGroups )
+		: m_x( x )
+		, m_nGroups( nGroups )
+	{}
+
+	std::size_t size() const
+	{ return m_x.size() * m_nGroups; }
+
+	/** dense jacobian */
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		J = boost::numeric::ublas::zero_matrix< double >( size(), input.size() );
+		for ( std::size_t g = 0; g < m_nGroups; g++ )
+			for ( std::size_t i = 0; i < m_x.size(); i++ )
+			{
+				const std::size_t r = g * m_x.size() + i;
+				double d[ 3 ];
+				result( r ) = evaluateSample( input, g, i, d );
+				J( r, 2 * g ) = d[ 0 ];
+				J( r, 2 * g + 1 ) = d[ 1 ];
+				J( r, 2 * m_nGroups ) = d[ 2 ];
+			}
+	}
+
+	/** sparse jacobian */
+	template< class VT1, class VT2 >
+	void evaluateWithJacobian( VT1& result, const VT2& input, Optimization::SparseJacobian< double >& J ) const
+	{
+		J.clear( input.size() );
+		for ( std::size_t g = 0; g < m_nGroups; g++ )
+			for ( std::size_t i = 0; i < m_x.size(); i++ )
+			{
+				double d[ 3 ];
+				result( g * m_x.size() + i ) = evaluateSample( input, g, i, d );
+				J.push_back( 2 * m_nGroups, d[ 2 ] );
+				J.push_back( 2 * g, d[ 0 ] );
+				J.push_back( 2 * g + 1, d[ 1 ] );
+				J.finishRow();
+			}
+	}
+
+protected:
+	template< class VT >
+	double evaluateSample( const VT& input, const std::size_t g, const std::size_t i, double* d ) const
+	{
+		const double e = exp( input( 2 * g + 1 ) * m_x[ i ] );
+		d[ 0 ] = e;
+		d[ 1 ] = input( 2 * g ) * m_x[ i ] * e;
+		d[ 2 ] = 1;
+		return input( 2 * g ) * e + input( 2 * m_nGroups );
+	}
+
+	const std::vector< double >& m_x;
+	const std::size_t m_nGroups;
+};
+
+/** fixed, unequal weights */
+struct AlternatingWeights
+{
+	bool noWeights() const
+	{ return false; }
+
+	template< class X, class Y >
+	void computeWeights( const X& errorVector, Y& weightVector ) const
+	{
+		for ( std::size_t i = 0; i < errorVector.size(); i++ )
+			weightVector( i ) = 1.0 / ( 1 + i % 3 );
+	}
+};
+
+} // anonymous namespace
+
+
+void TestSparseLevenbergMarquardt()
+{
+	const std::size_t nGroups = 30;
+	const std::size_t nSamples = 10;
+	std::vector< double > x( nSamples );
+	for ( std::size_t i = 0; i < nSamples; i++ )
+		x[ i ] = 2.0 * i / nSamples;
+
+	Vector< double > truth( 2 * nGroups + 1 );
+	Vector< double > y( nGroups * nSamples );
+	truth( 2 * nGroups ) = -0.5;
+	for ( std::size_t g = 0; g < nGroups; g++ )
+	{
+		truth( 2 * g ) = Random::distribute_uniform< double >( 1, 2 );
+		truth( 2 * g + 1 ) = Random::distribute_uniform< double >( 0.5, 1.5 );
+		for ( std::size_t i = 0; i < nSamples; i++ )
+			y( g * nSamples + i ) = truth( 2 * g ) * exp( truth( 2 * g + 1 ) * x[ i ] ) + truth( 2 * nGroups ) + 
+				Random::distribute_normal< double >( 0, 1e-3 );
+	}
+
+	GroupedCurves curves( x, nGroups );
+	Vector< double > initial( 2 * nGroups + 1 );
+	for ( std::size_t g = 0; g < nGroups; g++ )
+	{
+		initial( 2 * g ) = 1;
+		initial( 2 * g + 1 ) = 0;
+	}
+	initial( 2 * nGroups ) = 0;
+
+	// the sparse cholesky takes the same steps as the dense one
+	Vector< double > paramDense( initial );
+	Vector< double > paramSparse( initial );
+	const double resDense = Optimization::levenbergMarquardt( curves, paramDense, y,
+		Optimization::OptTerminate( 30, 1e-10 ), Optimization::OptNoNormalize() );
+	const double resSparse = Optimization::sparseLevenbergMarquardt( curves, paramSparse, y,
+		Optimization::OptTerminate( 30, 1e-10 ), Optimization::OptNoNormalize() );
+	BOOST_CHECK_SMALL( resDense - resSparse, 1e-10 );
+	BOOST_CHECK_SMALL( vectorDiffSum( paramDense, paramSparse ), 1e-6 );
+	BOOST_CHECK_SMALL( vectorDiffSum( paramSparse, truth ) / truth.size(), 1e-1 );
+
+	// conjugate gradients converge to the same solution
+	Vector< double > paramCG( initial );
+	const double resCG = Optimization::sparseLevenbergMarquardt( curves, paramCG, y,
+		Optimization::OptTerminate( 30, 1e-10 ), Optimization::OptNoNormalize(), Optimization::sparseLmUseConjugateGradient );
+	BOOST_CHECK_SMALL( resCG - resSparse, 1e-8 );
+	BOOST_CHECK_SMALL( vectorDiffSum( paramCG, paramSparse ), 1e-4 );
+
+	// also with the conjugate gradients of the gpu backend (on the host without a device)
+	Vector< double > paramGpu( initial );
+	const double resGpu = Optimization::sparseLevenbergMarquardt( curves, paramGpu, y,
+		Optimization::OptTerminate( 30, 1e-10 ), Optimization::OptNoNormalize(), Optimization::sparseLmUseGpuConjugateGradient );
+	BOOST_CHECK_SMALL( resGpu - resSparse, 1e-8 );
+	BOOST_CHECK_SMALL( vectorDiffSum( paramGpu, paramSparse ), 1e-4 );
+
+	// weights are applied to the rows of the sparse jacobian
+	Vector< double > paramDenseW( initial );
+	Vector< double > paramSparseW( initial );
+	const double resDenseW = Optimization::weightedLevenbergMarquardt( curves, paramDenseW, y,
+		Optimization::OptTerminate( 30, 1e-10 ), Optimization::OptNoNormalize(), AlternatingWeights() );
+	const double resSparseW = Optimization::weightedSparseLevenbergMarquardt( curves, paramSparseW, y,
+		Optimization::OptTerminate( 30, 1e-10 ), Optimization::OptNoNormalize(), AlternatingWeights() );
+	BOOST_CHECK_SMALL( resDenseW - resSparseW, 1e-10 );
+	BOOST_CHECK_SMALL( vectorDiffSum( paramDenseW, paramSparseW ), 1e-6 );
+
+	// direct check of the decomposition on the structure of the problem
+	Optimization::SparseJacobian< double > J;
+	Vector< double > result( y.size() );
+	curves.evaluateWithJacobian( result, truth, J );
+	BOOST_CHECK_EQUAL( J.nonZeros(), 3 * y.size() );
+
+	Optimization::Detail::SparseCholesky< double > cholesky;
+	cholesky.analyze( J );
+	BOOST_CHECK( cholesky.analyzed( J ) );
+	// the minimum degree ordering avoids fill-in of the arrow-shaped matrix
+	BOOST_CHECK_EQUAL( cholesky.factorNonZeros(), 3 * nGroups + 2 * nGroups + 1 );
+	BOOST_REQUIRE( cholesky.factorize( J, 0.1 ) );
+
+	Vector< double > b( truth.size() );
+	for ( std::size_t i = 0; i < b.size(); i++ )
+		b( i ) = Random::distribute_uniform< double >( -1, 1 );
+	Vector< double > solution( b );
+	cholesky.solve( solution );
+
+	Vector< double > Jx( y.size() );
+	Vector< double > check( b.size() );
+	J.multiply( solution, Jx );
+	J.multiplyTransposed( Jx, check );
+	check += 0.1 * solution;
+	BOOST_CHECK_SMALL( vectorDiffSum( check, b ), 1e-9 );
+}
@@ -0,0 +1,159 @@
+#include <utMath/Vector.h>
+#include <utMath/Geometry/UniformGrid.h>
+#include <utMath/Geometry/KdTree.h>
+#include <utMath/PoseListOperations.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utUtil/Exception.h>
+
+#include <algorithm>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+template< typename T, std::size_t N >
+T squaredDistance( const Vector< T, N >& a, const Vector< T, N >& b )
+{
+	T d( 0 );
+	for ( std::size_t k = 0; k < N; k++ )
+		d += ( a( k ) - b( k ) ) * ( a( k ) - b( k ) );
+	return d;
+}
+
+/** compares the grid to brute force over the points that are still alive */
+template< typename T, std::size_t N >
+void checkGrid( const Geometry::UniformGrid< T, N >& grid, const std::vector< Vector< T, N > >& points,
+	const std::vector< bool >& alive, const std::vector< Vector< T, N > >& queries, const T radius )
+{
+	std::vector< std::pair< T, std::size_t > > result;
+	for ( std::size_t q = 0; q < queries.size(); q++ )
+	{
+		std::vector< std::pair< T, std::size_t > > expected;
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			if ( alive[ i ] )
+				expected.push_back( std::make_pair( squaredDistance( queries[ q ], points[ i ] ), i ) );
+		std::sort( expected.begin(), expected.end() );
+
+		// nearest, also with a bound that excludes it
+		T distanceSq;
+		const std::size_t nearest = grid.nearest( queries[ q ], std::numeric_limits< T >::max(), &distanceSq );
+		BOOST_REQUIRE( nearest != grid.invalid );
+		BOOST_CHECK_EQUAL( distanceSq, expected[ 0 ].first );
+		BOOST_CHECK_EQUAL( squaredDistance( queries[ q ], points[ nearest ] ), expected[ 0 ].first );
+		BOOST_CHECK( grid.nearest( queries[ q ], expected[ 0 ].first ) == grid.invalid );
+
+		grid.kNearest( queries[ q ], 6, result );
+		BOOST_REQUIRE_EQUAL( result.size(), 6u );
+		for ( std::size_t k = 0; k < 6; k++ )
+			BOOST_CHECK_EQUAL( result[ k ].first, expected[ k ].first );
+
+		grid.radiusSearch( queries[ q ], radius * radius, result );
+		std::sort( result.begin(), result.end() );
+		std::size_t nInside = 0;
+		while ( nInside < expected.size() && expected[ nInside ].first < radius * radius )
+			nInside++;
+		BOOST_REQUIRE_EQUAL( result.size(), nInside );
+		for ( std::size_t k = 0; k < nInside; k++ )
+			BOOST_CHECK_EQUAL( result[ k ].first, expected[ k ].first );
+	}
+}
+
+template< typename T, std::size_t N >
+void testUniformGridRandom( const std::size_t nPoints, const T cellSize, const std::size_t nBuckets )
+{
+	typename Random::Vector< T, N >::Uniform randVector( -10, 10 );
+	const T radius( 1.5 );
+
+	std::vector< Vector< T, N > > queries;
+	std::generate_n( std::back_inserter( queries ), 100, randVector );
+	// a query far outside the points
+	queries.push_back( Vector< T, N >( randVector() * T( 5 ) ) );
+
+	// points are stored at the index of their id
+	Geometry::UniformGrid< T, N > grid( cellSize, nBuckets );
+	std::vector< Vector< T, N > > points;
+	std::vector< bool > alive;
+	for ( std::size_t i = 0; i < nPoints; i++ )
+	{
+		points.push_back( randVector() );
+		alive.push_back( true );
+		BOOST_CHECK_EQUAL( grid.insert( points.back() ), i );
+	}
+	BOOST_CHECK_EQUAL( grid.size(), nPoints );
+	checkGrid( grid, points, alive, queries, radius );
+
+	// remove every third point, move every other one a little or far
+	std::size_t nAlive = nPoints;
+	for ( std::size_t i = 0; i < nPoints; i += 3 )
+	{
+		grid.remove( i );
+		alive[ i ] = false;
+		nAlive--;
+	}
+	for ( std::size_t i = 1; i < nPoints; i += 2 )
+		if ( alive[ i ] )
+		{
+			points[ i ] = ( i % 4 == 1 ) ? Vector< T, N >( points[ i ] + randVector() * T( 0.01 ) ) : randVector();
+			grid.move( i, points[ i ] );
+		}
+	BOOST_CHECK_EQUAL( grid.size(), nAlive );
+	BOOST_CHECK( !grid.contains( 0 ) );
+	BOOST_CHECK( grid.contains( 1 ) );
+	BOOST_CHECK_EQUAL( squaredDistance( grid.point( 1 ), points[ 1 ] ), T( 0 ) );
+	checkGrid( grid, points, alive, queries, radius );
+
+	// ids of removed points are reused
+	const std::size_t id = grid.insert( randVector() );
+	BOOST_CHECK( id < nPoints && !alive[ id ] );
+	points[ id ] = grid.point( id );
+	alive[ id ] = true;
+	checkGrid( grid, points, alive, queries, radius );
+
+	// batched queries give the results of single queries, also on several threads
+	const ListExecutor executor( threadExecutor( 4, 8 ) );
+	std::vector< std::size_t > ids;
+	std::vector< T > distancesSq;
+	grid.nearest( queries, ids, distancesSq, std::numeric_limits< T >::max(), executor );
+	std::vector< std::vector< std::pair< T, std::size_t > > > neighbours;
+	grid.kNearest( queries, 4, neighbours, std::numeric_limits< T >::max(), executor );
+	std::vector< std::vector< std::pair< T, std::size_t > > > inRadius;
+	grid.radiusSearch( queries, radius * radius, inRadius, executor );
+	BOOST_REQUIRE_EQUAL( ids.size(), queries.size() );
+
+	std::vector< std::pair< T, std::size_t > > single;
+	for ( std::size_t q = 0; q < queries.size(); q++ )
+	{
+		BOOST_CHECK_EQUAL( ids[ q ], grid.nearest( queries[ q ] ) );
+		grid.kNearest( queries[ q ], 4, single );
+		BOOST_CHECK( neighbours[ q ] == single );
+		grid.radiusSearch( queries[ q ], radius * radius, single );
+		BOOST_CHECK( inRadius[ q ] == single );
+	}
+
+	grid.clear();
+	BOOST_CHECK_EQUAL( grid.size(), 0u );
+	BOOST_CHECK( grid.nearest( queries[ 0 ] ) == grid.invalid );
+}
+
+} // anonymous namespace
+
+void TestUniformGrid()
+{
+	// empty grid and invalid parameters
+	Geometry::UniformGrid< double, 3 > empty( 1.0 );
+	BOOST_CHECK( empty.nearest( Vector< double, 3 >( 0, 0, 0 ) ) == empty.invalid );
+	BOOST_CHECK_THROW( empty.remove( 0 ), Ubitrack::Util::Exception );
+	BOOST_CHECK_THROW( ( Geometry::UniformGrid< float, 2 >( 0.0f ) ), Ubitrack::Util::Exception );
+
+	testUniformGridRandom< float, 2 >( 500, 1.0f, 256 );
+	testUniformGridRandom< double, 3 >( 1000, 2.0, 4096 );
+	// few buckets, many cells share one
+	testUniformGridRandom< double, 3 >( 300, 0.5, 7 );
+	// cells much smaller than the distances between points
+	testUniformGridRandom< double, 2 >( 100, 0.05, 1024 );
+}
@@ -0,0 +1,44 @@
+#include <utMeasurement/Measurement.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+void TestCopyOnWrite()
+{
+	Measurement::PositionList a( 100, boost::shared_ptr< std::vector< Vector< double, 3 > > >( new std::vector< Vector< double, 3 > >( 1000, Vector< double, 3 >( 1, 2, 3 ) ) ) );
+	const std::vector< Vector< double, 3 > >* original = a.get();
+
+	// an unshared payload is modified in place
+	a.writable()[ 0 ]( 0 ) = 5;
+	BOOST_CHECK_EQUAL( a.get(), original );
+	BOOST_CHECK_EQUAL( ( *a )[ 0 ]( 0 ), 5.0 );
+
+	// reading a shared payload does not copy
+	Measurement::PositionList b( a );
+	BOOST_CHECK_EQUAL( ( *b )[ 0 ]( 0 ), 5.0 );
+	BOOST_CHECK_EQUAL( b.get(), original );
+	BOOST_CHECK_EQUAL( a.use_count(), 2 );
+
+	// writing a shared payload copies it, the other measurement keeps its value
+	b.writable()[ 0 ]( 0 ) = 7;
+	BOOST_CHECK( b.get() != original );
+	BOOST_CHECK_EQUAL( a.get(), original );
+	BOOST_CHECK_EQUAL( ( *a )[ 0 ]( 0 ), 5.0 );
+	BOOST_CHECK_EQUAL( ( *b )[ 0 ]( 0 ), 7.0 );
+	BOOST_CHECK_EQUAL( b->size(), 1000u );
+	BOOST_CHECK_EQUAL( b.time(), a.time() );
+	BOOST_CHECK( a.unique() && b.unique() );
+
+	// the copy is unshared, so further writes stay in place
+	const std::vector< Vector< double, 3 > >* copy = b.get();
+	b.writable()[ 1 ]( 1 ) = 8;
+	BOOST_CHECK_EQUAL( b.get(), copy );
+
+	// the last owner of a formerly shared payload writes in place
+	Measurement::PositionList c( a );
+	c = Measurement::PositionList();
+	a.writable()[ 2 ]( 2 ) = 9;
+	BOOST_CHECK_EQUAL( a.get(), original );
+}
@@ -0,0 +1,54 @@
+#include <utMeasurement/InlineMeasurement.h>
+#include <utMath/Random/Rotation.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+void TestInlineMeasurement()
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	const Math::Pose pose( randQuat(), Vector< double, 3 >( 1, 2, 3 ) );
+
+	// default constructed measurements are invalid but have a payload
+	Measurement::InlinePose empty;
+	BOOST_CHECK( empty.invalid() );
+	BOOST_CHECK( empty.get() != 0 );
+
+	// copies do not share the payload
+	Measurement::InlinePose a( 10, pose );
+	Measurement::InlinePose b( a );
+	*b = Math::Pose( pose.rotation(), Vector< double, 3 >( 5, 2, 3 ) );
+	BOOST_CHECK_EQUAL( a->translation()( 0 ), 1.0 );
+	BOOST_CHECK_EQUAL( b.time(), 10u );
+
+	// conversion to the shared form copies timestamp and payload
+	Measurement::Pose shared( a.shared() );
+	BOOST_CHECK_EQUAL( shared.time(), 10u );
+	BOOST_CHECK_EQUAL( shared->translation()( 2 ), 3.0 );
+	*shared = Math::Pose( pose.rotation(), Vector< double, 3 >( 1, 2, 0 ) );
+	BOOST_CHECK_EQUAL( ( *a ).translation()( 2 ), 3.0 );
+
+	// and back
+	Measurement::InlinePose c( shared );
+	BOOST_CHECK_EQUAL( c.time(), 10u );
+	BOOST_CHECK_EQUAL( c->translation()( 2 ), 0.0 );
+
+	// shared measurements without payload give a default payload
+	Measurement::InlineButton button( Measurement::Button( 3 ) );
+	BOOST_CHECK_EQUAL( button.time(), 3u );
+	BOOST_CHECK_EQUAL( int( *button ), 0 );
+
+	// stored next to the timestamp
+	BOOST_CHECK( sizeof( Measurement::InlinePosition ) <= sizeof( Measurement::Timestamp ) + sizeof( Vector< double, 3 > ) + sizeof( void* ) );
+
+	std::vector< Measurement::InlineRotation > rotations;
+	for ( std::size_t i = 0; i < 100; i++ )
+		rotations.push_back( Measurement::InlineRotation( i + 1, randQuat() ) );
+	rotations[ 0 ].invalidate();
+	BOOST_CHECK( rotations[ 0 ].invalid() );
+	BOOST_CHECK_EQUAL( rotations[ 99 ].time(), 100u );
+}
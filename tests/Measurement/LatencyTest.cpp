@@ -0,0 +1,55 @@
+#include <utMeasurement/Measurement.h>
+#include <utMeasurement/LatencyRecorder.h>
+#include <utUtil/TimerRegistry.h>
+
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+void TestLatency()
+{
+	Measurement::Pose pose( 1000, Math::Pose() );
+	const Measurement::Pose copy( pose );
+	const Measurement::Pose cloned( pose.clone() );
+	BOOST_CHECK_EQUAL( copy.created(), pose.created() );
+	BOOST_CHECK_EQUAL( cloned.created(), pose.created() );
+
+	// a measurement computed from the pose
+	boost::this_thread::sleep( boost::posix_time::milliseconds( 2 ) );
+	Measurement::Position position( pose.time(), pose->translation() );
+	position.derivedFrom( pose );
+	position.addHop();
+	BOOST_CHECK_EQUAL( position.created(), pose.created() );
+
+	Measurement::LatencyRecorder recorder( "latency_test" );
+	recorder.record( position );
+	recorder.record( Measurement::Pose() );
+	const Util::HistogramBlockTimer::Statistics stats( recorder.timer().getStatistics() );
+
+	if ( Measurement::Pose::latencyEnabled() )
+	{
+		BOOST_CHECK( pose.created() != 0 );
+		BOOST_CHECK_EQUAL( position.hops(), 2u );
+		BOOST_CHECK_EQUAL( recorder.maxHops(), 2u );
+
+		// the default constructed measurement has no creation time and is skipped
+		BOOST_CHECK_EQUAL( stats.runs, 1u );
+		BOOST_CHECK( stats.max >= 1.0 );
+
+		// the recorder is reported by the registry
+		const std::vector< Util::TimerStatistics > snapshot( Util::TimerRegistry::instance().snapshot() );
+		bool bFound = false;
+		for ( std::size_t i = 0; i < snapshot.size(); i++ )
+			bFound |= snapshot[ i ].name == "latency.latency_test";
+		BOOST_CHECK( bFound );
+	}
+	else
+	{
+		BOOST_CHECK_EQUAL( pose.created(), 0 );
+		BOOST_CHECK_EQUAL( position.hops(), 0u );
+		BOOST_CHECK_EQUAL( stats.runs, 0u );
+	}
+}
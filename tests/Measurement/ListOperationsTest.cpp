@@ -0,0 +1,79 @@
+#include <utMeasurement/ListOperations.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+void TestListOperations()
+{
+	Random::Quaternion< double >::Uniform randQuat;
+	Random::Vector< double, 3 >::Uniform randVector( -10, 10 );
+
+	const Pose p( randQuat(), randVector() );
+	Measurement::PoseList poses( 100, boost::shared_ptr< std::vector< Pose > >( new std::vector< Pose > ) );
+	Measurement::PositionList positions( 200, boost::shared_ptr< std::vector< Vector< double, 3 > > >( new std::vector< Vector< double, 3 > > ) );
+	for ( std::size_t i = 0; i < 10; i++ )
+	{
+		poses->push_back( Pose( randQuat(), randVector() ) );
+		positions->push_back( randVector() );
+	}
+
+	// a result without payload gets one
+	Measurement::PoseList result;
+	Measurement::multiply( p, poses, result );
+	BOOST_REQUIRE( result.get() != 0 );
+	BOOST_CHECK_EQUAL( result.time(), 100u );
+	BOOST_REQUIRE_EQUAL( result->size(), 10u );
+	BOOST_CHECK_SMALL( boost::numeric::ublas::norm_2( ( *result )[ 3 ].translation() - ( p * ( *poses )[ 3 ] ).translation() ), 1e-10 );
+
+	// an unshared payload is reused
+	const std::vector< Pose >* payload = result.get();
+	Measurement::invert( poses, result );
+	BOOST_CHECK( result.get() == payload );
+	BOOST_CHECK_SMALL( boost::numeric::ublas::norm_2( ( *result )[ 5 ].translation() - ( ~( *poses )[ 5 ] ).translation() ), 1e-10 );
+
+	// a shared payload is not overwritten
+	const Measurement::PoseList shared( result );
+	Measurement::multiply( poses, p, result );
+	BOOST_CHECK( result.get() != shared.get() );
+	BOOST_CHECK_SMALL( boost::numeric::ublas::norm_2( ( *shared )[ 5 ].translation() - ( ~( *poses )[ 5 ] ).translation() ), 1e-10 );
+
+	// the result may be the input
+	Measurement::PoseList inPlace( poses.clone() );
+	Measurement::multiply( p, inPlace, inPlace );
+	BOOST_CHECK_SMALL( boost::numeric::ublas::norm_2( ( *inPlace )[ 7 ].translation() - ( p * ( *poses )[ 7 ] ).translation() ), 1e-10 );
+
+	Measurement::PoseList interpolated;
+	Measurement::interpolate( poses, Measurement::PoseList( 300, *poses ), 0.5, interpolated );
+	BOOST_CHECK_EQUAL( interpolated.time(), 200u );
+
+	Measurement::PositionList transformed;
+	Measurement::transform( p, positions, transformed );
+	BOOST_CHECK_EQUAL( transformed.time(), 200u );
+	BOOST_CHECK_SMALL( boost::numeric::ublas::norm_2( ( *transformed )[ 2 ] - p * ( *positions )[ 2 ] ), 1e-10 );
+
+	Measurement::DistanceList d;
+	Measurement::distances( positions, transformed, d );
+	BOOST_REQUIRE_EQUAL( d->size(), 10u );
+	BOOST_CHECK_SMALL( ( *d )[ 2 ].m_value - boost::numeric::ublas::norm_2( ( *positions )[ 2 ] - ( *transformed )[ 2 ] ), 1e-10 );
+
+	// positions with error, the pose error is added to the rotated point error
+	Measurement::ErrorPositionList errorPositions( 400, boost::shared_ptr< std::vector< ErrorVector< double, 3 > > >(
+		new std::vector< ErrorVector< double, 3 > >( 10, ErrorVector< double, 3 >( randVector(), Matrix< double, 3, 3 >::identity() ) ) ) );
+	const ErrorPose ep( p, Matrix< double, 6, 6 >::identity() * 1e-4 );
+	Measurement::ErrorPositionList errorTransformed;
+	Measurement::transform( ep, errorPositions, errorTransformed );
+	BOOST_CHECK_EQUAL( errorTransformed.time(), 400u );
+	BOOST_REQUIRE_EQUAL( errorTransformed->size(), 10u );
+	const ErrorVector< double, 3 > single( ep * ( *errorPositions )[ 4 ] );
+	BOOST_CHECK_SMALL( double( boost::numeric::ublas::norm_frobenius( ( *errorTransformed )[ 4 ].covariance - single.covariance ) ), 1e-10 );
+
+	// a pose without error keeps the unit covariance
+	Measurement::transform( p, errorPositions, errorTransformed );
+	BOOST_CHECK_SMALL( double( boost::numeric::ublas::norm_2( ( *errorTransformed )[ 4 ].value - p * ( *errorPositions )[ 4 ].value ) ), 1e-10 );
+	BOOST_CHECK_SMALL( double( boost::numeric::ublas::norm_frobenius( ( *errorTransformed )[ 4 ].covariance - Matrix< double, 3, 3 >::identity() ) ), 1e-10 );
+}
@@ -0,0 +1,80 @@
+#include <utMeasurement/LocalMeasurement.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+void TestLocalMeasurement()
+{
+	const Math::Pose pose( Math::Quaternion(), Vector< double, 3 >( 1, 2, 3 ) );
+
+	// default constructed measurements are invalid and have no payload
+	Measurement::LocalPose empty;
+	BOOST_CHECK( empty.invalid() );
+	BOOST_CHECK( empty.get() == 0 );
+	BOOST_CHECK_EQUAL( empty.use_count(), 0u );
+
+	// copies share the payload and count without atomics
+	Measurement::LocalPose a( 10, pose );
+	{
+		Measurement::LocalPose b( a );
+		Measurement::LocalPose c;
+		c = b;
+		c = c;
+		BOOST_CHECK_EQUAL( a.use_count(), 3u );
+		BOOST_CHECK( b.get() == a.get() );
+		BOOST_CHECK_EQUAL( c.time(), 10u );
+
+		// copy-on-write leaves the others alone
+		c.writable() = Math::Pose( pose.rotation(), Vector< double, 3 >( 5, 2, 3 ) );
+		BOOST_CHECK_EQUAL( a->translation()( 0 ), 1.0 );
+		BOOST_CHECK_EQUAL( c->translation()( 0 ), 5.0 );
+		BOOST_CHECK_EQUAL( a.use_count(), 2u );
+		BOOST_CHECK( c.unique() );
+	}
+	BOOST_CHECK( a.unique() );
+
+	// a unique handle is written in place
+	Math::Pose* p = a.get();
+	a.writable() = pose;
+	BOOST_CHECK( a.get() == p );
+
+	// conversion to the thread-safe form shares the payload
+	Measurement::Pose shared( a.shared() );
+	BOOST_CHECK_EQUAL( shared.time(), 10u );
+	BOOST_CHECK( shared.get() == a.get() );
+	BOOST_CHECK( !a.unique() );
+
+	// so writing through the local handle copies
+	a.writable() = Math::Pose( pose.rotation(), Vector< double, 3 >( 1, 2, 0 ) );
+	BOOST_CHECK_EQUAL( shared->translation()( 2 ), 3.0 );
+	BOOST_CHECK( a.unique() );
+
+	// and back, again without copying
+	Measurement::LocalPose d( shared );
+	BOOST_CHECK_EQUAL( d.time(), 10u );
+	BOOST_CHECK( d.get() == shared.get() );
+
+	// clone copies the payload
+	Measurement::LocalPose e( d.clone() );
+	BOOST_CHECK( e.get() != d.get() );
+	BOOST_CHECK_EQUAL( e->translation()( 2 ), 3.0 );
+
+	// missing payloads survive the round trip
+	Measurement::LocalPositionList none( Measurement::PositionList( 20 ) );
+	BOOST_CHECK( none.get() == 0 );
+	BOOST_CHECK( !none.shared() );
+	BOOST_CHECK_EQUAL( none.shared().time(), 20u );
+
+	// lists are shared, not copied
+	std::vector< Vector< double, 3 > > points( 100, Vector< double, 3 >( 0, 0, 1 ) );
+	Measurement::LocalPositionList list( 30, points );
+	std::vector< Measurement::LocalPositionList > history( 10, list );
+	BOOST_CHECK_EQUAL( list.use_count(), 11u );
+	BOOST_CHECK( history[ 9 ].get() == list.get() );
+	history.clear();
+	BOOST_CHECK( list.unique() );
+}
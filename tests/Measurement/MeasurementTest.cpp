@@ -0,0 +1,31 @@
+#include "MeasurementTest.h"
+
+// declare external tests here, to save us some trivial header files
+void TestMeasurementPool();
+void TestInlineMeasurement();
+void TestTimestamp();
+void TestTimestampSync();
+void TestListOperations();
+void TestMeasurementRingBuffer();
+void TestStreamSynchronizer();
+void TestLatency();
+void TestCopyOnWrite();
+void TestLocalMeasurement();
+
+
+
+MeasurementTest::MeasurementTest()
+	: boost::unit_test::test_suite( "MeasurementTests" )
+{
+	add( BOOST_TEST_CASE( &TestMeasurementPool ) );
+	add( BOOST_TEST_CASE( &TestInlineMeasurement ) );
+	add( BOOST_TEST_CASE( &TestTimestamp ) );
+	add( BOOST_TEST_CASE( &TestTimestampSync ) );
+	add( BOOST_TEST_CASE( &TestListOperations ) );
+	add( BOOST_TEST_CASE( &TestMeasurementRingBuffer ) );
+	add( BOOST_TEST_CASE( &TestStreamSynchronizer ) );
+	add( BOOST_TEST_CASE( &TestLatency ) );
+	add( BOOST_TEST_CASE( &TestCopyOnWrite ) );
+	add( BOOST_TEST_CASE( &TestLocalMeasurement ) );
+}
+
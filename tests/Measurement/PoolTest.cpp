@@ -0,0 +1,81 @@
+#include <utMeasurement/MeasurementPool.h>
+#include <utMath/Random/Rotation.h>
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** creates and releases pooled measurements, checking that no two live payloads share memory */
+void poolWorker( const unsigned id, const std::size_t n, bool& ok )
+{
+	std::vector< Measurement::Position > live;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const double v = id * n + i;
+		live.push_back( Measurement::makePooled( i + 1, Vector< double, 3 >( v, v, v ) ) );
+
+		// release half of the measurements every few steps to recycle blocks
+		if ( live.size() == 16 )
+		{
+			for ( std::size_t j = 0; j < live.size(); j++ )
+				if ( ( *live[ j ] )( 0 ) != ( *live[ j ] )( 2 ) || live[ j ].time() == 0 )
+					ok = false;
+			live.erase( live.begin(), live.begin() + 8 );
+		}
+	}
+	for ( std::size_t j = 1; j < live.size(); j++ )
+		if ( ( *live[ j ] )( 0 ) != ( *live[ j - 1 ] )( 0 ) + 1 )
+			ok = false;
+}
+
+} // anonymous namespace
+
+
+void TestMeasurementPool()
+{
+	// payload and timestamp are stored as with the normal constructors
+	Random::Quaternion< double >::Uniform randQuat;
+	const Quaternion q( randQuat() );
+	Measurement::Rotation r( Measurement::makePooled( 42, q ) );
+	BOOST_CHECK_EQUAL( r.time(), 42u );
+	BOOST_CHECK( !r.invalid() );
+	BOOST_CHECK( *r == q );
+
+	// copies share the payload, clones do not
+	Measurement::Rotation shared( r );
+	Measurement::Rotation cloned( r.clone() );
+	*r = ~q;
+	BOOST_CHECK( *shared == ~q );
+	BOOST_CHECK( *cloned == q );
+
+	// default constructed payload
+	Measurement::Button b( Measurement::makePooled< Math::Scalar< int > >( 7 ) );
+	BOOST_CHECK( b.get() != 0 );
+	BOOST_CHECK_EQUAL( b.time(), 7u );
+
+	// released blocks are handed out again
+	Measurement::Pose p( Measurement::makePooled( 1, Math::Pose() ) );
+	const Math::Pose* address = p.get();
+	p.reset();
+	p = Measurement::makePooled( 2, Math::Pose( q, Vector< double, 3 >( 1, 2, 3 ) ) );
+	BOOST_CHECK( p.get() == address );
+	BOOST_CHECK_EQUAL( p->translation()( 2 ), 3.0 );
+
+	// concurrent allocation and release from several threads
+	const unsigned nThreads = 4;
+	bool ok[ nThreads ];
+	boost::thread_group threads;
+	for ( unsigned i = 0; i < nThreads; i++ )
+	{
+		ok[ i ] = true;
+		threads.create_thread( boost::bind( &poolWorker, i, 10000, boost::ref( ok[ i ] ) ) );
+	}
+	threads.join_all();
+	for ( unsigned i = 0; i < nThreads; i++ )
+		BOOST_CHECK( ok[ i ] );
+}
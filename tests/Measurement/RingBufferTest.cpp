@@ -0,0 +1,142 @@
+#include <utMeasurement/MeasurementRingBuffer.h>
+#include <utMath/Random/Rotation.h>
+#include <utUtil/Exception.h>
+
+#include <cmath>
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** samples the latest part of a buffer of vectors ( n, 2n, 3n ) at timestamps 1000 n and counts wrong samples */
+void ringBufferReader( const Measurement::MeasurementRingBuffer< Vector< double, 3 > >& buffer, const boost::atomic< bool >& done,
+	unsigned& errors, unsigned& samples )
+{
+	Vector< double, 3 > v;
+	while ( !done.load( boost::memory_order_acquire ) )
+	{
+		const Measurement::Position latest( buffer.latest() );
+		if ( latest.invalid() )
+			continue;
+		if ( std::fabs( ( *latest )( 0 ) * 1000 - latest.time() ) > 1e-6 )
+			errors++;
+
+		// between the two newest measurements
+		const Measurement::Timestamp t = latest.time() - 250;
+		if ( !buffer.sampleAt( t, v ) )
+			continue;
+		samples++;
+		if ( std::fabs( v( 0 ) * 1000 - t ) > 1e-6 || std::fabs( v( 2 ) - 3 * v( 0 ) ) > 1e-6 )
+			errors++;
+	}
+}
+
+} // anonymous namespace
+
+
+void TestMeasurementRingBuffer()
+{
+	BOOST_CHECK_THROW( Measurement::MeasurementRingBuffer< Math::Pose >( 0 ), Ubitrack::Util::Exception );
+
+	// poses are interpolated like linearInterpolate
+	Random::Quaternion< double >::Uniform randQuat;
+	Measurement::MeasurementRingBuffer< Math::Pose > poses( 4 );
+	BOOST_CHECK( poses.empty() );
+	BOOST_CHECK( poses.latest().invalid() );
+	BOOST_CHECK( poses.sampleAt( 100 ).invalid() );
+
+	std::vector< Math::Pose > pushed;
+	for ( unsigned i = 0; i < 6; i++ )
+	{
+		pushed.push_back( Math::Pose( randQuat(), Vector< double, 3 >( i, 2.0 * i, 0 ) ) );
+		poses.push( Measurement::Pose( 100 * ( i + 1 ), pushed.back() ) );
+	}
+	BOOST_CHECK_EQUAL( poses.size(), 4u );
+	BOOST_CHECK_EQUAL( poses.latest().time(), 600u );
+
+	// the two oldest ones are overwritten, times outside are not extrapolated
+	BOOST_CHECK( poses.sampleAt( 250 ).invalid() );
+	BOOST_CHECK( poses.sampleAt( 601 ).invalid() );
+
+	const Measurement::Pose sample( poses.sampleAt( 375 ) );
+	BOOST_REQUIRE( !sample.invalid() );
+	BOOST_CHECK_EQUAL( sample.time(), 375u );
+	const Math::Pose expected( linearInterpolate( pushed[ 2 ], pushed[ 3 ], 0.75 ) );
+	BOOST_CHECK_SMALL( norm_2( sample->translation() - expected.translation() ), 1e-12 );
+	BOOST_CHECK_SMALL( std::fabs( sample->rotation().x() - expected.rotation().x() ), 1e-12 );
+	BOOST_CHECK_SMALL( std::fabs( sample->rotation().w() - expected.rotation().w() ), 1e-12 );
+
+	// exact hits and the borders
+	BOOST_CHECK_SMALL( norm_2( poses.sampleAt( 300 )->translation() - pushed[ 2 ].translation() ), 1e-12 );
+	BOOST_CHECK_SMALL( norm_2( poses.sampleAt( 600 )->translation() - pushed[ 5 ].translation() ), 1e-12 );
+
+	// nearest without interpolation
+	Measurement::Timestamp found;
+	Math::Pose pose;
+	BOOST_CHECK( poses.nearest( 340, found, pose ) );
+	BOOST_CHECK_EQUAL( found, 300u );
+	BOOST_CHECK( poses.nearest( 360, found, pose ) );
+	BOOST_CHECK_EQUAL( found, 400u );
+	BOOST_CHECK( poses.nearest( 10, found, pose ) );
+	BOOST_CHECK_EQUAL( found, 300u );
+	BOOST_CHECK( poses.nearest( 1000, found, pose ) );
+	BOOST_CHECK_EQUAL( found, 600u );
+
+	// timestamps must not decrease
+	BOOST_CHECK_THROW( poses.push( 500, pushed[ 0 ] ), Ubitrack::Util::Exception );
+	poses.clear();
+	BOOST_CHECK( poses.empty() );
+	BOOST_CHECK( !poses.nearest( 300, found, pose ) );
+	poses.push( 50, pushed[ 0 ] );
+	BOOST_CHECK_EQUAL( poses.size(), 1u );
+
+	// placing the slots on the pushing thread starts over
+	poses.place();
+	BOOST_CHECK( poses.empty() );
+	poses.push( 20, pushed[ 0 ] );
+	BOOST_CHECK_EQUAL( poses.size(), 1u );
+	BOOST_CHECK( poses.nearest( 30, found, pose ) );
+	BOOST_CHECK_EQUAL( found, 20u );
+
+	// rotations use slerp, scalars are linear
+	Measurement::MeasurementRingBuffer< Math::Quaternion > rotations( 8 );
+	const Math::Quaternion qa( randQuat() ), qb( randQuat() );
+	rotations.push( 10, qa );
+	rotations.push( 20, qb );
+	const Math::Quaternion q( *rotations.sampleAt( 12 ) );
+	const Math::Quaternion qExpected( slerp( qa, qb, 0.2 ) );
+	BOOST_CHECK_SMALL( std::fabs( q.x() - qExpected.x() ) + std::fabs( q.w() - qExpected.w() ), 1e-12 );
+
+	Measurement::MeasurementRingBuffer< Math::Scalar< double > > distances( 8 );
+	distances.push( 10, 1.0 );
+	distances.push( 20, 3.0 );
+	BOOST_CHECK_CLOSE( distances.sampleAt( 15 )->m_value, 2.0, 1e-10 );
+
+	// readers sample while the buffer wraps around many times
+	Measurement::MeasurementRingBuffer< Vector< double, 3 > > positions( 64 );
+	boost::atomic< bool > done( false );
+	const unsigned nThreads = 3;
+	unsigned errors[ nThreads ] = { 0 };
+	unsigned samples[ nThreads ] = { 0 };
+	boost::thread_group threads;
+	for ( unsigned i = 0; i < nThreads; i++ )
+		threads.create_thread( boost::bind( &ringBufferReader, boost::cref( positions ), boost::cref( done ),
+			boost::ref( errors[ i ] ), boost::ref( samples[ i ] ) ) );
+
+	for ( unsigned n = 1; n <= 200000; n++ )
+		positions.push( 1000 * n, Vector< double, 3 >( n, 2.0 * n, 3.0 * n ) );
+	done.store( true, boost::memory_order_release );
+	threads.join_all();
+
+	for ( unsigned i = 0; i < nThreads; i++ )
+		BOOST_CHECK_EQUAL( errors[ i ], 0u );
+	BOOST_CHECK_EQUAL( positions.size(), 64u );
+	BOOST_CHECK_CLOSE( ( *positions.sampleAt( 1000 * 199990 + 500 ) )( 1 ), 2 * 199990.5, 1e-10 );
+}
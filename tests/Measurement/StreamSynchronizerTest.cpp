@@ -0,0 +1,83 @@
+#include <utMeasurement/StreamSynchronizer.h>
+#include <utUtil/Exception.h>
+
+#include <cmath>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+namespace {
+
+typedef Measurement::StreamSynchronizer< Vector< double, 3 >, Scalar< double >, Quaternion > Synchronizer;
+
+} // anonymous namespace
+
+
+void TestStreamSynchronizer()
+{
+	BOOST_CHECK_THROW( Synchronizer( Synchronizer::nearest, 10, 100, 0 ), Ubitrack::Util::Exception );
+
+	// nearest: a tuple is complete when all streams reach the reference timestamp
+	Synchronizer sync( Synchronizer::nearest, 10, 1000, 8 );
+	Measurement::Timestamp t;
+	Synchronizer::value_type values;
+	sync.push< 0 >( 100, Vector< double, 3 >( 1, 0, 0 ) );
+	sync.push< 1 >( 95, 1.0 );
+	BOOST_CHECK( !sync.pop( t, values ) );
+	sync.push< 2 >( Measurement::Rotation( 98, Quaternion() ) );
+	BOOST_CHECK( !sync.pop( t, values ) );
+	sync.push< 1 >( 102, 2.0 );
+	BOOST_CHECK( !sync.pop( t, values ) );
+	sync.push< 2 >( 120, Quaternion( 0, 0, 1, 0 ) );
+	BOOST_REQUIRE( sync.pop( t, values ) );
+	BOOST_CHECK_EQUAL( t, 100u );
+	BOOST_CHECK_EQUAL( values.get< 0 >()( 0 ), 1.0 );
+	BOOST_CHECK_EQUAL( values.get< 1 >().m_value, 2.0 );
+	BOOST_CHECK_EQUAL( values.get< 2 >().w(), 1.0 );
+	BOOST_CHECK( !sync.pop( t, values ) );
+
+	// a reference without a measurement within the tolerance is dropped
+	sync.push< 0 >( 140, Vector< double, 3 >( 2, 0, 0 ) );
+	sync.push< 1 >( 141, 3.0 );
+	sync.push< 2 >( 160, Quaternion() );
+	BOOST_CHECK( !sync.pop( t, values ) );
+	BOOST_CHECK_EQUAL( sync.droppedCount(), 1u );
+
+	// a stream that stops sending drops references after the maximum delay
+	sync.push< 0 >( 200, Vector< double, 3 >( 3, 0, 0 ) );
+	sync.push< 2 >( 200, Quaternion() );
+	BOOST_CHECK( !sync.pop( t, values ) );
+	sync.push< 0 >( 1300, Vector< double, 3 >( 4, 0, 0 ) );
+	BOOST_CHECK( !sync.pop( t, values ) );
+	BOOST_CHECK_EQUAL( sync.droppedCount(), 2u );
+
+	BOOST_CHECK_THROW( sync.push< 1 >( 100, 1.0 ), Ubitrack::Util::Exception );
+	sync.clear();
+
+	// interpolation of regular streams at different rates
+	Synchronizer interpolating( Synchronizer::interpolate, 20, 1000, 16 );
+	std::size_t nTuples = 0;
+	for ( Measurement::Timestamp time = 1000; time < 5000; time++ )
+	{
+		if ( time % 33 == 0 )
+			interpolating.push< 0 >( time, Vector< double, 3 >( double( time ), 0, 0 ) );
+		if ( time % 10 == 0 )
+			interpolating.push< 1 >( time, 2.0 * time );
+		if ( time % 4 == 0 )
+			interpolating.push< 2 >( time, Quaternion::fromLogarithm( Vector< double, 3 >( 0, 0, 1e-4 * time ) ) );
+
+		while ( interpolating.pop( t, values ) )
+		{
+			nTuples++;
+			BOOST_CHECK_EQUAL( values.get< 0 >()( 0 ), double( t ) );
+			BOOST_CHECK_CLOSE( values.get< 1 >().m_value, 2.0 * t, 1e-10 );
+			BOOST_CHECK_SMALL( values.get< 2 >().toLogarithm()( 2 ) - 1e-4 * t, 1e-10 );
+		}
+	}
+	// all but the last reference form tuples
+	BOOST_CHECK_EQUAL( interpolating.droppedCount(), 0u );
+	BOOST_CHECK( nTuples >= 4000 / 33 - 1 );
+}
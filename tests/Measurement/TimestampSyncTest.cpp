@@ -0,0 +1,133 @@
+#include <utMeasurement/TimestampSync.h>
+#include <utMeasurement/TimestampSyncLS.h>
+#include <utMath/Random/Scalar.h>
+
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** local time of a native clock that counts at 1 kHz and runs 100 ppm fast, in ns */
+Measurement::Timestamp trueLocal( const double native )
+{
+	return 1000000000000000000ULL + static_cast< Measurement::Timestamp >( native * 1e6 * 1.0001 );
+}
+
+/** absolute difference of two timestamps in ms */
+double differenceMs( const Measurement::Timestamp a, const Measurement::Timestamp b )
+{
+	return ( a > b ? a - b : b - a ) * 1e-6;
+}
+
+/** converts without updating until the writer is done and counts conversions that went backwards */
+template< class Sync >
+void timestampSyncReader( const Sync& sync, const boost::atomic< bool >& done, unsigned& errors )
+{
+	Measurement::Timestamp last = 0;
+	while ( !done.load( boost::memory_order_acquire ) )
+	{
+		Measurement::Timestamp t;
+		if ( !sync.toLocal( 1e7, t ) )
+			continue;
+		// the estimate converges, conversions of a fixed time far ahead stay close
+		if ( last != 0 && differenceMs( t, last ) > 50 )
+			errors++;
+		last = t;
+	}
+}
+
+/** feeds packets of 32 samples with up to 2 ms of arrival jitter */
+template< class Sync >
+void testTimestampSync( Sync& sync )
+{
+	Measurement::Timestamp t;
+	BOOST_CHECK( !sync.toLocal( 0.0, t ) );
+
+	boost::atomic< bool > done( false );
+	unsigned errors = 0;
+	boost::thread reader( boost::bind( &timestampSyncReader< Sync >, boost::cref( sync ), boost::cref( done ), boost::ref( errors ) ) );
+
+	std::vector< double > packet( 32 );
+	std::vector< Measurement::Timestamp > result;
+	for ( unsigned p = 0; p < 500; p++ )
+	{
+		for ( unsigned i = 0; i < 32; i++ )
+			packet[ i ] = 32.0 * p + i;
+		const Measurement::Timestamp arrival = trueLocal( packet.back() ) + Math::Random::distribute_uniform< unsigned >( 0, 2000000 );
+		sync.convertNativeToLocal( packet, arrival, result );
+		BOOST_REQUIRE_EQUAL( result.size(), 32u );
+		for ( unsigned i = 1; i < 32; i++ )
+			BOOST_CHECK( result[ i ] >= result[ i - 1 ] );
+	}
+	done.store( true, boost::memory_order_release );
+	reader.join();
+	BOOST_CHECK_EQUAL( errors, 0u );
+	BOOST_CHECK_EQUAL( sync.getEventCount(), 500u );
+
+	// the estimate is within the jitter
+	for ( unsigned i = 0; i < 32; i++ )
+	{
+		BOOST_CHECK( differenceMs( result[ i ], trueLocal( packet[ i ] ) ) < 3 );
+		BOOST_REQUIRE( sync.toLocal( packet[ i ], t ) );
+		BOOST_CHECK_EQUAL( t, result[ i ] );
+	}
+	BOOST_CHECK( differenceMs( sync.getClockModel().toLocal( 20000.0 ), trueLocal( 20000.0 ) ) < 3 );
+}
+
+/**
+ * a native clock in ms that starts after days of uptime and changes its drift from 100 to 40 ppm,
+ * the least-squares fit must follow the change without losing precision
+ */
+void testTimestampSyncLSDrift()
+{
+	Measurement::TimestampSyncLS sync( 0.002 );
+	const double nativeStart = 3e8;
+	Measurement::Timestamp localChange = 0;
+	Measurement::Timestamp converted = 0;
+	Measurement::Timestamp expected = 0;
+	for ( unsigned i = 0; i < 20000; i++ )
+	{
+		const double native = nativeStart + i;
+		expected = i < 10000 ? 1000000000ULL * 1000000000ULL + static_cast< Measurement::Timestamp >( i * 1e6 * 1.0001 )
+			: localChange + static_cast< Measurement::Timestamp >( ( i - 10000.0 ) * 1e6 * 1.00004 );
+		if ( i == 10000 )
+			localChange = expected = 1000000000ULL * 1000000000ULL + static_cast< Measurement::Timestamp >( i * 1e6 * 1.0001 );
+
+		// up to 0.2 ms of jitter and a few late outliers
+		Measurement::Timestamp local = expected + Math::Random::distribute_uniform< unsigned >( 0, 200000 );
+		if ( i % 1000 == 500 )
+			local += 20000000;
+		converted = sync.convertNativeToLocal( native, local );
+	}
+	BOOST_CHECK_EQUAL( sync.getEventCount(), 20000u );
+
+	// the estimate lies in the middle of the jitter and has the new drift
+	BOOST_CHECK( differenceMs( converted, expected + 100000 ) < 0.05 );
+	const Measurement::ClockModel model( sync.getClockModel() );
+	BOOST_CHECK_CLOSE( model.gain, 1e6 * 1.00004, 1e-3 );
+}
+
+} // anonymous namespace
+
+
+void TestTimestampSync()
+{
+	Measurement::TimestampSync sync( 1e3 );
+	testTimestampSync( sync );
+
+	// single timestamps update the same estimate
+	Measurement::Timestamp t;
+	const Measurement::Timestamp converted = sync.convertNativeToLocal( 16000.0, trueLocal( 16000.0 ) );
+	BOOST_REQUIRE( sync.toLocal( 16000.0, t ) );
+	BOOST_CHECK_EQUAL( t, converted );
+
+	Measurement::TimestampSyncLS syncLS;
+	testTimestampSync( syncLS );
+	testTimestampSyncLSDrift();
+}
@@ -0,0 +1,109 @@
+#include <utMeasurement/Timestamp.h>
+
+#include <ctime>
+#include <cstring>
+#include <cstdio>
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** absolute difference of two timestamps in ms */
+double differenceMs( const Measurement::Timestamp a, const Measurement::Timestamp b )
+{
+	return ( a > b ? a - b : b - a ) * 1e-6;
+}
+
+/** checks that the monotonic clock never goes backwards */
+void monotonicWorker( bool& ok )
+{
+	Measurement::Timestamp last = Measurement::now();
+	for ( int i = 0; i < 100000; i++ )
+	{
+		const Measurement::Timestamp t = Measurement::now();
+		if ( t < last )
+			ok = false;
+		last = t;
+	}
+}
+
+#ifndef _MSC_VER
+/** checks the formatting against the C library */
+void checkTimestampStrings( const Measurement::Timestamp t )
+{
+	time_t seconds = static_cast< time_t >( t / 1000000000 );
+	struct tm temp;
+	char expected[ 64 ];
+	gmtime_r( &seconds, &temp );
+	asctime_r( &temp, expected );
+	std::strcpy( expected + std::strlen( expected ) - 1, " UTC" );
+
+	char buffer[ Measurement::timestampStringSize ];
+	BOOST_CHECK_EQUAL( Measurement::timestampToString( t, buffer ), std::strlen( expected ) );
+	BOOST_CHECK_EQUAL( std::string( buffer ), std::string( expected ) );
+	BOOST_CHECK_EQUAL( Measurement::timestampToString( t ), std::string( expected ) );
+
+	localtime_r( &seconds, &temp );
+	std::sprintf( expected, "%02d:%02d:%02d.%06d", temp.tm_hour, temp.tm_min, temp.tm_sec, int( ( t / 1000 ) % 1000000 ) );
+	BOOST_CHECK_EQUAL( Measurement::timestampToShortString( t, buffer ), std::strlen( expected ) );
+	BOOST_CHECK_EQUAL( std::string( buffer ), std::string( expected ) );
+	BOOST_CHECK_EQUAL( Measurement::timestampToShortString( t ), std::string( expected ) );
+}
+#endif
+
+} // anonymous namespace
+
+
+void TestTimestamp()
+{
+	const Measurement::ClockSource initial = Measurement::getClockSource();
+
+	// both clocks and the coarse clock agree on the real time
+	Measurement::setClockSource( Measurement::clockRealtime );
+	BOOST_CHECK_EQUAL( Measurement::getClockSource(), Measurement::clockRealtime );
+	const Measurement::Timestamp realtime = Measurement::now();
+	Measurement::setClockSource( Measurement::clockMonotonic );
+	BOOST_CHECK_EQUAL( Measurement::getClockSource(), Measurement::clockMonotonic );
+	const Measurement::Timestamp monotonic = Measurement::now();
+	BOOST_CHECK( differenceMs( realtime, monotonic ) < 50 );
+	BOOST_CHECK( differenceMs( Measurement::nowCoarse(), monotonic ) < 100 );
+
+	// after 2001
+	BOOST_CHECK( monotonic > 1000000000ULL * 1000000000ULL );
+
+	Measurement::calibrateMonotonicClock();
+	BOOST_CHECK( differenceMs( Measurement::now(), monotonic ) < 50 );
+
+	// concurrent readers
+	const unsigned nThreads = 4;
+	bool ok[ nThreads ];
+	boost::thread_group threads;
+	for ( unsigned i = 0; i < nThreads; i++ )
+	{
+		ok[ i ] = true;
+		threads.create_thread( boost::bind( &monotonicWorker, boost::ref( ok[ i ] ) ) );
+	}
+	threads.join_all();
+	for ( unsigned i = 0; i < nThreads; i++ )
+		BOOST_CHECK( ok[ i ] );
+
+	Measurement::setClockSource( initial );
+
+#ifndef _MSC_VER
+	// formatting of dates around leap days and year changes, and of consecutive times within a second
+	const Measurement::Timestamp second = 1000000000ULL;
+	checkTimestampStrings( 0 );
+	checkTimestampStrings( 951782400ULL * second - 1 );	// 2000-02-29
+	checkTimestampStrings( 4107542399ULL * second + 999999999 );	// 2100-02-28 23:59:59
+	checkTimestampStrings( 4107542400ULL * second );	// 2100-03-01
+	for ( Measurement::Timestamp t = 1173016801ULL * second; t < 1173016803ULL * second; t += 123456789 )
+		checkTimestampStrings( t );
+	for ( unsigned i = 0; i < 1000; i++ )
+		checkTimestampStrings( ( static_cast< Measurement::Timestamp >( std::rand() ) << 31 ) + std::rand() );
+	checkTimestampStrings( monotonic );
+#endif
+}
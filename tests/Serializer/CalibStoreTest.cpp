@@ -0,0 +1,106 @@
+#include <utUtil/CalibFile.h>
+#include <utUtil/CalibStore.h>
+#include <utMath/Random/Rotation.h>
+#include <utMath/Random/Vector.h>
+
+#include <cstdio>
+#include <ctime>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+const char* g_calibFile = "CalibStoreTest.calib";
+const char* g_snapshot = "CalibStoreTest.snapshot";
+
+/** moves the modification time, as two writes within a second cannot be distinguished */
+void touch( const char* file, const std::time_t offset )
+{
+	boost::filesystem::last_write_time( file, boost::filesystem::last_write_time( file ) + offset );
+}
+
+} // anonymous namespace
+
+
+void TestCalibStore()
+{
+	std::remove( g_snapshot );
+	Math::Random::Quaternion< double >::Uniform randQuat;
+	Math::Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	const Math::Pose pose( randQuat(), randVector() );
+	Util::writeCalibFile( g_calibFile, pose );
+
+	// entries are written by save and found again after reopening
+	{
+		Util::CalibStore store( g_snapshot );
+		Math::Pose result;
+		BOOST_CHECK( !store.load( g_calibFile, result ) );
+		store.insert( g_calibFile, pose );
+		BOOST_CHECK( store.load( g_calibFile, result ) );
+		BOOST_CHECK_EQUAL( result, pose );
+		store.save();
+		BOOST_CHECK( store.load( g_calibFile, result ) );
+	}
+	{
+		Util::CalibStore store( g_snapshot );
+		BOOST_CHECK_EQUAL( store.size(), 1u );
+		Math::Pose result;
+		BOOST_CHECK( store.load( g_calibFile, result ) );
+		BOOST_CHECK_EQUAL( result, pose );
+
+		// entries are per type
+		Math::Quaternion q;
+		BOOST_CHECK( !store.load( g_calibFile, q ) );
+
+		// a changed source file is not served from the snapshot
+		touch( g_calibFile, 10 );
+		BOOST_CHECK( !store.load( g_calibFile, result ) );
+	}
+
+	// readCalibFile fills and uses the global store transparently
+	Util::CalibStore::enableGlobal( g_snapshot );
+	{
+		Math::Pose result;
+		Util::readCalibFile( g_calibFile, result );
+		BOOST_CHECK_EQUAL( result, pose );
+		BOOST_CHECK( Util::CalibStore::global()->load( g_calibFile, result ) );
+
+		// writing calibration replaces the outdated entry
+		const Math::Pose pose2( randQuat(), randVector() );
+		Util::writeCalibFile( g_calibFile, pose2 );
+		touch( g_calibFile, 20 );
+		Util::readCalibFile( g_calibFile, result );
+		BOOST_CHECK_EQUAL( result, pose2 );
+
+		Measurement::Pose m;
+		Util::writeCalibFile( g_calibFile, Measurement::Pose( 42, pose ) );
+		Util::readCalibFile( g_calibFile, m );
+		Util::readCalibFile( g_calibFile, m );
+		BOOST_CHECK_EQUAL( m.time(), 42u );
+		BOOST_CHECK_EQUAL( *m, pose );
+	}
+	Util::CalibStore::disableGlobal();
+
+	// the disabled store has been saved
+	{
+		Util::CalibStore store( g_snapshot );
+		Measurement::Pose m( 0, Math::Pose() );
+		BOOST_CHECK( store.load( g_calibFile, m ) );
+		BOOST_CHECK_EQUAL( *m, pose );
+	}
+
+	// damaged snapshots are ignored
+	{
+		std::FILE* f = std::fopen( g_snapshot, "r+b" );
+		std::fputc( 'X', f );
+		std::fclose( f );
+		Util::CalibStore store( g_snapshot );
+		BOOST_CHECK_EQUAL( store.size(), 0u );
+	}
+
+	std::remove( g_snapshot );
+	std::remove( g_calibFile );
+}
@@ -0,0 +1,173 @@
+#include <utSerialization/ColumnarLog.h>
+#include <utMeasurement/Measurement.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Serialization;
+
+namespace {
+
+const char* g_logFile = "ColumnarLogTest.utcol";
+
+/** copies the first n bytes of the log, to simulate files of crashed writers */
+void truncateLog( const char* target, const std::size_t n )
+{
+	std::ifstream in( g_logFile, std::ios::binary );
+	std::vector< char > data( ( std::istreambuf_iterator< char >( in ) ), std::istreambuf_iterator< char >() );
+	std::ofstream out( target, std::ios::binary );
+	out.write( &data[ 0 ], std::min( n, data.size() ) );
+}
+
+std::size_t fileSize( const char* name )
+{
+	std::ifstream in( name, std::ios::binary | std::ios::ate );
+	return static_cast< std::size_t >( in.tellg() );
+}
+
+Math::ErrorPose randomErrorPose()
+{
+	Math::Matrix< double, 6, 6 > covariance;
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = i; j < 6; j++ )
+			covariance( i, j ) = covariance( j, i ) = random( -1.0, 1.0 );
+	return Math::ErrorPose( Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ), covariance );
+}
+
+void checkErrorPose( const Math::ErrorPose& a, const Math::ErrorPose& b )
+{
+	// the compression is lossless
+	BOOST_CHECK_EQUAL( a.translation()( 0 ), b.translation()( 0 ) );
+	BOOST_CHECK_EQUAL( a.translation()( 2 ), b.translation()( 2 ) );
+	BOOST_CHECK_EQUAL( a.rotation().w(), b.rotation().w() );
+	BOOST_CHECK_EQUAL( a.rotation().y(), b.rotation().y() );
+	BOOST_CHECK_EQUAL( a.covariance()( 1, 4 ), b.covariance()( 1, 4 ) );
+	BOOST_CHECK_EQUAL( a.covariance()( 4, 1 ), b.covariance()( 1, 4 ) );
+	BOOST_CHECK_EQUAL( a.covariance()( 5, 5 ), b.covariance()( 5, 5 ) );
+}
+
+Measurement::Timestamp poseTime( const std::size_t i )
+{
+	// irregular sampling
+	return 1000000 + 10000 * i + ( i * 7919 ) % 13;
+}
+
+} // anonymous namespace
+
+
+void TestColumnarLog()
+{
+	const std::size_t nPoses = 3000;
+	std::vector< Math::ErrorPose > poses;
+	{
+		ColumnarLog::TypedWriter< Math::ErrorPose > writer( g_logFile, 256 );
+		BOOST_CHECK_EQUAL( writer.columnCount(), 28u );
+		for ( std::size_t i = 0; i < nPoses; i++ )
+		{
+			poses.push_back( randomErrorPose() );
+			writer.write( Measurement::ErrorPose( poseTime( i ), poses.back() ) );
+		}
+		BOOST_CHECK_THROW( writer.write( 5, poses.front() ), Ubitrack::Util::Exception );
+	}
+
+	{
+		ColumnarLog::Reader reader( g_logFile );
+		BOOST_CHECK_EQUAL( reader.rowCount(), nPoses );
+		BOOST_CHECK_EQUAL( reader.blocks().size(), ( nPoses + 255 ) / 256 );
+		BOOST_CHECK_EQUAL( reader.columnName( 2 ), "tz" );
+		BOOST_CHECK_EQUAL( reader.columnName( 6 ), "qw" );
+		BOOST_CHECK_EQUAL( reader.columnName( 7 ), "c00" );
+		BOOST_CHECK_EQUAL( reader.columnName( 13 ), "c11" );
+		BOOST_CHECK_EQUAL( reader.columnName( 27 ), "c55" );
+		BOOST_CHECK_THROW( reader.findColumn( "missing" ), Ubitrack::Util::Exception );
+
+		// all measurements
+		std::vector< Measurement::ErrorPose > all;
+		reader.read( 0, Measurement::Timestamp( -1 ), all );
+		BOOST_REQUIRE_EQUAL( all.size(), nPoses );
+		for ( std::size_t i = 0; i < nPoses; i += 17 )
+		{
+			BOOST_CHECK_EQUAL( all[ i ].time(), poseTime( i ) );
+			checkErrorPose( *all[ i ], poses[ i ] );
+		}
+
+		// a time range across block borders, with two columns
+		std::vector< std::size_t > columns;
+		columns.push_back( reader.findColumn( "tz" ) );
+		columns.push_back( reader.findColumn( "c14" ) );
+		std::vector< Measurement::Timestamp > times;
+		std::vector< std::vector< double > > values;
+		reader.read( poseTime( 250 ), poseTime( 700 ), columns, times, values );
+		BOOST_REQUIRE_EQUAL( times.size(), 451u );
+		BOOST_REQUIRE_EQUAL( values.size(), 2u );
+		for ( std::size_t i = 0; i < times.size(); i++ )
+		{
+			BOOST_CHECK_EQUAL( times[ i ], poseTime( 250 + i ) );
+			BOOST_CHECK_EQUAL( values[ 0 ][ i ], poses[ 250 + i ].translation()( 2 ) );
+			BOOST_CHECK_EQUAL( values[ 1 ][ i ], poses[ 250 + i ].covariance()( 1, 4 ) );
+		}
+
+		// ranges between and outside the measurements
+		reader.read( poseTime( 10 ) + 1, poseTime( 11 ) - 1, columns, times, values );
+		BOOST_CHECK( times.empty() && values[ 0 ].empty() );
+		reader.read( 0, 999999, columns, times, values );
+		BOOST_CHECK( times.empty() );
+		reader.read( poseTime( nPoses - 1 ), Measurement::Timestamp( -1 ), columns, times, values );
+		BOOST_CHECK_EQUAL( times.size(), 1u );
+
+		// the columns have to match the requested type
+		std::vector< Measurement::Pose > wrongType;
+		BOOST_CHECK_THROW( reader.read( 0, Measurement::Timestamp( -1 ), wrongType ), Ubitrack::Util::Exception );
+	}
+
+	// without index the reader walks through the blocks, and stops at an incomplete one
+	const char* crashed = "ColumnarLogTest.crashed.utcol";
+	truncateLog( crashed, fileSize( g_logFile ) / 2 );
+	{
+		ColumnarLog::Reader reader( crashed );
+		BOOST_CHECK( reader.rowCount() > 0 && reader.rowCount() < nPoses );
+		BOOST_CHECK_EQUAL( reader.rowCount() % 256, 0u );
+		std::vector< Measurement::ErrorPose > all;
+		reader.read( 0, Measurement::Timestamp( -1 ), all );
+		BOOST_REQUIRE_EQUAL( all.size(), reader.rowCount() );
+		checkErrorPose( *all.back(), poses[ all.size() - 1 ] );
+	}
+	std::remove( crashed );
+
+	// lists, and compression of a slowly changing stream
+	std::vector< std::vector< Math::Vector< double, 3 > > > lists;
+	{
+		ColumnarLog::TypedWriter< Math::Vector< double, 3 > > writer( g_logFile );
+		for ( std::size_t i = 0; i < 1000; i++ )
+		{
+			std::vector< Math::Vector< double, 3 > > points;
+			for ( std::size_t j = 0; j < 1 + i % 4; j++ )
+				points.push_back( Math::Vector< double, 3 >( double( j ), 0.25 * ( i / 100 ), 1.0 ) );
+			lists.push_back( points );
+			writer.write( Measurement::PositionList( 1000 + 10 * i, points ) );
+		}
+	}
+	BOOST_CHECK( fileSize( g_logFile ) < 2500 * 3 * sizeof( double ) / 4 );
+	{
+		ColumnarLog::Reader reader( g_logFile );
+		BOOST_CHECK_EQUAL( reader.columnName( 1 ), "y" );
+		std::vector< Measurement::PositionList > result;
+		reader.readLists( 1000 + 10 * 500, 1000 + 10 * 599, result );
+		BOOST_REQUIRE_EQUAL( result.size(), 100u );
+		for ( std::size_t i = 0; i < result.size(); i++ )
+		{
+			BOOST_CHECK_EQUAL( result[ i ].time(), Measurement::Timestamp( 1000 + 10 * ( 500 + i ) ) );
+			BOOST_REQUIRE_EQUAL( result[ i ]->size(), lists[ 500 + i ].size() );
+			for ( std::size_t j = 0; j < result[ i ]->size(); j++ )
+				BOOST_CHECK_EQUAL( ( *result[ i ] )[ j ], lists[ 500 + i ][ j ] );
+		}
+	}
+	std::remove( g_logFile );
+}
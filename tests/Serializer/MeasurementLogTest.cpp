@@ -0,0 +1,141 @@
+#include <utSerialization/MeasurementLog.h>
+#include <utMeasurement/Measurement.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <typeinfo>
+#include <vector>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Serialization;
+
+namespace {
+
+const char* g_logFile = "MeasurementLogTest.utlog";
+
+/** copies the first n bytes of the log, to simulate files of crashed writers */
+void truncateLog( const char* target, const std::size_t n )
+{
+	std::ifstream in( g_logFile, std::ios::binary );
+	std::vector< char > data( ( std::istreambuf_iterator< char >( in ) ), std::istreambuf_iterator< char >() );
+	std::ofstream out( target, std::ios::binary );
+	out.write( &data[ 0 ], std::min( n, data.size() ) );
+}
+
+std::size_t fileSize( const char* name )
+{
+	std::ifstream in( name, std::ios::binary | std::ios::ate );
+	return static_cast< std::size_t >( in.tellg() );
+}
+
+void checkLog( const char* name, const std::vector< Math::Pose >& poses, const std::vector< Math::Scalar< double > >& distances, const std::size_t nLists )
+{
+	MeasurementLog::Reader reader( name );
+	BOOST_CHECK_EQUAL( reader.streamCount(), 3u );
+	BOOST_CHECK_EQUAL( reader.stream( reader.findStream( "pose" ) ).type, typeid( Math::Pose ).name() );
+	BOOST_CHECK_EQUAL( reader.stream( reader.findStream( "distance" ) ).type, typeid( Math::Scalar< double > ).name() );
+
+	MeasurementLog::StreamReader< Math::Pose > poseStream( reader, "pose" );
+	MeasurementLog::StreamReader< Math::Scalar< double > > distanceStream( reader, "distance" );
+	MeasurementLog::StreamReader< std::vector< Math::Vector< double, 3 > > > listStream( reader, "points" );
+
+	// streams in crashed files may lack the last chunks
+	BOOST_REQUIRE( poseStream.size() <= poses.size() );
+	BOOST_REQUIRE( distanceStream.size() <= distances.size() );
+	BOOST_CHECK( listStream.size() <= nLists );
+
+	Measurement::Pose pose;
+	for ( std::size_t i = 0; i < poseStream.size(); i++ )
+	{
+		poseStream.read( i, pose );
+		BOOST_CHECK_EQUAL( pose.time(), Measurement::Timestamp( 1000 + 10 * i ) );
+		BOOST_CHECK_EQUAL( *pose, poses[ i ] );
+	}
+
+	for ( std::size_t i = 0; i < distanceStream.size(); i++ )
+	{
+		BOOST_CHECK_EQUAL( distanceStream.time( i ), Measurement::Timestamp( 1000 + 30 * i ) );
+		// simple types are read directly from the mapped file
+		BOOST_CHECK_EQUAL( distanceStream.data( i )->m_value, distances[ i ].m_value );
+	}
+
+	for ( std::size_t i = 0; i < listStream.size(); i++ )
+	{
+		Measurement::PositionList points( listStream[ i ] );
+		BOOST_CHECK_EQUAL( points->size(), i );
+		if ( i > 0 )
+			BOOST_CHECK_EQUAL( ( *points )[ i - 1 ]( 2 ), double( i ) );
+	}
+
+	// seek by timestamp
+	if ( poseStream.size() > 100 )
+	{
+		BOOST_CHECK_EQUAL( poseStream.lowerBound( 0 ), 0u );
+		BOOST_CHECK_EQUAL( poseStream.lowerBound( 1000 + 10 * 77 ), 77u );
+		BOOST_CHECK_EQUAL( poseStream.lowerBound( 1000 + 10 * 77 + 1 ), 78u );
+		BOOST_CHECK_EQUAL( poseStream.lowerBound( Measurement::Timestamp( -1 ) ), poseStream.size() );
+	}
+}
+
+} // anonymous namespace
+
+
+void TestMeasurementLog()
+{
+	std::vector< Math::Pose > poses;
+	std::vector< Math::Scalar< double > > distances;
+	const std::size_t nLists = 50;
+
+	{
+		// small chunks, so the streams are interleaved in the file
+		MeasurementLog::Writer writer( g_logFile, 4096 );
+		const unsigned poseId = writer.addStream< Math::Pose >( "pose" );
+		const unsigned distanceId = writer.addStream< Math::Scalar< double > >( "distance" );
+		const unsigned listId = writer.addStream< std::vector< Math::Vector< double, 3 > > >( "points" );
+
+		for ( std::size_t i = 0; i < 3000; i++ )
+		{
+			const Measurement::Timestamp t = 1000 + 10 * i;
+			poses.push_back( Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ) );
+			writer.write( poseId, Measurement::Pose( t, poses.back() ) );
+
+			if ( i % 3 == 0 )
+			{
+				distances.push_back( Math::Scalar< double >( i * 0.5 ) );
+				writer.write( distanceId, t, distances.back() );
+			}
+
+			if ( i < nLists )
+			{
+				std::vector< Math::Vector< double, 3 > > points;
+				for ( std::size_t j = 0; j < i; j++ )
+					points.push_back( Math::Vector< double, 3 >( 0, 0, double( j + 1 ) ) );
+				writer.write( listId, t, points );
+			}
+		}
+
+		BOOST_CHECK_THROW( writer.write( poseId, 5, poses.front() ), Util::Exception );
+	}
+
+	checkLog( g_logFile, poses, distances, nLists );
+	MeasurementLog::Reader reader( g_logFile );
+	BOOST_CHECK_EQUAL( MeasurementLog::StreamReader< Math::Pose >( reader, "pose" ).size(), poses.size() );
+	BOOST_CHECK_THROW( MeasurementLog::StreamReader< Math::Pose >( reader, "missing" ), Util::Exception );
+
+	// without index the reader walks through the records
+	const char* crashed = "MeasurementLogTest.crashed.utlog";
+	truncateLog( crashed, fileSize( g_logFile ) - 16 );
+	checkLog( crashed, poses, distances, nLists );
+
+	// and stops at an incomplete chunk
+	truncateLog( crashed, fileSize( g_logFile ) / 2 );
+	checkLog( crashed, poses, distances, nLists );
+
+	std::remove( crashed );
+	std::remove( g_logFile );
+}
@@ -0,0 +1,78 @@
+#include <utUtil/MessageArchive.h>
+#include <utSerialization/BoostArchiveSerializer.h>
+#include <utMath/CameraIntrinsics.h>
+#include <utMeasurement/Measurement.h>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+void TestMessageArchive()
+{
+	const Math::Pose pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) );
+	Math::Matrix< double, 6, 6 > covariance( Math::Matrix< double, 6, 6 >::identity() );
+	covariance( 1, 2 ) = 0.5;
+	const Measurement::ErrorPose errorPose( 12345, Math::ErrorPose( pose, covariance ) );
+
+	std::vector< Math::Vector< double, 3 > > points;
+	for ( int i = 0; i < 10; i++ )
+		points.push_back( randomVector< double, 3 >( 1.0 ) );
+	const Measurement::PositionList positions( 678, points );
+
+	Math::Vector< double > dynamic( 7 );
+	Math::Matrix< double > matrix( 3, 5 );
+	for ( std::size_t i = 0; i < 15; i++ )
+	{
+		matrix( i % 3, i / 3 ) = double( i );
+		dynamic( i % 7 ) = -double( i );
+	}
+	const Math::CameraIntrinsics< double > intrinsics( Math::Matrix< double, 3, 3 >::identity(),
+		Math::Vector< double, 2 >( 0.1, 0.2 ), Math::Vector< double, 2 >( 0.01, 0.02 ) );
+
+	// only the values are written, no headers
+	Util::MessageOArchive out;
+	out << pose;
+	BOOST_CHECK_EQUAL( out.size(), 7 * sizeof( double ) );
+
+	// the archive is reused for the next message
+	out.reset();
+	BOOST_CHECK_EQUAL( out.size(), 0u );
+	out << errorPose << positions << std::string( "bridge" ) << dynamic << matrix << intrinsics;
+	Serialization::BoostArchive::serialize( out, int( -3 ) );
+
+	Measurement::ErrorPose errorPose2( 0, Math::ErrorPose() );
+	Measurement::PositionList positions2( 0, std::vector< Math::Vector< double, 3 > >() );
+	std::string name;
+	Math::Vector< double > dynamic2;
+	Math::Matrix< double > matrix2;
+	Math::CameraIntrinsics< double > intrinsics2;
+	int i2 = 0;
+
+	Util::MessageIArchive in( out.data(), out.size() );
+	in >> errorPose2 >> positions2 >> name >> dynamic2 >> matrix2 >> intrinsics2;
+	Serialization::BoostArchive::deserialize( in, i2 );
+	BOOST_CHECK_EQUAL( in.remaining(), 0u );
+
+	BOOST_CHECK_EQUAL( errorPose2.time(), 12345u );
+	BOOST_CHECK_EQUAL( errorPose2->translation()( 1 ), pose.translation()( 1 ) );
+	BOOST_CHECK_EQUAL( errorPose2->rotation().w(), pose.rotation().w() );
+	BOOST_CHECK_EQUAL( errorPose2->covariance()( 1, 2 ), 0.5 );
+	BOOST_CHECK_EQUAL( positions2.time(), 678u );
+	BOOST_CHECK_EQUAL( positions2->size(), 10u );
+	BOOST_CHECK_EQUAL( ( *positions2 )[ 9 ]( 2 ), points[ 9 ]( 2 ) );
+	BOOST_CHECK_EQUAL( name, "bridge" );
+	BOOST_CHECK_EQUAL( dynamic2.size(), 7u );
+	BOOST_CHECK_EQUAL( dynamic2( 6 ), -13.0 );
+	BOOST_CHECK_EQUAL( matrix2.size1(), 3u );
+	BOOST_CHECK_EQUAL( matrix2.size2(), 5u );
+	BOOST_CHECK_EQUAL( matrix2( 2, 4 ), 14.0 );
+	BOOST_CHECK_EQUAL( intrinsics2.radial_params( 1 ), 0.2 );
+	BOOST_CHECK_EQUAL( i2, -3 );
+
+	// truncated messages are detected
+	Util::MessageIArchive truncated( out.data(), 40 );
+	BOOST_CHECK_THROW( truncated >> errorPose2, Util::Exception );
+	in.reset( out.data() + sizeof( Measurement::Timestamp ) + 7 * sizeof( double ) + 36 * sizeof( double ), 4 );
+	BOOST_CHECK_THROW( in >> positions2, Util::Exception );
+}
@@ -15,6 +15,71 @@
 using namespace Ubitrack;
 using namespace Ubitrack::Serialization;
 
+template< typename T >
+void testFixedFormat(const T& data, const std::size_t length)
+{
+    // the fixed-size encoding has the announced length and is readable by the direct reader
+    const std::size_t fixedLength = MsgpackArchive::FixedFormat< T >::length;
+    BOOST_CHECK_EQUAL(fixedLength, length);
+    std::vector< char > buffer(length + 1);
+    MsgpackArchive::FixedWriter writer(&buffer[0]);
+    MsgpackArchive::FixedFormat< T >::write(writer, data);
+    BOOST_CHECK_EQUAL(writer.written(), length);
+
+    T result;
+    BOOST_CHECK_EQUAL(MsgpackArchive::deserializeDirect(&buffer[0], length, result), length);
+    BOOST_CHECK_EQUAL(data, result);
+}
+
+void testFixedFormats()
+{
+    testFixedFormat(Math::Scalar< double >(22.33), 9);
+    testFixedFormat(randomVector< double, 3 >(5.0), 1 + 3 * 9);
+    testFixedFormat(Math::Vector< float, 2 >(1.5f, -2.0f), 1 + 2 * 5);
+    testFixedFormat(randomQuaternion(), 1 + 4 * 9);
+    testFixedFormat(Math::Pose(randomQuaternion(), randomVector< double, 3 >(5.0)), 1 + 37 + 28);
+
+    // 16 and more elements need a longer array header
+    Math::Matrix< double, 3, 4 > mat34;
+    randomMatrix(mat34);
+    testFixedFormat(mat34, 1 + 12 * 9);
+    Math::Matrix< double, 6, 6 > mat66;
+    randomMatrix(mat66);
+    testFixedFormat(mat66, 3 + 36 * 9);
+
+    // an error pose is [ rotation, translation, covariance ]
+    Math::ErrorPose errorPose(Math::Pose(randomQuaternion(), randomVector< double, 3 >(5.0)), mat66);
+    const std::size_t errorPoseLength = MsgpackArchive::FixedFormat< Math::ErrorPose >::length;
+    BOOST_CHECK_EQUAL(errorPoseLength, 1 + 37 + 28 + 327u);
+    std::vector< char > buffer(errorPoseLength);
+    MsgpackArchive::FixedWriter writer(&buffer[0]);
+    MsgpackArchive::FixedFormat< Math::ErrorPose >::write(writer, errorPose);
+    MsgpackArchive::DirectReader reader(&buffer[0], buffer.size());
+    reader.readArrayHeader(3);
+    Math::Quaternion q;
+    Math::Vector< double, 3 > t;
+    Math::Matrix< double, 6, 6 > covariance;
+    MsgpackArchive::DirectFormat< Math::Quaternion >::read(reader, q);
+    MsgpackArchive::DirectFormat< Math::Vector< double, 3 > >::read(reader, t);
+    MsgpackArchive::DirectFormat< Math::Matrix< double, 6, 6 > >::read(reader, covariance);
+    BOOST_CHECK_EQUAL(reader.consumed(), buffer.size());
+    BOOST_CHECK_EQUAL(Math::Pose(q, t), Math::Pose(errorPose));
+    BOOST_CHECK_EQUAL(covariance, mat66);
+
+    // types without fixed length
+    BOOST_CHECK(MsgpackArchive::FixedFormat< Math::Scalar< int > >::length == 0);
+    BOOST_CHECK((MsgpackArchive::FixedFormat< Math::Vector< std::size_t, 2 > >::length == 0));
+
+    // maximum lengths of lists and measurements
+    std::vector< Math::Pose > poses(20);
+    BOOST_CHECK_EQUAL(MsgpackArchive::FixedLength< std::vector< Math::Pose > >::get(poses), 3 + 20 * 66u);
+    poses.resize(3);
+    BOOST_CHECK_EQUAL(MsgpackArchive::FixedLength< std::vector< Math::Pose > >::get(poses), 1 + 3 * 66u);
+    BOOST_CHECK_EQUAL(MsgpackArchive::FixedLength< Measurement::Pose >::get(Measurement::Pose(1, Math::Pose())), 1 + 9 + 66u);
+    BOOST_CHECK_EQUAL(MsgpackArchive::FixedLength< Measurement::Pose >::get(Measurement::Pose()), 1u);
+}
+
+
 #ifdef HAVE_MSGPACK
 
 template< typename T >
@@ -94,6 +159,42 @@ void testSerializeMeasurement(const Measurement::Measurement< T >& data)
     BOOST_CHECK_EQUAL(*data, *result);
 }
 
+template< typename T >
+void testSerializeFixedLength(const T& data)
+{
+    // fixed-size types are packed in one block with the same encoding
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    MsgpackArchive::serialize(pk, data);
+    BOOST_CHECK_EQUAL(buffer.size(), MsgpackArchive::maxSerializationLength(data));
+
+    T result;
+    MsgpackArchive::deserializeDirect(buffer.data(), buffer.size(), result);
+    BOOST_CHECK_EQUAL(data, result);
+}
+
+void testSerializeErrorPose()
+{
+    Math::Matrix< double, 6, 6 > covariance;
+    randomMatrix(covariance);
+    Math::ErrorPose data(Math::Pose(randomQuaternion(), randomVector< double, 3 >(5.0)), covariance);
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    MsgpackArchive::serialize(pk, data);
+    BOOST_CHECK_EQUAL(buffer.size(), MsgpackArchive::maxSerializationLength(data));
+
+    msgpack::unpacker pac;
+    pac.reserve_buffer(buffer.size());
+    memcpy(pac.buffer(), buffer.data(), buffer.size() );
+    pac.buffer_consumed(buffer.size());
+
+    Math::ErrorPose result;
+    MsgpackArchive::deserialize(pac, result);
+    BOOST_CHECK_EQUAL(Math::Pose(data), Math::Pose(result));
+    BOOST_CHECK_EQUAL(data.covariance(), result.covariance());
+}
+
 template< typename T >
 void testSerializeMeasurementVector(const Measurement::Measurement< std::vector< T > >& data)
 {
@@ -122,6 +223,38 @@ void testSerializeMeasurementVector(const Measurement::Measurement< std::vector<
 
 }
 
+template< typename T >
+void testDeserializeDirectVector(const Measurement::Measurement< std::vector< T > >& data)
+{
+    // Serialize the measurement twice, as a stream of messages
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    MsgpackArchive::serialize(pk, data);
+    MsgpackArchive::serialize(pk, data);
+
+    // transfer to destination
+    msgpack::unpacker pac;
+    pac.reserve_buffer(buffer.size());
+    // simulate transfer
+    memcpy(pac.buffer(), buffer.data(), buffer.size() );
+
+    pac.buffer_consumed(buffer.size());
+
+    // Deserialize without intermediate objects, reusing the destination
+    Measurement::Measurement< std::vector< T > > result;
+    MsgpackArchive::deserializeDirect(pac, result);
+    const std::vector< T >* payload = result.get();
+    MsgpackArchive::deserializeDirect(pac, result);
+
+    BOOST_CHECK(payload == result.get());
+    BOOST_CHECK_EQUAL(pac.nonparsed_size(), 0u);
+    BOOST_CHECK_EQUAL(data.time(), result.time());
+    BOOST_CHECK_EQUAL(data->size(), result->size());
+    for (std::size_t i=0; i<data->size(); ++i) {
+        BOOST_CHECK_EQUAL(data->at(i), result->at(i));
+    }
+}
+
 template<typename T>
 std::vector<T> make_vector_simple(const T& v, int count) {
     std::vector<T> result(count);
@@ -214,6 +347,9 @@ void testSerializeMultiple()
 
 void TestMsgpack()
 {
+    // encoding of fixed-size types, independent of the msgpack library
+    testFixedFormats();
+
 
 #ifdef HAVE_MSGPACK
     // Test simple data types
@@ -318,6 +454,18 @@ void TestMsgpack()
 
     // test serializing multiple objects in astream
     testSerializeMultiple();
+
+    // fixed-size types
+    testSerializeFixedLength(v_vec3);
+    testSerializeFixedLength(v_pose);
+    testSerializeFixedLength(v_mat44);
+    testSerializeErrorPose();
+
+    // direct deserialization of lists
+    testDeserializeDirectVector(vec_button);
+    testDeserializeDirectVector(vec_distance);
+    testDeserializeDirectVector(make_vector_measurement(ts, v_vec3, 2000));
+    testDeserializeDirectVector(make_vector_measurement(ts, v_pose, 2000));
     
 #endif // HAVE_MSGPACK
 }
@@ -0,0 +1,158 @@
+#include <utUtil/PortableBinaryArchive.h>
+#include <utUtil/CalibFile.h>
+#include <utMath/CameraIntrinsics.h>
+#include <utMeasurement/Measurement.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <boost/archive/binary_oarchive.hpp>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+const char* g_calibFile = "PortableBinaryArchiveTest.calib";
+
+Math::ErrorPose randomErrorPose()
+{
+	Math::Matrix< double, 6, 6 > covariance;
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = i; j < 6; j++ )
+			covariance( i, j ) = covariance( j, i ) = random( -1.0, 1.0 );
+	return Math::ErrorPose( Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ), covariance );
+}
+
+template< typename T >
+std::string save( const T& v, const bool header = true )
+{
+	std::ostringstream stream( std::ios::out | std::ios::binary );
+	Util::PortableBinaryOArchive archive( stream, header );
+	archive << v;
+	return stream.str();
+}
+
+template< typename T >
+void load( const std::string& s, T& v, const bool header = true )
+{
+	std::istringstream stream( s, std::ios::in | std::ios::binary );
+	Util::PortableBinaryIArchive archive( stream, header );
+	archive >> v;
+}
+
+} // anonymous namespace
+
+
+void TestPortableBinaryArchive()
+{
+	// the format does not depend on the platform
+	{
+		const std::string s = save( int( -2 ) ) + save( 1.0, false ) + save( long( 3 ), false ) + save( std::string( "ab" ), false );
+		const unsigned char expected[] = {
+			'U', 'T', 'B', 'A', 1, 0, 0, 0,
+			0xfe, 0xff, 0xff, 0xff,
+			0, 0, 0, 0, 0, 0, 0xf0, 0x3f,
+			3, 0, 0, 0, 0, 0, 0, 0,
+			2, 0, 0, 0, 0, 0, 0, 0, 'a', 'b' };
+		BOOST_REQUIRE_EQUAL( s.size(), sizeof( expected ) );
+		BOOST_CHECK( std::memcmp( s.data(), expected, sizeof( expected ) ) == 0 );
+
+		int i;
+		load( s.substr( 0, 12 ), i );
+		BOOST_CHECK_EQUAL( i, -2 );
+	}
+
+	// fixed-size types take no more space than their elements, plus one class version
+	{
+		const Math::ErrorPose pose( randomErrorPose() );
+		const std::string s = save( pose, false );
+		BOOST_CHECK_EQUAL( s.size(), 4 + ( 4 + 3 + 36 ) * sizeof( double ) );
+
+		Math::ErrorPose result;
+		load( s, result, false );
+		BOOST_CHECK_EQUAL( result.rotation(), pose.rotation() );
+		BOOST_CHECK_EQUAL( result.translation(), pose.translation() );
+		BOOST_CHECK_EQUAL( result.covariance()( 1, 4 ), pose.covariance()( 1, 4 ) );
+		BOOST_CHECK_EQUAL( result.covariance()( 5, 0 ), pose.covariance()( 5, 0 ) );
+	}
+
+	// lists, measurements and dynamic sizes
+	{
+		std::vector< Math::Pose > poses;
+		for ( std::size_t i = 0; i < 50; i++ )
+			poses.push_back( Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ) );
+		Measurement::PoseList measurement( 123456789012345ULL, poses );
+		Math::Matrix< double, 0, 0 > dynamic( 2, 3 );
+		for ( std::size_t i = 0; i < 6; i++ )
+			dynamic( i % 2, i / 2 ) = double( i );
+		Math::Vector< float, 0 > floats( 5 );
+		for ( std::size_t i = 0; i < 5; i++ )
+			floats( i ) = 0.5f * i;
+
+		std::ostringstream out( std::ios::out | std::ios::binary );
+		{
+			Util::PortableBinaryOArchive archive( out );
+			archive << measurement << dynamic << floats;
+		}
+
+		Measurement::PoseList resultMeasurement( 0, boost::shared_ptr< std::vector< Math::Pose > >( new std::vector< Math::Pose > ) );
+		Math::Matrix< double, 0, 0 > resultDynamic;
+		Math::Vector< float, 0 > resultFloats;
+		std::istringstream in( out.str(), std::ios::in | std::ios::binary );
+		Util::PortableBinaryIArchive archive( in );
+		archive >> resultMeasurement >> resultDynamic >> resultFloats;
+		BOOST_CHECK_EQUAL( resultMeasurement.time(), measurement.time() );
+		BOOST_REQUIRE_EQUAL( resultMeasurement->size(), poses.size() );
+		BOOST_CHECK_EQUAL( ( *resultMeasurement )[ 17 ], poses[ 17 ] );
+		BOOST_REQUIRE_EQUAL( resultDynamic.size1(), 2u );
+		BOOST_REQUIRE_EQUAL( resultDynamic.size2(), 3u );
+		BOOST_CHECK_EQUAL( resultDynamic( 1, 2 ), 5.0 );
+		BOOST_REQUIRE_EQUAL( resultFloats.size(), 5u );
+		BOOST_CHECK_EQUAL( resultFloats( 3 ), 1.5f );
+	}
+
+	// damaged archives
+	{
+		Math::Pose pose;
+		BOOST_CHECK_THROW( load( save( Math::Pose() ).substr( 0, 20 ), pose ), Ubitrack::Util::Exception );
+		BOOST_CHECK_THROW( load( std::string( "22 serialization::archive" ), pose ), Ubitrack::Util::Exception );
+		std::string newer = save( Math::Pose() );
+		newer[ 4 ] = 2;
+		BOOST_CHECK_THROW( load( newer, pose ), Ubitrack::Util::Exception );
+	}
+
+	// binary calibration files, including those of the boost binary archive
+	{
+		Math::CameraIntrinsics< double > intrinsics;
+		intrinsics.matrix( 0, 0 ) = 500.0;
+		intrinsics.matrix( 1, 2 ) = 240.0;
+		intrinsics.dimension( 0 ) = 640;
+		intrinsics.radial_size = 2;
+		intrinsics.radial_params( 1 ) = 0.25;
+		Util::writeBinaryCalibFile( g_calibFile, intrinsics );
+
+		Math::CameraIntrinsics< double > result;
+		Util::readBinaryCalibFile( g_calibFile, result );
+		BOOST_CHECK_EQUAL( result.matrix( 0, 0 ), 500.0 );
+		BOOST_CHECK_EQUAL( result.matrix( 1, 2 ), 240.0 );
+		BOOST_CHECK_EQUAL( result.dimension( 0 ), 640u );
+		BOOST_CHECK_EQUAL( result.radial_params( 1 ), 0.25 );
+
+		const Math::ErrorPose pose( randomErrorPose() );
+		{
+			std::ofstream stream( g_calibFile, std::ios::out | std::ios::binary );
+			boost::archive::binary_oarchive archive( stream );
+			archive << pose;
+		}
+		Math::ErrorPose legacy;
+		Util::readBinaryCalibFile( g_calibFile, legacy );
+		BOOST_CHECK_EQUAL( legacy.rotation(), pose.rotation() );
+		BOOST_CHECK_EQUAL( legacy.covariance()( 2, 3 ), pose.covariance()( 2, 3 ) );
+		std::remove( g_calibFile );
+	}
+}
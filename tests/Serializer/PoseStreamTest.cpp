@@ -0,0 +1,121 @@
+#include <utSerialization/PoseStream.h>
+#include <utMeasurement/Measurement.h>
+#include <utUtil/Exception.h>
+
+#include <cmath>
+#include <vector>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Serialization;
+
+namespace {
+
+/** rotation angle between two quaternions */
+double angle( const Math::Quaternion& a, const Math::Quaternion& b )
+{
+	const double d = std::fabs( a.x() * b.x() + a.y() * b.y() + a.z() * b.z() + a.w() * b.w() );
+	return 2.0 * std::acos( std::min( d, 1.0 ) );
+}
+
+/** moves all targets by up to 1.5 m/s and 90 deg/s at 240 Hz */
+void move( std::vector< Math::Pose >& poses )
+{
+	for ( std::size_t i = 0; i < poses.size(); i++ )
+	{
+		const Math::Vector< double, 3 > axis( randomVector< double, 3 >( 1.0 ) );
+		Math::Quaternion q( Math::Quaternion( axis, random( 0.0, 0.0065 ) ) * poses[ i ].rotation() );
+		poses[ i ] = Math::Pose( q.normalize(),
+			poses[ i ].translation() + randomVector< double, 3 >( 0.0036 ) );
+	}
+}
+
+} // anonymous namespace
+
+
+void TestPoseStream()
+{
+	PoseStream::Parameters parameters;
+	parameters.keyframeInterval = 100;
+	PoseStream::Encoder encoder( parameters );
+	PoseStream::Decoder decoder;
+
+	std::vector< Math::Pose > poses;
+	for ( std::size_t i = 0; i < 200; i++ )
+		poses.push_back( Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ) );
+
+	std::vector< uint8_t > message;
+	std::size_t totalSize = 0;
+	double maxTranslationError = 0;
+	double maxAngle = 0;
+	const std::size_t nMessages = 480;
+	for ( std::size_t m = 0; m < nMessages; m++ )
+	{
+		const Measurement::Timestamp t = 1000000000ULL + m * 4166667ULL;
+		encoder.encode( Measurement::PoseList( t, poses ), message );
+		BOOST_CHECK_EQUAL( message[ 0 ] == 1, m % 100 == 0 );
+		totalSize += message.size();
+
+		Measurement::PoseList decoded;
+		BOOST_REQUIRE( decoder.decode( &message[ 0 ], message.size(), decoded ) );
+		BOOST_CHECK_EQUAL( decoded.time(), t );
+		BOOST_REQUIRE_EQUAL( decoded->size(), poses.size() );
+		for ( std::size_t i = 0; i < poses.size(); i++ )
+		{
+			for ( std::size_t j = 0; j < 3; j++ )
+				maxTranslationError = std::max( maxTranslationError,
+					std::fabs( ( *decoded )[ i ].translation()( j ) - poses[ i ].translation()( j ) ) );
+			maxAngle = std::max( maxAngle, angle( ( *decoded )[ i ].rotation(), poses[ i ].rotation() ) );
+		}
+		move( poses );
+	}
+
+	// the error is bounded and does not accumulate
+	BOOST_CHECK( maxTranslationError <= 0.5 * parameters.translationResolution + 1e-12 );
+	BOOST_CHECK( maxAngle < 2e-4 );
+
+	// compared to 7 doubles per pose and a timestamp per list
+	const double ratio = double( nMessages * ( 8 + 56 * poses.size() ) ) / totalSize;
+	BOOST_CHECK_MESSAGE( ratio > 4.0, "compression ratio " << ratio );
+
+	// after a lost message the decoder waits for the next keyframe
+	encoder.encode( 5000000000ULL, poses, message );
+	encoder.encode( 5004166667ULL, poses, message );
+	Measurement::Timestamp t;
+	std::vector< Math::Pose > decoded;
+	BOOST_CHECK( !decoder.decode( &message[ 0 ], message.size(), t, decoded ) );
+	BOOST_CHECK( !decoder.synchronized() );
+	encoder.encode( 5008333333ULL, poses, message );
+	BOOST_CHECK( !decoder.decode( &message[ 0 ], message.size(), t, decoded ) );
+	encoder.requestKeyframe();
+	encoder.encode( 5012500000ULL, poses, message );
+	BOOST_CHECK( decoder.decode( &message[ 0 ], message.size(), t, decoded ) );
+	BOOST_CHECK_EQUAL( t, 5012500000ULL );
+
+	// a changing number of poses starts a keyframe
+	poses.resize( 3 );
+	encoder.encode( 5016666667ULL, poses, message );
+	BOOST_CHECK_EQUAL( message[ 0 ], 1 );
+	BOOST_CHECK( decoder.decode( &message[ 0 ], message.size(), t, decoded ) );
+	BOOST_CHECK_EQUAL( decoded.size(), 3u );
+
+	// truncated messages
+	encoder.encode( 5020833333ULL, poses, message );
+	BOOST_CHECK_THROW( decoder.decode( &message[ 0 ], message.size() - 1, t, decoded ), Ubitrack::Util::Exception );
+	BOOST_CHECK( !decoder.synchronized() );
+
+	// single poses
+	PoseStream::Encoder poseEncoder;
+	PoseStream::Decoder poseDecoder;
+	const Measurement::Pose pose( 42, Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ) );
+	poseEncoder.encode( pose, message );
+	Measurement::Pose decodedPose;
+	BOOST_CHECK( poseDecoder.decode( &message[ 0 ], message.size(), decodedPose ) );
+	BOOST_CHECK_EQUAL( decodedPose.time(), 42u );
+	BOOST_CHECK_SMALL( angle( decodedPose->rotation(), pose->rotation() ), 2e-4 );
+
+	parameters.rotationBits = 24;
+	BOOST_CHECK_THROW( PoseStream::Encoder invalid( parameters ), Ubitrack::Util::Exception );
+}
@@ -0,0 +1,109 @@
+#include <utSerialization/ROSBinaryListView.h>
+#include <utSerialization/ScatterGather.h>
+#include <utMeasurement/Measurement.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Serialization;
+
+namespace {
+
+template< typename T >
+std::vector< uint8_t > serializeList( const std::vector< T >& data )
+{
+	ROSBinary::LStream length;
+	length.next( data );
+	std::vector< uint8_t > buffer( length.getLength() );
+	ROSBinary::OStream out( &buffer[ 0 ], (uint32_t) buffer.size() );
+	out.next( data );
+	return buffer;
+}
+
+/** a sum over a read-only list, accepts vectors and views */
+template< typename List >
+double sumX( const List& list )
+{
+	double sum = 0;
+	for ( typename List::const_iterator it = list.begin(); it != list.end(); ++it )
+		sum += it->translation()( 0 );
+	return sum;
+}
+
+} // anonymous namespace
+
+
+void TestROSBinaryListView()
+{
+	std::vector< Math::Pose > poses;
+	std::vector< Math::Scalar< unsigned long > > ids;
+	for ( std::size_t i = 0; i < 500; i++ )
+	{
+		poses.push_back( Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ) );
+		ids.push_back( Math::Scalar< unsigned long >( 1000 + 3 * i ) );
+	}
+
+	// elements are decoded on access
+	std::vector< uint8_t > buffer = serializeList( poses );
+	ROSBinary::PoseListView view;
+	ROSBinary::IStream in( &buffer[ 0 ], (uint32_t) buffer.size() );
+	in >> view;
+	BOOST_CHECK_EQUAL( in.getLength(), 0u );
+	BOOST_REQUIRE_EQUAL( view.size(), poses.size() );
+	BOOST_CHECK( view.data() == &buffer[ 4 ] );
+	BOOST_CHECK_EQUAL( view[ 123 ], poses[ 123 ] );
+	BOOST_CHECK_EQUAL( view.at( 499 ), poses[ 499 ] );
+	BOOST_CHECK_EQUAL( view.front(), poses.front() );
+	BOOST_CHECK_EQUAL( view.back(), poses.back() );
+	BOOST_CHECK_THROW( view.at( 500 ), Ubitrack::Util::Exception );
+
+	// iterators
+	BOOST_CHECK_EQUAL( view.end() - view.begin(), 500 );
+	BOOST_CHECK_EQUAL( *( view.begin() + 17 ), poses[ 17 ] );
+	BOOST_CHECK_EQUAL( sumX( view ), sumX( poses ) );
+	BOOST_CHECK( view.toVector() == poses );
+
+	// views are serialized like the list
+	std::vector< uint8_t > copy( buffer.size() );
+	ROSBinary::OStream out( &copy[ 0 ], (uint32_t) copy.size() );
+	out << view;
+	BOOST_CHECK( copy == buffer );
+	ROSBinary::LStream length;
+	length.next( view );
+	BOOST_CHECK_EQUAL( length.getLength(), buffer.size() );
+
+	// lookup of an id
+	std::vector< uint8_t > idBuffer = serializeList( ids );
+	ROSBinary::IDListView idView;
+	ROSBinary::IStream idIn( &idBuffer[ 0 ], (uint32_t) idBuffer.size() );
+	idIn >> idView;
+	ROSBinary::IDListView::const_iterator found = std::find( idView.begin(), idView.end(), Math::Scalar< unsigned long >( 1000 + 3 * 77 ) );
+	BOOST_CHECK_EQUAL( found - idView.begin(), 77 );
+
+	// views in measurements
+	Measurement::Measurement< ROSBinary::PoseListView > measurement( 42, view );
+	BOOST_CHECK_EQUAL( ( *measurement )[ 5 ], poses[ 5 ] );
+
+	// truncated buffers
+	ROSBinary::IStream truncated( &buffer[ 0 ], (uint32_t) buffer.size() - 1 );
+	BOOST_CHECK_THROW( truncated >> view, StreamOverrunException );
+
+	// views read from fragments own a copy
+	std::vector< Segment > fragments;
+	Segment first = { &buffer[ 0 ], 100 };
+	Segment second = { &buffer[ 100 ], buffer.size() - 100 };
+	fragments.push_back( first );
+	fragments.push_back( second );
+	ROSBinary::PoseListView scattered;
+	{
+		ROSBinary::ScatterIStream scatter( fragments );
+		scatter >> scattered;
+	}
+	BOOST_REQUIRE_EQUAL( scattered.size(), poses.size() );
+	BOOST_CHECK_EQUAL( scattered[ 2 ], poses[ 2 ] );
+	BOOST_CHECK_EQUAL( scattered[ 400 ], poses[ 400 ] );
+}
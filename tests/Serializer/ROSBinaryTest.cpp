@@ -0,0 +1,89 @@
+#include <utSerialization/ROSBinarySerialization.h>
+#include <utMeasurement/Measurement.h>
+
+#include <vector>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Serialization;
+
+template< typename T >
+void testSerializeList( const std::vector< T >& data, const uint32_t elementSize )
+{
+	// the length stream gives the exact size for packed types
+	ROSBinary::LStream length;
+	length.next( data );
+	BOOST_CHECK_EQUAL( length.getLength(), 4 + data.size() * elementSize );
+
+	std::vector< uint8_t > buffer( length.getLength() );
+	ROSBinary::OStream out( &buffer[ 0 ], (uint32_t) buffer.size() );
+	out.next( data );
+	BOOST_CHECK_EQUAL( out.getLength(), 0u );
+
+	std::vector< T > result;
+	ROSBinary::IStream in( &buffer[ 0 ], (uint32_t) buffer.size() );
+	in.next( result );
+	BOOST_CHECK_EQUAL( in.getLength(), 0u );
+
+	BOOST_CHECK_EQUAL( data.size(), result.size() );
+	for ( std::size_t i = 0; i < data.size(); i++ )
+		BOOST_CHECK_EQUAL( data[ i ], result[ i ] );
+
+	// truncated buffers are detected before anything is read
+	ROSBinary::IStream truncated( &buffer[ 0 ], (uint32_t) buffer.size() - 1 );
+	BOOST_CHECK_THROW( truncated.next( result ), StreamOverrunException );
+}
+
+
+void TestROSBinary()
+{
+	std::vector< Math::Vector< double, 3 > > positions;
+	std::vector< Math::Pose > poses;
+	std::vector< Math::Scalar< int > > buttons;
+	for ( int i = 0; i < 1000; i++ )
+	{
+		positions.push_back( randomVector< double, 3 >( 5.0 ) );
+		poses.push_back( Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ) );
+		buttons.push_back( Math::Scalar< int >( i ) );
+	}
+
+	testSerializeList( positions, 3 * sizeof( double ) );
+	testSerializeList( poses, 7 * sizeof( double ) );
+	testSerializeList( buttons, sizeof( int ) );
+
+	// poses are stored as translation followed by the rotation as ( x, y, z, w )
+	std::vector< uint8_t > buffer( 7 * sizeof( double ) );
+	ROSBinary::OStream out( &buffer[ 0 ], (uint32_t) buffer.size() );
+	out.next( poses[ 0 ] );
+	const double* d = reinterpret_cast< const double* >( &buffer[ 0 ] );
+	BOOST_CHECK_EQUAL( d[ 0 ], poses[ 0 ].translation()( 0 ) );
+	BOOST_CHECK_EQUAL( d[ 3 ], poses[ 0 ].rotation().x() );
+	BOOST_CHECK_EQUAL( d[ 6 ], poses[ 0 ].rotation().w() );
+
+	// poses with packed float covariance take the pose and 21 floats
+	Math::Matrix< double, 6, 6 > covariance;
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = i; j < 6; j++ )
+			covariance( i, j ) = covariance( j, i ) = random( -1.0, 1.0 );
+	std::vector< Math::PackedErrorPose< float > > errorPoses;
+	for ( std::size_t i = 0; i < 100; i++ )
+		errorPoses.push_back( Math::PackedErrorPose< float >( poses[ i ], covariance ) );
+	const uint32_t errorPoseSize = 7 * sizeof( double ) + 21 * sizeof( float );
+	BOOST_CHECK_EQUAL( ROSBinary::maxSerializationLength( errorPoses[ 0 ] ), errorPoseSize );
+
+	std::vector< uint8_t > errorPoseBuffer( 4 + errorPoses.size() * errorPoseSize );
+	ROSBinary::OStream errorPoseOut( &errorPoseBuffer[ 0 ], (uint32_t) errorPoseBuffer.size() );
+	errorPoseOut.next( errorPoses );
+	BOOST_CHECK_EQUAL( errorPoseOut.getLength(), 0u );
+
+	std::vector< Math::PackedErrorPose< float > > errorPoseResult;
+	ROSBinary::IStream errorPoseIn( &errorPoseBuffer[ 0 ], (uint32_t) errorPoseBuffer.size() );
+	errorPoseIn.next( errorPoseResult );
+	BOOST_REQUIRE_EQUAL( errorPoseResult.size(), errorPoses.size() );
+	BOOST_CHECK_EQUAL( static_cast< const Math::Pose& >( errorPoseResult[ 7 ] ), poses[ 7 ] );
+	BOOST_CHECK_EQUAL( errorPoseResult[ 7 ].packedCovariance()( 4, 1 ), float( covariance( 1, 4 ) ) );
+	BOOST_CHECK_EQUAL( errorPoseResult[ 7 ].covariance()( 5, 5 ), double( float( covariance( 5, 5 ) ) ) );
+}
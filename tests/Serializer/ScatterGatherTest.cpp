@@ -0,0 +1,131 @@
+#include <utSerialization/ScatterGather.h>
+#include <utMeasurement/Measurement.h>
+
+#include <string>
+#include <vector>
+
+#include "../tools.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Serialization;
+
+namespace {
+
+void testBufferPool()
+{
+	BufferPool pool( 1024, 2 );
+	{
+		BufferPool::Buffer a( pool.acquire() );
+		BufferPool::Buffer b( pool.acquire( 4096 ) );
+		BufferPool::Buffer c( pool.acquire() );
+		BOOST_CHECK_EQUAL( a->size(), 1024u );
+		BOOST_CHECK_EQUAL( b->size(), 4096u );
+	}
+	// only maxFree buffers are kept
+	BOOST_CHECK_EQUAL( pool.freeCount(), 2u );
+
+	BufferPool::Buffer reused( pool.acquire() );
+	BOOST_CHECK_EQUAL( pool.freeCount(), 1u );
+	BOOST_CHECK( reused->size() >= 1024u );
+
+	// buffers may outlive their pool
+	BufferPool::Buffer orphan;
+	{
+		BufferPool shortLived;
+		orphan = shortLived.acquire();
+	}
+	orphan.reset();
+}
+
+
+/** serializes a message of several items into a contiguous buffer */
+template< typename Stream >
+void writeMessage( Stream& out, const std::vector< Math::Vector< double, 3 > >& positions,
+	const std::vector< Math::Scalar< double > >& distances, const std::string& name )
+{
+	out << positions << name << distances << uint32_t( 42 );
+}
+
+} // anonymous namespace
+
+
+void TestScatterGather()
+{
+	testBufferPool();
+
+	std::vector< Math::Vector< double, 3 > > positions;
+	std::vector< Math::Scalar< double > > distances;
+	for ( std::size_t i = 0; i < 500; i++ )
+	{
+		positions.push_back( randomVector< double, 3 >( 5.0 ) );
+		distances.push_back( Math::Scalar< double >( random( 0.0, 10.0 ) ) );
+	}
+	const std::string name( "ART.Target1" );
+
+	// reference encoding
+	ROSBinary::LStream length;
+	length.next( positions );
+	length.next( name );
+	length.next( distances );
+	length.next( uint32_t( 42 ) );
+	std::vector< uint8_t > expected( length.getLength() );
+	ROSBinary::OStream contiguous( &expected[ 0 ], (uint32_t) expected.size() );
+	writeMessage( contiguous, positions, distances, name );
+
+	// small chunks, so the positions span several chunks
+	BufferPool pool( 1000 );
+	ROSBinary::GatherOStream out( pool );
+	for ( int round = 0; round < 2; round++ )
+	{
+		writeMessage( out, positions, distances, name );
+		BOOST_REQUIRE_EQUAL( out.size(), expected.size() );
+
+		std::vector< uint8_t > gathered( out.size() );
+		out.copyTo( &gathered[ 0 ] );
+		BOOST_CHECK( gathered == expected );
+
+		// the distances are referenced, not copied
+		bool referenced = false;
+		for ( std::size_t i = 0; i < out.segments().size(); i++ )
+			referenced |= out.segments()[ i ].data == &distances.front() && out.segments()[ i ].size == distances.size() * sizeof( double );
+		BOOST_CHECK( referenced );
+
+		// the chunks go back to the pool
+		out.clear();
+		BOOST_CHECK_EQUAL( out.size(), 0u );
+		BOOST_CHECK( pool.freeCount() > 0 );
+	}
+
+	// read back from fragments of different sizes, including empty ones
+	for ( std::size_t fragmentSize = 1; fragmentSize < 100; fragmentSize += 13 )
+	{
+		std::vector< Segment > fragments;
+		for ( std::size_t offset = 0; offset < expected.size(); offset += fragmentSize )
+		{
+			Segment fragment = { &expected[ offset ], std::min( fragmentSize, expected.size() - offset ) };
+			fragments.push_back( fragment );
+			Segment empty = { &expected[ offset ], 0 };
+			fragments.push_back( empty );
+		}
+
+		ROSBinary::ScatterIStream in( fragments );
+		std::vector< Math::Vector< double, 3 > > rPositions;
+		std::vector< Math::Scalar< double > > rDistances;
+		std::string rName;
+		uint32_t rMagic;
+		in >> rPositions >> rName >> rDistances >> rMagic;
+		BOOST_CHECK_EQUAL( in.getLength(), 0u );
+		BOOST_CHECK_EQUAL( rName, name );
+		BOOST_CHECK_EQUAL( rMagic, 42u );
+		BOOST_REQUIRE_EQUAL( rPositions.size(), positions.size() );
+		BOOST_REQUIRE_EQUAL( rDistances.size(), distances.size() );
+		for ( std::size_t i = 0; i < positions.size(); i += 7 )
+		{
+			BOOST_CHECK_EQUAL( rPositions[ i ], positions[ i ] );
+			BOOST_CHECK_EQUAL( rDistances[ i ], distances[ i ] );
+		}
+
+		BOOST_CHECK_THROW( in >> rMagic, StreamOverrunException );
+	}
+}
@@ -3,10 +3,32 @@
 // declare external tests here, to save us some trivial header files
 void TestBoostArchive();
 void TestMsgpack();
+void TestROSBinary();
+void TestROSBinaryListView();
+void TestMeasurementLog();
+void TestColumnarLog();
+void TestScatterGather();
+void TestStreamingWriter();
+void TestCalibStore();
+void TestPortableBinaryArchive();
+void TestPoseStream();
+void TestSharedMemoryRing();
+void TestMessageArchive();
 
 SerializerTest::SerializerTest()
 	: boost::unit_test::test_suite( "SerializerTests" )
 {
 	add( BOOST_TEST_CASE( &TestBoostArchive ) );
     add( BOOST_TEST_CASE( &TestMsgpack ) );
+    add( BOOST_TEST_CASE( &TestROSBinary ) );
+    add( BOOST_TEST_CASE( &TestROSBinaryListView ) );
+    add( BOOST_TEST_CASE( &TestMeasurementLog ) );
+    add( BOOST_TEST_CASE( &TestColumnarLog ) );
+    add( BOOST_TEST_CASE( &TestScatterGather ) );
+    add( BOOST_TEST_CASE( &TestStreamingWriter ) );
+    add( BOOST_TEST_CASE( &TestCalibStore ) );
+    add( BOOST_TEST_CASE( &TestPortableBinaryArchive ) );
+    add( BOOST_TEST_CASE( &TestPoseStream ) );
+    add( BOOST_TEST_CASE( &TestSharedMemoryRing ) );
+    add( BOOST_TEST_CASE( &TestMessageArchive ) );
 }
@@ -0,0 +1,167 @@
+#include <utSerialization/SharedMemoryRing.h>
+#include <utUtil/Exception.h>
+
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Serialization;
+
+namespace {
+
+std::string ringName( const char* suffix )
+{ return std::string( "utcore-test-" ) + suffix; }
+
+/** a pose whose components all depend on n, to detect torn reads */
+Math::Pose numberedPose( double n )
+{ return Math::Pose( Math::Quaternion( n, n + 1, n + 2, n + 3 ), Math::Vector< double, 3 >( n + 4, n + 5, n + 6 ) ); }
+
+bool isNumbered( const Math::Pose& p, Measurement::Timestamp t )
+{
+	const double n = static_cast< double >( t );
+	const Math::Quaternion& q( p.rotation() );
+	const Math::Vector< double, 3 >& v( p.translation() );
+	return q.x() == n && q.y() == n + 1 && q.z() == n + 2 && q.w() == n + 3
+		&& v( 0 ) == n + 4 && v( 1 ) == n + 5 && v( 2 ) == n + 6;
+}
+
+void writePoses( SharedMemoryWriter< Math::Pose >* writer, std::size_t count )
+{
+	for ( std::size_t i = 1; i <= count; i++ )
+		writer->write( i, numberedPose( static_cast< double >( i ) ) );
+}
+
+} // anonymous namespace
+
+
+void TestSharedMemoryRing()
+{
+	// fixed size types, the reader uses its own mapping of the region
+	{
+		const std::string name( ringName( "pose" ) );
+		SharedMemoryWriter< Math::Pose > writer( name, 4 );
+		SharedMemoryReader< Math::Pose > reader( name );
+		BOOST_CHECK_EQUAL( reader.capacity(), 4u );
+
+		Measurement::Pose m;
+		BOOST_CHECK( !reader.latest( m ) );
+		BOOST_CHECK( !reader.next( m ) );
+
+		writer.write( Measurement::Pose( 10, numberedPose( 10 ) ) );
+		writer.write( Measurement::Pose( 11, numberedPose( 11 ) ) );
+		BOOST_CHECK( reader.available() );
+		BOOST_CHECK( reader.next( m ) );
+		BOOST_CHECK_EQUAL( m.time(), 10u );
+		BOOST_CHECK( isNumbered( *m, 10 ) );
+
+		// latest skips to the newest value, next continues after it
+		writer.write( 12, numberedPose( 12 ) );
+		BOOST_CHECK( reader.latest( m ) );
+		BOOST_CHECK_EQUAL( m.time(), 12u );
+		BOOST_CHECK( isNumbered( *m, 12 ) );
+		BOOST_CHECK( !reader.next( m ) );
+
+		// a reader that falls behind loses the oldest values
+		for ( Measurement::Timestamp t = 13; t < 23; t++ )
+			writer.write( t, numberedPose( static_cast< double >( t ) ) );
+		std::vector< Measurement::Timestamp > times;
+		Math::Pose pose;
+		Measurement::Timestamp t;
+		while ( reader.next( t, pose ) )
+		{
+			BOOST_CHECK( isNumbered( pose, t ) );
+			times.push_back( t );
+		}
+		BOOST_CHECK_EQUAL( times.size(), 3u );
+		BOOST_CHECK_EQUAL( times.back(), 22u );
+		BOOST_CHECK_EQUAL( reader.lost() + times.size(), 10u );
+
+		// wrong types are rejected
+		BOOST_CHECK_THROW( SharedMemoryReader< Math::Quaternion > wrong( name ), Util::Exception );
+	}
+
+	// the name is removed with the writer
+	BOOST_CHECK_THROW( SharedMemoryReader< Math::Pose > missing( ringName( "pose" ) ), Util::Exception );
+
+	// error poses and rotations
+	{
+		const std::string name( ringName( "errorpose" ) );
+		SharedMemoryWriter< Math::ErrorPose > writer( name );
+		SharedMemoryReader< Math::ErrorPose > reader( name );
+		Math::Matrix< double, 6, 6 > covariance;
+		for ( std::size_t i = 0; i < 6; i++ )
+			for ( std::size_t j = 0; j < 6; j++ )
+				covariance( i, j ) = 0.1 * i + 0.01 * j;
+		writer.write( 5, Math::ErrorPose( numberedPose( 0.5 ), covariance ) );
+		Measurement::ErrorPose m;
+		BOOST_CHECK( reader.latest( m ) );
+		BOOST_CHECK_EQUAL( m->translation()( 2 ), 6.5 );
+		BOOST_CHECK_EQUAL( m->covariance()( 4, 3 ), covariance( 4, 3 ) );
+
+		const std::string rotationName( ringName( "rotation" ) );
+		SharedMemoryWriter< Math::Quaternion > rotationWriter( rotationName );
+		SharedMemoryReader< Math::Quaternion > rotationReader( rotationName );
+		rotationWriter.write( 1, Math::Quaternion( 0.5, 0.5, 0.5, 0.5 ) );
+		Measurement::Rotation r;
+		BOOST_CHECK( rotationReader.latest( r ) );
+		BOOST_CHECK_EQUAL( r->w(), 0.5 );
+	}
+
+	// bounded lists
+	{
+		const std::string name( ringName( "positions" ) );
+		typedef std::vector< Math::Vector< double, 3 > > List;
+		BOOST_CHECK_THROW( SharedMemoryWriter< List > unbounded( name ), Util::Exception );
+		SharedMemoryWriter< List > writer( name, 8, 3 );
+		SharedMemoryReader< List > reader( name );
+		BOOST_CHECK_EQUAL( reader.maxElements(), 3u );
+
+		List points( 2 );
+		points[ 1 ] = Math::Vector< double, 3 >( 1, 2, 3 );
+		writer.write( 1, points );
+		Measurement::PositionList m;
+		BOOST_CHECK( reader.latest( m ) );
+		BOOST_CHECK_EQUAL( m->size(), 2u );
+		BOOST_CHECK_EQUAL( ( *m )[ 1 ]( 2 ), 3.0 );
+
+		points.resize( 4 );
+		BOOST_CHECK_THROW( writer.write( 2, points ), Util::Exception );
+		BOOST_CHECK( !reader.available() );
+
+		writer.write( 3, List() );
+		BOOST_CHECK( reader.next( m ) );
+		BOOST_CHECK( m->empty() );
+	}
+
+	// a concurrent writer never produces torn reads
+	{
+		const std::string name( ringName( "concurrent" ) );
+		SharedMemoryWriter< Math::Pose > writer( name, 8 );
+		SharedMemoryReader< Math::Pose > latestReader( name );
+		SharedMemoryReader< Math::Pose > sequentialReader( name );
+		const std::size_t count = 200000;
+		boost::thread thread( &writePoses, &writer, count );
+
+		Math::Pose pose;
+		Measurement::Timestamp t;
+		Measurement::Timestamp previous = 0;
+		std::size_t received = 0;
+		bool consistent = true;
+		while ( previous < count )
+		{
+			if ( latestReader.latest( t, pose ) )
+				consistent = consistent && isNumbered( pose, t );
+			while ( sequentialReader.next( t, pose ) )
+			{
+				consistent = consistent && isNumbered( pose, t ) && t > previous;
+				previous = t;
+				received++;
+			}
+		}
+		thread.join();
+		BOOST_CHECK( consistent );
+		BOOST_CHECK_EQUAL( received + sequentialReader.lost(), count );
+	}
+}
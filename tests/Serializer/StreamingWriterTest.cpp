@@ -0,0 +1,115 @@
+#include <utSerialization/StreamingWriter.h>
+#include <utUtil/Exception.h>
+
+#include <vector>
+
+#include "../tools.h"
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Serialization;
+
+namespace {
+
+/** collects the data, optionally blocking until released to simulate a slow disk */
+struct TestSink
+{
+	TestSink()
+		: blocked( false )
+		, fail( false )
+	{}
+
+	void operator()( const uint8_t* data, std::size_t size )
+	{
+		boost::mutex::scoped_lock lock( mutex );
+		while ( blocked )
+			released.wait( lock );
+		if ( fail )
+			throw std::runtime_error( "disk full" );
+		received.insert( received.end(), data, data + size );
+	}
+
+	void release()
+	{
+		boost::mutex::scoped_lock lock( mutex );
+		blocked = false;
+		released.notify_all();
+	}
+
+	boost::mutex mutex;
+	boost::condition_variable released;
+	bool blocked;
+	bool fail;
+	std::vector< uint8_t > received;
+};
+
+} // anonymous namespace
+
+
+void TestStreamingWriter()
+{
+	const std::size_t poseSize = 7 * sizeof( double );
+
+	// everything written arrives in order, enough chunks to never overrun
+	{
+		TestSink sink;
+		std::vector< Math::Pose > poses;
+		{
+			StreamingWriter writer( boost::bind< void >( boost::ref( sink ), _1, _2 ), 100 * poseSize, 16 );
+			for ( std::size_t i = 0; i < 1000; i++ )
+			{
+				poses.push_back( Math::Pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) ) );
+				writer.write( poses.back() );
+			}
+			writer.flush();
+			BOOST_CHECK_EQUAL( writer.bytesWritten(), 1000 * poseSize );
+			BOOST_CHECK_EQUAL( writer.pendingChunks(), 0u );
+		}
+
+		BOOST_REQUIRE_EQUAL( sink.received.size(), 1000 * poseSize );
+		ROSBinary::IStream in( &sink.received[ 0 ], (uint32_t) sink.received.size() );
+		for ( std::size_t i = 0; i < poses.size(); i++ )
+		{
+			Math::Pose p;
+			in.next( p );
+			BOOST_CHECK_EQUAL( p, poses[ i ] );
+		}
+	}
+
+	// a consumer that falls behind causes an overrun instead of blocking the writer
+	{
+		TestSink sink;
+		sink.blocked = true;
+		StreamingWriter writer( boost::bind< void >( boost::ref( sink ), _1, _2 ), 4 * poseSize, 2 );
+		const Math::Pose pose( randomQuaternion(), randomVector< double, 3 >( 5.0 ) );
+
+		// the first chunk is handed to the sink, the second one fills up
+		std::size_t written = 0;
+		for ( ; written < 8; written++ )
+			writer.write( pose );
+		BOOST_CHECK( writer.congested() );
+		BOOST_CHECK_THROW( writer.write( pose ), StreamOverrunException );
+
+		// objects larger than a chunk never fit
+		std::vector< Math::Pose > large( 5, pose );
+		BOOST_CHECK_THROW( writer.write( large ), StreamOverrunException );
+
+		sink.release();
+		writer.flush();
+		BOOST_CHECK_EQUAL( sink.received.size(), written * poseSize );
+		BOOST_CHECK( !writer.congested() );
+		writer.write( pose );
+	}
+
+	// failures of the sink are reported to the writer
+	{
+		TestSink sink;
+		sink.fail = true;
+		StreamingWriter writer( boost::bind< void >( boost::ref( sink ), _1, _2 ), 4 * poseSize );
+		writer.write( Math::Pose() );
+		BOOST_CHECK_THROW( writer.flush(), Util::Exception );
+	}
+}
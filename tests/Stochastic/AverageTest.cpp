@@ -0,0 +1,170 @@
+#include <utMath/Blas1.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utMath/Stochastic/Average.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** the average of samples [ begin, end ) by the accumulating Average */
+template< typename ResultType, typename InputType >
+ResultType averageRange( const std::vector< InputType >& samples, const std::size_t begin, const std::size_t end )
+{
+	Stochastic::Average< ResultType > averager;
+	for ( std::size_t i = begin; i < end; i++ )
+		averager( samples[ i ] );
+	return averager.getAverage();
+}
+
+double difference( const double a, const double b )
+{ return std::fabs( a - b ); }
+
+double difference( const Scalar< double > a, const Scalar< double > b )
+{ return std::fabs( a - b ); }
+
+double difference( const Vector< double, 3 >& a, const Vector< double, 3 >& b )
+{ return boost::numeric::ublas::norm_2( a - b ); }
+
+double difference( const Quaternion& a, const Quaternion& b )
+{ return std::min( boost::math::abs( a - b ), boost::math::abs( a + b ) ); }
+
+double difference( const Pose& a, const Pose& b )
+{ return difference( a.rotation(), b.rotation() ) + difference( a.translation(), b.translation() ); }
+
+double difference( const ErrorVector< double, 3 >& a, const ErrorVector< double, 3 >& b )
+{ return difference( a.value, b.value ) + boost::numeric::ublas::norm_frobenius( a.covariance - b.covariance ); }
+
+double difference( const ErrorPose& a, const ErrorPose& b )
+{ return difference( Pose( a ), Pose( b ) ) + boost::numeric::ublas::norm_frobenius( a.covariance() - b.covariance() ); }
+
+/** the sliding average equals the average of the last samples at every step */
+template< typename ResultType, typename InputType >
+void testSlidingAverage( const std::vector< InputType >& samples, const std::size_t window )
+{
+	Stochastic::SlidingAverage< ResultType > averager( window );
+	BOOST_CHECK_THROW( averager.getAverage(), Ubitrack::Util::Exception );
+
+	double maxDifference = 0;
+	for ( std::size_t i = 0; i < samples.size(); i++ )
+	{
+		averager( samples[ i ] );
+		const std::size_t begin = i + 1 > window ? i + 1 - window : 0;
+		BOOST_CHECK_EQUAL( averager.size(), i + 1 - begin );
+		if ( i % 7 == 0 || i + 1 == samples.size() )
+			maxDifference = std::max( maxDifference, difference( averager.getAverage(), averageRange< ResultType >( samples, begin, i + 1 ) ) );
+	}
+	BOOST_CHECK_SMALL( maxDifference, 1e-9 );
+
+	averager.reset();
+	BOOST_CHECK_EQUAL( averager.size(), 0u );
+}
+
+/** the exponential average equals the average with normalized weights */
+template< typename InputType >
+void testExponentialAverage( const std::vector< InputType >& samples, const double alpha )
+{
+	typedef Stochastic::ExponentialAverage< ErrorVector< double, 3 > > Averager;
+	Averager averager( alpha );
+	BOOST_CHECK_THROW( averager.getAverage(), Ubitrack::Util::Exception );
+	BOOST_CHECK_THROW( Averager( 0 ), Ubitrack::Util::Exception );
+	for ( std::size_t i = 0; i < samples.size(); i++ )
+		averager( samples[ i ] );
+
+	double weightSum = 0;
+	Vector< double, 3 > mean( Vector< double, 3 >::zeros() );
+	for ( std::size_t i = 0; i < samples.size(); i++ )
+	{
+		const double w = std::pow( 1 - alpha, double( samples.size() - 1 - i ) );
+		weightSum += w;
+		mean += w * samples[ i ];
+	}
+	mean /= weightSum;
+	Matrix< double, 3, 3 > covariance( Matrix< double, 3, 3 >::zeros() );
+	for ( std::size_t i = 0; i < samples.size(); i++ )
+	{
+		const double w = std::pow( 1 - alpha, double( samples.size() - 1 - i ) ) / weightSum;
+		const Vector< double, 3 > d( samples[ i ] - mean );
+		covariance += w * outer_product( d, d );
+	}
+	BOOST_CHECK_SMALL( difference( averager.getAverage(), ErrorVector< double, 3 >( mean, covariance ) ), 1e-9 );
+
+	// alpha of one keeps the last sample only
+	Stochastic::ExponentialAverage< Vector< double, 3 > > last( 1 );
+	for ( std::size_t i = 0; i < samples.size(); i++ )
+		last( samples[ i ] );
+	BOOST_CHECK_SMALL( difference( last.getAverage(), samples.back() ), 1e-12 );
+}
+
+/** small random rotations about random axes */
+struct SmallRotation
+{
+	Random::Vector< double, 3 >::Normal randAxis;
+	Random::Vector< double, 1 >::Normal randAngle;
+
+	SmallRotation()
+		: randAxis( 0, 1 )
+		, randAngle( 0, 0.2 )
+	{}
+
+	Quaternion operator()()
+	{ return Quaternion( randAxis(), randAngle()( 0 ) ); }
+};
+
+} // anonymous namespace
+
+void TestAverage()
+{
+	const std::size_t n = 500;
+	Random::Vector< double, 3 >::Normal randVector( 1, 0.5 );
+	SmallRotation randRotation;
+
+	std::vector< double > scalars;
+	std::vector< Scalar< double > > wrapped;
+	std::vector< Vector< double, 3 > > vectors;
+	std::vector< Quaternion > rotations;
+	std::vector< Pose > poses;
+	const Quaternion base( Vector< double, 3 >( 0, 0, 1 ), 0.5 );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		vectors.push_back( randVector() );
+		scalars.push_back( vectors.back()( 0 ) );
+		wrapped.push_back( Scalar< double >( vectors.back()( 1 ) ) );
+
+		// both representations of the same rotations
+		Quaternion q( base * randRotation() );
+		if ( i % 3 == 0 )
+			q = -q;
+		rotations.push_back( q );
+		poses.push_back( Pose( q, vectors.back() * 10.0 ) );
+	}
+
+	testSlidingAverage< double >( scalars, 50 );
+	testSlidingAverage< Scalar< double > >( wrapped, 50 );
+	testSlidingAverage< Vector< double, 3 > >( vectors, 50 );
+	testSlidingAverage< Vector< double, 3 > >( vectors, 1 );
+	testSlidingAverage< ErrorVector< double, 3 > >( vectors, 64 );
+	testSlidingAverage< Quaternion >( rotations, 50 );
+	testSlidingAverage< Pose >( poses, 50 );
+	testSlidingAverage< ErrorPose >( poses, 37 );
+	BOOST_CHECK_THROW( Stochastic::SlidingAverage< Pose >( 0 ), Ubitrack::Util::Exception );
+
+	testExponentialAverage( vectors, 0.05 );
+
+	// rotations of about 180 degrees, whose real parts change sign
+	const Quaternion flip( Vector< double, 3 >( 0, 1, 0 ), 3.14159265358979 );
+	Stochastic::SlidingAverage< Quaternion > sliding( 100 );
+	Stochastic::ExponentialAverage< Quaternion > exponential( 0.1 );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const Quaternion q( flip * randRotation() );
+		sliding( q );
+		exponential( q );
+	}
+	BOOST_CHECK_SMALL( difference( sliding.getAverage(), flip ), 0.1 );
+	BOOST_CHECK_SMALL( difference( exponential.getAverage(), flip ), 0.2 );
+}
@@ -0,0 +1,136 @@
+#include <utMath/Matrix.h>
+#include <utMath/Blas3.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Stochastic/BackwardPropagation.h>
+
+#include <boost/numeric/bindings/lapack/posv.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+namespace lapack = boost::numeric::bindings::lapack;
+
+namespace {
+
+typedef Matrix< double, 0, 0 > MatType;
+
+/** a linear function with a fixed jacobian */
+struct LinearFunction
+{
+	const MatType& m_jacobian;
+
+	LinearFunction( const MatType& j )
+		: m_jacobian( j )
+	{}
+
+	std::size_t size() const
+	{ return m_jacobian.size1(); }
+
+	template< class VT, class MT >
+	void jacobian( const VT&, MT& J ) const
+	{ J = m_jacobian; }
+};
+
+MatType randomMatrix( const std::size_t m, const std::size_t n )
+{
+	MatType a( m, n );
+	for ( std::size_t i = 0; i < m; i++ )
+		for ( std::size_t j = 0; j < n; j++ )
+			a( i, j ) = Random::distribute_uniform< double >( -1, 1 );
+	return a;
+}
+
+template< class MT1, class MT2 >
+double difference( const MT1& a, const MT2& b )
+{
+	double d = 0;
+	for ( std::size_t i = 0; i < a.size1(); i++ )
+		for ( std::size_t j = 0; j < a.size2(); j++ )
+			d = std::max( d, std::fabs( double( a( i, j ) ) - double( b( i, j ) ) ) );
+	return d;
+}
+
+/** the pseudo-inverse solution s * ( J^T * J )^+ by the SVD version */
+MatType svdCovariance( const MatType& jacobian, const double s )
+{
+	MatType j( jacobian );
+	MatType result( jacobian.size2(), jacobian.size2() );
+	Stochastic::backwardPropagationIdentity( result, s, j );
+	return result;
+}
+
+} // anonymous namespace
+
+
+void TestBackwardPropagation()
+{
+	const Vector< double, 6 > params( Vector< double, 6 >::zeros() );
+
+	// columns of different scale, like translation and rotation
+	MatType J( randomMatrix( 40, 6 ) );
+	for ( std::size_t i = 0; i < J.size1(); i++ )
+		for ( std::size_t j = 3; j < 6; j++ )
+			J( i, j ) *= 500;
+	const LinearFunction f( J );
+
+	// identity input covariance, same as the SVD version
+	const MatType reference( svdCovariance( J, 0.25 ) );
+	Matrix< double, 6, 6 > result;
+	Stochastic::backwardPropagationIdentity( result, 0.25, f, params );
+	BOOST_CHECK_SMALL( difference( result, reference ) / ublas::norm_inf( reference ), 1e-10 );
+	for ( std::size_t i = 0; i < 6; i++ )
+		for ( std::size_t j = 0; j < i; j++ )
+			BOOST_CHECK_EQUAL( result( i, j ), result( j, i ) );
+
+	// float results are computed in double precision
+	Matrix< float, 6, 6 > resultf;
+	Stochastic::backwardPropagationIdentity( resultf, 0.25f, f, params );
+	BOOST_CHECK_SMALL( difference( resultf, reference ) / ublas::norm_inf( reference ), 1e-6 );
+
+	// diagonal input covariance: all rows are weighted, not only the first ones
+	Vector< double, 0 > e( J.size1() );
+	for ( std::size_t i = 0; i < e.size(); i++ )
+		e( i ) = 0.1 + i;
+	MatType weighted( J );
+	for ( std::size_t i = 0; i < e.size(); i++ )
+		ublas::row( weighted, i ) /= std::sqrt( e( i ) );
+	const MatType diagonalReference( svdCovariance( weighted, 1 ) );
+	Stochastic::backwardPropagationDiagonal( result, e, f, params );
+	BOOST_CHECK_SMALL( difference( result, diagonalReference ) / ublas::norm_inf( diagonalReference ), 1e-10 );
+	MatType jacobian( J );
+	MatType svdResult( 6, 6 );
+	Stochastic::backwardPropagationDiagonal( svdResult, e, jacobian );
+	BOOST_CHECK_SMALL( difference( svdResult, diagonalReference ) / ublas::norm_inf( diagonalReference ), 1e-10 );
+
+	// a diagonal matrix as full covariance gives the same result
+	MatType E( ublas::zero_matrix< double >( e.size(), e.size() ) );
+	for ( std::size_t i = 0; i < e.size(); i++ )
+		E( i, i ) = e( i );
+	Stochastic::backwardPropagation( result, E, f, params );
+	BOOST_CHECK_SMALL( difference( result, diagonalReference ) / ublas::norm_inf( diagonalReference ), 1e-10 );
+
+	// full covariance: C^-1 = J^T * E^-1 * J
+	const MatType A( randomMatrix( e.size(), e.size() ) );
+	noalias( E ) = ublas::prod( A, ublas::trans( A ) );
+	for ( std::size_t i = 0; i < e.size(); i++ )
+		E( i, i ) += 1;
+	Stochastic::backwardPropagation( result, E, f, params );
+	MatType EInv( E );
+	lapack::potrf( 'U', EInv );
+	lapack::potri( 'U', EInv );
+	for ( std::size_t i = 0; i < EInv.size1(); i++ )
+		for ( std::size_t j = 0; j < i; j++ )
+			EInv( i, j ) = EInv( j, i );
+	const MatType EInvJ( ublas::prod( EInv, J ) );
+	const MatType information( ublas::prod( ublas::trans( J ), EInvJ ) );
+	const MatType identity( ublas::prod( result, information ) );
+	BOOST_CHECK_SMALL( difference( identity, ublas::identity_matrix< double >( 6 ) ), 1e-8 );
+
+	// rank deficient jacobian falls back to the pseudo-inverse
+	MatType deficient( J );
+	ublas::column( deficient, 5 ) = ublas::column( deficient, 4 );
+	const MatType deficientReference( svdCovariance( deficient, 1 ) );
+	Stochastic::backwardPropagationIdentity( result, 1.0, LinearFunction( deficient ), params );
+	BOOST_CHECK_SMALL( difference( result, deficientReference ) / ublas::norm_inf( deficientReference ), 1e-10 );
+}
@@ -0,0 +1,128 @@
+#include <utMath/ErrorPose.h>
+#include <utMath/Blas1.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Random/Rotation.h>
+#include <utMath/Stochastic/CovarianceTransform.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** y = ( x0 * x1, sin( x2 ) ) */
+struct ProductSine
+{
+	template< class VT1, class VT2 >
+	void evaluate( VT1& result, const VT2& x ) const
+	{
+		result( 0 ) = x( 0 ) * x( 1 );
+		result( 1 ) = std::sin( x( 2 ) );
+	}
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& x, MT& jacobian ) const
+	{
+		evaluate( result, x );
+		jacobian( 0, 0 ) = x( 1 );
+		jacobian( 0, 1 ) = x( 0 );
+		jacobian( 0, 2 ) = 0;
+		jacobian( 1, 0 ) = 0;
+		jacobian( 1, 1 ) = 0;
+		jacobian( 1, 2 ) = std::cos( x( 2 ) );
+	}
+};
+
+/** a random symmetric positive definite covariance */
+template< std::size_t N >
+Matrix< double, N, N > randomCovariance( typename Random::Vector< double, N >::Uniform& randVector )
+{
+	Matrix< double, N, N > c( Matrix< double, N, N >::identity() * 0.1 );
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		const Vector< double, N > v( randVector() );
+		c += ublas::outer_prod( v, v );
+	}
+	return c;
+}
+
+template< std::size_t N >
+double difference( const Matrix< double, N, N >& a, const Matrix< double, N, N >& b )
+{ return double( ublas::norm_frobenius( a - b ) ); }
+
+} // anonymous namespace
+
+
+void TestCovarianceTransform()
+{
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+	Random::Vector< double, 6 >::Uniform randVector6( -0.1, 0.1 );
+	Random::Quaternion< double >::Uniform randQuat;
+
+	std::vector< ErrorVector< double, 3 > > points( 1000 );
+	for ( std::size_t i = 0; i < points.size(); i++ )
+		points[ i ] = ErrorVector< double, 3 >( randVector(), randomCovariance< 3 >( randVector ) );
+
+	// symmetric product
+	Matrix< double, 2, 3 > J;
+	for ( std::size_t i = 0; i < 2; i++ )
+		for ( std::size_t j = 0; j < 3; j++ )
+			J( i, j ) = i + 2.0 * j - 1;
+	Matrix< double, 2, 3 > jc( ublas::prod( J, points[ 0 ].covariance ) );
+	Matrix< double, 2, 2 > expected( ublas::prod( jc, ublas::trans( J ) ) );
+	Matrix< double, 2, 2 > product;
+	Stochastic::symmetricTransform( product, J, points[ 0 ].covariance );
+	BOOST_CHECK_SMALL( difference( product, expected ), 1e-12 );
+
+	// generic function, each element as with transformWithCovariance, sequential and threaded
+	std::vector< ErrorVector< double, 2 > > result;
+	std::vector< ErrorVector< double, 2 > > threaded;
+	Stochastic::transformListWithCovariance( ProductSine(), points, result );
+	Stochastic::transformListWithCovariance( ProductSine(), points, threaded, threadExecutor( 4, 16 ) );
+	BOOST_REQUIRE_EQUAL( result.size(), points.size() );
+	BOOST_REQUIRE_EQUAL( threaded.size(), points.size() );
+	for ( std::size_t i = 0; i < points.size(); i += 37 )
+	{
+		ErrorVector< double, 2 > single;
+		Stochastic::transformWithCovariance( ProductSine(), single.value, single.covariance, points[ i ].value, points[ i ].covariance );
+		BOOST_CHECK_SMALL( double( ublas::norm_2( result[ i ].value - single.value ) ), 1e-12 );
+		BOOST_CHECK_SMALL( difference( result[ i ].covariance, single.covariance ), 1e-12 );
+		BOOST_CHECK_SMALL( difference( threaded[ i ].covariance, result[ i ].covariance ), 1e-14 );
+	}
+
+	// poses without error rotate the covariances, also in place
+	const Pose p( randQuat(), randVector() );
+	Matrix< double, 3, 3 > R;
+	p.rotation().toMatrix( R );
+	std::vector< ErrorVector< double, 3 > > transformed( points );
+	transformErrorPositionList( p, transformed, transformed );
+	for ( std::size_t i = 0; i < points.size(); i += 37 )
+	{
+		const Matrix< double, 3, 3 > rc( ublas::prod( R, points[ i ].covariance ) );
+		const Matrix< double, 3, 3 > rotated( ublas::prod( rc, ublas::trans( R ) ) );
+		BOOST_CHECK_SMALL( double( ublas::norm_2( transformed[ i ].value - p * points[ i ].value ) ), 1e-12 );
+		BOOST_CHECK_SMALL( difference( transformed[ i ].covariance, rotated ), 1e-12 );
+	}
+
+	// poses with error add the pose error, consistent with the single point operator
+	const ErrorPose ep( p, randomCovariance< 6 >( randVector6 ) );
+	std::vector< ErrorVector< double, 3 > > sequential;
+	transformErrorPositionList( ep, points, sequential );
+	transformErrorPositionList( ep, points, transformed, threadExecutor( 4, 16 ) );
+	const ErrorPose exact( p, Matrix< double, 6, 6 >::zeros() );
+	for ( std::size_t i = 0; i < points.size(); i += 37 )
+	{
+		const ErrorVector< double, 3 > single( ep * points[ i ] );
+		BOOST_CHECK_SMALL( double( ublas::norm_2( sequential[ i ].value - single.value ) ), 1e-12 );
+		BOOST_CHECK_SMALL( difference( sequential[ i ].covariance, single.covariance ), 1e-12 );
+		BOOST_CHECK_SMALL( difference( transformed[ i ].covariance, sequential[ i ].covariance ), 1e-14 );
+
+		// without pose error only the point error remains, without point error only the pose error
+		const ErrorVector< double, 3 > noPoseError( exact * points[ i ] );
+		const ErrorVector< double, 3 > noPointError( ep * ErrorVector< double, 3 >( points[ i ].value, Matrix< double, 3, 3 >::zeros() ) );
+		const Matrix< double, 3, 3 > sum( noPoseError.covariance + noPointError.covariance );
+		BOOST_CHECK_SMALL( difference( sum, single.covariance ), 1e-12 );
+	}
+}
@@ -0,0 +1,101 @@
+#include <utMath/Random/Scalar.h>
+#include <utMath/Stochastic/Correlation.h>
+#include <utMath/Stochastic/CrossCorrelation.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** the correlation of the lag by the direct function, on the pairs ( a[ i ], b[ i + lag ] ) of [ begin, end ) */
+double directCorrelation( const std::vector< double >& a, const std::vector< double >& b, const long lag,
+	long begin, long end )
+{
+	begin = std::max( begin, std::max( 0L, -lag ) );
+	end = std::min( end, std::min( long( a.size() ), long( b.size() ) - lag ) );
+	return Stochastic::correlation( a.begin() + begin, a.begin() + end, b.begin() + begin + lag, b.begin() + end + lag );
+}
+
+/** a smooth random signal with an offset */
+std::vector< double > randomSignal( const std::size_t n )
+{
+	std::vector< double > s( n );
+	double v = 0;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		v = 0.9 * v + Random::distribute_uniform< double >( -1, 1 );
+		s[ i ] = 100 + v;
+	}
+	return s;
+}
+
+} // anonymous namespace
+
+
+void TestCrossCorrelation()
+{
+	// all lags at once, also for sequences of different length
+	const std::vector< double > a( randomSignal( 300 ) );
+	const std::vector< double > b( randomSignal( 250 ) );
+	const std::size_t maxLag = 40;
+	std::vector< double > c;
+	Stochastic::crossCorrelation( a, b, maxLag, c );
+	BOOST_REQUIRE_EQUAL( c.size(), 2 * maxLag + 1 );
+	for ( long lag = -long( maxLag ); lag <= long( maxLag ); lag++ )
+		BOOST_CHECK_SMALL( c[ maxLag + lag ] - directCorrelation( a, b, lag, 0, long( a.size() ) ), 1e-10 );
+
+	// a shifted copy correlates perfectly at its offset
+	std::vector< double > shifted( a.begin() + 7, a.end() );
+	Stochastic::crossCorrelation( shifted, a, maxLag, c );
+	BOOST_CHECK_CLOSE( c[ maxLag + 7 ], 1.0, 1e-8 );
+	double peak( 0 );
+	BOOST_CHECK_SMALL( Stochastic::correlationPeak( c, &peak ) - double( maxLag + 7 ), 0.05 );
+	BOOST_CHECK_CLOSE( peak, 1.0, 1e-3 );
+
+	// sub-sample peak of a sampled parabola
+	std::vector< double > parabola;
+	for ( int i = 0; i < 9; i++ )
+		parabola.push_back( 1 - ( i - 4.3 ) * ( i - 4.3 ) );
+	BOOST_CHECK_CLOSE( Stochastic::correlationPeak( parabola, &peak ), 4.3, 1e-8 );
+	BOOST_CHECK_CLOSE( peak, 1.0, 1e-8 );
+
+	// lags without enough overlap are 0
+	const std::vector< double > shortA( a.begin(), a.begin() + 5 );
+	Stochastic::crossCorrelation( shortA, shortA, 6, c, 3 );
+	BOOST_CHECK_EQUAL( c[ 0 ], 0.0 );
+	BOOST_CHECK_EQUAL( c[ 6 - 3 ], 0.0 );
+	BOOST_CHECK( c[ 6 - 2 ] != 0.0 );
+	BOOST_CHECK_CLOSE( c[ 6 ], 1.0, 1e-8 );
+
+	// sliding window, compared to the direct correlation of the last complete pairs of each lag
+	const std::size_t window = 50;
+	const std::size_t slidingLag = 10;
+	Stochastic::SlidingCrossCorrelation< double > sliding( window, slidingLag );
+	for ( std::size_t t = 0; t < b.size(); t++ )
+	{
+		sliding.push( a[ t ], b[ t ] );
+		if ( t % 23 != 0 && t != window - 1 && t != window )
+			continue;
+
+		sliding.correlations( c );
+		BOOST_REQUIRE_EQUAL( c.size(), 2 * slidingLag + 1 );
+		const std::vector< double > aPast( a.begin(), a.begin() + t + 1 );
+		const std::vector< double > bPast( b.begin(), b.begin() + t + 1 );
+		for ( long lag = -long( slidingLag ); lag <= long( slidingLag ); lag++ )
+		{
+			const long end = lag >= 0 ? long( t ) + 1 - lag : long( t ) + 1;
+			const long begin = end - long( window );
+			if ( std::min( end, long( t ) + 1 + lag ) - std::max( 0L, std::max( begin, -lag ) ) < 2 )
+			{
+				BOOST_CHECK_EQUAL( c[ slidingLag + lag ], 0.0 );
+				continue;
+			}
+			BOOST_CHECK_SMALL( c[ slidingLag + lag ] - directCorrelation( aPast, bPast, lag, begin, end ), 1e-9 );
+		}
+	}
+	BOOST_CHECK_EQUAL( sliding.count(), b.size() );
+	sliding.reset();
+	BOOST_CHECK_EQUAL( sliding.count(), 0u );
+}
@@ -0,0 +1,187 @@
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Stochastic/Gaussian.h>
+#include <utMath/Stochastic/KMeansClustering.h>
+
+#include <numeric>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+template< typename T, std::size_t N >
+void checkSameGaussian( const Stochastic::Gaussian< T, N >& a, const Stochastic::Gaussian< T, N >& b, const T epsilon )
+{
+	for ( std::size_t i = 0; i < N; i++ )
+		BOOST_CHECK_SMALL( a.mean[ i ] - b.mean[ i ], epsilon );
+	for ( std::size_t i = 0; i < N * N; i++ )
+		BOOST_CHECK_SMALL( a.covariance[ i ] - b.covariance[ i ], epsilon );
+	BOOST_CHECK_SMALL( a.variance - b.variance, epsilon );
+}
+
+template< typename T, std::size_t N >
+void testGaussianAccumulator( const std::size_t n, const T epsilon )
+{
+	// samples far from the origin, where the naive sum of squares loses precision
+	typename Random::Vector< T, N >::Normal randPoints( 1000, 2 );
+	std::vector< Vector< T, N > > points;
+	std::generate_n( std::back_inserter( points ), n, randPoints );
+
+	Stochastic::GaussianAccumulator< T, N > accumulator;
+	Stochastic::Gaussian< T, N > streamed, reference;
+	BOOST_CHECK( !accumulator.gaussian( streamed ) );
+
+	// same result as the two pass estimation
+	accumulator = std::for_each( points.begin(), points.end(), accumulator );
+	BOOST_CHECK_EQUAL( accumulator.count(), n );
+	BOOST_CHECK_CLOSE( accumulator.weight(), T( n ), epsilon );
+	BOOST_CHECK( accumulator.gaussian( streamed ) );
+	Stochastic::estimate_gaussian( points.begin(), points.end(), reference );
+	checkSameGaussian( streamed, reference, epsilon );
+
+	// merged partial accumulators give the same result
+	Stochastic::GaussianAccumulator< T, N > parts[ 3 ];
+	for ( std::size_t i = 0; i < n; i++ )
+		parts[ ( i * 7 ) % 3 ]( points[ i ] );
+	Stochastic::GaussianAccumulator< T, N > merged;
+	for ( std::size_t p = 0; p < 3; p++ )
+		merged.merge( parts[ p ] );
+	merged.merge( Stochastic::GaussianAccumulator< T, N >() );
+	BOOST_CHECK_EQUAL( merged.count(), n );
+	merged.gaussian( streamed );
+	checkSameGaussian( streamed, reference, epsilon );
+
+	// a weight of two counts like a sample added twice
+	Stochastic::GaussianAccumulator< T, N > weighted, repeated;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		weighted.add( points[ i ], i % 2 ? T( 2 ) : T( 1 ) );
+		repeated( points[ i ] );
+		if ( i % 2 )
+			repeated( points[ i ] );
+	}
+	Stochastic::Gaussian< T, N > fromRepeated;
+	weighted.gaussian( streamed );
+	repeated.gaussian( fromRepeated );
+	checkSameGaussian( streamed, fromRepeated, epsilon );
+
+	// forgetting weights the samples by powers of the factor
+	const T lambda( 0.95 );
+	Stochastic::GaussianAccumulator< T, N > forgetting( lambda );
+	std::vector< T > weights( n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		forgetting( points[ i ] );
+		weights[ i ] = std::pow( lambda, T( n - 1 - i ) );
+	}
+	const T weightSum = std::accumulate( weights.begin(), weights.end(), T( 0 ) );
+	BOOST_CHECK_CLOSE( forgetting.weight(), weightSum, epsilon );
+	for ( std::size_t i = 0; i < n; i++ )
+		weights[ i ] /= weightSum;
+	forgetting.gaussian( streamed );
+	Stochastic::estimate_gaussian( points.begin(), points.end(), weights.begin(), reference );
+	checkSameGaussian( streamed, reference, epsilon );
+
+	// the weight stays bounded by the forgetting
+	for ( std::size_t i = 0; i < 10 * n; i++ )
+		forgetting( points[ i % n ] );
+	BOOST_CHECK( forgetting.weight() <= 1 / ( 1 - lambda ) * ( 1 + epsilon ) );
+
+	// reset and invalid factors
+	accumulator.reset();
+	BOOST_CHECK_EQUAL( accumulator.count(), 0u );
+	typedef Stochastic::GaussianAccumulator< T, N > Accumulator;
+	BOOST_CHECK_THROW( Accumulator( T( 0 ) ), Ubitrack::Util::Exception );
+	BOOST_CHECK_THROW( Accumulator( T( 1.5 ) ), Ubitrack::Util::Exception );
+}
+
+template< typename T, std::size_t N >
+void testGroupedGaussians( const std::size_t n, const T epsilon )
+{
+	typedef Stochastic::Weighted< Stochastic::Gaussian< T, N >, T > WeightedGaussian;
+	const std::size_t nClusters = 4;
+
+	// values with cluster indices, -1 marks values that belong to no cluster
+	typename Random::Vector< T, N >::Normal randPoints( 10, 3 );
+	std::vector< Vector< T, N > > points;
+	std::vector< int > indices;
+	std::vector< T > weights;
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		points.push_back( randPoints() );
+		indices.push_back( i % 11 == 0 ? -1 : int( ( i * 7 ) % nClusters ) );
+		weights.push_back( T( 1 + i % 3 ) );
+	}
+
+	// same Gaussians as the estimation per cluster, with and without executor
+	std::vector< WeightedGaussian > grouped( nClusters ), parallel( nClusters );
+	BOOST_CHECK( Stochastic::estimate_gaussians_index( points.begin(), points.end(), indices.begin(), nClusters, grouped.begin() ) );
+	BOOST_CHECK( Stochastic::estimate_gaussians_index( points.begin(), points.end(), indices.begin(), nClusters, parallel.begin(),
+		threadExecutor( 3, 1 ) ) );
+	T weightSum( 0 );
+	for ( std::size_t k = 0; k < nClusters; k++ )
+	{
+		Stochastic::Gaussian< T, N > reference;
+		Stochastic::estimate_gaussian_index( points.begin(), points.end(), indices.begin(), int( k ), reference );
+		checkSameGaussian< T, N >( grouped[ k ], reference, epsilon );
+		checkSameGaussian< T, N >( parallel[ k ], reference, epsilon );
+		BOOST_CHECK_CLOSE( grouped[ k ].weight, T( std::count( indices.begin(), indices.end(), int( k ) ) ) / ( n - ( n + 10 ) / 11 ), epsilon );
+		weightSum += grouped[ k ].weight;
+	}
+	BOOST_CHECK_CLOSE( weightSum, T( 1 ), epsilon );
+
+	// weighted values against the weighted estimation of each cluster
+	std::vector< Stochastic::Gaussian< T, N > > weighted( nClusters ), weightedParallel( nClusters );
+	Stochastic::estimate_gaussians_index( points.begin(), points.end(), indices.begin(), weights.begin(), nClusters, weighted.begin() );
+	Stochastic::estimate_gaussians_index( points.begin(), points.end(), indices.begin(), weights.begin(), nClusters, weightedParallel.begin(),
+		threadExecutor( 2, 1 ) );
+	for ( std::size_t k = 0; k < nClusters; k++ )
+	{
+		std::vector< Vector< T, N > > members;
+		std::vector< T > memberWeights;
+		for ( std::size_t i = 0; i < n; i++ )
+			if ( indices[ i ] == int( k ) )
+			{
+				members.push_back( points[ i ] );
+				memberWeights.push_back( weights[ i ] );
+			}
+		const T memberSum = std::accumulate( memberWeights.begin(), memberWeights.end(), T( 0 ) );
+		for ( std::size_t i = 0; i < memberWeights.size(); i++ )
+			memberWeights[ i ] /= memberSum;
+		Stochastic::Gaussian< T, N > reference;
+		Stochastic::estimate_gaussian( members.begin(), members.end(), memberWeights.begin(), reference );
+		checkSameGaussian( weighted[ k ], reference, epsilon );
+		checkSameGaussian( weightedParallel[ k ], reference, epsilon );
+	}
+
+	// an empty cluster gives a zero Gaussian
+	std::vector< Stochastic::Gaussian< T, N > > withEmpty( nClusters + 1 );
+	BOOST_CHECK( !Stochastic::estimate_gaussians_index( points.begin(), points.end(), indices.begin(), nClusters + 1, withEmpty.begin() ) );
+	BOOST_CHECK_EQUAL( withEmpty[ nClusters ].variance, T( 0 ) );
+
+	// the Gaussians of k-means clusters
+	Stochastic::KMeansClustering< T, N > kmeans( nClusters );
+	kmeans.cluster( points );
+	std::vector< WeightedGaussian > clusters( nClusters );
+	kmeans.gaussians( points, clusters.begin() );
+	for ( std::size_t k = 0; k < nClusters; k++ )
+	{
+		Stochastic::Gaussian< T, N > reference;
+		Stochastic::estimate_gaussian_index( points.begin(), points.end(), kmeans.indices().begin(), k, reference );
+		checkSameGaussian< T, N >( clusters[ k ], reference, epsilon );
+	}
+}
+
+} // anonymous namespace
+
+void TestGaussianAccumulator()
+{
+	testGaussianAccumulator< double, 3 >( 5000, 1e-6 );
+	testGaussianAccumulator< double, 1 >( 1000, 1e-6 );
+	testGaussianAccumulator< float, 2 >( 300, 1e-2f );
+	testGroupedGaussians< double, 3 >( 20000, 1e-9 );
+	testGroupedGaussians< float, 2 >( 2000, 1e-3f );
+}
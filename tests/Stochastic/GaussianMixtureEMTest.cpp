@@ -0,0 +1,165 @@
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Stochastic/GaussianMixtureEM.h>
+#include <utMath/Stochastic/expectation_maximization.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** samples of three correlated Gaussians with weights 0.5, 0.3 and 0.2 */
+template< typename T, std::size_t N >
+void generateMixture( const std::size_t n, std::vector< Stochastic::Weighted< Stochastic::Gaussian< T, N >, T > >& mixture,
+	std::vector< Vector< T, N > >& points )
+{
+	typename Random::Vector< T, N >::Normal randNormal( 0, 1 );
+	const T weights[ 3 ] = { T( 0.5 ), T( 0.3 ), T( 0.2 ) };
+
+	mixture.resize( 3 );
+	for ( std::size_t k = 0; k < 3; k++ )
+	{
+		// x = mean + A z with A = scale * ( I + 0.5 * strict lower triangle )
+		const T scale = T( 0.5 ) + T( 0.25 ) * k;
+		T A[ N * N ];
+		for ( std::size_t j = 0; j < N; j++ )
+			for ( std::size_t l = 0; l < N; l++ )
+				A[ j * N + l ] = scale * ( j == l ? T( 1 ) : ( l < j ? T( 0.5 ) : T( 0 ) ) );
+
+		mixture[ k ].weight = weights[ k ];
+		for ( std::size_t j = 0; j < N; j++ )
+		{
+			mixture[ k ].mean[ j ] = T( 8 ) * ( j == k % N ? T( 1 ) : T( 0 ) ) - T( 2 ) * ( j == 0 ) * k;
+			for ( std::size_t l = 0; l < N; l++ )
+			{
+				T c( 0 );
+				for ( std::size_t m = 0; m < N; m++ )
+					c += A[ j * N + m ] * A[ l * N + m ];
+				mixture[ k ].covariance[ j * N + l ] = c;
+			}
+		}
+
+		const std::size_t nk = static_cast< std::size_t >( n * weights[ k ] );
+		for ( std::size_t i = 0; i < nk; i++ )
+		{
+			const Vector< T, N > z( randNormal() );
+			Vector< T, N > x;
+			for ( std::size_t j = 0; j < N; j++ )
+			{
+				x( j ) = mixture[ k ].mean[ j ];
+				for ( std::size_t l = 0; l < N; l++ )
+					x( j ) += A[ j * N + l ] * z( l );
+			}
+			points.push_back( x );
+		}
+	}
+}
+
+template< typename T, std::size_t N >
+void testGaussianMixtureEM( const std::size_t n, const T epsilon )
+{
+	typedef Stochastic::Weighted< Stochastic::Gaussian< T, N >, T > Component;
+	std::vector< Component > truth, mixture;
+	std::vector< Vector< T, N > > points;
+	generateMixture( n, truth, points );
+
+	// start from displaced means and unit covariances
+	mixture.resize( truth.size() );
+	for ( std::size_t k = 0; k < truth.size(); k++ )
+	{
+		mixture[ k ].weight = T( 1 ) / truth.size();
+		for ( std::size_t j = 0; j < N; j++ )
+		{
+			mixture[ k ].mean[ j ] = truth[ k ].mean[ j ] + T( 1 );
+			for ( std::size_t l = 0; l < N; l++ )
+				mixture[ k ].covariance[ j * N + l ] = j == l ? T( 1 ) : T( 0 );
+		}
+	}
+	const std::vector< Component > initial( mixture );
+
+	Stochastic::GaussianMixtureEM< T, N > em;
+	const T likelihood = em.estimate( points, mixture );
+	BOOST_CHECK( em.iterations() > 0 );
+	BOOST_CHECK( em.iterations() < 100 );
+
+	// the parameters are recovered
+	for ( std::size_t k = 0; k < truth.size(); k++ )
+	{
+		BOOST_CHECK_SMALL( mixture[ k ].weight - truth[ k ].weight, T( 0.01 ) );
+		for ( std::size_t j = 0; j < N; j++ )
+		{
+			BOOST_CHECK_SMALL( mixture[ k ].mean[ j ] - truth[ k ].mean[ j ], epsilon );
+			for ( std::size_t l = 0; l < N; l++ )
+				BOOST_CHECK_SMALL( mixture[ k ].covariance[ j * N + l ] - truth[ k ].covariance[ j * N + l ], 2 * epsilon );
+		}
+	}
+
+	// the log densities match the densities of the reference implementation
+	BOOST_REQUIRE_EQUAL( em.logDensities().size(), points.size() );
+	BOOST_CHECK_CLOSE( likelihood, Stochastic::log_likelihood< T >( mixture.begin(), mixture.end(), points.begin(), points.end() ), T( 0.01 ) );
+	{
+		std::vector< Stochastic::Probability< Component > > pdfs;
+		for ( std::size_t k = 0; k < mixture.size(); k++ )
+			pdfs.push_back( Stochastic::Probability< Component >( mixture[ k ] ) );
+		for ( std::size_t i = 0; i < points.size(); i += 97 )
+		{
+			T p( 0 );
+			for ( std::size_t k = 0; k < mixture.size(); k++ )
+				p += mixture[ k ].weight * pdfs[ k ]( points[ i ] );
+			BOOST_CHECK_SMALL( em.logDensities()[ i ] - std::log( p ), T( 1e-3 ) );
+		}
+	}
+
+	// evaluation does not change the mixture
+	const std::vector< Component > estimated( mixture );
+	BOOST_CHECK_CLOSE( em.evaluate( points, mixture ), likelihood, T( 1e-3 ) );
+	BOOST_CHECK_EQUAL( mixture[ 0 ].mean[ 0 ], estimated[ 0 ].mean[ 0 ] );
+
+	// samples far from all components still have a finite log density
+	std::vector< Vector< T, N > > outliers( 1, Vector< T, N >( Vector< T, N >::zeros() ) );
+	outliers[ 0 ]( 0 ) = T( 1000 );
+	const T outlierLikelihood = em.evaluate( outliers, mixture );
+	BOOST_CHECK( outlierLikelihood == outlierLikelihood );
+	BOOST_CHECK( outlierLikelihood < T( -1000 ) );
+	BOOST_CHECK( outlierLikelihood > -std::numeric_limits< T >::max() );
+
+	// the threaded estimation gives the same result
+	std::vector< Component > threaded( initial );
+	Stochastic::GaussianMixtureEM< T, N > emThreaded;
+	BOOST_CHECK_EQUAL( emThreaded.estimate( points, threaded, threadExecutor( 4, 1 ) ), likelihood );
+	BOOST_CHECK_EQUAL( emThreaded.iterations(), em.iterations() );
+	for ( std::size_t k = 0; k < truth.size(); k++ )
+	{
+		BOOST_CHECK_EQUAL( threaded[ k ].weight, mixture[ k ].weight );
+		for ( std::size_t j = 0; j < N; j++ )
+			BOOST_CHECK_EQUAL( threaded[ k ].mean[ j ], mixture[ k ].mean[ j ] );
+	}
+
+	// components without samples are switched off
+	std::vector< Component > withEmpty( estimated );
+	withEmpty.push_back( estimated[ 0 ] );
+	withEmpty.back().mean[ 0 ] = T( 1000 );
+	withEmpty.back().weight = T( 0.01 );
+	em.estimate( points, withEmpty );
+	BOOST_CHECK( withEmpty.back().weight < T( 1e-6 ) );
+
+	// invalid input
+	std::vector< Component > empty;
+	BOOST_CHECK_THROW( em.estimate( points, empty ), Ubitrack::Util::Exception );
+	std::vector< Component > zeroWeights( estimated );
+	for ( std::size_t k = 0; k < zeroWeights.size(); k++ )
+		zeroWeights[ k ].weight = 0;
+	BOOST_CHECK_THROW( em.evaluate( points, zeroWeights ), Ubitrack::Util::Exception );
+}
+
+} // anonymous namespace
+
+void TestGaussianMixtureEM()
+{
+	Random::seed( 42 );
+	testGaussianMixtureEM< double, 2 >( 20000, 0.05 );
+	testGaussianMixtureEM< double, 3 >( 20000, 0.05 );
+	testGaussianMixtureEM< float, 3 >( 20000, 0.05f );
+}
@@ -0,0 +1,118 @@
+#include <utMath/Blas1.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Stochastic/KMeansClustering.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+/** points around well separated centers on a grid with spacing 10 */
+template< typename T, std::size_t N >
+void generateBlobs( const std::size_t nCenters, const std::size_t n, std::vector< Vector< T, N > >& centers, std::vector< Vector< T, N > >& points )
+{
+	typename Random::Vector< T, N >::Normal randNoise( 0, 0.5 );
+	centers.clear();
+	for ( std::size_t k = 0; k < nCenters; k++ )
+	{
+		Vector< T, N > c( Vector< T, N >::zeros() );
+		c( 0 ) = T( 10 ) * ( k % 4 );
+		c( 1 ) = T( 10 ) * ( k / 4 );
+		centers.push_back( c );
+	}
+
+	points.clear();
+	for ( std::size_t i = 0; i < n; i++ )
+		points.push_back( centers[ i % nCenters ] + randNoise() );
+}
+
+/** distance from each center to the closest centroid */
+template< typename T, std::size_t N >
+T maxCenterError( const std::vector< Vector< T, N > >& centers, const std::vector< Vector< T, N > >& centroids )
+{
+	T maxError( 0 );
+	for ( std::size_t k = 0; k < centers.size(); k++ )
+	{
+		T error = std::numeric_limits< T >::max();
+		for ( std::size_t l = 0; l < centroids.size(); l++ )
+			error = std::min( error, T( boost::numeric::ublas::norm_2( centers[ k ] - centroids[ l ] ) ) );
+		maxError = std::max( maxError, error );
+	}
+	return maxError;
+}
+
+template< typename T, std::size_t N >
+void testKMeansClustering( const std::size_t n, const T epsilon )
+{
+	std::vector< Vector< T, N > > centers, points;
+	generateBlobs( 8, n, centers, points );
+
+	// well separated clusters are found
+	Random::seed( 42 );
+	Stochastic::KMeansClustering< T, N > kmeans( 8 );
+	const T inertia = kmeans.cluster( points );
+	BOOST_CHECK( kmeans.iterations() < 100 );
+	BOOST_CHECK_SMALL( maxCenterError( centers, kmeans.centroids() ), epsilon );
+	BOOST_REQUIRE_EQUAL( kmeans.indices().size(), n );
+
+	// every point belongs to the closest centroid, and the centroids are the means
+	T sum( 0 );
+	std::vector< Vector< T, N > > means( 8, Vector< T, N >::zeros() );
+	std::vector< std::size_t > counts( 8, 0 );
+	const std::vector< Vector< T, N > >& centroids( kmeans.centroids() );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const std::size_t a = kmeans.indices()[ i ];
+		const T d = boost::numeric::ublas::norm_2( points[ i ] - centroids[ a ] );
+		for ( std::size_t k = 0; k < 8; k++ )
+			BOOST_CHECK( d <= boost::numeric::ublas::norm_2( points[ i ] - centroids[ k ] ) * ( 1 + 1e-5 ) );
+		sum += d * d;
+		means[ a ] += points[ i ];
+		counts[ a ]++;
+	}
+	BOOST_CHECK_CLOSE( inertia, sum, 1e-2 );
+	for ( std::size_t k = 0; k < 8; k++ )
+		BOOST_CHECK_SMALL( T( boost::numeric::ublas::norm_2( means[ k ] / T( counts[ k ] ) - centroids[ k ] ) ), T( 1e-3 ) );
+
+	// the result does not depend on the executor
+	Random::seed( 42 );
+	Stochastic::KMeansClustering< T, N > threaded( 8 );
+	BOOST_CHECK_EQUAL( threaded.cluster( points, threadExecutor( 4, 1 ) ), inertia );
+	BOOST_CHECK( threaded.indices() == kmeans.indices() );
+	for ( std::size_t k = 0; k < 8; k++ )
+		BOOST_CHECK( threaded.centroids()[ k ] == centroids[ k ] );
+
+	// assignment of new points
+	std::vector< std::size_t > indices;
+	kmeans.assign( centers, indices );
+	for ( std::size_t k = 0; k < 8; k++ )
+		BOOST_CHECK_SMALL( T( boost::numeric::ublas::norm_2( centers[ k ] - centroids[ indices[ k ] ] ) ), epsilon );
+
+	// mini-batches of streaming data converge to the same centers
+	Random::seed( 42 );
+	Stochastic::KMeansClustering< T, N > streaming( 8 );
+	for ( std::size_t b = 0; b + 500 <= n; b += 500 )
+		streaming.miniBatchUpdate( std::vector< Vector< T, N > >( points.begin() + b, points.begin() + b + 500 ) );
+	BOOST_CHECK_SMALL( maxCenterError( centers, streaming.centroids() ), T( 4 ) * epsilon );
+
+	// warm start from known centroids needs a single update
+	Stochastic::KMeansClustering< T, N > warm( 8 );
+	warm.setCentroids( centroids );
+	BOOST_CHECK_CLOSE( warm.cluster( points ), inertia, 1e-2 );
+	BOOST_CHECK( warm.iterations() <= 2 );
+
+	BOOST_CHECK_THROW( warm.cluster( std::vector< Vector< T, N > >( points.begin(), points.begin() + 4 ) ), Ubitrack::Util::Exception );
+}
+
+} // anonymous namespace
+
+
+void TestKMeansClustering()
+{
+	testKMeansClustering< double, 3 >( 20000, 0.05 );
+	testKMeansClustering< float, 3 >( 20000, 0.05f );
+	testKMeansClustering< double, 2 >( 5000, 0.1 );
+}
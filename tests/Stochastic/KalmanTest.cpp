@@ -0,0 +1,262 @@
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Stochastic/Kalman.h>
+#include <utMath/Stochastic/KalmanUD.h>
+#include <utMath/Optimization/Function/LinearFunction.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+template< std::size_t N >
+Matrix< double, N, N > randomCovariance()
+{
+	typename Random::Vector< double, N >::Uniform randVector( -1, 1 );
+	Matrix< double, N, N > covariance( Matrix< double, N, N >::identity() * 0.1 );
+	for ( std::size_t k = 0; k < N; k++ )
+	{
+		const Vector< double, N > v( randVector() );
+		covariance += ublas::outer_prod( v, v );
+	}
+	return covariance;
+}
+
+template< std::size_t N, std::size_t M >
+void testMeasurementUpdate()
+{
+	typename Random::Vector< double, N >::Uniform randState( -1, 1 );
+	typename Random::Vector< double, M >::Uniform randMeas( -1, 1 );
+
+	Matrix< double, M, N > h;
+	for ( std::size_t r = 0; r < M; r++ )
+		for ( std::size_t c = 0; c < N; c++ )
+			h( r, c ) = Random::distribute_uniform< double >( -1, 1 );
+	const Optimization::Function::LinearFunction< M, N, double > mf( h );
+
+	const ErrorVector< double, N > prior( randState(), randomCovariance< N >() );
+	const ErrorVector< double, M > meas( randMeas(), randomCovariance< M >() );
+
+	// fixed-size joseph form against the generic update
+	ErrorVector< double, N > fixed( prior );
+	Stochastic::kalmanMeasurementUpdate< N, M >( fixed, mf, meas );
+	ErrorVector< double, N > generic( prior );
+	Stochastic::kalmanMeasurementUpdate( generic.value, generic.covariance, mf, meas.value, meas.covariance, 0, N );
+
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( fixed.value - generic.value ) ), 1e-9 );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( fixed.covariance - generic.covariance ) ), 1e-9 );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( fixed.covariance - ublas::trans( fixed.covariance ) ) ), 1e-15 );
+}
+
+template< std::size_t N, std::size_t M >
+void testMeasurementUpdateIdentity( const std::size_t iBegin )
+{
+	typename Random::Vector< double, N >::Uniform randState( -1, 1 );
+	typename Random::Vector< double, M >::Uniform randMeas( -1, 1 );
+
+	const ErrorVector< double, N > prior( randState(), randomCovariance< N >() );
+	const ErrorVector< double, M > meas( randMeas(), randomCovariance< M >() );
+
+	ErrorVector< double, N > fixed( prior );
+	Stochastic::kalmanMeasurementUpdateIdentity< N, M >( fixed, meas, iBegin, iBegin + M );
+	ErrorVector< double, N > generic( prior );
+	Stochastic::kalmanMeasurementUpdateIdentity( generic.value, generic.covariance, meas.value, meas.covariance, iBegin, iBegin + M );
+
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( fixed.value - generic.value ) ), 1e-9 );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( fixed.covariance - generic.covariance ) ), 1e-9 );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( fixed.covariance - ublas::trans( fixed.covariance ) ) ), 1e-15 );
+}
+
+template< std::size_t N, std::size_t M >
+void testUDFactors( const std::size_t iBegin )
+{
+	typename Random::Vector< double, N >::Uniform randState( -1, 1 );
+	typename Random::Vector< double, M >::Uniform randMeas( -1, 1 );
+
+	const ErrorVector< double, N > prior( randState(), randomCovariance< N >() );
+	const ErrorVector< double, M > meas( randMeas(), randomCovariance< M >() );
+
+	Matrix< double, N, N > ud;
+	Matrix< double, N, N > composed;
+	BOOST_CHECK( Stochastic::udFactorize( prior.covariance, ud ) );
+	Stochastic::udCompose( ud, composed );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( composed - prior.covariance ) ), 1e-12 );
+
+	// time update: A P A^T + diag( q ), with some zero noise elements
+	Matrix< double, N, N > a;
+	Vector< double, N > q;
+	for ( std::size_t r = 0; r < N; r++ )
+	{
+		for ( std::size_t c = 0; c < N; c++ )
+			a( r, c ) = Random::distribute_uniform< double >( -1, 1 );
+		q( r ) = r % 2 ? 0.0 : 0.1;
+	}
+	Matrix< double, N, N > expected( ublas::prod( Matrix< double, N, N >( ublas::prod( a, prior.covariance ) ), ublas::trans( a ) ) );
+	for ( std::size_t i = 0; i < N; i++ )
+		expected( i, i ) += q( i );
+	Stochastic::udTransform( ud, a, q );
+	Stochastic::udCompose( ud, composed );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( composed - expected ) / ublas::norm_inf( expected ) ), 1e-12 );
+
+	// measurement updates against the joseph form
+	Matrix< double, M, N > h;
+	for ( std::size_t r = 0; r < M; r++ )
+		for ( std::size_t c = 0; c < N; c++ )
+			h( r, c ) = Random::distribute_uniform< double >( -1, 1 );
+	const Optimization::Function::LinearFunction< M, N, double > mf( h );
+
+	ErrorVector< double, N > joseph( prior );
+	Stochastic::kalmanMeasurementUpdate( joseph.value, joseph.covariance, mf, meas.value, meas.covariance );
+	Vector< double, N > state( prior.value );
+	Stochastic::udFactorize( prior.covariance, ud );
+	Stochastic::kalmanMeasurementUpdateUD( state, ud, mf, meas.value, meas.covariance );
+	Stochastic::udCompose( ud, composed );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( state - joseph.value ) ), 1e-9 );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( composed - joseph.covariance ) ), 1e-9 );
+
+	joseph = prior;
+	Stochastic::kalmanMeasurementUpdateIdentity( joseph.value, joseph.covariance, meas.value, meas.covariance, iBegin );
+	state = prior.value;
+	Stochastic::udFactorize( prior.covariance, ud );
+	Stochastic::kalmanMeasurementUpdateIdentityUD( state, ud, meas.value, meas.covariance, iBegin );
+	Stochastic::udCompose( ud, composed );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( state - joseph.value ) ), 1e-9 );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( composed - joseph.covariance ) ), 1e-9 );
+
+	// the same update in single precision
+	Vector< float, N > stateF;
+	Matrix< float, N, N > udF;
+	Matrix< float, N, N > covF;
+	Vector< float, M > measF;
+	Matrix< float, M, M > measCovF;
+	for ( std::size_t r = 0; r < N; r++ )
+	{
+		stateF( r ) = float( prior.value( r ) );
+		for ( std::size_t c = 0; c < N; c++ )
+			covF( r, c ) = float( prior.covariance( r, c ) );
+	}
+	for ( std::size_t r = 0; r < M; r++ )
+	{
+		measF( r ) = float( meas.value( r ) );
+		for ( std::size_t c = 0; c < M; c++ )
+			measCovF( r, c ) = float( meas.covariance( r, c ) );
+	}
+	Stochastic::udFactorize( covF, udF );
+	Stochastic::kalmanMeasurementUpdateIdentityUD( stateF, udF, measF, measCovF, iBegin );
+	Stochastic::udCompose( udF, covF );
+	for ( std::size_t r = 0; r < N; r++ )
+	{
+		BOOST_CHECK_SMALL( stateF( r ) - joseph.value( r ), 1e-4 );
+		for ( std::size_t c = 0; c < N; c++ )
+			BOOST_CHECK_SMALL( covF( r, c ) - joseph.covariance( r, c ), 1e-4 );
+	}
+}
+
+template< std::size_t N, std::size_t M >
+void testInnovationGate( const std::size_t iBegin )
+{
+	typename Random::Vector< double, N >::Uniform randState( -1, 1 );
+	typename Random::Vector< double, M >::Uniform randMeas( -1, 1 );
+
+	const ErrorVector< double, N > prior( randState(), randomCovariance< N >() );
+	const ErrorVector< double, M > meas( randMeas(), randomCovariance< M >() );
+
+	// expected squared distance ( z - x_b )^T ( P_bb + R )^-1 ( z - x_b )
+	Matrix< double, M, M > s;
+	Vector< double, M > innovation;
+	for ( std::size_t r = 0; r < M; r++ )
+	{
+		innovation( r ) = meas.value( r ) - prior.value( iBegin + r );
+		for ( std::size_t c = 0; c < M; c++ )
+			s( r, c ) = prior.covariance( iBegin + r, iBegin + c ) + meas.covariance( r, c );
+	}
+	Vector< double, M > sInvInnovation( innovation );
+	BOOST_REQUIRE( choleskySolve( s, sInvInnovation ) );
+	const double d2 = ublas::inner_prod( innovation, sInvInnovation );
+
+	// a gate above the distance gives the ungated result, in all forms of the update
+	ErrorVector< double, N > ungated( prior );
+	Stochastic::kalmanMeasurementUpdateIdentity( ungated.value, ungated.covariance, meas.value, meas.covariance, iBegin );
+
+	Stochastic::InnovationGate gate( d2 * 1.01 );
+	ErrorVector< double, N > gated( prior );
+	BOOST_CHECK( Stochastic::kalmanMeasurementUpdateIdentity( gated.value, gated.covariance, meas.value, meas.covariance, iBegin, &gate ) );
+	BOOST_CHECK_CLOSE( gate.distance, d2, 1e-8 );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( gated.value - ungated.value ), 0.0 );
+
+	gate.distance = 0;
+	ErrorVector< double, N > generic( prior );
+	BOOST_CHECK( Stochastic::kalmanMeasurementUpdateIdentity( generic.value, generic.covariance, meas.value, meas.covariance, iBegin, iBegin + M, &gate ) );
+	BOOST_CHECK_CLOSE( gate.distance, d2, 1e-8 );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( generic.value - ungated.value ) ), 1e-9 );
+
+	Matrix< double, N, N > ud;
+	Stochastic::udFactorize( prior.covariance, ud );
+	Vector< double, N > state( prior.value );
+	gate.distance = 0;
+	BOOST_CHECK( Stochastic::kalmanMeasurementUpdateIdentityUD( state, ud, meas.value, meas.covariance, iBegin, &gate ) );
+	BOOST_CHECK_CLOSE( gate.distance, d2, 1e-8 );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( state - ungated.value ) ), 1e-9 );
+
+	// a gate below the distance leaves the state unchanged
+	Stochastic::InnovationGate closed( d2 * 0.99 );
+	gated = prior;
+	BOOST_CHECK( !Stochastic::kalmanMeasurementUpdateIdentity( gated.value, gated.covariance, meas.value, meas.covariance, iBegin, &closed ) );
+	BOOST_CHECK_CLOSE( closed.distance, d2, 1e-8 );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( gated.value - prior.value ), 0.0 );
+	BOOST_CHECK_EQUAL( double( ublas::norm_inf( gated.covariance - prior.covariance ) ), 0.0 );
+
+	generic = prior;
+	BOOST_CHECK( !Stochastic::kalmanMeasurementUpdateIdentity( generic.value, generic.covariance, meas.value, meas.covariance, iBegin, iBegin + M, &closed ) );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( generic.value - prior.value ), 0.0 );
+
+	Stochastic::udFactorize( prior.covariance, ud );
+	const Matrix< double, N, N > priorUD( ud );
+	state = prior.value;
+	BOOST_CHECK( !Stochastic::kalmanMeasurementUpdateIdentityUD( state, ud, meas.value, meas.covariance, iBegin, &closed ) );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( state - prior.value ), 0.0 );
+	BOOST_CHECK_EQUAL( double( ublas::norm_inf( ud - priorUD ) ), 0.0 );
+
+	// a measurement function over the whole state
+	Matrix< double, M, N > h( Matrix< double, M, N >::zeros() );
+	for ( std::size_t r = 0; r < M; r++ )
+		h( r, iBegin + r ) = 1;
+	const Optimization::Function::LinearFunction< M, N, double > mf( h );
+	gated = prior;
+	BOOST_CHECK( !Stochastic::kalmanMeasurementUpdate( gated.value, gated.covariance, mf, meas.value, meas.covariance, &closed ) );
+	BOOST_CHECK_CLOSE( closed.distance, d2, 1e-8 );
+	BOOST_CHECK( Stochastic::kalmanMeasurementUpdate( gated.value, gated.covariance, mf, meas.value, meas.covariance, &gate ) );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( gated.value - ungated.value ) ), 1e-9 );
+}
+
+} // anonymous namespace
+
+void TestKalman()
+{
+	for ( int i = 0; i < 20; i++ )
+	{
+		testMeasurementUpdate< 3, 3 >();
+		testMeasurementUpdate< 4, 4 >();
+		testMeasurementUpdate< 7, 3 >();
+		testMeasurementUpdateIdentity< 7, 4 >( 0 );
+		testMeasurementUpdateIdentity< 7, 3 >( 4 );
+		testMeasurementUpdateIdentity< 6, 2 >( 2 );
+		testUDFactors< 7, 4 >( 3 );
+		testUDFactors< 19, 7 >( 6 );
+		testInnovationGate< 7, 4 >( 3 );
+		testInnovationGate< 13, 3 >( 10 );
+	}
+
+	// chi-square thresholds
+	BOOST_CHECK_CLOSE( Stochastic::InnovationGate::chiSquare( 1, 0.95 ).threshold, 3.841459, 1e-4 );
+	BOOST_CHECK_CLOSE( Stochastic::InnovationGate::chiSquare( 3, 0.99 ).threshold, 11.344867, 1e-4 );
+	BOOST_CHECK( !( Stochastic::InnovationGate::chiSquare( 7, 0 ).threshold < std::numeric_limits< double >::infinity() ) );
+	Stochastic::InnovationGates gates;
+	BOOST_CHECK( gates.gate( 3 ) == 0 );
+	gates.setProbability( 0.99 );
+	BOOST_REQUIRE( gates.gate( 3 ) != 0 );
+	BOOST_CHECK_CLOSE( gates.gate( 3 )->threshold, 11.344867, 1e-4 );
+}
@@ -0,0 +1,75 @@
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Functors/MatrixFunctors.h>
+#include <utMath/Stochastic/MahalanobisDistance.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+
+namespace {
+
+template< typename T, std::size_t N >
+void testMahalanobisDistance( const std::size_t n, const T epsilon )
+{
+	// a random positive definite covariance
+	typename Random::Vector< T, N >::Uniform randVector( -1, 1 );
+	Matrix< T, N, N > covariance( Matrix< T, N, N >::identity() * T( 0.2 ) );
+	for ( std::size_t k = 0; k < N; k++ )
+	{
+		const Vector< T, N > v( randVector() );
+		covariance += boost::numeric::ublas::outer_prod( v, v );
+	}
+
+	Stochastic::Gaussian< T, N > gaussian;
+	const Vector< T, N > mean( randVector() );
+	for ( std::size_t i = 0; i < N; i++ )
+	{
+		gaussian.mean[ i ] = mean( i );
+		for ( std::size_t j = 0; j < N; j++ )
+			gaussian.covariance[ i * N + j ] = covariance( i, j );
+	}
+	const Matrix< T, N, N > inverse( Functors::matrix_inverse()( covariance ) );
+
+	std::vector< Vector< T, N > > points;
+	for ( std::size_t i = 0; i < n; i++ )
+		points.push_back( Vector< T, N >( randVector() * T( 3 ) ) );
+
+	const Stochastic::MahalanobisDistance< Stochastic::Gaussian< T, N > > distance( gaussian );
+	std::vector< T > squared;
+	distance.squaredDistances( points, squared );
+	BOOST_REQUIRE_EQUAL( squared.size(), n );
+	for ( std::size_t i = 0; i < n; i++ )
+	{
+		const Vector< T, N > d( points[ i ] - mean );
+		const Vector< T, N > id( boost::numeric::ublas::prod( inverse, d ) );
+		const T expected( boost::numeric::ublas::inner_prod( d, id ) );
+		BOOST_CHECK_SMALL( ( distance.squared( points[ i ] ) - expected ) / expected, epsilon );
+		BOOST_CHECK_SMALL( ( squared[ i ] - expected ) / expected, epsilon );
+		BOOST_CHECK_SMALL( distance( points[ i ] ) - std::sqrt( distance.squared( points[ i ] ) ), epsilon );
+	}
+
+	// the mean is copied
+	gaussian.mean[ 0 ] += 1;
+	BOOST_CHECK_SMALL( distance.squared( mean ), epsilon );
+}
+
+} // anonymous namespace
+
+
+void TestMahalanobisDistance()
+{
+	testMahalanobisDistance< double, 3 >( 150, 1e-10 );
+	testMahalanobisDistance< double, 4 >( 7, 1e-10 );
+	testMahalanobisDistance< float, 3 >( 150, 1e-3f );
+	testMahalanobisDistance< float, 2 >( 1, 1e-3f );
+
+	// a covariance that is not positive definite
+	Stochastic::Gaussian< double, 2 > gaussian;
+	const double indefinite[ 4 ] = { 1, 2, 2, 1 };
+	std::copy( indefinite, indefinite + 4, gaussian.covariance );
+	std::fill( gaussian.mean, gaussian.mean + 2, 0.0 );
+	typedef Stochastic::MahalanobisDistance< Stochastic::Gaussian< double, 2 > > DistanceType;
+	BOOST_CHECK_THROW( DistanceType distance( gaussian ), Ubitrack::Util::Exception );
+}
@@ -0,0 +1,120 @@
+#include <utMath/Blas1.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Stochastic/MonteCarloTransform.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** y = A x + b */
+struct AffineFunction
+{
+	Matrix< double, 2, 3 > A;
+	Vector< double, 2 > b;
+
+	void evaluate( Vector< double, 2 >& result, const Vector< double, 3 >& x ) const
+	{ result = ublas::prod( A, x ) + b; }
+};
+
+/** y = ( x0 x1, sin( x2 ) ) */
+struct NonlinearFunction
+{
+	void evaluate( Vector< double, 2 >& result, const Vector< double, 3 >& x ) const
+	{
+		result( 0 ) = x( 0 ) * x( 1 );
+		result( 1 ) = std::sin( x( 2 ) );
+	}
+};
+
+} // anonymous namespace
+
+void TestMonteCarloTransform()
+{
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+
+	// a random positive definite covariance
+	Matrix< double, 3, 3 > L( Matrix< double, 3, 3 >::zeros() );
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		const Vector< double, 3 > r( randVector() );
+		for ( std::size_t j = 0; j < i; j++ )
+			L( i, j ) = 0.3 * r( j );
+		L( i, i ) = 0.5 + 0.2 * i;
+	}
+	const Matrix< double, 3, 3 > P( ublas::prod( L, ublas::trans( L ) ) );
+	const Vector< double, 3 > mean( randVector() );
+
+	AffineFunction affine;
+	for ( std::size_t i = 0; i < 2; i++ )
+	{
+		const Vector< double, 3 > r( randVector() );
+		for ( std::size_t j = 0; j < 3; j++ )
+			affine.A( i, j ) = r( j );
+		affine.b( i ) = i + 1;
+	}
+
+	// without early stopping all samples are drawn, and the estimate approaches the exact result
+	typedef Stochastic::MonteCarloTransform< double, 3, 2 > Transform;
+	Transform::Parameters params;
+	params.maxSamples = 50000;
+	params.tolerance = 0;
+	params.seed = 7;
+	Transform mc( params );
+	Vector< double, 2 > resultMean;
+	Matrix< double, 2, 2 > resultCovariance;
+	BOOST_CHECK( !mc.transform( affine, mean, P, resultMean, resultCovariance ) );
+	BOOST_CHECK_EQUAL( mc.samples(), 50000u );
+
+	const Vector< double, 2 > expectedMean( ublas::prod( affine.A, mean ) + affine.b );
+	const Matrix< double, 2, 3 > AP( ublas::prod( affine.A, P ) );
+	const Matrix< double, 2, 2 > expectedCovariance( ublas::prod( AP, ublas::trans( affine.A ) ) );
+	const double scale = std::max( expectedCovariance( 0, 0 ), expectedCovariance( 1, 1 ) );
+	BOOST_CHECK_SMALL( ublas::norm_inf( resultMean - expectedMean ), 0.02 * std::sqrt( scale ) );
+	BOOST_CHECK_SMALL( double( ublas::norm_inf( resultCovariance - expectedCovariance ) ), 0.05 * scale );
+
+	// the result only depends on the seed, not on the executor
+	Vector< double, 2 > threadedMean;
+	Matrix< double, 2, 2 > threadedCovariance;
+	mc.transform( affine, mean, P, threadedMean, threadedCovariance, threadExecutor( 3, 1 ) );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( threadedMean - resultMean ), 0.0 );
+	BOOST_CHECK_EQUAL( double( ublas::norm_inf( threadedCovariance - resultCovariance ) ), 0.0 );
+
+	params.seed = 8;
+	Transform other( params );
+	other.transform( affine, mean, P, threadedMean, threadedCovariance );
+	BOOST_CHECK( ublas::norm_inf( threadedMean - resultMean ) > 0 );
+
+	// early stopping of a nonlinear function
+	Transform::Parameters stopping;
+	stopping.tolerance = 0.01;
+	Transform early( stopping );
+	NonlinearFunction nonlinear;
+	BOOST_CHECK( early.transform( nonlinear, mean, P, resultMean, resultCovariance, threadExecutor( 4, 1 ) ) );
+	BOOST_CHECK( early.converged() );
+	BOOST_CHECK( early.samples() >= stopping.minSamples && early.samples() < stopping.maxSamples );
+
+	// exact moments of the product of two Gaussian variables
+	const double m0 = mean( 0 ), m1 = mean( 1 );
+	const double expectedVariance = m0 * m0 * P( 1, 1 ) + m1 * m1 * P( 0, 0 ) + 2 * m0 * m1 * P( 0, 1 )
+		+ P( 0, 0 ) * P( 1, 1 ) + P( 0, 1 ) * P( 0, 1 );
+	BOOST_CHECK_SMALL( resultMean( 0 ) - ( m0 * m1 + P( 0, 1 ) ), 0.05 * std::sqrt( expectedVariance ) );
+	BOOST_CHECK_CLOSE( resultCovariance( 0, 0 ), expectedVariance, 10.0 );
+
+	// ErrorVector overload, with a singular covariance
+	Matrix< double, 3, 3 > singular( Matrix< double, 3, 3 >::zeros() );
+	singular( 0, 0 ) = 1;
+	const ErrorVector< double, 2 > ev( early.transform( affine, ErrorVector< double, 3 >( mean, singular ) ) );
+	BOOST_CHECK_SMALL( ublas::norm_inf( ev.value - expectedMean ), 0.05 );
+	BOOST_CHECK_CLOSE( ev.covariance( 1, 1 ), affine.A( 1, 0 ) * affine.A( 1, 0 ), 5.0 );
+
+	// invalid input
+	Matrix< double, 3, 3 > indefinite( P );
+	indefinite( 2, 2 ) = -1;
+	BOOST_CHECK_THROW( mc.transform( affine, mean, indefinite, resultMean, resultCovariance ), Ubitrack::Util::Exception );
+	params.batchSize = 0;
+	BOOST_CHECK_THROW( ( Transform( params ) ), Ubitrack::Util::Exception );
+}
@@ -2,7 +2,18 @@
 
 // declare external tests here, to save us some trivial header files
 void TestKMeans();
+void TestKMeansClustering();
 void TestExpectationMaximization();
+void TestGaussianMixtureEM();
+void TestGaussianAccumulator();
+void TestAverage();
+void TestUnscentedTransform();
+void TestMonteCarloTransform();
+void TestCovarianceTransform();
+void TestBackwardPropagation();
+void TestMahalanobisDistance();
+void TestCrossCorrelation();
+void TestKalman();
 
 
 
@@ -10,5 +21,16 @@ StochasticTest::StochasticTest()
 	: boost::unit_test::test_suite( "StochasticTests" )
 {
 	add( BOOST_TEST_CASE( &TestKMeans ) );
+	add( BOOST_TEST_CASE( &TestKMeansClustering ) );
 	add( BOOST_TEST_CASE( &TestExpectationMaximization ) );
+	add( BOOST_TEST_CASE( &TestGaussianMixtureEM ) );
+	add( BOOST_TEST_CASE( &TestGaussianAccumulator ) );
+	add( BOOST_TEST_CASE( &TestAverage ) );
+	add( BOOST_TEST_CASE( &TestUnscentedTransform ) );
+	add( BOOST_TEST_CASE( &TestMonteCarloTransform ) );
+	add( BOOST_TEST_CASE( &TestCovarianceTransform ) );
+	add( BOOST_TEST_CASE( &TestBackwardPropagation ) );
+	add( BOOST_TEST_CASE( &TestMahalanobisDistance ) );
+	add( BOOST_TEST_CASE( &TestCrossCorrelation ) );
+	add( BOOST_TEST_CASE( &TestKalman ) );
 }
@@ -0,0 +1,145 @@
+#include <utMath/Blas1.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Random/Vector.h>
+#include <utMath/Stochastic/UnscentedTransform.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack::Math;
+namespace ublas = boost::numeric::ublas;
+
+namespace {
+
+/** y = A x + b */
+struct AffineFunction
+{
+	Matrix< double, 2, 3 > A;
+	Vector< double, 2 > b;
+
+	void evaluate( Vector< double, 2 >& result, const Vector< double, 3 >& x ) const
+	{ result = ublas::prod( A, x ) + b; }
+
+	void evaluateBatch( std::vector< Vector< double, 2 > >& results, const std::vector< Vector< double, 3 > >& points ) const
+	{
+		results.resize( points.size() );
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			evaluate( results[ i ], points[ i ] );
+	}
+};
+
+/** y = ( x^T x, x0 x1, sin( x2 ) ) */
+struct QuadraticFunction
+{
+	void evaluate( Vector< double, 3 >& result, const Vector< double, 3 >& x ) const
+	{
+		result( 0 ) = ublas::inner_prod( x, x );
+		result( 1 ) = x( 0 ) * x( 1 );
+		result( 2 ) = std::sin( x( 2 ) );
+	}
+
+	void evaluateBatch( std::vector< Vector< double, 3 > >& results, const std::vector< Vector< double, 3 > >& points ) const
+	{
+		results.resize( points.size() );
+		for ( std::size_t i = 0; i < points.size(); i++ )
+			evaluate( results[ i ], points[ i ] );
+	}
+};
+
+double maxDifference( const Matrix< double, 3, 3 >& a, const Matrix< double, 3, 3 >& b )
+{ return ublas::norm_inf( a - b ); }
+
+} // anonymous namespace
+
+void TestUnscentedTransform()
+{
+	Random::Vector< double, 3 >::Uniform randVector( -1, 1 );
+
+	// a random positive definite covariance
+	Matrix< double, 3, 3 > L( Matrix< double, 3, 3 >::zeros() );
+	for ( std::size_t i = 0; i < 3; i++ )
+	{
+		const Vector< double, 3 > r( randVector() );
+		for ( std::size_t j = 0; j < i; j++ )
+			L( i, j ) = 0.3 * r( j );
+		L( i, i ) = 0.5 + 0.2 * i;
+	}
+	const Matrix< double, 3, 3 > P( ublas::prod( L, ublas::trans( L ) ) );
+	const Vector< double, 3 > mean( randVector() );
+
+	// affine functions are transformed exactly, for any spread
+	AffineFunction affine;
+	for ( std::size_t i = 0; i < 2; i++ )
+	{
+		const Vector< double, 3 > r( randVector() );
+		for ( std::size_t j = 0; j < 3; j++ )
+			affine.A( i, j ) = r( j );
+		affine.b( i ) = i + 1;
+	}
+	const double alphas[ 3 ] = { 1, 0.5, 1e-2 };
+	for ( std::size_t a = 0; a < 3; a++ )
+	{
+		Stochastic::UnscentedTransform< double, 3, 2 > ut( alphas[ a ] );
+		Vector< double, 2 > resultMean;
+		Matrix< double, 2, 2 > resultCovariance;
+		ut.transform( affine, mean, P, resultMean, resultCovariance );
+
+		const Vector< double, 2 > expectedMean( ublas::prod( affine.A, mean ) + affine.b );
+		const Matrix< double, 2, 3 > AP( ublas::prod( affine.A, P ) );
+		const Matrix< double, 2, 2 > expectedCovariance( ublas::prod( AP, ublas::trans( affine.A ) ) );
+		BOOST_CHECK_SMALL( ublas::norm_inf( resultMean - expectedMean ), 1e-9 );
+		BOOST_CHECK_SMALL( double( ublas::norm_inf( resultCovariance - expectedCovariance ) ), 1e-6 );
+		BOOST_CHECK_SMALL( double( ublas::norm_inf( ut.crossCovariance() - ublas::trans( AP ) ) ), 1e-6 );
+	}
+
+	// the sigma points have the input mean and covariance
+	Stochastic::UnscentedTransform< double, 3, 3 > ut;
+	const std::vector< Vector< double, 3 > >& points( ut.sigmaPoints( mean, P ) );
+	BOOST_REQUIRE_EQUAL( points.size(), 7u );
+	BOOST_CHECK_SMALL( ublas::norm_inf( points[ 0 ] - mean ), 1e-12 );
+	Matrix< double, 3, 3 > spread( Matrix< double, 3, 3 >::zeros() );
+	for ( std::size_t i = 1; i < points.size(); i++ )
+	{
+		const Vector< double, 3 > d( points[ i ] - mean );
+		spread += outer_product( d, d );
+	}
+	BOOST_CHECK_SMALL( maxDifference( spread / 6.0, P ), 1e-9 );
+
+	// the mean of a quadratic function is exact
+	QuadraticFunction quadratic;
+	Vector< double, 3 > resultMean;
+	Matrix< double, 3, 3 > resultCovariance;
+	ut.transform( quadratic, mean, P, resultMean, resultCovariance );
+	BOOST_CHECK_CLOSE( resultMean( 0 ), P( 0, 0 ) + P( 1, 1 ) + P( 2, 2 ) + ublas::inner_prod( mean, mean ), 1e-9 );
+	BOOST_CHECK_CLOSE( resultMean( 1 ), P( 0, 1 ) + mean( 0 ) * mean( 1 ), 1e-9 );
+
+	// the factorization is reused for the same covariance
+	const std::size_t nFactorizations = ut.factorizations();
+	Vector< double, 3 > otherMean;
+	Matrix< double, 3, 3 > otherCovariance;
+	ut.transform( quadratic, randVector(), P, otherMean, otherCovariance );
+	BOOST_CHECK_EQUAL( ut.factorizations(), nFactorizations );
+	ut.transform( quadratic, mean, P * 2.0, otherMean, otherCovariance );
+	BOOST_CHECK_EQUAL( ut.factorizations(), nFactorizations + 1 );
+
+	// single point evaluation, also in several threads, gives the same result
+	Vector< double, 3 > eachMean, threadedMean;
+	Matrix< double, 3, 3 > eachCovariance, threadedCovariance;
+	ut.transformEach( quadratic, mean, P, eachMean, eachCovariance );
+	ut.transformEach( quadratic, mean, P, threadedMean, threadedCovariance, threadExecutor( 3, 1 ) );
+	ut.transform( quadratic, mean, P, resultMean, resultCovariance );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( eachMean - resultMean ), 0.0 );
+	BOOST_CHECK_EQUAL( maxDifference( eachCovariance, resultCovariance ), 0.0 );
+	BOOST_CHECK_EQUAL( ublas::norm_inf( threadedMean - resultMean ), 0.0 );
+	BOOST_CHECK_EQUAL( maxDifference( threadedCovariance, resultCovariance ), 0.0 );
+
+	// ErrorVector overload
+	Stochastic::UnscentedTransform< double, 3, 2 > affineTransform;
+	const ErrorVector< double, 2 > ev( affineTransform.transform( affine, ErrorVector< double, 3 >( mean, P ) ) );
+	BOOST_CHECK_SMALL( ublas::norm_inf( ev.value - ( ublas::prod( affine.A, mean ) + affine.b ) ), 1e-9 );
+
+	// invalid input
+	BOOST_CHECK_THROW( ut.sigmaPoints( mean, Matrix< double, 3, 3 >::zeros() ), Ubitrack::Util::Exception );
+	typedef Stochastic::UnscentedTransform< double, 3, 3 > Transform;
+	BOOST_CHECK_THROW( Transform( 1, 2, -3 ), Ubitrack::Util::Exception );
+}
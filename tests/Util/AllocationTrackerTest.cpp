@@ -0,0 +1,74 @@
+#include <utUtil/AllocationTracker.h>
+#include <utUtil/TimerRegistry.h>
+#include <utMath/Matrix.h>
+#include <utMeasurement/Measurement.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+const Util::AllocationStatistics& statistics( const std::vector< Util::AllocationStatistics >& stats, Util::AllocationTracker::Category category )
+{
+	BOOST_REQUIRE_EQUAL( stats.size(), std::size_t( Util::AllocationTracker::CategoryCount ) );
+	return stats[ category ];
+}
+
+} // anonymous namespace
+
+
+void TestAllocationTracker()
+{
+	typedef Util::AllocationTracker Tracker;
+	BOOST_CHECK_EQUAL( std::string( Tracker::name( Tracker::SerializerBuffer ) ), "serializer_buffer" );
+
+	// the allocator counts wherever it is used
+	Tracker::reset();
+	const Util::AllocationStatistics before( statistics( Tracker::snapshot(), Tracker::SerializerBuffer ) );
+	{
+		std::vector< double, Util::TrackingAllocator< double, Tracker::SerializerBuffer > > v( 100 );
+		const Util::AllocationStatistics s( statistics( Tracker::snapshot(), Tracker::SerializerBuffer ) );
+		BOOST_CHECK_EQUAL( s.allocations, before.allocations + 1 );
+		BOOST_CHECK_EQUAL( s.bytes, before.bytes + 100 * sizeof( double ) );
+		BOOST_CHECK_EQUAL( s.liveBytes, before.liveBytes + 100 * sizeof( double ) );
+		BOOST_CHECK( s.peakBytes >= s.liveBytes );
+	}
+	const Util::AllocationStatistics after( statistics( Tracker::snapshot(), Tracker::SerializerBuffer ) );
+	BOOST_CHECK_EQUAL( after.deallocations, before.deallocations + 1 );
+	BOOST_CHECK_EQUAL( after.liveBytes, before.liveBytes );
+	BOOST_CHECK( after.peakBytes >= before.liveBytes + 100 * sizeof( double ) );
+
+	// the reset keeps the live bytes
+	Tracker::reset();
+	const Util::AllocationStatistics reset( statistics( Tracker::snapshot(), Tracker::SerializerBuffer ) );
+	BOOST_CHECK_EQUAL( reset.allocations, 0u );
+	BOOST_CHECK_EQUAL( reset.peakBytes, reset.liveBytes );
+
+	// the library containers are only counted with UBITRACK_TRACK_ALLOCATIONS
+	{
+		Math::Matrix< double > m( 20, 30 );
+		Measurement::Pose pose( 1, Math::Pose() );
+		const std::vector< Util::AllocationStatistics > stats( Util::TimerRegistry::instance().allocationSnapshot() );
+		if ( Tracker::enabled() )
+		{
+			BOOST_CHECK( statistics( stats, Tracker::MathStorage ).liveBytes >= 20 * 30 * sizeof( double ) );
+			BOOST_CHECK( statistics( stats, Tracker::MeasurementPayload ).allocations >= 1u );
+		}
+		else
+		{
+			BOOST_CHECK_EQUAL( statistics( stats, Tracker::MathStorage ).allocations, 0u );
+			BOOST_CHECK_EQUAL( statistics( stats, Tracker::MeasurementPayload ).allocations, 0u );
+		}
+	}
+
+	// one line per category
+	const std::string report( Util::TimerRegistry::format( Tracker::snapshot(), Util::TimerRegistry::JsonLines ) );
+	BOOST_CHECK( report.find( "\"allocations\":\"math_storage\"" ) != std::string::npos );
+	BOOST_CHECK( report.find( "\"live_bytes\":" ) != std::string::npos );
+	const std::string statsd( Util::TimerRegistry::format( Tracker::snapshot(), Util::TimerRegistry::Statsd ) );
+	BOOST_CHECK( statsd.find( "allocations.measurement_payload.bytes:" ) != std::string::npos );
+}
@@ -0,0 +1,154 @@
+#include <utUtil/AsyncAppender.h>
+#include <utUtil/Logging.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <log4cpp/Category.hh>
+#include <log4cpp/PatternLayout.hh>
+#include <log4cpp/StringQueueAppender.hh>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** target that holds the writer thread until it is released */
+class GateAppender
+	: public log4cpp::StringQueueAppender
+{
+public:
+	GateAppender()
+		: log4cpp::StringQueueAppender( "gate" )
+		, m_open( false )
+	{}
+
+	void open()
+	{
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_open = true;
+		m_changed.notify_all();
+	}
+
+protected:
+	virtual void _append( const log4cpp::LoggingEvent& event )
+	{
+		{
+			boost::mutex::scoped_lock lock( m_mutex );
+			while ( !m_open )
+				m_changed.wait( lock );
+		}
+		log4cpp::StringQueueAppender::_append( event );
+	}
+
+	bool m_open;
+	boost::mutex m_mutex;
+	boost::condition_variable m_changed;
+};
+
+void logMessages( log4cpp::Appender& appender, const int thread, const int n )
+{
+	for ( int i = 0; i < n; i++ )
+		appender.doAppend( log4cpp::LoggingEvent( "Test", std::string( 1, char( 'a' + thread ) ), "", log4cpp::Priority::INFO ) );
+}
+
+std::size_t countLines( const char* name )
+{
+	std::ifstream in( name );
+	std::size_t n = 0;
+	std::string line;
+	while ( std::getline( in, line ) )
+		n++;
+	return n;
+}
+
+} // anonymous namespace
+
+
+void TestAsyncAppender()
+{
+	// no event is lost when the loggers wait for the writer
+	{
+		log4cpp::StringQueueAppender target( "target" );
+		log4cpp::PatternLayout* layout = new log4cpp::PatternLayout();
+		layout->setConversionPattern( "%m" );
+		target.setLayout( layout );
+		Util::AsyncAppender async( "async", target, 64, Util::AsyncAppender::BlockWhenFull );
+		BOOST_CHECK_EQUAL( async.capacity(), 64u );
+
+		boost::thread_group threads;
+		for ( int t = 0; t < 4; t++ )
+			threads.create_thread( boost::bind( &logMessages, boost::ref( async ), t, 2000 ) );
+		threads.join_all();
+		async.flush();
+
+		BOOST_CHECK_EQUAL( target.queueSize(), 8000u );
+		BOOST_CHECK_EQUAL( async.droppedCount(), 0u );
+
+		// the events of each thread stay in order, and keep their content
+		std::size_t perThread[ 4 ] = { 0, 0, 0, 0 };
+		while ( !target.getQueue().empty() )
+		{
+			const std::string& message = target.getQueue().front();
+			BOOST_REQUIRE( message.size() > 0 && message[ 0 ] >= 'a' && message[ 0 ] < 'e' );
+			perThread[ message[ 0 ] - 'a' ]++;
+			target.getQueue().pop();
+		}
+		for ( int t = 0; t < 4; t++ )
+			BOOST_CHECK_EQUAL( perThread[ t ], 2000u );
+
+		// after closing, events are written directly
+		async.close();
+		logMessages( async, 0, 3 );
+		BOOST_CHECK_EQUAL( target.queueSize(), 3u );
+	}
+
+	// a full queue drops events instead of blocking
+	{
+		GateAppender target;
+		Util::AsyncAppender async( "async", target, 16 );
+		logMessages( async, 0, 100 );
+		BOOST_CHECK( async.droppedCount() >= 100u - 17u );
+
+		target.open();
+		async.flush();
+		BOOST_CHECK_EQUAL( target.queueSize() + async.droppedCount(), 100u );
+	}
+
+	// installed from the configuration file
+	log4cpp::Category& root = log4cpp::Category::getRoot();
+	const log4cpp::Priority::Value rootPriority = root.getPriority();
+	{
+		std::ofstream config( "AsyncAppenderTest.conf" );
+		config << "log4cpp.rootCategory=INFO, file\n"
+			<< "log4cpp.appender.file=FileAppender\n"
+			<< "log4cpp.appender.file.fileName=AsyncAppenderTest.log\n"
+			<< "log4cpp.appender.file.append=false\n"
+			<< "log4cpp.appender.file.layout=SimpleLayout\n"
+			<< "ubitrack.async=true\n"
+			<< "ubitrack.async.queueSize=1024\n"
+			<< "ubitrack.async.policy=block\n";
+	}
+	Util::initLogging( "AsyncAppenderTest.conf" );
+
+	Util::AsyncAppender* async = dynamic_cast< Util::AsyncAppender* >( root.getAppender() );
+	BOOST_REQUIRE( async != 0 );
+	BOOST_CHECK_EQUAL( async->capacity(), 1024u );
+	BOOST_CHECK( async->policy() == Util::AsyncAppender::BlockWhenFull );
+	BOOST_CHECK_EQUAL( async->target().getName(), "file" );
+
+	log4cpp::Category& category = log4cpp::Category::getInstance( "Ubitrack.Test.Async" );
+	for ( int i = 0; i < 5000; i++ )
+		category.info( "message %d", i );
+	Util::flushLogging();
+	BOOST_CHECK_EQUAL( countLines( "AsyncAppenderTest.log" ), 5000u );
+
+	root.removeAllAppenders();
+	root.setPriority( rootPriority );
+	std::remove( "AsyncAppenderTest.conf" );
+	std::remove( "AsyncAppenderTest.log" );
+}
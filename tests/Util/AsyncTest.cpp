@@ -0,0 +1,137 @@
+#include <utUtil/Async.h>
+#include <utUtil/Exception.h>
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/// reports n iterations
+int countDown( const int n )
+{
+	for ( int i = 0; i <= n; i++ )
+		Util::reportProgress( "countDown", i, n - i );
+	return n;
+}
+
+/// runs until it is cancelled
+int untilCancelled( boost::atomic< bool >* pStarted )
+{
+	*pStarted = true;
+	while ( true )
+	{
+		Util::checkCancellation();
+		boost::this_thread::yield();
+	}
+}
+
+int failing()
+{
+	UBITRACK_THROW( "failing operation" );
+}
+
+void storeRecord( std::vector< Util::ProgressRecord >* pRecords, const Util::ProgressRecord& record )
+{
+	pRecords->push_back( record );
+}
+
+void cancelAfter( Util::CancellationToken token, const std::size_t iteration, const Util::ProgressRecord& record )
+{
+	if ( record.iteration >= iteration )
+		token.cancel();
+}
+
+void storeContext( bool* pEmpty )
+{
+	*pEmpty = Util::ProgressContext::current().empty();
+}
+
+} // anonymous namespace
+
+
+void TestAsync()
+{
+	// without a scope nothing is reported or checked
+	BOOST_CHECK( Util::ProgressContext::current().empty() );
+	Util::reportProgress( "nothing", 0, 0 );
+	Util::checkCancellation();
+
+	// scopes nest
+	std::vector< Util::ProgressRecord > records;
+	Util::CancellationToken outerToken;
+	{
+		Util::ProgressScope outer( Util::ProgressContext( outerToken, boost::bind( &storeRecord, &records, _1 ) ) );
+		BOOST_CHECK( Util::ProgressScope::anyActive() );
+		countDown( 2 );
+		{
+			Util::ProgressScope hidden;
+			countDown( 5 );
+		}
+		BOOST_REQUIRE_EQUAL( records.size(), 3u );
+		BOOST_CHECK_EQUAL( records[ 0 ].residual, 2.0 );
+		BOOST_CHECK_EQUAL( records[ 2 ].iteration, 2u );
+		BOOST_CHECK_EQUAL( std::string( records[ 2 ].algorithm ), "countDown" );
+
+		// tasks of an executor do not see the context of the thread executing them
+		Util::Executor inlineExecutor( 1 );
+		Util::TaskGroup group( inlineExecutor );
+		bool bEmpty = false;
+		group.run( boost::bind( &storeContext, &bEmpty ) );
+		group.wait();
+		BOOST_CHECK( bEmpty );
+
+		outerToken.cancel();
+		BOOST_CHECK_THROW( Util::checkCancellation(), Util::OperationCancelled );
+		BOOST_CHECK_THROW( countDown( 1 ), Util::OperationCancelled );
+	}
+	BOOST_CHECK( !Util::ProgressScope::anyActive() );
+	Util::checkCancellation();
+
+	Util::Executor executor( 3 );
+
+	// results, progress and exceptions
+	records.clear();
+	Util::Future< int > result( Util::async< int >( boost::bind( &countDown, 10 ), Util::CancellationToken(),
+		boost::bind( &storeRecord, &records, _1 ), executor ) );
+	BOOST_CHECK( result.valid() );
+	BOOST_CHECK_EQUAL( result.get(), 10 );
+	BOOST_CHECK( result.ready() );
+	BOOST_CHECK_EQUAL( records.size(), 11u );
+	BOOST_CHECK_EQUAL( records.back().residual, 0.0 );
+	BOOST_CHECK( !Util::Future< int >().valid() );
+
+	Util::Future< int > error( Util::async< int >( &failing, Util::CancellationToken(), Util::ProgressCallback(), executor ) );
+	BOOST_CHECK_THROW( error.get(), Util::Exception );
+	BOOST_CHECK_THROW( error.get(), Util::Exception );
+
+	// cancelled while running
+	boost::atomic< bool > bStarted( false );
+	Util::Future< int > running( Util::async< int >( boost::bind( &untilCancelled, &bStarted ), Util::CancellationToken(),
+		Util::ProgressCallback(), executor ) );
+	while ( !bStarted )
+		boost::this_thread::yield();
+	BOOST_CHECK( !running.ready() );
+	running.cancel();
+	BOOST_CHECK_THROW( running.get(), Util::OperationCancelled );
+	BOOST_CHECK( running.token().cancelled() );
+
+	// cancelled before it started
+	Util::CancellationToken cancelled;
+	cancelled.cancel();
+	bStarted = false;
+	Util::Future< int > never( Util::async< int >( boost::bind( &untilCancelled, &bStarted ), cancelled, Util::ProgressCallback(), executor ) );
+	BOOST_CHECK_THROW( never.get(), Util::OperationCancelled );
+	BOOST_CHECK( !bStarted );
+
+	// cancelled by the progress callback
+	Util::CancellationToken token;
+	Util::Future< int > stopped( Util::async< int >( boost::bind( &countDown, 100 ), token,
+		boost::bind( &cancelAfter, token, 5, _1 ), executor ) );
+	BOOST_CHECK_THROW( stopped.get(), Util::OperationCancelled );
+}
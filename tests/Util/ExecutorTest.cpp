@@ -0,0 +1,138 @@
+#include <utUtil/Executor.h>
+#include <utUtil/Exception.h>
+#include <utUtil/OS.h>
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/atomic.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+void markRange( std::vector< int >* marks, const std::size_t begin, const std::size_t end )
+{
+	for ( std::size_t i = begin; i < end; i++ )
+		( *marks )[ i ]++;
+}
+
+/// parallel loops within parallel loops
+void nestedRange( Util::Executor* executor, std::vector< int >* marks, const std::size_t begin, const std::size_t end )
+{
+	for ( std::size_t i = begin; i < end; i++ )
+		executor->parallelFor( i * 100, ( i + 1 ) * 100, 7, boost::bind( &markRange, marks, _1, _2 ) );
+}
+
+double sumRange( const std::size_t begin, const std::size_t end )
+{
+	double sum = 0.0;
+	for ( std::size_t i = begin; i < end; i++ )
+		sum += 1.0 / ( i + 1 );
+	return sum;
+}
+
+void count( boost::atomic< int >* counter )
+{
+	( *counter )++;
+}
+
+void fail()
+{
+	throw std::runtime_error( "task failed" );
+}
+
+void testExecutor( Util::Executor& executor )
+{
+	// every index exactly once
+	std::vector< int > marks( 10007, 0 );
+	executor.parallelFor( 0, marks.size(), 64, boost::bind( &markRange, &marks, _1, _2 ) );
+	BOOST_CHECK( std::count( marks.begin(), marks.end(), 1 ) == std::ptrdiff_t( marks.size() ) );
+
+	std::vector< int > nested( 100 * 100, 0 );
+	executor.parallelFor( 0, 100, 3, boost::bind( &nestedRange, &executor, &nested, _1, _2 ) );
+	BOOST_CHECK( std::count( nested.begin(), nested.end(), 1 ) == std::ptrdiff_t( nested.size() ) );
+
+	// empty ranges
+	executor.parallelFor( 5, 5, 1, boost::bind( &markRange, &marks, _1, _2 ) );
+	BOOST_CHECK_EQUAL( executor.parallelReduce( 3, 3, 1, 2.5, &sumRange, std::plus< double >() ), 2.5 );
+
+	// exceptions are passed to the caller
+	BOOST_CHECK_THROW( executor.parallelFor( 0, 1000, 1, boost::bind( &fail ) ), std::runtime_error );
+
+	// sharding by NUMA node covers every index exactly once, too
+	BOOST_CHECK( executor.nodeCount() >= 1 );
+	std::vector< int > shards( 10007, 0 );
+	executor.parallelForNodes( 0, shards.size(), 64, boost::bind( &markRange, &shards, _1, _2 ) );
+	BOOST_CHECK( std::count( shards.begin(), shards.end(), 1 ) == std::ptrdiff_t( shards.size() ) );
+
+	// task groups
+	boost::atomic< int > counter( 0 );
+	{
+		Util::TaskGroup group( executor );
+		for ( int i = 0; i < 100; i++ )
+			group.run( boost::bind( &count, &counter ) );
+		group.wait();
+		BOOST_CHECK_EQUAL( counter.load(), 100 );
+		BOOST_CHECK( !group.cancelled() );
+	}
+	{
+		// tasks for nodes without workers run anyway
+		boost::atomic< int > pinned( 0 );
+		Util::TaskGroup group( executor );
+		for ( unsigned node = 0; node < 4; node++ )
+			group.runOnNode( node, boost::bind( &count, &pinned ) );
+		group.wait();
+		BOOST_CHECK_EQUAL( pinned.load(), 4 );
+	}
+	{
+		Util::TaskGroup group( executor );
+		group.cancel();
+		group.run( boost::bind( &count, &counter ) );
+		group.wait();
+		BOOST_CHECK_EQUAL( counter.load(), 100 );
+	}
+	{
+		Util::TaskGroup group( executor );
+		group.run( boost::bind( &fail ) );
+		BOOST_CHECK_THROW( group.wait(), std::runtime_error );
+		BOOST_CHECK( group.cancelled() );
+		// the exception is only thrown once
+		group.wait();
+	}
+}
+
+} // anonymous namespace
+
+
+void TestExecutor()
+{
+	Util::Executor parallel( 4 );
+	BOOST_CHECK_EQUAL( parallel.concurrency(), 4u );
+	BOOST_CHECK( !parallel.isInline() );
+	testExecutor( parallel );
+
+	// workers bound to CPUs belong to their NUMA node
+	Util::Executor bound( 3, std::vector< unsigned >( 1, 0 ) );
+	BOOST_CHECK_EQUAL( bound.nodeCount(), Util::numaNodeOfCpu( 0 ) + 1 );
+	testExecutor( bound );
+
+	Util::Executor inlined( 1 );
+	BOOST_CHECK( inlined.isInline() );
+	testExecutor( inlined );
+
+	// the reduction does not depend on the number of threads
+	const double a = parallel.parallelReduce( 0, 100000, 1000, 0.0, &sumRange, std::plus< double >() );
+	const double b = inlined.parallelReduce( 0, 100000, 1000, 0.0, &sumRange, std::plus< double >() );
+	BOOST_CHECK_EQUAL( a, b );
+	BOOST_CHECK_CLOSE( a, sumRange( 0, 100000 ), 1e-10 );
+
+	// the process executor can only be configured before its first use
+	Util::Executor::instance();
+	BOOST_CHECK_THROW( Util::Executor::configureInstance( 2 ), Util::Exception );
+}
@@ -0,0 +1,182 @@
+#include <utUtil/FlightRecorder.h>
+#include <utUtil/BlockTimer.h>
+#include <utUtil/TraceSpan.h>
+#include <utUtil/Exception.h>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+void recordMany( unsigned n )
+{
+	for ( unsigned i = 0; i < n; i++ )
+		Util::FlightRecorder::record( 'i', "flight_test_many", "index", i );
+}
+
+void span()
+{
+	UBITRACK_TRACE_SPAN( "flight_test_span", 5 );
+	UBITRACK_TRACE_SPAN_SET( 1, 7 );
+}
+
+std::vector< Util::FlightRecorder::Event > eventsNamed( const char* name )
+{
+	std::vector< Util::FlightRecorder::Event > result;
+	const std::vector< Util::FlightRecorder::Event > events( Util::FlightRecorder::snapshot() );
+	for ( std::size_t i = 0; i < events.size(); i++ )
+		if ( !std::strcmp( events[ i ].record.name, name ) )
+			result.push_back( events[ i ] );
+	return result;
+}
+
+std::size_t countFiles( const boost::filesystem::path& dir )
+{
+	std::size_t n = 0;
+	for ( boost::filesystem::directory_iterator it( dir ); it != boost::filesystem::directory_iterator(); ++it )
+		n++;
+	return n;
+}
+
+} // anonymous namespace
+
+
+void TestFlightRecorder()
+{
+	BOOST_CHECK_EQUAL( sizeof( Util::FlightRecorder::Record ), 72u );
+
+	// nothing is recorded before the start
+	Util::FlightRecorder::clear();
+	Util::FlightRecorder::record( 'i', "flight_test_stopped" );
+	BOOST_CHECK( eventsNamed( "flight_test_stopped" ).empty() );
+
+	Util::FlightRecorder::start( 100, 60.0 );
+	BOOST_CHECK( Util::FlightRecorder::running() );
+
+	// the ring of a thread keeps the newest records, 100 is rounded up to 128
+	boost::thread thread( boost::bind( &recordMany, 1000u ) );
+	thread.join();
+	{
+		const std::vector< Util::FlightRecorder::Event > events( eventsNamed( "flight_test_many" ) );
+		BOOST_REQUIRE_EQUAL( events.size(), 128u );
+		BOOST_CHECK_EQUAL( events.front().record.args[ 0 ].u, 872u );
+		BOOST_CHECK_EQUAL( events.back().record.args[ 0 ].u, 999u );
+		BOOST_CHECK_EQUAL( events.back().record.phase, 'i' );
+	}
+
+	// arguments keep their type and labels are truncated
+	Util::FlightRecorder::record( 'i', "flight_test_args", "u,i,d", 3u, -4, 0.5,
+		"a_component_with_a_long_name", "Output" );
+	{
+		const std::vector< Util::FlightRecorder::Event > events( eventsNamed( "flight_test_args" ) );
+		BOOST_REQUIRE_EQUAL( events.size(), 1u );
+		const Util::FlightRecorder::Record& r( events[ 0 ].record );
+		BOOST_CHECK_EQUAL( r.args[ 0 ].u, 3u );
+		BOOST_CHECK_EQUAL( r.args[ 1 ].i, -4 );
+		BOOST_CHECK_EQUAL( r.args[ 2 ].d, 0.5 );
+		BOOST_CHECK_EQUAL( std::string( r.label ), std::string( "a_component_with_a_lo" ) );
+		BOOST_CHECK( events[ 0 ].thread != eventsNamed( "flight_test_many" )[ 0 ].thread );
+	}
+
+#ifdef ENABLE_FLIGHT_RECORDER
+	// spans record their begin and end with the attributes
+	span();
+	{
+		const std::vector< Util::FlightRecorder::Event > events( eventsNamed( "flight_test_span" ) );
+		BOOST_REQUIRE_EQUAL( events.size(), 2u );
+		BOOST_CHECK_EQUAL( events[ 0 ].record.phase, 'B' );
+		BOOST_CHECK_EQUAL( events[ 1 ].record.phase, 'E' );
+		BOOST_CHECK_EQUAL( events[ 0 ].record.args[ 0 ].u, 5u );
+		BOOST_CHECK_EQUAL( events[ 1 ].record.args[ 1 ].u, 7u );
+		BOOST_CHECK( events[ 0 ].record.time <= events[ 1 ].record.time );
+	}
+#endif
+
+	// the dump is valid json in the trace event format
+	{
+		std::stringstream json;
+		Util::FlightRecorder::dump( json, "test \"dump\"" );
+		boost::property_tree::ptree tree;
+		BOOST_REQUIRE_NO_THROW( boost::property_tree::read_json( json, tree ) );
+		BOOST_CHECK_EQUAL( tree.get< std::string >( "otherData.reason" ), "test \"dump\"" );
+
+		std::size_t nArgs = 0;
+		BOOST_FOREACH( const boost::property_tree::ptree::value_type& e, tree.get_child( "traceEvents" ) )
+			if ( e.second.get< std::string >( "name" ) == "flight_test_args" )
+			{
+				BOOST_CHECK_EQUAL( e.second.get< std::string >( "ph" ), "i" );
+				BOOST_CHECK_EQUAL( e.second.get< int >( "args.i" ), -4 );
+				BOOST_CHECK_EQUAL( e.second.get< double >( "args.d" ), 0.5 );
+				BOOST_CHECK_EQUAL( e.second.get< std::string >( "args.label" ), "a_component_with_a_lo" );
+				nArgs++;
+			}
+		BOOST_CHECK_EQUAL( nArgs, 1u );
+	}
+
+	const boost::filesystem::path dir( "FlightRecorderTest.dir" );
+	boost::filesystem::remove_all( dir );
+	boost::filesystem::create_directory( dir );
+	Util::FlightRecorder::setDumpDirectory( dir.string() );
+	Util::FlightRecorder::setDumpInterval( 0 );
+
+	// a slow block timer run writes a dump
+	{
+		Util::BlockTimer timer( "flight_test_timer" );
+		timer.setDumpThreshold( 1.0 );
+		BOOST_CHECK_CLOSE( timer.getDumpThreshold(), 1.0, 1.0 );
+		{
+			UBITRACK_TIME( timer );
+		}
+		BOOST_CHECK_EQUAL( countFiles( dir ), 0u );
+		{
+			UBITRACK_TIME( timer );
+			Util::sleep( 5 );
+		}
+		BOOST_CHECK_EQUAL( countFiles( dir ), 1u );
+		BOOST_CHECK_EQUAL( eventsNamed( "block_timer" ).size(), 2u );
+	}
+
+	// so does an exception when enabled
+	Util::FlightRecorder::setDumpOnException( true );
+	try
+	{
+		UBITRACK_THROW( "flight test" );
+	}
+	catch ( const Util::Exception& )
+	{}
+	Util::FlightRecorder::setDumpOnException( false );
+	BOOST_CHECK_EQUAL( countFiles( dir ), 2u );
+	{
+		const std::vector< Util::FlightRecorder::Event > events( eventsNamed( "exception" ) );
+		BOOST_REQUIRE( !events.empty() );
+		BOOST_CHECK_EQUAL( std::string( events.back().record.label ), "flight test" );
+	}
+
+	// triggered dumps are rate limited
+	Util::FlightRecorder::setDumpInterval( 3600 );
+	BOOST_CHECK( Util::FlightRecorder::trigger( "test" ).empty() );
+	BOOST_CHECK_EQUAL( countFiles( dir ), 2u );
+	Util::FlightRecorder::setDumpInterval( 10 );
+
+	// a stopped recorder keeps its events and does not trigger
+	Util::FlightRecorder::stop();
+	BOOST_CHECK( !Util::FlightRecorder::running() );
+	BOOST_CHECK( !eventsNamed( "flight_test_args" ).empty() );
+	Util::FlightRecorder::clear();
+	BOOST_CHECK( Util::FlightRecorder::snapshot().empty() );
+	Util::FlightRecorder::setDumpDirectory( std::string() );
+
+	boost::filesystem::remove_all( dir );
+}
@@ -0,0 +1,95 @@
+#include <utUtil/GlobFiles.h>
+#include <utUtil/Exception.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+void touch( const boost::filesystem::path& p, const std::size_t size = 0 )
+{
+	std::ofstream out( p.string().c_str(), std::ios::binary );
+	out << std::string( size, 'x' );
+}
+
+} // anonymous namespace
+
+
+void TestGlobFiles()
+{
+	// natural order
+	BOOST_CHECK( Util::naturalLess( "frame9.png", "frame10.png" ) );
+	BOOST_CHECK( !Util::naturalLess( "frame10.png", "frame9.png" ) );
+	BOOST_CHECK( Util::naturalLess( "frame10.png", "frame10a.png" ) );
+	BOOST_CHECK( Util::naturalLess( "a.png", "b.png" ) );
+	BOOST_CHECK( Util::naturalLess( "frame01.png", "frame1.png" ) || Util::naturalLess( "frame1.png", "frame01.png" ) );
+	BOOST_CHECK( Util::naturalLess( "frame002.png", "frame10.png" ) );
+	BOOST_CHECK( !Util::naturalLess( "x", "x" ) );
+
+	const boost::filesystem::path dir( "GlobFilesTest.dir" );
+	const std::string index = "GlobFilesTest.index";
+	boost::filesystem::remove_all( dir );
+	std::remove( index.c_str() );
+	boost::filesystem::create_directory( dir );
+	for ( int i = 0; i < 300; i++ )
+		touch( dir / ( "frame" + boost::lexical_cast< std::string >( i ) + ".png" ), i % 7 );
+	touch( dir / "notes.txt" );
+	boost::filesystem::create_directory( dir / "sub.png" );
+
+	// names are matched, directories skipped, sizes and natural order are right
+	Util::GlobOptions options;
+	options.threads = 4;
+	Util::GlobFileList files;
+	BOOST_CHECK( !Util::scanFiles( dir.string(), Util::GlobPattern::get( Util::PATTERN_OPENCV_IMAGE_FILES ), files, options ) );
+	BOOST_REQUIRE_EQUAL( files.size(), 300u );
+	for ( std::size_t i = 0; i < files.size(); i++ )
+	{
+		BOOST_CHECK_EQUAL( files[ i ].path.filename().string(), "frame" + boost::lexical_cast< std::string >( i ) + ".png" );
+		BOOST_CHECK_EQUAL( files[ i ].size, i % 7 );
+		BOOST_CHECK( !files[ i ].directory );
+	}
+	BOOST_CHECK_EQUAL( files.paths().back().filename().string(), "frame299.png" );
+
+	// the same result as globFiles, apart from the order
+	std::list< boost::filesystem::path > list;
+	Util::globFiles( dir.string(), Util::PATTERN_OPENCV_IMAGE_FILES, list );
+	BOOST_CHECK_EQUAL( list.size(), files.size() );
+
+	Util::GlobFileList directories;
+	Util::scanFiles( dir.string(), Util::GlobPattern::get( Util::PATTERN_DIRECTORIES ), directories );
+	BOOST_REQUIRE_EQUAL( directories.size(), 1u );
+	BOOST_CHECK( directories[ 0 ].directory );
+
+	// the index is written on the first scan, and only trusted when the directory is old enough
+	options.indexFile = index;
+	files.clear();
+	BOOST_CHECK( !Util::scanFiles( dir.string(), Util::GlobPattern( ".*\\.txt" ), files, options ) );
+	BOOST_CHECK_EQUAL( files.size(), 1u );
+	BOOST_CHECK( boost::filesystem::exists( index ) );
+
+	const std::time_t old = std::time( 0 ) - 100;
+	boost::filesystem::last_write_time( dir, old );
+	files.clear();
+	BOOST_CHECK( !Util::scanFiles( dir.string(), Util::GlobPattern::get( Util::PATTERN_OPENCV_IMAGE_FILES ), files, options ) );
+	files.clear();
+	BOOST_CHECK( Util::scanFiles( dir.string(), Util::GlobPattern::get( Util::PATTERN_OPENCV_IMAGE_FILES ), files, options ) );
+	BOOST_REQUIRE_EQUAL( files.size(), 300u );
+	BOOST_CHECK_EQUAL( files[ 13 ].path, dir / "frame13.png" );
+	BOOST_CHECK_EQUAL( files[ 13 ].size, 6u );
+
+	// a changed directory is scanned again
+	touch( dir / "frame300.png" );
+	files.clear();
+	BOOST_CHECK( !Util::scanFiles( dir.string(), Util::GlobPattern::get( Util::PATTERN_OPENCV_IMAGE_FILES ), files, options ) );
+	BOOST_CHECK_EQUAL( files.size(), 301u );
+
+	BOOST_CHECK_THROW( Util::scanFiles( "GlobFilesTest.missing", Util::GlobPattern( ".*" ), files ), Util::Exception );
+
+	boost::filesystem::remove_all( dir );
+	std::remove( index.c_str() );
+}
@@ -0,0 +1,67 @@
+#include <utUtil/HistogramBlockTimer.h>
+
+#include <sstream>
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** adds the run times 1..n ticks */
+void timerWorker( Util::HistogramBlockTimer& timer, const unsigned n )
+{
+	for ( unsigned i = 1; i <= n; i++ )
+		timer.addMeasurement( i );
+}
+
+} // anonymous namespace
+
+
+void TestHistogramBlockTimer()
+{
+	// buckets are contiguous and cover their values
+	for ( unsigned i = 1; i < Util::HistogramBlockTimer::NBuckets; i++ )
+		BOOST_CHECK_EQUAL( Util::HistogramBlockTimer::bucket( Util::HistogramBlockTimer::bucketUpperBound( i - 1 ) + 1 ), i );
+	const boost::uint64_t values[] = { 0, 1, 7, 8, 9, 100, 1000, 123456789, ~boost::uint64_t( 0 ) };
+	for ( unsigned i = 0; i < sizeof( values ) / sizeof( values[ 0 ] ); i++ )
+	{
+		const unsigned b = Util::HistogramBlockTimer::bucket( values[ i ] );
+		BOOST_CHECK( b < Util::HistogramBlockTimer::NBuckets );
+		BOOST_CHECK( Util::HistogramBlockTimer::bucketUpperBound( b ) >= values[ i ] );
+		BOOST_CHECK( Util::HistogramBlockTimer::bucketUpperBound( b ) - values[ i ] <= values[ i ] / 8 );
+	}
+
+	// concurrent runs from more threads than shards are all counted
+	Util::HistogramBlockTimer timer( "test" );
+	const unsigned nThreads = Util::HistogramBlockTimer::NShards + 2;
+	const unsigned n = 10000;
+	boost::thread_group threads;
+	for ( unsigned i = 0; i < nThreads; i++ )
+		threads.create_thread( boost::bind( &timerWorker, boost::ref( timer ), n ) );
+	threads.join_all();
+
+	const double msPerTick = 1000.0 / Util::getHighPerformanceFrequency();
+	const Util::HistogramBlockTimer::Statistics stats( timer.getStatistics() );
+	BOOST_CHECK_EQUAL( stats.runs, nThreads * n );
+	BOOST_CHECK_CLOSE( stats.total, nThreads * ( n * ( n + 1.0 ) / 2 ) * msPerTick, 1e-6 );
+	BOOST_CHECK_CLOSE( stats.max, n * msPerTick, 1e-6 );
+
+	// percentiles of the uniform distribution, within the bucket resolution
+	BOOST_CHECK( stats.p50 >= 0.5 * n * msPerTick && stats.p50 <= 0.5 * n * 1.125 * msPerTick );
+	BOOST_CHECK( stats.p99 >= 0.99 * n * msPerTick && stats.p99 <= stats.max );
+	BOOST_CHECK( stats.p999 >= stats.p99 && stats.p999 <= stats.max );
+
+	// timing a block
+	{
+		UBITRACK_TIME_HISTOGRAM( timer );
+	}
+	BOOST_CHECK_EQUAL( timer.getStatistics().runs, nThreads * n + 1 );
+
+	std::ostringstream s;
+	s << timer;
+	BOOST_CHECK( s.str().find( "p99.9" ) != std::string::npos );
+}
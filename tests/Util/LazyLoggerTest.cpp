@@ -0,0 +1,38 @@
+#include <utUtil/LazyLogger.h>
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <log4cpp/Category.hh>
+#include <log4cpp/StringQueueAppender.hh>
+
+using namespace Ubitrack;
+
+namespace {
+
+// defined before main, the category must not exist until the first log statement
+static Util::LazyLogger g_logger( "Ubitrack.Test.LazyLogger" );
+
+} // anonymous namespace
+
+void TestLazyLogger()
+{
+	BOOST_CHECK_EQUAL( std::string( g_logger.name() ), "Ubitrack.Test.LazyLogger" );
+	BOOST_CHECK( log4cpp::Category::exists( "Ubitrack.Test.LazyLogger" ) == 0 );
+
+	log4cpp::Category& category( g_logger );
+	BOOST_CHECK( log4cpp::Category::exists( "Ubitrack.Test.LazyLogger" ) == &category );
+	BOOST_CHECK_EQUAL( &g_logger.category(), &category );
+
+	// works with the logging macros
+	log4cpp::StringQueueAppender* pAppender = new log4cpp::StringQueueAppender( "lazy" );
+	category.addAppender( pAppender );
+	category.setAdditivity( false );
+	category.setPriority( log4cpp::Priority::ERROR );
+	LOG4CPP_WARN( g_logger, "suppressed" );
+	LOG4CPP_ERROR( g_logger, "value " << 42 );
+	BOOST_REQUIRE_EQUAL( pAppender->queueSize(), 1u );
+	BOOST_CHECK( pAppender->getQueue().front().find( "value 42" ) != std::string::npos );
+	category.removeAppender( pAppender );
+}
@@ -0,0 +1,168 @@
+#include <utUtil/NoAllocationGuard.h>
+// reports all allocations of the test executable to the guards
+#include <utUtil/NoAllocationGuardNew.h>
+
+#include <utMath/Vector.h>
+#include <utMath/Matrix.h>
+#include <utMath/ErrorVector.h>
+#include <utMath/Random/Scalar.h>
+#include <utMath/Stochastic/Kalman.h>
+#include <utMath/Optimization/LevenbergMarquardt.h>
+#include <utMath/Optimization/Function/LinearFunction.h>
+#include <utMeasurement/Measurement.h>
+#include <utTracking/PoseKalmanFilterT.h>
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+using namespace Ubitrack::Math;
+
+namespace {
+
+typedef Ubitrack::Util::NoAllocationGuard Guard;
+
+void checkInactive( bool& bActive )
+{
+	bActive = Guard::active();
+	delete new int( 1 );
+}
+
+/** fits y = a * exp( b * x ) + c, see LevenbergMarquardtTest */
+class ExponentialCurve
+{
+public:
+	ExponentialCurve( const std::vector< double >& x )
+		: m_x( x )
+	{}
+
+	std::size_t size() const
+	{ return m_x.size(); }
+
+	template< class VT1, class VT2, class MT >
+	void evaluateWithJacobian( VT1& result, const VT2& input, MT& J ) const
+	{
+		for ( std::size_t i = 0; i < m_x.size(); i++ )
+		{
+			const double e = std::exp( input( 1 ) * m_x[ i ] );
+			result( i ) = input( 0 ) * e + input( 2 );
+			J( i, 0 ) = e;
+			J( i, 1 ) = input( 0 ) * m_x[ i ] * e;
+			J( i, 2 ) = 1;
+		}
+	}
+
+protected:
+	const std::vector< double >& m_x;
+};
+
+} // anonymous namespace
+
+
+void TestNoAllocationGuard()
+{
+	// counting regions
+	BOOST_CHECK( !Guard::active() );
+	{
+		Guard guard( Guard::Count );
+		BOOST_CHECK( Guard::active() );
+		BOOST_CHECK_EQUAL( guard.violations(), 0u );
+		delete new int( 1 );
+		BOOST_CHECK_EQUAL( guard.violations(), 1u );
+
+		// formatting, e.g. of log messages
+		std::ostringstream s;
+		s << "formatted " << 1.5 << std::string( 100, 'x' );
+		const std::size_t nFormatted = guard.violations();
+		BOOST_CHECK( nFormatted > 1 );
+
+		{
+			Guard inner( Guard::Count );
+			delete[] new char[ 16 ];
+			BOOST_CHECK_EQUAL( inner.violations(), 1u );
+		}
+		BOOST_CHECK( Guard::active() );
+		BOOST_CHECK_EQUAL( guard.violations(), nFormatted + 1 );
+
+		// guards only watch their own thread
+		bool bActive = true;
+		boost::thread thread( boost::bind( &checkInactive, boost::ref( bActive ) ) );
+		thread.join();
+		BOOST_CHECK( !bActive );
+	}
+	BOOST_CHECK( !Guard::active() );
+
+	// logged violations
+	{
+		Guard guard( Guard::Log );
+		std::vector< int > v( 10 );
+		BOOST_CHECK_EQUAL( guard.violations(), 1u );
+	}
+
+	// steady state of the fixed-size kalman filter updates
+	{
+		Matrix< double, 3, 6 > h;
+		for ( std::size_t r = 0; r < 3; r++ )
+			for ( std::size_t c = 0; c < 6; c++ )
+				h( r, c ) = Random::distribute_uniform< double >( -1, 1 );
+		const Optimization::Function::LinearFunction< 3, 6, double > mf( h );
+		ErrorVector< double, 6 > state( Vector< double, 6 >::zeros(), Matrix< double, 6, 6 >::identity() );
+		const ErrorVector< double, 3 > measurement( Vector< double, 3 >( 0.1, 0.2, 0.3 ), Matrix< double, 3, 3 >::identity() * 0.01 );
+
+		Guard guard( Guard::Count );
+		for ( int i = 0; i < 10; i++ )
+			Stochastic::kalmanMeasurementUpdate< 6, 3 >( state, mf, measurement );
+		BOOST_CHECK_EQUAL( guard.violations(), 0u );
+	}
+
+	// steady state of the pose filter, the measurements are created outside of the region
+	{
+		Tracking::PoseKalmanFilterT< 1, 1 > filter( Tracking::LinearPoseMotionModel( 1, 1 ) );
+		std::vector< Measurement::ErrorPose > measurements;
+		for ( int i = 0; i < 40; i++ )
+			measurements.push_back( Measurement::ErrorPose( 1000000000ULL + 10000000ULL * i,
+				ErrorPose( Quaternion(), Vector< double, 3 >( 0.01 * i, 0, 1 ), Matrix< double, 6, 6 >::identity() * 1e-4 ) ) );
+		for ( int i = 0; i < 20; i++ )
+			filter.addPoseMeasurement( measurements[ i ] );
+
+		Guard guard( Guard::Count );
+		for ( int i = 20; i < 40; i++ )
+		{
+			filter.timeUpdate( measurements[ i ].time() );
+			filter.addPoseMeasurement( measurements[ i ] );
+		}
+		BOOST_CHECK_EQUAL( guard.violations(), 0u );
+	}
+
+	// levenberg-marquardt with a workspace, after its buffers have been allocated
+	{
+		std::vector< double > x( 30 );
+		Vector< double > y( 30 );
+		for ( std::size_t i = 0; i < 30; i++ )
+		{
+			x[ i ] = i / 15.0;
+			y( i ) = 1.5 * std::exp( -0.7 * x[ i ] ) + 0.2;
+		}
+		const ExponentialCurve curve( x );
+		Optimization::LevenbergMarquardtWorkspace< double > workspace;
+		Vector< double > params( 3 );
+		params( 0 ) = 1;
+		params( 1 ) = params( 2 ) = 0;
+		Vector< double > start( params );
+		Optimization::levenbergMarquardt( workspace, curve, params, y, Optimization::OptTerminate( 20, 1e-10 ), Optimization::OptNoNormalize() );
+
+		Guard guard( Guard::Count );
+		for ( int i = 0; i < 5; i++ )
+		{
+			params = start;
+			Optimization::levenbergMarquardt( workspace, curve, params, y, Optimization::OptTerminate( 20, 1e-10 ), Optimization::OptNoNormalize() );
+		}
+		BOOST_CHECK_EQUAL( guard.violations(), 0u );
+		BOOST_CHECK_SMALL( params( 0 ) - 1.5, 1e-6 );
+	}
+}
@@ -0,0 +1,57 @@
+#include <utUtil/OS.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+void TestOS()
+{
+	// the monotonic clock advances with sleep
+	const long long start = Util::getMonotonicTime();
+	Util::sleep( 2 );
+	BOOST_CHECK( Util::getMonotonicTime() - start >= 2000000 );
+
+	// absolute deadlines are never missed early, and spinning keeps wakeups close to them
+	for ( int i = 0; i < 20; i++ )
+	{
+		const long long deadline = Util::getMonotonicTime() + 1000000;
+		Util::sleepUntil( deadline, 300000 );
+		const long long woken = Util::getMonotonicTime();
+		BOOST_CHECK( woken >= deadline );
+		BOOST_CHECK( woken < deadline + 5000000 );
+	}
+
+	// deadlines in the past return immediately
+	Util::sleepUntil( Util::getMonotonicTime() - 1000000 );
+
+	// a fixed rate does not drift with the time spent between waits
+	Util::PeriodicScheduler scheduler( 1000000 );
+	const long long first = scheduler.deadline();
+	for ( int i = 0; i < 50; i++ )
+	{
+		scheduler.wait();
+		Util::sleep( 0, 300000 );
+	}
+	BOOST_CHECK_EQUAL( scheduler.deadline(), first + 50 * 1000000LL + static_cast< long long >( scheduler.missedPeriods() ) * 1000000LL );
+	BOOST_CHECK( Util::getMonotonicTime() >= first + 50 * 1000000LL );
+
+	// missed periods are skipped instead of caught up, the last one returns immediately
+	Util::sleep( 10 );
+	const unsigned long long missed = scheduler.missedPeriods();
+	const long long before = Util::getMonotonicTime();
+	scheduler.wait();
+	BOOST_CHECK( scheduler.missedPeriods() >= missed + 8 );
+	BOOST_CHECK( scheduler.deadline() <= before );
+	BOOST_CHECK( before - scheduler.deadline() < 1000000 );
+
+	scheduler.reset();
+	BOOST_CHECK( scheduler.deadline() >= before );
+
+	// CPU 0 always exists, real-time priorities may need permissions the tests do not have
+	BOOST_CHECK( Util::setThreadAffinity( 0 ) );
+
+	// every machine has at least one NUMA node, the thread on CPU 0 runs on its node
+	BOOST_CHECK( Util::numaNodeCount() >= 1 );
+	BOOST_CHECK( Util::numaNodeOfCpu( 0 ) < Util::numaNodeCount() );
+	BOOST_CHECK_EQUAL( Util::currentNumaNode(), Util::numaNodeOfCpu( 0 ) );
+}
@@ -0,0 +1,89 @@
+#include <utUtil/SamplingProfiler.h>
+#include <utUtil/BlockTimer.h>
+#include <utUtil/TraceSpan.h>
+
+#include <sstream>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+Util::BlockTimer g_outerTimer( "outer" );
+
+volatile double g_sink = 0;
+
+void burn( const long long ns )
+{
+	const long long end = Util::getMonotonicTime() + ns;
+	while ( Util::getMonotonicTime() < end )
+		for ( int i = 0; i < 1000; i++ )
+			g_sink = g_sink + 1e-3;
+}
+
+void inner()
+{
+	Util::ProfilerScope scope( "inner" );
+	burn( 150000000 );
+}
+
+void work()
+{
+	UBITRACK_TIME( g_outerTimer );
+	burn( 50000000 );
+	inner();
+}
+
+void worker()
+{
+	UBITRACK_TRACE_SPAN( "worker", 1 );
+	work();
+}
+
+} // anonymous namespace
+
+
+void TestSamplingProfiler()
+{
+	// nothing is recorded without a running profiler
+	BOOST_CHECK( !Util::SamplingProfiler::push( "unused" ) );
+
+	Util::SamplingProfiler profiler( 1000 );
+	BOOST_CHECK( !profiler.running() );
+	profiler.start();
+	BOOST_CHECK( profiler.running() );
+
+	boost::thread thread( &worker );
+	work();
+	thread.join();
+	profiler.stop();
+	BOOST_CHECK( !profiler.running() );
+
+	const std::map< std::string, unsigned long long > stacks( profiler.collapsedStacks() );
+	BOOST_CHECK( profiler.sampleCount() > 50 );
+	BOOST_CHECK( stacks.count( "outer" ) );
+	BOOST_CHECK( stacks.count( "outer;inner" ) );
+	BOOST_CHECK( stacks.count( "worker;outer;inner" ) );
+	if ( stacks.count( "outer" ) && stacks.count( "outer;inner" ) )
+		BOOST_CHECK( stacks.find( "outer;inner" )->second > stacks.find( "outer" )->second );
+
+	std::ostringstream os;
+	profiler.writeCollapsed( os );
+	BOOST_CHECK( os.str().find( "outer;inner " ) != std::string::npos );
+
+	// a waiting thread uses no CPU time and is not counted
+	profiler.clear();
+	BOOST_CHECK_EQUAL( profiler.sampleCount(), 0u );
+	profiler.start();
+	{
+		Util::ProfilerScope scope( "sleeping" );
+		boost::this_thread::sleep( boost::posix_time::milliseconds( 50 ) );
+	}
+	profiler.stop();
+#ifdef __linux__
+	BOOST_CHECK_EQUAL( profiler.collapsedStacks().count( "sleeping" ), 0u );
+#endif
+}
@@ -0,0 +1,70 @@
+#include <utUtil/SeqLock.h>
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+/** a value that is consistent when all elements are equal */
+struct Block
+{
+	unsigned long long values[ 16 ];
+};
+
+/** copies the value until the writer is done and counts inconsistent copies */
+void seqLockReader( const Util::SeqLock< Block >& lock, const boost::atomic< bool >& done, unsigned& errors, unsigned long long& last )
+{
+	while ( !done.load( boost::memory_order_acquire ) )
+	{
+		const Block b( lock.load() );
+		for ( unsigned i = 1; i < 16; i++ )
+			if ( b.values[ i ] != b.values[ 0 ] )
+				errors++;
+		// values are published in increasing order
+		if ( b.values[ 0 ] < last )
+			errors++;
+		last = b.values[ 0 ];
+	}
+}
+
+} // anonymous namespace
+
+
+void TestSeqLock()
+{
+	// single thread
+	Util::SeqLock< int > lock( 3 );
+	BOOST_CHECK_EQUAL( lock.load(), 3 );
+	lock.store( 4 );
+	BOOST_CHECK_EQUAL( lock.load(), 4 );
+	Util::SeqLock< int > copy( lock );
+	BOOST_CHECK_EQUAL( copy.load(), 4 );
+
+	// readers never see a partially written value
+	Util::SeqLock< Block > blockLock;
+	boost::atomic< bool > done( false );
+	const unsigned nThreads = 3;
+	unsigned errors[ nThreads ] = { 0 };
+	unsigned long long last[ nThreads ] = { 0 };
+	boost::thread_group threads;
+	for ( unsigned i = 0; i < nThreads; i++ )
+		threads.create_thread( boost::bind( &seqLockReader, boost::cref( blockLock ), boost::cref( done ), boost::ref( errors[ i ] ), boost::ref( last[ i ] ) ) );
+
+	Block b;
+	for ( unsigned long long n = 1; n <= 200000; n++ )
+	{
+		for ( unsigned i = 0; i < 16; i++ )
+			b.values[ i ] = n;
+		blockLock.store( b );
+	}
+	done.store( true, boost::memory_order_release );
+	threads.join_all();
+
+	for ( unsigned i = 0; i < nThreads; i++ )
+		BOOST_CHECK_EQUAL( errors[ i ], 0u );
+	BOOST_CHECK_EQUAL( blockLock.load().values[ 15 ], 200000u );
+}
@@ -0,0 +1,199 @@
+#include <utUtil/SerialFraming.h>
+#include <utUtil/SerialPortReactor.h>
+#include <utUtil/Exception.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/test/unit_test.hpp>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <stdlib.h>
+	#include <unistd.h>
+#endif
+
+// last, as it defines the parity macros N, O and E
+#include <utUtil/SerialPort.h>
+
+using namespace Ubitrack;
+
+namespace {
+
+std::string frameString( const Util::Frame& f )
+{
+	return std::string( reinterpret_cast< const char* >( f.data ), f.size );
+}
+
+/** passes a string in chunks of the given size through a frame buffer */
+std::vector< std::string > receive( Util::FrameBuffer& buffer, const std::string& data, std::size_t chunk )
+{
+	std::vector< std::string > result;
+	std::vector< Util::Frame > frames;
+	for ( std::size_t pos = 0; pos < data.size(); pos += chunk )
+	{
+		std::size_t space;
+		unsigned char* p = buffer.prepare( space );
+		const std::size_t n = std::min( std::min( chunk, data.size() - pos ), space );
+		std::memcpy( p, data.data() + pos, n );
+		buffer.commit( n, frames );
+		for ( std::size_t i = 0; i < frames.size(); i++ )
+			result.push_back( frameString( frames[ i ] ) );
+	}
+	return result;
+}
+
+std::string cobs( const std::string& s )
+{
+	std::vector< unsigned char > out( s.size() + s.size() / 254 + 2 );
+	const std::size_t n = Util::cobsEncode( reinterpret_cast< const unsigned char* >( s.data() ), s.size(), &out[ 0 ] );
+	return std::string( reinterpret_cast< const char* >( &out[ 0 ] ), n );
+}
+
+#ifndef _WIN32
+
+/** collects batches of frames */
+struct BatchReceiver
+{
+	void onBatch( const Util::Frame* frames, std::size_t count, Measurement::Timestamp arrival )
+	{
+		boost::mutex::scoped_lock lock( mutex );
+		for ( std::size_t i = 0; i < count; i++ )
+		{
+			packets.push_back( frameString( frames[ i ] ) );
+			times.push_back( arrival );
+		}
+		batches++;
+		received.notify_all();
+	}
+
+	bool wait( std::size_t n )
+	{
+		boost::mutex::scoped_lock lock( mutex );
+		const boost::system_time timeout = boost::get_system_time() + boost::posix_time::seconds( 1 );
+		while ( packets.size() < n )
+			if ( !received.timed_wait( lock, timeout ) )
+				return false;
+		return true;
+	}
+
+	BatchReceiver()
+		: batches( 0 )
+	{}
+
+	boost::mutex mutex;
+	boost::condition_variable received;
+	std::vector< std::string > packets;
+	std::vector< Measurement::Timestamp > times;
+	std::size_t batches;
+};
+
+#endif
+
+} // anonymous namespace
+
+
+void TestSerialFraming()
+{
+	// length field after a sync byte, followed by a checksum
+	{
+		const std::string data = std::string( "\xA5\x03\x00" "abc" "S" "\xA5\x01\x00" "d" "S", 12 );
+		Util::FrameBuffer buffer( Util::LengthPrefixParser( 1, 2, 3, 1 ), Util::FrameDecoder(), 16 );
+		for ( std::size_t chunk = 1; chunk < 6; chunk++ )
+		{
+			std::vector< std::string > frames = receive( buffer, data + data, chunk );
+			BOOST_REQUIRE_EQUAL( frames.size(), 4u );
+			BOOST_CHECK_EQUAL( frames[ 0 ], data.substr( 0, 7 ) );
+			BOOST_CHECK_EQUAL( frames[ 3 ], data.substr( 7 ) );
+			BOOST_CHECK_EQUAL( buffer.pending(), 0u );
+		}
+
+		// big endian length fields, and too long frames are skipped
+		Util::LengthPrefixParser bigEndian( 0, 2, 2, 0, true, 100 );
+		const unsigned char frame[] = { 0x00, 0x02, 'x', 'y' };
+		BOOST_CHECK_EQUAL( bigEndian( frame, 3 ), 0 );
+		BOOST_CHECK_EQUAL( bigEndian( frame, 4 ), 4 );
+		const unsigned char garbage[] = { 0x7f, 0x02 };
+		BOOST_CHECK_EQUAL( bigEndian( garbage, 2 ), -1 );
+		BOOST_CHECK_THROW( Util::LengthPrefixParser( 2, 2, 3 ), Util::Exception );
+	}
+
+	// COBS
+	{
+		const std::string payloads[] = { std::string( "\x11\x00\x22\x00\x00\x33", 6 ), "", std::string( 300, 'x' ), std::string( 1, '\0' ) };
+		std::string stream( 1, '\0' );
+		for ( std::size_t i = 0; i < 4; i++ )
+		{
+			const std::string encoded = cobs( payloads[ i ] );
+			BOOST_CHECK( encoded.find( '\0' ) == encoded.size() - 1 );
+			stream += encoded;
+		}
+		// an invalid frame is dropped
+		stream += std::string( "\x05\x01\x00", 3 );
+
+		Util::FrameBuffer buffer( Util::CobsParser(), &Util::cobsDecode, 1024 );
+		std::vector< std::string > frames = receive( buffer, stream, 7 );
+		BOOST_REQUIRE_EQUAL( frames.size(), 4u );
+		for ( std::size_t i = 0; i < 4; i++ )
+			BOOST_CHECK( frames[ i ] == payloads[ i ] );
+	}
+
+	// without parser, every chunk is a frame
+	{
+		Util::FrameBuffer buffer( ( Util::FrameParser() ) );
+		std::vector< std::string > frames = receive( buffer, "abcdefg", 3 );
+		BOOST_REQUIRE_EQUAL( frames.size(), 3u );
+		BOOST_CHECK_EQUAL( frames[ 2 ], "g" );
+	}
+
+#ifndef _WIN32
+	int master = posix_openpt( O_RDWR | O_NOCTTY );
+	BOOST_REQUIRE( master >= 0 );
+	grantpt( master );
+	unlockpt( master );
+	const std::string slave( ptsname( master ) );
+
+	// blocking reads, all frames of a chunk have the same time
+	{
+		Util::SerialPort port( slave, 115200 );
+		port.open( 1, 0 );
+		Util::FrameReader reader( port, Util::FixedLengthParser( 3 ) );
+		BOOST_REQUIRE( ::write( master, "abcdefghij", 10 ) == 10 );
+		boost::this_thread::sleep( boost::posix_time::milliseconds( 20 ) );
+
+		std::vector< Util::Frame > frames;
+		const Measurement::Timestamp t = reader.read( frames );
+		BOOST_CHECK( t > 0 );
+		BOOST_REQUIRE_EQUAL( frames.size(), 3u );
+		BOOST_CHECK_EQUAL( frameString( frames[ 2 ] ), "ghi" );
+		BOOST_CHECK_EQUAL( reader.buffer().pending(), 1u );
+
+		// timeout without data
+		BOOST_CHECK_EQUAL( reader.read( frames ), 0u );
+		BOOST_CHECK( frames.empty() );
+		port.close();
+	}
+
+	// batches from the reactor
+	{
+		Util::SerialPort port( slave, 115200 );
+		port.openAsync();
+		BatchReceiver receiver;
+		Util::SerialPortReactor reactor;
+		reactor.addBatched( port, boost::bind( &BatchReceiver::onBatch, &receiver, _1, _2, _3 ), Util::CobsParser(), &Util::cobsDecode );
+
+		std::string data;
+		for ( int i = 0; i < 20; i++ )
+			data += cobs( std::string( "\x01\x00\x02", 3 ) );
+		BOOST_REQUIRE( ::write( master, data.data(), data.size() ) == ssize_t( data.size() ) );
+		BOOST_REQUIRE( receiver.wait( 20 ) );
+		BOOST_CHECK( receiver.packets[ 19 ] == std::string( "\x01\x00\x02", 3 ) );
+		BOOST_CHECK( receiver.batches < 20 );
+	}
+	::close( master );
+#endif
+}
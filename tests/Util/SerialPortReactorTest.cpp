@@ -0,0 +1,136 @@
+#include <utUtil/SerialPortReactor.h>
+#include <utUtil/Exception.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/test/unit_test.hpp>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <stdlib.h>
+	#include <unistd.h>
+#endif
+
+// last, as it defines the parity macros N, O and E
+#include <utUtil/SerialPort.h>
+
+using namespace Ubitrack;
+
+#ifndef _WIN32
+
+namespace {
+
+/** collects the received packets */
+struct Receiver
+{
+	void onPacket( const unsigned char* data, std::size_t size, Measurement::Timestamp arrival )
+	{
+		boost::mutex::scoped_lock lock( mutex );
+		packets.push_back( std::string( reinterpret_cast< const char* >( data ), size ) );
+		times.push_back( arrival );
+		received.notify_all();
+	}
+
+	/** waits up to a second for n packets */
+	bool wait( std::size_t n )
+	{
+		boost::mutex::scoped_lock lock( mutex );
+		const boost::system_time timeout = boost::get_system_time() + boost::posix_time::seconds( 1 );
+		while ( packets.size() < n )
+			if ( !received.timed_wait( lock, timeout ) )
+				return false;
+		return true;
+	}
+
+	boost::mutex mutex;
+	boost::condition_variable received;
+	std::vector< std::string > packets;
+	std::vector< Measurement::Timestamp > times;
+};
+
+/** a pseudo terminal, the slave side is opened as serial port */
+struct PseudoTerminal
+{
+	PseudoTerminal()
+	{
+		master = posix_openpt( O_RDWR | O_NOCTTY );
+		grantpt( master );
+		unlockpt( master );
+		slave = ptsname( master );
+	}
+
+	~PseudoTerminal()
+	{
+		::close( master );
+	}
+
+	void write( const char* s )
+	{
+		BOOST_REQUIRE( ::write( master, s, strlen( s ) ) == ssize_t( strlen( s ) ) );
+	}
+
+	int master;
+	std::string slave;
+};
+
+} // anonymous namespace
+
+#endif
+
+
+void TestSerialPortReactor()
+{
+#ifndef _WIN32
+	PseudoTerminal fixed;
+	PseudoTerminal lines;
+	BOOST_REQUIRE( fixed.master >= 0 && lines.master >= 0 );
+
+	Util::SerialPort fixedPort( fixed.slave, 115200 );
+	Util::SerialPort linePort( lines.slave, 115200 );
+	Util::SerialPortReactor reactor;
+	Receiver fixedReceiver;
+	Receiver lineReceiver;
+
+	// ports have to be opened for asynchronous reads first
+	BOOST_CHECK_THROW( reactor.add( fixedPort, Util::PacketHandler() ), Util::Exception );
+	fixedPort.openAsync();
+	linePort.openAsync();
+	unsigned char c;
+	BOOST_CHECK_THROW( fixedPort.read( &c, 1 ), Util::Exception );
+
+	// two ports on one thread, packets split across writes
+	Util::SerialPortReactor::Channel fixedChannel = reactor.add( fixedPort,
+		boost::bind( &Receiver::onPacket, &fixedReceiver, _1, _2, _3 ), Util::FixedLengthParser( 4 ), 16 );
+	reactor.add( linePort, boost::bind( &Receiver::onPacket, &lineReceiver, _1, _2, _3 ), Util::DelimiterParser( '\n' ) );
+	BOOST_CHECK_EQUAL( reactor.size(), 2u );
+
+	fixed.write( "abcdef" );
+	lines.write( "$GPGGA,1" );
+	fixed.write( "gh" );
+	lines.write( "23\n$GPRMC\n" );
+	for ( int i = 0; i < 10; i++ )
+		fixed.write( "0123" );
+
+	BOOST_REQUIRE( fixedReceiver.wait( 12 ) );
+	BOOST_CHECK_EQUAL( fixedReceiver.packets[ 0 ], "abcd" );
+	BOOST_CHECK_EQUAL( fixedReceiver.packets[ 1 ], "efgh" );
+	BOOST_CHECK_EQUAL( fixedReceiver.packets[ 11 ], "0123" );
+	BOOST_CHECK( fixedReceiver.times[ 0 ] > 0 && fixedReceiver.times[ 0 ] <= fixedReceiver.times[ 11 ] );
+
+	BOOST_REQUIRE( lineReceiver.wait( 2 ) );
+	BOOST_CHECK_EQUAL( lineReceiver.packets[ 0 ], "$GPGGA,123\n" );
+	BOOST_CHECK_EQUAL( lineReceiver.packets[ 1 ], "$GPRMC\n" );
+
+	// no packets after remove
+	reactor.remove( fixedChannel );
+	BOOST_CHECK_EQUAL( reactor.size(), 1u );
+	fixed.write( "wxyz" );
+	BOOST_CHECK( !fixedReceiver.wait( 13 ) );
+
+	// the reactor is destroyed before the ports are closed
+#endif
+}
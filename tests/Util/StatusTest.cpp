@@ -0,0 +1,138 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+#include <utUtil/Status.h>
+#include <utUtil/Exception.h>
+#include <utMath/Optimization/Ransac.h>
+#include <utMath/Vector.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+Util::Status failingOperation()
+{
+	return Util::Status( Util::Status::Degenerate, "degenerate input" );
+}
+
+unsigned throwingLine = 0;
+
+void throwingOperation( const std::string& what )
+{
+	throwingLine = __LINE__ + 1;
+	UBITRACK_THROW( "failed: " + what );
+}
+
+/** estimates an offset between two lists of numbers, reports pairs with equal values as degenerate */
+struct OffsetEstimator
+{
+	bool operator()( double& offset, const std::vector< double >& a, const std::vector< double >& b ) const
+	{
+		if ( a[ 0 ] == b[ 0 ] )
+			return false;
+		offset = b[ 0 ] - a[ 0 ];
+		return true;
+	}
+};
+
+struct OffsetStatusEstimator
+{
+	Util::Status operator()( double& offset, const std::vector< double >& a, const std::vector< double >& b ) const
+	{
+		if ( a[ 0 ] == b[ 0 ] )
+			return Util::Status( Util::Status::Degenerate, "no offset" );
+		offset = b[ 0 ] - a[ 0 ];
+		return Util::Status();
+	}
+};
+
+struct OffsetEvaluator
+{
+	double operator()( const double& offset, const double& a, const double& b ) const
+	{ return std::fabs( a + offset - b ); }
+};
+
+} // anonymous namespace
+
+
+void TestStatus()
+{
+	Util::Status ok;
+	BOOST_CHECK( ok.ok() );
+	BOOST_CHECK( ok );
+	BOOST_CHECK_EQUAL( ok.code(), Util::Status::Ok );
+	BOOST_CHECK_NO_THROW( UBITRACK_CHECK_STATUS( ok ) );
+
+	Util::Status failed = failingOperation();
+	BOOST_CHECK( !failed.ok() );
+	BOOST_CHECK( !failed );
+	BOOST_CHECK_EQUAL( failed.code(), Util::Status::Degenerate );
+	BOOST_CHECK_EQUAL( std::string( failed.message() ), "degenerate input" );
+	try
+	{
+		UBITRACK_CHECK_STATUS( failed );
+		BOOST_ERROR( "UBITRACK_CHECK_STATUS did not throw" );
+	}
+	catch ( const Util::Exception& e )
+	{
+		BOOST_CHECK_EQUAL( std::string( e.what() ), "degenerate input" );
+		BOOST_CHECK( e.line() > 0 );
+	}
+
+	// UBITRACK_THROW still throws a Util::Exception with the location of the throw site
+	try
+	{
+		throwingOperation( "x" );
+		BOOST_ERROR( "UBITRACK_THROW did not throw" );
+	}
+	catch ( const Util::Exception& e )
+	{
+		BOOST_CHECK_EQUAL( std::string( e.what() ), "failed: x" );
+		BOOST_CHECK_EQUAL( e.line(), throwingLine );
+		BOOST_CHECK( std::string( e.file() ).find( "StatusTest.cpp" ) != std::string::npos );
+	}
+	BOOST_CHECK_THROW( UBITRACK_THROW( "literal" ), Util::Exception );
+
+	// legacy RANSAC skips degenerate samples reported by bool or Status results
+	std::vector< double > a, b;
+	for ( int i = 0; i < 20; i++ )
+	{
+		a.push_back( i );
+		b.push_back( i % 5 == 0 ? double( i ) : i + 2.0 );
+	}
+	double offset = 0;
+	const std::size_t nInlier = Math::Optimization::ransac( offset, a, b, 0.1, 1, 10, 10, 100,
+		OffsetEstimator(), OffsetEvaluator() );
+	BOOST_CHECK_EQUAL( nInlier, 16u );
+	BOOST_CHECK_EQUAL( offset, 2.0 );
+
+	offset = 0;
+	BOOST_CHECK_EQUAL( Math::Optimization::ransac( offset, a, b, 0.1, 1, 10, 10, 100,
+		OffsetStatusEstimator(), OffsetEvaluator() ), 16u );
+	BOOST_CHECK_EQUAL( offset, 2.0 );
+}
@@ -0,0 +1,136 @@
+#include <utUtil/TimerRegistry.h>
+#include <utUtil/BlockTimer.h>
+#include <utUtil/HistogramBlockTimer.h>
+#include <utUtil/PerfCounters.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace Ubitrack;
+
+namespace {
+
+const Util::TimerStatistics* findTimer( const std::vector< Util::TimerStatistics >& stats, const std::string& name )
+{
+	for ( std::size_t i = 0; i < stats.size(); i++ )
+		if ( stats[ i ].name == name )
+			return &stats[ i ];
+	return 0;
+}
+
+/** collects the reports of the background reporter */
+struct ReportSink
+{
+	boost::mutex mutex;
+	std::vector< std::string > reports;
+
+	void operator()( const std::string& report )
+	{
+		boost::mutex::scoped_lock l( mutex );
+		reports.push_back( report );
+	}
+};
+
+} // anonymous namespace
+
+
+void TestTimerRegistry()
+{
+	Util::TimerRegistry& registry( Util::TimerRegistry::instance() );
+	{
+		Util::BlockTimer blockTimer( "registry.block" );
+		Util::HistogramBlockTimer histogramTimer( "registry.histogram" );
+
+		// timers without runs are not reported
+		BOOST_CHECK( !findTimer( registry.snapshot(), "registry.block" ) );
+
+		for ( int i = 0; i < 3; i++ )
+		{
+			UBITRACK_TIME( blockTimer );
+		}
+		for ( int i = 0; i < 5; i++ )
+		{
+			UBITRACK_TIME_HISTOGRAM( histogramTimer );
+		}
+
+		const std::vector< Util::TimerStatistics > stats( registry.snapshot() );
+		const Util::TimerStatistics* block = findTimer( stats, "registry.block" );
+		const Util::TimerStatistics* histogram = findTimer( stats, "registry.histogram" );
+		BOOST_REQUIRE( block && histogram );
+		BOOST_CHECK_EQUAL( block->runs, 3u );
+		BOOST_CHECK( !block->hasPercentiles );
+		BOOST_CHECK( block->codeFile.find( "TimerRegistryTest" ) != std::string::npos );
+		BOOST_CHECK_EQUAL( histogram->runs, 5u );
+		BOOST_CHECK( histogram->hasPercentiles );
+		BOOST_CHECK( histogram->max >= histogram->p50 );
+		BOOST_CHECK( findTimer( stats, "registry.block" ) < findTimer( stats, "registry.histogram" ) );
+
+		// one line per timer in JSON, several gauges per timer for statsd
+		const std::string json( Util::TimerRegistry::format( stats, Util::TimerRegistry::JsonLines ) );
+		BOOST_CHECK_EQUAL( std::count( json.begin(), json.end(), '\n' ), static_cast< std::ptrdiff_t >( stats.size() ) );
+		BOOST_CHECK( json.find( "\"name\":\"registry.histogram\"" ) != std::string::npos );
+		BOOST_CHECK( json.find( "\"p99_ms\":" ) != std::string::npos );
+		const std::string statsd( Util::TimerRegistry::format( stats, Util::TimerRegistry::Statsd ) );
+		BOOST_CHECK( statsd.find( "registry.block.runs:3|g\n" ) != std::string::npos );
+		BOOST_CHECK( statsd.find( "registry.histogram.p999:" ) != std::string::npos );
+
+		// the reporter delivers periodic reports
+		ReportSink sink;
+		registry.startReporter( 10, Util::TimerRegistry::JsonLines, boost::bind< void >( boost::ref( sink ), _1 ) );
+		for ( int i = 0; i < 200; i++ )
+		{
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+			boost::mutex::scoped_lock l( sink.mutex );
+			if ( sink.reports.size() >= 2 )
+				break;
+		}
+		registry.stopReporter();
+		BOOST_CHECK( sink.reports.size() >= 2 );
+		BOOST_CHECK( !sink.reports.empty() && sink.reports.back().find( "registry.block" ) != std::string::npos );
+	}
+
+	// hardware counters, if the system allows them
+	{
+		Util::BlockTimer countedTimer( "registry.counted" );
+		countedTimer.enableCounters();
+		volatile double sum = 0;
+		for ( int i = 0; i < 4; i++ )
+		{
+			UBITRACK_TIME( countedTimer );
+			for ( int j = 0; j < 10000; j++ )
+				sum = sum + j;
+		}
+
+		const unsigned available = Util::PerfCounters::available();
+		Util::PerfCounterValues values;
+		BOOST_CHECK_EQUAL( Util::PerfCounters::read( values ), available );
+		BOOST_CHECK_EQUAL( values.valid, available );
+
+		const std::vector< Util::TimerStatistics > stats( registry.snapshot() );
+		const Util::TimerStatistics* counted = findTimer( stats, "registry.counted" );
+		BOOST_REQUIRE( counted );
+		// runs that cannot read the counters are only timed
+		BOOST_CHECK_EQUAL( countedTimer.getCounterRuns(), available ? 4u : 0u );
+		BOOST_CHECK_EQUAL( counted->hasCounters, available != 0 );
+		const std::string json( Util::TimerRegistry::format( stats, Util::TimerRegistry::JsonLines ) );
+		if ( values.has( Util::PerfCounterValues::Instructions ) )
+		{
+			// at least the additions of the loop
+			BOOST_CHECK( counted->instructions > 10000 );
+			BOOST_CHECK( json.find( "\"instructions\":" ) != std::string::npos );
+		}
+		else
+			BOOST_CHECK( counted->instructions < 0 );
+		if ( values.has( Util::PerfCounterValues::Cycles ) && values.has( Util::PerfCounterValues::Instructions ) )
+			BOOST_CHECK( counted->ipc > 0 );
+		if ( !available )
+			BOOST_CHECK( json.find( "\"ipc\":" ) == std::string::npos );
+	}
+
+	// destroyed timers leave the registry
+	BOOST_CHECK( !findTimer( registry.snapshot(), "registry.block" ) );
+	BOOST_CHECK( !findTimer( registry.snapshot(), "registry.histogram" ) );
+}
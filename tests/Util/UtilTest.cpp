@@ -0,0 +1,43 @@
+#include "UtilTest.h"
+
+// declare external tests here, to save us some trivial header files
+void TestHistogramBlockTimer();
+void TestTimerRegistry();
+void TestSeqLock();
+void TestSerialPortReactor();
+void TestSerialFraming();
+void TestAsyncAppender();
+void TestOS();
+void TestGlobFiles();
+void TestStatus();
+void TestSamplingProfiler();
+void TestAllocationTracker();
+void TestExecutor();
+void TestAsync();
+void TestLazyLogger();
+void TestNoAllocationGuard();
+void TestFlightRecorder();
+
+
+
+UtilTest::UtilTest()
+	: boost::unit_test::test_suite( "UtilTests" )
+{
+	add( BOOST_TEST_CASE( &TestHistogramBlockTimer ) );
+	add( BOOST_TEST_CASE( &TestTimerRegistry ) );
+	add( BOOST_TEST_CASE( &TestSeqLock ) );
+	add( BOOST_TEST_CASE( &TestSerialPortReactor ) );
+	add( BOOST_TEST_CASE( &TestSerialFraming ) );
+	add( BOOST_TEST_CASE( &TestAsyncAppender ) );
+	add( BOOST_TEST_CASE( &TestOS ) );
+	add( BOOST_TEST_CASE( &TestGlobFiles ) );
+	add( BOOST_TEST_CASE( &TestStatus ) );
+	add( BOOST_TEST_CASE( &TestSamplingProfiler ) );
+	add( BOOST_TEST_CASE( &TestAllocationTracker ) );
+	add( BOOST_TEST_CASE( &TestExecutor ) );
+	add( BOOST_TEST_CASE( &TestAsync ) );
+	add( BOOST_TEST_CASE( &TestLazyLogger ) );
+	add( BOOST_TEST_CASE( &TestNoAllocationGuard ) );
+	add( BOOST_TEST_CASE( &TestFlightRecorder ) );
+}
+
@@ -7,6 +7,8 @@
 #include "Stochastic/StochasticTest.h"
 #include "Algorithm/AlgorithmTest.h"
 #include "Serializer/SerializerTest.h"
+#include "Measurement/MeasurementTest.h"
+#include "Util/UtilTest.h"
 
 using boost::unit_test::test_suite;
 
@@ -28,6 +30,8 @@ test_suite* init_unit_test_suite( int, char* [] )
 	allTests->add( new StochasticTest );
 	allTests->add( new AlgorithmTest );
 	allTests->add( new SerializerTest );
+	allTests->add( new MeasurementTest );
+	allTests->add( new UtilTest );
 
 	return allTests;
 }